@@ -0,0 +1,167 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests and benchmarks for the Conv2D algorithms of the Eigen compat kernels.
+
+#include <cmath>
+#include <random>
+#include <string>
+
+#include "../lib/compat/eigen/kernels/conv2d.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+using compat::internal::Conv2DAlgorithm;
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+DenseHostTensor CreateRandomTensor(llvm::ArrayRef<ssize_t> dims,
+                                   HostContext* host) {
+  auto dht = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(DType(DType::F32), TensorShape(dims)), host);
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  auto* data = static_cast<float*>(dht->data());
+  for (ssize_t i = 0; i < dht->NumElements(); ++i) data[i] = dist(gen);
+  return std::move(dht.getValue());
+}
+
+DenseHostTensor CreateTensor(llvm::ArrayRef<ssize_t> dims, HostContext* host) {
+  return std::move(DenseHostTensor::CreateUninitialized(
+                       TensorMetadata(DType(DType::F32), TensorShape(dims)),
+                       host)
+                       .getValue());
+}
+
+llvm::Expected<Eigen::NoOpOutputKernel> MakeNoOpOutputKernel(
+    compat::Conv2DParams) {
+  return Eigen::NoOpOutputKernel();
+}
+
+AsyncValueRef<Chain> Conv2D(const DenseHostTensor& input,
+                            const DenseHostTensor& filter,
+                            DenseHostTensor* output, string_view padding,
+                            Conv2DAlgorithm algorithm,
+                            const ExecutionContext& exec_ctx) {
+  const ssize_t strides[] = {1, 1};
+  return compat::internal::Conv2DImpl<float>(input, filter, output, padding,
+                                             strides, MakeNoOpOutputKernel,
+                                             exec_ctx, algorithm);
+}
+
+class WinogradConv2DTest : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(WinogradConv2DTest, MatchesContraction) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  // Odd output sizes exercise the clipped tiles at the image borders.
+  const std::string& padding = GetParam();
+  const ssize_t out_size = padding == "same" ? 9 : 7;
+  auto input = CreateRandomTensor({2, 9, 9, 24}, host.get());
+  auto filter = CreateRandomTensor({3, 3, 24, 20}, host.get());
+  auto expected = CreateTensor({2, out_size, out_size, 20}, host.get());
+  auto output = CreateTensor({2, out_size, out_size, 20}, host.get());
+
+  auto contraction = Conv2D(input, filter, &expected, padding,
+                            Conv2DAlgorithm::kContraction, exec_ctx);
+  auto winograd = Conv2D(input, filter, &output, padding,
+                         Conv2DAlgorithm::kWinograd, exec_ctx);
+  host->Await({contraction.CopyRCRef(), winograd.CopyRCRef()});
+  ASSERT_FALSE(contraction.IsError());
+  ASSERT_FALSE(winograd.IsError());
+
+  const auto* expected_data = static_cast<const float*>(expected.data());
+  const auto* output_data = static_cast<const float*>(output.data());
+  for (ssize_t i = 0; i < output.NumElements(); ++i)
+    ASSERT_NEAR(output_data[i], expected_data[i], 1e-4f) << i;
+}
+
+INSTANTIATE_TEST_SUITE_P(Paddings, WinogradConv2DTest,
+                         ::testing::Values("same", "valid"));
+
+TEST(WinogradConv2DTest, RejectsStridedConvolution) {
+  auto host = CreateTestHostContext(1);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto input = CreateRandomTensor({1, 8, 8, 4}, host.get());
+  auto filter = CreateRandomTensor({3, 3, 4, 4}, host.get());
+  auto output = CreateTensor({1, 4, 4, 4}, host.get());
+
+  const ssize_t strides[] = {2, 2};
+  auto chain = compat::internal::Conv2DImpl<float>(
+      input, filter, &output, "same", strides, MakeNoOpOutputKernel, exec_ctx,
+      Conv2DAlgorithm::kWinograd);
+  host->Await(chain.CopyRCRef());
+  EXPECT_TRUE(chain.IsError());
+}
+
+// Benchmarks a 3x3 "same" convolution of an [n, h, w, c] input to `k` output
+// channels.
+void Conv2D3x3(benchmark::State& state, Conv2DAlgorithm algorithm, ssize_t n,
+               ssize_t h, ssize_t w, ssize_t c, ssize_t k) {
+  auto host = CreateTestHostContext(8);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto input = CreateRandomTensor({n, h, w, c}, host.get());
+  auto filter = CreateRandomTensor({3, 3, c, k}, host.get());
+  auto output = CreateTensor({n, h, w, k}, host.get());
+
+  for (auto _ : state) {
+    auto chain = Conv2D(input, filter, &output, "same", algorithm, exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(n * h * w * k * state.iterations());
+}
+
+#define BM_Conv2D3x3(ALGORITHM, N, H, W, C, K)                             \
+  static void BM_Conv2D3x3_##ALGORITHM##_##N##x##H##x##W##x##C##_##K(      \
+      benchmark::State& state) {                                           \
+    Conv2D3x3(state, Conv2DAlgorithm::k##ALGORITHM, N, H, W, C, K);        \
+  }                                                                        \
+  BENCHMARK(BM_Conv2D3x3_##ALGORITHM##_##N##x##H##x##W##x##C##_##K)
+
+BM_Conv2D3x3(Contraction, 1, 56, 56, 64, 64);
+BM_Conv2D3x3(Winograd, 1, 56, 56, 64, 64);
+
+BM_Conv2D3x3(Contraction, 8, 28, 28, 128, 128);
+BM_Conv2D3x3(Winograd, 8, 28, 28, 128, 128);
+
+BM_Conv2D3x3(Contraction, 8, 14, 14, 256, 256);
+BM_Conv2D3x3(Winograd, 8, 14, 14, 256, 256);
+
+}  // namespace
+}  // namespace tfrt
@@ -21,16 +21,21 @@
 #define EIGEN_USE_THREADS
 
 #include "tfrt/dtype/dtype.h"
+#include "tfrt/support/bf16.h"
 #include "tfrt/support/fp16.h"
 #include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
 
 namespace tfrt {
 
+// The storage only types fp16 and bf16 are replaced with Eigen's arithmetic
+// types of the same layout.
 template <DType::Kind K>
-using EigenTypeForDTypeKind =
-    std::conditional_t<std::is_same<fp16, TypeForDTypeKind<K>>::value,
-                       Eigen::half, TypeForDTypeKind<K>>;
+using EigenTypeForDTypeKind = std::conditional_t<
+    std::is_same<fp16, TypeForDTypeKind<K>>::value, Eigen::half,
+    std::conditional_t<std::is_same<bf16, TypeForDTypeKind<K>>::value,
+                       Eigen::bfloat16, TypeForDTypeKind<K>>>;
 TFRT_REGISTER_DTYPE(Eigen::half, F16)
+TFRT_REGISTER_DTYPE(Eigen::bfloat16, BF16)
 }  // namespace tfrt
 
 namespace llvm {
@@ -46,6 +51,16 @@ struct PointerLikeTypeTraits<Eigen::half *> {
   // NOLINTNEXTLINE(readability-identifier-naming)
   static constexpr int NumLowBitsAvailable = 2;
 };
+template <>
+struct PointerLikeTypeTraits<Eigen::bfloat16 *> {
+  static inline void *getAsVoidPointer(Eigen::bfloat16 *ptr) { return ptr; }
+  static inline Eigen::bfloat16 *getFromVoidPointer(void *ptr) {
+    return static_cast<Eigen::bfloat16 *>(ptr);
+  }
+  // alignof(Eigen::bfloat16) == 2 (see Eigen/src/Core/arch/Default/BFloat16.h).
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  static constexpr int NumLowBitsAvailable = 1;
+};
 }  // namespace llvm
 
 #endif  // TFRT_BACKENDS_COMMON_COMPAT_EIGEN_DTYPE_H_
@@ -23,9 +23,14 @@
 #define TFRT_BACKENDS_COMMON_COMPAT_EIGEN_EVAULATOR_H_
 
 #include <cassert>
+#include <memory>
 #include <type_traits>
+#include <utility>
 
 #include "./thread_pool_device.h"
+#include "llvm/ADT/Optional.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/support/error_util.h"
 
 namespace tfrt {
@@ -39,6 +44,16 @@ class AsyncEigenEvaluator {
   explicit AsyncEigenEvaluator(HostContext* host)
       : ctx_(host->GetOrCreateSharedContext<compat::EigenHostContext>()) {}
 
+  // Evaluators constructed from the execution context run `ParallelEvaluate`
+  // blocks as ParallelFor tasks of the request.
+  explicit AsyncEigenEvaluator(const ExecutionContext& exec_ctx)
+      : ctx_(exec_ctx.host()
+                 ->GetOrCreateSharedContext<compat::EigenHostContext>()),
+        exec_ctx_(exec_ctx) {}
+
+  HostContext* host() const { return ctx_.host(); }
+  int NumThreads() const { return ctx_.Device().numThreads(); }
+
   template <typename... DenseHostTensors>
   auto KeepAlive(DenseHostTensors&&... tensors)
       -> std::array<RCReference<HostBuffer>, sizeof...(DenseHostTensors)> {
@@ -69,6 +84,37 @@ class AsyncEigenEvaluator {
                        std::move(args));
   }
 
+  // Calls `block_fn(begin, end)` for non-overlapping blocks of the [0, n)
+  // range in parallel. Each block is expected to do its own (single threaded)
+  // Eigen evaluation, so workers are never blocked waiting for Eigen tasks.
+  // Blocks are sized after the `cost` of one element of the range.
+  template <typename BlockFn, typename ArgLifetimeExtension>
+  AsyncValueRef<Chain> ParallelEvaluate(size_t n, ParallelFor::Cost cost,
+                                        BlockFn block_fn,
+                                        ArgLifetimeExtension args) {
+    if (exec_ctx_.hasValue()) {
+      return ParallelFor(*exec_ctx_).Execute(
+          n, ParallelFor::BlockSizes::FromCost(cost),
+          [block_fn = std::move(block_fn), args = std::move(args)](
+              size_t begin, size_t end) { block_fn(begin, end); });
+    }
+
+    // Without an execution context fall back to the Eigen thread pool device.
+    auto chain = MakeUnconstructedAsyncValueRef<Chain>(ctx_.host());
+    auto done = std::make_shared<
+        std::pair<AsyncValueRef<Chain>, ArgLifetimeExtension>>(
+        chain.CopyRef(), std::move(args));
+    ctx_.Device().parallelForAsync(
+        n,
+        Eigen::TensorOpCost(cost.bytes_loaded, cost.bytes_stored,
+                            cost.compute_cycles),
+        [block_fn = std::move(block_fn)](Eigen::Index begin, Eigen::Index end) {
+          block_fn(begin, end);
+        },
+        [done = std::move(done)]() { done->first.emplace(); });
+    return chain;
+  }
+
   template <typename... Args>
   DependencyToken MakeError(Args&&... args) {
     return MakeErrorAsyncValueRef(ctx_.host(),
@@ -77,6 +123,7 @@ class AsyncEigenEvaluator {
 
  private:
   const EigenHostContext& ctx_;
+  llvm::Optional<ExecutionContext> exec_ctx_;
 };
 
 // AsyncEigenEvaluator does the eigen operation inline in the same thread.
@@ -91,7 +138,12 @@ class SyncEigenEvaluator {
   // AsyncEigenEvaluator.
   using DependencyToken = Error;
 
-  explicit SyncEigenEvaluator(HostContext* host) {}
+  explicit SyncEigenEvaluator(HostContext* host) : host_(host) {}
+  explicit SyncEigenEvaluator(const ExecutionContext& exec_ctx)
+      : host_(exec_ctx.host()) {}
+
+  HostContext* host() const { return host_; }
+  int NumThreads() const { return 1; }
 
   // KeepAlive is a no-op for the sync evaluation.
   template <typename... DenseHostTensors>
@@ -122,10 +174,22 @@ class SyncEigenEvaluator {
     return Error::success();
   }
 
+  // The whole range is evaluated before returning, so `args` only has to be
+  // kept alive for the duration of the call.
+  template <typename BlockFn, typename ArgLifetimeExtension>
+  Error ParallelEvaluate(size_t n, ParallelFor::Cost cost, BlockFn block_fn,
+                         ArgLifetimeExtension args) {
+    if (n > 0) block_fn(0, n);
+    return Error::success();
+  }
+
   template <typename... Args>
   Error MakeError(Args&&... args) {
     return MakeStringError(std::forward<Args>(args)...);
   }
+
+ private:
+  HostContext* host_;
 };
 
 }  // namespace compat
@@ -22,10 +22,20 @@
 #define TFRT_BACKENDS_COMMON_OPS_TF_METADATA_FUNCTIONS_H_
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
 #include "tfrt/core_runtime/op_metadata_function.h"
 
 namespace tfrt {
+class OpAttrsRef;
+
+// Reads the values of the I32 or I64 dense attribute `attr_name`, which holds
+// a folded index argument of `op_name` (e.g. `begin` of _tf.Slice).
+llvm::Error GetFoldedIndices(const OpAttrsRef& attrs, llvm::StringRef op_name,
+                             llvm::StringRef attr_name,
+                             llvm::SmallVectorImpl<ssize_t>* indices);
+
 // This function returns op names and corresponding metadata functions that
 // are used by TF Python API.
 llvm::ArrayRef<std::pair<llvm::StringRef, OpMetadataFn>>
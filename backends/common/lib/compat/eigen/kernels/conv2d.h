@@ -19,9 +19,13 @@
 #ifndef TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_CONV2D_H_
 #define TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_CONV2D_H_
 
+#include <algorithm>
 #include <cstdint>
+#include <initializer_list>
 
 #include "conv2d_shape_functions.h"
+#include "winograd_conv2d.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
 #include "tfrt/common/compat/eigen/contraction_output_kernel.h"
@@ -68,12 +72,19 @@ inline llvm::Error CheckBatchNormArgs(const Conv2DParams& params,
   return llvm::Error::success();
 }
 
+// The algorithm used to compute the convolution.
+enum class Conv2DAlgorithm {
+  kAuto,         // Selected by the convolution shape.
+  kContraction,  // Tensor contraction of the image patches.
+  kWinograd,     // Winograd F(2x2, 3x3), see winograd_conv2d.h.
+};
+
 template <typename T, typename OutputKernelBuilder>
 inline AsyncValueRef<Chain> Conv2DImpl(
     const DenseHostTensor& input, const DenseHostTensor& filter,
     DenseHostTensor* output, string_view padding, ArrayRef<ssize_t> strides,
-    OutputKernelBuilder output_kernel_builder,
-    const ExecutionContext& exec_ctx) {
+    OutputKernelBuilder output_kernel_builder, const ExecutionContext& exec_ctx,
+    Conv2DAlgorithm algorithm = Conv2DAlgorithm::kAuto) {
   DHTIndexableView<T, 4> input_view(&input);
   DHTIndexableView<T, 4> filter_view(&filter);
   MutableDHTIndexableView<T, 4> output_view(output);
@@ -101,6 +112,19 @@ inline AsyncValueRef<Chain> Conv2DImpl(
     return EmitErrorAsync(exec_ctx, StrCat(error));
   }
 
+  const bool use_winograd =
+      algorithm == Conv2DAlgorithm::kWinograd ||
+      (algorithm == Conv2DAlgorithm::kAuto && PreferWinogradConv2D<T>(*params));
+  if (use_winograd) {
+    if (!IsWinogradConv2DSupported(*params)) {
+      return EmitErrorAsync(exec_ctx,
+                            "Winograd convolution requires a 3x3 kernel and "
+                            "1x1 strides");
+    }
+    return WinogradConv2D<T>(input, filter, output, *params,
+                             std::move(*output_kernel), exec_ctx);
+  }
+
   const FixedRankShape<4>& kernel_shape = filter_view.FixedShape();
 
   // 1x1 convolution can be computed as a simple Tensor contraction.
@@ -147,21 +171,19 @@ inline AsyncValueRef<Chain> Conv2DImpl(
   }
 }
 
-template <typename T, typename Activation = Identity>
-AsyncValueRef<Chain> Conv2DBatchNorm(
-    const DenseHostTensor& input, const DenseHostTensor& filter,
+// Returns the builder of the output kernel that applies batch normalization
+// and `Activation` to the convolution output.
+template <typename T, typename Activation>
+auto MakeBatchNormOutputKernelBuilder(
     const DenseHostTensor& scale,   // aka gamma
     const DenseHostTensor& offset,  // aka beta
     const DenseHostTensor& mean, const DenseHostTensor& variance,
-    DenseHostTensor* output, Chain chain_in, Attribute<float> epsilon,
-    StringAttribute padding, ArrayAttribute<ssize_t> strides,
-    const ExecutionContext& exec_ctx) {
+    float epsilon) {
   using OutputKernel = llvm::Expected<BatchNormOutputKernel<T, Activation>>;
 
-  auto output_kernel =
-      [scale = scale.CopyRef(), offset = offset.CopyRef(),
-       mean = mean.CopyRef(), variance = variance.CopyRef(),
-       epsilon = epsilon.get()](Conv2DParams params) -> OutputKernel {
+  return [scale = scale.CopyRef(), offset = offset.CopyRef(),
+          mean = mean.CopyRef(), variance = variance.CopyRef(),
+          epsilon](Conv2DParams params) -> OutputKernel {
     DHTIndexableView<T, 1> scale_view(&scale);
     DHTIndexableView<T, 1> offset_view(&offset);
     DHTIndexableView<T, 1> mean_view(&mean);
@@ -179,9 +201,36 @@ AsyncValueRef<Chain> Conv2DBatchNorm(
         AsEigenConstTensor(variance_view),  // variance
         epsilon);
   };
+}
+
+// Returns the builder of the output kernel that adds `bias` and applies
+// `Activation` to the convolution output.
+template <typename T, typename Activation>
+auto MakeBiasAddOutputKernelBuilder(const DenseHostTensor& bias) {
+  using OutputKernel = llvm::Expected<BiasAddOutputKernel<T, Activation>>;
+
+  return [bias = bias.CopyRef()](Conv2DParams params) -> OutputKernel {
+    DHTIndexableView<T, 1> bias_view(&bias);
+    if (auto err = internal::CheckBias(params, bias_view.FixedShape())) {
+      return std::move(err);
+    }
+    return BiasAddOutputKernel<T, Activation>(AsEigenConstTensor(bias_view));
+  };
+}
 
+template <typename T, typename Activation = Identity>
+AsyncValueRef<Chain> Conv2DBatchNorm(
+    const DenseHostTensor& input, const DenseHostTensor& filter,
+    const DenseHostTensor& scale,   // aka gamma
+    const DenseHostTensor& offset,  // aka beta
+    const DenseHostTensor& mean, const DenseHostTensor& variance,
+    DenseHostTensor* output, Chain chain_in, Attribute<float> epsilon,
+    StringAttribute padding, ArrayAttribute<ssize_t> strides,
+    const ExecutionContext& exec_ctx) {
   return Conv2DImpl<T>(input, filter, output, padding.get(), strides.data(),
-                       std::move(output_kernel), exec_ctx);
+                       MakeBatchNormOutputKernelBuilder<T, Activation>(
+                           scale, offset, mean, variance, epsilon.get()),
+                       exec_ctx);
 }
 
 template <typename T, typename Activation = Identity>
@@ -192,19 +241,63 @@ AsyncValueRef<Chain> Conv2DBias(const DenseHostTensor& input,
                                 StringAttribute padding,
                                 ArrayAttribute<ssize_t> strides,
                                 const ExecutionContext& exec_ctx) {
-  using OutputKernel = llvm::Expected<BiasAddOutputKernel<T, Activation>>;
+  return Conv2DImpl<T>(input, filter, output, padding.get(), strides.data(),
+                       MakeBiasAddOutputKernelBuilder<T, Activation>(bias),
+                       exec_ctx);
+}
 
-  auto output_kernel =
-      [bias = bias.CopyRef()](Conv2DParams params) -> OutputKernel {
-    DHTIndexableView<T, 1> bias_view(&bias);
-    if (auto err = internal::CheckBias(params, bias_view.FixedShape())) {
-      return std::move(err);
-    }
-    return BiasAddOutputKernel<T, Activation>(AsEigenConstTensor(bias_view));
+// Computes Conv2D followed by `fused_ops`, which are applied by the output
+// kernel of the contraction to each output block while it is in cache:
+//   {"BiasAdd"} or {"BiasAdd", "Relu"} with `fusion_inputs` = {bias}
+//   {"FusedBatchNorm"} or {"FusedBatchNorm", "Relu"} with `fusion_inputs` =
+//     {scale, offset, mean, variance}
+template <typename T>
+AsyncValueRef<Chain> FusedConv2D(const DenseHostTensor& input,
+                                 const DenseHostTensor& filter,
+                                 ArrayRef<const DenseHostTensor*> fusion_inputs,
+                                 DenseHostTensor* output, string_view padding,
+                                 ArrayRef<ssize_t> strides,
+                                 ArrayRef<string_view> fused_ops, float epsilon,
+                                 const ExecutionContext& exec_ctx) {
+  auto match_fusion = [&](std::initializer_list<string_view> ops) -> bool {
+    return fused_ops.size() == ops.size() &&
+           std::equal(fused_ops.begin(), fused_ops.end(), ops.begin());
   };
 
-  return Conv2DImpl<T>(input, filter, output, padding.get(), strides.data(),
-                       std::move(output_kernel), exec_ctx);
+  auto check_num_inputs = [&](size_t num_inputs) -> llvm::Error {
+    if (fusion_inputs.size() == num_inputs) return llvm::Error::success();
+    return MakeStringError("fusion ", fused_ops.front(), " expects ",
+                           num_inputs, " inputs, got ", fusion_inputs.size());
+  };
+
+  auto bias_add = [&](auto activation) -> AsyncValueRef<Chain> {
+    using Activation = decltype(activation);
+    if (auto err = check_num_inputs(1))
+      return EmitErrorAsync(exec_ctx, std::move(err));
+    return Conv2DImpl<T>(
+        input, filter, output, padding, strides,
+        MakeBiasAddOutputKernelBuilder<T, Activation>(*fusion_inputs[0]),
+        exec_ctx);
+  };
+
+  auto batch_norm = [&](auto activation) -> AsyncValueRef<Chain> {
+    using Activation = decltype(activation);
+    if (auto err = check_num_inputs(4))
+      return EmitErrorAsync(exec_ctx, std::move(err));
+    return Conv2DImpl<T>(input, filter, output, padding, strides,
+                         MakeBatchNormOutputKernelBuilder<T, Activation>(
+                             *fusion_inputs[0], *fusion_inputs[1],
+                             *fusion_inputs[2], *fusion_inputs[3], epsilon),
+                         exec_ctx);
+  };
+
+  if (match_fusion({"BiasAdd"})) return bias_add(Identity());
+  if (match_fusion({"BiasAdd", "Relu"})) return bias_add(Relu());
+  if (match_fusion({"FusedBatchNorm"})) return batch_norm(Identity());
+  if (match_fusion({"FusedBatchNorm", "Relu"})) return batch_norm(Relu());
+
+  return EmitErrorAsync(exec_ctx, StrCat("unsupported Conv2D fusion: ",
+                                        llvm::join(fused_ops, "+")));
 }
 
 }  // namespace internal
@@ -204,18 +204,19 @@ static AsyncValueRef<Chain> MaxPoolImpl(const DenseHostTensor& input,
     }
   };
 
-  // Compute minimum parallel for block size, to make sure that we do not create
-  // too many small tasks if extracted image patches are tiny.
-  // TODO(ezhulenev): Use Eigen expression cost model? Or add TFRT cost model?
-  static constexpr size_t kMinPatchSize = 1000;
+  // Each output loads an image patch, and stores one value for each channel.
+  // Use the cost model to make sure that we do not create too many small tasks
+  // if extracted image patches are tiny.
   const size_t image_patch_size = num_channels * ksize[0] * ksize[1];
-  const size_t min_block_size =
-      std::max(static_cast<size_t>(1), kMinPatchSize / image_patch_size);
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = image_patch_size * sizeof(T);
+  cost.bytes_stored = num_channels * sizeof(T);
+  cost.compute_cycles = image_patch_size;
   auto chain = MakeUnconstructedAsyncValueRef<Chain>(exec_ctx.host());
   auto args = KeepBuffers::alive(&input, output);
 
   ParallelFor(exec_ctx).Execute(
-      num_outputs, ParallelFor::BlockSizes::Min(min_block_size),
+      num_outputs, ParallelFor::BlockSizes::FromCost(cost),
       std::move(compute),
       [chain = chain.CopyRef(), args = std::move(args)]() { chain.emplace(); });
   return chain;
@@ -26,10 +26,12 @@ void RegisterConv2DGradFilterKernels(KernelRegistry* registry);
 void RegisterConv2DGradInputKernels(KernelRegistry* registry);
 void RegisterMatMulKernels(KernelRegistry* registry);
 
-TFRT_STATIC_KERNEL_REGISTRATION(RegisterEigenKernels);
-TFRT_STATIC_KERNEL_REGISTRATION(RegisterBatchNormGradKernels);
-TFRT_STATIC_KERNEL_REGISTRATION(RegisterConv2DGradFilterKernels);
-TFRT_STATIC_KERNEL_REGISTRATION(RegisterConv2DGradInputKernels);
-TFRT_STATIC_KERNEL_REGISTRATION(RegisterMatMulKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("eigen.", RegisterEigenKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("eigen.", RegisterBatchNormGradKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("eigen.",
+                                       RegisterConv2DGradFilterKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("eigen.",
+                                       RegisterConv2DGradInputKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("eigen.", RegisterMatMulKernels);
 
 }  // namespace tfrt
@@ -0,0 +1,322 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Winograd F(2x2, 3x3) convolution.
+//
+// Each 2x2 output tile is computed from a 4x4 input tile as
+//
+//   Y = A^T [(G g G^T) * (B^T d B)] A
+//
+// where `*` is the element-wise product summed over the input channels. For
+// every (input channel, output channel) pair this takes 16 multiplications
+// instead of the 36 of the direct convolution. The summation over the input
+// channels is done as 16 independent matrix multiplications:
+//
+//   M[xi] [tiles, out_channels] = V[xi] [tiles, in_channels] @
+//                                 U[xi] [in_channels, out_channels]
+//
+// where U = G g G^T is the transformed filter, and V = B^T d B the transformed
+// input tiles. The tiles are processed in chunks that fit into the cache, and
+// the contraction output kernel is applied to each output tile right after the
+// output transformation.
+
+#ifndef TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_WINOGRAD_CONV2D_H_
+#define TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_WINOGRAD_CONV2D_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "conv2d_shape_functions.h"
+#include "tfrt/common/compat/eigen/contraction_output_kernel.h"
+#include "tfrt/common/compat/eigen/tensor_types.h"
+#include "tfrt/common/compat/eigen/thread_pool_device.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace compat {
+namespace internal {
+
+// The size of the output and input tiles of F(2x2, 3x3).
+constexpr ssize_t kWinogradOutputTile = 2;
+constexpr ssize_t kWinogradInputTile = 4;
+constexpr ssize_t kWinogradTileElements = 16;
+
+// Returns true if the convolution can be computed with WinogradConv2D().
+inline bool IsWinogradConv2DSupported(const Conv2DParams& params) {
+  return params.kernel_shape[0] == 3 && params.kernel_shape[1] == 3 &&
+         params.strides[0] == 1 && params.strides[1] == 1 &&
+         params.dilations[0] == 1 && params.dilations[1] == 1;
+}
+
+// Returns true if WinogradConv2D() is expected to be faster than the tensor
+// contraction. The input and output transformations are only amortized if
+// there are enough channels, and the transformations lose too much precision
+// for types narrower than float.
+template <typename T>
+bool PreferWinogradConv2D(const Conv2DParams& params) {
+  constexpr ssize_t kMinChannels = 32;
+  return std::is_same<T, float>::value && IsWinogradConv2DSupported(params) &&
+         params.kernel_shape[2] >= kMinChannels &&
+         params.kernel_shape[3] >= kMinChannels;
+}
+
+// Computes U = G g G^T for the 3x3 filter `g`, whose element (i, j) is at
+// g[(i * 3 + j) * stride].
+template <typename T>
+inline void WinogradFilterTransform(const T* g, ssize_t stride,
+                                    T u[kWinogradTileElements]) {
+  const T half = static_cast<T>(0.5);
+  T t[4][3];  // G g
+  for (int j = 0; j < 3; ++j) {
+    const T g0 = g[j * stride], g1 = g[(3 + j) * stride],
+            g2 = g[(6 + j) * stride];
+    t[0][j] = g0;
+    t[1][j] = half * (g0 + g1 + g2);
+    t[2][j] = half * (g0 - g1 + g2);
+    t[3][j] = g2;
+  }
+  for (int i = 0; i < 4; ++i) {
+    u[i * 4 + 0] = t[i][0];
+    u[i * 4 + 1] = half * (t[i][0] + t[i][1] + t[i][2]);
+    u[i * 4 + 2] = half * (t[i][0] - t[i][1] + t[i][2]);
+    u[i * 4 + 3] = t[i][2];
+  }
+}
+
+// Computes V = B^T d B for the 4x4 input tile `d`.
+template <typename T>
+inline void WinogradInputTransform(const T d[kWinogradTileElements],
+                                   T v[kWinogradTileElements]) {
+  T t[4][4];  // B^T d
+  for (int j = 0; j < 4; ++j) {
+    t[0][j] = d[0 * 4 + j] - d[2 * 4 + j];
+    t[1][j] = d[1 * 4 + j] + d[2 * 4 + j];
+    t[2][j] = d[2 * 4 + j] - d[1 * 4 + j];
+    t[3][j] = d[1 * 4 + j] - d[3 * 4 + j];
+  }
+  for (int i = 0; i < 4; ++i) {
+    v[i * 4 + 0] = t[i][0] - t[i][2];
+    v[i * 4 + 1] = t[i][1] + t[i][2];
+    v[i * 4 + 2] = t[i][2] - t[i][1];
+    v[i * 4 + 3] = t[i][1] - t[i][3];
+  }
+}
+
+// Computes Y = A^T m A for the 4x4 tile `m`.
+template <typename T>
+inline void WinogradOutputTransform(const T m[kWinogradTileElements],
+                                    T y[kWinogradOutputTile *
+                                        kWinogradOutputTile]) {
+  T t[2][4];  // A^T m
+  for (int j = 0; j < 4; ++j) {
+    t[0][j] = m[0 * 4 + j] + m[1 * 4 + j] + m[2 * 4 + j];
+    t[1][j] = m[1 * 4 + j] - m[2 * 4 + j] - m[3 * 4 + j];
+  }
+  for (int i = 0; i < 2; ++i) {
+    y[i * 2 + 0] = t[i][0] + t[i][1] + t[i][2];
+    y[i * 2 + 1] = t[i][1] - t[i][2] - t[i][3];
+  }
+}
+
+// Computes the convolution of the NHWC `input` with the 3x3 HWIO `filter`
+// (see IsWinogradConv2DSupported), and applies `output_kernel` to the output.
+template <typename T, typename OutputKernel>
+AsyncValueRef<Chain> WinogradConv2D(const DenseHostTensor& input,
+                                    const DenseHostTensor& filter,
+                                    DenseHostTensor* output,
+                                    const Conv2DParams& params,
+                                    OutputKernel output_kernel,
+                                    const ExecutionContext& exec_ctx) {
+  using Matrix =
+      Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+  using ConstMatrixMap = Eigen::Map<const Matrix>;
+  using MatrixMap = Eigen::Map<Matrix>;
+
+  // The number of tiles transformed and multiplied together.
+  constexpr ssize_t kTilesPerChunk = 32;
+
+  const ssize_t batch = params.input_shape[0];
+  const ssize_t in_height = params.input_shape[1];
+  const ssize_t in_width = params.input_shape[2];
+  const ssize_t in_channels = params.input_shape[3];
+  const ssize_t out_height = params.output_shape[1];
+  const ssize_t out_width = params.output_shape[2];
+  const ssize_t out_channels = params.output_shape[3];
+  const ssize_t pad_top = params.paddings[0];
+  const ssize_t pad_left = params.paddings[2];
+
+  const ssize_t tiles_y =
+      (out_height + kWinogradOutputTile - 1) / kWinogradOutputTile;
+  const ssize_t tiles_x =
+      (out_width + kWinogradOutputTile - 1) / kWinogradOutputTile;
+  const ssize_t num_tiles = batch * tiles_y * tiles_x;
+  const ssize_t num_chunks = (num_tiles + kTilesPerChunk - 1) / kTilesPerChunk;
+
+  // Transform the filter to U [16, in_channels, out_channels]. This is cheap
+  // compared to the convolution, so it is done before scheduling the tiles.
+  const ssize_t u_stride = in_channels * out_channels;
+  auto transformed_filter =
+      std::make_shared<std::vector<T>>(kWinogradTileElements * u_stride);
+  {
+    const T* g = static_cast<const T*>(filter.data());
+    T* u = transformed_filter->data();
+    T tile[kWinogradTileElements];
+    for (ssize_t i = 0; i < u_stride; ++i) {
+      WinogradFilterTransform(g + i, u_stride, tile);
+      for (ssize_t xi = 0; xi < kWinogradTileElements; ++xi)
+        u[xi * u_stride + i] = tile[xi];
+    }
+  }
+
+  const T* input_data = static_cast<const T*>(input.data());
+  T* output_data = static_cast<T*>(output->data());
+
+  auto compute = [=](size_t start, size_t end) {
+    const T* u = transformed_filter->data();
+
+    // Transformed input tiles V [16, tiles, in_channels] and their products
+    // with the transformed filter M [16, tiles, out_channels].
+    std::vector<T> v(kWinogradTileElements * kTilesPerChunk * in_channels);
+    std::vector<T> m(kWinogradTileElements * kTilesPerChunk * out_channels);
+    // Padded input pixels are read from `zeros`, clipped output pixels are
+    // written to `scratch`.
+    std::vector<T> zeros(in_channels, static_cast<T>(0));
+    std::vector<T> scratch(out_channels);
+
+    Eigen::TensorContractionParams contraction_params;
+    contraction_params.swapped_arguments = true;
+
+    for (size_t chunk = start; chunk < end; ++chunk) {
+      const ssize_t first_tile = chunk * kTilesPerChunk;
+      const ssize_t chunk_tiles =
+          std::min(kTilesPerChunk, num_tiles - first_tile);
+      const ssize_t v_stride = chunk_tiles * in_channels;
+      const ssize_t m_stride = chunk_tiles * out_channels;
+
+      // Input transformation.
+      for (ssize_t t = 0; t < chunk_tiles; ++t) {
+        const ssize_t tile = first_tile + t;
+        const ssize_t b = tile / (tiles_y * tiles_x);
+        const ssize_t y0 = (tile / tiles_x) % tiles_y * kWinogradOutputTile;
+        const ssize_t x0 = tile % tiles_x * kWinogradOutputTile;
+
+        const T* pixels[kWinogradTileElements];
+        for (ssize_t i = 0; i < kWinogradInputTile; ++i) {
+          for (ssize_t j = 0; j < kWinogradInputTile; ++j) {
+            const ssize_t y = y0 + i - pad_top, x = x0 + j - pad_left;
+            const bool pad = y < 0 || y >= in_height || x < 0 || x >= in_width;
+            pixels[i * 4 + j] =
+                pad ? zeros.data()
+                    : input_data +
+                          ((b * in_height + y) * in_width + x) * in_channels;
+          }
+        }
+
+        T* v_tile = v.data() + t * in_channels;
+        for (ssize_t c = 0; c < in_channels; ++c) {
+          T d[kWinogradTileElements], transformed[kWinogradTileElements];
+          for (int xi = 0; xi < kWinogradTileElements; ++xi)
+            d[xi] = pixels[xi][c];
+          WinogradInputTransform(d, transformed);
+          for (int xi = 0; xi < kWinogradTileElements; ++xi)
+            v_tile[xi * v_stride + c] = transformed[xi];
+        }
+      }
+
+      // Multiplication with the transformed filter.
+      for (ssize_t xi = 0; xi < kWinogradTileElements; ++xi) {
+        ConstMatrixMap lhs(v.data() + xi * v_stride, chunk_tiles, in_channels);
+        ConstMatrixMap rhs(u + xi * u_stride, in_channels, out_channels);
+        MatrixMap(m.data() + xi * m_stride, chunk_tiles, out_channels)
+            .noalias() = lhs * rhs;
+      }
+
+      // Output transformation.
+      for (ssize_t t = 0; t < chunk_tiles; ++t) {
+        const ssize_t tile = first_tile + t;
+        const ssize_t b = tile / (tiles_y * tiles_x);
+        const ssize_t y0 = (tile / tiles_x) % tiles_y * kWinogradOutputTile;
+        const ssize_t x0 = tile % tiles_x * kWinogradOutputTile;
+        const ssize_t rows = std::min(kWinogradOutputTile, out_height - y0);
+        const ssize_t cols = std::min(kWinogradOutputTile, out_width - x0);
+
+        T* pixels[kWinogradOutputTile * kWinogradOutputTile];
+        for (ssize_t i = 0; i < kWinogradOutputTile; ++i) {
+          for (ssize_t j = 0; j < kWinogradOutputTile; ++j) {
+            pixels[i * 2 + j] =
+                i < rows && j < cols
+                    ? output_data + ((b * out_height + y0 + i) * out_width +
+                                     x0 + j) *
+                                        out_channels
+                    : scratch.data();
+          }
+        }
+
+        const T* m_tile = m.data() + t * out_channels;
+        for (ssize_t k = 0; k < out_channels; ++k) {
+          T tile_m[kWinogradTileElements];
+          T y[kWinogradOutputTile * kWinogradOutputTile];
+          for (int xi = 0; xi < kWinogradTileElements; ++xi)
+            tile_m[xi] = m_tile[xi * m_stride + k];
+          WinogradOutputTransform(tile_m, y);
+          for (int i = 0; i < kWinogradOutputTile * kWinogradOutputTile; ++i)
+            pixels[i][k] = y[i];
+        }
+
+        // Each output row of the tile is a block of `cols` contiguous pixels.
+        for (ssize_t i = 0; i < rows; ++i) {
+          ContractionOutputMapper<T> output_mapper(pixels[i * 2], out_channels);
+          const ssize_t pixel = (b * out_height + y0 + i) * out_width + x0;
+          output_kernel(output_mapper, contraction_params, /*i=*/0,
+                        /*j=*/pixel, /*num_rows=*/out_channels,
+                        /*num_cols=*/cols);
+        }
+      }
+    }
+  };
+
+  // Each chunk loads and stores its input and output tiles, and does one
+  // multiplication per (input channel, output channel) pair for each of the 16
+  // tile elements.
+  ParallelFor::Cost cost;
+  cost.bytes_loaded =
+      kTilesPerChunk * kWinogradTileElements * in_channels * sizeof(T);
+  cost.bytes_stored = kTilesPerChunk * kWinogradOutputTile *
+                      kWinogradOutputTile * out_channels * sizeof(T);
+  cost.compute_cycles =
+      kTilesPerChunk * kWinogradTileElements * in_channels * out_channels;
+
+  auto chain = MakeUnconstructedAsyncValueRef<Chain>(exec_ctx.host());
+  auto args = KeepBuffers::alive(&input, &filter, output);
+
+  ParallelFor(exec_ctx).Execute(
+      num_chunks, ParallelFor::BlockSizes::FromCost(cost), std::move(compute),
+      [chain = chain.CopyRef(), args = std::move(args)]() { chain.emplace(); });
+  return chain;
+}
+
+}  // namespace internal
+}  // namespace compat
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_WINOGRAD_CONV2D_H_
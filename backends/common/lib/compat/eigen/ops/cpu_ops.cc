@@ -150,6 +150,60 @@ static AsyncValueRef<DenseHostTensor> TfConv2DOp(
   return ForwardValue(output.getValue(), std::move(chain), host);
 }
 
+static AsyncValueRef<DenseHostTensor> TfFusedConv2DOp(
+    const DenseHostTensor& input, const DenseHostTensor& filter,
+    RepeatedArguments<DenseHostTensor> fusion_inputs, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+
+  auto output = DenseHostTensor::CreateUninitialized(output_md, host);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating tensor");
+  }
+
+  auto padding = attrs.GetStringAsserting("padding");
+  auto strides = attrs.GetArrayOptional<ssize_t>("strides");
+  auto data_format = attrs.GetStringOptional("data_format");
+  auto fused_ops_attr = attrs.GetAsserting<AggregateAttr>("fused_ops");
+  // The default epsilon of TensorFlow's FusedBatchNorm.
+  float epsilon = attrs.GetOptional<float>("epsilon").getValueOr(0.0001f);
+
+  if (data_format.hasValue() && data_format.getValue().str() != "NHWC") {
+    return EmitErrorAsync(exec_ctx, "only channel last order is supported");
+  }
+
+  if (strides.size() != 4) {
+    return EmitErrorAsync(exec_ctx, "strides should have 4 elements");
+  }
+  std::array<ssize_t, 2> strides_t{strides[1], strides[2]};
+
+  SmallVector<string_view, 2> fused_ops;
+  for (int i = 0; i < fused_ops_attr.GetNumElements(); ++i)
+    fused_ops.push_back(
+        fused_ops_attr.GetAttribute(i).cast<StringAttr>().GetValue());
+
+  SmallVector<const DenseHostTensor*, 4> fusion_args;
+  for (int i = 0; i < fusion_inputs.size(); ++i)
+    fusion_args.push_back(&fusion_inputs[i]);
+
+  AsyncValueRef<Chain> chain;
+  switch (input.dtype().kind()) {
+    default:
+      chain =
+          EmitErrorAsync(exec_ctx, "unsupported dtype for TfFusedConv2DOp");
+      break;
+#define DTYPE_FLOAT(ENUM)                                              \
+  case DType::ENUM:                                                    \
+    chain = internal::FusedConv2D<EigenTypeForDTypeKind<DType::ENUM>>( \
+        input, filter, fusion_args, output.getPointer(), padding,      \
+        strides_t, fused_ops, epsilon, exec_ctx);                      \
+    break;
+#include "tfrt/dtype/dtype.def"  // NOLINT
+  }
+
+  return ForwardValue(output.getValue(), std::move(chain), host);
+}
+
 static std::array<AsyncValueRef<DenseHostTensor>, 6> TfFusedBatchNormV3Op(
     const DenseHostTensor& input, const DenseHostTensor& scale,
     const DenseHostTensor& bias, const DenseHostTensor& mean,
@@ -224,6 +278,10 @@ void RegisterEigenTFOps(CpuOpRegistry* op_registry) {
   op_registry->AddOp(
       "tf.Conv2D", TFRT_CPU_OP(compat::TfConv2DOp), CpuOpFlags::NoSideEffects,
       {"padding", "explicit_paddings", "data_format", "strides", "dilations"});
+  op_registry->AddOp("tf._FusedConv2D", TFRT_CPU_OP(compat::TfFusedConv2DOp),
+                     CpuOpFlags::NoSideEffects,
+                     {"padding", "explicit_paddings", "data_format", "strides",
+                      "dilations", "fused_ops", "epsilon"});
   op_registry->AddOp("tf.FusedBatchNormV3",
                      TFRT_CPU_OP(compat::TfFusedBatchNormV3Op),
                      CpuOpFlags::NoSideEffects, {"data_format", "epsilon"});
@@ -40,6 +40,12 @@ static DType OpAttrTypeToDType(OpAttrType type) {
   case OpAttrType::ENUM:    \
     return DType(DType::ENUM);
 #include "tfrt/dtype/dtype.def"  // NOLINT
+    case OpAttrType::UNSUPPORTED_QUI8:
+      return DType(DType::QUI8);
+    case OpAttrType::UNSUPPORTED_QI8:
+      return DType(DType::QI8);
+    case OpAttrType::UNSUPPORTED_QI32:
+      return DType(DType::QI32);
   }
 }
 
@@ -173,6 +179,13 @@ static Expected<TensorMetadata> TfConvOpMd(const TensorMetadata& input,
   return TensorMetadata(input.dtype, output_dims_nchw);
 }
 
+// The fused ops of tf._FusedConv2D do not change the convolution output.
+static Expected<TensorMetadata> TfFusedConvOpMd(
+    const TensorMetadata& input, const TensorMetadata& filter,
+    VariadicOpArg<TensorMetadata> _, const OpAttrsRef& attrs) {
+  return TfConvOpMd(input, filter, attrs);
+}
+
 static Expected<TensorMetadata> TfShapeOpMd(const TensorMetadata& input,
                                             const OpAttrsRef& attrs) {
   auto out_type = attrs.GetAsserting<OpAttrType>("out_type");
@@ -482,6 +495,195 @@ static Expected<TensorMetadata> TfMeanOpFoldedMd(const TensorMetadata& input,
   }
 }
 
+llvm::Error GetFoldedIndices(const OpAttrsRef& attrs, llvm::StringRef op_name,
+                             llvm::StringRef attr_name,
+                             llvm::SmallVectorImpl<ssize_t>* indices) {
+  DenseAttr dense_attr;
+  if (!attrs.Get(attr_name, &dense_attr)) {
+    return MakeStringError(op_name, " needs a `", attr_name,
+                           "` dense attribute");
+  }
+
+  DenseView view = CreateDenseView(dense_attr);
+  switch (view.dtype().kind()) {
+    case DType::I32: {
+      auto values = view.GetFlat<int32_t>();
+      indices->assign(values.begin(), values.end());
+      return llvm::Error::success();
+    }
+    case DType::I64: {
+      auto values = view.GetFlat<int64_t>();
+      indices->assign(values.begin(), values.end());
+      return llvm::Error::success();
+    }
+    default:
+      return MakeStringError(op_name, " `", attr_name,
+                             "` must be int32 or int64, got ", view.dtype());
+  }
+}
+
+static Expected<TensorMetadata> TfReshapeOpFoldedMd(const TensorMetadata& input,
+                                                    const OpAttrsRef& attrs) {
+  SmallVector<ssize_t, 4> dims;
+  if (auto error = GetFoldedIndices(attrs, "tf.Reshape", "shape", &dims))
+    return std::move(error);
+
+  // At most one dimension is -1, and is inferred from the number of elements.
+  ssize_t num_elements = 1;
+  int inferred_dim = -1;
+  for (int i = 0; i < dims.size(); ++i) {
+    if (dims[i] == -1 && inferred_dim == -1) {
+      inferred_dim = i;
+    } else if (dims[i] < 0) {
+      return MakeStringError("tf.Reshape invalid `shape` dimension ", dims[i]);
+    } else {
+      num_elements *= dims[i];
+    }
+  }
+  const ssize_t input_num_elements = input.shape.GetNumElements();
+  if (inferred_dim != -1 && num_elements != 0 &&
+      input_num_elements % num_elements == 0) {
+    dims[inferred_dim] = input_num_elements / num_elements;
+    num_elements = input_num_elements;
+  }
+  if (num_elements != input_num_elements) {
+    return MakeStringError("tf.Reshape cannot reshape ", input.shape,
+                           " into a tensor of ", num_elements, " elements");
+  }
+
+  return TensorMetadata(input.dtype, dims);
+}
+
+static Expected<TensorMetadata> TfSliceOpFoldedMd(const TensorMetadata& input,
+                                                  const OpAttrsRef& attrs) {
+  SmallVector<ssize_t, 4> begin, size;
+  if (auto error = GetFoldedIndices(attrs, "tf.Slice", "begin", &begin))
+    return std::move(error);
+  if (auto error = GetFoldedIndices(attrs, "tf.Slice", "size", &size))
+    return std::move(error);
+  const int rank = input.shape.GetRank();
+  if (begin.size() != rank || size.size() != rank) {
+    return MakeStringError(
+        "tf.Slice `begin` and `size` must have the input rank ", rank);
+  }
+
+  for (int i = 0; i < rank; ++i) {
+    const ssize_t dim = input.shape.GetDimensionSize(i);
+    // A size of -1 selects the remaining elements of the dimension.
+    if (size[i] == -1) size[i] = dim - begin[i];
+    if (begin[i] < 0 || size[i] < 0 || begin[i] + size[i] > dim) {
+      return MakeStringError("tf.Slice [", begin[i], ", ", begin[i] + size[i],
+                             ") is out of range of dimension ", i, " of ",
+                             input.shape);
+    }
+  }
+
+  return TensorMetadata(input.dtype, size);
+}
+
+// tf.Split has a variable number of results, so the metadata function is not
+// defined with TFRT_METADATA.
+static RCReference<AsyncValue> TfSplitOpFoldedMd(
+    const ExecutionContext& exec_ctx, ArrayRef<TensorMetadata> inputs,
+    const OpAttrsRef& attrs, MutableArrayRef<TensorMetadata> results) {
+  auto emit_error = [&](Error error) {
+    return EmitErrorAsync(exec_ctx, std::move(error),
+                          ErrorCode::kInvalidArgument);
+  };
+  if (inputs.size() != 1) {
+    return emit_error(MakeStringError("tf.Split expects one input"));
+  }
+  const TensorMetadata& input = inputs[0];
+  SmallVector<ssize_t, 1> split_dim;
+  if (auto error = GetFoldedIndices(attrs, "tf.Split", "split_dim", &split_dim))
+    return emit_error(std::move(error));
+
+  const int rank = input.shape.GetRank();
+  if (split_dim.size() != 1 || split_dim[0] < -rank || split_dim[0] >= rank) {
+    return emit_error(
+        MakeStringError("tf.Split `split_dim` must be a scalar in [-", rank,
+                        ", ", rank, ")"));
+  }
+  const int dim = (split_dim[0] + rank) % rank;
+  const ssize_t num_split = results.size();
+  SmallVector<ssize_t, 4> dims;
+  input.shape.GetDimensions(&dims);
+  if (num_split == 0 || dims[dim] % num_split != 0) {
+    return emit_error(MakeStringError("tf.Split dimension ", dim, " of ",
+                                      input.shape, " is not divisible into ",
+                                      num_split, " results"));
+  }
+
+  dims[dim] /= num_split;
+  for (auto& result : results) result = TensorMetadata(input.dtype, dims);
+  return {};
+}
+
+static Expected<TensorMetadata> TfQuantizeOpMd(
+    const TensorMetadata& input, const TensorMetadata& scale,
+    const TensorMetadata& zero_point, const OpAttrsRef& attrs) {
+  if (input.dtype.kind() != DType::F32)
+    return MakeStringError("tf._Quantize input must be f32, got ",
+                           input.dtype);
+
+  auto dtype = OpAttrTypeToDType(attrs.GetAsserting<OpAttrType>("T"));
+  if (dtype.kind() != DType::QUI8 && dtype.kind() != DType::QI8)
+    return MakeStringError("tf._Quantize supports quint8 and qint8, got ",
+                           dtype);
+  return TensorMetadata(dtype, input.shape);
+}
+
+static Expected<TensorMetadata> TfDequantizeOpMd(
+    const TensorMetadata& input, const TensorMetadata& scale,
+    const TensorMetadata& zero_point, const OpAttrsRef& attrs) {
+  return TensorMetadata(DType(DType::F32), input.shape);
+}
+
+static Expected<TensorMetadata> TfQuantizedMatMulOpMd(
+    const TensorMetadata& a, const TensorMetadata& b,
+    const TensorMetadata& a_zero_point) {
+  if (a.dtype.kind() != DType::QUI8 || b.dtype.kind() != DType::QI8)
+    return MakeStringError(
+        "tf._QuantizedMatMul expects quint8 and qint8 arguments, got ",
+        a.dtype, " and ", b.dtype);
+
+  if (a.shape.GetRank() != 2 || b.shape.GetRank() != 2 ||
+      a.shape.GetDimensionSize(1) != b.shape.GetDimensionSize(0))
+    return MakeStringError(
+        "tf._QuantizedMatMul arguments have incompatible shapes: ", a.shape,
+        " and ", b.shape);
+
+  return TensorMetadata(DType(DType::QI32), {a.shape.GetDimensionSize(0),
+                                             b.shape.GetDimensionSize(1)});
+}
+
+static Expected<TensorMetadata> TfQuantizedConv2DOpMd(
+    const TensorMetadata& input, const TensorMetadata& filter,
+    const TensorMetadata& input_zero_point, const OpAttrsRef& attrs) {
+  if (input.dtype.kind() != DType::QUI8 || filter.dtype.kind() != DType::QI8)
+    return MakeStringError(
+        "tf._QuantizedConv2D expects quint8 and qint8 arguments, got ",
+        input.dtype, " and ", filter.dtype);
+
+  TFRT_ASSIGN_OR_RETURN(auto output_md, TfConvOpMd(input, filter, attrs));
+  output_md.dtype = DType(DType::QI32);
+  return output_md;
+}
+
+static Expected<TensorMetadata> TfQuantizedBiasAddOpMd(
+    const TensorMetadata& value, const TensorMetadata& bias,
+    const OpAttrsRef& attrs) {
+  if (value.dtype.kind() != DType::QI32)
+    return MakeStringError("tf._QuantizedBiasAdd expects qint32, got ",
+                           value.dtype);
+  return TfBiasAddOpMd(value, bias, attrs);
+}
+
+static Expected<TensorMetadata> TfQuantizedReluOpMd(
+    const TensorMetadata& input, const TensorMetadata& zero_point) {
+  return input;
+}
+
 llvm::ArrayRef<std::pair<llvm::StringRef, OpMetadataFn>>
 GetAllTFMetadataFunctions() {
   static auto* md_functions = [] {
@@ -497,6 +699,7 @@ GetAllTFMetadataFunctions() {
     result->emplace_back("tf.Log1p", TFRT_METADATA(UnaryIdentityMd));
     result->emplace_back("tf.Relu", TFRT_METADATA(UnaryIdentityMd));
     result->emplace_back("tf.Conv2D", TFRT_METADATA(TfConvOpMd));
+    result->emplace_back("tf._FusedConv2D", TFRT_METADATA(TfFusedConvOpMd));
     result->emplace_back("tf.MaxPool", TFRT_METADATA(TfMaxPoolOpMd));
     result->emplace_back("_tf.Mean", TFRT_METADATA(TfMeanOpFoldedMd));
     result->emplace_back("tf.Mul", TFRT_METADATA(TfBinaryOpMd));
@@ -516,7 +719,20 @@ GetAllTFMetadataFunctions() {
     result->emplace_back("tf.Transpose", TFRT_METADATA(TfTransposeOpMd));
     result->emplace_back("_tf.Transpose", TFRT_METADATA(TfTransposeOpFoldedMd));
     result->emplace_back("tf.Cast", TFRT_METADATA(TfCastOpMd));
+    result->emplace_back("_tf.Reshape", TFRT_METADATA(TfReshapeOpFoldedMd));
+    result->emplace_back("_tf.Slice", TFRT_METADATA(TfSliceOpFoldedMd));
+    result->emplace_back("_tf.Split", TfSplitOpFoldedMd);
     result->emplace_back("tf.ZerosLike", TFRT_METADATA(TfZerosLikeOpMd));
+    result->emplace_back("tf._Quantize", TFRT_METADATA(TfQuantizeOpMd));
+    result->emplace_back("tf._Dequantize", TFRT_METADATA(TfDequantizeOpMd));
+    result->emplace_back("tf._QuantizedMatMul",
+                         TFRT_METADATA(TfQuantizedMatMulOpMd));
+    result->emplace_back("tf._QuantizedConv2D",
+                         TFRT_METADATA(TfQuantizedConv2DOpMd));
+    result->emplace_back("tf._QuantizedBiasAdd",
+                         TFRT_METADATA(TfQuantizedBiasAddOpMd));
+    result->emplace_back("tf._QuantizedRelu",
+                         TFRT_METADATA(TfQuantizedReluOpMd));
     return result;
   }();
 
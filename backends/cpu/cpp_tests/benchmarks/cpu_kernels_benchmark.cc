@@ -0,0 +1,538 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of the CPU kernels of the TF ops over sweeps of shapes and dtypes.
+//
+// Besides the time, every kernel benchmark reports
+//
+//   FLOP/s:    floating point (or integer) operations per second,
+//   bytes/s:   bytes of the inputs and outputs per second,
+//   FLOP/B:    the arithmetic intensity of the kernel, and
+//   roofline%: the time of the kernel at the roofline, i.e. the larger of its
+//              operations at the peak compute throughput and its bytes at the
+//              peak memory bandwidth, in percent of the measured time.
+//
+// The peaks are measured once per dtype on the same number of threads as the
+// kernels, with the widest Eigen packets of the build and memcpy, and are
+// reported by the BM_Peak* benchmarks. Set TFRT_PEAK_GFLOPS and TFRT_PEAK_GBPS
+// to use e.g. the peaks of the hardware specification instead.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../../../common/lib/compat/eigen/kernels/conv2d.h"
+#include "../../lib/kernels/concat_kernel.h"
+#include "../../lib/kernels/cpu_kernels.h"
+#include "../../lib/kernels/cwise_binary_kernels.h"
+#include "../../lib/kernels/cwise_unary_kernels.h"
+#include "../../lib/kernels/matmul_kernel.h"
+#include "../../lib/kernels/softmax_kernel.h"
+#include "../../lib/kernels/tile_kernel.h"
+#include "benchmark/benchmark.h"
+#include "tfrt/common/compat/eigen/contraction_output_kernel.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/latch.h"
+#include "tfrt/support/string_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+// Number of threads of the host context of the kernels.
+constexpr int kNumThreads = 8;
+
+std::unique_ptr<HostContext> CreateTestHostContext() {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(kNumThreads, kNumThreads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+template <typename T>
+DenseHostTensor CreateRandomTensor(llvm::ArrayRef<ssize_t> dims,
+                                   HostContext* host) {
+  auto dht = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), TensorShape(dims)), host);
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  auto* data = static_cast<T*>(dht->data());
+  for (ssize_t i = 0; i < dht->NumElements(); ++i)
+    data[i] = static_cast<T>(dist(gen));
+  return std::move(dht.getValue());
+}
+
+template <typename T>
+DenseHostTensor CreateTensor(llvm::ArrayRef<ssize_t> dims, HostContext* host) {
+  return std::move(DenseHostTensor::CreateUninitialized(
+                       TensorMetadata(GetDType<T>(), TensorShape(dims)), host)
+                       .getValue());
+}
+
+//===----------------------------------------------------------------------===//
+// Roofline
+//===----------------------------------------------------------------------===//
+
+struct Roofline {
+  double ops_per_second;
+  double bytes_per_second;
+};
+
+int NumRooflineThreads() {
+  return std::min<int>(kNumThreads, std::thread::hardware_concurrency());
+}
+
+// Runs `fn(thread_index)` on each roofline thread and returns the seconds
+// until all of them have returned.
+template <typename Fn>
+double TimeOnRooflineThreads(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NumRooflineThreads(); ++i)
+    threads.emplace_back([&fn, i] { fn(i); });
+  for (auto& thread : threads) thread.join();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Measures the peak operations per second with independent multiply-adds of
+// the widest packets of T.
+template <typename T>
+double MeasurePeakOpsPerSecond() {
+  using Packet = typename Eigen::internal::packet_traits<T>::type;
+  const int packet_size = Eigen::internal::unpacket_traits<Packet>::size;
+  const int num_accumulators = 8;
+  const int64_t num_iterations = 1 << 24;
+
+  double seconds = TimeOnRooflineThreads([&](int) {
+    // Hide the values from the compiler, so that it can't fold the loop.
+    Packet a = Eigen::internal::pset1<Packet>(static_cast<T>(1));
+    Packet b = Eigen::internal::pset1<Packet>(static_cast<T>(0));
+    benchmark::DoNotOptimize(a);
+    benchmark::DoNotOptimize(b);
+    Packet acc[num_accumulators];
+    for (auto& packet : acc) packet = a;
+    for (int64_t i = 0; i < num_iterations; ++i) {
+      for (auto& packet : acc) packet = Eigen::internal::pmadd(packet, a, b);
+    }
+    for (auto& packet : acc) benchmark::DoNotOptimize(packet);
+  });
+  return 2.0 * packet_size * num_accumulators * num_iterations *
+         NumRooflineThreads() / seconds;
+}
+
+// Measures the peak memory bandwidth as the best of a few parallel copies of
+// buffers much larger than the caches, counting the bytes read and written.
+double MeasurePeakBytesPerSecond() {
+  const size_t size_per_thread = (256 << 20) / NumRooflineThreads();
+  std::vector<std::vector<char>> src(NumRooflineThreads()),
+      dst(NumRooflineThreads());
+  for (int i = 0; i < NumRooflineThreads(); ++i) {
+    src[i].assign(size_per_thread, 1);
+    dst[i].assign(size_per_thread, 0);
+  }
+
+  double best_seconds = std::numeric_limits<double>::infinity();
+  for (int repeat = 0; repeat < 5; ++repeat) {
+    best_seconds = std::min(best_seconds, TimeOnRooflineThreads([&](int i) {
+      std::memcpy(dst[i].data(), src[i].data(), size_per_thread);
+      benchmark::ClobberMemory();
+    }));
+  }
+  return 2.0 * size_per_thread * NumRooflineThreads() / best_seconds;
+}
+
+template <typename T>
+const Roofline& GetRoofline() {
+  static const Roofline* roofline = [] {
+    const char* peak_gflops = std::getenv("TFRT_PEAK_GFLOPS");
+    const char* peak_gbps = std::getenv("TFRT_PEAK_GBPS");
+    return new Roofline{
+        peak_gflops ? 1e9 * std::atof(peak_gflops)
+                    : MeasurePeakOpsPerSecond<T>(),
+        peak_gbps ? 1e9 * std::atof(peak_gbps) : MeasurePeakBytesPerSecond()};
+  }();
+  return *roofline;
+}
+
+// Reports the throughput of a kernel that executes `ops` operations of T and
+// reads and writes `bytes` bytes per iteration, relative to the roofline.
+template <typename T>
+void ReportRoofline(benchmark::State& state, double ops, double bytes) {
+  const Roofline& roofline = GetRoofline<T>();
+  double roofline_seconds = std::max(ops / roofline.ops_per_second,
+                                     bytes / roofline.bytes_per_second);
+  state.SetBytesProcessed(bytes * state.iterations());
+  state.counters["FLOP/s"] =
+      benchmark::Counter(ops, benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["FLOP/B"] = ops / bytes;
+  state.counters["roofline%"] = benchmark::Counter(
+      100 * roofline_seconds, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+template <typename T>
+void BM_PeakFlops(benchmark::State& state) {
+  for (auto _ : state) {
+    state.counters["FLOP/s"] = GetRoofline<T>().ops_per_second;
+  }
+}
+BENCHMARK_TEMPLATE(BM_PeakFlops, float)->Iterations(1);
+BENCHMARK_TEMPLATE(BM_PeakFlops, double)->Iterations(1);
+BENCHMARK_TEMPLATE(BM_PeakFlops, int32_t)->Iterations(1);
+
+void BM_PeakMemoryBandwidth(benchmark::State& state) {
+  for (auto _ : state) {
+    state.counters["bytes/s"] = GetRoofline<float>().bytes_per_second;
+  }
+}
+BENCHMARK(BM_PeakMemoryBandwidth)->Iterations(1);
+
+//===----------------------------------------------------------------------===//
+// MatMul and FusedMatMul
+//===----------------------------------------------------------------------===//
+
+void MatMulShapes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"m", "k", "n"});
+  benchmark->Args({1, 1024, 1024});
+  benchmark->Args({32, 1024, 1024});
+  benchmark->Args({256, 256, 256});
+  benchmark->Args({1024, 1024, 1024});
+  benchmark->Args({4096, 64, 4096});
+}
+
+// Benchmarks C[m, n] = A[m, k] @ B[k, n] with `output_kernel` applied to C.
+template <typename T, typename OutputKernelFactory>
+void MatMul(benchmark::State& state, OutputKernelFactory make_output_kernel,
+            double ops_per_output) {
+  auto host = CreateTestHostContext();
+  compat::AsyncEigenEvaluator evaluator(host.get());
+
+  const ssize_t m = state.range(0), k = state.range(1), n = state.range(2);
+  auto a = CreateRandomTensor<T>({m, k}, host.get());
+  auto b = CreateRandomTensor<T>({k, n}, host.get());
+  auto bias = CreateRandomTensor<T>({n}, host.get());
+  auto c = CreateTensor<T>({m, n}, host.get());
+
+  for (auto _ : state) {
+    auto chain = cpu::MatMul<T>(
+        1.0, a, b, 0.0, &c, /*transpose_a=*/false, /*transpose_b=*/false,
+        make_output_kernel(bias), evaluator);
+    host->Await(chain.CopyRCRef());
+  }
+
+  ReportRoofline<T>(state, (2.0 * k + ops_per_output) * m * n,
+                    sizeof(T) * (m * k + k * n + m * n));
+}
+
+template <typename T>
+void BM_MatMul(benchmark::State& state) {
+  MatMul<T>(
+      state, [](const DenseHostTensor&) { return Eigen::NoOpOutputKernel(); },
+      /*ops_per_output=*/0);
+}
+BENCHMARK_TEMPLATE(BM_MatMul, float)->Apply(MatMulShapes)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MatMul, double)->Apply(MatMulShapes)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MatMul, int32_t)->Apply(MatMulShapes)->UseRealTime();
+
+// MatMul with the BiasAdd and Relu of FusedMatMul in the output kernel.
+template <typename T>
+void BM_FusedMatMulBiasAddRelu(benchmark::State& state) {
+  MatMul<T>(
+      state,
+      [](const DenseHostTensor& bias) {
+        DHTArrayView<T> bias_view(&bias);
+        return compat::BiasAddOutputKernel<T, compat::Relu>(
+            compat::AsEigenConstTensor(bias_view));
+      },
+      /*ops_per_output=*/2);
+}
+BENCHMARK_TEMPLATE(BM_FusedMatMulBiasAddRelu, float)
+    ->Apply(MatMulShapes)
+    ->UseRealTime();
+
+//===----------------------------------------------------------------------===//
+// Conv2D
+//===----------------------------------------------------------------------===//
+
+llvm::Expected<Eigen::NoOpOutputKernel> MakeNoOpOutputKernel(
+    compat::Conv2DParams) {
+  return Eigen::NoOpOutputKernel();
+}
+
+// Benchmarks a "same" convolution of an [n, h, w, c] input with an
+// [r, r, c, k] filter.
+void BM_Conv2D(benchmark::State& state) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  const ssize_t n = state.range(0), h = state.range(1), w = state.range(2),
+                c = state.range(3), k = state.range(4), r = state.range(5);
+  auto input = CreateRandomTensor<float>({n, h, w, c}, host.get());
+  auto filter = CreateRandomTensor<float>({r, r, c, k}, host.get());
+  auto output = CreateTensor<float>({n, h, w, k}, host.get());
+  const ssize_t strides[] = {1, 1};
+
+  for (auto _ : state) {
+    auto chain = compat::internal::Conv2DImpl<float>(
+        input, filter, &output, "same", strides, MakeNoOpOutputKernel,
+        exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  ReportRoofline<float>(state, 2.0 * n * h * w * k * r * r * c,
+                        sizeof(float) *
+                            (n * h * w * c + r * r * c * k + n * h * w * k));
+}
+BENCHMARK(BM_Conv2D)
+    ->ArgNames({"n", "h", "w", "c", "k", "r"})
+    ->Args({1, 56, 56, 64, 64, 3})
+    ->Args({8, 28, 28, 128, 128, 3})
+    ->Args({8, 14, 14, 256, 256, 3})
+    ->Args({8, 56, 56, 64, 256, 1})
+    ->Args({32, 7, 7, 512, 2048, 1})
+    ->UseRealTime();
+
+//===----------------------------------------------------------------------===//
+// BiasAdd, Softmax, Tile and Concat
+//===----------------------------------------------------------------------===//
+
+void RowsAndColumns(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"rows", "cols"});
+  benchmark->Args({1, 1000});
+  benchmark->Args({32, 1000});
+  benchmark->Args({256, 1000});
+  benchmark->Args({32, 50000});
+  benchmark->Args({1024, 1024});
+}
+
+template <typename T>
+void BM_BiasAdd(benchmark::State& state) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  const ssize_t rows = state.range(0), cols = state.range(1);
+  auto input = CreateRandomTensor<T>({rows, cols}, host.get());
+  auto bias = CreateRandomTensor<T>({cols}, host.get());
+  auto output = CreateTensor<T>({rows, cols}, host.get());
+
+  for (auto _ : state) {
+    auto chain = cpu::BiasAdd<T, 2>(input, bias, &output, exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  ReportRoofline<T>(state, rows * cols,
+                    sizeof(T) * (2 * rows * cols + cols));
+}
+BENCHMARK_TEMPLATE(BM_BiasAdd, float)->Apply(RowsAndColumns)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_BiasAdd, double)->Apply(RowsAndColumns)->UseRealTime();
+
+// Counts the max, subtraction, exponential, sum and division of each logit
+// as one operation each.
+constexpr double kSoftmaxOpsPerElement = 5;
+
+// Float softmax uses the vectorized row kernel of tf.Softmax.
+void BM_Softmax_float(benchmark::State& state) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  const ssize_t rows = state.range(0), cols = state.range(1);
+  auto logits = CreateRandomTensor<float>({rows, cols}, host.get());
+  auto softmax = CreateTensor<float>({rows, cols}, host.get());
+
+  for (auto _ : state) {
+    auto chain = cpu::ParallelSoftmax<false>(logits, &softmax, exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  ReportRoofline<float>(state, kSoftmaxOpsPerElement * rows * cols,
+                        sizeof(float) * 2 * rows * cols);
+}
+BENCHMARK(BM_Softmax_float)->Apply(RowsAndColumns)->UseRealTime();
+
+void BM_Softmax_double(benchmark::State& state) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  const ssize_t rows = state.range(0), cols = state.range(1);
+  auto logits = CreateRandomTensor<double>({rows, cols}, host.get());
+  auto softmax = CreateTensor<double>({rows, cols}, host.get());
+
+  for (auto _ : state) {
+    auto chain =
+        cpu::Softmax<double, false, compat::AsyncEigenEvaluator>(
+            logits, &softmax, exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  ReportRoofline<double>(state, kSoftmaxOpsPerElement * rows * cols,
+                         sizeof(double) * 2 * rows * cols);
+}
+BENCHMARK(BM_Softmax_double)->Apply(RowsAndColumns)->UseRealTime();
+
+// Tiles a [rows, cols] input 4 times along each dimension.
+template <typename T>
+void BM_Tile(benchmark::State& state) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  const ssize_t rows = state.range(0), cols = state.range(1);
+  const ssize_t multiple = 4;
+  auto input = CreateRandomTensor<T>({rows, cols}, host.get());
+  auto output = CreateTensor<T>({rows * multiple, cols * multiple}, host.get());
+  const SmallVector<ssize_t, 5> multiples = {multiple, multiple};
+
+  for (auto _ : state) {
+    auto chain = cpu::Tile<T, compat::AsyncEigenEvaluator>(input, multiples,
+                                                           &output, exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  ReportRoofline<T>(state, /*ops=*/0,
+                    sizeof(T) * (rows * cols + output.NumElements()));
+}
+BENCHMARK_TEMPLATE(BM_Tile, float)
+    ->ArgNames({"rows", "cols"})
+    ->Args({32, 1000})
+    ->Args({256, 256})
+    ->UseRealTime();
+
+// Concatenates 8 [rows, cols] inputs along the last dimension.
+template <typename T>
+void BM_Concat(benchmark::State& state) {
+  auto host = CreateTestHostContext();
+
+  const ssize_t rows = state.range(0), cols = state.range(1);
+  const int num_inputs = 8;
+  std::vector<DenseHostTensor> inputs;
+  for (int i = 0; i < num_inputs; ++i)
+    inputs.push_back(CreateRandomTensor<T>({rows, cols}, host.get()));
+  auto output = CreateTensor<T>({rows, num_inputs * cols}, host.get());
+
+  for (auto _ : state) {
+    auto error = cpu::ConcatKernel<T>(inputs, /*axis=*/1, &output);
+    if (error) state.SkipWithError(StrCat(error).c_str());
+  }
+
+  ReportRoofline<T>(state, /*ops=*/0, sizeof(T) * 2 * output.NumElements());
+}
+BENCHMARK_TEMPLATE(BM_Concat, float)->Apply(RowsAndColumns)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Concat, int32_t)->Apply(RowsAndColumns)->UseRealTime();
+
+//===----------------------------------------------------------------------===//
+// Cwise ops
+//===----------------------------------------------------------------------===//
+
+// Benchmarks a binary op of a [rows, cols] tensor with a tensor of the same
+// shape, or with a [cols] vector that is broadcasted along the rows if
+// `broadcast` is true.
+template <typename T, typename Functor>
+void BinaryOp(benchmark::State& state, bool broadcast) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  const ssize_t rows = state.range(0), cols = state.range(1);
+  auto lhs = CreateRandomTensor<T>({rows, cols}, host.get());
+  auto rhs = broadcast ? CreateRandomTensor<T>({cols}, host.get())
+                       : CreateRandomTensor<T>({rows, cols}, host.get());
+  auto output = CreateTensor<T>({rows, cols}, host.get());
+
+  for (auto _ : state) {
+    latch done(1);
+    cpu::BinaryKernel<typename Functor::template Functor<T>,
+                      compat::AsyncEigenEvaluator>(
+        lhs, rhs, &output, exec_ctx, [&](Error error) {
+          if (error) state.SkipWithError(StrCat(error).c_str());
+          done.count_down();
+        });
+    done.wait();
+  }
+
+  ReportRoofline<T>(state, rows * cols,
+                    sizeof(T) * (2 * rows * cols + rhs.NumElements()));
+}
+
+template <typename T, typename Functor>
+void BM_Binary(benchmark::State& state) {
+  BinaryOp<T, Functor>(state, /*broadcast=*/false);
+}
+
+template <typename T, typename Functor>
+void BM_BinaryBroadcast(benchmark::State& state) {
+  BinaryOp<T, Functor>(state, /*broadcast=*/true);
+}
+
+#define BM_CWISE_BINARY(T, FUNCTOR)                                     \
+  BENCHMARK_TEMPLATE(BM_Binary, T, cpu::functor::FUNCTOR)               \
+      ->Apply(RowsAndColumns)                                           \
+      ->UseRealTime();                                                  \
+  BENCHMARK_TEMPLATE(BM_BinaryBroadcast, T, cpu::functor::FUNCTOR)      \
+      ->Apply(RowsAndColumns)                                           \
+      ->UseRealTime()
+
+BM_CWISE_BINARY(float, Add);
+BM_CWISE_BINARY(float, Mul);
+BM_CWISE_BINARY(float, Div);
+BM_CWISE_BINARY(double, Add);
+BM_CWISE_BINARY(int32_t, Add);
+
+// Counts each unary function of an element as one operation.
+template <typename T, typename Functor>
+void BM_Unary(benchmark::State& state) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  const ssize_t rows = state.range(0), cols = state.range(1);
+  auto input = CreateRandomTensor<T>({rows, cols}, host.get());
+  auto output = CreateTensor<T>({rows, cols}, host.get());
+
+  for (auto _ : state) {
+    auto chain = cpu::UnaryKernel<typename Functor::template Functor<T>>(
+        input, &output, exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  ReportRoofline<T>(state, rows * cols, sizeof(T) * 2 * rows * cols);
+}
+
+#define BM_CWISE_UNARY(T, FUNCTOR)                                      \
+  BENCHMARK_TEMPLATE(BM_Unary, T, cpu::functor::FUNCTOR)                \
+      ->Apply(RowsAndColumns)                                           \
+      ->UseRealTime()
+
+BM_CWISE_UNARY(float, Sigmoid);
+BM_CWISE_UNARY(float, Log);
+BM_CWISE_UNARY(float, Rsqrt);
+BM_CWISE_UNARY(double, Sigmoid);
+
+}  // namespace
+}  // namespace tfrt
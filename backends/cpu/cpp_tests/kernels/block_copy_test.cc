@@ -0,0 +1,177 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests for the block copies of Tile, Concat and Transpose.
+
+#include "../../lib/kernels/block_copy.h"
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tfrt {
+namespace cpu {
+namespace {
+
+// Tiles `input` by computing the source of each output element.
+std::vector<int32_t> ReferenceTile(const std::vector<int32_t>& input,
+                                   ArrayRef<ssize_t> dims,
+                                   ArrayRef<ssize_t> multiples) {
+  const int rank = dims.size();
+  ssize_t num_elements = 1;
+  for (int d = 0; d < rank; ++d) num_elements *= dims[d] * multiples[d];
+
+  std::vector<int32_t> output(num_elements);
+  for (ssize_t o = 0; o < num_elements; ++o) {
+    ssize_t rest = o, in_index = 0, in_stride = 1;
+    for (int d = rank - 1; d >= 0; --d) {
+      ssize_t out_dim = dims[d] * multiples[d];
+      in_index += rest % out_dim % dims[d] * in_stride;
+      rest /= out_dim;
+      in_stride *= dims[d];
+    }
+    output[o] = input[in_index];
+  }
+  return output;
+}
+
+void TestTile(std::vector<ssize_t> dims, std::vector<ssize_t> multiples) {
+  ssize_t num_elements = 1;
+  for (ssize_t dim : dims) num_elements *= dim;
+  std::vector<int32_t> input(num_elements);
+  std::iota(input.begin(), input.end(), 0);
+
+  std::vector<int32_t> expected = ReferenceTile(input, dims, multiples);
+  TileCopy copy(dims, multiples, sizeof(int32_t));
+
+  // Copy the rows in two parts to check that rows are independent.
+  std::vector<int32_t> output(expected.size(), -1);
+  copy.Copy(input.data(), output.data(), 0, copy.NumRows() / 2);
+  copy.Copy(input.data(), output.data(), copy.NumRows() / 2, copy.NumRows());
+  EXPECT_EQ(output, expected);
+}
+
+TEST(BlockCopyTest, Tile) {
+  TestTile({}, {});
+  TestTile({5}, {3});
+  TestTile({2, 3}, {1, 1});
+  TestTile({2, 3}, {2, 1});
+  TestTile({2, 3}, {1, 4});
+  TestTile({3, 1, 4}, {2, 5, 3});
+  TestTile({2, 3, 4, 5}, {1, 2, 1, 3});
+  TestTile({2, 1, 3, 1, 2, 2}, {3, 1, 1, 2, 1, 2});
+}
+
+// Transposes `input` by computing the source of each output element.
+template <typename T>
+std::vector<T> ReferenceTranspose(const std::vector<T>& input,
+                                  ArrayRef<ssize_t> dims,
+                                  ArrayRef<ssize_t> perm) {
+  const int rank = dims.size();
+  std::vector<ssize_t> in_strides(rank, 1);
+  for (int d = rank - 2; d >= 0; --d)
+    in_strides[d] = in_strides[d + 1] * dims[d + 1];
+
+  std::vector<T> output(input.size());
+  for (ssize_t o = 0; o < output.size(); ++o) {
+    ssize_t rest = o, in_index = 0;
+    for (int i = rank - 1; i >= 0; --i) {
+      in_index += rest % dims[perm[i]] * in_strides[perm[i]];
+      rest /= dims[perm[i]];
+    }
+    output[o] = input[in_index];
+  }
+  return output;
+}
+
+template <typename T>
+void TestTranspose(std::vector<ssize_t> dims, std::vector<ssize_t> perm) {
+  ssize_t num_elements = 1;
+  for (ssize_t dim : dims) num_elements *= dim;
+  std::vector<T> input(num_elements);
+  for (ssize_t i = 0; i < num_elements; ++i) input[i] = static_cast<T>(i);
+
+  std::vector<T> expected = ReferenceTranspose(input, dims, perm);
+  TransposeCopy copy(dims, perm, sizeof(T));
+
+  // Copy the rows in two parts to check that rows are independent.
+  std::vector<T> output(expected.size(), T(-1));
+  copy.Copy(input.data(), output.data(), 0, copy.NumRows() / 2);
+  copy.Copy(input.data(), output.data(), copy.NumRows() / 2, copy.NumRows());
+  EXPECT_EQ(output, expected);
+}
+
+template <typename T>
+void TestTransposes() {
+  TestTranspose<T>({}, {});
+  TestTranspose<T>({7}, {0});
+  TestTranspose<T>({3, 5}, {0, 1});
+  TestTranspose<T>({3, 5}, {1, 0});
+  TestTranspose<T>({32, 48}, {1, 0});
+  TestTranspose<T>({37, 21}, {1, 0});
+  TestTranspose<T>({2, 3, 4}, {0, 2, 1});
+  TestTranspose<T>({2, 3, 4}, {2, 0, 1});
+  TestTranspose<T>({2, 3, 4}, {1, 0, 2});
+  TestTranspose<T>({2, 1, 3, 1}, {3, 2, 1, 0});
+  TestTranspose<T>({2, 17, 19, 3}, {0, 3, 1, 2});
+  TestTranspose<T>({2, 3, 17, 19}, {0, 2, 3, 1});
+  TestTranspose<T>({2, 3, 4, 5, 6}, {4, 1, 3, 0, 2});
+  TestTranspose<T>({2, 3, 4, 5, 6}, {1, 2, 0, 4, 3});
+  TestTranspose<T>({0, 3}, {1, 0});
+}
+
+TEST(BlockCopyTest, Transpose) {
+  TestTransposes<int8_t>();
+  TestTransposes<int16_t>();
+  TestTransposes<int32_t>();
+  TestTransposes<int64_t>();
+  TestTransposes<std::complex<double>>();
+}
+
+// An element size without a specialized tile transpose.
+struct Element3 {
+  Element3() = default;
+  explicit Element3(int i) : bytes{char(i), char(i >> 8), char(i >> 16)} {}
+  bool operator==(const Element3& other) const {
+    return std::equal(bytes, bytes + 3, other.bytes);
+  }
+  char bytes[3];
+};
+
+TEST(BlockCopyTest, TransposeOddElementSize) {
+  static_assert(sizeof(Element3) == 3, "");
+  TestTranspose<Element3>({37, 21}, {1, 0});
+  TestTranspose<Element3>({2, 3, 17, 19}, {0, 2, 3, 1});
+}
+
+TEST(BlockCopyTest, ConcatRows) {
+  // Concatenates a [3, 2] and a [3, 1] matrix.
+  std::vector<int32_t> a = {0, 1, 2, 3, 4, 5};
+  std::vector<int32_t> b = {6, 7, 8};
+  const void* inputs[] = {a.data(), b.data()};
+  size_t row_bytes[] = {2 * sizeof(int32_t), sizeof(int32_t)};
+
+  std::vector<int32_t> output(9, -1);
+  ConcatRows(inputs, row_bytes, output.data(), 0, 1);
+  ConcatRows(inputs, row_bytes, output.data(), 1, 3);
+  EXPECT_EQ(output, std::vector<int32_t>({0, 1, 6, 2, 3, 7, 4, 5, 8}));
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,170 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Sparse (CSR) matmul kernel tests and benchmarks.
+
+#include "../../lib/kernels/csr_matmul_kernel.h"
+
+#include <random>
+
+#include "../../lib/kernels/matmul_kernel.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/csr_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+// Returns a [rows, cols] tensor where each element is non-zero with
+// probability `density`.
+DenseHostTensor CreateRandomTensor(ssize_t rows, ssize_t cols, double density,
+                                   HostContext* host) {
+  auto dht = DenseHostTensor::CreateUninitialized<float>(
+      TensorShape({rows, cols}), host);
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> values(-1.0, 1.0);
+  std::bernoulli_distribution nonzero(density);
+  for (auto& value : MutableDHTArrayView<float>(dht.getPointer()))
+    value = nonzero(gen) ? values(gen) : 0.0f;
+  return std::move(dht.getValue());
+}
+
+void ExpectCsrMatMulMatchesDense(ssize_t m, ssize_t k, ssize_t n,
+                                 double density) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto a = CreateRandomTensor(m, k, density, host.get());
+  auto b = CreateRandomTensor(k, n, 1.0, host.get());
+  auto csr = CopyDenseHostTensorToCsrHostTensor(a, host.get());
+  ASSERT_TRUE(!!csr);
+
+  auto c = DenseHostTensor::CreateUninitialized<float>(TensorShape({m, n}),
+                                                       host.get());
+  auto chain = cpu::CsrMatMul<float>(*csr, b, c.getPointer(), exec_ctx);
+  host->Await(chain.CopyRCRef());
+  ASSERT_FALSE(chain.IsError());
+
+  DHTIndexableView<float, 2> a_view(&a);
+  DHTIndexableView<float, 2> b_view(&b);
+  DHTIndexableView<float, 2> c_view(c.getPointer());
+  for (ssize_t i = 0; i < m; ++i) {
+    for (ssize_t j = 0; j < n; ++j) {
+      float expected = 0.0f;
+      for (ssize_t l = 0; l < k; ++l)
+        expected += a_view.ElementAt(i, l) * b_view.ElementAt(l, j);
+      ASSERT_NEAR(c_view.ElementAt(i, j), expected, 1e-4) << i << ", " << j;
+    }
+  }
+}
+
+TEST(CsrMatMulKernelTest, MatrixVector) {
+  ExpectCsrMatMulMatchesDense(/*m=*/300, /*k=*/200, /*n=*/1, /*density=*/0.1);
+}
+
+TEST(CsrMatMulKernelTest, MatrixMatrix) {
+  ExpectCsrMatMulMatchesDense(/*m=*/300, /*k=*/200, /*n=*/16, /*density=*/0.1);
+}
+
+TEST(CsrMatMulKernelTest, EmptyRows) {
+  ExpectCsrMatMulMatchesDense(/*m=*/64, /*k=*/64, /*n=*/8, /*density=*/0.0);
+}
+
+// Benchmarks C[m, n] = A[m, k] @ B[k, n] for a sparse A with the given density,
+// multiplying A in CSR format.
+void CsrMatMul(benchmark::State& state, int num_threads, ssize_t m, ssize_t k,
+               ssize_t n, double density) {
+  auto host = CreateTestHostContext(num_threads);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto a = CreateRandomTensor(m, k, density, host.get());
+  auto b = CreateRandomTensor(k, n, 1.0, host.get());
+  auto csr = CopyDenseHostTensorToCsrHostTensor(a, host.get());
+  auto c = DenseHostTensor::CreateUninitialized<float>(TensorShape({m, n}),
+                                                       host.get());
+
+  for (auto _ : state) {
+    auto chain = cpu::CsrMatMul<float>(*csr, b, c.getPointer(), exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(m * n * state.iterations());
+}
+
+// Same as above, but multiplying A as a dense tensor.
+void DenseMatMul(benchmark::State& state, int num_threads, ssize_t m,
+                 ssize_t k, ssize_t n, double density) {
+  auto host = CreateTestHostContext(num_threads);
+  compat::AsyncEigenEvaluator evaluator(host.get());
+
+  auto a = CreateRandomTensor(m, k, density, host.get());
+  auto b = CreateRandomTensor(k, n, 1.0, host.get());
+  auto c = DenseHostTensor::CreateUninitialized<float>(TensorShape({m, n}),
+                                                       host.get());
+
+  for (auto _ : state) {
+    auto chain = cpu::MatMul<float>(1.0, a, b, 0.0, c.getPointer(),
+                                    /*transpose_a=*/false,
+                                    /*transpose_b=*/false,
+                                    Eigen::NoOpOutputKernel(), evaluator);
+    host->Await(chain.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(m * n * state.iterations());
+}
+
+#define BM_MatMul(kind, threads, M, K, N, density_name, density)       \
+  static void BM_##kind##MatMul_##M##x##K##x##N##_##density_name##_##  \
+      tpool_##threads(benchmark::State& state) {                       \
+    kind##MatMul(state, threads, M, K, N, density);                    \
+  }                                                                    \
+  BENCHMARK(BM_##kind##MatMul_##M##x##K##x##N##_##density_name##_##    \
+            tpool_##threads)
+
+// [1024, 4096] @ [4096, 64] with 99% sparse lhs.
+BM_MatMul(Csr, 8, 1024, 4096, 64, sparse99, 0.01);
+BM_MatMul(Dense, 8, 1024, 4096, 64, sparse99, 0.01);
+
+// [1024, 4096] @ [4096, 64] with 99.9% sparse lhs.
+BM_MatMul(Csr, 8, 1024, 4096, 64, sparse999, 0.001);
+BM_MatMul(Dense, 8, 1024, 4096, 64, sparse999, 0.001);
+
+// [4096, 4096] @ [4096, 1] with 99% sparse lhs.
+BM_MatMul(Csr, 8, 4096, 4096, 1, sparse99, 0.01);
+BM_MatMul(Dense, 8, 4096, 4096, 1, sparse99, 0.01);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,293 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests for the vectorized coefficient wise kernels.
+
+#include "../../lib/kernels/cwise_simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "../../lib/kernels/cwise_binary_kernels.h"
+#include "../../lib/kernels/cwise_simd_impl.h"
+#include "../../lib/kernels/cwise_unary_kernels.h"
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+namespace cpu {
+namespace simd {
+namespace {
+
+using internal::KernelTable;
+
+std::vector<float> Iota(size_t n, float start, float step) {
+  std::vector<float> values(n);
+  for (size_t i = 0; i < n; ++i) values[i] = start + step * i;
+  return values;
+}
+
+// Runs `test` with the kernels of every instruction set that the CPU supports.
+void ForEachIsa(std::function<void(const KernelTable&)> test) {
+  for (Isa isa : {Isa::kGeneric, Isa::kNeon, Isa::kAvx2, Isa::kAvx512}) {
+    if (const KernelTable* kernels = internal::GetKernels(isa)) {
+      SCOPED_TRACE(static_cast<int>(isa));
+      test(*kernels);
+    }
+  }
+}
+
+TEST(CwiseSimdTest, SelectedIsaIsSupported) {
+  EXPECT_NE(internal::GetKernels(GetIsa()), nullptr);
+  EXPECT_NE(internal::GetKernels(Isa::kGeneric), nullptr);
+}
+
+TEST(CwiseSimdTest, Binary) {
+  struct {
+    BinaryOp op;
+    float (*reference)(float, float);
+  } ops[] = {
+      {BinaryOp::kAdd, [](float a, float b) { return a + b; }},
+      {BinaryOp::kSub, [](float a, float b) { return a - b; }},
+      {BinaryOp::kMul, [](float a, float b) { return a * b; }},
+      {BinaryOp::kDiv, [](float a, float b) { return a / b; }},
+      {BinaryOp::kMax, [](float a, float b) { return a > b ? a : b; }},
+      {BinaryOp::kMin, [](float a, float b) { return a < b ? a : b; }},
+  };
+
+  ForEachIsa([&](const KernelTable& kernels) {
+    // Cover sizes that are not a multiple of the vector width.
+    for (size_t n : {0, 1, 7, 8, 17, 33, 100}) {
+      std::vector<float> lhs = Iota(n, -3.0f, 0.25f);
+      std::vector<float> rhs = Iota(n, 5.0f, -0.5f);
+      for (const auto& op : ops) {
+        int index = static_cast<int>(op.op);
+        std::vector<float> out(n), out_lhs(n), out_rhs(n);
+        kernels.binary[index](lhs.data(), rhs.data(), out.data(), n);
+        kernels.binary_scalar_lhs[index](2.0f, rhs.data(), out_lhs.data(), n);
+        kernels.binary_scalar_rhs[index](lhs.data(), 2.0f, out_rhs.data(), n);
+        for (size_t i = 0; i < n; ++i) {
+          EXPECT_FLOAT_EQ(out[i], op.reference(lhs[i], rhs[i]));
+          EXPECT_FLOAT_EQ(out_lhs[i], op.reference(2.0f, rhs[i]));
+          EXPECT_FLOAT_EQ(out_rhs[i], op.reference(lhs[i], 2.0f));
+        }
+      }
+    }
+  });
+}
+
+TEST(CwiseSimdTest, BinaryInPlace) {
+  ForEachIsa([&](const KernelTable& kernels) {
+    std::vector<float> values = Iota(19, 1.0f, 1.0f);
+    kernels.binary[static_cast<int>(BinaryOp::kMul)](
+        values.data(), values.data(), values.data(), values.size());
+    for (size_t i = 0; i < values.size(); ++i)
+      EXPECT_EQ(values[i], (i + 1.0f) * (i + 1.0f));
+  });
+}
+
+TEST(CwiseSimdTest, Unary) {
+  ForEachIsa([&](const KernelTable& kernels) {
+    size_t n = 101;
+    std::vector<float> in = Iota(n, -10.0f, 0.2f);
+    std::vector<float> relu(n), sigmoid(n), tanh(n);
+    kernels.unary[static_cast<int>(UnaryOp::kRelu)](in.data(), relu.data(), n);
+    kernels.unary[static_cast<int>(UnaryOp::kSigmoid)](in.data(),
+                                                       sigmoid.data(), n);
+    kernels.unary[static_cast<int>(UnaryOp::kTanh)](in.data(), tanh.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+      EXPECT_EQ(relu[i], in[i] > 0.0f ? in[i] : 0.0f);
+      EXPECT_NEAR(sigmoid[i], 1.0f / (1.0f + std::exp(-in[i])), 1e-6f);
+      EXPECT_NEAR(tanh[i], std::tanh(in[i]), 1e-6f);
+    }
+  });
+}
+
+TEST(CwiseSimdTest, BinaryRows) {
+  std::vector<float> matrix = Iota(3 * 5, 0.0f, 1.0f);
+  std::vector<float> row = Iota(5, 100.0f, 100.0f);
+  std::vector<float> out_rhs(3 * 5), out_lhs(3 * 5);
+  BinaryRowRhs(BinaryOp::kAdd, matrix.data(), row.data(), out_rhs.data(), 3, 5);
+  BinaryRowLhs(BinaryOp::kSub, row.data(), matrix.data(), out_lhs.data(), 3, 5);
+  for (size_t r = 0; r < 3; ++r) {
+    for (size_t c = 0; c < 5; ++c) {
+      EXPECT_EQ(out_rhs[r * 5 + c], matrix[r * 5 + c] + row[c]);
+      EXPECT_EQ(out_lhs[r * 5 + c], row[c] - matrix[r * 5 + c]);
+    }
+  }
+}
+
+TEST(CwiseSimdTest, Reduce) {
+  ForEachIsa([&](const KernelTable& kernels) {
+    for (size_t n : {0, 1, 7, 8, 17, 33, 100}) {
+      std::vector<float> in = Iota(n, -3.0f, 0.25f);
+      float sum = 0.0f;
+      for (float value : in) sum += value;
+      auto sum_fn = kernels.reduce[static_cast<int>(ReduceOp::kSum)];
+      auto max_fn = kernels.reduce[static_cast<int>(ReduceOp::kMax)];
+      EXPECT_NEAR(sum_fn(in.data(), n), sum, 1e-4f);
+      EXPECT_EQ(max_fn(in.data(), n),
+                n == 0 ? -std::numeric_limits<float>::infinity() : in.back());
+    }
+  });
+}
+
+TEST(CwiseSimdTest, ExpSum) {
+  ForEachIsa([&](const KernelTable& kernels) {
+    size_t n = 101;
+    std::vector<float> in = Iota(n, -80.0f, 1.6f);
+    std::vector<float> out(n);
+    float sum = kernels.exp_sum(in.data(), 1.0f, out.data(), n);
+    double expected_sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      float expected = std::exp(in[i] - 1.0f);
+      EXPECT_NEAR(out[i], expected, 2e-6f * expected);
+      expected_sum += expected;
+    }
+    EXPECT_NEAR(sum, expected_sum, 1e-5 * expected_sum);
+    EXPECT_EQ(kernels.exp_sum(in.data(), 1.0f, nullptr, n), sum);
+  });
+}
+
+TEST(CwiseSimdTest, SoftmaxRow) {
+  size_t n = 1000;
+  std::vector<float> in = Iota(n, -20.0f, 0.05f);
+  std::vector<float> softmax(n), log_softmax(n);
+  SoftmaxRow(in.data(), softmax.data(), n, /*log=*/false);
+  SoftmaxRow(in.data(), log_softmax.data(), n, /*log=*/true);
+
+  double sum = 0.0;
+  for (float value : in) sum += std::exp(double{value} - in.back());
+  for (size_t i = 0; i < n; ++i) {
+    double log_expected = in[i] - in.back() - std::log(sum);
+    double expected = std::exp(log_expected);
+    EXPECT_NEAR(softmax[i], expected, 1e-5 * expected);
+    EXPECT_NEAR(log_softmax[i], log_expected, 1e-5);
+  }
+}
+
+// Values that exercise the rounding of the conversions to bf16 and fp16.
+std::vector<float> ConversionInputs() {
+  std::vector<float> values = Iota(64, -100.0f, 3.1f);
+  for (float value : {0.0f, -0.0f, 1.0f + 1.0f / 256, 1.0f + 3.0f / 256,
+                      1.0f + 1.0f / 2048, 1.0f + 3.0f / 2048, 65504.0f,
+                      65520.0f, 1e-5f, -1e-7f, 1e-40f, 3.4e38f,
+                      std::numeric_limits<float>::infinity(),
+                      -std::numeric_limits<float>::infinity(),
+                      std::numeric_limits<float>::quiet_NaN()})
+    values.push_back(value);
+  return values;
+}
+
+TEST(CwiseSimdTest, Bf16Conversions) {
+  std::vector<float> in = ConversionInputs();
+  ForEachIsa([&](const KernelTable& kernels) {
+    for (size_t n : {size_t{0}, size_t{1}, size_t{17}, in.size()}) {
+      std::vector<bf16> narrow(n);
+      std::vector<float> wide(n);
+      kernels.float_to_bf16(in.data(), narrow.data(), n);
+      kernels.bf16_to_float(narrow.data(), wide.data(), n);
+      for (size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(narrow[i].value, FloatToBf16(in[i]).value) << in[i];
+        float expected = Bf16ToFloat(narrow[i]);
+        if (std::isnan(expected))
+          EXPECT_TRUE(std::isnan(wide[i]));
+        else
+          EXPECT_EQ(wide[i], expected);
+      }
+    }
+  });
+}
+
+TEST(CwiseSimdTest, Fp16Conversions) {
+  std::vector<float> in = ConversionInputs();
+  ForEachIsa([&](const KernelTable& kernels) {
+    for (size_t n : {size_t{0}, size_t{1}, size_t{17}, in.size()}) {
+      std::vector<fp16> narrow(n);
+      std::vector<float> wide(n);
+      kernels.float_to_fp16(in.data(), narrow.data(), n);
+      kernels.fp16_to_float(narrow.data(), wide.data(), n);
+      for (size_t i = 0; i < n; ++i) {
+        float expected = Fp16ToFloat(FloatToFp16(in[i]));
+        if (std::isnan(in[i])) {
+          EXPECT_TRUE(std::isnan(wide[i]));
+          continue;
+        }
+        EXPECT_EQ(narrow[i].value, FloatToFp16(in[i]).value) << in[i];
+        EXPECT_EQ(wide[i], expected);
+      }
+    }
+  });
+}
+
+class CwiseKernelsTest : public ::testing::Test {
+ protected:
+  CwiseKernelsTest()
+      : host_([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+              CreateSingleThreadedWorkQueue()),
+        exec_ctx_(std::move(*RequestContextBuilder(&host_, nullptr).build())) {}
+
+  DenseHostTensor MakeTensor(ArrayRef<ssize_t> dims, ArrayRef<float> values) {
+    TensorMetadata metadata(GetDType<float>(), dims);
+    auto tensor = DenseHostTensor::CreateUninitialized(metadata, &host_);
+    auto view = MutableDHTArrayView<float>(tensor.getPointer());
+    std::copy(values.begin(), values.end(), view.data());
+    return std::move(*tensor);
+  }
+
+  HostContext host_;
+  ExecutionContext exec_ctx_;
+};
+
+TEST_F(CwiseKernelsTest, BinaryKernelBroadcastsRows) {
+  DenseHostTensor matrix = MakeTensor({2, 3}, {1, 2, 3, 4, 5, 6});
+  DenseHostTensor bias = MakeTensor({3}, {10, 20, 30});
+  DenseHostTensor out = MakeTensor({2, 3}, {0, 0, 0, 0, 0, 0});
+
+  using Add = functor::Add::Functor<float>;
+  EXPECT_FALSE(SyncBinaryKernel<Add>(matrix, bias, &out, exec_ctx_));
+  EXPECT_EQ(DHTArrayView<float>(&out).Elements(),
+            ArrayRef<float>({11, 22, 33, 14, 25, 36}));
+
+  using Sub = functor::Sub::Functor<float>;
+  EXPECT_FALSE(SyncBinaryKernel<Sub>(bias, matrix, &out, exec_ctx_));
+  EXPECT_EQ(DHTArrayView<float>(&out).Elements(),
+            ArrayRef<float>({9, 18, 27, 6, 15, 24}));
+}
+
+TEST_F(CwiseKernelsTest, UnaryKernelSigmoid) {
+  DenseHostTensor in = MakeTensor({4}, {-2, -1, 0, 1});
+  DenseHostTensor out = MakeTensor({4}, {0, 0, 0, 0});
+  SyncUnaryKernel<functor::Sigmoid::Functor<float>>(in, &out);
+  auto in_view = DHTArrayView<float>(&in);
+  auto out_view = DHTArrayView<float>(&out);
+  for (int i = 0; i < 4; ++i)
+    EXPECT_NEAR(out_view[i], 1.0f / (1.0f + std::exp(-in_view[i])), 1e-6f);
+}
+
+}  // namespace
+}  // namespace simd
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit tests and benchmarks for the gather and segment reduction kernels.
+
+#include "../../lib/kernels/embedding_kernels.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+// Returns a tensor of the given dtype filled with `values`, or with zeros if
+// there are none.
+template <typename T>
+DenseHostTensor CreateTensor(DType dtype, llvm::ArrayRef<ssize_t> dims,
+                             HostContext* host,
+                             llvm::ArrayRef<T> values = {}) {
+  auto dht = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(dtype, TensorShape(dims)), host);
+  auto* data = static_cast<T*>(dht->data());
+  std::fill(data, data + dht->NumElements(), T(0));
+  std::copy(values.begin(), values.end(), data);
+  return std::move(dht.getValue());
+}
+
+template <typename T>
+std::vector<T> Values(const DenseHostTensor& dht) {
+  const T* data = static_cast<const T*>(dht.data());
+  return std::vector<T>(data, data + dht.NumElements());
+}
+
+void Await(HostContext* host, AsyncValueRef<Chain> chain) {
+  host->Await(chain.CopyRCRef());
+  ASSERT_FALSE(chain.IsError());
+}
+
+TEST(EmbeddingKernelsTest, GatherCopiesRows) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto params = CreateTensor<int32_t>(DType(DType::I32), {3, 2}, host.get(),
+                                      {0, 1, 10, 11, 20, 21});
+  auto indices = CreateTensor<int64_t>(DType(DType::I64), {2, 2}, host.get(),
+                                       {2, 0, 1, 2});
+  auto output = CreateTensor<int32_t>(DType(DType::I32), {2, 2, 2}, host.get());
+  Await(host.get(), cpu::Gather(params, indices, &output, exec_ctx));
+  EXPECT_EQ(Values<int32_t>(output),
+            std::vector<int32_t>({20, 21, 0, 1, 10, 11, 20, 21}));
+}
+
+TEST(EmbeddingKernelsTest, GatherRejectsOutOfRangeIndices) {
+  auto host = CreateTestHostContext(1);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto params = CreateTensor<float>(DType(DType::F32), {3, 2}, host.get());
+  auto indices =
+      CreateTensor<int32_t>(DType(DType::I32), {1}, host.get(), {3});
+  auto output = CreateTensor<float>(DType(DType::F32), {1, 2}, host.get());
+  auto chain = cpu::Gather(params, indices, &output, exec_ctx);
+  host->Await(chain.CopyRCRef());
+  EXPECT_TRUE(chain.IsError());
+}
+
+TEST(EmbeddingKernelsTest, SegmentSum) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto data = CreateTensor<float>(DType(DType::F32), {4, 2}, host.get(),
+                                  {1, 2, 3, 4, 5, 6, 7, 8});
+  auto segment_ids =
+      CreateTensor<int32_t>(DType(DType::I32), {4}, host.get(), {0, 0, 2, 2});
+  auto num_segments = cpu::GetNumSegments(segment_ids);
+  ASSERT_TRUE(!!num_segments);
+  EXPECT_EQ(*num_segments, 3);
+
+  auto output = CreateTensor<float>(DType(DType::F32), {3, 2}, host.get());
+  Await(host.get(),
+        cpu::SparseSegmentReduce(data, /*indices=*/nullptr, segment_ids,
+                                 cpu::SegmentCombiner::kSum, &output,
+                                 exec_ctx));
+  EXPECT_EQ(Values<float>(output), std::vector<float>({4, 6, 0, 0, 12, 14}));
+}
+
+TEST(EmbeddingKernelsTest, SparseSegmentCombiners) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto data = CreateTensor<float>(DType(DType::F32), {3, 1}, host.get(),
+                                  {1, 2, 4});
+  auto indices = CreateTensor<int64_t>(DType(DType::I64), {5}, host.get(),
+                                       {0, 2, 2, 1, 1});
+  auto segment_ids = CreateTensor<int64_t>(DType(DType::I64), {5}, host.get(),
+                                           {0, 0, 0, 1, 1});
+  auto output = CreateTensor<float>(DType(DType::F32), {2, 1}, host.get());
+
+  Await(host.get(), cpu::SparseSegmentReduce(data, &indices, segment_ids,
+                                             cpu::SegmentCombiner::kSum,
+                                             &output, exec_ctx));
+  EXPECT_EQ(Values<float>(output), std::vector<float>({9, 4}));
+
+  Await(host.get(), cpu::SparseSegmentReduce(data, &indices, segment_ids,
+                                             cpu::SegmentCombiner::kMean,
+                                             &output, exec_ctx));
+  EXPECT_EQ(Values<float>(output), std::vector<float>({3, 2}));
+
+  Await(host.get(), cpu::SparseSegmentReduce(data, &indices, segment_ids,
+                                             cpu::SegmentCombiner::kSqrtN,
+                                             &output, exec_ctx));
+  EXPECT_FLOAT_EQ(Values<float>(output)[0], 9 / std::sqrt(3.0f));
+  EXPECT_FLOAT_EQ(Values<float>(output)[1], 4 / std::sqrt(2.0f));
+}
+
+TEST(EmbeddingKernelsTest, SparseSegmentRejectsUnsortedSegmentIds) {
+  auto host = CreateTestHostContext(1);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto data = CreateTensor<float>(DType(DType::F32), {2, 1}, host.get());
+  auto segment_ids =
+      CreateTensor<int32_t>(DType(DType::I32), {2}, host.get(), {1, 0});
+  auto output = CreateTensor<float>(DType(DType::F32), {2, 1}, host.get());
+  auto chain = cpu::SparseSegmentReduce(data, /*indices=*/nullptr, segment_ids,
+                                        cpu::SegmentCombiner::kSum, &output,
+                                        exec_ctx);
+  host->Await(chain.CopyRCRef());
+  EXPECT_TRUE(chain.IsError());
+}
+
+// Benchmarks an embedding lookup of `batch` bags of `bag_size` random rows of
+// a [num_rows, dim] table.
+void EmbeddingLookup(benchmark::State& state, int num_threads,
+                     ssize_t num_rows, ssize_t dim, ssize_t batch,
+                     ssize_t bag_size) {
+  auto host = CreateTestHostContext(num_threads);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int64_t> row(0, num_rows - 1);
+  std::vector<int64_t> ids(batch * bag_size);
+  std::vector<int64_t> segments(batch * bag_size);
+  for (size_t i = 0; i < ids.size(); ++i) {
+    ids[i] = row(gen);
+    segments[i] = i / bag_size;
+  }
+
+  auto table =
+      CreateTensor<float>(DType(DType::F32), {num_rows, dim}, host.get());
+  auto indices = CreateTensor<int64_t>(
+      DType(DType::I64), {batch * bag_size}, host.get(), ids);
+  auto segment_ids = CreateTensor<int64_t>(
+      DType(DType::I64), {batch * bag_size}, host.get(), segments);
+  auto output =
+      CreateTensor<float>(DType(DType::F32), {batch, dim}, host.get());
+
+  for (auto _ : state) {
+    auto chain = cpu::SparseSegmentReduce(table, &indices, segment_ids,
+                                          cpu::SegmentCombiner::kSum, &output,
+                                          exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(batch * bag_size * state.iterations());
+}
+
+#define BM_EmbeddingLookup(threads, ROWS, DIM, BATCH, BAG)                     \
+  static void BM_EmbeddingLookup_##ROWS##x##DIM##_##BATCH##x##BAG##_##threads( \
+      benchmark::State& state) {                                               \
+    EmbeddingLookup(state, threads, ROWS, DIM, BATCH, BAG);                    \
+  }                                                                            \
+  BENCHMARK(BM_EmbeddingLookup_##ROWS##x##DIM##_##BATCH##x##BAG##_##threads)
+
+BM_EmbeddingLookup(1, 1000000, 64, 256, 32);
+BM_EmbeddingLookup(8, 1000000, 64, 256, 32);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,355 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests and benchmarks for the packed matmul kernel.
+
+#include "../../lib/kernels/packed_matmul_kernel.h"
+
+#include <random>
+#include <vector>
+
+#include "../../lib/kernels/cwise_simd_impl.h"
+#include "../../lib/kernels/matmul_kernel.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/contraction_output_kernel.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+std::vector<float> RandomValues(size_t size) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> values(-1.0, 1.0);
+  std::vector<float> result(size);
+  for (auto& value : result) value = values(gen);
+  return result;
+}
+
+DenseHostTensor CreateRandomTensor(ssize_t rows, ssize_t cols,
+                                   HostContext* host) {
+  auto dht = DenseHostTensor::CreateUninitialized<float>(
+      TensorShape({rows, cols}), host);
+  auto values = RandomValues(rows * cols);
+  std::copy(values.begin(), values.end(),
+            MutableDHTArrayView<float>(dht.getPointer()).begin());
+  return std::move(dht.getValue());
+}
+
+// Returns lhs @ rhs for row major lhs [m, k] and rhs [k, n], transposed if
+// requested.
+std::vector<float> ReferenceMatMul(const float* lhs, const float* rhs,
+                                   size_t m, size_t n, size_t k,
+                                   bool transpose_lhs, bool transpose_rhs) {
+  std::vector<float> out(m * n);
+  for (size_t r = 0; r < m; ++r) {
+    for (size_t c = 0; c < n; ++c) {
+      float sum = 0.0f;
+      for (size_t i = 0; i < k; ++i)
+        sum += (transpose_lhs ? lhs[i * m + r] : lhs[r * k + i]) *
+               (transpose_rhs ? rhs[c * k + i] : rhs[i * n + c]);
+      out[r * n + c] = sum;
+    }
+  }
+  return out;
+}
+
+TEST(PackedMatMulTest, PacksZeroPaddedPanels) {
+  // rhs [2, 17] packs into two panels of 2 rows.
+  std::vector<float> rhs(2 * 17);
+  for (size_t i = 0; i < rhs.size(); ++i) rhs[i] = i;
+  std::vector<float> packed(cpu::simd::PackedMatMulRhsSize(2, 17), -1.0f);
+  cpu::simd::PackMatMulRhs(rhs.data(), 2, 17, /*transpose_rhs=*/false,
+                           packed.data(), 0, 2);
+
+  for (size_t j = 0; j < 16; ++j) {
+    EXPECT_EQ(packed[j], j);
+    EXPECT_EQ(packed[16 + j], 17 + j);
+  }
+  EXPECT_EQ(packed[32], 16);
+  EXPECT_EQ(packed[48], 33);
+  for (size_t j = 1; j < 16; ++j) {
+    EXPECT_EQ(packed[32 + j], 0.0f);
+    EXPECT_EQ(packed[48 + j], 0.0f);
+  }
+}
+
+TEST(PackedMatMulTest, MatchesReferenceForEveryIsa) {
+  using cpu::simd::Isa;
+  for (Isa isa : {Isa::kGeneric, Isa::kNeon, Isa::kAvx2, Isa::kAvx512}) {
+    const auto* kernels = cpu::simd::internal::GetKernels(isa);
+    if (!kernels) continue;
+    SCOPED_TRACE(static_cast<int>(isa));
+
+    for (size_t m : {1, 3, 4, 7, 32}) {
+      for (size_t n : {1, 16, 33}) {
+        for (size_t k : {1, 65}) {
+          SCOPED_TRACE(testing::Message() << m << "x" << k << "x" << n);
+          auto lhs = RandomValues(m * k);
+          auto rhs = RandomValues(k * n);
+          std::vector<float> packed(cpu::simd::PackedMatMulRhsSize(k, n));
+          cpu::simd::PackMatMulRhs(rhs.data(), k, n, /*transpose_rhs=*/false,
+                                   packed.data(), 0,
+                                   cpu::simd::NumMatMulPanels(n));
+
+          std::vector<float> out(m * n);
+          kernels->matmul(lhs.data(), /*lhs_row_stride=*/k,
+                          /*lhs_col_stride=*/1, packed.data(), out.data(),
+                          /*ldo=*/n, m, n, k);
+
+          auto expected = ReferenceMatMul(lhs.data(), rhs.data(), m, n, k,
+                                          /*transpose_lhs=*/false,
+                                          /*transpose_rhs=*/false);
+          for (size_t i = 0; i < out.size(); ++i)
+            ASSERT_NEAR(out[i], expected[i], 1e-4) << i;
+        }
+      }
+    }
+  }
+}
+
+TEST(PackedMatMulTest, Transposed) {
+  const size_t m = 5, n = 37, k = 19;
+  auto lhs = RandomValues(m * k);
+  auto rhs = RandomValues(k * n);
+  for (bool transpose_lhs : {false, true}) {
+    for (bool transpose_rhs : {false, true}) {
+      std::vector<float> packed(cpu::simd::PackedMatMulRhsSize(k, n));
+      cpu::simd::PackMatMulRhs(rhs.data(), k, n, transpose_rhs, packed.data(),
+                               0, cpu::simd::NumMatMulPanels(n));
+      std::vector<float> out(m * n);
+      cpu::simd::PackedMatMul(lhs.data(), transpose_lhs, packed.data(),
+                              out.data(), m, n, k, 0,
+                              cpu::simd::NumMatMulPanels(n));
+
+      auto expected = ReferenceMatMul(lhs.data(), rhs.data(), m, n, k,
+                                      transpose_lhs, transpose_rhs);
+      for (size_t i = 0; i < out.size(); ++i)
+        ASSERT_NEAR(out[i], expected[i], 1e-4) << i;
+    }
+  }
+}
+
+TEST(PackedMatMulTest, CachesRepeatedRhs) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+  const ssize_t m = 8, k = 300, n = 200;
+
+  auto a = CreateRandomTensor(m, k, host.get());
+  auto b = CreateRandomTensor(k, n, host.get());
+  auto expected = ReferenceMatMul(static_cast<const float*>(a.data()),
+                                  static_cast<const float*>(b.data()), m, n, k,
+                                  /*transpose_lhs=*/false,
+                                  /*transpose_rhs=*/false);
+
+  auto& cache = host->GetOrCreateSharedContext<cpu::PackedMatMulRhsCache>();
+  // The first multiplication packs `b` itself, the second caches it and the
+  // third uses the cached panels.
+  for (int i = 0; i < 3; ++i) {
+    auto c = DenseHostTensor::CreateUninitialized<float>(TensorShape({m, n}),
+                                                         host.get());
+    auto chain = cpu::PackedMatMul(a, b, c.getPointer(), /*transpose_a=*/false,
+                                   /*transpose_b=*/false, exec_ctx);
+    host->Await(chain.CopyRCRef());
+    ASSERT_FALSE(chain.IsError());
+
+    DHTArrayView<float> c_view(c.getPointer());
+    for (size_t j = 0; j < expected.size(); ++j)
+      ASSERT_NEAR(c_view[j], expected[j], 1e-3) << j;
+  }
+
+  auto packed = cache.GetOrPack(b, /*transpose_rhs=*/false, k, n);
+  ASSERT_TRUE(packed);
+  EXPECT_EQ(packed.get(),
+            cache.GetOrPack(b, /*transpose_rhs=*/false, k, n).get());
+}
+
+TEST(EigenMatMulTest, RowBlocksMatchReference) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+  // Enough rows for the row blocks on 4 threads, with a partial last block.
+  const ssize_t m = 300, k = 70, n = 45;
+
+  auto a = CreateRandomTensor(m, k, host.get());
+  auto b = CreateRandomTensor(k, n, host.get());
+  auto a_data = static_cast<const float*>(a.data());
+  auto b_data = static_cast<const float*>(b.data());
+
+  // Row blocks run as ParallelFor tasks with the execution context, and on the
+  // Eigen thread pool device without it.
+  compat::AsyncEigenEvaluator evaluators[] = {
+      compat::AsyncEigenEvaluator(exec_ctx),
+      compat::AsyncEigenEvaluator(host.get())};
+
+  for (auto& evaluator : evaluators) {
+    for (bool transpose_a : {false, true}) {
+      for (bool transpose_b : {false, true}) {
+        SCOPED_TRACE(testing::Message() << transpose_a << transpose_b);
+        // The same buffers are read as the transposed [k, m] and [n, k].
+        auto expected = ReferenceMatMul(a_data, b_data, m, n, k, transpose_a,
+                                        transpose_b);
+        auto a_shape = transpose_a ? TensorShape({k, m}) : TensorShape({m, k});
+        auto b_shape = transpose_b ? TensorShape({n, k}) : TensorShape({k, n});
+        DenseHostTensor a_arg(TensorMetadata(a.dtype(), a_shape),
+                              a.buffer().CopyRef());
+        DenseHostTensor b_arg(TensorMetadata(b.dtype(), b_shape),
+                              b.buffer().CopyRef());
+
+        auto c = DenseHostTensor::CreateUninitialized<float>(
+            TensorShape({m, n}), host.get());
+        MutableDHTArrayView<float> c_view(c.getPointer());
+        c_view.Fill(1.0f);
+
+        // C = 2 * AB + 0.5 * C
+        auto chain = cpu::MatMul<float>(2.0, a_arg, b_arg, 0.5, c.getPointer(),
+                                        transpose_a, transpose_b,
+                                        Eigen::NoOpOutputKernel(), evaluator);
+        host->Await(chain.CopyRCRef());
+        ASSERT_FALSE(chain.IsError());
+
+        for (size_t i = 0; i < expected.size(); ++i)
+          ASSERT_NEAR(c_view[i], 2.0f * expected[i] + 0.5f, 1e-3) << i;
+      }
+    }
+  }
+}
+
+TEST(EigenMatMulTest, CachesConstantWeights) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+  // Large enough for Eigen to block all dimensions of the product.
+  const ssize_t m = 200, k = 700, n = 300;
+
+  auto a = CreateRandomTensor(m, k, host.get());
+  auto bias = RandomValues(n);
+  compat::AsyncEigenEvaluator evaluator(exec_ctx);
+
+  for (bool transpose_b : {false, true}) {
+    SCOPED_TRACE(transpose_b);
+    auto b = transpose_b ? CreateRandomTensor(n, k, host.get())
+                         : CreateRandomTensor(k, n, host.get());
+    auto expected = ReferenceMatMul(static_cast<const float*>(a.data()),
+                                    static_cast<const float*>(b.data()), m, n,
+                                    k, /*transpose_lhs=*/false, transpose_b);
+
+    // The first multiplication packs the weights in every row block, the
+    // second caches them and the third uses the cached blocks.
+    for (int i = 0; i < 3; ++i) {
+      auto c = DenseHostTensor::CreateUninitialized<float>(
+          TensorShape({m, n}), host.get());
+      compat::BiasAddOutputKernel<float> output_kernel(
+          compat::EigenConstTensor<float, 1>(bias.data(), n));
+      auto chain = cpu::MatMul<float>(1.0, a, b, 0.0, c.getPointer(),
+                                      /*transpose_a=*/false, transpose_b,
+                                      output_kernel, evaluator);
+      host->Await(chain.CopyRCRef());
+      ASSERT_FALSE(chain.IsError());
+
+      DHTArrayView<float> c_view(c.getPointer());
+      for (size_t j = 0; j < expected.size(); ++j)
+        ASSERT_NEAR(c_view[j], expected[j] + bias[j % n], 1e-3) << j;
+    }
+
+    cpu::internal::GebpMatMul<float> gebp(m, n, k);
+    auto& cache = host->GetOrCreateSharedContext<cpu::PackedMatMulRhsCache>();
+    EXPECT_TRUE(cache.GetOrPack(b, gebp.layout(transpose_b),
+                                gebp.PackedSize() * sizeof(float),
+                                [](void*) { ADD_FAILURE() << "not cached"; }));
+  }
+}
+
+// Benchmarks C[m, n] = A[m, k] @ B[k, n] with a constant B.
+void PackedMatMul(benchmark::State& state, int num_threads, ssize_t m,
+                  ssize_t k, ssize_t n) {
+  auto host = CreateTestHostContext(num_threads);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto a = CreateRandomTensor(m, k, host.get());
+  auto b = CreateRandomTensor(k, n, host.get());
+  auto c = DenseHostTensor::CreateUninitialized<float>(TensorShape({m, n}),
+                                                       host.get());
+
+  for (auto _ : state) {
+    auto chain = cpu::PackedMatMul(a, b, c.getPointer(), /*transpose_a=*/false,
+                                   /*transpose_b=*/false, exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(m * n * state.iterations());
+}
+
+// Same as above, but computed with Eigen.
+void EigenMatMul(benchmark::State& state, int num_threads, ssize_t m,
+                 ssize_t k, ssize_t n) {
+  auto host = CreateTestHostContext(num_threads);
+  auto exec_ctx = CreateExecutionContext(host.get());
+  compat::AsyncEigenEvaluator evaluator(exec_ctx);
+
+  auto a = CreateRandomTensor(m, k, host.get());
+  auto b = CreateRandomTensor(k, n, host.get());
+  auto c = DenseHostTensor::CreateUninitialized<float>(TensorShape({m, n}),
+                                                       host.get());
+
+  for (auto _ : state) {
+    auto chain = cpu::MatMul<float>(1.0, a, b, 0.0, c.getPointer(),
+                                    /*transpose_a=*/false,
+                                    /*transpose_b=*/false,
+                                    Eigen::NoOpOutputKernel(), evaluator);
+    host->Await(chain.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(m * n * state.iterations());
+}
+
+#define BM_MatMul(kind, threads, M, K, N)                               \
+  static void BM_##kind##MatMul_##M##x##K##x##N##_tpool_##threads(      \
+      benchmark::State& state) {                                        \
+    kind##MatMul(state, threads, M, K, N);                              \
+  }                                                                     \
+  BENCHMARK(BM_##kind##MatMul_##M##x##K##x##N##_tpool_##threads)
+
+BM_MatMul(Packed, 8, 1, 1024, 1024);
+BM_MatMul(Eigen, 8, 1, 1024, 1024);
+
+BM_MatMul(Packed, 8, 8, 1024, 1024);
+BM_MatMul(Eigen, 8, 8, 1024, 1024);
+
+BM_MatMul(Packed, 8, 32, 1024, 1024);
+BM_MatMul(Eigen, 8, 32, 1024, 1024);
+
+BM_MatMul(Eigen, 8, 1024, 1024, 1024);
+
+}  // namespace
+}  // namespace tfrt
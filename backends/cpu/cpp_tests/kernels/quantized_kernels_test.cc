@@ -0,0 +1,250 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests and benchmarks for the int8 quantized kernels.
+
+#include "../../lib/kernels/quantized_kernels.h"
+
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+// Returns a tensor of the given dtype filled with random bytes, or with
+// `values` if specified.
+template <typename T>
+DenseHostTensor CreateTensor(DType dtype, llvm::ArrayRef<ssize_t> dims,
+                             HostContext* host,
+                             llvm::ArrayRef<T> values = {}) {
+  auto dht = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(dtype, TensorShape(dims)), host);
+  auto* data = static_cast<T*>(dht->data());
+  if (!values.empty()) {
+    std::copy(values.begin(), values.end(), data);
+  } else {
+    std::mt19937 gen(42);
+    for (ssize_t i = 0; i < dht->NumElements(); ++i)
+      data[i] = static_cast<T>(gen());
+  }
+  return std::move(dht.getValue());
+}
+
+template <typename T>
+const T* Data(const DenseHostTensor& dht) {
+  return static_cast<const T*>(dht.data());
+}
+
+void Await(HostContext* host, AsyncValueRef<Chain> chain) {
+  host->Await(chain.CopyRCRef());
+  ASSERT_FALSE(chain.IsError());
+}
+
+TEST(QuantizedKernelsTest, MatMulKernelsMatchReference) {
+  using cpu::internal::NumQuantizedPanels;
+  std::mt19937 gen(42);
+  for (auto kernel : {cpu::internal::GetGenericQuantizedMatMul(),
+                      cpu::internal::GetVnniQuantizedMatMul()}) {
+    if (!kernel) continue;
+    for (size_t m : {1, 3, 4, 9}) {
+      for (size_t n : {1, 16, 37}) {
+        for (size_t k : {1, 7, 64, 67}) {
+          SCOPED_TRACE(testing::Message() << m << "x" << k << "x" << n);
+          std::vector<uint8_t> lhs(m * k);
+          std::vector<int8_t> rhs(k * n);
+          for (auto& value : lhs) value = gen();
+          for (auto& value : rhs) value = gen();
+          const int32_t zero_point = gen() % 256;
+
+          std::vector<int8_t> packed(
+              cpu::internal::PackedQuantizedRhsSize(k, n));
+          std::vector<int32_t> col_sums(NumQuantizedPanels(n) *
+                                        cpu::internal::kQuantizedPanelWidth);
+          cpu::internal::PackQuantizedRhs(rhs.data(), k, n, packed.data(),
+                                          col_sums.data(), 0,
+                                          NumQuantizedPanels(n));
+
+          std::vector<int32_t> out(m * n);
+          kernel(lhs.data(), /*lda=*/k, zero_point, packed.data(),
+                 col_sums.data(), out.data(), /*ldo=*/n, m, n, k);
+
+          for (size_t r = 0; r < m; ++r) {
+            for (size_t c = 0; c < n; ++c) {
+              int32_t expected = 0;
+              for (size_t i = 0; i < k; ++i)
+                expected += (lhs[r * k + i] - zero_point) * rhs[i * n + c];
+              ASSERT_EQ(out[r * n + c], expected) << r << ", " << c;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(QuantizedKernelsTest, QuantizePerChannel) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto input = CreateTensor<float>(DType(DType::F32), {2, 3}, host.get(),
+                                   {0.0f, 1.0f, -1.0f, 2.5f, 100.0f, -100.0f});
+  auto scale = CreateTensor<float>(DType(DType::F32), {3}, host.get(),
+                                   {0.5f, 0.1f, 1.0f});
+  auto zero_point =
+      CreateTensor<int32_t>(DType(DType::I32), {3}, host.get(), {10, 0, -5});
+
+  auto output = CreateTensor<int8_t>(DType(DType::QI8), {2, 3}, host.get());
+  Await(host.get(), cpu::Quantize(input, scale, zero_point, /*axis=*/1,
+                                  &output, exec_ctx));
+  const int8_t expected_quantized[] = {10, 10, -6, 15, 127, -105};
+  for (int i = 0; i < 6; ++i)
+    EXPECT_EQ(Data<int8_t>(output)[i], expected_quantized[i]) << i;
+
+  auto dequantized =
+      CreateTensor<float>(DType(DType::F32), {2, 3}, host.get());
+  Await(host.get(), cpu::Dequantize(output, scale, zero_point, /*axis=*/1,
+                                    &dequantized, exec_ctx));
+  const float expected[] = {0.0f, 1.0f, -1.0f, 2.5f, 12.7f, -100.0f};
+  for (int i = 0; i < 6; ++i)
+    EXPECT_FLOAT_EQ(Data<float>(dequantized)[i], expected[i]) << i;
+}
+
+TEST(QuantizedKernelsTest, Conv2DMatchesReference) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  // A 3x3 convolution with stride 2 and one pixel of padding.
+  const ssize_t batch = 2, height = 7, width = 6, channels = 5;
+  const ssize_t out_height = 4, out_width = 3, out_channels = 3;
+  auto input = CreateTensor<uint8_t>(DType(DType::QUI8),
+                                     {batch, height, width, channels},
+                                     host.get());
+  auto filter = CreateTensor<int8_t>(
+      DType(DType::QI8), {3, 3, channels, out_channels}, host.get());
+  auto output = CreateTensor<int32_t>(
+      DType(DType::QI32), {batch, out_height, out_width, out_channels},
+      host.get());
+
+  cpu::QuantizedConv2DParams params;
+  params.input_zero_point = 128;
+  params.strides[0] = params.strides[1] = 2;
+  params.dilations[0] = params.dilations[1] = 1;
+  params.paddings_before[0] = params.paddings_before[1] = 1;
+  Await(host.get(),
+        cpu::QuantizedConv2D(input, filter, params, &output, exec_ctx));
+
+  const auto* in = Data<uint8_t>(input);
+  const auto* f = Data<int8_t>(filter);
+  const auto* out = Data<int32_t>(output);
+  for (ssize_t b = 0; b < batch; ++b) {
+    for (ssize_t y = 0; y < out_height; ++y) {
+      for (ssize_t x = 0; x < out_width; ++x) {
+        for (ssize_t o = 0; o < out_channels; ++o) {
+          int32_t expected = 0;
+          for (ssize_t fy = 0; fy < 3; ++fy) {
+            for (ssize_t fx = 0; fx < 3; ++fx) {
+              ssize_t in_y = y * 2 - 1 + fy, in_x = x * 2 - 1 + fx;
+              if (in_y < 0 || in_y >= height || in_x < 0 || in_x >= width)
+                continue;
+              for (ssize_t c = 0; c < channels; ++c) {
+                int32_t value =
+                    in[((b * height + in_y) * width + in_x) * channels + c];
+                int32_t weight =
+                    f[((fy * 3 + fx) * channels + c) * out_channels + o];
+                expected += (value - params.input_zero_point) * weight;
+              }
+            }
+          }
+          ASSERT_EQ(
+              out[((b * out_height + y) * out_width + x) * out_channels + o],
+              expected);
+        }
+      }
+    }
+  }
+}
+
+TEST(QuantizedKernelsTest, BiasAddAndRelu) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto input = CreateTensor<int32_t>(DType(DType::QI32), {2, 2}, host.get(),
+                                     {-5, 3, 7, -20});
+  auto bias =
+      CreateTensor<int32_t>(DType(DType::QI32), {2}, host.get(), {2, 10});
+  auto sum = CreateTensor<int32_t>(DType(DType::QI32), {2, 2}, host.get());
+  Await(host.get(), cpu::QuantizedBiasAdd(input, bias, &sum, exec_ctx));
+
+  auto relu = CreateTensor<int32_t>(DType(DType::QI32), {2, 2}, host.get());
+  Await(host.get(),
+        cpu::QuantizedRelu(sum, /*zero_point=*/0, &relu, exec_ctx));
+  EXPECT_EQ(
+      std::vector<int32_t>(Data<int32_t>(relu), Data<int32_t>(relu) + 4),
+      std::vector<int32_t>({0, 13, 9, 0}));
+}
+
+// Benchmarks C[m, n] = A[m, k] @ B[k, n].
+void QuantizedMatMul(benchmark::State& state, int num_threads, ssize_t m,
+                     ssize_t k, ssize_t n) {
+  auto host = CreateTestHostContext(num_threads);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto a = CreateTensor<uint8_t>(DType(DType::QUI8), {m, k}, host.get());
+  auto b = CreateTensor<int8_t>(DType(DType::QI8), {k, n}, host.get());
+  auto c = CreateTensor<int32_t>(DType(DType::QI32), {m, n}, host.get());
+
+  for (auto _ : state) {
+    auto chain = cpu::QuantizedMatMul(a, b, /*a_zero_point=*/128, &c, exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(m * n * state.iterations());
+}
+
+#define BM_QuantizedMatMul(threads, M, K, N)                             \
+  static void BM_QuantizedMatMul_##M##x##K##x##N##_tpool_##threads(      \
+      benchmark::State& state) {                                         \
+    QuantizedMatMul(state, threads, M, K, N);                            \
+  }                                                                      \
+  BENCHMARK(BM_QuantizedMatMul_##M##x##K##x##N##_tpool_##threads)
+
+BM_QuantizedMatMul(8, 1, 1024, 1024);
+BM_QuantizedMatMul(8, 8, 1024, 1024);
+BM_QuantizedMatMul(8, 32, 1024, 1024);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,177 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests and benchmarks for the random tensor kernels.
+
+#include "../../lib/kernels/random_kernels.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+TensorMetadata VectorMetadata(DType dtype, ssize_t size) {
+  return TensorMetadata(dtype, TensorShape(llvm::ArrayRef<ssize_t>(size)));
+}
+
+using RandomKernel = AsyncValueRef<Chain> (*)(uint64_t, uint64_t,
+                                              DenseHostTensor*,
+                                              const ExecutionContext&);
+
+DenseHostTensor Generate(RandomKernel kernel, DType dtype, ssize_t size,
+                         HostContext* host) {
+  auto dht =
+      DenseHostTensor::CreateUninitialized(VectorMetadata(dtype, size), host);
+  auto chain = kernel(42, 7, dht.getPointer(), CreateExecutionContext(host));
+  host->Await(chain.CopyRCRef());
+  EXPECT_FALSE(chain.IsError());
+  return std::move(dht.getValue());
+}
+
+template <typename T>
+void ExpectMoments(const DenseHostTensor& dht, double mean, double variance) {
+  const auto* data = static_cast<const T*>(dht.data());
+  double sum = 0, sum_squares = 0;
+  for (ssize_t i = 0; i < dht.NumElements(); ++i) {
+    sum += data[i];
+    sum_squares += static_cast<double>(data[i]) * data[i];
+  }
+  double actual_mean = sum / dht.NumElements();
+  EXPECT_NEAR(actual_mean, mean, 0.01);
+  EXPECT_NEAR(sum_squares / dht.NumElements() - actual_mean * actual_mean,
+              variance, 0.01);
+}
+
+// The values must not depend on the number of threads and the block sizes.
+TEST(RandomKernelsTest, Deterministic) {
+  auto host1 = CreateTestHostContext(1);
+  auto host4 = CreateTestHostContext(4);
+  for (RandomKernel kernel :
+       {cpu::RandomUniform, cpu::RandomNormal, cpu::TruncatedNormal}) {
+    for (DType dtype : {DType(DType::F32), DType(DType::F64)}) {
+      for (ssize_t size : {1, 2, 7, 1000, 100001}) {
+        auto expected = Generate(kernel, dtype, size, host1.get());
+        auto actual = Generate(kernel, dtype, size, host4.get());
+        EXPECT_EQ(std::memcmp(expected.data(), actual.data(),
+                              expected.DataSizeInBytes()),
+                  0)
+            << "size " << size;
+
+        // Smaller tensors are prefixes of larger ones.
+        auto prefix = Generate(kernel, dtype, size / 2, host4.get());
+        EXPECT_EQ(std::memcmp(prefix.data(), actual.data(),
+                              prefix.DataSizeInBytes()),
+                  0)
+            << "size " << size;
+      }
+    }
+  }
+}
+
+TEST(RandomKernelsTest, Uniform) {
+  auto host = CreateTestHostContext(4);
+  auto f32 =
+      Generate(cpu::RandomUniform, DType(DType::F32), 1 << 20, host.get());
+  for (float value : llvm::makeArrayRef(static_cast<const float*>(f32.data()),
+                                        f32.NumElements())) {
+    ASSERT_GE(value, 0.0f);
+    ASSERT_LT(value, 1.0f);
+  }
+  ExpectMoments<float>(f32, 0.5, 1.0 / 12);
+
+  auto f64 =
+      Generate(cpu::RandomUniform, DType(DType::F64), 1 << 20, host.get());
+  ExpectMoments<double>(f64, 0.5, 1.0 / 12);
+}
+
+TEST(RandomKernelsTest, Normal) {
+  auto host = CreateTestHostContext(4);
+  ExpectMoments<float>(
+      Generate(cpu::RandomNormal, DType(DType::F32), 1 << 20, host.get()), 0,
+      1);
+  ExpectMoments<double>(
+      Generate(cpu::RandomNormal, DType(DType::F64), 1 << 20, host.get()), 0,
+      1);
+}
+
+TEST(RandomKernelsTest, TruncatedNormal) {
+  auto host = CreateTestHostContext(4);
+  auto f32 =
+      Generate(cpu::TruncatedNormal, DType(DType::F32), 1 << 20, host.get());
+  for (float value : llvm::makeArrayRef(static_cast<const float*>(f32.data()),
+                                        f32.NumElements())) {
+    ASSERT_LT(std::abs(value), 2.0f);
+  }
+  // The variance of the standard normal distribution truncated to (-2, 2).
+  ExpectMoments<float>(f32, 0, 0.7737);
+}
+
+TEST(RandomKernelsTest, UnsupportedDType) {
+  auto host = CreateTestHostContext(1);
+  auto dht = DenseHostTensor::CreateUninitialized(
+      VectorMetadata(DType(DType::I32), 4), host.get());
+  auto chain = cpu::RandomUniform(42, 7, dht.getPointer(),
+                                  CreateExecutionContext(host.get()));
+  host->Await(chain.CopyRCRef());
+  EXPECT_TRUE(chain.IsError());
+}
+
+void BM_RandomKernel(benchmark::State& state, RandomKernel kernel) {
+  auto host = CreateTestHostContext(state.range(1));
+  auto exec_ctx = CreateExecutionContext(host.get());
+  auto dht = DenseHostTensor::CreateUninitialized(
+      VectorMetadata(DType(DType::F32), state.range(0)), host.get());
+  for (auto _ : state) {
+    auto chain = kernel(42, 7, dht.getPointer(), exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+  state.SetBytesProcessed(state.iterations() * dht->DataSizeInBytes());
+}
+
+BENCHMARK_CAPTURE(BM_RandomKernel, Uniform, cpu::RandomUniform)
+    ->ArgPair(1 << 20, 1)
+    ->ArgPair(1 << 20, 8);
+BENCHMARK_CAPTURE(BM_RandomKernel, Normal, cpu::RandomNormal)
+    ->ArgPair(1 << 20, 1)
+    ->ArgPair(1 << 20, 8);
+BENCHMARK_CAPTURE(BM_RandomKernel, TruncatedNormal, cpu::TruncatedNormal)
+    ->ArgPair(1 << 20, 1)
+    ->ArgPair(1 << 20, 8);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,213 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests and benchmarks for the parallel reduction and softmax kernels.
+
+#include "../../lib/kernels/reduction_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../../lib/kernels/softmax_kernel.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+using cpu::ReductionOp;
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+// Returns a tensor with the values 0, 1, 2, ... modulo 7.
+template <typename T>
+DenseHostTensor CreateTensor(llvm::ArrayRef<ssize_t> dims, HostContext* host) {
+  auto dht = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), TensorShape(dims)), host);
+  auto* data = static_cast<T*>(dht->data());
+  for (ssize_t i = 0; i < dht->NumElements(); ++i)
+    data[i] = static_cast<T>(i % 7);
+  return std::move(dht.getValue());
+}
+
+template <typename T>
+const T* Data(const DenseHostTensor& dht) {
+  return static_cast<const T*>(dht.data());
+}
+
+void Await(HostContext* host, AsyncValueRef<Chain> chain) {
+  host->Await(chain.CopyRCRef());
+  ASSERT_FALSE(chain.IsError());
+}
+
+TEST(ReductionKernelTest, MergesAdjacentDimensions) {
+  // [2, 3, 4] reduced along 0 and 2: rows of 4, then columns of [2, 3].
+  auto steps =
+      cpu::internal::GetReductionSteps({2, 3, 4}, {true, false, true});
+  ASSERT_EQ(steps.size(), 2);
+  EXPECT_EQ(steps[0].outer, 6);
+  EXPECT_EQ(steps[0].reduced, 4);
+  EXPECT_EQ(steps[0].inner, 1);
+  EXPECT_EQ(steps[1].outer, 1);
+  EXPECT_EQ(steps[1].reduced, 2);
+  EXPECT_EQ(steps[1].inner, 3);
+
+  // Adjacent reduced dimensions are one step, size 1 dimensions are ignored.
+  steps = cpu::internal::GetReductionSteps({5, 1, 2, 3},
+                                           {false, true, true, true});
+  ASSERT_EQ(steps.size(), 1);
+  EXPECT_EQ(steps[0].outer, 5);
+  EXPECT_EQ(steps[0].reduced, 6);
+  EXPECT_EQ(steps[0].inner, 1);
+}
+
+// Reduces [d0, d1, d2] along dimensions 0 and 2 and compares the result with
+// a reference computed in double.
+template <typename T>
+void TestReduceOuterAndInner(ReductionOp op, ssize_t d0, ssize_t d1,
+                             ssize_t d2) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto input = CreateTensor<T>({d0, d1, d2}, host.get());
+  auto output = CreateTensor<T>({d1}, host.get());
+  const int32_t reduction_indices[] = {0, 2};
+  Await(host.get(), cpu::Reduce<T>(op, input, reduction_indices, &output,
+                                   exec_ctx));
+
+  const T* in = Data<T>(input);
+  for (ssize_t j = 0; j < d1; ++j) {
+    double expected = op == ReductionOp::kMax ? -INFINITY : 0.0;
+    for (ssize_t i = 0; i < d0; ++i) {
+      for (ssize_t k = 0; k < d2; ++k) {
+        double value = in[(i * d1 + j) * d2 + k];
+        expected = op == ReductionOp::kMax ? std::max(expected, value)
+                                           : expected + value;
+      }
+    }
+    if (op == ReductionOp::kMean) expected /= d0 * d2;
+    EXPECT_NEAR(Data<T>(output)[j], expected, 1e-5 * std::abs(expected)) << j;
+  }
+}
+
+TEST(ReductionKernelTest, Float) {
+  for (auto op : {ReductionOp::kSum, ReductionOp::kMean, ReductionOp::kMax}) {
+    TestReduceOuterAndInner<float>(op, 3, 5, 7);
+    // The inner dimension of the second step is split into several blocks.
+    TestReduceOuterAndInner<float>(op, 2, 10000, 3);
+  }
+}
+
+TEST(ReductionKernelTest, Int32) {
+  for (auto op : {ReductionOp::kSum, ReductionOp::kMax})
+    TestReduceOuterAndInner<int32_t>(op, 3, 5, 7);
+}
+
+TEST(ReductionKernelTest, ReducesSizeOneDimension) {
+  auto host = CreateTestHostContext(1);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  auto input = CreateTensor<float>({4, 1}, host.get());
+  auto output = CreateTensor<float>({4}, host.get());
+  const int32_t reduction_indices[] = {1};
+  Await(host.get(), cpu::Reduce<float>(ReductionOp::kSum, input,
+                                       reduction_indices, &output, exec_ctx));
+  for (int i = 0; i < 4; ++i)
+    EXPECT_EQ(Data<float>(output)[i], Data<float>(input)[i]);
+}
+
+TEST(SoftmaxKernelTest, ParallelSoftmax) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  const ssize_t rows = 8, classes = 1001;
+  auto logits = CreateTensor<float>({rows, classes}, host.get());
+  auto softmax = CreateTensor<float>({rows, classes}, host.get());
+  auto log_softmax = CreateTensor<float>({rows, classes}, host.get());
+  Await(host.get(), cpu::ParallelSoftmax<false>(logits, &softmax, exec_ctx));
+  Await(host.get(), cpu::ParallelSoftmax<true>(logits, &log_softmax, exec_ctx));
+
+  const float* in = Data<float>(logits);
+  for (ssize_t r = 0; r < rows; ++r) {
+    double sum = 0.0;
+    for (ssize_t c = 0; c < classes; ++c) sum += std::exp(in[r * classes + c]);
+    for (ssize_t c = 0; c < classes; ++c) {
+      ssize_t i = r * classes + c;
+      double log_expected = in[i] - std::log(sum);
+      EXPECT_NEAR(Data<float>(softmax)[i], std::exp(log_expected),
+                  1e-5 * std::exp(log_expected));
+      EXPECT_NEAR(Data<float>(log_softmax)[i], log_expected, 1e-5);
+    }
+  }
+}
+
+void BM_Softmax(benchmark::State& state) {
+  auto host = CreateTestHostContext(8);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  const ssize_t rows = state.range(0), classes = state.range(1);
+  auto logits = CreateTensor<float>({rows, classes}, host.get());
+  auto softmax = CreateTensor<float>({rows, classes}, host.get());
+
+  for (auto _ : state) {
+    auto chain = cpu::ParallelSoftmax<false>(logits, &softmax, exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(rows * classes * state.iterations());
+}
+
+BENCHMARK(BM_Softmax)->Args({1, 50000})->Args({32, 50000})->Args({256, 1000});
+
+void BM_ReduceSum(benchmark::State& state) {
+  auto host = CreateTestHostContext(8);
+  auto exec_ctx = CreateExecutionContext(host.get());
+
+  const ssize_t rows = state.range(0), cols = state.range(1);
+  auto input = CreateTensor<float>({rows, cols}, host.get());
+  auto output = CreateTensor<float>({cols}, host.get());
+  const int32_t reduction_indices[] = {0};
+
+  for (auto _ : state) {
+    auto chain = cpu::Reduce<float>(ReductionOp::kSum, input,
+                                    reduction_indices, &output, exec_ctx);
+    host->Await(chain.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(rows * cols * state.iterations());
+}
+
+BENCHMARK(BM_ReduceSum)->Args({1024, 1024})->Args({32, 65536});
+
+}  // namespace
+}  // namespace tfrt
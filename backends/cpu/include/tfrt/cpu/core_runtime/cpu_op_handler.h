@@ -22,9 +22,12 @@
 
 #include <memory>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SetVector.h"
+#include "tfrt/core_runtime/op_dispatch_cache.h"
 #include "tfrt/core_runtime/op_handler.h"
 #include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/support/mutex.h"
 
 namespace tfrt {
 class CoreRuntime;
@@ -39,6 +42,7 @@ class CpuOpHandler : public OpHandler {
   Expected<CoreRuntimeOp> MakeOp(string_view op_name) override;
 
   RCReference<Device> GetDeviceRef() { return device_.CopyRef(); }
+  const RCReference<Device>& device() const { return device_; }
 
   void AddImplicitConversion(TensorType src, TensorType dst);
 
@@ -51,6 +55,14 @@ class CpuOpHandler : public OpHandler {
   llvm::SmallSetVector<TensorConversionFnRegistry::ConversionKey, 4>
       allowed_conversions;
 
+  // Returns the cache of the argument conversions of the op with `op_entry`,
+  // which is shared by all the CoreRuntimeOps made for the op.
+  ArgumentConversionCache* GetArgumentConversionCache(const void* op_entry);
+
+  mutex conversion_caches_mu_;
+  llvm::DenseMap<const void*, std::unique_ptr<ArgumentConversionCache>>
+      conversion_caches_ TFRT_GUARDED_BY(conversion_caches_mu_);
+
   friend llvm::Expected<CpuOpHandler*> CreateCpuOpHandler(
       CoreRuntime* runtime, RCReference<Device> device, OpHandler* fallback);
 
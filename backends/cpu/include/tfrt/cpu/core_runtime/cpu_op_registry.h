@@ -88,6 +88,15 @@ struct CpuOpFlags {
     // If this is set, the op dispatch function is prepared to deal with tensor
     // inputs in the TFRuntimeFallbackTensor format.
     AllowsTfRuntimeFallback = 1 << 5,
+
+    // If this is set, the op dispatch function is prepared to deal with tensor
+    // inputs in StridedHostTensor format.
+    AllowsStrided = 1 << 6,
+
+    // If this is set, the op dispatch function is prepared to deal with tensor
+    // inputs in CsrHostTensor format. Rank 2 CooHostTensor inputs are
+    // converted to CsrHostTensor.
+    AllowsCsr = 1 << 7,
   } flags;
 
   explicit CpuOpFlags() : flags(None) {}
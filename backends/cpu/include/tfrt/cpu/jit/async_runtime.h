@@ -22,6 +22,7 @@
 
 #include <cstddef>
 
+#include "llvm/ADT/FunctionExtras.h"
 #include "llvm/ADT/STLExtras.h"
 #include "mlir/ExecutionEngine/AsyncRuntime.h"
 #include "tfrt/host_context/async_dispatch.h"
@@ -75,9 +76,19 @@ class AsyncRuntime {
   void AwaitGroup(Group* group);
 
   // Execute the callable `f` on a thread managed by the runtime.
+  //
+  // The task is not enqueued immediately, but deferred in the caller thread
+  // until the next call to `Execute` (which enqueues it) or to
+  // `RunDeferredTasks` (which executes it inline). A parallel loop that
+  // launches N tasks enqueues N-1 of them, and executes the last one in the
+  // launching thread once it returns to the runtime or blocks in await.
   template <typename F>
   void Execute(F&& f);
 
+  // Executes tasks deferred by `Execute` in the caller thread. Must be called
+  // when the compiled kernel function or a resumed async task returns.
+  static void RunDeferredTasks();
+
   // Await operation that do not block the caller thread, but instead execute
   // the callable `F` when the token/group become ready.
   template <typename F>
@@ -96,8 +107,9 @@ class AsyncRuntime {
   // Extracts async value that is owned by the token.
   static AsyncValue* GetAsyncValue(Token* token);
 
-  // Extracts async values that are owned by the tokens added to the group.
-  static SmallVector<AsyncValue*, 4> GetAsyncValues(Group* group);
+  // Extracts async value that becomes available when all tokens added to the
+  // group are available. No tokens can be added to the group after that.
+  static AsyncValue* GetAsyncValue(Group* group);
 
   // Reference counting operations for the runtime objects.
   static void AddRef(AsyncRuntimeObject* obj, unsigned count = 1);
@@ -111,6 +123,8 @@ class AsyncRuntime {
   HostContext* host_context() const { return host_context_; }
 
  private:
+  void Defer(llvm::unique_function<void()> task);
+
   HostContext* host_context_;  // must outlive *this
 };
 
@@ -123,7 +137,7 @@ class AsyncRuntimeObject : public ::tfrt::ReferenceCounted<AsyncRuntimeObject> {
 
 template <typename F>
 void AsyncRuntime::Execute(F&& f) {
-  EnqueueWork(host_context_, std::forward<F>(f));
+  Defer(std::forward<F>(f));
 }
 
 template <typename F>
@@ -138,7 +152,7 @@ void AsyncRuntime::AwaitValue(Value* value, F&& f) {
 
 template <typename F>
 void AsyncRuntime::AwaitGroup(Group* group, F&& f) {
-  RunWhenReady(AsyncRuntime::GetAsyncValues(group), std::forward<F>(f));
+  AsyncRuntime::GetAsyncValue(group)->AndThen(std::forward<F>(f));
 }
 
 }  // namespace jit
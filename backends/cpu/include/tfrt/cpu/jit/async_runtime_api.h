@@ -61,6 +61,21 @@ void ExtractAsyncValue(
 llvm::orc::SymbolMap AsyncRuntimeApiSymbolMap(
     llvm::orc::MangleAndInterner mangle);
 
+// Allocates memory for the compiled kernels from the HostAllocator of the
+// current AsyncRuntime host context (or with AlignedAlloc if it is not set).
+// Memory must be released with `RuntimeFree`, which can be called from any
+// thread, even after the host context is no longer the current one.
+void* RuntimeAlignedAlloc(size_t alignment, size_t size);
+void RuntimeFree(void* ptr);
+
+// Builds a symbol map that binds the `malloc`, `aligned_alloc` and `free`
+// functions called by the compiled kernels (memref allocations and coroutine
+// frames) to the runtime allocation functions defined above. Buffers returned
+// from the kernels are owned by the HostAllocator, and can be passed to the
+// caller as HostBuffers without copying.
+llvm::orc::SymbolMap RuntimeAllocatorSymbolMap(
+    llvm::orc::MangleAndInterner mangle);
+
 }  // namespace jit
 }  // namespace cpu
 }  // namespace tfrt
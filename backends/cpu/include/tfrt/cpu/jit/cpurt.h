@@ -21,10 +21,18 @@
 #ifndef TFRT_BACKENDS_CPU_JIT_CPURT_H_
 #define TFRT_BACKENDS_CPU_JIT_CPURT_H_
 
+#include <chrono>
 #include <cstdint>
+#include <list>
 #include <memory>
+#include <string>
 #include <type_traits>
+#include <vector>
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
 #include "mlir/Dialect/Async/IR/AsyncTypes.h"
 #include "mlir/ExecutionEngine/ExecutionEngine.h"
 #include "mlir/IR/BuiltinTypes.h"
@@ -34,7 +42,9 @@
 #include "tfrt/cpu/jit/async_runtime.h"
 #include "tfrt/cpu/jit/async_runtime_api.h"
 #include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/resource_context.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/msan.h"
 
@@ -150,6 +160,10 @@ class JitExecutable;
 // function, and knows how to execute it, and return results to the caller.
 class Executable;
 
+namespace internal {
+class KernelStatsEntry;
+}  // namespace internal
+
 struct CompilationOptions {
   // Byte alignment for allocated memrefs. Depending on the compiler flags
   // Tensorflow requires tensors to be aligned on 16, 32 or 64 bytes.
@@ -165,6 +179,16 @@ struct CompilationOptions {
   // Disable recompilation for concrete input shapes or values.
   bool disable_specializations = false;
 
+  // The maximum number of specialized executables kept by a JitExecutable. The
+  // least recently used specializations are evicted when it is exceeded. Zero
+  // means that the number of specializations is not bounded.
+  int max_specializations = 64;
+
+  // Dimensions of operands that do not require a shape or value
+  // specialization are compiled as dynamic dimensions once they were seen with
+  // more than this number of different sizes. Zero disables this heuristic.
+  int max_dimension_sizes = 8;
+
   // Register dialects that are allowed in the serialized module.
   llvm::function_ref<void(mlir::DialectRegistry&)> register_dialects;
 
@@ -173,8 +197,47 @@ struct CompilationOptions {
   // Tensorflow use case this pipeline lowers from Tensorflow dialect down to
   // the Linalg on buffers via the MHLO->Linalg lowering.
   llvm::function_ref<void(mlir::OpPassManager&)> register_pass_pipeline;
+
+  // Directory of the persistent cache of compiled object files. If it is not
+  // empty, executables found in the cache are loaded without running the LLVM
+  // lowering, optimization and code generation, and compiled executables are
+  // added to it. Cache entries are keyed by the module after running the
+  // `register_pass_pipeline` (and the specialization to the operands), the
+  // entrypoint, the compilation options, the host CPU and the compiler
+  // version.
+  std::string object_cache_dir;
+
+  // Tiered compilation. If positive, executables compiled at runtime are first
+  // compiled without LLVM optimizations to reduce the latency of the first
+  // execution. Once an executable was executed this number of times, it is
+  // recompiled with the optimizations (and `jit_code_opt_level`) on the
+  // blocking work queue, and later executions call the optimized code.
+  // Executables found in the object cache are already optimized.
+  int tiered_compilation_threshold = 0;
+
+  // Shape bucketing of the entrypoints with the `cpurt.bucketed` attribute
+  // (see JitExecutable::kBucketed). The leading dimension of their operands is
+  // padded to the smallest of these sizes that is not smaller than it, so that
+  // operands of many different sizes share a few specializations. Sizes must
+  // be in ascending order. Dimensions larger than the largest size, or all
+  // dimensions if it is empty, are padded to the next power of two.
+  std::vector<ssize_t> bucket_sizes;
 };
 
+// Returns the object cache directory set by the TFRT_CPURT_OBJECT_CACHE_DIR
+// environment variable, or an empty string if it is not set.
+std::string GetObjectCacheDirFromEnv();
+
+// Returns the tiered compilation threshold set by the
+// TFRT_CPURT_TIERED_COMPILATION_THRESHOLD environment variable, or zero (no
+// tiered compilation) if it is not set.
+int GetTieredCompilationThresholdFromEnv();
+
+// Returns the bucket sizes set by the TFRT_CPURT_BUCKET_SIZES environment
+// variable as a comma separated list (e.g. "16,32,48,64"), or an empty list
+// (powers of two) if it is not set.
+std::vector<ssize_t> GetBucketSizesFromEnv();
+
 //----------------------------------------------------------------------------//
 // Types for passing compiled kernel arguments and passing back results.
 //----------------------------------------------------------------------------//
@@ -561,6 +624,9 @@ class Executable {
   struct ResultsMemoryLayout;
   struct CallFrame;
 
+  // Pointer to a compiled kernel function.
+  using KernelFunctionPtr = void (*)(void**);
+
   Executable(std::unique_ptr<mlir::MLIRContext> context,
              std::unique_ptr<mlir::ExecutionEngine> engine,
              mlir::FunctionType signature, string_view entrypoint,
@@ -573,6 +639,20 @@ class Executable {
     assert(fptr_ != nullptr && "entrypoint was not found");
   }
 
+  // Constructs an executable from the kernel function `fptr` of the object file
+  // loaded into the `jit`, e.g. from the persistent object cache.
+  Executable(std::unique_ptr<mlir::MLIRContext> context,
+             std::unique_ptr<llvm::orc::LLJIT> jit,
+             mlir::FunctionType signature, KernelFunctionPtr fptr,
+             ResultsMemoryLayout results_memory_layout)
+      : context_(std::move(context)),
+        jit_(std::move(jit)),
+        signature_(signature),
+        fptr_(fptr),
+        results_memory_layout_(std::move(results_memory_layout)) {
+    assert(fptr_ != nullptr && "entrypoint was not found");
+  }
+
   // Initializes call frame by adding all operands as pointers to arguments
   // vector. Also allocates storage for returned values, which are passed to the
   // compiled kernel as return value arguments.
@@ -600,6 +680,17 @@ class Executable {
 
   bool IsAsync() const { return results_memory_layout_.has_async_results; }
 
+  // Sets the statistics entry of the kernel that the executable was compiled
+  // from. Executions are recorded there if execution statistics are enabled.
+  void set_kernel_stats(internal::KernelStatsEntry* stats) { stats_ = stats; }
+
+  // Makes the executable, compiled without optimizations, recompile the
+  // `entrypoint` of the `mlir_module` with `opts` once it is hot (see
+  // CompilationOptions::tiered_compilation_threshold). The module must have
+  // the same signature, i.e. it must be specialized to the same operands.
+  void EnableTieredCompilation(string_view mlir_module, string_view entrypoint,
+                               const CompilationOptions& opts);
+
   // CallFrame provides a pointer-stable storage for packed function arguments
   // and storage for returned values.
   struct CallFrame {
@@ -638,14 +729,24 @@ class Executable {
       mlir::FunctionType signature);
 
  private:
-  // Pointer to a compiled kernel function.
-  using KernelFunctionPtr = void (*)(void**);
+  // State of the tiered compilation shared with the pending recompilation.
+  struct TieredCompilation;
+
+  // Returns the kernel function to call: the optimized function if the
+  // executable was recompiled, otherwise counts the execution and starts the
+  // recompilation when the executable becomes hot.
+  KernelFunctionPtr GetKernelFunction(const ExecutionContext& exec_ctx) const;
 
   std::unique_ptr<mlir::MLIRContext> context_;
+  // The compiled code is owned by the execution engine if the executable was
+  // compiled, or by the jit if it was loaded from an object file.
   std::unique_ptr<mlir::ExecutionEngine> engine_;
+  std::unique_ptr<llvm::orc::LLJIT> jit_;
   mlir::FunctionType signature_;
   KernelFunctionPtr fptr_;
   ResultsMemoryLayout results_memory_layout_;
+  internal::KernelStatsEntry* stats_ = nullptr;
+  std::shared_ptr<TieredCompilation> tiered_;  // null if not tiered
 };
 
 //----------------------------------------------------------------------------//
@@ -686,6 +787,14 @@ class JitExecutable {
  public:
   static constexpr const char* const kConstraint = "cpurt.constraint";
 
+  // Entrypoint attribute of the kernels that compute each row of their results
+  // from the same rows of their operands along the leading dimension, which
+  // all operands and results have. The `cpurt.execute` kernel pads the leading
+  // dimension of their operands with zero rows to the bucket size (see
+  // CompilationOptions::bucket_sizes), and slices the results back to the
+  // rows of the operands.
+  static constexpr const char* const kBucketed = "cpurt.bucketed";
+
   static Expected<JitExecutable> Instantiate(
       string_view mlir_module, string_view entrypoint,
       const CompilationOptions& compilation_opts);
@@ -703,16 +812,41 @@ class JitExecutable {
 
   // Returns an executable that may be specialized for the operands shape or
   // values. Can return default executable if no specialization is required, or
-  // specialized executable is not available.
+  // specialized executable is not available yet.
+  //
+  // Specialized executables are compiled asynchronously on the blocking work
+  // queue. While the compilation is in progress the default executable is
+  // returned if it exists, otherwise the returned async value becomes
+  // available when the compilation completes. Concurrent calls with operands
+  // that require the same specialization share a single compilation.
   //
   // Returns an error if compilation of the specialized executable failed, and
   // does not fallback on the default executable, because it must mean that the
   // default executable will fail at runtime.
-  //
-  // TODO(ezhulenev): This function should return AsyncValueRef<Executable*>
-  // because if default executable is not available, re-compilation should not
-  // block the caller thread.
-  Expected<const Executable*> GetExecutable(ArrayRef<MemrefDesc> operands);
+  AsyncValueRef<Executable> GetExecutable(ArrayRef<MemrefDesc> operands,
+                                          const ExecutionContext& exec_ctx);
+
+  struct SpecializationStats {
+    // The number of GetExecutable() calls that found the specialization in the
+    // cache (including pending compilations), or that had to compile it.
+    uint64_t num_hits = 0;
+    uint64_t num_misses = 0;
+    // The number of specializations evicted from the cache.
+    uint64_t num_evictions = 0;
+    // The number of operand dimensions that are no longer specialized.
+    uint64_t num_dynamic_dimensions = 0;
+    // The total time spent compiling specializations.
+    uint64_t compile_time_us = 0;
+  };
+
+  SpecializationStats GetSpecializationStats() const;
+
+  // Returns true if the entrypoint has the `cpurt.bucketed` attribute.
+  bool IsBucketed() const { return bucketed_; }
+
+  // Returns the size that the leading dimension of the operands of a bucketed
+  // entrypoint is padded to.
+  ssize_t GetBucketSize(ssize_t size) const;
 
   // JitExecutable is move-only type.
   JitExecutable(const JitExecutable&) = delete;
@@ -722,29 +856,34 @@ class JitExecutable {
   JitExecutable(string_view mlir_module, string_view entrypoint,
                 CompilationOptions compilation_opts,
                 ArrayRef<OperandConstraint> constraints,
-                Optional<Executable> default_executable = {});
-
-  // We do not use Expected<Executable> here because we need a mechanism to
-  // copy an error, and this is not possible using the Expected API.
-  struct ExecutableOrError {
-    explicit ExecutableOrError(Error error)
-        : error(std::move(error)), executable(llvm::None) {}
-    explicit ExecutableOrError(Executable executable)
-        : error(Error::success()), executable(std::move(executable)) {}
-
-    Error error;
-    Optional<Executable> executable;
+                internal::KernelStatsEntry* stats,
+                AsyncValueRef<Executable> default_executable = {});
+
+  // Sizes of an operand dimension that were seen by specializations.
+  struct DimensionSizes {
+    llvm::SmallDenseSet<ssize_t, 4> sizes;
+    bool dynamic = false;  // true if it is no longer specialized
   };
 
   // Because mutex is not copyable or movable keep specialized executables map
-  // guarded by a mutex on the heap in a dedicated struct.
+  // guarded by a mutex on the heap in a dedicated struct. It is shared with the
+  // pending compilations that update the stats.
   struct Specializations {
+    // Specialized executables, or compilation errors, are shared through async
+    // values, which are unavailable while the compilation is in progress. The
+    // list is ordered from the most to the least recently used.
+    using LruList =
+        std::list<std::pair<std::string, AsyncValueRef<Executable>>>;
+
     tfrt::mutex mu;
-    // TODO(ezhulenev): Select a different type of key, that would completely
-    // eliminate the possibility of a hash collision (currently it is zero for
-    // all practical purposes, but in theory it is still possible).
-    llvm::DenseMap<llvm::hash_code, ExecutableOrError> executables
+    LruList lru TFRT_GUARDED_BY(mu);
+    // Executables keyed by the operands shapes and values they are specialized
+    // to (see SpecializationKey() in cpurt.cc).
+    llvm::StringMap<LruList::iterator> executables TFRT_GUARDED_BY(mu);
+    // Sizes of the operands dimensions, indexed by the operand and dimension.
+    llvm::SmallVector<llvm::SmallVector<DimensionSizes, 4>> dimensions
         TFRT_GUARDED_BY(mu);
+    SpecializationStats stats TFRT_GUARDED_BY(mu);
   };
 
   std::string mlir_module_;
@@ -759,29 +898,156 @@ class JitExecutable {
   // `kResolved`.
   llvm::SmallVector<OperandConstraint> constraints_;
 
-  // Default executable that was not specialized to any of the arguments.
-  Optional<Executable> default_executable_;
+  // Default executable that was not specialized to any of the arguments, or
+  // null if the module must be specialized to be compiled.
+  AsyncValueRef<Executable> default_executable_;
 
   // Executables specialized for the arguments shapes or/and values.
-  std::unique_ptr<Specializations> specializations_;
+  std::shared_ptr<Specializations> specializations_;
+
+  // Statistics of the kernel shared by all the compiled executables.
+  internal::KernelStatsEntry* stats_;
+
+  // True if the entrypoint has the `cpurt.bucketed` attribute. Executables
+  // compiled ahead of time are never bucketed.
+  bool bucketed_ = false;
+};
+
+//----------------------------------------------------------------------------//
+// Compilation and execution statistics of the compiled kernels.
+//----------------------------------------------------------------------------//
+
+// The time spent compiling and executing a kernel, aggregated for all the
+// executables (default and specialized) compiled from the same module. The
+// statistics are kept for the lifetime of the process. The compilation phases
+// are also recorded in the histograms
+// "/tfrt/cpu/jit/compile_phase_time_ms/<phase>", and the executions in the
+// histograms "/tfrt/cpu/jit/kernel_execute_time_us/<kernel name>".
+struct KernelStats {
+  // The entrypoint function followed by a fingerprint of the module source,
+  // e.g. "main@0123abcd".
+  std::string name;
+
+  // The number of compiled executables, and the time spent in each phase of
+  // the compilation pipeline (including failed compilations).
+  int64_t num_compilations = 0;
+  std::chrono::nanoseconds specialize_time{0};      // operands specialization
+  std::chrono::nanoseconds lower_to_cpurt_time{0};  // `register_pass_pipeline`
+  std::chrono::nanoseconds lower_to_llvm_time{0};   // lowering to LLVM dialect
+  std::chrono::nanoseconds optimize_time{0};        // LLVM optimization passes
+  std::chrono::nanoseconds codegen_time{0};         // LLVM IR and machine code
+
+  // The number of executions, the time spent in the compiled function and the
+  // time spent converting its results. Only recorded while execution
+  // statistics are enabled.
+  int64_t num_executions = 0;
+  std::chrono::nanoseconds execute_time{0};
+  std::chrono::nanoseconds return_results_time{0};
+
+  std::chrono::nanoseconds compile_time() const {
+    return specialize_time + lower_to_cpurt_time + lower_to_llvm_time +
+           optimize_time + codegen_time;
+  }
 };
 
+// Enables recording of the kernel executions. Compilations are always
+// recorded, but the executions are not by default, because reading the clock
+// is not free compared to the small kernels.
+void EnableKernelExecutionStats(bool enable);
+
+// Returns the statistics of all the kernels compiled in this process, in
+// decreasing order of the total compilation and execution time.
+std::vector<KernelStats> GetKernelStats();
+
+// Prints the statistics returned by GetKernelStats() as a table.
+void PrintKernelStats(raw_ostream& os);
+
+//----------------------------------------------------------------------------//
+// Default executables compiled ahead of time into BEF files.
+//----------------------------------------------------------------------------//
+
+// The BEF converter can compile the default executables of the modules passed
+// to the compile kernels ahead of time, and store them in the native objects
+// section of the BEF file (see BEFNativeObjectCompiler). BEFFile::Open loads
+// them with LoadAotExecutable, and JitExecutable::Instantiate uses them instead
+// of parsing and compiling the module.
+
+// The kind of the BEF native objects with executables compiled ahead of time.
+constexpr const char* const kAotExecutableKind = "cpurt";
+
+// Returns the key of the executable compiled ahead of time for the
+// `entrypoint` of the serialized `mlir_module`.
+std::string GetAotExecutableKey(string_view mlir_module,
+                                string_view entrypoint);
+
+// Compiles the default executable of the `entrypoint` of the `mlir_module` for
+// the host CPU, and returns the native object to load with LoadAotExecutable.
+// Returns None if the module must be specialized to the operands, because it
+// has no default executable.
+Expected<Optional<std::string>> CompileAotExecutable(
+    string_view mlir_module, string_view entrypoint,
+    const CompilationOptions& compilation_opts);
+
+// Loads the native object returned by CompileAotExecutable, and registers the
+// executable with the `key`. Returns an error if the object was compiled by
+// another compiler version or for another CPU.
+Error LoadAotExecutable(string_view key, ArrayRef<uint8_t> data);
+
 //----------------------------------------------------------------------------//
 // Cache all JitExecutables in the resource context owned by the host.
 //----------------------------------------------------------------------------//
 
+// JitExecutableCache maps the compile kernels to their JitExecutables. Kernels
+// are identified by their location in the BEF file. The lookup is lock-free,
+// because it runs on every execution of the compile kernels.
+//
+// JitExecutables are shared with the caches of all the host contexts in the
+// process. They are keyed by the content of the module, the entrypoint and the
+// compilation options, so a module reloaded or executed by multiple host
+// contexts is compiled only once. A shared JitExecutable is released when the
+// last cache that uses it is destroyed. Compiled object files can be shared
+// across processes with the persistent object cache (see CompilationOptions).
 class JitExecutableCache {
  public:
-  explicit JitExecutableCache(HostContext* host) : host_(host) {}
-  AsyncValueRef<JitExecutable> Find(intptr_t key) const;
-  AsyncValueRef<JitExecutable> Insert(intptr_t key,
-                                      JitExecutable jit_executable);
+  JitExecutableCache();
+  ~JitExecutableCache();
+
+  // The slot of the cache in the ResourceContext, which kernels look up on
+  // every invocation.
+  static const ResourceSlot<JitExecutableCache>& GetResourceSlot();
+
+  // Returns the JitExecutable of the kernel at `location`, or null if it was
+  // not instantiated yet.
+  AsyncValueRef<JitExecutable> Find(intptr_t location) const;
+
+  // Returns the JitExecutable of the kernel at `location`, that executes the
+  // `entrypoint` of the `mlir_module`. Instantiates it with `opts` if it is
+  // not shared by another cache. Modules compiled with `register_dialects` or
+  // `register_pass_pipeline` callbacks are not shared, because the callbacks
+  // can't be compared.
+  Expected<AsyncValueRef<JitExecutable>> GetOrInstantiate(
+      intptr_t location, string_view mlir_module, string_view entrypoint,
+      const CompilationOptions& opts);
 
  private:
-  HostContext* host_;
+  struct Slot;
+
+  // Caches the `jit_executable` at `location`, and returns it.
+  AsyncValueRef<JitExecutable> Insert(
+      intptr_t location, AsyncValueRef<JitExecutable> jit_executable)
+      TFRT_REQUIRES(mu_);
+
+  // Fixed size open addressing hash table from the locations to the
+  // JitExecutables. Slots are only written under the mutex, and are never
+  // removed, so that Find() can read them without a lock.
+  std::unique_ptr<Slot[]> slots_;
+
   mutable tfrt::mutex mu_;
-  llvm::DenseMap<intptr_t, AsyncValueRef<JitExecutable>> cache_
+  // JitExecutables that did not fit into the slots.
+  llvm::DenseMap<intptr_t, AsyncValueRef<JitExecutable>> overflow_
       TFRT_GUARDED_BY(mu_);
+  // Keys of the shared JitExecutables used by this cache.
+  std::vector<std::string> shared_keys_ TFRT_GUARDED_BY(mu_);
 };
 
 }  // namespace jit
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the translation from MLIR to BEF with the CPURT kernels
+// compiled ahead of time.
+
+#ifndef TFRT_BACKENDS_CPU_JIT_CPURT_AOT_TRANSLATE_H_
+#define TFRT_BACKENDS_CPU_JIT_CPURT_AOT_TRANSLATE_H_
+
+#include "tfrt/support/forward_decls.h"
+
+namespace mlir {
+class ModuleOp;
+struct LogicalResult;
+}  // namespace mlir
+
+namespace tfrt {
+namespace cpu {
+namespace jit {
+
+// Converts `module` to BEF like MLIRToBEFTranslate, and compiles the default
+// executables of the modules passed to the CPURT compile kernels for the host
+// CPU into the native objects section.
+mlir::LogicalResult MLIRToBEFCpurtAotTranslate(mlir::ModuleOp module,
+                                               llvm::raw_ostream& output);
+
+}  // namespace jit
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_JIT_CPURT_AOT_TRANSLATE_H_
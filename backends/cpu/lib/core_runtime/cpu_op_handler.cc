@@ -21,16 +21,21 @@
 #include "tfrt/core_runtime/core_runtime.h"
 #include "tfrt/core_runtime/dispatch_utils.h"
 #include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_dispatch_cache.h"
 #include "tfrt/core_runtime/op_invocation.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/device.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/support/logging.h"
+#include "tfrt/tensor/conversion_registry.h"
 #include "tfrt/tensor/coo_host_tensor.h"
+#include "tfrt/tensor/csr_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/host_tensor.h"
+#include "tfrt/tensor/packed_string_host_tensor.h"
 #include "tfrt/tensor/scalar_host_tensor.h"
+#include "tfrt/tensor/strided_host_tensor.h"
 #include "tfrt/tensor/string_host_tensor.h"
 #include "tfrt/tensor/tensor_type_registration.h"
 
@@ -57,6 +62,18 @@ TensorType ArgumentTensorType(const Tensor& t, const CpuOpFlags& flags) {
     if (t.IsTensorType(type)) return type;
   }
 
+  if (flags & CpuOpFlags::AllowsCsr) {
+    auto type = CsrHostTensor::kTensorType;
+    if (t.IsTensorType(type)) return type;
+    if (t.IsTensorType(CooHostTensor::kTensorType) && t.shape().GetRank() == 2)
+      return type;
+  }
+
+  if (flags & CpuOpFlags::AllowsStrided) {
+    auto type = StridedHostTensor::kTensorType;
+    if (t.IsTensorType(type)) return type;
+  }
+
   if (flags & CpuOpFlags::AllowsString) {
     auto type = StringHostTensor::kTensorType;
     if (t.IsTensorType(type)) return type;
@@ -83,35 +100,97 @@ TensorType ArgumentTensorType(const Tensor& t, const CpuOpFlags& flags) {
   return result;
 }
 
+// Resolves how an argument with the tensor type, dtype and device in `key`
+// is converted for an op with `flags`. The device must be the device of
+// `op_handler`.
+ArgumentConversionCache::Entry ResolveArgumentConversion(
+    HostContext* host, const CpuOpFlags& flags, CpuOpHandler* op_handler,
+    const Tensor& tensor, const ArgumentConversionCache::Key& key) {
+  ArgumentConversionCache::Entry entry;
+  entry.key = key;
+  entry.dst_tensor_type = ArgumentTensorType(tensor, flags);
+  entry.allowed = entry.IsNoOp() || op_handler->AllowImplicitConversion(
+                                        key.tensor_type, entry.dst_tensor_type);
+  entry.conversion_fn =
+      entry.IsNoOp() || !entry.allowed
+          ? nullptr
+          : GetTensorConversionFn(host, key.tensor_type, entry.dst_tensor_type);
+  return entry;
+}
+
+// Returns the cached conversion of `tensor` on `device`, resolving and caching
+// it on a miss. Returns the resolved entry in `uncached` if the cache is full.
+const ArgumentConversionCache::Entry& LookupArgumentConversion(
+    HostContext* host, const CpuOpFlags& flags, CpuOpHandler* op_handler,
+    ArgumentConversionCache* cache, const Tensor& tensor, const Device& device,
+    ArgumentConversionCache::Entry* uncached) {
+  ArgumentConversionCache::Key key{tensor.tensor_type(), tensor.dtype(),
+                                   &device};
+  if (const auto* entry = cache->Lookup(key)) return *entry;
+  *uncached = ResolveArgumentConversion(host, flags, op_handler, tensor, key);
+  if (const auto* entry = cache->Insert(*uncached)) return *entry;
+  return *uncached;
+}
+
+RCReference<ErrorAsyncValue> EmitImplicitConversionError(
+    const ExecutionContext& exec_ctx, const Tensor& tensor,
+    const ArgumentConversionCache::Entry& conversion) {
+  return EmitErrorAsync(
+      exec_ctx, tfrt::StrCat("Cannot implictly convert ",
+                             tensor.tensor_type().name(), " to ",
+                             conversion.dst_tensor_type.name()));
+}
+
+// Converts the available `tensor` as described by the allowed `conversion`.
+AsyncValueRef<Tensor> ConvertArgumentTensor(
+    const ExecutionContext& exec_ctx, const Tensor& tensor,
+    const Device& device, const ArgumentConversionCache::Entry& conversion) {
+  assert(conversion.allowed);
+  // ConvertTensor() emits the error for a missing conversion function.
+  if (!conversion.conversion_fn)
+    return ConvertTensor(exec_ctx, tensor, device, device,
+                         conversion.dst_tensor_type);
+  return conversion.conversion_fn(tensor, device, device, exec_ctx);
+}
+
 TensorHandle MaybeConvertArgument(const ExecutionContext& exec_ctx,
                                   const CpuOpFlags& flags,
-                                  CpuOpHandler* op_handler, TensorHandle arg) {
+                                  CpuOpHandler* op_handler,
+                                  ArgumentConversionCache* cache,
+                                  TensorHandle arg) {
   if (arg.IsError()) return arg;
-  RCReference<Device> device = op_handler->GetDeviceRef();
 
   if (arg.GetAsyncTensor()->IsAvailable() && arg.IsDeviceAvailable()) {
+    const RCReference<Device>& device = arg.GetAvailableDevice();
     // We does not support implicit tensor conversion across device.
-    if (device.get() != arg.GetAvailableDevice().get()) {
+    if (device.get() != op_handler->device().get()) {
       // TODO(b/172847467): Return error tensor here instead of a slient
       // warning. This cannot be done currently as it will break existing GPU
       // tests.
       TFRT_LOG(WARNING) << "Cannot implictly convert from device "
-                        << arg.GetAvailableDevice()->name() << " to "
-                        << device->name();
+                        << device->name() << " to "
+                        << op_handler->device()->name();
       return arg;
     }
     auto& tensor = arg.GetAsyncTensor()->get<Tensor>();
-    auto target_type = ArgumentTensorType(tensor, flags);
-    if (target_type == tensor.tensor_type()) return arg;
-    if (!op_handler->AllowImplicitConversion(tensor.tensor_type(),
-                                             target_type)) {
-      return TensorHandle(EmitErrorAsync(
-          exec_ctx,
-          tfrt::StrCat("Cannot implictly convert ", tensor.tensor_type().name(),
-                       " to ", target_type.name())));
+    ArgumentConversionCache::Entry uncached;
+    const auto& conversion = LookupArgumentConversion(
+        exec_ctx.host(), flags, op_handler, cache, tensor, *device, &uncached);
+    if (conversion.IsNoOp()) return arg;
+    if (!conversion.allowed)
+      return TensorHandle(
+          EmitImplicitConversionError(exec_ctx, tensor, conversion));
+    auto result_tensor =
+        ConvertArgumentTensor(exec_ctx, tensor, *device, conversion);
+    if (arg.IsMetadataAvailable()) {
+      return TensorHandle(device.CopyRef(), arg.GetAvailableMetadata(),
+                          std::move(result_tensor));
+    } else {
+      return TensorHandle(device.CopyRef(), arg.GetAsyncMetadata().CopyRef(),
+                          std::move(result_tensor));
     }
-    return arg.TransferTo(exec_ctx, op_handler->GetDeviceRef(), target_type);
   } else {
+    RCReference<Device> device = op_handler->GetDeviceRef();
     RCReference<IndirectAsyncValue> result_ind_av =
         MakeIndirectAsyncValue(exec_ctx.host());
     SmallVector<AsyncValue*, 2> async_values;
@@ -122,7 +201,7 @@ TensorHandle MaybeConvertArgument(const ExecutionContext& exec_ctx,
     RunWhenReady(
         async_values,
         [exec_ctx, arg = arg.CopyRef(), result_ind_av = result_ind_av.CopyRef(),
-         device = device.CopyRef(), op_handler, flags]() mutable {
+         device = device.CopyRef(), op_handler, cache, flags]() mutable {
           if (arg.IsDeviceError()) {
             result_ind_av->ForwardTo(arg.GetAsyncDevice().CopyRCRef());
             return;
@@ -143,21 +222,21 @@ TensorHandle MaybeConvertArgument(const ExecutionContext& exec_ctx,
             return;
           }
           auto& arg_tensor = arg.GetAsyncTensor()->get<Tensor>();
-          auto target_type = ArgumentTensorType(arg_tensor, flags);
-          if (target_type == arg_tensor.tensor_type()) {
+          ArgumentConversionCache::Entry uncached;
+          const auto& conversion =
+              LookupArgumentConversion(exec_ctx.host(), flags, op_handler,
+                                       cache, arg_tensor, *device, &uncached);
+          if (conversion.IsNoOp()) {
             result_ind_av->ForwardTo(FormRef(arg.GetAsyncTensor()));
             return;
           }
-          if (!op_handler->AllowImplicitConversion(arg_tensor.tensor_type(),
-                                                   target_type)) {
-            result_ind_av->ForwardTo(EmitErrorAsync(
-                exec_ctx, tfrt::StrCat("Cannot implictly convert ",
-                                       arg_tensor.tensor_type().name(), " to ",
-                                       target_type.name())));
+          if (!conversion.allowed) {
+            result_ind_av->ForwardTo(
+                EmitImplicitConversionError(exec_ctx, arg_tensor, conversion));
             return;
           }
-          result_ind_av->ForwardTo(ConvertTensor(exec_ctx, arg_tensor, *device,
-                                                 *device, target_type));
+          result_ind_av->ForwardTo(
+              ConvertArgumentTensor(exec_ctx, arg_tensor, *device, conversion));
         });
 
     if (arg.IsMetadataAvailable()) {
@@ -170,12 +249,26 @@ TensorHandle MaybeConvertArgument(const ExecutionContext& exec_ctx,
   }
 }
 
+// The parts of a CpuOpEntry used to dispatch an op. Unlike CpuOpEntry, it is
+// cheap to copy for each invocation.
+struct CpuOpDispatchEntry {
+  explicit CpuOpDispatchEntry(const CpuOpEntry& op_entry)
+      : metadata_fn(op_entry.metadata_fn),
+        dispatch_fn(op_entry.dispatch_fn),
+        op_name(op_entry.op_name) {}
+
+  OpMetadataFn metadata_fn;
+  CpuDispatchFn dispatch_fn;
+  string_view op_name;
+};
+
 struct CpuOpHandlerTraits {
   using InputTensorTy = AsyncValue;
-  using OpEntryTy = CpuOpEntry;
+  using OpEntryTy = CpuOpDispatchEntry;
   using OpHandlerInfoTy = CpuOpHandler*;
 
-  static void Dispatch(const CpuOpEntry& op_entry, CpuOpHandler* cpu_op_handler,
+  static void Dispatch(const CpuOpDispatchEntry& op_entry,
+                       CpuOpHandler* cpu_op_handler,
                        ArrayRef<AsyncValue*> inputs, const OpAttrsRef& attrs,
                        ArrayRef<TensorMetadata> result_mds,
                        MutableArrayRef<RCReference<AsyncValue>> results,
@@ -211,6 +304,14 @@ llvm::Expected<CpuOpHandler*> CreateCpuOpHandler(CoreRuntime* runtime,
                                             DenseHostTensor::kTensorType);
   cpu_op_handler_ptr->AddImplicitConversion(CooHostTensor::kTensorType,
                                             DenseHostTensor::kTensorType);
+  cpu_op_handler_ptr->AddImplicitConversion(StridedHostTensor::kTensorType,
+                                            DenseHostTensor::kTensorType);
+  cpu_op_handler_ptr->AddImplicitConversion(CsrHostTensor::kTensorType,
+                                            DenseHostTensor::kTensorType);
+  cpu_op_handler_ptr->AddImplicitConversion(CooHostTensor::kTensorType,
+                                            CsrHostTensor::kTensorType);
+  cpu_op_handler_ptr->AddImplicitConversion(
+      PackedStringHostTensor::kTensorType, StringHostTensor::kTensorType);
 
   return cpu_op_handler_ptr;
 }
@@ -235,10 +336,12 @@ Expected<CoreRuntimeOp> CpuOpHandler::MakeOp(string_view op_name) {
   // fallback OpHandler.
   if (op_entry->dispatch_fn == nullptr) return GetFallback()->MakeOp(op_name);
 
+  ArgumentConversionCache* cache = GetArgumentConversionCache(op_entry);
+
   // NOTE(fishx): To avoid introducing an extra heap allocation, we need to
   // ensure that the size of captured variable is smaller than 3 pointers.
   return CoreRuntimeOp(
-      [op_entry, this](const OpInvocation& invocation) {
+      [op_entry, this, cache](const OpInvocation& invocation) {
         // CPU OpHandler should associate a CPU device.
         assert(this->device_);
         bool update_chain = !(op_entry->flags & CpuOpFlags::NoSideEffects);
@@ -246,17 +349,25 @@ Expected<CoreRuntimeOp> CpuOpHandler::MakeOp(string_view op_name) {
         // Convert the argument tensors if needed.
         for (auto& argument : invocation.arguments) {
           argument = MaybeConvertArgument(invocation.exec_ctx, op_entry->flags,
-                                          this, std::move(argument));
+                                          this, cache, std::move(argument));
         }
 
         // TODO(fishx): ExecuteOnOpHandler should return void.
-        ExecuteOnOpHandler<CpuOpHandlerTraits>(update_chain, invocation,
-                                               *op_entry, this);
+        ExecuteOnOpHandler<CpuOpHandlerTraits>(
+            update_chain, invocation, CpuOpDispatchEntry(*op_entry), this);
       },
       /*is_fallback=*/false, /*device=*/device_.CopyRef(),
       /*arg_tensor_type=*/DenseHostTensor::kTensorType);
 }
 
+ArgumentConversionCache* CpuOpHandler::GetArgumentConversionCache(
+    const void* op_entry) {
+  mutex_lock lock(conversion_caches_mu_);
+  auto& cache = conversion_caches_[op_entry];
+  if (!cache) cache = std::make_unique<ArgumentConversionCache>();
+  return cache.get();
+}
+
 void CpuOpHandler::AddImplicitConversion(TensorType src, TensorType dst) {
   allowed_conversions.insert({src, dst});
 }
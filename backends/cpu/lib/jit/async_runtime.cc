@@ -17,10 +17,13 @@
 
 #include "tfrt/cpu/jit/async_runtime.h"
 
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <type_traits>
+#include <vector>
 
+#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/chain.h"
@@ -28,7 +31,6 @@
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_buffer.h"
-#include "tfrt/support/concurrent_vector.h"
 #include "tfrt/support/ref_count.h"
 
 // -------------------------------------------------------------------------- //
@@ -47,7 +49,61 @@ using tfrt::RCReference;
 using tfrt::cpu::jit::AsyncRuntime;
 using tfrt::cpu::jit::AsyncRuntimeObject;
 
-class AsyncToken : public AsyncRuntimeObject {
+namespace {
+// Parallel loops create and destroy thousands of async tokens. Memory of the
+// destroyed objects of type T is kept in a per-thread free list, and reused by
+// the objects created later in the same thread.
+template <typename T>
+class PooledAllocation {
+ public:
+  static void* operator new(size_t size) {
+    assert(size == sizeof(T) && "pooled allocation of a derived type");
+    FreeList& free_list = GetFreeList();
+    if (free_list_destroyed || free_list.blocks.empty())
+      return ::operator new(size);
+    void* ptr = free_list.blocks.back();
+    free_list.blocks.pop_back();
+    return ptr;
+  }
+
+  static void operator delete(void* ptr) {
+    // Objects can be destroyed by the thread local destructors when a thread
+    // exits, after the free list was destroyed.
+    if (!free_list_destroyed) {
+      FreeList& free_list = GetFreeList();
+      if (free_list.blocks.size() < kMaxPooled) {
+        free_list.blocks.push_back(ptr);
+        return;
+      }
+    }
+    ::operator delete(ptr);
+  }
+
+ private:
+  static constexpr size_t kMaxPooled = 1024;
+
+  struct FreeList {
+    ~FreeList() {
+      free_list_destroyed = true;
+      for (void* ptr : blocks) ::operator delete(ptr);
+    }
+    std::vector<void*> blocks;
+  };
+
+  static FreeList& GetFreeList() {
+    static thread_local FreeList free_list;
+    return free_list;
+  }
+
+  static thread_local bool free_list_destroyed;
+};
+
+template <typename T>
+thread_local bool PooledAllocation<T>::free_list_destroyed = false;
+}  // namespace
+
+class AsyncToken : public AsyncRuntimeObject,
+                   public PooledAllocation<AsyncToken> {
  public:
   explicit AsyncToken(HostContext* host, unsigned ref_count = 1)
       : AsyncRuntimeObject(ref_count),
@@ -109,40 +165,49 @@ class AsyncValue : public AsyncRuntimeObject {
   AsyncValueRef<Storage> storage_;
 };
 
+// Async group counts the pending tokens instead of keeping them, and becomes
+// available when it is awaited and all the added tokens are available. Async
+// lowering awaits the group once all the tokens are added to it.
 class AsyncGroup : public AsyncRuntimeObject {
-  using AsyncTokens = tfrt::ConcurrentVector<AsyncToken*>;
-
  public:
-  explicit AsyncGroup(AsyncRuntime* runtime, unsigned ref_count = 1)
+  explicit AsyncGroup(HostContext* host, unsigned ref_count = 1)
       : AsyncRuntimeObject(ref_count),
-        runtime_(runtime),
-        async_tokens_(std::make_unique<AsyncTokens>(/*initial_capacity=*/16)) {}
-
-  ~AsyncGroup() override {
-    for (auto* obj : async_tokens_->ToArrayRef()) runtime_->DropRef(obj);
-  }
+        completed_(MakeConstructedAsyncValueRef<tfrt::Chain>(host)) {}
 
   size_t AddToken(AsyncToken* token) {
-    AsyncRuntime::AddRef(token);  // keep token alive while *this is alive
-    return async_tokens_->emplace_back(token);
-  }
+    assert(!sealed_ && "can't add tokens to the awaited group");
+    size_t rank = rank_.fetch_add(1, std::memory_order_relaxed);
 
-  size_t size() const { return async_tokens_->size(); }
+    tfrt::AsyncValue* value = token->GetAsyncValue();
+    if (value->IsAvailable()) return rank;
 
-  llvm::SmallVector<tfrt::AsyncValue*, 4> GetAsyncValues() const {
-    auto tokens = llvm::map_range(
-        async_tokens_->ToArrayRef(),
-        [](AsyncToken* token) { return token->GetAsyncValue(); });
-    return {tokens.begin(), tokens.end()};
+    // Keep *this alive until the token becomes available.
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    AddRef();
+    value->AndThen([this]() {
+      DropPending();
+      DropRef();
+    });
+
+    return rank;
   }
 
-  llvm::ArrayRef<AsyncToken*> GetAsyncTokens() const {
-    return async_tokens_->ToArrayRef();
+  tfrt::AsyncValue* GetAsyncValue() {
+    if (!sealed_.exchange(true)) DropPending();
+    return completed_.GetAsyncValue();
   }
 
  private:
-  AsyncRuntime* runtime_;
-  std::unique_ptr<AsyncTokens> async_tokens_;
+  void DropPending() {
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      completed_.SetStateConcrete();
+  }
+
+  std::atomic<size_t> rank_{0};
+  std::atomic<bool> sealed_{false};
+  // Tokens that are not available yet, plus one until the group is awaited.
+  std::atomic<size_t> pending_{1};
+  AsyncValueRef<tfrt::Chain> completed_;
 };
 
 }  // namespace runtime
@@ -166,9 +231,8 @@ namespace jit {
   return token->GetAsyncValue();
 }
 
-/*static*/ SmallVector<AsyncValue*, 4> AsyncRuntime::GetAsyncValues(
-    AsyncRuntime::Group* group) {
-  return group->GetAsyncValues();
+/*static*/ AsyncValue* AsyncRuntime::GetAsyncValue(AsyncRuntime::Group* group) {
+  return group->GetAsyncValue();
 }
 
 /*static*/ void AsyncRuntime::AddRef(AsyncRuntimeObject* obj, unsigned count) {
@@ -213,6 +277,7 @@ void AsyncRuntime::SetAvailable(AsyncRuntime::Token* token) {
 }
 
 void AsyncRuntime::AwaitToken(AsyncRuntime::Token* token) {
+  RunDeferredTasks();
   std::array<RCReference<AsyncValue>, 1> ref{FormRef(token->GetAsyncValue())};
   host_context_->Await(ref);
 }
@@ -235,12 +300,13 @@ void AsyncRuntime::SetAvailable(AsyncRuntime::Value* value) {
 }
 
 void AsyncRuntime::AwaitValue(AsyncRuntime::Value* value) {
+  RunDeferredTasks();
   std::array<RCReference<AsyncValue>, 1> ref{FormRef(value->GetAsyncValue())};
   host_context_->Await(ref);
 }
 
 AsyncRuntime::Group* AsyncRuntime::CreateGroup() {
-  return new AsyncRuntime::Group(this);
+  return new AsyncRuntime::Group(host_context_);
 }
 
 size_t AsyncRuntime::AddTokenToGroup(AsyncRuntime::Group* group,
@@ -249,13 +315,39 @@ size_t AsyncRuntime::AddTokenToGroup(AsyncRuntime::Group* group,
 }
 
 void AsyncRuntime::AwaitGroup(AsyncRuntime::Group* group) {
-  SmallVector<RCReference<AsyncValue>, 4> refs;
-  refs.reserve(group->size());
+  RunDeferredTasks();
+  std::array<RCReference<AsyncValue>, 1> ref{FormRef(group->GetAsyncValue())};
+  host_context_->Await(ref);
+}
+
+namespace {
+// A task deferred by the last call to `AsyncRuntime::Execute` in this thread.
+struct DeferredTask {
+  HostContext* host = nullptr;
+  llvm::unique_function<void()> task;
+};
 
-  for (AsyncRuntime::Token* token : group->GetAsyncTokens())
-    refs.emplace_back(FormRef(token->GetAsyncValue()));
+DeferredTask& GetDeferredTask() {
+  static thread_local DeferredTask deferred;
+  return deferred;
+}
+}  // namespace
+
+void AsyncRuntime::Defer(llvm::unique_function<void()> task) {
+  DeferredTask& deferred = GetDeferredTask();
+  if (deferred.task) EnqueueWork(deferred.host, std::move(deferred.task));
+  deferred.host = host_context_;
+  deferred.task = std::move(task);
+}
 
-  host_context_->Await(refs);
+/*static*/ void AsyncRuntime::RunDeferredTasks() {
+  DeferredTask& deferred = GetDeferredTask();
+  // Executed task can defer a new one.
+  while (deferred.task) {
+    llvm::unique_function<void()> task = std::move(deferred.task);
+    deferred.task = nullptr;
+    task();
+  }
 }
 
 }  // namespace jit
@@ -18,13 +18,17 @@
 
 #include "tfrt/cpu/jit/async_runtime_api.h"
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdlib>
 #include <iostream>
 
 #include "tfrt/cpu/jit/async_runtime.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/support/alloc.h"
 
 namespace tfrt {
 namespace cpu {
@@ -147,6 +151,67 @@ llvm::orc::SymbolMap AsyncRuntimeApiSymbolMap(
   return symbol_map;
 }
 
+namespace {
+// Runtime allocations are prefixed with a header that records how to release
+// the memory, because `free` does not know the size of the allocation.
+struct RuntimeAllocationHeader {
+  HostAllocator *allocator;  // nullptr if allocated with AlignedAlloc
+  void *base;
+  size_t size;
+};
+
+RuntimeAllocationHeader *GetRuntimeAllocationHeader(void *ptr) {
+  return reinterpret_cast<RuntimeAllocationHeader *>(ptr) - 1;
+}
+
+void *RuntimeMalloc(size_t size) {
+  return RuntimeAlignedAlloc(alignof(std::max_align_t), size);
+}
+}  // namespace
+
+void *RuntimeAlignedAlloc(size_t alignment, size_t size) {
+  alignment = std::max(alignment, alignof(RuntimeAllocationHeader));
+  size_t offset = (sizeof(RuntimeAllocationHeader) + alignment - 1) /
+                  alignment * alignment;
+
+  HostContext *host = async_runtime_context.host_context();
+  HostAllocator *allocator = host ? host->allocator() : nullptr;
+
+  void *base = allocator ? allocator->AllocateBytes(offset + size, alignment)
+                         : AlignedAlloc(alignment, offset + size);
+  if (base == nullptr) return nullptr;
+
+  void *ptr = static_cast<char *>(base) + offset;
+  *GetRuntimeAllocationHeader(ptr) = {allocator, base, offset + size};
+  return ptr;
+}
+
+void RuntimeFree(void *ptr) {
+  if (ptr == nullptr) return;
+  RuntimeAllocationHeader header = *GetRuntimeAllocationHeader(ptr);
+  if (header.allocator) {
+    header.allocator->DeallocateBytes(header.base, header.size);
+  } else {
+    std::free(header.base);
+  }
+}
+
+llvm::orc::SymbolMap RuntimeAllocatorSymbolMap(
+    llvm::orc::MangleAndInterner mangle) {
+  llvm::orc::SymbolMap symbol_map;
+
+  auto bind = [&](llvm::StringRef name, auto symbol_ptr) {
+    symbol_map[mangle(name)] = llvm::JITEvaluatedSymbol(
+        llvm::pointerToJITTargetAddress(symbol_ptr), llvm::JITSymbolFlags());
+  };
+
+  bind("malloc", &RuntimeMalloc);
+  bind("aligned_alloc", &RuntimeAlignedAlloc);
+  bind("free", &RuntimeFree);
+
+  return symbol_map;
+}
+
 }  // namespace jit
 }  // namespace cpu
 }  // namespace tfrt
@@ -232,6 +297,7 @@ void mlirAsyncRuntimeExecute(CoroHandle handle, CoroResume resume) {
   runtime.Execute([resume, handle, host = runtime.host_context()]() {
     ::tfrt::cpu::jit::SetAsyncRuntimeHostContext(host);
     (*resume)(handle);
+    AsyncRuntime::RunDeferredTasks();
   });
 }
 
@@ -241,6 +307,7 @@ void mlirAsyncRuntimeAwaitTokenAndExecute(AsyncToken *token, CoroHandle handle,
   runtime.AwaitToken(token, [handle, resume, host = runtime.host_context()]() {
     ::tfrt::cpu::jit::SetAsyncRuntimeHostContext(host);
     (*resume)(handle);
+    AsyncRuntime::RunDeferredTasks();
   });
 }
 
@@ -250,6 +317,7 @@ void mlirAsyncRuntimeAwaitValueAndExecute(AsyncValue *value, CoroHandle handle,
   runtime.AwaitValue(value, [handle, resume, host = runtime.host_context()]() {
     ::tfrt::cpu::jit::SetAsyncRuntimeHostContext(host);
     (*resume)(handle);
+    AsyncRuntime::RunDeferredTasks();
   });
 }
 
@@ -260,6 +328,7 @@ void mlirAsyncRuntimeAwaitAllInGroupAndExecute(AsyncGroup *group,
   runtime.AwaitGroup(group, [handle, resume, host = runtime.host_context()]() {
     ::tfrt::cpu::jit::SetAsyncRuntimeHostContext(host);
     (*resume)(handle);
+    AsyncRuntime::RunDeferredTasks();
   });
 }
 
@@ -21,14 +21,35 @@
 
 #include "tfrt/cpu/jit/cpurt.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <numeric>
-
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
 #include "llvm/ExecutionEngine/Orc/Mangling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
 #include "mlir/Conversion/AffineToStandard/AffineToStandard.h"
@@ -71,13 +92,16 @@
 #include "tfrt/cpu/jit/async_runtime.h"
 #include "tfrt/cpu/jit/async_runtime_api.h"
 #include "tfrt/cpu/jit/cpurt_support.h"
+#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/host_buffer.h"
+#include "tfrt/metrics/metrics.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/mutex.h"
 #include "tfrt/support/string_util.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/tensor.h"
+#include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
 namespace cpu {
@@ -95,6 +119,227 @@ static bool DebugCpurtCompile() {
 using CallFrame = Executable::CallFrame;
 using ResultsMemoryLayout = Executable::ResultsMemoryLayout;
 
+//----------------------------------------------------------------------------//
+// Compilation and execution statistics of the compiled kernels.
+//----------------------------------------------------------------------------//
+
+static std::atomic<bool> kernel_execution_stats_enabled{false};
+
+void EnableKernelExecutionStats(bool enable) {
+  kernel_execution_stats_enabled.store(enable, std::memory_order_relaxed);
+}
+
+static bool KernelExecutionStatsEnabled() {
+  return kernel_execution_stats_enabled.load(std::memory_order_relaxed);
+}
+
+static double ToMicroseconds(std::chrono::nanoseconds time) {
+  return std::chrono::duration<double, std::micro>(time).count();
+}
+
+static double ToMilliseconds(std::chrono::nanoseconds time) {
+  return std::chrono::duration<double, std::milli>(time).count();
+}
+
+// Records the time of a compilation pipeline phase in the phase histogram.
+static void RecordCompilationPhaseTime(string_view phase,
+                                       std::chrono::nanoseconds time) {
+  static auto* mu = new mutex;
+  static auto* histograms = new llvm::StringMap<metrics::Histogram*>;
+
+  metrics::Histogram* histogram;
+  {
+    mutex_lock lock(*mu);
+    metrics::Histogram*& entry = (*histograms)[phase];
+    if (!entry)
+      entry = metrics::NewHistogram(
+          StrCat("/tfrt/cpu/jit/compile_phase_time_ms/", phase),
+          metrics::Buckets::Explicit(
+              {1, 10, 50, 100, 250, 500, 1000, 2500, 5000, 10000}));
+    histogram = entry;
+  }
+  histogram->Record(ToMilliseconds(time));
+}
+
+namespace {
+// Measures the time of a compilation pipeline phase and traces it as a scope.
+// When destroyed adds the time to `time` and records it in the phase histogram.
+class CompilationPhaseTimer {
+ public:
+  CompilationPhaseTimer(string_view phase, std::chrono::nanoseconds* time)
+      : phase_(phase),
+        time_(time),
+        tracing_scope_(tracing::TracingLevel::Default,
+                       [&] { return StrCat("cpurt::", phase); }),
+        start_(std::chrono::steady_clock::now()) {}
+
+  ~CompilationPhaseTimer() {
+    std::chrono::nanoseconds elapsed =
+        std::chrono::steady_clock::now() - start_ - excluded_;
+    *time_ += elapsed;
+    RecordCompilationPhaseTime(phase_, elapsed);
+  }
+
+  // Excludes the time of a nested phase from the time of this phase.
+  void Exclude(std::chrono::nanoseconds time) { excluded_ += time; }
+
+ private:
+  string_view phase_;
+  std::chrono::nanoseconds* time_;
+  tracing::TracingScope tracing_scope_;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::nanoseconds excluded_{0};
+};
+}  // namespace
+
+namespace internal {
+// Statistics of the executables compiled from one kernel. Compilations are
+// rare and update the statistics under the mutex, executions only update the
+// atomic counters.
+class KernelStatsEntry {
+ public:
+  explicit KernelStatsEntry(string_view name)
+      : name_(name.str()),
+        execute_time_us_(metrics::NewHistogram(
+            StrCat("/tfrt/cpu/jit/kernel_execute_time_us/", name),
+            metrics::Buckets::Explicit(
+                {1, 10, 100, 1000, 10000, 100000, 1000000}))) {}
+
+  const std::string& name() const { return name_; }
+
+  // Adds the phase times of one compilation.
+  void RecordCompilation(const KernelStats& compilation) {
+    mutex_lock lock(mu_);
+    ++stats_.num_compilations;
+    stats_.specialize_time += compilation.specialize_time;
+    stats_.lower_to_cpurt_time += compilation.lower_to_cpurt_time;
+    stats_.lower_to_llvm_time += compilation.lower_to_llvm_time;
+    stats_.optimize_time += compilation.optimize_time;
+    stats_.codegen_time += compilation.codegen_time;
+  }
+
+  void RecordExecute(std::chrono::nanoseconds time) {
+    num_executions_.fetch_add(1, std::memory_order_relaxed);
+    execute_time_ns_.fetch_add(time.count(), std::memory_order_relaxed);
+    execute_time_us_->Record(ToMicroseconds(time));
+  }
+
+  void RecordReturnResults(std::chrono::nanoseconds time) {
+    return_results_time_ns_.fetch_add(time.count(), std::memory_order_relaxed);
+  }
+
+  KernelStats GetStats() const {
+    KernelStats stats;
+    {
+      mutex_lock lock(mu_);
+      stats = stats_;
+    }
+    stats.name = name_;
+    stats.num_executions = num_executions_.load(std::memory_order_relaxed);
+    stats.execute_time = std::chrono::nanoseconds(
+        execute_time_ns_.load(std::memory_order_relaxed));
+    stats.return_results_time = std::chrono::nanoseconds(
+        return_results_time_ns_.load(std::memory_order_relaxed));
+    return stats;
+  }
+
+ private:
+  const std::string name_;
+  metrics::Histogram* execute_time_us_;
+
+  mutable mutex mu_;
+  KernelStats stats_ TFRT_GUARDED_BY(mu_);  // only the compilation statistics
+
+  std::atomic<int64_t> num_executions_{0};
+  std::atomic<int64_t> execute_time_ns_{0};
+  std::atomic<int64_t> return_results_time_ns_{0};
+};
+}  // namespace internal
+
+using internal::KernelStatsEntry;
+
+namespace {
+struct KernelStatsRegistry {
+  mutex mu;
+  llvm::StringMap<std::unique_ptr<KernelStatsEntry>> entries
+      TFRT_GUARDED_BY(mu);
+};
+}  // namespace
+
+static KernelStatsRegistry& GetKernelStatsRegistry() {
+  static auto* registry = new KernelStatsRegistry;
+  return *registry;
+}
+
+// Returns the statistics entry of the kernel `name`, creating it on first use.
+// Entries are never deleted, so the returned pointer stays valid.
+static KernelStatsEntry* GetKernelStatsEntry(string_view name) {
+  KernelStatsRegistry& registry = GetKernelStatsRegistry();
+  mutex_lock lock(registry.mu);
+  std::unique_ptr<KernelStatsEntry>& entry = registry.entries[name];
+  if (!entry) entry = std::make_unique<KernelStatsEntry>(name);
+  return entry.get();
+}
+
+// Returns the name of the kernel compiled from the `entrypoint` of the
+// `mlir_module`. Modules usually have the same name (e.g. `@kernels`), so the
+// name has a prefix of the module source fingerprint instead.
+static std::string GetKernelName(string_view mlir_module,
+                                 string_view entrypoint) {
+  return StrCat(entrypoint, "@",
+                GetAotExecutableKey(mlir_module, entrypoint).substr(0, 8));
+}
+
+std::vector<KernelStats> GetKernelStats() {
+  std::vector<KernelStats> stats;
+  {
+    KernelStatsRegistry& registry = GetKernelStatsRegistry();
+    mutex_lock lock(registry.mu);
+    for (const auto& entry : registry.entries)
+      stats.push_back(entry.second->GetStats());
+  }
+
+  auto total_time = [](const KernelStats& kernel) {
+    return kernel.compile_time() + kernel.execute_time +
+           kernel.return_results_time;
+  };
+  std::sort(stats.begin(), stats.end(),
+            [&](const KernelStats& a, const KernelStats& b) {
+              if (total_time(a) != total_time(b))
+                return total_time(a) > total_time(b);
+              return a.name < b.name;
+            });
+  return stats;
+}
+
+void PrintKernelStats(raw_ostream& os) {
+  os << "--- CPURT kernel stats (compilation in ms, execution in us):\n";
+  os << llvm::right_justify("compiles", 9)
+     << llvm::right_justify("specialize", 11)
+     << llvm::right_justify("lower", 11) << llvm::right_justify("optimize", 11)
+     << llvm::right_justify("codegen", 11)
+     << llvm::right_justify("executions", 12)
+     << llvm::right_justify("execute", 13) << llvm::right_justify("avg", 11)
+     << llvm::right_justify("results", 13) << "  kernel\n";
+  for (const KernelStats& kernel : GetKernelStats()) {
+    double execute_us = ToMicroseconds(kernel.execute_time);
+    double avg_us = kernel.num_executions > 0
+                        ? execute_us / kernel.num_executions
+                        : 0.0;
+    os << llvm::format(
+        "%9lld %10.3f %10.3f %10.3f %10.3f %11lld %12.3f %10.3f %12.3f  ",
+        static_cast<long long>(kernel.num_compilations),
+        ToMilliseconds(kernel.specialize_time),
+        ToMilliseconds(kernel.lower_to_cpurt_time + kernel.lower_to_llvm_time),
+        ToMilliseconds(kernel.optimize_time),
+        ToMilliseconds(kernel.codegen_time),
+        static_cast<long long>(kernel.num_executions), execute_us, avg_us,
+        ToMicroseconds(kernel.return_results_time));
+    os << kernel.name << "\n";
+  }
+  os.flush();
+}
+
 raw_ostream& operator<<(raw_ostream& os, const MemrefDesc& desc) {
   auto print_arr = [&](string_view name, ArrayRef<ssize_t> arr) {
     os << " " << name << ": [";
@@ -396,7 +641,9 @@ static bool IsStaticStorageDuration(StridedMemRefType<T, rank>* memref) {
 //
 // This converter always creates a new DenseHostTensor from the memref, and it
 // must be used only when it is guaranteed that the compiled region can't
-// return global constant memref or forward one of the operands.
+// return global constant memref or forward one of the operands. The memref
+// was allocated from the HostAllocator (see RuntimeAllocatorSymbolMap), and
+// the tensor takes the ownership of it without copying the data.
 struct ConvertDenseHostTensor {
   using ResultType = DenseHostTensor;
   using ConversionContext = ConversionCtx;
@@ -412,7 +659,9 @@ struct ConvertDenseHostTensor {
 
     // Deallocate memref only if it has dynamic storage duration.
     void* ptr = IsStaticStorageDuration(memref) ? nullptr : memref->basePtr;
-    HostBuffer::Deallocator deallocator = [ptr](void*, size_t) { free(ptr); };
+    HostBuffer::Deallocator deallocator = [ptr](void*, size_t) {
+      RuntimeFree(ptr);
+    };
 
     return DenseHostTensor(
         metadata, HostBuffer::CreateFromExternal(memref->data,
@@ -499,16 +748,40 @@ Error Executable::Execute(ArrayRef<MemrefDesc> operands,
 
 void Executable::Execute(const ExecutionContext& exec_ctx,
                          CallFrame* call_frame) const {
+  TFRT_TRACE_SCOPE(Default,
+                   StrCat("Executable::Execute: ",
+                          stats_ ? string_view(stats_->name()) : "unknown"));
+
+  bool record_stats = stats_ && KernelExecutionStatsEnabled();
+  auto start = record_stats ? std::chrono::steady_clock::now()
+                            : std::chrono::steady_clock::time_point();
+
   // Set the AsyncRuntime host context to be used by all async tasks spawned
   // by the compiled kernel function.
   SetAsyncRuntimeHostContext(exec_ctx.host());
 
   // Call the compiled function.
-  (*fptr_)(call_frame->args.data());
+  (*GetKernelFunction(exec_ctx))(call_frame->args.data());
+
+  // Execute the last async task launched by the compiled function inline.
+  AsyncRuntime::RunDeferredTasks();
+
+  if (record_stats)
+    stats_->RecordExecute(std::chrono::steady_clock::now() - start);
 }
 
 Error Executable::ReturnResults(const ReturnValueConverterBase& results,
                                 CallFrame* call_frame) const {
+  TFRT_TRACE_STATIC_SCOPE(Default, "Executable::ReturnResults");
+
+  bool record_stats = stats_ && KernelExecutionStatsEnabled();
+  auto start = record_stats ? std::chrono::steady_clock::now()
+                            : std::chrono::steady_clock::time_point();
+  auto record = llvm::make_scope_exit([&] {
+    if (record_stats)
+      stats_->RecordReturnResults(std::chrono::steady_clock::now() - start);
+  });
+
   auto ret_types = signature_.getResults();
 
   bool converted = llvm::all_of(llvm::enumerate(ret_types), [&](auto tuple) {
@@ -667,25 +940,194 @@ static mlir::LogicalResult LowerToLlvm(mlir::ModuleOp module,
   return pm.run(module);
 }
 
+//----------------------------------------------------------------------------//
+// Persistent cache of compiled object files.
+//----------------------------------------------------------------------------//
+
+// Version of the object cache entries. It must be updated when the lowering to
+// LLVM or the calling convention of the compiled kernels changes.
+static constexpr const char* const kObjectCacheVersion = "cpurt-object-v1";
+
+std::string GetObjectCacheDirFromEnv() {
+  const char* dir = std::getenv("TFRT_CPURT_OBJECT_CACHE_DIR");
+  return dir ? dir : "";
+}
+
+std::vector<ssize_t> GetBucketSizesFromEnv() {
+  std::vector<ssize_t> bucket_sizes;
+  const char* sizes = std::getenv("TFRT_CPURT_BUCKET_SIZES");
+  if (!sizes) return bucket_sizes;
+  llvm::SmallVector<llvm::StringRef, 8> parts;
+  llvm::StringRef(sizes).split(parts, ',', /*MaxSplit=*/-1,
+                               /*KeepEmpty=*/false);
+  for (llvm::StringRef part : parts) {
+    int64_t size;
+    if (!part.trim().getAsInteger(10, size) && size > 0)
+      bucket_sizes.push_back(size);
+  }
+  llvm::sort(bucket_sizes);
+  return bucket_sizes;
+}
+
+// Returns the enabled host CPU features in a deterministic order.
+static std::string GetHostCpuFeatures() {
+  llvm::StringMap<bool> host_features;
+  llvm::SmallVector<llvm::StringRef> features;
+  if (llvm::sys::getHostCPUFeatures(host_features)) {
+    for (const auto& feature : host_features)
+      if (feature.second) features.push_back(feature.first());
+    llvm::sort(features);
+  }
+  return llvm::join(features, ",");
+}
+
+// Returns the path of the object file for the `entrypoint` of the `module`,
+// which must already be lowered to the dialects supported by the CPURT.
+static std::string GetObjectCachePath(mlir::ModuleOp module,
+                                      string_view entrypoint,
+                                      const CompilationOptions& opts) {
+  std::string module_str;
+  llvm::raw_string_ostream module_os(module_str);
+  module.print(module_os);
+
+  llvm::MD5 md5;
+  auto update = [&](string_view value) {
+    md5.update(value);
+    md5.update(llvm::StringRef("\0", 1));  // separates the key components
+  };
+  update(kObjectCacheVersion);
+  update(LLVM_VERSION_STRING);
+  update(llvm::sys::getHostCPUName());
+  update(GetHostCpuFeatures());
+  update(entrypoint);
+  update(StrCat(opts.alignment));
+  update(StrCat(opts.jit_code_opt_level ? *opts.jit_code_opt_level : -1));
+  update(module_os.str());
+
+  llvm::MD5::MD5Result result;
+  md5.final(result);
+  llvm::SmallString<32> hex;
+  llvm::MD5::stringifyResult(result, hex);
+
+  llvm::SmallString<128> path(opts.object_cache_dir);
+  llvm::sys::path::append(path, StrCat(hex, ".o"));
+  return path.str().str();
+}
+
+// Loads the `object` into a new jit that resolves the symbols the same way as
+// the MLIR execution engine.
+static Expected<std::unique_ptr<llvm::orc::LLJIT>> LoadObject(
+    std::unique_ptr<llvm::MemoryBuffer> object) {
+  auto builder = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!builder) return builder.takeError();
+
+  auto jit = llvm::orc::LLJITBuilder()
+                 .setJITTargetMachineBuilder(std::move(*builder))
+                 .create();
+  if (!jit) return jit.takeError();
+
+  llvm::orc::JITDylib& main = (*jit)->getMainJITDylib();
+  const llvm::DataLayout& data_layout = (*jit)->getDataLayout();
+
+  // Resolve symbols that are statically linked in the current process.
+  auto generator =
+      llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          data_layout.getGlobalPrefix());
+  if (!generator) return generator.takeError();
+  main.addGenerator(std::move(*generator));
+
+  // Register Async Runtime API intrinsics.
+  llvm::orc::MangleAndInterner mangle((*jit)->getExecutionSession(),
+                                      data_layout);
+  if (auto err =
+          main.define(llvm::orc::absoluteSymbols(
+              AsyncRuntimeApiSymbolMap(mangle))))
+    return std::move(err);
+
+  // Allocate memrefs returned from the kernel with the HostAllocator.
+  if (auto err = main.define(
+          llvm::orc::absoluteSymbols(RuntimeAllocatorSymbolMap(mangle))))
+    return std::move(err);
+
+  if (auto err = (*jit)->addObjectFile(std::move(object)))
+    return std::move(err);
+
+  return std::move(*jit);
+}
+
+// Loads the object file at `path`, see LoadObject.
+static Expected<std::unique_ptr<llvm::orc::LLJIT>> LoadObjectFile(
+    const std::string& path) {
+  auto object = llvm::MemoryBuffer::getFile(path);
+  if (!object) return llvm::errorCodeToError(object.getError());
+  return LoadObject(std::move(*object));
+}
+
+// Writes the object file compiled by the `engine` to the cache `path`. The
+// object file is written to a temporary file that is renamed when complete,
+// so that concurrent readers never load a partially written file. Errors are
+// ignored, the executable is recompiled if it is not in the cache.
+static void StoreObjectFile(mlir::ExecutionEngine& engine,
+                            const std::string& path) {
+  if (llvm::sys::fs::create_directories(llvm::sys::path::parent_path(path)))
+    return;
+
+  llvm::SmallString<128> tmp_path;
+  if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%%%.tmp", tmp_path))
+    return;
+  engine.dumpToObjectFile(tmp_path);
+
+  uint64_t size = 0;
+  if (llvm::sys::fs::file_size(tmp_path, size) || size == 0 ||
+      llvm::sys::fs::rename(tmp_path, path))
+    llvm::sys::fs::remove(tmp_path);
+}
+
+// Returns the object file compiled by the `engine`.
+static Expected<std::string> DumpObjectFile(mlir::ExecutionEngine& engine) {
+  llvm::SmallString<128> path;
+  if (auto ec = llvm::sys::fs::createTemporaryFile("cpurt", "o", path))
+    return llvm::errorCodeToError(ec);
+  auto remove = llvm::make_scope_exit([&]() { llvm::sys::fs::remove(path); });
+
+  engine.dumpToObjectFile(path);
+  auto object = llvm::MemoryBuffer::getFile(path);
+  if (!object) return llvm::errorCodeToError(object.getError());
+  if ((*object)->getBufferSize() == 0)
+    return MakeStringError("failed to dump the compiled object file");
+  return (*object)->getBuffer().str();
+}
+
 //----------------------------------------------------------------------------//
 // JitCompilationContext to manage specialization and compilation.
 //----------------------------------------------------------------------------//
 
 namespace {
+// The native object file of an executable compiled ahead of time, and the
+// symbol of its kernel function.
+struct AotObject {
+  std::string kernel_symbol;
+  std::string object;
+};
+
 // JitCompilationContext manages parsing, specialization and compilation of a
 // single compiled module. It owns the MLIR context where the module is created,
 // and handlers to capture all diagnostics messages.
 class JitCompilationContext {
  public:
-  // Instantiates JIT compilation context from the serialized mlir source.
+  // Instantiates JIT compilation context from the serialized mlir source. If
+  // `stats` is not null, the time of the compilation phases is recorded there.
   static Expected<std::unique_ptr<JitCompilationContext>> Instantiate(
-      const CompilationOptions& opts, string_view mlir_module);
+      const CompilationOptions& opts, string_view mlir_module,
+      KernelStatsEntry* stats = nullptr);
 
   // Makes an executable from the JIT compilation context. This is the end of
   // life for the compilation context, it effectively converts the MLIR module
-  // to the executable (function pointer) using LLVM JIT code generation.
+  // to the executable (function pointer) using LLVM JIT code generation. If
+  // `aot_object` is not null, it is set to the compiled object file.
   static Expected<Executable> Compile(
-      std::unique_ptr<JitCompilationContext> ctx, string_view entrypoint);
+      std::unique_ptr<JitCompilationContext> ctx, string_view entrypoint,
+      AotObject* aot_object = nullptr);
 
   template <typename OriginalError>
   llvm::Error Error(OriginalError original_error) {
@@ -709,7 +1151,7 @@ class JitCompilationContext {
 
  private:
   JitCompilationContext(const CompilationOptions& opts,
-                        string_view mlir_module);
+                        string_view mlir_module, KernelStatsEntry* stats);
 
   CompilationOptions opts_;
   std::unique_ptr<mlir::MLIRContext> context_;
@@ -718,6 +1160,9 @@ class JitCompilationContext {
   llvm::SourceMgr source_mgr_;
   mlir::SourceMgrDiagnosticHandler handler_;
   mlir::OwningModuleRef module_;  // can be null if failed to parse the module
+
+  KernelStatsEntry* stats_;
+  KernelStats compilation_stats_;  // phase times of this compilation
 };
 }  // namespace
 
@@ -767,11 +1212,13 @@ static Expected<mlir::FuncOp> ResolveEntrypointFunction(
 }
 
 JitCompilationContext::JitCompilationContext(const CompilationOptions& opts,
-                                             string_view mlir_module)
+                                             string_view mlir_module,
+                                             KernelStatsEntry* stats)
     : opts_(opts),
       context_(CreateMlirContext(opts_)),
       diagnostic_os_(diagnostic_),
-      handler_(source_mgr_, context_.get(), diagnostic_os_) {
+      handler_(source_mgr_, context_.get(), diagnostic_os_),
+      stats_(stats) {
   source_mgr_.AddNewSourceBuffer(
       llvm::MemoryBuffer::getMemBuffer(mlir_module, "cpurt.kernel"),
       llvm::SMLoc());
@@ -780,19 +1227,45 @@ JitCompilationContext::JitCompilationContext(const CompilationOptions& opts,
 
 /*static*/ Expected<std::unique_ptr<JitCompilationContext>>
 JitCompilationContext::Instantiate(const CompilationOptions& opts,
-                                   string_view mlir_module) {
+                                   string_view mlir_module,
+                                   KernelStatsEntry* stats) {
   std::unique_ptr<JitCompilationContext> context(
-      new JitCompilationContext(opts, mlir_module));
+      new JitCompilationContext(opts, mlir_module, stats));
   if (!context->module_)
     return context->Error("failed to parse the mlir source");
   return {std::move(context)};
 }
 
 /*static*/ Expected<Executable> JitCompilationContext::Compile(
-    std::unique_ptr<JitCompilationContext> ctx, string_view entrypoint) {
+    std::unique_ptr<JitCompilationContext> ctx, string_view entrypoint,
+    AotObject* aot_object) {
+  TFRT_TRACE_SCOPE(Default,
+                   StrCat("JitCompilationContext::Compile: ", entrypoint));
+
+  // Record the time spent in the compilation phases, even if it failed.
+  KernelStats& phases = ctx->compilation_stats_;
+  auto record_stats = llvm::make_scope_exit([&] {
+    if (ctx->stats_) ctx->stats_->RecordCompilation(phases);
+  });
+
+  // With tiered compilation the module is compiled without optimizations, and
+  // the source is kept to recompile it with optimizations later. The source
+  // must be printed before running the CPURT pipeline, because the
+  // recompilation runs it again.
+  bool baseline_tier =
+      ctx->options().tiered_compilation_threshold > 0 && !aot_object;
+  std::string tiered_source;
+  if (baseline_tier) {
+    llvm::raw_string_ostream os(tiered_source);
+    ctx->module().print(os);
+  }
+
   // Lower loaded module to dialects supported by the CPURT to LLVM pipeline.
-  if (failed(LowerToCpurt(ctx->module(), ctx->options())))
-    return ctx->Error("failed to lower module to CPURT dialects");
+  {
+    CompilationPhaseTimer timer("lower_to_cpurt", &phases.lower_to_cpurt_time);
+    if (failed(LowerToCpurt(ctx->module(), ctx->options())))
+      return ctx->Error("failed to lower module to CPURT dialects");
+  }
 
   // Verify entrypoint function signature.
   auto entry_func = ResolveEntrypointFunction(ctx->module(), entrypoint);
@@ -804,9 +1277,45 @@ JitCompilationContext::Instantiate(const CompilationOptions& opts,
       Executable::VerifyEntrypointSignature(entry_signature);
   if (auto err = results_memory_layout.takeError()) return std::move(err);
 
+  // Load the native code from the persistent object cache if it is there.
+  std::string object_cache_path;
+  if (!ctx->options().object_cache_dir.empty()) {
+    object_cache_path =
+        GetObjectCachePath(ctx->module(), entrypoint, ctx->options());
+
+    // Fall back on compiling the module if the object file can't be loaded,
+    // and replace it in the cache.
+    if (llvm::sys::fs::exists(object_cache_path)) {
+      Expected<std::unique_ptr<llvm::orc::LLJIT>> jit =
+          LoadObjectFile(object_cache_path);
+      if (jit) {
+        auto fptr = (*jit)->lookup(StrCat("_mlir_", entry_name));
+        if (fptr) {
+          Executable executable(
+              std::move(ctx->context_), std::move(*jit), entry_signature,
+              reinterpret_cast<Executable::KernelFunctionPtr>(
+                  fptr->getAddress()),
+              std::move(*results_memory_layout));
+          executable.set_kernel_stats(ctx->stats_);
+          return {std::move(executable)};
+        }
+        llvm::consumeError(fptr.takeError());
+      } else {
+        llvm::consumeError(jit.takeError());
+      }
+    }
+  }
+
   // Lower kernel IR from high level dialects to the MLIR LLVM Dialect.
-  if (failed(LowerToLlvm(ctx->module(), ctx->options())))
-    return ctx->Error("failed to lower module to LLVM");
+  {
+    CompilationPhaseTimer timer("lower_to_llvm", &phases.lower_to_llvm_time);
+    if (failed(LowerToLlvm(ctx->module(), ctx->options())))
+      return ctx->Error("failed to lower module to LLVM");
+  }
+
+  // Translation to LLVM IR and code generation (without the LLVM optimization
+  // pipeline that is measured as a separate phase).
+  CompilationPhaseTimer codegen_timer("codegen", &phases.codegen_time);
 
   // Prepare JIT target machine for code generation.
   auto builder = llvm::orc::JITTargetMachineBuilder::detectHost();
@@ -820,21 +1329,57 @@ JitCompilationContext::Instantiate(const CompilationOptions& opts,
 
   // Additional LLVM passes to run.
   llvm::SmallVector<const llvm::PassInfo*, 4> passes;
-  auto transformer = mlir::makeLLVMPassesTransformer(passes, /*mbOptLevel=*/2,
-                                                     target_machine->get());
+  auto optimize = mlir::makeLLVMPassesTransformer(
+      passes, /*mbOptLevel=*/baseline_tier ? 0 : 2, target_machine->get());
+  auto transformer = [&](llvm::Module* module) -> llvm::Error {
+    std::chrono::nanoseconds optimize_time{0};
+    auto record = llvm::make_scope_exit([&] {
+      phases.optimize_time += optimize_time;
+      codegen_timer.Exclude(optimize_time);
+    });
+    CompilationPhaseTimer timer("optimize", &optimize_time);
+    return optimize(module);
+  };
 
-  // Build MLIR execution engine.
+  // Build MLIR execution engine. The LLVM optimization pipeline runs when the
+  // engine is created.
   auto engine = mlir::ExecutionEngine::create(
       ctx->module(), /*llvmModuleBuilder=*/nullptr, transformer,
-      ctx->options().jit_code_opt_level, libs);
+      baseline_tier ? llvm::CodeGenOpt::None
+                    : ctx->options().jit_code_opt_level,
+      libs);
   if (!engine) return ctx->Error(engine.takeError());
 
   // Register Async Runtime API intrinsics.
   (*engine)->registerSymbols(AsyncRuntimeApiSymbolMap);
 
-  return Executable(std::move(ctx->context_), std::move(*engine),
-                    entry_signature, entry_name,
-                    std::move(*results_memory_layout));
+  // Allocate memrefs returned from the kernel with the HostAllocator.
+  (*engine)->registerSymbols(RuntimeAllocatorSymbolMap);
+
+  // Looking up the entrypoint compiles the module to the object file.
+  auto fptr = (*engine)->lookup(entry_name);
+  if (!fptr) return ctx->Error(fptr.takeError());
+
+  // Add the object file to the persistent cache. Only optimized executables
+  // are cached, because the cache entries are keyed by the optimization level.
+  if (!object_cache_path.empty() && !baseline_tier)
+    StoreObjectFile(**engine, object_cache_path);
+
+  if (aot_object) {
+    auto object = DumpObjectFile(**engine);
+    if (auto err = object.takeError()) return std::move(err);
+    aot_object->kernel_symbol = StrCat("_mlir_", entry_name);
+    aot_object->object = std::move(*object);
+  }
+
+  Executable executable(std::move(ctx->context_), std::move(*engine),
+                        entry_signature, entry_name,
+                        std::move(*results_memory_layout));
+  executable.set_kernel_stats(ctx->stats_);
+  if (baseline_tier)
+    executable.EnableTieredCompilation(tiered_source, entrypoint,
+                                       ctx->options());
+  return {std::move(executable)};
 }
 
 // Return input `type` specialized to memref descriptor operand.
@@ -861,6 +1406,9 @@ static llvm::Expected<mlir::Type> SpecializeType(mlir::Type type,
 llvm::Error JitCompilationContext::Specialize(
     ArrayRef<MemrefDesc> operands, ArrayRef<OperandConstraint> constraints,
     string_view entrypoint) {
+  CompilationPhaseTimer timer("specialize",
+                              &compilation_stats_.specialize_time);
+
   mlir::FuncOp func = module_->lookupSymbol<mlir::FuncOp>(entrypoint);
   if (!func) return MakeStringError("Entrypoint not found: ", entrypoint);
 
@@ -914,6 +1462,90 @@ llvm::Error JitCompilationContext::Specialize(
   return Error::success();
 }
 
+//----------------------------------------------------------------------------//
+// Tiered compilation of the executables.
+//----------------------------------------------------------------------------//
+
+int GetTieredCompilationThresholdFromEnv() {
+  const char* threshold =
+      std::getenv("TFRT_CPURT_TIERED_COMPILATION_THRESHOLD");
+  return threshold ? std::max(std::atoi(threshold), 0) : 0;
+}
+
+struct Executable::TieredCompilation {
+  // Recompiles the module with optimizations on the blocking work queue, and
+  // publishes the optimized kernel function when it is compiled. Executions
+  // keep calling the unoptimized function if the recompilation fails.
+  static void Recompile(std::shared_ptr<TieredCompilation> tiered,
+                        const ExecutionContext& exec_ctx);
+
+  std::string mlir_module;
+  std::string entrypoint;
+  CompilationOptions opts;
+  KernelStatsEntry* stats;
+
+  int64_t threshold;
+  std::atomic<int64_t> num_executions{0};
+
+  // The optimized executable owns the code of the optimized kernel function.
+  // It is set once before the function is published.
+  Optional<Executable> optimized;
+  std::atomic<KernelFunctionPtr> optimized_fptr{nullptr};
+};
+
+void Executable::TieredCompilation::Recompile(
+    std::shared_ptr<TieredCompilation> tiered,
+    const ExecutionContext& exec_ctx) {
+  EnqueueBlockingWork(exec_ctx, [tiered = std::move(tiered)]() {
+    Expected<std::unique_ptr<JitCompilationContext>> ctx =
+        JitCompilationContext::Instantiate(tiered->opts, tiered->mlir_module,
+                                           tiered->stats);
+    if (auto err = ctx.takeError()) {
+      llvm::consumeError(std::move(err));
+      return;
+    }
+
+    Expected<Executable> optimized =
+        JitCompilationContext::Compile(std::move(*ctx), tiered->entrypoint);
+    if (auto err = optimized.takeError()) {
+      llvm::consumeError(std::move(err));
+      return;
+    }
+
+    tiered->optimized.emplace(std::move(*optimized));
+    tiered->optimized_fptr.store(tiered->optimized->fptr_,
+                                 std::memory_order_release);
+  });
+}
+
+void Executable::EnableTieredCompilation(string_view mlir_module,
+                                         string_view entrypoint,
+                                         const CompilationOptions& opts) {
+  tiered_ = std::make_shared<TieredCompilation>();
+  tiered_->mlir_module = mlir_module.str();
+  tiered_->entrypoint = entrypoint.str();
+  tiered_->opts = opts;
+  tiered_->opts.tiered_compilation_threshold = 0;
+  tiered_->stats = stats_;
+  tiered_->threshold = std::max(opts.tiered_compilation_threshold, 1);
+}
+
+Executable::KernelFunctionPtr Executable::GetKernelFunction(
+    const ExecutionContext& exec_ctx) const {
+  if (!tiered_) return fptr_;
+
+  KernelFunctionPtr optimized =
+      tiered_->optimized_fptr.load(std::memory_order_acquire);
+  if (optimized) return optimized;
+
+  // Only the execution that reaches the threshold starts the recompilation.
+  if (tiered_->num_executions.fetch_add(1, std::memory_order_relaxed) + 1 ==
+      tiered_->threshold)
+    TieredCompilation::Recompile(tiered_, exec_ctx);
+
+  return fptr_;
+}
+
 //----------------------------------------------------------------------------//
 // JitExecutable implementation.
 //----------------------------------------------------------------------------//
@@ -1026,21 +1658,84 @@ static bool IsSpecializationOnly(ArrayRef<OperandConstraint> constraints) {
   });
 }
 
+namespace {
+// A default executable compiled ahead of time, and loaded from a BEF file.
+struct AotExecutable {
+  AsyncValueRef<Executable> executable;
+  llvm::SmallVector<OperandConstraint> constraints;
+};
+
+struct AotExecutables {
+  tfrt::mutex mu;
+  // Executables keyed by GetAotExecutableKey().
+  llvm::StringMap<AotExecutable> executables TFRT_GUARDED_BY(mu);
+};
+}  // namespace
+
+static AotExecutables& GetAotExecutables() {
+  static auto* aot_executables = new AotExecutables();
+  return *aot_executables;
+}
+
+// Returns the default executable of the `entrypoint` of the `mlir_module` that
+// was compiled ahead of time, and its operands `constraints`, or null if it was
+// not loaded.
+static AsyncValueRef<Executable> FindAotExecutable(
+    string_view mlir_module, string_view entrypoint,
+    llvm::SmallVectorImpl<OperandConstraint>* constraints) {
+  AotExecutables& aot_executables = GetAotExecutables();
+  {
+    // Do not hash the module if no executables were loaded.
+    tfrt::mutex_lock lock(aot_executables.mu);
+    if (aot_executables.executables.empty()) return {};
+  }
+
+  std::string key = GetAotExecutableKey(mlir_module, entrypoint);
+  tfrt::mutex_lock lock(aot_executables.mu);
+  auto it = aot_executables.executables.find(key);
+  if (it == aot_executables.executables.end()) return {};
+  constraints->assign(it->second.constraints.begin(),
+                      it->second.constraints.end());
+  return it->second.executable.CopyRef();
+}
+
 /*static*/ Expected<JitExecutable> JitExecutable::Instantiate(
     string_view mlir_module, string_view entrypoint,
     const CompilationOptions& compilation_opts) {
+  TFRT_TRACE_SCOPE(Default, StrCat("JitExecutable::Instantiate: ", entrypoint));
+
+  KernelStatsEntry* stats =
+      GetKernelStatsEntry(GetKernelName(mlir_module, entrypoint));
+
+  // Use the default executable compiled ahead of time if it was loaded. It
+  // accepts all compatible operands, and specializations are disabled, so that
+  // the module is never parsed or compiled at runtime.
+  llvm::SmallVector<OperandConstraint> aot_constraints;
+  if (AsyncValueRef<Executable> aot_executable =
+          FindAotExecutable(mlir_module, entrypoint, &aot_constraints)) {
+    CompilationOptions opts = compilation_opts;
+    opts.disable_specializations = true;
+    return JitExecutable(mlir_module, entrypoint, std::move(opts),
+                         aot_constraints, stats, std::move(aot_executable));
+  }
+
   // Set up LLVM target for code generation.
   InitializeCompiler();
 
   // Try to instantiate compilation context from the mlir source.
   Expected<std::unique_ptr<JitCompilationContext>> ctx =
-      JitCompilationContext::Instantiate(compilation_opts, mlir_module);
+      JitCompilationContext::Instantiate(compilation_opts, mlir_module, stats);
   if (auto err = ctx.takeError()) return std::move(err);
 
   // Get resolved operands constraints for the entrypoint function.
   auto constraints = GetOperandsConstraints((*ctx)->module(), entrypoint);
   if (auto err = constraints.takeError()) return std::move(err);
 
+  // Check if the operands of the entrypoint are padded to the bucket sizes.
+  auto func = ResolveEntrypointFunction((*ctx)->module(), entrypoint);
+  if (auto err = func.takeError()) return std::move(err);
+  bool bucketed = (*func)->hasAttr(kBucketed);
+
   // If the module must be specialized, return JitExecutable without a default
   // compiled executable.
   if (IsSpecializationOnly(*constraints)) {
@@ -1052,8 +1747,10 @@ static bool IsSpecializationOnly(ArrayRef<OperandConstraint> constraints) {
           "unresolved constraints: ",
           *constraints);
 
-    return JitExecutable(mlir_module, entrypoint, compilation_opts,
-                         *constraints);
+    JitExecutable jit_executable(mlir_module, entrypoint, compilation_opts,
+                                 *constraints, stats);
+    jit_executable.bucketed_ = bucketed;
+    return std::move(jit_executable);
   }
 
   // Otherwise try to compile the default executable.
@@ -1061,175 +1758,625 @@ static bool IsSpecializationOnly(ArrayRef<OperandConstraint> constraints) {
       JitCompilationContext::Compile(std::move(*ctx), entrypoint);
   if (auto err = executable.takeError()) return std::move(err);
 
-  return JitExecutable(mlir_module, entrypoint, compilation_opts, *constraints,
-                       std::move(*executable));
+  JitExecutable jit_executable(
+      mlir_module, entrypoint, compilation_opts, *constraints, stats,
+      MakeAvailableAsyncValueRef<Executable>(std::move(*executable)));
+  jit_executable.bucketed_ = bucketed;
+  return std::move(jit_executable);
 }
 
 JitExecutable::JitExecutable(string_view mlir_module, string_view entrypoint,
                              CompilationOptions compilation_opts,
                              ArrayRef<OperandConstraint> constraints,
-                             Optional<Executable> default_executable)
+                             KernelStatsEntry* stats,
+                             AsyncValueRef<Executable> default_executable)
     : mlir_module_(mlir_module.str()),
       entrypoint_(entrypoint.str()),
       compilation_opts_(std::move(compilation_opts)),
       constraints_(constraints.begin(), constraints.end()),
       default_executable_(std::move(default_executable)),
-      specializations_(std::make_unique<Specializations>()) {}
+      specializations_(std::make_shared<Specializations>()),
+      stats_(stats) {}
 
 const Executable* JitExecutable::DefaultExecutable() const {
-  return default_executable_.hasValue() ? &*default_executable_ : nullptr;
+  return default_executable_ ? &default_executable_.get() : nullptr;
 }
 
 bool JitExecutable::HasDefaultExecutable() const {
-  return default_executable_.hasValue();
+  return static_cast<bool>(default_executable_);
 }
 
 ArrayRef<OperandConstraint> JitExecutable::constraints() const {
   return constraints_;
 }
 
-// Hashes the given operands.
-// Note: due to value specialization, the resulting hash might depend on the
-// values (and not only on the types) of the operands.
-static llvm::hash_code HashOperands(ArrayRef<MemrefDesc> operands,
-                                    ArrayRef<OperandConstraint> constraints) {
-  llvm::hash_code hash = llvm::hash_value(operands);
+ssize_t JitExecutable::GetBucketSize(ssize_t size) const {
+  ArrayRef<ssize_t> bucket_sizes = compilation_opts_.bucket_sizes;
+  auto it = llvm::lower_bound(bucket_sizes, size);
+  if (it != bucket_sizes.end()) return *it;
+  return size <= 1 ? size : static_cast<ssize_t>(llvm::PowerOf2Ceil(size));
+}
 
-  // Mix values of arguments to be sunk into the hash.
-  for (int i = 0; i < constraints.size(); ++i) {
-    if (constraints[i] != OperandConstraint::kValue) continue;
+// Appends the bytes of `value` to the specialization `key`.
+template <typename T>
+static void AppendToKey(std::string* key, const T& value) {
+  key->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Returns the key of the specialization to the given operands. Unlike a hash,
+// the key identifies the specialization exactly: it has the dtype, the rank and
+// the sizes (kDynamicSize for dimensions that are not specialized) of all the
+// operands, and the values of the operands with a value constraint.
+static std::string SpecializationKey(ArrayRef<MemrefDesc> operands,
+                                     ArrayRef<OperandConstraint> constraints) {
+  std::string key;
+  for (unsigned i = 0; i < operands.size(); ++i) {
     const MemrefDesc& operand = operands[i];
-    const auto* data = static_cast<uint8_t*>(operand.data);
+    AppendToKey(&key, operand.dtype.kind());
+    AppendToKey(&key, operand.sizes.size());
+    for (ssize_t size : operand.sizes) AppendToKey(&key, size);
+
+    if (constraints[i] != OperandConstraint::kValue) continue;
+    const auto* data = static_cast<const char*>(operand.data);
     size_t rank = operand.sizes.size();
     assert(rank == 0 || rank == 1);
     size_t num_values = rank == 0 ? 1 : operand.sizes[0];
-    ssize_t len = num_values * operand.dtype.GetHostSize();
-    hash = llvm::hash_combine(hash, llvm::hash_combine_range(data, data + len));
+    key.append(data, num_values * operand.dtype.GetHostSize());
   }
-  return hash;
+  return key;
 }
 
-// Implement `hash_value` to rely on the ADL lookup for the MemrefDesc type.
-static llvm::hash_code hash_value(const MemrefDesc& memref) {
-  // We currently do not support non-contiguous memrefs as operands, so we do
-  // not need to hash memref strides.
-  return llvm::hash_combine(
-      memref.sizes.size(),
-      llvm::hash_combine_range(memref.sizes.begin(), memref.sizes.end()));
+// Records the time it took to compile a specialization.
+static void RecordSpecializationCompileTime(uint64_t compile_time_us) {
+  static metrics::Histogram* compile_time_ms = metrics::NewHistogram(
+      "/tfrt/cpu/jit/specialization_compile_time_ms",
+      metrics::Buckets::Explicit(
+          {1, 10, 50, 100, 250, 500, 1000, 2500, 5000, 10000}));
+  compile_time_ms->Record(compile_time_us / 1000.0);
 }
 
-// TODO(ezhulenev): Current implementation unnecessarily blocks if the
-// specialization is not available, however it can fallback on default
-// executable if it is available. Also the fast path should be free of mutex to
-// find the pre-compiled specialization. Maybe use atomic pointers (multiple
-// atomic pointers?) to keep the most commonly used specialization available
-// without grabbing a mutex and doing lookup in the DenseMap.
-//
-// TODO(ezhulenev): The number of specializations should be bounded, ideally we
-// should only keep N most common specializations, and for everything else
-// fall back on the default executable. However what to do if default executable
-// is not available, and the number of specializations is above N?
+// TODO(ezhulenev): The fast path should be free of mutex to find the
+// pre-compiled specialization. Maybe use atomic pointers (multiple atomic
+// pointers?) to keep the most commonly used specialization available without
+// grabbing a mutex and doing lookup in the StringMap.
 //
 // TODO(ezhulenev): Currently we always specialize operands to the shape, even
 // if operand constraint only requires rank specialization. Although it might be
 // beneficial to know the shape to do broadcasts fusion, consider not doing that
 // when it is not needed.
-Expected<const Executable*> JitExecutable::GetExecutable(
-    ArrayRef<MemrefDesc> operands) {
-  llvm::hash_code hash = HashOperands(operands, constraints_);
-
+AsyncValueRef<Executable> JitExecutable::GetExecutable(
+    ArrayRef<MemrefDesc> operands, const ExecutionContext& exec_ctx) {
   // Do not try to compile specialized executable if it is explicitly disabled.
   if (compilation_opts_.disable_specializations) {
     if (!HasDefaultExecutable())
-      return MakeStringError(
+      return MakeErrorAsyncValueRef(
           "jit executable specialization is disabled, but the default "
           "executable is not available");
 
-    return &*default_executable_;
+    return default_executable_.CopyRef();
   }
 
-  // Convert ExecutableOrError to the function result.
-  auto convert = [](ExecutableOrError& value) -> Expected<const Executable*> {
-    // Only error or executable must be available.
-    bool is_error = static_cast<bool>(value.error);
-    assert(is_error != value.executable.hasValue());
+  if (operands.size() != constraints_.size())
+    return MakeErrorAsyncValueRef(
+        StrCat("expected ", constraints_.size(), " operands, got ",
+               operands.size()));
+
+  // Returns the specialized executable, or the default executable if the
+  // specialization is still being compiled.
+  auto specialized_or_default = [&](const AsyncValueRef<Executable>& value) {
+    if (value.IsUnavailable() && HasDefaultExecutable())
+      return default_executable_.CopyRef();
+    return value.CopyRef();
+  };
 
-    if (is_error)
-      return MakeStringError("Compilation of specialized function failed: ",
-                             StrCat(value.error));
+  // Operands with the sizes of the dimensions that are not specialized
+  // replaced by kDynamicSize.
+  llvm::SmallVector<MemrefDesc, 4> specialized(operands.begin(),
+                                               operands.end());
 
-    return value.executable.getPointer();
+  // Shape and value constraints require all the sizes, other operands can be
+  // compiled with dynamic dimensions.
+  auto has_dynamic_dimensions = [&](unsigned i) {
+    return constraints_[i] != OperandConstraint::kShape &&
+           constraints_[i] != OperandConstraint::kValue;
   };
 
-  // Reduce the scope of the lock to ensure that compilation happens without
-  // holding the lock.
+  Specializations& specs = *specializations_;
+  const size_t max_specializations =
+      std::max(compilation_opts_.max_specializations, 0);
+  const size_t max_dimension_sizes =
+      std::max(compilation_opts_.max_dimension_sizes, 0);
+
+  std::string key;
+  AsyncValueRef<Executable> executable;
   {
-    tfrt::mutex_lock lock(specializations_->mu);
-    auto it = specializations_->executables.find(hash);
-    if (it != specializations_->executables.end())
-      return convert(it->getSecond());
+    tfrt::mutex_lock lock(specs.mu);
+
+    // Finds the specialization and moves it to the front of the LRU list, or
+    // returns null if it is not in the cache.
+    auto find = [&]() -> AsyncValueRef<Executable> {
+      for (unsigned i = 0; i < specs.dimensions.size(); ++i) {
+        auto& sizes = specialized[i].sizes;
+        for (unsigned d = 0; d < specs.dimensions[i].size(); ++d)
+          if (d < sizes.size() && specs.dimensions[i][d].dynamic)
+            sizes[d] = mlir::ShapedType::kDynamicSize;
+      }
+
+      key = SpecializationKey(specialized, constraints_);
+      auto it = specs.executables.find(key);
+      if (it == specs.executables.end()) return {};
+      specs.lru.splice(specs.lru.begin(), specs.lru, it->second);
+      return it->second->second.CopyRef();
+    };
+
+    // Records the sizes of the operands dimensions, and returns true if some
+    // of them became dynamic.
+    auto record_dimension_sizes = [&]() {
+      if (max_dimension_sizes == 0) return false;
+      bool updated = false;
+      specs.dimensions.resize(operands.size());
+      for (unsigned i = 0; i < operands.size(); ++i) {
+        if (!has_dynamic_dimensions(i)) continue;
+        auto& dimensions = specs.dimensions[i];
+        if (dimensions.size() < operands[i].sizes.size())
+          dimensions.resize(operands[i].sizes.size());
+        for (unsigned d = 0; d < operands[i].sizes.size(); ++d) {
+          DimensionSizes& dimension = dimensions[d];
+          if (dimension.dynamic) continue;
+          dimension.sizes.insert(operands[i].sizes[d]);
+          if (dimension.sizes.size() <= max_dimension_sizes) continue;
+          dimension.dynamic = true;
+          dimension.sizes.clear();
+          ++specs.stats.num_dynamic_dimensions;
+          updated = true;
+        }
+      }
+      return updated;
+    };
+
+    // If a dimension became dynamic, the specialization with the dynamic
+    // dimension might already be in the cache.
+    AsyncValueRef<Executable> found = find();
+    if (!found && record_dimension_sizes()) found = find();
+    if (found) {
+      ++specs.stats.num_hits;
+      return specialized_or_default(found);
+    }
+    ++specs.stats.num_misses;
+
+    // Claim the compilation of the specialization by adding an unavailable
+    // async value that concurrent callers will find.
+    executable = MakeUnconstructedAsyncValueRef<Executable>();
+    specs.lru.emplace_front(key, executable.CopyRef());
+    specs.executables[key] = specs.lru.begin();
+
+    // Evict the least recently used specializations. Pending compilations are
+    // not evicted, because concurrent callers share them.
+    if (max_specializations > 0) {
+      auto it = specs.lru.end();
+      while (specs.executables.size() > max_specializations &&
+             it != specs.lru.begin()) {
+        --it;
+        if (it->second.IsUnavailable()) continue;
+        specs.executables.erase(it->first);
+        it = specs.lru.erase(it);
+        ++specs.stats.num_evictions;
+      }
+    }
   }
 
+  // Removes the claimed specialization from the cache and forwards the error
+  // to the callers waiting for it, so that a later call can try again.
+  auto abandon = [&](Error err) -> AsyncValueRef<Executable> {
+    {
+      tfrt::mutex_lock lock(specs.mu);
+      auto it = specs.executables.find(key);
+      if (it != specs.executables.end()) {
+        specs.lru.erase(it->second);
+        specs.executables.erase(it);
+      }
+    }
+    executable.SetError(err);
+    return executable.CopyRef();
+  };
+
   // Try to instantiate compilation context from the mlir source.
   Expected<std::unique_ptr<JitCompilationContext>> ctx =
-      JitCompilationContext::Instantiate(compilation_opts_, mlir_module_);
+      JitCompilationContext::Instantiate(compilation_opts_, mlir_module_,
+                                         stats_);
   if (auto err = ctx.takeError()) {
     assert(false && "parsing mlir module must always succeed at this point");
-    return std::move(err);
+    return abandon(std::move(err));
   }
 
-  // Specialize executable to the concrete operands.
-  if (auto err = (*ctx)->Specialize(operands, constraints_, entrypoint_))
-    return MakeStringError("Failed to specialize executable: ", err);
+  // Specialize executable to the concrete operands. This must be done on the
+  // caller thread, because sinking values reads the operands data.
+  if (auto err = (*ctx)->Specialize(specialized, constraints_, entrypoint_))
+    return abandon(MakeStringError("Failed to specialize executable: ", err));
+
+  // Lowering and LLVM code generation are expensive, and run on the blocking
+  // work queue to avoid stalling the caller thread.
+  bool enqueued = EnqueueBlockingWork(
+      exec_ctx, [ctx = std::move(*ctx), entrypoint = entrypoint_,
+                 executable = executable.CopyRef(),
+                 specializations = specializations_]() mutable {
+        auto start = std::chrono::steady_clock::now();
+        Expected<Executable> compiled =
+            JitCompilationContext::Compile(std::move(ctx), entrypoint);
+        uint64_t compile_time_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+
+        RecordSpecializationCompileTime(compile_time_us);
+        {
+          tfrt::mutex_lock lock(specializations->mu);
+          specializations->stats.compile_time_us += compile_time_us;
+        }
+
+        // Errors are cached together with the compiled executables, because
+        // compiling the same specialization again will fail again.
+        if (auto err = compiled.takeError()) {
+          executable.SetError(StrCat(
+              "Compilation of specialized function failed: ", err));
+          return;
+        }
+        executable.emplace(std::move(*compiled));
+      });
+  if (!enqueued)
+    return abandon(MakeStringError("failed to enqueue the compilation"));
+
+  return specialized_or_default(executable);
+}
+
+JitExecutable::SpecializationStats JitExecutable::GetSpecializationStats()
+    const {
+  tfrt::mutex_lock lock(specializations_->mu);
+  return specializations_->stats;
+}
+
+//----------------------------------------------------------------------------//
+// Default executables compiled ahead of time.
+//----------------------------------------------------------------------------//
+
+// Version of the native objects with executables compiled ahead of time. It
+// must be updated when the lowering to LLVM, the calling convention of the
+// compiled kernels or the format of the native objects changes.
+static constexpr const char* const kAotExecutableVersion = "cpurt-aot-v1";
+
+std::string GetAotExecutableKey(string_view mlir_module,
+                                string_view entrypoint) {
+  llvm::MD5 md5;
+  md5.update(mlir_module);
+  md5.update(llvm::StringRef("\0", 1));
+  md5.update(entrypoint);
+
+  llvm::MD5::MD5Result result;
+  md5.final(result);
+  llvm::SmallString<32> hex;
+  llvm::MD5::stringifyResult(result, hex);
+  return hex.str().str();
+}
+
+// The native object of an executable compiled ahead of time is a sequence of
+// size prefixed fields: the version, the LLVM version, the host CPU and its
+// features, the kernel function symbol, the entrypoint signature, the operands
+// constraints and the object file.
+namespace {
+struct AotExecutableFields {
+  string_view version;
+  string_view llvm_version;
+  string_view cpu_name;
+  string_view cpu_features;
+  string_view kernel_symbol;
+  string_view signature;
+  string_view constraints;
+  string_view object;
+};
+}  // namespace
 
-  // Compile the specialized executable.
+static void AppendField(std::string* data, string_view field) {
+  uint64_t size = field.size();
+  data->append(reinterpret_cast<const char*>(&size), sizeof(size));
+  data->append(field.data(), field.size());
+}
+
+static bool ReadField(string_view* data, string_view* field) {
+  uint64_t size;
+  if (data->size() < sizeof(size)) return false;
+  std::memcpy(&size, data->data(), sizeof(size));
+  *data = data->drop_front(sizeof(size));
+  if (data->size() < size) return false;
+  *field = data->take_front(size);
+  *data = data->drop_front(size);
+  return true;
+}
+
+Expected<Optional<std::string>> CompileAotExecutable(
+    string_view mlir_module, string_view entrypoint,
+    const CompilationOptions& compilation_opts) {
+  InitializeCompiler();
+
+  // The object file is taken from the compilation, not from the cache.
+  CompilationOptions opts = compilation_opts;
+  opts.object_cache_dir.clear();
+
+  Expected<std::unique_ptr<JitCompilationContext>> ctx =
+      JitCompilationContext::Instantiate(opts, mlir_module);
+  if (auto err = ctx.takeError()) return std::move(err);
+
+  auto constraints = GetOperandsConstraints((*ctx)->module(), entrypoint);
+  if (auto err = constraints.takeError()) return std::move(err);
+
+  // Modules that must be specialized do not have a default executable.
+  if (IsSpecializationOnly(*constraints)) return {llvm::None};
+
+  AotObject aot_object;
   Expected<Executable> executable =
-      JitCompilationContext::Compile(std::move(*ctx), entrypoint_);
+      JitCompilationContext::Compile(std::move(*ctx), entrypoint, &aot_object);
+  if (auto err = executable.takeError()) return std::move(err);
 
-  // Update the specialized executables cache with an error or the value.
-  tfrt::mutex_lock lock(specializations_->mu);
+  std::string signature;
+  llvm::raw_string_ostream signature_os(signature);
+  signature_os << executable->signature();
+
+  std::string constraints_str;
+  for (OperandConstraint constraint : *constraints)
+    constraints_str.push_back(static_cast<char>(constraint));
+
+  std::string data;
+  AppendField(&data, kAotExecutableVersion);
+  AppendField(&data, LLVM_VERSION_STRING);
+  AppendField(&data, llvm::sys::getHostCPUName());
+  AppendField(&data, GetHostCpuFeatures());
+  AppendField(&data, aot_object.kernel_symbol);
+  AppendField(&data, signature_os.str());
+  AppendField(&data, constraints_str);
+  AppendField(&data, aot_object.object);
+  return {std::move(data)};
+}
 
-  // Concurrent thread updated the cache before us.
-  auto it = specializations_->executables.find(hash);
-  if (it != specializations_->executables.end())
-    return convert(it->getSecond());
-
-  // Update the cache with a compilation error.
-  if (auto err = executable.takeError()) {
-    auto emplaced =
-        specializations_->executables.try_emplace(hash, std::move(err));
-    assert(emplaced.second && "error must be successfully emplaced");
-    return convert(emplaced.first->getSecond());
+Error LoadAotExecutable(string_view key, ArrayRef<uint8_t> data) {
+  AotExecutableFields fields;
+  string_view remaining(reinterpret_cast<const char*>(data.data()),
+                        data.size());
+  if (!ReadField(&remaining, &fields.version) ||
+      !ReadField(&remaining, &fields.llvm_version) ||
+      !ReadField(&remaining, &fields.cpu_name) ||
+      !ReadField(&remaining, &fields.cpu_features) ||
+      !ReadField(&remaining, &fields.kernel_symbol) ||
+      !ReadField(&remaining, &fields.signature) ||
+      !ReadField(&remaining, &fields.constraints) ||
+      !ReadField(&remaining, &fields.object) || !remaining.empty())
+    return MakeStringError("malformed cpurt native object");
+
+  if (fields.version != kAotExecutableVersion ||
+      fields.llvm_version != LLVM_VERSION_STRING)
+    return MakeStringError("cpurt native object was compiled by another "
+                           "version of the compiler");
+
+  // The object may use instructions that are not supported by the host CPU.
+  if (fields.cpu_name != llvm::sys::getHostCPUName() ||
+      fields.cpu_features != GetHostCpuFeatures())
+    return MakeStringError("cpurt native object was compiled for another CPU: ",
+                           fields.cpu_name);
+
+  AotExecutables& aot_executables = GetAotExecutables();
+  {
+    tfrt::mutex_lock lock(aot_executables.mu);
+    if (aot_executables.executables.count(key)) return Error::success();
   }
 
-  // Or update the cache with a compiled executable.
-  auto emplaced =
-      specializations_->executables.try_emplace(hash, std::move(*executable));
-  assert(emplaced.second && "executable must be successfully emplaced");
-  return convert(emplaced.first->getSecond());
+  InitializeCompiler();
+
+  // The signature is the only part of the module that is parsed at runtime.
+  auto context = CreateMlirContext(CompilationOptions());
+  auto signature = mlir::parseType(fields.signature, context.get())
+                       .dyn_cast_or_null<mlir::FunctionType>();
+  if (!signature)
+    return MakeStringError("failed to parse the entrypoint signature: ",
+                           fields.signature);
+
+  auto results_memory_layout = Executable::VerifyEntrypointSignature(signature);
+  if (auto err = results_memory_layout.takeError()) return err;
+
+  llvm::SmallVector<OperandConstraint> constraints;
+  for (char constraint : fields.constraints)
+    constraints.push_back(static_cast<OperandConstraint>(constraint));
+  if (constraints.size() != signature.getNumInputs())
+    return MakeStringError("malformed cpurt native object constraints");
+
+  Expected<std::unique_ptr<llvm::orc::LLJIT>> jit =
+      LoadObject(llvm::MemoryBuffer::getMemBufferCopy(fields.object));
+  if (auto err = jit.takeError()) return err;
+
+  auto fptr = (*jit)->lookup(fields.kernel_symbol);
+  if (auto err = fptr.takeError()) return err;
+
+  Executable executable(
+      std::move(context), std::move(*jit), signature,
+      reinterpret_cast<Executable::KernelFunctionPtr>(fptr->getAddress()),
+      std::move(*results_memory_layout));
+
+  // The key is the module fingerprint used in the kernel names, and the
+  // kernel function symbol is the entrypoint with the "_mlir_" prefix.
+  string_view kernel_entrypoint = fields.kernel_symbol;
+  kernel_entrypoint.consume_front("_mlir_");
+  executable.set_kernel_stats(GetKernelStatsEntry(
+      StrCat(kernel_entrypoint, "@", key.substr(0, 8))));
+
+  tfrt::mutex_lock lock(aot_executables.mu);
+  aot_executables.executables.try_emplace(
+      key, AotExecutable{
+               MakeAvailableAsyncValueRef<Executable>(std::move(executable)),
+               std::move(constraints)});
+  return Error::success();
 }
 
 //----------------------------------------------------------------------------//
 // JitExecutableCache implementation.
 //----------------------------------------------------------------------------//
 
-AsyncValueRef<JitExecutable> JitExecutableCache::Find(intptr_t key) const {
+// Process-wide JitExecutables shared by the caches of all host contexts, and
+// the number of caches that use them.
+namespace {
+struct SharedJitExecutables {
+  struct Entry {
+    AsyncValueRef<JitExecutable> jit_executable;
+    int64_t num_users = 0;
+  };
+
+  mutex mu;
+  llvm::StringMap<Entry> entries TFRT_GUARDED_BY(mu);
+};
+}  // namespace
+
+static SharedJitExecutables& GetSharedJitExecutables() {
+  static auto* shared = new SharedJitExecutables;
+  return *shared;
+}
+
+// Returns the key of the shared JitExecutable: the module content fingerprint
+// and all the compilation options that change the compiled executables.
+static std::string GetSharedJitExecutableKey(string_view mlir_module,
+                                             string_view entrypoint,
+                                             const CompilationOptions& opts) {
+  std::string bucket_sizes;
+  for (ssize_t size : opts.bucket_sizes) StrAppend(&bucket_sizes, size, ",");
+  return StrCat(
+      GetAotExecutableKey(mlir_module, entrypoint), ":", opts.alignment, ":",
+      opts.num_worker_threads, ":",
+      opts.jit_code_opt_level ? *opts.jit_code_opt_level : -1, ":",
+      opts.disable_specializations, ":", opts.max_specializations, ":",
+      opts.max_dimension_sizes, ":", opts.tiered_compilation_threshold, ":",
+      opts.object_cache_dir, ":", bucket_sizes);
+}
+
+// An empty slot of the JitExecutableCache. Locations are offsets or addresses
+// in the BEF file, and are never negative.
+static constexpr intptr_t kEmptySlot = -1;
+
+struct JitExecutableCache::Slot {
+  std::atomic<intptr_t> location{kEmptySlot};
+  std::atomic<AsyncValue*> jit_executable{nullptr};  // owns a reference
+};
+
+// The number of slots in the JitExecutableCache, must be a power of two.
+static constexpr size_t kNumSlots = 1024;
+
+static size_t GetSlotIndex(intptr_t location) {
+  return llvm::hash_value(location) & (kNumSlots - 1);
+}
+
+JitExecutableCache::JitExecutableCache() : slots_(new Slot[kNumSlots]) {}
+
+JitExecutableCache::~JitExecutableCache() {
+  for (size_t i = 0; i < kNumSlots; ++i)
+    if (AsyncValue* jit_executable = slots_[i].jit_executable.load())
+      jit_executable->DropRef();
+
+  // Release the shared JitExecutables that are no longer used by any cache.
+  SharedJitExecutables& shared = GetSharedJitExecutables();
+  tfrt::mutex_lock lock(shared.mu);
+  for (const std::string& key : shared_keys_) {
+    auto it = shared.entries.find(key);
+    assert(it != shared.entries.end() && "shared JitExecutable not found");
+    if (--it->second.num_users == 0) shared.entries.erase(it);
+  }
+}
+
+const ResourceSlot<JitExecutableCache>& JitExecutableCache::GetResourceSlot() {
+  static const auto* slot = new ResourceSlot<JitExecutableCache>;
+  return *slot;
+}
+
+AsyncValueRef<JitExecutable> JitExecutableCache::Find(intptr_t location) const {
+  for (size_t i = GetSlotIndex(location), probe = 0; probe < kNumSlots;
+       i = (i + 1) & (kNumSlots - 1), ++probe) {
+    intptr_t slot_location = slots_[i].location.load(std::memory_order_acquire);
+    if (slot_location == kEmptySlot) return {};
+    if (slot_location != location) continue;
+    AsyncValue* jit_executable =
+        slots_[i].jit_executable.load(std::memory_order_relaxed);
+    return AsyncValueRef<JitExecutable>(FormRef(jit_executable));
+  }
+
+  // All the slots are used, the executable might be in the overflow map.
   tfrt::mutex_lock lock(mu_);
-  auto it = cache_.find(key);
-  if (it != cache_.end()) return it->second.CopyRef();
-  return AsyncValueRef<JitExecutable>();
+  auto it = overflow_.find(location);
+  if (it != overflow_.end()) return it->second.CopyRef();
+  return {};
 }
 
 AsyncValueRef<JitExecutable> JitExecutableCache::Insert(
-    intptr_t key, JitExecutable jit_executable) {
-  tfrt::mutex_lock lock(mu_);
-  auto it = cache_.find(key);
-  if (it != cache_.end()) return it->second.CopyRef();
+    intptr_t location, AsyncValueRef<JitExecutable> jit_executable) {
+  for (size_t i = GetSlotIndex(location), probe = 0; probe < kNumSlots;
+       i = (i + 1) & (kNumSlots - 1), ++probe) {
+    intptr_t slot_location = slots_[i].location.load(std::memory_order_relaxed);
+    if (slot_location == location) {
+      return AsyncValueRef<JitExecutable>(
+          FormRef(slots_[i].jit_executable.load(std::memory_order_relaxed)));
+    }
+    if (slot_location != kEmptySlot) continue;
+
+    // Publish the executable before the location, because Find() reads the
+    // executable once it sees the location.
+    slots_[i].jit_executable.store(jit_executable.CopyRef().release(),
+                                   std::memory_order_relaxed);
+    slots_[i].location.store(location, std::memory_order_release);
+    return jit_executable;
+  }
+
+  auto emplaced = overflow_.try_emplace(location, std::move(jit_executable));
+  return emplaced.first->second.CopyRef();
+}
+
+Expected<AsyncValueRef<JitExecutable>> JitExecutableCache::GetOrInstantiate(
+    intptr_t location, string_view mlir_module, string_view entrypoint,
+    const CompilationOptions& opts) {
+  assert(location != kEmptySlot && "invalid kernel location");
 
-  auto emplaced =
-      cache_.try_emplace(key, MakeAvailableAsyncValueRef<JitExecutable>(
-                                  host_, std::move(jit_executable)));
-  return emplaced.first->getSecond().CopyRef();
+  // Compilation callbacks can't be compared, so the executable is not shared.
+  if (opts.register_dialects || opts.register_pass_pipeline) {
+    Expected<JitExecutable> jit_executable =
+        JitExecutable::Instantiate(mlir_module, entrypoint, opts);
+    if (auto err = jit_executable.takeError()) return std::move(err);
+
+    tfrt::mutex_lock lock(mu_);
+    return Insert(location, MakeAvailableAsyncValueRef<JitExecutable>(
+                                std::move(*jit_executable)));
+  }
+
+  std::string key = GetSharedJitExecutableKey(mlir_module, entrypoint, opts);
+
+  // Instantiation is done under the lock, so that concurrent caches do not
+  // compile the same module. It only happens on the first execution of each
+  // compile kernel.
+  SharedJitExecutables& shared = GetSharedJitExecutables();
+  tfrt::mutex_lock shared_lock(shared.mu);
+
+  SharedJitExecutables::Entry& entry = shared.entries[key];
+  if (!entry.jit_executable) {
+    Expected<JitExecutable> jit_executable =
+        JitExecutable::Instantiate(mlir_module, entrypoint, opts);
+    if (auto err = jit_executable.takeError()) {
+      shared.entries.erase(key);
+      return std::move(err);
+    }
+    // Shared executables are not allocated with the host allocator, because
+    // they can outlive the host context.
+    entry.jit_executable =
+        MakeAvailableAsyncValueRef<JitExecutable>(std::move(*jit_executable));
+  }
+
+  // Insert returns the cached executable if another thread inserted it while
+  // this one was waiting for the lock.
+  tfrt::mutex_lock lock(mu_);
+  if (!llvm::is_contained(shared_keys_, key)) {
+    ++entry.num_users;
+    shared_keys_.push_back(std::move(key));
+  }
+  return Insert(location, entry.jit_executable.CopyRef());
 }
 
 }  // namespace jit
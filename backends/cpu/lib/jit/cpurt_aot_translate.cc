@@ -0,0 +1,62 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- cpurt_aot_translate.cc - CPURT ahead-of-time compilation -----------===//
+//
+// This file implements the translation from MLIR to BEF with the default
+// executables of the CPURT kernels compiled ahead of time.
+
+#include "tfrt/cpu/jit/cpurt_aot_translate.h"
+
+#include <string>
+#include <utility>
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Support/LogicalResult.h"
+#include "tfrt/bef_converter/mlir_to_bef.h"
+#include "tfrt/bef_converter/mlir_to_bef_translate.h"
+#include "tfrt/cpu/jit/cpurt.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace cpu {
+namespace jit {
+
+static Expected<Optional<BEFNativeObject>> CompileCpurtKernel(
+    string_view mlir_module, string_view entrypoint) {
+  // The compile kernels use the default compilation options, which must match
+  // the options used to compile the executable ahead of time.
+  Expected<Optional<std::string>> object =
+      CompileAotExecutable(mlir_module, entrypoint, CompilationOptions());
+  if (auto err = object.takeError()) return std::move(err);
+  if (!object->hasValue()) return {llvm::None};
+
+  return {BEFNativeObject{kAotExecutableKind,
+                          GetAotExecutableKey(mlir_module, entrypoint),
+                          std::move(object->getValue())}};
+}
+
+mlir::LogicalResult MLIRToBEFCpurtAotTranslate(mlir::ModuleOp module,
+                                               llvm::raw_ostream& output) {
+  BEFNativeObjectCompiler compiler;
+  compiler.kernels = {"cpurt.compile", "cpurt.corert.compile"};
+  compiler.compile = CompileCpurtKernel;
+  return MLIRToBEFWithNativeObjectsTranslate(module, output, compiler);
+}
+
+}  // namespace jit
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file uses a static constructor to register the mlir-to-bef-cpurt-aot
+// translation, which converts an mlir file to a bef file with the CPURT kernels
+// compiled ahead of time for the host CPU.
+
+#include "mlir/Translation.h"
+#include "tfrt/cpu/jit/cpurt_aot_translate.h"
+#include "tfrt/init_tfrt_dialects.h"
+
+namespace tfrt {
+namespace cpu {
+namespace jit {
+
+static mlir::TranslateFromMLIRRegistration registration(
+    "mlir-to-bef-cpurt-aot", MLIRToBEFCpurtAotTranslate,
+    [](mlir::DialectRegistry& registry) {
+      RegisterTFRTDialects(registry);
+      RegisterTFRTCompiledDialects(registry);
+    });
+
+}  // namespace jit
+}  // namespace cpu
+}  // namespace tfrt
@@ -65,11 +65,11 @@ static AsyncValueRef<JitExecutable> Compile(CompilationUnitAttribute kernel,
         exec_ctx, "compiled kernel must be referenced by one nested symbol");
 
   ResourceContext* res_ctx = exec_ctx.resource_context();
-  auto* jit_executable_cache =
-      res_ctx->GetOrCreateResource<JitExecutableCache>("cpurt.cache", host);
+  auto* jit_executable_cache = res_ctx->GetOrCreateResource(
+      JitExecutableCache::GetResourceSlot());
 
-  // TODO(ezhulenev): Compute cache key based on the content of MLIR module, or
-  // better keep module fingerprint in the BEF file.
+  // Executables are cached by the kernel location in the BEF file, and shared
+  // between the caches of all host contexts by the MLIR module content.
   intptr_t key = exec_ctx.location().data;
 
   // Maybe return JitExecutable from the cache.
@@ -77,18 +77,20 @@ static AsyncValueRef<JitExecutable> Compile(CompilationUnitAttribute kernel,
 
   CompilationOptions opts;
   opts.num_worker_threads = host->GetNumWorkerThreads();
+  opts.object_cache_dir = GetObjectCacheDirFromEnv();
+  opts.tiered_compilation_threshold = GetTieredCompilationThresholdFromEnv();
 
   string_view entrypoint = kernel.nested_symbols()[0];
   string_view module = kernel.serialized_operation();
 
-  // Instantiate new JitExecutable from the MLIR source.
-  Expected<JitExecutable> jit_executable =
-      JitExecutable::Instantiate(module, entrypoint, opts);
+  // Instantiate new JitExecutable from the MLIR source, or get the one
+  // instantiated for the same module by another host context.
+  Expected<AsyncValueRef<JitExecutable>> jit_executable =
+      jit_executable_cache->GetOrInstantiate(key, module, entrypoint, opts);
   if (auto err = jit_executable.takeError())
     return EmitErrorAsync(exec_ctx, std::move(err));
 
-  // Update the JitExecutable cache and return the result.
-  return jit_executable_cache->Insert(key, std::move(*jit_executable));
+  return std::move(*jit_executable);
 }
 
 // -------------------------------------------------------------------------- //
@@ -110,33 +112,30 @@ static Error ConvertTensorHandleOperandsToMemrefDesc(
     const Tensor& tensor = operands[i].GetAsyncTensor()->get<Tensor>();
     Expected<MemrefDesc> memref = ConvertTensorToMemrefDesc(tensor);
     if (auto err = memref.takeError()) return err;
-    memrefs->push_back(*memref);
+    memrefs->push_back(std::move(*memref));
   }
 
   return Error::success();
 }
 
-static void CoreRtExecute(Argument<JitExecutable> jit_executable,
-                          RepeatedArguments<TensorHandle> operands,
-                          RemainingResults results,
-                          const ExecutionContext& exec_ctx) {
+// Executes the available `executable` with `memrefs` operands, and returns true
+// if some of the `results` are not available yet.
+static bool CoreRtExecuteImpl(const AsyncValueRef<Executable>& executable,
+                              ArrayRef<MemrefDesc> memrefs,
+                              RemainingResults results,
+                              const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
 
-  // Extract tensors from tensor handle operands to pass them as the compiled
-  // kernel arguments.
-  SmallVector<MemrefDesc, 4> memrefs;
-  if (auto err = ConvertTensorHandleOperandsToMemrefDesc(operands, &memrefs))
-    return EmitErrors(results, std::move(err), exec_ctx);
-
-  // Get an executable that might be specialized to the operands.
-  Expected<const Executable*> executable =
-      jit_executable->GetExecutable(memrefs);
-  if (auto err = executable.takeError())
-    return EmitErrors(results, std::move(err), exec_ctx);
+  // Forward the specialization compilation error to all results.
+  if (executable.IsError()) {
+    for (size_t i = 0; i < results.size(); ++i)
+      results[i] = executable.CopyRCRef();
+    return false;
+  }
 
   // Allocate storage for compiled kernel results.
   SmallVector<RCReference<AsyncValue>, 4> kernel_ret;
-  kernel_ret.resize((*executable)->signature().getNumResults());
+  kernel_ret.resize(executable->signature().getNumResults());
 
   // Execute compiled kernel and get back raw return values that we'll need to
   // wrap into TensorHandles later on.
@@ -145,7 +144,7 @@ static void CoreRtExecute(Argument<JitExecutable> jit_executable,
   converter.AddConversion(ReturnAsyncMemrefAsDenseHostTensor<ConversionCtx>);
   // We skip error handling at this point and rely on error forwarding to the
   // kernel results below.
-  auto err = (*executable)->Execute(memrefs, converter, exec_ctx);
+  auto err = executable->Execute(memrefs, converter, exec_ctx);
   (void)err;
 
   // Compiled kernel should populate all expected results.
@@ -187,14 +186,60 @@ static void CoreRtExecute(Argument<JitExecutable> jit_executable,
     });
   }
 
-  // Keep operands alive if we have unavailable results.
-  if (unavailable_kernel_ret)
-    RunWhenReady(kernel_ret, [o = RCArray<AsyncValue>(operands.values())] {});
+  return unavailable_kernel_ret;
+}
+
+static void CoreRtExecute(Argument<JitExecutable> jit_executable,
+                          RepeatedArguments<TensorHandle> operands,
+                          RemainingResults results,
+                          const ExecutionContext& exec_ctx) {
+  // Extract tensors from tensor handle operands to pass them as the compiled
+  // kernel arguments.
+  SmallVector<MemrefDesc, 4> memrefs;
+  if (auto err = ConvertTensorHandleOperandsToMemrefDesc(operands, &memrefs))
+    return EmitErrors(results, std::move(err), exec_ctx);
+
+  // Get an executable that might be specialized to the operands.
+  AsyncValueRef<Executable> executable =
+      jit_executable->GetExecutable(memrefs, exec_ctx);
+
+  // Fast path when the executable is available synchronously.
+  if (executable.IsAvailable()) {
+    // Keep operands and the executable, which can be evicted from the
+    // specializations cache, alive if we have unavailable results.
+    if (CoreRtExecuteImpl(executable, memrefs, results, exec_ctx))
+      RunWhenReady(results.values(),
+                   [o = RCArray<AsyncValue>(operands.values()),
+                    e = std::move(executable)] {});
+    return;
+  }
+
+  // Slow path when the executable is being compiled: execute it once the
+  // compilation is completed, and forward its results to indirect results.
+  SmallVector<RCReference<IndirectAsyncValue>, 4> indirect_results;
+  for (size_t i = 0; i < results.size(); ++i)
+    indirect_results.push_back(results.AllocateIndirectResultAt(i));
+
+  executable.AndThen([executable = executable.CopyRef(), memrefs,
+                      indirect_results = std::move(indirect_results),
+                      exec_ctx]() {
+    SmallVector<RCReference<AsyncValue>, 4> values(indirect_results.size());
+    CoreRtExecuteImpl(executable, memrefs, {exec_ctx.host(), values},
+                      exec_ctx);
+    for (size_t i = 0; i < values.size(); ++i)
+      indirect_results[i]->ForwardTo(std::move(values[i]));
+  });
+
+  // Keep operands alive until the results are available.
+  RunWhenReady(results.values(),
+               [o = RCArray<AsyncValue>(operands.values()),
+                e = std::move(executable)] {});
 }
 
 void RegisterCpuRuntimeCoreRtKernels(KernelRegistry* registry) {
   registry->AddKernel("cpurt.corert.compile", TFRT_KERNEL(Compile));
   registry->AddKernel("cpurt.corert.execute", TFRT_KERNEL(CoreRtExecute));
+  registry->AddNativeObjectLoader(kAotExecutableKind, LoadAotExecutable);
 }
 
 }  // namespace jit
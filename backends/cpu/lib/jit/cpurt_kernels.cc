@@ -21,6 +21,7 @@
 #include <sys/types.h>
 
 #include <cstdint>
+#include <cstring>
 #include <memory>
 
 #include "tfrt/cpu/jit/cpurt.h"
@@ -31,6 +32,7 @@
 #include "tfrt/host_context/attribute_utils.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_buffer.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/kernel_utils.h"
@@ -60,11 +62,11 @@ static AsyncValueRef<JitExecutable> Compile(CompilationUnitAttribute kernel,
         exec_ctx, "compiled kernel must be referenced by one nested symbol");
 
   ResourceContext* res_ctx = exec_ctx.resource_context();
-  auto* jit_executable_cache =
-      res_ctx->GetOrCreateResource<JitExecutableCache>("cpurt.cache", host);
+  auto* jit_executable_cache = res_ctx->GetOrCreateResource(
+      JitExecutableCache::GetResourceSlot());
 
-  // TODO(ezhulenev): Compute cache key based on the content of MLIR module, or
-  // better keep module fingerprint in the BEF file.
+  // Executables are cached by the kernel location in the BEF file, and shared
+  // between the caches of all host contexts by the MLIR module content.
   intptr_t key = exec_ctx.location().data;
 
   // Maybe return JitExecutable from the cache.
@@ -72,18 +74,21 @@ static AsyncValueRef<JitExecutable> Compile(CompilationUnitAttribute kernel,
 
   CompilationOptions opts;
   opts.num_worker_threads = host->GetNumWorkerThreads();
+  opts.object_cache_dir = GetObjectCacheDirFromEnv();
+  opts.tiered_compilation_threshold = GetTieredCompilationThresholdFromEnv();
+  opts.bucket_sizes = GetBucketSizesFromEnv();
 
   string_view entrypoint = kernel.nested_symbols()[0];
   string_view module = kernel.serialized_operation();
 
-  // Instantiate new JitExecutable from the MLIR source.
-  Expected<JitExecutable> jit_executable =
-      JitExecutable::Instantiate(module, entrypoint, opts);
+  // Instantiate new JitExecutable from the MLIR source, or get the one
+  // instantiated for the same module by another host context.
+  Expected<AsyncValueRef<JitExecutable>> jit_executable =
+      jit_executable_cache->GetOrInstantiate(key, module, entrypoint, opts);
   if (auto err = jit_executable.takeError())
     return EmitErrorAsync(exec_ctx, std::move(err));
 
-  // Update the JitExecutable cache and return the result.
-  return jit_executable_cache->Insert(key, std::move(*jit_executable));
+  return std::move(*jit_executable);
 }
 
 // -------------------------------------------------------------------------- //
@@ -103,12 +108,155 @@ static Error ConvertTensorOperandsToMemrefDesc(
   for (unsigned i = 0; i < operands.size(); ++i) {
     Expected<MemrefDesc> memref = ConvertTensorToMemrefDesc(operands[i]);
     if (auto err = memref.takeError()) return err;
-    memrefs->push_back(*memref);
+    memrefs->push_back(std::move(*memref));
   }
 
   return Error::success();
 }
 
+// Executes the available `executable` with `memrefs` operands.
+static void ExecuteImpl(const AsyncValueRef<Executable>& executable,
+                        ArrayRef<MemrefDesc> memrefs, RemainingResults results,
+                        const ExecutionContext& exec_ctx) {
+  // Forward the specialization compilation error to all results.
+  if (executable.IsError()) {
+    for (size_t i = 0; i < results.size(); ++i)
+      results[i] = executable.CopyRCRef();
+    return;
+  }
+
+  // If execution failed errors will be automatically allocated for all results.
+  ReturnValueConverter<ConversionCtx> converter(results);
+  converter.AddConversion(ReturnAsyncToken<ConversionCtx>);
+  converter.AddConversion(ReturnAsyncMemrefAsDenseHostTensor<ConversionCtx>);
+  converter.AddConversion(ReturnMemrefAsDenseHostTensor<ConversionCtx>);
+
+  if (auto err = executable->Execute(memrefs, converter, exec_ctx)) return;
+}
+
+// Executes the executable that `jit_executable` returns for `memrefs`, and
+// returns it to keep it alive until the results are available.
+static AsyncValueRef<Executable> ExecuteMemrefs(
+    JitExecutable& jit_executable, ArrayRef<MemrefDesc> memrefs,
+    RemainingResults results, const ExecutionContext& exec_ctx) {
+  // Get an executable that might be specialized to the operands.
+  AsyncValueRef<Executable> executable =
+      jit_executable.GetExecutable(memrefs, exec_ctx);
+
+  // Fast path when the executable is available synchronously.
+  if (executable.IsAvailable()) {
+    ExecuteImpl(executable, memrefs, results, exec_ctx);
+    return executable;
+  }
+
+  // Slow path when the executable is being compiled: execute it once the
+  // compilation is completed, and forward its results to indirect results.
+  SmallVector<RCReference<IndirectAsyncValue>, 4> indirect_results;
+  for (size_t i = 0; i < results.size(); ++i)
+    indirect_results.push_back(results.AllocateIndirectResultAt(i));
+
+  executable.AndThen([executable = executable.CopyRef(),
+                      memrefs = SmallVector<MemrefDesc, 4>(memrefs.begin(),
+                                                           memrefs.end()),
+                      indirect_results = std::move(indirect_results),
+                      exec_ctx]() {
+    SmallVector<RCReference<AsyncValue>, 4> values(indirect_results.size());
+    ExecuteImpl(executable, memrefs, {exec_ctx.host(), values}, exec_ctx);
+    for (size_t i = 0; i < values.size(); ++i)
+      indirect_results[i]->ForwardTo(std::move(values[i]));
+  });
+  return executable;
+}
+
+// -------------------------------------------------------------------------- //
+// Shape bucketing of the operands and results of bucketed kernels.
+// -------------------------------------------------------------------------- //
+
+// Pads the leading dimension of the `memrefs` operands with zero rows to the
+// bucket size, and returns the number of rows of the operands. The padded
+// operands are allocated in `padded`, which must be kept alive until the
+// execution completes.
+static Expected<ssize_t> PadToBucket(const JitExecutable& jit_executable,
+                                     MutableArrayRef<MemrefDesc> memrefs,
+                                     SmallVectorImpl<DenseHostTensor>* padded,
+                                     const ExecutionContext& exec_ctx) {
+  if (memrefs.empty() || memrefs[0].sizes.empty())
+    return MakeStringError("bucketed kernel operands must have a leading "
+                           "dimension");
+  ssize_t num_rows = memrefs[0].sizes[0];
+  for (const MemrefDesc& memref : memrefs) {
+    if (memref.sizes.empty() || memref.sizes[0] != num_rows)
+      return MakeStringError("bucketed kernel operands must have the same "
+                             "leading dimension");
+  }
+
+  ssize_t bucket_size = jit_executable.GetBucketSize(num_rows);
+  if (bucket_size == num_rows) return num_rows;
+
+  for (MemrefDesc& memref : memrefs) {
+    size_t element_size = memref.dtype.GetHostSize();
+    size_t row_size = element_size;
+    for (size_t i = 1; i < memref.sizes.size(); ++i)
+      row_size *= memref.sizes[i];
+
+    memref.sizes[0] = bucket_size;
+    TensorMetadata metadata(memref.dtype, memref.sizes);
+    auto dht = DenseHostTensor::CreateUninitialized(metadata, exec_ctx);
+    if (!dht) return MakeStringError("cannot allocate padded operand");
+
+    char* data = static_cast<char*>(dht->data());
+    size_t size = row_size * num_rows;
+    std::memcpy(data,
+                static_cast<char*>(memref.data) + memref.offset * element_size,
+                size);
+    std::memset(data + size, 0, row_size * bucket_size - size);
+
+    memref.data = data;
+    memref.offset = 0;
+    padded->push_back(std::move(*dht));
+  }
+  return num_rows;
+}
+
+// Slices the `num_rows` leading rows of a dense host tensor result of a
+// bucketed kernel executed with padded operands. Other results (e.g. async
+// tokens) and errors are returned unchanged.
+static RCReference<AsyncValue> SliceToRows(RCReference<AsyncValue> result,
+                                           ssize_t num_rows,
+                                           ssize_t bucket_size,
+                                           HostContext* host) {
+  auto slice = [num_rows, bucket_size,
+                host](AsyncValue* value) -> RCReference<AsyncValue> {
+    if (value->IsError() || !value->IsType<DenseHostTensor>())
+      return FormRef(value);
+
+    const auto& dht = value->get<DenseHostTensor>();
+    SmallVector<ssize_t, 4> dims;
+    dht.shape().GetDimensions(&dims);
+    if (dims.empty() || dims[0] != bucket_size)
+      return MakeErrorAsyncValueRef(
+          "bucketed kernel result must have the leading dimension of its "
+          "operands");
+
+    size_t row_size = dims[0] ? dht.DataSizeInBytes() / dims[0] : 0;
+    dims[0] = num_rows;
+    return MakeAvailableAsyncValueRef<DenseHostTensor>(
+        host, TensorMetadata(dht.dtype(), dims),
+        HostBuffer::CreateFromExternal(dht.buffer().CopyRef(), /*offset=*/0,
+                                       row_size * num_rows));
+  };
+
+  if (result->IsAvailable()) return slice(result.get());
+
+  auto sliced = MakeIndirectAsyncValue(host);
+  AsyncValue* value = result.get();
+  value->AndThen([result = std::move(result), sliced = sliced.CopyRef(),
+                  slice = std::move(slice)]() {
+    sliced->ForwardTo(slice(result.get()));
+  });
+  return std::move(sliced);
+}
+
 static void Execute(Argument<JitExecutable> jit_executable,
                     Argument<Chain> in_chain,
                     RepeatedArguments<Tensor> operands,
@@ -119,28 +267,43 @@ static void Execute(Argument<JitExecutable> jit_executable,
   if (auto err = ConvertTensorOperandsToMemrefDesc(operands, &memrefs))
     return EmitErrors(results, std::move(err), exec_ctx);
 
-  // Get an executable that might be specialized to the operands.
-  Expected<const Executable*> executable =
-      jit_executable->GetExecutable(memrefs);
-  if (auto err = executable.takeError())
-    return EmitErrors(results, std::move(err), exec_ctx);
-
-  // If execution failed errors will be automatically allocated for all results.
-  ReturnValueConverter<ConversionCtx> converter(results);
-  converter.AddConversion(ReturnAsyncToken<ConversionCtx>);
-  converter.AddConversion(ReturnAsyncMemrefAsDenseHostTensor<ConversionCtx>);
-  converter.AddConversion(ReturnMemrefAsDenseHostTensor<ConversionCtx>);
+  // Pad the operands of bucketed kernels, so that the operands of different
+  // sizes share the specializations compiled for the bucket sizes.
+  SmallVector<DenseHostTensor, 4> padded;
+  ssize_t num_rows = 0;
+  if (jit_executable->IsBucketed()) {
+    Expected<ssize_t> rows =
+        PadToBucket(*jit_executable, memrefs, &padded, exec_ctx);
+    if (auto err = rows.takeError())
+      return EmitErrors(results, std::move(err), exec_ctx);
+    num_rows = *rows;
+  }
 
-  if (auto err = (*executable)->Execute(memrefs, converter, exec_ctx)) return;
+  AsyncValueRef<Executable> executable;
+  if (padded.empty()) {
+    executable = ExecuteMemrefs(*jit_executable, memrefs, results, exec_ctx);
+  } else {
+    // Execute with the padded operands and slice the padded results.
+    SmallVector<RCReference<AsyncValue>, 4> values(results.size());
+    executable = ExecuteMemrefs(*jit_executable, memrefs,
+                                {exec_ctx.host(), values}, exec_ctx);
+    for (size_t i = 0; i < values.size(); ++i)
+      results[i] = SliceToRows(std::move(values[i]), num_rows,
+                               memrefs[0].sizes[0], exec_ctx.host());
+  }
 
-  // Keep operands alive if we have unavailable results.
+  // Keep operands, padded operands and the executable, which can be evicted
+  // from the specializations cache, alive if we have unavailable results.
   RunWhenReady(results.values(),
-               [operands = RCArray<AsyncValue>(operands.values())] {});
+               [operands = RCArray<AsyncValue>(operands.values()),
+                padded = std::move(padded),
+                executable = std::move(executable)] {});
 }
 
 void RegisterCpuRuntimeKernels(KernelRegistry* registry) {
   registry->AddKernel("cpurt.compile", TFRT_KERNEL(Compile));
   registry->AddKernel("cpurt.execute", TFRT_KERNEL(Execute));
+  registry->AddNativeObjectLoader(kAotExecutableKind, LoadAotExecutable);
 }
 
 }  // namespace jit
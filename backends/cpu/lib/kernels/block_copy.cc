@@ -0,0 +1,336 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// This file implements the block copies of Tile, Concat and Transpose.
+
+#include "./block_copy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace tfrt {
+namespace cpu {
+namespace {
+
+// Fills `block_bytes * count` bytes at `out` with copies of the first
+// `block_bytes`, doubling the copied range each time.
+void Replicate(char* out, size_t block_bytes, ssize_t count) {
+  size_t filled = block_bytes;
+  const size_t total = block_bytes * count;
+  while (filled < total) {
+    size_t n = std::min(filled, total - filled);
+    std::memcpy(out + filled, out, n);
+    filled += n;
+  }
+}
+
+// Returns the number of elements along each side of the tiles that
+// TransposeCopy transposes, so that a tile is at most 512 bytes.
+ssize_t TransposeTileSize(size_t element_size) {
+  if (element_size <= 2) return 16;
+  if (element_size <= 8) return 8;
+  return 4;
+}
+
+// An opaque element of `N` bytes.
+template <size_t N>
+struct Bytes {
+  char data[N];
+};
+
+// Transposes a block of `rows` x `cols` elements of type T, with `cols` at most
+// kTile, from `in` with rows `in_stride` bytes apart to `out` with rows
+// `out_stride` bytes apart.
+template <typename T, int kTile>
+void TransposePanel(const char* in, size_t in_stride, char* out,
+                    size_t out_stride, ssize_t rows, ssize_t cols) {
+  ssize_t r = 0;
+  if (cols == kTile) {
+    // Full tiles have constant bounds, which lets the compiler keep the tile in
+    // registers and vectorize the loads and stores.
+    for (; r + kTile <= rows; r += kTile) {
+      T tile[kTile][kTile];
+      for (int i = 0; i < kTile; ++i) {
+        const T* src = reinterpret_cast<const T*>(in + (r + i) * in_stride);
+        for (int j = 0; j < kTile; ++j) tile[j][i] = src[j];
+      }
+      for (int j = 0; j < kTile; ++j) {
+        T* dst = reinterpret_cast<T*>(out + j * out_stride) + r;
+        for (int i = 0; i < kTile; ++i) dst[i] = tile[j][i];
+      }
+    }
+  }
+  for (; r < rows; ++r) {
+    const T* src = reinterpret_cast<const T*>(in + r * in_stride);
+    for (ssize_t j = 0; j < cols; ++j)
+      reinterpret_cast<T*>(out + j * out_stride)[r] = src[j];
+  }
+}
+
+// Same as above for elements of any size.
+void TransposePanel(const char* in, size_t in_stride, char* out,
+                    size_t out_stride, ssize_t rows, ssize_t cols,
+                    size_t element_size) {
+  switch (element_size) {
+    case 1:
+      return TransposePanel<uint8_t, 16>(in, in_stride, out, out_stride, rows,
+                                         cols);
+    case 2:
+      return TransposePanel<uint16_t, 16>(in, in_stride, out, out_stride, rows,
+                                          cols);
+    case 4:
+      return TransposePanel<uint32_t, 8>(in, in_stride, out, out_stride, rows,
+                                         cols);
+    case 8:
+      return TransposePanel<uint64_t, 8>(in, in_stride, out, out_stride, rows,
+                                         cols);
+    case 16:
+      return TransposePanel<Bytes<16>, 4>(in, in_stride, out, out_stride, rows,
+                                          cols);
+  }
+  for (ssize_t r = 0; r < rows; ++r) {
+    for (ssize_t j = 0; j < cols; ++j) {
+      std::memcpy(out + j * out_stride + r * element_size,
+                  in + r * in_stride + j * element_size, element_size);
+    }
+  }
+}
+
+}  // namespace
+
+TileCopy::TileCopy(ArrayRef<ssize_t> input_dims, ArrayRef<ssize_t> multiples,
+                   size_t element_size) {
+  assert(input_dims.size() == multiples.size());
+
+  // Dimensions of size one that are not repeated can be dropped, and a
+  // dimension that is not repeated is contiguous with the one before it.
+  for (int d = 0; d < input_dims.size(); ++d) {
+    if (multiples[d] == 1 && input_dims[d] == 1) continue;
+    if (multiples[d] == 1 && !dims_.empty()) {
+      dims_.back() *= input_dims[d];
+    } else {
+      dims_.push_back(input_dims[d]);
+      multiples_.push_back(multiples[d]);
+    }
+  }
+
+  // Keep an outer dimension to split into rows, and an inner one to copy.
+  while (dims_.size() < 2) {
+    dims_.insert(dims_.begin(), 1);
+    multiples_.insert(multiples_.begin(), 1);
+  }
+
+  const int rank = dims_.size();
+  in_strides_.resize(rank);
+  out_strides_.resize(rank);
+  in_strides_[rank - 1] = out_strides_[rank - 1] = element_size;
+  for (int d = rank - 2; d >= 0; --d) {
+    in_strides_[d] = in_strides_[d + 1] * dims_[d + 1];
+    out_strides_[d] = out_strides_[d + 1] * dims_[d + 1] * multiples_[d + 1];
+  }
+}
+
+void TileCopy::CopyBlock(const char* in, char* out, int d) const {
+  const int rank = dims_.size();
+  if (d == rank - 1) {
+    std::memcpy(out, in, dims_[d] * in_strides_[d]);
+  } else {
+    for (ssize_t i = 0; i < dims_[d]; ++i)
+      CopyBlock(in + i * in_strides_[d], out + i * out_strides_[d], d + 1);
+  }
+  Replicate(out, dims_[d] * out_strides_[d], multiples_[d]);
+}
+
+void TileCopy::Copy(const void* input, void* output, size_t begin,
+                    size_t end) const {
+  const char* in = static_cast<const char*>(input);
+  char* out = static_cast<char*>(output);
+
+  // Copies of a row along the outermost dimension are one input row apart.
+  const size_t copy_stride = dims_[0] * out_strides_[0];
+  for (size_t row = begin; row < end; ++row) {
+    char* out_row = out + row * out_strides_[0];
+    CopyBlock(in + row * in_strides_[0], out_row, 1);
+    for (ssize_t i = 1; i < multiples_[0]; ++i)
+      std::memcpy(out_row + i * copy_stride, out_row, out_strides_[0]);
+  }
+}
+
+TransposeCopy::TransposeCopy(ArrayRef<ssize_t> input_dims,
+                             ArrayRef<ssize_t> perm, size_t element_size)
+    : element_size_(element_size) {
+  assert(input_dims.size() == perm.size());
+  const int input_rank = input_dims.size();
+
+  // Dimensions of size one don't change the order of the elements and can be
+  // dropped.
+  SmallVector<int, 5> kept_index(input_rank, -1);
+  SmallVector<ssize_t, 5> kept_dims;
+  for (int d = 0; d < input_rank; ++d) {
+    if (input_dims[d] == 1) continue;
+    kept_index[d] = kept_dims.size();
+    kept_dims.push_back(input_dims[d]);
+  }
+  SmallVector<int, 5> kept_perm;
+  for (ssize_t d : perm) {
+    if (kept_index[d] >= 0) kept_perm.push_back(kept_index[d]);
+  }
+
+  // Input dimensions that are also adjacent in the output are contiguous and
+  // can be collapsed into one.
+  const int kept_rank = kept_dims.size();
+  SmallVector<bool, 5> starts_group(kept_rank, false);
+  for (int i = 0; i < kept_rank; ++i) {
+    if (i == 0 || kept_perm[i] != kept_perm[i - 1] + 1)
+      starts_group[kept_perm[i]] = true;
+  }
+  SmallVector<int, 5> group_index(kept_rank);
+  for (int d = 0; d < kept_rank; ++d) {
+    if (starts_group[d]) {
+      group_index[d] = dims_.size();
+      dims_.push_back(kept_dims[d]);
+    } else {
+      group_index[d] = group_index[d - 1];
+      dims_.back() *= kept_dims[d];
+    }
+  }
+  for (int i = 0; i < kept_rank; ++i) {
+    if (starts_group[kept_perm[i]]) perm_.push_back(group_index[kept_perm[i]]);
+  }
+
+  if (dims_.empty()) {
+    dims_.push_back(1);
+    perm_.push_back(0);
+  }
+
+  const int rank = dims_.size();
+  in_strides_.resize(rank);
+  out_strides_.resize(rank);
+  in_strides_[rank - 1] = out_strides_[perm_[rank - 1]] = element_size;
+  for (int d = rank - 2; d >= 0; --d)
+    in_strides_[d] = in_strides_[d + 1] * dims_[d + 1];
+  for (int i = rank - 2; i >= 0; --i)
+    out_strides_[perm_[i]] = out_strides_[perm_[i + 1]] * dims_[perm_[i + 1]];
+
+  // The innermost output dimension, and the innermost input dimension if it
+  // is not the same, are copied in rows or tiles. The rest are outer ones.
+  const int inner = perm_[rank - 1];
+  copy_rows_ = inner == rank - 1;
+  num_rows_ = 1;
+  for (int d : perm_) {
+    if (d == inner || d == rank - 1) continue;
+    outer_dims_.push_back(d);
+    num_rows_ *= dims_[d];
+  }
+
+  if (copy_rows_) {
+    row_bytes_ = dims_[inner] * element_size;
+  } else {
+    const ssize_t tile = TransposeTileSize(element_size);
+    num_tiles_ = (dims_[rank - 1] + tile - 1) / tile;
+    num_rows_ *= num_tiles_;
+    row_bytes_ = tile * dims_[inner] * element_size;
+  }
+}
+
+std::pair<size_t, size_t> TransposeCopy::OuterOffsets(size_t index) const {
+  size_t in_offset = 0, out_offset = 0;
+  for (int k = outer_dims_.size() - 1; k >= 0; --k) {
+    const int d = outer_dims_[k];
+    const size_t i = index % dims_[d];
+    index /= dims_[d];
+    in_offset += i * in_strides_[d];
+    out_offset += i * out_strides_[d];
+  }
+  return {in_offset, out_offset};
+}
+
+void TransposeCopy::CopyRows(const char* in, char* out, size_t begin,
+                             size_t end) const {
+  // Rows are contiguous in the output, so only the input offset is tracked,
+  // by incrementing the outer index one row at a time.
+  const int num_outer = outer_dims_.size();
+  SmallVector<ssize_t, 5> index(num_outer);
+  size_t rest = begin;
+  for (int k = num_outer - 1; k >= 0; --k) {
+    index[k] = rest % dims_[outer_dims_[k]];
+    rest /= dims_[outer_dims_[k]];
+  }
+  size_t in_offset = OuterOffsets(begin).first;
+
+  for (size_t row = begin; row < end; ++row) {
+    std::memcpy(out + row * row_bytes_, in + in_offset, row_bytes_);
+    for (int k = num_outer - 1; k >= 0; --k) {
+      const int d = outer_dims_[k];
+      in_offset += in_strides_[d];
+      if (++index[k] < dims_[d]) break;
+      in_offset -= dims_[d] * in_strides_[d];
+      index[k] = 0;
+    }
+  }
+}
+
+void TransposeCopy::CopyTiles(const char* in, char* out, size_t begin,
+                              size_t end) const {
+  // Each row is a panel of the innermost output dimension `a` by up to one
+  // tile of the innermost input dimension `b`.
+  const int b = dims_.size() - 1;
+  const int a = perm_[b];
+  const ssize_t tile = TransposeTileSize(element_size_);
+
+  for (size_t row = begin; row < end; ++row) {
+    std::pair<size_t, size_t> offsets = OuterOffsets(row / num_tiles_);
+    const ssize_t b_begin = row % num_tiles_ * tile;
+    TransposePanel(in + offsets.first + b_begin * in_strides_[b],
+                   in_strides_[a],
+                   out + offsets.second + b_begin * out_strides_[b],
+                   out_strides_[b], dims_[a],
+                   std::min(tile, dims_[b] - b_begin), element_size_);
+  }
+}
+
+void TransposeCopy::Copy(const void* input, void* output, size_t begin,
+                         size_t end) const {
+  const char* in = static_cast<const char*>(input);
+  char* out = static_cast<char*>(output);
+  if (copy_rows_) {
+    CopyRows(in, out, begin, end);
+  } else {
+    CopyTiles(in, out, begin, end);
+  }
+}
+
+void ConcatRows(ArrayRef<const void*> inputs, ArrayRef<size_t> row_bytes,
+                void* output, size_t begin, size_t end) {
+  assert(inputs.size() == row_bytes.size());
+  size_t output_row_bytes = 0;
+  for (size_t bytes : row_bytes) output_row_bytes += bytes;
+
+  char* out = static_cast<char*>(output) + begin * output_row_bytes;
+  for (size_t row = begin; row < end; ++row) {
+    for (int i = 0; i < inputs.size(); ++i) {
+      std::memcpy(out, static_cast<const char*>(inputs[i]) + row * row_bytes[i],
+                  row_bytes[i]);
+      out += row_bytes[i];
+    }
+  }
+}
+
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Copy engine for kernels that only move elements around, e.g. Tile, Concat
+// and Transpose.
+//
+// Instead of computing the source index of every output element, the copies
+// collapse adjacent dimensions that are copied contiguously and move whole
+// blocks with memcpy, so that they are limited by memory bandwidth rather than
+// by per-element index math. Elements are treated as opaque bytes.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_BLOCK_COPY_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_BLOCK_COPY_H_
+
+#include <cstddef>
+#include <utility>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Copies a row major input into an output that repeats it `multiples[d]` times
+// along each dimension `d`.
+//
+// The output is split into the rows of its outermost (collapsed) input
+// dimension, which can be copied independently, e.g. in parallel blocks.
+class TileCopy {
+ public:
+  TileCopy(ArrayRef<ssize_t> input_dims, ArrayRef<ssize_t> multiples,
+           size_t element_size);
+
+  // Returns the number of rows that Copy() splits the output into.
+  size_t NumRows() const { return dims_[0]; }
+
+  // Returns the number of bytes that Copy() reads and writes for each row.
+  size_t RowBytesLoaded() const { return in_strides_[0]; }
+  size_t RowBytesStored() const { return out_strides_[0] * multiples_[0]; }
+
+  // Copies the rows [begin, end) of `input` to all of their places in
+  // `output`.
+  void Copy(const void* input, void* output, size_t begin, size_t end) const;
+
+ private:
+  // Tiles the block of dimensions [d, rank) at `in` to `out`.
+  void CopyBlock(const char* in, char* out, int d) const;
+
+  // Collapsed dimensions and multiples, with at least two dimensions.
+  SmallVector<ssize_t, 5> dims_;
+  SmallVector<ssize_t, 5> multiples_;
+  // Strides of the dimensions in bytes.
+  SmallVector<size_t, 5> in_strides_;
+  SmallVector<size_t, 5> out_strides_;
+};
+
+// Copies a row major input into an output with the input dimensions permuted
+// by `perm`, i.e. output dimension `i` is input dimension `perm[i]`.
+//
+// If the innermost input dimension stays innermost, whole rows are copied with
+// memcpy. Otherwise the two dimensions that are innermost in the input and in
+// the output are transposed in square tiles that fit into registers, so that
+// both the loads and the stores are contiguous within a tile.
+//
+// The copy is split into independent rows: runs of contiguous elements in the
+// first case, and tiles along the innermost input dimension in the second.
+class TransposeCopy {
+ public:
+  TransposeCopy(ArrayRef<ssize_t> input_dims, ArrayRef<ssize_t> perm,
+                size_t element_size);
+
+  // Returns the number of rows that Copy() splits the output into.
+  size_t NumRows() const { return num_rows_; }
+
+  // Returns the number of bytes that Copy() reads and writes for each row.
+  size_t RowBytes() const { return row_bytes_; }
+
+  // Copies the rows [begin, end) of `input` to `output`.
+  void Copy(const void* input, void* output, size_t begin, size_t end) const;
+
+ private:
+  // Returns the byte offsets in the input and the output of the outer index
+  // `index`, which enumerates the dimensions in `outer_dims_`.
+  std::pair<size_t, size_t> OuterOffsets(size_t index) const;
+
+  void CopyRows(const char* in, char* out, size_t begin, size_t end) const;
+  void CopyTiles(const char* in, char* out, size_t begin, size_t end) const;
+
+  // Collapsed input dimensions and permutation, with at least one dimension.
+  SmallVector<ssize_t, 5> dims_;
+  SmallVector<ssize_t, 5> perm_;
+  // Strides of the input dimensions in bytes, in the input and the output.
+  SmallVector<size_t, 5> in_strides_;
+  SmallVector<size_t, 5> out_strides_;
+  // Input dimensions, in output order, that Copy() iterates over outside of
+  // the copied rows or tiles.
+  SmallVector<int, 5> outer_dims_;
+  size_t element_size_;
+  // Whether the innermost input dimension stays innermost in the output.
+  bool copy_rows_;
+  size_t num_tiles_ = 1;
+  size_t num_rows_;
+  size_t row_bytes_;
+};
+
+// Copies the rows [begin, end) of the concatenation of `inputs` along their
+// innermost dimension to `output`. Input `i` is a row major matrix with rows
+// of `row_bytes[i]` bytes, and the rows of `output` are the concatenation of
+// one row of each input.
+void ConcatRows(ArrayRef<const void*> inputs, ArrayRef<size_t> row_bytes,
+                void* output, size_t begin, size_t end);
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_BLOCK_COPY_H_
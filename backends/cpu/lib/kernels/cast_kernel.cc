@@ -0,0 +1,92 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the conversions between float and bf16 or fp16.
+
+#include "./cast_kernel.h"
+
+#include <cassert>
+#include <cstddef>
+
+#include "./cwise_simd.h"
+#include "tfrt/host_context/parallel_for.h"
+
+namespace tfrt {
+namespace cpu {
+namespace {
+
+// Converts the elements [begin, end) of `in` to `out`.
+using ConvertFn = void (*)(const void* in, void* out, size_t begin,
+                           size_t end);
+
+template <typename T>
+void ToFloat(const void* in, void* out, size_t begin, size_t end) {
+  simd::ConvertToFloat(static_cast<const T*>(in) + begin,
+                       static_cast<float*>(out) + begin, end - begin);
+}
+
+template <typename T>
+void FromFloat(const void* in, void* out, size_t begin, size_t end) {
+  simd::ConvertFromFloat(static_cast<const float*>(in) + begin,
+                         static_cast<T*>(out) + begin, end - begin);
+}
+
+ConvertFn GetConvertFn(DType from, DType to) {
+  if (to.kind() == DType::F32) {
+    if (from.kind() == DType::BF16) return &ToFloat<bf16>;
+    if (from.kind() == DType::F16) return &ToFloat<fp16>;
+  } else if (from.kind() == DType::F32) {
+    if (to.kind() == DType::BF16) return &FromFloat<bf16>;
+    if (to.kind() == DType::F16) return &FromFloat<fp16>;
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+bool IsFloatCast(DType from, DType to) {
+  return GetConvertFn(from, to) != nullptr;
+}
+
+AsyncValueRef<Chain> CastFloat(const DenseHostTensor& input,
+                               DenseHostTensor* output,
+                               const ExecutionContext& exec_ctx) {
+  ConvertFn convert = GetConvertFn(input.dtype(), output->dtype());
+  assert(convert && "unsupported cast");
+  assert(input.NumElements() == output->NumElements());
+
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = input.dtype().GetHostSize();
+  cost.bytes_stored = output->dtype().GetHostSize();
+  cost.compute_cycles = 1;
+
+  void* out = output->data();
+  return ParallelFor(exec_ctx).Execute(
+      input.NumElements(), ParallelFor::BlockSizes::FromCost(cost),
+      [input = input.CopyRef(), out, convert](size_t begin, size_t end) {
+        convert(input.data(), out, begin, end);
+      });
+}
+
+void CastFloatSync(const DenseHostTensor& input, DenseHostTensor* output) {
+  ConvertFn convert = GetConvertFn(input.dtype(), output->dtype());
+  assert(convert && "unsupported cast");
+  assert(input.NumElements() == output->NumElements());
+  convert(input.data(), output->data(), 0, input.NumElements());
+}
+
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Conversions between float and the 16-bit floating point types bf16 and fp16.
+//
+// Models are often stored and moved around in bf16 or fp16 to halve the memory
+// traffic, and computed in float. The conversions use the vectorized kernels
+// of cwise_simd.h.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CAST_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CAST_KERNEL_H_
+
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Returns whether the kernels below convert `from` to `to`, i.e. whether one
+// of them is F32 and the other one is BF16 or F16.
+bool IsFloatCast(DType from, DType to);
+
+// Converts `input` to the dtype of `output`, which has the same shape, in
+// parallel blocks on the thread pool.
+AsyncValueRef<Chain> CastFloat(const DenseHostTensor& input,
+                               DenseHostTensor* output,
+                               const ExecutionContext& exec_ctx);
+
+// Converts `input` to the dtype of `output` on the calling thread.
+void CastFloatSync(const DenseHostTensor& input, DenseHostTensor* output);
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CAST_KERNEL_H_
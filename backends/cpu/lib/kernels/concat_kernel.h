@@ -19,6 +19,7 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CONCAT_KERNEL_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CONCAT_KERNEL_H_
 
+#include "./block_copy.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/ranges.h"
@@ -100,76 +101,34 @@ Expected<TensorMetadata> ConcatMetadataKernel(const TensorRange& args,
   return TensorMetadata(arg0_dtype, TensorShape(output_dims));
 }
 
-template <int rank>
-using ConcatRankTag = std::integral_constant<int, rank>;
-
+// Concatenates `args` along `axis` into `output`. The elements are copied as
+// raw bytes (see block_copy.h), so `T` only has to match the size of the
+// input dtype.
 template <typename T, typename DHTRange>
 Error ConcatKernel(const DHTRange& args, int axis, DenseHostTensor* output) {
-  const int input_rank = args[0].shape().GetRank();
-
-  // Handle scalars concatenation separately to keep the common path simple.
-  if (input_rank == 0) {
-    for (int i = 0; i < args.size(); ++i) {
-      const T* inp = static_cast<const T*>(args[i].data());
-      T* out = static_cast<T*>(output->data());
-      out[i] = *inp;
-    }
+  const int rank = args[0].shape().GetRank();
+  // Compute the actual axis from a negative value.
+  axis = axis < 0 ? axis + rank : axis;
 
-    return Error::success();
+  // The output is a [num_rows, ...] matrix where each row is the concatenation
+  // of one row of each argument. Scalars are concatenated as vectors.
+  size_t num_rows = 1;
+  for (int d = 0; d < axis; ++d)
+    num_rows *= output->shape().GetDimensionSize(d);
+
+  SmallVector<const void*, 8> inputs;
+  SmallVector<size_t, 8> row_bytes;
+  for (const DenseHostTensor& dht : args) {
+    // It's possible for this input tensor to have zero dimension along the
+    // specified axis, in which case no work is needed, b/172595919
+    if (dht.NumElements() == 0) continue;
+    inputs.push_back(dht.data());
+    row_bytes.push_back(dht.NumElements() / num_rows * sizeof(T));
   }
 
-  // Compute the actual axis from a negative value.
-  axis = axis < 0 ? axis + input_rank : axis;
-
   // TODO(ezhulenev): Make this asynchronous/multithreaded.
-  auto rank_dispatch = [&](auto rank_tag) -> void {
-    static constexpr int rank = decltype(rank_tag)::value;
-
-    auto output_view = MutableDHTIndexableView<T, rank>(output);
-    auto output_t = compat::AsEigenTensor(output_view);
-
-    // Offset for writing to the output along the axis dimension.
-    ssize_t offset = 0;
-
-    for (auto& dht : args) {
-      auto arg_view = DHTIndexableView<T, rank>(&dht);
-      auto arg_t = compat::AsEigenConstTensor(arg_view);
-
-      // Offsets for the output slice.
-      Eigen::DSizes<ssize_t, rank> offsets;
-      for (int d = 0; d < rank; d++) offsets[d] = 0;
-      offsets[axis] = offset;
-
-      // Size of the output slice.
-      Eigen::DSizes<ssize_t, rank> sizes;
-      for (int d = 0; d < rank; d++) sizes[d] = dht.shape().GetDimensionSize(d);
-
-      // It's possible for this input tensor to have zero dimension along the
-      // specified axis, in which case no work is needed, b/172595919
-      if (sizes[axis] == 0) continue;
-
-      offset += sizes[axis];
-
-      // Write argument into the output tensor slice.
-      output_t.slice(offsets, sizes) = arg_t;
-    }
-  };
-
-  auto rank = output->shape().GetRank();
-  // Dispatch based on the output tensor rank.
-  if (rank == 1) {
-    rank_dispatch(ConcatRankTag<1>{});
-  } else if (rank == 2) {
-    rank_dispatch(ConcatRankTag<2>{});
-  } else if (rank == 3) {
-    rank_dispatch(ConcatRankTag<3>{});
-  } else if (rank == 4) {
-    rank_dispatch(ConcatRankTag<4>{});
-  } else if (rank == 5) {
-    rank_dispatch(ConcatRankTag<4>{});
-  } else {
-    return MakeStringError("Unsupported output tensor rank");
-  }
+  if (output->NumElements() != 0)
+    ConcatRows(inputs, row_bytes, output->data(), 0, num_rows);
 
   return Error::success();
 }
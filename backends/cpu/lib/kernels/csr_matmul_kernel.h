@@ -0,0 +1,105 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Sparse (CSR) times dense matrix multiplication kernels.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CSR_MATMUL_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CSR_MATMUL_KERNEL_H_
+
+#include <algorithm>
+#include <cstdint>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/tensor/csr_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Computes the rows [begin, end) of C = A @ B for a CSR matrix A [m, k] and a
+// row major dense matrix B [k, n]. Every non-zero A[r, i] adds
+// A[r, i] * B[i, :] to C[r, :], so B is only read at the rows of the non-zero
+// columns of A.
+template <typename T>
+void CsrMatMulRows(const int64_t* row_ptrs, const int64_t* col_indices,
+                   const T* values, const T* b, T* c, size_t n, size_t begin,
+                   size_t end) {
+  // Matrix-vector product (SpMV).
+  if (n == 1) {
+    for (size_t row = begin; row < end; ++row) {
+      T sum = static_cast<T>(0);
+      for (int64_t i = row_ptrs[row], e = row_ptrs[row + 1]; i != e; ++i)
+        sum += values[i] * b[col_indices[i]];
+      c[row] = sum;
+    }
+    return;
+  }
+
+  // Matrix-matrix product (SpMM).
+  for (size_t row = begin; row < end; ++row) {
+    T* c_row = c + row * n;
+    std::fill(c_row, c_row + n, static_cast<T>(0));
+    for (int64_t i = row_ptrs[row], e = row_ptrs[row + 1]; i != e; ++i) {
+      const T value = values[i];
+      const T* b_row = b + col_indices[i] * n;
+      for (size_t j = 0; j < n; ++j) c_row[j] += value * b_row[j];
+    }
+  }
+}
+
+// Computes C = A @ B for a CSR matrix A [m, k] and dense matrices B [k, n] and
+// C [m, n]. The rows of C are computed in parallel, in blocks sized after the
+// average number of non-zeros per row. The returned chain becomes available
+// when C is computed. A and B are kept alive until then, C must be kept alive
+// by the caller.
+template <typename T>
+AsyncValueRef<Chain> CsrMatMul(const CsrHostTensor& a, const DenseHostTensor& b,
+                               DenseHostTensor* c,
+                               const ExecutionContext& exec_ctx) {
+  assert(a.NumCols() == b.shape().GetDimensionSize(0));
+  assert(a.NumRows() == c->shape().GetDimensionSize(0));
+  assert(b.shape().GetDimensionSize(1) == c->shape().GetDimensionSize(1));
+
+  const size_t m = a.NumRows();
+  const size_t n = b.shape().GetDimensionSize(1);
+  const double nonzeros_per_row =
+      static_cast<double>(a.NumNonZeros()) / std::max<size_t>(m, 1);
+
+  ParallelFor::Cost cost;
+  cost.bytes_loaded =
+      nonzeros_per_row * (sizeof(int64_t) + sizeof(T) + n * sizeof(T));
+  cost.bytes_stored = n * sizeof(T);
+  cost.compute_cycles = nonzeros_per_row * n;
+
+  T* c_data = static_cast<T*>(c->data());
+  return ParallelFor(exec_ctx).Execute(
+      m, ParallelFor::BlockSizes::FromCost(cost),
+      [a = a.CopyRef(), b = b.CopyRef(), c_data, n](size_t begin, size_t end) {
+        CsrMatMulRows<T>(static_cast<const int64_t*>(a.RowPtrs()->data()),
+                         static_cast<const int64_t*>(a.ColIndices()->data()),
+                         static_cast<const T*>(a.Values()->data()),
+                         static_cast<const T*>(b.data()), c_data, n, begin,
+                         end);
+      });
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CSR_MATMUL_KERNEL_H_
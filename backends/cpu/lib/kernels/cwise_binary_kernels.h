@@ -19,6 +19,9 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_BINARY_KERNELS_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_BINARY_KERNELS_H_
 
+#include <type_traits>
+
+#include "./cwise_simd.h"
 #include "tfrt/common/compat/eigen/eigen_evaluator.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/common/compat/eigen/tensor_types.h"
@@ -162,6 +165,42 @@ struct BindLeftScalar : private Functor {
 
 namespace internal {
 
+// The vectorized kernel in cwise_simd.h that implements a binary functor.
+template <typename Functor>
+struct SimdBinaryOp : std::false_type {};
+
+#define TFRT_SIMD_BINARY_OP(FUNCTOR, OP)                        \
+  template <>                                                   \
+  struct SimdBinaryOp<FUNCTOR> : std::true_type {               \
+    static constexpr simd::BinaryOp value = simd::BinaryOp::OP; \
+  }
+
+TFRT_SIMD_BINARY_OP(Eigen::internal::scalar_sum_op<float>, kAdd);
+TFRT_SIMD_BINARY_OP(Eigen::internal::scalar_difference_op<float>, kSub);
+TFRT_SIMD_BINARY_OP(Eigen::internal::scalar_product_op<float>, kMul);
+TFRT_SIMD_BINARY_OP(Eigen::internal::scalar_quotient_op<float>, kDiv);
+
+#undef TFRT_SIMD_BINARY_OP
+
+// Returns the size of the rows if `bcast` repeats a row of the argument along
+// the outer dimensions of the result (e.g. the bias of BiasAdd), and 0
+// otherwise.
+inline ssize_t GetBroadcastRowSize(const ArgumentBCast& bcast) {
+  ArrayRef<ssize_t> reshape = bcast.reshape();
+  ArrayRef<ssize_t> broadcast = bcast.broadcast();
+
+  size_t inner = reshape.size();
+  while (inner > 0 && broadcast[inner - 1] == 1) --inner;
+  if (inner == 0) return 0;
+
+  for (size_t i = 0; i < inner; ++i)
+    if (reshape[i] != 1) return 0;
+
+  ssize_t row_size = 1;
+  for (size_t i = inner; i < reshape.size(); ++i) row_size *= reshape[i];
+  return row_size;
+}
+
 template <typename BinaryFunctor, typename EigenEvaluator>
 struct BinaryKernelImpl {
   using Functor = typename BinaryFunctor::Functor;
@@ -171,6 +210,28 @@ struct BinaryKernelImpl {
   explicit BinaryKernelImpl(EigenEvaluator eigen_evaluator)
       : eigen{eigen_evaluator} {}
 
+  // Calls `fn` with the vectorized kernel of the functor, if it has one and
+  // the output with `num_elements` should not be evaluated by the thread pool.
+  // Returns false if the output must be evaluated by Eigen.
+  template <typename Fn>
+  static bool EvaluateSimd(size_t num_elements, Fn fn) {
+    return EvaluateSimd(num_elements, std::move(fn), SimdBinaryOp<Functor>());
+  }
+
+  template <typename Fn>
+  static bool EvaluateSimd(size_t, Fn, std::false_type) {
+    return false;
+  }
+
+  template <typename Fn>
+  static bool EvaluateSimd(size_t num_elements, Fn fn, std::true_type) {
+    if (!std::is_same<EigenEvaluator, compat::SyncEigenEvaluator>::value &&
+        num_elements > simd::kMaxInlineElements)
+      return false;
+    fn(SimdBinaryOp<Functor>::value);
+    return true;
+  }
+
   template <typename OnDone>
   void ScalarScalar(const HostTensor& lhs, const HostTensor& rhs,
                     HostTensor* output, OnDone on_done) {
@@ -195,7 +256,15 @@ struct BinaryKernelImpl {
     auto rhs_t = compat::AsEigenConstTensor(DHTArrayView<Input>(rhs_tensor));
     auto out_t = compat::AsEigenTensor(MutableDHTArrayView<Output>(out_tensor));
 
-    // Bind scalar value to the right side of the binary functor.
+    if (EvaluateSimd(out_t.size(), [&](auto op) {
+          simd::BinaryScalarLhs(op, lhs_scalar->GetValue(), rhs_t.data(),
+                                out_t.data(), out_t.size());
+        })) {
+      on_done(Error::success());
+      return;
+    }
+
+    // Bind scalar value to the left side of the binary functor.
     using BindLeft = functor::BindLeftScalar<Input, Output, Functor>;
     auto expr = rhs_t.unaryExpr(BindLeft(lhs_scalar->GetValue()));
 
@@ -215,6 +284,14 @@ struct BinaryKernelImpl {
     auto lhs_t = compat::AsEigenConstTensor(DHTArrayView<Input>(lhs_tensor));
     auto out_t = compat::AsEigenTensor(MutableDHTArrayView<Output>(out_tensor));
 
+    if (EvaluateSimd(out_t.size(), [&](auto op) {
+          simd::BinaryScalarRhs(op, lhs_t.data(), rhs_scalar->GetValue(),
+                                out_t.data(), out_t.size());
+        })) {
+      on_done(Error::success());
+      return;
+    }
+
     // Bind scalar value to the right side of the binary functor.
     using BindRight = functor::BindRightScalar<Input, Output, Functor>;
     auto expr = lhs_t.unaryExpr(BindRight(rhs_scalar->GetValue()));
@@ -242,19 +319,42 @@ struct BinaryKernelImpl {
               on_done = std::move(on_done)]() { on_done(Error::success()); };
     };
 
+    const size_t num_elements = out_t.size();
+
     if (lhs_tensor->shape() == rhs_tensor->shape()) {
       // Arguments do not need broadcasting.
+      if (EvaluateSimd(num_elements, [&](auto op) {
+            simd::Binary(op, lhs_t.data(), rhs_t.data(), out_t.data(),
+                         num_elements);
+          })) {
+        on_done(Error::success());
+        return;
+      }
       auto expr = lhs_t.binaryExpr(rhs_t, Functor());
       eigen.Evaluate(out_t, std::move(expr), assign_callback());
 
     } else if (lhs_tensor->NumElements() == 1) {
       // Scalar (or Tensor of size 1) + Tensor.
+      if (EvaluateSimd(num_elements, [&](auto op) {
+            simd::BinaryScalarLhs(op, *lhs_t.data(), rhs_t.data(),
+                                  out_t.data(), num_elements);
+          })) {
+        on_done(Error::success());
+        return;
+      }
       using BindLeft = functor::BindLeftScalar<Input, Output, Functor>;
       auto expr = rhs_t.unaryExpr(BindLeft(*lhs_t.data()));
       eigen.Evaluate(out_t, std::move(expr), assign_callback());
 
     } else if (rhs_tensor->NumElements() == 1) {
       // Tensor + Scalar (or Tensor of size 1).
+      if (EvaluateSimd(num_elements, [&](auto op) {
+            simd::BinaryScalarRhs(op, lhs_t.data(), *rhs_t.data(),
+                                  out_t.data(), num_elements);
+          })) {
+        on_done(Error::success());
+        return;
+      }
       using BindRight = functor::BindRightScalar<Input, Output, Functor>;
       auto expr = lhs_t.unaryExpr(BindRight(*rhs_t.data()));
       eigen.Evaluate(out_t, std::move(expr), assign_callback());
@@ -289,6 +389,30 @@ struct BinaryKernelImpl {
     auto lhs_arr_view = DHTArrayView<Input>(&lhs_tensor);
     auto rhs_arr_view = DHTArrayView<Input>(&rhs_tensor);
 
+    // One argument has the output shape and the other one is a row that is
+    // repeated along its outer dimensions (e.g. the bias of BiasAdd).
+    const ssize_t num_elements = out_tensor->NumElements();
+    const ssize_t lhs_row_size = rhs_tensor.NumElements() == num_elements
+                                     ? GetBroadcastRowSize(*lhs_bcast)
+                                     : 0;
+    const ssize_t rhs_row_size = lhs_tensor.NumElements() == num_elements
+                                     ? GetBroadcastRowSize(*rhs_bcast)
+                                     : 0;
+    if (num_elements > 0 && (lhs_row_size > 0 || rhs_row_size > 0) &&
+        EvaluateSimd(num_elements, [&](auto op) {
+          auto* out = MutableDHTArrayView<Output>(out_tensor).data();
+          if (rhs_row_size > 0) {
+            simd::BinaryRowRhs(op, lhs_arr_view.data(), rhs_arr_view.data(),
+                               out, num_elements / rhs_row_size, rhs_row_size);
+          } else {
+            simd::BinaryRowLhs(op, lhs_arr_view.data(), rhs_arr_view.data(),
+                               out, num_elements / lhs_row_size, lhs_row_size);
+          }
+        })) {
+      on_done(Error::success());
+      return;
+    }
+
     // Use Rank type defined below to pass rank value via lambda argument.
     auto dispatch = [&](auto rank_dispatch) -> void {
       constexpr int rank = decltype(rank_dispatch)::value;
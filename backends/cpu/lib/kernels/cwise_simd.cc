@@ -0,0 +1,308 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the instruction set dispatch of the vectorized
+// kernels, the generic and NEON kernels, and the packing of matmul operands.
+
+#include "./cwise_simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "./cwise_simd_impl.h"
+
+namespace tfrt {
+namespace cpu {
+namespace simd {
+namespace internal {
+namespace {
+
+// Portable kernels that leave the vectorization to the compiler.
+struct GenericVec {
+  using Reg = float;
+  static constexpr size_t kWidth = 1;
+
+  static Reg Load(const float* ptr) { return *ptr; }
+  static void Store(float* ptr, Reg value) { *ptr = value; }
+  static Reg Set1(float value) { return value; }
+  static Reg Add(Reg lhs, Reg rhs) { return lhs + rhs; }
+  static Reg Sub(Reg lhs, Reg rhs) { return lhs - rhs; }
+  static Reg Mul(Reg lhs, Reg rhs) { return lhs * rhs; }
+  static Reg Div(Reg lhs, Reg rhs) { return lhs / rhs; }
+  static Reg Max(Reg lhs, Reg rhs) { return lhs > rhs ? lhs : rhs; }
+  static Reg Min(Reg lhs, Reg rhs) { return lhs < rhs ? lhs : rhs; }
+  static Reg MulAdd(Reg a, Reg b, Reg c) { return a * b + c; }
+  static Reg Floor(Reg value) { return std::floor(value); }
+  static Reg Exp2Int(Reg n) {
+    int32_t bits = (static_cast<int32_t>(n) + 127) << 23;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  static Reg LoadBf16(const bf16* ptr) { return Bf16ToFloat(*ptr); }
+  static void StoreBf16(bf16* ptr, Reg value) { *ptr = FloatToBf16(value); }
+  static Reg LoadFp16(const fp16* ptr) { return Fp16ToFloat(*ptr); }
+  static void StoreFp16(fp16* ptr, Reg value) { *ptr = FloatToFp16(value); }
+};
+
+#if defined(__aarch64__)
+struct NeonVec {
+  using Reg = float32x4_t;
+  static constexpr size_t kWidth = 4;
+
+  static Reg Load(const float* ptr) { return vld1q_f32(ptr); }
+  static void Store(float* ptr, Reg value) { vst1q_f32(ptr, value); }
+  static Reg Set1(float value) { return vdupq_n_f32(value); }
+  static Reg Add(Reg lhs, Reg rhs) { return vaddq_f32(lhs, rhs); }
+  static Reg Sub(Reg lhs, Reg rhs) { return vsubq_f32(lhs, rhs); }
+  static Reg Mul(Reg lhs, Reg rhs) { return vmulq_f32(lhs, rhs); }
+  static Reg Div(Reg lhs, Reg rhs) { return vdivq_f32(lhs, rhs); }
+  static Reg Max(Reg lhs, Reg rhs) { return vmaxq_f32(lhs, rhs); }
+  static Reg Min(Reg lhs, Reg rhs) { return vminq_f32(lhs, rhs); }
+  static Reg MulAdd(Reg a, Reg b, Reg c) { return vfmaq_f32(c, a, b); }
+  static Reg Floor(Reg value) { return vrndmq_f32(value); }
+  static Reg Exp2Int(Reg n) {
+    int32x4_t exponent = vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127));
+    return vreinterpretq_f32_s32(vshlq_n_s32(exponent, 23));
+  }
+  static Reg LoadBf16(const bf16* ptr) {
+    uint16x4_t bits = vld1_u16(reinterpret_cast<const uint16_t*>(ptr));
+    return vreinterpretq_f32_u32(vshll_n_u16(bits, 16));
+  }
+  static void StoreBf16(bf16* ptr, Reg value) {
+    // Same rounding as FloatToBf16(): add 0x7fff plus the lowest kept bit,
+    // and keep NaNs quiet.
+    uint32x4_t bits = vreinterpretq_u32_f32(value);
+    uint32x4_t odd = vandq_u32(vshrq_n_u32(bits, 16), vdupq_n_u32(1));
+    uint32x4_t rounded = vaddq_u32(bits, vaddq_u32(vdupq_n_u32(0x7fff), odd));
+    uint32x4_t is_nan = vmvnq_u32(vceqq_f32(value, value));
+    bits = vbslq_u32(is_nan, vorrq_u32(bits, vdupq_n_u32(0x400000)), rounded);
+    vst1_u16(reinterpret_cast<uint16_t*>(ptr), vshrn_n_u32(bits, 16));
+  }
+  static Reg LoadFp16(const fp16* ptr) {
+    uint16x4_t bits = vld1_u16(reinterpret_cast<const uint16_t*>(ptr));
+    return vcvt_f32_f16(vreinterpret_f16_u16(bits));
+  }
+  static void StoreFp16(fp16* ptr, Reg value) {
+    vst1_u16(reinterpret_cast<uint16_t*>(ptr),
+             vreinterpret_u16_f16(vcvt_f16_f32(value)));
+  }
+};
+#endif
+
+bool IsSupportedByCpu(Isa isa) {
+  switch (isa) {
+    case Isa::kGeneric:
+      return true;
+    case Isa::kNeon:
+#if defined(__aarch64__)
+      return true;
+#else
+      return false;
+#endif
+    case Isa::kAvx2:
+    case Isa::kAvx512:
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+      __builtin_cpu_init();
+      if (isa == Isa::kAvx512) return __builtin_cpu_supports("avx512f");
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+             __builtin_cpu_supports("f16c");
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+struct SelectedKernels {
+  Isa isa;
+  const KernelTable* kernels;
+};
+
+SelectedKernels SelectKernels() {
+  for (Isa isa : {Isa::kAvx512, Isa::kAvx2, Isa::kNeon}) {
+    if (const KernelTable* kernels = GetKernels(isa)) return {isa, kernels};
+  }
+  return {Isa::kGeneric, GetGenericKernels()};
+}
+
+// The kernels are selected once, on first use.
+const SelectedKernels& Selected() {
+  static const SelectedKernels selected = SelectKernels();
+  return selected;
+}
+
+const KernelTable& Kernels() { return *Selected().kernels; }
+
+}  // namespace
+
+const KernelTable* GetGenericKernels() {
+  static const KernelTable table = MakeKernelTable<GenericVec>();
+  return &table;
+}
+
+const KernelTable* GetNeonKernels() {
+#if defined(__aarch64__)
+  static const KernelTable table = MakeKernelTable<NeonVec>();
+  return &table;
+#else
+  return nullptr;
+#endif
+}
+
+const KernelTable* GetKernels(Isa isa) {
+  if (!IsSupportedByCpu(isa)) return nullptr;
+  switch (isa) {
+    case Isa::kGeneric:
+      return GetGenericKernels();
+    case Isa::kNeon:
+      return GetNeonKernels();
+    case Isa::kAvx2:
+      return GetAvx2Kernels();
+    case Isa::kAvx512:
+      return GetAvx512Kernels();
+  }
+  return nullptr;
+}
+
+}  // namespace internal
+
+Isa GetIsa() { return internal::Selected().isa; }
+
+void Binary(BinaryOp op, const float* lhs, const float* rhs, float* out,
+            size_t n) {
+  internal::Kernels().binary[static_cast<int>(op)](lhs, rhs, out, n);
+}
+
+void BinaryScalarLhs(BinaryOp op, float lhs, const float* rhs, float* out,
+                     size_t n) {
+  internal::Kernels().binary_scalar_lhs[static_cast<int>(op)](lhs, rhs, out,
+                                                              n);
+}
+
+void BinaryScalarRhs(BinaryOp op, const float* lhs, float rhs, float* out,
+                     size_t n) {
+  internal::Kernels().binary_scalar_rhs[static_cast<int>(op)](lhs, rhs, out,
+                                                              n);
+}
+
+void BinaryRowRhs(BinaryOp op, const float* lhs, const float* rhs, float* out,
+                  size_t num_rows, size_t row_size) {
+  auto kernel = internal::Kernels().binary[static_cast<int>(op)];
+  for (size_t row = 0; row < num_rows; ++row) {
+    size_t offset = row * row_size;
+    kernel(lhs + offset, rhs, out + offset, row_size);
+  }
+}
+
+void BinaryRowLhs(BinaryOp op, const float* lhs, const float* rhs, float* out,
+                  size_t num_rows, size_t row_size) {
+  auto kernel = internal::Kernels().binary[static_cast<int>(op)];
+  for (size_t row = 0; row < num_rows; ++row) {
+    size_t offset = row * row_size;
+    kernel(lhs, rhs + offset, out + offset, row_size);
+  }
+}
+
+void Unary(UnaryOp op, const float* in, float* out, size_t n) {
+  internal::Kernels().unary[static_cast<int>(op)](in, out, n);
+}
+
+float Reduce(ReduceOp op, const float* in, size_t n) {
+  return internal::Kernels().reduce[static_cast<int>(op)](in, n);
+}
+
+void SoftmaxRow(const float* in, float* out, size_t n, bool log) {
+  if (n == 0) return;
+  const internal::KernelTable& kernels = internal::Kernels();
+  float max = kernels.reduce[static_cast<int>(ReduceOp::kMax)](in, n);
+  if (log) {
+    // log_softmax = in - (max + log(sum(exp(in - max))))
+    float sum = kernels.exp_sum(in, max, /*out=*/nullptr, n);
+    kernels.binary_scalar_rhs[static_cast<int>(BinaryOp::kSub)](
+        in, max + std::log(sum), out, n);
+  } else {
+    // softmax = exp(in - max) / sum(exp(in - max))
+    float sum = kernels.exp_sum(in, max, out, n);
+    kernels.binary_scalar_rhs[static_cast<int>(BinaryOp::kMul)](
+        out, 1.0f / sum, out, n);
+  }
+}
+
+void ConvertToFloat(const bf16* in, float* out, size_t n) {
+  internal::Kernels().bf16_to_float(in, out, n);
+}
+
+void ConvertToFloat(const fp16* in, float* out, size_t n) {
+  internal::Kernels().fp16_to_float(in, out, n);
+}
+
+void ConvertFromFloat(const float* in, bf16* out, size_t n) {
+  internal::Kernels().float_to_bf16(in, out, n);
+}
+
+void ConvertFromFloat(const float* in, fp16* out, size_t n) {
+  internal::Kernels().float_to_fp16(in, out, n);
+}
+
+void PackMatMulRhs(const float* rhs, size_t k, size_t n, bool transpose_rhs,
+                   float* packed, size_t panel_begin, size_t panel_end) {
+  for (size_t panel = panel_begin; panel < panel_end; ++panel) {
+    float* dst = packed + panel * kMatMulPanelWidth * k;
+    size_t col_begin = panel * kMatMulPanelWidth;
+    size_t width = std::min(kMatMulPanelWidth, n - col_begin);
+
+    if (transpose_rhs) {
+      // Column j of the panel is the contiguous row col_begin + j of `rhs`.
+      for (size_t j = 0; j < width; ++j) {
+        const float* src = rhs + (col_begin + j) * k;
+        for (size_t i = 0; i < k; ++i) dst[i * kMatMulPanelWidth + j] = src[i];
+      }
+    } else {
+      for (size_t i = 0; i < k; ++i)
+        std::copy_n(rhs + i * n + col_begin, width,
+                    dst + i * kMatMulPanelWidth);
+    }
+
+    if (width == kMatMulPanelWidth) continue;
+    for (size_t i = 0; i < k; ++i)
+      std::fill(dst + i * kMatMulPanelWidth + width,
+                dst + (i + 1) * kMatMulPanelWidth, 0.0f);
+  }
+}
+
+void PackedMatMul(const float* lhs, bool transpose_lhs, const float* packed_rhs,
+                  float* out, size_t m, size_t n, size_t k, size_t panel_begin,
+                  size_t panel_end) {
+  size_t col_begin = panel_begin * kMatMulPanelWidth;
+  size_t col_end = std::min(panel_end * kMatMulPanelWidth, n);
+  if (col_begin >= col_end) return;
+  internal::Kernels().matmul(
+      lhs, /*lhs_row_stride=*/transpose_lhs ? 1 : k,
+      /*lhs_col_stride=*/transpose_lhs ? m : 1, packed_rhs + col_begin * k,
+      out + col_begin, /*ldo=*/n, m, col_end - col_begin, k);
+}
+
+}  // namespace simd
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Vectorized coefficient wise kernels for contiguous float buffers, and a
+// matrix multiplication kernel for matrices with few rows.
+//
+// Eigen selects its packet math when the kernels are compiled, so a binary
+// built for a generic x86-64 target only uses SSE. The kernels below are
+// compiled for several instruction sets (AVX-512, AVX2, NEON and a portable
+// fallback) and the best one supported by the CPU is selected once, when the
+// process starts.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_SIMD_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_SIMD_H_
+
+#include <cstddef>
+
+#include "tfrt/support/bf16.h"
+#include "tfrt/support/fp16.h"
+
+namespace tfrt {
+namespace cpu {
+namespace simd {
+
+enum class BinaryOp { kAdd, kSub, kMul, kDiv, kMax, kMin };
+enum class UnaryOp { kRelu, kSigmoid, kTanh };
+enum class ReduceOp { kSum, kMax };
+
+constexpr int kNumBinaryOps = static_cast<int>(BinaryOp::kMin) + 1;
+constexpr int kNumUnaryOps = static_cast<int>(UnaryOp::kTanh) + 1;
+constexpr int kNumReduceOps = static_cast<int>(ReduceOp::kMax) + 1;
+
+enum class Isa { kGeneric, kNeon, kAvx2, kAvx512 };
+
+// AsyncEigenEvaluator splits large tensors across the thread pool. Tensors with
+// up to this number of elements are cheaper to evaluate inline with the
+// kernels below.
+constexpr size_t kMaxInlineElements = 16 * 1024;
+
+// Returns the instruction set used by the kernels below.
+Isa GetIsa();
+
+// Computes out[i] = lhs[i] op rhs[i] for i in [0, n). `out` may alias `lhs`
+// or `rhs`.
+void Binary(BinaryOp op, const float* lhs, const float* rhs, float* out,
+            size_t n);
+
+// Computes out[i] = lhs op rhs[i].
+void BinaryScalarLhs(BinaryOp op, float lhs, const float* rhs, float* out,
+                     size_t n);
+
+// Computes out[i] = lhs[i] op rhs.
+void BinaryScalarRhs(BinaryOp op, const float* lhs, float rhs, float* out,
+                     size_t n);
+
+// Computes out[r, c] = lhs[r, c] op rhs[c] for `num_rows` rows of `row_size`
+// elements, i.e. broadcasts `rhs` along the outer dimension (e.g. BiasAdd).
+void BinaryRowRhs(BinaryOp op, const float* lhs, const float* rhs, float* out,
+                  size_t num_rows, size_t row_size);
+
+// Computes out[r, c] = lhs[c] op rhs[r, c].
+void BinaryRowLhs(BinaryOp op, const float* lhs, const float* rhs, float* out,
+                  size_t num_rows, size_t row_size);
+
+// Computes out[i] = op(in[i]). `out` may alias `in`. Sigmoid and tanh use the
+// same rational approximation as Eigen.
+void Unary(UnaryOp op, const float* in, float* out, size_t n);
+
+// Returns the reduction of in[i] for i in [0, n) with `op`. The sum of an
+// empty range is 0, the max is -infinity.
+float Reduce(ReduceOp op, const float* in, size_t n);
+
+// Converts `n` values between bf16 or fp16 and float. Conversions to bf16 and
+// fp16 round to nearest even, like FloatToBf16() and FloatToFp16(), so the
+// results only depend on the instruction set in the payload of NaNs.
+void ConvertToFloat(const bf16* in, float* out, size_t n);
+void ConvertToFloat(const fp16* in, float* out, size_t n);
+void ConvertFromFloat(const float* in, bf16* out, size_t n);
+void ConvertFromFloat(const float* in, fp16* out, size_t n);
+
+// Computes the softmax of the `n` logits `in`, or the log softmax if `log` is
+// set, in three passes: the max of the row, the sum of the exponentials of the
+// shifted logits, and the normalization. exp uses the same polynomial
+// approximation as Eigen. `out` may alias `in`.
+void SoftmaxRow(const float* in, float* out, size_t n, bool log);
+
+// Matrix multiplication out[m, n] = lhs[m, k] @ rhs[k, n] for a small `m`
+// (e.g. the batch size of an inference request), where Eigen's contraction
+// spends most of its time packing. `rhs` is packed once into panels of
+// kMatMulPanelWidth columns, each panel holding its k rows contiguously and the
+// columns past `n` zero padded. The packed layout does not depend on the
+// instruction set, so packed weights can be cached and reused by every call.
+
+// The number of columns in a packed panel.
+constexpr size_t kMatMulPanelWidth = 16;
+
+// PackedMatMul() is selected for products with up to this many rows in `lhs`,
+// larger products are left to Eigen.
+constexpr size_t kMaxPackedMatMulRows = 32;
+
+// Returns the number of panels of a packed `rhs` with `n` columns.
+inline size_t NumMatMulPanels(size_t n) {
+  return (n + kMatMulPanelWidth - 1) / kMatMulPanelWidth;
+}
+
+// Returns the number of floats in a packed `rhs` [k, n].
+inline size_t PackedMatMulRhsSize(size_t k, size_t n) {
+  return NumMatMulPanels(n) * kMatMulPanelWidth * k;
+}
+
+// Packs the panels [panel_begin, panel_end) of `rhs` [k, n], or of the
+// transpose of `rhs` [n, k] if `transpose_rhs` is set. `packed` points to the
+// whole packed `rhs` of PackedMatMulRhsSize(k, n) floats.
+void PackMatMulRhs(const float* rhs, size_t k, size_t n, bool transpose_rhs,
+                   float* packed, size_t panel_begin, size_t panel_end);
+
+// Computes the columns of `out` [m, n] covered by the panels
+// [panel_begin, panel_end) of `packed_rhs`. `lhs` is [m, k], or [k, m] if
+// `transpose_lhs` is set.
+void PackedMatMul(const float* lhs, bool transpose_lhs, const float* packed_rhs,
+                  float* out, size_t m, size_t n, size_t k, size_t panel_begin,
+                  size_t panel_end);
+
+}  // namespace simd
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_SIMD_H_
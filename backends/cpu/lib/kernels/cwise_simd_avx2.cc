@@ -0,0 +1,123 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the AVX2 coefficient wise kernels. The kernels are
+// compiled for AVX2 (and F16C for the fp16 conversions) with a target pragma,
+// independent of the compiler flags, and are only called if the CPU supports
+// them.
+
+#include "./cwise_simd.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TFRT_CWISE_SIMD_AVX2 1
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma,f16c"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma,f16c")
+#endif
+#endif
+
+#include "./cwise_simd_impl.h"
+
+namespace tfrt {
+namespace cpu {
+namespace simd {
+namespace internal {
+
+#if defined(TFRT_CWISE_SIMD_AVX2)
+namespace {
+
+struct Avx2Vec {
+  using Reg = __m256;
+  static constexpr size_t kWidth = 8;
+
+  static Reg Load(const float* ptr) { return _mm256_loadu_ps(ptr); }
+  static void Store(float* ptr, Reg value) { _mm256_storeu_ps(ptr, value); }
+  static Reg Set1(float value) { return _mm256_set1_ps(value); }
+  static Reg Add(Reg lhs, Reg rhs) { return _mm256_add_ps(lhs, rhs); }
+  static Reg Sub(Reg lhs, Reg rhs) { return _mm256_sub_ps(lhs, rhs); }
+  static Reg Mul(Reg lhs, Reg rhs) { return _mm256_mul_ps(lhs, rhs); }
+  static Reg Div(Reg lhs, Reg rhs) { return _mm256_div_ps(lhs, rhs); }
+  static Reg Max(Reg lhs, Reg rhs) { return _mm256_max_ps(lhs, rhs); }
+  static Reg Min(Reg lhs, Reg rhs) { return _mm256_min_ps(lhs, rhs); }
+  static Reg MulAdd(Reg a, Reg b, Reg c) { return _mm256_fmadd_ps(a, b, c); }
+  static Reg Floor(Reg value) { return _mm256_floor_ps(value); }
+  static Reg Exp2Int(Reg n) {
+    __m256i exponent =
+        _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(exponent, 23));
+  }
+  static Reg LoadBf16(const bf16* ptr) {
+    __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+    return _mm256_castsi256_ps(
+        _mm256_slli_epi32(_mm256_cvtepu16_epi32(bits), 16));
+  }
+  static void StoreBf16(bf16* ptr, Reg value) {
+    // Same rounding as FloatToBf16(): add 0x7fff plus the lowest kept bit,
+    // and keep NaNs quiet.
+    __m256i bits = _mm256_castps_si256(value);
+    __m256i odd = _mm256_and_si256(_mm256_srli_epi32(bits, 16),
+                                   _mm256_set1_epi32(1));
+    __m256i rounded = _mm256_add_epi32(
+        bits, _mm256_add_epi32(_mm256_set1_epi32(0x7fff), odd));
+    __m256i is_nan =
+        _mm256_castps_si256(_mm256_cmp_ps(value, value, _CMP_UNORD_Q));
+    __m256i quiet_nan = _mm256_or_si256(bits, _mm256_set1_epi32(0x400000));
+    bits = _mm256_srli_epi32(_mm256_blendv_epi8(rounded, quiet_nan, is_nan),
+                             16);
+    // Pack the 32-bit lanes to 16 bits, which interleaves the 128-bit halves,
+    // and move the two valid quarters together.
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(bits, bits),
+                                              _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr),
+                     _mm256_castsi256_si128(packed));
+  }
+  static Reg LoadFp16(const fp16* ptr) {
+    return _mm256_cvtph_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)));
+  }
+  static void StoreFp16(fp16* ptr, Reg value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr),
+                     _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+  }
+};
+
+}  // namespace
+
+const KernelTable* GetAvx2Kernels() {
+  static const KernelTable table = MakeKernelTable<Avx2Vec>();
+  return &table;
+}
+#else
+const KernelTable* GetAvx2Kernels() { return nullptr; }
+#endif
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace cpu
+}  // namespace tfrt
+
+#if defined(TFRT_CWISE_SIMD_AVX2)
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the AVX-512 coefficient wise kernels. The kernels are
+// compiled for AVX-512 with a target pragma, independent of the compiler flags,
+// and are only called if the CPU supports AVX-512.
+
+#include "./cwise_simd.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TFRT_CWISE_SIMD_AVX512 1
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+#endif
+
+#include "./cwise_simd_impl.h"
+
+namespace tfrt {
+namespace cpu {
+namespace simd {
+namespace internal {
+
+#if defined(TFRT_CWISE_SIMD_AVX512)
+namespace {
+
+struct Avx512Vec {
+  using Reg = __m512;
+  static constexpr size_t kWidth = 16;
+
+  static Reg Load(const float* ptr) { return _mm512_loadu_ps(ptr); }
+  static void Store(float* ptr, Reg value) { _mm512_storeu_ps(ptr, value); }
+  static Reg Set1(float value) { return _mm512_set1_ps(value); }
+  static Reg Add(Reg lhs, Reg rhs) { return _mm512_add_ps(lhs, rhs); }
+  static Reg Sub(Reg lhs, Reg rhs) { return _mm512_sub_ps(lhs, rhs); }
+  static Reg Mul(Reg lhs, Reg rhs) { return _mm512_mul_ps(lhs, rhs); }
+  static Reg Div(Reg lhs, Reg rhs) { return _mm512_div_ps(lhs, rhs); }
+  static Reg Max(Reg lhs, Reg rhs) { return _mm512_max_ps(lhs, rhs); }
+  static Reg Min(Reg lhs, Reg rhs) { return _mm512_min_ps(lhs, rhs); }
+  static Reg MulAdd(Reg a, Reg b, Reg c) { return _mm512_fmadd_ps(a, b, c); }
+  static Reg Floor(Reg value) {
+    return _mm512_roundscale_ps(value, _MM_FROUND_TO_NEG_INF);
+  }
+  static Reg Exp2Int(Reg n) {
+    __m512i exponent =
+        _mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(exponent, 23));
+  }
+  // AVX512_BF16 only converts to bf16 with denormals flushed to zero, so the
+  // rounding of FloatToBf16() is done with integer instructions instead.
+  static Reg LoadBf16(const bf16* ptr) {
+    __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+    return _mm512_castsi512_ps(
+        _mm512_slli_epi32(_mm512_cvtepu16_epi32(bits), 16));
+  }
+  static void StoreBf16(bf16* ptr, Reg value) {
+    __m512i bits = _mm512_castps_si512(value);
+    __m512i odd = _mm512_and_si512(_mm512_srli_epi32(bits, 16),
+                                   _mm512_set1_epi32(1));
+    __m512i rounded = _mm512_add_epi32(
+        bits, _mm512_add_epi32(_mm512_set1_epi32(0x7fff), odd));
+    __mmask16 is_nan = _mm512_cmp_ps_mask(value, value, _CMP_UNORD_Q);
+    rounded = _mm512_mask_or_epi32(rounded, is_nan, bits,
+                                   _mm512_set1_epi32(0x400000));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(ptr),
+        _mm512_cvtepi32_epi16(_mm512_srli_epi32(rounded, 16)));
+  }
+  static Reg LoadFp16(const fp16* ptr) {
+    return _mm512_cvtph_ps(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)));
+  }
+  static void StoreFp16(fp16* ptr, Reg value) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(ptr),
+                        _mm512_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+  }
+};
+
+}  // namespace
+
+const KernelTable* GetAvx512Kernels() {
+  static const KernelTable table = MakeKernelTable<Avx512Vec>();
+  return &table;
+}
+#else
+const KernelTable* GetAvx512Kernels() { return nullptr; }
+#endif
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace cpu
+}  // namespace tfrt
+
+#if defined(TFRT_CWISE_SIMD_AVX512)
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
@@ -0,0 +1,525 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Instruction set independent implementation of the kernels in cwise_simd.h.
+//
+// The kernels are templates over a `Vec` type that wraps the intrinsics of one
+// instruction set:
+//
+//   struct Vec {
+//     using Reg = ...;                   // Vector register type.
+//     static constexpr size_t kWidth;    // Number of floats in a register.
+//     static Reg Load(const float*);     // Unaligned load.
+//     static void Store(float*, Reg);    // Unaligned store.
+//     static Reg Set1(float);
+//     static Reg Add(Reg, Reg);  Sub, Mul, Div, Max, Min
+//     static Reg MulAdd(Reg a, Reg b, Reg c);  // a * b + c
+//     static Reg Floor(Reg);
+//     static Reg Exp2Int(Reg n);  // 2^n for integral n in [-126, 127]
+//     static Reg LoadBf16(const bf16*);   // Unaligned load and conversion.
+//     static void StoreBf16(bf16*, Reg);  // Rounds to nearest even.
+//     static Reg LoadFp16(const fp16*);
+//     static void StoreFp16(fp16*, Reg);
+//   };
+//
+// Each instruction set is compiled in its own translation unit, and the
+// templates must be instantiated with a `Vec` type that has internal linkage
+// so that the instantiations for different instruction sets are never merged.
+// A translation unit that enables an instruction set with a target pragma must
+// include cwise_simd.h and all system headers before the pragma, and this
+// header after it, so that the kernels but no code shared with other
+// translation units are compiled for that instruction set.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_SIMD_IMPL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_SIMD_IMPL_H_
+
+#include <cstddef>
+
+#include "./cwise_simd.h"
+
+namespace tfrt {
+namespace cpu {
+namespace simd {
+namespace internal {
+
+// The kernels of one instruction set, indexed by BinaryOp and UnaryOp.
+struct KernelTable {
+  using BinaryFn = void (*)(const float*, const float*, float*, size_t);
+  using BinaryScalarLhsFn = void (*)(float, const float*, float*, size_t);
+  using BinaryScalarRhsFn = void (*)(const float*, float, float*, size_t);
+  using UnaryFn = void (*)(const float*, float*, size_t);
+  using ReduceFn = float (*)(const float*, size_t);
+  // See ExpSumKernel() below.
+  using ExpSumFn = float (*)(const float*, float, float*, size_t);
+  // See PackedMatMulKernel() below.
+  using MatMulFn = void (*)(const float*, size_t, size_t, const float*, float*,
+                            size_t, size_t, size_t, size_t);
+
+  BinaryFn binary[kNumBinaryOps];
+  BinaryScalarLhsFn binary_scalar_lhs[kNumBinaryOps];
+  BinaryScalarRhsFn binary_scalar_rhs[kNumBinaryOps];
+  UnaryFn unary[kNumUnaryOps];
+  ReduceFn reduce[kNumReduceOps];
+  ExpSumFn exp_sum;
+  MatMulFn matmul;
+  void (*bf16_to_float)(const bf16*, float*, size_t);
+  void (*fp16_to_float)(const fp16*, float*, size_t);
+  void (*float_to_bf16)(const float*, bf16*, size_t);
+  void (*float_to_fp16)(const float*, fp16*, size_t);
+};
+
+// Returns the kernels of an instruction set, or nullptr if they were not
+// compiled into the binary or the CPU does not support the instruction set.
+const KernelTable* GetKernels(Isa isa);
+
+// Return the kernels of an instruction set, or nullptr if they were not
+// compiled into the binary. Use GetKernels() instead, the AVX-512 and AVX2
+// kernels must only be used if the CPU supports them.
+const KernelTable* GetGenericKernels();
+const KernelTable* GetNeonKernels();
+const KernelTable* GetAvx2Kernels();
+const KernelTable* GetAvx512Kernels();
+
+// Binary operations.
+#define TFRT_SIMD_BINARY_OP(NAME, FN)                         \
+  struct NAME {                                               \
+    template <typename Vec>                                   \
+    static typename Vec::Reg Apply(typename Vec::Reg lhs,     \
+                                   typename Vec::Reg rhs) {   \
+      return Vec::FN(lhs, rhs);                               \
+    }                                                         \
+  }
+
+TFRT_SIMD_BINARY_OP(AddOp, Add);
+TFRT_SIMD_BINARY_OP(SubOp, Sub);
+TFRT_SIMD_BINARY_OP(MulOp, Mul);
+TFRT_SIMD_BINARY_OP(DivOp, Div);
+TFRT_SIMD_BINARY_OP(MaxOp, Max);
+TFRT_SIMD_BINARY_OP(MinOp, Min);
+
+#undef TFRT_SIMD_BINARY_OP
+
+// Unary operations.
+struct ReluOp {
+  template <typename Vec>
+  static typename Vec::Reg Apply(typename Vec::Reg x) {
+    return Vec::Max(x, Vec::Set1(0.0f));
+  }
+};
+
+struct TanhOp {
+  // Rational approximation of tanh for floats, see
+  // Eigen::internal::generic_fast_tanh_float.
+  template <typename Vec>
+  static typename Vec::Reg Apply(typename Vec::Reg x) {
+    using Reg = typename Vec::Reg;
+    // tanh(x) rounds to +/-1 outside of this range.
+    x = Vec::Max(Vec::Min(x, Vec::Set1(7.90531110763549805f)),
+                 Vec::Set1(-7.90531110763549805f));
+    Reg x2 = Vec::Mul(x, x);
+
+    // The numerator polynomial is odd.
+    Reg p = Vec::MulAdd(x2, Vec::Set1(-2.76076847742355e-16f),
+                        Vec::Set1(2.00018790482477e-13f));
+    p = Vec::MulAdd(x2, p, Vec::Set1(-8.60467152213735e-11f));
+    p = Vec::MulAdd(x2, p, Vec::Set1(5.12229709037114e-08f));
+    p = Vec::MulAdd(x2, p, Vec::Set1(1.48572235717979e-05f));
+    p = Vec::MulAdd(x2, p, Vec::Set1(6.37261928875436e-04f));
+    p = Vec::MulAdd(x2, p, Vec::Set1(4.89352455891786e-03f));
+    p = Vec::Mul(x, p);
+
+    // The denominator polynomial is even.
+    Reg q = Vec::MulAdd(x2, Vec::Set1(1.19825839466702e-06f),
+                        Vec::Set1(1.18534705686654e-04f));
+    q = Vec::MulAdd(x2, q, Vec::Set1(2.26843463243900e-03f));
+    q = Vec::MulAdd(x2, q, Vec::Set1(4.89352518554385e-03f));
+
+    return Vec::Div(p, q);
+  }
+};
+
+struct SigmoidOp {
+  // sigmoid(x) = 0.5 * tanh(0.5 * x) + 0.5
+  template <typename Vec>
+  static typename Vec::Reg Apply(typename Vec::Reg x) {
+    typename Vec::Reg half = Vec::Set1(0.5f);
+    return Vec::MulAdd(half, TanhOp::Apply<Vec>(Vec::Mul(half, x)), half);
+  }
+};
+
+struct ExpOp {
+  // Polynomial approximation of exp for floats, see
+  // Eigen::internal::pexp_float.
+  template <typename Vec>
+  static typename Vec::Reg Apply(typename Vec::Reg x) {
+    using Reg = typename Vec::Reg;
+    // exp(x) overflows above this range, and is a denormal below it.
+    x = Vec::Max(Vec::Min(x, Vec::Set1(88.0f)), Vec::Set1(-87.0f));
+
+    // exp(x) = 2^n * exp(r), with n = round(x / ln(2)) and |r| <= ln(2) / 2.
+    Reg n = Vec::Floor(
+        Vec::MulAdd(x, Vec::Set1(1.44269504088896341f), Vec::Set1(0.5f)));
+    // ln(2) is split into two constants to reduce the rounding error of r.
+    Reg r = Vec::MulAdd(n, Vec::Set1(-0.693359375f), x);
+    r = Vec::MulAdd(n, Vec::Set1(2.12194440e-4f), r);
+
+    Reg p = Vec::MulAdd(r, Vec::Set1(1.9875691500e-4f),
+                        Vec::Set1(1.3981999507e-3f));
+    p = Vec::MulAdd(r, p, Vec::Set1(8.3334519073e-3f));
+    p = Vec::MulAdd(r, p, Vec::Set1(4.1665795894e-2f));
+    p = Vec::MulAdd(r, p, Vec::Set1(1.6666665459e-1f));
+    p = Vec::MulAdd(r, p, Vec::Set1(5.0000001201e-1f));
+    p = Vec::MulAdd(Vec::Mul(r, r), p, Vec::Add(r, Vec::Set1(1.0f)));
+
+    return Vec::Mul(p, Vec::Exp2Int(n));
+  }
+};
+
+// Reductions, with the identity to pad the remainder of a row that does not
+// fill a register.
+struct SumReduction {
+  static constexpr float kIdentity = 0.0f;
+  template <typename Vec>
+  static typename Vec::Reg Apply(typename Vec::Reg lhs,
+                                 typename Vec::Reg rhs) {
+    return Vec::Add(lhs, rhs);
+  }
+  static float Combine(float lhs, float rhs) { return lhs + rhs; }
+};
+
+struct MaxReduction {
+  static constexpr float kIdentity = -__builtin_inff();
+  template <typename Vec>
+  static typename Vec::Reg Apply(typename Vec::Reg lhs,
+                                 typename Vec::Reg rhs) {
+    return Vec::Max(lhs, rhs);
+  }
+  static float Combine(float lhs, float rhs) { return lhs > rhs ? lhs : rhs; }
+};
+
+// Kernels. The remainder of `n` that does not fill a register is processed
+// in a zero padded buffer on the stack.
+
+template <typename Vec>
+void CopyTail(const float* src, float* dst, size_t n) {
+  for (size_t i = 0; i < n; ++i) dst[i] = src[i];
+}
+
+template <typename Vec, typename Op>
+void BinaryKernel(const float* lhs, const float* rhs, float* out, size_t n) {
+  constexpr size_t kWidth = Vec::kWidth;
+  size_t i = 0;
+  for (; i + kWidth <= n; i += kWidth)
+    Vec::Store(out + i, Op::template Apply<Vec>(Vec::Load(lhs + i),
+                                                Vec::Load(rhs + i)));
+  if (i == n) return;
+
+  float lhs_tail[kWidth] = {}, rhs_tail[kWidth] = {}, out_tail[kWidth];
+  CopyTail<Vec>(lhs + i, lhs_tail, n - i);
+  CopyTail<Vec>(rhs + i, rhs_tail, n - i);
+  Vec::Store(out_tail, Op::template Apply<Vec>(Vec::Load(lhs_tail),
+                                               Vec::Load(rhs_tail)));
+  CopyTail<Vec>(out_tail, out + i, n - i);
+}
+
+template <typename Vec, typename Op>
+void BinaryScalarLhsKernel(float lhs, const float* rhs, float* out, size_t n) {
+  constexpr size_t kWidth = Vec::kWidth;
+  typename Vec::Reg lhs_reg = Vec::Set1(lhs);
+  size_t i = 0;
+  for (; i + kWidth <= n; i += kWidth)
+    Vec::Store(out + i, Op::template Apply<Vec>(lhs_reg, Vec::Load(rhs + i)));
+  if (i == n) return;
+
+  float rhs_tail[kWidth] = {}, out_tail[kWidth];
+  CopyTail<Vec>(rhs + i, rhs_tail, n - i);
+  Vec::Store(out_tail, Op::template Apply<Vec>(lhs_reg, Vec::Load(rhs_tail)));
+  CopyTail<Vec>(out_tail, out + i, n - i);
+}
+
+template <typename Vec, typename Op>
+void BinaryScalarRhsKernel(const float* lhs, float rhs, float* out, size_t n) {
+  constexpr size_t kWidth = Vec::kWidth;
+  typename Vec::Reg rhs_reg = Vec::Set1(rhs);
+  size_t i = 0;
+  for (; i + kWidth <= n; i += kWidth)
+    Vec::Store(out + i, Op::template Apply<Vec>(Vec::Load(lhs + i), rhs_reg));
+  if (i == n) return;
+
+  float lhs_tail[kWidth] = {}, out_tail[kWidth];
+  CopyTail<Vec>(lhs + i, lhs_tail, n - i);
+  Vec::Store(out_tail, Op::template Apply<Vec>(Vec::Load(lhs_tail), rhs_reg));
+  CopyTail<Vec>(out_tail, out + i, n - i);
+}
+
+template <typename Vec, typename Op>
+void UnaryKernel(const float* in, float* out, size_t n) {
+  constexpr size_t kWidth = Vec::kWidth;
+  size_t i = 0;
+  for (; i + kWidth <= n; i += kWidth)
+    Vec::Store(out + i, Op::template Apply<Vec>(Vec::Load(in + i)));
+  if (i == n) return;
+
+  float in_tail[kWidth] = {}, out_tail[kWidth];
+  CopyTail<Vec>(in + i, in_tail, n - i);
+  Vec::Store(out_tail, Op::template Apply<Vec>(Vec::Load(in_tail)));
+  CopyTail<Vec>(out_tail, out + i, n - i);
+}
+
+// Returns the reduction of the lanes of `value`.
+template <typename Vec, typename Op>
+float ReduceLanes(typename Vec::Reg value) {
+  float lanes[Vec::kWidth];
+  Vec::Store(lanes, value);
+  float result = lanes[0];
+  for (size_t i = 1; i < Vec::kWidth; ++i)
+    result = Op::Combine(result, lanes[i]);
+  return result;
+}
+
+template <typename Vec, typename Op>
+float ReduceKernel(const float* in, size_t n) {
+  using Reg = typename Vec::Reg;
+  constexpr size_t kWidth = Vec::kWidth;
+  // Independent accumulators hide the latency of the reduction instruction.
+  constexpr size_t kAccumulators = 4;
+
+  Reg acc[kAccumulators];
+  for (size_t j = 0; j < kAccumulators; ++j) acc[j] = Vec::Set1(Op::kIdentity);
+
+  size_t i = 0;
+  for (; i + kAccumulators * kWidth <= n; i += kAccumulators * kWidth)
+    for (size_t j = 0; j < kAccumulators; ++j)
+      acc[j] = Op::template Apply<Vec>(acc[j], Vec::Load(in + i + j * kWidth));
+  for (; i + kWidth <= n; i += kWidth)
+    acc[0] = Op::template Apply<Vec>(acc[0], Vec::Load(in + i));
+
+  if (i < n) {
+    float tail[kWidth];
+    for (size_t j = 0; j < kWidth; ++j) tail[j] = Op::kIdentity;
+    CopyTail<Vec>(in + i, tail, n - i);
+    acc[0] = Op::template Apply<Vec>(acc[0], Vec::Load(tail));
+  }
+
+  for (size_t j = 1; j < kAccumulators; ++j)
+    acc[0] = Op::template Apply<Vec>(acc[0], acc[j]);
+  return ReduceLanes<Vec, Op>(acc[0]);
+}
+
+// Returns the sum of exp(in[i] - shift) for i in [0, n), and stores the
+// exponentials to `out` unless it is nullptr.
+template <typename Vec>
+float ExpSumKernel(const float* in, float shift, float* out, size_t n) {
+  using Reg = typename Vec::Reg;
+  constexpr size_t kWidth = Vec::kWidth;
+  Reg shift_reg = Vec::Set1(shift);
+  Reg acc = Vec::Set1(0.0f);
+
+  size_t i = 0;
+  for (; i + kWidth <= n; i += kWidth) {
+    Reg value = ExpOp::Apply<Vec>(Vec::Sub(Vec::Load(in + i), shift_reg));
+    if (out) Vec::Store(out + i, value);
+    acc = Vec::Add(acc, value);
+  }
+  float sum = ReduceLanes<Vec, SumReduction>(acc);
+  if (i == n) return sum;
+
+  float in_tail[kWidth] = {}, out_tail[kWidth];
+  CopyTail<Vec>(in + i, in_tail, n - i);
+  Vec::Store(out_tail,
+             ExpOp::Apply<Vec>(Vec::Sub(Vec::Load(in_tail), shift_reg)));
+  if (out) CopyTail<Vec>(out_tail, out + i, n - i);
+  for (size_t j = 0; j < n - i; ++j) sum += out_tail[j];
+  return sum;
+}
+
+// Matrix multiplication. Each row block of `lhs` is multiplied with a packed
+// panel of `rhs` in registers: for every k, the panel row is loaded once and
+// multiplied with the broadcast lhs value of every row in the block.
+
+// The number of lhs rows multiplied with a panel at once. The accumulators of
+// a block take kMatMulRowBlock * kMatMulPanelWidth / kWidth registers.
+constexpr size_t kMatMulRowBlock = 4;
+
+template <typename Vec, size_t kRows>
+void MatMulRowBlock(const float* lhs, size_t lhs_row_stride,
+                    size_t lhs_col_stride, const float* panel, float* out,
+                    size_t ldo, size_t width, size_t k) {
+  using Reg = typename Vec::Reg;
+  constexpr size_t kRegs = kMatMulPanelWidth / Vec::kWidth;
+  static_assert(kMatMulPanelWidth % Vec::kWidth == 0,
+                "panel must fill whole registers");
+
+  Reg acc[kRows][kRegs];
+  for (size_t r = 0; r < kRows; ++r)
+    for (size_t j = 0; j < kRegs; ++j) acc[r][j] = Vec::Set1(0.0f);
+
+  for (size_t i = 0; i < k; ++i) {
+    const float* panel_row = panel + i * kMatMulPanelWidth;
+    Reg rhs[kRegs];
+    for (size_t j = 0; j < kRegs; ++j)
+      rhs[j] = Vec::Load(panel_row + j * Vec::kWidth);
+    for (size_t r = 0; r < kRows; ++r) {
+      Reg value = Vec::Set1(lhs[r * lhs_row_stride + i * lhs_col_stride]);
+      for (size_t j = 0; j < kRegs; ++j)
+        acc[r][j] = Vec::MulAdd(value, rhs[j], acc[r][j]);
+    }
+  }
+
+  for (size_t r = 0; r < kRows; ++r) {
+    float* out_row = out + r * ldo;
+    if (width == kMatMulPanelWidth) {
+      for (size_t j = 0; j < kRegs; ++j)
+        Vec::Store(out_row + j * Vec::kWidth, acc[r][j]);
+      continue;
+    }
+    float out_tail[kMatMulPanelWidth];
+    for (size_t j = 0; j < kRegs; ++j)
+      Vec::Store(out_tail + j * Vec::kWidth, acc[r][j]);
+    CopyTail<Vec>(out_tail, out_row, width);
+  }
+}
+
+// Computes out[m, n] = lhs[m, k] @ rhs[k, n], where lhs[r, i] is
+// lhs[r * lhs_row_stride + i * lhs_col_stride] and `packed_rhs` holds the
+// panels of `rhs` covering its n columns. Row r of `out` starts at
+// out + r * ldo.
+template <typename Vec>
+void PackedMatMulKernel(const float* lhs, size_t lhs_row_stride,
+                        size_t lhs_col_stride, const float* packed_rhs,
+                        float* out, size_t ldo, size_t m, size_t n, size_t k) {
+  for (size_t col = 0; col < n; col += kMatMulPanelWidth) {
+    const float* panel = packed_rhs + col * k;
+    size_t width = n - col < kMatMulPanelWidth ? n - col : kMatMulPanelWidth;
+    size_t row = 0;
+    for (; row + kMatMulRowBlock <= m; row += kMatMulRowBlock)
+      MatMulRowBlock<Vec, kMatMulRowBlock>(
+          lhs + row * lhs_row_stride, lhs_row_stride, lhs_col_stride, panel,
+          out + row * ldo + col, ldo, width, k);
+
+    const float* lhs_tail = lhs + row * lhs_row_stride;
+    float* out_tail = out + row * ldo + col;
+    switch (m - row) {
+      case 3:
+        MatMulRowBlock<Vec, 3>(lhs_tail, lhs_row_stride, lhs_col_stride, panel,
+                               out_tail, ldo, width, k);
+        break;
+      case 2:
+        MatMulRowBlock<Vec, 2>(lhs_tail, lhs_row_stride, lhs_col_stride, panel,
+                               out_tail, ldo, width, k);
+        break;
+      case 1:
+        MatMulRowBlock<Vec, 1>(lhs_tail, lhs_row_stride, lhs_col_stride, panel,
+                               out_tail, ldo, width, k);
+        break;
+    }
+  }
+}
+
+template <typename Vec, typename Op>
+void SetBinaryKernels(BinaryOp op, KernelTable* table) {
+  int index = static_cast<int>(op);
+  table->binary[index] = &BinaryKernel<Vec, Op>;
+  table->binary_scalar_lhs[index] = &BinaryScalarLhsKernel<Vec, Op>;
+  table->binary_scalar_rhs[index] = &BinaryScalarRhsKernel<Vec, Op>;
+}
+
+// Conversions between float and the 16-bit floating point types.
+struct Bf16Conversion {
+  using Type = bf16;
+  template <typename Vec>
+  static typename Vec::Reg Load(const bf16* ptr) {
+    return Vec::LoadBf16(ptr);
+  }
+  template <typename Vec>
+  static void Store(bf16* ptr, typename Vec::Reg value) {
+    Vec::StoreBf16(ptr, value);
+  }
+  static float ToFloat(bf16 value) { return Bf16ToFloat(value); }
+  static bf16 FromFloat(float value) { return FloatToBf16(value); }
+};
+
+struct Fp16Conversion {
+  using Type = fp16;
+  template <typename Vec>
+  static typename Vec::Reg Load(const fp16* ptr) {
+    return Vec::LoadFp16(ptr);
+  }
+  template <typename Vec>
+  static void Store(fp16* ptr, typename Vec::Reg value) {
+    Vec::StoreFp16(ptr, value);
+  }
+  static float ToFloat(fp16 value) { return Fp16ToFloat(value); }
+  static fp16 FromFloat(float value) { return FloatToFp16(value); }
+};
+
+// The remainder of `n` that does not fill a register is converted one value at
+// a time, which rounds the same way.
+template <typename Vec, typename Conversion>
+void ToFloatKernel(const typename Conversion::Type* in, float* out, size_t n) {
+  constexpr size_t kWidth = Vec::kWidth;
+  size_t i = 0;
+  for (; i + kWidth <= n; i += kWidth)
+    Vec::Store(out + i, Conversion::template Load<Vec>(in + i));
+  for (; i < n; ++i) out[i] = Conversion::ToFloat(in[i]);
+}
+
+template <typename Vec, typename Conversion>
+void FromFloatKernel(const float* in, typename Conversion::Type* out,
+                     size_t n) {
+  constexpr size_t kWidth = Vec::kWidth;
+  size_t i = 0;
+  for (; i + kWidth <= n; i += kWidth)
+    Conversion::template Store<Vec>(out + i, Vec::Load(in + i));
+  for (; i < n; ++i) out[i] = Conversion::FromFloat(in[i]);
+}
+
+template <typename Vec>
+KernelTable MakeKernelTable() {
+  KernelTable table;
+  SetBinaryKernels<Vec, AddOp>(BinaryOp::kAdd, &table);
+  SetBinaryKernels<Vec, SubOp>(BinaryOp::kSub, &table);
+  SetBinaryKernels<Vec, MulOp>(BinaryOp::kMul, &table);
+  SetBinaryKernels<Vec, DivOp>(BinaryOp::kDiv, &table);
+  SetBinaryKernels<Vec, MaxOp>(BinaryOp::kMax, &table);
+  SetBinaryKernels<Vec, MinOp>(BinaryOp::kMin, &table);
+
+  table.unary[static_cast<int>(UnaryOp::kRelu)] = &UnaryKernel<Vec, ReluOp>;
+  table.unary[static_cast<int>(UnaryOp::kSigmoid)] =
+      &UnaryKernel<Vec, SigmoidOp>;
+  table.unary[static_cast<int>(UnaryOp::kTanh)] = &UnaryKernel<Vec, TanhOp>;
+
+  table.reduce[static_cast<int>(ReduceOp::kSum)] =
+      &ReduceKernel<Vec, SumReduction>;
+  table.reduce[static_cast<int>(ReduceOp::kMax)] =
+      &ReduceKernel<Vec, MaxReduction>;
+  table.exp_sum = &ExpSumKernel<Vec>;
+
+  table.matmul = &PackedMatMulKernel<Vec>;
+
+  table.bf16_to_float = &ToFloatKernel<Vec, Bf16Conversion>;
+  table.fp16_to_float = &ToFloatKernel<Vec, Fp16Conversion>;
+  table.float_to_bf16 = &FromFloatKernel<Vec, Bf16Conversion>;
+  table.float_to_fp16 = &FromFloatKernel<Vec, Fp16Conversion>;
+  return table;
+}
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_SIMD_IMPL_H_
@@ -19,6 +19,10 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_UNARY_KERNELS_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_UNARY_KERNELS_H_
 
+#include <limits>
+#include <type_traits>
+
+#include "./cwise_simd.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/chain.h"
@@ -57,6 +61,53 @@ struct Sigmoid {
 
 }  // namespace functor
 
+namespace internal {
+
+// The vectorized kernel in cwise_simd.h that implements a unary functor.
+template <typename Functor>
+struct SimdUnaryOp : std::false_type {};
+
+template <>
+struct SimdUnaryOp<Eigen::internal::scalar_logistic_op<float>>
+    : std::true_type {
+  static constexpr simd::UnaryOp value = simd::UnaryOp::kSigmoid;
+};
+
+template <>
+struct SimdUnaryOp<Eigen::internal::scalar_tanh_op<float>> : std::true_type {
+  static constexpr simd::UnaryOp value = simd::UnaryOp::kTanh;
+};
+
+// Evaluates the functor with its vectorized kernel if it has one and the input
+// has at most `max_elements`. Returns false if the functor must be evaluated
+// by Eigen.
+template <typename UnaryFunctor>
+bool EvaluateSimdUnary(const DenseHostTensor& input, DenseHostTensor* output,
+                       size_t max_elements, std::false_type) {
+  return false;
+}
+
+template <typename UnaryFunctor>
+bool EvaluateSimdUnary(const DenseHostTensor& input, DenseHostTensor* output,
+                       size_t max_elements, std::true_type) {
+  size_t num_elements = input.NumElements();
+  if (num_elements > max_elements) return false;
+  simd::Unary(SimdUnaryOp<typename UnaryFunctor::Functor>::value,
+              DHTArrayView<float>(&input).data(),
+              MutableDHTArrayView<float>(output).data(), num_elements);
+  return true;
+}
+
+template <typename UnaryFunctor>
+bool EvaluateSimdUnary(const DenseHostTensor& input, DenseHostTensor* output,
+                       size_t max_elements) {
+  return EvaluateSimdUnary<UnaryFunctor>(
+      input, output, max_elements,
+      SimdUnaryOp<typename UnaryFunctor::Functor>());
+}
+
+}  // namespace internal
+
 template <typename UnaryFunctor, typename OnDone>
 static void UnaryKernel(const DenseHostTensor& input, DenseHostTensor* output,
                         const ExecutionContext& exec_ctx, OnDone on_done) {
@@ -64,6 +115,12 @@ static void UnaryKernel(const DenseHostTensor& input, DenseHostTensor* output,
   using T = typename UnaryFunctor::Input;
   using R = typename UnaryFunctor::Output;
 
+  if (internal::EvaluateSimdUnary<UnaryFunctor>(input, output,
+                                                simd::kMaxInlineElements)) {
+    on_done(Error::success());
+    return;
+  }
+
   HostContext* host = exec_ctx.host();
   auto& ctx = host->GetOrCreateSharedContext<compat::EigenHostContext>();
 
@@ -100,6 +157,10 @@ void SyncUnaryKernel(const DenseHostTensor& input, DenseHostTensor* output) {
   using T = typename UnaryFunctor::Input;
   using R = typename UnaryFunctor::Output;
 
+  if (internal::EvaluateSimdUnary<UnaryFunctor>(
+          input, output, std::numeric_limits<size_t>::max()))
+    return;
+
   auto input_t = compat::AsEigenConstTensor(DHTArrayView<T>(&input));
   auto output_t = compat::AsEigenTensor(MutableDHTArrayView<R>(output));
 
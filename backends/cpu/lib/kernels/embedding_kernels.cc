@@ -0,0 +1,289 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the gather and segment reduction kernels.
+
+#include "./embedding_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "./cwise_simd.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace cpu {
+namespace {
+
+// The number of rows that are prefetched ahead of the row being copied or
+// accumulated.
+constexpr size_t kPrefetchDistance = 4;
+// Only the first bytes of larger rows are prefetched, the hardware prefetcher
+// picks up the rest.
+constexpr size_t kMaxPrefetchBytes = 512;
+constexpr size_t kCacheLineSize = 64;
+
+void PrefetchRow(const void* row, size_t row_bytes) {
+#if defined(__GNUC__)
+  const char* ptr = static_cast<const char*>(row);
+  size_t size = std::min(row_bytes, kMaxPrefetchBytes);
+  for (size_t offset = 0; offset < size; offset += kCacheLineSize)
+    __builtin_prefetch(ptr + offset, /*rw=*/0, /*locality=*/1);
+#endif
+}
+
+bool IsIndexDType(DType dtype) {
+  return dtype.kind() == DType::I32 || dtype.kind() == DType::I64;
+}
+
+// Calls `fn` with a pointer to the i32 or i64 elements of `tensor`.
+template <typename Fn>
+auto WithIndices(const DenseHostTensor& tensor, Fn&& fn) {
+  if (tensor.dtype().kind() == DType::I32)
+    return fn(static_cast<const int32_t*>(tensor.data()));
+  return fn(static_cast<const int64_t*>(tensor.data()));
+}
+
+// Returns the number of elements in a row of `tensor`.
+size_t RowSize(const DenseHostTensor& tensor) {
+  size_t row_size = 1;
+  for (int i = 1; i < tensor.shape().GetRank(); ++i)
+    row_size *= tensor.shape().GetDimensionSize(i);
+  return row_size;
+}
+
+template <typename Index>
+Error CheckIndices(const Index* indices, size_t num_indices, ssize_t num_rows) {
+  for (size_t i = 0; i < num_indices; ++i) {
+    if (indices[i] < 0 || indices[i] >= num_rows)
+      return MakeStringError("index ", indices[i], " is out of range [0, ",
+                             num_rows, ")");
+  }
+  return Error::success();
+}
+
+// Computes the positions in the sorted `segment_ids` where each of the
+// `num_segments` segments starts, followed by the number of segment ids.
+template <typename Index>
+Expected<std::vector<size_t>> GetSegmentStarts(const Index* segment_ids,
+                                               size_t num_ids,
+                                               ssize_t num_segments) {
+  std::vector<size_t> starts(num_segments + 1);
+  size_t pos = 0;
+  for (ssize_t s = 0; s <= num_segments; ++s) {
+    while (pos < num_ids && segment_ids[pos] < s) {
+      if (pos > 0 && segment_ids[pos] < segment_ids[pos - 1])
+        return MakeStringError("segment ids are not sorted");
+      ++pos;
+    }
+    starts[s] = pos;
+  }
+  if (pos != num_ids || (num_ids > 0 && segment_ids[0] < 0))
+    return MakeStringError("segment ids must be in [0, ", num_segments, ")");
+  starts[num_segments] = num_ids;
+  return starts;
+}
+
+template <typename Index>
+AsyncValueRef<Chain> GatherImpl(const DenseHostTensor& params,
+                                const DenseHostTensor& indices_tensor,
+                                const Index* indices, DenseHostTensor* output,
+                                const ExecutionContext& exec_ctx) {
+  const size_t num_indices = indices_tensor.NumElements();
+  ssize_t num_rows = params.shape().GetDimensionSize(0);
+  if (auto error = CheckIndices(indices, num_indices, num_rows))
+    return EmitErrorAsync(exec_ctx, std::move(error));
+
+  size_t row_bytes = RowSize(params) * params.dtype().GetHostSize();
+  if (num_indices == 0 || row_bytes == 0) return GetReadyChain();
+
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = row_bytes + sizeof(Index);
+  cost.bytes_stored = row_bytes;
+
+  return ParallelFor(exec_ctx).Execute(
+      num_indices, ParallelFor::BlockSizes::FromCost(cost),
+      [params = params.CopyRef(), indices_tensor = indices_tensor.CopyRef(),
+       indices, output = output->CopyRef(),
+       row_bytes](size_t begin, size_t end) mutable {
+        const char* src = static_cast<const char*>(params.data());
+        char* dst = static_cast<char*>(output.data());
+        for (size_t i = begin; i < end; ++i) {
+          if (i + kPrefetchDistance < end)
+            PrefetchRow(src + indices[i + kPrefetchDistance] * row_bytes,
+                        row_bytes);
+          std::memcpy(dst + i * row_bytes, src + indices[i] * row_bytes,
+                      row_bytes);
+        }
+      });
+}
+
+// Combines the rows of `data` into the segments [segment_begin, segment_end)
+// of `output`. `indices` is null for the identity.
+template <typename Index>
+void ReduceSegments(const float* data, const Index* indices,
+                    ArrayRef<size_t> starts, size_t row_size,
+                    SegmentCombiner combiner, float* output,
+                    size_t segment_begin, size_t segment_end) {
+  auto row = [&](size_t i) {
+    return data + (indices ? static_cast<size_t>(indices[i]) : i) * row_size;
+  };
+  const size_t pos_end = starts[segment_end];
+
+  for (size_t s = segment_begin; s < segment_end; ++s) {
+    float* out = output + s * row_size;
+    const size_t begin = starts[s];
+    const size_t end = starts[s + 1];
+    if (begin == end) {
+      std::memset(out, 0, row_size * sizeof(float));
+      continue;
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+      if (i + kPrefetchDistance < pos_end)
+        PrefetchRow(row(i + kPrefetchDistance), row_size * sizeof(float));
+      if (i == begin) {
+        std::memcpy(out, row(i), row_size * sizeof(float));
+      } else {
+        simd::Binary(simd::BinaryOp::kAdd, out, row(i), out, row_size);
+      }
+    }
+
+    if (combiner == SegmentCombiner::kSum) continue;
+    float count = static_cast<float>(end - begin);
+    float scale = combiner == SegmentCombiner::kMean ? 1.0f / count
+                                                      : 1.0f / std::sqrt(count);
+    simd::BinaryScalarRhs(simd::BinaryOp::kMul, out, scale, out, row_size);
+  }
+}
+
+template <typename Index>
+AsyncValueRef<Chain> SparseSegmentReduceImpl(
+    const DenseHostTensor& data, const DenseHostTensor* indices_tensor,
+    const Index* indices, std::vector<size_t> starts, SegmentCombiner combiner,
+    DenseHostTensor* output, const ExecutionContext& exec_ctx) {
+  const size_t num_segments = starts.size() - 1;
+  const size_t row_size = RowSize(data);
+  if (num_segments == 0 || row_size == 0) return GetReadyChain();
+
+  double rows_per_segment =
+      static_cast<double>(starts.back()) / static_cast<double>(num_segments);
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = rows_per_segment * row_size * sizeof(float);
+  cost.bytes_stored = row_size * sizeof(float);
+  cost.compute_cycles = rows_per_segment * row_size / 8;
+
+  return ParallelFor(exec_ctx).Execute(
+      num_segments, ParallelFor::BlockSizes::FromCost(cost),
+      [data = data.CopyRef(),
+       indices_tensor =
+           indices_tensor ? indices_tensor->CopyRef() : DenseHostTensor(),
+       indices, starts = std::move(starts), row_size, combiner,
+       output = output->CopyRef()](size_t begin, size_t end) mutable {
+        ReduceSegments(static_cast<const float*>(data.data()), indices, starts,
+                       row_size, combiner, static_cast<float*>(output.data()),
+                       begin, end);
+      });
+}
+
+}  // namespace
+
+Expected<SegmentCombiner> ParseSegmentCombiner(string_view combiner) {
+  if (combiner == "sum") return SegmentCombiner::kSum;
+  if (combiner == "mean") return SegmentCombiner::kMean;
+  if (combiner == "sqrtn") return SegmentCombiner::kSqrtN;
+  return MakeStringError("unknown combiner: ", combiner);
+}
+
+Expected<ssize_t> GetNumSegments(const DenseHostTensor& segment_ids) {
+  if (!IsIndexDType(segment_ids.dtype()) || segment_ids.shape().GetRank() != 1)
+    return MakeStringError("segment ids must be an i32 or i64 vector");
+  return WithIndices(segment_ids, [&](auto* ids) -> Expected<ssize_t> {
+    ssize_t num_ids = segment_ids.NumElements();
+    if (num_ids == 0) return 0;
+    if (ids[num_ids - 1] < 0)
+      return MakeStringError("segment ids must not be negative");
+    return static_cast<ssize_t>(ids[num_ids - 1]) + 1;
+  });
+}
+
+AsyncValueRef<Chain> Gather(const DenseHostTensor& params,
+                            const DenseHostTensor& indices,
+                            DenseHostTensor* output,
+                            const ExecutionContext& exec_ctx) {
+  if (params.shape().GetRank() < 1)
+    return EmitErrorAsync(exec_ctx, "params must have at least one dimension");
+  if (!IsIndexDType(indices.dtype()))
+    return EmitErrorAsync(exec_ctx, "indices must be i32 or i64");
+  if (output->dtype() != params.dtype() ||
+      output->NumElements() != indices.NumElements() * RowSize(params))
+    return EmitErrorAsync(exec_ctx, "output has the wrong shape or dtype");
+
+  return WithIndices(indices, [&](auto* ids) {
+    return GatherImpl(params, indices, ids, output, exec_ctx);
+  });
+}
+
+AsyncValueRef<Chain> SparseSegmentReduce(const DenseHostTensor& data,
+                                         const DenseHostTensor* indices,
+                                         const DenseHostTensor& segment_ids,
+                                         SegmentCombiner combiner,
+                                         DenseHostTensor* output,
+                                         const ExecutionContext& exec_ctx) {
+  if (data.dtype().kind() != DType::F32 || data.shape().GetRank() < 1)
+    return EmitErrorAsync(exec_ctx, "data must be an f32 tensor with rows");
+  if (!IsIndexDType(segment_ids.dtype()) || segment_ids.shape().GetRank() != 1)
+    return EmitErrorAsync(exec_ctx, "segment ids must be an i32 or i64 vector");
+  if (indices && (!IsIndexDType(indices->dtype()) ||
+                  indices->shape().GetRank() != 1))
+    return EmitErrorAsync(exec_ctx, "indices must be an i32 or i64 vector");
+
+  const ssize_t num_ids = segment_ids.NumElements();
+  const ssize_t num_rows = data.shape().GetDimensionSize(0);
+  if (num_ids != (indices ? indices->NumElements() : num_rows))
+    return EmitErrorAsync(exec_ctx,
+                          "segment ids must have one element per combined row");
+
+  if (output->dtype().kind() != DType::F32 || output->shape().GetRank() < 1 ||
+      output->NumElements() !=
+          output->shape().GetDimensionSize(0) * RowSize(data))
+    return EmitErrorAsync(exec_ctx, "output has the wrong shape or dtype");
+  const ssize_t num_segments = output->shape().GetDimensionSize(0);
+
+  auto starts = WithIndices(segment_ids, [&](auto* ids) {
+    return GetSegmentStarts(ids, num_ids, num_segments);
+  });
+  if (!starts) return EmitErrorAsync(exec_ctx, starts.takeError());
+
+  if (!indices) {
+    return SparseSegmentReduceImpl<int64_t>(data, nullptr, nullptr,
+                                            std::move(*starts), combiner,
+                                            output, exec_ctx);
+  }
+  return WithIndices(*indices, [&](auto* ids) -> AsyncValueRef<Chain> {
+    if (auto error = CheckIndices(ids, num_ids, num_rows))
+      return EmitErrorAsync(exec_ctx, std::move(error));
+    return SparseSegmentReduceImpl(data, indices, ids, std::move(*starts),
+                                   combiner, output, exec_ctx);
+  });
+}
+
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Gather and segment reduction kernels, e.g. for the embedding lookups of
+// recommender models.
+//
+// The rows of a tensor are its slices along the first dimension. Indices and
+// segment ids are i32 or i64 tensors. The kernels run in parallel blocks on
+// the thread pool, and prefetch the rows that are gathered a few iterations
+// ahead, because embedding tables are usually much larger than the caches.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_EMBEDDING_KERNELS_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_EMBEDDING_KERNELS_H_
+
+#include <sys/types.h>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+enum class SegmentCombiner { kSum, kMean, kSqrtN };
+
+// Parses a combiner attribute: "sum", "mean" or "sqrtn".
+Expected<SegmentCombiner> ParseSegmentCombiner(string_view combiner);
+
+// Returns the number of segments of the sorted, non-negative `segment_ids`,
+// i.e. the last segment id plus one, or zero if there are none.
+Expected<ssize_t> GetNumSegments(const DenseHostTensor& segment_ids);
+
+// Gathers the rows `indices` of `params` into `output`, which has the shape
+// of `indices` followed by the row shape of `params`. Rows are copied as raw
+// bytes, so `params` can have any dtype of fixed size. Returns an error if an
+// index is out of range.
+AsyncValueRef<Chain> Gather(const DenseHostTensor& params,
+                            const DenseHostTensor& indices,
+                            DenseHostTensor* output,
+                            const ExecutionContext& exec_ctx);
+
+// Computes the f32 `output` [num_segments, ...], whose row s is the
+// combination of the rows data[indices[i]] for all i with segment_ids[i] == s.
+// The vector `segment_ids` must be sorted. If `indices` is null, the rows of
+// `data` are combined in order (i.e. indices[i] == i). Segments without rows
+// are zero. The mean and sqrtn combiners divide the sum of a segment by the
+// number of its rows or its square root.
+AsyncValueRef<Chain> SparseSegmentReduce(const DenseHostTensor& data,
+                                         const DenseHostTensor* indices,
+                                         const DenseHostTensor& segment_ids,
+                                         SegmentCombiner combiner,
+                                         DenseHostTensor* output,
+                                         const ExecutionContext& exec_ctx);
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_EMBEDDING_KERNELS_H_
@@ -55,7 +55,7 @@ typename EigenEvaluator::DependencyToken FusedMatMul(
                              DenseHostTensor>::value,
                 "fusion_inputs must be a range of DenseHostTensor");
 
-  EigenEvaluator eigen{exec_ctx.host()};
+  EigenEvaluator eigen{exec_ctx};
 
   // Parse the MatMul fusion config.
   SmallVector<string_view, 4> fused_ops(fused_ops_attr.GetNumElements());
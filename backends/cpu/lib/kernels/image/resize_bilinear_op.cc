@@ -16,6 +16,16 @@
 
 #include "resize_bilinear_op.h"
 
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
 namespace tfrt {
 namespace image {
 namespace {
@@ -44,15 +54,165 @@ void compute_interpolation_weights(const ssize_t out_size,
   }
 }
 
-float compute_lerp(const float top_left, const float top_right,
-                   const float bottom_left, const float bottom_right,
-                   const float x_lerp, const float y_lerp) {
-  const float top = top_left + (top_right - top_left) * x_lerp;
-  const float bottom = bottom_left + (bottom_right - bottom_left) * x_lerp;
-  return top + (bottom - top) * y_lerp;
+// The interpolation weights for resizing images of one size to another.
+// Resizing is separable: every output row is interpolated vertically from two
+// input rows, which are first interpolated horizontally.
+struct InterpolationTables {
+  // The vertical interpolation of each output row.
+  std::vector<CachedInterpolation> ys;
+  // The horizontal interpolation of each value in an output row, i.e. of each
+  // channel of each output pixel. The indices are offsets in an input row, so
+  // that the inner loop has no dependency on the number of channels.
+  std::vector<int32_t> xs_lower;
+  std::vector<int32_t> xs_upper;
+  std::vector<float> xs_lerp;
+};
+
+std::shared_ptr<const InterpolationTables> CreateInterpolationTables(
+    ssize_t input_height, ssize_t input_width, ssize_t channels,
+    float height_scale, float width_scale, ssize_t output_height,
+    ssize_t output_width) {
+  auto tables = std::make_shared<InterpolationTables>();
+  tables->ys.resize(output_height + 1);
+  compute_interpolation_weights(output_height, input_height, height_scale,
+                                tables->ys.data());
+
+  std::vector<CachedInterpolation> xs(output_width + 1);
+  compute_interpolation_weights(output_width, input_width, width_scale,
+                                xs.data());
+  const ssize_t out_row_size = output_width * channels;
+  tables->xs_lower.resize(out_row_size);
+  tables->xs_upper.resize(out_row_size);
+  tables->xs_lerp.resize(out_row_size);
+  for (ssize_t x = 0; x < output_width; ++x) {
+    for (ssize_t c = 0; c < channels; ++c) {
+      tables->xs_lower[x * channels + c] = xs[x].lower * channels + c;
+      tables->xs_upper[x * channels + c] = xs[x].upper * channels + c;
+      tables->xs_lerp[x * channels + c] = xs[x].lerp;
+    }
+  }
+  return tables;
+}
+
+// Returns the interpolation tables for the given sizes. The tables are cached,
+// because a model usually resizes all its images to the same size, and images
+// often have the same size too.
+std::shared_ptr<const InterpolationTables> GetInterpolationTables(
+    ssize_t input_height, ssize_t input_width, ssize_t channels,
+    float height_scale, float width_scale, ssize_t output_height,
+    ssize_t output_width) {
+  using Key = std::tuple<ssize_t, ssize_t, ssize_t, float, float, ssize_t,
+                         ssize_t>;
+  // The cache is cleared when it is full, to bound its memory if the sizes
+  // change all the time.
+  static constexpr size_t kMaxCachedTables = 64;
+  static mutex* mu = new mutex;
+  static auto* cache =
+      new std::map<Key, std::shared_ptr<const InterpolationTables>>;
+
+  Key key(input_height, input_width, channels, height_scale, width_scale,
+          output_height, output_width);
+  {
+    mutex_lock lock(*mu);
+    auto it = cache->find(key);
+    if (it != cache->end()) return it->second;
+  }
+
+  auto tables = CreateInterpolationTables(input_height, input_width, channels,
+                                          height_scale, width_scale,
+                                          output_height, output_width);
+  mutex_lock lock(*mu);
+  if (cache->size() >= kMaxCachedTables) cache->clear();
+  cache->emplace(key, tables);
+  return tables;
+}
+
+// Interpolates the uint8 `input_row` horizontally into the float `output_row`.
+void interpolate_row(const uint8_t* input_row,
+                     const InterpolationTables& tables, float* output_row) {
+  const int32_t* xs_lower = tables.xs_lower.data();
+  const int32_t* xs_upper = tables.xs_upper.data();
+  const float* xs_lerp = tables.xs_lerp.data();
+  const ssize_t size = tables.xs_lerp.size();
+  for (ssize_t i = 0; i < size; ++i) {
+    const float left(input_row[xs_lower[i]]);
+    const float right(input_row[xs_upper[i]]);
+    output_row[i] = left + (right - left) * xs_lerp[i];
+  }
+}
+
+// Interpolates the rows `top` and `bottom` vertically into `output`, and
+// normalizes the result. The loop is over contiguous values only, so that the
+// compiler vectorizes it.
+void interpolate_column(const float* top, const float* bottom, float lerp,
+                        float mean, float scale, ssize_t size,
+                        float* output) {
+  for (ssize_t i = 0; i < size; ++i)
+    output[i] = (top[i] + (bottom[i] - top[i]) * lerp - mean) * scale;
 }
+
 }  // namespace
 
+void resize_image_rows(const uint8_t* input, const ssize_t input_height,
+                       const ssize_t input_width, const ssize_t channels,
+                       const float height_scale, const float width_scale,
+                       const ssize_t output_height, const ssize_t output_width,
+                       const float mean, const float scale,
+                       const ssize_t row_start, const ssize_t row_end,
+                       float* output) {
+  auto tables =
+      GetInterpolationTables(input_height, input_width, channels, height_scale,
+                             width_scale, output_height, output_width);
+
+  const ssize_t in_row_size = input_width * channels;
+  const ssize_t out_row_size = output_width * channels;
+
+  // The horizontally interpolated input rows, which are reused by consecutive
+  // output rows. The upper row of an output row is often the lower row of the
+  // next one.
+  std::vector<float> lower_row(out_row_size), upper_row(out_row_size);
+  ssize_t lower_index = -1, upper_index = -1;
+
+  float* output_y_ptr = output + row_start * out_row_size;
+  for (ssize_t y = row_start; y < row_end; ++y) {
+    const CachedInterpolation& ys = tables->ys[y];
+    if (ys.lower != lower_index) {
+      if (ys.lower == upper_index) {
+        std::swap(lower_row, upper_row);
+        std::swap(lower_index, upper_index);
+      } else {
+        interpolate_row(input + ys.lower * in_row_size, *tables,
+                        lower_row.data());
+        lower_index = ys.lower;
+      }
+    }
+    if (ys.upper != upper_index) {
+      if (ys.upper == lower_index) {
+        std::memcpy(upper_row.data(), lower_row.data(),
+                    out_row_size * sizeof(float));
+      } else {
+        interpolate_row(input + ys.upper * in_row_size, *tables,
+                        upper_row.data());
+      }
+      upper_index = ys.upper;
+    }
+
+    interpolate_column(lower_row.data(), upper_row.data(), ys.lerp, mean, scale,
+                       out_row_size, output_y_ptr);
+    output_y_ptr += out_row_size;
+  }
+}
+
+void resize_image(const uint8_t* input, const ssize_t input_height,
+                  const ssize_t input_width, const ssize_t channels,
+                  const float height_scale, const float width_scale,
+                  const ssize_t output_height, const ssize_t output_width,
+                  const float mean, const float scale, float* output) {
+  resize_image_rows(input, input_height, input_width, channels, height_scale,
+                    width_scale, output_height, output_width, mean, scale,
+                    /*row_start=*/0, /*row_end=*/output_height, output);
+}
+
 void resize_image(const DenseHostTensor& input, const float height_scale,
                   const float width_scale, DenseHostTensor& output) {
   const TensorShape& input_shape = input.shape();
@@ -65,70 +225,17 @@ void resize_image(const DenseHostTensor& input, const float height_scale,
   ssize_t output_height = output_shape.GetDimensionSize(1);
   ssize_t output_width = output_shape.GetDimensionSize(2);
 
-  std::vector<CachedInterpolation> ys(output_height + 1);
-  std::vector<CachedInterpolation> xs(output_width + 1);
-
-  compute_interpolation_weights(output_height, input_height, height_scale,
-                                ys.data());
-  compute_interpolation_weights(output_width, input_width, width_scale,
-                                xs.data());
-
-  // Scale x interpolation weights to avoid a multiplication during iteration.
-  for (int i = 0; i < xs.size(); ++i) {
-    xs[i].lower *= channels;
-    xs[i].upper *= channels;
-  }
-
-  const ssize_t in_row_size = input_width * channels;
-  const ssize_t in_batch_num_values = input_height * in_row_size;
-  const ssize_t out_row_size = output_width * channels;
+  const ssize_t in_batch_num_values = input_height * input_width * channels;
+  const ssize_t out_batch_num_values = output_height * output_width * channels;
   const uint8_t* input_b_ptr = static_cast<const uint8_t*>(input.data());
-  float* output_y_ptr = static_cast<float*>(output.data());
+  float* output_b_ptr = static_cast<float*>(output.data());
 
   for (int b = 0; b < batch_size; ++b) {
-    for (ssize_t y = 0; y < output_height; ++y) {
-      const uint8_t* ys_input_lower_ptr =
-          input_b_ptr + ys[y].lower * in_row_size;
-      const uint8_t* ys_input_upper_ptr =
-          input_b_ptr + ys[y].upper * in_row_size;
-      const float ys_lerp = ys[y].lerp;
-      for (ssize_t x = 0; x < output_width; ++x) {
-        const ssize_t xs_lower = xs[x].lower;
-        const ssize_t xs_upper = xs[x].upper;
-        const float xs_lerp = xs[x].lerp;
-
-        // Read channel 0.
-        const float top_left0(ys_input_lower_ptr[xs_lower + 0]);
-        const float top_right0(ys_input_lower_ptr[xs_upper + 0]);
-        const float bottom_left0(ys_input_upper_ptr[xs_lower + 0]);
-        const float bottom_right0(ys_input_upper_ptr[xs_upper + 0]);
-
-        // Read channel 1.
-        const float top_left1(ys_input_lower_ptr[xs_lower + 1]);
-        const float top_right1(ys_input_lower_ptr[xs_upper + 1]);
-        const float bottom_left1(ys_input_upper_ptr[xs_lower + 1]);
-        const float bottom_right1(ys_input_upper_ptr[xs_upper + 1]);
-
-        // Read channel 2.
-        const float top_left2(ys_input_lower_ptr[xs_lower + 2]);
-        const float top_right2(ys_input_lower_ptr[xs_upper + 2]);
-        const float bottom_left2(ys_input_upper_ptr[xs_lower + 2]);
-        const float bottom_right2(ys_input_upper_ptr[xs_upper + 2]);
-
-        // Compute output.
-        output_y_ptr[x * channels + 0] =
-            compute_lerp(top_left0, top_right0, bottom_left0, bottom_right0,
-                         xs_lerp, ys_lerp);
-        output_y_ptr[x * channels + 1] =
-            compute_lerp(top_left1, top_right1, bottom_left1, bottom_right1,
-                         xs_lerp, ys_lerp);
-        output_y_ptr[x * channels + 2] =
-            compute_lerp(top_left2, top_right2, bottom_left2, bottom_right2,
-                         xs_lerp, ys_lerp);
-      }
-      output_y_ptr += out_row_size;
-    }
+    resize_image(input_b_ptr, input_height, input_width, channels,
+                 height_scale, width_scale, output_height, output_width,
+                 /*mean=*/0.0f, /*scale=*/1.0f, output_b_ptr);
     input_b_ptr += in_batch_num_values;
+    output_b_ptr += out_batch_num_values;
   }
 }
 
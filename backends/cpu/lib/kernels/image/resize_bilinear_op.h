@@ -30,6 +30,24 @@
 namespace tfrt {
 namespace image {
 
+// Resizes the `input_height` x `input_width` image with `channels` uint8
+// channels in `input` to `output_height` x `output_width`, and writes the
+// normalized `(value - mean) * scale` float values to `output`.
+void resize_image(const uint8_t* input, ssize_t input_height,
+                  ssize_t input_width, ssize_t channels, float height_scale,
+                  float width_scale, ssize_t output_height,
+                  ssize_t output_width, float mean, float scale,
+                  float* output);
+
+// Same as above, but only writes the output rows [row_start, row_end), so that
+// the rows of an image can be resized in parallel.
+void resize_image_rows(const uint8_t* input, ssize_t input_height,
+                       ssize_t input_width, ssize_t channels,
+                       float height_scale, float width_scale,
+                       ssize_t output_height, ssize_t output_width, float mean,
+                       float scale, ssize_t row_start, ssize_t row_end,
+                       float* output);
+
 void resize_image(const DenseHostTensor& input, const float height_scale,
                   const float width_scale, DenseHostTensor& output);
 
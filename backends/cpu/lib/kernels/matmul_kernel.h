@@ -19,13 +19,264 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_MATMUL_KERNEL_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_MATMUL_KERNEL_H_
 
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "./packed_matmul_kernel.h"
+
 #include "tfrt/common/compat/eigen/contraction_kernel.h"
+#include "tfrt/common/compat/eigen/contraction_output_kernel.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/common/compat/eigen/tensor_types.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
 
 namespace tfrt {
 namespace cpu {
+namespace internal {
+
+// Rows of the output computed together by one single threaded contraction.
+// Blocks of rows are multiples of this size, large enough to amortize the
+// packing of the right-hand side into each block.
+constexpr Eigen::Index kMatMulBlockRows = 32;
+
+// Evaluates `C = alpha * AB + beta * C` for the rows [row_begin, row_end) of
+// `C` on the calling thread. The output kernel sees the block as a full
+// contraction, which is fine for the fused output kernels that only depend on
+// the output column.
+template <typename T, typename OutputKernel>
+void MatMulRows(float alpha, const T* a, const T* b, float beta, T* c,
+                Eigen::Index k, Eigen::Index n, Eigen::Index m,
+                bool transpose_a, bool transpose_b,
+                const OutputKernel& output_kernel, Eigen::Index row_begin,
+                Eigen::Index row_end) {
+  using ConstMatrix = compat::EigenConstTensor<T, 2>;
+  using Matrix = compat::EigenTensor<T, 2>;
+
+  const Eigen::Index rows = row_end - row_begin;
+
+  Eigen::array<Eigen::IndexPair<Eigen::Index>, 1> contract_dim;
+  contract_dim[0].first = transpose_a ? 0 : 1;
+  contract_dim[0].second = transpose_b ? 1 : 0;
+
+  ConstMatrix in1(b, transpose_b ? n : k, transpose_b ? k : n);
+  Matrix out(c + row_begin * n, rows, n);
+
+  auto evaluate = [&](auto in0) {
+    Eigen::DefaultDevice device;
+    auto contract_expr = in0.contract(in1, contract_dim, output_kernel);
+    if (alpha == 1.0 && beta == 0.0) {
+      out.device(device) = contract_expr;
+    } else if (alpha == 1.0) {
+      out.device(device) = contract_expr + out.constant(beta) * out;
+    } else {
+      out.device(device) =
+          out.constant(alpha) * contract_expr + out.constant(beta) * out;
+    }
+  };
+
+  if (transpose_a) {
+    // Rows of `C` are the columns of the [k, m] matrix `A`.
+    Eigen::array<Eigen::Index, 2> offsets = {0, row_begin};
+    Eigen::array<Eigen::Index, 2> extents = {k, rows};
+    evaluate(ConstMatrix(a, k, m).slice(offsets, extents));
+  } else {
+    evaluate(ConstMatrix(a + row_begin * k, rows, k));
+  }
+}
+
+// Multiplies with weights packed once for Eigen's gebp kernel, and cached
+// across calls for constant weights (see PackedMatMulRhsCache). Eigen computes
+// the row major C = AB as the column major C^T = B^T A^T, so the weights B are
+// the gebp lhs, packed in [block_k, block_n] blocks that each row block of C
+// reuses without packing them again.
+template <typename T>
+class GebpMatMul {
+ public:
+  using Index = Eigen::Index;
+
+  // Blocking sizes for C[m, n] = A[m, k] @ B[k, n].
+  GebpMatMul(Index m, Index n, Index k) : n_(n), k_(k) {
+    block_k_ = k;
+    block_n_ = n;
+    block_m_ = m;
+    Eigen::internal::computeProductBlockingSizes<T, T>(block_k_, block_n_,
+                                                       block_m_);
+  }
+
+  PackedMatMulRhsCache::Layout layout(bool transpose_b) const {
+    return {PackedMatMulRhsCache::Layout::kEigenGebp,
+            static_cast<size_t>(k_),
+            static_cast<size_t>(n_),
+            transpose_b,
+            sizeof(T),
+            static_cast<size_t>(block_k_),
+            static_cast<size_t>(block_n_)};
+  }
+
+  // The number of elements in the packed weights.
+  Index PackedSize() const {
+    Index size = (k_ / block_k_) * PackedRowSize(block_k_);
+    if (k_ % block_k_) size += PackedRowSize(k_ % block_k_);
+    return size;
+  }
+
+  // Packs B [k, n], or [n, k] if `transpose_b`, into `packed`.
+  void PackWeights(const T* b, bool transpose_b, T* packed) const {
+    if (transpose_b) {
+      PackWeights<Eigen::RowMajor>(LhsMapper<Eigen::RowMajor>(b, k_), packed);
+    } else {
+      PackWeights<Eigen::ColMajor>(LhsMapper<Eigen::ColMajor>(b, n_), packed);
+    }
+  }
+
+  // Evaluates `C = alpha * AB + beta * C` for the rows [row_begin, row_end) of
+  // `C` on the calling thread. The output kernel is called for every output
+  // block after its product is accumulated.
+  template <typename OutputKernel>
+  void MatMulRows(float alpha, const T* a, const T* packed_b, float beta, T* c,
+                  Index m, bool transpose_a, const OutputKernel& output_kernel,
+                  Index row_begin, Index row_end) const {
+    T* c_rows = c + row_begin * n_;
+    const Index rows = row_end - row_begin;
+    if (beta == 0.0) {
+      std::fill(c_rows, c_rows + rows * n_, T(0));
+    } else if (beta != 1.0) {
+      for (T* v = c_rows; v != c_rows + rows * n_; ++v) *v *= T(beta);
+    }
+
+    if (transpose_a) {
+      // Rows of `C` are the columns of the [k, m] matrix `A`.
+      MatMulRows<Eigen::RowMajor>(
+          alpha, RhsMapper<Eigen::RowMajor>(a + row_begin, m), packed_b, c_rows,
+          rows, output_kernel, row_begin);
+    } else {
+      MatMulRows<Eigen::ColMajor>(
+          alpha, RhsMapper<Eigen::ColMajor>(a + row_begin * k_, k_), packed_b,
+          c_rows, rows, output_kernel, row_begin);
+    }
+  }
+
+ private:
+  using Traits = Eigen::internal::gebp_traits<T, T>;
+  using OutputMapper = compat::internal::ContractionOutputMapper<T>;
+
+  template <int StorageOrder>
+  using LhsMapper =
+      Eigen::internal::const_blas_data_mapper<T, Index, StorageOrder>;
+  template <int StorageOrder>
+  using RhsMapper =
+      Eigen::internal::const_blas_data_mapper<T, Index, StorageOrder>;
+
+  // Packed blocks start at offsets aligned for the packet loads of gebp.
+  static constexpr Index kAlignment =
+      std::max<Index>(EIGEN_MAX_ALIGN_BYTES / sizeof(T), 1);
+
+  static Index Align(Index size) {
+    return (size + kAlignment - 1) / kAlignment * kAlignment;
+  }
+
+  // The number of elements in the packed blocks of `depth` rows of B.
+  Index PackedRowSize(Index depth) const {
+    Index size = (n_ / block_n_) * Align(depth * block_n_);
+    if (n_ % block_n_) size += Align(depth * (n_ % block_n_));
+    return size;
+  }
+
+  // Returns the offset of the packed block at B[k2, i2].
+  Index PackedOffset(Index k2, Index i2) const {
+    const Index depth = std::min(k2 + block_k_, k_) - k2;
+    return (k2 / block_k_) * PackedRowSize(block_k_) +
+           (i2 / block_n_) * Align(depth * block_n_);
+  }
+
+  template <int StorageOrder>
+  void PackWeights(const LhsMapper<StorageOrder>& lhs, T* packed) const {
+    Eigen::internal::gemm_pack_lhs<T, Index, LhsMapper<StorageOrder>,
+                                   Traits::mr, Traits::LhsProgress,
+                                   typename Traits::LhsPacket4Packing,
+                                   StorageOrder>
+        pack_lhs;
+    for (Index k2 = 0; k2 < k_; k2 += block_k_) {
+      const Index depth = std::min(k2 + block_k_, k_) - k2;
+      for (Index i2 = 0; i2 < n_; i2 += block_n_) {
+        const Index cols = std::min(i2 + block_n_, n_) - i2;
+        pack_lhs(packed + PackedOffset(k2, i2), lhs.getSubMapper(i2, k2),
+                 depth, cols);
+      }
+    }
+  }
+
+  template <int StorageOrder, typename OutputKernel>
+  void MatMulRows(float alpha, const RhsMapper<StorageOrder>& rhs,
+                  const T* packed_b, T* c_rows, Index rows,
+                  const OutputKernel& output_kernel, Index row_begin) const {
+    Eigen::internal::gemm_pack_rhs<T, Index, RhsMapper<StorageOrder>,
+                                   Traits::nr, StorageOrder>
+        pack_rhs;
+    Eigen::internal::gebp_kernel<T, T, Index, OutputMapper, Traits::mr,
+                                 Traits::nr, /*ConjugateLhs=*/false,
+                                 /*ConjugateRhs=*/false>
+        gebp;
+
+    const Index block_m = std::min(block_m_, rows);
+    std::vector<T, Eigen::aligned_allocator<T>> packed_a(block_k_ * block_m);
+
+    OutputMapper output(c_rows, n_);
+    Eigen::TensorContractionParams params{/*swapped_arguments=*/true};
+
+    for (Index j2 = 0; j2 < rows; j2 += block_m) {
+      const Index actual_m = std::min(j2 + block_m, rows) - j2;
+      for (Index k2 = 0; k2 < k_; k2 += block_k_) {
+        const Index depth = std::min(k2 + block_k_, k_) - k2;
+        pack_rhs(packed_a.data(), rhs.getSubMapper(k2, j2), depth, actual_m);
+
+        for (Index i2 = 0; i2 < n_; i2 += block_n_) {
+          const Index cols = std::min(i2 + block_n_, n_) - i2;
+          const OutputMapper output_block = output.getSubMapper(i2, j2);
+          gebp(output_block, packed_b + PackedOffset(k2, i2), packed_a.data(),
+               cols, depth, actual_m, T(alpha));
+          if (k2 + depth == k_) {
+            output_kernel(output_block, params, i2, row_begin + j2, cols,
+                          actual_m);
+          }
+        }
+      }
+    }
+  }
+
+  Index n_;
+  Index k_;
+  Index block_k_;
+  Index block_n_;
+  Index block_m_;
+};
+
+// Returns the cached gebp packing of the weights `b`, or null if they are not
+// cached. Output kernels are applied before `alpha` and `beta` by the Eigen
+// contraction, so they are only fused into the cached path without them.
+template <typename T, typename OutputKernel>
+RCReference<HostBuffer> GetCachedGebpWeights(
+    const GebpMatMul<T>& gebp, const DenseHostTensor& b, bool transpose_b,
+    float alpha, float beta, HostContext* host) {
+  if (!std::is_same<T, float>::value && !std::is_same<T, double>::value)
+    return {};
+  if (!std::is_same<OutputKernel, Eigen::NoOpOutputKernel>::value &&
+      (alpha != 1.0 || beta != 0.0))
+    return {};
+
+  auto& cache = host->GetOrCreateSharedContext<PackedMatMulRhsCache>();
+  return cache.GetOrPack(b, gebp.layout(transpose_b),
+                         gebp.PackedSize() * sizeof(T), [&](void* packed) {
+                           gebp.PackWeights(static_cast<const T*>(b.data()),
+                                            transpose_b,
+                                            static_cast<T*>(packed));
+                         });
+}
+
+}  // namespace internal
 
 // General matrix multiplication kernel:
 //   C = alpha * AB + beta * C
@@ -51,6 +302,55 @@ typename EigenEvaluator::DependencyToken MatMul(
 
   auto buffers = eigen.KeepAlive(&a, &b, c);
 
+  // With enough rows to give every thread a block, the rows of `C` are split
+  // into parallel blocks that each run a single threaded contraction. This
+  // keeps large products off the Eigen thread pool device, whose tasks do not
+  // know about the request. Short and wide products are left to Eigen, which
+  // also splits the columns.
+  const Eigen::Index m = out.dimension(0);
+  const Eigen::Index n = out.dimension(1);
+  const Eigen::Index k = in0.dimension(transpose_a ? 0 : 1);
+  if (m >= internal::kMatMulBlockRows * eigen.NumThreads()) {
+    const Eigen::Index num_blocks =
+        (m + internal::kMatMulBlockRows - 1) / internal::kMatMulBlockRows;
+    const double block_rows = internal::kMatMulBlockRows;
+
+    ParallelFor::Cost cost;
+    cost.bytes_loaded = block_rows * k * sizeof(T);
+    cost.bytes_stored = block_rows * n * sizeof(T);
+    cost.compute_cycles = block_rows * k * n;
+
+    const T* a_data = in0.data();
+    const T* b_data = in1.data();
+    T* c_data = out.data();
+
+    // Constant weights are packed once and shared by all row blocks.
+    internal::GebpMatMul<T> gebp(m, n, k);
+    if (auto packed_b = internal::GetCachedGebpWeights<T, OutputKernel>(
+            gebp, b, transpose_b, alpha, beta, eigen.host())) {
+      const T* packed_data = static_cast<const T*>(packed_b->data());
+      return eigen.ParallelEvaluate(
+          num_blocks, cost,
+          [=](size_t begin, size_t end) {
+            gebp.MatMulRows(
+                alpha, a_data, packed_data, beta, c_data, m, transpose_a,
+                output_kernel, begin * internal::kMatMulBlockRows,
+                std::min<Eigen::Index>(end * internal::kMatMulBlockRows, m));
+          },
+          std::make_pair(std::move(buffers), std::move(packed_b)));
+    }
+
+    return eigen.ParallelEvaluate(
+        num_blocks, cost,
+        [=](size_t begin, size_t end) {
+          internal::MatMulRows<T>(
+              alpha, a_data, b_data, beta, c_data, k, n, m, transpose_a,
+              transpose_b, output_kernel, begin * internal::kMatMulBlockRows,
+              std::min<Eigen::Index>(end * internal::kMatMulBlockRows, m));
+        },
+        std::move(buffers));
+  }
+
   auto contract_expr = in0.contract(in1, contract_dim, output_kernel);
 
   if (alpha == 1.0 && beta == 0.0) {
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the packed matmul kernel and its rhs cache.
+
+#include "./packed_matmul_kernel.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "tfrt/host_context/parallel_for.h"
+
+namespace tfrt {
+namespace cpu {
+
+RCReference<HostBuffer> PackedMatMulRhsCache::GetOrPack(
+    const DenseHostTensor& rhs, bool transpose_rhs, size_t k, size_t n) {
+  Layout layout{Layout::kPanels, k, n, transpose_rhs};
+  return GetOrPack(
+      rhs, layout, simd::PackedMatMulRhsSize(k, n) * sizeof(float),
+      [&](void* packed) {
+        simd::PackMatMulRhs(static_cast<const float*>(rhs.data()), k, n,
+                            transpose_rhs, static_cast<float*>(packed),
+                            /*panel_begin=*/0, simd::NumMatMulPanels(n));
+      });
+}
+
+RCReference<HostBuffer> PackedMatMulRhsCache::GetOrPack(
+    const DenseHostTensor& rhs, const Layout& layout, size_t packed_bytes,
+    llvm::function_ref<void(void*)> pack) {
+  Key key(rhs.data(), layout.format, layout.k, layout.n, layout.transpose,
+          layout.element_size, layout.block_k, layout.block_n);
+  if (packed_bytes > kCapacityBytes) return {};
+
+  {
+    mutex_lock lock(mu_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) return it->second.packed.CopyRef();
+
+    auto seen = std::find(seen_.begin(), seen_.end(), key);
+    if (seen == seen_.end()) {
+      seen_.push_back(key);
+      if (seen_.size() > kMaxSeen) seen_.pop_front();
+      return {};
+    }
+    seen_.erase(seen);
+  }
+
+  auto packed = HostBuffer::CreateUninitialized(
+      packed_bytes, alignof(std::max_align_t), host_->allocator());
+  if (!packed) return {};
+  pack(packed->data());
+
+  mutex_lock lock(mu_);
+  // Another thread may have packed the same tensor concurrently.
+  auto inserted =
+      entries_.emplace(key, Entry{rhs.buffer().CopyRef(), packed.CopyRef()});
+  if (!inserted.second) return inserted.first->second.packed.CopyRef();
+
+  insertion_order_.push_back(key);
+  size_bytes_ += packed_bytes;
+  while (size_bytes_ > kCapacityBytes) {
+    auto oldest = entries_.find(insertion_order_.front());
+    size_bytes_ -= oldest->second.packed->size();
+    entries_.erase(oldest);
+    insertion_order_.pop_front();
+  }
+  return packed;
+}
+
+AsyncValueRef<Chain> PackedMatMul(const DenseHostTensor& a,
+                                  const DenseHostTensor& b, DenseHostTensor* c,
+                                  bool transpose_a, bool transpose_b,
+                                  const ExecutionContext& exec_ctx) {
+  const size_t m = c->shape().GetDimensionSize(0);
+  const size_t n = c->shape().GetDimensionSize(1);
+  const size_t k = a.shape().GetDimensionSize(transpose_a ? 0 : 1);
+  assert(UsePackedMatMul(a.dtype(), m, n, k));
+
+  HostContext* host = exec_ctx.host();
+  auto& cache = host->GetOrCreateSharedContext<PackedMatMulRhsCache>();
+  RCReference<HostBuffer> packed = cache.GetOrPack(b, transpose_b, k, n);
+
+  // Uncached tensors are packed by each task for the panels it multiplies.
+  const bool is_packed = static_cast<bool>(packed);
+  if (!is_packed) {
+    packed = HostBuffer::CreateUninitialized(
+        simd::PackedMatMulRhsSize(k, n) * sizeof(float), alignof(float),
+        host->allocator());
+    if (!packed) return EmitErrorAsync(exec_ctx, "out of memory packing rhs");
+  }
+
+  ParallelFor::Cost cost;
+  cost.bytes_loaded =
+      (k * simd::kMatMulPanelWidth * (is_packed ? 1 : 2) + m * k) *
+      sizeof(float);
+  cost.bytes_stored = (m + (is_packed ? 0 : k)) * simd::kMatMulPanelWidth *
+                      sizeof(float);
+  cost.compute_cycles = m * k;
+
+  float* c_data = static_cast<float*>(c->data());
+  return ParallelFor(exec_ctx).Execute(
+      simd::NumMatMulPanels(n), ParallelFor::BlockSizes::FromCost(cost),
+      [a = a.CopyRef(), b = b.CopyRef(), packed = std::move(packed), is_packed,
+       c_data, transpose_a, transpose_b, m, n, k](size_t begin, size_t end) {
+        auto* packed_data = static_cast<float*>(packed->data());
+        if (!is_packed)
+          simd::PackMatMulRhs(static_cast<const float*>(b.data()), k, n,
+                              transpose_b, packed_data, begin, end);
+        simd::PackedMatMul(static_cast<const float*>(a.data()), transpose_a,
+                           packed_data, c_data, m, n, k, begin, end);
+      });
+}
+
+}  // namespace cpu
+}  // namespace tfrt
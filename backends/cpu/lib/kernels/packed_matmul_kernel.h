@@ -0,0 +1,128 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Matrix multiplication kernel for float matrices with few rows, that
+// multiplies with rhs panels packed once and cached for constant weights.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_PACKED_MATMUL_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_PACKED_MATMUL_KERNEL_H_
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <tuple>
+
+#include "./cwise_simd.h"
+#include "llvm/ADT/STLExtras.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/host_context/shared_context.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Returns true if C[m, n] = A[m, k] @ B[k, n] should be computed with
+// PackedMatMul() instead of Eigen's contraction.
+inline bool UsePackedMatMul(DType dtype, ssize_t m, ssize_t n, ssize_t k) {
+  return dtype.kind() == DType::F32 && m > 0 &&
+         m <= static_cast<ssize_t>(simd::kMaxPackedMatMulRows) && n > 0 &&
+         k > 0;
+}
+
+// Caches the packed panels of matmul rhs tensors, which are usually weights
+// multiplied in every step. A tensor is packed and cached the second time it
+// is seen, so that activations multiplied once are not. The cache holds a
+// reference to the rhs buffer, so that its address is not reused while cached.
+// Tensors are immutable, so the packed panels never become stale.
+class PackedMatMulRhsCache : public SharedContext {
+ public:
+  // The total size of the cached packed tensors. The oldest entries are
+  // evicted first.
+  static constexpr size_t kCapacityBytes = 64 << 20;
+
+  // The number of uncached tensors remembered to detect the second use.
+  static constexpr size_t kMaxSeen = 64;
+
+  // Describes how a rhs [k, n] (or [n, k] if `transpose`) is packed. The same
+  // tensor may be cached in several layouts.
+  struct Layout {
+    enum Format {
+      // The panels of simd::PackMatMulRhs().
+      kPanels,
+      // The blocks of Eigen's gebp kernel (see matmul_kernel.h), which depend
+      // on the blocking sizes and the element type.
+      kEigenGebp,
+    };
+
+    Format format;
+    size_t k;
+    size_t n;
+    bool transpose;
+    size_t element_size = sizeof(float);
+    size_t block_k = 0;
+    size_t block_n = 0;
+  };
+
+  explicit PackedMatMulRhsCache(HostContext* host) : host_(host) {}
+
+  // Returns the packed `rhs` [k, n] (or [n, k] if `transpose_rhs`), or null if
+  // it is not cached and the caller should pack it itself.
+  RCReference<HostBuffer> GetOrPack(const DenseHostTensor& rhs,
+                                    bool transpose_rhs, size_t k, size_t n);
+
+  // Returns `rhs` packed in `layout`, or null if it is not cached and the
+  // caller should pack it itself. `pack` writes the `packed_bytes` of the
+  // layout into its argument.
+  RCReference<HostBuffer> GetOrPack(const DenseHostTensor& rhs,
+                                    const Layout& layout, size_t packed_bytes,
+                                    llvm::function_ref<void(void*)> pack);
+
+ private:
+  using Key = std::tuple<const void*, int, size_t, size_t, bool, size_t,
+                         size_t, size_t>;
+
+  struct Entry {
+    RCReference<HostBuffer> rhs;
+    RCReference<HostBuffer> packed;
+  };
+
+  HostContext* host_;
+  mutex mu_;
+  std::map<Key, Entry> entries_ TFRT_GUARDED_BY(mu_);
+  std::deque<Key> insertion_order_ TFRT_GUARDED_BY(mu_);
+  size_t size_bytes_ TFRT_GUARDED_BY(mu_) = 0;
+  std::deque<Key> seen_ TFRT_GUARDED_BY(mu_);
+};
+
+// Computes C[m, n] = A[m, k] @ B[k, n] for float tensors, where A and B are
+// transposed if `transpose_a` and `transpose_b` are set. The columns of C are
+// computed in parallel, one or more panels at a time. The returned chain
+// becomes available when C is computed. A and B are kept alive until then, C
+// must be kept alive by the caller.
+AsyncValueRef<Chain> PackedMatMul(const DenseHostTensor& a,
+                                  const DenseHostTensor& b, DenseHostTensor* c,
+                                  bool transpose_a, bool transpose_b,
+                                  const ExecutionContext& exec_ctx);
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_PACKED_MATMUL_KERNEL_H_
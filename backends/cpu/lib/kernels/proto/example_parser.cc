@@ -0,0 +1,367 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements a parser that extracts features from serialized
+// tf.Example protos without deserializing them.
+//
+// The parser reads the protobuf wire format of example.proto directly:
+//
+//   Example:   1: Features (message)
+//   Features:  1: repeated map entry {1: key (string), 2: value (Feature)}
+//   Feature:   1: BytesList, 2: FloatList, 3: Int64List (oneof)
+//   BytesList: 1: repeated bytes
+//   FloatList: 1: repeated float (packed or not)
+//   Int64List: 1: repeated int64 (packed or not)
+
+#include "example_parser.h"
+
+#include <cstring>
+
+#include "llvm/Support/Endian.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace proto {
+namespace {
+
+enum WireType {
+  kVarint = 0,
+  kFixed64 = 1,
+  kLengthDelimited = 2,
+  kFixed32 = 5,
+};
+
+// Reads fields in the protobuf wire format from a buffer.
+class WireReader {
+ public:
+  explicit WireReader(string_view buffer)
+      : ptr_(buffer.bytes_begin()), end_(buffer.bytes_end()) {}
+
+  bool done() const { return ptr_ == end_; }
+
+  // The Read* functions return false if the buffer is malformed.
+  bool ReadVarint(uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (ptr_ == end_) return false;
+      uint8_t byte = *ptr_++;
+      result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool ReadTag(int* field, int* wire_type) {
+    uint64_t tag;
+    if (!ReadVarint(&tag)) return false;
+    *field = static_cast<int>(tag >> 3);
+    *wire_type = static_cast<int>(tag & 7);
+    return true;
+  }
+
+  bool ReadLengthDelimited(string_view* value) {
+    uint64_t size;
+    if (!ReadVarint(&size) || size > static_cast<uint64_t>(end_ - ptr_))
+      return false;
+    *value = string_view(reinterpret_cast<const char*>(ptr_), size);
+    ptr_ += size;
+    return true;
+  }
+
+  bool ReadFixed32(uint32_t* value) {
+    if (end_ - ptr_ < 4) return false;
+    *value = llvm::support::endian::read32le(ptr_);
+    ptr_ += 4;
+    return true;
+  }
+
+  bool SkipField(int wire_type) {
+    uint64_t varint;
+    string_view value;
+    switch (wire_type) {
+      case kVarint:
+        return ReadVarint(&varint);
+      case kFixed64:
+        return Skip(8);
+      case kLengthDelimited:
+        return ReadLengthDelimited(&value);
+      case kFixed32:
+        return Skip(4);
+      default:
+        // Groups are not used by example.proto.
+        return false;
+    }
+  }
+
+ private:
+  bool Skip(size_t size) {
+    if (static_cast<size_t>(end_ - ptr_) < size) return false;
+    ptr_ += size;
+    return true;
+  }
+
+  const uint8_t* ptr_;
+  const uint8_t* end_;
+};
+
+Error MakeMalformedError(const char* message) {
+  return MakeStringError("malformed tf.Example: ", message);
+}
+
+// Parses a Feature message into `feature`. A Feature without a value list is
+// not found, like a missing feature.
+Error ParseFeature(string_view value, SerializedFeature* feature) {
+  *feature = SerializedFeature();
+  WireReader reader(value);
+  while (!reader.done()) {
+    int field, wire_type;
+    if (!reader.ReadTag(&field, &wire_type))
+      return MakeMalformedError("bad Feature tag");
+    if (wire_type == kLengthDelimited && field >= 1 && field <= 3) {
+      // The last value of a oneof wins.
+      if (!reader.ReadLengthDelimited(&feature->list))
+        return MakeMalformedError("bad Feature value");
+      feature->found = true;
+      feature->type = field == 1   ? FeatureType::kBytes
+                      : field == 2 ? FeatureType::kFloat
+                                   : FeatureType::kInt64;
+    } else if (!reader.SkipField(wire_type)) {
+      return MakeMalformedError("bad Feature field");
+    }
+  }
+  return Error::success();
+}
+
+// Parses a map entry of the Features message, and its value if the key is
+// requested.
+Error ParseFeatureMapEntry(string_view entry,
+                           const llvm::StringMap<int>& key_indices,
+                           MutableArrayRef<SerializedFeature> features) {
+  string_view key, value;
+  WireReader reader(entry);
+  while (!reader.done()) {
+    int field, wire_type;
+    if (!reader.ReadTag(&field, &wire_type))
+      return MakeMalformedError("bad feature map tag");
+    if (wire_type == kLengthDelimited && field == 1) {
+      if (!reader.ReadLengthDelimited(&key))
+        return MakeMalformedError("bad feature key");
+    } else if (wire_type == kLengthDelimited && field == 2) {
+      if (!reader.ReadLengthDelimited(&value))
+        return MakeMalformedError("bad feature value");
+    } else if (!reader.SkipField(wire_type)) {
+      return MakeMalformedError("bad feature map field");
+    }
+  }
+
+  auto it = key_indices.find(key);
+  if (it == key_indices.end()) return Error::success();
+  // Like for protobuf maps, the last entry of a key wins.
+  return ParseFeature(value, &features[it->second]);
+}
+
+Error ParseFeatures(string_view message,
+                    const llvm::StringMap<int>& key_indices,
+                    MutableArrayRef<SerializedFeature> features) {
+  WireReader reader(message);
+  while (!reader.done()) {
+    int field, wire_type;
+    if (!reader.ReadTag(&field, &wire_type))
+      return MakeMalformedError("bad Features tag");
+    if (wire_type == kLengthDelimited && field == 1) {
+      string_view entry;
+      if (!reader.ReadLengthDelimited(&entry))
+        return MakeMalformedError("bad feature map entry");
+      if (auto error = ParseFeatureMapEntry(entry, key_indices, features))
+        return error;
+    } else if (!reader.SkipField(wire_type)) {
+      return MakeMalformedError("bad Features field");
+    }
+  }
+  return Error::success();
+}
+
+// Calls `on_packed(payload)` or `on_value(reader)` for each packed or unpacked
+// element of the repeated field 1 of `list`, whose unpacked elements have wire
+// type `wire_type`.
+template <typename OnPacked, typename OnValue>
+Error ForEachListField(string_view list, int wire_type, OnPacked on_packed,
+                       OnValue on_value) {
+  WireReader reader(list);
+  while (!reader.done()) {
+    int field, field_wire_type;
+    if (!reader.ReadTag(&field, &field_wire_type))
+      return MakeMalformedError("bad value list tag");
+    if (field == 1 && field_wire_type == kLengthDelimited) {
+      string_view payload;
+      if (!reader.ReadLengthDelimited(&payload))
+        return MakeMalformedError("bad value list");
+      if (auto error = on_packed(payload)) return error;
+    } else if (field == 1 && field_wire_type == wire_type) {
+      if (!on_value(reader)) return MakeMalformedError("bad value");
+    } else if (!reader.SkipField(field_wire_type)) {
+      return MakeMalformedError("bad value list field");
+    }
+  }
+  return Error::success();
+}
+
+Error CheckType(const SerializedFeature& feature, FeatureType type) {
+  if (feature.found && feature.type != type)
+    return MakeStringError("feature has a different type than requested");
+  return Error::success();
+}
+
+}  // namespace
+
+Error FindFeatures(string_view example, const llvm::StringMap<int>& key_indices,
+                   MutableArrayRef<SerializedFeature> features) {
+  WireReader reader(example);
+  while (!reader.done()) {
+    int field, wire_type;
+    if (!reader.ReadTag(&field, &wire_type))
+      return MakeMalformedError("bad Example tag");
+    if (wire_type == kLengthDelimited && field == 1) {
+      // Repeated occurrences of a message field are merged.
+      string_view message;
+      if (!reader.ReadLengthDelimited(&message))
+        return MakeMalformedError("bad Features");
+      if (auto error = ParseFeatures(message, key_indices, features))
+        return error;
+    } else if (!reader.SkipField(wire_type)) {
+      return MakeMalformedError("bad Example field");
+    }
+  }
+  return Error::success();
+}
+
+Expected<size_t> CountValues(const SerializedFeature& feature) {
+  if (!feature.found) return 0;
+
+  size_t count = 0;
+  Error error = Error::success();
+  switch (feature.type) {
+    case FeatureType::kBytes:
+      error = ForEachListField(
+          feature.list, kLengthDelimited,
+          [&](string_view) -> Error {
+            ++count;
+            return Error::success();
+          },
+          [](WireReader&) { return false; });
+      break;
+    case FeatureType::kFloat:
+      error = ForEachListField(
+          feature.list, kFixed32,
+          [&](string_view payload) -> Error {
+            if (payload.size() % 4 != 0)
+              return MakeMalformedError("bad packed float list");
+            count += payload.size() / 4;
+            return Error::success();
+          },
+          [&](WireReader& reader) {
+            ++count;
+            return reader.SkipField(kFixed32);
+          });
+      break;
+    case FeatureType::kInt64:
+      error = ForEachListField(
+          feature.list, kVarint,
+          [&](string_view payload) -> Error {
+            // Every varint ends with a byte without the continuation bit.
+            for (char byte : payload) count += !(byte & 0x80);
+            return Error::success();
+          },
+          [&](WireReader& reader) {
+            ++count;
+            return reader.SkipField(kVarint);
+          });
+      break;
+  }
+  if (error) return std::move(error);
+  return count;
+}
+
+Error DecodeValues(const SerializedFeature& feature,
+                   MutableArrayRef<int64_t> values) {
+  if (auto error = CheckType(feature, FeatureType::kInt64)) return error;
+  if (!feature.found) return Error::success();
+
+  size_t i = 0;
+  auto read_value = [&](WireReader& reader) {
+    uint64_t value;
+    if (i == values.size() || !reader.ReadVarint(&value)) return false;
+    values[i++] = static_cast<int64_t>(value);
+    return true;
+  };
+  return ForEachListField(
+      feature.list, kVarint,
+      [&](string_view payload) -> Error {
+        WireReader reader(payload);
+        while (!reader.done()) {
+          if (!read_value(reader))
+            return MakeMalformedError("bad packed int64 list");
+        }
+        return Error::success();
+      },
+      read_value);
+}
+
+Error DecodeValues(const SerializedFeature& feature,
+                   MutableArrayRef<float> values) {
+  if (auto error = CheckType(feature, FeatureType::kFloat)) return error;
+  if (!feature.found) return Error::success();
+
+  size_t i = 0;
+  auto read_value = [&](WireReader& reader) {
+    uint32_t bits;
+    if (i == values.size() || !reader.ReadFixed32(&bits)) return false;
+    std::memcpy(&values[i++], &bits, sizeof(float));
+    return true;
+  };
+  return ForEachListField(
+      feature.list, kFixed32,
+      [&](string_view payload) -> Error {
+        WireReader reader(payload);
+        while (!reader.done()) {
+          if (!read_value(reader))
+            return MakeMalformedError("bad packed float list");
+        }
+        return Error::success();
+      },
+      read_value);
+}
+
+Error DecodeValues(const SerializedFeature& feature,
+                   MutableArrayRef<std::string> values) {
+  if (auto error = CheckType(feature, FeatureType::kBytes)) return error;
+  if (!feature.found) return Error::success();
+
+  size_t i = 0;
+  return ForEachListField(
+      feature.list, kLengthDelimited,
+      [&](string_view value) -> Error {
+        if (i == values.size())
+          return MakeMalformedError("bad bytes list");
+        values[i++] = value.str();
+        return Error::success();
+      },
+      [](WireReader&) { return false; });
+}
+
+}  // namespace proto
+}  // namespace tfrt
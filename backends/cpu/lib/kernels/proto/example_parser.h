@@ -0,0 +1,66 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares a parser that extracts features from serialized
+// tf.Example protos without deserializing them.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_PROTO_EXAMPLE_PARSER_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_PROTO_EXAMPLE_PARSER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace proto {
+
+enum class FeatureType { kBytes, kFloat, kInt64 };
+
+// The serialized value list of a feature in an example. `list` is the payload
+// of its BytesList, FloatList or Int64List message, and points into the
+// serialized example.
+struct SerializedFeature {
+  bool found = false;
+  FeatureType type = FeatureType::kBytes;
+  string_view list;
+};
+
+// Scans the wire format of the serialized `example` once, and stores the value
+// list of the feature named `key` in `features[key_indices[key]]`. Features
+// that are not in `key_indices` are skipped without being decoded, and
+// features that are not in the example are not found.
+Error FindFeatures(string_view example, const llvm::StringMap<int>& key_indices,
+                   MutableArrayRef<SerializedFeature> features);
+
+// Returns the number of values in the serialized `feature`.
+Expected<size_t> CountValues(const SerializedFeature& feature);
+
+// Decodes the values of the serialized `feature` into `values`, which must have
+// the size returned by CountValues.
+Error DecodeValues(const SerializedFeature& feature,
+                   MutableArrayRef<int64_t> values);
+Error DecodeValues(const SerializedFeature& feature,
+                   MutableArrayRef<float> values);
+Error DecodeValues(const SerializedFeature& feature,
+                   MutableArrayRef<std::string> values);
+
+}  // namespace proto
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_PROTO_EXAMPLE_PARSER_H_
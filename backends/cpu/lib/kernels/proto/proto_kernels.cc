@@ -14,11 +14,19 @@
 
 // This file implements protobuf-related kernels.
 
+#include <string>
+#include <vector>
+
+#include "example_parser.h"
+#include "llvm/ADT/StringMap.h"
 #include "tfrt/cpu/kernels/proto/example.proto.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/rc_array.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/string_host_tensor.h"
 #include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
@@ -30,7 +38,7 @@ static AsyncValueRef<tfrt::proto::Example> ParseExampleFromBytes(
 
   return EnqueueWork(
       exec_ctx, [data = data.ValueRef(), exec_ctx]() -> ReturnTy {
-        TFRT_TRACE_SCOPE(Default, "ParseExampleFromBytes");
+        TFRT_TRACE_STATIC_SCOPE(Default, "ParseExampleFromBytes");
         tfrt::proto::Example example;
         if (!example.ParseFromString(data.get())) {
           auto diag =
@@ -49,7 +57,8 @@ static AsyncValueRef<std::string> GetBytesFieldFromExample(
   return EnqueueWork(exec_ctx,
                      [example = example.ValueRef(), key = key.ValueRef(),
                       exec_ctx]() -> ReturnTy {
-                       TFRT_TRACE_SCOPE(Default, "GetBytesFieldFromExample");
+                       TFRT_TRACE_STATIC_SCOPE(Default,
+                                               "GetBytesFieldFromExample");
                        const auto& feature_map = example->features().feature();
                        if (!feature_map.contains(key.get())) {
                          auto diag = EmitError(exec_ctx, "key ", key.get(),
@@ -77,6 +86,207 @@ static llvm::Expected<int64_t> GetInt64FieldFromExample(
   return int64_list.value(0);
 }
 
+// A feature requested from a batch of examples.
+struct FeatureSpec {
+  std::string key;
+  FeatureType type;
+  // The number of values of the feature in each example, or -1 for ragged
+  // features with any number of values.
+  int64_t dense_size;
+};
+
+// Decodes the values of the feature `index` of all examples into `values`.
+// `features` has the serialized features of each example in turn.
+template <typename T>
+static Error DecodeRows(ArrayRef<SerializedFeature> features, size_t index,
+                        ArrayRef<int64_t> row_splits,
+                        MutableArrayRef<T> values) {
+  const size_t num_features = features.size() / (row_splits.size() - 1);
+  for (size_t i = 0; i + 1 < row_splits.size(); ++i) {
+    if (auto error = DecodeValues(
+            features[i * num_features + index],
+            values.slice(row_splits[i], row_splits[i + 1] - row_splits[i])))
+      return error;
+  }
+  return Error::success();
+}
+
+template <typename T>
+static Expected<RCReference<AsyncValue>> DecodeDenseHostTensor(
+    ArrayRef<SerializedFeature> features, size_t index,
+    ArrayRef<int64_t> row_splits, const TensorShape& shape,
+    HostContext* host) {
+  auto tensor = DenseHostTensor::CreateUninitialized<T>(shape, host);
+  if (!tensor) return MakeStringError("cannot allocate tensor");
+  MutableArrayRef<T> values(static_cast<T*>(tensor->data()),
+                            row_splits.back());
+  if (auto error = DecodeRows(features, index, row_splits, values))
+    return std::move(error);
+  return MakeAvailableAsyncValueRef<DenseHostTensor>(host, std::move(*tensor))
+      .ReleaseRCRef();
+}
+
+static Expected<RCReference<AsyncValue>> DecodeStringHostTensor(
+    ArrayRef<SerializedFeature> features, size_t index,
+    ArrayRef<int64_t> row_splits, const TensorShape& shape,
+    HostContext* host) {
+  auto tensor = StringHostTensor::CreateUninitialized(shape, host);
+  if (!tensor) return MakeStringError("cannot allocate tensor");
+  if (auto error =
+          DecodeRows(features, index, row_splits, tensor->strings()))
+    return std::move(error);
+  return MakeAvailableAsyncValueRef<StringHostTensor>(host, std::move(*tensor))
+      .ReleaseRCRef();
+}
+
+static Expected<RCReference<AsyncValue>> DecodeFeatureTensor(
+    FeatureType type, ArrayRef<SerializedFeature> features, size_t index,
+    ArrayRef<int64_t> row_splits, const TensorShape& shape,
+    HostContext* host) {
+  switch (type) {
+    case FeatureType::kBytes:
+      return DecodeStringHostTensor(features, index, row_splits, shape, host);
+    case FeatureType::kFloat:
+      return DecodeDenseHostTensor<float>(features, index, row_splits, shape,
+                                          host);
+    case FeatureType::kInt64:
+      return DecodeDenseHostTensor<int64_t>(features, index, row_splits,
+                                            shape, host);
+  }
+  llvm_unreachable("unknown feature type");
+}
+
+// Returns the tensors of the requested features of a batch of serialized
+// examples, see ParseExampleBatch.
+static Expected<std::vector<RCReference<AsyncValue>>> ParseExamples(
+    const RCArray<AsyncValue>& examples, ArrayRef<FeatureSpec> specs,
+    HostContext* host) {
+  const size_t batch_size = examples.size();
+  const size_t num_features = specs.size();
+
+  // Locate the requested features in every example with a single scan.
+  llvm::StringMap<int> key_indices;
+  for (size_t i = 0; i < num_features; ++i) key_indices[specs[i].key] = i;
+  std::vector<SerializedFeature> features(batch_size * num_features);
+  for (size_t i = 0; i < batch_size; ++i) {
+    if (auto error = FindFeatures(
+            examples[i]->get<std::string>(), key_indices,
+            MutableArrayRef<SerializedFeature>(features)
+                .slice(i * num_features, num_features)))
+      return std::move(error);
+  }
+
+  std::vector<RCReference<AsyncValue>> results;
+  std::vector<int64_t> row_splits(batch_size + 1);
+  for (size_t f = 0; f < num_features; ++f) {
+    const FeatureSpec& spec = specs[f];
+    row_splits[0] = 0;
+    for (size_t i = 0; i < batch_size; ++i) {
+      auto count = CountValues(features[i * num_features + f]);
+      if (!count) return count.takeError();
+      if (spec.dense_size >= 0 &&
+          static_cast<int64_t>(*count) != spec.dense_size) {
+        return MakeStringError("feature ", spec.key, " has ", *count,
+                               " values in example ", i, ", expected ",
+                               spec.dense_size);
+      }
+      row_splits[i + 1] = row_splits[i] + *count;
+    }
+
+    TensorShape shape =
+        spec.dense_size >= 0
+            ? TensorShape({static_cast<ssize_t>(batch_size), spec.dense_size})
+            : TensorShape(ArrayRef<int64_t>{row_splits.back()});
+    auto values =
+        DecodeFeatureTensor(spec.type, features, f, row_splits, shape, host);
+    if (!values)
+      return MakeStringError("feature ", spec.key, ": ",
+                             toString(values.takeError()));
+    results.push_back(std::move(*values));
+
+    if (spec.dense_size < 0) {
+      auto splits = DenseHostTensor::CreateUninitialized<int64_t>(
+          TensorShape(ArrayRef<int64_t>{static_cast<int64_t>(batch_size) + 1}),
+          host);
+      if (!splits) return MakeStringError("cannot allocate tensor");
+      std::copy(row_splits.begin(), row_splits.end(),
+                static_cast<int64_t*>(splits->data()));
+      results.push_back(
+          MakeAvailableAsyncValueRef<DenseHostTensor>(host, std::move(*splits))
+              .ReleaseRCRef());
+    }
+  }
+  return std::move(results);
+}
+
+// Parses the features `keys` from a batch of serialized tf.Example protos,
+// without deserializing the examples. Each example is scanned once, only the
+// requested features are decoded, and they are decoded directly into batched
+// tensors.
+//
+// A feature of type `types[i]` ("bytes", "float" or "int64") with a
+// non-negative `dense_sizes[i]` must have that many values in every example,
+// and returns a tensor of shape [batch, dense_sizes[i]]. A feature with a
+// dense size of -1 is ragged, and returns the values of all examples and the
+// int64 row splits of shape [batch + 1], which separate the values of each
+// example, like tf.RaggedTensor. Bytes features return StringHostTensors.
+//
+// The attributes are in the alphabetical order of their names.
+static void ParseExampleBatch(RemainingArguments serialized,
+                              RemainingResults results,
+                              ArrayAttribute<int64_t> dense_sizes,
+                              AggregateAttr keys, AggregateAttr types,
+                              const ExecutionContext& exec_ctx) {
+  auto emit_error = [&](string_view message) {
+    auto error = EmitErrorAsync(exec_ctx, message);
+    for (auto& result : results.values()) result = error.CopyRef();
+  };
+
+  if (keys.GetNumElements() != types.GetNumElements() ||
+      keys.GetNumElements() != dense_sizes.size())
+    return emit_error("keys, types and dense_sizes must have the same size");
+
+  std::vector<FeatureSpec> specs;
+  size_t num_results = 0;
+  for (int i = 0, e = keys.GetNumElements(); i < e; ++i) {
+    FeatureSpec spec;
+    spec.key = keys.GetAttributeOfType<StringAttr>(i).GetValue().str();
+    string_view type = types.GetAttributeOfType<StringAttr>(i).GetValue();
+    if (type == "bytes") {
+      spec.type = FeatureType::kBytes;
+    } else if (type == "float") {
+      spec.type = FeatureType::kFloat;
+    } else if (type == "int64") {
+      spec.type = FeatureType::kInt64;
+    } else {
+      return emit_error(StrCat("unsupported feature type ", type));
+    }
+    spec.dense_size = dense_sizes[i];
+    num_results += spec.dense_size >= 0 ? 1 : 2;
+    specs.push_back(std::move(spec));
+  }
+  if (num_results != results.size())
+    return emit_error(StrCat("expected ", num_results, " results"));
+
+  std::vector<RCReference<IndirectAsyncValue>> outputs;
+  for (size_t i = 0; i < results.size(); ++i)
+    outputs.push_back(results.AllocateIndirectResultAt(i));
+
+  EnqueueWork(exec_ctx, [examples = RCArray<AsyncValue>(serialized.values()),
+                         specs = std::move(specs),
+                         outputs = std::move(outputs), exec_ctx] {
+    TFRT_TRACE_STATIC_SCOPE(Default, "ParseExampleBatch");
+    auto values = ParseExamples(examples, specs, exec_ctx.host());
+    if (!values) {
+      auto error = EmitErrorAsync(exec_ctx, values.takeError());
+      for (auto& output : outputs) output->ForwardTo(error.CopyRef());
+      return;
+    }
+    for (size_t i = 0; i < outputs.size(); ++i)
+      outputs[i]->ForwardTo(std::move((*values)[i]));
+  });
+}
+
 // This is the entrypoint to the library.
 void RegisterProtoKernels(KernelRegistry* registry) {
   registry->AddKernel("tfrt_test.parse_example_from_bytes",
@@ -85,6 +295,8 @@ void RegisterProtoKernels(KernelRegistry* registry) {
                       TFRT_KERNEL(GetBytesFieldFromExample));
   registry->AddKernel("tfrt_test.get_int64_field_from_example",
                       TFRT_KERNEL(GetInt64FieldFromExample));
+  registry->AddKernel("tfrt_test.parse_example_batch",
+                      TFRT_KERNEL(ParseExampleBatch));
 }
 
 }  // namespace proto
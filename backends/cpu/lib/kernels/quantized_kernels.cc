@@ -0,0 +1,510 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the int8 quantized kernels and the portable quantized
+// matmul kernel.
+
+#include "./quantized_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace cpu {
+namespace internal {
+namespace {
+
+void GenericQuantizedMatMul(const uint8_t* lhs, size_t lda,
+                            int32_t lhs_zero_point, const int8_t* packed,
+                            const int32_t* col_sums, int32_t* out, size_t ldo,
+                            size_t m, size_t n, size_t k) {
+  const size_t padded_k = (k + 3) / 4 * 4;
+  for (size_t col = 0; col < n; col += kQuantizedPanelWidth) {
+    const int8_t* panel = packed + col * padded_k;
+    size_t width = std::min(kQuantizedPanelWidth, n - col);
+    for (size_t row = 0; row < m; ++row) {
+      const uint8_t* lhs_row = lhs + row * lda;
+      int32_t acc[kQuantizedPanelWidth] = {};
+      for (size_t i = 0; i < k; ++i) {
+        const int8_t* rhs = panel + i / 4 * 4 * kQuantizedPanelWidth + i % 4;
+        int32_t value = lhs_row[i];
+        for (size_t j = 0; j < kQuantizedPanelWidth; ++j)
+          acc[j] += value * rhs[j * 4];
+      }
+      int32_t* out_row = out + row * ldo + col;
+      for (size_t j = 0; j < width; ++j)
+        out_row[j] = acc[j] - lhs_zero_point * col_sums[col + j];
+    }
+  }
+}
+
+bool CpuSupportsVnni() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx512f") &&
+         __builtin_cpu_supports("avx512vnni");
+#else
+  return false;
+#endif
+}
+
+// The kernel is selected once, on first use.
+QuantizedMatMulFn SelectedQuantizedMatMul() {
+  static const QuantizedMatMulFn selected = [] {
+    if (QuantizedMatMulFn vnni = GetVnniQuantizedMatMul()) return vnni;
+    return GetGenericQuantizedMatMul();
+  }();
+  return selected;
+}
+
+}  // namespace
+
+QuantizedMatMulFn GetGenericQuantizedMatMul() {
+  return &GenericQuantizedMatMul;
+}
+
+QuantizedMatMulFn GetVnniQuantizedMatMul() {
+  if (!CpuSupportsVnni()) return nullptr;
+  return GetCompiledVnniQuantizedMatMul();
+}
+
+void PackQuantizedRhs(const int8_t* rhs, size_t k, size_t n, int8_t* packed,
+                      int32_t* col_sums, size_t panel_begin,
+                      size_t panel_end) {
+  const size_t padded_k = (k + 3) / 4 * 4;
+  for (size_t panel = panel_begin; panel < panel_end; ++panel) {
+    size_t col_begin = panel * kQuantizedPanelWidth;
+    int8_t* dst = packed + col_begin * padded_k;
+    int32_t* sums = col_sums + col_begin;
+    std::fill(dst, dst + kQuantizedPanelWidth * padded_k, 0);
+    std::fill(sums, sums + kQuantizedPanelWidth, 0);
+
+    size_t width = std::min(kQuantizedPanelWidth, n - col_begin);
+    for (size_t i = 0; i < k; ++i) {
+      const int8_t* src = rhs + i * n + col_begin;
+      int8_t* group = dst + i / 4 * 4 * kQuantizedPanelWidth + i % 4;
+      for (size_t j = 0; j < width; ++j) {
+        group[j * 4] = src[j];
+        sums[j] += src[j];
+      }
+    }
+  }
+}
+
+void QuantizedMatMulPanels(const uint8_t* lhs, size_t lda,
+                           int32_t lhs_zero_point, const int8_t* packed,
+                           const int32_t* col_sums, int32_t* out, size_t ldo,
+                           size_t m, size_t n, size_t k, size_t panel_begin,
+                           size_t panel_end) {
+  size_t col_begin = panel_begin * kQuantizedPanelWidth;
+  size_t col_end = std::min(panel_end * kQuantizedPanelWidth, n);
+  if (col_begin >= col_end) return;
+  SelectedQuantizedMatMul()(lhs, lda, lhs_zero_point,
+                            packed + col_begin * ((k + 3) / 4 * 4),
+                            col_sums + col_begin, out + col_begin, ldo, m,
+                            col_end - col_begin, k);
+}
+
+}  // namespace internal
+
+namespace {
+
+// The scale and zero point of the element i of a tensor are at index
+// (i / inner_size) % num_channels.
+struct ChannelParams {
+  const float* scale;
+  const int32_t* zero_point;
+  size_t num_channels;
+  size_t inner_size;
+
+  size_t Channel(size_t i) const { return i / inner_size % num_channels; }
+};
+
+Expected<ChannelParams> GetChannelParams(const TensorShape& shape,
+                                         const DenseHostTensor& scale,
+                                         const DenseHostTensor& zero_point,
+                                         int axis) {
+  if (scale.dtype().kind() != DType::F32)
+    return MakeStringError("scale must be f32, got ", scale.dtype());
+  if (zero_point.dtype().kind() != DType::I32)
+    return MakeStringError("zero point must be i32, got ", zero_point.dtype());
+
+  ChannelParams params;
+  params.scale = static_cast<const float*>(scale.data());
+  params.zero_point = static_cast<const int32_t*>(zero_point.data());
+  params.num_channels = 1;
+  params.inner_size = std::max<ssize_t>(shape.GetNumElements(), 1);
+
+  if (axis != -1) {
+    if (axis < 0 || axis >= shape.GetRank())
+      return MakeStringError("axis ", axis, " is out of range for rank ",
+                             shape.GetRank());
+    params.num_channels = shape.GetDimensionSize(axis);
+    params.inner_size = 1;
+    for (int i = axis + 1; i < shape.GetRank(); ++i)
+      params.inner_size *= shape.GetDimensionSize(i);
+    if (params.inner_size == 0) params.inner_size = 1;
+  }
+
+  if (scale.NumElements() != params.num_channels ||
+      zero_point.NumElements() != params.num_channels)
+    return MakeStringError("expected ", params.num_channels,
+                           " scales and zero points, got ",
+                           scale.NumElements(), " and ",
+                           zero_point.NumElements());
+  return params;
+}
+
+// Returns the block sizes of an elementwise kernel with the given cost per
+// element.
+ParallelFor::BlockSizes ElementwiseBlockSizes(size_t bytes_loaded,
+                                              size_t bytes_stored,
+                                              size_t compute_cycles) {
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = bytes_loaded;
+  cost.bytes_stored = bytes_stored;
+  cost.compute_cycles = compute_cycles;
+  return ParallelFor::BlockSizes::FromCost(cost);
+}
+
+template <typename T>
+AsyncValueRef<Chain> QuantizeImpl(const DenseHostTensor& input,
+                                  const DenseHostTensor& scale,
+                                  const DenseHostTensor& zero_point,
+                                  ChannelParams params, DenseHostTensor* output,
+                                  const ExecutionContext& exec_ctx) {
+  auto* out = static_cast<T*>(output->data());
+  return ParallelFor(exec_ctx).Execute(
+      input.NumElements(), ElementwiseBlockSizes(sizeof(float), sizeof(T), 5),
+      [input = input.CopyRef(), scale = scale.CopyRef(),
+       zero_point = zero_point.CopyRef(), params,
+       out](size_t begin, size_t end) {
+        const auto* in = static_cast<const float*>(input.data());
+        constexpr float kMin = std::numeric_limits<T>::min();
+        constexpr float kMax = std::numeric_limits<T>::max();
+        for (size_t i = begin; i < end; ++i) {
+          size_t c = params.Channel(i);
+          float value =
+              std::round(in[i] / params.scale[c]) + params.zero_point[c];
+          out[i] = static_cast<T>(std::min(std::max(value, kMin), kMax));
+        }
+      });
+}
+
+template <typename T>
+AsyncValueRef<Chain> DequantizeImpl(const DenseHostTensor& input,
+                                    const DenseHostTensor& scale,
+                                    const DenseHostTensor& zero_point,
+                                    ChannelParams params,
+                                    DenseHostTensor* output,
+                                    const ExecutionContext& exec_ctx) {
+  auto* out = static_cast<float*>(output->data());
+  return ParallelFor(exec_ctx).Execute(
+      input.NumElements(), ElementwiseBlockSizes(sizeof(T), sizeof(float), 3),
+      [input = input.CopyRef(), scale = scale.CopyRef(),
+       zero_point = zero_point.CopyRef(), params,
+       out](size_t begin, size_t end) {
+        const auto* in = static_cast<const T*>(input.data());
+        for (size_t i = begin; i < end; ++i) {
+          size_t c = params.Channel(i);
+          int64_t value = static_cast<int64_t>(in[i]) - params.zero_point[c];
+          out[i] = params.scale[c] * static_cast<float>(value);
+        }
+      });
+}
+
+template <typename T>
+AsyncValueRef<Chain> QuantizedReluImpl(const DenseHostTensor& input,
+                                       int32_t zero_point,
+                                       DenseHostTensor* output,
+                                       const ExecutionContext& exec_ctx) {
+  if (zero_point < std::numeric_limits<T>::min() ||
+      zero_point > std::numeric_limits<T>::max())
+    return EmitErrorAsync(exec_ctx, "zero point is out of range");
+
+  auto* out = static_cast<T*>(output->data());
+  return ParallelFor(exec_ctx).Execute(
+      input.NumElements(), ElementwiseBlockSizes(sizeof(T), sizeof(T), 1),
+      [input = input.CopyRef(), zero_point = static_cast<T>(zero_point),
+       out](size_t begin, size_t end) {
+        const auto* in = static_cast<const T*>(input.data());
+        for (size_t i = begin; i < end; ++i)
+          out[i] = std::max(in[i], zero_point);
+      });
+}
+
+// The packed qint8 rhs of internal::QuantizedMatMulPanels().
+struct PackedQuantizedRhs {
+  RCReference<HostBuffer> packed;
+  RCReference<HostBuffer> col_sums;
+};
+
+// Allocates the packed `rhs` [k, n]. Returns null buffers if out of memory.
+PackedQuantizedRhs AllocatePackedQuantizedRhs(size_t k, size_t n,
+                                              HostContext* host) {
+  PackedQuantizedRhs result;
+  result.packed = HostBuffer::CreateUninitialized(
+      internal::PackedQuantizedRhsSize(k, n), alignof(int32_t),
+      host->allocator());
+  result.col_sums = HostBuffer::CreateUninitialized(
+      internal::NumQuantizedPanels(n) * internal::kQuantizedPanelWidth *
+          sizeof(int32_t),
+      alignof(int32_t), host->allocator());
+  if (!result.packed || !result.col_sums) return {};
+  return result;
+}
+
+}  // namespace
+
+AsyncValueRef<Chain> Quantize(const DenseHostTensor& input,
+                              const DenseHostTensor& scale,
+                              const DenseHostTensor& zero_point, int axis,
+                              DenseHostTensor* output,
+                              const ExecutionContext& exec_ctx) {
+  if (input.dtype().kind() != DType::F32)
+    return EmitErrorAsync(exec_ctx, "unsupported dtype for quantize");
+
+  auto params = GetChannelParams(input.shape(), scale, zero_point, axis);
+  if (!params) return EmitErrorAsync(exec_ctx, params.takeError());
+
+  switch (output->dtype().kind()) {
+    case DType::QUI8:
+      return QuantizeImpl<uint8_t>(input, scale, zero_point, *params, output,
+                                   exec_ctx);
+    case DType::QI8:
+      return QuantizeImpl<int8_t>(input, scale, zero_point, *params, output,
+                                  exec_ctx);
+    default:
+      return EmitErrorAsync(exec_ctx, "unsupported quantized dtype");
+  }
+}
+
+AsyncValueRef<Chain> Dequantize(const DenseHostTensor& input,
+                                const DenseHostTensor& scale,
+                                const DenseHostTensor& zero_point, int axis,
+                                DenseHostTensor* output,
+                                const ExecutionContext& exec_ctx) {
+  auto params = GetChannelParams(input.shape(), scale, zero_point, axis);
+  if (!params) return EmitErrorAsync(exec_ctx, params.takeError());
+
+  switch (input.dtype().kind()) {
+    case DType::QUI8:
+      return DequantizeImpl<uint8_t>(input, scale, zero_point, *params, output,
+                                     exec_ctx);
+    case DType::QI8:
+      return DequantizeImpl<int8_t>(input, scale, zero_point, *params, output,
+                                    exec_ctx);
+    case DType::QI32:
+      return DequantizeImpl<int32_t>(input, scale, zero_point, *params,
+                                     output, exec_ctx);
+    default:
+      return EmitErrorAsync(exec_ctx, "unsupported dtype for dequantize");
+  }
+}
+
+AsyncValueRef<Chain> QuantizedMatMul(const DenseHostTensor& a,
+                                     const DenseHostTensor& b,
+                                     int32_t a_zero_point, DenseHostTensor* c,
+                                     const ExecutionContext& exec_ctx) {
+  if (a.dtype().kind() != DType::QUI8 || b.dtype().kind() != DType::QI8)
+    return EmitErrorAsync(exec_ctx, "quantized matmul expects quint8 @ qint8");
+
+  const size_t m = c->shape().GetDimensionSize(0);
+  const size_t n = c->shape().GetDimensionSize(1);
+  const size_t k = a.shape().GetDimensionSize(1);
+
+  auto rhs = AllocatePackedQuantizedRhs(k, n, exec_ctx.host());
+  if (!rhs.packed) return EmitErrorAsync(exec_ctx, "out of memory packing rhs");
+
+  // Each task packs the panels it multiplies.
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = 2 * k * internal::kQuantizedPanelWidth + m * k;
+  cost.bytes_stored =
+      (k + m * sizeof(int32_t)) * internal::kQuantizedPanelWidth;
+  cost.compute_cycles = m * k / 4 + k;
+
+  auto* c_data = static_cast<int32_t*>(c->data());
+  return ParallelFor(exec_ctx).Execute(
+      internal::NumQuantizedPanels(n), ParallelFor::BlockSizes::FromCost(cost),
+      [a = a.CopyRef(), b = b.CopyRef(), rhs = std::move(rhs), a_zero_point,
+       c_data, m, n, k](size_t begin, size_t end) {
+        auto* packed = static_cast<int8_t*>(rhs.packed->data());
+        auto* col_sums = static_cast<int32_t*>(rhs.col_sums->data());
+        internal::PackQuantizedRhs(static_cast<const int8_t*>(b.data()), k, n,
+                                   packed, col_sums, begin, end);
+        internal::QuantizedMatMulPanels(static_cast<const uint8_t*>(a.data()),
+                                        /*lda=*/k, a_zero_point, packed,
+                                        col_sums, c_data, /*ldo=*/n, m, n, k,
+                                        begin, end);
+      });
+}
+
+AsyncValueRef<Chain> QuantizedConv2D(const DenseHostTensor& input,
+                                     const DenseHostTensor& filter,
+                                     const QuantizedConv2DParams& params,
+                                     DenseHostTensor* output,
+                                     const ExecutionContext& exec_ctx) {
+  if (input.dtype().kind() != DType::QUI8 ||
+      filter.dtype().kind() != DType::QI8)
+    return EmitErrorAsync(exec_ctx, "quantized conv2d expects quint8 * qint8");
+  if (params.input_zero_point < 0 || params.input_zero_point > 255)
+    return EmitErrorAsync(exec_ctx, "input zero point is out of range");
+
+  const TensorShape& in_shape = input.shape();
+  const TensorShape& filter_shape = filter.shape();
+  const TensorShape& out_shape = output->shape();
+  if (in_shape.GetRank() != 4 || filter_shape.GetRank() != 4 ||
+      out_shape.GetRank() != 4)
+    return EmitErrorAsync(exec_ctx, "quantized conv2d expects rank 4 tensors");
+  if (in_shape.GetDimensionSize(3) != filter_shape.GetDimensionSize(2))
+    return EmitErrorAsync(exec_ctx, "input and filter channels do not match");
+  const ssize_t height = in_shape.GetDimensionSize(1);
+  const ssize_t width = in_shape.GetDimensionSize(2);
+  const ssize_t channels = in_shape.GetDimensionSize(3);
+  const ssize_t filter_height = filter_shape.GetDimensionSize(0);
+  const ssize_t filter_width = filter_shape.GetDimensionSize(1);
+  const ssize_t out_height = out_shape.GetDimensionSize(1);
+  const ssize_t out_width = out_shape.GetDimensionSize(2);
+
+  // The HWIO filter is the rhs [k, n] of the matmul with the lhs rows of input
+  // patches, one per output pixel.
+  const size_t m = out_shape.GetDimensionSize(0) * out_height * out_width;
+  const size_t n = filter_shape.GetDimensionSize(3);
+  const size_t k = filter_height * filter_width * channels;
+
+  auto rhs = AllocatePackedQuantizedRhs(k, n, exec_ctx.host());
+  if (!rhs.packed)
+    return EmitErrorAsync(exec_ctx, "out of memory packing filter");
+  internal::PackQuantizedRhs(
+      static_cast<const int8_t*>(filter.data()), k, n,
+      static_cast<int8_t*>(rhs.packed->data()),
+      static_cast<int32_t*>(rhs.col_sums->data()), 0,
+      internal::NumQuantizedPanels(n));
+
+  // A 1x1 convolution with unit strides and no padding multiplies the input
+  // pixels in place.
+  const bool is_pointwise = filter_height == 1 && filter_width == 1 &&
+                            params.strides[0] == 1 && params.strides[1] == 1 &&
+                            params.paddings_before[0] == 0 &&
+                            params.paddings_before[1] == 0 &&
+                            out_height == height && out_width == width;
+
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = k + n * sizeof(int32_t);
+  cost.bytes_stored = (is_pointwise ? 0 : k) + n * sizeof(int32_t);
+  cost.compute_cycles = k * n / 64 + (is_pointwise ? 0 : k);
+
+  auto* out = static_cast<int32_t*>(output->data());
+  return ParallelFor(exec_ctx).Execute(
+      m, ParallelFor::BlockSizes::FromCost(cost),
+      [input = input.CopyRef(), rhs = std::move(rhs), params, out,
+       is_pointwise, height, width, channels, filter_height, filter_width,
+       out_height, out_width, n, k](size_t begin, size_t end) {
+        const auto* in = static_cast<const uint8_t*>(input.data());
+        const auto* packed = static_cast<const int8_t*>(rhs.packed->data());
+        const auto* col_sums =
+            static_cast<const int32_t*>(rhs.col_sums->data());
+        const size_t num_panels = internal::NumQuantizedPanels(n);
+
+        if (is_pointwise) {
+          internal::QuantizedMatMulPanels(
+              in + begin * k, /*lda=*/k, params.input_zero_point, packed,
+              col_sums, out + begin * n, /*ldo=*/n, end - begin, n, k, 0,
+              num_panels);
+          return;
+        }
+
+        // Gathers the input patches of a few output pixels at a time.
+        constexpr size_t kRowsPerBlock = 64;
+        std::vector<uint8_t> patches(std::min(kRowsPerBlock, end - begin) * k);
+        for (size_t block = begin; block < end; block += kRowsPerBlock) {
+          size_t block_end = std::min(block + kRowsPerBlock, end);
+          for (size_t row = block; row < block_end; ++row) {
+            ssize_t batch = row / (out_height * out_width);
+            ssize_t y = row / out_width % out_height;
+            ssize_t x = row % out_width;
+            uint8_t* patch = patches.data() + (row - block) * k;
+            for (ssize_t fy = 0; fy < filter_height; ++fy) {
+              ssize_t in_y = y * params.strides[0] - params.paddings_before[0] +
+                             fy * params.dilations[0];
+              for (ssize_t fx = 0; fx < filter_width; ++fx) {
+                ssize_t in_x = x * params.strides[1] -
+                               params.paddings_before[1] +
+                               fx * params.dilations[1];
+                uint8_t* dst = patch + (fy * filter_width + fx) * channels;
+                if (in_y < 0 || in_y >= height || in_x < 0 || in_x >= width) {
+                  std::fill(dst, dst + channels,
+                            static_cast<uint8_t>(params.input_zero_point));
+                  continue;
+                }
+                const uint8_t* src =
+                    in + ((batch * height + in_y) * width + in_x) * channels;
+                std::memcpy(dst, src, channels);
+              }
+            }
+          }
+          internal::QuantizedMatMulPanels(
+              patches.data(), /*lda=*/k, params.input_zero_point, packed,
+              col_sums, out + block * n, /*ldo=*/n, block_end - block, n, k, 0,
+              num_panels);
+        }
+      });
+}
+
+AsyncValueRef<Chain> QuantizedBiasAdd(const DenseHostTensor& input,
+                                      const DenseHostTensor& bias,
+                                      DenseHostTensor* output,
+                                      const ExecutionContext& exec_ctx) {
+  if (input.dtype().kind() != DType::QI32 || bias.dtype().kind() != DType::QI32)
+    return EmitErrorAsync(exec_ctx, "quantized bias add expects qint32");
+
+  const size_t channels = bias.NumElements();
+  auto* out = static_cast<int32_t*>(output->data());
+  return ParallelFor(exec_ctx).Execute(
+      input.NumElements(),
+      ElementwiseBlockSizes(2 * sizeof(int32_t), sizeof(int32_t), 1),
+      [input = input.CopyRef(), bias = bias.CopyRef(), channels,
+       out](size_t begin, size_t end) {
+        const auto* in = static_cast<const int32_t*>(input.data());
+        const auto* bias_data = static_cast<const int32_t*>(bias.data());
+        for (size_t i = begin; i < end; ++i)
+          out[i] = in[i] + bias_data[i % channels];
+      });
+}
+
+AsyncValueRef<Chain> QuantizedRelu(const DenseHostTensor& input,
+                                   int32_t zero_point, DenseHostTensor* output,
+                                   const ExecutionContext& exec_ctx) {
+  switch (input.dtype().kind()) {
+    case DType::QUI8:
+      return QuantizedReluImpl<uint8_t>(input, zero_point, output, exec_ctx);
+    case DType::QI8:
+      return QuantizedReluImpl<int8_t>(input, zero_point, output, exec_ctx);
+    case DType::QI32:
+      return QuantizedReluImpl<int32_t>(input, zero_point, output, exec_ctx);
+    default:
+      return EmitErrorAsync(exec_ctx, "unsupported dtype for quantized relu");
+  }
+}
+
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Int8 quantized inference kernels.
+//
+// A quantized value q represents the real value scale * (q - zero_point). The
+// scale and zero point are either shared by the whole tensor, or given per
+// channel along one axis. Activations are quint8 with any zero point, weights
+// are qint8 quantized symmetrically (zero point 0) per output channel.
+//
+// MatMul and Conv2D multiply quint8 activations with qint8 weights and return
+// the exact qint32 accumulators sum((a - a_zero_point) * b). The accumulator of
+// output channel c has the scale a_scale * b_scale[c] and zero point 0, which
+// is also the quantization of the qint32 bias for BiasAdd. Dequantize with
+// these scales returns the float result, or Quantize it again for the next
+// layer.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_QUANTIZED_KERNELS_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_QUANTIZED_KERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Quantizes the float `input` to the quint8 or qint8 `output`. `scale` (f32)
+// and `zero_point` (i32) have one element, or one element per channel along
+// `axis` of `input` if `axis` is not -1.
+AsyncValueRef<Chain> Quantize(const DenseHostTensor& input,
+                              const DenseHostTensor& scale,
+                              const DenseHostTensor& zero_point, int axis,
+                              DenseHostTensor* output,
+                              const ExecutionContext& exec_ctx);
+
+// Dequantizes the quint8, qint8 or qint32 `input` to the float `output`, with
+// `scale` and `zero_point` as in Quantize().
+AsyncValueRef<Chain> Dequantize(const DenseHostTensor& input,
+                                const DenseHostTensor& scale,
+                                const DenseHostTensor& zero_point, int axis,
+                                DenseHostTensor* output,
+                                const ExecutionContext& exec_ctx);
+
+// Computes the qint32 C[m, n] = (A[m, k] - a_zero_point) @ B[k, n] for the
+// quint8 A and qint8 B.
+AsyncValueRef<Chain> QuantizedMatMul(const DenseHostTensor& a,
+                                     const DenseHostTensor& b,
+                                     int32_t a_zero_point, DenseHostTensor* c,
+                                     const ExecutionContext& exec_ctx);
+
+// Parameters of a quantized 2D convolution of an NHWC input with an HWIO
+// filter. The paddings are filled with the input zero point.
+struct QuantizedConv2DParams {
+  int32_t input_zero_point;
+  ssize_t strides[2];
+  ssize_t dilations[2];
+  ssize_t paddings_before[2];
+};
+
+// Computes the qint32 NHWC `output` of the convolution of the quint8 NHWC
+// `input` with the qint8 HWIO `filter`.
+AsyncValueRef<Chain> QuantizedConv2D(const DenseHostTensor& input,
+                                     const DenseHostTensor& filter,
+                                     const QuantizedConv2DParams& params,
+                                     DenseHostTensor* output,
+                                     const ExecutionContext& exec_ctx);
+
+// Adds the qint32 `bias` to the last dimension of the qint32 `input`.
+AsyncValueRef<Chain> QuantizedBiasAdd(const DenseHostTensor& input,
+                                      const DenseHostTensor& bias,
+                                      DenseHostTensor* output,
+                                      const ExecutionContext& exec_ctx);
+
+// Computes max(input, zero_point) for a quint8, qint8 or qint32 `input`, i.e.
+// the relu of the values it represents.
+AsyncValueRef<Chain> QuantizedRelu(const DenseHostTensor& input,
+                                   int32_t zero_point, DenseHostTensor* output,
+                                   const ExecutionContext& exec_ctx);
+
+namespace internal {
+
+// The matmul of quint8 lhs rows with qint8 rhs, packed into panels of
+// kQuantizedPanelWidth columns. Each panel holds groups of four rows of `rhs`,
+// where the four values of a column are adjacent, so that the product of a
+// panel with four lhs values is one dot product instruction. The rows past `k`
+// and the columns past `n` are zero padded.
+
+// The number of columns in a packed panel.
+constexpr size_t kQuantizedPanelWidth = 16;
+
+// Returns the number of panels of a packed `rhs` with `n` columns.
+inline size_t NumQuantizedPanels(size_t n) {
+  return (n + kQuantizedPanelWidth - 1) / kQuantizedPanelWidth;
+}
+
+// Returns the number of bytes of a packed `rhs` [k, n].
+inline size_t PackedQuantizedRhsSize(size_t k, size_t n) {
+  return NumQuantizedPanels(n) * kQuantizedPanelWidth * ((k + 3) / 4 * 4);
+}
+
+// Packs the panels [panel_begin, panel_end) of `rhs` [k, n] and stores the
+// sums of their columns to `col_sums`, which has a value for every column of
+// the packed `rhs`.
+void PackQuantizedRhs(const int8_t* rhs, size_t k, size_t n, int8_t* packed,
+                      int32_t* col_sums, size_t panel_begin, size_t panel_end);
+
+// Computes out[m, n] = (lhs[m, k] - lhs_zero_point) @ rhs[k, n] from the packed
+// `rhs` and its column sums. Row r of `lhs` starts at lhs + r * lda, row r of
+// `out` starts at out + r * ldo.
+using QuantizedMatMulFn = void (*)(const uint8_t* lhs, size_t lda,
+                                   int32_t lhs_zero_point, const int8_t* packed,
+                                   const int32_t* col_sums, int32_t* out,
+                                   size_t ldo, size_t m, size_t n, size_t k);
+
+// Returns the portable kernel, and the AVX-512 VNNI kernel or nullptr if it is
+// not compiled into the binary or not supported by the CPU.
+QuantizedMatMulFn GetGenericQuantizedMatMul();
+QuantizedMatMulFn GetVnniQuantizedMatMul();
+
+// Returns the AVX-512 VNNI kernel, or nullptr if it is not compiled into the
+// binary. Use GetVnniQuantizedMatMul() instead, the kernel must only be used if
+// the CPU supports AVX-512 VNNI.
+QuantizedMatMulFn GetCompiledVnniQuantizedMatMul();
+
+// Computes the panels [panel_begin, panel_end) of `out` with the fastest
+// kernel supported by the CPU.
+void QuantizedMatMulPanels(const uint8_t* lhs, size_t lda,
+                           int32_t lhs_zero_point, const int8_t* packed,
+                           const int32_t* col_sums, int32_t* out, size_t ldo,
+                           size_t m, size_t n, size_t k, size_t panel_begin,
+                           size_t panel_end);
+
+}  // namespace internal
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_QUANTIZED_KERNELS_H_
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the AVX-512 VNNI quantized matmul kernel. The kernel is
+// compiled for AVX-512 VNNI with a target pragma, independent of the compiler
+// flags, and is only called if the CPU supports AVX-512 VNNI.
+
+#include <cstring>
+
+#include "./quantized_kernels.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TFRT_QUANTIZED_VNNI 1
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f,avx512vnni"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512vnni")
+#endif
+#endif
+
+namespace tfrt {
+namespace cpu {
+namespace internal {
+
+#if defined(TFRT_QUANTIZED_VNNI)
+namespace {
+
+static_assert(kQuantizedPanelWidth == 16, "a panel must fill one register");
+
+// Loads four lhs values as one 32 bit integer, zero padded past `k`.
+inline int32_t LoadLhsGroup(const uint8_t* lhs, size_t i, size_t k) {
+  int32_t group = 0;
+  std::memcpy(&group, lhs + i, k - i < 4 ? k - i : 4);
+  return group;
+}
+
+// Multiplies kRows rows of `lhs` with a panel. For every four rows of the
+// panel, the panel is loaded once and accumulated with the dot products of the
+// broadcast four values of each lhs row.
+template <size_t kRows>
+void VnniRowBlock(const uint8_t* lhs, size_t lda, int32_t lhs_zero_point,
+                  const int8_t* panel, const int32_t* col_sums, int32_t* out,
+                  size_t ldo, size_t width, size_t k) {
+  __m512i acc[kRows];
+  for (size_t r = 0; r < kRows; ++r) acc[r] = _mm512_setzero_si512();
+
+  for (size_t i = 0; i < k; i += 4) {
+    __m512i rhs = _mm512_loadu_si512(panel + i * kQuantizedPanelWidth);
+    for (size_t r = 0; r < kRows; ++r) {
+      __m512i value = _mm512_set1_epi32(LoadLhsGroup(lhs + r * lda, i, k));
+      acc[r] = _mm512_dpbusd_epi32(acc[r], value, rhs);
+    }
+  }
+
+  __m512i correction = _mm512_mullo_epi32(_mm512_set1_epi32(lhs_zero_point),
+                                          _mm512_loadu_si512(col_sums));
+  __mmask16 mask = static_cast<__mmask16>((1u << width) - 1);
+  for (size_t r = 0; r < kRows; ++r)
+    _mm512_mask_storeu_epi32(out + r * ldo, mask,
+                             _mm512_sub_epi32(acc[r], correction));
+}
+
+void VnniQuantizedMatMul(const uint8_t* lhs, size_t lda,
+                         int32_t lhs_zero_point, const int8_t* packed,
+                         const int32_t* col_sums, int32_t* out, size_t ldo,
+                         size_t m, size_t n, size_t k) {
+  constexpr size_t kRowBlock = 4;
+  const size_t padded_k = (k + 3) / 4 * 4;
+  for (size_t col = 0; col < n; col += kQuantizedPanelWidth) {
+    const int8_t* panel = packed + col * padded_k;
+    size_t width = n - col < kQuantizedPanelWidth ? n - col
+                                                  : kQuantizedPanelWidth;
+    size_t row = 0;
+    for (; row + kRowBlock <= m; row += kRowBlock)
+      VnniRowBlock<kRowBlock>(lhs + row * lda, lda, lhs_zero_point, panel,
+                              col_sums + col, out + row * ldo + col, ldo, width,
+                              k);
+
+    const uint8_t* lhs_tail = lhs + row * lda;
+    int32_t* out_tail = out + row * ldo + col;
+    switch (m - row) {
+      case 3:
+        VnniRowBlock<3>(lhs_tail, lda, lhs_zero_point, panel, col_sums + col,
+                        out_tail, ldo, width, k);
+        break;
+      case 2:
+        VnniRowBlock<2>(lhs_tail, lda, lhs_zero_point, panel, col_sums + col,
+                        out_tail, ldo, width, k);
+        break;
+      case 1:
+        VnniRowBlock<1>(lhs_tail, lda, lhs_zero_point, panel, col_sums + col,
+                        out_tail, ldo, width, k);
+        break;
+    }
+  }
+}
+
+}  // namespace
+
+QuantizedMatMulFn GetCompiledVnniQuantizedMatMul() {
+  return &VnniQuantizedMatMul;
+}
+#else
+QuantizedMatMulFn GetCompiledVnniQuantizedMatMul() { return nullptr; }
+#endif
+
+}  // namespace internal
+}  // namespace cpu
+}  // namespace tfrt
+
+#if defined(TFRT_QUANTIZED_VNNI)
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
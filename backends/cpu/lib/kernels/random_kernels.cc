@@ -0,0 +1,218 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the random tensor kernels.
+//
+// Element i of a uniform tensor is computed from the values
+// [i * k, (i + 1) * k) of the stream, where k is the number of 32-bit values
+// per element. Normal values are computed in pairs with the Box-Muller
+// transform, pair j from the values [j * 2k, (j + 1) * 2k). Each block of a parallel fill skips to the
+// values of its first element, and generates the values of its elements in
+// tiles with PhiloxRandom::Fill().
+//
+// Truncated normal values are resampled a varying number of times, so each
+// pair is sampled from its own range of kTruncatedReservedPairs Box-Muller
+// pairs of the stream, which is practically never exhausted.
+
+#include "./random_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/philox_random.h"
+
+namespace tfrt {
+namespace cpu {
+namespace {
+
+// The number of 32-bit random values per element of type T.
+template <typename T>
+constexpr size_t kValuesPerElement = sizeof(T) / sizeof(uint32_t);
+
+// The number of elements (or pairs of elements) generated per tile.
+constexpr size_t kTileSize = 256;
+
+// The number of Box-Muller pairs of the stream reserved per truncated pair.
+// The probability that a sample is outside of (-2, 2) is 0.0455, so running
+// out of reserved values is much less likely than a hardware error.
+constexpr uint64_t kTruncatedReservedPairs = 16;
+
+// Returns a value uniformly distributed in [0, 1) from the mantissa bits of
+// kValuesPerElement<T> random values.
+template <typename T>
+T Uniform(const uint32_t* bits);
+
+template <>
+float Uniform<float>(const uint32_t* bits) {
+  // Sets the exponent to 0 to get a value in [1, 2).
+  uint32_t value = 0x3f800000u | (bits[0] & 0x7fffffu);
+  float result;
+  std::memcpy(&result, &value, sizeof(result));
+  return result - 1.0f;
+}
+
+template <>
+double Uniform<double>(const uint32_t* bits) {
+  uint64_t value = static_cast<uint64_t>(bits[0]) << 32 | bits[1];
+  value = 0x3ff0000000000000ull | (value & 0xfffffffffffffull);
+  double result;
+  std::memcpy(&result, &value, sizeof(result));
+  return result - 1.0;
+}
+
+// Computes a pair of independent standard normal values from the random values
+// of two uniform values with the Box-Muller transform.
+template <typename T>
+void BoxMuller(const uint32_t* bits, T* normal) {
+  // 1 - u is exact and in (0, 1], which avoids log(0).
+  T u1 = T(1) - Uniform<T>(bits);
+  T u2 = Uniform<T>(bits + kValuesPerElement<T>);
+  T radius = std::sqrt(T(-2) * std::log(u1));
+  T theta = T(2 * M_PI) * u2;
+  normal[0] = radius * std::sin(theta);
+  normal[1] = radius * std::cos(theta);
+}
+
+template <typename T>
+void FillUniform(uint64_t seed, uint64_t seed2, T* out, size_t begin,
+                 size_t end) {
+  constexpr size_t kValues = kValuesPerElement<T>;
+  random::PhiloxRandom generator(seed, seed2);
+  generator.Skip(begin * kValues);
+  uint32_t bits[kTileSize * kValues];
+  for (size_t i = begin; i < end; i += kTileSize) {
+    size_t size = std::min(kTileSize, end - i);
+    generator.Fill(bits, size * kValues);
+    for (size_t j = 0; j < size; ++j)
+      out[i + j] = Uniform<T>(bits + j * kValues);
+  }
+}
+
+template <typename T>
+void FillNormal(uint64_t seed, uint64_t seed2, T* out, size_t begin,
+                size_t end) {
+  constexpr size_t kValues = 2 * kValuesPerElement<T>;
+  random::PhiloxRandom generator(seed, seed2);
+  generator.Skip(begin / 2 * kValues);
+  uint32_t bits[kTileSize * kValues];
+  // Pair j fills the elements 2j and 2j + 1, the first and last pair of the
+  // block may only fill one of them.
+  for (size_t pair = begin / 2, end_pair = (end + 1) / 2; pair < end_pair;
+       pair += kTileSize) {
+    size_t size = std::min(kTileSize, end_pair - pair);
+    generator.Fill(bits, size * kValues);
+    for (size_t j = 0; j < size; ++j) {
+      T normal[2];
+      BoxMuller(bits + j * kValues, normal);
+      size_t index = 2 * (pair + j);
+      if (index >= begin) out[index] = normal[0];
+      if (index + 1 < end) out[index + 1] = normal[1];
+    }
+  }
+}
+
+template <typename T>
+void FillTruncatedNormal(uint64_t seed, uint64_t seed2, T* out, size_t begin,
+                         size_t end) {
+  constexpr size_t kValues = 2 * kValuesPerElement<T>;
+  for (size_t pair = begin / 2, end_pair = (end + 1) / 2; pair < end_pair;
+       ++pair) {
+    random::PhiloxRandom generator(seed, seed2);
+    generator.Skip(pair * kTruncatedReservedPairs * kValues);
+    T truncated[2];
+    for (int count = 0; count < 2;) {
+      uint32_t bits[kValues];
+      generator.Fill(bits, kValues);
+      T normal[2];
+      BoxMuller(bits, normal);
+      for (int k = 0; k < 2 && count < 2; ++k)
+        if (std::abs(normal[k]) < T(2)) truncated[count++] = normal[k];
+    }
+    size_t index = 2 * pair;
+    if (index >= begin) out[index] = truncated[0];
+    if (index + 1 < end) out[index + 1] = truncated[1];
+  }
+}
+
+using FillFn = void (*)(uint64_t seed, uint64_t seed2, void* out, size_t begin,
+                        size_t end);
+
+template <typename T, void (*Fill)(uint64_t, uint64_t, T*, size_t, size_t)>
+void FillUntyped(uint64_t seed, uint64_t seed2, void* out, size_t begin,
+                 size_t end) {
+  Fill(seed, seed2, static_cast<T*>(out), begin, end);
+}
+
+// Fills `output` in parallel with `fill_f32` or `fill_f64`, which compute one
+// element in about `compute_cycles`.
+AsyncValueRef<Chain> RandomFill(uint64_t seed, uint64_t seed2,
+                                DenseHostTensor* output, FillFn fill_f32,
+                                FillFn fill_f64, double compute_cycles,
+                                const ExecutionContext& exec_ctx) {
+  FillFn fill;
+  switch (output->dtype().kind()) {
+    case DType::F32:
+      fill = fill_f32;
+      break;
+    case DType::F64:
+      fill = fill_f64;
+      break;
+    default:
+      return EmitErrorAsync(exec_ctx, "unsupported dtype for random tensor");
+  }
+
+  ParallelFor::Cost cost;
+  cost.bytes_stored = output->dtype().GetHostSize();
+  cost.compute_cycles = compute_cycles;
+  return ParallelFor(exec_ctx).Execute(
+      output->NumElements(), ParallelFor::BlockSizes::FromCost(cost),
+      [seed, seed2, fill, out = output->data()](size_t begin, size_t end) {
+        fill(seed, seed2, out, begin, end);
+      });
+}
+
+}  // namespace
+
+AsyncValueRef<Chain> RandomUniform(uint64_t seed, uint64_t seed2,
+                                   DenseHostTensor* output,
+                                   const ExecutionContext& exec_ctx) {
+  return RandomFill(seed, seed2, output,
+                    FillUntyped<float, FillUniform<float>>,
+                    FillUntyped<double, FillUniform<double>>,
+                    /*compute_cycles=*/2, exec_ctx);
+}
+
+AsyncValueRef<Chain> RandomNormal(uint64_t seed, uint64_t seed2,
+                                  DenseHostTensor* output,
+                                  const ExecutionContext& exec_ctx) {
+  return RandomFill(seed, seed2, output, FillUntyped<float, FillNormal<float>>,
+                    FillUntyped<double, FillNormal<double>>,
+                    /*compute_cycles=*/30, exec_ctx);
+}
+
+AsyncValueRef<Chain> TruncatedNormal(uint64_t seed, uint64_t seed2,
+                                     DenseHostTensor* output,
+                                     const ExecutionContext& exec_ctx) {
+  return RandomFill(seed, seed2, output,
+                    FillUntyped<float, FillTruncatedNormal<float>>,
+                    FillUntyped<double, FillTruncatedNormal<double>>,
+                    /*compute_cycles=*/60, exec_ctx);
+}
+
+}  // namespace cpu
+}  // namespace tfrt
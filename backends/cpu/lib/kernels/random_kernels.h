@@ -0,0 +1,56 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Random tensor kernels.
+//
+// The kernels fill f32 or f64 tensors from the Philox stream of a pair of
+// seeds, in parallel. Every element is computed from a fixed range of values
+// of the stream, so the result only depends on the seeds and the shape, and
+// not on the number of threads or how the tensor is split into blocks.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_RANDOM_KERNELS_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_RANDOM_KERNELS_H_
+
+#include <cstdint>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Fills `output` with values uniformly distributed in [0, 1).
+AsyncValueRef<Chain> RandomUniform(uint64_t seed, uint64_t seed2,
+                                   DenseHostTensor* output,
+                                   const ExecutionContext& exec_ctx);
+
+// Fills `output` with values of the standard normal distribution.
+AsyncValueRef<Chain> RandomNormal(uint64_t seed, uint64_t seed2,
+                                  DenseHostTensor* output,
+                                  const ExecutionContext& exec_ctx);
+
+// Fills `output` with values of the standard normal distribution, truncated to
+// (-2, 2). Values outside of the range are dropped and resampled.
+AsyncValueRef<Chain> TruncatedNormal(uint64_t seed, uint64_t seed2,
+                                     DenseHostTensor* output,
+                                     const ExecutionContext& exec_ctx);
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_RANDOM_KERNELS_H_
@@ -0,0 +1,276 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Sum, Mean and Max reductions of host tensors over arbitrary axes.
+//
+// Adjacent input dimensions that are all reduced or all kept are merged, and
+// the reduction is computed as a sequence of steps from the innermost reduced
+// dimension outwards. Each step reduces the middle dimension of an
+// [outer, reduced, inner] view of the result of the previous step: contiguous
+// rows if `inner` is 1, or otherwise by accumulating rows of `inner` elements.
+// float reductions use the vectorized kernels of cwise_simd.h. The work of a
+// step is split across the thread pool with ParallelFor.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_REDUCTION_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_REDUCTION_KERNEL_H_
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "./cwise_simd.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/common/compat/eigen/thread_pool_device.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "unsupported/Eigen/CXX11/Tensor"
+
+namespace tfrt {
+namespace cpu {
+
+enum class ReductionOp { kSum, kMean, kMax };
+
+namespace internal {
+
+// Reduces the middle dimension of [outer, reduced, inner].
+struct ReductionStep {
+  size_t outer;
+  size_t reduced;
+  size_t inner;
+};
+
+// Returns the steps of the reduction of a tensor with `dims` along the
+// dimensions i with reduced_dims[i] set.
+inline llvm::SmallVector<ReductionStep, 4> GetReductionSteps(
+    ArrayRef<ssize_t> dims, ArrayRef<bool> reduced_dims) {
+  // Merge adjacent dimensions that are all reduced or all kept.
+  llvm::SmallVector<std::pair<size_t, bool>, 4> groups;
+  for (size_t i = 0; i < dims.size(); ++i) {
+    if (dims[i] == 1) continue;  // Reducing or keeping it is a no-op.
+    if (!groups.empty() && groups.back().second == reduced_dims[i]) {
+      groups.back().first *= dims[i];
+    } else {
+      groups.emplace_back(dims[i], reduced_dims[i]);
+    }
+  }
+
+  llvm::SmallVector<ReductionStep, 4> steps;
+  size_t inner = 1;  // The kept elements of the groups after the current one.
+  for (size_t g = groups.size(); g-- > 0;) {
+    if (!groups[g].second) {
+      inner *= groups[g].first;
+      continue;
+    }
+    size_t outer = 1;
+    for (size_t i = 0; i < g; ++i) outer *= groups[i].first;
+    steps.push_back({outer, groups[g].first, inner});
+  }
+  return steps;
+}
+
+// Scalar reductions for the types without vectorized kernels.
+template <typename T>
+struct ReductionKernels {
+  static T Identity(ReductionOp op) {
+    return op == ReductionOp::kMax ? Eigen::NumTraits<T>::lowest()
+                                   : static_cast<T>(0);
+  }
+
+  static T Row(ReductionOp op, const T* in, size_t n) {
+    T result = Identity(op);
+    if (op == ReductionOp::kMax) {
+      for (size_t i = 0; i < n; ++i) result = in[i] > result ? in[i] : result;
+    } else {
+      for (size_t i = 0; i < n; ++i) result = result + in[i];
+    }
+    return result;
+  }
+
+  // Computes acc[i] = acc[i] op in[i].
+  static void Accumulate(ReductionOp op, const T* in, T* acc, size_t n) {
+    if (op == ReductionOp::kMax) {
+      for (size_t i = 0; i < n; ++i) acc[i] = in[i] > acc[i] ? in[i] : acc[i];
+    } else {
+      for (size_t i = 0; i < n; ++i) acc[i] = acc[i] + in[i];
+    }
+  }
+};
+
+template <>
+struct ReductionKernels<float> {
+  static float Identity(ReductionOp op) {
+    return op == ReductionOp::kMax ? -std::numeric_limits<float>::infinity()
+                                   : 0.0f;
+  }
+
+  static float Row(ReductionOp op, const float* in, size_t n) {
+    return simd::Reduce(
+        op == ReductionOp::kMax ? simd::ReduceOp::kMax : simd::ReduceOp::kSum,
+        in, n);
+  }
+
+  static void Accumulate(ReductionOp op, const float* in, float* acc,
+                         size_t n) {
+    simd::Binary(
+        op == ReductionOp::kMax ? simd::BinaryOp::kMax : simd::BinaryOp::kAdd,
+        acc, in, acc, n);
+  }
+};
+
+// The number of inner elements accumulated by one task of a step.
+constexpr size_t kReductionInnerBlock = 4096;
+
+// Computes the tasks [begin, end) of `step`. With `count` > 0 the results are
+// divided by `count`.
+template <typename T>
+void ReductionStepTasks(ReductionOp op, const ReductionStep& step, const T* in,
+                        T* out, size_t count, size_t begin, size_t end) {
+  using Kernels = ReductionKernels<T>;
+  const T divisor = static_cast<T>(count);
+
+  if (step.inner == 1) {
+    for (size_t row = begin; row < end; ++row) {
+      out[row] = Kernels::Row(op, in + row * step.reduced, step.reduced);
+      if (count > 0) out[row] = out[row] / divisor;
+    }
+    return;
+  }
+
+  const size_t num_blocks =
+      (step.inner + kReductionInnerBlock - 1) / kReductionInnerBlock;
+  for (size_t task = begin; task < end; ++task) {
+    const size_t outer = task / num_blocks;
+    const size_t offset = task % num_blocks * kReductionInnerBlock;
+    const size_t size = std::min(kReductionInnerBlock, step.inner - offset);
+
+    const T* src = in + outer * step.reduced * step.inner + offset;
+    T* acc = out + outer * step.inner + offset;
+    std::fill(acc, acc + size, Kernels::Identity(op));
+    for (size_t r = 0; r < step.reduced; ++r)
+      Kernels::Accumulate(op, src + r * step.inner, acc, size);
+    if (count > 0)
+      for (size_t i = 0; i < size; ++i) acc[i] = acc[i] / divisor;
+  }
+}
+
+// Runs `steps` one after another, and sets `done` when the last one is
+// completed. `in_holder` owns `in` if it is an intermediate result.
+template <typename T>
+void RunReductionSteps(ReductionOp op,
+                       llvm::SmallVector<ReductionStep, 4> steps, size_t index,
+                       const T* in, std::shared_ptr<std::vector<T>> in_holder,
+                       T* out, size_t count, ExecutionContext exec_ctx,
+                       std::shared_ptr<void> buffers,
+                       AsyncValueRef<Chain> done) {
+  const ReductionStep step = steps[index];
+  const bool last = index + 1 == steps.size();
+
+  std::shared_ptr<std::vector<T>> out_holder;
+  T* step_out = out;
+  if (!last) {
+    out_holder = std::make_shared<std::vector<T>>(step.outer * step.inner);
+    step_out = out_holder->data();
+  }
+
+  size_t num_tasks = step.outer;
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = step.reduced * sizeof(T);
+  cost.bytes_stored = sizeof(T);
+  cost.compute_cycles = step.reduced;
+  if (step.inner > 1) {
+    const size_t block = std::min(kReductionInnerBlock, step.inner);
+    num_tasks *= (step.inner + block - 1) / block;
+    cost.bytes_loaded *= block;
+    cost.bytes_stored *= block;
+    cost.compute_cycles *= block;
+  }
+
+  auto compute = [op, step, in, step_out,
+                  count = last ? count : 0](size_t begin, size_t end) {
+    ReductionStepTasks(op, step, in, step_out, count, begin, end);
+  };
+
+  auto on_done = [op, steps, index, last, in_holder = std::move(in_holder),
+                  out_holder, out, count, exec_ctx,
+                  buffers = std::move(buffers),
+                  done = std::move(done)]() mutable {
+    // The input of the completed step is no longer needed.
+    in_holder.reset();
+    if (last) {
+      done.emplace();
+      return;
+    }
+    const T* next_in = out_holder->data();
+    RunReductionSteps(op, std::move(steps), index + 1, next_in,
+                      std::move(out_holder), out, count, std::move(exec_ctx),
+                      std::move(buffers), std::move(done));
+  };
+
+  ParallelFor(exec_ctx).Execute(num_tasks,
+                                ParallelFor::BlockSizes::FromCost(cost),
+                                std::move(compute), std::move(on_done));
+}
+
+}  // namespace internal
+
+// Reduces `input` along the dimensions in `reduction_indices` (which must be
+// unique and in [0, rank)). `output` has the number of elements of the kept
+// dimensions, with or without the reduced dimensions of size 1.
+template <typename T>
+AsyncValueRef<Chain> Reduce(ReductionOp op, const DenseHostTensor& input,
+                            ArrayRef<int32_t> reduction_indices,
+                            DenseHostTensor* output,
+                            const ExecutionContext& exec_ctx) {
+  const int rank = input.shape().GetRank();
+  llvm::SmallVector<ssize_t, 4> dims;
+  input.shape().GetDimensions(&dims);
+
+  llvm::SmallVector<bool, 4> reduced_dims(rank, false);
+  size_t count = 1;
+  for (int32_t index : reduction_indices) {
+    reduced_dims[index] = true;
+    count *= dims[index];
+  }
+
+  const T* in = static_cast<const T*>(input.data());
+  T* out = static_cast<T*>(output->data());
+
+  auto steps = internal::GetReductionSteps(dims, reduced_dims);
+  if (steps.empty()) {
+    // Only dimensions of size 1 are reduced.
+    std::copy(in, in + input.NumElements(), out);
+    return MakeAvailableAsyncValueRef<Chain>(exec_ctx.host());
+  }
+
+  auto done = MakeUnconstructedAsyncValueRef<Chain>(exec_ctx.host());
+  auto buffers = std::make_shared<decltype(compat::KeepBuffers::alive(
+      &input, output))>(compat::KeepBuffers::alive(&input, output));
+  internal::RunReductionSteps<T>(
+      op, std::move(steps), /*index=*/0, in, /*in_holder=*/nullptr, out,
+      op == ReductionOp::kMean ? count : 0, exec_ctx, std::move(buffers),
+      done.CopyRef());
+  return done;
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_REDUCTION_KERNEL_H_
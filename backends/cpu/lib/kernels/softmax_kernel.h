@@ -19,9 +19,11 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_SOFTMAX_KERNEL_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_SOFTMAX_KERNEL_H_
 
+#include "./cwise_simd.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/common/compat/eigen/tensor_types.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/tensor_shape.h"
 
@@ -112,6 +114,39 @@ static typename EigenEvaluator::DependencyToken Softmax(
   }
 }
 
+// Computes the (log) softmax of the float `logits` along the last dimension.
+// Each row is computed with a single fused kernel (see simd::SoftmaxRow), and
+// the rows are split across the thread pool.
+template <bool log>
+AsyncValueRef<Chain> ParallelSoftmax(const DenseHostTensor& logits,
+                                     DenseHostTensor* softmax,
+                                     const ExecutionContext& exec_ctx) {
+  const TensorShape& shape = logits.shape();
+  const size_t num_classes =
+      shape.GetRank() == 0 ? 1 : shape.GetDimensionSize(shape.GetRank() - 1);
+  const size_t num_rows =
+      num_classes == 0 ? 0 : logits.NumElements() / num_classes;
+
+  const float* in = static_cast<const float*>(logits.data());
+  float* out = static_cast<float*>(softmax->data());
+
+  // Each row is read twice and written once (read twice and written twice
+  // for softmax), and computes an exponential for every class.
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = 2 * num_classes * sizeof(float);
+  cost.bytes_stored = (log ? 1 : 2) * num_classes * sizeof(float);
+  cost.compute_cycles = 20 * num_classes;
+
+  auto args = compat::KeepBuffers::alive(&logits, softmax);
+  return ParallelFor(exec_ctx).Execute(
+      num_rows, ParallelFor::BlockSizes::FromCost(cost),
+      [in, out, num_classes, args = std::move(args)](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row)
+          simd::SoftmaxRow(in + row * num_classes, out + row * num_classes,
+                           num_classes, log);
+      });
+}
+
 }  // namespace cpu
 }  // namespace tfrt
 
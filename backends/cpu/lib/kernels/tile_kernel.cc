@@ -18,6 +18,9 @@
 
 #include "./tile_kernel.h"
 
+#include "./block_copy.h"
+#include "tfrt/host_context/parallel_for.h"
+
 namespace tfrt {
 namespace cpu {
 
@@ -46,6 +49,43 @@ Expected<SmallVector<ssize_t, 5>> TileMultiples(
   return multiples;
 }
 
+namespace {
+
+TileCopy GetTileCopy(const DenseHostTensor& input,
+                     ArrayRef<ssize_t> multiples) {
+  SmallVector<ssize_t, 5> input_dims;
+  input.shape().GetDimensions(&input_dims);
+  return TileCopy(input_dims, multiples, input.dtype().GetHostSize());
+}
+
+}  // namespace
+
+AsyncValueRef<Chain> TileBlocks(const DenseHostTensor& input,
+                                ArrayRef<ssize_t> multiples,
+                                DenseHostTensor* output,
+                                const ExecutionContext& exec_ctx) {
+  if (output->NumElements() == 0) return GetReadyChain();
+  TileCopy copy = GetTileCopy(input, multiples);
+
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = copy.RowBytesLoaded();
+  cost.bytes_stored = copy.RowBytesStored();
+
+  return ParallelFor(exec_ctx).Execute(
+      copy.NumRows(), ParallelFor::BlockSizes::FromCost(cost),
+      [copy = std::move(copy), input = input.CopyRef(),
+       output = output->CopyRef()](size_t begin, size_t end) mutable {
+        copy.Copy(input.data(), output.data(), begin, end);
+      });
+}
+
+void TileBlocksSync(const DenseHostTensor& input, ArrayRef<ssize_t> multiples,
+                    DenseHostTensor* output) {
+  if (output->NumElements() == 0) return;
+  TileCopy copy = GetTileCopy(input, multiples);
+  copy.Copy(input.data(), output->data(), 0, copy.NumRows());
+}
+
 void TileStringTensor(const StringHostTensor& input, StringHostTensor* output) {
   // Compute strides from the shape.
   auto strides = [](const TensorShape& shape) -> SmallVector<ssize_t, 5> {
@@ -20,10 +20,9 @@
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TILE_KERNEL_H_
 
 #include "tfrt/common/compat/eigen/eigen_evaluator.h"
-#include "tfrt/common/compat/eigen/eigen_kernel.h"
-#include "tfrt/common/compat/eigen/tensor_types.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/type_traits.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
 #include "tfrt/tensor/string_host_tensor.h"
@@ -34,49 +33,42 @@ namespace cpu {
 Expected<SmallVector<ssize_t, 5>> TileMultiples(
     const DenseHostTensor& multiples_arg);
 
-template <int rank>
-using TileRankTag = std::integral_constant<int, rank>;
+// Tiles `input` into `output` with memory block copies (see block_copy.h),
+// in parallel blocks on the thread pool.
+AsyncValueRef<Chain> TileBlocks(const DenseHostTensor& input,
+                                ArrayRef<ssize_t> multiples,
+                                DenseHostTensor* output,
+                                const ExecutionContext& exec_ctx);
+
+// Tiles `input` into `output` on the calling thread.
+void TileBlocksSync(const DenseHostTensor& input, ArrayRef<ssize_t> multiples,
+                    DenseHostTensor* output);
+
+inline AsyncValueRef<Chain> TileBlocks(TypeTag<compat::AsyncEigenEvaluator>,
+                                       const DenseHostTensor& input,
+                                       ArrayRef<ssize_t> multiples,
+                                       DenseHostTensor* output,
+                                       const ExecutionContext& exec_ctx) {
+  return TileBlocks(input, multiples, output, exec_ctx);
+}
+
+inline Error TileBlocks(TypeTag<compat::SyncEigenEvaluator>,
+                        const DenseHostTensor& input,
+                        ArrayRef<ssize_t> multiples, DenseHostTensor* output,
+                        const ExecutionContext& exec_ctx) {
+  TileBlocksSync(input, multiples, output);
+  return Error::success();
+}
 
+// Tiles `input` into `output`. The elements are copied as raw bytes, so `T`
+// only has to match the size of the input dtype.
 template <typename T, typename EigenEvaluator>
 static typename EigenEvaluator::DependencyToken Tile(
     const DenseHostTensor& input, const SmallVector<ssize_t, 5>& multiples,
     DenseHostTensor* output, const ExecutionContext& exec_ctx) {
-  EigenEvaluator eigen{exec_ctx.host()};
-
-  auto rank_dispatch = [&](auto rank_tag) {
-    static constexpr int rank = decltype(rank_tag)::value;
-
-    auto input_view = DHTIndexableView<T, rank>(&input);
-    auto output_view = MutableDHTIndexableView<T, rank>(output);
-
-    auto input_t = compat::AsEigenConstTensor(input_view);
-    auto output_t = compat::AsEigenTensor(output_view);
-
-    Eigen::DSizes<Eigen::Index, rank> broadcast;
-    for (int i = 0; i < rank; ++i) {
-      broadcast[i] = multiples[i];
-    }
-
-    return eigen.Evaluate(output_t, input_t.broadcast(broadcast),
-                          eigen.KeepAlive(&input, output));
-  };
-
-  // Dispatch based on the output tensor rank.
-  const int rank = output->shape().GetRank();
-
-  if (rank == 1) {
-    return rank_dispatch(TileRankTag<1>{});
-  } else if (rank == 2) {
-    return rank_dispatch(TileRankTag<2>{});
-  } else if (rank == 3) {
-    return rank_dispatch(TileRankTag<3>{});
-  } else if (rank == 4) {
-    return rank_dispatch(TileRankTag<4>{});
-  } else if (rank == 5) {
-    return rank_dispatch(TileRankTag<5>{});
-  } else {
-    return eigen.MakeError("Unsupported tensor rank");
-  }
+  assert(input.dtype().GetHostSize() == sizeof(T));
+  return TileBlocks(TypeTag<EigenEvaluator>(), input, multiples, output,
+                    exec_ctx);
 }
 
 void TileStringTensor(const StringHostTensor& input, StringHostTensor* output);
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Transpose Tensorflow kernel implementation.
+
+#include "./transpose_kernel.h"
+
+#include "./block_copy.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+namespace cpu {
+
+Expected<SmallVector<ssize_t, 5>> TransposePerm(const DenseHostTensor& perm_arg,
+                                                int rank) {
+  SmallVector<ssize_t, 5> perm;
+
+  if (perm_arg.shape().GetRank() != 1) {
+    return MakeStringError("Transpose perm must be a vector");
+  }
+
+  if (perm_arg.dtype().kind() == DType::I32) {
+    DHTArrayView<int32_t> view(&perm_arg);
+    perm.assign(view.begin(), view.end());
+
+  } else if (perm_arg.dtype().kind() == DType::I64) {
+    DHTArrayView<int64_t> view(&perm_arg);
+    perm.assign(view.begin(), view.end());
+
+  } else {
+    return MakeStringError("Unsupported perm data type");
+  }
+
+  if (auto err = CheckTransposePerm(perm, rank)) return std::move(err);
+  return perm;
+}
+
+Error CheckTransposePerm(ArrayRef<ssize_t> perm, int rank) {
+  if (perm.size() != rank) {
+    return MakeStringError("Transpose perm must have the same size as input ",
+                           "rank");
+  }
+  SmallVector<bool, 5> seen(rank, false);
+  for (ssize_t d : perm) {
+    if (d < 0 || d >= rank || seen[d]) {
+      return MakeStringError("Transpose perm must be a permutation of [0, ",
+                             rank, ")");
+    }
+    seen[d] = true;
+  }
+  return Error::success();
+}
+
+TensorShape TransposeShape(const TensorShape& input_shape,
+                           ArrayRef<ssize_t> perm) {
+  SmallVector<ssize_t, 5> output_dims;
+  for (ssize_t d : perm) output_dims.push_back(input_shape.GetDimensionSize(d));
+  return TensorShape(output_dims);
+}
+
+namespace {
+
+TransposeCopy GetTransposeCopy(const DenseHostTensor& input,
+                               ArrayRef<ssize_t> perm) {
+  SmallVector<ssize_t, 5> input_dims;
+  input.shape().GetDimensions(&input_dims);
+  return TransposeCopy(input_dims, perm, input.dtype().GetHostSize());
+}
+
+}  // namespace
+
+AsyncValueRef<Chain> Transpose(const DenseHostTensor& input,
+                               ArrayRef<ssize_t> perm, DenseHostTensor* output,
+                               const ExecutionContext& exec_ctx) {
+  if (output->NumElements() == 0) return GetReadyChain();
+  TransposeCopy copy = GetTransposeCopy(input, perm);
+
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = copy.RowBytes();
+  cost.bytes_stored = copy.RowBytes();
+
+  return ParallelFor(exec_ctx).Execute(
+      copy.NumRows(), ParallelFor::BlockSizes::FromCost(cost),
+      [copy = std::move(copy), input = input.CopyRef(),
+       output = output->CopyRef()](size_t begin, size_t end) mutable {
+        copy.Copy(input.data(), output.data(), begin, end);
+      });
+}
+
+void TransposeSync(const DenseHostTensor& input, ArrayRef<ssize_t> perm,
+                   DenseHostTensor* output) {
+  if (output->NumElements() == 0) return;
+  TransposeCopy copy = GetTransposeCopy(input, perm);
+  copy.Copy(input.data(), output->data(), 0, copy.NumRows());
+}
+
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow Transpose kernel implementation.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TRANSPOSE_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TRANSPOSE_KERNEL_H_
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Reads the permutation of a transpose of a tensor of rank `rank` from an I32
+// or I64 vector, and checks that it is a permutation of [0, rank).
+Expected<SmallVector<ssize_t, 5>> TransposePerm(const DenseHostTensor& perm_arg,
+                                                int rank);
+
+// Same as above for a permutation that is already read.
+Error CheckTransposePerm(ArrayRef<ssize_t> perm, int rank);
+
+// Returns the shape of `input_shape` transposed by `perm`.
+TensorShape TransposeShape(const TensorShape& input_shape,
+                           ArrayRef<ssize_t> perm);
+
+// Transposes `input` into `output` with block copies (see block_copy.h), in
+// parallel blocks on the thread pool.
+AsyncValueRef<Chain> Transpose(const DenseHostTensor& input,
+                               ArrayRef<ssize_t> perm, DenseHostTensor* output,
+                               const ExecutionContext& exec_ctx);
+
+// Transposes `input` into `output` on the calling thread.
+void TransposeSync(const DenseHostTensor& input, ArrayRef<ssize_t> perm,
+                   DenseHostTensor* output);
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TRANSPOSE_KERNEL_H_
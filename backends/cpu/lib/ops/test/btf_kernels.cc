@@ -26,38 +26,19 @@ namespace tfrt {
 //===----------------------------------------------------------------------===//
 
 namespace {
-template <typename DType_, size_t Rank_>
-struct ParseDenseHostTensorTraits {
-  using DType = DType_;
-  static constexpr size_t kRank = Rank_;
-  using TensorTy = DenseHostTensor;
-  static constexpr auto kParseTensorFn =
-      ParseDenseHostTensorFromStream<DType_, Rank_>;
-};
-
-template <typename DType_, size_t Rank_>
-constexpr size_t ParseDenseHostTensorTraits<DType_, Rank_>::kRank;
-
+// Tensors are read over the memory mapped file instead of being copied.
 template <size_t Rank>
 void RegisterDenseTensorReaders(KernelRegistry* registry) {
-  registry->AddKernel(
-      "btf.read_dense_tensor.f32." + std::to_string(Rank),
-      TFRT_KERNEL(ReadTensorFromBTF<ParseDenseHostTensorTraits<float, Rank>>));
-  registry->AddKernel(
-      "btf.read_dense_tensor.i32." + std::to_string(Rank),
-      TFRT_KERNEL(
-          ReadTensorFromBTF<ParseDenseHostTensorTraits<int32_t, Rank>>));
-  registry->AddKernel(
-      "btf.read_dense_tensor.i64." + std::to_string(Rank),
-      TFRT_KERNEL(
-          ReadTensorFromBTF<ParseDenseHostTensorTraits<int64_t, Rank>>));
-  registry->AddKernel(
-      "btf.read_dense_tensor.i8." + std::to_string(Rank),
-      TFRT_KERNEL(ReadTensorFromBTF<ParseDenseHostTensorTraits<int8_t, Rank>>));
-  registry->AddKernel(
-      "btf.read_dense_tensor.ui8." + std::to_string(Rank),
-      TFRT_KERNEL(
-          ReadTensorFromBTF<ParseDenseHostTensorTraits<uint8_t, Rank>>));
+  registry->AddKernel("btf.read_dense_tensor.f32." + std::to_string(Rank),
+                      TFRT_KERNEL(MapDenseHostTensorFromBTF<float, Rank>));
+  registry->AddKernel("btf.read_dense_tensor.i32." + std::to_string(Rank),
+                      TFRT_KERNEL(MapDenseHostTensorFromBTF<int32_t, Rank>));
+  registry->AddKernel("btf.read_dense_tensor.i64." + std::to_string(Rank),
+                      TFRT_KERNEL(MapDenseHostTensorFromBTF<int64_t, Rank>));
+  registry->AddKernel("btf.read_dense_tensor.i8." + std::to_string(Rank),
+                      TFRT_KERNEL(MapDenseHostTensorFromBTF<int8_t, Rank>));
+  registry->AddKernel("btf.read_dense_tensor.ui8." + std::to_string(Rank),
+                      TFRT_KERNEL(MapDenseHostTensorFromBTF<uint8_t, Rank>));
 }
 }  // namespace
 
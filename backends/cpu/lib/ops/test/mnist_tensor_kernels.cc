@@ -18,6 +18,7 @@
 #include <limits>
 
 #include "../../kernels/cpu_kernels.h"
+#include "../../kernels/csr_matmul_kernel.h"
 #include "tfrt/common/compat/eigen/eigen_dtype.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/common/compat/eigen/tensor_types.h"
@@ -30,6 +31,7 @@
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/host_context/sync_kernel_utils.h"
 #include "tfrt/tensor/btf.h"
+#include "tfrt/tensor/csr_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
 
 using ::tfrt::compat::AsEigenConstTensor;
@@ -46,7 +48,31 @@ namespace tfrt {
 // mnist.matmul op and kernels
 //===----------------------------------------------------------------------===//
 
-static void MatMulOp(const DenseHostTensor& lhs, const DenseHostTensor& rhs,
+// Returns `tensor` as a DenseHostTensor, converting a CsrHostTensor.
+static llvm::Optional<DenseHostTensor> AsDenseHostTensor(
+    const HostTensor& tensor, HostContext* host) {
+  if (auto* csr = dyn_cast<CsrHostTensor>(&tensor))
+    return CopyCsrHostTensorToDenseHostTensor(*csr, host);
+  return cast<DenseHostTensor>(tensor).CopyRef();
+}
+
+// Computes C = A @ B for a CSR matrix A without converting it to dense.
+template <typename T>
+static RCReference<AsyncValue> CsrMatMulOp(const CsrHostTensor& lhs,
+                                           const DenseHostTensor& rhs,
+                                           DenseHostTensor dest_tensor,
+                                           const ExecutionContext& exec_ctx) {
+  auto chain = cpu::CsrMatMul<T>(lhs, rhs, &dest_tensor, exec_ctx);
+  auto result =
+      MakeUnconstructedAsyncValueRef<DenseHostTensor>(exec_ctx.host());
+  chain.AndThen([result = result.CopyRef(),
+                 dest_tensor = std::move(dest_tensor)]() mutable {
+    result.emplace(std::move(dest_tensor));
+  });
+  return result.ReleaseRCRef();
+}
+
+static void MatMulOp(const HostTensor& lhs, const HostTensor& rhs,
                      const OpAttrsRef& attrs, const TensorMetadata& dest_md,
                      RCReference<AsyncValue>* dest,
                      const ExecutionContext& exec_ctx) {
@@ -64,15 +90,43 @@ static void MatMulOp(const DenseHostTensor& lhs, const DenseHostTensor& rhs,
   bool transpose_a = attrs.GetAsserting<bool>("transpose_a");
   bool transpose_b = attrs.GetAsserting<bool>("transpose_b");
 
+  // A sparse lhs is multiplied directly, which only reads the rows of rhs at
+  // its non-zero columns.
+  auto* csr_lhs = dyn_cast<CsrHostTensor>(&lhs);
+  if (csr_lhs && !transpose_a && !transpose_b && isa<DenseHostTensor>(rhs)) {
+    const auto& dense_rhs = cast<DenseHostTensor>(rhs);
+    switch (lhs.dtype().kind()) {
+      default:
+        break;
+#define CSR_MATMUL_DTYPE(ENUM)                                            \
+  case DType::ENUM:                                                       \
+    *dest = CsrMatMulOp<TypeForDTypeKind<DType::ENUM>>(                   \
+        *csr_lhs, dense_rhs, std::move(dest_tensor), exec_ctx);           \
+    return;
+        CSR_MATMUL_DTYPE(F32)
+        CSR_MATMUL_DTYPE(F64)
+        CSR_MATMUL_DTYPE(I32)
+        CSR_MATMUL_DTYPE(I64)
+#undef CSR_MATMUL_DTYPE
+    }
+  }
+
+  auto lhs_dht = AsDenseHostTensor(lhs, host);
+  auto rhs_dht = AsDenseHostTensor(rhs, host);
+  if (!lhs_dht || !rhs_dht) {
+    *dest = EmitErrorAsync(exec_ctx, "out of memory converting operands");
+    return;
+  }
+
   // Computes C = A @ B.
   switch (lhs.dtype().kind()) {
     default:
       *dest = EmitErrorAsync(exec_ctx, "unsupported dtype for matmul");
       return;
-#define DTYPE_TRIVIAL(ENUM)                                \
-  case DType::ENUM:                                        \
-    cpu::CallMatMulKernel<TypeForDTypeKind<DType::ENUM>>(  \
-        lhs, rhs, &dest_tensor, transpose_a, transpose_b); \
+#define DTYPE_TRIVIAL(ENUM)                                          \
+  case DType::ENUM:                                                  \
+    cpu::CallMatMulKernel<TypeForDTypeKind<DType::ENUM>>(            \
+        *lhs_dht, *rhs_dht, &dest_tensor, transpose_a, transpose_b); \
     break;
 #include "tfrt/dtype/dtype.def"
   }
@@ -743,7 +797,8 @@ void RegisterMNISTTensorKernels(KernelRegistry* registry) {
 
 void RegisterTestMnistCpuOps(CpuOpRegistry* op_registry) {
   op_registry->AddOp("tfrt_test.matmul", TFRT_CPU_OP(MatMulOp),
-                     CpuOpFlags::NoSideEffects, {"transpose_a", "transpose_b"});
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsCsr,
+                     {"transpose_a", "transpose_b"});
   op_registry->AddOp("tfrt_test.relu", TFRT_CPU_OP(ReluOp),
                      CpuOpFlags::NoSideEffects);
   op_registry->AddOp("tfrt_test.equal", TFRT_CPU_OP(ElementwiseEqualOp),
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow Cast operation.
+
+#include "cast_op.h"
+
+#include "../../kernels/cast_kernel.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+// Only casts between float and bf16 or fp16 are supported, e.g. to store the
+// weights or activations of a model in 16 bits.
+static AsyncValueRef<DenseHostTensor> TfCastOp(
+    const DenseHostTensor& input, const TensorMetadata& output_md,
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+
+  if (input.dtype() == output_md.dtype)
+    return MakeAvailableAsyncValueRef<DenseHostTensor>(host, input.CopyRef());
+
+  if (!cpu::IsFloatCast(input.dtype(), output_md.dtype)) {
+    return EmitErrorAsync(exec_ctx, StrCat("Unsupported cast from ",
+                                           input.dtype(), " to ",
+                                           output_md.dtype));
+  }
+
+  auto output = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto chain = cpu::CastFloat(input, output.getPointer(), exec_ctx);
+  return ForwardValue(output.getValue(), std::move(chain), host);
+}
+
+}  // namespace
+
+void RegisterTfCastCpuOp(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf.Cast", TFRT_CPU_OP(TfCastOp),
+                     CpuOpFlags::NoSideEffects, {"SrcT", "DstT", "Truncate"});
+}
+
+}  // namespace tfrt
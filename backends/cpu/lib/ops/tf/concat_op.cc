@@ -37,7 +37,7 @@ static Expected<DenseHostTensor> TfConcatOpDense(
     const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
   auto* host = exec_ctx.host();
   // Allocate output tensor.
-  auto dest = DenseHostTensor::CreateUninitialized(output_md, host);
+  auto dest = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
   if (!dest) {
     return MakeStringError("out of memory allocating result");
   }
@@ -17,12 +17,16 @@
 #include "tfrt/cpu/ops/tf/cpu_ops.h"
 
 #include "../../kernels/cpu_kernels.h"
+#include "../../kernels/reduction_kernel.h"
+#include "cast_op.h"
 #include "concat_op.h"
 #include "constant_ops.h"
 #include "cwise_binary_ops.h"
 #include "cwise_unary_ops.h"
+#include "embedding_ops.h"
 #include "matmul_fusion_ops.h"
 #include "matmul_ops.h"
+#include "quantized_ops.h"
 #include "shape_ops.h"
 #include "softmax_ops.h"
 #include "tfrt/common/compat/eigen/eigen_dtype.h"
@@ -37,6 +41,7 @@
 #include "tfrt/tensor/dense_host_tensor_view.h"
 #include "tfrt/tensor/tensor_serialize_utils.h"
 #include "tile_op.h"
+#include "transpose_op.h"
 
 namespace tfrt {
 namespace {
@@ -49,7 +54,7 @@ static Expected<DenseHostTensor> TfConstOp(const OpAttrsRef& attrs,
                                            const TensorMetadata& dest_md,
                                            const ExecutionContext& exec_ctx) {
   auto dest_alloc =
-      DenseHostTensor::CreateUninitialized(dest_md, exec_ctx.host());
+      DenseHostTensor::CreateUninitialized(dest_md, exec_ctx);
   if (!dest_alloc) {
     return MakeStringError("out of memory allocating dht tensor");
   }
@@ -73,7 +78,7 @@ static AsyncValueRef<DenseHostTensor> TfReluOp(
     const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
 
-  auto dest = DenseHostTensor::CreateUninitialized(B_md, host);
+  auto dest = DenseHostTensor::CreateUninitialized(B_md, exec_ctx);
   if (!dest) {
     return EmitErrorAsync(exec_ctx, "out of memory allocating result");
   }
@@ -95,10 +100,22 @@ static AsyncValueRef<DenseHostTensor> TfReluOp(
 }
 
 //===----------------------------------------------------------------------===//
-// tf.Mean op
+// tf.Sum, tf.Mean and tf.Max ops
 //===----------------------------------------------------------------------===//
 
-struct MeanHelper {
+static const char* GetReductionOpName(cpu::ReductionOp op) {
+  switch (op) {
+    case cpu::ReductionOp::kSum:
+      return "tf.Sum";
+    case cpu::ReductionOp::kMean:
+      return "tf.Mean";
+    case cpu::ReductionOp::kMax:
+      return "tf.Max";
+  }
+  llvm_unreachable("unknown reduction op");
+}
+
+struct ReductionHelper {
   TensorMetadata output_metadata;
   TensorMetadata final_output_metadata;
 
@@ -107,10 +124,10 @@ struct MeanHelper {
   SmallVector<int32_t, 4> positive_reduction_indices;
 };
 
-static Expected<MeanHelper> TfMeanOutputMd(
-    const DenseHostTensor& input, const DenseHostTensor& reduction_indices,
-    bool keep_dims) {
-  MeanHelper helper;
+static Expected<ReductionHelper> TfReductionOutputMd(
+    const char* op_name, const DenseHostTensor& input,
+    const DenseHostTensor& reduction_indices, bool keep_dims) {
+  ReductionHelper helper;
 
   // Check if an input dimension is reduced or not.
   // TODO(tfrt-devs): Support i64 reduction_indices.
@@ -121,12 +138,13 @@ static Expected<MeanHelper> TfMeanOutputMd(
     int rank = input.shape().GetRank();
     if (reduction_index < -rank || reduction_index >= rank) {
       return MakeStringError(
-          "tf.Mean reduction index must be in [-input_rank, input_rank) range");
+          op_name,
+          " reduction index must be in [-input_rank, input_rank) range");
     }
     // Add the rank to get the corresponding positive index if it is negative.
     reduction_index = (reduction_index + rank) % rank;
     if (reduced_dim[reduction_index]) {
-      return MakeStringError("tf.Mean reduction indices must be unique");
+      return MakeStringError(op_name, " reduction indices must be unique");
     }
 
     reduced_dim[reduction_index] = true;
@@ -154,9 +172,11 @@ static Expected<MeanHelper> TfMeanOutputMd(
   return helper;
 }
 
-static AsyncValueRef<DenseHostTensor> TfMeanOp(
+template <cpu::ReductionOp op>
+static AsyncValueRef<DenseHostTensor> TfReductionOp(
     const DenseHostTensor& input, const DenseHostTensor& reduction_indices,
     const OpAttrsRef& op_attrs, const ExecutionContext& exec_ctx) {
+  const char* op_name = GetReductionOpName(op);
   HostContext* host = exec_ctx.host();
 
   bool keep_dims = false;
@@ -164,12 +184,13 @@ static AsyncValueRef<DenseHostTensor> TfMeanOp(
     keep_dims = attr.getValue();
 
   // Compute output tensor metadata from reduction indices.
-  auto helper = TfMeanOutputMd(input, reduction_indices, keep_dims);
+  auto helper =
+      TfReductionOutputMd(op_name, input, reduction_indices, keep_dims);
   if (auto err = helper.takeError())
     return EmitErrorAsync(exec_ctx, std::move(err));
 
   auto output =
-      DenseHostTensor::CreateUninitialized(helper->output_metadata, host);
+      DenseHostTensor::CreateUninitialized(helper->output_metadata, exec_ctx);
   if (!output) {
     return EmitErrorAsync(exec_ctx, "out of memory allocating tensor");
   }
@@ -177,13 +198,14 @@ static AsyncValueRef<DenseHostTensor> TfMeanOp(
   AsyncValueRef<Chain> chain;
   switch (input.dtype().kind()) {
     default:
-      chain = EmitErrorAsync(exec_ctx, "unsupported dtype for TfMeanOp");
+      chain = EmitErrorAsync(
+          exec_ctx, StrCat("unsupported dtype for ", op_name, " op"));
       break;
-#define DTYPE_NUMERIC(ENUM)                                             \
-  case DType::ENUM:                                                     \
-    chain = cpu::Mean<EigenTypeForDTypeKind<DType::ENUM>>(              \
-        input, helper->positive_reduction_indices, output.getPointer(), \
-        exec_ctx);                                                      \
+#define DTYPE_NUMERIC(ENUM)                                                 \
+  case DType::ENUM:                                                         \
+    chain = cpu::Reduce<EigenTypeForDTypeKind<DType::ENUM>>(                \
+        op, input, helper->positive_reduction_indices, output.getPointer(), \
+        exec_ctx);                                                          \
     break;
 #include "tfrt/dtype/dtype.def"  // NOLINT
   }
@@ -204,7 +226,7 @@ static AsyncValueRef<DenseHostTensor> TfBiasAddOp(
     const DenseHostTensor& input, const DenseHostTensor& bias,
     const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
-  auto output = DenseHostTensor::CreateUninitialized(output_md, host);
+  auto output = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
   if (!output) {
     return EmitErrorAsync(exec_ctx, "out of memory allocating tensor");
   }
@@ -253,20 +275,31 @@ void RegisterTfCpuOps(CpuOpRegistry* op_registry) {
                      CpuOpFlags::NoSideEffects, {"value"});
   op_registry->AddOp("tf.Relu", TFRT_CPU_OP(TfReluOp),
                      CpuOpFlags::NoSideEffects);
-  op_registry->AddOp("tf.Mean", TFRT_CPU_OP(TfMeanOp),
+  op_registry->AddOp("tf.Sum",
+                     TFRT_CPU_OP(TfReductionOp<cpu::ReductionOp::kSum>),
+                     CpuOpFlags::NoSideEffects);
+  op_registry->AddOp("tf.Mean",
+                     TFRT_CPU_OP(TfReductionOp<cpu::ReductionOp::kMean>),
+                     CpuOpFlags::NoSideEffects);
+  op_registry->AddOp("tf.Max",
+                     TFRT_CPU_OP(TfReductionOp<cpu::ReductionOp::kMax>),
                      CpuOpFlags::NoSideEffects);
   op_registry->AddOp("tf.BiasAdd", TFRT_CPU_OP(TfBiasAddOp),
                      CpuOpFlags::NoSideEffects);
 
+  RegisterTfCastCpuOp(op_registry);
   RegisterTfConcatCpuOp(op_registry);
   RegisterTfConstantCpuOps(op_registry);
   RegisterTfUnaryCpuOps(op_registry);
   RegisterTfBinaryCpuOps(op_registry);
+  RegisterTfEmbeddingCpuOps(op_registry);
   RegisterTfShapeCpuOps(op_registry);
   RegisterTfSofmaxCpuOps(op_registry);
   RegisterTfMatmulFusionCpuOps(op_registry);
   RegisterTfMatmulCpuOps(op_registry);
+  RegisterTfQuantizedCpuOps(op_registry);
   RegisterTfTileCpuOp(op_registry);
+  RegisterTfTransposeCpuOp(op_registry);
 }
 
 }  // namespace tfrt
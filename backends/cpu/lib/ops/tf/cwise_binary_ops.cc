@@ -103,12 +103,12 @@ static AsyncValueRef<HostTensor> TfBinaryOp(Argument<HostTensor> lhs,
 using Numeric = typename internal::GetTypeDispatch<
     DType::UI8, DType::UI16, DType::UI32, DType::UI64,
     DType::I8,  DType::I16,  DType::I32,  DType::I64,
-    DType::F16, DType::F32,  DType::F64>::Type;
+    DType::F16, DType::BF16, DType::F32,  DType::F64>::Type;
 
 using NumericAndComplex = typename internal::GetTypeDispatch<
     DType::UI8, DType::UI16, DType::UI32, DType::UI64,
     DType::I8,  DType::I16,  DType::I32,  DType::I64,
-    DType::F16, DType::F32,  DType::F64,
+    DType::F16, DType::BF16, DType::F32,  DType::F64,
     DType::Complex64, DType::Complex128>::Type;
 // clang-format on
 
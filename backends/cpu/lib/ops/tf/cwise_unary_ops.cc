@@ -57,14 +57,18 @@ static AsyncValueRef<DenseHostTensor> TfUnaryOp(
     default:
       return EmitErrorAsync(exec_ctx, "unsupported dtype");
       break;
-#define DTYPE_FLOAT(ENUM)                                      \
+#define UNARY_CASE(ENUM)                                       \
   case DType::ENUM: {                                          \
     using F = typename UnaryFunctor::template Functor<         \
         EigenTypeForDTypeKind<DType::ENUM>>;                   \
     tfrt::cpu::UnaryKernel<F>(*input, &output.get(), exec_ctx, \
                               std::move(on_done));             \
   } break;
+      UNARY_CASE(F16)
+      UNARY_CASE(BF16)
+#define DTYPE_FLOAT(ENUM) UNARY_CASE(ENUM)
 #include "tfrt/dtype/dtype.def"  // NOLINT
+#undef UNARY_CASE
   }
 
   return output;
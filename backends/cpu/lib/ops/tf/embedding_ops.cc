@@ -0,0 +1,195 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Gather, segment reduction and sparse embedding lookup operations. See
+// embedding_kernels.h for the kernels.
+
+#include "embedding_ops.h"
+
+#include <sys/types.h>
+
+#include <cstdint>
+
+#include "../../kernels/embedding_kernels.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/coo_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+// Returns the metadata of a tensor with `leading_dims` followed by the row
+// dimensions of `tensor`.
+static TensorMetadata GetRowsMetadata(DType dtype,
+                                      ArrayRef<ssize_t> leading_dims,
+                                      const TensorShape& shape) {
+  SmallVector<ssize_t, 4> dims(leading_dims.begin(), leading_dims.end());
+  for (int i = 1; i < shape.GetRank(); ++i)
+    dims.push_back(shape.GetDimensionSize(i));
+  return TensorMetadata(dtype, dims);
+}
+
+static AsyncValueRef<DenseHostTensor> SegmentReduce(
+    const DenseHostTensor& data, const DenseHostTensor* indices,
+    const DenseHostTensor& segment_ids, ssize_t num_segments,
+    cpu::SegmentCombiner combiner, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  if (data.shape().GetRank() < 1)
+    return EmitErrorAsync(exec_ctx, "data must have at least one dimension");
+
+  auto output = DenseHostTensor::CreateUninitialized(
+      GetRowsMetadata(data.dtype(), {num_segments}, data.shape()), exec_ctx);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto chain = cpu::SparseSegmentReduce(data, indices, segment_ids, combiner,
+                                        output.getPointer(), exec_ctx);
+  return ForwardValue(output.getValue(), std::move(chain), host);
+}
+
+//===----------------------------------------------------------------------===//
+// tf.GatherV2 op
+//===----------------------------------------------------------------------===//
+
+static AsyncValueRef<DenseHostTensor> TfGatherV2Op(
+    const DenseHostTensor& params, const DenseHostTensor& indices,
+    const DenseHostTensor& axis, const OpAttrsRef& attrs,
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+
+  // Only gathers along the first dimension are supported.
+  int64_t axis_value;
+  if (axis.NumElements() != 1) {
+    return EmitErrorAsync(exec_ctx, "axis must be a scalar");
+  } else if (axis.dtype().kind() == DType::I32) {
+    axis_value = *static_cast<const int32_t*>(axis.data());
+  } else if (axis.dtype().kind() == DType::I64) {
+    axis_value = *static_cast<const int64_t*>(axis.data());
+  } else {
+    return EmitErrorAsync(exec_ctx, "axis must be i32 or i64");
+  }
+  int64_t batch_dims = attrs.GetOptional<int64_t>("batch_dims").getValueOr(0);
+  if (axis_value != 0 || batch_dims != 0)
+    return EmitErrorAsync(exec_ctx, "only gathers along axis 0 are supported");
+  if (params.shape().GetRank() < 1)
+    return EmitErrorAsync(exec_ctx, "params must have at least one dimension");
+
+  SmallVector<ssize_t, 4> indices_dims;
+  indices.shape().GetDimensions(&indices_dims);
+  auto output = DenseHostTensor::CreateUninitialized(
+      GetRowsMetadata(params.dtype(), indices_dims, params.shape()), exec_ctx);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto chain = cpu::Gather(params, indices, output.getPointer(), exec_ctx);
+  return ForwardValue(output.getValue(), std::move(chain), host);
+}
+
+//===----------------------------------------------------------------------===//
+// tf.SegmentSum and tf.SparseSegment{Sum,Mean,SqrtN} ops
+//===----------------------------------------------------------------------===//
+
+static AsyncValueRef<DenseHostTensor> TfSegmentSumOp(
+    const DenseHostTensor& data, const DenseHostTensor& segment_ids,
+    const ExecutionContext& exec_ctx) {
+  auto num_segments = cpu::GetNumSegments(segment_ids);
+  if (!num_segments) return EmitErrorAsync(exec_ctx, num_segments.takeError());
+  return SegmentReduce(data, /*indices=*/nullptr, segment_ids, *num_segments,
+                       cpu::SegmentCombiner::kSum, exec_ctx);
+}
+
+template <cpu::SegmentCombiner combiner>
+static AsyncValueRef<DenseHostTensor> TfSparseSegmentOp(
+    const DenseHostTensor& data, const DenseHostTensor& indices,
+    const DenseHostTensor& segment_ids, const ExecutionContext& exec_ctx) {
+  auto num_segments = cpu::GetNumSegments(segment_ids);
+  if (!num_segments) return EmitErrorAsync(exec_ctx, num_segments.takeError());
+  return SegmentReduce(data, &indices, segment_ids, *num_segments, combiner,
+                       exec_ctx);
+}
+
+//===----------------------------------------------------------------------===//
+// tf._EmbeddingLookupSparse op
+//===----------------------------------------------------------------------===//
+
+// Combines the rows of `params` selected by the ids of each row of the sparse
+// [batch, max_ids] tensor `sp_ids`, like tf.nn.embedding_lookup_sparse without
+// weights. The ids of a batch row are the values of its non-zero elements,
+// which must be in row-major order. Batch rows without ids are zero.
+static AsyncValueRef<DenseHostTensor> TfEmbeddingLookupSparseOp(
+    const DenseHostTensor& params, const HostTensor& sp_ids_arg,
+    const OpAttrsRef& attrs, const ExecutionContext& exec_ctx) {
+  if (!isa<CooHostTensor>(sp_ids_arg))
+    return EmitErrorAsync(exec_ctx, "sp_ids must be a sparse tensor");
+  const CooHostTensor& sp_ids = cast<CooHostTensor>(sp_ids_arg);
+  if (sp_ids.shape().GetRank() != 2)
+    return EmitErrorAsync(exec_ctx, "sp_ids must be a sparse matrix");
+
+  auto combiner = cpu::ParseSegmentCombiner(
+      attrs.GetStringOptional("combiner").getValueOr("mean"));
+  if (!combiner) return EmitErrorAsync(exec_ctx, combiner.takeError());
+
+  // The segment ids are the batch rows, i.e. the first column of the indices
+  // of the non-zero elements.
+  const DenseHostTensor& coo_indices = *sp_ids.Indices();
+  const size_t num_ids = coo_indices.shape().GetDimensionSize(0);
+  auto segment_ids = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(DType(DType::I64), {static_cast<ssize_t>(num_ids)}),
+      exec_ctx);
+  if (!segment_ids) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating segment ids");
+  }
+  const int64_t* coo_rows = static_cast<const int64_t*>(coo_indices.data());
+  int64_t* rows = static_cast<int64_t*>(segment_ids->data());
+  for (size_t i = 0; i < num_ids; ++i) rows[i] = coo_rows[2 * i];
+
+  return SegmentReduce(params, sp_ids.Values(), *segment_ids,
+                       sp_ids.shape().GetDimensionSize(0), *combiner, exec_ctx);
+}
+
+}  // namespace
+
+void RegisterTfEmbeddingCpuOps(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf.GatherV2", TFRT_CPU_OP(TfGatherV2Op),
+                     CpuOpFlags::NoSideEffects, {"batch_dims"});
+  op_registry->AddOp("tf.SegmentSum", TFRT_CPU_OP(TfSegmentSumOp),
+                     CpuOpFlags::NoSideEffects);
+  op_registry->AddOp(
+      "tf.SparseSegmentSum",
+      TFRT_CPU_OP(TfSparseSegmentOp<cpu::SegmentCombiner::kSum>),
+      CpuOpFlags::NoSideEffects);
+  op_registry->AddOp(
+      "tf.SparseSegmentMean",
+      TFRT_CPU_OP(TfSparseSegmentOp<cpu::SegmentCombiner::kMean>),
+      CpuOpFlags::NoSideEffects);
+  op_registry->AddOp(
+      "tf.SparseSegmentSqrtN",
+      TFRT_CPU_OP(TfSparseSegmentOp<cpu::SegmentCombiner::kSqrtN>),
+      CpuOpFlags::NoSideEffects);
+  op_registry->AddOp("tf._EmbeddingLookupSparse",
+                     TFRT_CPU_OP(TfEmbeddingLookupSparseOp),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsCoo,
+                     {"combiner"});
+}
+
+}  // namespace tfrt
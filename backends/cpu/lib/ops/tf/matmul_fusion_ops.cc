@@ -40,7 +40,7 @@ static AsyncValueRef<DenseHostTensor> TfFusedMatMulOp(
     const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
 
-  auto output = DenseHostTensor::CreateUninitialized(output_md, host);
+  auto output = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
   if (!output) {
     return EmitErrorAsync(exec_ctx, "out of memory allocating result");
   }
@@ -22,7 +22,9 @@
 #include <complex>
 #include <initializer_list>
 
+#include "../../kernels/cast_kernel.h"
 #include "../../kernels/matmul_kernel.h"
+#include "../../kernels/packed_matmul_kernel.h"
 #include "tfrt/common/compat/eigen/eigen_evaluator.h"
 #include "tfrt/core_runtime/op_attrs.h"
 #include "tfrt/core_runtime/op_utils.h"
@@ -37,12 +39,19 @@ namespace {
 
 using compat::AsyncEigenEvaluator;
 
+static AsyncValueRef<DenseHostTensor> TfReducedPrecisionMatMulOp(
+    const DenseHostTensor& a, const DenseHostTensor& b, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx);
+
 static AsyncValueRef<DenseHostTensor> TfMatMulOp(
     const DenseHostTensor& a, const DenseHostTensor& b, const OpAttrsRef& attrs,
     const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
 
-  auto output = DenseHostTensor::CreateUninitialized(output_md, host);
+  if (cpu::IsFloatCast(a.dtype(), DType(DType::F32)))
+    return TfReducedPrecisionMatMulOp(a, b, attrs, output_md, exec_ctx);
+
+  auto output = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
   if (!output) {
     return EmitErrorAsync(exec_ctx, "out of memory allocating result");
   }
@@ -50,7 +59,19 @@ static AsyncValueRef<DenseHostTensor> TfMatMulOp(
   bool transpose_a = attrs.GetAsserting<bool>("transpose_a");
   bool transpose_b = attrs.GetAsserting<bool>("transpose_b");
 
-  AsyncEigenEvaluator evaluator(exec_ctx.host());
+  // Products with few rows, e.g. small batch inference, are faster with
+  // packed (and cached) rhs panels than with Eigen's contraction.
+  const ssize_t m = output_md.shape.GetDimensionSize(0);
+  const ssize_t n = output_md.shape.GetDimensionSize(1);
+  const ssize_t k = a.shape().GetDimensionSize(transpose_a ? 0 : 1);
+  if (cpu::UsePackedMatMul(a.dtype(), m, n, k)) {
+    return ForwardValue(
+        output.getValue(),
+        cpu::PackedMatMul(a, b, &*output, transpose_a, transpose_b, exec_ctx),
+        host);
+  }
+
+  AsyncEigenEvaluator evaluator(exec_ctx);
 
   // Dispatch based on the input data type.
   auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
@@ -70,6 +91,44 @@ static AsyncValueRef<DenseHostTensor> TfMatMulOp(
                       host);
 }
 
+// bf16 and fp16 products are computed in float. The operands are widened
+// before the multiplication and the product is rounded after it, which costs
+// little compared to the multiplication itself.
+static AsyncValueRef<DenseHostTensor> TfReducedPrecisionMatMulOp(
+    const DenseHostTensor& a, const DenseHostTensor& b, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  const DType f32(DType::F32);
+
+  auto widen = [&](const DenseHostTensor& tensor) {
+    auto result = DenseHostTensor::CreateUninitialized(
+        TensorMetadata(f32, tensor.shape()), exec_ctx);
+    if (result) cpu::CastFloatSync(tensor, result.getPointer());
+    return result;
+  };
+  auto float_a = widen(a);
+  auto float_b = widen(b);
+  auto output = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
+  if (!float_a || !float_b || !output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto float_output =
+      TfMatMulOp(*float_a, *float_b, attrs,
+                 TensorMetadata(f32, output_md.shape), exec_ctx);
+  auto result = MakeUnconstructedAsyncValueRef<DenseHostTensor>(host);
+  float_output.AndThen([float_a = std::move(*float_a),
+                        float_b = std::move(*float_b),
+                        float_output = float_output.CopyRef(),
+                        output = std::move(*output),
+                        result = result.CopyRef()]() mutable {
+    if (float_output.IsError()) return result.SetError(float_output.GetError());
+    cpu::CastFloatSync(*float_output, &output);
+    result.emplace(std::move(output));
+  });
+  return result;
+}
+
 }  // namespace
 
 void RegisterTfMatmulCpuOps(CpuOpRegistry* op_registry) {
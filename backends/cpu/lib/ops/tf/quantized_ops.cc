@@ -0,0 +1,205 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Int8 quantized inference operations. See quantized_kernels.h for the
+// quantization scheme.
+
+#include "quantized_ops.h"
+
+#include "../../kernels/quantized_kernels.h"
+#include "tfrt/common/ops/tf/dnn_ops_util.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+// Returns the value of a scalar i32 zero point tensor.
+static Expected<int32_t> GetZeroPoint(const DenseHostTensor& zero_point) {
+  if (zero_point.dtype().kind() != DType::I32 || zero_point.NumElements() != 1)
+    return MakeStringError("zero point must be a scalar i32 tensor");
+  return *static_cast<const int32_t*>(zero_point.data());
+}
+
+static int GetAxis(const OpAttrsRef& attrs) {
+  return attrs.GetOptional<int32_t>("axis").getValueOr(-1);
+}
+
+//===----------------------------------------------------------------------===//
+// tf._Quantize and tf._Dequantize ops
+//===----------------------------------------------------------------------===//
+
+static AsyncValueRef<DenseHostTensor> TfQuantizeOp(
+    const DenseHostTensor& input, const DenseHostTensor& scale,
+    const DenseHostTensor& zero_point, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  auto output = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto chain = cpu::Quantize(input, scale, zero_point, GetAxis(attrs),
+                             output.getPointer(), exec_ctx);
+  return ForwardValue(output.getValue(), std::move(chain), host);
+}
+
+static AsyncValueRef<DenseHostTensor> TfDequantizeOp(
+    const DenseHostTensor& input, const DenseHostTensor& scale,
+    const DenseHostTensor& zero_point, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  auto output = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto chain = cpu::Dequantize(input, scale, zero_point, GetAxis(attrs),
+                               output.getPointer(), exec_ctx);
+  return ForwardValue(output.getValue(), std::move(chain), host);
+}
+
+//===----------------------------------------------------------------------===//
+// tf._QuantizedMatMul and tf._QuantizedConv2D ops
+//===----------------------------------------------------------------------===//
+
+static AsyncValueRef<DenseHostTensor> TfQuantizedMatMulOp(
+    const DenseHostTensor& a, const DenseHostTensor& b,
+    const DenseHostTensor& a_zero_point, const TensorMetadata& output_md,
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  auto zero_point = GetZeroPoint(a_zero_point);
+  if (!zero_point) return EmitErrorAsync(exec_ctx, zero_point.takeError());
+
+  auto output = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto chain =
+      cpu::QuantizedMatMul(a, b, *zero_point, output.getPointer(), exec_ctx);
+  return ForwardValue(output.getValue(), std::move(chain), host);
+}
+
+static AsyncValueRef<DenseHostTensor> TfQuantizedConv2DOp(
+    const DenseHostTensor& input, const DenseHostTensor& filter,
+    const DenseHostTensor& input_zero_point, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  auto zero_point = GetZeroPoint(input_zero_point);
+  if (!zero_point) return EmitErrorAsync(exec_ctx, zero_point.takeError());
+
+  auto channel_order =
+      GetTfChannelOrder(attrs.GetStringOptional("data_format"));
+  if (channel_order != ChannelOrder::ChannelLast) {
+    return EmitErrorAsync(exec_ctx, "only channel last order is supported");
+  }
+
+  auto filter_dims = GetDimensions(filter.shape());
+  // TF filter is HWIO, convert to OIHW.
+  RotateRight(filter_dims, 2);
+  std::swap(filter_dims[0], filter_dims[1]);
+
+  // Convert the NHWC input to NCHW.
+  auto input_dims = GetDimensions(input.shape());
+  RotateRight(llvm::MutableArrayRef<ssize_t>(input_dims).drop_front());
+
+  auto windowed_output_data = GetTfWindowedOutputData(
+      input_dims, filter_dims, channel_order,
+      attrs.GetStringAsserting("padding"),
+      attrs.GetArrayOptional<int>("explicit_paddings"),
+      attrs.GetArrayOptional<ssize_t>("strides"),
+      attrs.GetArrayOptional<ssize_t>("dilations"));
+  if (!windowed_output_data)
+    return EmitErrorAsync(exec_ctx, windowed_output_data.takeError());
+
+  cpu::QuantizedConv2DParams params;
+  params.input_zero_point = *zero_point;
+  for (int i = 0; i < 2; ++i) {
+    params.strides[i] = windowed_output_data->strides[i];
+    params.dilations[i] = windowed_output_data->dilations[i];
+    params.paddings_before[i] = windowed_output_data->paddings_before[i];
+  }
+
+  auto output = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto chain = cpu::QuantizedConv2D(input, filter, params,
+                                    output.getPointer(), exec_ctx);
+  return ForwardValue(output.getValue(), std::move(chain), host);
+}
+
+//===----------------------------------------------------------------------===//
+// tf._QuantizedBiasAdd and tf._QuantizedRelu ops
+//===----------------------------------------------------------------------===//
+
+static AsyncValueRef<DenseHostTensor> TfQuantizedBiasAddOp(
+    const DenseHostTensor& input, const DenseHostTensor& bias,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  auto output = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto chain =
+      cpu::QuantizedBiasAdd(input, bias, output.getPointer(), exec_ctx);
+  return ForwardValue(output.getValue(), std::move(chain), host);
+}
+
+static AsyncValueRef<DenseHostTensor> TfQuantizedReluOp(
+    const DenseHostTensor& input, const DenseHostTensor& zero_point_tensor,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  auto zero_point = GetZeroPoint(zero_point_tensor);
+  if (!zero_point) return EmitErrorAsync(exec_ctx, zero_point.takeError());
+
+  auto output = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto chain =
+      cpu::QuantizedRelu(input, *zero_point, output.getPointer(), exec_ctx);
+  return ForwardValue(output.getValue(), std::move(chain), host);
+}
+
+}  // namespace
+
+void RegisterTfQuantizedCpuOps(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf._Quantize", TFRT_CPU_OP(TfQuantizeOp),
+                     CpuOpFlags::NoSideEffects, {"T", "axis"});
+  op_registry->AddOp("tf._Dequantize", TFRT_CPU_OP(TfDequantizeOp),
+                     CpuOpFlags::NoSideEffects, {"axis"});
+  op_registry->AddOp("tf._QuantizedMatMul", TFRT_CPU_OP(TfQuantizedMatMulOp),
+                     CpuOpFlags::NoSideEffects);
+  op_registry->AddOp(
+      "tf._QuantizedConv2D", TFRT_CPU_OP(TfQuantizedConv2DOp),
+      CpuOpFlags::NoSideEffects,
+      {"padding", "explicit_paddings", "data_format", "strides", "dilations"});
+  op_registry->AddOp("tf._QuantizedBiasAdd", TFRT_CPU_OP(TfQuantizedBiasAddOp),
+                     CpuOpFlags::NoSideEffects);
+  op_registry->AddOp("tf._QuantizedRelu", TFRT_CPU_OP(TfQuantizedReluOp),
+                     CpuOpFlags::NoSideEffects);
+}
+
+}  // namespace tfrt
@@ -38,11 +38,18 @@ static AsyncValueRef<DenseHostTensor> TfSoftmaxOp(
     const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
 
-  auto dest = DenseHostTensor::CreateUninitialized(output_md, host);
+  auto dest = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
   if (!dest) {
     return EmitErrorAsync(exec_ctx, "out of memory allocating result");
   }
 
+  // Float softmax uses the fused and vectorized row kernel.
+  if (logits.dtype().kind() == DType::F32) {
+    auto chain =
+        ::tfrt::cpu::ParallelSoftmax<log>(logits, dest.getPointer(), exec_ctx);
+    return ForwardValue(dest.getValue(), std::move(chain), host);
+  }
+
   AsyncValueRef<Chain> chain;
   switch (logits.dtype().kind()) {
     default:
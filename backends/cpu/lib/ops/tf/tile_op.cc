@@ -66,7 +66,7 @@ static AsyncValueRef<HostTensor> TfTileOp(const HostTensor& input_arg,
     const DenseHostTensor& input = cast<DenseHostTensor>(input_arg);
 
     // Allocate output tensor.
-    auto dest = DenseHostTensor::CreateUninitialized(output_md, host);
+    auto dest = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
     if (!dest) {
       return EmitErrorAsync(exec_ctx, "out of memory allocating result");
     }
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow Transpose operation.
+
+#include "transpose_op.h"
+
+#include "../../kernels/transpose_kernel.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/tensor_serialize_utils.h"
+
+namespace tfrt {
+namespace {
+
+static AsyncValueRef<DenseHostTensor> TfTransposeOpImpl(
+    const DenseHostTensor& input, ArrayRef<ssize_t> perm,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+
+  // The metadata function of "tf.Transpose" can't read the values of the perm
+  // tensor, so check that it computed the shape of this permutation.
+  if (cpu::TransposeShape(input.shape(), perm) != output_md.shape) {
+    return EmitErrorAsync(
+        exec_ctx, "tf.Transpose perm does not match the output shape");
+  }
+
+  auto output = DenseHostTensor::CreateUninitialized(output_md, exec_ctx);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto chain = cpu::Transpose(input, perm, output.getPointer(), exec_ctx);
+  return ForwardValue(output.getValue(), std::move(chain), host);
+}
+
+static AsyncValueRef<DenseHostTensor> TfTransposeOp(
+    const DenseHostTensor& input, const DenseHostTensor& perm_arg,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  auto perm = cpu::TransposePerm(perm_arg, input.shape().GetRank());
+  if (!perm) return EmitErrorAsync(exec_ctx, perm.takeError());
+  return TfTransposeOpImpl(input, *perm, output_md, exec_ctx);
+}
+
+static AsyncValueRef<DenseHostTensor> TfTransposeOpFolded(
+    const DenseHostTensor& input, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  DenseAttr perm_attr;
+  if (!attrs.Get("perm", &perm_attr)) {
+    return EmitErrorAsync(exec_ctx,
+                          "tf.Transpose needs a `perm` dense attribute");
+  }
+
+  DenseView perm_view = CreateDenseView(perm_attr);
+  SmallVector<ssize_t, 5> perm;
+  switch (perm_view.dtype().kind()) {
+    case DType::I32: {
+      auto value = perm_view.GetFlat<int32_t>();
+      perm.assign(value.begin(), value.end());
+      break;
+    }
+    case DType::I64: {
+      auto value = perm_view.GetFlat<int64_t>();
+      perm.assign(value.begin(), value.end());
+      break;
+    }
+    default:
+      return EmitErrorAsync(exec_ctx, "Unsupported perm data type");
+  }
+
+  if (auto err = cpu::CheckTransposePerm(perm, input.shape().GetRank()))
+    return EmitErrorAsync(exec_ctx, std::move(err));
+  return TfTransposeOpImpl(input, perm, output_md, exec_ctx);
+}
+
+}  // namespace
+
+void RegisterTfTransposeCpuOp(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf.Transpose", TFRT_CPU_OP(TfTransposeOp),
+                     CpuOpFlags::NoSideEffects);
+
+  // "_tf.Transpose" is a compiler-optimized version of "tf.Transpose" where
+  // the perm argument is folded to an attribute.
+  op_registry->AddOp("_tf.Transpose", TFRT_CPU_OP(TfTransposeOpFolded),
+                     CpuOpFlags::NoSideEffects, {"perm"});
+}
+
+}  // namespace tfrt
@@ -0,0 +1,111 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor --test_init_function=register_op_handlers_cpu $(bef_name %s) | FileCheck %s --dump-input=fail
+
+func @register_op_handlers_cpu() {
+  %null = "corert.create_null_op_handler"() : () -> !corert.ophandler
+  %cpu = "corert.create_cpu_op_handler"(%null) : (!corert.ophandler) -> !corert.ophandler
+  corert.register_op_handler %cpu "cpu"
+  tfrt.return
+}
+
+// CHECK: --- Running 'cast_f32_bf16'
+func @cast_f32_bf16() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+
+  // 1 + 1/256 and 1 + 3/256 are halfway between two bf16 values and round to
+  // the even one.
+  %operand = corert.executeop(%cpu) "tf.Const"()
+    {value = dense<[1.0, 1.00390625, 1.01171875, -2.5]> : tensor<4xf32>, dtype = f32} : 1
+  %bf16 = corert.executeop(%cpu) "tf.Cast"(%operand)
+    {DstT = bf16, SrcT = f32, Truncate = false} : 1
+  %result = corert.executeop(%cpu) "tf.Cast"(%bf16)
+    {DstT = f32, SrcT = bf16, Truncate = false} : 1
+
+  // CHECK: DenseHostTensor dtype = F32, shape = [4]
+  // CHECK-SAME: values = [1.000000e+00, 1.000000e+00, 1.015625e+00, -2.500000e+00]
+  %ch_print_cpu = corert.executeop.seq(%cpu, %ch0) "tfrt_test.print"(%result) : 0
+  tfrt.return %ch_print_cpu : !tfrt.chain
+}
+
+// CHECK: --- Running 'cast_f32_f16'
+func @cast_f32_f16() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+
+  %operand = corert.executeop(%cpu) "tf.Const"()
+    {value = dense<[1.0, 0.1, 65504.0, -2.5]> : tensor<4xf32>, dtype = f32} : 1
+  %f16 = corert.executeop(%cpu) "tf.Cast"(%operand)
+    {DstT = f16, SrcT = f32, Truncate = false} : 1
+  %result = corert.executeop(%cpu) "tf.Cast"(%f16)
+    {DstT = f32, SrcT = f16, Truncate = false} : 1
+
+  // CHECK: DenseHostTensor dtype = F32, shape = [4]
+  // CHECK-SAME: values = [1.000000e+00, 9.997559e-02, 6.550400e+04, -2.500000e+00]
+  %ch_print_cpu = corert.executeop.seq(%cpu, %ch0) "tfrt_test.print"(%result) : 0
+  tfrt.return %ch_print_cpu : !tfrt.chain
+}
+
+// CHECK: --- Running 'matmul_mul_bf16'
+func @matmul_mul_bf16() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+
+  %a = corert.executeop(%cpu) "tf.Const"()
+    {value = dense<[[1.0, 2.0], [3.0, 4.0]]> : tensor<2x2xf32>, dtype = f32} : 1
+  %b = corert.executeop(%cpu) "tf.Const"()
+    {value = dense<[[1.0, 0.5], [0.25, 2.0]]> : tensor<2x2xf32>, dtype = f32} : 1
+  %a_bf16 = corert.executeop(%cpu) "tf.Cast"(%a)
+    {DstT = bf16, SrcT = f32, Truncate = false} : 1
+  %b_bf16 = corert.executeop(%cpu) "tf.Cast"(%b)
+    {DstT = bf16, SrcT = f32, Truncate = false} : 1
+
+  %product = corert.executeop(%cpu) "tf.MatMul"(%a_bf16, %b_bf16)
+    {transpose_a = false, transpose_b = false} : 1
+  %square = corert.executeop(%cpu) "tf.Mul"(%product, %product) : 1
+  %result = corert.executeop(%cpu) "tf.Cast"(%square)
+    {DstT = f32, SrcT = bf16, Truncate = false} : 1
+
+  // CHECK: DenseHostTensor dtype = F32, shape = [2, 2]
+  // CHECK-SAME: values = [2.250000e+00, 2.025000e+01, 1.600000e+01, 9.000000e+01]
+  %ch_print_cpu = corert.executeop.seq(%cpu, %ch0) "tfrt_test.print"(%result) : 0
+  tfrt.return %ch_print_cpu : !tfrt.chain
+}
+
+// CHECK: --- Running 'matmul_f16'
+func @matmul_f16() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+
+  %a = corert.executeop(%cpu) "tf.Const"()
+    {value = dense<[[1.0, 2.0], [3.0, 4.0]]> : tensor<2x2xf32>, dtype = f32} : 1
+  %b = corert.executeop(%cpu) "tf.Const"()
+    {value = dense<[[1.0, 0.5], [0.25, 2.0]]> : tensor<2x2xf32>, dtype = f32} : 1
+  %a_f16 = corert.executeop(%cpu) "tf.Cast"(%a)
+    {DstT = f16, SrcT = f32, Truncate = false} : 1
+  %b_f16 = corert.executeop(%cpu) "tf.Cast"(%b)
+    {DstT = f16, SrcT = f32, Truncate = false} : 1
+
+  %product = corert.executeop(%cpu) "tf.MatMul"(%a_f16, %b_f16)
+    {transpose_a = false, transpose_b = true} : 1
+  %result = corert.executeop(%cpu) "tf.Cast"(%product)
+    {DstT = f32, SrcT = f16, Truncate = false} : 1
+
+  // CHECK: DenseHostTensor dtype = F32, shape = [2, 2]
+  // CHECK-SAME: values = [2.000000e+00, 4.250000e+00, 5.000000e+00, 8.750000e+00]
+  %ch_print_cpu = corert.executeop.seq(%cpu, %ch0) "tfrt_test.print"(%result) : 0
+  tfrt.return %ch_print_cpu : !tfrt.chain
+}
@@ -0,0 +1,68 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: env TFRT_CPURT_BUCKET_SIZES=8,16 \
+// RUN:   bef_executor $(bef_name %s) | FileCheck %s
+
+// The operands of the bucketed kernel are padded with zero rows to the bucket
+// size, and the results are sliced back to the rows of the operands.
+
+module @kernels attributes { tfrt.compiled } {
+  func @main(%input: memref<?x?xf32>) -> memref<?x?xf32>
+      attributes { cpurt.bucketed } {
+    %c0 = constant 0 : index
+    %c1 = constant 1 : index
+    %0 = memref.dim %input, %c0 : memref<?x?xf32>
+    %1 = memref.dim %input, %c1 : memref<?x?xf32>
+    %output = memref.alloc(%0, %1) : memref<?x?xf32>
+
+    linalg.generic { indexing_maps = [affine_map<(d0, d1) -> (d0, d1)>,
+                                      affine_map<(d0, d1) -> (d0, d1)>],
+                     iterator_types = ["parallel", "parallel"] }
+    ins(%input: memref<?x?xf32>) outs(%output : memref<?x?xf32>) {
+      ^bb0(%in: f32, %out: f32):
+        %2 = addf %in, %in : f32
+        linalg.yield %2 : f32
+    }
+
+    return %output : memref<?x?xf32>
+  }
+}
+
+// CHECK: --- Running 'bucketed'
+func @bucketed() {
+  %ch0 = tfrt.new.chain
+
+  %executable = cpurt.compile { kernel = @kernels::@main }
+
+  %input0 = tfrt_dht.create_uninitialized_tensor.f32.2 [5 : i64, 4 : i64]
+  %input0_ready = tfrt_dht.fill_tensor_with_constant.f32 %input0, %ch0 1.0 : f32
+  %0 = cpurt.execute %executable[%input0_ready](%input0)
+              : (!t.tensor) -> !t.tensor
+
+  // CHECK:      DenseHostTensor dtype = F32, shape = [5, 4]
+  // CHECK-SAME: values = [2.0{{0*}}e+00
+  %printed0 = tfrt_dht.print_tensor %0, %ch0
+
+  %input1 = tfrt_dht.create_uninitialized_tensor.f32.2 [9 : i64, 4 : i64]
+  %input1_ready = tfrt_dht.fill_tensor_with_constant.f32 %input1, %printed0 3.0 : f32
+  %1 = cpurt.execute %executable[%input1_ready](%input1)
+              : (!t.tensor) -> !t.tensor
+
+  // CHECK:      DenseHostTensor dtype = F32, shape = [9, 4]
+  // CHECK-SAME: values = [6.0{{0*}}e+00
+  %printed1 = tfrt_dht.print_tensor %1, %ch0
+
+  tfrt.return
+}
@@ -0,0 +1,63 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor -print_cpurt_kernel_stats $(bef_name %s) | FileCheck %s
+
+module @kernels attributes { tfrt.compiled } {
+  func @main(%input: memref<?xf32>) -> memref<?xf32> {
+    %c0 = constant 0 : index
+    %0 = memref.dim %input, %c0 : memref<?xf32>
+    %output = memref.alloc(%0) : memref<?xf32>
+
+    linalg.generic { indexing_maps = [affine_map<(d0) -> (d0)>,
+                                      affine_map<(d0) -> (d0)>],
+                     iterator_types = ["parallel"] }
+    ins(%input: memref<?xf32>) outs(%output : memref<?xf32>) {
+      ^bb0(%in: f32, %out: f32):
+        %1 = addf %in, %in : f32
+        linalg.yield %1 : f32
+    }
+
+    return %output : memref<?xf32>
+  }
+}
+
+// CHECK: --- Running 'compile_twice'
+func @compile_twice() {
+  %ch0 = tfrt.new.chain
+
+  %input = tfrt_dht.create_uninitialized_tensor.f32.1 [4 : i64]
+  %input_ready = tfrt_dht.fill_tensor_with_constant.f32 %input, %ch0 1.0 : f32
+
+  // Compile kernels at different locations share the JitExecutable, because
+  // they compile the same module.
+  %executable0 = cpurt.compile { kernel = @kernels::@main }
+  %executable1 = cpurt.compile { kernel = @kernels::@main }
+
+  %output0 = cpurt.execute %executable0[%input_ready](%input)
+              : (!t.tensor) -> !t.tensor
+  %output1 = cpurt.execute %executable1[%ch0](%output0)
+              : (!t.tensor) -> !t.tensor
+
+  // CHECK:      DenseHostTensor dtype = F32, shape = [4]
+  // CHECK-SAME: values = [4.0{{.*}}
+  %printed = tfrt_dht.print_tensor %output1, %ch0
+
+  tfrt.return
+}
+
+// The default executable is compiled once, and executed by both kernels.
+// CHECK: --- CPURT kernel stats (compilation in ms, execution in us):
+// CHECK-NEXT: compiles
+// CHECK-NEXT: {{^ +}}1 {{.*}} 2 {{.*}}  main@{{[0-9a-f]+}}
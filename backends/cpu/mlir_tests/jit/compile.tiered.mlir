@@ -0,0 +1,64 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: env TFRT_CPURT_TIERED_COMPILATION_THRESHOLD=2 \
+// RUN:   bef_executor $(bef_name %s) --work_queue_type=mstd:8 | FileCheck %s
+
+// The kernel is compiled without optimizations first, and recompiled with
+// optimizations after the second execution. Executions run the unoptimized
+// kernel until the optimized one is ready, so either of them can compute the
+// results.
+
+module @kernels attributes { tfrt.compiled } {
+  func @main(%input: memref<?x?xf32>) -> memref<?x?xf32> {
+    %c0 = constant 0 : index
+    %c1 = constant 1 : index
+    %0 = memref.dim %input, %c0 : memref<?x?xf32>
+    %1 = memref.dim %input, %c1 : memref<?x?xf32>
+    %output = memref.alloc(%0, %1) : memref<?x?xf32>
+
+    linalg.generic { indexing_maps = [affine_map<(d0, d1) -> (d0, d1)>,
+                                      affine_map<(d0, d1) -> (d0, d1)>],
+                     iterator_types = ["parallel", "parallel"] }
+    ins(%input: memref<?x?xf32>) outs(%output : memref<?x?xf32>) {
+      ^bb0(%in: f32, %out: f32):
+        %2 = addf %in, %in : f32
+        linalg.yield %2 : f32
+    }
+
+    return %output : memref<?x?xf32>
+  }
+}
+
+// CHECK: --- Running 'tiered_compilation'
+func @tiered_compilation() {
+  %ch0 = tfrt.new.chain
+
+  %input = tfrt_dht.create_uninitialized_tensor.f32.2 [4 : i64, 4 : i64]
+  %input_ready = tfrt_dht.fill_tensor_with_constant.f32 %input, %ch0 1.0 : f32
+
+  %executable = cpurt.compile { kernel = @kernels::@main }
+
+  %0 = cpurt.execute %executable[%input_ready](%input)
+              : (!t.tensor) -> !t.tensor
+  %1 = cpurt.execute %executable[%ch0](%0) : (!t.tensor) -> !t.tensor
+  %2 = cpurt.execute %executable[%ch0](%1) : (!t.tensor) -> !t.tensor
+  %3 = cpurt.execute %executable[%ch0](%2) : (!t.tensor) -> !t.tensor
+
+  // CHECK:      DenseHostTensor dtype = F32, shape = [4, 4]
+  // CHECK-SAME: values = [1.6{{0*}}e+01
+  %printed = tfrt_dht.print_tensor %3, %ch0
+
+  tfrt.return
+}
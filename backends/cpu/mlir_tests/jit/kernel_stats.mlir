@@ -0,0 +1,63 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor -print_cpurt_kernel_stats $(bef_name %s) | FileCheck %s
+
+module @kernels attributes { tfrt.compiled } {
+  func @main(%input: memref<?x?xf32>) -> memref<?x?xf32> {
+    %c0 = constant 0 : index
+    %c1 = constant 1 : index
+    %0 = memref.dim %input, %c0 : memref<?x?xf32>
+    %1 = memref.dim %input, %c1 : memref<?x?xf32>
+    %output = memref.alloc(%0, %1) : memref<?x?xf32>
+
+    linalg.generic { indexing_maps = [affine_map<(d0, d1) -> (d0, d1)>,
+                                      affine_map<(d0, d1) -> (d0, d1)>],
+                     iterator_types = ["parallel", "parallel"] }
+    ins(%input: memref<?x?xf32>) outs(%output : memref<?x?xf32>) {
+      ^bb0(%in: f32, %out: f32):
+        %2 = addf %in, %in : f32
+        linalg.yield %2 : f32
+    }
+
+    return %output : memref<?x?xf32>
+  }
+}
+
+// CHECK: --- Running 'execute_twice'
+func @execute_twice() {
+  %ch0 = tfrt.new.chain
+
+  %input = tfrt_dht.create_uninitialized_tensor.f32.2 [4 : i64, 4 : i64]
+  %input_ready = tfrt_dht.fill_tensor_with_constant.f32 %input, %ch0 1.0 : f32
+
+  %executable = cpurt.compile { kernel = @kernels::@main }
+
+  %output0 = cpurt.execute %executable[%input_ready](%input)
+              : (!t.tensor) -> !t.tensor
+  %output1 = cpurt.execute %executable[%ch0](%output0)
+              : (!t.tensor) -> !t.tensor
+
+  // CHECK:      DenseHostTensor dtype = F32, shape = [4, 4]
+  // CHECK-SAME: values = [4.0{{.*}}
+  %printed = tfrt_dht.print_tensor %output1, %ch0
+
+  tfrt.return
+}
+
+// The kernel statistics are printed after all functions have run. The default
+// executable is compiled once, and executed twice.
+// CHECK: --- CPURT kernel stats (compilation in ms, execution in us):
+// CHECK-NEXT: compiles
+// CHECK-NEXT: {{^ +}}1 {{.*}} 2 {{.*}}  main@{{[0-9a-f]+}}
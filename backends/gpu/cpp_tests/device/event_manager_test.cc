@@ -0,0 +1,69 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for EventManager.
+#include "tfrt/gpu/device/event_manager.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/error_util.h"
+#include "tfrt/gpu/wrapper/driver_wrapper.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace gpu {
+
+class EventManagerTest : public ::testing::TestWithParam<wrapper::Platform> {};
+
+TEST_P(EventManagerTest, CompletesManyEvents) {
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(/*num_threads=*/2,
+                                   /*num_blocking_threads=*/1));
+
+  ASSERT_TRUE(IsSuccess(Init(GetParam())));
+  TFRT_ASSERT_AND_ASSIGN(auto device, DeviceGet(GetParam(), 0));
+  TFRT_ASSERT_AND_ASSIGN(auto context, DevicePrimaryCtxRetain(device));
+  TFRT_ASSERT_AND_ASSIGN(auto current, wrapper::CtxSetCurrent(context.get()));
+  TFRT_ASSERT_AND_ASSIGN(auto stream, wrapper::StreamCreate(
+                                          current,
+                                          wrapper::StreamFlags::DEFAULT));
+
+  // More events than blocking threads complete without blocking a thread each.
+  std::vector<RCReference<AsyncValue>> chains;
+  for (int i = 0; i < 100; ++i) {
+    TFRT_ASSERT_AND_ASSIGN(
+        auto event,
+        wrapper::EventCreate(current, wrapper::EventFlags::DISABLE_TIMING));
+    ASSERT_TRUE(IsSuccess(wrapper::EventRecord(event.get(), stream.get())));
+    chains.push_back(EventManager::Get(context.get())
+                         .Then(std::move(event), host.get())
+                         .ReleaseRCRef());
+  }
+
+  host->Await(chains);
+  for (auto& chain : chains) EXPECT_FALSE(chain->IsError());
+}
+
+INSTANTIATE_TEST_SUITE_P(BaseTestCases, EventManagerTest,
+                         ::testing::Values(wrapper::Platform::CUDA));
+
+}  // namespace gpu
+}  // namespace tfrt
@@ -0,0 +1,104 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for the module cache of GpuContext.
+#include "tfrt/gpu/gpu_types.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/error_util.h"
+#include "tfrt/gpu/wrapper/driver_wrapper.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace gpu {
+
+// PTX string of an empty kernel.
+static const char kKernelPtx[] = R"(
+    .version 6.0
+    .target sm_35
+    .address_size 64
+
+    .visible .entry Kernel() {
+      ret;
+    })";
+
+class GpuContextTest : public ::testing::TestWithParam<wrapper::Platform> {
+ protected:
+  std::unique_ptr<HostContext> CreateHostContext() {
+    return std::make_unique<HostContext>(
+        [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+        CreateMultiThreadedWorkQueue(/*num_threads=*/2,
+                                     /*num_blocking_threads=*/4));
+  }
+};
+
+TEST_P(GpuContextTest, LoadModulesConcurrently) {
+  ASSERT_TRUE(IsSuccess(Init(GetParam())));
+  TFRT_ASSERT_AND_ASSIGN(auto device, DeviceGet(GetParam(), 0));
+  TFRT_ASSERT_AND_ASSIGN(auto context, DevicePrimaryCtxRetain(device));
+  auto gpu_context = MakeAvailableAsyncValueRef<GpuContext>(std::move(context));
+  auto host = CreateHostContext();
+
+  string_view data(kKernelPtx, sizeof(kKernelPtx));
+  std::vector<GpuModuleImage> images = {{1, data}, {2, data}};
+  auto chain = LoadModules(gpu_context.CopyRef(), images, host.get());
+
+  // Threads that need a module wait for the pending load, and all of them get
+  // the cached module.
+  std::vector<wrapper::Module> modules(4);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < modules.size(); ++i) {
+    threads.emplace_back([&, i] {
+      auto module = gpu_context->LoadModule(1 + i % 2, data);
+      if (module) modules[i] = *module;
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  host->Await(chain.CopyRCRef());
+  ASSERT_FALSE(chain.IsError());
+
+  TFRT_ASSERT_AND_ASSIGN(auto first, gpu_context->LoadModule(1, data));
+  TFRT_ASSERT_AND_ASSIGN(auto second, gpu_context->LoadModule(2, data));
+  EXPECT_NE(first, second);
+  for (size_t i = 0; i < modules.size(); ++i)
+    EXPECT_EQ(modules[i], i % 2 ? second : first);
+}
+
+TEST_P(GpuContextTest, LoadModulesError) {
+  ASSERT_TRUE(IsSuccess(Init(GetParam())));
+  TFRT_ASSERT_AND_ASSIGN(auto device, DeviceGet(GetParam(), 0));
+  TFRT_ASSERT_AND_ASSIGN(auto context, DevicePrimaryCtxRetain(device));
+  auto gpu_context = MakeAvailableAsyncValueRef<GpuContext>(std::move(context));
+  auto host = CreateHostContext();
+
+  // Not null-terminated.
+  std::vector<GpuModuleImage> images = {{1, "invalid"}};
+  auto chain = LoadModules(gpu_context.CopyRef(), images, host.get());
+  host->Await(chain.CopyRCRef());
+  EXPECT_TRUE(chain.IsError());
+}
+
+INSTANTIATE_TEST_SUITE_P(BaseTestCases, GpuContextTest,
+                         ::testing::Values(wrapper::Platform::CUDA));
+
+}  // namespace gpu
+}  // namespace tfrt
@@ -0,0 +1,78 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for AsyncGpuAllocator.
+#include "tfrt/gpu/memory/async_gpu_allocator.h"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/error_util.h"
+#include "tfrt/gpu/memory/gpu_buffer.h"
+#include "tfrt/gpu/wrapper/driver_wrapper.h"
+
+namespace tfrt {
+namespace gpu {
+
+class AsyncGpuAllocatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto platform = wrapper::Platform::CUDA;
+    ASSERT_TRUE(IsSuccess(wrapper::Init(platform)));
+    TFRT_ASSERT_AND_ASSIGN(auto device, wrapper::DeviceGet(platform, 0));
+    TFRT_ASSERT_AND_ASSIGN(context_, wrapper::DevicePrimaryCtxRetain(device));
+    TFRT_ASSERT_AND_ASSIGN(auto current,
+                           wrapper::CtxSetCurrent(context_.get()));
+    auto flags = wrapper::StreamFlags::DEFAULT;
+    TFRT_ASSERT_AND_ASSIGN(stream1_, wrapper::StreamCreate(current, flags));
+    TFRT_ASSERT_AND_ASSIGN(stream2_, wrapper::StreamCreate(current, flags));
+    TFRT_ASSERT_AND_ASSIGN(
+        allocator_,
+        AsyncGpuAllocator::Create(current, /*release_threshold=*/1 << 20));
+  }
+
+  wrapper::OwningContext context_;
+  wrapper::OwningStream stream1_, stream2_;
+  std::unique_ptr<AsyncGpuAllocator> allocator_;
+};
+
+TEST_F(AsyncGpuAllocatorTest, AllocatesOnStream) {
+  TFRT_ASSERT_AND_ASSIGN(auto buffer,
+                         allocator_->AllocateBuffer(1000, stream1_.get()));
+  EXPECT_TRUE(buffer->IsValid());
+  EXPECT_EQ(buffer->size(), 1000u);
+  EXPECT_EQ(buffer->stream(), stream1_.get());
+  auto address = reinterpret_cast<uintptr_t>(GetRawPointer<void>(*buffer));
+  EXPECT_EQ(address % GpuCrtAllocator::kAlignment, 0u);
+  TFRT_ASSERT_AND_ASSIGN(auto current, wrapper::CtxSetCurrent(context_.get()));
+  EXPECT_TRUE(IsSuccess(wrapper::MemsetD8Async(current, buffer->pointer(), 0,
+                                               1000, stream1_.get())));
+  buffer.reset();
+  EXPECT_TRUE(IsSuccess(wrapper::StreamSynchronize(stream1_.get())));
+}
+
+TEST_F(AsyncGpuAllocatorTest, FreesAfterUseOnOtherStream) {
+  TFRT_ASSERT_AND_ASSIGN(auto buffer,
+                         allocator_->AllocateBuffer(1 << 20, stream1_.get()));
+  TFRT_ASSERT_AND_ASSIGN(auto current, wrapper::CtxSetCurrent(context_.get()));
+  EXPECT_TRUE(IsSuccess(allocator_->RecordUsage(*buffer, stream2_.get())));
+  EXPECT_TRUE(IsSuccess(wrapper::MemsetD8Async(current, buffer->pointer(), 0,
+                                               1 << 20, stream2_.get())));
+  buffer.reset();
+  EXPECT_TRUE(IsSuccess(wrapper::StreamSynchronize(stream1_.get())));
+  EXPECT_TRUE(IsSuccess(wrapper::StreamSynchronize(stream2_.get())));
+}
+
+}  // namespace gpu
+}  // namespace tfrt
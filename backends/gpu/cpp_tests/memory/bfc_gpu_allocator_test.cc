@@ -0,0 +1,153 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test and benchmark for BfcGpuAllocator.
+#include "tfrt/gpu/memory/bfc_gpu_allocator.h"
+
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/error_util.h"
+#include "tfrt/gpu/memory/gpu_buffer.h"
+#include "tfrt/gpu/wrapper/driver_wrapper.h"
+
+namespace tfrt {
+namespace gpu {
+
+class BfcGpuAllocatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto platform = wrapper::Platform::CUDA;
+    ASSERT_TRUE(IsSuccess(wrapper::Init(platform)));
+    TFRT_ASSERT_AND_ASSIGN(auto device, wrapper::DeviceGet(platform, 0));
+    TFRT_ASSERT_AND_ASSIGN(context_, wrapper::DevicePrimaryCtxRetain(device));
+    TFRT_ASSERT_AND_ASSIGN(auto current,
+                           wrapper::CtxSetCurrent(context_.get()));
+    auto flags = wrapper::StreamFlags::DEFAULT;
+    TFRT_ASSERT_AND_ASSIGN(stream1_, wrapper::StreamCreate(current, flags));
+    TFRT_ASSERT_AND_ASSIGN(stream2_, wrapper::StreamCreate(current, flags));
+    allocator_ = std::make_unique<BfcGpuAllocator>(current);
+  }
+
+  RCReference<GpuCrtBuffer> Allocate(size_t size, wrapper::Stream stream) {
+    auto buffer = allocator_->AllocateBuffer(size, stream);
+    if (!buffer) {
+      ADD_FAILURE() << buffer.takeError();
+      return {};
+    }
+    return std::move(*buffer);
+  }
+
+  wrapper::OwningContext context_;
+  wrapper::OwningStream stream1_, stream2_;
+  std::unique_ptr<BfcGpuAllocator> allocator_;
+};
+
+TEST_F(BfcGpuAllocatorTest, ReusesMemoryOfSameStream) {
+  auto buffer = Allocate(1000, stream1_.get());
+  void* pointer = GetRawPointer<void>(*buffer);
+  buffer.reset();
+  buffer = Allocate(1024, stream1_.get());
+  EXPECT_EQ(GetRawPointer<void>(*buffer), pointer);
+  EXPECT_EQ(allocator_->GetStats().num_cross_stream_reuses, 0);
+}
+
+TEST_F(BfcGpuAllocatorTest, ReusesMemoryOfOtherStream) {
+  auto buffer = Allocate(1 << 20, stream1_.get());
+  void* pointer = GetRawPointer<void>(*buffer);
+  buffer.reset();
+  // The freed chunk is the best fit, but stream2 needs to wait for stream1.
+  buffer = Allocate(1 << 20, stream2_.get());
+  EXPECT_EQ(GetRawPointer<void>(*buffer), pointer);
+  EXPECT_EQ(allocator_->GetStats().num_cross_stream_reuses, 1);
+}
+
+TEST_F(BfcGpuAllocatorTest, TracksUsageAndFragmentation) {
+  auto buffer1 = Allocate(1 << 20, stream1_.get());
+  auto buffer2 = Allocate(1 << 20, stream1_.get());
+  auto buffer3 = Allocate(1 << 20, stream1_.get());
+  auto stats = allocator_->GetStats();
+  EXPECT_EQ(stats.bytes_in_use, 3 << 20);
+  EXPECT_EQ(stats.num_allocs, 3);
+
+  // Freeing the middle buffer leaves a hole.
+  buffer2.reset();
+  stats = allocator_->GetStats();
+  EXPECT_EQ(stats.bytes_in_use, 2 << 20);
+  EXPECT_EQ(stats.peak_bytes_in_use, 3 << 20);
+  EXPECT_GT(stats.fragmentation(), 0.0);
+
+  // Freed chunks are coalesced with their neighbors on the same stream.
+  void* pointer = GetRawPointer<void>(*buffer1);
+  buffer1.reset();
+  buffer3.reset();
+  EXPECT_EQ(allocator_->GetStats().bytes_in_use, 0);
+  buffer1 = Allocate(3 << 20, stream1_.get());
+  EXPECT_EQ(GetRawPointer<void>(*buffer1), pointer);
+  EXPECT_EQ(allocator_->GetStats().num_cross_stream_reuses, 0);
+}
+
+TEST_F(BfcGpuAllocatorTest, CoalescesAcrossStreamsWhenOutOfMemory) {
+  size_t limit = allocator_->GetStats().bytes_limit;
+  size_t size = limit / 4 * 3 / 256 * 256;
+  Allocate(size, stream1_.get()).reset();
+  // Neither the memory freed on stream1 nor the rest fits on its own.
+  auto buffer = Allocate(size + 256, stream2_.get());
+  ASSERT_TRUE(buffer);
+  // The coalesced chunk is too small to split.
+  EXPECT_EQ(allocator_->GetStats().bytes_in_use, limit);
+}
+
+// Replays a trace of allocations of random sizes between 256B and 4MB on
+// state.range(0) streams, with up to 256 live buffers.
+static void BM_AllocationTrace(benchmark::State& state) {
+  auto platform = wrapper::Platform::CUDA;
+  llvm::ExitOnError die_if_error;
+  die_if_error(wrapper::Init(platform));
+  auto device = die_if_error(wrapper::DeviceGet(platform, 0));
+  auto context = die_if_error(wrapper::DevicePrimaryCtxRetain(device));
+  auto current = die_if_error(wrapper::CtxSetCurrent(context.get()));
+  std::vector<wrapper::OwningStream> streams;
+  for (int i = 0; i < state.range(0); ++i) {
+    streams.push_back(die_if_error(
+        wrapper::StreamCreate(current, wrapper::StreamFlags::DEFAULT)));
+  }
+  BfcGpuAllocator allocator(current);
+
+  std::mt19937 engine(/*seed=*/42);
+  std::uniform_int_distribution<int> log_size(8, 22);
+  std::uniform_int_distribution<size_t> index(0, 255);
+  std::vector<RCReference<GpuCrtBuffer>> buffers(256);
+
+  for (auto _ : state) {
+    size_t size = engine() % (size_t{1} << log_size(engine)) + 1;
+    auto& stream = streams[engine() % streams.size()];
+    buffers[index(engine)] =
+        die_if_error(allocator.AllocateBuffer(size, stream.get()));
+    buffers[index(engine)].reset();
+  }
+  buffers.clear();
+
+  state.SetItemsProcessed(state.iterations());
+  auto stats = allocator.GetStats();
+  state.counters["cross_stream_reuses"] = stats.num_cross_stream_reuses;
+  state.counters["peak_MB"] = stats.peak_bytes_in_use >> 20;
+}
+
+BENCHMARK(BM_AllocationTrace)->Arg(1)->Arg(4);
+
+}  // namespace gpu
+}  // namespace tfrt
@@ -22,6 +22,7 @@
 #include "llvm/Support/raw_os_ostream.h"
 #include "tfrt/cpp_tests/error_util.h"
 #include "tfrt/gpu/gpu_types.h"
+#include "tfrt/gpu/memory/gpu_buffer.h"
 #include "tfrt/gpu/wrapper/driver_wrapper.h"
 
 namespace tfrt {
@@ -51,6 +52,39 @@ TEST_P(GpuBufferTest, Basic) {
   stream.reset();  // Destroy `stream` before `gpu_context`.
 }
 
+TEST(GpuCrtBufferTest, SubBuffer) {
+  // Sub-buffers only do pointer arithmetic, so host memory stands in for GPU
+  // memory.
+  char data[64];
+  int num_deallocations = 0;
+  auto buffer = TakeRef(new GpuCrtBuffer(
+      wrapper::Pointer<void>(data, wrapper::Platform::CUDA), sizeof(data),
+      [&](GpuCrtBuffer*) { ++num_deallocations; }));
+
+  TFRT_ASSERT_AND_ASSIGN(
+      auto sub_buffer, GpuCrtBuffer::CreateSubBuffer(buffer.CopyRef(), 16, 32));
+  EXPECT_EQ(GetRawPointer<char>(*sub_buffer), data + 16);
+  EXPECT_EQ(sub_buffer->size(), 32);
+  EXPECT_EQ(&sub_buffer->owner(), buffer.get());
+  EXPECT_EQ(sub_buffer->allocator(), nullptr);
+
+  // Sub-buffers of sub-buffers refer to the owner directly.
+  TFRT_ASSERT_AND_ASSIGN(
+      auto nested, GpuCrtBuffer::CreateSubBuffer(sub_buffer.CopyRef(), 8, 8));
+  EXPECT_EQ(GetRawPointer<char>(*nested), data + 24);
+  EXPECT_EQ(&nested->owner(), buffer.get());
+
+  EXPECT_FALSE(GpuCrtBuffer::CreateSubBuffer(buffer.CopyRef(), 48, 32));
+  EXPECT_FALSE(GpuCrtBuffer::CreateSubBuffer(buffer.CopyRef(), 65, 0));
+
+  // The memory is deallocated once the buffer and all sub-buffers are gone.
+  buffer.reset();
+  sub_buffer.reset();
+  EXPECT_EQ(num_deallocations, 0);
+  nested.reset();
+  EXPECT_EQ(num_deallocations, 1);
+}
+
 INSTANTIATE_TEST_SUITE_P(BaseTestCases, GpuBufferTest,
                          ::testing::Values(wrapper::Platform::CUDA));
 
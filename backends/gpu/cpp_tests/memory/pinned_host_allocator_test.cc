@@ -0,0 +1,53 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for PinnedHostAllocator.
+#include "tfrt/gpu/memory/pinned_host_allocator.h"
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/error_util.h"
+#include "tfrt/gpu/wrapper/driver_wrapper.h"
+
+namespace tfrt {
+namespace gpu {
+
+class PinnedHostAllocatorTest
+    : public ::testing::TestWithParam<wrapper::Platform> {};
+
+TEST_P(PinnedHostAllocatorTest, ReusesFreedBlocks) {
+  ASSERT_TRUE(IsSuccess(Init(GetParam())));
+  TFRT_ASSERT_AND_ASSIGN(auto device, DeviceGet(GetParam(), 0));
+  TFRT_ASSERT_AND_ASSIGN(auto context, DevicePrimaryCtxRetain(device));
+
+  PinnedHostAllocator allocator(context.get());
+  void* ptr = allocator.AllocateBytes(1000, 16);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_TRUE(allocator.Contains(ptr, 1000));
+  EXPECT_TRUE(allocator.Contains(static_cast<char*>(ptr) + 10, 990));
+  int on_stack = 0;
+  EXPECT_FALSE(allocator.Contains(&on_stack, sizeof(on_stack)));
+
+  // Allocations of the same size class reuse the freed block.
+  allocator.DeallocateBytes(ptr, 1000);
+  EXPECT_FALSE(allocator.Contains(ptr, 1000));
+  void* reused = allocator.AllocateBytes(1024, 16);
+  EXPECT_EQ(reused, ptr);
+  allocator.DeallocateBytes(reused, 1024);
+}
+
+INSTANTIATE_TEST_SUITE_P(BaseTestCases, PinnedHostAllocatorTest,
+                         ::testing::Values(wrapper::Platform::CUDA));
+
+}  // namespace gpu
+}  // namespace tfrt
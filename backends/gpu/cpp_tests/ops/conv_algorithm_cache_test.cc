@@ -0,0 +1,79 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for ConvolutionAlgorithmCache.
+#include "tfrt/gpu/ops/tf/conv_algorithm_cache.h"
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tfrt {
+namespace gpu {
+
+class ConvolutionAlgorithmCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("conv_algorithms", "txt",
+                                                    path_));
+    // Start without a file, as if nothing has been tuned yet.
+    llvm::sys::fs::remove(path_);
+  }
+  void TearDown() override { llvm::sys::fs::remove(path_); }
+
+  llvm::SmallString<128> path_;
+};
+
+TEST_F(ConvolutionAlgorithmCacheTest, InMemory) {
+  ConvolutionAlgorithmCache cache("");
+  EXPECT_FALSE(cache.Find("key"));
+  cache.Insert("key", {1, 1024, 2});
+  auto algorithm = cache.Find("key");
+  ASSERT_TRUE(algorithm);
+  EXPECT_EQ(algorithm->algo, 1);
+  EXPECT_EQ(algorithm->workspace_size_bytes, 1024u);
+  EXPECT_EQ(algorithm->math_type, 2);
+}
+
+TEST_F(ConvolutionAlgorithmCacheTest, SharesEntriesThroughFile) {
+  ConvolutionAlgorithmCache(path_.str().str()).Insert("a key", {1, 1024, 2});
+  {
+    ConvolutionAlgorithmCache other(path_.str().str());
+    ASSERT_TRUE(other.Find("a key"));
+    other.Insert("a key", {3, 0, 0});
+  }
+  ConvolutionAlgorithmCache cache(path_.str().str());
+  auto algorithm = cache.Find("a key");
+  ASSERT_TRUE(algorithm);
+  // The last entry wins.
+  EXPECT_EQ(algorithm->algo, 3);
+  EXPECT_EQ(algorithm->workspace_size_bytes, 0u);
+}
+
+TEST_F(ConvolutionAlgorithmCacheTest, IgnoresMalformedLines) {
+  {
+    std::error_code error_code;
+    llvm::raw_fd_ostream os(path_, error_code);
+    ASSERT_FALSE(error_code);
+    os << "garbage\n1 2 3 good\n4 5\n";
+  }
+  ConvolutionAlgorithmCache cache(path_.str().str());
+  ASSERT_TRUE(cache.Find("good"));
+  EXPECT_EQ(cache.Find("good")->workspace_size_bytes, 2u);
+  EXPECT_FALSE(cache.Find("garbage"));
+}
+
+}  // namespace gpu
+}  // namespace tfrt
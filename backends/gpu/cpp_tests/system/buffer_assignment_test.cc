@@ -0,0 +1,65 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for AssignBuffers.
+#include "tfrt/gpu/system/buffer_assignment.h"
+
+#include "gtest/gtest.h"
+
+namespace tfrt {
+namespace gpu {
+
+TEST(BufferAssignmentTest, Empty) {
+  auto assignment = AssignBuffers({}, 256);
+  EXPECT_TRUE(assignment.offsets.empty());
+  EXPECT_EQ(assignment.arena_size, 0u);
+}
+
+TEST(BufferAssignmentTest, OverlappingLiveRanges) {
+  auto assignment = AssignBuffers({{100, 0, 1}, {200, 1, 2}}, 256);
+  // The larger buffer is placed first.
+  EXPECT_EQ(assignment.offsets[0], 256u);
+  EXPECT_EQ(assignment.offsets[1], 0u);
+  EXPECT_EQ(assignment.arena_size, 356u);
+}
+
+TEST(BufferAssignmentTest, ReusesMemoryOfDeadBuffers) {
+  auto assignment = AssignBuffers({{100, 0, 1}, {200, 2, 3}}, 256);
+  EXPECT_EQ(assignment.offsets[0], 0u);
+  EXPECT_EQ(assignment.offsets[1], 0u);
+  EXPECT_EQ(assignment.arena_size, 200u);
+}
+
+TEST(BufferAssignmentTest, FillsGapsOfDeadBuffers) {
+  // Buffer 1 dies before buffers 3 and 4 are born, which leaves a gap between
+  // buffers 0 and 2.
+  auto assignment = AssignBuffers(
+      {{1024, 0, 9}, {1000, 0, 4}, {600, 0, 9}, {300, 5, 9}, {100, 5, 9}},
+      256);
+  EXPECT_EQ(assignment.offsets[0], 0u);
+  EXPECT_EQ(assignment.offsets[1], 1024u);
+  EXPECT_EQ(assignment.offsets[2], 2048u);
+  EXPECT_EQ(assignment.offsets[3], 1024u);
+  EXPECT_EQ(assignment.offsets[4], 1536u);
+  EXPECT_EQ(assignment.arena_size, 2648u);
+}
+
+TEST(BufferAssignmentTest, IgnoresEmptyBuffers) {
+  auto assignment = AssignBuffers({{0, 0, 9}, {100, 0, 9}}, 256);
+  EXPECT_EQ(assignment.offsets[1], 0u);
+  EXPECT_EQ(assignment.arena_size, 100u);
+}
+
+}  // namespace gpu
+}  // namespace tfrt
@@ -636,6 +636,54 @@ TEST_F(Test, TestEventsCUDA) {
   EXPECT_EQ(result, desired);
 }
 
+TEST_F(Test, TestGraphCUDA) {
+  auto platform = Platform::CUDA;
+  ASSERT_TRUE(IsSuccess(Init(platform)));
+  TFRT_ASSERT_AND_ASSIGN(auto device, DeviceGet(platform, 0));
+  TFRT_ASSERT_AND_ASSIGN(auto context, CtxCreate(CtxFlags::SCHED_AUTO, device));
+  TFRT_ASSERT_AND_ASSIGN(auto current, CtxGetCurrent());
+  TFRT_ASSERT_AND_ASSIGN(auto stream,
+                         StreamCreate(current, StreamFlags::NON_BLOCKING));
+  TFRT_ASSERT_AND_ASSIGN(auto dst, MemAlloc<int>(current, 1));
+
+  auto capture_memset = [&](int value) -> llvm::Expected<OwningGraph> {
+    if (auto error = StreamBeginCapture(stream.get(),
+                                        StreamCaptureMode::THREAD_LOCAL))
+      return std::move(error);
+    if (auto error = MemsetD32Async(current, dst.get(), value, /*count=*/1,
+                                    stream.get()))
+      return std::move(error);
+    return StreamEndCapture(stream.get());
+  };
+  auto launch_and_read = [&](GraphExec graph_exec) -> llvm::Expected<int> {
+    if (auto error = GraphLaunch(graph_exec, stream.get()))
+      return std::move(error);
+    if (auto error = StreamSynchronize(stream.get())) return std::move(error);
+    int result = 0;
+    if (auto error = Memcpy(current, {&result, platform}, dst.get(),
+                            sizeof(int)))
+      return std::move(error);
+    return result;
+  };
+
+  TFRT_ASSERT_AND_ASSIGN(auto graph, capture_memset(42));
+  // Captured work is not executed.
+  TFRT_ASSERT_AND_ASSIGN(bool stream_ready, StreamQuery(stream.get()));
+  EXPECT_TRUE(stream_ready);
+  TFRT_ASSERT_AND_ASSIGN(auto graph_exec,
+                         GraphInstantiate(current, graph.get()));
+  TFRT_ASSERT_AND_ASSIGN(int result, launch_and_read(graph_exec.get()));
+  EXPECT_EQ(result, 42);
+
+  // Graphs with the same topology update the instantiated graph in place.
+  TFRT_ASSERT_AND_ASSIGN(graph, capture_memset(7));
+  TFRT_ASSERT_AND_ASSIGN(bool updated,
+                         GraphExecUpdate(graph_exec.get(), graph.get()));
+  EXPECT_TRUE(updated);
+  TFRT_ASSERT_AND_ASSIGN(result, launch_and_read(graph_exec.get()));
+  EXPECT_EQ(result, 7);
+}
+
 TEST_P(Test, UnalignedPointeeType) {
   auto platform = GetParam();
   Pointer<const char>(reinterpret_cast<const char*>(0x1), platform);
@@ -32,16 +32,32 @@ class GpuDevice;
 
 namespace tfrt {
 namespace gpu {
+
+// Precision policy for the compute-bound ops (MatMul and Conv2D). Other ops,
+// in particular reductions and softmax, always run in the precision of their
+// operands.
+enum class MixedPrecision {
+  // Run all ops in the precision of their operands.
+  kNone,
+  // Run F32 ops with F16 operands on tensor cores, accumulating in F32. The
+  // results are F32.
+  kFloat16,
+};
+
 class GpuDispatchContext {
  public:
-  explicit GpuDispatchContext(const GpuDevice* device)
+  // Dispatches on the compute stream of `device` for `stream_id`.
+  explicit GpuDispatchContext(
+      const GpuDevice* device, int stream_id = 0,
+      MixedPrecision mixed_precision = MixedPrecision::kNone)
       : device_(device),
-        stream_(device->stream()),
+        stream_(device->stream(stream_id)),
         allocator_(device->allocator()),
-        eigen_gpu_device_(device->eigen_gpu_device()),
-        blas_handle_(device->blas_handle()),
-        dnn_handle_(device->dnn_handle()),
-        current_context_(std::move(device->CreateContext())) {}
+        eigen_gpu_device_(device->eigen_gpu_device(stream_id)),
+        blas_handle_(device->blas_handle(stream_id)),
+        dnn_handle_(device->dnn_handle(stream_id)),
+        current_context_(std::move(device->CreateContext())),
+        mixed_precision_(mixed_precision) {}
 
   // The inputs to the GPU dispatch function are available for reading on this
   // stream.  The outputs from the dispatch must also be ready for reading on
@@ -67,6 +83,8 @@ class GpuDispatchContext {
 
   const GpuDevice& device() const { return *device_; }
 
+  MixedPrecision mixed_precision() const { return mixed_precision_; }
+
  private:
   const GpuDevice* device_;
   wrapper::Stream stream_;
@@ -75,6 +93,7 @@ class GpuDispatchContext {
   wrapper::BlasHandle blas_handle_;
   wrapper::DnnHandle dnn_handle_;
   wrapper::CurrentContext current_context_;
+  MixedPrecision mixed_precision_;
 };
 }  // namespace gpu
 }  // namespace tfrt
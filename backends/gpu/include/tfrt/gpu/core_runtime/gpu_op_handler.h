@@ -28,10 +28,21 @@
 namespace tfrt {
 namespace gpu {
 class GpuDevice;
+enum class MixedPrecision;
 
+// `mixed_precision` is the precision policy of the ops dispatched by the op
+// handler (see MixedPrecision). Create separate op handlers for models which
+// need different policies.
 llvm::Expected<OpHandler*> CreateGpuOpHandler(CoreRuntime* runtime,
                                               RCReference<GpuDevice> device,
                                               OpHandler* fallback);
+llvm::Expected<OpHandler*> CreateGpuOpHandler(CoreRuntime* runtime,
+                                              RCReference<GpuDevice> device,
+                                              OpHandler* fallback,
+                                              MixedPrecision mixed_precision);
+
+// Parses "none" or "f16".
+llvm::Expected<MixedPrecision> ParseMixedPrecision(string_view name);
 }  // namespace gpu
 }  // namespace tfrt
 
@@ -33,6 +33,15 @@ namespace tfrt {
 namespace gpu {
 class GpuCrtAllocator;
 
+// GpuDevice owns a pool of streams: compute streams, which run the GPU ops,
+// and dedicated streams for host to device and device to host copies, so that
+// transfers overlap compute. Ops are assigned to compute streams by the stream
+// id of the ExecutionContext (see compiler::StreamAnalysis), so independent ops
+// run concurrently. Each compute stream has its own Eigen device and BLAS and
+// DNN handles.
+//
+// Buffers are allocated on the stream that produces them. Consumers on other
+// streams call WaitForBuffer() before using a buffer.
 class GpuDevice : public Device, public DeviceTraits<GpuDevice> {
  public:
   static const char* type_name() {
@@ -40,26 +49,46 @@ class GpuDevice : public Device, public DeviceTraits<GpuDevice> {
     return kName;
   }
 
-  explicit GpuDevice(string_view name, int gpu_ordinal);
+  // Uses `num_compute_streams` compute streams, unless the device uses the
+  // external GPU resources (see GpuResources), which only provide one stream
+  // for all the work.
+  explicit GpuDevice(string_view name, int gpu_ordinal,
+                     int num_compute_streams = GetNumComputeStreamsFromEnv());
+
+  // Returns the number of compute streams set by the
+  // TFRT_GPU_NUM_COMPUTE_STREAMS environment variable, or 2 by default.
+  static int GetNumComputeStreamsFromEnv();
 
   llvm::Error Initialize();
 
+  int num_compute_streams() const;
+
   // The inputs to the GPU dispatch function are available for reading on this
   // stream.  The outputs from the dispatch must also be ready for reading on
-  // this stream.
-  wrapper::Stream stream() const;
+  // this stream. Stream ids are mapped to the compute streams round-robin.
+  wrapper::Stream stream(int stream_id = 0) const;
+
+  // Streams for the host to device and device to host copies.
+  wrapper::Stream h2d_stream() const;
+  wrapper::Stream d2h_stream() const;
 
   // Allocator for allocating GPU device memory.
   gpu::GpuCrtAllocator* allocator() const;
 
   // Eigen GPU device. Used to launch Eigen kernels.
-  Eigen::GpuDevice* eigen_gpu_device() const;
+  Eigen::GpuDevice* eigen_gpu_device(int stream_id = 0) const;
 
   // GPU BLAS library handle. Used to launch BLAS routines.
-  wrapper::BlasHandle blas_handle() const;
+  wrapper::BlasHandle blas_handle(int stream_id = 0) const;
 
   // GPU DNN library handle. Used to launch convolutions etc.
-  wrapper::DnnHandle dnn_handle() const;
+  wrapper::DnnHandle dnn_handle(int stream_id = 0) const;
+
+  // Makes `stream` wait for the work enqueued so far on the stream of
+  // `buffer`, which produced its content, and lets the allocator know that the
+  // buffer is used on `stream`.
+  llvm::Error WaitForBuffer(const GpuCrtBuffer& buffer,
+                            wrapper::Stream stream) const;
 
   // Create a current context. It is usually called inside the dispatch
   // function. See the documentation for wrapper::CurrentContext for more
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares GpuDeviceGroup which runs collectives across GpuDevices.
+
+#ifndef TFRT_GPU_DEVICE_DEVICE_GROUP_H_
+#define TFRT_GPU_DEVICE_DEVICE_GROUP_H_
+
+#include <memory>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "tfrt/gpu/device/device.h"
+#include "tfrt/gpu/memory/gpu_buffer.h"
+#include "tfrt/gpu/wrapper/ccl_wrapper.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+
+namespace tfrt {
+namespace gpu {
+
+// GpuDeviceGroup runs data-parallel collectives across a set of GpuDevices,
+// with one rank per device. Each device has a NCCL (or RCCL) communicator and
+// a dedicated stream for the collectives, so that communication overlaps with
+// the compute streams of the device.
+//
+// A collective takes one input and one output buffer per rank. It waits for
+// the streams that produced the buffers (see GpuDevice::WaitForBuffer()), and
+// the streams of the output buffers wait for the collective in turn. The
+// collectives of all ranks are enqueued from the calling thread as one NCCL
+// group.
+class GpuDeviceGroup {
+ public:
+  // Creates the communicators of `devices`, which are ranked in order. The
+  // devices need to be initialized.
+  static llvm::Expected<std::unique_ptr<GpuDeviceGroup>> Create(
+      ArrayRef<RCReference<GpuDevice>> devices);
+
+  ~GpuDeviceGroup();
+
+  int size() const { return ranks_.size(); }
+  const GpuDevice& device(int rank) const { return *ranks_[rank].device; }
+
+  // The stream and communicator that run the collectives of `rank`.
+  wrapper::Stream stream(int rank) const { return ranks_[rank].stream.get(); }
+  wrapper::CclComm comm(int rank) const { return ranks_[rank].comm.get(); }
+
+  llvm::Error AllReduce(ArrayRef<const GpuCrtBuffer*> inputs,
+                        ArrayRef<const GpuCrtBuffer*> outputs,
+                        ncclDataType_t data_type, ncclRedOp_t reduction_op);
+  llvm::Error AllGather(ArrayRef<const GpuCrtBuffer*> inputs,
+                        ArrayRef<const GpuCrtBuffer*> outputs,
+                        ncclDataType_t data_type);
+  llvm::Error ReduceScatter(ArrayRef<const GpuCrtBuffer*> inputs,
+                            ArrayRef<const GpuCrtBuffer*> outputs,
+                            ncclDataType_t data_type,
+                            ncclRedOp_t reduction_op);
+  // The input buffers of ranks other than `root` are ignored and may be null.
+  llvm::Error Broadcast(ArrayRef<const GpuCrtBuffer*> inputs,
+                        ArrayRef<const GpuCrtBuffer*> outputs,
+                        ncclDataType_t data_type, int root);
+
+ private:
+  struct Rank {
+    RCReference<GpuDevice> device;
+    wrapper::OwningStream stream;
+    wrapper::OwningEvent event;
+    wrapper::OwningCclComm comm;
+  };
+
+  explicit GpuDeviceGroup(std::vector<Rank> ranks);
+
+  // Synchronizes the buffers with the collective streams and calls `enqueue`
+  // for each rank within one NCCL group.
+  llvm::Error Run(
+      ArrayRef<const GpuCrtBuffer*> inputs,
+      ArrayRef<const GpuCrtBuffer*> outputs,
+      llvm::function_ref<llvm::Error(int rank, wrapper::CurrentContext current)>
+          enqueue);
+
+  // NB! The communicators are destroyed before the streams they run on.
+  std::vector<Rank> ranks_;
+  // Serializes the collectives, which need to be enqueued in the same order on
+  // all ranks.
+  mutex mu_;
+};
+
+}  // namespace gpu
+}  // namespace tfrt
+
+#endif  // TFRT_GPU_DEVICE_DEVICE_GROUP_H_
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares EventManager, which runs host callbacks when GPU events
+// complete.
+
+#ifndef TFRT_GPU_DEVICE_EVENT_MANAGER_H_
+#define TFRT_GPU_DEVICE_EVENT_MANAGER_H_
+
+#include <memory>
+#include <vector>
+
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/Support/Error.h"
+#include "tfrt/gpu/wrapper/driver_wrapper.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/support/thread_environment.h"
+
+namespace tfrt {
+class Chain;
+class HostContext;
+
+namespace gpu {
+
+// EventManager waits for the GPU events of one context on a single poller
+// thread, and runs the callbacks of the completed events on the host work
+// queue. Waiting for a device to host copy therefore does not tie up a
+// blocking work queue thread (with EventSynchronize) per event.
+//
+// Event managers are created on first use, and live until the process exits.
+class EventManager {
+ public:
+  using Callback = llvm::unique_function<void(llvm::Error)>;
+
+  // Returns the event manager of the `context`.
+  static EventManager& Get(wrapper::Context context);
+
+  ~EventManager();
+
+  // Calls `callback` on the `host` work queue when `event` has completed, or
+  // with an error if the event could not be queried. The event must be
+  // recorded on a stream, and it must stay alive until the callback is called
+  // (usually the callback owns it).
+  void Then(wrapper::Event event, HostContext* host, Callback callback);
+
+  // Returns a chain that becomes available when `event` has completed. The
+  // event is destroyed after it has completed.
+  AsyncValueRef<Chain> Then(wrapper::OwningEvent event, HostContext* host);
+
+ private:
+  struct PendingEvent {
+    wrapper::Event event;
+    HostContext* host;
+    Callback callback;
+  };
+
+  EventManager();
+
+  // Polls the pending events until the event manager is destroyed.
+  void PollEvents();
+
+  mutex mu_;
+  condition_variable cv_;
+  // Events added since the last poll.
+  std::vector<PendingEvent> pending_ TFRT_GUARDED_BY(mu_);
+  bool shutdown_ TFRT_GUARDED_BY(mu_) = false;
+
+  std::unique_ptr<ThreadingEnvironment::Thread> poller_;
+};
+
+}  // namespace gpu
+}  // namespace tfrt
+
+#endif  // TFRT_GPU_DEVICE_EVENT_MANAGER_H_
@@ -18,6 +18,9 @@
 #ifndef TFRT_GPU_DEVICE_GPU_CONFIG_H_
 #define TFRT_GPU_DEVICE_GPU_CONFIG_H_
 
+#include <cstdint>
+#include <functional>
+
 #include "tfrt/gpu/memory/gpu_allocator.h"
 #include "tfrt/gpu/wrapper/driver_wrapper.h"
 
@@ -41,6 +44,13 @@ void SetTfrtGpuResources(wrapper::Device device, GpuResources resources);
 
 llvm::Optional<GpuResources> GetTfrtGpuResources(wrapper::Device device);
 
+// Returns a factory for stream-ordered allocators (see AsyncGpuAllocator).
+// The memory pool returns cached memory in excess of `release_threshold` bytes
+// to the system when a stream is synchronized. Falls back to BfcGpuAllocator
+// on devices which do not support memory pools.
+GpuAllocatorFactory CreateAsyncGpuAllocatorFactory(
+    uint64_t release_threshold = UINT64_MAX);
+
 }  // namespace gpu
 }  // namespace tfrt
 #endif  // TFRT_GPU_DEVICE_GPU_CONFIG_H_
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares GpuTracingScope, which records the device time of GPU
+// work in the tracing sink.
+
+#ifndef TFRT_GPU_DEVICE_GPU_TRACING_H_
+#define TFRT_GPU_DEVICE_GPU_TRACING_H_
+
+#include <memory>
+
+#include "tfrt/gpu/wrapper/driver_wrapper.h"
+#include "tfrt/tracing/tracing.h"
+
+namespace tfrt {
+class HostContext;
+
+namespace gpu {
+
+// Traces the device time of the work that is enqueued on a stream while the
+// scope is alive, e.g. the kernels of a GPU op or a memcpy.
+//
+// If tracing is enabled at the Default level, the scope records timing events
+// on the stream when it is created and destroyed. Once the work has completed,
+// the device time between the events is recorded in the tracing sink as an
+// activity on the track `track`, e.g. of the device stream. The activity is
+// connected by a new flow to the enclosing scope of the host thread, which
+// shows when the work was enqueued.
+//
+// Device timestamps are converted to host time with an event that is
+// synchronized once per context, when the first scope of the context is
+// traced.
+class GpuTracingScope {
+ public:
+  GpuTracingScope(wrapper::CurrentContext current, wrapper::Stream stream,
+                  HostContext* host, tracing::TracingSink::NameGenerator name,
+                  tracing::TracingSink::NameGenerator track);
+  ~GpuTracingScope();
+
+  GpuTracingScope(const GpuTracingScope&) = delete;
+  GpuTracingScope& operator=(const GpuTracingScope&) = delete;
+
+ private:
+  struct Activity;
+
+  // Records the completed `activity` in the tracing sink.
+  static llvm::Error RecordActivity(Activity& activity);
+
+  // Set if the scope is traced.
+  std::unique_ptr<Activity> activity_;
+};
+
+}  // namespace gpu
+}  // namespace tfrt
+
+#endif  // TFRT_GPU_DEVICE_GPU_TRACING_H_
@@ -26,6 +26,7 @@
 
 #include "llvm/ADT/DenseMap.h"
 #include "tfrt/gpu/wrapper/blas_wrapper.h"
+#include "tfrt/gpu/wrapper/ccl_wrapper.h"
 #include "tfrt/gpu/wrapper/dnn_wrapper.h"
 #include "tfrt/gpu/wrapper/driver_wrapper.h"
 #include "tfrt/gpu/wrapper/solver_wrapper.h"
@@ -34,6 +35,8 @@
 #include "tfrt/support/ref_count.h"
 
 namespace tfrt {
+class Chain;
+
 namespace gpu {
 
 // Types that do not need a wrapper class go here.
@@ -55,13 +58,41 @@ class GpuContext {
 
   // Load module from binary 'data' blob and return a (non-owning) reference to
   // the module. The 'key' needs to be uniquely identify the `data` payload.
+  //
+  // The modules are cached per context and shared by all its streams. This
+  // method is thread-safe: modules with different keys load concurrently, and
+  // a call for a module that is being loaded by another thread (e.g. by
+  // LoadModules() below) waits for it instead of loading it again.
   Expected<wrapper::Module> LoadModule(uint64_t key, string_view data);
 
  private:
+  struct ModuleCache;
+
   wrapper::OwningContext context_;
-  llvm::DenseMap<uint64_t, wrapper::OwningModule> modules_;
+  std::unique_ptr<ModuleCache> module_cache_;
 };
 
+// A module embedded in a BEF file, i.e. the attributes of a
+// tfrt_gpu.module.load kernel.
+struct GpuModuleImage {
+  uint64_t key;
+  // Null-terminated cubin, hsaco or PTX.
+  string_view data;
+};
+
+// Loads `images` into `context` concurrently, each in blocking work of `host`,
+// so that the tfrt_gpu.module.load kernels find the modules in the cache
+// instead of loading them one after the other on first execution. PTX is
+// compiled by the driver, which stores the result in its compilation cache
+// (see CUDA_CACHE_PATH), so later processes skip the JIT as well.
+//
+// The returned chain is ready when all modules are loaded, or has the error
+// of a module that failed to load. The data of `images` needs to stay alive
+// until then.
+AsyncValueRef<Chain> LoadModules(AsyncValueRef<GpuContext> context,
+                                 ArrayRef<GpuModuleImage> images,
+                                 HostContext* host);
+
 class GpuStream {
  public:
   explicit GpuStream(AsyncValueRef<GpuContext> context,
@@ -113,6 +144,7 @@ class GpuEvent {
 
   const wrapper::OwningEvent& operator->() const { return event_; }
   wrapper::Event get() const { return event_.get(); }
+  wrapper::Context context() const { return context_->get(); }
 
  private:
   AsyncValueRef<GpuContext> context_;
@@ -308,6 +340,25 @@ class GpuSolverHandle {
   wrapper::OwningSolverHandle handle_;
 };
 
+class GpuCclHandle {
+ public:
+  explicit GpuCclHandle(AsyncValueRef<GpuContext> context,
+                        wrapper::OwningCclComm comm);
+  ~GpuCclHandle();
+
+  GpuCclHandle(GpuCclHandle&&) = default;
+  GpuCclHandle& operator=(GpuCclHandle&&) = default;
+
+  const wrapper::OwningCclComm& operator->() const { return comm_; }
+  wrapper::CclComm get() const { return comm_.get(); }
+
+  wrapper::Context context() const { return context_->get(); }
+
+ private:
+  AsyncValueRef<GpuContext> context_;
+  wrapper::OwningCclComm comm_;
+};
+
 }  // namespace gpu
 }  // namespace tfrt
 
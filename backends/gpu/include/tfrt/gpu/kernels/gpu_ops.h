@@ -22,12 +22,15 @@
 #ifndef TFRT_GPU_KERNELS_CUDA_OPDEFS_GPU_OPS_H_
 #define TFRT_GPU_KERNELS_CUDA_OPDEFS_GPU_OPS_H_
 
+#include <type_traits>
+
 #include "mlir/Dialect/GPU/GPUDialect.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Dialect.h"
 #include "mlir/IR/OpDefinition.h"
 #include "tfrt/basic_kernels/opdefs/basic_kernels.h"
 #include "tfrt/gpu/wrapper/blas_wrapper.h"
+#include "tfrt/gpu/wrapper/ccl_wrapper.h"
 #include "tfrt/gpu/wrapper/dnn_wrapper.h"
 #include "tfrt/gpu/wrapper/wrapper.h"
 #include "tfrt/tensor/opdefs/host_tensor.h"
@@ -69,26 +72,32 @@ class EnumAttr : public Attribute {
   }
 
  private:
-  static int ToOpaqueValue(T value) { return value.ToOpaqueValue(); }
-  static T FromOpaqueValue(int opaque) { return T::FromOpaqueValue(opaque); }
+  // Plain enums are stored as is, wrapper::Enums in their opaque encoding.
+  template <typename U = T, std::enable_if_t<std::is_enum<U>::value, int> = 0>
+  static int ToOpaqueValue(T value) {
+    return static_cast<int>(value);
+  }
+  template <typename U = T, std::enable_if_t<!std::is_enum<U>::value, int> = 0>
+  static int ToOpaqueValue(T value) {
+    return value.ToOpaqueValue();
+  }
+  template <typename U = T, std::enable_if_t<std::is_enum<U>::value, int> = 0>
+  static T FromOpaqueValue(int opaque) {
+    return static_cast<T>(opaque);
+  }
+  template <typename U = T, std::enable_if_t<!std::is_enum<U>::value, int> = 0>
+  static T FromOpaqueValue(int opaque) {
+    return T::FromOpaqueValue(opaque);
+  }
 };
 
-// wrapper::Platform specialization. If there are more, SFINAE on std::is_enum.
-template <>
-inline int EnumAttr<wrapper::Platform>::ToOpaqueValue(wrapper::Platform value) {
-  return static_cast<int>(value);
-}
-template <>
-inline wrapper::Platform EnumAttr<wrapper::Platform>::FromOpaqueValue(
-    int opaque) {
-  return static_cast<wrapper::Platform>(opaque);
-}
-
 using PlatformAttr = EnumAttr<wrapper::Platform>;
 using DnnDataTypeAttr = EnumAttr<wrapper::DnnDataType>;
 using BlasDataTypeAttr = EnumAttr<wrapper::BlasDataType>;
 using BlasOperationAttr = EnumAttr<wrapper::BlasOperation>;
 using BlasGemmAlgoAttr = EnumAttr<wrapper::BlasGemmAlgo>;
+using CclDataTypeAttr = EnumAttr<ncclDataType_t>;
+using CclReductionOpAttr = EnumAttr<ncclRedOp_t>;
 
 namespace conversion {
 
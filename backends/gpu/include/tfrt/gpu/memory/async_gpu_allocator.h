@@ -0,0 +1,84 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stream-ordered GPU allocator
+//
+// This file defines a GPU memory allocator backed by a driver memory pool.
+#ifndef TFRT_GPU_MEMORY_ASYNC_GPU_ALLOCATOR_H_
+#define TFRT_GPU_MEMORY_ASYNC_GPU_ALLOCATOR_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Error.h"
+#include "tfrt/gpu/memory/gpu_allocator.h"
+#include "tfrt/gpu/wrapper/driver_wrapper.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace gpu {
+
+// A GPU memory allocator that allocates and frees memory in stream order from
+// the default memory pool of the device. Neither allocation nor deallocation
+// blocks the host: the memory becomes available when the work enqueued before
+// the allocation on the primary stream has completed, and is returned to the
+// pool when the work enqueued before the deallocation has completed.
+//
+// Buffers used on other streams (see RecordUsage()) are freed after the
+// primary stream has waited for the work enqueued on those streams before the
+// deallocation. All the streams must outlive the buffers.
+//
+// The pool caches freed memory for reuse. At synchronization points, memory
+// in excess of the release threshold is returned to the system.
+class AsyncGpuAllocator : public gpu::GpuCrtAllocator {
+ public:
+  // Returns an error if the device of `current` does not support memory
+  // pools.
+  static llvm::Expected<std::unique_ptr<AsyncGpuAllocator>> Create(
+      wrapper::CurrentContext current, uint64_t release_threshold);
+
+  llvm::Expected<RCReference<GpuCrtBuffer>> AllocateBuffer(
+      size_t size, wrapper::Stream stream) override;
+
+  void Deallocate(const gpu::GpuCrtBuffer& buffer) override;
+
+  llvm::Error RecordUsage(const gpu::GpuCrtBuffer& buffer,
+                          wrapper::Stream stream) override;
+
+ private:
+  AsyncGpuAllocator(wrapper::Context context, wrapper::MemoryPool pool);
+
+  llvm::Error FreeAsync(const gpu::GpuCrtBuffer& buffer,
+                        llvm::ArrayRef<wrapper::Stream> other_streams);
+
+  const wrapper::Context context_;
+  const wrapper::MemoryPool pool_;
+
+  mutex mu_;
+  // Streams other than the primary stream that use a buffer, indexed by the
+  // address of the buffer. Buffers only used on their primary stream have no
+  // entry.
+  llvm::DenseMap<void*, llvm::SmallVector<wrapper::Stream, 2>> other_streams_
+      TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace gpu
+}  // namespace tfrt
+
+#endif  // TFRT_GPU_MEMORY_ASYNC_GPU_ALLOCATOR_H_
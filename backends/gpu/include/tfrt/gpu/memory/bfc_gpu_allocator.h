@@ -20,10 +20,14 @@
 #ifndef TFRT_GPU_MEMORY_BFC_GPU_ALLOCATOR_H_
 #define TFRT_GPU_MEMORY_BFC_GPU_ALLOCATOR_H_
 
-#include <map>
+#include <array>
+#include <functional>
+#include <memory>
 #include <set>
+#include <string>
 #include <unordered_map>
 
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Error.h"
 #include "tfrt/gpu/memory/gpu_allocator.h"
 #include "tfrt/gpu/wrapper/driver_wrapper.h"
@@ -42,13 +46,24 @@ namespace gpu {
 // coalescing.  One assumption we make is that the process using this
 // allocator owns pretty much all of the GPU memory, and that nearly
 // all requests to allocate GPU memory go through this interface.
+//
+// Memory is allocated on multiple streams. Each chunk remembers the streams
+// that may still access it: the stream it was allocated on, and the streams
+// passed to RecordUsage(). When the chunk is reused on another stream, that
+// stream waits for the work enqueued so far on those streams, so the host is
+// never blocked. All the streams must outlive the allocator.
+//
+// Free chunks that are only accessed by one stream are kept in a free list of
+// that stream, so that the stream can reuse them in order without waiting.
+// Allocations fall back to the free lists of other streams, and, if that
+// fails too, to coalescing free chunks across streams. Within a free list,
+// chunks are binned by power-of-two size classes and sorted by size and
+// address, so the best fit is found in logarithmic time.
 class BfcGpuAllocator : public gpu::GpuCrtAllocator {
  public:
   explicit BfcGpuAllocator(const wrapper::CurrentContext& current);
+  ~BfcGpuAllocator() override;
 
-  // BfcGpuAllocator does not support streams. If it is asked to allocate
-  // something on a stream different from the stream of any previous
-  // allocations, the allocation request will fail.
   llvm::Expected<RCReference<GpuCrtBuffer>> AllocateBuffer(
       size_t num_bytes, wrapper::Stream stream) override;
 
@@ -57,14 +72,38 @@ class BfcGpuAllocator : public gpu::GpuCrtAllocator {
   llvm::Error RecordUsage(const gpu::GpuCrtBuffer& buffer,
                           wrapper::Stream stream) override;
 
+  llvm::Optional<MemoryUsage> GetMemoryUsage() const override;
+
+  struct Stats {
+    // Size of the memory pool.
+    size_t bytes_limit = 0;
+    size_t bytes_in_use = 0;
+    size_t peak_bytes_in_use = 0;
+    size_t num_allocs = 0;
+    // Number of allocations that reused memory of another stream, which
+    // requires a stream wait.
+    size_t num_cross_stream_reuses = 0;
+    size_t largest_free_block_bytes = 0;
+
+    // Fraction of the free memory that is not in the largest free block.
+    double fragmentation() const;
+  };
+  Stats GetStats() const;
+
  private:
-  struct Bin;
+  // Allocations are rounded to multiples of the minimum size.
+  static constexpr size_t kMinAllocationSize = 256;
+  // Bin i holds the chunks of size [256 << i, 512 << i), the last bin holds
+  // all larger chunks.
+  static constexpr int kNumBins = 48;
+
+  struct FreeList;
 
   // Chunks point to GPU memory.  Their prev/next pointers form a
   // doubly-linked list of addresses sorted by GPU base address that
   // must be contiguous.  Chunks contain information about whether
   // they are in use or whether they are free, and contain a pointer
-  // to the bin they are in.
+  // to the free list they are in.
   struct Chunk {
     size_t size = 0;  // Full size of GPU buffer.
 
@@ -81,73 +120,86 @@ class BfcGpuAllocator : public gpu::GpuCrtAllocator {
     // 'ptr + size'
     Chunk* next = nullptr;
 
-    // What bin are we in?
-    Bin* bin = nullptr;
+    // What free list are we in? Null if the chunk is in use.
+    FreeList* free_list = nullptr;
+
+    // Streams that may access the memory of this chunk.
+    llvm::SmallVector<wrapper::Stream, 2> streams;
 
     std::string DebugString(bool with_neighbors) const;
   };
 
-  Chunk* AllocateNewChunk(size_t num_bytes);
-  void SplitChunk(Chunk* c, size_t num_bytes) TFRT_REQUIRES(mu_);
-  void Merge(Chunk* c1, Chunk* c2) TFRT_REQUIRES(mu_);
-  void MaybeCoalesce(Chunk* c) TFRT_REQUIRES(mu_);
+  // Orders chunks by size, and by address among chunks of the same size.
+  struct ChunkComparator {
+    bool operator()(const Chunk* a, const Chunk* b) const {
+      if (a->size != b->size) return a->size < b->size;
+      return std::less<void*>()(a->ptr, b->ptr);
+    }
+  };
+  using Bin = std::set<Chunk*, ChunkComparator>;
+
+  // Free chunks that may only be accessed by `stream`. The free list of the
+  // null stream holds the chunks that are accessed by no or several streams.
+  struct FreeList {
+    std::array<Bin, kNumBins> bins;
+    // Bit i is set if bins[i] is not empty.
+    uint64_t non_empty_bins = 0;
+  };
 
-  void ReassignChunkToBin(Chunk* c);
-  void RemoveChunkFromBin(Chunk* c) TFRT_REQUIRES(mu_);
+  static int BinIndex(size_t num_bytes);
 
-  // DumpMemoryLog prints extra statistics for the bin that would
-  // serve an allocation of size `num_bytes`.
-  void DumpMemoryLog(size_t num_bytes);
+  // Returns the stream whose free list holds `c` when it's free.
+  static wrapper::Stream GetFreeListStream(const Chunk* c);
 
-  // A Bin is a collection of similar-sized Chunks.
-  struct Bin {
-    // All chunks in this bin have >= bin_size memory.
-    size_t bin_size = 0;
+  FreeList& GetFreeList(wrapper::Stream stream) TFRT_REQUIRES(mu_);
+  void InsertFreeChunk(Chunk* c) TFRT_REQUIRES(mu_);
+  void RemoveFreeChunk(Chunk* c) TFRT_REQUIRES(mu_);
 
-    struct ChunkComparator {
-      bool operator()(Chunk* a, Chunk* b) const { return a->size < b->size; }
-    };
+  // Returns the smallest chunk in `free_list` of at least `num_bytes`, or null.
+  static Chunk* FindChunk(const FreeList& free_list, size_t num_bytes);
+  // Returns the best fit for `num_bytes` across the free lists of all streams.
+  Chunk* FindChunkOnAnyStream(size_t num_bytes) TFRT_REQUIRES(mu_);
 
-    // List of chunks within the bin, sorted by chunk size.
-    std::multiset<Chunk*, ChunkComparator> chunks;
+  void SplitChunk(Chunk* c, size_t num_bytes) TFRT_REQUIRES(mu_);
+  void Merge(Chunk* c1, Chunk* c2) TFRT_REQUIRES(mu_);
+  // Merges `c` with its free neighbors on the same free list and inserts the
+  // result into the free list.
+  void CoalesceAndInsert(Chunk* c) TFRT_REQUIRES(mu_);
+  // Merges all adjacent free chunks, regardless of their streams. Returns
+  // true if any chunks were merged.
+  bool CoalesceAcrossStreams() TFRT_REQUIRES(mu_);
 
-    explicit Bin(size_t bs) : bin_size(bs) {}
+  // Makes `stream` wait for the other streams that may access `c`, and makes
+  // it the only stream of `c`.
+  llvm::Error SetChunkStream(Chunk* c, wrapper::Stream stream)
+      TFRT_REQUIRES(mu_);
 
-    ~Bin() {
-      for (Chunk* chunk : chunks) {
-        delete chunk;
-      }
-    }
-  };
+  // DumpMemoryLog prints the statistics and the state of the free lists for
+  // an allocation of size `num_bytes`.
+  void DumpMemoryLog(size_t num_bytes) TFRT_REQUIRES(mu_);
 
-  static bool CompareFirst(const std::pair<size_t, std::unique_ptr<Bin>>& a,
-                           int64_t b) {
-    return a.first < b;
-  }
+  Stats GetStatsLocked() const TFRT_REQUIRES(mu_);
 
   // Structures immutable after construction
   wrapper::Context context_;
   // The base pointer where all the GPU memory begins.
   wrapper::DeviceMemory<void> base_ptr_;
   uint64_t gpu_memory_size_ = 0;
-
-  // Map from bin size to Bin
-  // After construction, the bin map is never resized.
-  std::vector<std::pair<size_t, std::unique_ptr<Bin>>> bins_;
+  // Name of the tracing counter of the bytes in use.
+  std::string counter_name_;
 
   // Structures mutable after construction
   mutable mutex mu_;
+  // Owns all chunks.
   std::unordered_map<void*, Chunk*> ptr_to_chunk_map_ TFRT_GUARDED_BY(mu_);
-  // Because we don't support multiple streams, stream_ is the stream
-  // for all allocations. All allocation requests on a different stream will be
-  // denied.
-  // We can't easily support "stream transitioning" now because:
-  //  - we need to synchronize the former stream when we transition to the new
-  //  stream.
-  //  - the allocator is not notified when the stream is destroyed. So, the
-  //  synchronization can happen after the stream is destroyed causing
-  //  segfault.
-  wrapper::Stream stream_ TFRT_GUARDED_BY(mu_);
+  // The chunk at the base pointer, which is never merged into another chunk.
+  Chunk* first_chunk_ TFRT_GUARDED_BY(mu_) = nullptr;
+  std::unordered_map<wrapper::Stream, std::unique_ptr<FreeList>> free_lists_
+      TFRT_GUARDED_BY(mu_);
+  // Events that are recorded on a stream to make another stream wait for it.
+  std::unordered_map<wrapper::Stream, wrapper::OwningEvent> stream_events_
+      TFRT_GUARDED_BY(mu_);
+  Stats stats_ TFRT_GUARDED_BY(mu_);
 };
 
 }  // namespace gpu
@@ -23,6 +23,7 @@
 #include "llvm/Support/Error.h"
 #include "tfrt/gpu/memory/gpu_buffer.h"
 #include "tfrt/gpu/wrapper/wrapper.h"
+#include "tfrt/host_context/host_allocator.h"
 #include "tfrt/support/ref_count.h"
 
 namespace tfrt {
@@ -70,6 +71,12 @@ class GpuCrtAllocator {
   // Deallocate()) to know when it is safe to reuse the buffer.
   virtual llvm::Error RecordUsage(const GpuCrtBuffer& buffer,
                                   wrapper::Stream stream) = 0;
+
+  // Returns the number of bytes in use and the limit, or None if the
+  // allocator does not track its usage.
+  virtual llvm::Optional<MemoryUsage> GetMemoryUsage() const {
+    return llvm::None;
+  }
 };
 
 }  // namespace gpu
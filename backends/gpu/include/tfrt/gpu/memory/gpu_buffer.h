@@ -24,6 +24,7 @@
 #include <cstdint>
 
 #include "llvm/ADT/FunctionExtras.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/raw_ostream.h"
 #include "tfrt/gpu/wrapper/wrapper.h"
 #include "tfrt/support/ref_count.h"
@@ -40,7 +41,8 @@ class GpuCrtAllocator;
 // enables significantly more efficient algorithms. GpuBuffer includes
 // GpuAllocator* so that the destructor can easily deallocate the memory.
 //
-// GpuBuffers own their memory.
+// GpuBuffers own their memory, except for sub-buffers (see CreateSubBuffer),
+// which keep the buffer that owns their memory alive instead.
 // GpuBuffers are thread-safe.
 // GpuBuffers are neither copyable nor movable.
 class GpuCrtBuffer : public ReferenceCounted<GpuCrtBuffer> {
@@ -49,8 +51,9 @@ class GpuCrtBuffer : public ReferenceCounted<GpuCrtBuffer> {
   // deallocated using `allocator` when destroyed.
   // `pointer` must have been obtained from the `allocator`.
   // Prefer using GpuAllocator::Allocate instead of creating buffers manually.
+  // `stream` is the primary stream of the buffer (see GpuCrtAllocator).
   GpuCrtBuffer(wrapper::Pointer<void> pointer, size_t size,
-               GpuCrtAllocator* allocator);
+               GpuCrtAllocator* allocator, wrapper::Stream stream = {});
 
   using Deallocator = llvm::unique_function<void(GpuCrtBuffer* buffer)>;
   // Create a GpuBuffer by taking ownership of an externally allocated GPU
@@ -61,6 +64,12 @@ class GpuCrtBuffer : public ReferenceCounted<GpuCrtBuffer> {
 
   ~GpuCrtBuffer();
 
+  // Creates a sub-buffer holding the `size` bytes at `offset` into `buffer`,
+  // without allocating or copying memory. The sub-buffer keeps the memory of
+  // `buffer` alive and has the same primary stream.
+  static llvm::Expected<RCReference<GpuCrtBuffer>> CreateSubBuffer(
+      RCReference<GpuCrtBuffer> buffer, size_t offset, size_t size);
+
   const wrapper::Pointer<void>& pointer() const { return pointer_; }
 
   // Returns the number of `bytes` held by this buffer.
@@ -68,10 +77,31 @@ class GpuCrtBuffer : public ReferenceCounted<GpuCrtBuffer> {
 
   bool IsValid() const { return pointer_ != nullptr; }
 
+  // Returns the allocator of the buffer, or nullptr if the buffer was
+  // allocated externally or is a sub-buffer.
+  GpuCrtAllocator* allocator() const {
+    return has_allocator_ ? allocator_ : nullptr;
+  }
+
+  // Returns the buffer that owns the memory of this buffer: the buffer a
+  // sub-buffer was created from, or this buffer otherwise. Usage of the memory
+  // on other streams must be recorded on the allocator of the owner.
+  const GpuCrtBuffer& owner() const { return owner_ ? *owner_ : *this; }
+
+  // Returns the stream the buffer was allocated on, which is the stream that
+  // produces its content. Returns nullptr if the buffer was allocated
+  // externally.
+  wrapper::Stream stream() const { return stream_; }
+
  private:
+  // Creates a sub-buffer of `owner`, see CreateSubBuffer.
+  GpuCrtBuffer(RCReference<GpuCrtBuffer> owner, size_t offset, size_t size);
+
   // Pointer value of 0 means that the buffer is not pointing to valid memory.
   wrapper::Pointer<void> pointer_;
 
+  // Primary stream of this buffer.
+  wrapper::Stream stream_;
   // Size of this buffer in bytes, i.e. number of bytes in the GPU memory that
   // this buffer represents.
   size_t size_ : sizeof(size_t) * 8 - 1;
@@ -87,6 +117,10 @@ class GpuCrtBuffer : public ReferenceCounted<GpuCrtBuffer> {
     // allocated buffer.
     Deallocator deallocator_;
   };
+
+  // The buffer that owns the memory of a sub-buffer, nullptr otherwise. A
+  // sub-buffer has a null allocator_, so that it does not deallocate.
+  RCReference<GpuCrtBuffer> owner_;
 };
 
 template <typename T>
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Pinned host memory allocator
+//
+// This file defines a HostAllocator for page-locked host memory.
+#ifndef TFRT_GPU_MEMORY_PINNED_HOST_ALLOCATOR_H_
+#define TFRT_GPU_MEMORY_PINNED_HOST_ALLOCATOR_H_
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "tfrt/gpu/wrapper/driver_wrapper.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace gpu {
+
+// A HostAllocator that allocates page-locked (pinned) host memory, which the
+// GPU copies from and to asynchronously and at full bandwidth. Copies from
+// pageable memory are staged by the driver, and block the host until the data
+// has been copied.
+//
+// Pinning memory is expensive, so freed blocks are cached in power-of-two size
+// classes and reused for later allocations, up to `max_cached_bytes`. Blocks
+// larger than the largest size class are not cached.
+//
+// The memory is allocated portable, i.e. it is pinned for all GPU contexts.
+class PinnedHostAllocator : public HostAllocator {
+ public:
+  // Returns the pinned host allocator that allocates with `context`. It lives
+  // until the process exits.
+  static PinnedHostAllocator& Get(wrapper::Context context);
+
+  explicit PinnedHostAllocator(wrapper::Context context,
+                               size_t max_cached_bytes = 256 << 20);
+  ~PinnedHostAllocator() override;
+
+  // Returns nullptr if the memory could not be allocated. `alignment` must not
+  // be larger than the page size.
+  void* AllocateBytes(size_t size, size_t alignment) override;
+  void DeallocateBytes(void* ptr, size_t size) override;
+
+  // Returns true if the `size` bytes at `ptr` were allocated by this allocator
+  // (and are still allocated).
+  bool Contains(const void* ptr, size_t size) const;
+
+ private:
+  // Allocates and frees pinned memory with the driver.
+  void* AllocatePinned(size_t size);
+  void FreePinned(void* ptr);
+
+  wrapper::Context context_;
+  size_t max_cached_bytes_;
+
+  mutable mutex mu_;
+  // Free blocks, indexed by the log2 of their size.
+  std::vector<std::vector<void*>> free_blocks_ TFRT_GUARDED_BY(mu_);
+  size_t cached_bytes_ TFRT_GUARDED_BY(mu_) = 0;
+  // Allocated blocks, by their start address.
+  std::map<uintptr_t, size_t> allocated_blocks_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace gpu
+}  // namespace tfrt
+
+#endif  // TFRT_GPU_MEMORY_PINNED_HOST_ALLOCATOR_H_
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Cache of autotuned convolution algorithms.
+//
+// Entries are keyed by a string which describes the convolution (tensor
+// descriptors, convolution parameters), the device model and the DNN library
+// version. The cache can be backed by a file, in which case existing entries
+// are loaded on construction and new entries are appended to the file. Each
+// entry is appended with a single write, so that several processes can share
+// the same file. If a key occurs several times in the file, the last entry
+// wins.
+#ifndef TFRT_GPU_OPS_TF_CONV_ALGORITHM_CACHE_H_
+#define TFRT_GPU_OPS_TF_CONV_ALGORITHM_CACHE_H_
+
+#include <cstddef>
+#include <string>
+
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace gpu {
+
+// The result of autotuning a convolution. 'algo' and 'math_type' hold the
+// values of the cudnnConvolution{Fwd,BwdData,BwdFilter}Algo_t and
+// cudnnMathType_t enums.
+struct ConvolutionAlgorithm {
+  int algo;
+  size_t workspace_size_bytes;
+  int math_type;
+};
+
+class ConvolutionAlgorithmCache {
+ public:
+  // Creates a cache backed by the file at 'path', or an in-memory cache if
+  // 'path' is empty. The file is created when the first entry is inserted.
+  explicit ConvolutionAlgorithmCache(std::string path);
+
+  // Returns the process-wide cache. It is backed by the file named by the
+  // TFRT_GPU_CONV_ALGORITHM_CACHE environment variable, if set.
+  static ConvolutionAlgorithmCache& Get();
+
+  llvm::Optional<ConvolutionAlgorithm> Find(string_view key) const;
+
+  // Inserts or replaces the entry for 'key' and appends it to the file.
+  // 'key' must not contain new lines. Failures to write the file are logged
+  // and otherwise ignored.
+  void Insert(string_view key, ConvolutionAlgorithm algorithm);
+
+ private:
+  void Load();
+
+  const std::string path_;
+  mutable mutex mu_;
+  llvm::StringMap<ConvolutionAlgorithm> map_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace gpu
+}  // namespace tfrt
+
+#endif  // TFRT_GPU_OPS_TF_CONV_ALGORITHM_CACHE_H_
@@ -75,6 +75,10 @@ void populateGpuAsyncConversionPatterns(mlir::RewritePatternSet& patterns,
 void populateTfrtConversionPatterns(mlir::RewritePatternSet& patterns,
                                     mlir::ConversionTarget& target);
 
+// Adds a rewrite pattern that groups chains of independent tfrt_gpu.blas.gemm
+// ops of the same shape into tfrt_gpu.blas.gemm.grouped ops.
+void populateGemmGroupingPatterns(mlir::RewritePatternSet& patterns);
+
 }  // namespace gpu
 }  // namespace tfrt
 
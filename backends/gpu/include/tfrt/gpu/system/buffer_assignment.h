@@ -0,0 +1,58 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Assignment of temporary buffers to offsets within a single arena.
+//
+// Buffers are placed in order of decreasing size. Each buffer is placed into
+// the smallest gap between the buffers already placed whose live ranges
+// overlap with its own, or after the last of them if no gap is large enough.
+// Buffers with disjoint live ranges may therefore share memory.
+#ifndef TFRT_GPU_SYSTEM_BUFFER_ASSIGNMENT_H_
+#define TFRT_GPU_SYSTEM_BUFFER_ASSIGNMENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace gpu {
+
+// A temporary buffer of `size` bytes that is live from program point `begin`
+// through program point `end`, e.g. the indices of the first and the last
+// kernel using the buffer.
+struct TempBuffer {
+  size_t size;
+  int64_t begin;
+  int64_t end;
+};
+
+// The offsets of temporary buffers within an arena of `arena_size` bytes.
+struct BufferAssignment {
+  std::vector<size_t> offsets;
+  size_t arena_size = 0;
+};
+
+// Assigns offsets to `buffers` such that buffers with overlapping live ranges
+// don't overlap in memory. Offsets are multiples of `alignment`.
+BufferAssignment AssignBuffers(ArrayRef<TempBuffer> buffers, size_t alignment);
+
+}  // namespace gpu
+}  // namespace tfrt
+
+#endif  // TFRT_GPU_SYSTEM_BUFFER_ASSIGNMENT_H_
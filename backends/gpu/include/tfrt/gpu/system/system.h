@@ -19,8 +19,11 @@
 #ifndef TFRT_GPU_SYSTEM_SYSTEM_H_
 #define TFRT_GPU_SYSTEM_SYSTEM_H_
 
+#include <memory>
+
 #include "tfrt/bef/bef_buffer.h"
 #include "tfrt/gpu/device/device.h"
+#include "tfrt/gpu/system/buffer_assignment.h"
 #include "tfrt/gpu/wrapper/blas_wrapper.h"
 #include "tfrt/gpu/wrapper/wrapper.h"
 #include "tfrt/host_context/async_value_ref.h"
@@ -38,22 +41,62 @@ class GpuAllocator;
 class GpuBuffer;
 class GpuContext;
 class GpuStream;
+class ProgramArenas;
+class ProgramGraphCache;
+class ProgramModules;
 
 // A thin wrapper of TFRT callable GPU Function. The function should be
 // generated by lhlo_gpu_to_tfrt_cuda. This class manages the lifetime of
 // the GPU Function.
+//
+// If `capture_graphs` is true, System::Execute records the GPU work of the
+// function into a graph and replays it on later calls with the same argument
+// sizes, which avoids the overhead of launching each kernel individually. This
+// requires that the function dispatches all its work synchronously and that
+// all device memory it uses is passed as inputs or outputs. Graphs are only
+// supported on CUDA; the function is executed normally on other platforms or
+// if it cannot be captured.
+//
+// The function may take `temp_buffers` as trailing arguments, for the
+// intermediate results it computes. The buffers are assigned to offsets in an
+// arena when the program is created, so that buffers which are not live at the
+// same time share memory. The arena is allocated on the first execution on a
+// stream and reused by later executions on that stream.
+//
+// The GPU modules that the function loads with tfrt_gpu.module.load are
+// collected from the BEF file when the program is created. They are loaded
+// concurrently into the context of a stream by System::LoadModules, or by the
+// first execution on the stream, instead of one after the other by the kernels
+// that need them.
 class Program {
  public:
   Program(BefBuffer&& file_buffer, llvm::StringRef function_name,
-          HostContext* host);
+          HostContext* host, bool capture_graphs = false,
+          ArrayRef<TempBuffer> temp_buffers = {});
+  Program(Program&&);
+  Program& operator=(Program&&);
+  ~Program();
+
   const Function* GetFunction() { return function_; }
 
  private:
+  friend class System;
+
   BefBuffer file_buffer_;
 
   // The ownership of this bef file isn't shared.
   RCReference<BEFFile> bef_file_;
   const Function* function_;
+
+  // Null if the function has no temporary buffers.
+  std::unique_ptr<ProgramArenas> arenas_;
+
+  // Null if graph capture is disabled.
+  std::unique_ptr<ProgramGraphCache> graph_cache_;
+
+  // Null if the BEF file loads no GPU modules. Destroyed before the BEF file,
+  // which the pending loads read.
+  std::unique_ptr<ProgramModules> modules_;
 };
 
 // A thin wrapper on top of low level GPU APIs. It provides convenient methods
@@ -115,8 +158,18 @@ class System {
 
   // TODO(fishx): Introduce method for d2d data transfer.
 
+  // Load the GPU modules of `program` into the context of `stream`, e.g. right
+  // after creating them so that the first execution doesn't wait for the
+  // modules. The output chain is ready when all modules are loaded. The stream
+  // needs to be available.
+  AsyncValueRef<Chain> LoadModules(ExecutionContext& exec_ctx, Program& program,
+                                   AsyncValueRef<GpuStream> stream);
+
   // Execute the lowered GPU Function on given stream. The output chain is ready
-  // when the all gpu kernels have been dispatched on the stream.
+  // when the all gpu kernels have been dispatched on the stream. If the program
+  // captures graphs and all arguments are available, the kernels are dispatched
+  // by launching a graph. If the program has temporary buffers, the stream
+  // needs to be available.
   AsyncValueRef<Chain> Execute(ExecutionContext& exec_ctx, Program& program,
                                AsyncValueRef<GpuStream> stream,
                                ArrayRef<AsyncValueRef<GpuBuffer>> inputs,
@@ -21,6 +21,7 @@
 #define TFRT_GPU_TENSOR_DENSE_GPU_TENSOR_H_
 
 #include "llvm/ADT/Optional.h"
+#include "llvm/Support/Error.h"
 #include "tfrt/gpu/memory/gpu_buffer.h"
 #include "tfrt/support/ref_count.h"
 #include "tfrt/tensor/tensor.h"
@@ -64,6 +65,12 @@ class DenseGpuTensor final : public Tensor,
     return DenseGpuTensor(new_shape, dtype(), buffer_.CopyRef());
   }
 
+  // Returns a DenseGpuTensor of `shape` that views the elements of this tensor
+  // starting at element `offset`, in a sub-buffer of its GpuBuffer. Returns an
+  // error if the elements are out of range.
+  llvm::Expected<DenseGpuTensor> Slice(size_t offset,
+                                       const TensorShape& shape) const;
+
   // Tensor type for DenseGpuTensor.
   static const char* name() { return "DenseGpu"; }
 
@@ -82,6 +82,16 @@ llvm::Error BlasGemmStridedBatchedEx(
     Pointer<const void> beta, Pointer<void> C, BlasDataType typeC, int heightC,
     int64_t strideC, int batchCount, BlasDataType computeType,
     BlasGemmAlgo algo);
+// Like above, but the matrices are passed as arrays of `batchCount` pointers
+// instead of a base pointer and a stride. The arrays need to be in device
+// memory.
+llvm::Error BlasGemmBatchedEx(
+    CurrentContext current, BlasHandle handle, BlasOperation transA,
+    BlasOperation transB, int m, int n, int k, Pointer<const void> alpha,
+    Pointer<const void*> Aarray, BlasDataType typeA, int heightA,
+    Pointer<const void*> Barray, BlasDataType typeB, int heightB,
+    Pointer<const void> beta, Pointer<void*> Carray, BlasDataType typeC,
+    int heightC, int batchCount, BlasDataType computeType, BlasGemmAlgo algo);
 
 }  // namespace wrapper
 }  // namespace gpu
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Subset of the NCCL and RCCL API.
+//
+// RCCL implements the NCCL API with the same names, which is why the functions
+// of both libraries can't be declared with their original names in the same
+// program. The RCCL functions below are prefixed with 'rccl' instead, and are
+// forwarded to the 'nccl' symbols of the RCCL library. The enums and the
+// unique id have the same definitions in both libraries.
+#ifndef TFRT_GPU_WRAPPER_CCL_STUB_H_
+#define TFRT_GPU_WRAPPER_CCL_STUB_H_
+
+#include <cstddef>
+
+#include "tfrt/gpu/wrapper/cuda_forwards.h"
+#include "tfrt/gpu/wrapper/hip_forwards.h"
+
+using ncclComm_t = struct ncclComm *;
+using rcclComm_t = struct rcclComm *;
+
+#define NCCL_UNIQUE_ID_BYTES 128
+struct ncclUniqueId {
+  char internal[NCCL_UNIQUE_ID_BYTES];
+};
+
+enum ncclResult_t {
+  ncclSuccess = 0,
+  ncclUnhandledCudaError = 1,
+  ncclSystemError = 2,
+  ncclInternalError = 3,
+  ncclInvalidArgument = 4,
+  ncclInvalidUsage = 5,
+  ncclNumResults = 6
+};
+
+enum ncclRedOp_t {
+  ncclSum = 0,
+  ncclProd = 1,
+  ncclMax = 2,
+  ncclMin = 3,
+  ncclNumOps = 4
+};
+
+enum ncclDataType_t {
+  ncclInt8 = 0,
+  ncclUint8 = 1,
+  ncclInt32 = 2,
+  ncclUint32 = 3,
+  ncclInt64 = 4,
+  ncclUint64 = 5,
+  ncclFloat16 = 6,
+  ncclFloat32 = 7,
+  ncclFloat64 = 8,
+  ncclNumTypes = 9
+};
+
+extern "C" {
+
+ncclResult_t ncclGetVersion(int *version);
+ncclResult_t ncclGetUniqueId(ncclUniqueId *uniqueId);
+ncclResult_t ncclCommInitRank(ncclComm_t *comm, int nranks,
+                              ncclUniqueId commId, int rank);
+ncclResult_t ncclCommDestroy(ncclComm_t comm);
+ncclResult_t ncclCommCount(const ncclComm_t comm, int *count);
+ncclResult_t ncclCommUserRank(const ncclComm_t comm, int *rank);
+ncclResult_t ncclGroupStart();
+ncclResult_t ncclGroupEnd();
+ncclResult_t ncclAllReduce(const void *sendbuff, void *recvbuff, size_t count,
+                           ncclDataType_t datatype, ncclRedOp_t op,
+                           ncclComm_t comm, cudaStream_t stream);
+ncclResult_t ncclAllGather(const void *sendbuff, void *recvbuff,
+                           size_t sendcount, ncclDataType_t datatype,
+                           ncclComm_t comm, cudaStream_t stream);
+ncclResult_t ncclReduceScatter(const void *sendbuff, void *recvbuff,
+                               size_t recvcount, ncclDataType_t datatype,
+                               ncclRedOp_t op, ncclComm_t comm,
+                               cudaStream_t stream);
+ncclResult_t ncclBroadcast(const void *sendbuff, void *recvbuff, size_t count,
+                           ncclDataType_t datatype, int root, ncclComm_t comm,
+                           cudaStream_t stream);
+
+ncclResult_t rcclGetVersion(int *version);
+ncclResult_t rcclGetUniqueId(ncclUniqueId *uniqueId);
+ncclResult_t rcclCommInitRank(rcclComm_t *comm, int nranks,
+                              ncclUniqueId commId, int rank);
+ncclResult_t rcclCommDestroy(rcclComm_t comm);
+ncclResult_t rcclCommCount(const rcclComm_t comm, int *count);
+ncclResult_t rcclCommUserRank(const rcclComm_t comm, int *rank);
+ncclResult_t rcclGroupStart();
+ncclResult_t rcclGroupEnd();
+ncclResult_t rcclAllReduce(const void *sendbuff, void *recvbuff, size_t count,
+                           ncclDataType_t datatype, ncclRedOp_t op,
+                           rcclComm_t comm, hipStream_t stream);
+ncclResult_t rcclAllGather(const void *sendbuff, void *recvbuff,
+                           size_t sendcount, ncclDataType_t datatype,
+                           rcclComm_t comm, hipStream_t stream);
+ncclResult_t rcclReduceScatter(const void *sendbuff, void *recvbuff,
+                               size_t recvcount, ncclDataType_t datatype,
+                               ncclRedOp_t op, rcclComm_t comm,
+                               hipStream_t stream);
+ncclResult_t rcclBroadcast(const void *sendbuff, void *recvbuff, size_t count,
+                           ncclDataType_t datatype, int root, rcclComm_t comm,
+                           hipStream_t stream);
+
+}  // extern "C"
+
+#endif  // TFRT_GPU_WRAPPER_CCL_STUB_H_
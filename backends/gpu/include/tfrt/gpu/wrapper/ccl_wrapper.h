@@ -0,0 +1,102 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Thin abstraction layer for NCCL and RCCL.
+#ifndef TFRT_GPU_WRAPPER_CCL_WRAPPER_H_
+#define TFRT_GPU_WRAPPER_CCL_WRAPPER_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "tfrt/gpu/wrapper/ccl_stub.h"
+#include "tfrt/gpu/wrapper/wrapper.h"
+
+namespace tfrt {
+namespace gpu {
+namespace wrapper {
+
+llvm::raw_ostream& operator<<(llvm::raw_ostream& os, ncclResult_t result);
+
+template <>
+Expected<ncclDataType_t> Parse<ncclDataType_t>(llvm::StringRef name);
+llvm::raw_ostream& operator<<(llvm::raw_ostream& os, ncclDataType_t value);
+
+template <>
+Expected<ncclRedOp_t> Parse<ncclRedOp_t>(llvm::StringRef name);
+llvm::raw_ostream& operator<<(llvm::raw_ostream& os, ncclRedOp_t value);
+
+// Non-owning handles of GPU resources.
+using CclComm = Resource<ncclComm_t, rcclComm_t>;
+
+namespace internal {
+// Helper to wrap resources and memory into RAII types.
+struct CclCommDeleter {
+  using pointer = CclComm;
+  void operator()(CclComm comm) const;
+};
+}  // namespace internal
+
+// RAII wrappers for resources. Instances own the underlying resource.
+//
+// They are implemented as std::unique_ptrs with custom deleters.
+//
+// Use get() and release() to access the non-owning handle, please use with
+// appropriate care.
+using OwningCclComm = internal::OwningResource<internal::CclCommDeleter>;
+
+llvm::Expected<int> CclGetVersion(Platform platform);
+llvm::Expected<ncclUniqueId> CclGetUniqueId(Platform platform);
+// Creates the communicator of 'rank' in a clique of 'nranks'. Blocks until all
+// ranks have called this function, use CclGroupStart/End() to initialize
+// multiple ranks from the same thread.
+llvm::Expected<OwningCclComm> CclCommInitRank(CurrentContext current,
+                                              int nranks, ncclUniqueId commId,
+                                              int rank);
+llvm::Error CclCommDestroy(CclComm comm);
+llvm::Expected<int> CclCommCount(CclComm comm);
+llvm::Expected<int> CclCommUserRank(CclComm comm);
+
+// Calls between CclGroupStart() and CclGroupEnd() are fused and only enqueued
+// by the latter. This is required when issuing collectives for more than one
+// rank from the same thread.
+llvm::Error CclGroupStart(Platform platform);
+llvm::Error CclGroupEnd(Platform platform);
+
+llvm::Error CclAllReduce(CurrentContext current, Pointer<const void> sendbuff,
+                         Pointer<void> recvbuff, size_t count,
+                         ncclDataType_t datatype, ncclRedOp_t op, CclComm comm,
+                         Stream stream);
+llvm::Error CclAllGather(CurrentContext current, Pointer<const void> sendbuff,
+                         Pointer<void> recvbuff, size_t sendcount,
+                         ncclDataType_t datatype, CclComm comm, Stream stream);
+llvm::Error CclReduceScatter(CurrentContext current,
+                             Pointer<const void> sendbuff,
+                             Pointer<void> recvbuff, size_t recvcount,
+                             ncclDataType_t datatype, ncclRedOp_t op,
+                             CclComm comm, Stream stream);
+llvm::Error CclBroadcast(CurrentContext current, Pointer<const void> sendbuff,
+                         Pointer<void> recvbuff, size_t count,
+                         ncclDataType_t datatype, int root, CclComm comm,
+                         Stream stream);
+
+// Returns the size in bytes of one element of 'datatype'.
+size_t GetCclDataTypeSizeBytes(ncclDataType_t datatype);
+
+}  // namespace wrapper
+}  // namespace gpu
+}  // namespace tfrt
+
+#endif  // TFRT_GPU_WRAPPER_CCL_WRAPPER_H_
@@ -75,13 +75,14 @@ llvm::Error CublasGemmEx(CurrentContext current, cublasHandle_t handle,
                          Pointer<const void> beta, Pointer<void> C,
                          cudaDataType typeC, int heightC,
                          cudaDataType computeType, cublasGemmAlgo_t algo);
+// The matrix pointer arrays need to be in device memory.
 llvm::Error CublasGemmBatchedEx(
     CurrentContext current, cublasHandle_t handle, cublasOperation_t transA,
     cublasOperation_t transB, int m, int n, int k, Pointer<const void> alpha,
-    llvm::ArrayRef<Pointer<const void>> Aarray, cudaDataType typeA, int heightA,
-    llvm::ArrayRef<Pointer<const void>> Barray, cudaDataType typeB, int heightB,
-    Pointer<const void> beta, llvm::ArrayRef<Pointer<void>> Carray,
-    cudaDataType typeC, int heightC, int batchCount, cudaDataType computeType,
+    Pointer<const void*> Aarray, cudaDataType typeA, int heightA,
+    Pointer<const void*> Barray, cudaDataType typeB, int heightB,
+    Pointer<const void> beta, Pointer<void*> Carray, cudaDataType typeC,
+    int heightC, int batchCount, cudaDataType computeType,
     cublasGemmAlgo_t algo);
 llvm::Error CublasGemmStridedBatchedEx(
     CurrentContext current, cublasHandle_t handle, cublasOperation_t transA,
@@ -98,9 +98,28 @@ llvm::Error CuEventSynchronize(CUevent event);
 llvm::Expected<bool> CuEventQuery(CUevent event);
 llvm::Expected<float> CuEventElapsedTime(CUevent start, CUevent end);
 
+llvm::Error CuStreamBeginCapture(CUstream stream, CUstreamCaptureMode mode);
+llvm::Expected<OwningGraph> CuStreamEndCapture(CUstream stream);
+llvm::Expected<bool> CuStreamIsCapturing(CUstream stream);
+llvm::Error CuGraphDestroy(CUgraph graph);
+llvm::Expected<OwningGraphExec> CuGraphInstantiate(CurrentContext current,
+                                                   CUgraph graph);
+llvm::Error CuGraphExecDestroy(CUgraphExec graph_exec);
+llvm::Expected<bool> CuGraphExecUpdate(CUgraphExec graph_exec, CUgraph graph);
+llvm::Error CuGraphLaunch(CUgraphExec graph_exec, CUstream stream);
+
 llvm::Expected<DeviceMemory<void>> CuMemAlloc(CurrentContext current,
                                               size_t size_bytes);
 llvm::Error CuMemFree(Pointer<void> pointer);
+llvm::Expected<CUmemoryPool> CuDeviceGetDefaultMemPool(Device device);
+llvm::Error CuMemPoolSetReleaseThreshold(CUmemoryPool pool,
+                                         uint64_t threshold);
+llvm::Error CuMemPoolTrimTo(CUmemoryPool pool, size_t min_bytes_to_keep);
+llvm::Expected<Pointer<void>> CuMemAllocFromPoolAsync(CurrentContext current,
+                                                      size_t size_bytes,
+                                                      CUmemoryPool pool,
+                                                      CUstream stream);
+llvm::Error CuMemFreeAsync(Pointer<void> pointer, CUstream stream);
 llvm::Expected<HostMemory<void>> CuMemHostAlloc(CurrentContext current,
                                                 size_t size_bytes,
                                                 CUmemhostalloc_flags flags);
@@ -62,6 +62,11 @@ enum class MemAttachFlags {
   GLOBAL = 1,
   HOST = 2,
 };
+enum class StreamCaptureMode {
+  GLOBAL = 0,
+  THREAD_LOCAL = 1,
+  RELAXED = 2,
+};
 
 namespace internal {
 template <typename E>
@@ -117,6 +122,9 @@ using Module = Resource<CUmodule, hipModule_t>;
 // with PointerIntPair. Will fail runtime asserts if used.
 using Event = Resource<CUevent, hipEvent_t>;
 using Function = Resource<CUfunction, hipFunction_t>;
+using Graph = Resource<CUgraph, hipGraph_t>;
+using GraphExec = Resource<CUgraphExec, hipGraphExec_t>;
+using MemoryPool = Resource<CUmemoryPool, hipMemPool_t>;
 
 namespace internal {
 struct ModuleDeleter {
@@ -127,6 +135,14 @@ struct EventDeleter {
   using pointer = Event;
   void operator()(Event event) const;
 };
+struct GraphDeleter {
+  using pointer = Graph;
+  void operator()(Graph graph) const;
+};
+struct GraphExecDeleter {
+  using pointer = GraphExec;
+  void operator()(GraphExec graph_exec) const;
+};
 
 struct DeviceMemoryDeallocator {
   void operator()(Pointer<void> pointer) const;
@@ -153,6 +169,8 @@ using OwningMemory = std::unique_ptr<T, MemoryDeleter<T, Deleter>>;
 // appropriate care.
 using OwningModule = internal::OwningResource<internal::ModuleDeleter>;
 using OwningEvent = internal::OwningResource<internal::EventDeleter>;
+using OwningGraph = internal::OwningResource<internal::GraphDeleter>;
+using OwningGraphExec = internal::OwningResource<internal::GraphExecDeleter>;
 
 // RAII wrappers for GPU memory. Instances own the underlying memory.
 template <typename T>
@@ -237,6 +255,25 @@ llvm::Error EventSynchronize(Event event);
 llvm::Expected<bool> EventQuery(Event event);
 llvm::Expected<float> EventElapsedTime(Event start, Event end);
 
+// Work enqueued on a capturing stream is recorded into a graph instead of
+// being executed. The graph can be instantiated once and launched repeatedly
+// at a fraction of the cost of launching the individual operations.
+//
+// Graphs are currently only supported on CUDA.
+llvm::Error StreamBeginCapture(Stream stream, StreamCaptureMode mode);
+llvm::Expected<OwningGraph> StreamEndCapture(Stream stream);
+llvm::Expected<bool> StreamIsCapturing(Stream stream);
+
+llvm::Error GraphDestroy(Graph graph);
+llvm::Expected<OwningGraphExec> GraphInstantiate(CurrentContext current,
+                                                 Graph graph);
+llvm::Error GraphExecDestroy(GraphExec graph_exec);
+// Updates the parameters (e.g. kernel arguments and memcpy pointers) of
+// 'graph_exec' to those of 'graph'. Returns false if 'graph' has a different
+// topology than 'graph_exec' and needs to be instantiated instead.
+llvm::Expected<bool> GraphExecUpdate(GraphExec graph_exec, Graph graph);
+llvm::Error GraphLaunch(GraphExec graph_exec, Stream stream);
+
 llvm::Expected<DeviceMemory<void>> MemAlloc(CurrentContext current,
                                             size_t size_bytes);
 llvm::Error MemFree(Pointer<void> pointer);
@@ -257,6 +294,21 @@ llvm::Expected<MemoryRange<void>> MemGetAddressRange(CurrentContext current,
                                                      Pointer<void> ptr);
 llvm::Expected<MemoryInfo> MemGetInfo(CurrentContext current);
 
+// Stream-ordered allocation from memory pools. The memory is allocated and
+// freed in the order of the work enqueued on 'stream', without blocking the
+// host. Memory freed to a pool is kept for reuse until the pool holds more
+// than its release threshold at a synchronization point.
+//
+// Memory pools are currently only supported on CUDA.
+llvm::Expected<MemoryPool> DeviceGetDefaultMemPool(Device device);
+llvm::Error MemPoolSetReleaseThreshold(MemoryPool pool, uint64_t threshold);
+llvm::Error MemPoolTrimTo(MemoryPool pool, size_t min_bytes_to_keep);
+llvm::Expected<Pointer<void>> MemAllocFromPoolAsync(CurrentContext current,
+                                                    size_t size_bytes,
+                                                    MemoryPool pool,
+                                                    Stream stream);
+llvm::Error MemFreeAsync(Pointer<void> pointer, Stream stream);
+
 llvm::Error Memcpy(CurrentContext current, Pointer<void> dst,
                    Pointer<const void> src, size_t count_bytes);
 llvm::Error MemcpyAsync(CurrentContext current, Pointer<void> dst,
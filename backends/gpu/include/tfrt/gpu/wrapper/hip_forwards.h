@@ -27,6 +27,9 @@ using hipModule_t = struct ihipModule_t *;
 using hipStream_t = struct ihipStream_t *;
 using hipEvent_t = struct ihipEvent_t *;
 using hipFunction_t = struct ihipModuleSymbol_t *;
+using hipGraph_t = struct ihipGraph *;
+using hipGraphExec_t = struct hipGraphExec *;
+using hipMemPool_t = struct ihipMemPoolHandle_t *;
 
 // Forward declaration of MIOpen types.
 using miopenHandle_t = struct miopenHandle *;
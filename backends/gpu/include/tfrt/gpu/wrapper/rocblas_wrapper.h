@@ -84,6 +84,15 @@ llvm::Error RocblasGemmStridedBatchedEx(
     int heightC, int64_t strideC, Pointer<void> D, rocblas_datatype typeD,
     int heightD, int64_t strideD, int batchCount, rocblas_datatype computeType,
     rocblas_gemm_algo algo);
+// The matrix pointer arrays need to be in device memory.
+llvm::Error RocblasGemmBatchedEx(
+    CurrentContext current, rocblas_handle handle, rocblas_operation transA,
+    rocblas_operation transB, int m, int n, int k, Pointer<const void> alpha,
+    Pointer<const void*> Aarray, rocblas_datatype typeA, int heightA,
+    Pointer<const void*> Barray, rocblas_datatype typeB, int heightB,
+    Pointer<const void> beta, Pointer<void*> Carray, rocblas_datatype typeC,
+    int heightC, Pointer<void*> Darray, rocblas_datatype typeD, int heightD,
+    int batchCount, rocblas_datatype computeType, rocblas_gemm_algo algo);
 
 // The functions below are not used and might be removed.
 
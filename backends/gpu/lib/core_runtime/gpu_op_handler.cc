@@ -28,10 +28,12 @@
 #include "tfrt/gpu/core_runtime/gpu_op_registry.h"
 #include "tfrt/gpu/device/device.h"
 #include "tfrt/gpu/device/device_util.h"
+#include "tfrt/gpu/device/gpu_tracing.h"
 #include "tfrt/gpu/tensor/dense_gpu_tensor.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/device.h"
+#include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/string_util.h"
@@ -53,11 +55,12 @@ class GpuOpHandler : public OpHandler {
  public:
   explicit GpuOpHandler(CoreRuntime* runtime, OpHandler* fallback,
                         GpuOpRegistry op_registry,
-                        RCReference<GpuDevice> device);
+                        RCReference<GpuDevice> device,
+                        MixedPrecision mixed_precision);
 
   Expected<CoreRuntimeOp> MakeOp(string_view op_name) override;
 
-  GpuDispatchContext MakeGpuDispatchContext();
+  GpuDispatchContext MakeGpuDispatchContext(int stream_id);
 
   RCReference<Device> GetDeviceRef() { return device_.CopyRef(); }
 
@@ -66,6 +69,8 @@ class GpuOpHandler : public OpHandler {
 
   RCReference<GpuDevice> device_;
 
+  const MixedPrecision mixed_precision_;
+
   friend llvm::Expected<OpHandler*> CreateGpuOpHandler(
       CoreRuntime* runtime, RCReference<Device> device, OpHandler* fallback);
 };
@@ -82,7 +87,31 @@ struct GpuOpHandlerTraits {
                        MutableArrayRef<RCReference<AsyncValue>> results,
                        AsyncValueRef<Chain>* chain,
                        const ExecutionContext& exec_ctx) {
-    GpuDispatchContext dctx = gpu_op_handler->MakeGpuDispatchContext();
+    // The stream analysis assigns independent ops to different streams.
+    GpuDispatchContext dctx =
+        gpu_op_handler->MakeGpuDispatchContext(exec_ctx.stream_id());
+
+    // Inputs produced on other streams must be ready on the dispatch stream.
+    for (AsyncValue* input : inputs) {
+      if (!input->IsType<DenseGpuTensor>()) continue;
+      const GpuCrtBuffer& buffer = input->get<DenseGpuTensor>().buffer();
+      if (auto error = dctx.device().WaitForBuffer(buffer, dctx.stream())) {
+        auto diag = EmitError(exec_ctx, StrCat(error));
+        for (auto& result : results) result = MakeErrorAsyncValueRef(diag);
+        if (chain) *chain = MakeErrorAsyncValueRef(diag);
+        return;
+      }
+    }
+
+    // Trace the device time of the kernels that the op enqueues.
+    GpuTracingScope tracing_scope(
+        dctx.current_context(), dctx.stream(), exec_ctx.host(),
+        [&] { return op_entry.op_name.str(); },
+        [&] {
+          const GpuDevice& device = dctx.device();
+          return StrCat(device.name(), " stream ",
+                        exec_ctx.stream_id() % device.num_compute_streams());
+        });
     op_entry.dispatch_fn(exec_ctx, &dctx, inputs, attrs, result_mds, results,
                          chain);
   }
@@ -100,25 +129,42 @@ struct GpuOpHandlerTraits {
 llvm::Expected<OpHandler*> CreateGpuOpHandler(CoreRuntime* runtime,
                                               RCReference<GpuDevice> device,
                                               OpHandler* fallback) {
+  return CreateGpuOpHandler(runtime, std::move(device), fallback,
+                            MixedPrecision::kNone);
+}
+
+llvm::Expected<OpHandler*> CreateGpuOpHandler(CoreRuntime* runtime,
+                                              RCReference<GpuDevice> device,
+                                              OpHandler* fallback,
+                                              MixedPrecision mixed_precision) {
   GpuOpRegistry op_registry;
   RegisterStaticGpuOps(&op_registry);
-  auto gpu_op_handler = std::make_unique<GpuOpHandler>(
-      runtime, fallback, std::move(op_registry), std::move(device));
+  auto gpu_op_handler =
+      std::make_unique<GpuOpHandler>(runtime, fallback, std::move(op_registry),
+                                     std::move(device), mixed_precision);
 
   auto gpu_op_handler_ptr = gpu_op_handler.get();
   runtime->TakeOpHandler(std::move(gpu_op_handler));
   return gpu_op_handler_ptr;
 }
 
+llvm::Expected<MixedPrecision> ParseMixedPrecision(string_view name) {
+  if (name == "none") return MixedPrecision::kNone;
+  if (name == "f16") return MixedPrecision::kFloat16;
+  return MakeStringError("Unknown mixed precision policy: ", name);
+}
+
 GpuOpHandler::GpuOpHandler(CoreRuntime* runtime, OpHandler* fallback,
                            GpuOpRegistry op_registry,
-                           RCReference<GpuDevice> device)
+                           RCReference<GpuDevice> device,
+                           MixedPrecision mixed_precision)
     : OpHandler("gpu", runtime, fallback),
       op_registry_(std::move(op_registry)),
-      device_(std::move(device)) {}
+      device_(std::move(device)),
+      mixed_precision_(mixed_precision) {}
 
-GpuDispatchContext GpuOpHandler::MakeGpuDispatchContext() {
-  return GpuDispatchContext{device_.get()};
+GpuDispatchContext GpuOpHandler::MakeGpuDispatchContext(int stream_id) {
+  return GpuDispatchContext{device_.get(), stream_id, mixed_precision_};
 }
 
 Expected<CoreRuntimeOp> GpuOpHandler::MakeOp(string_view op_name) {
@@ -17,6 +17,7 @@
 #include "op_handler_kernels.h"
 
 #include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/gpu/core_runtime/gpu_dispatch_context.h"
 #include "tfrt/gpu/core_runtime/gpu_op_handler.h"
 #include "tfrt/gpu/device/device.h"
 #include "tfrt/gpu/device/device_util.h"
@@ -37,6 +38,23 @@ static Expected<OpHandler *> CreateGpuOpHandlerKernel(
   if (!gpu) return gpu.takeError();
   return CreateGpuOpHandler(runtime, std::move(gpu.get()), fallback.get());
 }
+
+// Creates a GPU op handler with the mixed precision policy named by the
+// `mixed_precision` attribute ("none" or "f16").
+static Expected<OpHandler *> CreateGpuOpHandlerWithMixedPrecisionKernel(
+    int gpu_ordinal, Argument<OpHandler *> fallback,
+    StringAttribute mixed_precision, const ExecutionContext &exec_ctx) {
+  auto policy = ParseMixedPrecision(mixed_precision.get());
+  if (!policy) return policy.takeError();
+  auto *runtime = CoreRuntime::GetFromHostContext(exec_ctx.host());
+  assert(runtime);
+  auto device_name = StrCat("GPU:", gpu_ordinal);
+  auto gpu =
+      GetOrCreateGpuDevice(device_name, gpu_ordinal, runtime->GetHostContext());
+  if (!gpu) return gpu.takeError();
+  return CreateGpuOpHandler(runtime, std::move(gpu.get()), fallback.get(),
+                            *policy);
+}
 //===----------------------------------------------------------------------===//
 // Registration
 //===----------------------------------------------------------------------===//
@@ -44,6 +62,9 @@ static Expected<OpHandler *> CreateGpuOpHandlerKernel(
 void RegisterGpuOpHandlerKernels(KernelRegistry *registry) {
   registry->AddKernel("corert.create_gpu_op_handler",
                       TFRT_KERNEL(CreateGpuOpHandlerKernel));
+  registry->AddKernel(
+      "corert.create_gpu_op_handler_with_mixed_precision",
+      TFRT_KERNEL(CreateGpuOpHandlerWithMixedPrecisionKernel));
 }
 
 }  // namespace gpu
@@ -17,15 +17,26 @@
 
 #include "tfrt/gpu/device/conversion_function.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
 #include "tfrt/gpu/device/device.h"
+#include "tfrt/gpu/device/event_manager.h"
+#include "tfrt/gpu/device/gpu_tracing.h"
 #include "tfrt/gpu/memory/gpu_allocator.h"
+#include "tfrt/gpu/memory/pinned_host_allocator.h"
 #include "tfrt/gpu/tensor/dense_gpu_tensor.h"
 #include "tfrt/gpu/wrapper/wrapper.h"
-#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_buffer.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/metrics/metrics.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/string_util.h"
 #include "tfrt/tensor/conversion_registry.h"
 #include "tfrt/tensor/conversion_utils.h"
 #include "tfrt/tensor/dense_host_tensor.h"
@@ -36,19 +47,65 @@ namespace gpu {
 
 using wrapper::EventFlags;
 using wrapper::EventRecord;
-using wrapper::EventSynchronize;
 using wrapper::OwningEvent;
 using wrapper::Pointer;
 
+using Clock = std::chrono::steady_clock;
+
+// Host to device copies through a staging buffer are issued in chunks of this
+// size, so that the DMA of one chunk overlaps staging the next.
+static constexpr size_t kStagingChunkSize = size_t{4} << 20;
+
+namespace {
+// Metrics of the copies in one direction between host and device.
+struct TransferMetrics {
+  metrics::Counter* bytes;
+  // Effective bandwidth from enqueueing a copy to its completion, in MB/s.
+  metrics::Histogram* bandwidth;
+};
+}  // namespace
+
+static TransferMetrics MakeTransferMetrics(const std::string& prefix) {
+  auto buckets = metrics::Buckets::Explicit(
+      {10, 100, 1000, 2000, 4000, 8000, 12000, 16000, 24000, 32000});
+  return {metrics::NewCounter(prefix + "bytes"),
+          metrics::NewHistogram(prefix + "bandwidth_mb_per_s", buckets)};
+}
+
+static const TransferMetrics& GetH2DMetrics() {
+  static const auto* metrics =
+      new TransferMetrics(MakeTransferMetrics("/tfrt/gpu/memcpy_h2d/"));
+  return *metrics;
+}
+
+static const TransferMetrics& GetD2HMetrics() {
+  static const auto* metrics =
+      new TransferMetrics(MakeTransferMetrics("/tfrt/gpu/memcpy_d2h/"));
+  return *metrics;
+}
+
+static void RecordTransfer(const TransferMetrics& metrics, size_t bytes,
+                           Clock::time_point start) {
+  metrics.bytes->IncrementBy(bytes);
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  // Small copies are dominated by latency and would skew the bandwidth.
+  if (bytes >= (size_t{1} << 20) && seconds > 0)
+    metrics.bandwidth->Record(bytes / seconds * 1e-6);
+}
+
 AsyncValueRef<DenseHostTensor> ConvertDenseGpuTensorToDenseHostTensor(
     wrapper::CurrentContext current_context, wrapper::Stream stream,
     const DenseGpuTensor& gpu_tensor, HostContext* host) {
+  // Copy to pinned memory, so that the copy is asynchronous.
   llvm::Optional<DenseHostTensor> result_or_error =
-      DenseHostTensor::CreateUninitialized(gpu_tensor.metadata(), host);
+      DenseHostTensor::CreateUninitialized(
+          gpu_tensor.metadata(),
+          &PinnedHostAllocator::Get(current_context.context()));
   if (!result_or_error) {
     return MakeErrorAsyncValueRef(host, "cannot allocate result tensor");
   }
   DenseHostTensor result = std::move(*result_or_error);
+  Clock::time_point start = Clock::now();
 
   Pointer<void> memcpy_dst(result.data(), current_context.platform());
   Pointer<void> memcpy_src = gpu_tensor.buffer().pointer();
@@ -80,16 +137,20 @@ AsyncValueRef<DenseHostTensor> ConvertDenseGpuTensorToDenseHostTensor(
                   toString(std::move(event_record_error)));
   }
 
-  return EnqueueBlockingWork(
-      host,
-      [event = std::move(event),
-       result = std::move(result)]() mutable -> Expected<DenseHostTensor> {
-        if (EventSynchronize(event.get())) {
-          return MakeStringError("could not wait for event");
-        } else {
-          return std::move(result);
-        }
-      });
+  auto result_ref = MakeUnconstructedAsyncValueRef<DenseHostTensor>(host);
+  wrapper::Event event_handle = event.get();
+  EventManager::Get(current_context.context())
+      .Then(event_handle, host,
+            [event = std::move(event), result = std::move(result),
+             result_ref = result_ref.CopyRef(), size_in_bytes,
+             start](llvm::Error error) mutable {
+              if (error)
+                return result_ref.SetError(
+                    StrCat("could not wait for event: ", error));
+              RecordTransfer(GetD2HMetrics(), size_in_bytes, start);
+              result_ref.emplace(std::move(result));
+            });
+  return result_ref;
 }
 
 static AsyncValueRef<DenseHostTensor>
@@ -97,8 +158,17 @@ DenseGpuTensorToDenseHostTensorConversionFn(const DenseGpuTensor& tensor,
                                             const GpuDevice& src,
                                             const CpuDevice& dst,
                                             const ExecutionContext& exec_ctx) {
-  return ConvertDenseGpuTensorToDenseHostTensor(
-      src.CreateContext(), src.stream(), tensor, exec_ctx.host());
+  // The copy runs on the dedicated device-to-host stream, after the stream
+  // that produced the tensor.
+  if (auto error = src.WaitForBuffer(tensor.buffer(), src.d2h_stream()))
+    return MakeErrorAsyncValueRef(exec_ctx.host(), StrCat(error));
+  wrapper::CurrentContext current = src.CreateContext();
+  GpuTracingScope tracing_scope(
+      current, src.d2h_stream(), exec_ctx.host(),
+      [] { return std::string("MemcpyDtoH"); },
+      [&] { return StrCat(src.name(), " d2h"); });
+  return ConvertDenseGpuTensorToDenseHostTensor(current, src.d2h_stream(),
+                                                tensor, exec_ctx.host());
 }
 
 Expected<DenseGpuTensor> ConvertDenseHostTensorToDenseGpuTensor(
@@ -113,10 +183,41 @@ Expected<DenseGpuTensor> ConvertDenseHostTensorToDenseGpuTensor(
   if (!buffer_or_error) return buffer_or_error.takeError();
   RCReference<gpu::GpuCrtBuffer> buffer = std::move(*buffer_or_error);
 
-  Pointer<const void> memcpy_src(tensor.data(), current_context.platform());
-  if (auto error = MemcpyAsync(current_context, /*dst=*/buffer->pointer(),
-                               /*src=*/memcpy_src, size_in_bytes, stream))
-    return std::move(error);
+  // Copies from pageable memory block the host, so the tensor is staged in a
+  // pinned buffer unless it is pinned already. Large tensors are staged and
+  // copied chunk by chunk, so the device starts reading the first chunk while
+  // the host still stages the rest.
+  auto& pinned_allocator = PinnedHostAllocator::Get(current_context.context());
+  RCReference<HostBuffer> staging_buffer;
+  Clock::time_point start = Clock::now();
+  if (size_in_bytes > 0 &&
+      !pinned_allocator.Contains(tensor.data(), size_in_bytes)) {
+    staging_buffer = HostBuffer::CreateUninitialized(
+        size_in_bytes, alignof(std::max_align_t), &pinned_allocator);
+    if (!staging_buffer)
+      return MakeStringError("could not allocate pinned staging buffer");
+    auto* src = static_cast<const char*>(tensor.data());
+    auto* staging = static_cast<char*>(staging_buffer->data());
+    Pointer<char> dst(buffer->pointer());
+    for (size_t offset = 0; offset < size_in_bytes;
+         offset += kStagingChunkSize) {
+      size_t chunk_size = std::min(kStagingChunkSize, size_in_bytes - offset);
+      std::memcpy(staging + offset, src + offset, chunk_size);
+      Pointer<const void> memcpy_src(staging + offset,
+                                     current_context.platform());
+      if (auto error = MemcpyAsync(current_context, /*dst=*/dst + offset,
+                                   /*src=*/memcpy_src, chunk_size, stream)) {
+        // The chunks enqueued so far still read from the staging buffer.
+        if (offset > 0) llvm::consumeError(StreamSynchronize(stream));
+        return std::move(error);
+      }
+    }
+  } else {
+    Pointer<const void> memcpy_src(tensor.data(), current_context.platform());
+    if (auto error = MemcpyAsync(current_context, /*dst=*/buffer->pointer(),
+                                 /*src=*/memcpy_src, size_in_bytes, stream))
+      return std::move(error);
+  }
 
   llvm::Expected<OwningEvent> event_or_error =
       EventCreate(current_context, EventFlags::DISABLE_TIMING);
@@ -126,27 +227,33 @@ Expected<DenseGpuTensor> ConvertDenseHostTensorToDenseGpuTensor(
 
   if (auto error = EventRecord(event.get(), stream)) return std::move(error);
 
-  // The underlying buffer of `tensor` needs to live until the memcpy is done.
-  bool work_enqueued = EnqueueBlockingWork(
-      host, [tensor = tensor.CopyRef(), event = std::move(event)] {
-        // FIXME(sanjoy): How do we handle an error from EventSynchronize here?
-        llvm::ExitOnError die_if_error;
-        die_if_error(EventSynchronize(event.get()));
-      });
-  if (!work_enqueued) {
-    return MakeStringError(
-        "could not enqueue work to synchronize after issuing host to device "
-        "memcpy in CreateDenseTensorOp");
-  }
+  // The underlying buffer of `tensor` (or the staging buffer) needs to live
+  // until the memcpy is done.
+  wrapper::Event event_handle = event.get();
+  EventManager::Get(current_context.context())
+      .Then(event_handle, host,
+            [tensor = tensor.CopyRef(), event = std::move(event),
+             staging_buffer = std::move(staging_buffer), size_in_bytes,
+             start](llvm::Error error) {
+              // FIXME(sanjoy): How do we handle an error from the event here?
+              llvm::ExitOnError die_if_error;
+              die_if_error(std::move(error));
+              RecordTransfer(GetH2DMetrics(), size_in_bytes, start);
+            });
   return gpu::DenseGpuTensor(tensor.metadata(), std::move(buffer));
 }
 
 static Expected<DenseGpuTensor> DenseHostTensorToDenseGpuTensorConversionFn(
     const DenseHostTensor& tensor, const CpuDevice& src, const GpuDevice& dst,
     const ExecutionContext& exec_ctx) {
-  return ConvertDenseHostTensorToDenseGpuTensor(dst.CreateContext(),
-                                                dst.stream(), dst.allocator(),
-                                                tensor, exec_ctx.host());
+  // Consumers on the compute streams wait for the buffer's stream on dispatch.
+  wrapper::CurrentContext current = dst.CreateContext();
+  GpuTracingScope tracing_scope(
+      current, dst.h2d_stream(), exec_ctx.host(),
+      [] { return std::string("MemcpyHtoD"); },
+      [&] { return StrCat(dst.name(), " h2d"); });
+  return ConvertDenseHostTensorToDenseGpuTensor(
+      current, dst.h2d_stream(), dst.allocator(), tensor, exec_ctx.host());
 }
 
 void RegisterGpuTensorConversionFn(TensorConversionFnRegistry* registry) {
@@ -17,24 +17,57 @@
 // This file implements GPU device.
 #include "tfrt/gpu/device/device.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
 #include "eigen_support.h"
+#include "llvm/ADT/StringExtras.h"
 #include "tfrt/gpu/device/gpu_config.h"
 #include "tfrt/gpu/memory/bfc_gpu_allocator.h"
 #include "tfrt/gpu/memory/gpu_allocator.h"
 #include "tfrt/gpu/wrapper/cublas_wrapper.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/string_util.h"
+#include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
 namespace gpu {
 
 class GpuDevice::Impl {
  public:
-  explicit Impl(int gpu_ordinal) : gpu_ordinal_(gpu_ordinal) {}
+  Impl(int gpu_ordinal, int num_compute_streams)
+      : gpu_ordinal_(gpu_ordinal), num_compute_streams_(num_compute_streams) {}
 
   llvm::Error Initialize();
 
+  // Creates a compute stream with its Eigen device and library handles.
+  llvm::Error AddComputeStream(wrapper::CurrentContext current,
+                               wrapper::Stream stream);
+
+  // A compute stream and the resources that launch work on it.
+  struct ComputeStream {
+    // If `owned_stream` is null, `stream` points to a non-owning stream.
+    wrapper::OwningStream owned_stream;
+    wrapper::Stream stream;
+    wrapper::OwningBlasHandle blas_handle;
+    wrapper::OwningDnnHandle dnn_handle;
+
+    // NB! The declaration order here is important. The eigen_gpu_device
+    // references eigen_stream_interface, which references stream.
+    gpu::OwningEigenStreamInterface eigen_stream_interface;
+    gpu::OwningEigenGpuDevice eigen_gpu_device;
+  };
+
+  const ComputeStream& GetComputeStream(int stream_id) const {
+    assert(stream_id >= 0 && "invalid stream id");
+    return *compute_streams_[stream_id % compute_streams_.size()];
+  }
+
   int gpu_ordinal_;
+  int num_compute_streams_;
 
   // TODO(sanjoy): we need to figure out how the lifetimes of these objects
   // interact with the lifetime of the GPU op handler.
@@ -48,92 +81,176 @@ class GpuDevice::Impl {
   // Otherwise, `context_` is set to be `owned_context_.get()`.
   wrapper::OwningContext owned_context_;
   wrapper::Context context_;
-  // If `owned_stream` is null, `stream_` points to a non-owning stream.
-  // Otherwise, `stream_` is set to be `owned_stream_.get()`.
-  wrapper::OwningStream owned_stream_;
-  wrapper::Stream stream_;
-  wrapper::OwningBlasHandle blas_handle_;
-  wrapper::OwningDnnHandle dnn_handle_;
-
-  // NB! The declaration order here is important. The eigen_gpu_device_
-  // references eigen_stream_interface_, which references stream_.
-  gpu::OwningEigenStreamInterface eigen_stream_interface_;
-  gpu::OwningEigenGpuDevice eigen_gpu_device_;
 
+  std::vector<std::unique_ptr<ComputeStream>> compute_streams_;
+  // If the owned copy streams are null, the copy streams are the external
+  // stream.
+  wrapper::OwningStream owned_h2d_stream_;
+  wrapper::OwningStream owned_d2h_stream_;
+  wrapper::Stream h2d_stream_;
+  wrapper::Stream d2h_stream_;
+
+  // NB! The allocator is destroyed before the streams it allocates on.
   std::unique_ptr<gpu::GpuCrtAllocator> allocator_;
+
+  // Events recorded on the streams that produce buffers, to make the streams
+  // that use them wait.
+  mutable mutex mu_;
+  mutable std::unordered_map<wrapper::Stream, wrapper::OwningEvent>
+      stream_events_ TFRT_GUARDED_BY(mu_);
 };
 
+llvm::Error GpuDevice::Impl::AddComputeStream(wrapper::CurrentContext current,
+                                              wrapper::Stream stream) {
+  auto compute_stream = std::make_unique<ComputeStream>();
+  if (stream == nullptr) {
+    TFRT_ASSIGN_OR_RETURN(
+        compute_stream->owned_stream,
+        StreamCreate(current, wrapper::StreamFlags::DEFAULT));
+    stream = compute_stream->owned_stream.get();
+  }
+  compute_stream->stream = stream;
+
+  compute_stream->eigen_stream_interface =
+      gpu::CreateEigenStreamInterface(stream);
+  compute_stream->eigen_gpu_device = gpu::CreateEigenGpuDevice(
+      compute_stream->eigen_stream_interface.get());
+
+  // TODO(iga): Only log errors during BLAS handle creation?
+  TFRT_ASSIGN_OR_RETURN(compute_stream->blas_handle, BlasCreate(current));
+  if (auto error =
+          wrapper::BlasSetStream(compute_stream->blas_handle.get(), stream))
+    return error;
+  if (auto error = wrapper::CublasSetMathMode(
+          static_cast<cublasHandle_t>(compute_stream->blas_handle.get()),
+          CUBLAS_TENSOR_OP_MATH))
+    return error;
+
+  TFRT_ASSIGN_OR_RETURN(compute_stream->dnn_handle,
+                        wrapper::DnnCreate(current));
+  if (auto error =
+          wrapper::DnnSetStream(compute_stream->dnn_handle.get(), stream))
+    return error;
+
+  compute_streams_.push_back(std::move(compute_stream));
+  return Error::success();
+}
+
 llvm::Error GpuDevice::Impl::Initialize() {
   // TODO(zhangqiaorjc): Generalize to multi-GPU.
   TFRT_ASSIGN_OR_RETURN(device_,
                         DeviceGet(wrapper::Platform::CUDA, gpu_ordinal_));
-  llvm::Optional<wrapper::CurrentContext> current_context;
 
   // Use external GPU resources if they are available.
   if (auto gpu_resources = gpu::GetTfrtGpuResources(device_)) {
     // Set a non-owning context.
     context_ = gpu_resources->gpu_context;
     TFRT_ASSIGN_OR_RETURN(auto current, CtxSetCurrent(context_));
-    current_context.emplace(current);
 
     allocator_ = std::unique_ptr<gpu::GpuCrtAllocator>(
         gpu_resources->allocator_factory(context_));
 
-    stream_ = gpu_resources->stream;
-  } else {
-    TFRT_ASSIGN_OR_RETURN(owned_context_, DevicePrimaryCtxRetain(device_));
-    context_ = owned_context_.get();
-    TFRT_ASSIGN_OR_RETURN(auto current, CtxSetCurrent(context_));
-    current_context.emplace(current);
-
-    TFRT_ASSIGN_OR_RETURN(owned_stream_,
-                          StreamCreate(current, wrapper::StreamFlags::DEFAULT));
-    stream_ = owned_stream_.get();
-
-    allocator_ = std::unique_ptr<gpu::GpuCrtAllocator>(
-        new gpu::BfcGpuAllocator(current));
+    // All the work runs on the external stream.
+    if (auto error = AddComputeStream(current, gpu_resources->stream))
+      return error;
+    h2d_stream_ = d2h_stream_ = gpu_resources->stream;
+    return Error::success();
   }
 
-  eigen_stream_interface_ = gpu::CreateEigenStreamInterface(stream_);
-  eigen_gpu_device_ = gpu::CreateEigenGpuDevice(eigen_stream_interface_.get());
+  TFRT_ASSIGN_OR_RETURN(owned_context_, DevicePrimaryCtxRetain(device_));
+  context_ = owned_context_.get();
+  TFRT_ASSIGN_OR_RETURN(auto current, CtxSetCurrent(context_));
 
-  // TODO(iga): Only log errors during BLAS handle creation?
-  TFRT_ASSIGN_OR_RETURN(blas_handle_, BlasCreate(*current_context));
-  if (auto error = wrapper::BlasSetStream(blas_handle_.get(), stream_))
-    return error;
-  if (auto error = wrapper::CublasSetMathMode(
-          static_cast<cublasHandle_t>(blas_handle_.get()),
-          CUBLAS_TENSOR_OP_MATH))
-    return error;
+  for (int i = 0; i < std::max(num_compute_streams_, 1); ++i)
+    if (auto error = AddComputeStream(current, /*stream=*/nullptr))
+      return error;
 
-  TFRT_ASSIGN_OR_RETURN(dnn_handle_, wrapper::DnnCreate(*current_context));
-  if (auto error = wrapper::DnnSetStream(dnn_handle_.get(), stream_))
-    return error;
+  TFRT_ASSIGN_OR_RETURN(
+      owned_h2d_stream_,
+      StreamCreate(current, wrapper::StreamFlags::DEFAULT));
+  TFRT_ASSIGN_OR_RETURN(
+      owned_d2h_stream_,
+      StreamCreate(current, wrapper::StreamFlags::DEFAULT));
+  h2d_stream_ = owned_h2d_stream_.get();
+  d2h_stream_ = owned_d2h_stream_.get();
+
+  allocator_ = std::unique_ptr<gpu::GpuCrtAllocator>(
+      new gpu::BfcGpuAllocator(current));
 
   return Error::success();
 }
 
-GpuDevice::GpuDevice(string_view name, int gpu_ordinal)
-    : Device(kDeviceType, name), impl_(std::make_unique<Impl>(gpu_ordinal)) {}
+GpuDevice::GpuDevice(string_view name, int gpu_ordinal, int num_compute_streams)
+    : Device(kDeviceType, name),
+      impl_(std::make_unique<Impl>(gpu_ordinal, num_compute_streams)) {}
+
+int GpuDevice::GetNumComputeStreamsFromEnv() {
+  static const int num_compute_streams = [] {
+    const char* env = std::getenv("TFRT_GPU_NUM_COMPUTE_STREAMS");
+    int value;
+    if (env && llvm::to_integer(env, value) && value > 0) return value;
+    return 2;
+  }();
+  return num_compute_streams;
+}
 
 llvm::Error GpuDevice::Initialize() { return impl_->Initialize(); }
 
-wrapper::Stream GpuDevice::stream() const { return impl_->stream_; }
+int GpuDevice::num_compute_streams() const {
+  return impl_->compute_streams_.size();
+}
+
+wrapper::Stream GpuDevice::stream(int stream_id) const {
+  return impl_->GetComputeStream(stream_id).stream;
+}
+
+wrapper::Stream GpuDevice::h2d_stream() const { return impl_->h2d_stream_; }
+
+wrapper::Stream GpuDevice::d2h_stream() const { return impl_->d2h_stream_; }
 
 gpu::GpuCrtAllocator* GpuDevice::allocator() const {
   return impl_->allocator_.get();
 }
 
-Eigen::GpuDevice* GpuDevice::eigen_gpu_device() const {
-  return impl_->eigen_gpu_device_.get();
+Eigen::GpuDevice* GpuDevice::eigen_gpu_device(int stream_id) const {
+  return impl_->GetComputeStream(stream_id).eigen_gpu_device.get();
 }
 
-wrapper::BlasHandle GpuDevice::blas_handle() const {
-  return impl_->blas_handle_.get();
+wrapper::BlasHandle GpuDevice::blas_handle(int stream_id) const {
+  return impl_->GetComputeStream(stream_id).blas_handle.get();
 }
 
-wrapper::DnnHandle GpuDevice::dnn_handle() const {
-  return impl_->dnn_handle_.get();
+wrapper::DnnHandle GpuDevice::dnn_handle(int stream_id) const {
+  return impl_->GetComputeStream(stream_id).dnn_handle.get();
+}
+
+llvm::Error GpuDevice::WaitForBuffer(const GpuCrtBuffer& buffer,
+                                     wrapper::Stream stream) const {
+  // Externally allocated buffers are synchronized by their owner.
+  wrapper::Stream producer = buffer.stream();
+  if (producer == nullptr || producer == stream) return Error::success();
+
+  {
+    mutex_lock lock(impl_->mu_);
+    wrapper::OwningEvent& event = impl_->stream_events_[producer];
+    if (!event) {
+      TFRT_ASSIGN_OR_RETURN(auto current, SetCurrentContext());
+      TFRT_ASSIGN_OR_RETURN(
+          event, wrapper::EventCreate(current,
+                                      wrapper::EventFlags::DISABLE_TIMING));
+    }
+    // The buffer is available on the host, so the work that produces it has
+    // been enqueued on the producer stream.
+    if (auto error = wrapper::EventRecord(event.get(), producer)) return error;
+    if (auto error = wrapper::StreamWaitEvent(stream, event.get()))
+      return error;
+  }
+
+  // The allocator tracks the usage of sub-buffers on their owner.
+  const GpuCrtBuffer& owner = buffer.owner();
+  if (GpuCrtAllocator* allocator = owner.allocator())
+    return allocator->RecordUsage(owner, stream);
+  return Error::success();
 }
 
 wrapper::CurrentContext GpuDevice::CreateContext() const {
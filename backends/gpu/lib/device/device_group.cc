@@ -0,0 +1,185 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements GpuDeviceGroup.
+#include "tfrt/gpu/device/device_group.h"
+
+#include <utility>
+
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace gpu {
+
+static size_t GetCount(const GpuCrtBuffer& buffer, ncclDataType_t data_type) {
+  return buffer.size() / wrapper::GetCclDataTypeSizeBytes(data_type);
+}
+
+// Returns the pointer of `buffer`, or a null pointer of `platform`.
+static wrapper::Pointer<const void> GetPointer(const GpuCrtBuffer* buffer,
+                                               wrapper::Platform platform) {
+  if (!buffer) return wrapper::Pointer<const void>(nullptr, platform);
+  return buffer->pointer();
+}
+
+llvm::Expected<std::unique_ptr<GpuDeviceGroup>> GpuDeviceGroup::Create(
+    ArrayRef<RCReference<GpuDevice>> devices) {
+  if (devices.empty()) return MakeStringError("Empty device group.");
+
+  std::vector<Rank> ranks;
+  ranks.reserve(devices.size());
+  for (const auto& device : devices) {
+    Rank rank;
+    rank.device = device.CopyRef();
+    TFRT_ASSIGN_OR_RETURN(auto current, device->SetCurrentContext());
+    TFRT_ASSIGN_OR_RETURN(
+        rank.stream,
+        wrapper::StreamCreate(current, wrapper::StreamFlags::NON_BLOCKING));
+    TFRT_ASSIGN_OR_RETURN(
+        rank.event,
+        wrapper::EventCreate(current, wrapper::EventFlags::DISABLE_TIMING));
+    ranks.push_back(std::move(rank));
+  }
+
+  // Don't keep a CurrentContext instance, the loop below switches contexts.
+  auto platform = ranks.front().stream.get().platform();
+  TFRT_ASSIGN_OR_RETURN(auto id, wrapper::CclGetUniqueId(platform));
+
+  // All ranks are initialized from this thread, which requires a group.
+  if (auto error = wrapper::CclGroupStart(platform)) return std::move(error);
+  int num_ranks = ranks.size();
+  llvm::Error error = llvm::Error::success();
+  for (int i = 0; i < num_ranks && !error; ++i) {
+    auto comm = [&]() -> llvm::Expected<wrapper::OwningCclComm> {
+      TFRT_ASSIGN_OR_RETURN(auto current, devices[i]->SetCurrentContext());
+      return wrapper::CclCommInitRank(current, num_ranks, id, i);
+    }();
+    if (comm)
+      ranks[i].comm = std::move(*comm);
+    else
+      error = comm.takeError();
+  }
+  error = joinErrors(std::move(error), wrapper::CclGroupEnd(platform));
+  if (error) return std::move(error);
+
+  return std::unique_ptr<GpuDeviceGroup>(new GpuDeviceGroup(std::move(ranks)));
+}
+
+GpuDeviceGroup::GpuDeviceGroup(std::vector<Rank> ranks)
+    : ranks_(std::move(ranks)) {}
+
+GpuDeviceGroup::~GpuDeviceGroup() = default;
+
+llvm::Error GpuDeviceGroup::Run(
+    ArrayRef<const GpuCrtBuffer*> inputs, ArrayRef<const GpuCrtBuffer*> outputs,
+    llvm::function_ref<llvm::Error(int rank, wrapper::CurrentContext current)>
+        enqueue) {
+  if (inputs.size() != ranks_.size() || outputs.size() != ranks_.size()) {
+    return MakeStringError("Expected ", size(), " input and output buffers, ",
+                           "got ", inputs.size(), " and ", outputs.size());
+  }
+  if (llvm::is_contained(outputs, nullptr))
+    return MakeStringError("Output buffers must not be null.");
+
+  mutex_lock lock(mu_);
+
+  // Wait for the producers of the buffers on the collective streams.
+  for (int i = 0; i < size(); ++i) {
+    for (const GpuCrtBuffer* buffer : {inputs[i], outputs[i]}) {
+      if (!buffer) continue;
+      if (auto error = device(i).WaitForBuffer(*buffer, stream(i)))
+        return error;
+    }
+  }
+
+  auto platform = stream(0).platform();
+  if (auto error = wrapper::CclGroupStart(platform)) return error;
+  llvm::Error error = llvm::Error::success();
+  for (int i = 0; i < size() && !error; ++i) {
+    auto current = device(i).SetCurrentContext();
+    error = current ? enqueue(i, *current) : current.takeError();
+  }
+  error = joinErrors(std::move(error), wrapper::CclGroupEnd(platform));
+  if (error) return error;
+
+  // Make the streams of the output buffers wait for the collectives.
+  for (int i = 0; i < size(); ++i) {
+    wrapper::Stream consumer = outputs[i]->stream();
+    if (consumer == nullptr || consumer == stream(i)) continue;
+    if (auto error = device(i).SetCurrentContext().takeError()) return error;
+    const wrapper::OwningEvent& event = ranks_[i].event;
+    if (auto error = wrapper::EventRecord(event.get(), stream(i))) return error;
+    if (auto error = wrapper::StreamWaitEvent(consumer, event.get()))
+      return error;
+  }
+
+  return Error::success();
+}
+
+llvm::Error GpuDeviceGroup::AllReduce(ArrayRef<const GpuCrtBuffer*> inputs,
+                                      ArrayRef<const GpuCrtBuffer*> outputs,
+                                      ncclDataType_t data_type,
+                                      ncclRedOp_t reduction_op) {
+  return Run(inputs, outputs, [&](int rank, wrapper::CurrentContext current) {
+    auto input = GetPointer(inputs[rank], current.platform());
+    return wrapper::CclAllReduce(
+        current, input, outputs[rank]->pointer(),
+        GetCount(*outputs[rank], data_type), data_type, reduction_op,
+        comm(rank), stream(rank));
+  });
+}
+
+llvm::Error GpuDeviceGroup::AllGather(ArrayRef<const GpuCrtBuffer*> inputs,
+                                      ArrayRef<const GpuCrtBuffer*> outputs,
+                                      ncclDataType_t data_type) {
+  return Run(inputs, outputs, [&](int rank, wrapper::CurrentContext current) {
+    auto input = GetPointer(inputs[rank], current.platform());
+    return wrapper::CclAllGather(
+        current, input, outputs[rank]->pointer(),
+        GetCount(*outputs[rank], data_type) / size(), data_type, comm(rank),
+        stream(rank));
+  });
+}
+
+llvm::Error GpuDeviceGroup::ReduceScatter(ArrayRef<const GpuCrtBuffer*> inputs,
+                                          ArrayRef<const GpuCrtBuffer*> outputs,
+                                          ncclDataType_t data_type,
+                                          ncclRedOp_t reduction_op) {
+  return Run(inputs, outputs, [&](int rank, wrapper::CurrentContext current) {
+    auto input = GetPointer(inputs[rank], current.platform());
+    return wrapper::CclReduceScatter(
+        current, input, outputs[rank]->pointer(),
+        GetCount(*outputs[rank], data_type), data_type, reduction_op,
+        comm(rank), stream(rank));
+  });
+}
+
+llvm::Error GpuDeviceGroup::Broadcast(ArrayRef<const GpuCrtBuffer*> inputs,
+                                      ArrayRef<const GpuCrtBuffer*> outputs,
+                                      ncclDataType_t data_type, int root) {
+  if (root < 0 || root >= inputs.size() || !inputs[root])
+    return MakeStringError("Invalid broadcast root: ", root);
+  return Run(inputs, outputs, [&](int rank, wrapper::CurrentContext current) {
+    auto input = GetPointer(inputs[rank], current.platform());
+    return wrapper::CclBroadcast(
+        current, input, outputs[rank]->pointer(),
+        GetCount(*outputs[rank], data_type), data_type, root, comm(rank),
+        stream(rank));
+  });
+}
+
+}  // namespace gpu
+}  // namespace tfrt
@@ -22,6 +22,7 @@
 #include "tfrt/gpu/device/device.h"
 #include "tfrt/host_context/device.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/memory_pressure.h"
 #include "tfrt/support/string_util.h"
 
 namespace tfrt {
@@ -39,11 +40,21 @@ llvm::Expected<RCReference<GpuDevice>> GetOrCreateGpuDevice(string_view name,
     return std::move(existing_device);
   }
   auto gpu_device = MakeRef<GpuDevice>(name, gpu_ordinal);
+  GpuDevice* gpu_device_ptr = gpu_device.get();
   if (auto error = gpu_device->Initialize()) {
     return std::move(error);
   }
 
-  return host->GetDeviceManager()->MaybeAddDevice(std::move(gpu_device));
+  auto device = host->GetDeviceManager()->MaybeAddDevice(std::move(gpu_device));
+  // Only the device that was added reports its usage. The device manager keeps
+  // it alive as long as the host.
+  if (device.get() == gpu_device_ptr) {
+    MemoryPressure::Get(host).AddSource(
+        [allocator = device->allocator()] {
+          return allocator->GetMemoryUsage();
+        });
+  }
+  return std::move(device);
 }
 
 }  // namespace gpu
@@ -0,0 +1,119 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements EventManager.
+
+#include "tfrt/gpu/device/event_manager.h"
+
+#include <chrono>
+#include <iterator>
+#include <thread>
+#include <unordered_map>
+
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+namespace gpu {
+
+// Delay between two polls of the pending events, if none has completed.
+static constexpr auto kPollingDelay = std::chrono::microseconds(10);
+
+EventManager& EventManager::Get(wrapper::Context context) {
+  static auto* mu = new mutex;
+  static auto* managers =
+      new std::unordered_map<wrapper::Context, std::unique_ptr<EventManager>>;
+
+  mutex_lock lock(*mu);
+  std::unique_ptr<EventManager>& manager = (*managers)[context];
+  if (!manager) manager.reset(new EventManager);
+  return *manager;
+}
+
+EventManager::EventManager() {
+  poller_ = ThreadingEnvironment::StartThread("tfrt-gpu-events",
+                                              [this] { PollEvents(); });
+}
+
+EventManager::~EventManager() {
+  {
+    mutex_lock lock(mu_);
+    shutdown_ = true;
+  }
+  cv_.notify_one();
+  // Joins the poller thread after all the pending events have completed.
+  poller_.reset();
+}
+
+void EventManager::Then(wrapper::Event event, HostContext* host,
+                        Callback callback) {
+  {
+    mutex_lock lock(mu_);
+    pending_.push_back({event, host, std::move(callback)});
+  }
+  cv_.notify_one();
+}
+
+AsyncValueRef<Chain> EventManager::Then(wrapper::OwningEvent event,
+                                        HostContext* host) {
+  auto chain = MakeUnconstructedAsyncValueRef<Chain>(host);
+  wrapper::Event event_handle = event.get();
+  Then(event_handle, host,
+       [event = std::move(event), chain = chain.CopyRef()](llvm::Error error) {
+         if (error) return chain.SetError(StrCat(error));
+         chain.emplace();
+       });
+  return chain;
+}
+
+void EventManager::PollEvents() {
+  // Events that did not complete in the previous poll.
+  std::vector<PendingEvent> polled;
+
+  while (true) {
+    {
+      mutex_lock lock(mu_);
+      if (polled.empty())
+        cv_.wait(lock, [&] { return shutdown_ || !pending_.empty(); });
+      if (shutdown_ && pending_.empty() && polled.empty()) return;
+      std::move(pending_.begin(), pending_.end(), std::back_inserter(polled));
+      pending_.clear();
+    }
+
+    // Query the events without holding the lock, and pass the callbacks of
+    // the completed ones to the host work queue.
+    std::vector<PendingEvent> not_ready;
+    for (PendingEvent& pending : polled) {
+      llvm::Expected<bool> ready = wrapper::EventQuery(pending.event);
+      if (ready && !*ready) {
+        not_ready.push_back(std::move(pending));
+        continue;
+      }
+      llvm::Error error = ready ? llvm::Error::success() : ready.takeError();
+      EnqueueWork(pending.host, [callback = std::move(pending.callback),
+                                 error = std::move(error)]() mutable {
+        callback(std::move(error));
+      });
+    }
+
+    bool made_progress = not_ready.size() < polled.size();
+    polled = std::move(not_ready);
+    if (!made_progress) std::this_thread::sleep_for(kPollingDelay);
+  }
+}
+
+}  // namespace gpu
+}  // namespace tfrt
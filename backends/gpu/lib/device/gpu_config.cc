@@ -19,8 +19,10 @@
 #include <unordered_map>
 
 #include "llvm/ADT/Optional.h"
+#include "tfrt/gpu/memory/async_gpu_allocator.h"
 #include "tfrt/gpu/memory/bfc_gpu_allocator.h"
 #include "tfrt/gpu/wrapper/hash_utils.h"
+#include "tfrt/support/logging.h"
 #include "tfrt/support/mutex.h"
 
 namespace tfrt {
@@ -68,5 +70,17 @@ llvm::Optional<GpuResources> GetTfrtGpuResources(wrapper::Device device) {
   return GetGpuResourcesMap()->GetResources(device);
 }
 
+GpuAllocatorFactory CreateAsyncGpuAllocatorFactory(uint64_t release_threshold) {
+  return [=](const wrapper::Context& context) -> GpuCrtAllocator* {
+    llvm::ExitOnError die_if_error;
+    auto current = die_if_error(wrapper::CtxSetCurrent(context));
+    auto allocator = AsyncGpuAllocator::Create(current, release_threshold);
+    if (allocator) return allocator->release();
+    TFRT_LOG(WARNING) << "Falling back to BfcGpuAllocator: "
+                      << allocator.takeError();
+    return new BfcGpuAllocator(current);
+  };
+}
+
 }  // namespace gpu
 }  // namespace tfrt
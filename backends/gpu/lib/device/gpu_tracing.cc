@@ -0,0 +1,142 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements GpuTracingScope.
+
+#include "tfrt/gpu/device/gpu_tracing.h"
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+#include "tfrt/gpu/device/event_manager.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
+#include "tfrt/support/mutex.h"
+
+namespace tfrt {
+namespace gpu {
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+// An event of a context and the host time when it completed.
+struct ClockAnchor {
+  wrapper::OwningEvent event;
+  Clock::time_point time;
+};
+}  // namespace
+
+// Returns the clock anchor of the current context, recording and synchronizing
+// it on `stream` if the context doesn't have one yet.
+static llvm::Expected<const ClockAnchor*> GetClockAnchor(
+    wrapper::CurrentContext current, wrapper::Stream stream) {
+  static auto* mu = new mutex;
+  static auto* anchors =
+      new std::unordered_map<wrapper::Context, std::unique_ptr<ClockAnchor>>;
+
+  mutex_lock lock(*mu);
+  auto& anchor = (*anchors)[current.context()];
+  if (anchor) return anchor.get();
+
+  TFRT_ASSIGN_OR_RETURN(auto event, wrapper::EventCreate(
+                                        current, wrapper::EventFlags::DEFAULT));
+  if (auto error = wrapper::EventRecord(event.get(), stream))
+    return std::move(error);
+  if (auto error = wrapper::EventSynchronize(event.get()))
+    return std::move(error);
+  anchor.reset(new ClockAnchor{std::move(event), Clock::now()});
+  return anchor.get();
+}
+
+struct GpuTracingScope::Activity {
+  wrapper::Context context;
+  wrapper::Stream stream;
+  HostContext* host;
+  std::string name;
+  std::string track;
+  uint64_t flow_id;
+  const ClockAnchor* anchor;
+  wrapper::OwningEvent start;
+  wrapper::OwningEvent end;
+};
+
+static Clock::duration ToDuration(float milliseconds) {
+  return std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<float, std::milli>(milliseconds));
+}
+
+llvm::Error GpuTracingScope::RecordActivity(Activity& activity) {
+  TFRT_ASSIGN_OR_RETURN(float begin_ms,
+                        wrapper::EventElapsedTime(activity.anchor->event.get(),
+                                                  activity.start.get()));
+  // Derive the end from the elapsed time between the two events, which is more
+  // precise than the elapsed time since the anchor.
+  TFRT_ASSIGN_OR_RETURN(float duration_ms,
+                        wrapper::EventElapsedTime(activity.start.get(),
+                                                  activity.end.get()));
+  auto begin = activity.anchor->time + ToDuration(begin_ms);
+  tracing::RecordTracingActivity(
+      tracing::TracingLevel::Default, [&] { return std::move(activity.name); },
+      activity.track, begin, begin + ToDuration(duration_ms),
+      activity.flow_id);
+  return llvm::Error::success();
+}
+
+GpuTracingScope::GpuTracingScope(wrapper::CurrentContext current,
+                                 wrapper::Stream stream, HostContext* host,
+                                 tracing::TracingSink::NameGenerator name,
+                                 tracing::TracingSink::NameGenerator track) {
+  if (!tracing::IsTracingEnabled(tracing::TracingLevel::Default)) return;
+
+  auto activity = [&]() -> llvm::Expected<std::unique_ptr<Activity>> {
+    TFRT_ASSIGN_OR_RETURN(auto anchor, GetClockAnchor(current, stream));
+    auto flags = wrapper::EventFlags::DEFAULT;
+    TFRT_ASSIGN_OR_RETURN(auto start, wrapper::EventCreate(current, flags));
+    TFRT_ASSIGN_OR_RETURN(auto end, wrapper::EventCreate(current, flags));
+    if (auto error = wrapper::EventRecord(start.get(), stream))
+      return std::move(error);
+    return std::unique_ptr<Activity>(new Activity{
+        current.context(), stream, host, name(), track(),
+        tracing::NewTracingFlowId(), anchor, std::move(start), std::move(end)});
+  }();
+  if (!activity) {
+    TFRT_LOG(WARNING) << "Failed to trace GPU activity: "
+                      << activity.takeError();
+    return;
+  }
+  activity_ = std::move(*activity);
+  tracing::RecordTracingFlow(tracing::TracingLevel::Default,
+                             activity_->flow_id);
+}
+
+GpuTracingScope::~GpuTracingScope() {
+  if (!activity_) return;
+
+  wrapper::Event end = activity_->end.get();
+  if (auto error = wrapper::EventRecord(end, activity_->stream)) {
+    TFRT_LOG(WARNING) << "Failed to trace GPU activity: " << error;
+    return;
+  }
+  EventManager::Get(activity_->context)
+      .Then(end, activity_->host,
+            [activity = std::move(activity_)](llvm::Error error) {
+              if (!error) error = RecordActivity(*activity);
+              if (error)
+                TFRT_LOG(WARNING) << "Failed to trace GPU activity: " << error;
+            });
+}
+
+}  // namespace gpu
+}  // namespace tfrt
@@ -18,19 +18,41 @@
 #include "tfrt/gpu/wrapper/blas_wrapper.h"
 #include "tfrt/gpu/wrapper/dnn_wrapper.h"
 #include "tfrt/gpu/wrapper/driver_wrapper.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
 namespace gpu {
+// The modules of a GpuContext. The map only holds the lock while looking up
+// the entry of a key, and each entry holds its own lock while loading the
+// module, so that different modules load concurrently.
+struct GpuContext::ModuleCache {
+  struct Entry {
+    mutex mu;
+    wrapper::OwningModule module TFRT_GUARDED_BY(mu);
+  };
+
+  mutex mu;
+  llvm::DenseMap<uint64_t, std::unique_ptr<Entry>> entries TFRT_GUARDED_BY(mu);
+};
+
 GpuContext::GpuContext(wrapper::OwningContext context)
-    : context_(std::move(context)) {}
+    : context_(std::move(context)),
+      module_cache_(std::make_unique<ModuleCache>()) {}
 
 GpuContext::~GpuContext() = default;
 
 wrapper::Context GpuContext::release() {
-  modules_.clear();           // Clear modules map.
+  if (module_cache_) {
+    mutex_lock lock(module_cache_->mu);
+    module_cache_->entries.clear();  // Clear modules map.
+  }
   return context_.release();  // Release OwningContext.
 }
 
@@ -57,10 +79,18 @@ static llvm::Expected<wrapper::OwningModule> LoadModule(
 
 Expected<wrapper::Module> GpuContext::LoadModule(uint64_t key,
                                                  string_view data) {
-  auto it = modules_.find(key);
-  if (it != modules_.end()) {
+  ModuleCache::Entry* entry;
+  {
+    mutex_lock lock(module_cache_->mu);
+    auto& ptr = module_cache_->entries[key];
+    if (!ptr) ptr = std::make_unique<ModuleCache::Entry>();
+    entry = ptr.get();
+  }
+
+  mutex_lock lock(entry->mu);
+  if (entry->module) {
     // Returned cached module.
-    return it->second.get();
+    return entry->module.get();
   }
 
   if (data.empty() || data.back() != 0)
@@ -72,10 +102,36 @@ Expected<wrapper::Module> GpuContext::LoadModule(uint64_t key,
   auto module = gpu::LoadModule(*current, data);
   if (!module) return module.takeError();
 
-  auto pair = modules_.try_emplace(key, std::move(*module));
-  assert(pair.second && "failed to insert into map");
+  entry->module = std::move(*module);
+  return entry->module.get();
+}
+
+AsyncValueRef<Chain> LoadModules(AsyncValueRef<GpuContext> context,
+                                 ArrayRef<GpuModuleImage> images,
+                                 HostContext* host) {
+  if (images.empty()) return GetReadyChain(host);
+
+  SmallVector<AsyncValueRef<Chain>, 8> results;
+  SmallVector<AsyncValue*, 8> values;
+  results.reserve(images.size());
+  for (const GpuModuleImage& image : images) {
+    results.push_back(EnqueueBlockingWork(
+        host, [context = context.CopyRef(), image]() -> Expected<Chain> {
+          auto module = context->LoadModule(image.key, image.data);
+          if (!module) return module.takeError();
+          return Chain();
+        }));
+    values.push_back(results.back().GetAsyncValue());
+  }
 
-  return pair.first->second.get();
+  auto chain = MakeUnconstructedAsyncValueRef<Chain>(host);
+  RunWhenReady(values, [results = std::move(results), chain = chain.CopyRef()] {
+    for (const auto& result : results) {
+      if (result.IsError()) return chain.SetError(result.GetError());
+    }
+    chain.emplace();
+  });
+  return chain;
 }
 
 GpuStream::GpuStream(AsyncValueRef<GpuContext> context,
@@ -220,5 +276,11 @@ GpuSolverHandle::GpuSolverHandle(AsyncValueRef<GpuStream> stream,
 
 GpuSolverHandle::~GpuSolverHandle() = default;
 
+GpuCclHandle::GpuCclHandle(AsyncValueRef<GpuContext> context,
+                           wrapper::OwningCclComm comm)
+    : context_(std::move(context)), comm_(std::move(comm)) {}
+
+GpuCclHandle::~GpuCclHandle() = default;
+
 }  // namespace gpu
 }  // namespace tfrt
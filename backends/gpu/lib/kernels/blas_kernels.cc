@@ -16,13 +16,16 @@
 #include <cstdint>
 
 #include "kernels_detail.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Errc.h"
 #include "tfrt/gpu/gpu_types.h"
 #include "tfrt/gpu/wrapper/blas_wrapper.h"
 #include "tfrt/gpu/wrapper/cublas_wrapper.h"
+#include "tfrt/gpu/wrapper/driver_wrapper.h"
 #include "tfrt/gpu/wrapper/rocblas_wrapper.h"
 #include "tfrt/gpu/wrapper/wrapper.h"
 #include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/support/error_util.h"
 
 namespace tfrt {
 namespace gpu {
@@ -120,6 +123,60 @@ static Error BlasGemmBatch(
       batchCount, wrapper::BlasDataType::FromOpaqueValue(*computeType), algo);
 }
 
+// Computes a group of independent GEMMs of the same shape, passed as buffers
+// A0..An-1, B0..Bn-1, C0..Cn-1, with a single batched BLAS call.
+static Error BlasGemmGrouped(
+    const GpuBlasHandle& handle, int32_t m, int32_t n, int32_t k, float alpha,
+    int32_t heightA, int32_t heightB, float beta, int32_t heightC,
+    wrapper::BlasGemmAlgo algo, Chain, RemainingArguments buffers,
+    // Needs to be sorted alphabetically by attribute name!
+    Attribute<int32_t> computeType, Attribute<int32_t> transA,
+    Attribute<int32_t> transB, Attribute<int32_t> typeA,
+    Attribute<int32_t> typeB, Attribute<int32_t> typeC) {
+  if (buffers.size() == 0 || buffers.size() % 3 != 0) {
+    return MakeStringError("Expected a positive multiple of 3 buffers, got ",
+                           buffers.size());
+  }
+  int batch_count = buffers.size() / 3;
+
+  auto current = wrapper::CtxSetCurrent(handle.context());
+  if (!current) return current.takeError();
+  auto stream = wrapper::BlasGetStream(handle.get());
+  if (!stream) return stream.takeError();
+
+  llvm::SmallVector<void*, 24> pointers;
+  pointers.reserve(buffers.size());
+  for (const auto& buffer : buffers.values())
+    pointers.push_back(buffer->get<GpuBuffer>().pointer().raw());
+
+  // The batched BLAS call expects the matrix pointer arrays in device memory.
+  size_t size_bytes = pointers.size() * sizeof(void*);
+  auto memory = wrapper::MemAlloc(*current, size_bytes);
+  if (!memory) return memory.takeError();
+  auto platform = current->platform();
+  if (auto error = wrapper::MemcpyAsync(
+          *current, memory->get(),
+          wrapper::Pointer<const void>(pointers.data(), platform), size_bytes,
+          *stream))
+    return error;
+
+  wrapper::Pointer<const float> alpha_ptr(&alpha, platform);
+  wrapper::Pointer<const float> beta_ptr(&beta, platform);
+  wrapper::Pointer<const void*> a_array(memory->get());
+  wrapper::Pointer<void*> c_array(memory->get());
+
+  // Freeing 'memory' when it goes out of scope waits for the GEMMs to
+  // complete.
+  return wrapper::BlasGemmBatchedEx(
+      *current, handle.get(), wrapper::BlasOperation::FromOpaqueValue(*transA),
+      wrapper::BlasOperation::FromOpaqueValue(*transB), m, n, k, alpha_ptr,
+      a_array, wrapper::BlasDataType::FromOpaqueValue(*typeA), heightA,
+      a_array + batch_count, wrapper::BlasDataType::FromOpaqueValue(*typeB),
+      heightB, beta_ptr, c_array + 2 * batch_count,
+      wrapper::BlasDataType::FromOpaqueValue(*typeC), heightC, batch_count,
+      wrapper::BlasDataType::FromOpaqueValue(*computeType), algo);
+}
+
 void RegisterGpuBlasKernels(KernelRegistry* kernel_reg) {
   kernel_reg->AddKernel("tfrt_gpu.blas.create", TFRT_KERNEL(BlasCreate));
   kernel_reg->AddKernel("tfrt_gpu.blas.axpy",
@@ -129,6 +186,8 @@ void RegisterGpuBlasKernels(KernelRegistry* kernel_reg) {
                         TFRT_KERNEL_WITH_CHAIN_RESULT(BlasGemm));
   kernel_reg->AddKernel("tfrt_gpu.blas.gemm.batch",
                         TFRT_KERNEL_WITH_CHAIN_RESULT(BlasGemmBatch));
+  kernel_reg->AddKernel("tfrt_gpu.blas.gemm.grouped",
+                        TFRT_KERNEL_WITH_CHAIN_RESULT(BlasGemmGrouped));
 }
 }  // namespace gpu
 }  // namespace tfrt
@@ -0,0 +1,155 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the tfrt_gpu.ccl kernels.
+#include <cstdint>
+
+#include "kernels_detail.h"
+#include "tfrt/gpu/gpu_types.h"
+#include "tfrt/gpu/wrapper/ccl_wrapper.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace gpu {
+
+// tfrt_gpu.ccl.unique_id returns a new id to create a clique of communicators.
+static Expected<ncclUniqueId> CclUniqueId(Attribute<int32_t> platform) {
+  return wrapper::CclGetUniqueId(static_cast<wrapper::Platform>(*platform));
+}
+
+// tfrt_gpu.ccl.create creates the communicator of 'rank' in the clique
+// identified by 'id'. The result becomes available once all 'count' ranks of
+// the clique have been created. This kernel does not block the caller thread.
+static AsyncValueRef<GpuCclHandle> CclCreate(Argument<GpuContext> context,
+                                             int32_t rank, int32_t count,
+                                             const ncclUniqueId& id,
+                                             const ExecutionContext& exec_ctx) {
+  return EnqueueBlockingWork(
+      exec_ctx,
+      [context = context.ValueRef(), rank, count,
+       id]() -> Expected<GpuCclHandle> {
+        auto current = wrapper::CtxSetCurrent(context->get());
+        if (!current) return current.takeError();
+        auto comm = wrapper::CclCommInitRank(*current, count, id, rank);
+        if (!comm) return comm.takeError();
+        return GpuCclHandle(context.CopyRef(), std::move(*comm));
+      });
+}
+
+static Error CheckBufferSizes(const GpuBuffer& input, const GpuBuffer& output,
+                              size_t input_count, size_t output_count,
+                              ncclDataType_t data_type) {
+  size_t element_size = wrapper::GetCclDataTypeSizeBytes(data_type);
+  if (input.size() < input_count * element_size) {
+    return MakeStringError("Input buffer is too small: ", input.size(), " < ",
+                           input_count * element_size);
+  }
+  if (output.size() < output_count * element_size) {
+    return MakeStringError("Output buffer is too small: ", output.size(),
+                           " < ", output_count * element_size);
+  }
+  return Error::success();
+}
+
+// tfrt_gpu.ccl.all_reduce reduces the input buffers of all ranks and writes
+// the result to the output buffer of each rank.
+static Error CclAllReduce(
+    const GpuCclHandle& handle, const GpuBuffer& input, const GpuBuffer& output,
+    const GpuStream& stream,
+    // Needs to be sorted alphabetically by attribute name!
+    Attribute<int32_t> dataType, Attribute<int32_t> reductionOp) {
+  auto data_type = static_cast<ncclDataType_t>(*dataType);
+  size_t count = output.size() / wrapper::GetCclDataTypeSizeBytes(data_type);
+  if (auto error = CheckBufferSizes(input, output, count, count, data_type))
+    return error;
+  auto current = wrapper::CtxSetCurrent(handle.context());
+  if (!current) return current.takeError();
+  return wrapper::CclAllReduce(*current, input.pointer(), output.pointer(),
+                               count, data_type,
+                               static_cast<ncclRedOp_t>(*reductionOp),
+                               handle.get(), stream.get());
+}
+
+// tfrt_gpu.ccl.all_gather concatenates the input buffers of all ranks in rank
+// order and writes the result to the output buffer of each rank.
+static Error CclAllGather(const GpuCclHandle& handle, const GpuBuffer& input,
+                          const GpuBuffer& output, const GpuStream& stream,
+                          Attribute<int32_t> dataType) {
+  auto data_type = static_cast<ncclDataType_t>(*dataType);
+  auto num_ranks = wrapper::CclCommCount(handle.get());
+  if (!num_ranks) return num_ranks.takeError();
+  size_t count = input.size() / wrapper::GetCclDataTypeSizeBytes(data_type);
+  if (auto error = CheckBufferSizes(input, output, count, count * *num_ranks,
+                                    data_type))
+    return error;
+  auto current = wrapper::CtxSetCurrent(handle.context());
+  if (!current) return current.takeError();
+  return wrapper::CclAllGather(*current, input.pointer(), output.pointer(),
+                               count, data_type, handle.get(), stream.get());
+}
+
+// tfrt_gpu.ccl.reduce_scatter reduces the input buffers of all ranks and
+// writes the rank'th block of the result to the output buffer of each rank.
+static Error CclReduceScatter(
+    const GpuCclHandle& handle, const GpuBuffer& input, const GpuBuffer& output,
+    const GpuStream& stream,
+    // Needs to be sorted alphabetically by attribute name!
+    Attribute<int32_t> dataType, Attribute<int32_t> reductionOp) {
+  auto data_type = static_cast<ncclDataType_t>(*dataType);
+  auto num_ranks = wrapper::CclCommCount(handle.get());
+  if (!num_ranks) return num_ranks.takeError();
+  size_t count = output.size() / wrapper::GetCclDataTypeSizeBytes(data_type);
+  if (auto error = CheckBufferSizes(input, output, count * *num_ranks, count,
+                                    data_type))
+    return error;
+  auto current = wrapper::CtxSetCurrent(handle.context());
+  if (!current) return current.takeError();
+  return wrapper::CclReduceScatter(*current, input.pointer(), output.pointer(),
+                                   count, data_type,
+                                   static_cast<ncclRedOp_t>(*reductionOp),
+                                   handle.get(), stream.get());
+}
+
+// tfrt_gpu.ccl.broadcast copies the input buffer of rank 'root' to the output
+// buffer of each rank. The input buffer is ignored on all other ranks.
+static Error CclBroadcast(const GpuCclHandle& handle, const GpuBuffer& input,
+                          const GpuBuffer& output, int32_t root,
+                          const GpuStream& stream,
+                          Attribute<int32_t> dataType) {
+  auto data_type = static_cast<ncclDataType_t>(*dataType);
+  size_t count = output.size() / wrapper::GetCclDataTypeSizeBytes(data_type);
+  auto current = wrapper::CtxSetCurrent(handle.context());
+  if (!current) return current.takeError();
+  return wrapper::CclBroadcast(*current, input.pointer(), output.pointer(),
+                               count, data_type, root, handle.get(),
+                               stream.get());
+}
+
+void RegisterGpuCclKernels(KernelRegistry* kernel_reg) {
+  kernel_reg->AddKernel("tfrt_gpu.ccl.unique_id", TFRT_KERNEL(CclUniqueId));
+  kernel_reg->AddKernel("tfrt_gpu.ccl.create", TFRT_KERNEL(CclCreate));
+  kernel_reg->AddKernel("tfrt_gpu.ccl.all_reduce",
+                        TFRT_KERNEL_WITH_CHAIN_RESULT(CclAllReduce));
+  kernel_reg->AddKernel("tfrt_gpu.ccl.all_gather",
+                        TFRT_KERNEL_WITH_CHAIN_RESULT(CclAllGather));
+  kernel_reg->AddKernel("tfrt_gpu.ccl.reduce_scatter",
+                        TFRT_KERNEL_WITH_CHAIN_RESULT(CclReduceScatter));
+  kernel_reg->AddKernel("tfrt_gpu.ccl.broadcast",
+                        TFRT_KERNEL_WITH_CHAIN_RESULT(CclBroadcast));
+}
+
+}  // namespace gpu
+}  // namespace tfrt
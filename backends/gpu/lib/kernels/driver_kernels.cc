@@ -20,6 +20,7 @@
 #include "llvm/Support/Error.h"
 #include "llvm_derived/Support/raw_ostream.h"
 #include "tfrt/dtype/dtype.h"
+#include "tfrt/gpu/device/event_manager.h"
 #include "tfrt/gpu/gpu_types.h"
 #include "tfrt/gpu/memory/gpu_buffer.h"
 #include "tfrt/gpu/tensor/dense_gpu_tensor.h"
@@ -110,14 +111,13 @@ static void GpuEventSynchronize(Argument<GpuEvent> event, Chain in_chain,
   auto ready = wrapper::EventQuery(event->get());
   if (!ready) return result.SetError(StrCat(ready.takeError()));
   if (*ready) return result.emplace(in_chain);
-  bool enqueued = EnqueueBlockingWork(
-      exec_ctx, [result = result.CopyRef(), event = event.ValueRef(),
-                 in_chain = in_chain]() mutable {
-        if (auto error = wrapper::EventSynchronize(event->get()))
-          return result.SetError(StrCat(error));
-        result.emplace(in_chain);
-      });
-  if (!enqueued) return result.SetError("Failed to enqueue blocking work.");
+  EventManager::Get(event->context())
+      .Then(event->get(), exec_ctx.host(),
+            [result = result.CopyRef(), event = event.ValueRef(),
+             in_chain = in_chain](llvm::Error error) mutable {
+              if (error) return result.SetError(StrCat(error));
+              result.emplace(in_chain);
+            });
 }
 
 // tfrt_gpu.allocator.create creates a new allocator.
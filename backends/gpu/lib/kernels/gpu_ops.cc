@@ -24,6 +24,7 @@
 #include "mlir/IR/OpImplementation.h"
 #include "mlir/IR/TypeUtilities.h"
 #include "tfrt/basic_kernels/opdefs/types.h"
+#include "tfrt/gpu/wrapper/ccl_wrapper.h"
 #include "tfrt/gpu/wrapper/cublas_wrapper.h"
 #include "tfrt/gpu/wrapper/cudnn_wrapper.h"
 #include "tfrt/gpu/wrapper/miopen_wrapper.h"
@@ -121,7 +122,8 @@ static ParseResult parseEnum(OpAsmParser &parser,
 template <typename T>
 static void printEnum(OpAsmPrinter &printer, Operation *,
                       EnumAttr<T> attribute) {
-  printer << attribute.getValue();
+  using wrapper::operator<<;  // for T.
+  printer.getStream() << attribute.getValue();
 }
 
 template <typename Tag>
@@ -25,13 +25,15 @@ void RegisterGpuDriverKernels(KernelRegistry* kernel_reg);
 void RegisterGpuBlasKernels(KernelRegistry* kernel_reg);
 void RegisterGpuDnnKernels(KernelRegistry* kernel_reg);
 void RegisterGpuSolverKernels(KernelRegistry* kernel_reg);
+void RegisterGpuCclKernels(KernelRegistry* kernel_reg);
 
 namespace kernels {
 
-TFRT_STATIC_KERNEL_REGISTRATION(RegisterGpuDriverKernels);
-TFRT_STATIC_KERNEL_REGISTRATION(RegisterGpuBlasKernels);
-TFRT_STATIC_KERNEL_REGISTRATION(RegisterGpuDnnKernels);
-TFRT_STATIC_KERNEL_REGISTRATION(RegisterGpuSolverKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("tfrt_gpu.", RegisterGpuDriverKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("tfrt_gpu.", RegisterGpuBlasKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("tfrt_gpu.", RegisterGpuDnnKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("tfrt_cuda.", RegisterGpuSolverKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("tfrt_gpu.", RegisterGpuCclKernels);
 
 }  // namespace kernels
 }  // namespace gpu
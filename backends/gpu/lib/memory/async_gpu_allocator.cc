@@ -0,0 +1,100 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the stream-ordered GPU allocator.
+
+#include "tfrt/gpu/memory/async_gpu_allocator.h"
+
+#include <algorithm>
+
+#include "llvm/ADT/STLExtras.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/tracing/tracing.h"
+
+namespace tfrt {
+namespace gpu {
+
+llvm::Expected<std::unique_ptr<AsyncGpuAllocator>> AsyncGpuAllocator::Create(
+    wrapper::CurrentContext current, uint64_t release_threshold) {
+  TFRT_ASSIGN_OR_RETURN(auto device, wrapper::CtxGetDevice(current));
+  TFRT_ASSIGN_OR_RETURN(auto pool, wrapper::DeviceGetDefaultMemPool(device));
+  if (auto error = wrapper::MemPoolSetReleaseThreshold(pool, release_threshold))
+    return std::move(error);
+  return std::unique_ptr<AsyncGpuAllocator>(
+      new AsyncGpuAllocator(current.context(), pool));
+}
+
+AsyncGpuAllocator::AsyncGpuAllocator(wrapper::Context context,
+                                     wrapper::MemoryPool pool)
+    : context_(context), pool_(pool) {}
+
+llvm::Expected<RCReference<GpuCrtBuffer>> AsyncGpuAllocator::AllocateBuffer(
+    size_t size, wrapper::Stream stream) {
+  TFRT_TRACE_STATIC_SCOPE(Default, "AsyncGpuAllocator::AllocateBuffer");
+  TFRT_ASSIGN_OR_RETURN(auto current, wrapper::CtxSetCurrent(context_));
+  // The pool does not support empty allocations.
+  size = std::max<size_t>(size, 1);
+  TFRT_ASSIGN_OR_RETURN(
+      auto pointer,
+      wrapper::MemAllocFromPoolAsync(current, size, pool_, stream));
+  return MakeRef<GpuCrtBuffer>(pointer, size, this, stream);
+}
+
+void AsyncGpuAllocator::Deallocate(const gpu::GpuCrtBuffer& buffer) {
+  llvm::SmallVector<wrapper::Stream, 2> other_streams;
+  {
+    mutex_lock lock(mu_);
+    auto it = other_streams_.find(GetRawPointer<void>(buffer));
+    if (it != other_streams_.end()) {
+      other_streams = std::move(it->second);
+      other_streams_.erase(it);
+    }
+  }
+  if (auto error = FreeAsync(buffer, other_streams))
+    TFRT_LOG(ERROR) << "Failed to free " << buffer << ": " << error;
+}
+
+llvm::Error AsyncGpuAllocator::FreeAsync(
+    const gpu::GpuCrtBuffer& buffer,
+    llvm::ArrayRef<wrapper::Stream> other_streams) {
+  TFRT_ASSIGN_OR_RETURN(auto current, wrapper::CtxSetCurrent(context_));
+  // Make the primary stream wait for the work enqueued so far on the other
+  // streams, so that the memory is not reused before that work completes.
+  for (auto other_stream : other_streams) {
+    TFRT_ASSIGN_OR_RETURN(
+        auto event,
+        wrapper::EventCreate(current, wrapper::EventFlags::DISABLE_TIMING));
+    if (auto error = wrapper::EventRecord(event.get(), other_stream))
+      return error;
+    if (auto error = wrapper::StreamWaitEvent(buffer.stream(), event.get()))
+      return error;
+  }
+  return wrapper::MemFreeAsync(buffer.pointer(), buffer.stream());
+}
+
+llvm::Error AsyncGpuAllocator::RecordUsage(const gpu::GpuCrtBuffer& buffer,
+                                           wrapper::Stream stream) {
+  if (stream == buffer.stream()) return llvm::Error::success();
+  mutex_lock lock(mu_);
+  auto& streams = other_streams_[GetRawPointer<void>(buffer)];
+  if (!llvm::is_contained(streams, stream)) streams.push_back(stream);
+  return llvm::Error::success();
+}
+
+}  // namespace gpu
+}  // namespace tfrt
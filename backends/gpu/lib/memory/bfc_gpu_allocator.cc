@@ -21,9 +21,11 @@
 #include <algorithm>
 #include <cstdint>
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
 #include "tfrt/gpu/wrapper/cuda_wrapper.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/ref_count.h"
@@ -33,27 +35,14 @@
 namespace tfrt {
 namespace gpu {
 BfcGpuAllocator::BfcGpuAllocator(const wrapper::CurrentContext& current)
-    : context_(current.context()) {
+    : context_(current.context()),
+      counter_name_(StrCat("BfcGpuAllocator bytes in use (", context_, ")")) {
   llvm::ExitOnError die_if_error;
   wrapper::MemoryInfo mem_info = die_if_error(wrapper::MemGetInfo(current));
   gpu_memory_size_ =
       static_cast<uint64_t>(static_cast<float>(mem_info.free_bytes) * 0.50);
   base_ptr_ = die_if_error(wrapper::MemAlloc(current, gpu_memory_size_));
 
-  // Create a bunch of bins of various good sizes.
-
-  // Covers allocations of exactly 256 bytes (the minimum size).
-  bins_.push_back(std::make_pair(256, std::make_unique<Bin>(256)));
-
-  // We create bins to fit all possible ranges that cover the
-  // gpu_memory_size_ starting from allocations up to 1024 bytes to
-  // allocations up to (and including) the memory limit.
-  for (size_t bin_size = 1024; bin_size < gpu_memory_size_ * 2; bin_size *= 2) {
-    bins_.push_back(std::make_pair(bin_size, std::make_unique<Bin>(bin_size)));
-  }
-
-  assert(std::is_sorted(bins_.begin(), bins_.end()));
-
   // Create one large chunk for the whole memory space that will
   // be chunked later.
   BfcGpuAllocator::Chunk* c = new BfcGpuAllocator::Chunk();
@@ -64,81 +53,149 @@ BfcGpuAllocator::BfcGpuAllocator(const wrapper::CurrentContext& current)
   c->prev = nullptr;
   c->next = nullptr;
 
+  mutex_lock l(mu_);
   ptr_to_chunk_map_.insert(std::make_pair(c->ptr, c));
+  first_chunk_ = c;
+  stats_.bytes_limit = gpu_memory_size_;
+
+  // Insert the chunk into the free list of the null stream.
+  InsertFreeChunk(c);
+}
 
-  // Insert the chunk into the right bin.
-  ReassignChunkToBin(c);
+BfcGpuAllocator::~BfcGpuAllocator() {
+  mutex_lock l(mu_);
+  for (const auto& pair : ptr_to_chunk_map_) delete pair.second;
 }
 
 llvm::Expected<RCReference<gpu::GpuCrtBuffer>> BfcGpuAllocator::AllocateBuffer(
     size_t num_bytes, wrapper::Stream stream) {
-  TFRT_TRACE_SCOPE(Default, "BfcGpuAllocator::Allocate");
+  TFRT_TRACE_STATIC_SCOPE(Default, "BfcGpuAllocator::Allocate");
   // First, always allocate memory of at least 256 bytes, and always
   // allocate multiples of 256 bytes so all memory addresses are
   // nicely byte aligned.
   static_assert(
-      GpuCrtAllocator::kAlignment <= 256,
+      GpuCrtAllocator::kAlignment <= kMinAllocationSize,
       "BfcGpuAllocator does not support alignment to more than 256 bytes");
-  size_t rounded_bytes = (256 * ((num_bytes + 255) / 256));
+  size_t rounded_bytes =
+      llvm::alignTo(num_bytes, static_cast<size_t>(kMinAllocationSize));
   if (rounded_bytes == 0) {
     return llvm::createStringError(llvm::errc::invalid_argument,
                                    "Tried to allocate a size 0 buffer.");
   }
 
-  // The BFC allocator tries to find the best fit first.
-  //
-  // First identify the first bin that could satisfy rounded_bytes.
-  auto it =
-      std::lower_bound(bins_.begin(), bins_.end(), rounded_bytes, CompareFirst);
-  if (it == bins_.end()) {
+  mutex_lock l(mu_);
+  // Prefer memory that was last used by the same stream, which can be reused
+  // without waiting for other streams. Otherwise take the best fit on any
+  // stream, and coalesce the free memory of all streams as a last resort.
+  Chunk* chunk = FindChunk(GetFreeList(stream), rounded_bytes);
+  if (!chunk) chunk = FindChunkOnAnyStream(rounded_bytes);
+  if (!chunk && CoalesceAcrossStreams())
+    chunk = FindChunkOnAnyStream(rounded_bytes);
+
+  if (!chunk) {
+    // We searched all free lists for an existing free chunk to use and
+    // couldn't find one.  This means we must have run out of memory,
     return llvm::createStringError(
-        llvm::errc::invalid_argument,
-        tfrt::StrCat(" Asked for ", rounded_bytes, " but largest bin was ",
-                     bins_.rbegin()->first));
+        llvm::errc::not_enough_memory,
+        tfrt::StrCat("Ran out of memory trying to allocate ",
+                     HumanReadableNumBytes(num_bytes)));
   }
 
-  mutex_lock l(mu_);
-  if (stream_ == nullptr) {
-    stream_ = stream;
-  } else if (stream != stream_) {
-    return llvm::createStringError(
-        llvm::errc::invalid_argument,
-        "BfcGpuAllocator does not support multiple streams");
+  RemoveFreeChunk(chunk);
+
+  // If we can break the size of the chunk into two reasonably
+  // large pieces, do so.
+  //
+  // TODO(vrv): What should be the criteria when deciding when
+  // to split?
+  if (chunk->size >= rounded_bytes * 2) {
+    SplitChunk(chunk, rounded_bytes);
   }
-  for (; it != bins_.end(); ++it) {
-    // Start searching from the first bin for the smallest chunk that fits
-    // rounded_bytes.
-    const std::unique_ptr<Bin>& b = it->second;
-    for (BfcGpuAllocator::Chunk* chunk : b->chunks) {
-      if (!chunk->in_use && chunk->size >= rounded_bytes) {
-        // We found an existing chunk that fits us that wasn't in use.
-        chunk->in_use = true;
-
-        // If we can break the size of the chunk into two reasonably
-        // large pieces, do so.
-        //
-        // TODO(vrv): What should be the criteria when deciding when
-        // to split?
-        if (chunk->size >= rounded_bytes * 2) {
-          SplitChunk(chunk, rounded_bytes);
-        }
-
-        return MakeRef<gpu::GpuCrtBuffer>(
-            wrapper::Pointer<void>(chunk->ptr, stream.platform()), num_bytes,
-            this);
-      }
-    }
+
+  if (auto error = SetChunkStream(chunk, stream)) {
+    CoalesceAndInsert(chunk);
+    return std::move(error);
   }
+  chunk->in_use = true;
+
+  ++stats_.num_allocs;
+  stats_.bytes_in_use += chunk->size;
+  stats_.peak_bytes_in_use =
+      std::max(stats_.peak_bytes_in_use, stats_.bytes_in_use);
+  TFRT_TRACE_COUNTER(Default, counter_name_, stats_.bytes_in_use);
+
+  return MakeRef<gpu::GpuCrtBuffer>(
+      wrapper::Pointer<void>(chunk->ptr, stream.platform()), num_bytes, this,
+      stream);
+}
+
+int BfcGpuAllocator::BinIndex(size_t num_bytes) {
+  assert(num_bytes >= kMinAllocationSize);
+  int index = llvm::Log2_64(num_bytes / kMinAllocationSize);
+  return std::min(index, kNumBins - 1);
+}
+
+wrapper::Stream BfcGpuAllocator::GetFreeListStream(const Chunk* c) {
+  return c->streams.size() == 1 ? c->streams.front() : wrapper::Stream();
+}
 
-  // We searched all bins for an existing free chunk to use and
-  // couldn't find one.  This means we must have run out of memory,
-  return llvm::createStringError(
-      llvm::errc::not_enough_memory,
-      tfrt::StrCat("Ran out of memory trying to allocate ",
-                   HumanReadableNumBytes(num_bytes)));
+BfcGpuAllocator::FreeList& BfcGpuAllocator::GetFreeList(
+    wrapper::Stream stream) {
+  std::unique_ptr<FreeList>& free_list = free_lists_[stream];
+  if (!free_list) free_list = std::make_unique<FreeList>();
+  return *free_list;
+}
+
+void BfcGpuAllocator::InsertFreeChunk(Chunk* c) {
+  assert(!c->in_use && !c->free_list);
+  FreeList& free_list = GetFreeList(GetFreeListStream(c));
+  int index = BinIndex(c->size);
+  free_list.bins[index].insert(c);
+  free_list.non_empty_bins |= uint64_t{1} << index;
+  c->free_list = &free_list;
+}
+
+void BfcGpuAllocator::RemoveFreeChunk(Chunk* c) {
+  FreeList* free_list = c->free_list;
+  assert(free_list && "Chunk is not free");
+  int index = BinIndex(c->size);
+  Bin& bin = free_list->bins[index];
+  auto erased = bin.erase(c);
+  (void)erased;
+  assert(erased == 1 && "Could not find chunk in bin");
+  if (bin.empty()) free_list->non_empty_bins &= ~(uint64_t{1} << index);
+  c->free_list = nullptr;
+}
+
+BfcGpuAllocator::Chunk* BfcGpuAllocator::FindChunk(const FreeList& free_list,
+                                                   size_t num_bytes) {
+  // The bin of `num_bytes` may hold smaller chunks, the bins above only hold
+  // chunks that fit.
+  int index = BinIndex(num_bytes);
+  Chunk key;
+  key.size = num_bytes;
+  const Bin& bin = free_list.bins[index];
+  auto it = bin.lower_bound(&key);
+  if (it != bin.end()) return *it;
+  if (index + 1 == kNumBins) return nullptr;
+  uint64_t larger_bins =
+      free_list.non_empty_bins & (~uint64_t{0} << (index + 1));
+  if (larger_bins == 0) return nullptr;
+  return *free_list.bins[llvm::countTrailingZeros(larger_bins)].begin();
+}
+
+BfcGpuAllocator::Chunk* BfcGpuAllocator::FindChunkOnAnyStream(
+    size_t num_bytes) {
+  Chunk* best = nullptr;
+  for (const auto& pair : free_lists_) {
+    Chunk* chunk = FindChunk(*pair.second, num_bytes);
+    if (chunk && (!best || ChunkComparator()(chunk, best))) best = chunk;
+  }
+  return best;
 }
 
 void BfcGpuAllocator::SplitChunk(BfcGpuAllocator::Chunk* c, size_t num_bytes) {
+  assert(!c->free_list && "Chunk must be removed from its free list");
   // Create a new chunk starting num_bytes after c
   BfcGpuAllocator::Chunk* new_chunk = new BfcGpuAllocator::Chunk();
   new_chunk->ptr = static_cast<void*>(static_cast<char*>(c->ptr) + num_bytes);
@@ -148,8 +205,9 @@ void BfcGpuAllocator::SplitChunk(BfcGpuAllocator::Chunk* c, size_t num_bytes) {
   new_chunk->size = c->size - num_bytes;
   c->size = num_bytes;
 
-  // The new chunk is not in use.
+  // The new chunk is not in use, but might be accessed by the same streams.
   new_chunk->in_use = false;
+  new_chunk->streams = c->streams;
 
   // Maintain the pointers.
   // c <-> c_neighbor becomes
@@ -162,9 +220,9 @@ void BfcGpuAllocator::SplitChunk(BfcGpuAllocator::Chunk* c, size_t num_bytes) {
     c_neighbor->prev = new_chunk;
   }
 
-  // Maintain the bins
-  ReassignChunkToBin(new_chunk);
-  ReassignChunkToBin(c);
+  // The remainder is free. It's not merged with the free chunk that may
+  // follow it, because that chunk was not merged with `c` before either.
+  InsertFreeChunk(new_chunk);
 }
 
 void BfcGpuAllocator::Deallocate(const gpu::GpuCrtBuffer& buffer) {
@@ -179,22 +237,58 @@ void BfcGpuAllocator::Deallocate(const gpu::GpuCrtBuffer& buffer) {
   BfcGpuAllocator::Chunk* c = it->second;
   // Mark the chunk as no longer in use
   c->in_use = false;
+  stats_.bytes_in_use -= c->size;
+  TFRT_TRACE_COUNTER(Default, counter_name_, stats_.bytes_in_use);
 
-  // Consider coalescing it.
-  MaybeCoalesce(c);
+  // Coalesce it and return it to the free list of its stream.
+  CoalesceAndInsert(c);
 }
 
 llvm::Error BfcGpuAllocator::RecordUsage(const gpu::GpuCrtBuffer& buffer,
                                          wrapper::Stream stream) {
-  llvm_unreachable("RecordUsage is not implemented.");
+  mutex_lock l(mu_);
+  auto it = ptr_to_chunk_map_.find(GetRawPointer<void>(buffer));
+  assert(it != ptr_to_chunk_map_.end() &&
+         "Asked to record usage of a pointer we never allocated");
+  auto& streams = it->second->streams;
+  if (!llvm::is_contained(streams, stream)) streams.push_back(stream);
+  return llvm::Error::success();
+}
+
+llvm::Error BfcGpuAllocator::SetChunkStream(BfcGpuAllocator::Chunk* c,
+                                            wrapper::Stream stream) {
+  bool waited = false;
+  for (wrapper::Stream other : c->streams) {
+    if (other == stream) continue;
+    // Record an event on the other stream now, which covers all the work that
+    // accessed the chunk before it was deallocated.
+    wrapper::OwningEvent& event = stream_events_[other];
+    if (!event) {
+      auto current = wrapper::CtxSetCurrent(context_);
+      if (!current) return current.takeError();
+      auto new_event =
+          wrapper::EventCreate(*current, wrapper::EventFlags::DISABLE_TIMING);
+      if (!new_event) return new_event.takeError();
+      event = std::move(*new_event);
+    }
+    if (auto error = wrapper::EventRecord(event.get(), other)) return error;
+    if (auto error = wrapper::StreamWaitEvent(stream, event.get()))
+      return error;
+    waited = true;
+  }
+  if (waited) ++stats_.num_cross_stream_reuses;
+  c->streams.assign({stream});
+  return llvm::Error::success();
 }
 
 // Merges c1 and c2 when c1->next is c2 and c2->prev is c1.
 // We merge c2 into c1.
 void BfcGpuAllocator::Merge(BfcGpuAllocator::Chunk* c1,
                             BfcGpuAllocator::Chunk* c2) {
-  // We can only merge chunks that are not in use.
+  // We can only merge chunks that are not in use, and that have been removed
+  // from their free lists.
   assert(!c1->in_use && !c2->in_use);
+  assert(!c1->free_list && !c2->free_list);
 
   // c1's prev doesn't change, still points to the same ptr, and is
   // still not in use.
@@ -213,122 +307,119 @@ void BfcGpuAllocator::Merge(BfcGpuAllocator::Chunk* c1,
   // Set the new size
   c1->size += c2->size;
 
+  // The merged chunk might be accessed by the streams of both chunks.
+  for (wrapper::Stream stream : c2->streams)
+    if (!llvm::is_contained(c1->streams, stream)) c1->streams.push_back(stream);
+
   // Delete c2 and cleanup all state
-  RemoveChunkFromBin(c2);
+  ptr_to_chunk_map_.erase(c2->ptr);
+  delete c2;
 }
 
-void BfcGpuAllocator::ReassignChunkToBin(BfcGpuAllocator::Chunk* c) {
-  auto it = std::lower_bound(bins_.begin(), bins_.end(), c->size, CompareFirst);
-  assert(it != bins_.end() && " Tried to reassign to non-existant bin");
-
-  Bin* new_bin = it->second.get();
-
-  // If the bin has not changed, do nothing.
-  Bin* old_bin = c->bin;
-  if (old_bin != nullptr && new_bin == old_bin) {
-    return;
+void BfcGpuAllocator::CoalesceAndInsert(BfcGpuAllocator::Chunk* c) {
+  // Only merge with neighbors on the same free list, so that the memory of a
+  // stream stays reusable without waiting for other streams.
+  wrapper::Stream stream = GetFreeListStream(c);
+  auto can_merge = [&](Chunk* neighbor) {
+    return neighbor && !neighbor->in_use &&
+           GetFreeListStream(neighbor) == stream;
+  };
+
+  if (can_merge(c->next)) {
+    RemoveFreeChunk(c->next);
+    // Deletes c->next
+    Merge(c, c->next);
   }
 
-  // The bin has changed.  Add the chunk to the new bin and remove
-  // the chunk from the old bin.
-  new_bin->chunks.insert(c);
-  c->bin = new_bin;
-
-  if (old_bin == nullptr) {
-    return;
+  if (can_merge(c->prev)) {
+    Chunk* prev = c->prev;
+    RemoveFreeChunk(prev);
+    // Deletes c
+    Merge(prev, c);
+    c = prev;
   }
 
-  // Remove chunk from old bin
-  for (auto it = old_bin->chunks.begin(); it != old_bin->chunks.end(); ++it) {
-    if (*it == c) {
-      old_bin->chunks.erase(it);
-      return;
-    }
-  }
-  TFRT_LOG(FATAL) << "Could not find chunk in old bin";
+  InsertFreeChunk(c);
 }
 
-void BfcGpuAllocator::RemoveChunkFromBin(BfcGpuAllocator::Chunk* c) {
-  Bin* b = c->bin;
-  for (auto it = b->chunks.begin(); it != b->chunks.end(); ++it) {
-    Chunk* other_c = *it;
-    if (other_c->ptr == c->ptr) {
-      b->chunks.erase(it);
-      ptr_to_chunk_map_.erase(c->ptr);
-      delete c;
-      return;
+bool BfcGpuAllocator::CoalesceAcrossStreams() {
+  TFRT_TRACE_STATIC_SCOPE(Default, "BfcGpuAllocator::CoalesceAcrossStreams");
+  bool merged = false;
+  for (Chunk* c = first_chunk_; c; c = c->next) {
+    if (c->in_use) continue;
+    while (c->next && !c->next->in_use) {
+      if (c->free_list) RemoveFreeChunk(c);
+      RemoveFreeChunk(c->next);
+      // Deletes c->next
+      Merge(c, c->next);
+      merged = true;
     }
+    if (!c->free_list) InsertFreeChunk(c);
   }
-
-  TFRT_LOG(FATAL) << "Could not find chunk in bin";
+  return merged;
 }
 
-void BfcGpuAllocator::MaybeCoalesce(BfcGpuAllocator::Chunk* c) {
-  // This chunk is no longer in-use, consider coalescing the chunk
-  // with adjacent chunks.
-  Chunk* chunk_to_reassign = nullptr;
-
-  // If the next chunk is free, coalesce the two, if the result would
-  // fit in an existing bin.
-  if (c->next && !c->next->in_use) {
-    chunk_to_reassign = c;
-
-    // Deletes c->next
-    Merge(c, c->next);
-  }
+double BfcGpuAllocator::Stats::fragmentation() const {
+  size_t free_bytes = bytes_limit - bytes_in_use;
+  if (free_bytes == 0) return 0.0;
+  return 1.0 - static_cast<double>(largest_free_block_bytes) / free_bytes;
+}
 
-  // If the previous chunk is free, coalesce the two
-  if (c->prev && !c->prev->in_use) {
-    chunk_to_reassign = c->prev;
+BfcGpuAllocator::Stats BfcGpuAllocator::GetStats() const {
+  mutex_lock l(mu_);
+  return GetStatsLocked();
+}
 
-    // Deletes c
-    Merge(c->prev, c);
-  }
+llvm::Optional<MemoryUsage> BfcGpuAllocator::GetMemoryUsage() const {
+  Stats stats = GetStats();
+  MemoryUsage usage;
+  usage.bytes_in_use = stats.bytes_in_use;
+  usage.bytes_limit = stats.bytes_limit;
+  return usage;
+}
 
-  // Reassign the final merged chunk into the right bin.
-  if (chunk_to_reassign) {
-    ReassignChunkToBin(chunk_to_reassign);
+BfcGpuAllocator::Stats BfcGpuAllocator::GetStatsLocked() const {
+  Stats stats = stats_;
+  for (const auto& pair : free_lists_) {
+    const FreeList& free_list = *pair.second;
+    if (free_list.non_empty_bins == 0) continue;
+    int index = llvm::Log2_64(free_list.non_empty_bins);
+    stats.largest_free_block_bytes =
+        std::max(stats.largest_free_block_bytes,
+                 (*free_list.bins[index].rbegin())->size);
   }
+  return stats;
 }
 
 void BfcGpuAllocator::DumpMemoryLog(size_t num_bytes) {
-  // For each bin: tally up the total number of chunks and bytes.
-  for (const auto& bin : bins_) {
-    Bin* b = bin.second.get();
-
-    size_t total_bytes_in_use = 0;
-    size_t total_bytes_in_bin = 0;
-    size_t total_chunks_in_use = 0;
-    size_t total_chunks_in_bin = 0;
-    for (Chunk* c : b->chunks) {
-      total_bytes_in_bin += c->size;
-      ++total_chunks_in_bin;
-      if (c->in_use) {
-        total_bytes_in_use += c->size;
-        ++total_chunks_in_use;
-      }
+  Stats stats = GetStatsLocked();
+  TFRT_LOG(INFO) << "Limit: " << HumanReadableNumBytes(stats.bytes_limit)
+                 << ", in use: " << HumanReadableNumBytes(stats.bytes_in_use)
+                 << ", peak: " << HumanReadableNumBytes(stats.peak_bytes_in_use)
+                 << ", largest free block: "
+                 << HumanReadableNumBytes(stats.largest_free_block_bytes)
+                 << ", fragmentation: " << stats.fragmentation();
+
+  // For each free list and bin: tally up the total number of chunks and bytes.
+  for (const auto& pair : free_lists_) {
+    for (int index = 0; index < kNumBins; ++index) {
+      const Bin& bin = pair.second->bins[index];
+      if (bin.empty()) continue;
+      size_t total_bytes_in_bin = 0;
+      for (Chunk* c : bin) total_bytes_in_bin += c->size;
+      TFRT_LOG(INFO) << "Stream " << pair.first << ", bin ("
+                     << HumanReadableNumBytes(kMinAllocationSize << index)
+                     << "): \tFree chunks: " << bin.size() << " "
+                     << HumanReadableNumBytes(total_bytes_in_bin);
     }
-
-    TFRT_LOG(INFO) << "Bin (" << b->bin_size
-                   << "): \tTotal Chunks: " << total_chunks_in_bin
-                   << ", Chunks in use: " << total_chunks_in_use << " "
-                   << HumanReadableNumBytes(total_bytes_in_bin)
-                   << " allocated for chunks. "
-                   << HumanReadableNumBytes(total_bytes_in_use)
-                   << " in use in bin. ";
   }
 
-  // Find the bin that we would have liked to allocate in, so we
+  // Log the chunks in the bin that we would have liked to allocate in, so we
   // can get some further analysis about fragmentation.
-  auto it =
-      std::lower_bound(bins_.begin(), bins_.end(), num_bytes, CompareFirst);
-  if (it != bins_.end()) {
-    Bin* b = it->second.get();
-
-    TFRT_LOG(INFO) << "Bin for " << HumanReadableNumBytes(num_bytes) << " was "
-                   << HumanReadableNumBytes(b->bin_size) << ", Chunk State: ";
-
-    for (Chunk* c : b->chunks) {
+  int index = BinIndex(std::max(
+      num_bytes, static_cast<size_t>(kMinAllocationSize)));
+  for (const auto& pair : free_lists_) {
+    for (Chunk* c : pair.second->bins[index]) {
       TFRT_LOG(INFO) << c->DebugString(/*with_neighbors=*/true);
     }
   }
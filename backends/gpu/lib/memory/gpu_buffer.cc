@@ -21,13 +21,15 @@
 
 #include "llvm/Support/Format.h"
 #include "tfrt/gpu/memory/gpu_allocator.h"
+#include "tfrt/support/error_util.h"
 
 namespace tfrt {
 namespace gpu {
 
 GpuCrtBuffer::GpuCrtBuffer(wrapper::Pointer<void> pointer, size_t size,
-                           GpuCrtAllocator* allocator)
+                           GpuCrtAllocator* allocator, wrapper::Stream stream)
     : pointer_(pointer),
+      stream_(stream),
       size_(size),
       has_allocator_(true),
       allocator_(allocator) {}
@@ -39,6 +41,31 @@ GpuCrtBuffer::GpuCrtBuffer(wrapper::Pointer<void> pointer, size_t size,
       has_allocator_(false),
       deallocator_(std::move(deallocator)) {}
 
+GpuCrtBuffer::GpuCrtBuffer(RCReference<GpuCrtBuffer> owner, size_t offset,
+                           size_t size)
+    : pointer_(static_cast<wrapper::Pointer<char>>(owner->pointer_) + offset),
+      stream_(owner->stream_),
+      size_(size),
+      has_allocator_(true),
+      allocator_(nullptr),
+      owner_(std::move(owner)) {}
+
+llvm::Expected<RCReference<GpuCrtBuffer>> GpuCrtBuffer::CreateSubBuffer(
+    RCReference<GpuCrtBuffer> buffer, size_t offset, size_t size) {
+  if (offset > buffer->size() || size > buffer->size() - offset) {
+    return MakeStringError("Sub-buffer at offset ", offset, " of ", size,
+                           " bytes is out of range of ", *buffer);
+  }
+  // Sub-buffers of sub-buffers refer to the owner directly, so that usage
+  // tracking and lifetime only ever involve one level.
+  if (buffer->owner_) {
+    offset +=
+        GetRawPointer<char>(*buffer) - GetRawPointer<char>(buffer->owner());
+    buffer = buffer->owner_.CopyRef();
+  }
+  return TakeRef(new GpuCrtBuffer(std::move(buffer), offset, size));
+}
+
 GpuCrtBuffer::~GpuCrtBuffer() {
   if (has_allocator_) {
     if (allocator_ != nullptr) {
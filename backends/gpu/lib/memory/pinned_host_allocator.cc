@@ -0,0 +1,138 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the pinned host memory allocator.
+
+#include "tfrt/gpu/memory/pinned_host_allocator.h"
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/support/logging.h"
+
+namespace tfrt {
+namespace gpu {
+
+// Blocks are at least 256 bytes, and at most 64MiB are cached.
+static constexpr int kMinSizeClass = 8;
+static constexpr int kMaxSizeClass = 26;
+
+// Returns the size class of an allocation of `size` bytes, or -1 if it is too
+// large to be cached.
+static int GetSizeClass(size_t size) {
+  int size_class = std::max<int>(llvm::Log2_64_Ceil(size), kMinSizeClass);
+  return size_class <= kMaxSizeClass ? size_class : -1;
+}
+
+PinnedHostAllocator& PinnedHostAllocator::Get(wrapper::Context context) {
+  static auto* mu = new mutex;
+  static auto* allocators = new std::unordered_map<
+      wrapper::Context, std::unique_ptr<PinnedHostAllocator>>;
+
+  mutex_lock lock(*mu);
+  std::unique_ptr<PinnedHostAllocator>& allocator = (*allocators)[context];
+  if (!allocator) allocator = std::make_unique<PinnedHostAllocator>(context);
+  return *allocator;
+}
+
+PinnedHostAllocator::PinnedHostAllocator(wrapper::Context context,
+                                         size_t max_cached_bytes)
+    : context_(context),
+      max_cached_bytes_(max_cached_bytes),
+      free_blocks_(kMaxSizeClass + 1) {}
+
+PinnedHostAllocator::~PinnedHostAllocator() {
+  mutex_lock lock(mu_);
+  if (!allocated_blocks_.empty())
+    TFRT_LOG(ERROR) << allocated_blocks_.size()
+                    << " pinned host memory blocks are still allocated";
+  for (auto& blocks : free_blocks_)
+    for (void* ptr : blocks) FreePinned(ptr);
+}
+
+void* PinnedHostAllocator::AllocatePinned(size_t size) {
+  auto current = wrapper::CtxSetCurrent(context_);
+  if (!current) {
+    TFRT_LOG(ERROR) << current.takeError();
+    return nullptr;
+  }
+  auto memory = wrapper::MemHostAlloc(*current, size,
+                                      wrapper::MemHostAllocFlags::PORTABLE);
+  if (!memory) {
+    TFRT_LOG(ERROR) << memory.takeError();
+    return nullptr;
+  }
+  return memory->release().raw(context_.platform());
+}
+
+void PinnedHostAllocator::FreePinned(void* ptr) {
+  wrapper::Pointer<void> pointer(ptr, context_.platform());
+  if (auto error = wrapper::MemHostFree(pointer)) TFRT_LOG(ERROR) << error;
+}
+
+void* PinnedHostAllocator::AllocateBytes(size_t size, size_t alignment) {
+  // Pinned memory is page aligned.
+  assert(alignment <= 4096 && "unsupported alignment");
+
+  int size_class = GetSizeClass(size);
+  size_t block_size = size_class >= 0 ? size_t{1} << size_class : size;
+
+  void* ptr = nullptr;
+  if (size_class >= 0) {
+    mutex_lock lock(mu_);
+    auto& blocks = free_blocks_[size_class];
+    if (!blocks.empty()) {
+      ptr = blocks.back();
+      blocks.pop_back();
+      cached_bytes_ -= block_size;
+    }
+  }
+
+  if (!ptr) ptr = AllocatePinned(block_size);
+  if (!ptr) return nullptr;
+
+  mutex_lock lock(mu_);
+  allocated_blocks_.emplace(reinterpret_cast<uintptr_t>(ptr), block_size);
+  return ptr;
+}
+
+void PinnedHostAllocator::DeallocateBytes(void* ptr, size_t size) {
+  int size_class = GetSizeClass(size);
+  size_t block_size = size_class >= 0 ? size_t{1} << size_class : size;
+  {
+    mutex_lock lock(mu_);
+    allocated_blocks_.erase(reinterpret_cast<uintptr_t>(ptr));
+    if (size_class >= 0 && cached_bytes_ + block_size <= max_cached_bytes_) {
+      free_blocks_[size_class].push_back(ptr);
+      cached_bytes_ += block_size;
+      return;
+    }
+  }
+  FreePinned(ptr);
+}
+
+bool PinnedHostAllocator::Contains(const void* ptr, size_t size) const {
+  auto address = reinterpret_cast<uintptr_t>(ptr);
+  mutex_lock lock(mu_);
+  // Find the last block that starts at or before `ptr`.
+  auto it = allocated_blocks_.upper_bound(address);
+  if (it == allocated_blocks_.begin()) return false;
+  --it;
+  return address + size <= it->first + it->second;
+}
+
+}  // namespace gpu
+}  // namespace tfrt
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Declares helpers for tf.Cast op
+//
+// Declares a function to convert GPU tensors between floating point types,
+// which is implemented by the `tf_gpu_unary_ops` cuda_library target.
+#ifndef TFRT_BACKENDS_GPU_LIB_OPS_TF_CAST_OP_H_
+#define TFRT_BACKENDS_GPU_LIB_OPS_TF_CAST_OP_H_
+
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+class DType;
+
+namespace gpu {
+
+class GpuDispatchContext;
+class DenseGpuTensor;
+
+// Enqueues a conversion of `input` to `dtype`. Supports conversions between
+// F16, F32 and F64.
+llvm::Expected<DenseGpuTensor> CastGpuTensor(GpuDispatchContext* dctx,
+                                             const DenseGpuTensor& input,
+                                             DType dtype);
+
+}  // namespace gpu
+
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_GPU_LIB_OPS_TF_CAST_OP_H_
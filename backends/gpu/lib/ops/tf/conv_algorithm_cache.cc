@@ -0,0 +1,115 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Implementation of the cache of autotuned convolution algorithms.
+#include "tfrt/gpu/ops/tf/conv_algorithm_cache.h"
+
+#include <cstdlib>
+#include <tuple>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/support/logging.h"
+
+namespace tfrt {
+namespace gpu {
+
+// Each line of the file holds one entry: "<algo> <workspace> <math> <key>".
+static llvm::Optional<std::pair<string_view, ConvolutionAlgorithm>> ParseLine(
+    string_view line) {
+  ConvolutionAlgorithm algorithm;
+  string_view algo, workspace, math_type, key;
+  std::tie(algo, line) = line.split(' ');
+  std::tie(workspace, line) = line.split(' ');
+  std::tie(math_type, key) = line.split(' ');
+  if (key.empty() || algo.getAsInteger(10, algorithm.algo) ||
+      workspace.getAsInteger(10, algorithm.workspace_size_bytes) ||
+      math_type.getAsInteger(10, algorithm.math_type))
+    return llvm::None;
+  return std::make_pair(key, algorithm);
+}
+
+ConvolutionAlgorithmCache::ConvolutionAlgorithmCache(std::string path)
+    : path_(std::move(path)) {
+  Load();
+}
+
+ConvolutionAlgorithmCache& ConvolutionAlgorithmCache::Get() {
+  static auto* cache = [] {
+    const char* path = std::getenv("TFRT_GPU_CONV_ALGORITHM_CACHE");
+    return new ConvolutionAlgorithmCache(path ? path : "");
+  }();
+  return *cache;
+}
+
+void ConvolutionAlgorithmCache::Load() {
+  if (path_.empty()) return;
+  auto buffer = llvm::MemoryBuffer::getFile(path_);
+  if (!buffer) return;  // Nothing has been tuned yet.
+
+  mutex_lock lock(mu_);
+  SmallVector<string_view, 0> lines;
+  (*buffer)->getBuffer().split(lines, '\n', /*MaxSplit=*/-1,
+                               /*KeepEmpty=*/false);
+  for (string_view line : lines) {
+    // Skip lines truncated by a process that died while writing.
+    if (auto entry = ParseLine(line)) map_[entry->first] = entry->second;
+  }
+}
+
+llvm::Optional<ConvolutionAlgorithm> ConvolutionAlgorithmCache::Find(
+    string_view key) const {
+  mutex_lock lock(mu_);
+  auto it = map_.find(key);
+  if (it == map_.end()) return llvm::None;
+  return it->second;
+}
+
+void ConvolutionAlgorithmCache::Insert(string_view key,
+                                       ConvolutionAlgorithm algorithm) {
+  assert(key.find('\n') == string_view::npos);
+  mutex_lock lock(mu_);
+  map_[key] = algorithm;
+  if (path_.empty()) return;
+
+  llvm::SmallString<256> line;
+  llvm::raw_svector_ostream(line)
+      << algorithm.algo << ' ' << algorithm.workspace_size_bytes << ' '
+      << algorithm.math_type << ' ' << key << '\n';
+
+  std::error_code error_code;
+  llvm::raw_fd_ostream os(path_, error_code, llvm::sys::fs::OF_Append);
+  if (error_code) {
+    TFRT_LOG(WARNING) << "Failed to open convolution algorithm cache '"
+                      << path_ << "': " << error_code.message();
+    return;
+  }
+  // Write the whole line at once, interleaved appends from other processes
+  // may otherwise corrupt the file.
+  os.SetUnbuffered();
+  os << line.str();
+  if (os.has_error()) {
+    TFRT_LOG(WARNING) << "Failed to write convolution algorithm cache '"
+                      << path_ << "': " << os.error().message();
+    os.clear_error();
+  }
+}
+
+}  // namespace gpu
+}  // namespace tfrt
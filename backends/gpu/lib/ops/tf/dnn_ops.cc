@@ -15,6 +15,7 @@
 // Collates list of all TF DNN operations.
 
 #include <numeric>
+#include <string>
 #include <unordered_map>
 
 #include "dnn_ops_cu.h"
@@ -31,10 +32,15 @@
 #include "tfrt/gpu/core_runtime/gpu_dispatch_context.h"
 #include "tfrt/gpu/core_runtime/gpu_op_registry.h"
 #include "tfrt/gpu/core_runtime/gpu_op_utils.h"
+#include "tfrt/gpu/ops/tf/conv_algorithm_cache.h"
 #include "tfrt/gpu/tensor/dense_gpu_tensor.h"
 #include "tfrt/gpu/wrapper/cudnn_wrapper.h"
 #include "tfrt/gpu/wrapper/dnn_wrapper.h"
+#include "tfrt/gpu/wrapper/hash_utils.h"
+#include "tfrt/host_context/attribute_utils.h"
+#include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/string_util.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/tensor_metadata.h"
@@ -62,11 +68,6 @@ struct TensorDescriptorData {
   llvm::SmallVector<int, 4> dimensions;
   llvm::SmallVector<int, 4> strides;
 };
-static bool operator==(const TensorDescriptorData& left,
-                       const TensorDescriptorData& right) {
-  return left.dtype == right.dtype && left.dimensions == right.dimensions &&
-         left.strides == right.strides;
-}
 
 static llvm::raw_ostream& operator<<(llvm::raw_ostream& os,
                                      const TensorDescriptorData& data) {
@@ -215,48 +216,91 @@ DefaultCudnnCovolutionForwardAlgorithm() {
   return default_algo;
 }
 
-using ConvolutionAlgorithmKey =
-    std::tuple<TensorDescriptorData, TensorDescriptorData,
-               TensorDescriptorData>;
+// Returns a description of the device and cuDNN version of the current
+// context, which is part of the key of ConvolutionAlgorithmCache entries.
+static llvm::Expected<std::string> GetConvolutionAlgorithmKeyPrefix(
+    wrapper::CurrentContext current) {
+  static auto* mu = new mutex;
+  static auto* prefixes = new std::unordered_map<wrapper::Device, std::string>;
+  TFRT_ASSIGN_OR_RETURN(auto device, wrapper::CtxGetDevice(current));
+  mutex_lock lock(*mu);
+  auto it = prefixes->find(device);
+  if (it != prefixes->end()) return it->second;
+
+  TFRT_ASSIGN_OR_RETURN(auto name, wrapper::DeviceGetName(device));
+  TFRT_ASSIGN_OR_RETURN(auto version, wrapper::CudnnGetVersion());
+  auto prefix = StrCat(name, ";cudnn", version.major, ".", version.minor, ".",
+                       version.patch);
+  return prefixes->emplace(device, std::move(prefix)).first->second;
+}
 
-struct ConvolutionAlgorithmHash {
-  size_t operator()(const ConvolutionAlgorithmKey& key) const {
-    auto result = Hash(std::get<0>(key));
-    Combine(result, Hash(std::get<1>(key)));
-    Combine(result, Hash(std::get<2>(key)));
-    return result;
-  }
+// Returns the key of a convolution in the ConvolutionAlgorithmCache. The
+// tensor descriptors include the data types and the layouts.
+static llvm::Expected<std::string> GetConvolutionAlgorithmKey(
+    wrapper::CurrentContext current, const TensorDescriptorData& input,
+    const TensorDescriptorData& filter, const TensorDescriptorData& output,
+    llvm::ArrayRef<ssize_t> paddings, llvm::ArrayRef<ssize_t> strides,
+    llvm::ArrayRef<ssize_t> dilations, cudnnDataType_t conv_dtype,
+    cudnnMathType_t math_type) {
+  TFRT_ASSIGN_OR_RETURN(auto prefix, GetConvolutionAlgorithmKeyPrefix(current));
+  std::string key;
+  llvm::raw_string_ostream(key)
+      << prefix << ";in=" << input << ";filter=" << filter
+      << ";out=" << output << ";pad=" << Join(paddings, ",")
+      << ";stride=" << Join(strides, ",")
+      << ";dilation=" << Join(dilations, ",") << ";type=" << conv_dtype
+      << ";math=" << static_cast<int>(math_type);
+  return key;
+}
 
- private:
-  static size_t Hash(const TensorDescriptorData& data) {
-    std::hash<int> hash;
-    size_t result = hash(data.dtype);
-    for (const auto& dim : data.dimensions) Combine(result, hash(dim));
-    for (const auto& stride : data.strides) Combine(result, hash(stride));
-    return result;
+// Benchmarks all cudnnConvolutionForward algorithms and returns the fastest
+// one that fits into the largest workspace the allocator can provide.
+static llvm::Expected<ConvolutionAlgorithm> AutotuneConvolutionForward(
+    GpuDispatchContext* dctx, cudnnTensorDescriptor_t input_desc,
+    wrapper::Pointer<const void> input_ptr, cudnnFilterDescriptor_t filter_desc,
+    wrapper::Pointer<const void> filter_ptr,
+    cudnnConvolutionDescriptor_t conv_desc, cudnnTensorDescriptor_t output_desc,
+    wrapper::Pointer<void> output_ptr,
+    RCReference<GpuCrtBuffer>& workspace_buffer) {
+  size_t workspace_size_bytes = 0;
+  wrapper::Pointer<void> workspace_ptr(nullptr,
+                                       dctx->dnn_handle().platform());
+  for (size_t mega_bytes : {1024, 128, 16}) {
+    if (auto buffer = dctx->allocator()->AllocateBuffer(mega_bytes << 20,
+                                                        dctx->stream())) {
+      workspace_buffer = std::move(*buffer);
+      workspace_size_bytes = workspace_buffer->size();
+      workspace_ptr = workspace_buffer->pointer();
+      break;
+    } else {
+      llvm::consumeError(buffer.takeError());
+    }
   }
 
-  static void Combine(size_t& seed, size_t value) {
-    // boost::hash_combine.
-    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  TFRT_ASSIGN_OR_RETURN(
+      auto algo_perfs,
+      wrapper::CudnnFindConvolutionForwardAlgorithm(
+          dctx->current_context(), dctx->dnn_handle(), input_desc, input_ptr,
+          filter_desc, filter_ptr, conv_desc, output_desc, output_ptr,
+          CUDNN_CONVOLUTION_FWD_ALGO_COUNT, workspace_ptr,
+          workspace_size_bytes));
+  // The results are sorted by execution time.
+  for (const auto& algo_perf : algo_perfs) {
+    if (algo_perf.status != CUDNN_STATUS_SUCCESS) continue;
+    if (algo_perf.memory > workspace_size_bytes) continue;
+    return ConvolutionAlgorithm{algo_perf.algo, algo_perf.memory,
+                                algo_perf.mathType};
   }
-};
-
-// T should be cudnnConvolution{Fwd,BwdData,BwdFilter}Algo_t.
-template <typename T>
-using ConvolutionAlgorithmMap = std::unordered_map<
-    ConvolutionAlgorithmKey,
-    std::tuple<T /*algo*/, size_t /*workspace_size_bytes*/, cudnnMathType_t>,
-    ConvolutionAlgorithmHash>;
-
-auto& GetConvolutionForwardAlgorithmMap() {
-  static auto* map = new ConvolutionAlgorithmMap<cudnnConvolutionFwdAlgo_t>();
-  return *map;
+  return MakeStringError("No cudnnConvolutionForward algorithm fits into ",
+                         workspace_size_bytes, " bytes of workspace");
 }
 
-static llvm::Expected<DenseGpuTensor> ComputeConvGpuOp(
+// Computes the convolution of `input` and `filter`. If `bias` is not null, it
+// is added to the output channels before applying the activation.
+static llvm::Expected<DenseGpuTensor> ComputeConv(
     GpuDispatchContext* dctx, const DenseGpuTensor& input,
-    const DenseGpuTensor& filter, const OpAttrsRef& attrs,
+    const DenseGpuTensor& filter, const DenseGpuTensor* bias,
+    FusedActivationMode activation_mode, const OpAttrsRef& attrs,
     const TensorMetadata& result_md) {
   TFRT_ASSIGN_OR_RETURN(auto temp_buffer,
                         AllocateBuffer(dctx, filter.dtype(), filter.shape()));
@@ -363,13 +407,19 @@ static llvm::Expected<DenseGpuTensor> ComputeConvGpuOp(
     auto reshaped_filter = filter.WithShape(
         TensorShape(llvm::makeArrayRef(filter_dims_hwio).take_back(2)));
     if (auto error =
-            RunCublasGemm(dctx->current_context(), dctx->blas_handle(),
-                          /*transpose_a=*/false, /*transpose_b=*/false,
+            RunCublasGemm(dctx, /*transpose_a=*/false, /*transpose_b=*/false,
                           reshaped_input.getValue(), reshaped_filter.getValue(),
                           output_buffer.get()))
       return std::move(error);
-    return DenseGpuTensor(result_md.shape, result_md.dtype,
+    DenseGpuTensor output(result_md.shape, result_md.dtype,
                           std::move(output_buffer));
+    if (bias) {
+      if (auto error = BiasActivation(
+              dctx->current_context(), dctx->stream(), channel_order, output,
+              *bias, activation_mode, &output.buffer()))
+        return std::move(error);
+    }
+    return std::move(output);
   }
 
   TFRT_ASSIGN_OR_RETURN(
@@ -411,9 +461,15 @@ static llvm::Expected<DenseGpuTensor> ComputeConvGpuOp(
           conv_dtype))
     return std::move(error);
 
-  // Opt-in to use tensor cores. This might be overwritten below.
-  if (auto error = wrapper::CudnnSetConvolutionMathType(conv_desc.get(),
-                                                        CUDNN_TENSOR_OP_MATH))
+  // Opt-in to use tensor cores. This might be overwritten below. The mixed
+  // precision policy lets cuDNN convert F32 operands to F16 for tensor cores,
+  // which avoids separate casts of the input, filter and output tensors.
+  auto math_type = CUDNN_TENSOR_OP_MATH;
+  if (dctx->mixed_precision() == MixedPrecision::kFloat16 &&
+      input_data.dtype == CUDNN_DATA_FLOAT)
+    math_type = CUDNN_TENSOR_OP_MATH_ALLOW_CONVERSION;
+  if (auto error =
+          wrapper::CudnnSetConvolutionMathType(conv_desc.get(), math_type))
     return std::move(error);
 
   cudnnConvolutionFwdAlgo_t algo;
@@ -431,35 +487,27 @@ static llvm::Expected<DenseGpuTensor> ComputeConvGpuOp(
             dctx->dnn_handle(), input_desc.get(), filter_desc.get(),
             conv_desc.get(), output_desc.get(), algo));
   } else {
-    auto& map = GetConvolutionForwardAlgorithmMap();
-    auto key = std::make_tuple(input_data, filter_data, output_data);
-    auto it = map.find(key);
-    if (it == map.end()) {
-      for (size_t mega_bytes : {1024, 128, 16, 0}) {
-        workspace_size_bytes = mega_bytes * 1024 * 1024;
-        if (workspace_size_bytes == 0) break;
-        if (auto workspace_buffer_or_error = dctx->allocator()->AllocateBuffer(
-                workspace_size_bytes, dctx->stream())) {
-          workspace_buffer = std::move(*workspace_buffer_or_error);
-          break;
-        }
-      }
+    TFRT_ASSIGN_OR_RETURN(
+        auto key, GetConvolutionAlgorithmKey(
+                      dctx->current_context(), input_data, filter_data,
+                      output_data, paddings, windowed_output_data.strides,
+                      windowed_output_data.dilations, conv_dtype, math_type));
+    auto& cache = ConvolutionAlgorithmCache::Get();
+    auto algorithm = cache.Find(key);
+    if (!algorithm) {
       TFRT_ASSIGN_OR_RETURN(
-          auto algo_perfs,
-          wrapper::CudnnFindConvolutionForwardAlgorithm(
-              dctx->current_context(), dctx->dnn_handle(), input_desc.get(),
-              input_ptr, filter_desc.get(), temp_buffer->pointer(),
-              conv_desc.get(), output_desc.get(), output_buffer->pointer(), 1,
-              workspace_buffer->pointer(), workspace_size_bytes));
-      const auto& algo_perf = algo_perfs.front();
-      it = map.emplace_hint(it, key,
-                            std::make_tuple(algo_perf.algo, algo_perf.memory,
-                                            algo_perf.mathType));
+          algorithm,
+          AutotuneConvolutionForward(
+              dctx, input_desc.get(), input_ptr, filter_desc.get(),
+              temp_buffer->pointer(), conv_desc.get(), output_desc.get(),
+              output_buffer->pointer(), workspace_buffer));
+      cache.Insert(key, *algorithm);
     }
-    algo = std::get<cudnnConvolutionFwdAlgo_t>(it->second);
-    workspace_size_bytes = std::get<size_t>(it->second);
+    algo = static_cast<cudnnConvolutionFwdAlgo_t>(algorithm->algo);
+    workspace_size_bytes = algorithm->workspace_size_bytes;
     if (auto error = wrapper::CudnnSetConvolutionMathType(
-            conv_desc.get(), std::get<cudnnMathType_t>(it->second)))
+            conv_desc.get(),
+            static_cast<cudnnMathType_t>(algorithm->math_type)))
       return std::move(error);
   }
 
@@ -476,6 +524,41 @@ static llvm::Expected<DenseGpuTensor> ComputeConvGpuOp(
         return workspace_buffer->pointer();
       }());
 
+  // cuDNN fuses the bias and ReLU into the convolution, or the bias alone
+  // with the implicit precomputed GEMM algorithm. Other activations are
+  // applied in a separate pass.
+  if (bias && (activation_mode == FusedActivationMode::kRelu ||
+               (activation_mode == FusedActivationMode::kIdentity &&
+                algo == CUDNN_CONVOLUTION_FWD_ALGO_IMPLICIT_PRECOMP_GEMM))) {
+    llvm::SmallVector<ssize_t, 4> bias_dims(rank, 1);
+    bias_dims[1] = output_dims_nchw[1];
+    TFRT_ASSIGN_OR_RETURN(
+        auto bias_data,
+        GetTensorDescriptorData(bias->dtype(), bias_dims, channel_order));
+    TFRT_ASSIGN_OR_RETURN(auto bias_desc, CreateTensorDescriptor(bias_data));
+    TFRT_ASSIGN_OR_RETURN(auto activation_desc,
+                          wrapper::CudnnCreateActivationDescriptor());
+    if (auto error = wrapper::CudnnSetActivationDescriptor(
+            activation_desc.get(),
+            activation_mode == FusedActivationMode::kRelu
+                ? CUDNN_ACTIVATION_RELU
+                : CUDNN_ACTIVATION_IDENTITY,
+            CUDNN_PROPAGATE_NAN, /*coefficient=*/0.0))
+      return std::move(error);
+    // The output doubles as the (zero weighted) side input 'z'.
+    if (auto error = wrapper::CudnnConvolutionBiasActivationForward(
+            dctx->current_context(), dctx->dnn_handle(),
+            alpha.pointer(platform), input_desc.get(), input_ptr,
+            filter_desc.get(), temp_buffer->pointer(), conv_desc.get(), algo,
+            workspace_ptr, workspace_size_bytes, beta.pointer(platform),
+            output_desc.get(), output_buffer->pointer(), bias_desc.get(),
+            bias->buffer().pointer(), activation_desc.get(), output_desc.get(),
+            output_buffer->pointer()))
+      return std::move(error);
+    return DenseGpuTensor(result_md.shape, result_md.dtype,
+                          std::move(output_buffer));
+  }
+
   if (auto error = wrapper::CudnnConvolutionForward(
           dctx->current_context(), dctx->dnn_handle(), alpha.pointer(platform),
           input_desc.get(), input_ptr, filter_desc.get(),
@@ -484,8 +567,52 @@ static llvm::Expected<DenseGpuTensor> ComputeConvGpuOp(
           output_buffer->pointer()))
     return std::move(error);
 
-  return DenseGpuTensor(result_md.shape, result_md.dtype,
+  DenseGpuTensor output(result_md.shape, result_md.dtype,
                         std::move(output_buffer));
+  if (bias) {
+    if (auto error = BiasActivation(dctx->current_context(), dctx->stream(),
+                                    channel_order, output, *bias,
+                                    activation_mode, &output.buffer()))
+      return std::move(error);
+  }
+  return std::move(output);
+}
+
+static llvm::Expected<DenseGpuTensor> ComputeConvGpuOp(
+    GpuDispatchContext* dctx, const DenseGpuTensor& input,
+    const DenseGpuTensor& filter, const OpAttrsRef& attrs,
+    const TensorMetadata& result_md) {
+  return ComputeConv(dctx, input, filter, /*bias=*/nullptr,
+                     FusedActivationMode::kIdentity, attrs, result_md);
+}
+
+static llvm::Expected<DenseGpuTensor> ComputeFusedConvGpuOp(
+    GpuDispatchContext* dctx, const DenseGpuTensor& input,
+    const DenseGpuTensor& filter, RepeatedArguments<DenseGpuTensor> args,
+    const OpAttrsRef& attrs, const TensorMetadata& result_md) {
+  auto fused_ops_attr = attrs.GetAsserting<AggregateAttr>("fused_ops");
+  llvm::SmallVector<string_view, 2> fused_ops;
+  for (int i = 0; i < fused_ops_attr.GetNumElements(); ++i)
+    fused_ops.push_back(
+        fused_ops_attr.GetAttribute(i).cast<StringAttr>().GetValue());
+  TFRT_ASSIGN_OR_RETURN(auto activation_mode,
+                        ParseFusedActivationMode(fused_ops));
+
+  if (args.size() != 1)
+    return MakeStringError("Expected one bias argument, got ", args.size());
+  const auto& bias = args[0];
+  auto data_format = attrs.GetStringOptional("data_format");
+  auto channel_order = GetTfChannelOrder(data_format);
+  const ssize_t channels = result_md.shape.GetDimensionSize(
+      channel_order == ChannelOrder::ChannelFirst
+          ? 1
+          : result_md.shape.GetRank() - 1);
+  if (bias.shape().GetRank() != 1 || bias.NumElements() != channels)
+    return MakeStringError("Bias shape ", bias.shape(),
+                           " does not match output channels ", channels);
+
+  return ComputeConv(dctx, input, filter, &bias, activation_mode, attrs,
+                     result_md);
 }
 
 static llvm::Expected<DenseGpuTensor> ComputeMaxPoolGpuOp(
@@ -753,6 +880,9 @@ void RegisterDnnGpuTfOps(GpuOpRegistry* registry) {
   registry->AddOp(
       "tf.Conv2D", TFRT_GPU_OP(gpu::ComputeConvGpuOp),
       {"padding", "explicit_paddings", "data_format", "strides", "dilations"});
+  registry->AddOp("tf._FusedConv2D", TFRT_GPU_OP(gpu::ComputeFusedConvGpuOp),
+                  {"padding", "explicit_paddings", "data_format", "strides",
+                   "dilations", "fused_ops"});
   registry->AddOp("tf.MaxPool", TFRT_GPU_OP(gpu::ComputeMaxPoolGpuOp),
                   {"padding", "explicit_paddings", "data_format", "strides",
                    "dilations", "ksize"});
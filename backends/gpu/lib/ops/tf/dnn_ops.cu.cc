@@ -17,6 +17,9 @@
 // Implements hand-written CUDA kernels useful for DNN ops.
 #include "dnn_ops_cu.h"
 //
+#include <functional>
+#include <numeric>
+
 #include "tfrt/common/ops/tf/dnn_ops_util.h"
 // TODO(fishx): use gpu native type instead of eigen for fp16.
 #include "tfrt/common/compat/eigen/eigen_dtype.h"
@@ -24,6 +27,7 @@
 #include "tfrt/gpu/memory/gpu_buffer.h"
 #include "tfrt/gpu/tensor/dense_gpu_tensor.h"
 #include "tfrt/gpu/wrapper/cudart_wrapper.h"
+#include "tfrt/support/string_util.h"
 
 namespace tfrt {
 namespace gpu {
@@ -596,6 +600,94 @@ struct FusedBatchNormInferenceFunctor {
   }
 };
 
+// -------------------------------------------------------------------------- //
+// BiasActivation implementation.                                             //
+// -------------------------------------------------------------------------- //
+
+template <FusedActivationMode activation_mode, typename U>
+__device__ U Activate(U x) {
+  if (activation_mode == FusedActivationMode::kRelu) {
+    return x < U(0) ? U(0) : x;
+  } else if (activation_mode == FusedActivationMode::kRelu6) {
+    return x < U(0) ? U(0) : (x > U(6) ? U(6) : x);
+  } else if (activation_mode == FusedActivationMode::kElu) {
+    return x < U(0) ? expm1(x) : x;
+  } else if (activation_mode == FusedActivationMode::kGeluApproximate) {
+    const U kSqrt2OverPi = U(0.7978845608028654);
+    return U(0.5) * x *
+           (U(1) + tanh(kSqrt2OverPi * (x + U(0.044715) * x * x * x)));
+  } else if (activation_mode == FusedActivationMode::kGeluExact) {
+    const U kSqrtHalf = U(0.7071067811865476);
+    return U(0.5) * x * (U(1) + erf(x * kSqrtHalf));
+  }
+  return x;
+}
+
+// Adds the per channel 'bias' to 'in' and applies the activation. The
+// computation is performed in type U. 'in' and 'out' may alias.
+template <typename T, typename U, FusedActivationMode activation_mode>
+__global__ void BiasActivationKernel(int32_t count, int32_t channels_size,
+                                     int32_t inner_dim_size, const T* in,
+                                     const T* __restrict__ bias, T* out) {
+  int32_t index = blockIdx.x * blockDim.x + threadIdx.x;
+  const int32_t total_device_threads = gridDim.x * blockDim.x;
+
+  while (index < count) {
+    const int32_t channel = (index / inner_dim_size) % channels_size;
+    U value = U(in[index]) + U(bias[channel]);
+    out[index] = T(Activate<activation_mode>(value));
+    index += total_device_threads;
+  }
+}
+
+template <typename T, typename U>
+llvm::Error LaunchBiasActivation(wrapper::CurrentContext current,
+                                 const wrapper::Stream& stream,
+                                 ChannelOrder channel_order,
+                                 const DenseGpuTensor& input,
+                                 const DenseGpuTensor& bias,
+                                 FusedActivationMode activation_mode,
+                                 GpuCrtBuffer* output_buffer) {
+  int32_t count = input.NumElements();
+  if (count == 0) return llvm::Error::success();
+
+  TFRT_ASSIGN_OR_RETURN(GpuLaunchConfig config,
+                        GetGpuLaunchConfig(current, count));
+
+  // Channels are the innermost dimension, or the second dimension for
+  // channels first layouts.
+  auto input_shape = GetDimensions(input.shape());
+  int32_t channels_size = input_shape.back();
+  int32_t inner_dim_size = 1;
+  if (channel_order == ChannelOrder::ChannelFirst) {
+    channels_size = input_shape[1];
+    inner_dim_size = std::accumulate(input_shape.begin() + 2,
+                                     input_shape.end(), 1,
+                                     std::multiplies<ssize_t>());
+  }
+
+  auto launch = [&](auto* kernel) {
+    return wrapper::CudaLaunchKernel(
+        current, kernel, config.block_count, config.thread_per_block, 0,
+        stream, count, channels_size, inner_dim_size, GetRawPointer<T>(input),
+        GetRawPointer<T>(bias), GetRawPointer<T>(*output_buffer));
+  };
+
+  switch (activation_mode) {
+#define ACTIVATION_CASE(mode)                                    \
+  case FusedActivationMode::mode:                                \
+    return launch(&BiasActivationKernel<T, U, FusedActivationMode::mode>);
+    ACTIVATION_CASE(kIdentity)
+    ACTIVATION_CASE(kRelu)
+    ACTIVATION_CASE(kRelu6)
+    ACTIVATION_CASE(kElu)
+    ACTIVATION_CASE(kGeluApproximate)
+    ACTIVATION_CASE(kGeluExact)
+#undef ACTIVATION_CASE
+  }
+  return MakeStringError("no bias activation kernel was launched");
+}
+
 }  // namespace
 
 llvm::Error TransformFilterTensor(wrapper::CurrentContext current,
@@ -647,5 +739,48 @@ llvm::Error FusedBatchNormEx(
   return llvm::Error::success();
 }
 
+llvm::Expected<FusedActivationMode> ParseFusedActivationMode(
+    llvm::ArrayRef<string_view> fused_ops) {
+  if (fused_ops.empty() || fused_ops.front() != "BiasAdd")
+    return MakeStringError("Fused ops must start with BiasAdd");
+  if (fused_ops.size() == 1) return FusedActivationMode::kIdentity;
+  if (fused_ops.size() == 2) {
+    auto activation = fused_ops.back();
+    if (activation == "Relu") return FusedActivationMode::kRelu;
+    if (activation == "Relu6") return FusedActivationMode::kRelu6;
+    if (activation == "Elu") return FusedActivationMode::kElu;
+    if (activation == "GeluApproximate")
+      return FusedActivationMode::kGeluApproximate;
+    if (activation == "GeluExact") return FusedActivationMode::kGeluExact;
+  }
+  return MakeStringError("Unsupported fused ops: ", Join(fused_ops, ","));
+}
+
+llvm::Error BiasActivation(wrapper::CurrentContext current,
+                           const wrapper::Stream& stream,
+                           ChannelOrder channel_order,
+                           const DenseGpuTensor& input,
+                           const DenseGpuTensor& bias,
+                           FusedActivationMode activation_mode,
+                           GpuCrtBuffer* output_buffer) {
+  switch (input.dtype().kind()) {
+    case DType::F16:
+      return LaunchBiasActivation<Eigen::half, float>(
+          current, stream, channel_order, input, bias, activation_mode,
+          output_buffer);
+    case DType::F32:
+      return LaunchBiasActivation<float, float>(current, stream, channel_order,
+                                                input, bias, activation_mode,
+                                                output_buffer);
+    case DType::F64:
+      return LaunchBiasActivation<double, double>(
+          current, stream, channel_order, input, bias, activation_mode,
+          output_buffer);
+    default:
+      return MakeStringError("BiasActivation does not support dtype: ",
+                             input.dtype());
+  }
+}
+
 }  // namespace gpu
 }  // namespace tfrt
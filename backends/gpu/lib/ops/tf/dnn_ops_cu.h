@@ -50,6 +50,33 @@ llvm::Error FusedBatchNormEx(
     const DenseGpuTensor* side_input, float epsilon,
     FusedBatchNormActivationMode activation_mode, GpuCrtBuffer* output_buffer);
 
+// Activations of the fused contraction ops tf._FusedMatMul and
+// tf._FusedConv2D, which are applied after adding the bias.
+enum class FusedActivationMode {
+  kIdentity,
+  kRelu,
+  kRelu6,
+  kElu,
+  kGeluApproximate,
+  kGeluExact
+};
+
+// Parses the 'fused_ops' attribute of the fused contraction ops. Only
+// "BiasAdd", optionally followed by an activation, is supported.
+llvm::Expected<FusedActivationMode> ParseFusedActivationMode(
+    llvm::ArrayRef<string_view> fused_ops);
+
+// Adds `bias` to the channels of `input`, applies the activation and writes
+// the output into `output_buffer`. `output_buffer` may be the buffer of
+// `input`, which avoids an extra allocation.
+llvm::Error BiasActivation(wrapper::CurrentContext current,
+                           const wrapper::Stream& stream,
+                           ChannelOrder channel_order,
+                           const DenseGpuTensor& input,
+                           const DenseGpuTensor& bias,
+                           FusedActivationMode activation_mode,
+                           GpuCrtBuffer* output_buffer);
+
 }  // namespace gpu
 }  // namespace tfrt
 
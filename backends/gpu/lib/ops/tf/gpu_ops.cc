@@ -40,6 +40,7 @@ void RegisterMlirGpuTfOps(GpuOpRegistry* registry);
 void RegisterNullaryGpuTfOps(GpuOpRegistry* registry);
 void RegisterPadGpuTfOps(GpuOpRegistry* registry);
 void RegisterReductionGpuTfOps(GpuOpRegistry* registry);
+void RegisterShapeGpuTfOps(GpuOpRegistry* registry);
 void RegisterTransposeGpuTfOps(GpuOpRegistry* registry);
 void RegisterUnaryGpuTfOps(GpuOpRegistry* registry);
 
@@ -55,6 +56,7 @@ void RegisterTfGpuOps(GpuOpRegistry* registry) {
   RegisterNullaryGpuTfOps(registry);
   RegisterPadGpuTfOps(registry);
   RegisterReductionGpuTfOps(registry);
+  RegisterShapeGpuTfOps(registry);
   RegisterTransposeGpuTfOps(registry);
   RegisterUnaryGpuTfOps(registry);
 }
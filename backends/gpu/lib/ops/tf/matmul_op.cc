@@ -18,6 +18,8 @@
 #include <immintrin.h>
 
 #include "blas_support.h"
+#include "cast_op.h"
+#include "dnn_ops_cu.h"
 #include "tfrt/core_runtime/op_attr_type.h"
 #include "tfrt/core_runtime/op_attrs.h"
 #include "tfrt/core_runtime/op_utils.h"
@@ -28,7 +30,9 @@
 #include "tfrt/gpu/memory/gpu_buffer.h"
 #include "tfrt/gpu/tensor/dense_gpu_tensor.h"
 #include "tfrt/gpu/wrapper/wrapper.h"
+#include "tfrt/host_context/attribute_utils.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/fp16.h"
 #include "tfrt/support/logging.h"
@@ -75,7 +79,7 @@ static llvm::Error CallCublasGemm(wrapper::CurrentContext current,
                                   uint64_t n, const gpu::DenseGpuTensor& a,
                                   const gpu::DenseGpuTensor& b,
                                   GpuCrtBuffer* result) {
-  TFRT_TRACE_SCOPE(Default, "CublasGemm");
+  TFRT_TRACE_STATIC_SCOPE(Default, "CublasGemm");
   // Blas expects matrices in column major.
   // Use C' = B' x A' (' stands for transpose)
   // clang-format off
@@ -120,11 +124,53 @@ llvm::Error RunCublasGemm(wrapper::CurrentContext current,
   }
 }
 
+// Converts the F32 matrices `a` and `b` to F16 and multiplies them on tensor
+// cores. The products are accumulated and returned in F32.
+static llvm::Error RunCublasGemmF16(GpuDispatchContext* dctx, bool transpose_a,
+                                    bool transpose_b, uint64_t m, uint64_t k,
+                                    uint64_t n, const gpu::DenseGpuTensor& a,
+                                    const gpu::DenseGpuTensor& b,
+                                    GpuCrtBuffer* result) {
+  TFRT_TRACE_STATIC_SCOPE(Default, "CublasGemmEx");
+  TFRT_ASSIGN_OR_RETURN(auto a_f16, CastGpuTensor(dctx, a, DType(DType::F16)));
+  TFRT_ASSIGN_OR_RETURN(auto b_f16, CastGpuTensor(dctx, b, DType(DType::F16)));
+  auto handle = dctx->blas_handle();
+  auto platform = handle.platform();
+  // clang-format off
+  return wrapper::CublasGemmEx(
+      dctx->current_context(), handle,
+      transpose_b ? CUBLAS_OP_T : CUBLAS_OP_N,
+      transpose_a ? CUBLAS_OP_T : CUBLAS_OP_N,
+      n, m, k,
+      ConstValue<float>(1.0).pointer(platform),
+      b_f16.buffer().pointer(), CUDA_R_16F, transpose_b ? k : n,
+      a_f16.buffer().pointer(), CUDA_R_16F, transpose_a ? m : k,
+      ConstValue<float>(0.0).pointer(platform),
+      result->pointer(), CUDA_R_32F, n,
+      CUDA_R_32F, CUBLAS_GEMM_DEFAULT_TENSOR_OP);
+  // clang-format on
+}
+
+llvm::Error RunCublasGemm(GpuDispatchContext* dctx, bool transpose_a,
+                          bool transpose_b, const gpu::DenseGpuTensor& a,
+                          const gpu::DenseGpuTensor& b, GpuCrtBuffer* result) {
+  if (dctx->mixed_precision() == MixedPrecision::kFloat16 &&
+      a.dtype().kind() == DType::F32) {
+    const uint64_t m = a.shape().GetDimensionSize(transpose_a ? 1 : 0);
+    const uint64_t k = a.shape().GetDimensionSize(transpose_a ? 0 : 1);
+    const uint64_t n = b.shape().GetDimensionSize(transpose_b ? 0 : 1);
+    return RunCublasGemmF16(dctx, transpose_a, transpose_b, m, k, n, a, b,
+                            result);
+  }
+  return RunCublasGemm(dctx->current_context(), dctx->blas_handle(),
+                       transpose_a, transpose_b, a, b, result);
+}
+
 static llvm::Expected<DenseGpuTensor> GpuMatmulOp(
     GpuDispatchContext* dctx, const gpu::DenseGpuTensor& a,
     const gpu::DenseGpuTensor& b, const OpAttrsRef& attrs,
     const TensorMetadata& result_md) {
-  TFRT_TRACE_SCOPE(Default, "GpuMatmulOp");
+  TFRT_TRACE_STATIC_SCOPE(Default, "GpuMatmulOp");
 
   size_t size_in_bytes = result_md.GetHostSizeInBytes();
   TFRT_ASSIGN_OR_RETURN(RCReference<GpuCrtBuffer> buffer,
@@ -153,8 +199,7 @@ static llvm::Expected<DenseGpuTensor> GpuMatmulOp(
   bool transpose_a = attrs.GetAsserting<bool>("transpose_a");
   bool transpose_b = attrs.GetAsserting<bool>("transpose_b");
   if (auto error =
-          RunCublasGemm(dctx->current_context(), dctx->blas_handle(),
-                        transpose_a, transpose_b, a, b, buffer.get())) {
+          RunCublasGemm(dctx, transpose_a, transpose_b, a, b, buffer.get())) {
     // TODO(iga): Propagate original error.
     return std::move(error);
   }
@@ -162,9 +207,45 @@ static llvm::Expected<DenseGpuTensor> GpuMatmulOp(
   return DenseGpuTensor(result_md.shape, result_md.dtype, std::move(buffer));
 }
 
+// Computes the matmul with cuBLAS, then adds the bias and applies the
+// activation in a single pass over the result.
+static llvm::Expected<DenseGpuTensor> GpuFusedMatmulOp(
+    GpuDispatchContext* dctx, const gpu::DenseGpuTensor& a,
+    const gpu::DenseGpuTensor& b, RepeatedArguments<DenseGpuTensor> args,
+    const OpAttrsRef& attrs, const TensorMetadata& result_md) {
+  TFRT_TRACE_STATIC_SCOPE(Default, "GpuFusedMatmulOp");
+
+  auto fused_ops_attr = attrs.GetAsserting<AggregateAttr>("fused_ops");
+  SmallVector<string_view, 2> fused_ops;
+  for (int i = 0; i < fused_ops_attr.GetNumElements(); ++i)
+    fused_ops.push_back(
+        fused_ops_attr.GetAttribute(i).cast<StringAttr>().GetValue());
+  TFRT_ASSIGN_OR_RETURN(auto activation_mode,
+                        ParseFusedActivationMode(fused_ops));
+
+  if (args.size() != 1)
+    return MakeStringError("Expected one bias argument, got ", args.size());
+  const auto& bias = args[0];
+  const ssize_t inner_dim = result_md.shape.GetDimensionSize(1);
+  if (bias.shape().GetRank() != 1 || bias.NumElements() != inner_dim)
+    return MakeStringError("Bias shape ", bias.shape(),
+                           " does not match output inner dimension ",
+                           inner_dim);
+
+  TFRT_ASSIGN_OR_RETURN(auto result,
+                        GpuMatmulOp(dctx, a, b, attrs, result_md));
+  if (auto error = BiasActivation(
+          dctx->current_context(), dctx->stream(), ChannelOrder::ChannelLast,
+          result, bias, activation_mode, &result.buffer()))
+    return std::move(error);
+  return std::move(result);
+}
+
 void RegisterMatmulGpuTfOps(GpuOpRegistry* registry) {
   registry->AddOp("tf.MatMul", TFRT_GPU_OP(gpu::GpuMatmulOp),
                   {"transpose_a", "transpose_b"});
+  registry->AddOp("tf._FusedMatMul", TFRT_GPU_OP(gpu::GpuFusedMatmulOp),
+                  {"transpose_a", "transpose_b", "fused_ops"});
 }
 
 }  // namespace gpu
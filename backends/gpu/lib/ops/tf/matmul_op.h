@@ -25,6 +25,7 @@
 namespace tfrt {
 namespace gpu {
 class GpuOpRegistry;
+class GpuDispatchContext;
 class DenseGpuTensor;
 class GpuCrtBuffer;
 
@@ -32,6 +33,12 @@ llvm::Error RunCublasGemm(wrapper::CurrentContext current,
                           wrapper::BlasHandle handle, bool transpose_a,
                           bool transpose_b, const DenseGpuTensor& a,
                           const DenseGpuTensor& b, GpuCrtBuffer* result);
+
+// Like above, but on the BLAS handle of `dctx` and in the precision of its
+// mixed precision policy.
+llvm::Error RunCublasGemm(GpuDispatchContext* dctx, bool transpose_a,
+                          bool transpose_b, const DenseGpuTensor& a,
+                          const DenseGpuTensor& b, GpuCrtBuffer* result);
 }  // namespace gpu
 }  // namespace tfrt
 
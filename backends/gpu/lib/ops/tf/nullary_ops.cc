@@ -18,10 +18,10 @@
 #include "tfrt/gpu/core_runtime/gpu_dispatch_context.h"
 #include "tfrt/gpu/core_runtime/gpu_op_registry.h"
 #include "tfrt/gpu/core_runtime/gpu_op_utils.h"
+#include "tfrt/gpu/device/event_manager.h"
 #include "tfrt/gpu/memory/gpu_buffer.h"
 #include "tfrt/gpu/tensor/dense_gpu_tensor.h"
 #include "tfrt/gpu/wrapper/wrapper.h"
-#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/tensor/tensor_serialize_utils.h"
 
@@ -64,15 +64,15 @@ static llvm::Expected<DenseGpuTensor> GpuConstOp(
     return std::move(error);
 
   // `frozen_attrs` needs to live until the memcpy is done.
-  bool work_enqueued = EnqueueBlockingWork(
-      exec_ctx,
-      [frozen_attrs = std::move(frozen_attrs), event = std::move(event)] {
-        // FIXME(sanjoy): How do we handle an error from EventSynchronize here?
-        llvm::ExitOnError die_if_error;
-        die_if_error(wrapper::EventSynchronize(event.get()));
-      });
-  if (!work_enqueued)
-    return MakeStringError("enqueue to blocking work queue failed");
+  wrapper::Event event_handle = event.get();
+  EventManager::Get(dctx->current_context().context())
+      .Then(event_handle, exec_ctx.host(),
+            [frozen_attrs = std::move(frozen_attrs),
+             event = std::move(event)](llvm::Error error) {
+              // FIXME(sanjoy): How do we handle an error from the event here?
+              llvm::ExitOnError die_if_error;
+              die_if_error(std::move(error));
+            });
 
   return DenseGpuTensor(result_md.shape, result_md.dtype, std::move(buffer));
 }
@@ -0,0 +1,126 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Implements TF ops that only change the shape of tensors on GPU. The results
+// view the memory of the input in sub-buffers, without launching kernels.
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/common/ops/tf/metadata_functions.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/gpu/core_runtime/gpu_dispatch_context.h"
+#include "tfrt/gpu/core_runtime/gpu_op_registry.h"
+#include "tfrt/gpu/core_runtime/gpu_op_utils.h"
+#include "tfrt/gpu/tensor/dense_gpu_tensor.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace gpu {
+
+// Returns the offset in elements of the slice of `shape` at `begin` with
+// `size`, or an error if the slice is not contiguous in memory, i.e. if it
+// is not a range of the outermost dimension that has more than one element.
+static llvm::Expected<size_t> GetContiguousSliceOffset(
+    const TensorShape& shape, ArrayRef<ssize_t> begin,
+    const TensorShape& size) {
+  const int rank = shape.GetRank();
+  int dim = 0;
+  while (dim < rank && size.GetDimensionSize(dim) == 1) ++dim;
+  for (int i = dim + 1; i < rank; ++i) {
+    if (size.GetDimensionSize(i) != shape.GetDimensionSize(i)) {
+      return MakeStringError("Slice of ", size, " at dimension ", i, " of ",
+                             shape, " is not contiguous in memory");
+    }
+  }
+
+  size_t offset = 0;
+  for (int i = 0; i < rank; ++i) {
+    offset = offset * shape.GetDimensionSize(i) + begin[i];
+  }
+  return offset;
+}
+
+static llvm::Expected<DenseGpuTensor> GpuReshapeFoldedOp(
+    GpuDispatchContext* dctx, const DenseGpuTensor& input,
+    const OpAttrsRef& attrs, const TensorMetadata& result_md) {
+  llvm::Optional<DenseGpuTensor> result = input.WithShape(result_md.shape);
+  if (!result) {
+    return MakeStringError("tf.Reshape cannot reshape ", input.shape(),
+                           " into ", result_md.shape);
+  }
+  return std::move(*result);
+}
+
+static llvm::Expected<DenseGpuTensor> GpuSliceFoldedOp(
+    GpuDispatchContext* dctx, const DenseGpuTensor& input,
+    const OpAttrsRef& attrs, const TensorMetadata& result_md) {
+  llvm::SmallVector<ssize_t, 4> begin;
+  if (auto error = GetFoldedIndices(attrs, "tf.Slice", "begin", &begin))
+    return std::move(error);
+  auto offset =
+      GetContiguousSliceOffset(input.shape(), begin, result_md.shape);
+  if (!offset) return offset.takeError();
+  return input.Slice(*offset, result_md.shape);
+}
+
+// tf.Split has a variable number of results, so the dispatch function is not
+// defined with TFRT_GPU_OP.
+static void GpuSplitFoldedOp(const ExecutionContext& exec_ctx,
+                             GpuDispatchContext* dctx,
+                             ArrayRef<AsyncValue*> inputs,
+                             const OpAttrsRef& attrs,
+                             ArrayRef<TensorMetadata> result_mds,
+                             MutableArrayRef<RCReference<AsyncValue>> results,
+                             AsyncValueRef<Chain>* chain) {
+  auto set_error = [&](Error error) {
+    results[0] = EmitErrorAsync(exec_ctx, std::move(error));
+    for (size_t i = 1; i < results.size(); ++i)
+      results[i] = results[0].CopyRef();
+  };
+
+  const auto& input = inputs[0]->get<DenseGpuTensor>();
+  llvm::SmallVector<ssize_t, 1> split_dim;
+  if (auto error = GetFoldedIndices(attrs, "tf.Split", "split_dim", &split_dim))
+    return set_error(std::move(error));
+  const int rank = input.shape().GetRank();
+  const int dim = (split_dim[0] + rank) % rank;
+
+  // The results are the consecutive slices of `dim`.
+  llvm::SmallVector<ssize_t, 4> begin(rank, 0);
+  for (size_t i = 0; i < results.size(); ++i) {
+    begin[dim] = i * result_mds[i].shape.GetDimensionSize(dim);
+    auto offset =
+        GetContiguousSliceOffset(input.shape(), begin, result_mds[i].shape);
+    if (!offset) return set_error(offset.takeError());
+    auto result = input.Slice(*offset, result_mds[i].shape);
+    if (!result) return set_error(result.takeError());
+    results[i] = MakeAvailableAsyncValueRef<DenseGpuTensor>(std::move(*result))
+                     .ReleaseRCRef();
+  }
+}
+
+void RegisterShapeGpuTfOps(GpuOpRegistry* registry) {
+  // The shape, begin, size and split_dim arguments are folded to dense
+  // attributes.
+  registry->AddOp("_tf.Reshape", TFRT_GPU_OP(gpu::GpuReshapeFoldedOp),
+                  {"shape"});
+  registry->AddOp("_tf.Slice", TFRT_GPU_OP(gpu::GpuSliceFoldedOp),
+                  {"begin", "size"});
+  registry->AddOp("_tf.Split", GpuSplitFoldedOp, {"split_dim"});
+}
+
+}  // namespace gpu
+}  // namespace tfrt
@@ -14,6 +14,7 @@
 
 // Collates list of all unary TF operations.
 
+#include "cast_op.h"
 #include "eigen_helper.cu.h"
 #include "tfrt/core_runtime/op_attrs.h"
 #include "tfrt/gpu/core_runtime/gpu_op_registry.h"
@@ -145,25 +146,31 @@ struct CastImpl<gpu::FunctorSignature<ResultType, InputType>, Rest...> {
   }
 };
 
+// Casts between floating point types.
+using CastOp = CastImpl<gpu::FunctorSignature<float, float>,
+                        gpu::FunctorSignature<float, double>,
+                        gpu::FunctorSignature<float, Eigen::half>,
+                        gpu::FunctorSignature<double, float>,
+                        gpu::FunctorSignature<double, double>,
+                        gpu::FunctorSignature<double, Eigen::half>,
+                        gpu::FunctorSignature<Eigen::half, float>,
+                        gpu::FunctorSignature<Eigen::half, double>,
+                        gpu::FunctorSignature<Eigen::half, Eigen::half>>;
+
 }  // namespace
 
+llvm::Expected<DenseGpuTensor> CastGpuTensor(GpuDispatchContext* dctx,
+                                             const DenseGpuTensor& input,
+                                             DType dtype) {
+  return CastOp::Invoke(dctx, input, OpAttrsRef(),
+                        TensorMetadata(dtype, input.shape()));
+}
+
 void RegisterUnaryGpuTfOps(GpuOpRegistry* registry) {
   registry->AddOp("tf.Tanh", TFRT_GPU_OP(ComputeUnaryElementwiseOpViaEigen<
                                          Eigen::internal::scalar_tanh_op,
                                          DType::F16, DType::F32, DType::F64>));
-  registry->AddOp(
-      "tf.Cast",
-      TFRT_GPU_OP(
-          CastImpl<gpu::FunctorSignature<float, float>,
-                   gpu::FunctorSignature<float, double>,
-                   gpu::FunctorSignature<float, Eigen::half>,
-                   gpu::FunctorSignature<double, float>,
-                   gpu::FunctorSignature<double, double>,
-                   gpu::FunctorSignature<double, Eigen::half>,
-                   gpu::FunctorSignature<Eigen::half, float>,
-                   gpu::FunctorSignature<Eigen::half, double>,
-                   gpu::FunctorSignature<Eigen::half, Eigen::half>>::Invoke),
-      {"Truncate"});
+  registry->AddOp("tf.Cast", TFRT_GPU_OP(CastOp::Invoke), {"Truncate"});
 }
 }  // namespace gpu
 }  // namespace tfrt
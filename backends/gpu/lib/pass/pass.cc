@@ -14,6 +14,8 @@
 
 #include "tfrt/gpu/pass/pass.h"
 
+#include <tuple>
+
 #include "llvm/ADT/STLExtras.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
@@ -126,6 +128,27 @@ struct HoistGpuWaitsPattern : public OpRewritePattern<FuncOp> {
   LogicalResult matchAndRewrite(FuncOp op,
                                 PatternRewriter &rewriter) const override;
 };
+
+// Groups a chain of independent tfrt_gpu.blas.gemm ops of the same shape into
+// a single tfrt_gpu.blas.gemm.grouped op.
+//
+//   %ch1 = tfrt_gpu.blas.gemm %handle, ..., %a0, ..., %b0, ..., %c0, ..., %ch0
+//   %ch2 = tfrt_gpu.blas.gemm %handle, ..., %a1, ..., %b1, ..., %c1, ..., %ch1
+//
+// is rewritten to
+//
+//   %ch2 = tfrt_gpu.blas.gemm.grouped %handle, ..., %ch0,
+//       buffers(%a0, %a1, %b0, %b1, %c0, %c1)
+//
+// Ops are only grouped if none of them accesses the C matrix of another. The
+// buffers are compared by value, i.e. they are assumed not to alias.
+struct GroupBlasGemmPattern : public OpRewritePattern<BlasGemmOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+ private:
+  LogicalResult matchAndRewrite(BlasGemmOp op,
+                                PatternRewriter &rewriter) const override;
+};
 }  // namespace
 
 WrapInAsyncExecPattern::WrapInAsyncExecPattern(MLIRContext *context,
@@ -268,6 +291,79 @@ LogicalResult HoistGpuWaitsPattern::matchAndRewrite(
   return success();
 }
 
+// Returns whether 'lhs' and 'rhs' compute GEMMs of the same shape and with the
+// same parameters.
+static bool IsGroupable(BlasGemmOp lhs, BlasGemmOp rhs) {
+  auto get_params = [](BlasGemmOp op) {
+    return std::make_tuple(op.handle(), op.m(), op.n(), op.k(), op.alpha(),
+                           op.heightA(), op.heightB(), op.beta(),
+                           op.heightC(), op.algo());
+  };
+  return get_params(lhs) == get_params(rhs) &&
+         lhs->getAttrDictionary() == rhs->getAttrDictionary();
+}
+
+// Returns whether 'op' accesses the C matrix of any op in 'group' or vice
+// versa.
+static bool HasConflict(ArrayRef<BlasGemmOp> group, BlasGemmOp op) {
+  return llvm::any_of(group, [&](BlasGemmOp other) {
+    Value c = op.C(), other_c = other.C();
+    return c == other.A() || c == other.B() || c == other_c ||
+           other_c == op.A() || other_c == op.B();
+  });
+}
+
+// Returns the op that is the only user of the chain result of 'op', if that
+// op is a tfrt_gpu.blas.gemm.
+static BlasGemmOp GetNextGemm(BlasGemmOp op) {
+  Value chain = op.getResult();
+  if (!chain.hasOneUse()) return nullptr;
+  auto next = dyn_cast<BlasGemmOp>(*chain.user_begin());
+  if (!next || next.chain() != chain) return nullptr;
+  return next;
+}
+
+LogicalResult GroupBlasGemmPattern::matchAndRewrite(
+    BlasGemmOp op, PatternRewriter &rewriter) const {
+  // Only match the first op of a group.
+  if (auto prev = op.chain().getDefiningOp<BlasGemmOp>()) {
+    if (GetNextGemm(prev) == op && IsGroupable(prev, op) &&
+        !HasConflict(prev, op))
+      return rewriter.notifyMatchFailure(op, "not the first op of a group");
+  }
+
+  SmallVector<BlasGemmOp, 4> group = {op};
+  for (auto next = GetNextGemm(op);
+       next && IsGroupable(op, next) && !HasConflict(group, next);
+       next = GetNextGemm(next)) {
+    group.push_back(next);
+  }
+  if (group.size() < 2)
+    return rewriter.notifyMatchFailure(op, "no other op to group with");
+
+  SmallVector<Value, 16> operands = {op.handle(),  op.m(),     op.n(),
+                                     op.k(),       op.alpha(), op.heightA(),
+                                     op.heightB(), op.beta(),  op.heightC(),
+                                     op.algo(),    op.chain()};
+  for (auto gemm : group) operands.push_back(gemm.A());
+  for (auto gemm : group) operands.push_back(gemm.B());
+  for (auto gemm : group) operands.push_back(gemm.C());
+  SmallVector<Location, 4> locations;
+  for (auto gemm : group) locations.push_back(gemm.getLoc());
+
+  // Replace the last op, whose position is dominated by all operands.
+  BlasGemmOp last = group.back();
+  rewriter.setInsertionPoint(last);
+  auto grouped = rewriter.create<BlasGemmGroupedOp>(
+      rewriter.getFusedLoc(locations), last->getResultTypes(), operands,
+      op->getAttrs());
+  rewriter.replaceOp(last, grouped->getResults());
+  for (auto gemm : llvm::reverse(llvm::makeArrayRef(group).drop_back()))
+    rewriter.eraseOp(gemm);
+
+  return success();
+}
+
 void populateGpuAsyncConversionPatterns(RewritePatternSet &patterns,
                                         mlir::TypeConverter &converter,
                                         mlir::ConversionTarget &target) {
@@ -292,5 +388,9 @@ void populateTfrtConversionPatterns(mlir::RewritePatternSet &patterns,
   });
 }
 
+void populateGemmGroupingPatterns(mlir::RewritePatternSet &patterns) {
+  patterns.add<GroupBlasGemmPattern>(patterns.getContext());
+}
+
 }  // namespace gpu
 }  // namespace tfrt
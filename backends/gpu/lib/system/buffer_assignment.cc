@@ -0,0 +1,83 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Implementation of the assignment of temporary buffers to an arena.
+#include "tfrt/gpu/system/buffer_assignment.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "llvm/Support/MathExtras.h"
+
+namespace tfrt {
+namespace gpu {
+
+BufferAssignment AssignBuffers(ArrayRef<TempBuffer> buffers,
+                               size_t alignment) {
+  BufferAssignment result;
+  result.offsets.resize(buffers.size());
+
+  // Place large buffers first, they are the hardest to fit into gaps.
+  std::vector<size_t> order(buffers.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+    return buffers[lhs].size > buffers[rhs].size;
+  });
+
+  std::vector<size_t> placed;  // Indices of placed buffers.
+  std::vector<size_t> conflicts;
+  for (size_t index : order) {
+    const TempBuffer& buffer = buffers[index];
+    if (buffer.size == 0) continue;
+
+    // Placed buffers which are live at the same time, ordered by offset.
+    conflicts.clear();
+    for (size_t other : placed) {
+      if (buffers[other].begin <= buffer.end &&
+          buffer.begin <= buffers[other].end)
+        conflicts.push_back(other);
+    }
+    std::sort(conflicts.begin(), conflicts.end(), [&](size_t lhs, size_t rhs) {
+      return result.offsets[lhs] < result.offsets[rhs];
+    });
+
+    // Find the smallest gap that fits the buffer.
+    size_t offset = 0;
+    size_t best_offset = 0;
+    size_t best_gap = std::numeric_limits<size_t>::max();
+    for (size_t other : conflicts) {
+      size_t other_offset = result.offsets[other];
+      if (offset + buffer.size <= other_offset) {
+        size_t gap = other_offset - offset;
+        if (gap < best_gap) {
+          best_gap = gap;
+          best_offset = offset;
+        }
+      }
+      offset = std::max<size_t>(
+          offset, llvm::alignTo(other_offset + buffers[other].size, alignment));
+    }
+    if (best_gap == std::numeric_limits<size_t>::max()) best_offset = offset;
+
+    result.offsets[index] = best_offset;
+    result.arena_size = std::max(result.arena_size, best_offset + buffer.size);
+    placed.push_back(index);
+  }
+
+  return result;
+}
+
+}  // namespace gpu
+}  // namespace tfrt
@@ -16,30 +16,303 @@
 
 #include "tfrt/gpu/system/system.h"
 
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
 #include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/gpu/device/event_manager.h"
 #include "tfrt/gpu/gpu_types.h"
 #include "tfrt/gpu/wrapper/wrapper.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/attribute_utils.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
 namespace gpu {
 
+// Graphs captured from the executions of a program.
+//
+// The first execution runs normally: it initializes libraries and loads
+// modules, which is not allowed during capture. If it dispatched all work
+// synchronously, later executions are captured into one graph per stream and
+// argument sizes. A graph is replayed as is if the argument pointers did not
+// change, and updated in place with a fresh capture otherwise.
+class ProgramGraphCache {
+ public:
+  // Returns None if the program needs to be executed normally.
+  llvm::Optional<AsyncValueRef<Chain>> Execute(
+      const ExecutionContext& exec_ctx, const Function& fn,
+      ArrayRef<AsyncValue*> args, const GpuStream& stream,
+      ArrayRef<AsyncValueRef<GpuBuffer>> buffers);
+
+ private:
+  // Bounds the device memory used by graphs of programs with dynamic shapes.
+  static constexpr size_t kMaxGraphsPerStream = 64;
+
+  struct Entry {
+    std::vector<void*> pointers;
+    wrapper::OwningGraphExec graph_exec;
+  };
+  using Entries = std::map<std::vector<size_t>, Entry>;
+
+  mutex mu_;
+  bool warmed_up_ TFRT_GUARDED_BY(mu_) = false;
+  bool disabled_ TFRT_GUARDED_BY(mu_) = false;
+  std::unordered_map<wrapper::Stream, Entries> entries_ TFRT_GUARDED_BY(mu_);
+};
+
+llvm::Optional<AsyncValueRef<Chain>> ProgramGraphCache::Execute(
+    const ExecutionContext& exec_ctx, const Function& fn,
+    ArrayRef<AsyncValue*> args, const GpuStream& stream,
+    ArrayRef<AsyncValueRef<GpuBuffer>> buffers) {
+  HostContext* host = exec_ctx.host();
+  auto make_error = [&](const llvm::Error& error) -> AsyncValueRef<Chain> {
+    return MakeErrorAsyncValueRef(host, DecodedDiagnostic(error));
+  };
+  auto run = [&] {
+    RCReference<AsyncValue> result;
+    fn.Execute(exec_ctx, args, {result});
+    return AsyncValueRef<Chain>(std::move(result));
+  };
+
+  mutex_lock lock(mu_);
+  if (disabled_) return llvm::None;
+  if (!warmed_up_) {
+    warmed_up_ = true;
+    auto result = run();
+    // Work dispatched after the function returns would escape the capture.
+    if (!result.IsAvailable()) disabled_ = true;
+    return std::move(result);
+  }
+
+  wrapper::Platform platform = stream.get().platform();
+  std::vector<size_t> sizes;
+  std::vector<void*> pointers;
+  for (const auto& buffer : buffers) {
+    sizes.push_back(buffer->size());
+    pointers.push_back(buffer->pointer().raw(platform));
+  }
+
+  Entries& entries = entries_[stream.get()];
+  auto it = entries.find(sizes);
+  if (it == entries.end()) {
+    if (entries.size() >= kMaxGraphsPerStream) return llvm::None;
+    it = entries.emplace(std::move(sizes), Entry()).first;
+  }
+  Entry& entry = it->second;
+
+  if (entry.graph_exec && entry.pointers == pointers) {
+    if (auto error = wrapper::GraphLaunch(entry.graph_exec.get(), stream.get()))
+      return make_error(error);
+    return MakeAvailableAsyncValueRef<Chain>(host);
+  }
+
+  auto current = wrapper::CtxSetCurrent(stream.context());
+  if (!current) return make_error(current.takeError());
+
+  if (auto error = wrapper::StreamBeginCapture(
+          stream.get(), wrapper::StreamCaptureMode::THREAD_LOCAL)) {
+    TFRT_LOG(WARNING) << "Disabling GPU graphs: " << std::move(error);
+    disabled_ = true;
+    return llvm::None;
+  }
+  auto result = run();
+  auto graph = wrapper::StreamEndCapture(stream.get());
+  if (!graph) {
+    // The function used an API that is not allowed during capture. None of the
+    // captured work has been executed, so the caller runs it again.
+    TFRT_LOG(WARNING) << "Disabling GPU graphs: " << graph.takeError();
+    disabled_ = true;
+    return llvm::None;
+  }
+  if (result.IsError()) return std::move(result);
+  // The warm-up was synchronous, but this execution is not. Launch the
+  // captured part, but don't replay it later.
+  if (!result.IsAvailable()) disabled_ = true;
+
+  bool updated = false;
+  if (entry.graph_exec) {
+    auto update =
+        wrapper::GraphExecUpdate(entry.graph_exec.get(), graph->get());
+    if (!update) return make_error(update.takeError());
+    updated = *update;
+  }
+  if (!updated) {
+    auto graph_exec = wrapper::GraphInstantiate(*current, graph->get());
+    if (!graph_exec) return make_error(graph_exec.takeError());
+    entry.graph_exec = std::move(*graph_exec);
+  }
+  entry.pointers = std::move(pointers);
+
+  if (auto error = wrapper::GraphLaunch(entry.graph_exec.get(), stream.get()))
+    return make_error(error);
+  return std::move(result);
+}
+
+// Arenas for the temporary buffers of a program, one per stream. Executions
+// on the same stream are ordered, so they can share the arena.
+class ProgramArenas {
+ public:
+  explicit ProgramArenas(ArrayRef<TempBuffer> buffers);
+
+  // Returns the temporary buffers for executions on `stream`. The first call
+  // for a stream allocates the arena.
+  Expected<ArrayRef<AsyncValueRef<GpuBuffer>>> Get(
+      HostContext* host, const AsyncValueRef<GpuStream>& stream);
+
+ private:
+  struct Arena {
+    GpuBuffer memory;
+    // Views into `memory`, destroyed before it.
+    std::vector<AsyncValueRef<GpuBuffer>> buffers;
+  };
+
+  std::vector<size_t> sizes_;
+  BufferAssignment assignment_;
+
+  mutex mu_;
+  std::unordered_map<wrapper::Stream, Arena> arenas_ TFRT_GUARDED_BY(mu_);
+};
+
+ProgramArenas::ProgramArenas(ArrayRef<TempBuffer> buffers)
+    : assignment_(AssignBuffers(buffers, GpuAllocator::kAlignment)) {
+  for (const auto& buffer : buffers) sizes_.push_back(buffer.size);
+}
+
+Expected<ArrayRef<AsyncValueRef<GpuBuffer>>> ProgramArenas::Get(
+    HostContext* host, const AsyncValueRef<GpuStream>& stream) {
+  mutex_lock lock(mu_);
+  auto it = arenas_.find(stream->get());
+  if (it != arenas_.end())
+    return ArrayRef<AsyncValueRef<GpuBuffer>>(it->second.buffers);
+
+  Arena arena;
+  if (assignment_.arena_size > 0) {
+    auto allocator = MakeAvailableAsyncValueRef<GpuDefaultAllocator>(
+        host, stream->gpu_context());
+    auto memory = GpuBuffer::Allocate(std::move(allocator),
+                                      assignment_.arena_size, stream->get());
+    if (!memory) return memory.takeError();
+    arena.memory = std::move(*memory);
+  }
+  wrapper::Pointer<char> base(arena.memory.pointer());
+  for (size_t i = 0; i < sizes_.size(); ++i) {
+    if (sizes_[i] == 0) {
+      arena.buffers.push_back(MakeAvailableAsyncValueRef<GpuBuffer>(host));
+      continue;
+    }
+    auto allocator = MakeAvailableAsyncValueRef<GpuOneShotAllocator<void>>(
+        host, base + assignment_.offsets[i]);
+    auto buffer = GpuBuffer::Allocate(std::move(allocator), sizes_[i]);
+    if (!buffer) return buffer.takeError();
+    arena.buffers.push_back(
+        MakeAvailableAsyncValueRef<GpuBuffer>(host, std::move(*buffer)));
+  }
+  it = arenas_.emplace(stream->get(), std::move(arena)).first;
+  return ArrayRef<AsyncValueRef<GpuBuffer>>(it->second.buffers);
+}
+
+// The GPU modules embedded in the BEF file of a program. They are collected
+// when the file is opened, and loaded concurrently into the context of each
+// stream that the program executes on, so that the tfrt_gpu.module.load
+// kernels of the first execution don't load them one by one.
+class ProgramModules {
+ public:
+  ProgramModules(std::vector<GpuModuleImage> images, HostContext* host)
+      : images_(std::move(images)), host_(host) {}
+
+  // Waits for pending loads, which read the BEF file.
+  ~ProgramModules();
+
+  // Starts loading the modules into the context of `stream`. Returns a chain
+  // that is ready when they are loaded. Later calls for the same context return
+  // the same chain.
+  AsyncValueRef<Chain> Load(const AsyncValueRef<GpuStream>& stream);
+
+ private:
+  const std::vector<GpuModuleImage> images_;
+  HostContext* const host_;
+
+  mutex mu_;
+  // Keyed by the address of the context. If a context is destroyed and a new
+  // one is created at the same address, the kernels load the modules instead.
+  std::unordered_map<const GpuContext*, AsyncValueRef<Chain>> loaded_
+      TFRT_GUARDED_BY(mu_);
+};
+
+ProgramModules::~ProgramModules() {
+  SmallVector<RCReference<AsyncValue>, 4> pending;
+  mutex_lock lock(mu_);
+  for (const auto& pair : loaded_) {
+    if (!pair.second.IsAvailable())
+      pending.push_back(pair.second.CopyRCRef());
+  }
+  host_->Await(pending);
+}
+
+AsyncValueRef<Chain> ProgramModules::Load(
+    const AsyncValueRef<GpuStream>& stream) {
+  AsyncValueRef<GpuContext> context = stream->gpu_context();
+  mutex_lock lock(mu_);
+  auto it = loaded_.find(context.get());
+  if (it != loaded_.end()) return it->second.CopyRef();
+  const GpuContext* key = context.get();
+  auto chain = LoadModules(std::move(context), images_, host_);
+  loaded_.emplace(key, chain.CopyRef());
+  return chain;
+}
+
+// Returns the modules that the tfrt_gpu.module.load kernels of `bef_file`
+// load. Modules with the same key are only returned once.
+static std::vector<GpuModuleImage> GetModuleImages(const BEFFile& bef_file) {
+  std::vector<GpuModuleImage> images;
+  llvm::DenseSet<uint64_t> keys;
+  bef_file.ForEachKernel(
+      "tfrt_gpu.module.load", [&](ArrayRef<const void*> attributes) {
+        // Attributes are in alphabetical order: data, key.
+        if (attributes.size() != 2) return;
+        StringAttribute data(attributes[0]);
+        Attribute<uint64_t> key(attributes[1]);
+        if (keys.insert(key.get()).second)
+          images.push_back({key.get(), data.get()});
+      });
+  return images;
+}
+
 Program::Program(BefBuffer&& file_buffer, llvm::StringRef function_name,
-                 HostContext* host)
+                 HostContext* host, bool capture_graphs,
+                 ArrayRef<TempBuffer> temp_buffers)
     : file_buffer_(std::move(file_buffer)) {
   bef_file_ = tfrt::BEFFile::Open(file_buffer_, host->GetKernelRegistry(),
                                   host->diag_handler(), host->allocator());
   assert(bef_file_);
   function_ = bef_file_->GetFunction(function_name);
+  auto module_images = GetModuleImages(*bef_file_);
+  if (!module_images.empty()) {
+    modules_ =
+        std::make_unique<ProgramModules>(std::move(module_images), host);
+  }
+  if (!temp_buffers.empty())
+    arenas_ = std::make_unique<ProgramArenas>(temp_buffers);
+  if (capture_graphs) graph_cache_ = std::make_unique<ProgramGraphCache>();
 }
 
+Program::Program(Program&&) = default;
+Program& Program::operator=(Program&&) = default;
+Program::~Program() = default;
+
 /*static*/
 AsyncValueRef<System> System::Initialize(wrapper::Platform platform,
                                          llvm::StringRef prefix,
@@ -185,23 +458,31 @@ AsyncValueRef<Chain> System::TransferFromDevice(ExecutionContext& exec_ctx,
         if (auto error = wrapper::EventRecord(event->get(), stream->get()))
           return out_chain.SetError(error);
 
-        // EventSynchronize needs to be scheduled in the blocking work queue
-        // because it will block caller thread until the event is completed.
-        auto enqueued = EnqueueBlockingWork(
-            exec_ctx,
-            [event = std::move(*event), out_chain = out_chain.CopyRef()] {
-              if (auto error = wrapper::EventSynchronize(event.get()))
-                return out_chain.SetError(error);
-              out_chain.emplace();
-            });
-        if (!enqueued) {
-          return out_chain.SetError(
-              "TransferFromDevice failed: failed to enqueue blocking work");
-        }
+        // The event manager notifies the host when the event is completed,
+        // without blocking a thread until then.
+        wrapper::Event event_handle = event->get();
+        EventManager::Get(stream->context())
+            .Then(event_handle, exec_ctx.host(),
+                  [event = std::move(*event),
+                   out_chain = out_chain.CopyRef()](llvm::Error error) {
+                    if (error) return out_chain.SetError(error);
+                    out_chain.emplace();
+                  });
       });
   return out_chain;
 }
 
+AsyncValueRef<Chain> System::LoadModules(ExecutionContext& exec_ctx,
+                                         Program& program,
+                                         AsyncValueRef<GpuStream> stream) {
+  if (!program.modules_) return GetReadyChain(exec_ctx.host());
+  if (!stream.IsConcrete()) {
+    return MakeErrorAsyncValueRef(
+        "Failed to load modules: stream is not available");
+  }
+  return program.modules_->Load(stream);
+}
+
 AsyncValueRef<Chain> System::Execute(ExecutionContext& exec_ctx,
                                      Program& program,
                                      AsyncValueRef<GpuStream> stream,
@@ -217,8 +498,26 @@ AsyncValueRef<Chain> System::Execute(ExecutionContext& exec_ctx,
   auto num_args = fn->num_arguments();
 
   // Lowering pass for HLO will generate BEF Function with the following
-  // signature: {chain, stream, ...inputs, ...outputs} -> chain
+  // signature: {chain, stream, ...inputs, ...outputs, ...temps} -> chain
   // So we need to prepare and check the arguments first.
+  ArrayRef<AsyncValueRef<GpuBuffer>> temps;
+  if (program.arenas_) {
+    if (!stream.IsConcrete()) {
+      return MakeErrorAsyncValueRef(
+          "Failed to execute lowered function: stream is not available");
+    }
+    auto buffers = program.arenas_->Get(exec_ctx.host(), stream);
+    if (!buffers) {
+      return MakeErrorAsyncValueRef(exec_ctx.host(),
+                                    DecodedDiagnostic(buffers.takeError()));
+    }
+    temps = *buffers;
+  }
+
+  // Load the modules of the program concurrently, ahead of its module.load
+  // kernels, which wait for the modules they need.
+  if (program.modules_ && stream.IsConcrete()) program.modules_->Load(stream);
+
   SmallVector<AsyncValue*, 8> args;
   args.reserve(num_args);
 
@@ -231,6 +530,9 @@ AsyncValueRef<Chain> System::Execute(ExecutionContext& exec_ctx,
   for (auto& output : outputs) {
     args.push_back(output.GetAsyncValue());
   }
+  for (auto& temp : temps) {
+    args.push_back(temp.GetAsyncValue());
+  }
 
   if (args.size() != num_args) {
     return MakeErrorAsyncValueRef(
@@ -238,6 +540,19 @@ AsyncValueRef<Chain> System::Execute(ExecutionContext& exec_ctx,
                args.size(), " v.s. ", num_args));
   }
 
+  if (program.graph_cache_ &&
+      llvm::all_of(args, [](AsyncValue* arg) {
+        return arg->IsAvailable() && !arg->IsError();
+      })) {
+    SmallVector<AsyncValueRef<GpuBuffer>, 8> buffers;
+    for (auto& input : inputs) buffers.push_back(input.CopyRef());
+    for (auto& output : outputs) buffers.push_back(output.CopyRef());
+    for (auto& temp : temps) buffers.push_back(temp.CopyRef());
+    if (auto result = program.graph_cache_->Execute(exec_ctx, *fn, args,
+                                                    *stream, buffers))
+      return std::move(*result);
+  }
+
   tfrt::RCReference<tfrt::AsyncValue> result;
   fn->Execute(exec_ctx, args, {result});
 
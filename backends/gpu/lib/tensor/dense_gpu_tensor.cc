@@ -35,6 +35,16 @@ DenseGpuTensor::DenseGpuTensor(const TensorMetadata& metadata,
                                RCReference<GpuCrtBuffer> buffer)
     : Tensor(metadata), buffer_(std::move(buffer)) {}
 
+llvm::Expected<DenseGpuTensor> DenseGpuTensor::Slice(
+    size_t offset, const TensorShape& shape) const {
+  const size_t element_size = dtype().GetHostSize();
+  auto buffer =
+      GpuCrtBuffer::CreateSubBuffer(buffer_.CopyRef(), offset * element_size,
+                                    shape.GetNumElements() * element_size);
+  if (!buffer) return buffer.takeError();
+  return DenseGpuTensor(shape, dtype(), std::move(*buffer));
+}
+
 void DenseGpuTensor::Print(llvm::raw_ostream& os) const {
   os << "DenseGpuTensor<dtype=" << dtype() << ", shape=" << shape()
      << ", pointer=" << buffer_->pointer() << ">";
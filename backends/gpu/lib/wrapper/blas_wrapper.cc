@@ -150,6 +150,32 @@ llvm::Error BlasGemmStridedBatchedEx(
   }
 }
 
+llvm::Error BlasGemmBatchedEx(
+    CurrentContext current, BlasHandle handle, BlasOperation transA,
+    BlasOperation transB, int m, int n, int k, Pointer<const void> alpha,
+    Pointer<const void*> Aarray, BlasDataType typeA, int heightA,
+    Pointer<const void*> Barray, BlasDataType typeB, int heightB,
+    Pointer<const void> beta, Pointer<void*> Carray, BlasDataType typeC,
+    int heightC, int batchCount, BlasDataType computeType, BlasGemmAlgo algo) {
+  auto platform = handle.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CublasGemmBatchedEx(current, handle, transA, transB, m, n, k,
+                                 alpha, Aarray, typeA, heightA, Barray, typeB,
+                                 heightB, beta, Carray, typeC, heightC,
+                                 batchCount, computeType, algo);
+    case Platform::ROCm:
+      return RocblasGemmBatchedEx(current, handle, transA, transB, m, n, k,
+                                  alpha, Aarray, typeA, heightA, Barray, typeB,
+                                  heightB, beta, Carray, typeC, heightC,
+                                  // Note: pass C as input and output.
+                                  Carray, typeC, heightC, batchCount,
+                                  computeType, algo);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
 }  // namespace wrapper
 }  // namespace gpu
 }  // namespace tfrt
@@ -0,0 +1,193 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Implementation of the NCCL and RCCL API forwarding calls to symbols
+// dynamically loaded from the real libraries.
+#include "tfrt/gpu/wrapper/ccl_stub.h"
+
+#include <utility>
+
+#include "symbol_loader.h"
+
+// Memoizes load of the .so for the NCCL library.
+static void *LoadNcclSymbol(const char *symbol_name) {
+  static SymbolLoader loader("libnccl.so.2");
+  return loader.GetAddressOfSymbol(symbol_name);
+}
+
+// Memoizes load of the .so for the RCCL library.
+static void *LoadRcclSymbol(const char *symbol_name) {
+  static SymbolLoader loader("librccl.so");
+  return loader.GetAddressOfSymbol(symbol_name);
+}
+
+// Calls function 'symbol_name' in the NCCL library with 'args'.
+template <typename Func, Func *, typename... Args>
+static ncclResult_t NcclCall(const char *symbol_name, Args &&...args) {
+  static auto func_ptr = reinterpret_cast<Func *>(LoadNcclSymbol(symbol_name));
+  if (!func_ptr) return ncclSystemError;
+  return func_ptr(std::forward<Args>(args)...);
+}
+
+// Calls function 'symbol_name' in the RCCL library with 'args'. The RCCL
+// symbols have the 'nccl' prefix, which is why 'Func' only provides the
+// signature.
+template <typename Func, Func *, typename... Args>
+static ncclResult_t RcclCall(const char *symbol_name, Args &&...args) {
+  static auto func_ptr = reinterpret_cast<Func *>(LoadRcclSymbol(symbol_name));
+  if (!func_ptr) return ncclSystemError;
+  return func_ptr(std::forward<Args>(args)...);
+}
+
+extern "C" {
+
+ncclResult_t ncclGetVersion(int *version) {
+  return NcclCall<decltype(ncclGetVersion), ncclGetVersion>(
+      "ncclGetVersion", version);
+}
+
+ncclResult_t ncclGetUniqueId(ncclUniqueId *uniqueId) {
+  return NcclCall<decltype(ncclGetUniqueId), ncclGetUniqueId>(
+      "ncclGetUniqueId", uniqueId);
+}
+
+ncclResult_t ncclCommInitRank(ncclComm_t *comm, int nranks, ncclUniqueId commId,
+                              int rank) {
+  return NcclCall<decltype(ncclCommInitRank), ncclCommInitRank>(
+      "ncclCommInitRank", comm, nranks, commId, rank);
+}
+
+ncclResult_t ncclCommDestroy(ncclComm_t comm) {
+  return NcclCall<decltype(ncclCommDestroy), ncclCommDestroy>(
+      "ncclCommDestroy", comm);
+}
+
+ncclResult_t ncclCommCount(const ncclComm_t comm, int *count) {
+  return NcclCall<decltype(ncclCommCount), ncclCommCount>(
+      "ncclCommCount", comm, count);
+}
+
+ncclResult_t ncclCommUserRank(const ncclComm_t comm, int *rank) {
+  return NcclCall<decltype(ncclCommUserRank), ncclCommUserRank>(
+      "ncclCommUserRank", comm, rank);
+}
+
+ncclResult_t ncclGroupStart() {
+  return NcclCall<decltype(ncclGroupStart), ncclGroupStart>("ncclGroupStart");
+}
+
+ncclResult_t ncclGroupEnd() {
+  return NcclCall<decltype(ncclGroupEnd), ncclGroupEnd>("ncclGroupEnd");
+}
+
+ncclResult_t ncclAllReduce(const void *sendbuff, void *recvbuff, size_t count,
+                           ncclDataType_t datatype, ncclRedOp_t op,
+                           ncclComm_t comm, cudaStream_t stream) {
+  return NcclCall<decltype(ncclAllReduce), ncclAllReduce>(
+      "ncclAllReduce", sendbuff, recvbuff, count, datatype, op, comm, stream);
+}
+
+ncclResult_t ncclAllGather(const void *sendbuff, void *recvbuff,
+                           size_t sendcount, ncclDataType_t datatype,
+                           ncclComm_t comm, cudaStream_t stream) {
+  return NcclCall<decltype(ncclAllGather), ncclAllGather>(
+      "ncclAllGather", sendbuff, recvbuff, sendcount, datatype, comm, stream);
+}
+
+ncclResult_t ncclReduceScatter(const void *sendbuff, void *recvbuff,
+                               size_t recvcount, ncclDataType_t datatype,
+                               ncclRedOp_t op, ncclComm_t comm,
+                               cudaStream_t stream) {
+  return NcclCall<decltype(ncclReduceScatter), ncclReduceScatter>(
+      "ncclReduceScatter", sendbuff, recvbuff, recvcount, datatype, op, comm,
+      stream);
+}
+
+ncclResult_t ncclBroadcast(const void *sendbuff, void *recvbuff, size_t count,
+                           ncclDataType_t datatype, int root, ncclComm_t comm,
+                           cudaStream_t stream) {
+  return NcclCall<decltype(ncclBroadcast), ncclBroadcast>(
+      "ncclBroadcast", sendbuff, recvbuff, count, datatype, root, comm, stream);
+}
+
+ncclResult_t rcclGetVersion(int *version) {
+  return RcclCall<decltype(rcclGetVersion), rcclGetVersion>(
+      "ncclGetVersion", version);
+}
+
+ncclResult_t rcclGetUniqueId(ncclUniqueId *uniqueId) {
+  return RcclCall<decltype(rcclGetUniqueId), rcclGetUniqueId>(
+      "ncclGetUniqueId", uniqueId);
+}
+
+ncclResult_t rcclCommInitRank(rcclComm_t *comm, int nranks, ncclUniqueId commId,
+                              int rank) {
+  return RcclCall<decltype(rcclCommInitRank), rcclCommInitRank>(
+      "ncclCommInitRank", comm, nranks, commId, rank);
+}
+
+ncclResult_t rcclCommDestroy(rcclComm_t comm) {
+  return RcclCall<decltype(rcclCommDestroy), rcclCommDestroy>(
+      "ncclCommDestroy", comm);
+}
+
+ncclResult_t rcclCommCount(const rcclComm_t comm, int *count) {
+  return RcclCall<decltype(rcclCommCount), rcclCommCount>(
+      "ncclCommCount", comm, count);
+}
+
+ncclResult_t rcclCommUserRank(const rcclComm_t comm, int *rank) {
+  return RcclCall<decltype(rcclCommUserRank), rcclCommUserRank>(
+      "ncclCommUserRank", comm, rank);
+}
+
+ncclResult_t rcclGroupStart() {
+  return RcclCall<decltype(rcclGroupStart), rcclGroupStart>("ncclGroupStart");
+}
+
+ncclResult_t rcclGroupEnd() {
+  return RcclCall<decltype(rcclGroupEnd), rcclGroupEnd>("ncclGroupEnd");
+}
+
+ncclResult_t rcclAllReduce(const void *sendbuff, void *recvbuff, size_t count,
+                           ncclDataType_t datatype, ncclRedOp_t op,
+                           rcclComm_t comm, hipStream_t stream) {
+  return RcclCall<decltype(rcclAllReduce), rcclAllReduce>(
+      "ncclAllReduce", sendbuff, recvbuff, count, datatype, op, comm, stream);
+}
+
+ncclResult_t rcclAllGather(const void *sendbuff, void *recvbuff,
+                           size_t sendcount, ncclDataType_t datatype,
+                           rcclComm_t comm, hipStream_t stream) {
+  return RcclCall<decltype(rcclAllGather), rcclAllGather>(
+      "ncclAllGather", sendbuff, recvbuff, sendcount, datatype, comm, stream);
+}
+
+ncclResult_t rcclReduceScatter(const void *sendbuff, void *recvbuff,
+                               size_t recvcount, ncclDataType_t datatype,
+                               ncclRedOp_t op, rcclComm_t comm,
+                               hipStream_t stream) {
+  return RcclCall<decltype(rcclReduceScatter), rcclReduceScatter>(
+      "ncclReduceScatter", sendbuff, recvbuff, recvcount, datatype, op, comm,
+      stream);
+}
+
+ncclResult_t rcclBroadcast(const void *sendbuff, void *recvbuff, size_t count,
+                           ncclDataType_t datatype, int root, rcclComm_t comm,
+                           hipStream_t stream) {
+  return RcclCall<decltype(rcclBroadcast), rcclBroadcast>(
+      "ncclBroadcast", sendbuff, recvbuff, count, datatype, root, comm, stream);
+}
+
+}  // extern "C"
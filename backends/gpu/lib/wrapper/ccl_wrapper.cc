@@ -0,0 +1,328 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Thin abstraction layer for NCCL and RCCL.
+#include "tfrt/gpu/wrapper/ccl_wrapper.h"
+
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/raw_ostream.h"
+#include "wrapper_detail.h"
+
+namespace tfrt {
+namespace gpu {
+namespace wrapper {
+
+template llvm::raw_ostream& internal::operator<<(
+    llvm::raw_ostream&, const ErrorData<ncclResult_t>&);
+
+llvm::raw_ostream& operator<<(llvm::raw_ostream& os, ncclResult_t result) {
+  switch (result) {
+    case ncclSuccess:
+      return os << "ncclSuccess";
+    case ncclUnhandledCudaError:
+      return os << "ncclUnhandledCudaError";
+    case ncclSystemError:
+      return os << "ncclSystemError";
+    case ncclInternalError:
+      return os << "ncclInternalError";
+    case ncclInvalidArgument:
+      return os << "ncclInvalidArgument";
+    case ncclInvalidUsage:
+      return os << "ncclInvalidUsage";
+    default:
+      return os << llvm::formatv("ncclResult_t({0})", static_cast<int>(result));
+  }
+}
+
+template <>
+Expected<ncclDataType_t> Parse<ncclDataType_t>(llvm::StringRef name) {
+  if (name == "ncclInt8") return ncclInt8;
+  if (name == "ncclUint8") return ncclUint8;
+  if (name == "ncclInt32") return ncclInt32;
+  if (name == "ncclUint32") return ncclUint32;
+  if (name == "ncclInt64") return ncclInt64;
+  if (name == "ncclUint64") return ncclUint64;
+  if (name == "ncclFloat16") return ncclFloat16;
+  if (name == "ncclFloat32") return ncclFloat32;
+  if (name == "ncclFloat64") return ncclFloat64;
+  return MakeStringError("Unknown ncclDataType_t: ", name);
+}
+
+llvm::raw_ostream& operator<<(llvm::raw_ostream& os, ncclDataType_t value) {
+  switch (value) {
+    case ncclInt8:
+      return os << "ncclInt8";
+    case ncclUint8:
+      return os << "ncclUint8";
+    case ncclInt32:
+      return os << "ncclInt32";
+    case ncclUint32:
+      return os << "ncclUint32";
+    case ncclInt64:
+      return os << "ncclInt64";
+    case ncclUint64:
+      return os << "ncclUint64";
+    case ncclFloat16:
+      return os << "ncclFloat16";
+    case ncclFloat32:
+      return os << "ncclFloat32";
+    case ncclFloat64:
+      return os << "ncclFloat64";
+    default:
+      return os << llvm::formatv("ncclDataType_t({0})",
+                                 static_cast<int>(value));
+  }
+}
+
+template <>
+Expected<ncclRedOp_t> Parse<ncclRedOp_t>(llvm::StringRef name) {
+  if (name == "ncclSum") return ncclSum;
+  if (name == "ncclProd") return ncclProd;
+  if (name == "ncclMax") return ncclMax;
+  if (name == "ncclMin") return ncclMin;
+  return MakeStringError("Unknown ncclRedOp_t: ", name);
+}
+
+llvm::raw_ostream& operator<<(llvm::raw_ostream& os, ncclRedOp_t value) {
+  switch (value) {
+    case ncclSum:
+      return os << "ncclSum";
+    case ncclProd:
+      return os << "ncclProd";
+    case ncclMax:
+      return os << "ncclMax";
+    case ncclMin:
+      return os << "ncclMin";
+    default:
+      return os << llvm::formatv("ncclRedOp_t({0})", static_cast<int>(value));
+  }
+}
+
+void internal::CclCommDeleter::operator()(CclComm comm) const {
+  LogIfError(CclCommDestroy(comm));
+}
+
+llvm::Expected<int> CclGetVersion(Platform platform) {
+  int version = 0;
+  switch (platform) {
+    case Platform::CUDA:
+      RETURN_IF_ERROR(ncclGetVersion(&version));
+      return version;
+    case Platform::ROCm:
+      RETURN_IF_ERROR(rcclGetVersion(&version));
+      return version;
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Expected<ncclUniqueId> CclGetUniqueId(Platform platform) {
+  ncclUniqueId id;
+  switch (platform) {
+    case Platform::CUDA:
+      RETURN_IF_ERROR(ncclGetUniqueId(&id));
+      return id;
+    case Platform::ROCm:
+      RETURN_IF_ERROR(rcclGetUniqueId(&id));
+      return id;
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Expected<OwningCclComm> CclCommInitRank(CurrentContext current,
+                                              int nranks, ncclUniqueId commId,
+                                              int rank) {
+  auto platform = current.platform();
+  switch (platform) {
+    case Platform::CUDA: {
+      CheckCudaContext(current);
+      ncclComm_t comm = nullptr;
+      RETURN_IF_ERROR(ncclCommInitRank(&comm, nranks, commId, rank));
+      return OwningCclComm(comm);
+    }
+    case Platform::ROCm: {
+      CheckHipContext(current);
+      rcclComm_t comm = nullptr;
+      RETURN_IF_ERROR(rcclCommInitRank(&comm, nranks, commId, rank));
+      return OwningCclComm(comm);
+    }
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error CclCommDestroy(CclComm comm) {
+  auto platform = comm.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return TO_ERROR(ncclCommDestroy(comm));
+    case Platform::ROCm:
+      return TO_ERROR(rcclCommDestroy(comm));
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Expected<int> CclCommCount(CclComm comm) {
+  int count = 0;
+  auto platform = comm.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      RETURN_IF_ERROR(ncclCommCount(comm, &count));
+      return count;
+    case Platform::ROCm:
+      RETURN_IF_ERROR(rcclCommCount(comm, &count));
+      return count;
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Expected<int> CclCommUserRank(CclComm comm) {
+  int rank = 0;
+  auto platform = comm.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      RETURN_IF_ERROR(ncclCommUserRank(comm, &rank));
+      return rank;
+    case Platform::ROCm:
+      RETURN_IF_ERROR(rcclCommUserRank(comm, &rank));
+      return rank;
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error CclGroupStart(Platform platform) {
+  switch (platform) {
+    case Platform::CUDA:
+      return TO_ERROR(ncclGroupStart());
+    case Platform::ROCm:
+      return TO_ERROR(rcclGroupStart());
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error CclGroupEnd(Platform platform) {
+  switch (platform) {
+    case Platform::CUDA:
+      return TO_ERROR(ncclGroupEnd());
+    case Platform::ROCm:
+      return TO_ERROR(rcclGroupEnd());
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error CclAllReduce(CurrentContext current, Pointer<const void> sendbuff,
+                         Pointer<void> recvbuff, size_t count,
+                         ncclDataType_t datatype, ncclRedOp_t op, CclComm comm,
+                         Stream stream) {
+  auto platform = comm.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      CheckCudaContext(current);
+      return TO_ERROR(ncclAllReduce(ToCuda(sendbuff), ToCuda(recvbuff), count,
+                                    datatype, op, comm, stream));
+    case Platform::ROCm:
+      CheckHipContext(current);
+      return TO_ERROR(rcclAllReduce(ToRocm(sendbuff), ToRocm(recvbuff), count,
+                                    datatype, op, comm, stream));
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error CclAllGather(CurrentContext current, Pointer<const void> sendbuff,
+                         Pointer<void> recvbuff, size_t sendcount,
+                         ncclDataType_t datatype, CclComm comm, Stream stream) {
+  auto platform = comm.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      CheckCudaContext(current);
+      return TO_ERROR(ncclAllGather(ToCuda(sendbuff), ToCuda(recvbuff),
+                                    sendcount, datatype, comm, stream));
+    case Platform::ROCm:
+      CheckHipContext(current);
+      return TO_ERROR(rcclAllGather(ToRocm(sendbuff), ToRocm(recvbuff),
+                                    sendcount, datatype, comm, stream));
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error CclReduceScatter(CurrentContext current,
+                             Pointer<const void> sendbuff,
+                             Pointer<void> recvbuff, size_t recvcount,
+                             ncclDataType_t datatype, ncclRedOp_t op,
+                             CclComm comm, Stream stream) {
+  auto platform = comm.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      CheckCudaContext(current);
+      return TO_ERROR(ncclReduceScatter(ToCuda(sendbuff), ToCuda(recvbuff),
+                                        recvcount, datatype, op, comm, stream));
+    case Platform::ROCm:
+      CheckHipContext(current);
+      return TO_ERROR(rcclReduceScatter(ToRocm(sendbuff), ToRocm(recvbuff),
+                                        recvcount, datatype, op, comm, stream));
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error CclBroadcast(CurrentContext current, Pointer<const void> sendbuff,
+                         Pointer<void> recvbuff, size_t count,
+                         ncclDataType_t datatype, int root, CclComm comm,
+                         Stream stream) {
+  auto platform = comm.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      CheckCudaContext(current);
+      return TO_ERROR(ncclBroadcast(ToCuda(sendbuff), ToCuda(recvbuff), count,
+                                    datatype, root, comm, stream));
+    case Platform::ROCm:
+      CheckHipContext(current);
+      return TO_ERROR(rcclBroadcast(ToRocm(sendbuff), ToRocm(recvbuff), count,
+                                    datatype, root, comm, stream));
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+size_t GetCclDataTypeSizeBytes(ncclDataType_t datatype) {
+  switch (datatype) {
+    case ncclInt8:
+    case ncclUint8:
+      return 1;
+    case ncclFloat16:
+      return 2;
+    case ncclInt32:
+    case ncclUint32:
+    case ncclFloat32:
+      return 4;
+    case ncclInt64:
+    case ncclUint64:
+    case ncclFloat64:
+      return 8;
+    default:
+      llvm_unreachable(StrCat("Unexpected ncclDataType_t: ", datatype).c_str());
+  }
+}
+
+}  // namespace wrapper
+}  // namespace gpu
+}  // namespace tfrt
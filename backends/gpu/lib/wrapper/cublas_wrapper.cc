@@ -124,16 +124,16 @@ extern "C" CUBLASAPI cublasStatus_t CUBLASWINAPI cublasGemmBatchedEx_v10(
 llvm::Error CublasGemmBatchedEx(
     CurrentContext current, cublasHandle_t handle, cublasOperation_t transA,
     cublasOperation_t transB, int m, int n, int k, Pointer<const void> alpha,
-    llvm::ArrayRef<Pointer<const void>> Aarray, cudaDataType typeA, int heightA,
-    llvm::ArrayRef<Pointer<const void>> Barray, cudaDataType typeB, int heightB,
-    Pointer<const void> beta, llvm::ArrayRef<Pointer<void>> Carray,
-    cudaDataType typeC, int heightC, int batchCount, cudaDataType computeType,
+    Pointer<const void*> Aarray, cudaDataType typeA, int heightA,
+    Pointer<const void*> Barray, cudaDataType typeB, int heightB,
+    Pointer<const void> beta, Pointer<void*> Carray, cudaDataType typeC,
+    int heightC, int batchCount, cudaDataType computeType,
     cublasGemmAlgo_t algo) {
   CheckCudaContext(current);
   return TO_ERROR(cublasGemmBatchedEx_v10(
-      handle, transA, transB, m, n, k, ToCuda(alpha), ToCuda(Aarray).data(),
-      typeA, heightA, ToCuda(Barray).data(), typeB, heightB, ToCuda(beta),
-      ToCuda(Carray).data(), typeC, heightC, batchCount, computeType, algo));
+      handle, transA, transB, m, n, k, ToCuda(alpha), ToCuda(Aarray), typeA,
+      heightA, ToCuda(Barray), typeB, heightB, ToCuda(beta), ToCuda(Carray),
+      typeC, heightC, batchCount, computeType, algo));
 }
 
 extern "C" CUBLASAPI cublasStatus_t CUBLASWINAPI cublasGemmStridedBatchedEx_v10(
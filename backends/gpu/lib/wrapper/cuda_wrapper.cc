@@ -398,6 +398,56 @@ llvm::Expected<float> CuEventElapsedTime(CUevent start, CUevent end) {
   return time_ms;
 }
 
+llvm::Error CuStreamBeginCapture(CUstream stream, CUstreamCaptureMode mode) {
+  return TO_ERROR(cuStreamBeginCapture(stream, mode));
+}
+
+llvm::Expected<OwningGraph> CuStreamEndCapture(CUstream stream) {
+  CUgraph graph;
+  RETURN_IF_ERROR(cuStreamEndCapture(stream, &graph));
+  return OwningGraph(graph);
+}
+
+llvm::Expected<bool> CuStreamIsCapturing(CUstream stream) {
+  CUstreamCaptureStatus status;
+  RETURN_IF_ERROR(cuStreamIsCapturing(stream, &status));
+  return status == CU_STREAM_CAPTURE_STATUS_ACTIVE;
+}
+
+llvm::Error CuGraphDestroy(CUgraph graph) {
+  if (graph == nullptr) return llvm::Error::success();
+  return TO_ERROR(cuGraphDestroy(graph));
+}
+
+llvm::Expected<OwningGraphExec> CuGraphInstantiate(CurrentContext current,
+                                                   CUgraph graph) {
+  CheckCudaContext(current);
+  CUgraphExec graph_exec;
+  RETURN_IF_ERROR(cuGraphInstantiate(&graph_exec, graph,
+                                     /*phErrorNode=*/nullptr,
+                                     /*logBuffer=*/nullptr, /*bufferSize=*/0));
+  return OwningGraphExec(graph_exec);
+}
+
+llvm::Error CuGraphExecDestroy(CUgraphExec graph_exec) {
+  if (graph_exec == nullptr) return llvm::Error::success();
+  return TO_ERROR(cuGraphExecDestroy(graph_exec));
+}
+
+llvm::Expected<bool> CuGraphExecUpdate(CUgraphExec graph_exec, CUgraph graph) {
+  CUgraphNode error_node;
+  CUgraphExecUpdateResult update_result;
+  auto result =
+      cuGraphExecUpdate(graph_exec, graph, &error_node, &update_result);
+  if (result == CUDA_ERROR_GRAPH_EXEC_UPDATE_FAILURE) return false;
+  RETURN_IF_ERROR(result);
+  return update_result == CU_GRAPH_EXEC_UPDATE_SUCCESS;
+}
+
+llvm::Error CuGraphLaunch(CUgraphExec graph_exec, CUstream stream) {
+  return TO_ERROR(cuGraphLaunch(graph_exec, stream));
+}
+
 llvm::Expected<DeviceMemory<void>> CuMemAlloc(CurrentContext current,
                                               size_t size_bytes) {
   CheckCudaContext(current);
@@ -421,6 +471,47 @@ llvm::Error CuMemFree(Pointer<void> pointer) {
   return llvm::Error::success();
 }
 
+llvm::Expected<CUmemoryPool> CuDeviceGetDefaultMemPool(Device device) {
+  CUmemoryPool pool;
+  RETURN_IF_ERROR(cuDeviceGetDefaultMemPool(&pool, ToCuda(device)));
+  return pool;
+}
+
+llvm::Error CuMemPoolSetReleaseThreshold(CUmemoryPool pool,
+                                         uint64_t threshold) {
+  return TO_ERROR(cuMemPoolSetAttribute(
+      pool, CU_MEMPOOL_ATTR_RELEASE_THRESHOLD, &threshold));
+}
+
+llvm::Error CuMemPoolTrimTo(CUmemoryPool pool, size_t min_bytes_to_keep) {
+  return TO_ERROR(cuMemPoolTrimTo(pool, min_bytes_to_keep));
+}
+
+llvm::Expected<Pointer<void>> CuMemAllocFromPoolAsync(CurrentContext current,
+                                                      size_t size_bytes,
+                                                      CUmemoryPool pool,
+                                                      CUstream stream) {
+  CheckCudaContext(current);
+  void* ptr;
+  if (auto error = TO_ERROR(cuMemAllocFromPoolAsync(
+          reinterpret_cast<CUdeviceptr*>(&ptr), size_bytes, pool, stream))) {
+    return llvm::handleErrors(
+        std::move(error), [&](std::unique_ptr<ErrorInfo<CUresult>> info) {
+          return GetResult(*info) == CUDA_ERROR_OUT_OF_MEMORY
+                     ? MakeOomError(current, size_bytes)
+                     : llvm::Error(std::move(info));
+        });
+  }
+  NotifyResourceCreated(ResourceType::kDeviceMemory, ptr);
+  return Pointer<void>(ptr, Platform::CUDA);
+}
+
+llvm::Error CuMemFreeAsync(Pointer<void> pointer, CUstream stream) {
+  RETURN_IF_ERROR(cuMemFreeAsync(ToDevicePtr(pointer), stream));
+  NotifyResourceDestroyed(ToCuda(pointer));
+  return llvm::Error::success();
+}
+
 llvm::Expected<HostMemory<void>> CuMemHostAlloc(CurrentContext current,
                                                 size_t size_bytes,
                                                 CUmemhostalloc_flags flags) {
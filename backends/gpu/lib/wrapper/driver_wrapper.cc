@@ -69,6 +69,13 @@ static constexpr auto ToCuda(MemAttachFlags flag) {
   ASSERT_EQ(CU_MEM_ATTACH_HOST, MemAttachFlags::HOST);
   return static_cast<CUmemAttach_flags>(flag);
 }
+static constexpr auto ToCuda(StreamCaptureMode mode) {
+  ASSERT_EQ(CU_STREAM_CAPTURE_MODE_GLOBAL, StreamCaptureMode::GLOBAL);
+  ASSERT_EQ(CU_STREAM_CAPTURE_MODE_THREAD_LOCAL,
+            StreamCaptureMode::THREAD_LOCAL);
+  ASSERT_EQ(CU_STREAM_CAPTURE_MODE_RELAXED, StreamCaptureMode::RELAXED);
+  return static_cast<CUstreamCaptureMode>(mode);
+}
 
 // Cast driver wrapper flags to HIP enums.
 static constexpr auto ToHip(CtxFlags flag) {
@@ -204,6 +211,12 @@ void internal::StreamDeleter::operator()(Stream stream) const {
 void internal::EventDeleter::operator()(Event event) const {
   LogIfError(EventDestroy(event));
 }
+void internal::GraphDeleter::operator()(Graph graph) const {
+  LogIfError(GraphDestroy(graph));
+}
+void internal::GraphExecDeleter::operator()(GraphExec graph_exec) const {
+  LogIfError(GraphExecDestroy(graph_exec));
+}
 void internal::DeviceMemoryDeallocator::operator()(
     Pointer<void> pointer) const {
   LogIfError(MemFree(pointer));
@@ -640,6 +653,103 @@ llvm::Expected<float> EventElapsedTime(Event start, Event end) {
   }
 }
 
+llvm::Error StreamBeginCapture(Stream stream, StreamCaptureMode mode) {
+  auto platform = stream.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuStreamBeginCapture(stream, ToCuda(mode));
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Expected<OwningGraph> StreamEndCapture(Stream stream) {
+  auto platform = stream.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuStreamEndCapture(stream);
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Expected<bool> StreamIsCapturing(Stream stream) {
+  auto platform = stream.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuStreamIsCapturing(stream);
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error GraphDestroy(Graph graph) {
+  auto platform = graph.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuGraphDestroy(graph);
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Expected<OwningGraphExec> GraphInstantiate(CurrentContext current,
+                                                 Graph graph) {
+  auto platform = current.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuGraphInstantiate(current, graph);
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error GraphExecDestroy(GraphExec graph_exec) {
+  auto platform = graph_exec.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuGraphExecDestroy(graph_exec);
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Expected<bool> GraphExecUpdate(GraphExec graph_exec, Graph graph) {
+  auto platform = graph_exec.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuGraphExecUpdate(graph_exec, graph);
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error GraphLaunch(GraphExec graph_exec, Stream stream) {
+  auto platform = graph_exec.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuGraphLaunch(graph_exec, stream);
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
 llvm::Expected<DeviceMemory<void>> MemAlloc(CurrentContext current,
                                             size_t size_bytes) {
   auto platform = current.platform();
@@ -768,6 +878,69 @@ llvm::Expected<MemoryInfo> MemGetInfo(CurrentContext current) {
   }
 }
 
+llvm::Expected<MemoryPool> DeviceGetDefaultMemPool(Device device) {
+  auto platform = device.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuDeviceGetDefaultMemPool(device);
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error MemPoolSetReleaseThreshold(MemoryPool pool, uint64_t threshold) {
+  auto platform = pool.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuMemPoolSetReleaseThreshold(pool, threshold);
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error MemPoolTrimTo(MemoryPool pool, size_t min_bytes_to_keep) {
+  auto platform = pool.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuMemPoolTrimTo(pool, min_bytes_to_keep);
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Expected<Pointer<void>> MemAllocFromPoolAsync(CurrentContext current,
+                                                    size_t size_bytes,
+                                                    MemoryPool pool,
+                                                    Stream stream) {
+  auto platform = current.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuMemAllocFromPoolAsync(current, size_bytes, pool, stream);
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
+llvm::Error MemFreeAsync(Pointer<void> pointer, Stream stream) {
+  auto platform = pointer.platform();
+  switch (platform) {
+    case Platform::CUDA:
+      return CuMemFreeAsync(pointer, stream);
+    case Platform::ROCm:
+      return UnsupportedPlatform(platform);
+    default:
+      return InvalidPlatform(platform);
+  }
+}
+
 llvm::Error Memcpy(CurrentContext current, Pointer<void> dst,
                    Pointer<const void> src, size_t count_bytes) {
   auto platform = current.platform();
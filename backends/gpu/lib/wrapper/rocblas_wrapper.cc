@@ -102,6 +102,22 @@ llvm::Error RocblasGemmStridedBatchedEx(
       computeType, algo, /*solution_index=*/0, /*flags=*/0));
 }
 
+llvm::Error RocblasGemmBatchedEx(
+    CurrentContext current, rocblas_handle handle, rocblas_operation transA,
+    rocblas_operation transB, int m, int n, int k, Pointer<const void> alpha,
+    Pointer<const void*> Aarray, rocblas_datatype typeA, int heightA,
+    Pointer<const void*> Barray, rocblas_datatype typeB, int heightB,
+    Pointer<const void> beta, Pointer<void*> Carray, rocblas_datatype typeC,
+    int heightC, Pointer<void*> Darray, rocblas_datatype typeD, int heightD,
+    int batchCount, rocblas_datatype computeType, rocblas_gemm_algo algo) {
+  CheckHipContext(current);
+  return TO_ERROR(rocblas_gemm_batched_ex(
+      handle, transA, transB, m, n, k, ToRocm(alpha), ToRocm(Aarray), typeA,
+      heightA, ToRocm(Barray), typeB, heightB, ToRocm(beta), ToRocm(Carray),
+      typeC, heightC, ToRocm(Darray), typeD, heightD, batchCount, computeType,
+      algo, /*solution_index=*/0, /*flags=*/0));
+}
+
 llvm::Error RocblasSnrm2(CurrentContext current, rocblas_handle handle, int n,
                          Pointer<const float> x, int incx,
                          Pointer<float> result) {
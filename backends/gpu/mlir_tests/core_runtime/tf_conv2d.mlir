@@ -147,3 +147,51 @@ func @conv2d_same_strides() -> !tfrt.chain {
   %ch_print_cpu = corert.executeop.seq(%gpu, %ch_epoch) "tfrt_test.print"(%cpu_handle_result) : 0
   tfrt.return %ch_print_cpu : !tfrt.chain
 }
+
+// CHECK: --- Running 'fused_conv2d_bias_f32'
+func @fused_conv2d_bias_f32() -> !tfrt.chain {
+  %ch_epoch = tfrt.new.chain
+  %gpu = corert.get_op_handler %ch_epoch "gpu"
+
+  %gpu_handle_input = corert.executeop(%gpu)
+    "tfrt_test.create_dense_tensor"() { shape = [1, 1, 2, 2], values = [-2.0 : f32, -1.0 : f32, 1.0 : f32,  2.0 : f32] } : 1
+
+  %gpu_handle_filter = corert.executeop(%gpu)
+    "tfrt_test.create_dense_tensor"() { shape = [3, 3, 1, 1], values = [3.0 : f32, 0.0 : f32, 5.0 : f32,0.0 : f32, 0.0 : f32, 0.0 : f32,7.0 : f32, 0.0 : f32, 9.0 : f32] } : 1
+
+  %gpu_handle_bias = corert.executeop(%gpu)
+    "tfrt_test.create_dense_tensor"() { shape = [1], values = [1.0 : f32] } : 1
+
+  %gpu_handle_result = corert.executeop(%gpu)
+    "tf._FusedConv2D"(%gpu_handle_input, %gpu_handle_filter, %gpu_handle_bias)
+      { data_format = "NCHW", padding = "SAME", fused_ops = ["BiasAdd"] } : 1
+
+  %cpu_handle_result = corert.executeop(%gpu) "tfrt_test.gpu_tensor_to_host_tensor"(%gpu_handle_result) : 1
+  // CHECK: DenseHostTensor dtype = F32, shape = [1, 1, 2, 2], values = [19, 8, -4, -5]
+  %ch_print_cpu = corert.executeop.seq(%gpu, %ch_epoch) "tfrt_test.print"(%cpu_handle_result) : 0
+  tfrt.return %ch_print_cpu : !tfrt.chain
+}
+
+// CHECK: --- Running 'fused_conv2d_bias_relu_f32'
+func @fused_conv2d_bias_relu_f32() -> !tfrt.chain {
+  %ch_epoch = tfrt.new.chain
+  %gpu = corert.get_op_handler %ch_epoch "gpu"
+
+  %gpu_handle_input = corert.executeop(%gpu)
+    "tfrt_test.create_dense_tensor"() { shape = [1, 1, 2, 2], values = [-2.0 : f32, -1.0 : f32, 1.0 : f32,  2.0 : f32] } : 1
+
+  %gpu_handle_filter = corert.executeop(%gpu)
+    "tfrt_test.create_dense_tensor"() { shape = [3, 3, 1, 1], values = [3.0 : f32, 0.0 : f32, 5.0 : f32,0.0 : f32, 0.0 : f32, 0.0 : f32,7.0 : f32, 0.0 : f32, 9.0 : f32] } : 1
+
+  %gpu_handle_bias = corert.executeop(%gpu)
+    "tfrt_test.create_dense_tensor"() { shape = [1], values = [1.0 : f32] } : 1
+
+  %gpu_handle_result = corert.executeop(%gpu)
+    "tf._FusedConv2D"(%gpu_handle_input, %gpu_handle_filter, %gpu_handle_bias)
+      { data_format = "NCHW", padding = "SAME", fused_ops = ["BiasAdd", "Relu"] } : 1
+
+  %cpu_handle_result = corert.executeop(%gpu) "tfrt_test.gpu_tensor_to_host_tensor"(%gpu_handle_result) : 1
+  // CHECK: DenseHostTensor dtype = F32, shape = [1, 1, 2, 2], values = [19, 8, 0, 0]
+  %ch_print_cpu = corert.executeop.seq(%gpu, %ch_epoch) "tfrt_test.print"(%cpu_handle_result) : 0
+  tfrt.return %ch_print_cpu : !tfrt.chain
+}
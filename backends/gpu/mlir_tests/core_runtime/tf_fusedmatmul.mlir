@@ -0,0 +1,74 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor --test_init_function=register_op_handlers_gpu $(bef_name %s) | FileCheck %s --dump-input=fail
+
+func @register_op_handlers_gpu() {
+  %null = "corert.create_null_op_handler"() : () -> !corert.ophandler
+
+  %gpu_ordinal = tfrt.constant.i32 0
+  %gpu = "corert.create_gpu_op_handler" (%gpu_ordinal, %null) : (i32, !corert.ophandler) -> !corert.ophandler
+  corert.register_op_handler %gpu "gpu"
+  tfrt.return
+}
+
+// CHECK: --- Running 'fusedMatMul_bias_f32'
+func @fusedMatMul_bias_f32() -> !tfrt.chain {
+  %ch_epoch = tfrt.new.chain
+  %gpu = corert.get_op_handler %ch_epoch "gpu"
+
+  %a = corert.executeop(%gpu) "tfrt_test.create_dense_tensor"()
+    { shape = [2, 3], values = [-1.0 : f32, -0.5 : f32, 0.0 : f32, 0.5 : f32, 1.0 : f32, 1.5 : f32] } : 1
+  %b = corert.executeop(%gpu) "tfrt_test.create_dense_tensor"()
+    { shape = [3, 2], values = [0.0 : f32, 1.0 : f32, 2.0 : f32, 3.0 : f32, 4.0 : f32, 5.0 : f32] } : 1
+  %bias = corert.executeop(%gpu) "tfrt_test.create_dense_tensor"()
+    { shape = [2], values = [1.0 : f32, 2.0 : f32] } : 1
+
+  %gpu_handle_result = corert.executeop(%gpu)
+      "tf._FusedMatMul"(%a, %b, %bias)
+      { fused_ops = ["BiasAdd"], transpose_a = false, transpose_b = false } : 1
+
+  %cpu_handle_result = corert.executeop(%gpu)
+    "tfrt_test.gpu_tensor_to_host_tensor"(%gpu_handle_result) : 1
+
+  // CHECK: DenseHostTensor dtype = F32, shape = [2, 2], values = [0, -0.5, 9, 13]
+  %ch_print_cpu = corert.executeop.seq(%gpu, %ch_epoch)
+    "tfrt_test.print"(%cpu_handle_result) : 0
+  tfrt.return %ch_print_cpu : !tfrt.chain
+}
+
+// CHECK: --- Running 'fusedMatMul_bias_relu_f32'
+func @fusedMatMul_bias_relu_f32() -> !tfrt.chain {
+  %ch_epoch = tfrt.new.chain
+  %gpu = corert.get_op_handler %ch_epoch "gpu"
+
+  %a = corert.executeop(%gpu) "tfrt_test.create_dense_tensor"()
+    { shape = [2, 3], values = [-1.0 : f32, -0.5 : f32, 0.0 : f32, 0.5 : f32, 1.0 : f32, 1.5 : f32] } : 1
+  %b = corert.executeop(%gpu) "tfrt_test.create_dense_tensor"()
+    { shape = [3, 2], values = [0.0 : f32, 1.0 : f32, 2.0 : f32, 3.0 : f32, 4.0 : f32, 5.0 : f32] } : 1
+  %bias = corert.executeop(%gpu) "tfrt_test.create_dense_tensor"()
+    { shape = [2], values = [1.0 : f32, 2.0 : f32] } : 1
+
+  %gpu_handle_result = corert.executeop(%gpu)
+      "tf._FusedMatMul"(%a, %b, %bias)
+      { fused_ops = ["BiasAdd", "Relu"], transpose_a = false, transpose_b = false } : 1
+
+  %cpu_handle_result = corert.executeop(%gpu)
+    "tfrt_test.gpu_tensor_to_host_tensor"(%gpu_handle_result) : 1
+
+  // CHECK: DenseHostTensor dtype = F32, shape = [2, 2], values = [0, 0, 9, 13]
+  %ch_print_cpu = corert.executeop.seq(%gpu, %ch_epoch)
+    "tfrt_test.print"(%cpu_handle_result) : 0
+  tfrt.return %ch_print_cpu : !tfrt.chain
+}
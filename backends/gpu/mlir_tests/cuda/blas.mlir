@@ -149,3 +149,57 @@ func @blas_gemm_batched() {
 }
 
 
+
+// CHECK-LABEL: --- Running 'blas_gemm_grouped'
+func @blas_gemm_grouped() {
+  %ch1 = tfrt.new.chain
+  %index = tfrt.constant.i32 0
+  %device = tfrt_gpu.device.get CUDA, %index
+  %context = tfrt_gpu.context.create %device
+  %allocator = tfrt_gpu.allocator.create %context
+  %stream = tfrt_gpu.stream.create %context
+  %blas = tfrt_gpu.blas.create %stream
+
+  %buffer_size_bytes = tfrt.constant.i64 16 // [2, 2] * 4 bytes floats = 16 bytes
+
+  %host_tensor = tfrt_dht.create_uninitialized_tensor.f32.2 [2 : i64, 2 : i64]
+  %host_buffer, %ch2 = tfrt_dht.get_buffer %host_tensor, %ch1
+
+  %ch3 = tfrt_dht.set_tensor_with_constant_values.f32 %host_tensor, %ch2 [1.0 : f32, 2.0 : f32, 3.0 : f32, 4.0 : f32]
+  %gpu_buffer_0 = tfrt_gpu.mem.allocate %allocator, %stream, %buffer_size_bytes, %ch3
+  %ch4 = tfrt_gpu.mem.copy_host_to_device %gpu_buffer_0, %host_buffer, %buffer_size_bytes, %stream, %ch3
+
+  %ch5 = tfrt_dht.set_tensor_with_constant_values.f32 %host_tensor, %ch4 [2.0 : f32, 3.0 : f32, 4.0 : f32, 5.0 : f32]
+  %gpu_buffer_1 = tfrt_gpu.mem.allocate %allocator, %stream, %buffer_size_bytes, %ch5
+  %ch6 = tfrt_gpu.mem.copy_host_to_device %gpu_buffer_1, %host_buffer, %buffer_size_bytes, %stream, %ch5
+
+  %ch7 = tfrt_dht.set_tensor_with_constant_values.f32 %host_tensor, %ch6 [0.0 : f32, 0.0 : f32, 0.0 : f32, 0.0 : f32]
+  %gpu_buffer_2 = tfrt_gpu.mem.allocate %allocator, %stream, %buffer_size_bytes, %ch7
+  %ch8 = tfrt_gpu.mem.copy_host_to_device %gpu_buffer_2, %host_buffer, %buffer_size_bytes, %stream, %ch7
+  %gpu_buffer_3 = tfrt_gpu.mem.allocate %allocator, %stream, %buffer_size_bytes, %ch8
+  %ch9 = tfrt_gpu.mem.copy_host_to_device %gpu_buffer_3, %host_buffer, %buffer_size_bytes, %stream, %ch8
+
+  %dim = tfrt.constant.i32 2
+  %alpha = tfrt.constant.f32 1.0
+  %beta = tfrt.constant.f32 1.0
+  %algo = tfrt_gpu.blas.gemm.algo CUBLAS_GEMM_DEFAULT
+  // Computes buffer_2 = buffer_0 * buffer_1 and buffer_3 = buffer_1 * buffer_0.
+  %ch10 = tfrt_gpu.blas.gemm.grouped %blas,
+    CUBLAS_OP_N, CUBLAS_OP_N, %dim, %dim, %dim,
+    %alpha, CUDA_R_32F, %dim, CUDA_R_32F, %dim, %beta, CUDA_R_32F, %dim,
+    CUDA_R_32F, %algo, %ch9,
+    buffers(%gpu_buffer_0, %gpu_buffer_1, %gpu_buffer_1, %gpu_buffer_0,
+            %gpu_buffer_2, %gpu_buffer_3)
+
+  %ch11 = tfrt_gpu.mem.copy_device_to_host %host_buffer, %gpu_buffer_2, %buffer_size_bytes, %stream, %ch10
+  // CHECK: DenseHostTensor dtype = F32, shape = [2, 2]
+  // CHECK-SAME: values = [1.100000e+01, 1.600000e+01, 1.900000e+01, 2.800000e+01]
+  %ch12 = tfrt_dht.print_tensor %host_tensor, %ch11
+
+  %ch13 = tfrt_gpu.mem.copy_device_to_host %host_buffer, %gpu_buffer_3, %buffer_size_bytes, %stream, %ch12
+  // CHECK: DenseHostTensor dtype = F32, shape = [2, 2]
+  // CHECK-SAME: values = [1.000000e+01, 1.300000e+01, 2.200000e+01, 2.900000e+01]
+  %ch14 = tfrt_dht.print_tensor %host_tensor, %ch13
+
+  tfrt.return
+}
@@ -0,0 +1,89 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor $(bef_name %s) | FileCheck %s --dump-input=fail
+
+// CHECK-LABEL: --- Running 'ccl_all_reduce'
+func @ccl_all_reduce() {
+  %ch1 = tfrt.new.chain
+  %index = tfrt.constant.i32 0
+  %device = tfrt_gpu.device.get CUDA, %index
+  %context = tfrt_gpu.context.create %device
+  %allocator = tfrt_gpu.allocator.create %context
+  %stream = tfrt_gpu.stream.create %context
+
+  // A clique with a single rank.
+  %rank = tfrt.constant.i32 0
+  %count = tfrt.constant.i32 1
+  %id = tfrt_gpu.ccl.unique_id CUDA
+  %ccl = tfrt_gpu.ccl.create %context, %rank, %count, %id
+
+  %buffer_size_bytes = tfrt.constant.i64 16 // [2, 2] * 4 bytes floats = 16 bytes
+
+  %host_tensor = tfrt_dht.create_uninitialized_tensor.f32.2 [2 : i64, 2 : i64]
+  %host_buffer, %ch2 = tfrt_dht.get_buffer %host_tensor, %ch1
+
+  %ch3 = tfrt_dht.set_tensor_with_constant_values.f32 %host_tensor, %ch2 [1.0 : f32, 2.0 : f32, 3.0 : f32, 4.0 : f32]
+  %input = tfrt_gpu.mem.allocate %allocator, %stream, %buffer_size_bytes, %ch3
+  %ch4 = tfrt_gpu.mem.copy_host_to_device %input, %host_buffer, %buffer_size_bytes, %stream, %ch3
+  %output = tfrt_gpu.mem.allocate %allocator, %stream, %buffer_size_bytes, %ch4
+
+  %ch5 = tfrt_gpu.ccl.all_reduce %ccl, %input, %output, ncclFloat32, ncclSum, %stream, %ch4
+
+  %ch6 = tfrt_dht.set_tensor_with_constant_values.f32 %host_tensor, %ch5 [0.0 : f32, 0.0 : f32, 0.0 : f32, 0.0 : f32]
+  %ch7 = tfrt_gpu.mem.copy_device_to_host %host_buffer, %output, %buffer_size_bytes, %stream, %ch6
+  %ch8 = tfrt_gpu.stream.synchronize %stream, %ch7
+  // CHECK: DenseHostTensor dtype = F32, shape = [2, 2]
+  // CHECK-SAME: values = [1.000000e+00, 2.000000e+00, 3.000000e+00, 4.000000e+00]
+  %ch9 = tfrt_dht.print_tensor %host_tensor, %ch8
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'ccl_broadcast'
+func @ccl_broadcast() {
+  %ch1 = tfrt.new.chain
+  %index = tfrt.constant.i32 0
+  %device = tfrt_gpu.device.get CUDA, %index
+  %context = tfrt_gpu.context.create %device
+  %allocator = tfrt_gpu.allocator.create %context
+  %stream = tfrt_gpu.stream.create %context
+
+  %rank = tfrt.constant.i32 0
+  %count = tfrt.constant.i32 1
+  %id = tfrt_gpu.ccl.unique_id CUDA
+  %ccl = tfrt_gpu.ccl.create %context, %rank, %count, %id
+
+  %buffer_size_bytes = tfrt.constant.i64 8 // 2 * 4 bytes ints = 8 bytes
+
+  %host_tensor = tfrt_dht.create_uninitialized_tensor.i32.1 [2 : i64]
+  %host_buffer, %ch2 = tfrt_dht.get_buffer %host_tensor, %ch1
+
+  %ch3 = tfrt_dht.set_tensor_with_constant_values.i32 %host_tensor, %ch2 [5 : i32, 7 : i32]
+  %input = tfrt_gpu.mem.allocate %allocator, %stream, %buffer_size_bytes, %ch3
+  %ch4 = tfrt_gpu.mem.copy_host_to_device %input, %host_buffer, %buffer_size_bytes, %stream, %ch3
+  %output = tfrt_gpu.mem.allocate %allocator, %stream, %buffer_size_bytes, %ch4
+
+  %root = tfrt.constant.i32 0
+  %ch5 = tfrt_gpu.ccl.broadcast %ccl, %input, %output, %root, ncclInt32, %stream, %ch4
+
+  %ch6 = tfrt_dht.set_tensor_with_constant_values.i32 %host_tensor, %ch5 [0 : i32, 0 : i32]
+  %ch7 = tfrt_gpu.mem.copy_device_to_host %host_buffer, %output, %buffer_size_bytes, %stream, %ch6
+  %ch8 = tfrt_gpu.stream.synchronize %stream, %ch7
+  // CHECK: DenseHostTensor dtype = I32, shape = [2]
+  // CHECK-SAME: values = [5, 7]
+  %ch9 = tfrt_dht.print_tensor %host_tensor, %ch8
+
+  tfrt.return
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit tests for the sampling profiler of BEF execution.
+
+#include "tfrt/bef_executor/bef_sampling_profiler.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace tfrt {
+namespace {
+
+// Returns the number of samples of `kernel` in `function`.
+int64_t GetNumSamples(const BEFSamplingProfiler& profiler,
+                      string_view function, string_view kernel) {
+  for (const auto& profile : profiler.GetProfiles()) {
+    if (profile.function_name == function && profile.kernel_name == kernel)
+      return profile.num_samples;
+  }
+  return 0;
+}
+
+TEST(BEFSamplingProfilerTest, InternsSites) {
+  const BEFSampleSite* site = BEFSampleSite::Get("kernel");
+  EXPECT_EQ(site->name(), "kernel");
+  EXPECT_EQ(BEFSampleSite::Get(std::string("kernel")), site);
+  EXPECT_NE(BEFSampleSite::Get("other_kernel"), site);
+}
+
+TEST(BEFSamplingProfilerTest, SamplesInnermostScope) {
+  BEFSamplingProfiler profiler(std::chrono::microseconds(100));
+  const BEFSampleSite* function = BEFSampleSite::Get("function");
+  {
+    BEFSampleScope scope(function, BEFSampleSite::Get("outer"));
+    {
+      BEFSampleScope nested_scope(function, BEFSampleSite::Get("inner"));
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    EXPECT_GT(GetNumSamples(profiler, "function", "inner"), 0);
+    EXPECT_EQ(GetNumSamples(profiler, "function", "outer"), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  EXPECT_GT(GetNumSamples(profiler, "function", "outer"), 0);
+
+  // Threads that don't execute kernels are not sampled.
+  int64_t num_samples = GetNumSamples(profiler, "function", "outer");
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  EXPECT_EQ(GetNumSamples(profiler, "function", "outer"), num_samples);
+  EXPECT_EQ(profiler.GetProfiles().size(), 2);
+}
+
+TEST(BEFSamplingProfilerTest, SamplesOtherThreads) {
+  BEFSamplingProfiler profiler(std::chrono::microseconds(100));
+  // The slot of the first thread is reused by the second one.
+  for (const char* kernel : {"first_thread", "second_thread"}) {
+    std::thread thread([kernel] {
+      BEFSampleScope scope(nullptr, BEFSampleSite::Get(kernel));
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    });
+    thread.join();
+  }
+  EXPECT_GT(GetNumSamples(profiler, "", "first_thread"), 0);
+  EXPECT_GT(GetNumSamples(profiler, "", "second_thread"), 0);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,289 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of the host_context primitives on the hot path of execution.
+//
+// Multi-threaded benchmarks take the number of worker threads as their first
+// argument and report wall time. Run with
+//
+//   --benchmark_format=json --benchmark_out=<file>
+//
+// to write machine-readable results, e.g. to compare them with
+// tools like compare.py of Google Benchmark.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/host_context/resource_context.h"
+#include "tfrt/host_context/task_function.h"
+#include "tfrt/host_context/timer_queue.h"
+#include "tfrt/support/latch.h"
+#include "tfrt/support/logging.h"
+
+namespace tfrt {
+namespace {
+
+std::unique_ptr<HostContext> CreateSingleThreadedHostContext() {
+  return std::make_unique<HostContext>([](const DecodedDiagnostic&) {},
+                                       CreateMallocAllocator(),
+                                       CreateSingleThreadedWorkQueue());
+}
+
+std::unique_ptr<HostContext> CreateMultiThreadedHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, /*num_blocking_threads=*/1));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> request_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  if (!request_ctx) TFRT_LOG(FATAL) << request_ctx.takeError();
+  return ExecutionContext{std::move(*request_ctx)};
+}
+
+// Worker thread counts of the multi-threaded benchmarks.
+void ThreadCounts(benchmark::internal::Benchmark* benchmark) {
+  for (int num_threads : {1, 2, 4, 8}) benchmark->Arg(num_threads);
+}
+
+//===----------------------------------------------------------------------===//
+// AsyncValue
+//===----------------------------------------------------------------------===//
+
+void BM_MakeAvailableAsyncValue(benchmark::State& state) {
+  for (auto _ : state) {
+    auto value = MakeAvailableAsyncValueRef<int32_t>(42);
+    benchmark::DoNotOptimize(value.get());
+  }
+}
+BENCHMARK(BM_MakeAvailableAsyncValue);
+
+void BM_EmplaceAsyncValue(benchmark::State& state) {
+  for (auto _ : state) {
+    auto value = MakeUnconstructedAsyncValueRef<int32_t>();
+    value.emplace(42);
+    benchmark::DoNotOptimize(value.get());
+  }
+}
+BENCHMARK(BM_EmplaceAsyncValue);
+
+void BM_AsyncValueAndThen(benchmark::State& state) {
+  for (auto _ : state) {
+    auto value = MakeUnconstructedAsyncValueRef<int32_t>();
+    int32_t result = 0;
+    for (int i = 0; i < state.range(0); ++i)
+      value.AndThen([&] { result += value.get(); });
+    value.emplace(42);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AsyncValueAndThen)->Arg(1)->Arg(8);
+
+void BM_AvailableAsyncValueAndThen(benchmark::State& state) {
+  auto value = MakeAvailableAsyncValueRef<int32_t>(42);
+  int32_t result = 0;
+  for (auto _ : state) {
+    value.AndThen([&] { result += value.get(); });
+  }
+  benchmark::DoNotOptimize(result);
+}
+BENCHMARK(BM_AvailableAsyncValueAndThen);
+
+//===----------------------------------------------------------------------===//
+// RunWhenReady
+//===----------------------------------------------------------------------===//
+
+void BM_RunWhenReadyFanIn(benchmark::State& state) {
+  auto host = CreateSingleThreadedHostContext();
+  std::vector<AsyncValueRef<Chain>> values(state.range(0));
+  std::vector<AsyncValue*> value_ptrs(state.range(0));
+  for (auto _ : state) {
+    for (int i = 0; i < state.range(0); ++i) {
+      values[i] = MakeConstructedAsyncValueRef<Chain>(host.get());
+      value_ptrs[i] = values[i].GetAsyncValue();
+    }
+    bool ready = false;
+    RunWhenReady(value_ptrs, [&] { ready = true; });
+    for (auto& value : values) value.SetStateConcrete();
+    benchmark::DoNotOptimize(ready);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RunWhenReadyFanIn)->Arg(1)->Arg(4)->Arg(32);
+
+//===----------------------------------------------------------------------===//
+// HostContext::Allocate
+//===----------------------------------------------------------------------===//
+
+void BM_HostContextAllocate(benchmark::State& state) {
+  auto host = CreateSingleThreadedHostContext();
+  for (auto _ : state) {
+    char* ptr = host->Allocate<char>(state.range(0));
+    benchmark::DoNotOptimize(ptr);
+    host->Deallocate(ptr, state.range(0));
+  }
+}
+BENCHMARK(BM_HostContextAllocate)->Arg(16)->Arg(1024)->Arg(64 << 10);
+
+//===----------------------------------------------------------------------===//
+// ParallelFor
+//===----------------------------------------------------------------------===//
+
+void BM_ParallelFor(benchmark::State& state) {
+  auto host = CreateMultiThreadedHostContext(state.range(0));
+  ParallelFor parallel_for(CreateExecutionContext(host.get()));
+  constexpr size_t kTotalSize = 1 << 16;
+  std::vector<int32_t> data(kTotalSize);
+  for (auto _ : state) {
+    auto done = parallel_for.Execute(
+        kTotalSize, ParallelFor::BlockSizes::Fixed(state.range(1)),
+        [&](size_t start, size_t end) {
+          for (size_t i = start; i < end; ++i) ++data[i];
+        });
+    host->Await({done.CopyRCRef()});
+  }
+  benchmark::DoNotOptimize(data.data());
+  state.SetItemsProcessed(state.iterations() * kTotalSize);
+}
+BENCHMARK(BM_ParallelFor)
+    ->Apply([](benchmark::internal::Benchmark* benchmark) {
+      for (int num_threads : {1, 2, 4, 8}) {
+        for (int block_size : {1 << 10, 1 << 14})
+          benchmark->Args({num_threads, block_size});
+      }
+    })
+    ->UseRealTime();
+
+//===----------------------------------------------------------------------===//
+// TimerQueue
+//===----------------------------------------------------------------------===//
+
+void BM_TimerQueueScheduleAndCancel(benchmark::State& state) {
+  TimerQueue timer_queue;
+  for (auto _ : state) {
+    auto handle =
+        timer_queue.ScheduleTimer(std::chrono::seconds(100), [] {});
+    timer_queue.CancelTimer(handle);
+  }
+}
+BENCHMARK(BM_TimerQueueScheduleAndCancel);
+
+// Measures the latency until an expired timer fires on the timer thread.
+void BM_TimerQueueFire(benchmark::State& state) {
+  TimerQueue timer_queue;
+  for (auto _ : state) {
+    latch fired(1);
+    timer_queue.ScheduleTimer(std::chrono::nanoseconds(0),
+                              [&] { fired.count_down(); });
+    fired.wait();
+  }
+}
+BENCHMARK(BM_TimerQueueFire)->UseRealTime();
+
+//===----------------------------------------------------------------------===//
+// ResourceContext
+//===----------------------------------------------------------------------===//
+
+struct BenchmarkResource {
+  int value = 0;
+};
+
+void BM_ResourceContextGetByName(benchmark::State& state) {
+  ResourceContext resource_context;
+  resource_context.CreateResource<BenchmarkResource>("resource");
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        resource_context.GetResource<BenchmarkResource>("resource"));
+  }
+}
+BENCHMARK(BM_ResourceContextGetByName);
+
+void BM_ResourceContextGetInSlot(benchmark::State& state) {
+  static const auto* slot = new ResourceSlot<BenchmarkResource>;
+  ResourceContext resource_context;
+  resource_context.GetOrCreateResource(*slot);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(resource_context.GetResource(*slot));
+  }
+}
+BENCHMARK(BM_ResourceContextGetInSlot);
+
+//===----------------------------------------------------------------------===//
+// MultiThreadedWorkQueue
+//===----------------------------------------------------------------------===//
+
+// Each task adds the next one until `num_hops` tasks have run, which measures
+// the round trip of a task through the queues of the worker threads.
+void AddPingPongTask(ConcurrentWorkQueue* work_queue, int num_hops,
+                     latch* done) {
+  work_queue->AddTask(TaskFunction([=] {
+    if (num_hops == 1) {
+      done->count_down();
+    } else {
+      AddPingPongTask(work_queue, num_hops - 1, done);
+    }
+  }));
+}
+
+void BM_WorkQueuePingPong(benchmark::State& state) {
+  auto work_queue = CreateMultiThreadedWorkQueue(state.range(0),
+                                                 /*num_blocking_threads=*/1);
+  constexpr int kNumHops = 100;
+  for (auto _ : state) {
+    latch done(1);
+    AddPingPongTask(work_queue.get(), kNumHops, &done);
+    done.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * kNumHops);
+}
+BENCHMARK(BM_WorkQueuePingPong)->Apply(ThreadCounts)->UseRealTime();
+
+// Adds independent tasks from the benchmark thread and waits for all of them.
+void BM_WorkQueueFanOut(benchmark::State& state) {
+  auto work_queue = CreateMultiThreadedWorkQueue(state.range(0),
+                                                 /*num_blocking_threads=*/1);
+  constexpr int kNumTasks = 100;
+  std::atomic<int64_t> sum{0};
+  for (auto _ : state) {
+    latch done(kNumTasks);
+    for (int i = 0; i < kNumTasks; ++i) {
+      work_queue->AddTask(TaskFunction([&] {
+        sum.fetch_add(1, std::memory_order_relaxed);
+        done.count_down();
+      }));
+    }
+    done.wait();
+  }
+  benchmark::DoNotOptimize(sum.load());
+  state.SetItemsProcessed(state.iterations() * kNumTasks);
+}
+BENCHMARK(BM_WorkQueueFanOut)->Apply(ThreadCounts)->UseRealTime();
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,158 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for BatchedOp.
+
+#include "tfrt/core_runtime/batched_op.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_invocation.h"
+#include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+class BatchedOpTest : public ::testing::Test {
+ protected:
+  BatchedOpTest()
+      : host_([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+              CreateMultiThreadedWorkQueue(2, 1)),
+        exec_ctx_(std::move(*RequestContextBuilder(&host_, nullptr).build())) {}
+
+  // An op that doubles its argument and records the number of rows of each
+  // execution.
+  CoreRuntimeOp MakeDoubleOp() {
+    return CoreRuntimeOp(
+        [this](const OpInvocation& invocation) {
+          const auto& arg =
+              invocation.arguments[0].GetAsyncTensor()->get<DenseHostTensor>();
+          batch_sizes_.push_back(arg.shape().GetDimensionSize(0));
+          auto result = DenseHostTensor::CreateUninitialized(arg.metadata(),
+                                                             &host_);
+          for (int i = 0; i < arg.NumElements(); ++i)
+            static_cast<float*>(result->data())[i] =
+                2 * static_cast<const float*>(arg.data())[i];
+          invocation.results[0] = TensorHandle(
+              host_.GetHostDeviceRef(), arg.metadata(),
+              MakeAvailableAsyncValueRef<DenseHostTensor>(
+                  &host_, std::move(*result)));
+        },
+        /*is_fallback=*/false);
+  }
+
+  TensorHandle MakeTensor(ArrayRef<float> values, int num_columns = 1) {
+    TensorMetadata md(DType(DType::F32),
+                      {static_cast<ssize_t>(values.size()) / num_columns,
+                       static_cast<ssize_t>(num_columns)});
+    auto dht = DenseHostTensor::CreateUninitialized(md, &host_);
+    std::copy(values.begin(), values.end(), static_cast<float*>(dht->data()));
+    return TensorHandle(
+        host_.GetHostDeviceRef(), md,
+        MakeAvailableAsyncValueRef<DenseHostTensor>(&host_, std::move(*dht)));
+  }
+
+  std::vector<float> GetValues(const TensorHandle& handle) {
+    host_.Await(FormRef(handle.GetAsyncTensor()));
+    const auto& dht = handle.GetAsyncTensor()->get<DenseHostTensor>();
+    auto* data = static_cast<const float*>(dht.data());
+    return std::vector<float>(data, data + dht.NumElements());
+  }
+
+  HostContext host_;
+  ExecutionContext exec_ctx_;
+  // Only written by the op, which runs once at a time in these tests.
+  std::vector<ssize_t> batch_sizes_;
+};
+
+TEST_F(BatchedOpTest, FullBatchExecutesOnce) {
+  BatchingOptions options;
+  options.max_batch_size = 4;
+  options.batch_timeout = std::chrono::seconds(100);
+  BatchedOp batched_op(MakeDoubleOp(), OpAttrs().freeze(), 1, options);
+
+  TensorHandle results[4];
+  for (int i = 0; i < 4; ++i) {
+    TensorHandle argument = MakeTensor({static_cast<float>(i)});
+    batched_op(exec_ctx_, argument, results[i]);
+  }
+  for (int i = 0; i < 4; ++i)
+    EXPECT_EQ(GetValues(results[i]), std::vector<float>({2.0f * i}));
+  EXPECT_EQ(batch_sizes_, std::vector<ssize_t>({4}));
+}
+
+TEST_F(BatchedOpTest, TimeoutExecutesPartialBatch) {
+  BatchingOptions options;
+  options.batch_timeout = std::chrono::milliseconds(1);
+  BatchedOp batched_op(MakeDoubleOp(), OpAttrs().freeze(), 1, options);
+
+  TensorHandle first, second;
+  TensorHandle argument = MakeTensor({1, 2, 3, 4}, 2);
+  batched_op(exec_ctx_, argument, first);
+  argument = MakeTensor({5, 6}, 2);
+  batched_op(exec_ctx_, argument, second);
+  EXPECT_EQ(GetValues(first), std::vector<float>({2, 4, 6, 8}));
+  EXPECT_EQ(GetValues(second), std::vector<float>({10, 12}));
+  EXPECT_EQ(first.GetAvailableMetadata().shape, TensorShape({2, 2}));
+  EXPECT_EQ(batch_sizes_, std::vector<ssize_t>({3}));
+}
+
+TEST_F(BatchedOpTest, PadsToAllowedBatchSize) {
+  BatchingOptions options;
+  options.batch_timeout = std::chrono::seconds(100);
+  options.allowed_batch_sizes = {2, 8};
+  BatchedOp batched_op(MakeDoubleOp(), OpAttrs().freeze(), 1, options);
+
+  TensorHandle results[3];
+  for (int i = 0; i < 3; ++i) {
+    TensorHandle argument = MakeTensor({static_cast<float>(i)});
+    batched_op(exec_ctx_, argument, results[i]);
+  }
+  batched_op.Flush();
+  for (int i = 0; i < 3; ++i)
+    EXPECT_EQ(GetValues(results[i]), std::vector<float>({2.0f * i}));
+  EXPECT_EQ(batch_sizes_, std::vector<ssize_t>({8}));
+}
+
+TEST_F(BatchedOpTest, MismatchedCallFails) {
+  BatchingOptions options;
+  options.batch_timeout = std::chrono::seconds(100);
+  BatchedOp batched_op(MakeDoubleOp(), OpAttrs().freeze(), 1, options);
+
+  TensorHandle good, bad;
+  TensorHandle argument = MakeTensor({1, 2}, 2);
+  batched_op(exec_ctx_, argument, good);
+  argument = MakeTensor({1, 2, 3}, 3);
+  batched_op(exec_ctx_, argument, bad);
+  batched_op.Flush();
+
+  EXPECT_EQ(GetValues(good), std::vector<float>({2, 4}));
+  host_.Await(FormRef(bad.GetAsyncTensor()));
+  EXPECT_TRUE(bad.IsError());
+  EXPECT_EQ(batch_sizes_, std::vector<ssize_t>({1}));
+}
+
+}  // namespace
+}  // namespace tfrt
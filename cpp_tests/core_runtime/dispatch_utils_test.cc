@@ -0,0 +1,61 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for the op dispatch utilities.
+
+#include "tfrt/core_runtime/dispatch_utils.h"
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
+
+namespace tfrt {
+namespace {
+
+TEST(DispatchUtilsTest, UnwrapDonatableArguments) {
+  auto host = CreateHostContext();
+
+  // A resolved IndirectAsyncValue referenced only by the arguments.
+  RCReference<AsyncValue> value =
+      MakeAvailableAsyncValueRef<int32_t>(host.get(), 1).ReleaseRCRef();
+  AsyncValue* value_ptr = value.get();
+  RCReference<IndirectAsyncValue> unique = MakeIndirectAsyncValue(host.get());
+  unique->ForwardTo(std::move(value));
+
+  // A resolved IndirectAsyncValue that is also referenced elsewhere.
+  RCReference<IndirectAsyncValue> shared = MakeIndirectAsyncValue(host.get());
+  shared->ForwardTo(
+      MakeAvailableAsyncValueRef<int32_t>(host.get(), 2).ReleaseRCRef());
+  RCReference<IndirectAsyncValue> shared_copy = shared.CopyRef();
+
+  // An unresolved IndirectAsyncValue.
+  RCReference<IndirectAsyncValue> unresolved =
+      MakeIndirectAsyncValue(host.get());
+  AsyncValue* unresolved_ptr = unresolved.get();
+
+  SmallVector<RCReference<AsyncValue>, 3> arguments;
+  arguments.push_back(std::move(unique));
+  arguments.push_back(std::move(shared));
+  arguments.push_back(std::move(unresolved));
+  internal::UnwrapDonatableArguments(arguments);
+
+  EXPECT_EQ(arguments[0].get(), value_ptr);
+  EXPECT_TRUE(arguments[0]->IsUnique());
+  EXPECT_EQ(arguments[1].get(), shared_copy.get());
+  EXPECT_EQ(arguments[2].get(), unresolved_ptr);
+}
+
+}  // namespace
+}  // namespace tfrt
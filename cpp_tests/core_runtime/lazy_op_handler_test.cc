@@ -0,0 +1,205 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for the LazyOpHandler.
+
+#include "tfrt/core_runtime/lazy_op_handler.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_handler.h"
+#include "tfrt/core_runtime/op_invocation.h"
+#include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/host_context/attribute_utils.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/tensor/scalar_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+using ::testing::ElementsAre;
+
+// An op handler that records the ops it executes. Every op returns a scalar
+// float tensor.
+class RecordingOpHandler : public OpHandler {
+ public:
+  explicit RecordingOpHandler(CoreRuntime* runtime)
+      : OpHandler("recording", runtime, /*fallback=*/nullptr) {}
+
+  Expected<CoreRuntimeOp> MakeOp(string_view op_name) override {
+    return CoreRuntimeOp(
+        [this, op_name = op_name.str()](const OpInvocation& invocation) {
+          Record(op_name, invocation);
+          auto* host = invocation.exec_ctx.host();
+          TensorMetadata metadata(DType(DType::F32), {});
+          invocation.results[0] = TensorHandle(
+              host->GetHostDeviceRef(), metadata,
+              MakeAvailableAsyncValueRef<ScalarHostTensor<float>>(
+                  host, metadata, 1.0f));
+        },
+        /*is_fallback=*/false);
+  }
+
+  std::vector<std::string> executed_ops() {
+    mutex_lock lock(mu_);
+    return executed_ops_;
+  }
+
+  std::vector<std::string> fused_ops() {
+    mutex_lock lock(mu_);
+    return fused_ops_;
+  }
+
+ private:
+  void Record(const std::string& op_name, const OpInvocation& invocation) {
+    mutex_lock lock(mu_);
+    executed_ops_.push_back(op_name);
+    AggregateAttr fused_ops;
+    if (invocation.attrs.Get("fused_ops", &fused_ops)) {
+      for (int i = 0, e = fused_ops.GetNumElements(); i < e; ++i)
+        fused_ops_.push_back(
+            fused_ops.GetAttributeOfType<StringAttr>(i).GetValue().str());
+    }
+  }
+
+  mutex mu_;
+  std::vector<std::string> executed_ops_ TFRT_GUARDED_BY(mu_);
+  std::vector<std::string> fused_ops_ TFRT_GUARDED_BY(mu_);
+};
+
+class LazyOpHandlerTest : public ::testing::Test {
+ protected:
+  LazyOpHandlerTest()
+      : runtime_(std::move(*CoreRuntime::Create(
+            [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+            CreateSingleThreadedWorkQueue()))) {
+    auto recording = std::make_unique<RecordingOpHandler>(runtime_.get());
+    recording_ = recording.get();
+    runtime_->TakeOpHandler(std::move(recording));
+    lazy_ = std::move(*CreateLazyOpHandler(runtime_.get(), recording_));
+    exec_ctx_ = std::make_unique<ExecutionContext>(
+        std::move(*RequestContextBuilder(host(), nullptr).build()));
+  }
+
+  HostContext* host() { return runtime_->GetHostContext(); }
+
+  TensorHandle MakeTensor() {
+    TensorMetadata metadata(DType(DType::F32), {});
+    return TensorHandle(host()->GetHostDeviceRef(), metadata,
+                        MakeAvailableAsyncValueRef<ScalarHostTensor<float>>(
+                            host(), metadata, 2.0f));
+  }
+
+  TensorHandle Execute(string_view op_name,
+                       MutableArrayRef<TensorHandle> args) {
+    auto op = runtime_->MakeOp(op_name, lazy_);
+    EXPECT_TRUE(!!op);
+    OpAttrs attrs;
+    TensorHandle result;
+    (*op)(*exec_ctx_, args, OpAttrsRef(attrs), result, /*chain=*/nullptr);
+    return result;
+  }
+
+  std::unique_ptr<CoreRuntime> runtime_;
+  RecordingOpHandler* recording_;
+  OpHandler* lazy_;
+  std::unique_ptr<ExecutionContext> exec_ctx_;
+};
+
+TEST_F(LazyOpHandlerTest, FusesMatMulBiasAddRelu) {
+  TensorHandle result;
+  {
+    TensorHandle matmul_args[] = {MakeTensor(), MakeTensor()};
+    TensorHandle matmul = Execute("tf.MatMul", matmul_args);
+    TensorHandle bias_add_args[] = {std::move(matmul), MakeTensor()};
+    TensorHandle bias_add = Execute("tf.BiasAdd", bias_add_args);
+    TensorHandle relu_args[] = {std::move(bias_add)};
+    result = Execute("tf.Relu", relu_args);
+  }
+  EXPECT_TRUE(recording_->executed_ops().empty());
+
+  runtime_->GetHostContext()->Quiesce();
+  EXPECT_THAT(recording_->executed_ops(), ElementsAre("tf._FusedMatMul"));
+  EXPECT_THAT(recording_->fused_ops(), ElementsAre("BiasAdd", "Relu"));
+  ASSERT_TRUE(result.GetAsyncTensor()->IsAvailable());
+  EXPECT_FALSE(result.GetAsyncTensor()->IsError());
+}
+
+TEST_F(LazyOpHandlerTest, FusesConv2DBiasAddRelu) {
+  TensorHandle result;
+  {
+    TensorHandle conv_args[] = {MakeTensor(), MakeTensor()};
+    TensorHandle conv = Execute("tf.Conv2D", conv_args);
+    TensorHandle bias_add_args[] = {std::move(conv), MakeTensor()};
+    TensorHandle bias_add = Execute("tf.BiasAdd", bias_add_args);
+    TensorHandle relu_args[] = {std::move(bias_add)};
+    result = Execute("tf.Relu", relu_args);
+  }
+
+  runtime_->GetHostContext()->Quiesce();
+  EXPECT_THAT(recording_->executed_ops(), ElementsAre("tf._FusedConv2D"));
+  EXPECT_THAT(recording_->fused_ops(), ElementsAre("BiasAdd", "Relu"));
+  ASSERT_TRUE(result.GetAsyncTensor()->IsAvailable());
+  EXPECT_FALSE(result.GetAsyncTensor()->IsError());
+}
+
+TEST_F(LazyOpHandlerTest, NextOpFlushesChain) {
+  TensorHandle matmul_args[] = {MakeTensor(), MakeTensor()};
+  TensorHandle bias_add_args[] = {Execute("tf.MatMul", matmul_args),
+                                  MakeTensor()};
+  TensorHandle add_args[] = {Execute("tf.BiasAdd", bias_add_args),
+                             MakeTensor()};
+  EXPECT_TRUE(recording_->executed_ops().empty());
+
+  Execute("tf.AddV2", add_args);
+  EXPECT_THAT(recording_->executed_ops(),
+              ElementsAre("tf._FusedMatMul", "tf.AddV2"));
+  EXPECT_THAT(recording_->fused_ops(), ElementsAre("BiasAdd"));
+  runtime_->GetHostContext()->Quiesce();
+}
+
+TEST_F(LazyOpHandlerTest, ObservedIntermediateResultIsNotFused) {
+  TensorHandle matmul_args[] = {MakeTensor(), MakeTensor()};
+  TensorHandle matmul = Execute("tf.MatMul", matmul_args);
+  TensorHandle bias_add_args[] = {matmul.CopyRef(), MakeTensor()};
+  TensorHandle bias_add = Execute("tf.BiasAdd", bias_add_args);
+
+  runtime_->GetHostContext()->Quiesce();
+  EXPECT_THAT(recording_->executed_ops(),
+              ElementsAre("tf.MatMul", "tf.BiasAdd"));
+  ASSERT_TRUE(matmul.GetAsyncTensor()->IsAvailable());
+  EXPECT_FALSE(matmul.GetAsyncTensor()->IsError());
+  ASSERT_TRUE(bias_add.GetAsyncTensor()->IsAvailable());
+  EXPECT_FALSE(bias_add.GetAsyncTensor()->IsError());
+}
+
+TEST_F(LazyOpHandlerTest, OtherOpsAreNotDeferred) {
+  TensorHandle args[] = {MakeTensor(), MakeTensor()};
+  Execute("tf.AddV2", args);
+  EXPECT_THAT(recording_->executed_ops(), ElementsAre("tf.AddV2"));
+}
+
+}  // namespace
+}  // namespace tfrt
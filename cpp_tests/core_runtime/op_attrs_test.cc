@@ -219,6 +219,68 @@ TEST(OpAttrsTest, ArrayAsserting) {
   ASSERT_EQ(op_attrs_ref.GetArrayAsserting<int32_t>("bar"), empty_ref);
 }
 
+TEST(OpAttrsTest, Fingerprint) {
+  OpAttrs op_attrs1;
+  ASSERT_TRUE(op_attrs1.Set<int32_t>("foo", 1));
+  ASSERT_TRUE(op_attrs1.SetString("bar", "baz"));
+
+  // The fingerprint does not depend on the order of the attributes.
+  OpAttrs op_attrs2;
+  ASSERT_TRUE(op_attrs2.SetString("bar", "baz"));
+  ASSERT_TRUE(op_attrs2.Set<int32_t>("foo", 1));
+
+  auto fingerprint = OpAttrsRef(op_attrs1).Fingerprint(1024);
+  ASSERT_TRUE(fingerprint.hasValue());
+  EXPECT_EQ(OpAttrsRef(op_attrs2).Fingerprint(1024), fingerprint);
+  EXPECT_EQ(OpAttrsRef(op_attrs1).freeze().Fingerprint(1024), fingerprint);
+
+  OpAttrs op_attrs3;
+  ASSERT_TRUE(op_attrs3.SetString("bar", "baz"));
+  ASSERT_TRUE(op_attrs3.Set<int32_t>("foo", 2));
+  EXPECT_NE(OpAttrsRef(op_attrs3).Fingerprint(1024), fingerprint);
+
+  // Attribute values larger than the limit are not fingerprinted.
+  EXPECT_FALSE(OpAttrsRef(op_attrs1).Fingerprint(4).hasValue());
+}
+
+TEST(OpAttrsTest, Intern) {
+  OpAttrsInterner interner;
+
+  OpAttrs op_attrs1;
+  ASSERT_TRUE(op_attrs1.Set<int32_t>("foo", 1));
+  ASSERT_TRUE(op_attrs1.SetString("bar", "baz"));
+  OpAttrsRef interned1 = interner.Intern(op_attrs1);
+  ASSERT_TRUE(interned1.IsInterned());
+  EXPECT_EQ(interned1.GetAsserting<int32_t>("foo"), 1);
+  EXPECT_EQ(interned1.GetStringAsserting("bar"), "baz");
+  EXPECT_FALSE(OpAttrsRef(op_attrs1).IsInterned());
+
+  // Identical attribute sets are interned to the same copy.
+  OpAttrs op_attrs2;
+  ASSERT_TRUE(op_attrs2.SetString("bar", "baz"));
+  ASSERT_TRUE(op_attrs2.Set<int32_t>("foo", 1));
+  OpAttrsRef interned2 = interner.Intern(op_attrs2);
+  EXPECT_EQ(interned2.GetInternedIdentity(), interned1.GetInternedIdentity());
+  EXPECT_EQ(interner.Intern(op_attrs1).GetInternedIdentity(),
+            interned1.GetInternedIdentity());
+  EXPECT_EQ(interned2.Fingerprint(0), OpAttrsRef(op_attrs1).Fingerprint(1024));
+
+  // Modified attribute sets are interned separately.
+  ASSERT_TRUE(op_attrs2.Set<bool>("qux", true));
+  OpAttrsRef interned3 = interner.Intern(op_attrs2);
+  EXPECT_NE(interned3.GetInternedIdentity(), interned1.GetInternedIdentity());
+  EXPECT_EQ(interner.size(), 2);
+
+  // Empty sets and sets with external attributes are not interned.
+  OpAttrs empty_attrs;
+  EXPECT_FALSE(interner.Intern(empty_attrs).IsInterned());
+  OpAttrs external_attrs;
+  ASSERT_TRUE(external_attrs.SetStringExternal("bar", "baz"));
+  OpAttrsRef frozen = interner.Intern(external_attrs);
+  EXPECT_FALSE(frozen.IsInterned());
+  EXPECT_EQ(frozen.GetStringAsserting("bar"), "baz");
+}
+
 void BM_OpAttrSetBool(benchmark::State& state) {
   for (auto _ : state) {
     tfrt::OpAttrs attrs;
@@ -236,6 +298,17 @@ void BM_OpAttrGetBool(benchmark::State& state) {
 }
 BENCHMARK(BM_OpAttrGetBool);
 
+void BM_OpAttrsIntern(benchmark::State& state) {
+  tfrt::OpAttrsInterner interner;
+  for (auto _ : state) {
+    tfrt::OpAttrs attrs;
+    attrs.Set<bool>("transpose_a", false);
+    attrs.Set<bool>("transpose_b", true);
+    benchmark::DoNotOptimize(interner.Intern(attrs));
+  }
+}
+BENCHMARK(BM_OpAttrsIntern);
+
 void BM_OpAttrSetUnrankedShape(benchmark::State& state) {
   tfrt::BefAttrEncoder encoder;
   const size_t offset = encoder.EncodeUnrankedShapeAttr();
@@ -0,0 +1,174 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for OpBatch and CoreRuntime::ExecuteBatch.
+
+#include "tfrt/core_runtime/op_batch.h"
+
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_handler.h"
+#include "tfrt/core_runtime/op_invocation.h"
+#include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/scalar_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+float GetValue(const TensorHandle& handle) {
+  return handle.GetAsyncTensor()->get<ScalarHostTensor<float>>().GetValue();
+}
+
+TensorHandle MakeTensor(HostContext* host, float value) {
+  TensorMetadata metadata(DType(DType::F32), {});
+  return TensorHandle(host->GetHostDeviceRef(), metadata,
+                      MakeAvailableAsyncValueRef<ScalarHostTensor<float>>(
+                          host, metadata, value));
+}
+
+// An op handler with scalar "test.add" and "test.multiply" ops. It counts the
+// ops it makes.
+class ArithmeticOpHandler : public OpHandler {
+ public:
+  explicit ArithmeticOpHandler(CoreRuntime* runtime)
+      : OpHandler("arithmetic", runtime, /*fallback=*/nullptr) {}
+
+  Expected<CoreRuntimeOp> MakeOp(string_view op_name) override {
+    bool is_add = op_name == "test.add";
+    if (!is_add && op_name != "test.multiply")
+      return MakeStringError(op_name, " is not supported.");
+    ++num_made_ops_;
+    return CoreRuntimeOp(
+        [is_add](const OpInvocation& invocation) {
+          float lhs = GetValue(invocation.arguments[0]);
+          float rhs = GetValue(invocation.arguments[1]);
+          invocation.results[0] =
+              MakeTensor(invocation.exec_ctx.host(),
+                         is_add ? lhs + rhs : lhs * rhs);
+        },
+        /*is_fallback=*/false);
+  }
+
+  int num_made_ops() const { return num_made_ops_; }
+
+ private:
+  int num_made_ops_ = 0;
+};
+
+class OpBatchTest : public ::testing::Test {
+ protected:
+  OpBatchTest()
+      : runtime_(std::move(*CoreRuntime::Create(
+            [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+            CreateSingleThreadedWorkQueue()))) {
+    auto op_handler = std::make_unique<ArithmeticOpHandler>(runtime_.get());
+    op_handler_ = op_handler.get();
+    runtime_->TakeOpHandler(std::move(op_handler));
+    exec_ctx_ = std::make_unique<ExecutionContext>(
+        std::move(*RequestContextBuilder(host(), nullptr).build()));
+  }
+
+  HostContext* host() { return runtime_->GetHostContext(); }
+
+  std::unique_ptr<CoreRuntime> runtime_;
+  ArithmeticOpHandler* op_handler_;
+  std::unique_ptr<ExecutionContext> exec_ctx_;
+};
+
+TEST_F(OpBatchTest, ExecuteBatch) {
+  OpAttrs attrs;
+  OpBatch batch(runtime_.get());
+  // Computes ((x + y) * x, x + y).
+  OpBatch::ValueId x = batch.AddArgument();
+  OpBatch::ValueId y = batch.AddArgument();
+  auto sum = batch.AddOp("test.add", op_handler_, {x, y}, attrs);
+  ASSERT_TRUE(!!sum);
+  auto product = batch.AddOp("test.multiply", op_handler_, {*sum, x}, attrs);
+  ASSERT_TRUE(!!product);
+  batch.AddResult(*product);
+  batch.AddResult(*sum);
+
+  EXPECT_EQ(batch.num_arguments(), 2);
+  EXPECT_EQ(batch.num_results(), 2);
+  EXPECT_EQ(batch.num_ops(), 2);
+
+  // The batch can be executed repeatedly.
+  for (float value : {1.0f, 2.0f, 3.0f}) {
+    TensorHandle arguments[] = {MakeTensor(host(), value),
+                                MakeTensor(host(), 10.0f)};
+    TensorHandle results[2];
+    runtime_->ExecuteBatch(*exec_ctx_, batch, arguments, results,
+                           /*chain=*/nullptr);
+    EXPECT_EQ(GetValue(results[0]), (value + 10.0f) * value);
+    EXPECT_EQ(GetValue(results[1]), value + 10.0f);
+  }
+}
+
+TEST_F(OpBatchTest, ResolvesOpsOnce) {
+  OpAttrs attrs;
+  OpBatch batch(runtime_.get());
+  OpBatch::ValueId value = batch.AddArgument();
+  for (int i = 0; i < 10; ++i) {
+    auto sum = batch.AddOp("test.add", op_handler_, {value, value}, attrs);
+    ASSERT_TRUE(!!sum);
+    value = *sum;
+  }
+  batch.AddResult(value);
+  EXPECT_EQ(op_handler_->num_made_ops(), 1);
+
+  TensorHandle arguments[] = {MakeTensor(host(), 1.0f)};
+  TensorHandle results[1];
+  runtime_->ExecuteBatch(*exec_ctx_, batch, arguments, results,
+                         /*chain=*/nullptr);
+  EXPECT_EQ(GetValue(results[0]), 1024.0f);
+}
+
+TEST_F(OpBatchTest, ArgumentAsResult) {
+  OpAttrs attrs;
+  OpBatch batch(runtime_.get());
+  OpBatch::ValueId x = batch.AddArgument();
+  batch.AddResult(x);
+  auto sum = batch.AddOp("test.add", op_handler_, {x, x}, attrs);
+  ASSERT_TRUE(!!sum);
+  batch.AddResult(*sum);
+
+  TensorHandle arguments[] = {MakeTensor(host(), 3.0f)};
+  TensorHandle results[2];
+  runtime_->ExecuteBatch(*exec_ctx_, batch, arguments, results,
+                         /*chain=*/nullptr);
+  EXPECT_EQ(GetValue(results[0]), 3.0f);
+  EXPECT_EQ(GetValue(results[1]), 6.0f);
+}
+
+TEST_F(OpBatchTest, UnsupportedOp) {
+  OpAttrs attrs;
+  OpBatch batch(runtime_.get());
+  OpBatch::ValueId x = batch.AddArgument();
+  auto result = batch.AddOp("test.unknown", op_handler_, {x}, attrs);
+  EXPECT_FALSE(!!result);
+  llvm::consumeError(result.takeError());
+  EXPECT_EQ(batch.num_ops(), 0);
+}
+
+}  // namespace
+}  // namespace tfrt
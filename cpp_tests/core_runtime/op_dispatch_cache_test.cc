@@ -0,0 +1,194 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file has unit tests for tfrt::ArgumentConversionCache and
+// tfrt::MetadataFnCache.
+
+#include "tfrt/core_runtime/op_dispatch_cache.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/coo_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/scalar_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+using Entry = ArgumentConversionCache::Entry;
+using Key = ArgumentConversionCache::Key;
+
+Entry MakeEntry(TensorType src, DType dtype, TensorType dst) {
+  Entry entry;
+  entry.key = Key{src, dtype, /*device=*/nullptr};
+  entry.dst_tensor_type = dst;
+  entry.allowed = true;
+  return entry;
+}
+
+TEST(ArgumentConversionCacheTest, LookupInsertedEntries) {
+  ArgumentConversionCache cache;
+  Entry dht = MakeEntry(DenseHostTensor::kTensorType, DType(DType::F32),
+                        DenseHostTensor::kTensorType);
+  Entry scalar = MakeEntry(AnyScalarHostTensor::kTensorType, DType(DType::F32),
+                           DenseHostTensor::kTensorType);
+  EXPECT_EQ(cache.Lookup(dht.key), nullptr);
+
+  const Entry* cached = cache.Insert(dht);
+  ASSERT_NE(cached, nullptr);
+  EXPECT_TRUE(cached->IsNoOp());
+  EXPECT_EQ(cache.Lookup(dht.key), cached);
+  EXPECT_EQ(cache.Lookup(scalar.key), nullptr);
+
+  cached = cache.Insert(scalar);
+  ASSERT_NE(cached, nullptr);
+  EXPECT_FALSE(cached->IsNoOp());
+  EXPECT_EQ(cache.Lookup(scalar.key), cached);
+
+  // The dtype is part of the key.
+  EXPECT_EQ(cache.Lookup(Key{DenseHostTensor::kTensorType, DType(DType::I32),
+                             /*device=*/nullptr}),
+            nullptr);
+}
+
+TEST(ArgumentConversionCacheTest, FullCache) {
+  ArgumentConversionCache cache;
+  for (int i = 0; i < ArgumentConversionCache::kNumEntries; ++i) {
+    EXPECT_NE(cache.Insert(MakeEntry(CooHostTensor::kTensorType,
+                                     DType(static_cast<DType::Kind>(i + 1)),
+                                     DenseHostTensor::kTensorType)),
+              nullptr);
+  }
+  Entry entry = MakeEntry(DenseHostTensor::kTensorType, DType(DType::F32),
+                          DenseHostTensor::kTensorType);
+  EXPECT_EQ(cache.Insert(entry), nullptr);
+  EXPECT_EQ(cache.Lookup(entry.key), nullptr);
+}
+
+TEST(ArgumentConversionCacheTest, ConcurrentInsert) {
+  ArgumentConversionCache cache;
+  Entry entry = MakeEntry(DenseHostTensor::kTensorType, DType(DType::F32),
+                          DenseHostTensor::kTensorType);
+
+  // All threads get the same cached entry.
+  std::vector<const Entry*> cached(4);
+  std::vector<std::thread> threads;
+  for (auto& result : cached) {
+    threads.emplace_back([&] { result = cache.Insert(entry); });
+  }
+  for (auto& thread : threads) thread.join();
+  for (const Entry* result : cached) EXPECT_EQ(result, cache.Lookup(entry.key));
+}
+
+int num_metadata_fn_calls = 0;
+
+// Returns the first argument metadata, or an error if the "error" attribute is
+// set.
+RCReference<AsyncValue> IdentityMetadataFn(
+    const ExecutionContext& exec_ctx, ArrayRef<TensorMetadata> inputs,
+    const OpAttrsRef& attrs, MutableArrayRef<TensorMetadata> results) {
+  ++num_metadata_fn_calls;
+  if (attrs.GetOptional<bool>("error").getValueOr(false))
+    return MakeErrorAsyncValueRef(exec_ctx.host(), "metadata error");
+  results[0] = inputs[0];
+  return {};
+}
+
+class MetadataFnCacheTest : public ::testing::Test {
+ protected:
+  MetadataFnCacheTest() { num_metadata_fn_calls = 0; }
+
+  RCReference<AsyncValue> Run(ArrayRef<TensorMetadata> arguments,
+                              const OpAttrs& attrs, TensorMetadata* result) {
+    return MetadataFnCache::Get(&host_).Run(
+        IdentityMetadataFn, exec_ctx_, arguments, OpAttrsRef(attrs),
+        MutableArrayRef<TensorMetadata>(result, 1));
+  }
+
+  HostContext host_{[](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+                    CreateSingleThreadedWorkQueue()};
+  ExecutionContext exec_ctx_{std::move(
+      *RequestContextBuilder(&host_, /*resource_context=*/nullptr).build())};
+};
+
+TEST_F(MetadataFnCacheTest, CachesResults) {
+  TensorMetadata md(DType(DType::F32), {2, 3});
+  OpAttrs attrs;
+  ASSERT_TRUE(attrs.Set<int32_t>("axis", 1));
+
+  TensorMetadata result;
+  EXPECT_FALSE(Run(md, attrs, &result));
+  EXPECT_EQ(result, md);
+  EXPECT_EQ(num_metadata_fn_calls, 1);
+
+  result = TensorMetadata();
+  EXPECT_FALSE(Run(md, attrs, &result));
+  EXPECT_EQ(result, md);
+  EXPECT_EQ(num_metadata_fn_calls, 1);
+
+  // A different shape, dtype or attribute value is a miss.
+  TensorMetadata other_shape(DType(DType::F32), {3, 2});
+  EXPECT_FALSE(Run(other_shape, attrs, &result));
+  EXPECT_EQ(result, other_shape);
+  EXPECT_EQ(num_metadata_fn_calls, 2);
+
+  TensorMetadata other_dtype(DType(DType::I32), {2, 3});
+  EXPECT_FALSE(Run(other_dtype, attrs, &result));
+  EXPECT_EQ(result, other_dtype);
+  EXPECT_EQ(num_metadata_fn_calls, 3);
+
+  OpAttrs other_attrs;
+  ASSERT_TRUE(other_attrs.Set<int32_t>("axis", 0));
+  EXPECT_FALSE(Run(md, other_attrs, &result));
+  EXPECT_EQ(num_metadata_fn_calls, 4);
+
+  auto stats = MetadataFnCache::Get(&host_).GetStats();
+  EXPECT_EQ(stats.num_hits, 1);
+  EXPECT_EQ(stats.num_misses, 4);
+}
+
+TEST_F(MetadataFnCacheTest, ErrorsAreNotCached) {
+  TensorMetadata md(DType(DType::F32), {2});
+  OpAttrs attrs;
+  ASSERT_TRUE(attrs.Set<bool>("error", true));
+
+  TensorMetadata result;
+  EXPECT_TRUE(Run(md, attrs, &result));
+  EXPECT_TRUE(Run(md, attrs, &result));
+  EXPECT_EQ(num_metadata_fn_calls, 2);
+}
+
+TEST_F(MetadataFnCacheTest, LargeAttributesAreNotCached) {
+  TensorMetadata md(DType(DType::F32), {2});
+  std::vector<int32_t> values(MetadataFnCache::kMaxAttrValueBytes);
+  OpAttrs attrs;
+  ASSERT_TRUE(attrs.SetArray<int32_t>("values", values));
+
+  TensorMetadata result;
+  EXPECT_FALSE(Run(md, attrs, &result));
+  EXPECT_FALSE(Run(md, attrs, &result));
+  EXPECT_EQ(num_metadata_fn_calls, 2);
+  EXPECT_EQ(MetadataFnCache::Get(&host_).GetStats().num_uncacheable, 2);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit tests for the recording and the replay of request signatures.
+
+#include "tfrt/core_runtime/request_signature.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/host_context/native_function.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+// The shapes and the first values of the tensor arguments of the calls of
+// the test function.
+std::vector<std::string>* calls = new std::vector<std::string>();
+
+void TestCallable(AsyncValue* const* arguments, int num_arguments,
+                  RCReference<AsyncValue>* results, int num_results,
+                  HostContext* host) {
+  const auto& tensor = arguments[1]->get<DenseHostTensor>();
+  std::string call;
+  llvm::raw_string_ostream os(call);
+  os << tensor.shape() << " "
+     << static_cast<int>(static_cast<const float*>(tensor.data())[0]);
+  calls->push_back(os.str());
+  results[0] = GetReadyChain(host).ReleaseRCRef();
+}
+
+class RequestSignatureTest : public ::testing::Test {
+ protected:
+  RequestSignatureTest()
+      : host_([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+              CreateSingleThreadedWorkQueue()),
+        exec_ctx_(std::move(*RequestContextBuilder(&host_, nullptr).build())),
+        function_("main",
+                  {host_.GetKernelRegistry().GetType("!tfrt.chain"),
+                   host_.GetKernelRegistry().GetType("!t.tensor")},
+                  {host_.GetKernelRegistry().GetType("!tfrt.chain")},
+                  TestCallable) {
+    calls->clear();
+  }
+
+  RCReference<AsyncValue> MakeTensor(ArrayRef<ssize_t> dims, float value) {
+    auto dht = DenseHostTensor::CreateUninitialized(
+        TensorMetadata(GetDType<float>(), dims), &host_);
+    for (int i = 0; i < dht->NumElements(); ++i)
+      static_cast<float*>(dht->data())[i] = value;
+    return MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*dht));
+  }
+
+  HostContext host_;
+  ExecutionContext exec_ctx_;
+  NativeFunction function_;
+};
+
+TEST_F(RequestSignatureTest, PrintAndParse) {
+  auto chain = GetReadyChain(&host_);
+  auto tensor = MakeTensor({2, 3}, 1.0f);
+  auto signature =
+      GetRequestSignature(function_, {chain.GetAsyncValue(), tensor.get()});
+  ASSERT_TRUE(!!signature);
+  EXPECT_EQ(PrintRequestSignature(*signature), "main chain dht:f32[2,3]");
+
+  auto parsed = ParseRequestSignature("main chain th:i32[] dht:f32[4]");
+  ASSERT_TRUE(!!parsed);
+  EXPECT_EQ(PrintRequestSignature(*parsed), "main chain th:i32[] dht:f32[4]");
+
+  auto invalid = ParseRequestSignature("main dht:x32[4]");
+  EXPECT_FALSE(!!invalid);
+  llvm::consumeError(invalid.takeError());
+}
+
+TEST_F(RequestSignatureTest, RecordDistinctSignatures) {
+  auto chain = GetReadyChain(&host_);
+  RequestRecorder recorder;
+  for (auto dims : {std::vector<ssize_t>{2, 3}, std::vector<ssize_t>{4, 3},
+                    std::vector<ssize_t>{2, 3}}) {
+    auto tensor = MakeTensor(dims, 1.0f);
+    recorder.Record(function_, {chain.GetAsyncValue(), tensor.get()});
+  }
+
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  recorder.Write(os);
+  EXPECT_EQ(os.str(), "main chain dht:f32[2,3]\nmain chain dht:f32[4,3]\n");
+
+  auto signatures = ParseRequestSignatures(text);
+  ASSERT_TRUE(!!signatures);
+  EXPECT_EQ(signatures->size(), 2);
+}
+
+TEST_F(RequestSignatureTest, WarmUpCallsFunctions) {
+  auto signatures = ParseRequestSignatures(
+      "main chain dht:f32[2,3]\n\nmain chain dht:f32[4]\nmissing chain\n");
+  ASSERT_TRUE(!!signatures);
+
+  auto error = WarmUp(
+      *signatures,
+      [&](string_view name) -> const Function* {
+        return name == "main" ? &function_ : nullptr;
+      },
+      exec_ctx_);
+  // The missing function is reported, but the other calls are made.
+  ASSERT_TRUE(!!error);
+  EXPECT_NE(toString(std::move(error)).find("missing: function not found"),
+            std::string::npos);
+  EXPECT_EQ(*calls, (std::vector<std::string>{"[2, 3] 0", "[4] 0"}));
+}
+
+}  // namespace
+}  // namespace tfrt
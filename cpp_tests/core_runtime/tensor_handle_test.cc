@@ -0,0 +1,87 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for TensorHandle.
+
+#include "tfrt/core_runtime/tensor_handle.h"
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/device.h"
+#include "tfrt/tensor/scalar_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+class TensorHandleTest : public ::testing::Test {
+ protected:
+  TensorHandleTest() : host_(CreateHostContext()) {}
+
+  AsyncValueRef<Tensor> MakeTensor() {
+    return MakeAvailableAsyncValueRef<ScalarHostTensor<float>>(
+        host_.get(), metadata_, 1.0f);
+  }
+
+  std::unique_ptr<HostContext> host_;
+  TensorMetadata metadata_{DType(DType::F32), {}};
+};
+
+TEST_F(TensorHandleTest, AvailableDeviceAndMetadataAreInlined) {
+  auto device = MakeAvailableAsyncValueRef<RCReference<Device>>(
+      host_.get(), host_->GetHostDeviceRef());
+  auto metadata =
+      MakeAvailableAsyncValueRef<TensorMetadata>(host_.get(), metadata_);
+
+  TensorHandle handle(std::move(device), std::move(metadata), MakeTensor());
+  ASSERT_TRUE(handle.IsDeviceAvailable());
+  ASSERT_TRUE(handle.IsMetadataAvailable());
+  EXPECT_EQ(handle.GetAvailableDevice().get(), host_->GetHostDeviceRef().get());
+  EXPECT_EQ(handle.GetAvailableMetadata(), metadata_);
+
+  TensorHandle copy = handle.CopyRef();
+  EXPECT_EQ(copy.GetAvailableMetadata(), metadata_);
+}
+
+TEST_F(TensorHandleTest, UnavailableDeviceAndMetadataAreNotInlined) {
+  auto device =
+      MakeUnconstructedAsyncValueRef<RCReference<Device>>(host_.get());
+  auto metadata = MakeUnconstructedAsyncValueRef<TensorMetadata>(host_.get());
+  auto tensor = MakeIndirectAsyncValue(host_.get());
+
+  TensorHandle handle(device.CopyRef(), metadata.CopyRef(),
+                      AsyncValueRef<Tensor>(tensor.CopyRef()));
+  EXPECT_FALSE(handle.IsDeviceAvailable());
+  EXPECT_FALSE(handle.IsMetadataAvailable());
+  EXPECT_EQ(handle.GetAsyncTensor(), tensor.get());
+
+  device.emplace(host_->GetHostDeviceRef());
+  metadata.emplace(metadata_);
+  tensor->ForwardTo(MakeTensor().ReleaseRCRef());
+  EXPECT_TRUE(handle.IsDeviceAvailable());
+  EXPECT_EQ(handle.GetAvailableMetadata(), metadata_);
+}
+
+TEST_F(TensorHandleTest, ResolvedIndirectTensorIsSkipped) {
+  AsyncValueRef<Tensor> tensor = MakeTensor();
+  auto indirect = MakeIndirectAsyncValue(host_.get());
+  indirect->ForwardTo(tensor.CopyRCRef());
+
+  TensorHandle handle(host_->GetHostDeviceRef(), metadata_,
+                      AsyncValueRef<Tensor>(std::move(indirect)));
+  EXPECT_EQ(handle.GetAsyncTensor(), tensor.GetAsyncValue());
+}
+
+}  // namespace
+}  // namespace tfrt
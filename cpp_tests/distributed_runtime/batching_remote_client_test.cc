@@ -0,0 +1,201 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for BatchingRemoteClient.
+
+#include "tfrt/distributed_runtime/batching_remote_client.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace {
+
+// Records the batches it is asked to send, which complete when the test calls
+// CompleteBatch(). RemoteExecute fails if the program name is "fail", all
+// other calls fail.
+class FakeRemoteClient : public RemoteClientInterface {
+ public:
+#define FAKE_CLIENT_METHOD(method)                                          \
+  void method##Async(RemoteCallContext* call_ctx,                           \
+                     const method##Request* request,                        \
+                     method##Response* response, CallbackFn done) override { \
+    done(MakeStringError("unexpected call"));                               \
+  }
+
+  FAKE_CLIENT_METHOD(GetDevices);
+  FAKE_CLIENT_METHOD(CreateContext);
+  FAKE_CLIENT_METHOD(CloseContext);
+  FAKE_CLIENT_METHOD(SendReadyChains);
+  FAKE_CLIENT_METHOD(SendData);
+  FAKE_CLIENT_METHOD(RegisterFunction);
+  FAKE_CLIENT_METHOD(RemoteExecuteOp);
+  FAKE_CLIENT_METHOD(DeleteRemoteObjects);
+  FAKE_CLIENT_METHOD(KeepAlive);
+
+#undef FAKE_CLIENT_METHOD
+
+  void RemoteExecuteAsync(RemoteCallContext* call_ctx,
+                          const RemoteExecuteRequest* request,
+                          RemoteExecuteResponse* response,
+                          CallbackFn done) override {
+    if (request->program_name() == "fail") {
+      done(MakeStringError("failed"));
+      return;
+    }
+    response->add_metadata(request->program_name());
+    done(Error::success());
+  }
+
+  void BatchAsync(RemoteCallContext* call_ctx, const BatchRequest* request,
+                  BatchResponse* response, CallbackFn done) override {
+    batches.push_back({request, response, std::move(done)});
+  }
+
+  // Completes the oldest pending batch with the default implementation of
+  // BatchAsync.
+  void CompleteBatch() {
+    PendingBatch batch = std::move(batches.front());
+    batches.erase(batches.begin());
+    RemoteClientInterface::BatchAsync(RemoteCallContext::GetDefault(),
+                                      batch.request, batch.response,
+                                      std::move(batch.done));
+  }
+
+  struct PendingBatch {
+    const BatchRequest* request;
+    BatchResponse* response;
+    CallbackFn done;
+  };
+  std::vector<PendingBatch> batches;
+};
+
+class BatchingRemoteClientTest : public ::testing::Test {
+ protected:
+  void CreateClient(BatchingRemoteClient::Options options) {
+    auto fake = std::make_unique<FakeRemoteClient>();
+    fake_ = fake.get();
+    client_ = std::make_unique<BatchingRemoteClient>(std::move(fake), options);
+  }
+
+  // Calls RemoteExecute for `program_name`, and records its result.
+  void RemoteExecute(const std::string& program_name) {
+    auto call = std::make_unique<Call>();
+    call->request.set_program_name(program_name);
+    Call* call_ptr = call.get();
+    calls_.push_back(std::move(call));
+    client_->RemoteExecuteAsync(RemoteCallContext::GetDefault(),
+                                &call_ptr->request, &call_ptr->response,
+                                [call_ptr](Error e) {
+                                  call_ptr->done = true;
+                                  if (e) call_ptr->error = StrCat(e);
+                                });
+  }
+
+  struct Call {
+    RemoteExecuteRequest request;
+    RemoteExecuteResponse response;
+    bool done = false;
+    std::string error;
+  };
+
+  FakeRemoteClient* fake_;
+  std::unique_ptr<BatchingRemoteClient> client_;
+  std::vector<std::unique_ptr<Call>> calls_;
+};
+
+TEST_F(BatchingRemoteClientTest, BatchesRequestsWhileBatchesAreInFlight) {
+  BatchingRemoteClient::Options options;
+  options.max_inflight_batches = 1;
+  CreateClient(options);
+
+  // The first request is sent right away, the others wait for it.
+  RemoteExecute("a");
+  RemoteExecute("b");
+  RemoteExecute("c");
+  ASSERT_EQ(fake_->batches.size(), 1);
+  EXPECT_EQ(fake_->batches[0].request->requests_size(), 1);
+
+  fake_->CompleteBatch();
+  ASSERT_TRUE(calls_[0]->done);
+  EXPECT_EQ(calls_[0]->error, "");
+  ASSERT_EQ(calls_[0]->response.metadata_size(), 1);
+  EXPECT_EQ(calls_[0]->response.metadata(0), "a");
+  EXPECT_FALSE(calls_[1]->done);
+
+  ASSERT_EQ(fake_->batches.size(), 1);
+  EXPECT_EQ(fake_->batches[0].request->requests_size(), 2);
+  fake_->CompleteBatch();
+  ASSERT_TRUE(calls_[2]->done);
+  EXPECT_EQ(calls_[2]->response.metadata(0), "c");
+  EXPECT_TRUE(fake_->batches.empty());
+}
+
+TEST_F(BatchingRemoteClientTest, SendsFullBatches) {
+  BatchingRemoteClient::Options options;
+  options.max_batch_size = 2;
+  options.max_inflight_batches = 1;
+  CreateClient(options);
+
+  RemoteExecute("a");
+  RemoteExecute("b");
+  RemoteExecute("c");
+  ASSERT_EQ(fake_->batches.size(), 2);
+  EXPECT_EQ(fake_->batches[1].request->requests_size(), 2);
+
+  fake_->CompleteBatch();
+  fake_->CompleteBatch();
+  for (const auto& call : calls_) EXPECT_TRUE(call->done);
+}
+
+TEST_F(BatchingRemoteClientTest, ReportsErrorsPerRequest) {
+  BatchingRemoteClient::Options options;
+  options.max_inflight_batches = 1;
+  CreateClient(options);
+
+  RemoteExecute("a");
+  RemoteExecute("fail");
+  RemoteExecute("b");
+  fake_->CompleteBatch();
+  fake_->CompleteBatch();
+
+  EXPECT_EQ(calls_[1]->error, "failed");
+  EXPECT_EQ(calls_[2]->error, "");
+  EXPECT_EQ(calls_[2]->response.metadata(0), "b");
+}
+
+TEST_F(BatchingRemoteClientTest, ReportsBatchErrorsToAllRequests) {
+  BatchingRemoteClient::Options options;
+  options.max_inflight_batches = 1;
+  CreateClient(options);
+
+  RemoteExecute("a");
+  RemoteExecute("b");
+  RemoteExecute("c");
+  fake_->CompleteBatch();
+  auto batch = std::move(fake_->batches.front());
+  fake_->batches.clear();
+  batch.done(MakeStringError("network error"));
+
+  EXPECT_EQ(calls_[1]->error, "network error");
+  EXPECT_EQ(calls_[2]->error, "network error");
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for CompiledProgramCache.
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "tfrt/distributed_runtime/function_cache.h"
+
+namespace tfrt {
+namespace {
+
+std::shared_ptr<const CompiledProgramCache::CompiledProgram> MakeProgram(
+    size_t size) {
+  auto program = std::make_shared<CompiledProgramCache::CompiledProgram>();
+  program->bef_buffer.resize(size);
+  return program;
+}
+
+TEST(CompiledProgramCacheTest, FingerprintDependsOnContent) {
+  std::string fingerprint = CompiledProgramCache::Fingerprint("program");
+  EXPECT_EQ(fingerprint, CompiledProgramCache::Fingerprint("program"));
+  EXPECT_NE(fingerprint, CompiledProgramCache::Fingerprint("program2"));
+}
+
+TEST(CompiledProgramCacheTest, KeyDependsOnOptions) {
+  std::string fingerprint = CompiledProgramCache::Fingerprint("program");
+  std::string key = CompiledProgramCache::Key(fingerprint, false, false);
+  EXPECT_NE(key, CompiledProgramCache::Key(fingerprint, true, false));
+  EXPECT_NE(key, CompiledProgramCache::Key(fingerprint, false, true));
+}
+
+TEST(CompiledProgramCacheTest, LookupInserted) {
+  CompiledProgramCache cache(1024);
+  EXPECT_EQ(cache.Lookup("a"), nullptr);
+
+  auto program = MakeProgram(16);
+  cache.Insert("a", program);
+  EXPECT_EQ(cache.Lookup("a"), program);
+
+  // Inserting an existing key keeps the cached program.
+  cache.Insert("a", MakeProgram(16));
+  EXPECT_EQ(cache.Lookup("a"), program);
+}
+
+TEST(CompiledProgramCacheTest, EvictsOldest) {
+  CompiledProgramCache cache(100);
+  cache.Insert("a", MakeProgram(40));
+  cache.Insert("b", MakeProgram(40));
+  cache.Insert("c", MakeProgram(40));
+  EXPECT_EQ(cache.Lookup("a"), nullptr);
+  EXPECT_NE(cache.Lookup("b"), nullptr);
+  EXPECT_NE(cache.Lookup("c"), nullptr);
+
+  // Programs larger than the capacity are not cached.
+  cache.Insert("d", MakeProgram(101));
+  EXPECT_EQ(cache.Lookup("d"), nullptr);
+  EXPECT_NE(cache.Lookup("b"), nullptr);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -19,7 +19,10 @@
 #include "tfrt/distributed_runtime/distributed_context.h"
 
 #include <atomic>
+#include <future>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
@@ -27,6 +30,7 @@
 #include "tfrt/cpp_tests/test_util.h"
 #include "tfrt/distributed_runtime/callback_registry.h"
 #include "tfrt/distributed_runtime/fabric_communicator.h"
+#include "tfrt/distributed_runtime/local_fabric_communicator.h"
 #include "tfrt/distributed_runtime/proto/remote_message.pb.h"
 #include "tfrt/distributed_runtime/remote_client.h"
 #include "tfrt/distributed_runtime/server_context.h"
@@ -34,6 +38,7 @@
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/string_util.h"
 
 namespace tfrt {
 
@@ -185,5 +190,158 @@ TEST(DistributedContext, GetCollectiveGroup) {
   EXPECT_EQ(group1.members.size(), 3);
 }
 
+// Runs `fn` with a callback, and returns the error passed to it as a string.
+template <typename F>
+std::string AwaitError(F fn) {
+  std::promise<std::string> error;
+  fn([&](Error e) { error.set_value(e ? StrCat(e) : ""); });
+  return error.get_future().get();
+}
+
+TEST(DistributedContext, BroadcastRemoteReadyChains) {
+  // More tasks than kReadyChainsFanout, so that some tasks forward the chains.
+  constexpr int kNumTasks = 20;
+  std::string dist_config_str = "cluster_config { jobs { name: 'worker'";
+  for (int i = 0; i < kNumTasks; ++i) {
+    dist_config_str +=
+        StrCat(" tasks: { key: ", i, " value: 'broadcast_addr", i, "' }");
+  }
+  dist_config_str += " } } job_name: 'worker'";
+  DistributedContextConfiguration dist_config;
+  ASSERT_TRUE(::google::protobuf::TextFormat::ParseFromString(dist_config_str,
+                                                              &dist_config));
+
+  const uint64_t context_id = 0;
+  std::vector<std::unique_ptr<HostContext>> hosts;
+  std::vector<std::unique_ptr<ServerContext>> servers;
+  std::vector<DistributedContext*> dist_contexts;
+  for (int i = 0; i < kNumTasks; ++i) {
+    hosts.push_back(std::make_unique<HostContext>(
+        [](const DecodedDiagnostic&) {}, tfrt::CreateMallocAllocator(),
+        tfrt::CreateMultiThreadedWorkQueue(/*num_threads=*/2,
+                                           /*num_blocking_threads=*/2)));
+    servers.push_back(std::make_unique<ServerContext>(
+        hosts.back().get(),
+        ServerContextConfiguration{FabricCommunicatorConfiguration{
+            kLocalFabricCommunicatorType, StrCat("broadcast_addr", i)}}));
+    dist_config.set_task_id(i);
+    auto dist_context =
+        servers.back()->CreateDistributedContext(context_id, dist_config);
+    ASSERT_TRUE(!!dist_context);
+    dist_contexts.push_back(*dist_context);
+  }
+  for (DistributedContext* dist_context : dist_contexts) {
+    ASSERT_EQ(AwaitError([&](auto done) {
+                dist_context->GetRemoteDevices(std::move(done));
+              }),
+              "");
+  }
+
+  // Task 0 is the leader, and collects the ready chains of all tasks.
+  DistributedContext* leader = dist_contexts[0];
+  auto add_ready_chain = [&](int task, const RemoteObjectId& chain) {
+    RemoteObjectIdProto proto;
+    proto.set_prefix_id(chain.prefix_id);
+    proto.set_local_id(chain.local_id);
+    proto.set_device(chain.device->name().str());
+    return leader->AddReadyChain(leader->GetTaskHandle("worker", task), proto);
+  };
+  for (int i = 1; i < kNumTasks; ++i) {
+    ASSERT_FALSE(add_ready_chain(i, dist_contexts[i]->LocalReadyChain()));
+  }
+
+  auto expect_ready_chain = [&](int task, const RemoteObjectId& chain) {
+    for (int i = 0; i < kNumTasks; ++i) {
+      if (i == task) continue;
+      auto ready_chains = dist_contexts[i]->RemoteReadyChains();
+      auto it = ready_chains.find(dist_contexts[i]->GetTaskHandle("worker",
+                                                                  task));
+      ASSERT_NE(it, ready_chains.end());
+      EXPECT_EQ(it->second.prefix_id, chain.prefix_id);
+      EXPECT_EQ(it->second.local_id, chain.local_id);
+    }
+  };
+
+  ASSERT_EQ(AwaitError([&](auto done) {
+              leader->BroadcastRemoteReadyChains(std::move(done));
+            }),
+            "");
+  for (int i = 0; i < kNumTasks; ++i) {
+    expect_ready_chain(i, dist_contexts[i]->LocalReadyChain());
+  }
+
+  // A later broadcast sends the changed chain.
+  RemoteObjectId changed = dist_contexts[5]->LocalReadyChain();
+  changed.local_id += 100;
+  ASSERT_FALSE(add_ready_chain(5, changed));
+  ASSERT_EQ(AwaitError([&](auto done) {
+              leader->BroadcastRemoteReadyChains(std::move(done));
+            }),
+            "");
+  expect_ready_chain(5, changed);
+  expect_ready_chain(7, dist_contexts[7]->LocalReadyChain());
+}
+
+TEST(DistributedContext, CreateRemoteContexts) {
+  // More tasks than kCreateContextFanout, so that some tasks forward the
+  // requests.
+  constexpr int kNumTasks = 20;
+  std::string dist_config_str = "cluster_config { jobs { name: 'worker'";
+  for (int i = 0; i < kNumTasks; ++i) {
+    dist_config_str +=
+        StrCat(" tasks: { key: ", i, " value: 'create_addr", i, "' }");
+  }
+  dist_config_str += " } } job_name: 'worker' task_id: 0";
+  DistributedContextConfiguration dist_config;
+  ASSERT_TRUE(::google::protobuf::TextFormat::ParseFromString(dist_config_str,
+                                                              &dist_config));
+
+  std::vector<std::unique_ptr<HostContext>> hosts;
+  std::vector<std::unique_ptr<ServerContext>> servers;
+  for (int i = 0; i < kNumTasks; ++i) {
+    hosts.push_back(std::make_unique<HostContext>(
+        [](const DecodedDiagnostic&) {}, tfrt::CreateMallocAllocator(),
+        tfrt::CreateMultiThreadedWorkQueue(/*num_threads=*/2,
+                                           /*num_blocking_threads=*/2)));
+    servers.push_back(std::make_unique<ServerContext>(
+        hosts.back().get(),
+        ServerContextConfiguration{FabricCommunicatorConfiguration{
+            kLocalFabricCommunicatorType, StrCat("create_addr", i)}}));
+  }
+
+  // Task 0 is the single client.
+  const uint64_t context_id = 0;
+  auto expected = servers[0]->CreateDistributedContext(context_id, dist_config);
+  ASSERT_TRUE(!!expected);
+  DistributedContext* leader = *expected;
+  ASSERT_EQ(AwaitError([&](auto done) {
+              leader->GetRemoteDevices(std::move(done));
+            }),
+            "");
+  ASSERT_EQ(AwaitError([&](auto done) {
+              leader->CreateRemoteContexts(
+                  DistributedContext::RemoteInitMode::SINGLE_CLIENT,
+                  std::move(done));
+            }),
+            "");
+
+  auto ready_chains = leader->RemoteReadyChains();
+  for (int i = 1; i < kNumTasks; ++i) {
+    auto dist_context = servers[i]->GetDistributedContext(context_id);
+    ASSERT_TRUE(!!dist_context);
+    EXPECT_EQ((*dist_context)->GetTaskName(), StrCat("/job:worker/task:", i));
+    EXPECT_EQ(
+        (*dist_context)->GetRemoteDeviceManager()->ListDevices<Device>().size(),
+        leader->GetRemoteDeviceManager()->ListDevices<Device>().size());
+
+    // The ready chains of the forwarding tasks are sent back to the leader.
+    auto it = ready_chains.find(leader->GetTaskHandle("worker", i));
+    ASSERT_NE(it, ready_chains.end());
+    RemoteObjectId chain = (*dist_context)->LocalReadyChain();
+    EXPECT_EQ(it->second.prefix_id, chain.prefix_id);
+    EXPECT_EQ(it->second.local_id, chain.local_id);
+  }
+}
+
 }  // namespace
 }  // namespace tfrt
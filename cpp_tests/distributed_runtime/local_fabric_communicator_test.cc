@@ -0,0 +1,149 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for LocalFabricCommunicator.
+
+#include "tfrt/distributed_runtime/local_fabric_communicator.h"
+
+#include <cstring>
+#include <future>
+#include <memory>
+#include <string>
+
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+#include "tfrt/distributed_runtime/callback_registry.h"
+#include "tfrt/distributed_runtime/distributed_context.h"
+#include "tfrt/distributed_runtime/proto/remote_message.pb.h"
+#include "tfrt/distributed_runtime/remote_client.h"
+#include "tfrt/distributed_runtime/server_context.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace {
+
+constexpr uint64_t kContextId = 1;
+
+DistributedContextConfiguration GetDistributedConfiguration(int task_id) {
+  // Task 2 has no server.
+  const std::string dist_config_str =
+      "  cluster_config {"
+      "    jobs {"
+      "      name: 'worker'"
+      "      tasks: { key: 0 value: 'local_addr0' }"
+      "      tasks: { key: 1 value: 'local_addr1' }"
+      "      tasks: { key: 2 value: 'local_addr2' }"
+      "    }"
+      "  }"
+      "  job_name: 'worker'";
+  DistributedContextConfiguration config;
+  EXPECT_TRUE(::google::protobuf::TextFormat::ParseFromString(dist_config_str,
+                                                              &config));
+  config.set_task_id(task_id);
+  return config;
+}
+
+std::unique_ptr<HostContext> CreateMultiThreadedHostContext() {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(/*num_threads=*/2,
+                                   /*num_blocking_threads=*/2));
+}
+
+class LocalFabricCommunicatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (int i = 0; i < 2; ++i) {
+      hosts_[i] = CreateMultiThreadedHostContext();
+      ServerContextConfiguration server_config{FabricCommunicatorConfiguration{
+          kLocalFabricCommunicatorType, StrCat("local_addr", i)}};
+      servers_[i] =
+          std::make_unique<ServerContext>(hosts_[i].get(), server_config);
+      auto dist_ctx = servers_[i]->CreateDistributedContext(
+          kContextId, GetDistributedConfiguration(i));
+      ASSERT_TRUE(!!dist_ctx);
+      dist_ctxs_[i] = *dist_ctx;
+    }
+  }
+
+  RemoteClientInterface* GetClient(int task_id) {
+    return dist_ctxs_[0]->GetRemoteClient(
+        dist_ctxs_[0]->GetTaskHandle("worker", task_id));
+  }
+
+  std::unique_ptr<HostContext> hosts_[2];
+  std::unique_ptr<ServerContext> servers_[2];
+  DistributedContext* dist_ctxs_[2];
+};
+
+TEST_F(LocalFabricCommunicatorTest, GetDevices) {
+  GetDevicesRequest request;
+  GetDevicesResponse response;
+  std::promise<std::string> error;
+  GetClient(1)->GetDevicesAsync(
+      RemoteCallContext::GetDefault(), &request, &response,
+      [&](Error e) { error.set_value(e ? StrCat(e) : ""); });
+  EXPECT_EQ(error.get_future().get(), "");
+  EXPECT_EQ(response.devices_size(),
+            hosts_[1]->GetDeviceManager()->ListDevices<Device>().size());
+}
+
+TEST_F(LocalFabricCommunicatorTest, SendDataWithPayloadCopiesBuffers) {
+  std::promise<RCReference<HostBuffer>> received;
+  dist_ctxs_[1]->GetCallbackRegistry()->SetCallback(
+      "key", [&](const InstanceKey&, CallbackRegistry::CallbackValue value) {
+        ASSERT_EQ(value.buffers.size(), 1);
+        received.set_value(std::move(value.buffers[0]));
+      });
+
+  auto buffer = HostBuffer::CreateUninitialized(5, 1, hosts_[0]->allocator());
+  std::memcpy(buffer->data(), "hello", 5);
+  llvm::SmallVector<RCReference<HostBuffer>, 4> buffers;
+  buffers.push_back(buffer.CopyRef());
+
+  SendDataRequest request;
+  request.set_context_id(kContextId);
+  request.set_instance_key("key");
+  SendDataResponse response;
+  std::promise<std::string> error;
+  GetClient(1)->SendDataWithPayloadAsync(
+      RemoteCallContext::GetDefault(), &request, Payload(std::move(buffers)),
+      &response, [&](Error e) { error.set_value(e ? StrCat(e) : ""); });
+  EXPECT_EQ(error.get_future().get(), "");
+
+  // The sender may overwrite its buffer once the request is done.
+  std::memcpy(buffer->data(), "xxxxx", 5);
+  RCReference<HostBuffer> copy = received.get_future().get();
+  EXPECT_EQ(std::string(static_cast<const char*>(copy->data()), copy->size()),
+            "hello");
+}
+
+TEST_F(LocalFabricCommunicatorTest, NoServer) {
+  KeepAliveRequest request;
+  KeepAliveResponse response;
+  std::promise<std::string> error;
+  GetClient(2)->KeepAliveAsync(
+      RemoteCallContext::GetDefault(), &request, &response,
+      [&](Error e) { error.set_value(e ? StrCat(e) : ""); });
+  EXPECT_NE(error.get_future().get(), "");
+}
+
+}  // namespace
+}  // namespace tfrt
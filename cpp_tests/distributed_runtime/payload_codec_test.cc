@@ -0,0 +1,183 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for PayloadCodec.
+
+#include "tfrt/distributed_runtime/payload_codec.h"
+
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/host_buffer.h"
+
+namespace tfrt {
+namespace {
+
+class PayloadCodecTest : public ::testing::Test {
+ protected:
+  RCReference<HostBuffer> CreateBuffer(const void* data, size_t size) {
+    auto buffer = HostBuffer::CreateUninitialized(size, alignof(float),
+                                                  allocator_.get());
+    std::memcpy(buffer->data(), data, size);
+    return buffer;
+  }
+
+  Payload CreatePayload(const void* data, size_t size) {
+    llvm::SmallVector<RCReference<HostBuffer>, 4> buffers;
+    buffers.push_back(CreateBuffer(data, size));
+    return Payload(std::move(buffers));
+  }
+
+  std::unique_ptr<HostAllocator> allocator_ = CreateMallocAllocator();
+};
+
+string_view BufferString(const HostBuffer& buffer) {
+  return string_view(static_cast<const char*>(buffer.data()), buffer.size());
+}
+
+TEST_F(PayloadCodecTest, Disabled) {
+  PayloadCodec codec(PayloadCompressionConfiguration(), allocator_.get());
+  EXPECT_FALSE(codec.enabled());
+
+  std::string data(10000, 'a');
+  SendDataRequest request;
+  Payload payload =
+      codec.Encode(CreatePayload(data.data(), data.size()),
+                   PayloadCodec::PayloadKind::kBytes, &request);
+  EXPECT_FALSE(PayloadCodec::IsEncoded(request));
+  EXPECT_EQ(BufferString(*payload.buffers[0]), data);
+}
+
+TEST_F(PayloadCodecTest, Lz4RoundTrip) {
+  PayloadCompressionConfiguration config;
+  config.set_lz4(true);
+  PayloadCodec codec(config, allocator_.get());
+
+  std::string data;
+  for (int i = 0; i < 20000; ++i) data += std::to_string(i % 700);
+  SendDataRequest request;
+  Payload encoded =
+      codec.Encode(CreatePayload(data.data(), data.size()),
+                   PayloadCodec::PayloadKind::kBytes, &request);
+  ASSERT_EQ(request.payload_encoding_size(), 1);
+  EXPECT_EQ(request.payload_encoding(0), PAYLOAD_ENCODING_LZ4);
+  EXPECT_LT(encoded.buffers[0]->size(), data.size() / 4);
+
+  auto decoded = codec.Decode(request, std::move(encoded));
+  ASSERT_TRUE(!!decoded);
+  EXPECT_EQ(BufferString(*decoded->buffers[0]), data);
+}
+
+TEST_F(PayloadCodecTest, IncompressibleAndSmallBuffersAreNotEncoded) {
+  PayloadCompressionConfiguration config;
+  config.set_lz4(true);
+  PayloadCodec codec(config, allocator_.get());
+
+  std::string random(10000, 0);
+  uint32_t state = 1;
+  for (char& c : random) {
+    state = state * 1103515245 + 12345;
+    c = static_cast<char>(state >> 24);
+  }
+  std::string small(100, 'a');
+  SendDataRequest request;
+  Payload encoded =
+      codec.Encode(CreatePayload(random.data(), random.size()),
+                   PayloadCodec::PayloadKind::kBytes, &request);
+  encoded.buffers.push_back(CreateBuffer(small.data(), small.size()));
+  EXPECT_FALSE(PayloadCodec::IsEncoded(request));
+  EXPECT_EQ(BufferString(*encoded.buffers[0]), random);
+}
+
+TEST_F(PayloadCodecTest, Bf16OnlyAppliesToPartialSums) {
+  PayloadCompressionConfiguration config;
+  config.set_float_encoding(PayloadCompressionConfiguration::BF16);
+  PayloadCodec codec(config, allocator_.get());
+
+  std::vector<float> values(4096);
+  for (int i = 0; i < values.size(); ++i) values[i] = i * 0.25f - 100.0f;
+  const size_t size = values.size() * sizeof(float);
+
+  SendDataRequest bytes_request;
+  codec.Encode(CreatePayload(values.data(), size),
+               PayloadCodec::PayloadKind::kBytes, &bytes_request);
+  EXPECT_FALSE(PayloadCodec::IsEncoded(bytes_request));
+
+  SendDataRequest request;
+  Payload encoded =
+      codec.Encode(CreatePayload(values.data(), size),
+                   PayloadCodec::PayloadKind::kFloatPartialSums, &request);
+  ASSERT_EQ(request.payload_encoding_size(), 1);
+  EXPECT_EQ(request.payload_encoding(0), PAYLOAD_ENCODING_BF16);
+  EXPECT_EQ(encoded.buffers[0]->size(), size / 2);
+
+  auto decoded = codec.Decode(request, std::move(encoded));
+  ASSERT_TRUE(!!decoded);
+  ASSERT_EQ(decoded->buffers[0]->size(), size);
+  const float* result = static_cast<const float*>(decoded->buffers[0]->data());
+  for (int i = 0; i < values.size(); ++i)
+    EXPECT_NEAR(result[i], values[i], std::abs(values[i]) / 128);
+}
+
+TEST_F(PayloadCodecTest, TopKKeepsLargestValues) {
+  PayloadCompressionConfiguration config;
+  config.set_float_encoding(PayloadCompressionConfiguration::TOP_K);
+  config.set_top_k_fraction(0.1);
+  PayloadCodec codec(config, allocator_.get());
+
+  std::vector<float> values(2000);
+  for (int i = 0; i < values.size(); ++i)
+    values[i] = (i % 2 ? -1.0f : 1.0f) * ((i * 37) % 1000);
+  const size_t size = values.size() * sizeof(float);
+
+  SendDataRequest request;
+  Payload encoded =
+      codec.Encode(CreatePayload(values.data(), size),
+                   PayloadCodec::PayloadKind::kFloatPartialSums, &request);
+  ASSERT_EQ(request.payload_encoding_size(), 1);
+  EXPECT_EQ(request.payload_encoding(0), PAYLOAD_ENCODING_TOP_K);
+
+  auto decoded = codec.Decode(request, std::move(encoded));
+  ASSERT_TRUE(!!decoded);
+  ASSERT_EQ(decoded->buffers[0]->size(), size);
+  const float* result = static_cast<const float*>(decoded->buffers[0]->data());
+  int num_kept = 0;
+  for (int i = 0; i < values.size(); ++i) {
+    if (std::abs(values[i]) >= 900) {
+      EXPECT_EQ(result[i], values[i]);
+      ++num_kept;
+    } else {
+      EXPECT_EQ(result[i], 0.0f);
+    }
+  }
+  EXPECT_EQ(num_kept, 200);
+}
+
+TEST_F(PayloadCodecTest, MalformedPayload) {
+  PayloadCodec codec(PayloadCompressionConfiguration(), allocator_.get());
+  const char data[] = "\xff\xff\xff\xff\xff\xff\xff\x7f\x10";
+  SendDataRequest request;
+  request.add_payload_encoding(PAYLOAD_ENCODING_LZ4);
+  auto decoded = codec.Decode(request, CreatePayload(data, 9));
+  EXPECT_FALSE(!!decoded);
+  llvm::consumeError(decoded.takeError());
+}
+
+}  // namespace
+}  // namespace tfrt
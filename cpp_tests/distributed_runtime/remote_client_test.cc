@@ -0,0 +1,98 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for RemoteClientInterface.
+
+#include "tfrt/distributed_runtime/remote_client.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/distributed_runtime/payload.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace {
+
+// Records the SendData requests, and fails all other calls.
+class FakeRemoteClient : public RemoteClientInterface {
+ public:
+#define FAKE_CLIENT_METHOD(method)                                          \
+  void method##Async(RemoteCallContext* call_ctx,                           \
+                     const method##Request* request,                        \
+                     method##Response* response, CallbackFn done) override { \
+    done(MakeStringError("unexpected call"));                               \
+  }
+
+  FAKE_CLIENT_METHOD(GetDevices);
+  FAKE_CLIENT_METHOD(CreateContext);
+  FAKE_CLIENT_METHOD(CloseContext);
+  FAKE_CLIENT_METHOD(SendReadyChains);
+  FAKE_CLIENT_METHOD(RegisterFunction);
+  FAKE_CLIENT_METHOD(RemoteExecute);
+  FAKE_CLIENT_METHOD(RemoteExecuteOp);
+  FAKE_CLIENT_METHOD(DeleteRemoteObjects);
+  FAKE_CLIENT_METHOD(KeepAlive);
+
+#undef FAKE_CLIENT_METHOD
+
+  void SendDataAsync(RemoteCallContext* call_ctx,
+                     const SendDataRequest* request,
+                     SendDataResponse* response, CallbackFn done) override {
+    sent.push_back(*request);
+    done(Error::success());
+  }
+
+  std::vector<SendDataRequest> sent;
+};
+
+RCReference<HostBuffer> CreateTestBuffer(const std::string& data) {
+  auto* copy = new std::string(data);
+  return HostBuffer::CreateFromExternal(
+      &(*copy)[0], copy->size(), [copy](void*, size_t) { delete copy; });
+}
+
+TEST(RemoteClientTest, SendDataWithPayloadCopiesPayloadByDefault) {
+  FakeRemoteClient client;
+  llvm::SmallVector<RCReference<HostBuffer>, 4> buffers;
+  buffers.push_back(CreateTestBuffer("metadata"));
+  buffers.push_back(CreateTestBuffer("tensor data"));
+
+  SendDataRequest request;
+  request.set_instance_key("key");
+  SendDataResponse response;
+  bool done = false;
+  client.SendDataWithPayloadAsync(RemoteCallContext::GetDefault(), &request,
+                                  Payload(std::move(buffers)), &response,
+                                  [&done](Error e) {
+                                    EXPECT_FALSE(e);
+                                    done = true;
+                                  });
+
+  EXPECT_TRUE(done);
+  ASSERT_EQ(client.sent.size(), 1);
+  EXPECT_EQ(client.sent[0].instance_key(), "key");
+  ASSERT_EQ(client.sent[0].payload_size(), 2);
+  EXPECT_EQ(client.sent[0].payload(0), "metadata");
+  EXPECT_EQ(client.sent[0].payload(1), "tensor data");
+}
+
+}  // namespace
+}  // namespace tfrt
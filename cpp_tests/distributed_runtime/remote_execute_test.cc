@@ -0,0 +1,91 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for the RemoteExecute helpers.
+
+#include "tfrt/distributed_runtime/remote_execute.h"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+class RemoteExecuteTest : public ::testing::Test {
+ protected:
+  DenseHostTensor CreateTensor(ArrayRef<int64_t> dims) {
+    auto tensor = DenseHostTensor::CreateUninitialized<int32_t>(
+        TensorShape(dims), host_.get());
+    auto values = MutableDHTArrayView<int32_t>(tensor.getPointer());
+    for (int i = 0; i < values.NumElements(); ++i) values[i] = i;
+    return std::move(*tensor);
+  }
+
+  std::unique_ptr<HostContext> host_ = CreateHostContext();
+};
+
+TEST_F(RemoteExecuteTest, CanInlineTensor) {
+  DenseHostTensor tensor = CreateTensor({4});
+  EXPECT_TRUE(CanInlineTensor(tensor, 16));
+  EXPECT_FALSE(CanInlineTensor(tensor, 15));
+  // Zero disables inlining.
+  EXPECT_FALSE(CanInlineTensor(CreateTensor({0}), 0));
+}
+
+TEST_F(RemoteExecuteTest, RoundTrip) {
+  DenseHostTensor tensor = CreateTensor({2, 3});
+  InlineTensorProto proto;
+  SerializeInlineTensor(tensor, &proto);
+
+  auto result = DeserializeInlineTensor(proto, host_.get());
+  ASSERT_TRUE(!!result);
+  EXPECT_EQ(result->metadata(), tensor.metadata());
+  auto values = DHTArrayView<int32_t>(&*result);
+  for (int i = 0; i < values.NumElements(); ++i) EXPECT_EQ(values[i], i);
+}
+
+TEST_F(RemoteExecuteTest, TakeInlineTensor) {
+  DenseHostTensor tensor = CreateTensor({64});
+  InlineTensorProto proto;
+  SerializeInlineTensor(tensor, &proto);
+  const char* data = proto.data().data();
+
+  auto result = TakeInlineTensor(&proto, host_.get());
+  ASSERT_TRUE(!!result);
+  EXPECT_EQ(result->metadata(), tensor.metadata());
+  // The heap allocation of the data is aligned, so it is not copied.
+  EXPECT_EQ(result->data(), data);
+  EXPECT_TRUE(proto.data().empty());
+  auto values = DHTArrayView<int32_t>(&*result);
+  for (int i = 0; i < values.NumElements(); ++i) EXPECT_EQ(values[i], i);
+}
+
+TEST_F(RemoteExecuteTest, SizeMismatch) {
+  InlineTensorProto proto;
+  SerializeInlineTensor(CreateTensor({4}), &proto);
+  proto.mutable_data()->resize(8);
+
+  auto result = DeserializeInlineTensor(proto, host_.get());
+  EXPECT_FALSE(!!result);
+  llvm::consumeError(result.takeError());
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for RemoteIterator.
+
+#include "tfrt/distributed_runtime/remote_iterator.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/distributed_runtime/remote_client.h"
+#include "tfrt/distributed_runtime/remote_execute.h"
+#include "tfrt/distributed_runtime/remote_object_manager.h"
+#include "tfrt/host_context/device.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+namespace {
+
+// Records the RemoteExecute calls, which complete when the test calls
+// Complete(), and the deleted remote objects. All other calls fail.
+class FakeRemoteClient : public RemoteClientInterface {
+ public:
+#define FAKE_CLIENT_METHOD(method)                                          \
+  void method##Async(RemoteCallContext* call_ctx,                           \
+                     const method##Request* request,                        \
+                     method##Response* response, CallbackFn done) override { \
+    done(MakeStringError("unexpected call"));                               \
+  }
+
+  FAKE_CLIENT_METHOD(GetDevices);
+  FAKE_CLIENT_METHOD(CreateContext);
+  FAKE_CLIENT_METHOD(CloseContext);
+  FAKE_CLIENT_METHOD(SendReadyChains);
+  FAKE_CLIENT_METHOD(SendData);
+  FAKE_CLIENT_METHOD(RegisterFunction);
+  FAKE_CLIENT_METHOD(RemoteExecuteOp);
+  FAKE_CLIENT_METHOD(KeepAlive);
+
+#undef FAKE_CLIENT_METHOD
+
+  void RemoteExecuteAsync(RemoteCallContext* call_ctx,
+                          const RemoteExecuteRequest* request,
+                          RemoteExecuteResponse* response,
+                          CallbackFn done) override {
+    calls.push_back({*request, response, std::move(done)});
+  }
+
+  void DeleteRemoteObjectsAsync(RemoteCallContext* call_ctx,
+                                const DeleteRemoteObjectsRequest* request,
+                                DeleteRemoteObjectsResponse* response,
+                                CallbackFn done) override {
+    for (const auto& id : request->input()) deleted.push_back(id.local_id());
+    done(Error::success());
+  }
+
+  // Completes call `index`, whose outputs after the chain are `values`.
+  void Complete(int index, ArrayRef<const DenseHostTensor*> values) {
+    for (size_t i = 0; i < values.size(); ++i) {
+      auto* inline_output = calls[index].response->add_inline_output();
+      inline_output->set_index(i + 1);
+      SerializeInlineTensor(*values[i], inline_output);
+    }
+    CallbackFn done = std::move(calls[index].done);
+    done(Error::success());
+  }
+
+  void Fail(int index, string_view message) {
+    CallbackFn done = std::move(calls[index].done);
+    done(MakeStringError(message));
+  }
+
+  struct Call {
+    RemoteExecuteRequest request;
+    RemoteExecuteResponse* response;
+    CallbackFn done;
+  };
+  std::vector<Call> calls;
+  std::vector<uint64_t> deleted;
+};
+
+class RemoteIteratorTest : public ::testing::Test {
+ protected:
+  RCReference<data::Iterator> MakeIterator(int prefetch_num) {
+    return TakeRef(host_->Construct<RemoteIterator>(
+        &client_, &manager_, /*context_id=*/1, "get_next", chain_id_,
+        iterator_id_, /*num_values=*/1, prefetch_num, host_.get()));
+  }
+
+  DenseHostTensor CreateTensor(int32_t value) {
+    auto tensor = DenseHostTensor::CreateUninitialized<int32_t>(
+        TensorShape(ArrayRef<int64_t>{64}), host_.get());
+    MutableDHTArrayView<int32_t>(tensor.getPointer()).Fill(value);
+    return std::move(*tensor);
+  }
+
+  std::unique_ptr<HostContext> host_ = CreateHostContext();
+  ExecutionContext exec_ctx_{std::move(
+      *RequestContextBuilder(host_.get(), /*resource_context=*/nullptr)
+           .build())};
+  RCReference<Device> device_ = MakeRef<CpuDevice>("cpu");
+  RemoteObjectManager manager_{TaskHandle(1), host_.get()};
+  RemoteObjectId chain_id_ = manager_.AllocateRemoteObject(device_.CopyRef());
+  RemoteObjectId iterator_id_ =
+      manager_.AllocateRemoteObject(device_.CopyRef());
+  FakeRemoteClient client_;
+};
+
+TEST_F(RemoteIteratorTest, PrefetchesInOrder) {
+  auto iterator = MakeIterator(/*prefetch_num=*/2);
+
+  auto first = iterator->GetNext(exec_ctx_);
+  // The first request and two prefetched ones are in flight.
+  ASSERT_EQ(client_.calls.size(), 3);
+  uint64_t chain = chain_id_.local_id;
+  for (const auto& call : client_.calls) {
+    const RemoteExecuteRequest* request = &call.request;
+    EXPECT_EQ(request->program_name(), "get_next");
+    ASSERT_EQ(request->input_size(), 2);
+    EXPECT_EQ(request->input(0).local_id(), chain);
+    EXPECT_EQ(request->input(1).local_id(), iterator_id_.local_id);
+    ASSERT_EQ(request->output_size(), 2);
+    EXPECT_TRUE(request->output(1).value_only());
+    chain = request->output(0).id().local_id();
+  }
+  EXPECT_FALSE(first.eof.IsAvailable());
+
+  DenseHostTensor tensor = CreateTensor(42);
+  client_.Complete(0, {&tensor});
+  ASSERT_TRUE(first.eof.IsConcrete());
+  EXPECT_FALSE(first.eof.get());
+  const auto& value = first.values[0]->get<DenseHostTensor>();
+  EXPECT_EQ(DHTArrayView<int32_t>(&value)[0], 42);
+
+  // The chain consumed by the completed request is released by the next one.
+  auto second = iterator->GetNext(exec_ctx_);
+  ASSERT_EQ(client_.calls.size(), 4);
+  ASSERT_EQ(client_.calls[3].request.release_size(), 1);
+  EXPECT_EQ(client_.calls[3].request.release(0).local_id(),
+            chain_id_.local_id);
+
+  client_.Complete(1, {&tensor});
+  client_.Complete(2, {&tensor});
+  client_.Complete(3, {&tensor});
+}
+
+TEST_F(RemoteIteratorTest, EndOfIteration) {
+  auto iterator = MakeIterator(/*prefetch_num=*/1);
+
+  auto first = iterator->GetNext(exec_ctx_);
+  ASSERT_EQ(client_.calls.size(), 2);
+  DenseHostTensor tensor = CreateTensor(1);
+  client_.Complete(0, {&tensor});
+  client_.Fail(1, "iterator reached end");
+
+  auto second = iterator->GetNext(exec_ctx_);
+  ASSERT_TRUE(second.eof.IsConcrete());
+  EXPECT_TRUE(second.eof.get());
+  EXPECT_TRUE(second.values[0]->IsError());
+
+  // No more requests are sent after the end.
+  auto third = iterator->GetNext(exec_ctx_);
+  EXPECT_EQ(client_.calls.size(), 2);
+  ASSERT_TRUE(third.eof.IsConcrete());
+  EXPECT_TRUE(third.eof.get());
+}
+
+TEST_F(RemoteIteratorTest, Error) {
+  auto iterator = MakeIterator(/*prefetch_num=*/0);
+
+  auto first = iterator->GetNext(exec_ctx_);
+  ASSERT_EQ(client_.calls.size(), 1);
+  client_.Fail(0, "failed");
+  EXPECT_TRUE(first.eof.IsError());
+  EXPECT_TRUE(first.values[0]->IsError());
+}
+
+TEST_F(RemoteIteratorTest, DeletesRemoteObjects) {
+  auto iterator = MakeIterator(/*prefetch_num=*/0);
+  auto first = iterator->GetNext(exec_ctx_);
+  DenseHostTensor tensor = CreateTensor(1);
+  client_.Complete(0, {&tensor});
+  const uint64_t last_chain =
+      client_.calls[0].request.output(0).id().local_id();
+
+  iterator.reset();
+  EXPECT_EQ(client_.deleted,
+            (std::vector<uint64_t>{iterator_id_.local_id, last_chain,
+                                   chain_id_.local_id}));
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for RemoteObjectManager.
+
+#include "tfrt/distributed_runtime/remote_object_manager.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/device.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace {
+
+class RemoteObjectManagerTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<HostContext> host_ = CreateHostContext();
+  RCReference<Device> device_ = MakeRef<CpuDevice>("cpu");
+  RemoteObjectManager manager_{TaskHandle(1), host_.get()};
+};
+
+TEST_F(RemoteObjectManagerTest, GetBeforeSet) {
+  RemoteObjectId id = manager_.AllocateRemoteObject(device_.CopyRef());
+  RCReference<AsyncValue> value = manager_.GetRemoteObject(id);
+  EXPECT_FALSE(value->IsAvailable());
+
+  manager_.SetRemoteObject(id, MakeAvailableAsyncValueRef<int>(host_.get(), 42)
+                                   .ReleaseRCRef());
+  ASSERT_TRUE(value->IsAvailable());
+  EXPECT_EQ(value->get<int>(), 42);
+  EXPECT_EQ(manager_.GetRemoteObject(id)->get<int>(), 42);
+}
+
+TEST_F(RemoteObjectManagerTest, BatchedSetGetDelete) {
+  constexpr int kNumObjects = 100;
+  llvm::SmallVector<RemoteObjectId, 4> ids;
+  llvm::SmallVector<RCReference<AsyncValue>, 4> values;
+  for (int i = 0; i < kNumObjects; ++i) {
+    ids.push_back(manager_.AllocateRemoteObject(device_.CopyRef()));
+    values.push_back(
+        MakeAvailableAsyncValueRef<int>(host_.get(), i).ReleaseRCRef());
+  }
+  manager_.SetRemoteObjects(ids, values);
+
+  // Objects are appended in the order of the ids.
+  llvm::SmallVector<RCReference<AsyncValue>, 4> results;
+  results.push_back(values[0].CopyRef());
+  manager_.GetRemoteObjects(llvm::makeArrayRef(ids).drop_front(), &results);
+  ASSERT_EQ(results.size(), kNumObjects);
+  for (int i = 0; i < kNumObjects; ++i) {
+    ASSERT_TRUE(results[i]->IsAvailable());
+    EXPECT_EQ(results[i]->get<int>(), i);
+  }
+
+  EXPECT_FALSE(manager_.DeleteRemoteObjects(ids));
+  Error error = manager_.DeleteRemoteObjects(ids);
+  EXPECT_TRUE(!!error);
+  llvm::consumeError(std::move(error));
+}
+
+TEST_F(RemoteObjectManagerTest, ConcurrentAccess) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumObjects = 1000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([this, t] {
+      for (int i = 0; i < kNumObjects; ++i) {
+        RemoteObjectId id(/*prefix_id=*/2, t * kNumObjects + i,
+                          device_.CopyRef());
+        // Consumers and producers race on the same ids.
+        if (i % 2 == 0) manager_.GetRemoteObject(id);
+        manager_.SetRemoteObject(
+            id, MakeAvailableAsyncValueRef<int>(host_.get(), i).ReleaseRCRef());
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (int t = 0; t < kNumThreads; ++t) {
+    for (int i = 0; i < kNumObjects; ++i) {
+      RemoteObjectId id(/*prefix_id=*/2, t * kNumObjects + i,
+                        device_.CopyRef());
+      RCReference<AsyncValue> value = manager_.GetRemoteObject(id);
+      ASSERT_TRUE(value->IsAvailable());
+      EXPECT_EQ(value->get<int>(), i);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace tfrt
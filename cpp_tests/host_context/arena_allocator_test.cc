@@ -0,0 +1,171 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit tests for TFRT ArenaAllocator.
+
+#include "tfrt/host_context/arena_allocator.h"
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/profiled_allocator.h"
+
+namespace tfrt {
+namespace {
+
+constexpr size_t kTestChunkSize = 1024;
+
+class ArenaAllocatorTest : public ::testing::Test {
+ protected:
+  ArenaAllocatorTest()
+      : fallback_allocator_(CreateLeakCheckAllocator(CreateMallocAllocator())),
+        arena_(TakeRef(
+            new ArenaAllocator(fallback_allocator_.get(), kTestChunkSize))) {}
+
+  std::unique_ptr<HostAllocator> fallback_allocator_;
+  RCReference<ArenaAllocator> arena_;
+};
+
+TEST_F(ArenaAllocatorTest, AllocateWithAlignment) {
+  std::vector<std::pair<void*, size_t>> allocations;
+  for (size_t alignment : {1, 2, 4, 8, 16, 32, 64, 128}) {
+    void* ptr = arena_->AllocateBytes(3, alignment);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignment, 0);
+    memset(ptr, 0, 3);
+    allocations.push_back({ptr, 3});
+  }
+  EXPECT_EQ(arena_->NumChunks(), 1);
+  for (auto& allocation : allocations)
+    arena_->DeallocateBytes(allocation.first, allocation.second);
+}
+
+TEST_F(ArenaAllocatorTest, BumpPointer) {
+  char* first = static_cast<char*>(arena_->AllocateBytes(16, 16));
+  char* second = static_cast<char*>(arena_->AllocateBytes(16, 16));
+  EXPECT_EQ(first + 16, second);
+
+  char* third = static_cast<char*>(arena_->AllocateBytes(16, 16));
+  EXPECT_EQ(second + 16, third);
+
+  arena_->DeallocateBytes(first, 16);
+  arena_->DeallocateBytes(second, 16);
+  arena_->DeallocateBytes(third, 16);
+}
+
+TEST_F(ArenaAllocatorTest, SizeClasses) {
+  EXPECT_EQ(ArenaAllocator::SizeClass(1), 16);
+  EXPECT_EQ(ArenaAllocator::SizeClass(16), 16);
+  EXPECT_EQ(ArenaAllocator::SizeClass(17), 18);
+  EXPECT_EQ(ArenaAllocator::SizeClass(100), 104);
+  EXPECT_EQ(ArenaAllocator::SizeClass(1024), 1024);
+  EXPECT_EQ(ArenaAllocator::SizeClass(1025), 1152);
+}
+
+TEST_F(ArenaAllocatorTest, RecyclesDeallocatedMemory) {
+  char* first = static_cast<char*>(arena_->AllocateBytes(100, 8));
+  char* second = static_cast<char*>(arena_->AllocateBytes(100, 8));
+  arena_->DeallocateBytes(first, 100);
+
+  // Allocations of the same size class reuse the deallocated memory.
+  char* third = static_cast<char*>(arena_->AllocateBytes(97, 8));
+  EXPECT_EQ(third, first);
+
+  // Other size classes do not.
+  char* fourth = static_cast<char*>(arena_->AllocateBytes(50, 8));
+  arena_->DeallocateBytes(second, 100);
+  char* fifth = static_cast<char*>(arena_->AllocateBytes(50, 8));
+  EXPECT_NE(fifth, second);
+  EXPECT_NE(fifth, fourth);
+
+  // Blocks are only reused if they have the requested alignment.
+  arena_->DeallocateBytes(fifth, 50);
+  char* sixth = static_cast<char*>(arena_->AllocateBytes(50, 128));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(sixth) % 128, 0);
+
+  EXPECT_EQ(arena_->NumChunks(), 1);
+  arena_->DeallocateBytes(third, 97);
+  arena_->DeallocateBytes(fourth, 50);
+  arena_->DeallocateBytes(sixth, 50);
+  EXPECT_TRUE(arena_->IsUnique());
+}
+
+TEST_F(ArenaAllocatorTest, NewChunk) {
+  std::vector<void*> allocations;
+  for (int i = 0; i < 8; ++i) {
+    allocations.push_back(arena_->AllocateBytes(kTestChunkSize / 4, 8));
+    ASSERT_NE(allocations.back(), nullptr);
+  }
+  EXPECT_EQ(arena_->NumChunks(), 2);
+  for (void* ptr : allocations)
+    arena_->DeallocateBytes(ptr, kTestChunkSize / 4);
+}
+
+TEST_F(ArenaAllocatorTest, LargeAllocationFallsBack) {
+  void* ptr = arena_->AllocateBytes(kTestChunkSize, 8);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(arena_->NumChunks(), 0);
+  EXPECT_EQ(arena_->NumRef(), 2);
+  arena_->DeallocateBytes(ptr, kTestChunkSize);
+
+  // Large allocations are recycled too, and freed with the arena.
+  EXPECT_EQ(arena_->AllocateBytes(kTestChunkSize - 1, 8), ptr);
+  arena_->DeallocateBytes(ptr, kTestChunkSize - 1);
+  EXPECT_TRUE(arena_->IsUnique());
+}
+
+TEST_F(ArenaAllocatorTest, AllocationOutlivesOwner) {
+  ArenaAllocator* arena = arena_.get();
+  char* ptr = static_cast<char*>(arena->AllocateBytes(8, 8));
+  EXPECT_EQ(arena->NumRef(), 2);
+
+  // The allocation keeps the arena alive.
+  arena_.reset();
+  memset(ptr, 0, 8);
+  arena->DeallocateBytes(ptr, 8);
+}
+
+TEST_F(ArenaAllocatorTest, ConcurrentAllocations) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumAllocations = 1000;
+
+  std::vector<std::vector<int64_t*>> allocations(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i]() {
+      for (int j = 0; j < kNumAllocations; ++j) {
+        auto* ptr = arena_->Allocate<int64_t>();
+        *ptr = i * kNumAllocations + j;
+        allocations[i].push_back(ptr);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (int i = 0; i < kNumThreads; ++i) {
+    for (int j = 0; j < kNumAllocations; ++j) {
+      EXPECT_EQ(*allocations[i][j], i * kNumAllocations + j);
+      arena_->Deallocate(allocations[i][j]);
+    }
+  }
+  EXPECT_TRUE(arena_->IsUnique());
+}
+
+}  // namespace
+}  // namespace tfrt
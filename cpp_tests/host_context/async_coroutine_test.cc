@@ -0,0 +1,170 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for TFRT AsyncTask coroutines.
+
+#include "tfrt/host_context/async_coroutine.h"
+
+#include "gtest/gtest.h"
+
+#if defined(TFRT_HAS_COROUTINES)
+
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext() {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {},
+      CreateMemoryUsageTrackingAllocator(CreateMallocAllocator(),
+                                         /*bytes_limit=*/0),
+      CreateSingleThreadedWorkQueue());
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  return ExecutionContext(
+      llvm::cantFail(RequestContextBuilder(host, nullptr).build()));
+}
+
+size_t GetBytesInUse(HostContext* host) {
+  return host->allocator()->GetMemoryUsage()->bytes_in_use;
+}
+
+AsyncTask<int> AddAsync(const ExecutionContext& exec_ctx, AsyncValueRef<int> a,
+                        AsyncValueRef<int> b) {
+  int sum = co_await a;
+  sum += co_await b;
+  if (sum < 0) co_return MakeStringError("negative sum");
+  co_return sum;
+}
+
+TEST(AsyncCoroutineTest, CompletesSynchronously) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+  AsyncValueRef<int> sum =
+      AddAsync(exec_ctx, MakeAvailableAsyncValueRef<int>(1),
+               MakeAvailableAsyncValueRef<int>(2));
+  ASSERT_TRUE(sum.IsConcrete());
+  EXPECT_EQ(*sum, 3);
+}
+
+TEST(AsyncCoroutineTest, AwaitsUnavailableValues) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+  auto a = MakeUnconstructedAsyncValueRef<int>();
+  auto b = MakeUnconstructedAsyncValueRef<int>();
+  AsyncValueRef<int> sum = AddAsync(exec_ctx, a.CopyRef(), b.CopyRef());
+  EXPECT_FALSE(sum.IsAvailable());
+
+  a.emplace(1);
+  EXPECT_FALSE(sum.IsAvailable());
+  b.emplace(2);
+  ASSERT_TRUE(sum.IsConcrete());
+  EXPECT_EQ(*sum, 3);
+}
+
+TEST(AsyncCoroutineTest, ReturnsError) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+  AsyncValueRef<int> sum =
+      AddAsync(exec_ctx, MakeAvailableAsyncValueRef<int>(1),
+               MakeAvailableAsyncValueRef<int>(-2));
+  ASSERT_TRUE(sum.IsError());
+  EXPECT_EQ(sum.GetError().message, "negative sum");
+}
+
+TEST(AsyncCoroutineTest, PropagatesAwaitedError) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+  auto a = MakeUnconstructedAsyncValueRef<int>();
+  bool resumed = false;
+  auto coroutine = [&](const ExecutionContext& exec_ctx,
+                       AsyncValueRef<int> value) -> AsyncTask<int> {
+    int result = co_await value;
+    resumed = true;
+    co_return result;
+  };
+  AsyncValueRef<int> result = coroutine(exec_ctx, a.CopyRef());
+  EXPECT_GT(GetBytesInUse(host.get()), 0);
+
+  a.SetError("failed");
+  ASSERT_TRUE(result.IsError());
+  EXPECT_EQ(result.GetError().message, "failed");
+  EXPECT_FALSE(resumed);
+  // The destroyed frame is returned to the HostAllocator.
+  EXPECT_EQ(GetBytesInUse(host.get()), 0);
+}
+
+TEST(AsyncCoroutineTest, AllocatesFrameFromHostAllocator) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+  auto b = MakeUnconstructedAsyncValueRef<int>();
+  AsyncValueRef<int> sum =
+      AddAsync(exec_ctx, MakeAvailableAsyncValueRef<int>(1), b.CopyRef());
+  EXPECT_GT(GetBytesInUse(host.get()), 0);
+
+  b.emplace(2);
+  EXPECT_EQ(*sum, 3);
+  EXPECT_EQ(GetBytesInUse(host.get()), 0);
+}
+
+TEST(AsyncCoroutineTest, AwaitsTasksAndChains) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+  auto a = MakeUnconstructedAsyncValueRef<int>();
+  auto chain = MakeUnconstructedAsyncValueRef<Chain>();
+  auto coroutine = [](const ExecutionContext& exec_ctx, AsyncValueRef<int> a,
+                      RCReference<AsyncValue> chain) -> AsyncTask<int> {
+    co_await chain;
+    int sum = co_await AddAsync(exec_ctx, std::move(a),
+                                MakeAvailableAsyncValueRef<int>(2));
+    co_return sum * 10;
+  };
+  AsyncValueRef<int> result =
+      coroutine(exec_ctx, a.CopyRef(), chain.CopyRCRef());
+
+  a.emplace(1);
+  EXPECT_FALSE(result.IsAvailable());
+  chain.emplace();
+  ASSERT_TRUE(result.IsConcrete());
+  EXPECT_EQ(*result, 30);
+}
+
+TEST(AsyncCoroutineTest, ResumesOnWorkQueue) {
+  auto host = CreateTestHostContext();
+  auto exec_ctx = CreateExecutionContext(host.get());
+  auto coroutine = [](const ExecutionContext& exec_ctx) -> AsyncTask<Chain> {
+    co_await ResumeOnWorkQueue(exec_ctx);
+    co_return Chain();
+  };
+  AsyncValueRef<Chain> done = coroutine(exec_ctx);
+  EXPECT_FALSE(done.IsAvailable());
+
+  host->Quiesce();
+  EXPECT_TRUE(done.IsConcrete());
+}
+
+}  // namespace
+}  // namespace tfrt
+
+#endif  // TFRT_HAS_COROUTINES
@@ -0,0 +1,191 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file contains unit tests for RunWhenReady and WhenAllReady.
+
+#include "tfrt/host_context/async_dispatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+
+namespace tfrt {
+namespace {
+
+class AsyncDispatchTest : public ::testing::Test {
+ protected:
+  AsyncDispatchTest() { host_context_ = CreateHostContext(); }
+
+  std::unique_ptr<HostContext> host_context_;
+};
+
+TEST_F(AsyncDispatchTest, RunWhenReady) {
+  auto first = MakeUnconstructedAsyncValueRef<int32_t>(host_context_.get());
+  auto second = MakeUnconstructedAsyncValueRef<int32_t>(host_context_.get());
+  auto third = MakeAvailableAsyncValueRef<int32_t>(host_context_.get(), 3);
+
+  int result = 0;
+  RunWhenReady({first.GetAsyncValue(), second.GetAsyncValue(),
+                third.GetAsyncValue()},
+               [&] { result = first.get() + second.get() + third.get(); });
+  first.emplace(1);
+  EXPECT_EQ(result, 0);
+  second.emplace(2);
+  EXPECT_EQ(result, 6);
+}
+
+TEST_F(AsyncDispatchTest, WhenAllReadyAvailable) {
+  auto value = MakeAvailableAsyncValueRef<int32_t>(host_context_.get(), 1);
+  auto chain = WhenAllReady(host_context_.get(), {value.GetAsyncValue()});
+  EXPECT_TRUE(chain.IsConcrete());
+
+  auto empty = WhenAllReady(host_context_.get(), ArrayRef<AsyncValue*>());
+  EXPECT_TRUE(empty.IsConcrete());
+}
+
+TEST_F(AsyncDispatchTest, WhenAllReady) {
+  std::vector<AsyncValueRef<int32_t>> values;
+  std::vector<AsyncValue*> value_ptrs;
+  for (int i = 0; i < 32; ++i) {
+    values.push_back(
+        MakeUnconstructedAsyncValueRef<int32_t>(host_context_.get()));
+    value_ptrs.push_back(values.back().GetAsyncValue());
+  }
+
+  auto chain = WhenAllReady(host_context_.get(), value_ptrs);
+  for (int i = 0; i < 32; ++i) {
+    EXPECT_FALSE(chain.IsAvailable());
+    if (i % 2 == 0) {
+      values[i].emplace(i);
+    } else {
+      values[i].SetError("error");
+    }
+  }
+
+  // Errors of the values are not propagated to the chain.
+  EXPECT_TRUE(chain.IsConcrete());
+}
+
+TEST_F(AsyncDispatchTest, EnqueueWorkBatch) {
+  ExecutionContext exec_ctx(
+      std::move(*RequestContextBuilder(host_context_.get(), nullptr).build()));
+  constexpr int kNumClosures = 1000;
+
+  // With a zero time budget the batch is split after every closure, and each
+  // closure still runs exactly once.
+  std::vector<std::atomic<int>> counts(kNumClosures);
+  std::vector<llvm::unique_function<void()>> work;
+  for (int i = 0; i < kNumClosures; ++i) work.push_back([&, i] { ++counts[i]; });
+  EnqueueWorkBatch(exec_ctx, std::move(work), std::chrono::nanoseconds(0));
+  host_context_->Quiesce();
+  for (auto& count : counts) EXPECT_EQ(count.load(), 1);
+
+  // Within the time budget, all closures run in order in a single task.
+  work.clear();
+  std::vector<int> order;
+  std::vector<std::thread::id> threads;
+  for (int i = 0; i < kNumClosures; ++i) {
+    work.push_back([&, i] {
+      order.push_back(i);
+      threads.push_back(std::this_thread::get_id());
+    });
+  }
+  EnqueueWorkBatch(exec_ctx, std::move(work), std::chrono::hours(1));
+  host_context_->Quiesce();
+  ASSERT_EQ(order.size(), kNumClosures);
+  for (int i = 0; i < kNumClosures; ++i) {
+    EXPECT_EQ(order[i], i);
+    EXPECT_EQ(threads[i], threads[0]);
+  }
+}
+
+// Each continuation runs the next one, so that they nest as deeply as the
+// limits allow.
+TEST_F(AsyncDispatchTest, RunInlineOrEnqueueBoundsDepth) {
+  ExecutionContext exec_ctx(
+      std::move(*RequestContextBuilder(host_context_.get(), nullptr).build()));
+  const InlineContinuationLimits default_limits = GetInlineContinuationLimits();
+  InlineContinuationLimits limits;
+  limits.max_depth = 10;
+  SetInlineContinuationLimits(limits);
+
+  constexpr int kNumContinuations = 1000;
+  static thread_local int depth = 0;
+  int max_depth = 0;
+  int num_run = 0;
+  std::function<void()> run_next = [&] {
+    ++depth;
+    max_depth = std::max(max_depth, depth);
+    if (++num_run < kNumContinuations) {
+      RunInlineOrEnqueue(exec_ctx, [&] { run_next(); });
+    }
+    --depth;
+  };
+  RunInlineOrEnqueue(exec_ctx, [&] { run_next(); });
+  host_context_->Quiesce();
+  EXPECT_EQ(num_run, kNumContinuations);
+  // A continuation that runs from the work queue starts a new stack, on which
+  // up to `max_depth` continuations run nested.
+  EXPECT_EQ(max_depth, limits.max_depth + 1);
+
+  SetInlineContinuationLimits(default_limits);
+}
+
+void BM_WhenAllReady(benchmark::State& state) {
+  auto host = CreateHostContext();
+  std::vector<AsyncValueRef<Chain>> values(state.range(0));
+  std::vector<AsyncValue*> value_ptrs(state.range(0));
+  for (auto _ : state) {
+    for (int i = 0; i < state.range(0); ++i) {
+      values[i] = MakeConstructedAsyncValueRef<Chain>(host.get());
+      value_ptrs[i] = values[i].GetAsyncValue();
+    }
+    auto chain = WhenAllReady(host.get(), value_ptrs);
+    for (auto& value : values) value.SetStateConcrete();
+    benchmark::DoNotOptimize(chain.IsConcrete());
+  }
+}
+BENCHMARK(BM_WhenAllReady)->Arg(4)->Arg(32);
+
+// Enqueues `range(0)` tiny closures, one task each or as a batch.
+void BM_EnqueueTinyWork(benchmark::State& state, bool batch) {
+  auto host = CreateHostContext();
+  ExecutionContext exec_ctx(
+      std::move(*RequestContextBuilder(host.get(), nullptr).build()));
+  std::atomic<int64_t> sum{0};
+  for (auto _ : state) {
+    std::vector<llvm::unique_function<void()>> work;
+    for (int i = 0; i < state.range(0); ++i) work.push_back([&] { ++sum; });
+    if (batch) {
+      EnqueueWorkBatch(exec_ctx, std::move(work));
+    } else {
+      for (auto& closure : work) EnqueueWork(exec_ctx, std::move(closure));
+    }
+    host->Quiesce();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_CAPTURE(BM_EnqueueTinyWork, tasks, false)->Arg(1000);
+BENCHMARK_CAPTURE(BM_EnqueueTinyWork, batch, true)->Arg(1000);
+
+}  // namespace
+}  // namespace tfrt
@@ -16,7 +16,11 @@
 
 #include "tfrt/host_context/async_value_ref.h"
 
+#include <vector>
+
+#include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
+#include "tfrt/host_context/chain.h"
 #include "tfrt/cpp_tests/test_util.h"
 #include "tfrt/support/ref_count.h"
 
@@ -125,5 +129,50 @@ TEST_F(AsyncValueRefTest, CopyRef) {
   EXPECT_EQ(value.GetAsyncValue(), copied_value.GetAsyncValue());
 }
 
+TEST_F(AsyncValueRefTest, ReadyChainIsShared) {
+  auto other_host = CreateHostContext();
+  auto chain = GetReadyChain(host_context_.get());
+  EXPECT_TRUE(chain.IsConcrete());
+  EXPECT_EQ(GetReadyChain(other_host.get()).GetAsyncValue(),
+            chain.GetAsyncValue());
+  EXPECT_EQ(MakeAvailableAsyncValueRef<Chain>().GetAsyncValue(),
+            chain.GetAsyncValue());
+  EXPECT_EQ(
+      MakeAvailableAsyncValueRef<Chain>(host_context_.get()).GetAsyncValue(),
+      chain.GetAsyncValue());
+}
+
+TEST_F(AsyncValueRefTest, LargeValue) {
+  // Values larger than the pooled sizes are allocated separately.
+  struct LargeValue {
+    char data[1024];
+  };
+  auto value = MakeAvailableAsyncValueRef<LargeValue>();
+  value->data[1023] = 1;
+  EXPECT_EQ(value->data[1023], 1);
+}
+
+void BM_MakeAvailableAsyncValueRef(benchmark::State& state) {
+  std::vector<AsyncValueRef<int32_t>> values(state.range(0));
+  for (auto _ : state) {
+    for (auto& value : values) value = MakeAvailableAsyncValueRef<int32_t>(1);
+    for (auto& value : values) value.reset();
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_MakeAvailableAsyncValueRef)->Arg(1)->Arg(100);
+
+void BM_MakeAvailableChain(benchmark::State& state) {
+  auto host = CreateHostContext();
+  std::vector<AsyncValueRef<Chain>> chains(100);
+  for (auto _ : state) {
+    for (auto& chain : chains)
+      chain = MakeAvailableAsyncValueRef<Chain>(host.get());
+    for (auto& chain : chains) chain.reset();
+  }
+  state.SetItemsProcessed(state.iterations() * chains.size());
+}
+BENCHMARK(BM_MakeAvailableChain);
+
 }  // namespace
 }  // namespace tfrt
@@ -16,6 +16,7 @@
 
 #include "tfrt/host_context/async_value.h"
 
+#include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
 #include "tfrt/cpp_tests/test_util.h"
 #include "tfrt/host_context/async_value_ref.h"
@@ -108,6 +109,23 @@ TEST_F(AsyncValueTest, AddAndDropRef) {
   value->DropRef();
 }
 
+TEST_F(AsyncValueTest, GetForwardedValue) {
+  RCReference<IndirectAsyncValue> indirect =
+      MakeIndirectAsyncValue(host_context_.get());
+  EXPECT_EQ(indirect->GetForwardedValue(), nullptr);
+
+  AsyncValueRef<int32_t> value =
+      MakeAvailableAsyncValueRef<int32_t>(host_context_.get(), 123);
+  indirect->ForwardTo(value.CopyRCRef());
+  EXPECT_EQ(indirect->GetForwardedValue(), value.GetAsyncValue());
+
+  // Forwarding to a resolved IndirectAsyncValue forwards to its value.
+  RCReference<IndirectAsyncValue> indirect2 =
+      MakeIndirectAsyncValue(host_context_.get());
+  indirect2->ForwardTo(indirect.CopyRef());
+  EXPECT_EQ(indirect2->GetForwardedValue(), value.GetAsyncValue());
+}
+
 TEST_F(AsyncValueTest, KeepPayloadOnError) {
   int payload_value = 0;
 
@@ -148,5 +166,31 @@ TEST_F(AsyncValueTest, KeepPayloadOnError) {
 
   EXPECT_EQ(2, payload_value);
 }
+
+void BM_AndThenSingleWaiter(benchmark::State& state) {
+  auto host = CreateHostContext();
+  for (auto _ : state) {
+    auto value = MakeUnconstructedAsyncValueRef<int32_t>(host.get());
+    int32_t result = 0;
+    value.AndThen([&] { result = value.get(); });
+    value.emplace(42);
+    benchmark::DoNotOptimize(result);
+  }
+}
+BENCHMARK(BM_AndThenSingleWaiter);
+
+void BM_AndThenMultipleWaiters(benchmark::State& state) {
+  auto host = CreateHostContext();
+  for (auto _ : state) {
+    auto value = MakeUnconstructedAsyncValueRef<int32_t>(host.get());
+    int32_t result = 0;
+    for (int i = 0; i < state.range(0); ++i)
+      value.AndThen([&] { result += value.get(); });
+    value.emplace(42);
+    benchmark::DoNotOptimize(result);
+  }
+}
+BENCHMARK(BM_AndThenMultipleWaiters)->Arg(2)->Arg(8);
+
 }  // namespace
 }  // namespace tfrt
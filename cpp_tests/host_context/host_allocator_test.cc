@@ -19,6 +19,9 @@
 #include "tfrt/host_context/host_allocator.h"
 
 #include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -53,6 +56,125 @@ TEST_F(HostAllocatorTest, AllocateDeallocate) {
   allocator_->Deallocate<uint64_t>(entries, kTestAllocateEntryCount);
 }
 
+// Tests for the slab allocator.
+class SlabAllocatorTest : public ::testing::Test {
+ protected:
+  SlabAllocatorTest() : allocator_(CreateSlabAllocator()) {}
+  std::unique_ptr<HostAllocator> allocator_;
+};
+
+bool IsAligned(void* ptr, size_t alignment) {
+  return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+}
+
+TEST_F(SlabAllocatorTest, AllocateDeallocateBytesWithAlignment) {
+  for (size_t size : {1, 8, 64, 100, 1024, 32 * 1024, 32 * 1024 + 1,
+                      1024 * 1024, 2 * 1024 * 1024, 3 * 1024 * 1024 + 5}) {
+    for (size_t alignment : {1, 8, 64, 256, 4096}) {
+      void* buffer = allocator_->AllocateBytes(size, alignment);
+      ASSERT_NE(nullptr, buffer);
+      EXPECT_TRUE(IsAligned(buffer, alignment));
+      // Small allocations are at least 64-byte aligned.
+      if (size <= 32 * 1024) EXPECT_TRUE(IsAligned(buffer, 64));
+      memset(buffer, 0xFF, size);
+      allocator_->DeallocateBytes(buffer, size);
+    }
+  }
+}
+
+TEST_F(SlabAllocatorTest, ReuseFreedBlock) {
+  void* first = allocator_->AllocateBytes(100, 8);
+  allocator_->DeallocateBytes(first, 100);
+  void* second = allocator_->AllocateBytes(128, 8);
+  EXPECT_EQ(first, second);
+  allocator_->DeallocateBytes(second, 128);
+}
+
+TEST_F(SlabAllocatorTest, DistinctBlocks) {
+  constexpr size_t kNumBlocks = 10000;
+  constexpr size_t kBlockSize = 48;
+  std::vector<char*> blocks;
+  for (size_t i = 0; i < kNumBlocks; ++i) {
+    blocks.push_back(static_cast<char*>(allocator_->AllocateBytes(
+        kBlockSize, alignof(std::max_align_t))));
+    memset(blocks.back(), i % 256, kBlockSize);
+  }
+  for (size_t i = 0; i < kNumBlocks; ++i) {
+    for (size_t j = 0; j < kBlockSize; ++j)
+      ASSERT_EQ(static_cast<char>(i % 256), blocks[i][j]);
+    allocator_->DeallocateBytes(blocks[i], kBlockSize);
+  }
+}
+
+TEST_F(SlabAllocatorTest, DeallocateOnOtherThreads) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumAllocations = 1000;
+
+  std::vector<std::vector<void*>> allocations(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i]() {
+      for (int j = 0; j < kNumAllocations; ++j) {
+        size_t size = 16 << (j % 8);
+        void* ptr = allocator_->AllocateBytes(size, 16);
+        memset(ptr, i, size);
+        allocations[i].push_back(ptr);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  threads.clear();
+
+  // Each thread deallocates the blocks allocated by another thread.
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i]() {
+      const auto& blocks = allocations[(i + 1) % kNumThreads];
+      for (int j = 0; j < kNumAllocations; ++j)
+        allocator_->DeallocateBytes(blocks[j], 16 << (j % 8));
+    });
+  }
+  for (auto& thread : threads) thread.join();
+}
+
+// Tests for the huge page allocator.
+TEST(HugePageAllocatorTest, AllocateDeallocateBytesWithAlignment) {
+  auto allocator = CreateHugePageAllocator(CreateMallocAllocator(),
+                                           /*min_size=*/1024 * 1024);
+  for (size_t size :
+       {100, 1024 * 1024 - 1, 1024 * 1024, 3 * 1024 * 1024 + 5}) {
+    for (size_t alignment : {8, 64, 4096}) {
+      void* buffer = allocator->AllocateBytes(size, alignment);
+      ASSERT_NE(nullptr, buffer);
+      EXPECT_TRUE(IsAligned(buffer, alignment));
+      memset(buffer, 0xFF, size);
+      allocator->DeallocateBytes(buffer, size);
+    }
+  }
+}
+
+TEST(HugePageAllocatorTest, ForwardsSmallAllocations) {
+  // The fixed size allocator can only serve the small allocation.
+  auto allocator = CreateHugePageAllocator(CreateFixedSizeAllocator(1024),
+                                           /*min_size=*/4096);
+  void* small = allocator->AllocateBytes(512, 8);
+  ASSERT_NE(nullptr, small);
+  EXPECT_EQ(nullptr, allocator->AllocateBytes(2048, 8));
+#if defined(__linux__)
+  void* large = allocator->AllocateBytes(8192, 8);
+  ASSERT_NE(nullptr, large);
+  EXPECT_TRUE(IsAligned(large, 2 * 1024 * 1024));
+  allocator->DeallocateBytes(large, 8192);
+#endif
+  allocator->DeallocateBytes(small, 512);
+}
+
+TEST(HugePageAllocatorTest, AdviseHugePages) {
+  std::vector<char> buffer(5 * 1024 * 1024, 1);
+  AdviseHugePages(buffer.data(), buffer.size());
+  AdviseHugePages(buffer.data(), 100);
+  EXPECT_EQ(1, buffer.back());
+}
+
 // Tests for HostArray class.
 constexpr size_t kTestArraySize = 16;
 class HostArrayTest : public ::testing::Test {
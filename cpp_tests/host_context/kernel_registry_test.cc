@@ -0,0 +1,158 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for the KernelRegistry.
+
+#include "tfrt/host_context/kernel_registry.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/Error.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+namespace {
+
+void AsyncKernel(AsyncKernelFrame* frame) {}
+void SyncKernel(SyncKernelFrame* frame) {}
+
+std::unique_ptr<HostContext> CreateHostContext() {
+  return std::make_unique<HostContext>([](const DecodedDiagnostic&) {},
+                                       CreateMallocAllocator(),
+                                       CreateSingleThreadedWorkQueue());
+}
+
+// Register `num_kernels` kernels named like the kernels of a large binary.
+std::vector<std::string> AddKernels(KernelRegistry* registry, int num_kernels) {
+  std::vector<std::string> names;
+  for (int i = 0; i < num_kernels; ++i) {
+    names.push_back(StrCat("tfrt_test.kernel_", i, ".f32.", i % 5));
+    if (i % 2 == 0) {
+      registry->AddKernel(names.back(), AsyncKernel);
+    } else {
+      registry->AddSyncKernel(names.back(), SyncKernel);
+    }
+  }
+  return names;
+}
+
+void ExpectKernels(const KernelRegistry& registry,
+                   const std::vector<std::string>& names) {
+  for (int i = 0, e = names.size(); i < e; ++i) {
+    auto kernel = registry.GetKernel(names[i]);
+    if (i % 2 == 0) {
+      ASSERT_TRUE(kernel.is<AsyncKernelImplementation>());
+      EXPECT_EQ(kernel.get<AsyncKernelImplementation>(), AsyncKernel);
+    } else {
+      ASSERT_TRUE(kernel.is<SyncKernelImplementation>());
+      EXPECT_EQ(kernel.get<SyncKernelImplementation>(), SyncKernel);
+    }
+  }
+}
+
+TEST(KernelRegistryTest, GetKernel) {
+  auto host = CreateHostContext();
+  KernelRegistry* registry = host->GetMutableRegistry();
+  auto names = AddKernels(registry, 100);
+  ExpectKernels(*registry, names);
+  EXPECT_TRUE(registry->GetKernel("tfrt_test.unknown").is<Monostate>());
+}
+
+TEST(KernelRegistryTest, Freeze) {
+  auto host = CreateHostContext();
+  KernelRegistry* registry = host->GetMutableRegistry();
+  for (int num_kernels : {0, 1, 2, 7, 1000}) {
+    auto names = AddKernels(registry, num_kernels);
+    registry->Freeze();
+    ExpectKernels(*registry, names);
+    EXPECT_TRUE(registry->GetKernel("tfrt_test.unknown").is<Monostate>());
+    EXPECT_TRUE(registry->GetKernel("").is<Monostate>());
+
+    // Kernels added after Freeze() are found.
+    registry->AddKernel(StrCat("tfrt_test.late_", num_kernels), AsyncKernel);
+    EXPECT_TRUE(registry->GetKernel(StrCat("tfrt_test.late_", num_kernels))
+                    .is<AsyncKernelImplementation>());
+    ExpectKernels(*registry, names);
+
+    host = CreateHostContext();
+    registry = host->GetMutableRegistry();
+  }
+}
+
+void RegisterFamilyKernels(KernelRegistry* registry) {
+  registry->AddKernel("tfrt_family.async", AsyncKernel);
+  registry->AddSyncKernel("tfrt_family.sync", SyncKernel);
+}
+
+TEST(KernelRegistryTest, DeferredKernelFamily) {
+  for (bool freeze : {false, true}) {
+    auto host = CreateHostContext();
+    KernelRegistry* registry = host->GetMutableRegistry();
+    auto names = AddKernels(registry, 10);
+    registry->AddDeferredKernelFamily("tfrt_family.", RegisterFamilyKernels);
+    if (freeze) registry->Freeze();
+
+    // Lookups of other kernels don't register the family.
+    ExpectKernels(*registry, names);
+    EXPECT_TRUE(registry->GetKernel("tfrt_test.unknown").is<Monostate>());
+
+    // The first lookup of a kernel of the family registers all of them.
+    EXPECT_TRUE(
+        registry->GetKernel("tfrt_family.sync").is<SyncKernelImplementation>());
+    EXPECT_TRUE(registry->GetKernel("tfrt_family.async")
+                    .is<AsyncKernelImplementation>());
+    EXPECT_TRUE(registry->GetKernel("tfrt_family.unknown").is<Monostate>());
+    ExpectKernels(*registry, names);
+  }
+}
+
+Error LoadNativeObject(string_view key, ArrayRef<uint8_t> data) {
+  return Error::success();
+}
+
+TEST(KernelRegistryTest, NativeObjectLoader) {
+  auto host = CreateHostContext();
+  KernelRegistry* registry = host->GetMutableRegistry();
+  EXPECT_EQ(registry->GetNativeObjectLoader("tfrt_test"), nullptr);
+
+  // Adding the same loader again is allowed.
+  registry->AddNativeObjectLoader("tfrt_test", LoadNativeObject);
+  registry->AddNativeObjectLoader("tfrt_test", LoadNativeObject);
+  EXPECT_EQ(registry->GetNativeObjectLoader("tfrt_test"), LoadNativeObject);
+  EXPECT_EQ(registry->GetNativeObjectLoader("tfrt_test.unknown"), nullptr);
+}
+
+void BM_GetKernel(benchmark::State& state) {
+  auto host = CreateHostContext();
+  KernelRegistry* registry = host->GetMutableRegistry();
+  auto names = AddKernels(registry, state.range(0));
+  if (state.range(1)) registry->Freeze();
+
+  for (auto _ : state) {
+    for (const auto& name : names)
+      benchmark::DoNotOptimize(registry->GetKernel(name));
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_GetKernel)->ArgPair(5000, 0)->ArgPair(5000, 1);
+
+}  // namespace
+}  // namespace tfrt
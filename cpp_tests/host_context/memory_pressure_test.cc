@@ -0,0 +1,138 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for TFRT MemoryPressure.
+
+#include "tfrt/host_context/memory_pressure.h"
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace {
+
+constexpr size_t kBytesLimit = 1000;
+
+std::unique_ptr<HostContext> CreateTestHostContext() {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {},
+      CreateMemoryUsageTrackingAllocator(CreateMallocAllocator(), kBytesLimit),
+      CreateSingleThreadedWorkQueue());
+}
+
+Error BuildRequest(HostContext* host,
+                   RequestOptions::RequestPriority priority) {
+  ResourceContext resource_context;
+  RequestOptions request_options;
+  request_options.priority = priority;
+  auto request_context = RequestContextBuilder(host, &resource_context)
+                             .set_request_options(request_options)
+                             .build();
+  if (!request_context) return request_context.takeError();
+  return Error::success();
+}
+
+TEST(MemoryPressureTest, TracksAllocatorUsage) {
+  auto host = CreateTestHostContext();
+  auto usage = host->allocator()->GetMemoryUsage();
+  ASSERT_TRUE(usage.hasValue());
+  EXPECT_EQ(usage->bytes_in_use, 0);
+  EXPECT_EQ(usage->bytes_limit, kBytesLimit);
+
+  void* ptr = host->allocator()->AllocateBytes(400, alignof(int));
+  EXPECT_EQ(host->allocator()->GetMemoryUsage()->bytes_in_use, 400);
+  EXPECT_DOUBLE_EQ(MemoryPressure::Get(host.get()).GetPressure(), 0.4);
+
+  host->allocator()->DeallocateBytes(ptr, 400);
+  EXPECT_EQ(host->allocator()->GetMemoryUsage()->bytes_in_use, 0);
+  EXPECT_DOUBLE_EQ(MemoryPressure::Get(host.get()).GetPressure(), 0.0);
+}
+
+TEST(MemoryPressureTest, NoPressureWithoutLimit) {
+  HostContext host([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+                   CreateSingleThreadedWorkQueue());
+  auto& memory_pressure = MemoryPressure::Get(&host);
+  void* ptr = host.allocator()->AllocateBytes(1 << 20, alignof(int));
+  EXPECT_EQ(memory_pressure.GetPressure(), 0.0);
+  EXPECT_EQ(memory_pressure.LimitBufferSize(8), 8);
+  host.allocator()->DeallocateBytes(ptr, 1 << 20);
+}
+
+TEST(MemoryPressureTest, UsesMostLoadedSource) {
+  auto host = CreateTestHostContext();
+  auto& memory_pressure = MemoryPressure::Get(host.get());
+  MemoryUsage device_usage;
+  device_usage.bytes_in_use = 50;
+  device_usage.bytes_limit = 100;
+  memory_pressure.AddSource(
+      [&] { return Optional<MemoryUsage>(device_usage); });
+  EXPECT_DOUBLE_EQ(memory_pressure.GetPressure(), 0.5);
+
+  device_usage.bytes_in_use = 0;
+  device_usage.bytes_limit = 0;
+  EXPECT_DOUBLE_EQ(memory_pressure.GetPressure(), 0.0);
+}
+
+TEST(MemoryPressureTest, AdmitsRequestsByPriority) {
+  auto host = CreateTestHostContext();
+  auto& memory_pressure = MemoryPressure::Get(host.get());
+  memory_pressure.SetWatermarks(0.5, 0.8);
+  auto* allocator = host->allocator();
+
+  void* ptr = allocator->AllocateBytes(400, alignof(int));
+  EXPECT_FALSE(BuildRequest(host.get(), RequestOptions::kLowPriority));
+  allocator->DeallocateBytes(ptr, 400);
+
+  ptr = allocator->AllocateBytes(600, alignof(int));
+  Error error = BuildRequest(host.get(), RequestOptions::kLowPriority);
+  EXPECT_TRUE(error.isA<ResourceExhaustedErrorInfo>());
+  llvm::consumeError(std::move(error));
+  EXPECT_FALSE(BuildRequest(host.get(), RequestOptions::kDefaultPriority));
+  allocator->DeallocateBytes(ptr, 600);
+
+  ptr = allocator->AllocateBytes(900, alignof(int));
+  error = BuildRequest(host.get(), RequestOptions::kHighPriority);
+  EXPECT_TRUE(error.isA<ResourceExhaustedErrorInfo>());
+  llvm::consumeError(std::move(error));
+  EXPECT_FALSE(BuildRequest(host.get(), RequestOptions::kCriticalPriority));
+  allocator->DeallocateBytes(ptr, 900);
+
+  EXPECT_FALSE(BuildRequest(host.get(), RequestOptions::kLowPriority));
+}
+
+TEST(MemoryPressureTest, ShrinksBuffers) {
+  auto host = CreateTestHostContext();
+  auto& memory_pressure = MemoryPressure::Get(host.get());
+  memory_pressure.SetWatermarks(0.5, 0.9);
+  auto* allocator = host->allocator();
+
+  EXPECT_EQ(memory_pressure.LimitBufferSize(8), 8);
+
+  void* ptr = allocator->AllocateBytes(700, alignof(int));
+  EXPECT_EQ(memory_pressure.LimitBufferSize(8), 4);
+  allocator->DeallocateBytes(ptr, 700);
+
+  ptr = allocator->AllocateBytes(900, alignof(int));
+  EXPECT_EQ(memory_pressure.LimitBufferSize(8), 0);
+  allocator->DeallocateBytes(ptr, 900);
+}
+
+}  // namespace
+}  // namespace tfrt
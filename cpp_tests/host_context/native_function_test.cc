@@ -0,0 +1,113 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for typed native functions.
+
+#include "tfrt/host_context/native_function.h"
+
+#include <tuple>
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace {
+
+int32_t Add(int32_t a, int32_t b) { return a + b; }
+
+std::tuple<int32_t, AsyncValueRef<int32_t>> DivRem(int32_t n, int32_t d,
+                                                   HostContext* host) {
+  return std::make_tuple(n / d, MakeAvailableAsyncValueRef<int32_t>(n % d));
+}
+
+Expected<std::tuple<int32_t, int32_t>> CheckedDivRem(int32_t n, int32_t d) {
+  if (d == 0) return MakeStringError("division by zero");
+  return std::make_tuple(n / d, n % d);
+}
+
+class NativeFunctionTest : public ::testing::Test {
+ protected:
+  NativeFunctionTest()
+      : host_(CreateHostContext()),
+        exec_ctx_(std::move(*RequestContextBuilder(host_.get(),
+                                                   /*resource_context=*/nullptr)
+                                 .build())) {}
+
+  std::unique_ptr<HostContext> host_;
+  ExecutionContext exec_ctx_;
+};
+
+TEST_F(NativeFunctionTest, AvailableArguments) {
+  NativeFunction fn("add", {}, {}, TFRT_NATIVE_FUNCTION(Add));
+
+  auto a = MakeAvailableAsyncValueRef<int32_t>(1);
+  auto b = MakeAvailableAsyncValueRef<int32_t>(2);
+  AsyncValue* args[] = {a.GetAsyncValue(), b.GetAsyncValue()};
+  RCReference<AsyncValue> results[1];
+  fn.Execute(exec_ctx_, args, results);
+
+  // The function runs synchronously when all the arguments are available.
+  ASSERT_TRUE(results[0]->IsAvailable());
+  EXPECT_EQ(results[0]->get<int32_t>(), 3);
+}
+
+TEST_F(NativeFunctionTest, UnavailableArguments) {
+  NativeFunction fn("add", {}, {}, TFRT_NATIVE_FUNCTION(Add));
+
+  auto a = MakeAvailableAsyncValueRef<int32_t>(1);
+  auto b = MakeUnconstructedAsyncValueRef<int32_t>();
+  AsyncValue* args[] = {a.GetAsyncValue(), b.GetAsyncValue()};
+  RCReference<AsyncValue> results[1];
+  fn.Execute(exec_ctx_, args, results);
+  EXPECT_FALSE(results[0]->IsAvailable());
+
+  b.emplace(5);
+  host_->Await(results);
+  EXPECT_EQ(results[0]->get<int32_t>(), 6);
+}
+
+TEST_F(NativeFunctionTest, MultipleResults) {
+  NativeFunction fn("div_rem", {}, {}, TFRT_NATIVE_FUNCTION(DivRem));
+
+  auto n = MakeAvailableAsyncValueRef<int32_t>(7);
+  auto d = MakeAvailableAsyncValueRef<int32_t>(3);
+  AsyncValue* args[] = {n.GetAsyncValue(), d.GetAsyncValue()};
+  RCReference<AsyncValue> results[2];
+  fn.Execute(exec_ctx_, args, results);
+
+  EXPECT_EQ(results[0]->get<int32_t>(), 2);
+  EXPECT_EQ(results[1]->get<int32_t>(), 1);
+}
+
+TEST_F(NativeFunctionTest, ErrorSetsAllResults) {
+  NativeFunction fn("checked_div_rem", {}, {},
+                    TFRT_NATIVE_FUNCTION(CheckedDivRem));
+
+  auto n = MakeAvailableAsyncValueRef<int32_t>(7);
+  auto d = MakeAvailableAsyncValueRef<int32_t>(0);
+  AsyncValue* args[] = {n.GetAsyncValue(), d.GetAsyncValue()};
+  RCReference<AsyncValue> results[2];
+  fn.Execute(exec_ctx_, args, results);
+
+  for (auto& result : results) {
+    ASSERT_TRUE(result->IsError());
+    EXPECT_EQ(result->GetError().message, "division by zero");
+  }
+}
+
+}  // namespace
+}  // namespace tfrt
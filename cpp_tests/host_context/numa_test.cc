@@ -0,0 +1,182 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for the NUMA work queue and allocator.
+
+#include "tfrt/host_context/numa.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/latch.h"
+
+namespace tfrt {
+namespace {
+
+// Two nodes that share all CPUs of the first node of the host, so that the
+// tests run on hosts with a single node.
+NumaTopology GetTwoNodeTopology() {
+  const auto& host_node = NumaTopology::Get().nodes().front();
+  return NumaTopology({{10, host_node.cpus}, {20, host_node.cpus}});
+}
+
+TEST(NumaTest, HostTopology) {
+  const NumaTopology& topology = NumaTopology::Get();
+  ASSERT_GE(topology.num_nodes(), 1);
+  for (const auto& node : topology.nodes()) EXPECT_FALSE(node.cpus.empty());
+  EXPECT_EQ(topology.GetNodeIndex(topology.nodes().back().id),
+            topology.num_nodes() - 1);
+  EXPECT_EQ(topology.GetNodeIndex(-1), -1);
+}
+
+TEST(NumaTest, BindThread) {
+  NumaTopology topology = GetTwoNodeTopology();
+  std::thread thread([&] {
+    EXPECT_EQ(GetCurrentNumaNode(), -1);
+    BindCurrentThreadToNumaNode(topology.nodes()[1]);
+    EXPECT_EQ(GetCurrentNumaNode(), 20);
+  });
+  thread.join();
+}
+
+TEST(NumaTest, NodeOfAddress) {
+  auto data = std::make_unique<char[]>(4096);
+  memset(data.get(), 1, 4096);
+  int id = GetNumaNodeOfAddress(data.get());
+  // Not all hosts report the node of a page.
+  if (id >= 0) EXPECT_GE(NumaTopology::Get().GetNodeIndex(id), 0);
+}
+
+TEST(NumaWorkQueueTest, WorkerThreadsAreBound) {
+  auto work_queue = CreateNumaWorkQueue(2, 1, GetTwoNodeTopology());
+  EXPECT_EQ(work_queue->GetParallelismLevel(), 4);
+  EXPECT_FALSE(work_queue->IsInWorkerThread());
+
+  // Wait with a latch, because Quiesce() can run the tasks in this thread.
+  std::atomic<int> num_bound{0};
+  latch done(100);
+  for (int i = 0; i < 100; ++i) {
+    work_queue->AddTask(TaskFunction([&] {
+      int node = GetCurrentNumaNode();
+      if (node == 10 || node == 20) ++num_bound;
+      done.count_down();
+    }));
+  }
+  done.wait();
+  EXPECT_EQ(num_bound.load(), 100);
+}
+
+TEST(NumaWorkQueueTest, TasksStayOnTheirNode) {
+  auto work_queue = CreateNumaWorkQueue(2, 1, GetTwoNodeTopology());
+  ConcurrentWorkQueue* queue = work_queue.get();
+
+  std::atomic<int> num_same_node{0};
+  latch done(10);
+  for (int i = 0; i < 10; ++i) {
+    queue->AddTask(TaskFunction([&] {
+      int node = GetCurrentNumaNode();
+      queue->AddTask(TaskFunction([&, node] {
+        if (GetCurrentNumaNode() == node) ++num_same_node;
+        done.count_down();
+      }));
+    }));
+  }
+  done.wait();
+  EXPECT_EQ(num_same_node.load(), 10);
+}
+
+TEST(NumaWorkQueueTest, QuiesceWithBlockingTasks) {
+  auto work_queue = CreateNumaWorkQueue(1, 1, GetTwoNodeTopology());
+  ConcurrentWorkQueue* queue = work_queue.get();
+
+  std::atomic<int> num_tasks{0};
+  for (int i = 0; i < 10; ++i) {
+    auto task = queue->AddBlockingTask(
+        TaskFunction([&] {
+          queue->AddTask(TaskFunction([&] {
+            auto nested = queue->AddBlockingTask(
+                TaskFunction([&] { ++num_tasks; }), /*allow_queuing=*/true);
+            EXPECT_FALSE(nested.hasValue());
+          }));
+        }),
+        /*allow_queuing=*/true);
+    EXPECT_FALSE(task.hasValue());
+  }
+  work_queue->Quiesce();
+  EXPECT_EQ(num_tasks.load(), 10);
+}
+
+TEST(NumaWorkQueueTest, AddTaskNear) {
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateNumaWorkQueue(1, 1));
+  auto req_ctx = RequestContextBuilder(host.get(), nullptr).build();
+  ASSERT_TRUE(!!req_ctx);
+  ExecutionContext exec_ctx(std::move(*req_ctx));
+
+  auto data = std::make_unique<char[]>(4096);
+  memset(data.get(), 1, 4096);
+  int data_node = GetNumaNodeOfAddress(data.get());
+
+  std::atomic<int> task_node{-1};
+  latch done(1);
+  EnqueueWorkNear(exec_ctx, data.get(), [&] {
+    task_node = GetCurrentNumaNode();
+    done.count_down();
+  });
+  done.wait();
+  EXPECT_GE(NumaTopology::Get().GetNodeIndex(task_node), 0);
+  if (data_node >= 0) EXPECT_EQ(task_node.load(), data_node);
+}
+
+TEST(NumaAllocatorTest, AllocateFromBoundThreads) {
+  NumaTopology topology = GetTwoNodeTopology();
+  auto allocator = CreateNumaAllocator(CreateSlabAllocator, topology);
+
+  std::vector<std::thread> threads;
+  for (const auto& node : topology.nodes()) {
+    threads.emplace_back([&allocator, &node] {
+      BindCurrentThreadToNumaNode(node);
+      std::vector<void*> allocations;
+      for (int i = 0; i < 100; ++i) {
+        void* ptr = allocator->AllocateBytes(256, 64);
+        ASSERT_NE(ptr, nullptr);
+        memset(ptr, 0, 256);
+        allocations.push_back(ptr);
+      }
+      for (void* ptr : allocations) allocator->DeallocateBytes(ptr, 256);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  // Memory can be deallocated by a thread bound to another node.
+  void* ptr = allocator->AllocateBytes(1024, 16);
+  std::thread thread([&] {
+    BindCurrentThreadToNumaNode(topology.nodes()[1]);
+    allocator->DeallocateBytes(ptr, 1024);
+  });
+  thread.join();
+}
+
+}  // namespace
+}  // namespace tfrt
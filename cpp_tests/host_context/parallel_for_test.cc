@@ -102,6 +102,56 @@ TEST(ParallelForTest, MinBlockSize) {
   ASSERT_EQ(ranges, expected);
 }
 
+TEST(ParallelForTest, CheapCostRunsInCallerThread) {
+  auto host = CreateTestHostContext(4);
+  ParallelFor pfor(CreateTestExecutionContext(host.get()));
+
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = 8;
+  cost.bytes_stored = 4;
+  cost.compute_cycles = 1;
+
+  std::vector<Range> ranges;
+  AsyncValueRef<Chain> done = pfor.Execute(
+      1000, BlockSizes::FromCost(cost),
+      [&](size_t begin, size_t end) { ranges.push_back({begin, end}); });
+
+  // The range is computed synchronously as a single block.
+  EXPECT_TRUE(done.IsConcrete());
+  const std::vector<Range> expected = {{0, 1000}};
+  EXPECT_EQ(ranges, expected);
+}
+
+TEST(ParallelForTest, ExpensiveCostFillsWorkerThreads) {
+  auto host = CreateTestHostContext(4);
+  ParallelFor pfor(CreateTestExecutionContext(host.get()));
+
+  // Each element is expensive enough to be a task on its own. 10 blocks of 2
+  // elements would leave half of the 4 threads idle in the last round, so the
+  // blocks are coarsened to 3 elements.
+  ParallelFor::Cost cost;
+  cost.compute_cycles = 1000000;
+
+  latch barrier(8);  // 7 tasks + 1 on-done callback
+  mutex mu;
+  std::vector<Range> ranges;
+
+  AsyncValueRef<Chain> done = pfor.Execute(
+      20, BlockSizes::FromCost(cost), [&](size_t begin, size_t end) {
+        mutex_lock lock(mu);
+        ranges.push_back({begin, end});
+        barrier.count_down();
+      });
+  done.AndThen([&]() { barrier.count_down(); });
+
+  barrier.wait();
+
+  std::sort(ranges.begin(), ranges.end());
+  const std::vector<Range> expected = {{0, 3},   {3, 6},   {6, 9},  {9, 12},
+                                       {12, 15}, {15, 18}, {18, 20}};
+  ASSERT_EQ(ranges, expected);
+}
+
 TEST(ParallelForTest, BlockTasksCompletion) {
   auto host = CreateTestHostContext(4);
   ParallelFor pfor(CreateTestExecutionContext(host.get()));
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit tests for the heap profiles of the profiled allocators.
+
+#include "tfrt/host_context/profiled_allocator.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tfrt {
+namespace {
+
+// A field of a protocol buffer message, either a varint or length-delimited.
+struct Field {
+  int number;
+  uint64_t varint;
+  string_view bytes;
+};
+
+uint64_t ReadVarint(string_view* data) {
+  uint64_t value = 0;
+  for (int shift = 0; !data->empty(); shift += 7) {
+    uint8_t byte = data->front();
+    *data = data->drop_front();
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80) break;
+  }
+  return value;
+}
+
+std::vector<Field> ParseMessage(string_view data) {
+  std::vector<Field> fields;
+  while (!data.empty()) {
+    uint64_t tag = ReadVarint(&data);
+    Field field = {static_cast<int>(tag >> 3), 0, {}};
+    if ((tag & 7) == 2) {
+      size_t size = ReadVarint(&data);
+      field.bytes = data.take_front(size);
+      data = data.drop_front(size);
+    } else {
+      field.varint = ReadVarint(&data);
+    }
+    fields.push_back(field);
+  }
+  return fields;
+}
+
+// Returns the values of the samples in the heap profile, keyed by site.
+std::map<std::string, std::vector<int64_t>> GetHeapProfile() {
+  std::string buffer;
+  llvm::raw_string_ostream os(buffer);
+  WriteHeapProfile(os);
+  os.flush();
+
+  std::vector<std::string> strings;
+  std::map<uint64_t, uint64_t> function_names, location_functions;
+  std::vector<std::pair<uint64_t, std::vector<int64_t>>> samples;
+  for (const Field& field : ParseMessage(buffer)) {
+    if (field.number == 6) strings.push_back(field.bytes.str());
+    if (field.number != 2 && field.number != 4 && field.number != 5) continue;
+    auto fields = ParseMessage(field.bytes);
+    if (field.number == 5) function_names[fields[0].varint] = fields[1].varint;
+    if (field.number == 4) {
+      location_functions[fields[0].varint] =
+          ParseMessage(fields[1].bytes)[0].varint;
+    }
+    if (field.number == 2) {
+      samples.emplace_back();
+      for (const Field& sample_field : fields) {
+        if (sample_field.number == 1)
+          samples.back().first = sample_field.varint;
+        if (sample_field.number == 2)
+          samples.back().second.push_back(sample_field.varint);
+      }
+    }
+  }
+
+  std::map<std::string, std::vector<int64_t>> result;
+  for (const auto& sample : samples) {
+    uint64_t function = location_functions[sample.first];
+    result[strings[function_names[function]]] = sample.second;
+  }
+  return result;
+}
+
+TEST(ProfiledAllocatorTest, NoSamplesWithoutSampling) {
+  auto allocator = CreateLeakCheckAllocator(CreateMallocAllocator());
+  void* ptr = allocator->AllocateBytes(100, 8);
+  EXPECT_TRUE(GetHeapProfile().empty());
+  allocator->DeallocateBytes(ptr, 100);
+}
+
+TEST(ProfiledAllocatorTest, AttributesSamplesToSites) {
+  // Sample every allocation.
+  auto allocator = CreateLeakCheckAllocator(CreateMallocAllocator(), 1);
+  void* ptrs[3];
+  {
+    AllocationSiteScope site("kernel_a");
+    ptrs[0] = allocator->AllocateBytes(100, 8);
+    ptrs[1] = allocator->AllocateBytes(100, 8);
+    {
+      AllocationSiteScope nested_site("kernel_b");
+      ptrs[2] = allocator->AllocateBytes(50, 8);
+    }
+  }
+  allocator->DeallocateBytes(ptrs[0], 100);
+
+  auto profile = GetHeapProfile();
+  ASSERT_EQ(profile.size(), 2);
+  // alloc_objects, alloc_space, inuse_objects, inuse_space.
+  EXPECT_EQ(profile["kernel_a"], std::vector<int64_t>({2, 200, 1, 100}));
+  EXPECT_EQ(profile["kernel_b"], std::vector<int64_t>({1, 50, 1, 50}));
+
+  allocator->DeallocateBytes(ptrs[1], 100);
+  allocator->DeallocateBytes(ptrs[2], 50);
+  EXPECT_EQ(GetHeapProfile()["kernel_a"],
+            std::vector<int64_t>({2, 200, 0, 0}));
+}
+
+TEST(ProfiledAllocatorTest, EstimatesUnsampledAllocations) {
+  auto allocator = CreateLeakCheckAllocator(CreateMallocAllocator(), 4096);
+  constexpr int kNumAllocations = 10000;
+  constexpr size_t kSize = 64;
+  std::vector<void*> ptrs;
+  for (int i = 0; i < kNumAllocations; ++i)
+    ptrs.push_back(allocator->AllocateBytes(kSize, 8));
+
+  auto values = GetHeapProfile()["[unattributed]"];
+  ASSERT_EQ(values.size(), 4);
+  EXPECT_NEAR(values[1], kNumAllocations * kSize, kNumAllocations * kSize / 4);
+  EXPECT_EQ(values[1], values[3]);
+
+  for (void* ptr : ptrs) allocator->DeallocateBytes(ptr, kSize);
+}
+
+}  // namespace
+}  // namespace tfrt
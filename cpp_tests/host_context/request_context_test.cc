@@ -16,10 +16,14 @@
 
 // Unit test for TFRT RequestContext.
 
+#include <cstring>
+
 #include "gtest/gtest.h"
+#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_buffer.h"
 #include "tfrt/host_context/host_context.h"
 
 namespace tfrt {
@@ -41,6 +45,18 @@ TEST(RequestContextTest, Id) {
   EXPECT_EQ(expected_request_context.get()->id(), 0xdeadbeef);
 }
 
+TEST(RequestContextTest, TraceId) {
+  auto host = CreateTestHostContext();
+  ResourceContext resource_context;
+  auto expected_request_context =
+      RequestContextBuilder(host.get(), &resource_context)
+          .set_trace_id(0xdeadbeef)
+          .build();
+  ASSERT_FALSE(!expected_request_context);
+  ExecutionContext exec_ctx(std::move(expected_request_context.get()));
+  EXPECT_EQ(exec_ctx.trace_id(), 0xdeadbeef);
+}
+
 TEST(RequestContextTest, ContextData) {
   auto host = CreateTestHostContext();
   ResourceContext resource_context;
@@ -60,5 +76,82 @@ TEST(RequestContextTest, ContextData) {
   EXPECT_EQ(expected_request_context.get()->GetDataIfExists<int>(), nullptr);
 }
 
+TEST(RequestContextTest, ArenaAllocator) {
+  auto host = CreateTestHostContext();
+  ResourceContext resource_context;
+
+  auto request_without_arena =
+      RequestContextBuilder(host.get(), &resource_context).build();
+  ASSERT_FALSE(!request_without_arena);
+  EXPECT_EQ(request_without_arena.get()->arena_allocator(), nullptr);
+  EXPECT_EQ(request_without_arena.get()->allocator(), host->allocator());
+
+  auto request_with_arena = RequestContextBuilder(host.get(), &resource_context)
+                                .enable_arena_allocator()
+                                .build();
+  ASSERT_FALSE(!request_with_arena);
+  ExecutionContext exec_ctx(std::move(request_with_arena.get()));
+  ASSERT_NE(exec_ctx.request_ctx()->arena_allocator(), nullptr);
+  EXPECT_EQ(exec_ctx.allocator(), exec_ctx.request_ctx()->arena_allocator());
+
+  auto buffer = HostBuffer::CreateUninitialized(/*size=*/64,
+                                                /*alignment=*/16, exec_ctx);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(exec_ctx.request_ctx()->arena_allocator()->NumChunks(), 1);
+
+  // The buffer stays valid after the request is destroyed.
+  auto other_request =
+      RequestContextBuilder(host.get(), &resource_context).build();
+  ASSERT_FALSE(!other_request);
+  exec_ctx = ExecutionContext(std::move(other_request.get()));
+  memset(buffer->data(), 0, buffer->size());
+}
+
+TEST(RequestContextTest, CancelCallbacks) {
+  auto host = CreateTestHostContext();
+  ResourceContext resource_context;
+  auto request = RequestContextBuilder(host.get(), &resource_context).build();
+  ASSERT_FALSE(!request);
+  RequestContext* request_ctx = request.get().get();
+
+  int num_called = 0;
+  request_ctx->AddCancelCallback([&] { ++num_called; });
+  auto removed = request_ctx->AddCancelCallback([&] { num_called += 10; });
+  request_ctx->RemoveCancelCallback(removed);
+  EXPECT_EQ(num_called, 0);
+
+  request_ctx->Cancel();
+  EXPECT_EQ(num_called, 1);
+  // Callbacks run only once.
+  request_ctx->Cancel();
+  EXPECT_EQ(num_called, 1);
+  // Callbacks added after the cancellation run immediately.
+  request_ctx->AddCancelCallback([&] { ++num_called; });
+  EXPECT_EQ(num_called, 2);
+}
+
+TEST(RequestContextTest, CancelSkipsQueuedWork) {
+  auto host = CreateTestHostContext();
+  ResourceContext resource_context;
+  auto request = RequestContextBuilder(host.get(), &resource_context).build();
+  ASSERT_FALSE(!request);
+  ExecutionContext exec_ctx(std::move(request.get()));
+
+  bool ran = false;
+  AsyncValueRef<int> queued = EnqueueWork(exec_ctx, [&] {
+    ran = true;
+    return 1;
+  });
+  exec_ctx.request_ctx()->Cancel();
+  host->Quiesce();
+  EXPECT_FALSE(ran);
+  ASSERT_TRUE(queued.IsError());
+  EXPECT_EQ(queued.GetError().message, "Cancelled");
+
+  // Work of a cancelled request is not enqueued at all.
+  AsyncValueRef<int> late = EnqueueWork(exec_ctx, [] { return 1; });
+  EXPECT_TRUE(late.IsError());
+}
+
 }  // namespace
 }  // namespace tfrt
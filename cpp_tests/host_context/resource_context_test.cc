@@ -18,6 +18,10 @@
 
 #include "tfrt/host_context/resource_context.h"
 
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
 #include "tfrt/support/string_util.h"
 
@@ -97,5 +101,81 @@ TEST(ResourceContextTest, DestructionOrder) {
   }
 }
 
+const ResourceSlot<SomeResource>& GetSomeResourceSlot() {
+  static const auto* slot = new ResourceSlot<SomeResource>;
+  return *slot;
+}
+
+TEST(ResourceContextTest, GetOrCreateInSlot) {
+  ResourceContext resource_context;
+  EXPECT_EQ(resource_context.GetResource(GetSomeResourceSlot()), nullptr);
+
+  SomeResource* rc =
+      resource_context.GetOrCreateResource(GetSomeResourceSlot(), 41);
+  ASSERT_EQ(rc->GetData(), 41);
+  EXPECT_EQ(resource_context.GetResource(GetSomeResourceSlot()), rc);
+
+  SomeResource* rc2 =
+      resource_context.GetOrCreateResource(GetSomeResourceSlot(), 42);
+  EXPECT_EQ(rc2, rc);
+
+  // Slots do not share the resources of the same type with a name.
+  SomeResource* named =
+      resource_context.GetOrCreateResource<SomeResource>("some_name", 43);
+  EXPECT_NE(named, rc);
+
+  // Each ResourceContext has its own resource in the slot.
+  ResourceContext other_context;
+  EXPECT_EQ(other_context.GetResource(GetSomeResourceSlot()), nullptr);
+}
+
+TEST(ResourceContextTest, GetOrCreateInSlotConcurrently) {
+  ResourceContext resource_context;
+  std::vector<SomeResource*> resources(8);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&, i] {
+      resources[i] =
+          resource_context.GetOrCreateResource(GetSomeResourceSlot(), i);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  for (SomeResource* resource : resources) EXPECT_EQ(resource, resources[0]);
+}
+
+TEST(ResourceContextTest, SlotDestructionOrder) {
+  static bool parent_destroyed = false;
+  struct Parent {
+    ~Parent() { parent_destroyed = true; }
+  };
+
+  struct Child {
+    ~Child() { EXPECT_FALSE(parent_destroyed); }
+  };
+
+  static const auto* child_slot = new ResourceSlot<Child>;
+  ResourceContext resource_context;
+  resource_context.CreateResource<Parent>("parent");
+  resource_context.GetOrCreateResource(*child_slot);
+}
+
+void BM_GetOrCreateResourceByName(benchmark::State& state) {
+  ResourceContext resource_context;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        resource_context.GetOrCreateResource<SomeResource>("some_name", 41));
+  }
+}
+BENCHMARK(BM_GetOrCreateResourceByName);
+
+void BM_GetOrCreateResourceInSlot(benchmark::State& state) {
+  ResourceContext resource_context;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        resource_context.GetOrCreateResource(GetSomeResourceSlot(), 41));
+  }
+}
+BENCHMARK(BM_GetOrCreateResourceInSlot);
+
 }  // namespace
 }  // namespace tfrt
@@ -188,6 +188,31 @@ TEST_F(SyncKernelTest, SideEffectingKernel) {
   ASSERT_EQ(copy.get<int>(), 1);
 }
 
+// Sync kernels in async functions read their arguments from AsyncValues in
+// place, and emplace their results into AsyncValues.
+TEST_F(SyncKernelTest, AsyncValueArgumentsAndResults) {
+  auto async_arg1 = MakeAvailableAsyncValueRef<int>(5);
+  auto async_arg2 = MakeAvailableAsyncValueRef<int>(2);
+  Value arg1, arg2;
+  async_arg1.GetAsyncValue()->BorrowValue(&arg1);
+  async_arg2.GetAsyncValue()->BorrowValue(&arg2);
+  EXPECT_EQ(&arg1.get<int>(), &async_arg1.get());
+  AddArg(&arg1);
+  AddArg(&arg2);
+
+  SmallVector<RCReference<AsyncValue>, 2> results;
+  results.resize(2);
+  auto kernel_frame = MakeKernelFrame();
+  kernel_frame.SetAsyncResults(results);
+  TFRT_SYNC_KERNEL(IntQuoRem)(&kernel_frame);
+
+  ASSERT_EQ(kernel_frame.GetNumResults(), 2);
+  ASSERT_TRUE(results[0]->IsConcrete());
+  ASSERT_TRUE(results[1]->IsConcrete());
+  EXPECT_EQ(results[0]->get<int>(), 2);
+  EXPECT_EQ(results[1]->get<int>(), 1);
+}
+
 using SyncKernelDeathTest = SyncKernelTest;
 
 // Assert death only in the debug mode, as the validity of kernel call is only
@@ -0,0 +1,139 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for the tenant work queue and allocator.
+
+#include "tfrt/host_context/tenant.h"
+
+#include <atomic>
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/latch.h"
+
+namespace tfrt {
+namespace {
+
+TEST(TenantWorkQueueTest, LimitsParallelism) {
+  std::shared_ptr<ConcurrentWorkQueue> shared =
+      CreateMultiThreadedWorkQueue(4, 1);
+  auto work_queue = CreateTenantWorkQueue(shared, {"model", 2});
+  EXPECT_EQ(work_queue->GetParallelismLevel(), 2);
+
+  std::atomic<int> num_running{0};
+  std::atomic<int> max_running{0};
+  latch done(100);
+  for (int i = 0; i < 100; ++i) {
+    work_queue->AddTask(TaskFunction([&] {
+      int running = ++num_running;
+      int max = max_running.load();
+      while (running > max && !max_running.compare_exchange_weak(max, running))
+        ;
+      for (volatile int j = 0; j < 10000; ++j) {
+      }
+      --num_running;
+      done.count_down();
+    }));
+  }
+  done.wait();
+  work_queue->Quiesce();
+  EXPECT_GE(max_running.load(), 1);
+  EXPECT_LE(max_running.load(), 2);
+}
+
+TEST(TenantWorkQueueTest, QuiesceWaitsForOwnTasks) {
+  std::shared_ptr<ConcurrentWorkQueue> shared =
+      CreateMultiThreadedWorkQueue(2, 2);
+  auto model_a = CreateTenantWorkQueue(shared, {"a", 1});
+  auto model_b = CreateTenantWorkQueue(shared, {"b", 0});
+
+  // A blocking task of another tenant does not hold up Quiesce().
+  latch release(1);
+  auto blocked = model_b->AddBlockingTask(
+      TaskFunction([&] { release.wait(); }), /*allow_queuing=*/true);
+  EXPECT_FALSE(blocked.hasValue());
+
+  std::atomic<int> num_tasks{0};
+  for (int i = 0; i < 10; ++i) {
+    model_a->AddTask(TaskFunction([&] {
+      ++num_tasks;
+      auto nested = model_a->AddBlockingTask(
+          TaskFunction([&] { ++num_tasks; }), /*allow_queuing=*/true);
+      EXPECT_FALSE(nested.hasValue());
+    }));
+  }
+  model_a->Quiesce();
+  EXPECT_EQ(num_tasks.load(), 20);
+
+  release.count_down();
+  model_b->Quiesce();
+}
+
+TEST(TenantWorkQueueTest, HostContextsShareThreads) {
+  std::shared_ptr<ConcurrentWorkQueue> shared =
+      CreateMultiThreadedWorkQueue(2, 1);
+  std::shared_ptr<HostAllocator> allocator = CreateMallocAllocator();
+  auto make_host = [&](const char* name) {
+    return std::make_unique<HostContext>(
+        [](const DecodedDiagnostic&) {}, CreateTenantAllocator(allocator),
+        CreateTenantWorkQueue(shared, {name, 1}));
+  };
+  auto host_a = make_host("a");
+  auto host_b = make_host("b");
+
+  auto chain_a = MakeUnconstructedAsyncValueRef<Chain>(host_a.get());
+  auto chain_b = MakeUnconstructedAsyncValueRef<Chain>(host_b.get());
+  host_a->work_queue().AddTask(TaskFunction([&] { chain_a.emplace(); }));
+  host_b->work_queue().AddTask(TaskFunction([&] { chain_b.emplace(); }));
+  host_a->Await({chain_a.CopyRCRef()});
+  host_b->Await({chain_b.CopyRCRef()});
+  EXPECT_TRUE(chain_a.IsConcrete());
+  EXPECT_TRUE(chain_b.IsConcrete());
+
+  // The shared work queue and allocator outlive the first tenant.
+  chain_a.reset();
+  host_a.reset();
+  host_b->Quiesce();
+}
+
+TEST(TenantAllocatorTest, EnforcesQuota) {
+  std::shared_ptr<HostAllocator> shared = CreateMallocAllocator();
+  auto allocator = CreateTenantAllocator(shared, 16384);
+
+  void* first = allocator->AllocateBytes(8192, 64);
+  ASSERT_NE(first, nullptr);
+  void* second = allocator->AllocateBytes(8192, 64);
+  ASSERT_NE(second, nullptr);
+  EXPECT_EQ(allocator->AllocateBytes(8192, 64), nullptr);
+
+  // Small allocations do not fail.
+  void* small = allocator->AllocateBytes(64, 16);
+  EXPECT_NE(small, nullptr);
+  allocator->DeallocateBytes(small, 64);
+
+  allocator->DeallocateBytes(first, 8192);
+  void* third = allocator->AllocateBytes(8192, 64);
+  EXPECT_NE(third, nullptr);
+  allocator->DeallocateBytes(second, 8192);
+  allocator->DeallocateBytes(third, 8192);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -21,8 +21,11 @@
 #include <chrono>
 #include <ctime>
 #include <memory>
+#include <vector>
 
+#include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
+#include "tfrt/support/latch.h"
 
 namespace tfrt {
 namespace {
@@ -93,5 +96,75 @@ TEST(TimerQueueTest, TimerQueueTimerCancelled) {
   ASSERT_FALSE(expired_2);
 }
 
+// This test checks that timers never expire before their deadline, and expire
+// in the order of their deadlines, including the timers that are moved to
+// lower levels of the timing wheel.
+TEST(TimerQueueTest, TimerQueueManyTimers) {
+  using Clock = std::chrono::system_clock;
+  constexpr int kNumTimers = 1000;
+  std::vector<Clock::time_point> deadlines(kNumTimers);
+  std::vector<Clock::time_point> expirations(kNumTimers);
+  latch done(kNumTimers);
+  {
+    TimerQueue tq;
+    std::vector<TimerQueue::TimerHandle> timers;
+    auto now = Clock::now();
+    for (int i = 0; i < kNumTimers; ++i) {
+      // Deadlines are spread over [0, 600ms), in a shuffled order.
+      deadlines[i] = now + (i * 337 % kNumTimers) * 600us;
+      timers.push_back(tq.ScheduleTimerAt(deadlines[i], [&, i] {
+        expirations[i] = Clock::now();
+        done.count_down();
+      }));
+    }
+    done.wait();
+  }
+
+  for (int i = 0; i < kNumTimers; ++i) {
+    EXPECT_GE(expirations[i], deadlines[i]);
+    for (int j = 0; j < kNumTimers; ++j) {
+      if (deadlines[j] + TimerQueue::kTickDuration <= deadlines[i])
+        EXPECT_LE(expirations[j], expirations[i]);
+    }
+  }
+}
+
+// This test checks that cancelled timers release their callback right away.
+TEST(TimerQueueTest, TimerQueueCancelReleasesCallback) {
+  TimerQueue tq;
+  auto resource = std::make_shared<int>(0);
+  auto timer = tq.ScheduleTimer(1h, [resource] {});
+  EXPECT_EQ(resource.use_count(), 2);
+  tq.CancelTimer(timer);
+  timer.reset();
+  EXPECT_EQ(resource.use_count(), 1);
+}
+
+// Schedule and cancel timers that do not expire while the benchmark runs, with
+// `state.range(0)` other timers pending, like the deadlines of the requests
+// in flight.
+void BM_ScheduleAndCancelTimer(benchmark::State& state) {
+  TimerQueue tq;
+  std::vector<TimerQueue::TimerHandle> pending;
+  for (int i = 0; i < state.range(0); ++i)
+    pending.push_back(tq.ScheduleTimer(1h + i * 1ms, [] {}));
+
+  for (auto _ : state) {
+    auto timer = tq.ScheduleTimer(10min, [] {});
+    tq.CancelTimer(timer);
+  }
+}
+BENCHMARK(BM_ScheduleAndCancelTimer)->Arg(0)->Arg(10000);
+
+// Same as above, from several threads that share one TimerQueue.
+void BM_ScheduleAndCancelTimerContended(benchmark::State& state) {
+  static TimerQueue* tq = new TimerQueue;
+  for (auto _ : state) {
+    auto timer = tq->ScheduleTimer(10min, [] {});
+    tq->CancelTimer(timer);
+  }
+}
+BENCHMARK(BM_ScheduleAndCancelTimerContended)->Threads(8);
+
 }  // namespace
 }  // namespace tfrt
@@ -18,11 +18,13 @@
 
 #include <chrono>
 #include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "tfrt/cpp_tests/test_util.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/support/logging.h"
@@ -88,5 +90,69 @@ TEST(SingleThreadeWorkQueueTest,
   thread.join();
 }
 
+TEST(SingleThreadeWorkQueueTest, TasksRunInOrder) {
+  std::unique_ptr<ConcurrentWorkQueue> work_queue =
+      CreateSingleThreadedWorkQueue();
+  std::unique_ptr<HostAllocator> allocator = CreateMallocAllocator();
+
+  HostContext host{{}, std::move(allocator), std::move(work_queue)};
+  std::vector<int> order;
+  EnqueueWork(&host, [&] {
+    order.push_back(0);
+    // Tasks added by a running task run after the tasks added before it.
+    EnqueueWork(&host, [&] { order.push_back(2); });
+  });
+  EnqueueWork(&host, [&] { order.push_back(1); });
+  host.Quiesce();
+  EXPECT_EQ(order, std::vector<int>({0, 1, 2}));
+}
+
+TEST(SingleThreadeWorkQueueTest, BusyPollManyProducers) {
+  std::unique_ptr<ConcurrentWorkQueue> work_queue =
+      CreateSingleThreadedWorkQueue(std::chrono::microseconds(100));
+  std::unique_ptr<HostAllocator> allocator = CreateMallocAllocator();
+
+  HostContext host{{}, std::move(allocator), std::move(work_queue)};
+  constexpr int kNumThreads = 4;
+  constexpr int kNumTasks = 1000;
+  AsyncValueRef<Chain> done = MakeConstructedAsyncValueRef<Chain>(&host);
+  int num_tasks = 0;
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < kNumTasks; ++j) {
+        EnqueueWork(&host, [&] {
+          // Tasks only run on the thread in Await, so no synchronization.
+          if (++num_tasks == kNumThreads * kNumTasks) done.SetStateConcrete();
+        });
+      }
+    });
+  }
+
+  host.Await(done.CopyRCRef());
+  EXPECT_EQ(num_tasks, kNumThreads * kNumTasks);
+  for (auto& thread : threads) thread.join();
+}
+
+TEST(SingleThreadeWorkQueueTest, AwaitOnTwoThreads) {
+  std::unique_ptr<ConcurrentWorkQueue> work_queue =
+      CreateSingleThreadedWorkQueue();
+  std::unique_ptr<HostAllocator> allocator = CreateMallocAllocator();
+
+  HostContext host{{}, std::move(allocator), std::move(work_queue)};
+  AsyncValueRef<int> first = MakeConstructedAsyncValueRef<int>(&host, 1);
+  AsyncValueRef<int> second = MakeConstructedAsyncValueRef<int>(&host, 2);
+
+  // Whichever thread runs the tasks, both values become available.
+  std::thread thread{[&] { host.Await(second.CopyRCRef()); }};
+  EnqueueWork(&host, [&] { first.SetStateConcrete(); });
+  EnqueueWork(&host, [&] { second.SetStateConcrete(); });
+  host.Await(first.CopyRCRef());
+  thread.join();
+  EXPECT_TRUE(first.IsAvailable());
+  EXPECT_TRUE(second.IsAvailable());
+}
+
 }  // namespace
 }  // namespace tfrt
@@ -0,0 +1,94 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Unit test for SimpleMetricsRegistry.
+#include "tfrt/metrics/simple_metrics_registry/simple_metrics_registry.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/metrics/metrics.h"
+
+namespace tfrt {
+namespace metrics {
+namespace {
+
+using ::testing::HasSubstr;
+
+std::string ExportPrometheusText(SimpleMetricsRegistry& registry) {
+  std::string result;
+  llvm::raw_string_ostream os(result);
+  registry.ExportPrometheusText(os);
+  return os.str();
+}
+
+TEST(SimpleMetricsRegistryTest, Counter) {
+  SimpleMetricsRegistry registry;
+  Counter* counter = registry.NewCounter("/tfrt/counter");
+  EXPECT_EQ(registry.NewCounter("/tfrt/counter"), counter);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < 1000; ++j) counter->Increment();
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  counter->IncrementBy(10);
+  EXPECT_EQ(ExportPrometheusText(registry),
+            "# TYPE tfrt_counter counter\n"
+            "tfrt_counter 4010\n");
+}
+
+TEST(SimpleMetricsRegistryTest, Gauges) {
+  SimpleMetricsRegistry registry;
+  registry.NewIntGauge("/tfrt/int_gauge")->Set(42);
+  registry.NewStringGauge("/tfrt/string_gauge")->Set("a\"b");
+  EXPECT_EQ(ExportPrometheusText(registry),
+            "# TYPE tfrt_int_gauge gauge\n"
+            "tfrt_int_gauge 42\n"
+            "# TYPE tfrt_string_gauge gauge\n"
+            "tfrt_string_gauge{value=\"a\\\"b\"} 1\n");
+}
+
+TEST(SimpleMetricsRegistryTest, Histogram) {
+  SimpleMetricsRegistry registry;
+  Histogram* histogram = registry.NewHistogram(
+      "/tfrt/histogram.us", Buckets::Explicit({1, 10, 100}));
+  for (double value : {0.5, 1.0, 5.0, 50.0, 50.0, 500.0})
+    histogram->Record(value);
+  EXPECT_EQ(ExportPrometheusText(registry),
+            "# TYPE tfrt_histogram_us histogram\n"
+            "tfrt_histogram_us_bucket{le=\"1\"} 1\n"
+            "tfrt_histogram_us_bucket{le=\"10\"} 3\n"
+            "tfrt_histogram_us_bucket{le=\"100\"} 5\n"
+            "tfrt_histogram_us_bucket{le=\"+Inf\"} 6\n"
+            "tfrt_histogram_us_sum 606.5\n"
+            "tfrt_histogram_us_count 6\n");
+}
+
+TEST(SimpleMetricsRegistryTest, GlobalRegistry) {
+  RegisterMetricsRegistry(GetGlobalSimpleMetricsRegistry());
+  NewCounter("/tfrt/global_counter")->Increment();
+  EXPECT_THAT(ExportPrometheusText(*GetGlobalSimpleMetricsRegistry()),
+              HasSubstr("tfrt_global_counter 1\n"));
+}
+
+}  // namespace
+}  // namespace metrics
+}  // namespace tfrt
@@ -133,6 +133,38 @@ TEST_F(BefReaderTest, ReadIntThreeBytes) {
   EXPECT_EQ(16643, value);
 }
 
+TEST_F(BefReaderTest, ReadInt4) {
+  BEFReader reader(array_ref_);
+  uint32_t value = 0;
+  EXPECT_TRUE(reader.ReadInt4(&value));
+  EXPECT_EQ(0x03020100, value);
+  EXPECT_TRUE(reader.ReadInt4(&value));
+  EXPECT_EQ(0x07060504, value);
+
+  // Should fail: only two bytes are left.
+  EXPECT_FALSE(reader.ReadInt4(&value));
+}
+
+TEST_F(BefReaderTest, ReadInt4Unaligned) {
+  BEFReader reader(array_ref_);
+  reader.SkipOffset(1);
+  uint32_t value = 0;
+  EXPECT_FALSE(reader.ReadInt4(&value));
+}
+
+TEST_F(BefReaderTest, ReadFunctionTableInt) {
+  uint8_t vbr_content[] = {0x81, 0x02};
+  BEFReader vbr_reader{vbr_content};
+  size_t value = 0;
+  EXPECT_TRUE(vbr_reader.ReadFunctionTableInt(&value, /*fixed_width=*/false));
+  EXPECT_EQ(130, value);
+
+  BEFReader fixed_width_reader(array_ref_);
+  EXPECT_TRUE(
+      fixed_width_reader.ReadFunctionTableInt(&value, /*fixed_width=*/true));
+  EXPECT_EQ(0x03020100, value);
+}
+
 TEST_F(BefReaderTest, ReadAlignmentAlreadyAligned) {
   BEFReader reader(array_ref_);
 
@@ -16,15 +16,24 @@
 
 #include "tfrt/support/concurrent_vector.h"
 
+#include <memory>
 #include <thread>
 
+#include "benchmark/benchmark.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 namespace {
 
-TEST(ConcurrentVectorTest, SingleThreaded) {
-  tfrt::ConcurrentVector<int> vec(1);
+template <typename Vector>
+class ConcurrentVectorTest : public testing::Test {};
+
+using VectorTypes = testing::Types<tfrt::ConcurrentVector<int>,
+                                   tfrt::SegmentedConcurrentVector<int>>;
+TYPED_TEST_SUITE(ConcurrentVectorTest, VectorTypes);
+
+TYPED_TEST(ConcurrentVectorTest, SingleThreaded) {
+  TypeParam vec(1);
 
   constexpr int kCount = 1000;
 
@@ -37,8 +46,8 @@ TEST(ConcurrentVectorTest, SingleThreaded) {
   }
 }
 
-TEST(ConcurrentVectorTest, OneWriterOneReader) {
-  tfrt::ConcurrentVector<int> vec(1);
+TYPED_TEST(ConcurrentVectorTest, OneWriterOneReader) {
+  TypeParam vec(1);
 
   constexpr int kCount = 1000;
 
@@ -60,8 +69,8 @@ TEST(ConcurrentVectorTest, OneWriterOneReader) {
   reader.join();
 }
 
-TEST(ConcurrentVectorTest, TwoWritersTwoReaders) {
-  tfrt::ConcurrentVector<int> vec(1);
+TYPED_TEST(ConcurrentVectorTest, TwoWritersTwoReaders) {
+  TypeParam vec(1);
 
   constexpr int kCount = 1000;
 
@@ -101,4 +110,99 @@ TEST(ConcurrentVectorTest, TwoWritersTwoReaders) {
   reader2.join();
 }
 
+TEST(SegmentedConcurrentVectorTest, ElementsDontMove) {
+  tfrt::SegmentedConcurrentVector<std::unique_ptr<int>> vec(3);
+
+  constexpr int kCount = 1000;
+
+  std::vector<std::unique_ptr<int>*> addresses;
+  for (int i = 0; i < kCount; ++i) {
+    ASSERT_EQ(i, vec.emplace_back(std::make_unique<int>(i)));
+    addresses.push_back(&vec[i]);
+  }
+
+  for (int i = 0; i < kCount; ++i) {
+    EXPECT_EQ(addresses[i], &vec[i]);
+    EXPECT_EQ(i, *vec[i]);
+  }
+}
+
+TEST(SegmentedConcurrentVectorTest, ManyWriters) {
+  tfrt::SegmentedConcurrentVector<int> vec(1);
+
+  constexpr int kNumWriters = 8;
+  constexpr int kCount = 10000;
+
+  // Each writer stores from 0 to kCount - 1 to the vector.
+  std::vector<std::thread> writers;
+  for (int i = 0; i < kNumWriters; ++i) {
+    writers.emplace_back([&] {
+      for (int j = 0; j < kCount; ++j) vec.emplace_back(j);
+    });
+  }
+  for (auto& writer : writers) writer.join();
+
+  ASSERT_EQ(vec.size(), kNumWriters * kCount);
+  std::vector<int> counts(kCount);
+  for (int i = 0; i < kNumWriters * kCount; ++i) ++counts[vec[i]];
+  for (int count : counts) EXPECT_EQ(count, kNumWriters);
+}
+
+// A type info sized element, like the entries of the AsyncValue type info
+// table that is filled at startup.
+struct Entry {
+  void* functions[4];
+};
+
+// Emplaces `range(0)` elements into a new vector from `range(1)` threads, like
+// the registration of types and kernels at startup.
+template <typename Vector>
+void BM_Registration(benchmark::State& state) {
+  const int num_elements = state.range(0);
+  const int num_threads = state.range(1);
+  for (auto _ : state) {
+    Vector vec(1);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&] {
+        for (int j = 0; j < num_elements / num_threads; ++j)
+          vec.emplace_back(Entry{});
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    benchmark::DoNotOptimize(vec[0]);
+  }
+  state.SetItemsProcessed(state.iterations() * num_elements);
+}
+
+BENCHMARK_TEMPLATE(BM_Registration, tfrt::ConcurrentVector<Entry>)
+    ->ArgPair(1000, 1)
+    ->ArgPair(100000, 1)
+    ->ArgPair(100000, 4)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Registration, tfrt::SegmentedConcurrentVector<Entry>)
+    ->ArgPair(1000, 1)
+    ->ArgPair(100000, 1)
+    ->ArgPair(100000, 4)
+    ->UseRealTime();
+
+template <typename Vector>
+void BM_Read(benchmark::State& state) {
+  const int num_elements = state.range(0);
+  Vector vec(64);
+  for (int i = 0; i < num_elements; ++i) vec.emplace_back(i);
+
+  for (auto _ : state) {
+    int sum = 0;
+    for (int i = 0; i < num_elements; ++i) sum += vec[i];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * num_elements);
+}
+
+BENCHMARK_TEMPLATE(BM_Read, tfrt::ConcurrentVector<int>)->Arg(64)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_Read, tfrt::SegmentedConcurrentVector<int>)
+    ->Arg(64)
+    ->Arg(4096);
+
 }  // namespace
@@ -0,0 +1,113 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests and benchmarks for crc32c.
+
+#include "tfrt/support/crc32c.h"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace tfrt {
+namespace {
+
+// Bitwise crc32c, independent of the table and the accelerated versions.
+uint32_t ReferenceExtend(uint32_t crc, const char* buf, size_t size) {
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= static_cast<uint8_t>(buf[i]);
+    for (int bit = 0; bit < 8; ++bit)
+      crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78u : 0);
+  }
+  return ~crc;
+}
+
+std::vector<char> RandomBytes(size_t size) {
+  std::mt19937 gen(42);
+  std::vector<char> bytes(size);
+  for (auto& byte : bytes) byte = static_cast<char>(gen());
+  return bytes;
+}
+
+TEST(Crc32cTest, StandardResults) {
+  // From rfc3720 section B.4.
+  char buf[32];
+
+  memset(buf, 0, sizeof(buf));
+  EXPECT_EQ(0x8a9136aa, crc32c::Value(buf, sizeof(buf)));
+
+  memset(buf, 0xff, sizeof(buf));
+  EXPECT_EQ(0x62a8ab43, crc32c::Value(buf, sizeof(buf)));
+
+  for (int i = 0; i < 32; ++i) buf[i] = i;
+  EXPECT_EQ(0x46dd794e, crc32c::Value(buf, sizeof(buf)));
+
+  for (int i = 0; i < 32; ++i) buf[i] = 31 - i;
+  EXPECT_EQ(0x113fdb5c, crc32c::Value(buf, sizeof(buf)));
+
+  EXPECT_EQ(0xe3069283, crc32c::Value("123456789", 9));
+}
+
+TEST(Crc32cTest, MatchesReference) {
+  // Cover the tails, the interleaved blocks and the folded blocks of the
+  // accelerated versions, at all alignments.
+  auto bytes = RandomBytes(16 * 1024);
+  std::mt19937 gen(0);
+  for (size_t size = 0; size < 12 * 1024; size += size < 1024 ? 1 : 61) {
+    for (size_t offset = 0; offset < 8; ++offset) {
+      uint32_t crc = gen();
+      ASSERT_EQ(crc32c::Extend(crc, bytes.data() + offset, size),
+                ReferenceExtend(crc, bytes.data() + offset, size))
+          << "size " << size << ", offset " << offset;
+    }
+  }
+}
+
+TEST(Crc32cTest, Extend) {
+  auto bytes = RandomBytes(10000);
+  uint32_t crc = crc32c::Value(bytes.data(), bytes.size());
+  for (size_t split : {0, 1, 7, 300, 3000, 9999}) {
+    uint32_t extended = crc32c::Extend(crc32c::Value(bytes.data(), split),
+                                       bytes.data() + split,
+                                       bytes.size() - split);
+    EXPECT_EQ(crc, extended) << "split " << split;
+  }
+}
+
+TEST(Crc32cTest, Mask) {
+  uint32_t crc = crc32c::Value("foo", 3);
+  EXPECT_NE(crc, crc32c::Mask(crc));
+  EXPECT_NE(crc, crc32c::Mask(crc32c::Mask(crc)));
+  EXPECT_EQ(crc, crc32c::Unmask(crc32c::Mask(crc)));
+  EXPECT_EQ(crc,
+            crc32c::Unmask(crc32c::Unmask(crc32c::Mask(crc32c::Mask(crc)))));
+}
+
+void BM_Crc32c(benchmark::State& state) {
+  auto bytes = RandomBytes(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(crc32c::Value(bytes.data(), bytes.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_Crc32c)->Range(16, 16 << 20);
+
+}  // namespace
+}  // namespace tfrt
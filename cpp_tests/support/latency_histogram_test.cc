@@ -0,0 +1,99 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for LatencyHistogram.
+
+#include "tfrt/support/latency_histogram.h"
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tfrt {
+namespace {
+
+using std::chrono::nanoseconds;
+
+TEST(LatencyHistogramTest, Empty) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.count(), 0);
+  EXPECT_EQ(histogram.Min(), nanoseconds(0));
+  EXPECT_EQ(histogram.Max(), nanoseconds(0));
+  EXPECT_EQ(histogram.Mean(), nanoseconds(0));
+  EXPECT_EQ(histogram.Percentile(50), nanoseconds(0));
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+  LatencyHistogram histogram;
+  for (int i = 1; i <= 100; ++i) histogram.Record(nanoseconds(i));
+  EXPECT_EQ(histogram.count(), 100);
+  EXPECT_EQ(histogram.Min(), nanoseconds(1));
+  EXPECT_EQ(histogram.Max(), nanoseconds(100));
+  EXPECT_EQ(histogram.Mean(), nanoseconds(50));
+  EXPECT_EQ(histogram.Percentile(0), nanoseconds(1));
+  EXPECT_EQ(histogram.Percentile(50), nanoseconds(50));
+  EXPECT_EQ(histogram.Percentile(99), nanoseconds(99));
+  EXPECT_EQ(histogram.Percentile(100), nanoseconds(100));
+}
+
+TEST(LatencyHistogramTest, RelativeError) {
+  LatencyHistogram histogram;
+  // One value per microsecond up to 1 second.
+  const int64_t num_values = 1000000;
+  for (int64_t i = 1; i <= num_values; ++i)
+    histogram.Record(std::chrono::microseconds(i));
+
+  for (double percentile : {1.0, 50.0, 90.0, 99.0, 99.9}) {
+    double expected = percentile / 100 * num_values * 1000;
+    double actual = histogram.Percentile(percentile).count();
+    EXPECT_GE(actual, expected) << percentile;
+    EXPECT_LE(actual, expected * 1.02) << percentile;
+  }
+  EXPECT_EQ(histogram.Percentile(100), std::chrono::seconds(1));
+}
+
+TEST(LatencyHistogramTest, LargeValues) {
+  LatencyHistogram histogram;
+  const auto max = nanoseconds(std::numeric_limits<int64_t>::max());
+  histogram.Record(max);
+  histogram.Record(std::chrono::hours(1));
+  EXPECT_EQ(histogram.Max(), max);
+  EXPECT_EQ(histogram.Percentile(100), max);
+  EXPECT_GE(histogram.Percentile(50), std::chrono::hours(1));
+  EXPECT_LE(histogram.Percentile(50), std::chrono::minutes(62));
+}
+
+TEST(LatencyHistogramTest, ConcurrentRecord) {
+  LatencyHistogram histogram;
+  const int num_threads = 4;
+  const int num_values = 10000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 1; j <= num_values; ++j) histogram.Record(nanoseconds(j));
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(histogram.count(), num_threads * num_values);
+  EXPECT_EQ(histogram.Min(), nanoseconds(1));
+  EXPECT_EQ(histogram.Max(), nanoseconds(num_values));
+}
+
+}  // namespace
+}  // namespace tfrt
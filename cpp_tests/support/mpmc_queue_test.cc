@@ -0,0 +1,204 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for BoundedMpmcQueue
+
+#include "tfrt/support/mpmc_queue.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using tfrt::BoundedMpmcQueue;
+
+TEST(BoundedMpmcQueueTest, Capacity) {
+  EXPECT_EQ(BoundedMpmcQueue<int>(1).capacity(), 2);
+  EXPECT_EQ(BoundedMpmcQueue<int>(4).capacity(), 4);
+  EXPECT_EQ(BoundedMpmcQueue<int>(5).capacity(), 8);
+}
+
+TEST(BoundedMpmcQueueTest, SingleThreaded) {
+  BoundedMpmcQueue<int> queue(4);
+  EXPECT_FALSE(queue.TryPop().hasValue());
+
+  // Wraps around the ring several times.
+  for (int lap = 0; lap < 3; ++lap) {
+    for (int i = 0; i < 4; ++i) EXPECT_TRUE(queue.TryPush(lap * 4 + i));
+    EXPECT_FALSE(queue.TryPush(-1));
+    EXPECT_EQ(queue.size(), 4);
+    for (int i = 0; i < 4; ++i) EXPECT_EQ(*queue.TryPop(), lap * 4 + i);
+    EXPECT_FALSE(queue.TryPop().hasValue());
+  }
+}
+
+TEST(BoundedMpmcQueueTest, MoveOnly) {
+  BoundedMpmcQueue<std::unique_ptr<int>> queue(2);
+  EXPECT_TRUE(queue.TryPush(std::make_unique<int>(1)));
+  EXPECT_TRUE(queue.TryEmplace(new int(2)));
+
+  // A failed push leaves the value alone.
+  auto value = std::make_unique<int>(3);
+  EXPECT_FALSE(queue.TryPush(std::move(value)));
+  ASSERT_NE(value, nullptr);
+
+  EXPECT_EQ(**queue.TryPop(), 1);
+  EXPECT_EQ(**queue.TryPop(), 2);
+}
+
+TEST(BoundedMpmcQueueTest, DestroysRemainingElements) {
+  auto value = std::make_shared<int>(0);
+  {
+    BoundedMpmcQueue<std::shared_ptr<int>> queue(8);
+    for (int i = 0; i < 5; ++i) queue.TryPush(value);
+    EXPECT_EQ(value.use_count(), 6);
+  }
+  EXPECT_EQ(value.use_count(), 1);
+}
+
+// Every pushed value is popped exactly once, and the values of each producer
+// are popped in order by each consumer.
+TEST(BoundedMpmcQueueTest, ManyProducersManyConsumers) {
+  constexpr int kThreads = 4;
+  constexpr int kCount = 100000;
+  BoundedMpmcQueue<int> queue(64);
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kThreads; ++p) {
+    threads.emplace_back([&queue, p] {
+      for (int i = 0; i < kCount; ++i) {
+        while (!queue.TryPush(p * kCount + i)) std::this_thread::yield();
+      }
+    });
+  }
+
+  std::atomic<int> num_popped{0};
+  std::vector<std::vector<int>> popped(kThreads);
+  for (int c = 0; c < kThreads; ++c) {
+    threads.emplace_back([&, c] {
+      std::vector<int> last(kThreads, -1);
+      while (num_popped.load() < kThreads * kCount) {
+        if (auto value = queue.TryPop()) {
+          ++num_popped;
+          int producer = *value / kCount;
+          EXPECT_GT(*value, last[producer]);
+          last[producer] = *value;
+          popped[c].push_back(*value);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  std::vector<bool> seen(kThreads * kCount);
+  for (const auto& values : popped) {
+    for (int value : values) {
+      EXPECT_FALSE(seen[value]) << value;
+      seen[value] = true;
+    }
+  }
+  EXPECT_EQ(num_popped.load(), kThreads * kCount);
+  EXPECT_FALSE(queue.TryPop().hasValue());
+}
+
+// The mutex and std::queue buffer that BoundedMpmcQueue replaces.
+template <typename T>
+class MutexQueue {
+ public:
+  explicit MutexQueue(size_t capacity) : capacity_(capacity) {}
+
+  bool TryPush(T value) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (queue_.size() == capacity_) return false;
+    queue_.push(std::move(value));
+    return true;
+  }
+
+  llvm::Optional<T> TryPop() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (queue_.empty()) return llvm::None;
+    llvm::Optional<T> value(std::move(queue_.front()));
+    queue_.pop();
+    return value;
+  }
+
+ private:
+  const size_t capacity_;
+  std::mutex mu_;
+  std::queue<T> queue_;
+};
+
+// Passes values from `range(0)` producers to as many consumers.
+template <typename Queue>
+void BM_ProducerConsumer(benchmark::State& state) {
+  constexpr int kCount = 100000;
+  const int num_threads = state.range(0);
+  for (auto _ : state) {
+    Queue queue(1024);
+    std::atomic<int> num_popped{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&] {
+        for (int j = 0; j < kCount; ++j) {
+          while (!queue.TryPush(j)) std::this_thread::yield();
+        }
+      });
+      threads.emplace_back([&] {
+        while (num_popped.load(std::memory_order_relaxed) <
+               num_threads * kCount) {
+          if (queue.TryPop())
+            num_popped.fetch_add(1, std::memory_order_relaxed);
+          else
+            std::this_thread::yield();
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  }
+  state.SetItemsProcessed(state.iterations() * num_threads * kCount);
+}
+
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, BoundedMpmcQueue<int>)
+    ->Arg(1)
+    ->Arg(4)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, MutexQueue<int>)
+    ->Arg(1)
+    ->Arg(4)
+    ->UseRealTime();
+
+// Pushes and pops one value on a single thread.
+template <typename Queue>
+void BM_PushPop(benchmark::State& state) {
+  Queue queue(1024);
+  for (auto _ : state) {
+    queue.TryPush(1);
+    benchmark::DoNotOptimize(queue.TryPop());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_PushPop, BoundedMpmcQueue<int>);
+BENCHMARK_TEMPLATE(BM_PushPop, MutexQueue<int>);
+
+}  // namespace
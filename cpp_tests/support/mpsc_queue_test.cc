@@ -0,0 +1,164 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for MpscQueue
+
+#include "tfrt/support/mpsc_queue.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using tfrt::MpscQueue;
+using tfrt::MpscQueueNode;
+
+struct Item : MpscQueueNode {
+  explicit Item(int value = 0) : value(value) {}
+  int value;
+};
+
+TEST(MpscQueueTest, SingleThreaded) {
+  MpscQueue<Item> queue;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(queue.Pop(), nullptr);
+
+  std::deque<Item> items;
+  for (int i = 0; i < 10; ++i) items.emplace_back(i);
+
+  // Alternates between a single element and several elements, which takes the
+  // different paths around the stub node.
+  for (int round = 0; round < 3; ++round) {
+    queue.Push(&items[0]);
+    EXPECT_FALSE(queue.empty());
+    EXPECT_EQ(queue.Pop(), &items[0]);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.Pop(), nullptr);
+
+    for (auto& item : items) queue.Push(&item);
+    for (int i = 0; i < 5; ++i) EXPECT_EQ(queue.Pop()->value, i);
+    // Elements can be pushed again once they are popped.
+    for (int i = 0; i < 5; ++i) queue.Push(&items[i]);
+    for (int i = 5; i < 10; ++i) EXPECT_EQ(queue.Pop()->value, i);
+    for (int i = 0; i < 5; ++i) EXPECT_EQ(queue.Pop()->value, i);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.Pop(), nullptr);
+  }
+}
+
+// Every pushed element is popped exactly once, in the order of each producer.
+TEST(MpscQueueTest, ManyProducers) {
+  constexpr int kProducers = 4;
+  constexpr int kCount = 100000;
+  MpscQueue<Item> queue;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&queue, p] {
+      for (int i = 0; i < kCount; ++i) queue.Push(new Item(p * kCount + i));
+    });
+  }
+
+  std::vector<int> last;
+  for (int p = 0; p < kProducers; ++p) last.push_back(p * kCount - 1);
+  for (int num_popped = 0; num_popped < kProducers * kCount;) {
+    std::unique_ptr<Item> item(queue.Pop());
+    if (!item) {
+      std::this_thread::yield();
+      continue;
+    }
+    int producer = item->value / kCount;
+    ASSERT_EQ(item->value, last[producer] + 1);
+    last[producer] = item->value;
+    ++num_popped;
+  }
+  for (auto& producer : producers) producer.join();
+  EXPECT_TRUE(queue.empty());
+}
+
+// The mutex and std::queue buffer that MpscQueue replaces.
+class MutexQueue {
+ public:
+  void Push(Item* item) {
+    std::lock_guard<std::mutex> lock(mu_);
+    queue_.push(item);
+  }
+
+  Item* Pop() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (queue_.empty()) return nullptr;
+    Item* item = queue_.front();
+    queue_.pop();
+    return item;
+  }
+
+ private:
+  std::mutex mu_;
+  std::queue<Item*> queue_;
+};
+
+// Passes elements from `range(0)` producers to one consumer.
+template <typename Queue>
+void BM_ManyProducers(benchmark::State& state) {
+  constexpr int kCount = 100000;
+  const int num_producers = state.range(0);
+  std::unique_ptr<Item[]> items(new Item[num_producers * kCount]);
+  for (auto _ : state) {
+    Queue queue;
+    std::vector<std::thread> producers;
+    for (int i = 0; i < num_producers; ++i) {
+      producers.emplace_back([&, i] {
+        for (int j = 0; j < kCount; ++j) queue.Push(&items[i * kCount + j]);
+      });
+    }
+    for (int num_popped = 0; num_popped < num_producers * kCount;) {
+      if (queue.Pop())
+        ++num_popped;
+      else
+        std::this_thread::yield();
+    }
+    for (auto& producer : producers) producer.join();
+  }
+  state.SetItemsProcessed(state.iterations() * num_producers * kCount);
+}
+
+BENCHMARK_TEMPLATE(BM_ManyProducers, MpscQueue<Item>)
+    ->Arg(1)
+    ->Arg(4)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ManyProducers, MutexQueue)->Arg(1)->Arg(4)->UseRealTime();
+
+// Pushes and pops one element on a single thread.
+template <typename Queue>
+void BM_PushPop(benchmark::State& state) {
+  Queue queue;
+  Item item(1);
+  for (auto _ : state) {
+    queue.Push(&item);
+    benchmark::DoNotOptimize(queue.Pop());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_PushPop, MpscQueue<Item>);
+BENCHMARK_TEMPLATE(BM_PushPop, MutexQueue);
+
+}  // namespace
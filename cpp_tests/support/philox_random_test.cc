@@ -16,6 +16,9 @@
 
 #include "tfrt/support/philox_random.h"
 
+#include <vector>
+
+#include "benchmark/benchmark.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -28,5 +31,62 @@ TEST(PhiloxRandomTest, GenerateNumber) {
   EXPECT_THAT(generator(), 3724722508);
 }
 
+// Fill() and Skip() must return the same values as calls of operator(), for
+// any alignment to the 128-bit samples and across counter overflows.
+TEST(PhiloxRandomTest, FillMatchesOperator) {
+  const uint64_t kSamples = 4;  // 32-bit values per sample.
+  for (uint64_t skip : {uint64_t{0}, uint64_t{3}, (kSamples << 32) - 77,
+                        (kSamples << 32) * 0xffffffff - 77}) {
+    for (size_t size : {0, 1, 5, 32, 33, 63, 64, 65, 200, 1001}) {
+      for (int offset : {0, 1, 3}) {
+        random::PhiloxRandom expected(100, 200), generator(100, 200);
+        expected.Skip(skip);
+        generator.Skip(skip);
+        for (int i = 0; i < offset; ++i) ASSERT_EQ(generator(), expected());
+
+        std::vector<uint32_t> values(size);
+        generator.Fill(values.data(), size);
+        for (size_t i = 0; i < size; ++i)
+          ASSERT_EQ(values[i], expected()) << "skip " << skip << " at " << i;
+        EXPECT_EQ(generator(), expected());
+      }
+    }
+  }
+}
+
+TEST(PhiloxRandomTest, Skip) {
+  for (uint64_t skip : {0, 1, 3, 4, 5, 8, 101}) {
+    for (int offset : {0, 1, 3}) {
+      random::PhiloxRandom expected(100, 200), generator(100, 200);
+      for (int i = 0; i < offset; ++i) ASSERT_EQ(generator(), expected());
+      generator.Skip(skip);
+      for (uint64_t i = 0; i < skip; ++i) expected();
+      for (int i = 0; i < 10; ++i) EXPECT_EQ(generator(), expected());
+    }
+  }
+}
+
+static void BM_PhiloxOperator(benchmark::State& state) {
+  random::PhiloxRandom generator(100, 200);
+  std::vector<uint32_t> values(state.range(0));
+  for (auto _ : state) {
+    for (auto& value : values) value = generator();
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetBytesProcessed(state.iterations() * values.size() * 4);
+}
+BENCHMARK(BM_PhiloxOperator)->Arg(1 << 16);
+
+static void BM_PhiloxFill(benchmark::State& state) {
+  random::PhiloxRandom generator(100, 200);
+  std::vector<uint32_t> values(state.range(0));
+  for (auto _ : state) {
+    generator.Fill(values.data(), values.size());
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetBytesProcessed(state.iterations() * values.size() * 4);
+}
+BENCHMARK(BM_PhiloxFill)->Arg(1 << 16);
+
 }  // namespace
 }  // namespace tfrt
@@ -17,6 +17,7 @@
 #include "tfrt/support/ref_count.h"
 
 #include "gtest/gtest.h"
+#include "tfrt/support/rc_array.h"
 
 namespace tfrt {
 namespace {
@@ -46,6 +47,34 @@ TEST(RefCountTest, ReferenceCountedIsNotUnique) {
   wi->DropRef();
 }
 
+TEST(RefCountTest, ReferenceCountedAddDropMany) {
+  WrappedInt32* wi = new WrappedInt32(123);
+  wi->AddRef(3);
+  EXPECT_EQ(wi->NumRef(), 4);
+  wi->AddRef(0);
+  wi->DropRef(2);
+  EXPECT_EQ(wi->NumRef(), 2);
+  wi->DropRef(0);
+  EXPECT_EQ(wi->NumRef(), 2);
+  wi->DropRef(2);
+}
+
+TEST(RefCountTest, RCArrayRepeatedValues) {
+  RCReference<WrappedInt32> a = MakeRef<WrappedInt32>(1);
+  RCReference<WrappedInt32> b = MakeRef<WrappedInt32>(2);
+  {
+    RCArray<WrappedInt32> array(
+        llvm::ArrayRef<WrappedInt32*>{a.get(), a.get(), b.get(), a.get()});
+    EXPECT_EQ(a->NumRef(), 4);
+    EXPECT_EQ(b->NumRef(), 2);
+    RCArray<WrappedInt32> copy = array.CopyRef();
+    EXPECT_EQ(a->NumRef(), 7);
+    EXPECT_EQ(copy[3], a.get());
+  }
+  EXPECT_EQ(a->NumRef(), 1);
+  EXPECT_EQ(b->NumRef(), 1);
+}
+
 TEST(RefCountTest, RCReferenceBasic) {
   RCReference<WrappedInt32> rwi = MakeRef<WrappedInt32>(123);
   EXPECT_EQ(123, rwi->value());
@@ -0,0 +1,56 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for selective registration.
+
+#include "tfrt/support/selective_registration.h"
+
+#include "gtest/gtest.h"
+#include "tfrt/support/op_registry_impl.h"
+
+namespace tfrt {
+namespace {
+
+// Selective registration is process-wide, like the code that bef_deps
+// generates.
+static const char* const kKernelNames[] = {"tfrt.add.i32", "tfrt.print.i32"};
+static const char* const kOpNames[] = {"tf.AddV2"};
+TFRT_STATIC_SELECTIVE_REGISTRATION(kKernelNames, kOpNames);
+
+TEST(SelectiveRegistrationTest, Kernels) {
+  EXPECT_TRUE(ShouldRegisterKernel("tfrt.add.i32"));
+  EXPECT_FALSE(ShouldRegisterKernel("tfrt.add.i64"));
+  EXPECT_FALSE(ShouldRegisterKernel("tf.AddV2"));
+}
+
+TEST(SelectiveRegistrationTest, KernelFamilies) {
+  EXPECT_TRUE(ShouldRegisterKernelFamily("tfrt."));
+  EXPECT_FALSE(ShouldRegisterKernelFamily("tfrt_gpu."));
+}
+
+TEST(SelectiveRegistrationTest, OpRegistry) {
+  using Registry = OpRegistryImpl<void (*)(), void (*)(), int>;
+  Registry registry;
+  auto dispatch_fn = +[] {};
+  registry.AddOp("tf.AddV2", dispatch_fn, /*flags=*/0, {});
+  registry.AddOp("tf.MatMul", dispatch_fn, /*flags=*/0, {});
+  registry.AddMetadataFn("tf.MatMul", dispatch_fn);
+
+  EXPECT_EQ(registry.LookupOpEntry("tf.AddV2")->dispatch_fn, dispatch_fn);
+  EXPECT_EQ(registry.LookupOpEntry("tf.MatMul")->dispatch_fn, nullptr);
+  EXPECT_EQ(registry.LookupOpEntry("tf.MatMul")->metadata_fn, nullptr);
+}
+
+}  // namespace
+}  // namespace tfrt
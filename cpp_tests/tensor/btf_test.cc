@@ -16,9 +16,15 @@
 
 // Unit test for BTF utils.
 
+#include <fstream>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
 #include "tfrt/tensor/btf_util.h"
 
 namespace tfrt {
@@ -45,5 +51,113 @@ TEST(BTFTest, BTFWriteAndRead) {
   }
 }
 
+TEST(BTFTest, MappedBTFFile) {
+  auto context = CreateHostContext();
+  const auto a = CreateDummyTensor<float>({3, 2}, context.get());
+  const auto b = CreateDummyTensor<uint8_t>({63}, context.get());
+  const auto c = CreateDummyTensor<int64_t>({0}, context.get());
+  std::vector<const Tensor*> tensors{&a, &b, &c};
+
+  const std::string path = testing::TempDir() + "/mapped_btf_file.btf";
+  {
+    std::ofstream os(path, std::ios_base::binary);
+    ASSERT_FALSE(WriteTensorsToBTF(&os, tensors));
+  }
+
+  // Tensors keep the mapping alive after the file is closed.
+  DenseHostTensor first;
+  {
+    auto file = MappedBTFFile::Open(path);
+    ASSERT_TRUE(!!file);
+    EXPECT_EQ(file->NumTensors(), tensors.size());
+    for (int i = 0; i < tensors.size(); i++) {
+      const auto& expected =
+          reinterpret_cast<const DenseHostTensor&>(*tensors[i]);
+      auto out = file->ReadDHT(i);
+      ASSERT_TRUE(!!out);
+      EXPECT_EQ(*out, expected);
+      // The tensor aliases the mapped file instead of owning a copy.
+      EXPECT_FALSE(out->buffer()->IsExclusiveDataOwner());
+      if (i == 0) first = std::move(*out);
+    }
+    EXPECT_FALSE(!!file->ReadDHT(tensors.size()));
+  }
+  EXPECT_EQ(first, a);
+
+  auto dht = MapDHTFromBTF(path, 1, DType(DType::UI8), 1);
+  ASSERT_TRUE(!!dht);
+  EXPECT_EQ(*dht, b);
+  EXPECT_FALSE(!!MapDHTFromBTF(path, 1, DType(DType::I32), 1));
+  EXPECT_FALSE(!!MapDHTFromBTF(path, 1, DType(DType::UI8), 2));
+  EXPECT_FALSE(!!MappedBTFFile::Open(path + ".missing"));
+}
+
+TEST(BTFTest, ChunkedWriteAndRead) {
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(4, 4));
+  auto request_ctx =
+      RequestContextBuilder(host.get(), /*resource_context=*/nullptr).build();
+  ASSERT_TRUE(!!request_ctx);
+  ExecutionContext exec_ctx(std::move(*request_ctx));
+
+  const auto a = CreateDummyTensor<float>({64, 33}, host.get());
+  const auto b = CreateDummyTensor<uint8_t>({63}, host.get());
+  const auto c = CreateDummyTensor<int64_t>({0}, host.get());
+  std::vector<const DenseHostTensor*> tensors{&a, &b, &c};
+
+  const std::string path = testing::TempDir() + "/chunked_btf_file.btf";
+  auto written =
+      WriteChunkedTensorsToBTF(path, tensors, /*chunk_size=*/100, exec_ctx);
+  host->Await(written.CopyRCRef());
+  ASSERT_FALSE(written.IsError());
+
+  {
+    auto file = MappedBTFFile::Open(path);
+    ASSERT_TRUE(!!file);
+    EXPECT_EQ(file->NumTensors(), tensors.size());
+    for (int i = 0; i < tensors.size(); i++) {
+      auto out = file->ReadDHT(i);
+      ASSERT_TRUE(!!out);
+      EXPECT_EQ(*out, *tensors[i]);
+
+      auto verified = file->VerifyChecksums(i, exec_ctx);
+      host->Await(verified.CopyRCRef());
+      EXPECT_FALSE(verified.IsError());
+    }
+  }
+
+  std::ifstream is(path, std::ios_base::binary);
+  auto offsets = ReadBTFOffsets(&is);
+  ASSERT_TRUE(!!offsets);
+  ASSERT_EQ(offsets->size(), tensors.size());
+  for (int i = 0; i < tensors.size(); i++) {
+    auto out = ReadDHTFromBTF(&is, (*offsets)[i], host.get());
+    ASSERT_TRUE(!!out);
+    EXPECT_EQ(*out, *tensors[i]);
+  }
+
+  // Corrupt the last byte of the first tensor, whose data needs no padding.
+  {
+    std::fstream fs(path, std::ios_base::binary | std::ios_base::in |
+                              std::ios_base::out);
+    const uint64_t last_byte = (*offsets)[1] - 1;
+    fs.seekg(last_byte);
+    const char value = fs.get() ^ 1;
+    fs.seekp(last_byte);
+    fs.put(value);
+  }
+
+  auto file = MappedBTFFile::Open(path);
+  ASSERT_TRUE(!!file);
+  auto verified = file->VerifyChecksums(0, exec_ctx);
+  host->Await(verified.CopyRCRef());
+  EXPECT_TRUE(verified.IsError());
+
+  std::ifstream corrupted(path, std::ios_base::binary);
+  EXPECT_FALSE(!!ReadDHTFromBTF(&corrupted, (*offsets)[0], host.get()));
+  EXPECT_TRUE(!!ReadDHTFromBTF(&corrupted, (*offsets)[1], host.get()));
+}
+
 }  // namespace
 }  // namespace tfrt
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for CsrHostTensor.
+
+#include "tfrt/tensor/csr_host_tensor.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/coo_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+namespace {
+
+using testing::ElementsAre;
+
+class CsrHostTensorTest : public ::testing::Test {
+ protected:
+  // Returns a [3, 4] COO tensor with the elements listed out of row order.
+  CooHostTensor CreateCooTensor() {
+    auto indices = DenseHostTensor::CreateUninitialized<int64_t>(
+        TensorShape({4, 2}), host_.get());
+    auto values = DenseHostTensor::CreateUninitialized<float>(TensorShape(4),
+                                                              host_.get());
+    MutableDHTArrayView<int64_t> indices_view(indices.getPointer());
+    MutableDHTArrayView<float> values_view(values.getPointer());
+    int64_t coords[] = {2, 1, 0, 3, 2, 0, 0, 1};
+    float elements[] = {1, 2, 3, 4};
+    std::copy(std::begin(coords), std::end(coords), indices_view.begin());
+    std::copy(std::begin(elements), std::end(elements), values_view.begin());
+    return CooHostTensor(TensorShape({3, 4}), DType(DType::F32),
+                         std::move(indices.getValue()),
+                         std::move(values.getValue()));
+  }
+
+  std::unique_ptr<HostContext> host_ = CreateHostContext();
+};
+
+TEST_F(CsrHostTensorTest, FromCooHostTensor) {
+  auto coo = CreateCooTensor();
+  auto csr = CopyCooHostTensorToCsrHostTensor(coo, host_.get());
+  ASSERT_TRUE(!!csr);
+  EXPECT_EQ(csr->NumNonZeros(), 4);
+  EXPECT_THAT(DHTArrayView<int64_t>(csr->RowPtrs()).Elements(),
+              ElementsAre(0, 2, 2, 4));
+  EXPECT_THAT(DHTArrayView<int64_t>(csr->ColIndices()).Elements(),
+              ElementsAre(3, 1, 1, 0));
+  EXPECT_THAT(DHTArrayView<float>(csr->Values()).Elements(),
+              ElementsAre(2, 4, 1, 3));
+
+  auto dht = CopyCsrHostTensorToDenseHostTensor(*csr, host_.get());
+  ASSERT_TRUE(dht.hasValue());
+  EXPECT_THAT(DHTArrayView<float>(dht.getPointer()).Elements(),
+              ElementsAre(0, 4, 0, 2, 0, 0, 0, 0, 3, 1, 0, 0));
+}
+
+TEST_F(CsrHostTensorTest, FromDenseHostTensor) {
+  auto dht = CreateDummyTensor<int32_t>({2, 3}, host_.get());
+  auto csr = CopyDenseHostTensorToCsrHostTensor(dht, host_.get());
+  ASSERT_TRUE(!!csr);
+  EXPECT_THAT(DHTArrayView<int64_t>(csr->RowPtrs()).Elements(),
+              ElementsAre(0, 2, 5));
+  EXPECT_THAT(DHTArrayView<int64_t>(csr->ColIndices()).Elements(),
+              ElementsAre(1, 2, 0, 1, 2));
+  EXPECT_THAT(DHTArrayView<int32_t>(csr->Values()).Elements(),
+              ElementsAre(1, 2, 3, 4, 5));
+
+  auto rank1 = CreateDummyTensor<int32_t>({3}, host_.get());
+  EXPECT_FALSE(!!CopyDenseHostTensorToCsrHostTensor(rank1, host_.get()));
+}
+
+TEST_F(CsrHostTensorTest, OutOfBoundsIndex) {
+  auto indices = DenseHostTensor::CreateUninitialized<int64_t>(
+      TensorShape({1, 2}), host_.get());
+  auto values =
+      DenseHostTensor::CreateUninitialized<float>(TensorShape(1), host_.get());
+  MutableDHTArrayView<int64_t> indices_view(indices.getPointer());
+  indices_view[0] = 1;
+  indices_view[1] = 5;
+  CooHostTensor coo(TensorShape({2, 2}), DType(DType::F32),
+                    std::move(indices.getValue()),
+                    std::move(values.getValue()));
+
+  auto csr = CopyCooHostTensorToCsrHostTensor(coo, host_.get());
+  ASSERT_FALSE(!!csr);
+  EXPECT_EQ(llvm::toString(csr.takeError()),
+            "index [1, 5] is out of bounds of [2, 2]");
+}
+
+TEST_F(CsrHostTensorTest, ConvertToCooHostTensor) {
+  RegisterTensorConversionFns(host_.get());
+
+  auto csr = CopyCooHostTensorToCsrHostTensor(CreateCooTensor(), host_.get());
+  ASSERT_TRUE(!!csr);
+
+  ExecutionContext exec_ctx(
+      std::move(*RequestContextBuilder(host_.get(), nullptr).build()));
+  auto result = ConvertTensorOnHost(exec_ctx, *csr, CooHostTensor::kTensorType);
+  host_->Await(result.CopyRCRef());
+  ASSERT_FALSE(result.IsError());
+
+  const auto& coo = static_cast<const CooHostTensor&>(result.get());
+  EXPECT_THAT(DHTArrayView<int64_t>(coo.Indices()).Elements(),
+              ElementsAre(0, 3, 0, 1, 2, 1, 2, 0));
+  EXPECT_EQ(coo.Values()->data(), csr->Values()->data());
+}
+
+TEST_F(CsrHostTensorTest, ConvertLargeToDenseHostTensor) {
+  RegisterTensorConversionFns(host_.get());
+
+  // Large enough to be converted in parallel blocks of rows.
+  auto dht = CreateDummyTensor<int32_t>({300, 500}, host_.get());
+  auto csr = CopyDenseHostTensorToCsrHostTensor(dht, host_.get());
+  ASSERT_TRUE(!!csr);
+
+  ExecutionContext exec_ctx(
+      std::move(*RequestContextBuilder(host_.get(), nullptr).build()));
+  auto result =
+      ConvertTensorOnHost(exec_ctx, *csr, DenseHostTensor::kTensorType);
+  host_->Await(result.CopyRCRef());
+  ASSERT_FALSE(result.IsError());
+
+  const auto& dht_result = static_cast<const DenseHostTensor&>(result.get());
+  DHTArrayView<int32_t> view(&dht_result);
+  for (int i = 0; i < 300 * 500; ++i) ASSERT_EQ(view[i], i);
+}
+
+TEST_F(CsrHostTensorTest, Print) {
+  auto csr = CopyCooHostTensorToCsrHostTensor(CreateCooTensor(), host_.get());
+  ASSERT_TRUE(!!csr);
+
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  csr->Print(os);
+  EXPECT_EQ(os.str(),
+            "CsrHostTensor dtype = F32, shape = [3, 4], row_ptrs = [0, 2, 2, "
+            "4], col_indices = [3, 1, 1, 0], values = [2.000000e+00, "
+            "4.000000e+00, 1.000000e+00, 3.000000e+00]\n");
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for PackedStringHostTensor.
+
+#include "tfrt/tensor/packed_string_host_tensor.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/string_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+using testing::ElementsAre;
+
+class PackedStringHostTensorTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<HostContext> host_ = CreateHostContext();
+};
+
+TEST_F(PackedStringHostTensorTest, Create) {
+  std::vector<std::string> strings = {"abc", "", "defgh", "i"};
+  auto tensor =
+      PackedStringHostTensor::Create(TensorShape({2, 2}), strings, host_.get());
+  ASSERT_TRUE(tensor.hasValue());
+  EXPECT_THAT(tensor->offsets(), ElementsAre(0, 3, 3, 8, 9));
+  EXPECT_EQ(string_view(tensor->bytes(), 9), "abcdefghi");
+  EXPECT_EQ(tensor->GetString(0), "abc");
+  EXPECT_EQ(tensor->GetString(1), "");
+  EXPECT_EQ(tensor->GetString(2), "defgh");
+  EXPECT_EQ(tensor->GetString(3), "i");
+
+  // The offsets and the bytes share one allocation.
+  EXPECT_EQ(tensor->offsets_buffer().get(), tensor->bytes_buffer().get());
+
+  auto copy = tensor->CopyRef();
+  EXPECT_EQ(copy.bytes(), tensor->bytes());
+  EXPECT_EQ(copy.GetString(2), "defgh");
+}
+
+TEST_F(PackedStringHostTensorTest, CreateScalarDoesNotCopy) {
+  std::string str(100, 'x');
+  const char* data = str.data();
+  auto tensor =
+      PackedStringHostTensor::CreateScalar(std::move(str), host_.get());
+  ASSERT_TRUE(tensor.hasValue());
+  EXPECT_EQ(tensor->NumElements(), 1);
+  EXPECT_EQ(tensor->bytes(), data);
+  EXPECT_EQ(tensor->GetString(0), std::string(100, 'x'));
+}
+
+TEST_F(PackedStringHostTensorTest, ConvertToAndFromStringHostTensor) {
+  RegisterTensorConversionFns(host_.get());
+  ExecutionContext exec_ctx(
+      std::move(*RequestContextBuilder(host_.get(), nullptr).build()));
+
+  auto sht = StringHostTensor::CreateUninitialized(TensorShape(3),
+                                                   host_.get());
+  ASSERT_TRUE(sht.hasValue());
+  sht->strings()[0] = "string";
+  sht->strings()[2] = "tensor";
+
+  auto packed =
+      ConvertTensorOnHost(exec_ctx, *sht, PackedStringHostTensor::kTensorType);
+  host_->Await(packed.CopyRCRef());
+  ASSERT_FALSE(packed.IsError());
+  const auto& packed_tensor =
+      static_cast<const PackedStringHostTensor&>(packed.get());
+  EXPECT_THAT(packed_tensor.offsets(), ElementsAre(0, 6, 6, 12));
+
+  auto unpacked = ConvertTensorOnHost(exec_ctx, packed_tensor,
+                                      StringHostTensor::kTensorType);
+  host_->Await(unpacked.CopyRCRef());
+  ASSERT_FALSE(unpacked.IsError());
+  EXPECT_THAT(static_cast<const StringHostTensor&>(unpacked.get()).strings(),
+              ElementsAre("string", "", "tensor"));
+}
+
+TEST_F(PackedStringHostTensorTest, Print) {
+  std::vector<std::string> strings = {"string", "tensor"};
+  auto tensor =
+      PackedStringHostTensor::Create(TensorShape(2), strings, host_.get());
+  ASSERT_TRUE(tensor.hasValue());
+
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  tensor->Print(os);
+  EXPECT_EQ(os.str(),
+            "PackedStringHostTensor shape = [2], values = [\"string\", "
+            "\"tensor\"]");
+}
+
+}  // namespace
+}  // namespace tfrt
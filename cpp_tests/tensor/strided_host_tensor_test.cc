@@ -0,0 +1,159 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for StridedHostTensor.
+
+#include "tfrt/tensor/strided_host_tensor.h"
+
+#include <complex>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+namespace {
+
+using testing::ElementsAre;
+
+class StridedHostTensorTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<HostContext> host_ = CreateHostContext();
+};
+
+TEST_F(StridedHostTensorTest, ViewOfDenseHostTensor) {
+  auto dht = CreateDummyTensor<int32_t>({2, 3}, host_.get());
+  StridedHostTensor tensor(dht);
+  EXPECT_THAT(tensor.strides(), ElementsAre(3, 1));
+  EXPECT_TRUE(tensor.IsContiguous());
+  EXPECT_EQ(tensor.ElementAt<int32_t>({1, 2}), 5);
+  EXPECT_EQ(tensor.data(), dht.data());
+}
+
+TEST_F(StridedHostTensorTest, Slice) {
+  auto dht = CreateDummyTensor<int32_t>({3, 4}, host_.get());
+  auto slice = StridedHostTensor(dht).Slice({1, 1}, {2, 2});
+  ASSERT_TRUE(!!slice);
+  EXPECT_FALSE(slice->IsContiguous());
+  EXPECT_EQ(slice->buffer().get(), dht.buffer().get());
+  EXPECT_EQ(slice->ElementAt<int32_t>({0, 0}), 5);
+  EXPECT_EQ(slice->ElementAt<int32_t>({1, 1}), 10);
+
+  auto copy = slice->ToDenseHostTensor(host_.get());
+  ASSERT_TRUE(copy.hasValue());
+  EXPECT_NE(copy->buffer().get(), dht.buffer().get());
+  EXPECT_THAT(DHTArrayView<int32_t>(copy.getPointer()).Elements(),
+              ElementsAre(5, 6, 9, 10));
+
+  EXPECT_FALSE(!!StridedHostTensor(dht).Slice({2, 0}, {2, 4}));
+}
+
+TEST_F(StridedHostTensorTest, ContiguousSliceSharesBuffer) {
+  auto dht = CreateDummyTensor<int32_t>({3, 4}, host_.get());
+  auto slice = StridedHostTensor(dht).Slice({1, 0}, {2, 4});
+  ASSERT_TRUE(!!slice);
+  EXPECT_TRUE(slice->IsContiguous());
+
+  auto view = slice->ToDenseHostTensor(host_.get());
+  ASSERT_TRUE(view.hasValue());
+  EXPECT_EQ(view->data(), slice->data());
+  EXPECT_THAT(DHTArrayView<int32_t>(view.getPointer()).Elements(),
+              ElementsAre(4, 5, 6, 7, 8, 9, 10, 11));
+}
+
+TEST_F(StridedHostTensorTest, Transpose) {
+  auto dht = CreateDummyTensor<float>({2, 3}, host_.get());
+  auto transpose = StridedHostTensor(dht).Transpose({1, 0});
+  ASSERT_TRUE(!!transpose);
+  EXPECT_THAT(transpose->strides(), ElementsAre(1, 3));
+  EXPECT_EQ(transpose->shape(), TensorShape({3, 2}));
+
+  auto copy = transpose->ToDenseHostTensor(host_.get());
+  ASSERT_TRUE(copy.hasValue());
+  EXPECT_THAT(DHTArrayView<float>(copy.getPointer()).Elements(),
+              ElementsAre(0, 3, 1, 4, 2, 5));
+
+  EXPECT_FALSE(!!StridedHostTensor(dht).Transpose({0, 0}));
+}
+
+TEST_F(StridedHostTensorTest, BroadcastTo) {
+  auto dht = CreateDummyTensor<int32_t>({3}, host_.get());
+  auto broadcast = StridedHostTensor(dht).BroadcastTo(TensorShape({2, 3}));
+  ASSERT_TRUE(!!broadcast);
+  EXPECT_THAT(broadcast->strides(), ElementsAre(0, 1));
+
+  auto copy = broadcast->ToDenseHostTensor(host_.get());
+  ASSERT_TRUE(copy.hasValue());
+  EXPECT_THAT(DHTArrayView<int32_t>(copy.getPointer()).Elements(),
+              ElementsAre(0, 1, 2, 0, 1, 2));
+
+  EXPECT_FALSE(!!StridedHostTensor(dht).BroadcastTo(TensorShape({2, 4})));
+}
+
+TEST_F(StridedHostTensorTest, TransposeComplex) {
+  auto dht = CreateDummyTensor<std::complex<double>>({2, 3}, host_.get());
+  auto transpose = StridedHostTensor(dht).Transpose({1, 0});
+  ASSERT_TRUE(!!transpose);
+
+  auto copy = transpose->ToDenseHostTensor(host_.get());
+  ASSERT_TRUE(copy.hasValue());
+  EXPECT_THAT(DHTArrayView<std::complex<double>>(copy.getPointer()).Elements(),
+              ElementsAre(0, 3, 1, 4, 2, 5));
+}
+
+TEST_F(StridedHostTensorTest, ConvertLargeTranspose) {
+  RegisterTensorConversionFns(host_.get());
+
+  // Large enough to be copied in parallel blocks of rows.
+  auto dht = CreateDummyTensor<int32_t>({300, 500}, host_.get());
+  auto transpose = StridedHostTensor(dht).Transpose({1, 0});
+  ASSERT_TRUE(!!transpose);
+
+  ExecutionContext exec_ctx(
+      std::move(*RequestContextBuilder(host_.get(), nullptr).build()));
+  auto result =
+      ConvertTensorOnHost(exec_ctx, *transpose, DenseHostTensor::kTensorType);
+  host_->Await(result.CopyRCRef());
+  ASSERT_FALSE(result.IsError());
+
+  const auto& dht_result = static_cast<const DenseHostTensor&>(result.get());
+  DHTIndexableView<int32_t, 2> view(&dht_result);
+  for (int i = 0; i < 500; ++i)
+    for (int j = 0; j < 300; ++j) ASSERT_EQ(view.ElementAt(i, j), j * 500 + i);
+}
+
+TEST_F(StridedHostTensorTest, Print) {
+  auto dht = CreateDummyTensor<int32_t>({2, 2}, host_.get());
+  auto transpose = StridedHostTensor(dht).Transpose({1, 0});
+  ASSERT_TRUE(!!transpose);
+
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  transpose->Print(os);
+  EXPECT_EQ(os.str(),
+            "StridedHostTensor dtype = I32, shape = [2, 2], strides = [1, 2], "
+            "offset = 0, values = [0, 2, 1, 3]");
+}
+
+}  // namespace
+}  // namespace tfrt
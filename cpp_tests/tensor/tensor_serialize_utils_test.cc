@@ -0,0 +1,114 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for DenseAttr serialization utils.
+
+#include "tfrt/tensor/tensor_serialize_utils.h"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "tfrt/bef_converter/bef_attr_encoder.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+namespace {
+
+// A function that only counts its references, as the owner of an attribute
+// section.
+class RefCountingFunction : public Function {
+ public:
+  RefCountingFunction()
+      : Function("ref_counting", FunctionKind::kBEFFunction, {}, {}) {}
+
+  void Execute(const ExecutionContext& exec_ctx,
+               ArrayRef<AsyncValue*> arguments,
+               MutableArrayRef<RCReference<AsyncValue>> results) const final {}
+  void AddRef() const final { ++ref_count_; }
+  void DropRef() const final { --ref_count_; }
+
+  int ref_count() const { return ref_count_; }
+
+ private:
+  mutable int ref_count_ = 0;
+};
+
+// Returns a BEF buffer with a dense attribute of `num_elements` floats at
+// `*offset`.
+BefBuffer EncodeDenseAttr(HostContext* host, int num_elements,
+                          size_t* offset) {
+  auto dht = DenseHostTensor::CreateUninitialized<float>(
+      TensorShape(ArrayRef<int64_t>{num_elements}), host);
+  assert(dht.hasValue());
+  MutableDHTArrayView<float> view(dht.getPointer());
+  for (int i = 0; i < num_elements; ++i) view[i] = i;
+
+  BefAttrEncoder encoder;
+  // Misalign the attribute to check that the elements are aligned anyway.
+  encoder.EmitByte(0);
+  *offset = SerializeDenseHostTensorToDenseAttr(*dht, &encoder);
+  return encoder.TakeResult();
+}
+
+TEST(TensorSerializeUtilsTest, LargeDenseAttrIsCacheLineAligned) {
+  auto host = CreateHostContext();
+  size_t offset;
+  BefBuffer buffer = EncodeDenseAttr(host.get(), 32, &offset);
+  DenseAttr attr(buffer.data() + offset);
+
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(attr.GetElements()) %
+                kAttributeLargeTensorAlignment,
+            0);
+  EXPECT_EQ(attr.GetElement<float>(31), 31.0f);
+}
+
+TEST(TensorSerializeUtilsTest, DenseAttributeIsUsedInPlace) {
+  auto host = CreateHostContext();
+  size_t offset;
+  BefBuffer buffer = EncodeDenseAttr(host.get(), 32, &offset);
+  DenseAttr attr(buffer.data() + offset);
+  RefCountingFunction owner;
+
+  {
+    auto dht = DeserializeDenseHostTensorFromDenseAttr(
+        DenseAttribute(attr, &owner), host.get());
+    ASSERT_TRUE(!!dht);
+    EXPECT_EQ(dht->data(), attr.GetElements());
+    EXPECT_EQ(dht->NumElements(), 32);
+    // The tensor keeps the attribute section alive.
+    EXPECT_EQ(owner.ref_count(), 1);
+  }
+  EXPECT_EQ(owner.ref_count(), 0);
+}
+
+TEST(TensorSerializeUtilsTest, DenseAttributeWithoutOwnerIsCopied) {
+  auto host = CreateHostContext();
+  size_t offset;
+  BefBuffer buffer = EncodeDenseAttr(host.get(), 4, &offset);
+  DenseAttr attr(buffer.data() + offset);
+
+  auto dht = DeserializeDenseHostTensorFromDenseAttr(
+      DenseAttribute(attr, /*owner=*/nullptr), host.get());
+  ASSERT_TRUE(!!dht);
+  EXPECT_NE(dht->data(), attr.GetElements());
+  DHTArrayView<float> view(&*dht);
+  for (int i = 0; i < 4; ++i) EXPECT_EQ(view[i], i);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -19,6 +19,7 @@
 #include "tfrt/tensor/tensor_shape.h"
 
 #include <array>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -36,5 +37,65 @@ TEST(TensorShapeTest, Strides) {
   EXPECT_EQ(strides, expected);
 }
 
+TEST(TensorShapeTest, PackedDims) {
+  std::array<ssize_t, 5> dims5 = {3, 200000, 7, 4000000, 2};
+  TensorShape shape5(dims5);
+  EXPECT_EQ(shape5.GetRank(), 5);
+  EXPECT_EQ(shape5.GetNumElements(), 3LL * 200000 * 7 * 4000000 * 2);
+  EXPECT_EQ(shape5.GetDimensionSize(3), 4000000);
+
+  std::array<ssize_t, 5> result5;
+  shape5.GetDimensions(&result5);
+  EXPECT_EQ(result5, dims5);
+
+  std::array<ssize_t, 6> dims6 = {262143, 1, 70000, 0, 5, 100000};
+  TensorShape shape6(dims6);
+  std::array<ssize_t, 6> result6;
+  shape6.GetDimensions(&result6);
+  EXPECT_EQ(result6, dims6);
+  EXPECT_EQ(shape6.GetNumElements(), 0);
+
+  EXPECT_EQ(TensorShape(dims6), shape6);
+  EXPECT_NE(TensorShape(std::array<ssize_t, 6>{262143, 1, 70000, 1, 5, 100000}),
+            shape6);
+}
+
+TEST(TensorShapeTest, LargeDims) {
+  std::array<ssize_t, 6> dims = {2, 70000, 3, 1LL << 33, 1, 5};
+  TensorShape shape(dims);
+
+  EXPECT_EQ(shape.GetRank(), 6);
+  EXPECT_EQ(shape.GetNumElements(), 2 * 70000 * 3 * (1LL << 33) * 5);
+  EXPECT_EQ(shape.GetDimensionSize(3), 1LL << 33);
+
+  std::array<ssize_t, 6> result;
+  shape.GetDimensions(&result);
+  EXPECT_EQ(result, dims);
+
+  TensorShape copy = shape;
+  EXPECT_EQ(copy, shape);
+  EXPECT_NE(copy, TensorShape(std::array<ssize_t, 6>{2, 70000, 3, 1, 1, 5}));
+}
+
+TEST(TensorShapeTest, HighRank) {
+  std::vector<ssize_t> dims = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  TensorShape shape(dims);
+  EXPECT_EQ(shape.GetRank(), 10);
+  EXPECT_EQ(shape.GetNumElements(), 3628800);
+
+  TensorShape copy = shape;
+  TensorShape moved = std::move(shape);
+  EXPECT_EQ(moved, copy);
+  EXPECT_EQ(moved.GetDimensionSize(9), 10);
+
+  // A moved-from shape is left as a scalar.
+  EXPECT_EQ(shape.GetRank(), 0);  // NOLINT(bugprone-use-after-move)
+  EXPECT_EQ(shape.GetNumElements(), 1);
+
+  copy = TensorShape(ArrayRef<ssize_t>{});
+  EXPECT_EQ(copy, shape);
+  EXPECT_NE(copy, moved);
+}
+
 }  // namespace
 }  // namespace tfrt
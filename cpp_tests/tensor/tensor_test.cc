@@ -21,9 +21,14 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/coo_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
 #include "tfrt/tensor/dense_tensor_utils.h"
+#include "tfrt/tensor/scalar_host_tensor.h"
 #include "tfrt/tensor/tensor_metadata.h"
 #include "tfrt/tensor/tensor_shape.h"
 
@@ -148,5 +153,61 @@ TEST(TensorTest, FlattenTensor) {
   EXPECT_TRUE(dht.buffer().get() == flat.buffer().get());
 }
 
+// Converts `tensor` with the registered conversion functions and waits for the
+// result.
+AsyncValueRef<HostTensor> ConvertAndWait(const Tensor& tensor,
+                                         TensorType dst_tensor_type,
+                                         HostContext* host) {
+  ExecutionContext exec_ctx(
+      std::move(*RequestContextBuilder(host, nullptr).build()));
+  auto result = ConvertTensorOnHost(exec_ctx, tensor, dst_tensor_type);
+  host->Await(result.CopyRCRef());
+  return result;
+}
+
+TEST(TensorTest, ConvertLargeScalarHostTensor) {
+  auto context = CreateHostContext();
+  RegisterTensorConversionFns(context.get());
+
+  // Large enough to be filled in parallel blocks.
+  ScalarHostTensor<int32_t> scalar(TensorShape({1000, 100}), 7);
+  auto result = ConvertAndWait(scalar, DenseHostTensor::kTensorType,
+                               context.get());
+  ASSERT_FALSE(result.IsError());
+  DHTArrayView<int32_t> view(
+      &static_cast<const DenseHostTensor&>(result.get()));
+  EXPECT_EQ(view.NumElements(), 100000);
+  EXPECT_TRUE(llvm::all_of(view.Elements(), [](int32_t v) { return v == 7; }));
+}
+
+TEST(TensorTest, ConvertCooHostTensor) {
+  auto context = CreateHostContext();
+  RegisterTensorConversionFns(context.get());
+
+  auto indices = DenseHostTensor::CreateUninitialized(
+                     TensorMetadata::Create<int64_t>(2, 2), context.get())
+                     .getValue();
+  MutableDHTArrayView<int64_t> indices_view(&indices);
+  std::copy_n(std::array<int64_t, 4>{0, 1, 300, 2}.begin(), 4,
+              indices_view.data());
+  auto values = DenseHostTensor::CreateUninitialized(
+                    TensorMetadata::Create<float>(2), context.get())
+                    .getValue();
+  MutableDHTArrayView<float> values_view(&values);
+  values_view[0] = 1.5f;
+  values_view[1] = -2.0f;
+
+  CooHostTensor coo(TensorShape({301, 300}), DType(DType::F32),
+                    std::move(indices), std::move(values));
+  auto result =
+      ConvertAndWait(coo, DenseHostTensor::kTensorType, context.get());
+  ASSERT_FALSE(result.IsError());
+  DHTIndexableView<float, 2> view(
+      &static_cast<const DenseHostTensor&>(result.get()));
+  EXPECT_EQ(view.ElementAt(0, 1), 1.5f);
+  EXPECT_EQ(view.ElementAt(300, 2), -2.0f);
+  EXPECT_EQ(llvm::count(view.Elements(), 0.0f), 301 * 300 - 2);
+}
+
 }  // namespace
 }  // namespace tfrt
@@ -0,0 +1,209 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for SimpleTracingSink.
+#include "tfrt/tracing/simple_tracing_sink/simple_tracing_sink.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tfrt {
+namespace tracing {
+namespace {
+
+// Returns the trace events exported by `sink`.
+llvm::json::Array ExportTraceEvents(SimpleTracingSink& sink) {
+  std::string buffer;
+  llvm::raw_string_ostream os(buffer);
+  sink.ExportChromeTrace(os);
+  auto json = llvm::json::parse(os.str());
+  EXPECT_TRUE(static_cast<bool>(json));
+  if (!json) {
+    llvm::consumeError(json.takeError());
+    return {};
+  }
+  return std::move(*json->getAsObject()->getArray("traceEvents"));
+}
+
+TEST(SimpleTracingSinkTest, ExportsScopesAndEvents) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  SimpleTracingSink sink;
+  RegisterTracingSink(&sink);
+  SetTracingLevel(TracingLevel::Default);
+  RequestTracing(true);
+  {
+    TracingScope scope(TracingLevel::Default, [] { return "scope"; });
+    RecordTracingEvent(TracingLevel::Default, [] { return "event"; });
+  }
+  RequestTracing(false);
+
+  auto events = ExportTraceEvents(sink);
+  ASSERT_EQ(events.size(), 2);
+  const auto& event = *events[0].getAsObject();
+  EXPECT_EQ(*event.getString("name"), "event");
+  EXPECT_EQ(*event.getString("ph"), "i");
+  const auto& scope = *events[1].getAsObject();
+  EXPECT_EQ(*scope.getString("name"), "scope");
+  EXPECT_EQ(*scope.getString("ph"), "X");
+  EXPECT_LE(*scope.getNumber("ts"), *event.getNumber("ts"));
+  EXPECT_GE(*scope.getNumber("ts") + *scope.getNumber("dur"),
+            *event.getNumber("ts"));
+}
+
+TEST(SimpleTracingSinkTest, ExportsTracePoints) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  TracePoint trace_point("trace_point");
+  SetTracingLevel(TracingLevel::Default);
+  {
+    SimpleTracingSink sink;
+    RegisterTracingSink(&sink);
+    RequestTracing(true);
+    RecordTracingEvent(TracingLevel::Default, trace_point);
+    RecordTracingEvent(TracingLevel::Default, trace_point);
+    RequestTracing(false);
+
+    auto events = ExportTraceEvents(sink);
+    ASSERT_EQ(events.size(), 2);
+    EXPECT_EQ(*events[0].getAsObject()->getString("name"), "trace_point");
+    EXPECT_EQ(*events[1].getAsObject()->getString("name"), "trace_point");
+  }
+  {
+    // Another sink doesn't use the name id cached by the previous one.
+    SimpleTracingSink sink;
+    RegisterTracingSink(&sink);
+    RequestTracing(true);
+    RecordTracingEvent(TracingLevel::Default, [] { return "other"; });
+    { TracingScope scope(TracingLevel::Default, trace_point); }
+    RequestTracing(false);
+
+    auto events = ExportTraceEvents(sink);
+    ASSERT_EQ(events.size(), 2);
+    EXPECT_EQ(*events[0].getAsObject()->getString("name"), "other");
+    EXPECT_EQ(*events[1].getAsObject()->getString("name"), "trace_point");
+  }
+}
+
+TEST(SimpleTracingSinkTest, RecordsThreadIds) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  SimpleTracingSink sink;
+  RegisterTracingSink(&sink);
+  SetTracingLevel(TracingLevel::Default);
+  RequestTracing(true);
+  RecordTracingEvent(TracingLevel::Default, [] { return "main"; });
+  std::thread([] {
+    RecordTracingEvent(TracingLevel::Default, [] { return "other"; });
+  }).join();
+  RequestTracing(false);
+
+  auto events = ExportTraceEvents(sink);
+  ASSERT_EQ(events.size(), 2);
+  const auto& main_event = *events[0].getAsObject();
+  const auto& other_event = *events[1].getAsObject();
+  EXPECT_EQ(*main_event.getString("name"), "main");
+  EXPECT_EQ(*other_event.getString("name"), "other");
+  EXPECT_NE(*main_event.getInteger("tid"), *other_event.getInteger("tid"));
+}
+
+TEST(SimpleTracingSinkTest, ExportsFlows) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  SimpleTracingSink sink;
+  RegisterTracingSink(&sink);
+  SetTracingLevel(TracingLevel::Default);
+  RequestTracing(true);
+  uint64_t flow_id = NewTracingFlowId();
+  auto record_flow = [&] {
+    TracingScope scope(TracingLevel::Default, [] { return "scope"; });
+    RecordTracingFlow(TracingLevel::Default, flow_id);
+  };
+  record_flow();
+  std::thread(record_flow).join();
+  record_flow();
+  RequestTracing(false);
+
+  // Flow steps precede their enclosing scopes.
+  auto events = ExportTraceEvents(sink);
+  ASSERT_EQ(events.size(), 6);
+  for (int i = 0; i < 3; ++i) {
+    const auto& flow = *events[2 * i].getAsObject();
+    EXPECT_EQ(*flow.getString("id"), llvm::utohexstr(flow_id));
+    EXPECT_EQ(*flow.getString("bp"), "e");
+  }
+  // The events are grouped by thread.
+  EXPECT_EQ(*events[0].getAsObject()->getString("ph"), "s");
+  EXPECT_EQ(*events[2].getAsObject()->getString("ph"), "f");
+  EXPECT_EQ(*events[4].getAsObject()->getString("ph"), "t");
+}
+
+TEST(SimpleTracingSinkTest, ExportsTrackActivitiesAndCounters) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  SimpleTracingSink sink;
+  RegisterTracingSink(&sink);
+  SetTracingLevel(TracingLevel::Default);
+  RequestTracing(true);
+  uint64_t flow_id = NewTracingFlowId();
+  {
+    TracingScope scope(TracingLevel::Default, [] { return "enqueue"; });
+    RecordTracingFlow(TracingLevel::Default, flow_id);
+  }
+  auto begin = std::chrono::steady_clock::now();
+  auto end = begin + std::chrono::microseconds(5);
+  RecordTracingActivity(
+      TracingLevel::Default, [] { return "kernel"; }, "stream", begin, end,
+      flow_id);
+  TFRT_TRACE_COUNTER(Default, "bytes", 42);
+  RequestTracing(false);
+
+  // The host scope with its flow step, the track name, the track activity
+  // with its flow step, and the counter.
+  auto events = ExportTraceEvents(sink);
+  ASSERT_EQ(events.size(), 6);
+  const auto& track = *events[2].getAsObject();
+  EXPECT_EQ(*track.getInteger("pid"), 1);
+  EXPECT_EQ(*track.getString("ph"), "M");
+  EXPECT_EQ(*track.getObject("args")->getString("name"), "stream");
+  const auto& activity = *events[3].getAsObject();
+  EXPECT_EQ(*activity.getInteger("pid"), 1);
+  EXPECT_EQ(*activity.getInteger("tid"), *track.getInteger("tid"));
+  EXPECT_EQ(*activity.getString("name"), "kernel");
+  EXPECT_EQ(*activity.getString("ph"), "X");
+  EXPECT_DOUBLE_EQ(*activity.getNumber("dur"), 5.0);
+  const auto& flow = *events[4].getAsObject();
+  EXPECT_EQ(*flow.getInteger("pid"), 1);
+  EXPECT_EQ(*flow.getString("id"), llvm::utohexstr(flow_id));
+  EXPECT_EQ(*flow.getString("ph"), "f");
+  const auto& counter = *events[5].getAsObject();
+  EXPECT_EQ(*counter.getString("name"), "bytes");
+  EXPECT_EQ(*counter.getString("ph"), "C");
+  EXPECT_EQ(*counter.getObject("args")->getInteger("value"), 42);
+}
+
+}  // namespace
+}  // namespace tracing
+}  // namespace tfrt
@@ -22,6 +22,7 @@
 #include "tfrt/cpp_tests/error_util.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/string_util.h"
+#include "tfrt/tracing/simple_tracing_sink/simple_tracing_sink.h"
 #include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
@@ -90,6 +91,14 @@ void BM_TracingScopes(benchmark::State& state) {
 }
 BENCHMARK(BM_TracingScopes);
 
+void BM_StaticTracingScopes(benchmark::State& state) {
+  BenchmarkTracingSink sink;
+  for (auto _ : state) {
+    TFRT_TRACE_STATIC_SCOPE(Default, "scope");
+  }
+}
+BENCHMARK(BM_StaticTracingScopes);
+
 void BM_StrCatTracingScopes(benchmark::State& state) {
   BenchmarkTracingSink sink;
   for (auto _ : state) {
@@ -115,6 +124,48 @@ void BM_InactiveTracingScopes(benchmark::State& state) {
   }
 }
 BENCHMARK(BM_InactiveTracingScopes);
+
+void BM_InactiveStaticTracingScopes(benchmark::State& state) {
+  BenchmarkTracingSink sink;
+  tfrt::tracing::SetTracingLevel(tfrt::tracing::TracingLevel::Default);
+  for (auto _ : state) {
+    TFRT_TRACE_STATIC_SCOPE(Debug, "scope");
+  }
+}
+BENCHMARK(BM_InactiveStaticTracingScopes);
+
+void BM_SimpleTracingSinkEvents(benchmark::State& state) {
+  SimpleTracingSink sink;
+  RegisterTracingSink(&sink);
+  tfrt::tracing::RequestTracing(true);
+  for (auto _ : state) {
+    RecordTracingEvent(TracingLevel::Default, [] { return "event"; });
+  }
+  tfrt::tracing::RequestTracing(false);
+}
+BENCHMARK(BM_SimpleTracingSinkEvents);
+
+void BM_SimpleTracingSinkScopes(benchmark::State& state) {
+  SimpleTracingSink sink;
+  RegisterTracingSink(&sink);
+  tfrt::tracing::RequestTracing(true);
+  for (auto _ : state) {
+    TracingScope(TracingLevel::Default, [] { return "scope"; });
+  }
+  tfrt::tracing::RequestTracing(false);
+}
+BENCHMARK(BM_SimpleTracingSinkScopes);
+
+void BM_SimpleTracingSinkStaticScopes(benchmark::State& state) {
+  SimpleTracingSink sink;
+  RegisterTracingSink(&sink);
+  tfrt::tracing::RequestTracing(true);
+  for (auto _ : state) {
+    TFRT_TRACE_STATIC_SCOPE(Default, "scope");
+  }
+  tfrt::tracing::RequestTracing(false);
+}
+BENCHMARK(BM_SimpleTracingSinkStaticScopes);
 }  // namespace
 }  // namespace tracing
 }  // namespace tfrt
@@ -42,6 +42,7 @@ class MockTracingSink : TracingSink {
               (override));
   MOCK_METHOD(void, PushTracingScope, (TracingSink::NameGenerator), (override));
   MOCK_METHOD(void, PopTracingScope, (), (override));
+  MOCK_METHOD(void, RecordTracingFlow, (uint64_t), (override));
 };
 
 auto kSetDefaultErrorFactory = [] {
@@ -152,6 +153,70 @@ TEST(TracingTest, Scopes) {
   TracingScope(TracingLevel::Debug, [] { return "scope4"; });
 }
 
+TEST(TracingTest, TracePoints) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  InSequence seq;
+  MockTracingSink sink;
+
+  SetTracingLevel(TracingLevel::Default);
+  EXPECT_FALSE(IsTracingEnabled(TracingLevel::Default));
+
+  EXPECT_CALL(sink, RequestTracing(true));
+  RequestTracing(true);
+  EXPECT_TRUE(IsTracingEnabled(TracingLevel::Default));
+  EXPECT_FALSE(IsTracingEnabled(TracingLevel::Verbose));
+
+  // The sink's default implementation forwards the trace point names.
+  EXPECT_CALL(sink, PushTracingScope(FunctionReturns("scope")));
+  EXPECT_CALL(sink, RecordTracingEvent(FunctionReturns("event")));
+  EXPECT_CALL(sink, PopTracingScope());
+  {
+    TFRT_TRACE_STATIC_SCOPE(Default, "scope");
+    TFRT_TRACE_STATIC_EVENT(Default, "event");
+  }
+
+  EXPECT_CALL(sink, PushTracingScope(FunctionReturns("verbose"))).Times(0);
+  { TFRT_TRACE_STATIC_SCOPE(Verbose, "verbose"); }
+
+  SetTracingLevel(TracingLevel::Verbose);
+  EXPECT_TRUE(IsTracingEnabled(TracingLevel::Verbose));
+
+  EXPECT_CALL(sink, RequestTracing(false));
+  RequestTracing(false);
+  EXPECT_FALSE(IsTracingEnabled(TracingLevel::Default));
+}
+
+TEST(TracingTest, Flows) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  InSequence seq;
+  MockTracingSink sink;
+
+  SetTracingLevel(TracingLevel::Default);
+
+  EXPECT_CALL(sink, RequestTracing(true));
+  RequestTracing(true);
+
+  uint64_t flow_id = NewTracingFlowId();
+  EXPECT_NE(flow_id, 0);
+  EXPECT_NE(NewTracingFlowId(), flow_id);
+
+  EXPECT_CALL(sink, RecordTracingFlow(flow_id));
+  RecordTracingFlow(TracingLevel::Default, flow_id);
+
+  EXPECT_CALL(sink, RecordTracingFlow(0)).Times(0);  // Not traced.
+  RecordTracingFlow(TracingLevel::Default, 0);
+
+  EXPECT_CALL(sink, RecordTracingFlow(flow_id)).Times(0);
+  RecordTracingFlow(TracingLevel::Verbose, flow_id);
+
+  EXPECT_CALL(sink, RequestTracing(false));
+  RequestTracing(false);
+}
+
 }  // namespace
 }  // namespace tracing
 }  // namespace tfrt
@@ -34,6 +34,10 @@ class TFRTDialect : public mlir::Dialect {
   mlir::Type parseType(mlir::DialectAsmParser &parser) const override;
   void printType(mlir::Type type,
                  mlir::DialectAsmPrinter &printer) const override;
+
+  mlir::Operation *materializeConstant(mlir::OpBuilder &builder,
+                                       mlir::Attribute value, mlir::Type type,
+                                       mlir::Location loc) override;
 };
 
 }  // namespace tfrt
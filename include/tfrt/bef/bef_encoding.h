@@ -37,9 +37,16 @@ enum : uint8_t {
   kBEFMagic1 = 0x0B,
   kBEFMagic2 = 0xEF,
 
-  // This is the only known version of BEF files at the moment, new numbers
-  // should be used when/if a format break is introduced.
+  // This is the original version of BEF files. New numbers should be used
+  // when/if a format break is introduced.
   kBEFVersion0 = 0,
+
+  // Same as kBEFVersion0, except that the location offset, register table,
+  // kernel table and result registers at the start of each function in the
+  // Functions section are 4-byte integers aligned to 4 bytes instead of VBR
+  // integers. They can be decoded without a data dependent loop per integer,
+  // at the cost of a larger file.
+  kBEFVersion1 = 1,
 };
 
 // These are the section ID's for the standard sections.  Each section is
@@ -101,6 +108,13 @@ enum class BEFSectionID : uint8_t {
   // purposes only.
   kDebugInfo = 11,
 
+  // The native objects section contains native code compiled ahead of time
+  // from the compilation units of the program. It is a count of the objects,
+  // followed by the kind, the key and the data of each object, each of them
+  // prefixed by its size. It is an optional section, BEFFile::Open passes the
+  // objects to the native object loaders of the kernel registry.
+  kNativeObjects = 12,
+
   // kNumSectionIDs is the number of section ids in a BEF file including
   // optional sections.
   kNumSectionIDs,
@@ -113,10 +127,22 @@ enum : size_t {
   // DenseTensor data address alignment.
   kAttributeTensorAlignment = 8,
 
+  // DenseTensor data address alignment for tensors with at least this many
+  // bytes, which is a cache line, so that they can be used in place.
+  kAttributeLargeTensorAlignment = 64,
+
   // Maximum attribute alignment.
-  kAttributeMaxAlignment = 8,
+  kAttributeMaxAlignment = 64,
 };
 
+// Returns the alignment of the elements of a dense attribute with
+// `elements_size` bytes of elements.
+inline size_t GetDenseAttrAlignment(size_t elements_size) {
+  return elements_size >= kAttributeLargeTensorAlignment
+             ? kAttributeLargeTensorAlignment
+             : kAttributeTensorAlignment;
+}
+
 // SpecialAttribute describes the special BEF attributes of a kernel. It is a
 // bitfield, each bit of which represent one kind of such attribute.
 enum class SpecialAttribute : uint8_t {
@@ -128,6 +154,30 @@ enum class SpecialAttribute : uint8_t {
 
   // This attribute indicates whether a kernel has a debug info available.
   kHasDebugInfo = 2,
+
+  // This attribute is only set on the arguments pseudo kernel of a function.
+  // It indicates that the kernels of the function form a single dependency
+  // chain in the order they appear in the function, i.e. each kernel (and the
+  // pseudo kernel) is used by at most one other kernel. Such functions can be
+  // executed without tracking the ready counts of the kernels.
+  kSequentialFunction = 4,
+
+  // This attribute is only set on the arguments pseudo kernel of a function
+  // with the `tfrt.pure` attribute. It indicates that the results of the
+  // function only depend on the values of its arguments, so the executor can
+  // reuse the results of an earlier execution with equal arguments.
+  kPureFunction = 8,
+};
+
+// The bits of the special_metadata field of a kernel above the
+// SpecialAttribute bits store the critical path priority of the kernel. It is
+// the critical path cost of the kernel computed by StreamAnalysis, scaled to
+// [0, kMaxKernelPriority] relative to the critical path cost of its function.
+// Kernels with a higher priority are on a longer chain of dependent kernels.
+// BEF files without priorities have all kernels at priority 0.
+enum : uint32_t {
+  kKernelPriorityShift = 8,
+  kMaxKernelPriority = 255,
 };
 
 // This enum defined the function kind.
@@ -78,6 +78,27 @@ class BEFReader {
     return true;
   }
 
+  // Read a 4-byte integer, which must be aligned to 4 bytes.
+  bool ReadInt4(uint32_t* value) {
+    if (file_.size() < 4 ||
+        reinterpret_cast<uintptr_t>(file_.data()) % alignof(uint32_t) != 0)
+      return false;
+    *value = *reinterpret_cast<const uint32_t*>(file_.data());
+    file_ = file_.drop_front(4);
+    return true;
+  }
+
+  // Read an integer from the tables at the start of a function, which are VBR
+  // encoded in kBEFVersion0 files and 4-byte integers if `fixed_width` is true,
+  // as in kBEFVersion1 files.
+  bool ReadFunctionTableInt(size_t* value, bool fixed_width) {
+    if (!fixed_width) return ReadVbrInt(value);
+    uint32_t fixed_width_value;
+    if (!ReadInt4(&fixed_width_value)) return false;
+    *value = fixed_width_value;
+    return true;
+  }
+
   bool ReadSection(uint8_t* section_id, ArrayRef<uint8_t>* data) {
     size_t length;
     if (!ReadByte(section_id) || !ReadVbrInt(&length)) return false;
@@ -136,7 +157,8 @@ class BEFKernel {
     uint32_t num_attributes;
     uint32_t num_functions;
     uint32_t num_results;
-    // 1 << SpecialAttribute::kNonStrict for non-strict kernel.
+    // 1 << SpecialAttribute::kNonStrict for non-strict kernel. The bits from
+    // kKernelPriorityShift hold the critical path priority of the kernel.
     // TODO(tfrt-devs): Pack the special_metadata to other fields in
     // kernel header.
     uint32_t special_metadata = 0x0;
@@ -154,6 +176,12 @@ class BEFKernel {
     ASSERT_LITTLE_ENDIAN();
   }
 
+  // Return the start of the kernel entries of this kernel, which identifies
+  // the kernel in the BEF file.
+  const uint32_t* kernel_start() const {
+    return reinterpret_cast<const uint32_t*>(header_);
+  }
+
   uint32_t kernel_code() const { return header_->kernel_code; }
   uint32_t kernel_location() const { return header_->kernel_location; }
   uint32_t num_arguments() const { return header_->num_arguments; }
@@ -197,6 +225,22 @@ class BEFKernel {
         static_cast<uint32_t>(SpecialAttribute::kHasDebugInfo));
   }
 
+  bool IsSequentialFunction() const {
+    return static_cast<bool>(
+        special_metadata() &
+        static_cast<uint32_t>(SpecialAttribute::kSequentialFunction));
+  }
+
+  bool IsPureFunction() const {
+    return static_cast<bool>(
+        special_metadata() &
+        static_cast<uint32_t>(SpecialAttribute::kPureFunction));
+  }
+
+  uint32_t critical_path_priority() const {
+    return (special_metadata() >> kKernelPriorityShift) & kMaxKernelPriority;
+  }
+
   uint32_t GetDebugInfoOffset() const {
     assert(HasDebugInfo() && "Try to access a nonexistent debug info.");
     auto kernel_body_offset = body_start_ + num_arguments() + num_attributes() +
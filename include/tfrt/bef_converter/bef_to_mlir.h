@@ -19,6 +19,9 @@
 #ifndef TFRT_BEF_CONVERTER_BEF_TO_MLIR_H_
 #define TFRT_BEF_CONVERTER_BEF_TO_MLIR_H_
 
+#include <string>
+
+#include "llvm/ADT/ArrayRef.h"
 #include "tfrt/support/forward_decls.h"
 
 namespace mlir {
@@ -33,11 +36,14 @@ namespace tfrt {
 // BinaryExecutableFormat (BEF) format to a MLIR module containing this host
 // executor program.
 //
+// If `function_names` is not empty, only the functions with these names and
+// the functions they reference are converted.
+//
 // On error, this emits the error message through the MLIR error handler, and
 // returns a null module.
-mlir::OwningModuleRef ConvertBEFToMLIR(mlir::Location location,
-                                       ArrayRef<uint8_t> bef_file,
-                                       mlir::MLIRContext* context);
+mlir::OwningModuleRef ConvertBEFToMLIR(
+    mlir::Location location, ArrayRef<uint8_t> bef_file,
+    mlir::MLIRContext* context, ArrayRef<std::string> function_names = {});
 
 }  // namespace tfrt
 
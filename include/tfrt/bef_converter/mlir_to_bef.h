@@ -20,9 +20,14 @@
 #define TFRT_BEF_CONVERTER_MLIR_TO_BEF_H_
 
 #include <cstdint>
+#include <functional>
+#include <string>
 #include <vector>
 
+#include "llvm/ADT/Optional.h"
+#include "llvm/Support/Error.h"
 #include "tfrt/bef/bef_buffer.h"
+#include "tfrt/support/forward_decls.h"
 
 namespace mlir {
 class ModuleOp;
@@ -30,14 +35,46 @@ class ModuleOp;
 
 namespace tfrt {
 
+// A native object compiled ahead of time from a compilation unit, and stored in
+// the kNativeObjects section of a BEF file. At runtime, it is passed to the
+// native object loader of its `kind` (see KernelRegistry).
+struct BEFNativeObject {
+  std::string kind;
+  std::string key;
+  std::string data;
+};
+
+// Compiles the compilation units that are passed to the `kernels` ahead of
+// time. `compile` takes the serialized compilation unit module, as it is passed
+// to the kernel at runtime, and the name of the referenced function. It returns
+// None if the compilation unit can only be compiled at runtime.
+struct BEFNativeObjectCompiler {
+  std::vector<std::string> kernels;
+  std::function<Expected<Optional<BEFNativeObject>>(
+      string_view serialized_operation, string_view entrypoint)>
+      compile;
+};
+
 // This function converts the specified MLIR module containing a host executor
 // compatible program to the BinaryExecutableFormat (BEF) format, which is the
 // low level format that the executor takes.
 //
+// If `fixed_width_function_tables` is true, the BEF file is emitted in the
+// kBEFVersion1 format, which decodes faster but is larger.
+//
+// If multithreading is enabled in the MLIRContext of `module`, the functions
+// of large modules are emitted in parallel. The output is the same as with
+// multithreading disabled.
+//
+// The compilation units referenced by the kernels of `native_object_compilers`
+// are compiled ahead of time into the kNativeObjects section.
+//
 // On error, this emits the error message through the MLIR error handler, and
 // returns an empty AlignedBuffer.
-BefBuffer ConvertMLIRToBEF(mlir::ModuleOp module,
-                           bool disable_optional_sections);
+BefBuffer ConvertMLIRToBEF(
+    mlir::ModuleOp module, bool disable_optional_sections,
+    bool fixed_width_function_tables = false,
+    ArrayRef<BEFNativeObjectCompiler> native_object_compilers = {});
 
 }  // namespace tfrt
 
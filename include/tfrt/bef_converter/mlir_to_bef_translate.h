@@ -19,6 +19,7 @@
 #ifndef TFRT_BEF_CONVERTER_MLIR_TO_BEF_TRANSLATE_H_
 #define TFRT_BEF_CONVERTER_MLIR_TO_BEF_TRANSLATE_H_
 
+#include "tfrt/bef_converter/mlir_to_bef.h"
 #include "tfrt/support/forward_decls.h"
 
 namespace mlir {
@@ -31,6 +32,12 @@ namespace tfrt {
 mlir::LogicalResult MLIRToBEFTranslate(mlir::ModuleOp module,
                                        llvm::raw_ostream& output);
 
+// Same as MLIRToBEFTranslate, but the compilation units referenced by the
+// kernels of `native_object_compilers` are compiled ahead of time.
+mlir::LogicalResult MLIRToBEFWithNativeObjectsTranslate(
+    mlir::ModuleOp module, llvm::raw_ostream& output,
+    ArrayRef<BEFNativeObjectCompiler> native_object_compilers);
+
 }
 
 #endif  // TFRT_BEF_CONVERTER_MLIR_TO_BEF_TRANSLATE_H_
@@ -0,0 +1,90 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Options for BEF function execution
+//
+// This file declares BEFExecutionOptions, which controls how the BEFExecutor
+// schedules ready kernels. The options are attached to a request as
+// RequestContext data, e.g.:
+//
+//   RequestContextBuilder builder(host, resource_context);
+//   builder.context_data().emplace<BEFExecutionOptions>(options);
+//
+// Requests without BEFExecutionOptions use the default options.
+
+#ifndef TFRT_BEF_EXECUTOR_BEF_EXECUTION_OPTIONS_H_
+#define TFRT_BEF_EXECUTOR_BEF_EXECUTION_OPTIONS_H_
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+class BEFKernelProfiler;
+
+// Policy used by the BEFExecutor to schedule kernels that become ready on a
+// stream other than the one being executed by the current thread.
+enum class BEFSchedulingMode {
+  // Kernels on the current stream are executed inline. All other ready kernels
+  // are bundled into a single new task on the work queue, which recursively
+  // splits them by stream in the same way.
+  kInlineOutline,
+
+  // Ready kernels on other streams are grouped by stream id into a pool of
+  // ready streams owned by the executor. A bounded number of worker tasks
+  // execute whole streams; a thread that runs out of kernels on its stream
+  // steals the next ready stream from the pool instead of returning to the
+  // work queue. This keeps the number of enqueued tasks proportional to the
+  // parallelism of the host rather than to the width of the graph.
+  kStreamStealing,
+};
+
+struct BEFExecutionOptions {
+  BEFSchedulingMode scheduling_mode = BEFSchedulingMode::kInlineOutline;
+
+  // Maximum number of worker tasks that concurrently execute streams of one
+  // function invocation in kStreamStealing mode. Zero means the number of
+  // worker threads of the HostContext.
+  int max_stream_workers = 0;
+
+  // If not empty, `scheduling_mode` only applies to the functions named here.
+  // Other functions use kInlineOutline.
+  std::vector<std::string> scheduled_functions;
+
+  // If true, the executor runs the ready kernel with the highest critical path
+  // priority first, instead of the most recently ready one. The priorities are
+  // computed by the BEF converter from the kernel costs. Outline kernels are
+  // spilled with the highest priority kernel first, and in kStreamStealing
+  // mode, the stream with the highest priority kernel is taken first.
+  bool prioritize_critical_path = false;
+
+  // If not null, the executor records per-kernel statistics in this profiler.
+  // It must outlive the request.
+  BEFKernelProfiler* kernel_profiler = nullptr;
+
+  // Return the scheduling mode to use for the function `function_name`.
+  BEFSchedulingMode GetSchedulingMode(string_view function_name) const {
+    if (scheduled_functions.empty() ||
+        llvm::is_contained(scheduled_functions, function_name))
+      return scheduling_mode;
+    return BEFSchedulingMode::kInlineOutline;
+  }
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_EXECUTOR_BEF_EXECUTION_OPTIONS_H_
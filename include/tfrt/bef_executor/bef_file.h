@@ -46,7 +46,9 @@ class BEFFile : public ReferenceCounted<BEFFile> {
 
   // Open and read a BEF file, setting up our internal state and returning a
   // pointer to our initialized object on success.  On failure, an error
-  // message is emitted to the error_handler and nullptr is returned.
+  // message is emitted to the error_handler and nullptr is returned. `file`
+  // must outlive the returned BEFFile, which kernels may keep alive to use
+  // constants in place (see DenseAttribute).
   //
   // TODO: This should (optionally) manage ownership of the underlying data
   // passed in, taking a closure to run when the lifetime of the BEFFile is
@@ -56,6 +58,17 @@ class BEFFile : public ReferenceCounted<BEFFile> {
                                    ErrorHandler error_handler,
                                    HostAllocator* host_allocator);
 
+  // Memory-map the BEF file at `path` read-only and open it without copying
+  // its contents. The mapping is owned by the returned BEFFile and is released
+  // when the last reference to the BEFFile is dropped. Function bodies are
+  // decoded on first use, so pages of functions that are never executed are
+  // not faulted in. On failure, an error message is emitted to the
+  // error_handler and nullptr is returned.
+  static RCReference<BEFFile> OpenMapped(string_view path,
+                                         const KernelRegistry& registry,
+                                         ErrorHandler error_handler,
+                                         HostAllocator* host_allocator);
+
   // Get a list of functions out of the BEF file.
   void GetFunctionList(SmallVectorImpl<const Function*>* result) const;
 
@@ -63,6 +76,15 @@ class BEFFile : public ReferenceCounted<BEFFile> {
   // found in this BEF file.
   const Function* GetFunction(string_view function_name) const;
 
+  // Call `fn` with the attributes of each kernel named `kernel_name` in the
+  // BEF functions of this file, e.g. to prepare resources that the kernels
+  // would otherwise create on first execution. The attributes point into the
+  // attribute section and are decoded like the attributes of a kernel frame.
+  // Functions that cannot be decoded are skipped.
+  void ForEachKernel(
+      string_view kernel_name,
+      llvm::function_ref<void(ArrayRef<const void*> attributes)> fn) const;
+
   LocationHandler* location_handler() const { return location_handler_.get(); }
 
   virtual ~BEFFile() = 0;
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Per-kernel profiler for BEF function execution
+//
+// This file declares BEFKernelProfiler, which collects per-kernel statistics
+// while the BEFExecutor runs BEF functions. A profiler is enabled for a
+// request by setting BEFExecutionOptions::kernel_profiler. The measured kernel
+// times are also recorded in the metrics registry, in the histograms
+// "/tfrt/bef_executor/kernel_time_us/<kernel name>" and
+// "/tfrt/bef_executor/kernel_async_wait_us/<kernel name>".
+
+#ifndef TFRT_BEF_EXECUTOR_BEF_KERNEL_PROFILER_H_
+#define TFRT_BEF_EXECUTOR_BEF_KERNEL_PROFILER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+class BEFFileImpl;
+class BEFKernel;
+
+namespace metrics {
+class Histogram;
+}  // namespace metrics
+
+// The statistics of one kernel.
+struct BEFKernelProfile {
+  // The kernel name from the kernels section of the BEF file.
+  std::string kernel_name;
+  // The debug info of the kernel, if present in the BEF file.
+  std::string debug_info;
+  // The location of the kernel as "filename:line:column".
+  std::string location;
+
+  // The number of measured invocations of the kernel.
+  int64_t num_invocations = 0;
+  // The total wall time of the measured invocations of the kernel
+  // implementation. For asynchronous kernels, this does not include the time
+  // it takes for their results to become available.
+  std::chrono::nanoseconds total_time{0};
+
+  // The number of arguments of the kernel that were not available after the
+  // kernel producing them returned, and the total time it took for them to
+  // become available.
+  int64_t num_async_waits = 0;
+  std::chrono::nanoseconds async_wait_time{0};
+};
+
+// BEFKernelProfiler is thread-safe. It can be shared by any number of
+// requests.
+//
+// Kernels are identified by their address in the BEF file, so the BEF files
+// executed with a profiler must stay loaded while the profiler is in use.
+class BEFKernelProfiler {
+ public:
+  // Measure one out of every `sample_period` kernel invocations on each
+  // thread. A `sample_period` of 1 measures every invocation.
+  explicit BEFKernelProfiler(int sample_period = 1);
+
+  BEFKernelProfiler(const BEFKernelProfiler&) = delete;
+  BEFKernelProfiler& operator=(const BEFKernelProfiler&) = delete;
+
+  // Return true if the next kernel invocation on the calling thread should be
+  // measured.
+  bool ShouldSample() {
+    if (sample_period_ == 1) return true;
+    thread_local unsigned num_invocations = 0;
+    return ++num_invocations % sample_period_ == 0;
+  }
+
+  // Record an invocation of `kernel` in `bef_file` that took `time`.
+  void RecordInvocation(BEFFileImpl* bef_file, const BEFKernel& kernel,
+                        std::chrono::nanoseconds time);
+
+  // Record that an argument of `kernel` in `bef_file` took `time` to become
+  // available.
+  void RecordAsyncWait(BEFFileImpl* bef_file, const BEFKernel& kernel,
+                       std::chrono::nanoseconds time);
+
+  // Return the statistics of all kernels that have been recorded, in
+  // decreasing order of total time. Kernels with the same name, debug info
+  // and location are merged, e.g. kernels in the same BEF file loaded twice.
+  std::vector<BEFKernelProfile> GetProfiles() const;
+
+  // Print the statistics returned by GetProfiles() as a table.
+  void Print(raw_ostream& os) const;
+
+  // Write the statistics returned by GetProfiles() as a kernel cost profile,
+  // which the tfrt-apply-cost-profile compiler pass reads to guide stream
+  // assignment. Each line has the number of measured invocations, their total
+  // time in nanoseconds, the kernel name and the location, separated by
+  // spaces. Lines starting with '#' are comments.
+  void WriteCostProfile(raw_ostream& os) const;
+
+ private:
+  struct KernelEntry {
+    BEFKernelProfile profile;
+    metrics::Histogram* time_histogram;
+    metrics::Histogram* async_wait_histogram;
+  };
+
+  // Return the entry for `kernel`, creating it if this is the first record.
+  KernelEntry& GetKernelEntry(BEFFileImpl* bef_file, const BEFKernel& kernel)
+      TFRT_REQUIRES(mu_);
+
+  // Return the histogram named `name`, creating it on first use.
+  metrics::Histogram* GetHistogram(std::string name) TFRT_REQUIRES(mu_);
+
+  const unsigned sample_period_;
+
+  mutable mutex mu_;
+  // The entries of the kernels recorded so far, indexed by the address of the
+  // kernel in the BEF file.
+  llvm::DenseMap<const void*, KernelEntry> kernel_entries_ TFRT_GUARDED_BY(mu_);
+  // The histograms created in the metrics registry, indexed by name.
+  llvm::StringMap<metrics::Histogram*> histograms_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_EXECUTOR_BEF_KERNEL_PROFILER_H_
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Sampling profiler for BEF function execution
+//
+// This file declares BEFSamplingProfiler, which attributes CPU time to BEF
+// functions and kernels at a cost low enough to stay enabled in production.
+// The BEFExecutor and the BEFInterpreter publish the function and the kernel
+// that each thread executes in a thread-local slot, which takes a few stores
+// per kernel. While a profiler is alive, a background thread reads the slots
+// of all threads every sample period and counts the samples per function and
+// kernel. The counts are periodically exported to the metrics registry as the
+// counters "/tfrt/bef_executor/kernel_samples/<function>/<kernel>".
+
+#ifndef TFRT_BEF_EXECUTOR_BEF_SAMPLING_PROFILER_H_
+#define TFRT_BEF_EXECUTOR_BEF_SAMPLING_PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Compiler.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/support/thread_environment.h"
+
+namespace tfrt {
+
+namespace metrics {
+class Counter;
+}  // namespace metrics
+
+// The interned name of a BEF function or kernel. Sites are never destroyed, so
+// that the sampling thread can read them after their BEF file is unloaded.
+class BEFSampleSite {
+ public:
+  // Returns the site named `name`, creating it on first use. This takes a
+  // global lock, so it should be called when a BEF file is loaded rather than
+  // when it is executed.
+  static const BEFSampleSite* Get(string_view name);
+
+  string_view name() const { return name_; }
+
+ private:
+  explicit BEFSampleSite(string_view name) : name_(name) {}
+
+  // Points to the key of the entry in the table of interned sites.
+  string_view name_;
+
+  friend class BEFSampleSiteTable;
+};
+
+namespace internal {
+
+// The function and the kernel that a thread executes, or null if it doesn't
+// execute a BEF kernel.
+struct BEFExecutionSlot {
+  std::atomic<const BEFSampleSite*> function{nullptr};
+  std::atomic<const BEFSampleSite*> kernel{nullptr};
+};
+
+// The slot of the calling thread, or null if it is not registered yet. The
+// pointer is constant-initialized, so accessing it needs no guard.
+inline BEFExecutionSlot*& CurrentExecutionSlot() {
+  thread_local BEFExecutionSlot* slot = nullptr;
+  return slot;
+}
+
+// Registers a slot for the calling thread with the sampling threads and
+// returns it. The slot is recycled when the thread exits.
+BEFExecutionSlot* RegisterExecutionSlot();
+
+}  // namespace internal
+
+// Publishes `kernel` of `function` as executed by the calling thread while the
+// scope is alive. Scopes nest, e.g. for kernels that call functions.
+class BEFSampleScope {
+ public:
+  BEFSampleScope(const BEFSampleSite* function, const BEFSampleSite* kernel)
+      : slot_(GetSlot()),
+        previous_function_(slot_->function.load(std::memory_order_relaxed)),
+        previous_kernel_(slot_->kernel.load(std::memory_order_relaxed)) {
+    slot_->function.store(function, std::memory_order_release);
+    slot_->kernel.store(kernel, std::memory_order_release);
+  }
+  ~BEFSampleScope() {
+    slot_->function.store(previous_function_, std::memory_order_release);
+    slot_->kernel.store(previous_kernel_, std::memory_order_release);
+  }
+
+  BEFSampleScope(const BEFSampleScope&) = delete;
+  BEFSampleScope& operator=(const BEFSampleScope&) = delete;
+
+ private:
+  static internal::BEFExecutionSlot* GetSlot() {
+    internal::BEFExecutionSlot* slot = internal::CurrentExecutionSlot();
+    if (LLVM_UNLIKELY(slot == nullptr)) slot = internal::RegisterExecutionSlot();
+    return slot;
+  }
+
+  internal::BEFExecutionSlot* const slot_;
+  const BEFSampleSite* const previous_function_;
+  const BEFSampleSite* const previous_kernel_;
+};
+
+// The samples of one kernel.
+struct BEFSampleProfile {
+  std::string function_name;
+  std::string kernel_name;
+  int64_t num_samples = 0;
+};
+
+// BEFSamplingProfiler is thread-safe. Any number of profilers can be alive at
+// the same time, each of them samples all threads.
+class BEFSamplingProfiler {
+ public:
+  // Sample the threads every `sample_period` and export the samples to the
+  // metrics registry every `export_period`.
+  explicit BEFSamplingProfiler(
+      std::chrono::microseconds sample_period = std::chrono::milliseconds(10),
+      std::chrono::milliseconds export_period = std::chrono::seconds(10));
+
+  // Stops the sampling thread and exports the remaining samples.
+  ~BEFSamplingProfiler();
+
+  BEFSamplingProfiler(const BEFSamplingProfiler&) = delete;
+  BEFSamplingProfiler& operator=(const BEFSamplingProfiler&) = delete;
+
+  // Return the samples of all kernels so far, in decreasing order.
+  std::vector<BEFSampleProfile> GetProfiles() const;
+
+  // Print the samples returned by GetProfiles() as a table.
+  void Print(raw_ostream& os) const;
+
+ private:
+  struct KernelEntry {
+    int64_t num_samples = 0;
+    int64_t num_exported_samples = 0;
+    metrics::Counter* counter = nullptr;
+  };
+
+  using SiteKey = std::pair<const BEFSampleSite*, const BEFSampleSite*>;
+
+  void SampleLoop();
+
+  // Count the kernels that the threads execute right now.
+  void Sample() TFRT_REQUIRES(mu_);
+
+  // Add the samples since the last export to the metrics counters.
+  void ExportMetrics() TFRT_REQUIRES(mu_);
+
+  const std::chrono::microseconds sample_period_;
+  const std::chrono::milliseconds export_period_;
+
+  mutable mutex mu_;
+  condition_variable cond_;
+  bool stop_ TFRT_GUARDED_BY(mu_) = false;
+  // Samples keyed by the function and the kernel sites.
+  llvm::DenseMap<SiteKey, KernelEntry> kernel_entries_ TFRT_GUARDED_BY(mu_);
+  std::unique_ptr<ThreadingEnvironment::Thread> sample_thread_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_EXECUTOR_BEF_SAMPLING_PROFILER_H_
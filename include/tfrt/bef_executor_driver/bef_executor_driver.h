@@ -22,11 +22,13 @@
 #ifndef TFRT_BEF_EXECUTOR_DRIVER_BEF_EXECUTOR_DRIVER_H_
 #define TFRT_BEF_EXECUTOR_DRIVER_BEF_EXECUTOR_DRIVER_H_
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
+#include "tfrt/bef_executor/bef_execution_options.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/support/forward_decls.h"
 
@@ -45,6 +47,16 @@ enum class HostAllocatorType {
   // Allocator wrapped around profiled malloc and exit(1) on detecting memory
   // leak.
   kLeakCheckMalloc,
+
+  // Allocator with thread-local caches of size classes for small allocations.
+  kSlab,
+
+  // Slab allocator for each NUMA node, used by the threads bound to the node.
+  kNumaSlab,
+
+  // Slab allocator that maps allocations of at least 2 MB in explicit huge
+  // pages if the hugetlb pool has free pages.
+  kHugePageSlab,
 };
 
 struct RunBefConfig {
@@ -57,6 +69,66 @@ struct RunBefConfig {
   std::string work_queue_type;
   tfrt::HostAllocatorType host_allocator_type;
   bool print_error_code = false;
+  // If positive, each function call owns an ArenaAllocator with chunks of this
+  // size. The kernels that allocate their intermediate tensors with the
+  // ExecutionContext then recycle memory within the call.
+  size_t arena_chunk_size = 0;
+  // Scheduling mode for the BEFExecutor. If `scheduled_functions` is not
+  // empty, the mode only applies to the functions named there.
+  tfrt::BEFSchedulingMode scheduling_mode =
+      tfrt::BEFSchedulingMode::kInlineOutline;
+  ArrayRef<std::string> scheduled_functions;
+  // Run ready kernels in the order of their critical path priorities.
+  bool prioritize_critical_path = false;
+  // Profile every kernel and print the per-kernel statistics after running
+  // all functions.
+  bool print_kernel_profile = false;
+  // If not empty, profile every kernel and write a kernel cost profile to this
+  // file after running all functions, see BEFKernelProfiler::WriteCostProfile.
+  std::string kernel_cost_profile_filename;
+  // Sample the kernels that the threads execute and print the number of
+  // samples per kernel after running all functions.
+  bool print_sampling_profile = false;
+  // If not empty, sample the allocations of the profiled allocators and write
+  // a pprof heap profile to this file after running all functions.
+  std::string heap_profile_filename;
+  // The average number of bytes allocated between samples.
+  size_t heap_profile_sample_period = 512 * 1024;
+
+  // Print the wall time of the startup phases, e.g. kernel registration, BEF
+  // file loading and the first call of each function, after running all
+  // functions.
+  bool print_startup_profile = false;
+  // Defer the registration of the static kernel families until their kernels
+  // are looked up, see TFRT_STATIC_KERNEL_FAMILY_REGISTRATION.
+  bool defer_kernel_registration = false;
+  // BEF files that are opened in parallel with the input file, e.g. to
+  // measure the cold start of a server that loads several programs.
+  ArrayRef<std::string> preload_bef_files;
+
+  // If not empty, write the signatures of the function calls to this file
+  // after running all functions, see RequestRecorder.
+  std::string record_signatures_filename;
+  // If not empty, call the functions of the signatures in this file (written
+  // with `record_signatures_filename`) with zero-filled arguments before
+  // running the functions, to warm up the caches, see WarmUp.
+  std::string warmup_signatures_filename;
+
+  // If `load_num_callers` or `load_qps` is positive, run each function
+  // repeatedly under load for `load_duration_secs` instead of once, and print
+  // the throughput and latency percentiles of the calls.
+  //
+  // Number of concurrent callers of a closed loop, each of which calls the
+  // function again when its previous call has completed.
+  int load_num_callers = 0;
+  // Target calls per second of an open loop. The calls arrive at exponentially
+  // distributed intervals (a Poisson process) regardless of how many calls are
+  // in flight, and their latency includes the time they wait to be started.
+  // Takes precedence over `load_num_callers`.
+  double load_qps = 0;
+  // Calls that start during the warmup are not measured.
+  double load_warmup_secs = 1;
+  double load_duration_secs = 10;
 };
 
 // Run the BEF program with default execution context.
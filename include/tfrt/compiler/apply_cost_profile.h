@@ -0,0 +1,49 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Profile-guided operation costs for stream assignment.
+//
+// The pass reads a kernel cost profile written by `bef_executor
+// --kernel_cost_profile=<file>`, and sets the `_tfrt_cost` attribute of each
+// operation that the profile has a record for to its average execution time.
+// StreamAnalysis then uses the measured costs instead of treating every
+// operation without a cost as expensive.
+//
+// Operations are matched to the profile by kernel name and source location, so
+// the profile has to be recorded from a BEF file translated from the same MLIR
+// file. The times are converted to cost units of `ns-per-cost-unit`
+// nanoseconds, which is also the unit of the `tfrt.cost_threshold` attribute.
+
+#ifndef TFRT_COMPILER_APPLY_COST_PROFILE_H_
+#define TFRT_COMPILER_APPLY_COST_PROFILE_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "llvm/ADT/StringRef.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+namespace tfrt {
+namespace compiler {
+
+std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>> CreateApplyCostProfilePass(
+    llvm::StringRef profile_filename, int64_t ns_per_cost_unit = 1000);
+
+}  // namespace compiler
+}  // namespace tfrt
+
+#endif  // TFRT_COMPILER_APPLY_COST_PROFILE_H_
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Optimization pipeline for modules in TFRT dialects before BEF emission.
+//
+// BEF files otherwise carry whatever the frontend emitted. The pipeline runs:
+//
+// 1. The inliner, which inlines the functions called with `tfrt.call`, so
+//    that small wrapper functions do not cost a function call at runtime.
+// 2. Symbol DCE, which removes the private functions that are no longer used.
+// 3. The canonicalizer, which folds the arithmetic basic kernels on constants,
+//    simplifies `tfrt.merge.chains` and removes kernels without side effects
+//    whose results are unused.
+// 4. CSE, which deduplicates equal kernels without side effects such as
+//    constants and `tfrt.new.chain`, followed by another canonicalization.
+//
+// It is registered as the `tfrt-optimize-bef` pass pipeline.
+
+#ifndef TFRT_COMPILER_BEF_OPTIMIZATION_H_
+#define TFRT_COMPILER_BEF_OPTIMIZATION_H_
+
+#include "mlir/Pass/PassManager.h"
+
+namespace tfrt {
+namespace compiler {
+
+// Adds the BEF optimization passes to `pm`, which runs on a module.
+void CreateBEFOptimizationPipeline(mlir::OpPassManager& pm);
+
+}  // namespace compiler
+}  // namespace tfrt
+
+#endif  // TFRT_COMPILER_BEF_OPTIMIZATION_H_
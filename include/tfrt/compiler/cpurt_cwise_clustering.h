@@ -0,0 +1,54 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Clustering of CoreRuntime elementwise op chains into CPURT kernels.
+//
+// The pass finds chains of `corert.executeop` operations on the "cpu" op
+// handler that run the elementwise TF ops `tf.AddV2`, `tf.Mul`, `tf.Relu` and
+// `tf.BiasAdd`, and replaces each cluster with a `cpurt.corert.compile` +
+// `cpurt.corert.execute` pair. The cluster is compiled into a single
+// `linalg.generic` operation that computes all the fused ops in one loop nest,
+// without materializing the intermediate tensors.
+//
+// CoreRuntime tensor handles are not typed, so the compiled kernels assume
+// that all tensors are f32 tensors of the same `rank` (and bias vectors of
+// rank 1), and that the operands of the binary ops have the same shape (no
+// broadcasting). The kernels verify the shapes at runtime and abort if they
+// do not match, so the pass must only be used for programs that satisfy these
+// assumptions. Operands of an unexpected rank or type are reported as errors
+// by the `cpurt.corert.execute` operation.
+//
+// Clusters with fewer than `min_cluster_size` ops are not worth the kernel
+// launch overhead and are left to the CoreRuntime op handler.
+
+#ifndef TFRT_COMPILER_CPURT_CWISE_CLUSTERING_H_
+#define TFRT_COMPILER_CPURT_CWISE_CLUSTERING_H_
+
+#include <memory>
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+namespace tfrt {
+namespace compiler {
+
+std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>>
+CreateCpurtCwiseClusteringPass(int rank = 2, int min_cluster_size = 2);
+
+}  // namespace compiler
+}  // namespace tfrt
+
+#endif  // TFRT_COMPILER_CPURT_CWISE_CLUSTERING_H_
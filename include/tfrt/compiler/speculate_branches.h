@@ -0,0 +1,53 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Speculative execution of cheap `tfrt.cond` and `tfrt.case` branches.
+//
+// The pass sets the `speculative` attribute of `tfrt.cond` and `tfrt.case`
+// operations whose branch functions are all cheap and free of side effects.
+// The runtime then runs all branches without waiting for the condition or
+// branch index, and drops the results of the branches that are not selected.
+// This takes the branches off the critical path when the condition depends on
+// a long-running computation.
+//
+// A branch is cheap if the total cost of its operations, as computed by
+// StreamAnalysis, does not exceed the cost threshold (the module or function
+// attribute `tfrt.cost_threshold`). All branches run, so the total cost and
+// not the critical path cost is what speculation spends. Operations without a
+// `_tfrt_cost` attribute cost the threshold, so by default only single
+// operation branches are speculated.
+//
+// A branch is free of side effects if all its operations have no memory
+// effects and no regions.
+
+#ifndef TFRT_COMPILER_SPECULATE_BRANCHES_H_
+#define TFRT_COMPILER_SPECULATE_BRANCHES_H_
+
+#include <memory>
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+namespace tfrt {
+namespace compiler {
+
+std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>>
+CreateSpeculateBranchesPass();
+
+}  // namespace compiler
+}  // namespace tfrt
+
+#endif  // TFRT_COMPILER_SPECULATE_BRANCHES_H_
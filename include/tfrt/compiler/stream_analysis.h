@@ -114,6 +114,22 @@ class StreamAnalysis {
   // It is set through the module attribute `tfrt.cost_threshold`.
   int64_t GetCostThreshold() const { return options_.cost_threshold; }
 
+  // Return the cost of `op` itself. Operations without a `_tfrt_cost`
+  // attribute cost the cost threshold. `op` can be nullptr for the root.
+  int64_t GetOperationCost(mlir::Operation* op) const;
+
+  // Return the critical path cost of `op`, which is the cost of `op` plus the
+  // largest critical path cost among its users. It is the cost of the most
+  // expensive chain of dependent operations from `op` to the end of the
+  // function. `op` can be nullptr for the root, whose critical path cost is the
+  // critical path cost of the function. Executing operations with higher
+  // critical path costs first reduces the latency of the function.
+  int64_t GetCriticalPathCost(mlir::Operation* op) const {
+    auto it = critical_path_cost_map_.find(op);
+    assert(it != critical_path_cost_map_.end());
+    return it->second;
+  }
+
  private:
   void GetOptionsForBlock(mlir::Block& block);
   void AnalyzeBlock(mlir::Block& block);
@@ -121,7 +137,7 @@ class StreamAnalysis {
   void BuildStreamBackwardPass(mlir::Block& block);
   void BuildStreamForOp(mlir::Operation* op);
   void FinalizeStreams(mlir::Block& block);
-  int64_t GetOperationCost(mlir::Operation* op) const;
+  void ComputeCriticalPathBackwardPass(mlir::Block& block);
 
   // BuildInfo is a temporary data structure for keeping stream and op
   // information during building the stream tree. It is used for efficient
@@ -177,6 +193,9 @@ class StreamAnalysis {
 
   // `stream_map_` contains the finalized op-to-stream mapping.
   llvm::DenseMap<mlir::Operation*, Stream*> stream_map_;
+
+  // `critical_path_cost_map_` contains the critical path cost of each op.
+  llvm::DenseMap<mlir::Operation*, int64_t> critical_path_cost_map_;
 };
 
 }  // namespace compiler
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares BatchedOp, which batches concurrent calls of an op.
+
+#ifndef TFRT_CORE_RUNTIME_BATCHED_OP_H_
+#define TFRT_CORE_RUNTIME_BATCHED_OP_H_
+
+#include <chrono>
+#include <vector>
+
+#include "tfrt/core_runtime/core_runtime_op.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/ref_count.h"
+
+namespace tfrt {
+
+class ExecutionContext;
+class TensorHandle;
+
+struct BatchingOptions {
+  // A batch is executed as soon as its calls have this many rows.
+  int max_batch_size = 32;
+  // A batch that is not full is executed this long after its first call.
+  std::chrono::nanoseconds batch_timeout = std::chrono::milliseconds(1);
+  // Sizes that the batches are padded to with zero rows, in ascending order,
+  // e.g. so that a compiled op sees few distinct shapes. A batch larger than
+  // the largest size is not padded. If empty, batches are not padded.
+  std::vector<int> allowed_batch_sizes;
+};
+
+// A BatchedOp executes an op once for several concurrent calls, e.g. the
+// single example requests of a model server. The calls pass dense host
+// tensors whose first dimension is the batch dimension. The arguments of the
+// calls in a batch are concatenated along this dimension, the op is executed
+// once, and its results are split back into the rows of each call. The
+// results of a call are dense host tensors on the host device.
+//
+// The op must compute each row of its results from the same rows of its
+// arguments, and all calls must pass arguments of the same dtypes and row
+// shapes. It is executed with the ExecutionContext of the first call of the
+// batch and must not have side effects.
+//
+// Example:
+//
+//   BatchedOp batched_op(std::move(op), attrs.freeze(), /*num_results=*/1,
+//                        {/*max_batch_size=*/32});
+//   // On each request:
+//   TensorHandle result;
+//   batched_op(exec_ctx, {example}, result);
+//
+// BatchedOp is thread-safe. Pending calls are executed when it is destroyed.
+class BatchedOp {
+ public:
+  BatchedOp(CoreRuntimeOp op, OpAttrsRef attrs, int num_results,
+            BatchingOptions options);
+  ~BatchedOp();
+
+  BatchedOp(const BatchedOp&) = delete;
+  BatchedOp& operator=(const BatchedOp&) = delete;
+
+  // Adds a call to the current batch and fills in `results` with
+  // TensorHandles that become available when the batch has been executed.
+  // Like CoreRuntimeOp, this takes the argument TensorHandles.
+  void operator()(const ExecutionContext& exec_ctx,
+                  MutableArrayRef<TensorHandle> arguments,
+                  MutableArrayRef<TensorHandle> results);
+
+  // Executes the current batch without waiting for more calls.
+  void Flush();
+
+ private:
+  class Batcher;
+  RCReference<Batcher> batcher_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_CORE_RUNTIME_BATCHED_OP_H_
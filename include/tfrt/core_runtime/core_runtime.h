@@ -35,6 +35,7 @@ class Function;
 class HostAllocator;
 class HostContext;
 class OpAttrsRef;
+class OpBatch;
 class CoreRuntimeOp;
 class OpHandler;
 class TensorHandle;
@@ -98,6 +99,18 @@ class CoreRuntime final {
                const OpAttrsRef& attrs, MutableArrayRef<TensorHandle> results,
                AsyncValueRef<Chain>* chain);
 
+  // Execute the ops of `batch` in order, taking `arguments` as the batch
+  // arguments and filling in `results` with the batch results. The ops were
+  // resolved against their op handlers when the batch was built, so this only
+  // dispatches them. `chain`, if not null, is threaded through all ops of the
+  // batch.
+  //
+  // Like Execute, this takes the input argument TensorHandle's.
+  void ExecuteBatch(const ExecutionContext& exec_ctx, const OpBatch& batch,
+                    MutableArrayRef<TensorHandle> arguments,
+                    MutableArrayRef<TensorHandle> results,
+                    AsyncValueRef<Chain>* chain);
+
   // [Experimental]
   // Return an CoreRuntimeOp (a callable) that clients can use to execute an op
   // directly, or an error if it cannot find the op in the op registry.
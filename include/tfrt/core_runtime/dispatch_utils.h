@@ -135,6 +135,13 @@ void ExecuteWhenMetadataIsReady(const OpInvocation& invocation,
                                 bool update_chain, RCReference<Device> device,
                                 MetadataIsReadyCallback callback);
 
+// Replaces each resolved IndirectAsyncValue in `arguments` that is referenced
+// only by `arguments` with the value it forwards to. Kernels may forward the
+// buffer of an argument to a result when they hold the only reference to it
+// (see AsyncValue::IsUnique), which never holds for an IndirectAsyncValue.
+void UnwrapDonatableArguments(
+    MutableArrayRef<RCReference<AsyncValue>> arguments);
+
 template <typename OpHandlerTraits>
 class AsyncOpDispatcher {
  public:
@@ -251,6 +258,7 @@ void AsyncOpDispatcher<OpHandlerTraits>::RunDispatchFunction() {
     // bail out.
     if (arg->IsError()) return PropagateError(arg.get());
   }
+  UnwrapDonatableArguments(arguments_);
 
   // Finally, run the dispatch function.
   SmallVector<RCReference<AsyncValue>, 4> result_tensors;
@@ -421,6 +429,7 @@ void ExecuteWithResultMetadataResolved(
   if (async_args.empty()) {
     // All input tensor and input chain are available. We can immediately
     // dispatch the kernel synchronously.
+    internal::UnwrapDonatableArguments(arg_tensors);
     SmallVector<RCReference<AsyncValue>, 4> result_tensors;
     SmallVector<AsyncValueRef<TensorMetadata>, 0> empty_md_avs;
     internal::AsyncOpDispatcher<OpHandlerTraits>::RunDispatchFunctionSync(
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the create function for the LazyOpHandler.
+//
+// The LazyOpHandler wraps another op handler and defers the execution of
+// "tf.MatMul", "tf.Conv2D", "tf.BiasAdd" and "tf.Relu" ops, so that eager
+// chains like Relu(BiasAdd(MatMul(a, b), bias)) can be executed as a single
+// "tf._FusedMatMul" (or "tf._FusedConv2D") op of the wrapped op handler. All
+// other ops are passed through to the wrapped op handler.
+//
+// A deferred op is executed when the next op is dispatched to the op handler,
+// or by a task enqueued to the work queue when the op was deferred, so the
+// results of deferred ops are always eventually available. Intermediate
+// results of a chain are only fused away if no one else references them.
+
+#ifndef TFRT_CORE_RUNTIME_LAZY_OP_HANDLER_H_
+#define TFRT_CORE_RUNTIME_LAZY_OP_HANDLER_H_
+
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+class OpHandler;
+class CoreRuntime;
+
+llvm::Expected<tfrt::OpHandler *> CreateLazyOpHandler(
+    tfrt::CoreRuntime *runtime, OpHandler *fallback);
+
+}  // namespace tfrt
+
+#endif  // TFRT_CORE_RUNTIME_LAZY_OP_HANDLER_H_
@@ -24,6 +24,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <unordered_map>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/None.h"
@@ -33,12 +34,15 @@
 #include "tfrt/core_runtime/op_attr_type.h"
 #include "tfrt/host_context/attribute_utils.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
 
 class OpAttrsRef;
 class ImmutableOpAttrs;
+class OpAttrsInterner;
 
 // Defines entry type
 //  When kExternalScalar and kExternalArray types are used,
@@ -407,6 +411,7 @@ class OpAttrs final {
 
   class OutOfLineRepresentation;
   friend class OutOfLineRepresentation;
+  friend class OpAttrsInterner;
 
   // Most op invocations have a small number of attributes, and we want them
   // to be formed without an allocation.  This array holds the string and
@@ -633,11 +638,59 @@ class OpAttrsRef {
   void Print(raw_ostream& os) const;
   void Dump() const;
 
+  // Return a fingerprint of the names and values of the attributes, which does
+  // not depend on the order the attributes were set in. Returns None if the
+  // attribute values are larger than `max_value_bytes` in total, as hashing
+  // them on every op invocation would be too expensive. The fingerprint of an
+  // interned attribute set is always returned, it is computed only once.
+  Optional<uint64_t> Fingerprint(size_t max_value_bytes) const;
+
+  // Return true if this refers to an attribute set returned by
+  // OpAttrsInterner::Intern().
+  bool IsInterned() const;
+
+  // Return a pointer that identifies an interned attribute set: two interned
+  // attribute sets from the same OpAttrsInterner have the same contents if and
+  // only if they have the same identity. Returns nullptr if the set is not
+  // interned.
+  const void* GetInternedIdentity() const;
+
  private:
   // If the pointer is null, then the represented attribute set is empty.
   llvm::PointerUnion<const OpAttrs*, ImmutableOpAttrs*> attrs_;
 };
 
+// Interns attribute sets: identical attribute sets are frozen once, and all
+// later calls to Intern() with the same attributes return a reference to the
+// same immutable copy without allocating. This is intended for clients that
+// build the same attribute sets for every op invocation.
+//
+// Interned sets are never evicted, so the number of distinct attribute sets
+// passed to an interner should be bounded. OpAttrsInterner is thread-safe.
+class OpAttrsInterner {
+ public:
+  OpAttrsInterner() = default;
+  ~OpAttrsInterner();
+
+  OpAttrsInterner(const OpAttrsInterner&) = delete;
+  OpAttrsInterner& operator=(const OpAttrsInterner&) = delete;
+
+  // Return the interned copy of `attrs`. Attribute sets with external
+  // attributes reference memory the interner does not own, they are frozen
+  // but not interned.
+  OpAttrsRef Intern(const OpAttrs& attrs);
+
+  // Return the number of distinct interned attribute sets.
+  size_t size() const;
+
+ private:
+  mutable mutex mu_;
+  // Interned attribute sets keyed by their fingerprint. The interner owns a
+  // reference to each of them.
+  std::unordered_multimap<uint64_t, ImmutableOpAttrs*> interned_
+      TFRT_GUARDED_BY(mu_);
+};
+
 // Return the OpAttrType converted from DType.
 OpAttrType GetOpAttrTypeFromDType(DType::Kind kind);
 
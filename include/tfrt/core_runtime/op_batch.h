@@ -0,0 +1,135 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares OpBatch, a sequence of ops that is executed with a single
+// call to CoreRuntime::ExecuteBatch.
+
+#ifndef TFRT_CORE_RUNTIME_OP_BATCH_H_
+#define TFRT_CORE_RUNTIME_OP_BATCH_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/core_runtime/core_runtime_op.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+class CoreRuntime;
+class OpHandler;
+
+// An OpBatch describes a sequence of ops whose arguments refer symbolically to
+// the arguments of the batch or to the results of earlier ops in the batch.
+// The ops are resolved against their op handlers once, when they are added,
+// and the batch can then be executed any number of times with
+// CoreRuntime::ExecuteBatch. This avoids the per-op handler lookup and
+// TensorHandle bookkeeping of issuing the ops one by one.
+//
+// Example: computing (x + y) * x.
+//
+//   OpBatch batch(runtime);
+//   OpBatch::ValueId x = batch.AddArgument();
+//   OpBatch::ValueId y = batch.AddArgument();
+//   OpBatch::ValueId sum = *batch.AddOp("tfrt_test.add", cpu, {x, y}, attrs);
+//   OpBatch::ValueId product =
+//       *batch.AddOp("tfrt_test.multiply", cpu, {sum, x}, attrs);
+//   batch.AddResult(product);
+//
+// OpBatch is not thread-safe while it is being built, but a fully built batch
+// may be executed concurrently.
+class OpBatch {
+ public:
+  // A symbolic reference to a TensorHandle of the batch.
+  using ValueId = uint32_t;
+
+  explicit OpBatch(CoreRuntime* runtime) : runtime_(runtime) {}
+
+  OpBatch(const OpBatch&) = delete;
+  OpBatch& operator=(const OpBatch&) = delete;
+
+  // Adds an argument to the batch. The arguments are passed to ExecuteBatch in
+  // the order they are added.
+  ValueId AddArgument();
+
+  // Adds an op to the batch and returns the id of its first result. The
+  // results of the op have consecutive ids. Returns an error if `op_handler`
+  // does not support the op.
+  Expected<ValueId> AddOp(string_view op_name, OpHandler* op_handler,
+                          ArrayRef<ValueId> arguments, const OpAttrs& attrs,
+                          size_t num_results = 1);
+
+  // Marks `value` as a result of the batch. The results are returned by
+  // ExecuteBatch in the order they are added.
+  void AddResult(ValueId value);
+
+  size_t num_arguments() const { return argument_values_.size(); }
+  size_t num_results() const { return results_.size(); }
+  size_t num_ops() const { return ops_.size(); }
+
+ private:
+  friend class CoreRuntime;
+
+  struct Op {
+    const CoreRuntimeOp* op;
+    OpAttrsRef attrs;
+    // The range of the arguments of the op in `op_arguments_`.
+    uint32_t arguments_begin;
+    uint32_t num_arguments;
+    ValueId first_result;
+    uint32_t num_results;
+  };
+
+  struct OpArgument {
+    ValueId value;
+    // True if the op can take the TensorHandle, because no later op or batch
+    // result refers to it.
+    bool take;
+  };
+
+  // Executes the batch. See CoreRuntime::ExecuteBatch.
+  void Execute(const ExecutionContext& exec_ctx,
+               MutableArrayRef<TensorHandle> arguments,
+               MutableArrayRef<TensorHandle> results,
+               AsyncValueRef<Chain>* chain) const;
+
+  CoreRuntime* runtime_;
+
+  // The CoreRuntimeOps of the batch, deduplicated by op handler and op name.
+  llvm::DenseMap<OpHandler*, llvm::StringMap<CoreRuntimeOp>> resolved_ops_;
+
+  std::vector<Op> ops_;
+  // The arguments of all ops in `ops_`.
+  std::vector<OpArgument> op_arguments_;
+  // The values of the batch arguments and results.
+  std::vector<ValueId> argument_values_;
+  std::vector<ValueId> results_;
+
+  uint32_t num_values_ = 0;
+  uint32_t max_op_arguments_ = 0;
+
+  // The index in `op_arguments_` of the last use of each value, kNoUse if the
+  // value is not used yet or kEscaped if the value is a batch result.
+  static constexpr int32_t kNoUse = -1;
+  static constexpr int32_t kEscaped = -2;
+  std::vector<int32_t> last_use_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_CORE_RUNTIME_OP_BATCH_H_
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Caches used on the op dispatch path.
+//
+// The op handlers decide for each argument of an op whether it has to be
+// converted to another tensor type, and look up the conversion function in
+// the TensorConversionFnRegistry. The decision only depends on the tensor type,
+// dtype and device of the argument, which rarely change between invocations of
+// the same op, so it is remembered in a small per-op ArgumentConversionCache.
+//
+// Similarly, the result metadata computed by an op metadata function only
+// depends on the argument metadata and the op attributes. The
+// MetadataFnCache remembers them for all ops of a HostContext.
+
+#ifndef TFRT_CORE_RUNTIME_OP_DISPATCH_CACHE_H_
+#define TFRT_CORE_RUNTIME_OP_DISPATCH_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/core_runtime/op_metadata_function.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/shared_context.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/tensor_type_registration.h"
+
+namespace tfrt {
+
+class Device;
+class HostContext;
+class OpAttrsRef;
+
+class ArgumentConversionCache {
+ public:
+  struct Key {
+    TensorType tensor_type = TensorType::kUnknownTensorType;
+    DType dtype;
+    const Device* device = nullptr;
+
+    bool operator==(const Key& other) const {
+      return tensor_type == other.tensor_type && dtype == other.dtype &&
+             device == other.device;
+    }
+  };
+
+  struct Entry {
+    Key key;
+    // The tensor type the argument is converted to. If it is the type of the
+    // argument, the argument is passed as is.
+    TensorType dst_tensor_type = TensorType::kUnknownTensorType;
+    // False if the op handler does not allow the implicit conversion.
+    bool allowed = false;
+    // The registered conversion function, or nullptr if there is none.
+    TensorConversionFn conversion_fn = nullptr;
+
+    bool IsNoOp() const { return dst_tensor_type == key.tensor_type; }
+  };
+
+  // The number of argument kinds remembered per op. Ops that see more kinds
+  // of arguments fall back to the uncached lookups for the rest.
+  static constexpr int kNumEntries = 4;
+
+  ArgumentConversionCache() = default;
+  ~ArgumentConversionCache();
+
+  ArgumentConversionCache(const ArgumentConversionCache&) = delete;
+  ArgumentConversionCache& operator=(const ArgumentConversionCache&) = delete;
+
+  // Returns the entry for `key`, or nullptr if it is not cached. Lookup() is
+  // lock-free and can be called concurrently with Insert().
+  const Entry* Lookup(const Key& key) const {
+    for (const auto& slot : entries_) {
+      const Entry* entry = slot.load(std::memory_order_acquire);
+      if (entry == nullptr) return nullptr;
+      if (entry->key == key) return entry;
+    }
+    return nullptr;
+  }
+
+  // Inserts `entry` into the cache. Returns the cached copy of `entry`, or
+  // nullptr if the cache is full.
+  const Entry* Insert(const Entry& entry);
+
+ private:
+  // Entries are never removed, so a pointer returned by Lookup() stays valid
+  // until the cache is destroyed.
+  std::atomic<const Entry*> entries_[kNumEntries] = {};
+};
+
+// Cache of the results of op metadata functions, keyed by the metadata
+// function, the argument metadata and a fingerprint of the op attributes.
+// Metadata functions must be pure functions of these for the cache to be
+// valid. Failed metadata functions are not cached.
+//
+// The cache is sharded to reduce lock contention between threads dispatching
+// ops concurrently. A shard is cleared when it is full.
+class MetadataFnCache : public SharedContext {
+ public:
+  // Attributes with larger values are not cached, because fingerprinting them
+  // is about as expensive as running the metadata function.
+  static constexpr size_t kMaxAttrValueBytes = 1024;
+
+  static constexpr int kNumShards = 16;
+  static constexpr size_t kMaxEntriesPerShard = 512;
+
+  struct Stats {
+    uint64_t num_hits = 0;
+    uint64_t num_misses = 0;
+    // The number of invocations with attributes too large to fingerprint.
+    uint64_t num_uncacheable = 0;
+  };
+
+  explicit MetadataFnCache(HostContext* host) {}
+
+  // Returns the cache shared by all ops executed in `host`.
+  static MetadataFnCache& Get(HostContext* host);
+
+  // Runs `metadata_fn`, or copies its results from the cache if it was called
+  // with the same argument metadata and attributes before. Returns the error
+  // of the metadata function on failure.
+  RCReference<AsyncValue> Run(OpMetadataFn metadata_fn,
+                              const ExecutionContext& exec_ctx,
+                              ArrayRef<TensorMetadata> arguments,
+                              const OpAttrsRef& attrs,
+                              MutableArrayRef<TensorMetadata> results);
+
+  Stats GetStats() const;
+
+ private:
+  struct Entry {
+    OpMetadataFn metadata_fn;
+    uint64_t attrs_fingerprint;
+    llvm::SmallVector<TensorMetadata, 4> arguments;
+    llvm::SmallVector<TensorMetadata, 2> results;
+  };
+
+  struct Shard {
+    mutable mutex mu;
+    llvm::DenseMap<uint64_t, Entry> entries TFRT_GUARDED_BY(mu);
+  };
+
+  bool Lookup(uint64_t hash, OpMetadataFn metadata_fn,
+              ArrayRef<TensorMetadata> arguments, uint64_t attrs_fingerprint,
+              MutableArrayRef<TensorMetadata> results);
+  void Insert(uint64_t hash, OpMetadataFn metadata_fn,
+              ArrayRef<TensorMetadata> arguments, uint64_t attrs_fingerprint,
+              ArrayRef<TensorMetadata> results);
+
+  // Counts a lookup, and records the hit rate of the last kReportInterval
+  // lookups in the "/tfrt/core_runtime/metadata_fn_cache/hit_rate" histogram.
+  void RecordLookup(bool hit);
+  static constexpr uint64_t kReportInterval = 1024;
+
+  Shard shards_[kNumShards];
+
+  std::atomic<uint64_t> num_hits_{0};
+  std::atomic<uint64_t> num_misses_{0};
+  std::atomic<uint64_t> num_uncacheable_{0};
+  // The number of hits since the hit rate was last recorded.
+  std::atomic<uint64_t> num_interval_hits_{0};
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_CORE_RUNTIME_OP_DISPATCH_CACHE_H_
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Request signatures
+//
+// This file declares the recording of the signatures of function calls (the
+// function and the dtypes and shapes of its arguments) and their replay with
+// zero-filled arguments, to warm up the caches of a server before it takes
+// traffic: the specializations of compiled kernels, the op dispatch caches
+// and the allocator pools.
+//
+//   // While serving, e.g. on a canary:
+//   RequestRecorder recorder;
+//   recorder.Record(*function, arguments);
+//   ...
+//   recorder.Write(os);
+//
+//   // After a deploy, before taking traffic:
+//   auto signatures = ParseRequestSignatures(buffer->getBuffer());
+//   WarmUp(*signatures, find_function, exec_ctx);
+
+#ifndef TFRT_CORE_RUNTIME_REQUEST_SIGNATURE_H_
+#define TFRT_CORE_RUNTIME_REQUEST_SIGNATURE_H_
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringSet.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+
+class AsyncValue;
+class ExecutionContext;
+class Function;
+
+struct RequestSignature {
+  enum class ArgumentKind { kChain, kDenseHostTensor, kTensorHandle };
+
+  struct Argument {
+    ArgumentKind kind;
+    // The metadata of tensor and tensor handle arguments.
+    llvm::Optional<TensorMetadata> metadata;
+  };
+
+  std::string function_name;
+  llvm::SmallVector<Argument, 4> arguments;
+};
+
+// Returns the signature of a call of `function` with `arguments`. The
+// arguments must be available chains, dense host tensors, or tensor handles
+// with available metadata.
+Expected<RequestSignature> GetRequestSignature(
+    const Function& function, ArrayRef<AsyncValue*> arguments);
+
+// Prints a signature as one line, e.g. "main chain dht:f32[2,3] th:i32[]".
+std::string PrintRequestSignature(const RequestSignature& signature);
+
+// Parses a signature printed by PrintRequestSignature.
+Expected<RequestSignature> ParseRequestSignature(string_view line);
+
+// Records the distinct signatures of function calls. Calls with arguments
+// that have no signature are ignored. RequestRecorder is thread-safe.
+class RequestRecorder {
+ public:
+  void Record(const Function& function, ArrayRef<AsyncValue*> arguments);
+
+  // Returns the distinct signatures in the order they were first recorded.
+  std::vector<RequestSignature> GetSignatures() const;
+
+  // Writes one signature per line.
+  void Write(raw_ostream& os) const;
+
+ private:
+  mutable mutex mu_;
+  llvm::StringSet<> printed_ TFRT_GUARDED_BY(mu_);
+  std::vector<RequestSignature> signatures_ TFRT_GUARDED_BY(mu_);
+};
+
+// Parses the signatures written by RequestRecorder::Write. Empty lines are
+// ignored.
+Expected<std::vector<RequestSignature>> ParseRequestSignatures(
+    string_view text);
+
+// Calls the functions of `signatures` that `find_function` returns (or null
+// if a function does not exist) once each with zero-filled arguments of the
+// signature, and waits for the calls to complete. Tensor handles are on the
+// host device. Returns an error if a call failed, but still makes all the
+// calls. Synchronous BEF functions are not supported.
+Error WarmUp(ArrayRef<RequestSignature> signatures,
+             llvm::function_ref<const Function*(string_view)> find_function,
+             const ExecutionContext& exec_ctx);
+
+}  // namespace tfrt
+
+#endif  // TFRT_CORE_RUNTIME_REQUEST_SIGNATURE_H_
@@ -43,7 +43,9 @@ class TensorHandle final {
   }
 
   // A TensorHandle owns a `async_metadata`, `tensor` and 'device', none of
-  // these input pointer is allowed to be NULL.
+  // these input pointer is allowed to be NULL. A device or metadata that is
+  // already available is stored inline, and a resolved IndirectAsyncValue
+  // `tensor` is replaced by the value it forwards to.
   TensorHandle(AsyncValueRef<RCReference<Device>> async_device,
                AsyncValueRef<TensorMetadata> async_metadata,
                AsyncValueRef<Tensor> tensor);
@@ -174,6 +176,14 @@ class TensorHandle final {
     return tensor_and_flags_.getInt() & Flags::MetadataInline;
   }
 
+  // Returns the +1 reference to the tensor of a new TensorHandle.
+  static AsyncValue* ReleaseTensor(AsyncValueRef<Tensor> tensor);
+
+  // Initializes the device and metadata of a new TensorHandle. They are stored
+  // inline if they are already available.
+  void InitDevice(AsyncValueRef<RCReference<Device>> async_device);
+  void InitMetadata(AsyncValueRef<TensorMetadata> async_metadata);
+
   // Reset both tensor and metadata to default initialized state.
   void Reset() {
     if (IsMetadataInline()) {
@@ -28,15 +28,6 @@
 #include "tfrt/support/rc_array.h"
 #include "tfrt/support/ref_count.h"
 
-// If there are too many recursive calls, the stack size limit will be exceeded
-// and it will cause segmentation fault. The maximum number of recursive calls
-// depend on the OS level stack size and the size of the recursive function,
-// which is hard to know for sure. We need to balance between threadpool
-// scheduling overhead and the risk of hitting stack size limit when choosing
-// the frequency of scheduling the callback in the threadpool.
-// TODO(b/156791937): Consider moving this logic into AsyncValue implementation.
-#define MAX_RECURSIVE_CALLS 100
-
 namespace tfrt {
 namespace data {
 
@@ -133,8 +124,22 @@ static void AllocateTupleResult(
 
 }  // namespace internal
 
+class Autotuner;
+class IteratorStats;
+class PipelineStats;
+
 // This struct provides parameters specific to iterator creation.
-struct IteratorContext {};
+struct IteratorContext {
+  // Tunes the arguments set to AUTOTUNE of the iterators of the pipeline. May
+  // be null, in which case they take a default value.
+  std::shared_ptr<Autotuner> autotuner;
+  // Collects the stats of the iterators of the pipeline. May be null, in which
+  // case the iterators are not instrumented.
+  std::shared_ptr<PipelineStats> stats;
+  // The stats of the stage whose iterator creates the iterator, if `stats` is
+  // set.
+  IteratorStats* consumer_stats = nullptr;
+};
 
 class Iterator : public ReferenceCounted<Iterator> {
  public:
@@ -156,9 +161,17 @@ class Dataset : public ReferenceCounted<Dataset> {
  public:
   virtual ~Dataset() {}
 
-  // Creates an iterator that points to the first element of the dataset.
-  // The iterator should keep +1 reference to the parent_dataset.
-  virtual RCReference<Iterator> MakeIterator(
+  // Creates an iterator that points to the first element of the dataset. If
+  // `context.stats` is set, the iterator records its stats there.
+  RCReference<Iterator> MakeIterator(const IteratorContext& context);
+
+  // Returns the name of the dataset in the stats of its iterators.
+  virtual string_view name() const = 0;
+
+ protected:
+  // Creates the iterator returned by MakeIterator(). The iterator should keep
+  // +1 reference to the parent_dataset.
+  virtual RCReference<Iterator> MakeIteratorImpl(
       const IteratorContext& context) = 0;
 
  private:
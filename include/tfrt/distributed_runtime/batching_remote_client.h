@@ -0,0 +1,132 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares BatchingRemoteClient, which coalesces small requests to a
+// remote task into batches.
+
+#ifndef TFRT_DISTRIBUTED_RUNTIME_BATCHING_REMOTE_CLIENT_H_
+#define TFRT_DISTRIBUTED_RUNTIME_BATCHING_REMOTE_CLIENT_H_
+
+#include <memory>
+#include <vector>
+
+#include "llvm/ADT/FunctionExtras.h"
+#include "tfrt/distributed_runtime/remote_client.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+// BatchingRemoteClient wraps the client of one remote task. It coalesces the
+// RemoteExecute, SendReadyChains and DeleteRemoteObjects requests into batches
+// sent with BatchAsync of the wrapped client, which amortizes the overhead of
+// an RPC over many small requests. Requests with a call context other than the
+// default one, and all other calls, are forwarded as is.
+//
+// A batch is sent right away while fewer than `max_inflight_batches` batches
+// are in flight, so a lightly loaded client adds no latency. Otherwise the
+// requests accumulate, and are sent when a batch completes or when the batch
+// is full.
+class BatchingRemoteClient final : public RemoteClientInterface {
+ public:
+  struct Options {
+    // Maximum number of requests in a batch.
+    size_t max_batch_size = 128;
+    // A batch is full once its requests take this many bytes.
+    size_t max_batch_bytes = 1024 * 1024;
+    // Maximum number of batches in flight before requests accumulate.
+    size_t max_inflight_batches = 2;
+  };
+
+  BatchingRemoteClient(std::unique_ptr<RemoteClientInterface> client,
+                       Options options)
+      : client_(std::move(client)), options_(options) {}
+
+  // All calls must have completed.
+  ~BatchingRemoteClient() override;
+
+#define FORWARD_CLIENT_METHOD(method)                                       \
+  void method##Async(RemoteCallContext* call_ctx,                           \
+                     const method##Request* request,                        \
+                     method##Response* response, CallbackFn done) override { \
+    client_->method##Async(call_ctx, request, response, std::move(done));   \
+  }
+
+  FORWARD_CLIENT_METHOD(GetDevices);
+  FORWARD_CLIENT_METHOD(CreateContext);
+  FORWARD_CLIENT_METHOD(CloseContext);
+  FORWARD_CLIENT_METHOD(SendData);
+  FORWARD_CLIENT_METHOD(RegisterFunction);
+  FORWARD_CLIENT_METHOD(RemoteExecuteOp);
+  FORWARD_CLIENT_METHOD(KeepAlive);
+  FORWARD_CLIENT_METHOD(Batch);
+
+#undef FORWARD_CLIENT_METHOD
+
+  void RemoteExecuteAsync(RemoteCallContext* call_ctx,
+                          const RemoteExecuteRequest* request,
+                          RemoteExecuteResponse* response,
+                          CallbackFn done) override;
+
+  void SendReadyChainsAsync(RemoteCallContext* call_ctx,
+                            const SendReadyChainsRequest* request,
+                            SendReadyChainsResponse* response,
+                            CallbackFn done) override;
+
+  void DeleteRemoteObjectsAsync(RemoteCallContext* call_ctx,
+                                const DeleteRemoteObjectsRequest* request,
+                                DeleteRemoteObjectsResponse* response,
+                                CallbackFn done) override;
+
+  void SendDataWithPayloadAsync(RemoteCallContext* call_ctx,
+                                SendDataRequest* request, Payload payload,
+                                SendDataResponse* response,
+                                CallbackFn done) override {
+    client_->SendDataWithPayloadAsync(call_ctx, request, std::move(payload),
+                                      response, std::move(done));
+  }
+
+ private:
+  // Sets the response of a request from its response in the batch, which is
+  // null if the batch failed, and invokes the callback of the request.
+  using ResponseFn = llvm::unique_function<void(Error, BatchedResponse*)>;
+
+  struct Batch {
+    BatchRequest request;
+    size_t num_bytes = 0;
+    std::vector<ResponseFn> response_fns;
+  };
+
+  // Adds the request set by `set_request`, which takes `num_bytes`, to the
+  // pending batch, and sends the batch if possible.
+  void AddRequest(size_t num_bytes,
+                  llvm::function_ref<void(BatchedRequest*)> set_request,
+                  ResponseFn response_fn);
+
+  void SendBatch(std::unique_ptr<Batch> batch);
+
+  const std::unique_ptr<RemoteClientInterface> client_;
+  const Options options_;
+
+  mutex mu_;
+  // The batch that collects new requests. It is null when there are none.
+  std::unique_ptr<Batch> pending_batch_ TFRT_GUARDED_BY(mu_);
+  size_t num_inflight_batches_ TFRT_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_DISTRIBUTED_RUNTIME_BATCHING_REMOTE_CLIENT_H_
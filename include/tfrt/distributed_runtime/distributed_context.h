@@ -23,12 +23,14 @@
 #ifndef TFRT_DISTRIBUTED_RUNTIME_DISTRIBUTED_CONTEXT_H_
 #define TFRT_DISTRIBUTED_RUNTIME_DISTRIBUTED_CONTEXT_H_
 
+#include <memory>
 #include <string>
 
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "tfrt/distributed_runtime/cluster_info.h"
 #include "tfrt/distributed_runtime/function_cache.h"
+#include "tfrt/distributed_runtime/payload_codec.h"
 #include "tfrt/distributed_runtime/proto/cluster_config.pb.h"
 #include "tfrt/distributed_runtime/remote_client.h"
 #include "tfrt/distributed_runtime/remote_device.h"
@@ -36,6 +38,7 @@
 #include "tfrt/distributed_runtime/server_context.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/ref_count.h"
+#include "tfrt/support/refcounted_callback.h"
 #include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
@@ -66,6 +69,11 @@ class DistributedContext {
  public:
   enum RemoteInitMode { SINGLE_CLIENT, MULTI_CLIENT };
 
+  // Number of tasks each task sends the ready chains to in a broadcast.
+  static constexpr size_t kReadyChainsFanout = 8;
+  // Number of tasks each task creates contexts on in cluster initialization.
+  static constexpr size_t kCreateContextFanout = 8;
+
   DistributedContext(uint64_t context_id, ServerContext* server,
                      DistributedContextConfiguration configuration);
   ~DistributedContext();
@@ -118,6 +126,15 @@ class DistributedContext {
 
   FunctionCache* GetFunctionCache() const { return function_cache_.get(); }
 
+  // Codec of the payloads sent to and received from other tasks.
+  const PayloadCodec& GetPayloadCodec() const { return payload_codec_; }
+
+  // Tensors of at most this many bytes are passed by value in RemoteExecute
+  // requests and responses, or none if it is zero.
+  int64_t GetMaxInlineTensorBytes() const {
+    return dist_config_.max_inline_tensor_bytes();
+  }
+
   RemoteClientInterface* GetRemoteClient(TaskHandle task_handle);
 
   using CallbackFn = llvm::unique_function<void(Error)>;
@@ -125,15 +142,33 @@ class DistributedContext {
   // Get device information on remote tasks.
   void GetRemoteDevices(CallbackFn done_callback);
 
-  // Create contexts on remote tasks. The callback will be invoked after all
-  // remote calls finish. This method should be invoked on the single client,
-  // or the lead task in multi-client cluster.
+  // Create contexts on remote tasks. The cluster configuration and devices are
+  // sent along a tree of tasks with kCreateContextFanout children per task,
+  // and the ready chains of all tasks are sent back along the same tree. The
+  // callback will be invoked after all remote calls finish. This method should
+  // be invoked on the single client, or the lead task in multi-client cluster.
   void CreateRemoteContexts(RemoteInitMode mode, CallbackFn done_callback);
 
-  // Broadcast remote chains collected from all tasks. The callback will be
-  // invoked after all remote calls finish.
+  // Creates contexts on the forward_to_tasks of `request`, received from the
+  // parent of this task in cluster initialization, and adds their ready chains
+  // to `response`. The callback will be invoked after all of them created
+  // their contexts.
+  void ForwardCreateContext(const CreateContextRequest& request,
+                            CreateContextResponse* response,
+                            CallbackFn done_callback);
+
+  // Broadcast remote chains collected from all tasks. Only the chains that
+  // changed since the previous broadcast are sent, along a tree of tasks with
+  // kReadyChainsFanout children per task. The callback will be invoked after
+  // all tasks received the chains.
   void BroadcastRemoteReadyChains(CallbackFn done_callback);
 
+  // Sends the ready chains of `request`, received from the parent of this task
+  // in a broadcast, to the tasks in its forward_to_tasks. The callback will be
+  // invoked after all of them received the chains.
+  void ForwardRemoteReadyChains(const SendReadyChainsRequest& request,
+                                CallbackFn done_callback);
+
   // Close contexts on remote tasks. The callback will be invoked after all
   // remote calls finish.
   void CloseRemoteContexts(CallbackFn done_callback);
@@ -154,6 +189,26 @@ class DistributedContext {
   // distributed contexts created by `CreateRemoteContexts`.
   void SendKeepAlive(int delay_secs);
 
+  // Sends CreateContext requests sharing the configuration and devices of
+  // `base_request` to the subtrees of `tasks`, split as in
+  // SendReadyChainsToTasks, and adds the ready chains in the responses.
+  void SendCreateContextToTasks(
+      std::shared_ptr<CreateContextRequest> base_request,
+      ArrayRef<std::string> tasks, RCReference<RefCountedCallback> done);
+
+  // Adds the ready chains of `tasks` to the subtree_ready_chains of
+  // `response`.
+  Error AddSubtreeReadyChains(ArrayRef<std::string> tasks,
+                              CreateContextResponse* response);
+
+  // Sends `ready_chains` to the subtrees of `tasks`: they are split into up to
+  // kReadyChainsFanout subtrees, and the first task of each forwards the
+  // chains to the rest of its subtree.
+  void SendReadyChainsToTasks(
+      const google::protobuf::RepeatedPtrField<RemoteObjectIdProto>&
+          ready_chains,
+      ArrayRef<std::string> tasks, RCReference<RefCountedCallback> done);
+
   const uint64_t context_id_;
   ServerContext* const server_context_;
 
@@ -178,10 +233,15 @@ class DistributedContext {
 
   std::unique_ptr<FunctionCache> function_cache_;
 
+  const PayloadCodec payload_codec_;
+
   std::unique_ptr<RemoteObjectId> local_ready_chain_;
   mutex ready_chains_mu_;
   llvm::DenseMap<TaskHandle, RemoteObjectId> ready_chains_
       TFRT_GUARDED_BY(ready_chains_mu_);
+  // The ready chains sent by the previous broadcast, including the local one.
+  llvm::DenseMap<TaskHandle, RemoteObjectId> broadcast_ready_chains_
+      TFRT_GUARDED_BY(ready_chains_mu_);
 
   mutex keep_alive_mu_;
   TimerQueue::TimerHandle keep_alive_timer_ TFRT_GUARDED_BY(keep_alive_mu_);
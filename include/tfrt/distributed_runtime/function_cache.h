@@ -17,17 +17,24 @@
 // Function Cache
 //
 // This file declares FunctionCache, which caches the programs that are
-// registered and instantiated from remote requests.
+// registered and instantiated from remote requests, and CompiledProgramCache,
+// which caches compiled programs by content across distributed contexts.
 
 #ifndef TFRT_DISTRIBUTED_RUNTIME_FUNCTION_CACHE_H_
 #define TFRT_DISTRIBUTED_RUNTIME_FUNCTION_CACHE_H_
 
+#include <deque>
+#include <memory>
+#include <string>
 #include <unordered_map>
 
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/bef/bef_buffer.h"
 #include "tfrt/bef_executor/bef_file.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/resource_context.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
 
 namespace tfrt {
 
@@ -62,5 +69,49 @@ class FunctionCache {
       TFRT_GUARDED_BY(cached_bef_mutex_);
 };
 
+// Caches compiled programs by the fingerprint of their source, so that a
+// program registered by many distributed contexts (or registered again after
+// a context is recreated) is transferred and compiled once per server. The
+// oldest programs are evicted when the total BEF size exceeds the capacity.
+class CompiledProgramCache {
+ public:
+  struct CompiledProgram {
+    BefBuffer bef_buffer;
+    // Output devices returned by the compiler, if the program was compiled.
+    llvm::SmallVector<std::string, 4> output_devices;
+  };
+
+  explicit CompiledProgramCache(size_t capacity_bytes)
+      : capacity_bytes_(capacity_bytes) {}
+
+  // Returns the fingerprint of a program source.
+  static std::string Fingerprint(string_view program);
+
+  // Returns the cache key of the program with `fingerprint` compiled with the
+  // given options.
+  static std::string Key(string_view fingerprint, bool need_compilation,
+                         bool program_is_bef);
+
+  // Returns the program with `key`, or null if it is not cached.
+  std::shared_ptr<const CompiledProgram> Lookup(const std::string& key) const
+      TFRT_EXCLUDES(mu_);
+
+  // Caches `program` with `key`, unless a program with that key is already
+  // cached. Programs larger than the capacity are not cached.
+  void Insert(const std::string& key,
+              std::shared_ptr<const CompiledProgram> program)
+      TFRT_EXCLUDES(mu_);
+
+ private:
+  const size_t capacity_bytes_;
+
+  mutable mutex mu_;
+  std::unordered_map<std::string, std::shared_ptr<const CompiledProgram>>
+      programs_ TFRT_GUARDED_BY(mu_);
+  // Keys in insertion order, for eviction.
+  std::deque<std::string> insertion_order_ TFRT_GUARDED_BY(mu_);
+  size_t size_bytes_ TFRT_GUARDED_BY(mu_) = 0;
+};
+
 }  // namespace tfrt
 #endif  // TFRT_DISTRIBUTED_RUNTIME_FUNCTION_CACHE_H_
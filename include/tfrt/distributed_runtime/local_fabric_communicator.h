@@ -0,0 +1,58 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Local Fabric Communicator
+//
+// This file declares LocalFabricCommunicator, which connects servers in the
+// same process without serializing requests.
+
+#ifndef TFRT_DISTRIBUTED_RUNTIME_LOCAL_FABRIC_COMMUNICATOR_H_
+#define TFRT_DISTRIBUTED_RUNTIME_LOCAL_FABRIC_COMMUNICATOR_H_
+
+#include <memory>
+#include <string>
+
+#include "tfrt/distributed_runtime/fabric_communicator.h"
+
+namespace tfrt {
+
+// Fabric type of LocalFabricCommunicator in FabricCommunicatorConfiguration.
+constexpr char kLocalFabricCommunicatorType[] = "local";
+
+// Sends requests to servers in the same process, by the server address in
+// their fabric configuration. Requests and responses are passed to the request
+// handler of the destination without serialization, and the buffers of
+// SendData payloads are copied once, into buffers of the destination.
+class LocalFabricCommunicator final : public FabricCommunicator {
+ public:
+  // Makes the server reachable at its configured server address.
+  explicit LocalFabricCommunicator(ServerContext* server_context);
+  ~LocalFabricCommunicator() override;
+
+  std::unique_ptr<RemoteClientInterface> CreateRemoteClient(
+      DistributedContext* dist_context, TaskHandle task_handle) override;
+
+ private:
+  const std::string address_;
+  bool registered_ = false;
+};
+
+FabricCommunicator* CreateLocalFabricCommunicator(
+    ServerContext* server_context);
+
+}  // namespace tfrt
+
+#endif  // TFRT_DISTRIBUTED_RUNTIME_LOCAL_FABRIC_COMMUNICATOR_H_
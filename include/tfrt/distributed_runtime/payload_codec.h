@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares PayloadCodec, which compresses the payloads sent between
+// tasks.
+
+#ifndef TFRT_DISTRIBUTED_RUNTIME_PAYLOAD_CODEC_H_
+#define TFRT_DISTRIBUTED_RUNTIME_PAYLOAD_CODEC_H_
+
+#include "llvm/Support/Error.h"
+#include "tfrt/distributed_runtime/payload.h"
+#include "tfrt/distributed_runtime/proto/cluster_config.pb.h"
+#include "tfrt/distributed_runtime/proto/remote_message.pb.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+// PayloadCodec encodes the buffers of SendData payloads as configured by the
+// PayloadCompressionConfiguration of a distributed context, and records the
+// encoding of each buffer in the request. Decoding only depends on the
+// recorded encodings, so a receiver decodes whatever its senders chose.
+class PayloadCodec {
+ public:
+  // What a payload holds, which determines the applicable encodings.
+  enum class PayloadKind {
+    // Any data. Only lossless encodings apply.
+    kBytes,
+    // float32 partial results of a reduction, which tolerate lossy encodings.
+    kFloatPartialSums,
+  };
+
+  PayloadCodec(const PayloadCompressionConfiguration& config,
+               HostAllocator* allocator);
+
+  // Returns true if Encode may change payloads.
+  bool enabled() const { return lz4_ || float_encoding_ != kNoFloatEncoding; }
+
+  // Returns `payload` with its buffers encoded, and sets the encodings of
+  // `request`. Buffers that would not shrink are returned as is.
+  Payload Encode(Payload payload, PayloadKind kind,
+                 SendDataRequest* request) const;
+
+  // Returns true if `request` has encoded payload buffers.
+  static bool IsEncoded(const SendDataRequest& request);
+
+  // Decodes the buffers of `payload` with the encodings of `request`.
+  Expected<Payload> Decode(const SendDataRequest& request,
+                           Payload payload) const;
+
+ private:
+  static constexpr auto kNoFloatEncoding =
+      PayloadCompressionConfiguration::NONE;
+
+  const bool lz4_;
+  const PayloadCompressionConfiguration::FloatEncoding float_encoding_;
+  const float top_k_fraction_;
+  const size_t min_payload_bytes_;
+  HostAllocator* const allocator_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_DISTRIBUTED_RUNTIME_PAYLOAD_CODEC_H_
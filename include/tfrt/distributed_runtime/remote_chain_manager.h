@@ -17,11 +17,14 @@
 // Remote Chain Manager
 //
 // This file declares RemoteChainManager. RemoteChainManager manages a single
-// chain for every host.
+// chain for every host, and the remote objects of tensors whose producing ops
+// are still in flight.
 
 #ifndef TFRT_DISTRIBUTED_RUNTIME_REMOTE_CHAIN_MANAGER_H_
 #define TFRT_DISTRIBUTED_RUNTIME_REMOTE_CHAIN_MANAGER_H_
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
 #include "tfrt/distributed_runtime/distributed_context.h"
 #include "tfrt/distributed_runtime/remote_object.h"
 #include "tfrt/distributed_runtime/task_handle.h"
@@ -36,10 +39,25 @@ class RemoteChainManager {
   RemoteObjectId GetRemoteChain(TaskHandle task);
   void SetRemoteChain(TaskHandle task, RemoteObjectId chain);
 
+  // Records that `tensor`, which becomes available when the op producing it
+  // returns, will be stored in the remote object `id`. Ops consuming `tensor`
+  // can then be dispatched before it is available, and wait for it remotely.
+  void AddPendingTensor(const AsyncValue* tensor, const RemoteObjectId& id);
+
+  // Must be called after `tensor` is set, before it may be destroyed.
+  void RemovePendingTensor(const AsyncValue* tensor);
+
+  // Returns the remote object of `tensor` if it is pending.
+  llvm::Optional<RemoteObjectId> GetPendingTensor(const AsyncValue* tensor);
+
  private:
   mutex chains_mu_;
   llvm::DenseMap<TaskHandle, RemoteObjectId> chains_
       TFRT_GUARDED_BY(chains_mu_);
+
+  mutex pending_tensors_mu_;
+  llvm::DenseMap<const AsyncValue*, RemoteObjectId> pending_tensors_
+      TFRT_GUARDED_BY(pending_tensors_mu_);
 };
 
 }  // namespace tfrt
@@ -21,6 +21,7 @@
 
 #include "llvm/ADT/FunctionExtras.h"
 #include "llvm/Support/Error.h"
+#include "tfrt/distributed_runtime/payload.h"
 #include "tfrt/distributed_runtime/proto/remote_message.pb.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/mutex.h"
@@ -136,6 +137,36 @@ class RemoteClientInterface {
   CLIENT_METHOD(KeepAlive);
 
 #undef CLIENT_METHOD
+
+  // Sends `payload` as the payload of `request`, outside of the request
+  // message. Transports that can send the buffers without copying them into
+  // the message, e.g. with scatter-gather I/O, should override this and pass
+  // the received buffers to RequestHandlerInterface::HandleSendDataWithPayload.
+  // The buffers are shared with the caller, and may be read by the transport
+  // until they are received.
+  //
+  // The default implementation copies the buffers into the payload of
+  // `request` and calls SendDataAsync().
+  virtual void SendDataWithPayloadAsync(RemoteCallContext* call_ctx,
+                                        SendDataRequest* request,
+                                        Payload payload,
+                                        SendDataResponse* response,
+                                        CallbackFn done) {
+    for (const auto& buffer : payload.buffers)
+      request->add_payload(buffer->data(), buffer->size());
+    SendDataAsync(call_ctx, request, response, std::move(done));
+  }
+
+  // Sends the requests of a batch, and sets the response of each in the
+  // response at the same position of `response`. The callback is invoked with
+  // an error only if the batch as a whole failed, the errors of the requests
+  // are in their responses. Transports should override this to send the batch
+  // with one RPC, handled by RequestHandlerInterface::HandleBatch.
+  //
+  // The default implementation sends each request with its own call.
+  virtual void BatchAsync(RemoteCallContext* call_ctx,
+                          const BatchRequest* request, BatchResponse* response,
+                          CallbackFn done);
 };
 
 }  // namespace tfrt
@@ -22,7 +22,9 @@
 #define TFRT_DISTRIBUTED_RUNTIME_REMOTE_EXECUTE_H_
 
 #include "llvm/ADT/SmallVector.h"
+#include "tfrt/distributed_runtime/proto/remote_message.pb.h"
 #include "tfrt/host_context/device.h"
+#include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
 // A specification for remote_execute kernel calls.
@@ -35,6 +37,26 @@ struct RemoteExecuteSpec {
   llvm::SmallVector<RCReference<Device>, 4> output_devices;
 };
 
+class DenseHostTensor;
+class HostContext;
+
+// Returns true if `tensor` can be passed by value in RemoteExecute requests
+// and responses that inline tensors of at most `max_bytes`, or none if zero.
+bool CanInlineTensor(const DenseHostTensor& tensor, int64_t max_bytes);
+
+// Serializes `tensor` to pass it by value. The index of `proto` is not set.
+void SerializeInlineTensor(const DenseHostTensor& tensor,
+                           InlineTensorProto* proto);
+
+// Returns the tensor that SerializeInlineTensor() serialized into `proto`.
+Expected<DenseHostTensor> DeserializeInlineTensor(
+    const InlineTensorProto& proto, HostContext* host);
+
+// Same as above, but the returned tensor takes over the data of `proto` instead
+// of copying it, unless the data is not aligned for the dtype of the tensor.
+Expected<DenseHostTensor> TakeInlineTensor(InlineTensorProto* proto,
+                                           HostContext* host);
+
 }  // namespace tfrt
 
 #endif  // TFRT_DISTRIBUTED_RUNTIME_REMOTE_EXECUTE_H_
\ No newline at end of file
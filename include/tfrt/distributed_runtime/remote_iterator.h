@@ -0,0 +1,106 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares RemoteIterator, which reads the elements of an input
+// pipeline that runs on a remote task.
+
+#ifndef TFRT_DISTRIBUTED_RUNTIME_REMOTE_ITERATOR_H_
+#define TFRT_DISTRIBUTED_RUNTIME_REMOTE_ITERATOR_H_
+
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "tfrt/data/dataset.h"
+#include "tfrt/distributed_runtime/remote_object.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+class RemoteClientInterface;
+class RemoteObjectManager;
+
+// RemoteIterator returns the elements of a tfrt_data iterator that lives on a
+// remote task, so that the preprocessing of the input pipeline runs on
+// dedicated workers instead of on the trainer.
+//
+// Each element is fetched by running `program_name` on the remote task, which
+// is registered like any other remote function and has the signature
+//
+//   (!tfrt.chain, !tfrt_data.iterator) -> (!tfrt.chain, !t.tensor...)
+//
+// with `num_values` tensors, e.g. the results of tfrt_data.iterator_get_next.
+// The chain output of a request is the chain input of the next one, so that
+// the remote task pulls the elements in order while up to `prefetch_num`
+// requests after the one being consumed are in flight. The tensors are only
+// returned by value, and the tensors of the iterator take over the memory of
+// the responses instead of copying it.
+//
+// The end of the remote iterator is recognized by the error of its elements.
+// The remote objects of the iterator and of the last chain are deleted when
+// RemoteIterator is destroyed.
+class RemoteIterator : public data::Iterator {
+ public:
+  RemoteIterator(RemoteClientInterface* remote_client,
+                 RemoteObjectManager* object_manager, uint64_t context_id,
+                 string_view program_name, RemoteObjectId chain_id,
+                 RemoteObjectId iterator_id, int num_values, int prefetch_num,
+                 HostContext* host);
+
+  // This class is not copyable or movable.
+  RemoteIterator(const RemoteIterator&) = delete;
+  RemoteIterator& operator=(const RemoteIterator&) = delete;
+
+  data::IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  void Destroy() override;
+
+  // Sends the request for the element after the last requested one.
+  data::IterationResult FetchNext();
+
+  bool ReachedEnd() const {
+    mutex_lock lock(mu_);
+    return end_of_iteration_;
+  }
+
+  RemoteClientInterface* const remote_client_;
+  RemoteObjectManager* const object_manager_;
+  const uint64_t context_id_;
+  const std::string program_name_;
+  const RemoteObjectId iterator_id_;
+  const int num_values_;
+  const int prefetch_num_;
+  HostContext* const host_;
+
+  // The chain that the next request waits for.
+  RemoteObjectId last_chain_id_;
+  std::queue<data::IterationResult> buffer_;
+
+  mutable mutex mu_;
+  bool end_of_iteration_ TFRT_GUARDED_BY(mu_) = false;
+  // The chains that were consumed by a completed request, which the next
+  // request releases.
+  std::vector<RemoteObjectId> consumed_chain_ids_ TFRT_GUARDED_BY(mu_);
+  // The chains of failed requests, which may or may not exist on the remote
+  // task. They are deleted with the iterator.
+  std::vector<RemoteObjectId> failed_chain_ids_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_DISTRIBUTED_RUNTIME_REMOTE_ITERATOR_H_
@@ -23,13 +23,20 @@
 
 #include <unordered_map>
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/distributed_runtime/remote_object.h"
 #include "tfrt/distributed_runtime/task_handle.h"
 #include "tfrt/host_context/async_value.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
+// The objects are spread over shards by id, each with its own lock, so that
+// concurrent requests rarely contend. The batch methods lock each shard once
+// per batch.
 class RemoteObjectManager {
  public:
   static const uint64_t kInvalidPrefixId;
@@ -47,23 +54,45 @@ class RemoteObjectManager {
   // objects outputs of the remote_execute.
   void SetRemoteObject(const RemoteObjectId& id, RCReference<AsyncValue> value);
 
+  // Stores `values[i]` with `ids[i]` for each id.
+  void SetRemoteObjects(ArrayRef<RemoteObjectId> ids,
+                        ArrayRef<RCReference<AsyncValue>> values);
+
   // Retrieve Remote Object with given id.
   // This is called by RequestHandler implementation to retrieve the remote
   // objects input to the remote_execute.
   RCReference<AsyncValue> GetRemoteObject(const RemoteObjectId& id);
 
+  // Appends the remote objects with `ids` to `values`, in order.
+  void GetRemoteObjects(ArrayRef<RemoteObjectId> ids,
+                        SmallVectorImpl<RCReference<AsyncValue>>* values);
+
   // Delete the given remote object ids.
-  Error DeleteRemoteObjects(const llvm::SmallVectorImpl<RemoteObjectId>& ids);
+  Error DeleteRemoteObjects(ArrayRef<RemoteObjectId> ids);
 
  private:
+  static constexpr int kNumShards = 16;
+
+  using ObjectMap = llvm::DenseMap<RemoteObjectId, RCReference<AsyncValue>>;
+
+  // Shards are cache line aligned, so that their locks do not share lines.
+  struct alignas(64) Shard {
+    tfrt::mutex mutex;
+    ObjectMap object_maps TFRT_GUARDED_BY(mutex);
+  };
+
+  static int GetShardIndex(const RemoteObjectId& id);
+
+  // Calls `fn(object_maps, indices)` for each shard with its lock held, where
+  // `indices` are the indices of the `ids` in the shard.
+  template <typename F>
+  void ForEachShard(ArrayRef<RemoteObjectId> ids, F fn);
+
   std::atomic<int64_t> next_unique_id_{1};
   const uint64_t prefix_id_;
   HostContext* host_context_;
 
-  tfrt::mutex mutex_;
-
-  llvm::DenseMap<RemoteObjectId, RCReference<AsyncValue>> object_maps_
-      TFRT_GUARDED_BY(mutex_);
+  Shard shards_[kNumShards];
 };
 }  // namespace tfrt
 namespace llvm {
@@ -73,8 +102,9 @@ struct DenseMapInfo<tfrt::RemoteObjectId> {
     return {tfrt::RemoteObjectManager::kInvalidPrefixId, 0,
             tfrt::RCReference<tfrt::Device>()};
   }
+  // Must differ from the empty key, or lookups stop at erased entries.
   static tfrt::RemoteObjectId getTombstoneKey() {
-    return {tfrt::RemoteObjectManager::kInvalidPrefixId, 0,
+    return {tfrt::RemoteObjectManager::kInvalidPrefixId, 1,
             tfrt::RCReference<tfrt::Device>()};
   }
   static unsigned getHashValue(const tfrt::RemoteObjectId& id) {
@@ -20,7 +20,9 @@
 #ifndef TFRT_DISTRIBUTED_RUNTIME_REMOTE_TENSOR_H_
 #define TFRT_DISTRIBUTED_RUNTIME_REMOTE_TENSOR_H_
 
+#include "llvm/ADT/Optional.h"
 #include "tfrt/distributed_runtime/remote_object.h"
+#include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/tensor.h"
 
 namespace tfrt {
@@ -30,14 +32,27 @@ class RemoteTensor : public Tensor, public TensorTraits<RemoteTensor> {
   RemoteTensor(const TensorMetadata& metadata,
                const RemoteObjectId& remote_object_id);
 
+  // A remote tensor whose value was also returned by the remote task, see
+  // DistributedContextConfiguration.max_inline_tensor_bytes.
+  RemoteTensor(const TensorMetadata& metadata,
+               const RemoteObjectId& remote_object_id,
+               DenseHostTensor inline_value);
+
   void Print(raw_ostream& os) const override;
 
   static const char* name() { return "Remote"; }
 
   const RemoteObjectId& remote_object_id() { return remote_object_id_; }
 
+  // Returns the value of the tensor if the remote task returned it, which
+  // saves fetching it, or nullptr.
+  const DenseHostTensor* inline_value() const {
+    return inline_value_ ? inline_value_.getPointer() : nullptr;
+  }
+
  private:
   RemoteObjectId remote_object_id_;
+  llvm::Optional<DenseHostTensor> inline_value_;
 };
 
 }  // namespace tfrt
@@ -25,6 +25,7 @@
 #include <llvm/ADT/ArrayRef.h>
 #include <tfrt/support/ref_count.h>
 
+#include "tfrt/distributed_runtime/payload.h"
 #include "tfrt/distributed_runtime/proto/remote_message.pb.h"
 #include "tfrt/support/forward_decls.h"
 
@@ -55,6 +56,14 @@ class RequestHandlerInterface {
   virtual void HandleSendData(const SendDataRequest* request,
                               SendDataResponse* response, CallbackFn done) = 0;
 
+  // Same as HandleSendData, but with the payload received outside of the
+  // request message, e.g. directly into host buffers. The payload field of
+  // `request` is ignored.
+  virtual void HandleSendDataWithPayload(const SendDataRequest* request,
+                                         Payload payload,
+                                         SendDataResponse* response,
+                                         CallbackFn done) = 0;
+
   virtual void HandleRegisterFunction(const RegisterFunctionRequest* request,
                                       RegisterFunctionResponse* response,
                                       CallbackFn done) = 0;
@@ -74,6 +83,12 @@ class RequestHandlerInterface {
   virtual void HandleKeepAlive(const KeepAliveRequest* request,
                                KeepAliveResponse* response,
                                CallbackFn done) = 0;
+
+  // Handles the requests of a batch in order, and sets the response or error
+  // of each in the response at the same position of `response`. Invokes `done`
+  // once all requests are done.
+  virtual void HandleBatch(const BatchRequest* request,
+                           BatchResponse* response, CallbackFn done) = 0;
 };
 
 }  // namespace tfrt
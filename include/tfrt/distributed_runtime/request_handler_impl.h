@@ -28,6 +28,12 @@ class ServerContext;
 std::unique_ptr<RequestHandlerInterface> NewRequestHandler(
     ServerContext* server_context);
 
+// Implements RequestHandlerInterface::HandleBatch by passing each request of
+// the batch to the corresponding method of `handler`.
+void HandleBatchRequest(RequestHandlerInterface* handler,
+                        const BatchRequest* request, BatchResponse* response,
+                        CallbackFn done);
+
 }  // namespace tfrt
 
 #endif  // TFRT_DISTRIBUTED_RUNTIME_REQUEST_HANDLER_IMPL_H_
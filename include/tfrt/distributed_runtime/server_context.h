@@ -32,6 +32,7 @@
 
 namespace tfrt {
 
+class CompiledProgramCache;
 class FabricCommunicator;
 class RequestHandlerInterface;
 class DistributedContext;
@@ -44,6 +45,9 @@ struct ServerContextConfiguration {
 
   // Timeout for garbage collecting inactive distributed contexts.
   int context_gc_timeout_secs = 600;
+
+  // Total size of the compiled programs cached across distributed contexts.
+  size_t compiled_program_cache_bytes = 256 << 20;
 };
 
 // ServerContext constructs and owns fabric communicators.
@@ -90,6 +94,10 @@ class ServerContext {
     return init_helper_.get();
   }
 
+  CompiledProgramCache* GetCompiledProgramCache() const {
+    return compiled_program_cache_.get();
+  }
+
   void ShutDown();
 
  protected:
@@ -114,6 +122,7 @@ class ServerContext {
   const ServerContextConfiguration configuration_;
   std::unique_ptr<RequestHandlerInterface> request_handler_;
   std::unique_ptr<DistributedInitHelper> const init_helper_;
+  std::unique_ptr<CompiledProgramCache> const compiled_program_cache_;
   mutex communicator_mutex_;
   std::unique_ptr<FabricCommunicator> fabric_communicator_
       TFRT_GUARDED_BY(communicator_mutex_);
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Bump Pointer Arena Allocator
+//
+// This file declares ArenaAllocator, a HostAllocator for memory that dies with
+// a request. A request owns an arena if it is enabled with
+// RequestContextBuilder::enable_arena_allocator(). Kernels opt into it with
+// ExecutionContext::allocator(), e.g.:
+//
+//   auto dht = DenseHostTensor::CreateUninitialized(metadata, exec_ctx);
+
+#ifndef TFRT_HOST_CONTEXT_ARENA_ALLOCATOR_H_
+#define TFRT_HOST_CONTEXT_ARENA_ALLOCATOR_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+// ArenaAllocator allocates memory by bumping a pointer in chunks allocated from
+// a fallback allocator. All chunks are freed in one go when the arena is
+// destroyed.
+//
+// Allocation sizes are rounded up to size classes, and deallocated memory is
+// recycled by later allocations of the same size class. Kernels release their
+// intermediate tensors when the last use of their register drops them, so a
+// request's memory is bounded by its live tensors rather than by everything
+// it ever allocated, and a warm arena makes no fallback allocator calls.
+//
+// ArenaAllocator is reference counted, and each live allocation holds a
+// reference. The owner of the arena, e.g. a RequestContext, drops its
+// reference when it is done with the arena. Allocations that escape the owner
+// keep the chunks alive until they are deallocated, so they stay valid.
+//
+// Allocations larger than a quarter of the chunk size are made individually
+// by the fallback allocator, which must outlive the arena. They are recycled
+// too, and returned to the fallback allocator when the arena is destroyed.
+//
+// ArenaAllocator is thread-safe.
+class ArenaAllocator : public HostAllocator,
+                       public ReferenceCounted<ArenaAllocator> {
+ public:
+  static constexpr size_t kDefaultChunkSize = 256 * 1024;
+
+  explicit ArenaAllocator(HostAllocator* fallback_allocator,
+                          size_t chunk_size = kDefaultChunkSize);
+  ~ArenaAllocator() override;
+
+  void* AllocateBytes(size_t size, size_t alignment) override;
+  void DeallocateBytes(void* ptr, size_t size) override;
+
+  // Return the number of chunks allocated so far. This should be used for
+  // testing and debugging only.
+  size_t NumChunks() const;
+
+  // Return the size class of allocations of `size` bytes. Classes are an
+  // eighth of a power of two apart, so rounding wastes at most 12.5%.
+  static size_t SizeClass(size_t size);
+
+ private:
+  // Return true if allocations of `size_class` are made in chunks.
+  bool IsArenaAllocation(size_t size_class) const {
+    return size_class <= max_arena_allocation_size_;
+  }
+
+  HostAllocator* const fallback_allocator_;
+  const size_t chunk_size_;
+  const size_t max_arena_allocation_size_;
+
+  mutable mutex mu_;
+  // The unused part of the last chunk.
+  char* current_ TFRT_GUARDED_BY(mu_) = nullptr;
+  char* end_ TFRT_GUARDED_BY(mu_) = nullptr;
+  std::vector<void*> chunks_ TFRT_GUARDED_BY(mu_);
+  // Deallocated memory by size class.
+  llvm::DenseMap<size_t, std::vector<void*>> free_blocks_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_ARENA_ALLOCATOR_H_
@@ -0,0 +1,273 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares AsyncTask, a coroutine type that allows writing
+// multi-step asynchronous kernels as straight-line code.
+//
+// It requires C++20 coroutines. TFRT_HAS_COROUTINES is defined when they are
+// available, and the rest of this file is empty otherwise.
+
+#ifndef TFRT_HOST_CONTEXT_ASYNC_COROUTINE_H_
+#define TFRT_HOST_CONTEXT_ASYNC_COROUTINE_H_
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define TFRT_HAS_COROUTINES 1
+#endif
+#endif
+
+#if defined(TFRT_HAS_COROUTINES)
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+template <typename T>
+class AsyncTask;
+
+namespace internal {
+
+// Returns the HostContext of the first ExecutionContext or HostContext* among
+// the arguments of a coroutine, or nullptr if there is none.
+inline HostContext* FindHost() { return nullptr; }
+template <typename... Args>
+HostContext* FindHost(const ExecutionContext& exec_ctx, const Args&...) {
+  return exec_ctx.host();
+}
+template <typename... Args>
+HostContext* FindHost(HostContext* host, const Args&...) {
+  return host;
+}
+template <typename Arg, typename... Args>
+HostContext* FindHost(const Arg&, const Args&... args) {
+  return FindHost(args...);
+}
+
+// Coroutine frames are prefixed with the allocator that they are returned to.
+struct alignas(alignof(std::max_align_t)) CoroutineFrameHeader {
+  HostAllocator* allocator;
+};
+
+inline void* AllocateCoroutineFrame(size_t size, HostContext* host) {
+  HostAllocator* allocator = host ? host->allocator() : nullptr;
+  size += sizeof(CoroutineFrameHeader);
+  void* ptr = allocator ? allocator->AllocateBytes(
+                              size, alignof(CoroutineFrameHeader))
+                        : ::operator new(size);
+  return new (ptr) CoroutineFrameHeader{allocator} + 1;
+}
+
+inline void DeallocateCoroutineFrame(void* ptr, size_t size) {
+  auto* header = static_cast<CoroutineFrameHeader*>(ptr) - 1;
+  size += sizeof(CoroutineFrameHeader);
+  if (header->allocator) {
+    header->allocator->DeallocateBytes(header, size);
+  } else {
+    ::operator delete(header, size);
+  }
+}
+
+// Suspends a coroutine until an AsyncValue is available. If the value is an
+// error, the coroutine is destroyed instead of resumed, and its result is set
+// to the error.
+class AsyncValueAwaiter {
+ public:
+  // The caller keeps `value` alive until the coroutine is resumed.
+  explicit AsyncValueAwaiter(AsyncValue* value) : value_(value) {}
+  explicit AsyncValueAwaiter(RCReference<AsyncValue> value)
+      : owned_value_(std::move(value)), value_(owned_value_.get()) {}
+
+  bool await_ready() const { return value_->IsConcrete(); }
+
+  template <typename Promise>
+  void await_suspend(std::coroutine_handle<Promise> handle) const {
+    // The coroutine may be resumed on another thread before AndThen() returns,
+    // so the awaiter, which lives in the coroutine frame, is not accessed after
+    // it.
+    AsyncValue* value = value_;
+    value->AndThen([handle, value] {
+      if (value->IsError()) {
+        handle.promise().SetError(value->GetError());
+        handle.destroy();
+      } else {
+        handle.resume();
+      }
+    });
+  }
+
+  void await_resume() const {}
+
+ protected:
+  RCReference<AsyncValue> owned_value_;
+  AsyncValue* value_;
+};
+
+template <typename T>
+class TypedAsyncValueAwaiter : public AsyncValueAwaiter {
+ public:
+  using AsyncValueAwaiter::AsyncValueAwaiter;
+
+  T& await_resume() const { return value_->get<T>(); }
+};
+
+// Resumes a coroutine as a task on the work queue of an ExecutionContext.
+class WorkQueueAwaiter {
+ public:
+  explicit WorkQueueAwaiter(const ExecutionContext& exec_ctx)
+      : exec_ctx_(exec_ctx) {}
+
+  bool await_ready() const { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) const {
+    EnqueueWork(exec_ctx_, [handle] { handle.resume(); });
+  }
+
+  void await_resume() const {}
+
+ private:
+  ExecutionContext exec_ctx_;
+};
+
+template <typename T>
+class AsyncTaskPromise {
+ public:
+  // Allocates the coroutine frame from the HostAllocator of the HostContext
+  // among the coroutine arguments, see FindHost().
+  template <typename... Args>
+  static void* operator new(size_t size, const Args&... args) {
+    return AllocateCoroutineFrame(size, FindHost(args...));
+  }
+  static void operator delete(void* ptr, size_t size) {
+    DeallocateCoroutineFrame(ptr, size);
+  }
+
+  AsyncTask<T> get_return_object() { return AsyncTask<T>(result_.CopyRef()); }
+
+  // The coroutine runs on the calling thread until it first suspends, and its
+  // frame is destroyed when it returns.
+  std::suspend_never initial_suspend() const noexcept { return {}; }
+  std::suspend_never final_suspend() const noexcept { return {}; }
+
+  void return_value(T value) { result_.emplace(std::move(value)); }
+  void return_value(Expected<T> value) { result_.emplace(std::move(value)); }
+  void return_value(Error error) {
+    result_.SetError(error);
+    llvm::consumeError(std::move(error));
+  }
+  void return_value(RCReference<ErrorAsyncValue> error) {
+    result_.SetError(error->GetError());
+  }
+
+  void unhandled_exception() const { std::terminate(); }
+
+  void SetError(const DecodedDiagnostic& diag) { result_.SetError(diag); }
+
+  // An awaited AsyncValueRef lvalue must be alive until the coroutine is
+  // resumed. Awaited rvalues are kept alive by the coroutine.
+  template <typename U>
+  TypedAsyncValueAwaiter<U> await_transform(const AsyncValueRef<U>& value) {
+    return TypedAsyncValueAwaiter<U>(value.GetAsyncValue());
+  }
+  template <typename U>
+  TypedAsyncValueAwaiter<U> await_transform(AsyncValueRef<U>&& value) {
+    return TypedAsyncValueAwaiter<U>(value.ReleaseRCRef());
+  }
+  template <typename U>
+  TypedAsyncValueAwaiter<U> await_transform(AsyncTask<U>&& task) {
+    return await_transform(static_cast<AsyncValueRef<U>>(std::move(task)));
+  }
+  AsyncValueAwaiter await_transform(const RCReference<AsyncValue>& value) {
+    return AsyncValueAwaiter(value.get());
+  }
+  AsyncValueAwaiter await_transform(RCReference<AsyncValue>&& value) {
+    return AsyncValueAwaiter(std::move(value));
+  }
+  WorkQueueAwaiter await_transform(WorkQueueAwaiter awaiter) {
+    return awaiter;
+  }
+
+ private:
+  AsyncValueRef<T> result_ = MakeUnconstructedAsyncValueRef<T>();
+};
+
+}  // namespace internal
+
+// AsyncTask<T> is the return type of a coroutine that produces an
+// AsyncValueRef<T>. The coroutine can co_await AsyncValueRefs, type-erased
+// RCReference<AsyncValue>s and other AsyncTasks, instead of chaining AndThen()
+// callbacks:
+//
+//   AsyncTask<int> AddAsync(const ExecutionContext& exec_ctx,
+//                           AsyncValueRef<int> a, AsyncValueRef<int> b) {
+//     int sum = co_await a;
+//     sum += co_await b;
+//     if (sum < 0) co_return MakeStringError("negative sum");
+//     co_return sum;
+//   }
+//
+//   AsyncValueRef<int> sum = AddAsync(exec_ctx, std::move(a), std::move(b));
+//
+// The coroutine runs on the calling thread until it awaits a value that is not
+// available. It is then resumed on the thread that makes the value available,
+// like an AndThen() callback. co_await ResumeOnWorkQueue(exec_ctx) continues
+// on the work queue instead. If an awaited value is an error, the coroutine is
+// destroyed and the result is set to the error, like TFRT_ASSIGN_OR_RETURN.
+//
+// The coroutine frame, which holds its arguments and the locals that live
+// across suspension points, is a single allocation from the HostAllocator
+// when one of the arguments is an ExecutionContext or a HostContext*.
+// Reference arguments are not copied into the frame, so arguments that are used
+// after the coroutine first suspends should be passed by value.
+template <typename T>
+class LLVM_NODISCARD AsyncTask {
+ public:
+  using promise_type = internal::AsyncTaskPromise<T>;
+
+  // Returns the result of the coroutine.
+  operator AsyncValueRef<T>() && { return std::move(result_); }
+
+ private:
+  friend promise_type;
+
+  explicit AsyncTask(AsyncValueRef<T> result) : result_(std::move(result)) {}
+
+  AsyncValueRef<T> result_;
+};
+
+// Returns an awaitable that resumes the coroutine as a task on the work queue
+// of `exec_ctx`, e.g. to move expensive work off the thread that made an
+// awaited value available.
+inline internal::WorkQueueAwaiter ResumeOnWorkQueue(
+    const ExecutionContext& exec_ctx) {
+  return internal::WorkQueueAwaiter(exec_ctx);
+}
+
+}  // namespace tfrt
+
+#endif  // TFRT_HAS_COROUTINES
+
+#endif  // TFRT_HOST_CONTEXT_ASYNC_COROUTINE_H_
@@ -19,6 +19,10 @@
 #ifndef TFRT_HOST_CONTEXT_ASYNC_DISPATCH_H_
 #define TFRT_HOST_CONTEXT_ASYNC_DISPATCH_H_
 
+#include <chrono>
+#include <vector>
+
+#include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_context.h"
 
@@ -38,6 +42,17 @@ struct UnwrapExpected<Expected<T>> {
 template <typename F>
 using AsyncResultTypeT = typename UnwrapExpected<std::result_of_t<F()>>::type;
 
+// Sets `result` to the cancellation error and returns true if the request of
+// `exec_ctx` is cancelled, so that queued work nobody waits for is skipped.
+template <typename R>
+bool SetErrorIfCancelled(const ExecutionContext& exec_ctx,
+                         const AsyncValueRef<R>& result) {
+  auto* cancelled = exec_ctx.GetCancelAsyncValue();
+  if (!cancelled) return false;
+  result.SetError(cancelled->GetError());
+  return true;
+}
+
 }  // namespace internal
 
 // Block until the specified values are available (either with a value or an
@@ -51,8 +66,26 @@ void Await(const ExecutionContext& exec_ctx,
 void EnqueueWork(const ExecutionContext& exec_ctx,
                  llvm::unique_function<void()> work);
 
+// Add some non-blocking work that mostly accesses the memory at `data` to the
+// work_queue used by the ExecutionContext. The work queue may run it close to
+// that memory, see ConcurrentWorkQueue::AddTaskNear().
+void EnqueueWorkNear(const ExecutionContext& exec_ctx, const void* data,
+                     llvm::unique_function<void()> work);
+
+// Add closures that are too cheap to amortize the overhead of a task each, such
+// as a burst of sub-microsecond continuations, to the work_queue as one task.
+// The task runs the closures in order until it has run for `time_budget`, then
+// adds half of the remaining closures as another task, so that long batches
+// are still spread over the worker threads. The closures of a batch may
+// therefore run concurrently and out of order.
+void EnqueueWorkBatch(
+    const ExecutionContext& exec_ctx,
+    std::vector<llvm::unique_function<void()>> work,
+    std::chrono::nanoseconds time_budget = std::chrono::microseconds(100));
+
 // Overload of EnqueueWork that return AsyncValueRef<R> for work that returns R
-// when R is not void.
+// when R is not void. The work is not run, and the result is set to the
+// cancellation error, if the request is cancelled before the work starts.
 //
 // Example:
 // int a = 1, b = 2;
@@ -62,8 +95,10 @@ template <typename F, typename R = internal::AsyncResultTypeT<F>,
 LLVM_NODISCARD AsyncValueRef<R> EnqueueWork(const ExecutionContext& exec_ctx,
                                             F&& work) {
   auto result = MakeUnconstructedAsyncValueRef<R>(exec_ctx.host());
-  EnqueueWork(exec_ctx, [result = result.CopyRef(),
+  if (internal::SetErrorIfCancelled(exec_ctx, result)) return result;
+  EnqueueWork(exec_ctx, [exec_ctx, result = result.CopyRef(),
                          work = std::forward<F>(work)]() mutable {
+    if (internal::SetErrorIfCancelled(exec_ctx, result)) return;
     result.emplace(work());
   });
   return result;
@@ -81,7 +116,8 @@ LLVM_NODISCARD bool EnqueueBlockingWork(const ExecutionContext& exec_ctx,
                                         llvm::unique_function<void()> work);
 
 // Overload of EnqueueBlockingWork that return AsyncValueRef<R> for work that
-// returns R when R is not void.
+// returns R when R is not void. Like EnqueueWork, it skips the work of a
+// cancelled request.
 //
 // Example:
 // int a = 1, b = 2;
@@ -92,9 +128,11 @@ template <typename F, typename R = internal::AsyncResultTypeT<F>,
 LLVM_NODISCARD AsyncValueRef<R> EnqueueBlockingWork(
     const ExecutionContext& exec_ctx, F&& work) {
   auto result = MakeUnconstructedAsyncValueRef<R>(exec_ctx.host());
+  if (internal::SetErrorIfCancelled(exec_ctx, result)) return result;
   bool enqueued = EnqueueBlockingWork(
-      exec_ctx,
-      [result = result.CopyRef(), work = std::forward<F>(work)]() mutable {
+      exec_ctx, [exec_ctx, result = result.CopyRef(),
+                 work = std::forward<F>(work)]() mutable {
+        if (internal::SetErrorIfCancelled(exec_ctx, result)) return;
         result.emplace(work());
       });
   if (!enqueued) {
@@ -114,7 +152,8 @@ LLVM_NODISCARD bool RunBlockingWork(const ExecutionContext& exec_ctx,
                                     llvm::unique_function<void()> work);
 
 // Overload of RunBlockingWork that return AsyncValueRef<R> for work that
-// returns R when R is not void.
+// returns R when R is not void. Like EnqueueWork, it skips the work of a
+// cancelled request.
 //
 // Example:
 // int a = 1, b = 2;
@@ -125,9 +164,11 @@ template <typename F, typename R = internal::AsyncResultTypeT<F>,
 LLVM_NODISCARD AsyncValueRef<R> RunBlockingWork(
     const ExecutionContext& exec_ctx, F&& work) {
   auto result = MakeUnconstructedAsyncValueRef<R>(exec_ctx.host());
+  if (internal::SetErrorIfCancelled(exec_ctx, result)) return result;
   bool enqueued = RunBlockingWork(
-      exec_ctx,
-      [result = result.CopyRef(), work = std::forward<F>(work)]() mutable {
+      exec_ctx, [exec_ctx, result = result.CopyRef(),
+                 work = std::forward<F>(work)]() mutable {
+        if (internal::SetErrorIfCancelled(exec_ctx, result)) return;
         result.emplace(work());
       });
   if (!enqueued) {
@@ -210,6 +251,52 @@ LLVM_NODISCARD AsyncValueRef<R> RunBlockingWork(HostContext* host, F&& work) {
   return result;
 }
 
+// Limits for the continuations that RunInlineOrEnqueue() runs nested on one
+// thread. Deeper nesting risks overflowing the stack, and a long chain of
+// continuations keeps a thread from the work that other threads could steal.
+struct InlineContinuationLimits {
+  int max_depth = 100;
+  std::chrono::nanoseconds time_budget = std::chrono::milliseconds(1);
+};
+
+// Sets the limits for all threads.
+void SetInlineContinuationLimits(const InlineContinuationLimits& limits);
+InlineContinuationLimits GetInlineContinuationLimits();
+
+namespace internal {
+// Marks the scope of an inline continuation on the calling thread, if the
+// limits allow one more.
+class InlineContinuationScope {
+ public:
+  InlineContinuationScope() : is_inline_(Enter()) {}
+  ~InlineContinuationScope() {
+    if (is_inline_) Exit();
+  }
+  InlineContinuationScope(const InlineContinuationScope&) = delete;
+  InlineContinuationScope& operator=(const InlineContinuationScope&) = delete;
+
+  bool is_inline() const { return is_inline_; }
+
+ private:
+  static bool Enter();
+  static void Exit();
+
+  const bool is_inline_;
+};
+}  // namespace internal
+
+// Runs the continuation `work` inline, which avoids the latency of a task, if
+// the calling thread runs fewer nested inline continuations than the
+// InlineContinuationLimits allow. Otherwise adds it to the work queue, which
+// unwinds the stack. Use it for work that runs when a value becomes available
+// and may make other values available, e.g. in AndThen() callbacks.
+template <typename F>
+void RunInlineOrEnqueue(const ExecutionContext& exec_ctx, F&& work) {
+  internal::InlineContinuationScope scope;
+  if (scope.is_inline()) return work();
+  EnqueueWork(exec_ctx, std::forward<F>(work));
+}
+
 // Run the specified function when the specified set of AsyncValue's are all
 // resolved.  This is a set-version of "AndThen".
 void RunWhenReady(ArrayRef<AsyncValue*> values,
@@ -218,6 +305,26 @@ void RunWhenReady(ArrayRef<AsyncValue*> values,
 void RunWhenReady(ArrayRef<RCReference<AsyncValue>> values,
                   llvm::unique_function<void()> callee);
 
+// Overloads of RunWhenReady that run `callee` with RunInlineOrEnqueue(), for
+// callees that may recursively wait for other values.
+void RunWhenReady(const ExecutionContext& exec_ctx,
+                  ArrayRef<AsyncValue*> values,
+                  llvm::unique_function<void()> callee);
+
+void RunWhenReady(const ExecutionContext& exec_ctx,
+                  ArrayRef<RCReference<AsyncValue>> values,
+                  llvm::unique_function<void()> callee);
+
+// Return a chain that becomes available when the specified set of AsyncValue's
+// are all resolved, with a value or an error. The chain itself is never an
+// error. This costs one waiter per unavailable value and, in the steady state,
+// no allocation for the join, so it is suited to waiting on many values.
+AsyncValueRef<Chain> WhenAllReady(HostContext* host,
+                                  ArrayRef<AsyncValue*> values);
+
+AsyncValueRef<Chain> WhenAllReady(HostContext* host,
+                                  ArrayRef<RCReference<AsyncValue>> values);
+
 }  // namespace tfrt
 
 #endif  // TFRT_HOST_CONTEXT_ASYNC_DISPATCH_H_
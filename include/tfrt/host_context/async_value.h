@@ -27,16 +27,21 @@
 
 #include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <string>
 #include <type_traits>
 
 #include "llvm/ADT/PointerIntPair.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/location.h"
+#include "tfrt/host_context/value.h"
+#include "tfrt/support/alloc.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_local_free_list.h"
 #include "tfrt/support/type_traits.h"
 
 namespace tfrt {
@@ -51,6 +56,52 @@ class ConcreteAsyncValue;
 template <typename T>
 constexpr bool kMaybeBase = std::is_class<T>::value && !std::is_final<T>::value;
 
+// AsyncValues of at most kMaxPooledAsyncValueSize bytes, which hold chains and
+// scalars and are most of the AsyncValues of a program, are recycled through
+// a thread-local free list for their size instead of malloc.
+constexpr size_t kMaxPooledAsyncValueSize = 64;
+
+template <typename T>
+using IsPooledAsyncValue =
+    std::integral_constant<bool, sizeof(T) <= kMaxPooledAsyncValueSize &&
+                                     alignof(T) <= alignof(std::max_align_t)>;
+
+// The memory of a pooled AsyncValue of `kSize` bytes.
+template <size_t kSize>
+struct AsyncValueBlock {
+  char data[kSize];
+};
+
+template <typename T>
+void* AllocateAsyncValue(std::true_type) {
+  return ThreadLocalFreeList<AsyncValueBlock<sizeof(T)>>::Allocate(sizeof(T));
+}
+template <typename T>
+void* AllocateAsyncValue(std::false_type) {
+  return AlignedAlloc(alignof(T), sizeof(T));
+}
+
+template <typename T>
+void DeallocateAsyncValue(void* ptr, std::true_type) {
+  ThreadLocalFreeList<AsyncValueBlock<sizeof(T)>>::Deallocate(ptr);
+}
+template <typename T>
+void DeallocateAsyncValue(void* ptr, std::false_type) {
+  std::free(ptr);
+}
+
+// Allocate the memory of an AsyncValue of type T.
+template <typename T>
+void* AllocateAsyncValue() {
+  return AllocateAsyncValue<T>(IsPooledAsyncValue<T>());
+}
+
+// Deallocate memory returned by AllocateAsyncValue<T>().
+template <typename T>
+void DeallocateAsyncValue(void* ptr) {
+  DeallocateAsyncValue<T>(ptr, IsPooledAsyncValue<T>());
+}
+
 }  // namespace internal
 
 // This is a future of the specified value type. Arbitrary C++ types may be used
@@ -134,6 +185,11 @@ class AsyncValue {
   template <typename T>
   T& get();
 
+  // Sets `value` to a non-owning pointer to the payload, so that sync kernels
+  // can read it in place. The state must be `kConcrete`, and this AsyncValue
+  // must outlive `value`.
+  void BorrowValue(Value* value);
+
   // Returns the underlying error. IsError() must be true.
   const DecodedDiagnostic& GetError() const;
 
@@ -386,29 +442,32 @@ class AsyncValue {
  private:
   // Information about a ConcreteAsyncValue<T> subclass.
   struct TypeInfo {
-    // Destructor returns the size of the derived AsyncValue to be deallocated.
-    // The second bool argument indicates whether to destruct the AsyncValue
+    // Destructor returns the size of the derived AsyncValue. The second bool
+    // argument indicates whether to destruct and deallocate the AsyncValue
     // object or simply destroy the payloads.
     using DestructorFn = size_t (*)(AsyncValue*, bool);
     using GetErrorFn = const DecodedDiagnostic& (*)(const AsyncValue*);
     using SetErrorFn = void (*)(AsyncValue*, DecodedDiagnostic diag);
     using HasDataFn = bool (*)(const AsyncValue*);
+    using BorrowValueFn = void (*)(AsyncValue*, Value*);
 
     DestructorFn destructor;
     GetErrorFn get_error;
     SetErrorFn set_error;
     HasDataFn has_data;
+    BorrowValueFn borrow_value;
   };
 
   // The destructor function for a derived AsyncValue. The `destroys_object`
-  // argument indicates whether to destruct the AsyncValue object or simply
-  // destroy the payloads.
+  // argument indicates whether to destruct and deallocate the AsyncValue
+  // object or simply destroy the payloads.
   template <typename Derived>
   static TypeInfo MakeTypeInfo() {
     return TypeInfo{
         [](AsyncValue* v, bool destroys_object) {
           if (destroys_object) {
             static_cast<Derived*>(v)->~Derived();
+            internal::DeallocateAsyncValue<Derived>(v);
           } else {
             static_cast<Derived*>(v)->Destroy();
           }
@@ -423,6 +482,9 @@ class AsyncValue {
         [](const AsyncValue* v) {
           return static_cast<const Derived*>(v)->HasData();
         },
+        [](AsyncValue* v, Value* value) {
+          value->set(&static_cast<Derived*>(v)->get(), Value::PointerPayload{});
+        },
     };
   }
 
@@ -434,7 +496,7 @@ class AsyncValue {
   // Get the TypeInfo instance for this AsyncValue.
   const TypeInfo& GetTypeInfo() const;
 
-  using TypeInfoTable = ConcurrentVector<TypeInfo>;
+  using TypeInfoTable = SegmentedConcurrentVector<TypeInfo>;
 
   // Returns the TypeInfoTable instance (there is one per process).
   static TypeInfoTable* GetTypeInfoTableSingleton();
@@ -705,6 +767,12 @@ class ErrorAsyncValue
             std::move(diagnostic)) {}
 };
 
+// ErrorAsyncValue is destroyed and deallocated as its base class.
+static_assert(sizeof(ErrorAsyncValue) ==
+                  sizeof(internal::ConcreteAsyncValue<
+                         DummyValueForErrorAsyncValue>),
+              "ErrorAsyncValue must not add data members");
+
 // IndirectAsyncValue represents an uncomputed AsyncValue of unspecified kind
 // and type. IndirectAsyncValue is used when an AsyncValue must be returned,
 // but the value it holds is not ready and the producer of the value doesn't
@@ -727,6 +795,12 @@ class IndirectAsyncValue : public AsyncValue {
   // This method must be called at most once.
   void ForwardTo(RCReference<AsyncValue> value);
 
+  // Return the value this IndirectAsyncValue forwards to, or nullptr if it is
+  // not resolved yet. The returned value is never an IndirectAsyncValue.
+  AsyncValue* GetForwardedValue() const {
+    return IsAvailable() ? value_ : nullptr;
+  }
+
   static bool classof(const AsyncValue* v) {
     return v->kind() == AsyncValue::Kind::kIndirect;
   }
@@ -854,6 +928,20 @@ T& AsyncValue::get() {
   return const_cast<T&>(static_cast<const AsyncValue*>(this)->get<T>());
 }
 
+inline void AsyncValue::BorrowValue(Value* value) {
+  assert(IsConcrete());
+  switch (kind()) {
+    case Kind::kConcrete:
+      GetTypeInfo().borrow_value(this, value);
+      return;
+    case Kind::kIndirect:
+      auto* iv_value = cast<IndirectAsyncValue>(this)->value_;
+      assert(iv_value && "Indirect value not resolved");
+      iv_value->BorrowValue(value);
+      return;
+  }
+}
+
 inline void AsyncValue::SetStateConcrete() {
   assert(IsConstructed() && kind() == Kind::kConcrete);
   NotifyAvailable(State::kConcrete);
@@ -913,12 +1001,11 @@ inline void AsyncValue::Destroy() {
     // explicit check and instead make ~IndirectAsyncValue go through the
     // GetTypeInfo().destructor case below.
     static_cast<IndirectAsyncValue*>(this)->~IndirectAsyncValue();
-    std::free(this);
+    internal::DeallocateAsyncValue<IndirectAsyncValue>(this);
     return;
   }
 
   GetTypeInfo().destructor(this, /*destroys_object=*/true);
-  std::free(this);
 }
 
 inline raw_ostream& operator<<(raw_ostream& os,
@@ -40,10 +40,11 @@ class ExecutionContext;
 
 namespace internal {
 
-// Forward declaration from host_context.h.
+// Allocate and construct an AsyncValue of type T, which is destroyed by
+// AsyncValue::Destroy().
 template <typename T, typename... Args>
 T* SimpleConstruct(Args&&... args) {
-  void* buf = AlignedAlloc(alignof(T), sizeof(T));
+  void* buf = AllocateAsyncValue<T>();
   return new (buf) T(std::forward<Args>(args)...);
 }
 
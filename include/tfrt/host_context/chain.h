@@ -19,8 +19,9 @@
 // Chain is a control dependence between kernels. Its runtime representation is
 // a zero sized value.
 //
-// ReadyChain is a singleton that holds an AsyncValueRef to a Chain for each
-// HostContext, to avoid repeated creation of ready chains on the heap.
+// GetReadyChain() returns a ready chain that is shared by all HostContexts, to
+// avoid repeated creation of ready chains on the heap. It is never destroyed
+// and is not reference counted, so copies of it do not touch its refcount.
 //===----------------------------------------------------------------------===//
 
 #ifndef TFRT_HOST_CONTEXT_CHAIN_H_
@@ -33,46 +34,13 @@ namespace tfrt {
 
 struct Chain {};
 
-class ReadyChain {
- public:
-  ReadyChain(const ReadyChain&) = delete;
-  ReadyChain& operator=(const ReadyChain&) = delete;
-
-  static ReadyChain& Get() {
-    // TODO(b/162096472) Use NoDestructor when available.
-    static ReadyChain& kReadyChain = *new ReadyChain();
-    return kReadyChain;
-  }
-
-  AsyncValueRef<Chain> GetReadyChain(HostContext* host) {
-    return AsyncValueRef<Chain>(
-        FormRef(all_ready_chains_[HostContextPtr(host).index()].get()));
-  }
-
- private:
-  friend class HostContext;
-
-  ReadyChain() = default;
-
-  void Construct(HostContext* host) {
-    all_ready_chains_[HostContextPtr(host).index()] =
-        std::make_unique<internal::ConcreteAsyncValue<Chain>>(
-            internal::ConcreteAsyncValue<Chain>::UnRefCountedConcretePayload{});
-  }
-
-  void Destruct(HostContext* host) {
-    all_ready_chains_[HostContextPtr(host).index()].reset();
-  }
-
-  // Store a ready chain for each HostContext to avoid repeated creations of
-  // ready chains on the heap.
-  std::unique_ptr<internal::ConcreteAsyncValue<Chain>>
-      all_ready_chains_[HostContextPool::kCompacity];
-};
-
+AsyncValueRef<Chain> GetReadyChain();
 AsyncValueRef<Chain> GetReadyChain(HostContext* host);
 
-// Specialization of MakeAvailableAsyncValueRef<Chain> that calls GetReadyChain.
+// Specializations of MakeAvailableAsyncValueRef<Chain> that call
+// GetReadyChain.
+template <>
+AsyncValueRef<Chain> MakeAvailableAsyncValueRef<Chain>();
 template <>
 AsyncValueRef<Chain> MakeAvailableAsyncValueRef<Chain>(HostContext* host);
 
@@ -22,9 +22,13 @@
 #ifndef TFRT_HOST_CONTEXT_CONCURRENT_WORK_QUEUE_H_
 #define TFRT_HOST_CONTEXT_CONCURRENT_WORK_QUEUE_H_
 
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Compiler.h"
 #include "tfrt/host_context/task_function.h"
@@ -99,6 +103,24 @@ class ConcurrentWorkQueue {
     AddTask(std::move(work));
   }
 
+  // Enqueue several blocks of work that can run in parallel, e.g. the fan-out
+  // of a kernel. Thread-safe. The tasks are moved out of `works`. An
+  // implementation may wake up its threads once for the whole batch. The
+  // default implementation adds the tasks one by one.
+  virtual void AddTasks(const ExecutionContext& exec_ctx,
+                        MutableArrayRef<TaskFunction> works) {
+    for (TaskFunction& work : works) AddTask(exec_ctx, std::move(work));
+  }
+
+  // Enqueue a block of work that mostly accesses the memory at `data`, e.g.
+  // the buffer of an input tensor. A NUMA-aware implementation may run the
+  // work on a thread close to that memory. The default implementation ignores
+  // `data`.
+  virtual void AddTaskNear(const ExecutionContext& exec_ctx, const void* data,
+                           TaskFunction work) {
+    AddTask(exec_ctx, std::move(work));
+  }
+
   // Enqueue a blocking task. Thread-safe.
   //
   // If `allow_queuing` is false, implementation must guarantee that work will
@@ -142,9 +164,15 @@ class ConcurrentWorkQueue {
   virtual bool IsInWorkerThread() const = 0;
 };
 
-// Create a thread pool that only uses the host donor thread, involving no
-// synchronization.
-std::unique_ptr<ConcurrentWorkQueue> CreateSingleThreadedWorkQueue();
+// Create a thread pool that only uses the host donor thread. Tasks added by
+// the tasks it runs involve no synchronization, and tasks added by other
+// threads go through a lock-free queue.
+//
+// If `spin_duration` is not zero, the donor thread busy-polls for new tasks
+// for up to `spin_duration` before it blocks, which trades CPU time for lower
+// wake-up latency.
+std::unique_ptr<ConcurrentWorkQueue> CreateSingleThreadedWorkQueue(
+    std::chrono::nanoseconds spin_duration = std::chrono::nanoseconds(0));
 
 // Create a multi-threaded non-blocking thread pool that supports both blocking
 // and non-blocking workloads.
@@ -161,6 +189,60 @@ std::unique_ptr<ConcurrentWorkQueue> CreateSingleThreadedWorkQueue();
 std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
     int num_threads, int num_blocking_threads);
 
+// Create a multi-threaded work queue with elastic blocking threads. It keeps
+// `min_num_blocking_threads` pre-allocated blocking threads, and when they are
+// all busy it runs blocking tasks in up to `num_blocking_threads` -
+// `min_num_blocking_threads` additional threads. The additional threads exit
+// after they are idle for `blocking_idle_timeout`.
+//
+// Requires `num_threads` > 0 and
+// 0 < `min_num_blocking_threads` <= `num_blocking_threads`.
+std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
+    int num_threads, int num_blocking_threads, int min_num_blocking_threads,
+    std::chrono::nanoseconds blocking_idle_timeout = std::chrono::seconds(1));
+
+// Options of a multi-threaded work queue that control the number, placement
+// and names of its threads.
+struct MultiThreadedWorkQueueOptions {
+  // Number of pre-allocated threads used in non-blocking concurrent work queue.
+  int num_threads = 0;
+  // Maximum number of threads used in blocking work queue.
+  int num_blocking_threads = 0;
+  // Number of pre-allocated threads used in blocking work queue, or 0 to
+  // pre-allocate all `num_blocking_threads`.
+  int min_num_blocking_threads = 0;
+  // Additional blocking threads exit after they are idle for this long.
+  std::chrono::nanoseconds blocking_idle_timeout = std::chrono::seconds(1);
+
+  // CPUs the non-blocking threads are pinned to. If empty, the threads are not
+  // pinned.
+  std::vector<int> cpus;
+  // CPUs the blocking threads are pinned to. If empty and `cpus` is not empty,
+  // the blocking threads are pinned to the other CPUs of the host, so that
+  // they do not disturb the non-blocking threads.
+  std::vector<int> blocking_cpus;
+
+  // Names of the non-blocking and blocking threads, or empty for the default
+  // names. Linux truncates thread names to 15 characters.
+  std::string thread_name;
+  std::string blocking_thread_name;
+
+  // Enables deadline-aware scheduling of the requests with a deadline (see
+  // RequestOptions::deadline). Their tasks run at high priority once the
+  // request is within `urgent_deadline_slack` of its deadline, and
+  // InitRequest() rejects requests whose deadline is closer than the recent
+  // queueing delay of the tasks.
+  bool deadline_scheduling = false;
+  std::chrono::nanoseconds urgent_deadline_slack = std::chrono::milliseconds(10);
+};
+
+// Create a multi-threaded work queue configured by `options`.
+//
+// Requires `num_threads` > 0 and
+// 0 <= `min_num_blocking_threads` <= `num_blocking_threads` > 0.
+std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
+    const MultiThreadedWorkQueueOptions& options);
+
 // A factory function for creating ConcurrentWorkQueue objects. The factory
 // function defines the semantics of the argument string.
 // TODO(pgavin): Consider using a configuration object or other data structure
@@ -19,18 +19,47 @@
 #ifndef TFRT_HOST_CONTEXT_EXECUTION_CONTEXT_H_
 #define TFRT_HOST_CONTEXT_EXECUTION_CONTEXT_H_
 
+#include <chrono>
+
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/arena_allocator.h"
 #include "tfrt/host_context/debug_info.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/resource_context.h"
 #include "tfrt/support/map_by_type.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
 
 class HostContext;
+class HostAllocator;
 class ErrorAsyncValue;
 class ConcurrentWorkQueue;
 
+struct RequestOptions {
+  using RequestPriority = int;
+
+  // The priorities honored by the multi-threaded work queue when it picks the
+  // next task to run or to steal. Larger values are more urgent: values from
+  // kCriticalPriority up are critical, and negative values are low.
+  static constexpr RequestPriority kLowPriority = -1;
+  static constexpr RequestPriority kDefaultPriority = 0;
+  static constexpr RequestPriority kHighPriority = 1;
+  static constexpr RequestPriority kCriticalPriority = 2;
+
+  RequestPriority priority = kDefaultPriority;
+
+  // The time by which the request should complete. Work queues may schedule
+  // the tasks of requests close to their deadline first, and reject requests
+  // that cannot meet it. It does not cancel the request, see
+  // RequestDeadlineTracker for that.
+  std::chrono::system_clock::time_point deadline =
+      std::chrono::system_clock::time_point::max();
+};
+
 // A request refers to either a BEFFunction execution or an op execution.
 // RequestContext holds per request information, such as the cancellation status
 // and request priority. A RequestContext object is reference counted and is
@@ -47,10 +76,32 @@ class RequestContext : public ReferenceCounted<RequestContext> {
   ~RequestContext();
 
   bool IsCancelled() const { return GetCancelAsyncValue(); }
+
+  // Cancels the request and runs the registered cancel callbacks. Only the
+  // first call has an effect.
   void Cancel();
+
+  // Registers `callback` to run when the request is cancelled, so that work
+  // which does not check IsCancelled(), such as an in-flight remote call or
+  // blocking I/O, can be aborted. The callback runs immediately if the request
+  // is already cancelled. Returns an id for RemoveCancelCallback(), which
+  // should be called once the work completes.
+  using CancelCallbackId = int64_t;
+  CancelCallbackId AddCancelCallback(llvm::unique_function<void()> callback);
+  void RemoveCancelCallback(CancelCallbackId id);
+
   HostContext* host() const { return host_; }
   ResourceContext* resource_context() const { return resource_context_; }
 
+  // Return the arena allocator of the request, or nullptr if the request does
+  // not own one.
+  ArenaAllocator* arena_allocator() const { return arena_allocator_.get(); }
+
+  // Return the allocator for memory that is expected to die with the request:
+  // the arena allocator if the request owns one, otherwise the allocator of
+  // the HostContext.
+  HostAllocator* allocator() const;
+
   // If the request has been canceled, return an ErrorAsyncValue for
   // the cancellation. Otherwise, return nullptr.
   ErrorAsyncValue* GetCancelAsyncValue() const {
@@ -78,18 +129,34 @@ class RequestContext : public ReferenceCounted<RequestContext> {
   void ClearData() { context_data_ = ContextData(); }
 
   int64_t id() const { return id_; }
+  RequestOptions::RequestPriority priority() const { return priority_; }
+  std::chrono::system_clock::time_point deadline() const { return deadline_; }
+
+  // The id of the trace flow (see tracing::RecordTracingFlow) connecting the
+  // activities of the request, or zero if the request is not traced.
+  uint64_t trace_id() const { return trace_id_; }
 
  private:
   friend class RequestContextBuilder;
 
   RequestContext(HostContext* host, ResourceContext* resource_context,
-                 ContextData ctx_data, int64_t id)
+                 ContextData ctx_data, int64_t id,
+                 const RequestOptions& request_options,
+                 RCReference<ArenaAllocator> arena_allocator,
+                 uint64_t trace_id)
       : id_{id},
+        priority_{request_options.priority},
+        deadline_{request_options.deadline},
+        trace_id_{trace_id},
         host_{host},
         resource_context_{resource_context},
-        context_data_{std::move(ctx_data)} {}
+        context_data_{std::move(ctx_data)},
+        arena_allocator_{std::move(arena_allocator)} {}
 
   int64_t id_;
+  RequestOptions::RequestPriority priority_;
+  std::chrono::system_clock::time_point deadline_;
+  uint64_t trace_id_;
   HostContext* const host_ = nullptr;
   // Both ResourceContext and ContextData manages data used during the request
   // execution. ResourceContext is more flexible than ContextData at the cost of
@@ -102,13 +169,18 @@ class RequestContext : public ReferenceCounted<RequestContext> {
   ResourceContext* const resource_context_ = nullptr;
   ContextData context_data_;
 
-  std::atomic<ErrorAsyncValue*> cancel_value_{nullptr};
-};
+  // The arena is freed when the request is destroyed, unless allocations from
+  // it are still alive.
+  RCReference<ArenaAllocator> arena_allocator_;
 
-struct RequestOptions {
-  using RequestPriority = int;
+  std::atomic<ErrorAsyncValue*> cancel_value_{nullptr};
 
-  RequestPriority priority = 0;
+  mutex cancel_callbacks_mu_;
+  CancelCallbackId next_cancel_callback_id_
+      TFRT_GUARDED_BY(cancel_callbacks_mu_) = 0;
+  llvm::SmallVector<std::pair<CancelCallbackId, llvm::unique_function<void()>>,
+                    2>
+      cancel_callbacks_ TFRT_GUARDED_BY(cancel_callbacks_mu_);
 };
 
 // A builder class for RequestContext.
@@ -133,7 +205,35 @@ class RequestContextBuilder {
     return std::move(*this);
   }
 
+  // Make the request own an ArenaAllocator, which allocates chunks of
+  // `chunk_size` bytes from the allocator of the HostContext.
+  RequestContextBuilder& enable_arena_allocator(
+      size_t chunk_size = ArenaAllocator::kDefaultChunkSize) & {
+    arena_chunk_size_ = chunk_size;
+    return *this;
+  }
+
+  RequestContextBuilder&& enable_arena_allocator(
+      size_t chunk_size = ArenaAllocator::kDefaultChunkSize) && {
+    arena_chunk_size_ = chunk_size;
+    return std::move(*this);
+  }
+
+  // Continue the trace flow `trace_id`, e.g. of the remote request which
+  // issued this one. By default, requests built while tracing is enabled start
+  // a new flow.
+  RequestContextBuilder& set_trace_id(uint64_t trace_id) & {
+    trace_id_ = trace_id;
+    return *this;
+  }
+
+  RequestContextBuilder&& set_trace_id(uint64_t trace_id) && {
+    trace_id_ = trace_id;
+    return std::move(*this);
+  }
+
   int64_t id() const { return id_; }
+  uint64_t trace_id() const { return trace_id_; }
   HostContext* host() const { return host_; }
   ResourceContext* resource_context() const { return resource_context_; }
   const RequestOptions& request_options() const { return request_options_; }
@@ -151,6 +251,9 @@ class RequestContextBuilder {
   RequestOptions request_options_;
   ResourceContext* resource_context_ = nullptr;
   RequestContext::ContextData context_data_;
+  // Zero if the request does not own an arena allocator.
+  size_t arena_chunk_size_ = 0;
+  uint64_t trace_id_ = 0;
 };
 
 // ExecutionContext holds the context information for kernel and op execution,
@@ -173,17 +276,20 @@ class ExecutionContext {
       : request_ctx_{exec_ctx.request_ctx_.CopyRef()},
         work_queue_(&exec_ctx.work_queue()),
         location_{exec_ctx.location()},
-        debug_info_({exec_ctx.debug_info()}) {}
+        debug_info_({exec_ctx.debug_info()}),
+        stream_id_(exec_ctx.stream_id()) {}
   ExecutionContext(ExecutionContext&& exec_ctx)
       : request_ctx_{std::move(exec_ctx.request_ctx_)},
         work_queue_(&exec_ctx.work_queue()),
         location_{exec_ctx.location()},
-        debug_info_({exec_ctx.debug_info()}) {}
+        debug_info_({exec_ctx.debug_info()}),
+        stream_id_(exec_ctx.stream_id()) {}
   ExecutionContext& operator=(const ExecutionContext& exec_ctx) {
     request_ctx_ = exec_ctx.request_ctx_.CopyRef();
     work_queue_ = &exec_ctx.work_queue();
     location_ = exec_ctx.location();
     debug_info_ = exec_ctx.debug_info();
+    stream_id_ = exec_ctx.stream_id();
     return *this;
   }
   ExecutionContext& operator=(ExecutionContext&& exec_ctx) {
@@ -191,19 +297,35 @@ class ExecutionContext {
     work_queue_ = &exec_ctx.work_queue();
     location_ = exec_ctx.location();
     debug_info_ = exec_ctx.debug_info();
+    stream_id_ = exec_ctx.stream_id();
     return *this;
   }
 
   Location location() const { return location_; }
   DebugInfo debug_info() const { return debug_info_; }
+  // The id of the stream (see compiler::StreamAnalysis) of the kernel that is
+  // executed. Devices with multiple streams can use it to run independent
+  // kernels concurrently.
+  int stream_id() const { return stream_id_; }
   HostContext* host() const { return request_ctx_->host(); }
+  // Return the allocator for memory that dies with the request. See
+  // RequestContext::allocator().
+  HostAllocator* allocator() const { return request_ctx_->allocator(); }
   bool IsCancelled() const { return request_ctx_->IsCancelled(); }
+  RequestOptions::RequestPriority priority() const {
+    return request_ctx_->priority();
+  }
+  std::chrono::system_clock::time_point deadline() const {
+    return request_ctx_->deadline();
+  }
+  uint64_t trace_id() const { return request_ctx_->trace_id(); }
   ErrorAsyncValue* GetCancelAsyncValue() const {
     return request_ctx_->GetCancelAsyncValue();
   }
 
   void set_location(Location location) { location_ = location; }
   void set_debug_info(DebugInfo debug_info) { debug_info_ = debug_info; }
+  void set_stream_id(int stream_id) { stream_id_ = stream_id; }
 
   // Set the work queue to use for dispatching async tasks.
   void set_work_queue(ConcurrentWorkQueue* work_queue) {
@@ -227,6 +349,7 @@ class ExecutionContext {
   ConcurrentWorkQueue* work_queue_ = nullptr;
   Location location_;
   DebugInfo debug_info_;
+  int stream_id_ = 0;
 };
 
 }  // namespace tfrt
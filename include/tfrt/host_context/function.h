@@ -58,6 +58,16 @@ class Function {
       const ExecutionContext& exec_ctx, ArrayRef<AsyncValue*> arguments,
       MutableArrayRef<RCReference<AsyncValue>> results) const = 0;
 
+  // Execute this function `count` > 0 times, passing the results of each
+  // execution as the arguments of the next one. This requires the argument and
+  // result types to be the same, and returns the results of the last
+  // execution. Implementations can reuse the execution state across the
+  // iterations, the default implementation simply calls Execute().
+  virtual void ExecuteRepeatedly(
+      const ExecutionContext& exec_ctx, int32_t count,
+      ArrayRef<AsyncValue*> arguments,
+      MutableArrayRef<RCReference<AsyncValue>> results) const;
+
   // Reference counting operations, used by async kernels to keep the underlying
   // storage for a function alive.
   virtual void AddRef() const = 0;
@@ -24,10 +24,20 @@
 #include <memory>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringRef.h"
 #include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
 
+// The memory in use by an allocator, see HostAllocator::GetMemoryUsage().
+struct MemoryUsage {
+  size_t bytes_in_use = 0;
+  // The budget of the allocator, or zero if it has none. Allocations beyond it
+  // may still succeed, but MemoryPressure sheds load as usage approaches it.
+  size_t bytes_limit = 0;
+};
+
 // This is a pure virtual base class for memory allocator implementations. This
 // abstraction allows clients of the runtime to plug in their own memory
 // allocation policies, e.g. to cordon off allocations for one HostContext to
@@ -61,6 +71,9 @@ class HostAllocator {
   // Deallocate the specified pointer that has the specified size.
   virtual void DeallocateBytes(void* ptr, size_t size) = 0;
 
+  // Returns the memory in use, or None if the allocator does not track it.
+  virtual Optional<MemoryUsage> GetMemoryUsage() const { return llvm::None; }
+
  protected:
   friend class HostContext;
   HostAllocator() = default;
@@ -74,9 +87,73 @@ class HostAllocator {
 // Create an allocator that just calls malloc/free.
 std::unique_ptr<HostAllocator> CreateMallocAllocator();
 
+// Create an allocator for multi-threaded hosts. Allocations of up to 32 kB are
+// served from thread-local caches of power of two size classes, which are
+// carved from slabs and aligned to their size (at least 64 bytes). This avoids
+// the contention of malloc across worker threads. Allocations of at least 2 MB
+// are mapped in regions that can be backed by huge pages, other allocations
+// use malloc. Small allocations can not be aligned to more than 32 kB.
+//
+// Memory of small allocations is cached by the allocator until it is
+// destroyed.
+std::unique_ptr<HostAllocator> CreateSlabAllocator();
+
+// Decorate an allocator to back allocations of at least `min_size` bytes with
+// huge pages, which reduces the TLB misses of kernels that stream through
+// large buffers, e.g. weights and batch activations. Each such allocation is
+// mapped with explicit huge pages from the kernel's hugetlb pool if it has
+// free pages: 1 GB pages for allocations of at least 1 GB, otherwise 2 MB
+// pages. If the pool is exhausted, the allocation is mapped in a region that
+// can be backed by transparent huge pages instead. Allocations that can not
+// be mapped, and all allocations on platforms without huge pages, are
+// forwarded to `allocator`.
+std::unique_ptr<HostAllocator> CreateHugePageAllocator(
+    std::unique_ptr<HostAllocator> allocator,
+    size_t min_size = 2 * 1024 * 1024);
+
+// Advise the kernel to back the huge page aligned part of the mapped memory
+// [ptr, ptr + size) with transparent huge pages, e.g. for the constants of a
+// memory mapped file. This is only a hint, which kernels without huge page
+// support for file mappings ignore.
+void AdviseHugePages(void* ptr, size_t size);
+
+// Decorate an allocator to count the bytes in use, which it reports with
+// `bytes_limit` from GetMemoryUsage(). The limit is not enforced: it is the
+// budget against which MemoryPressure measures usage to shed load. Decorators
+// that forward some allocations elsewhere, like the huge page allocator, need
+// to be wrapped by this one rather than wrap it.
+std::unique_ptr<HostAllocator> CreateMemoryUsageTrackingAllocator(
+    std::unique_ptr<HostAllocator> allocator, size_t bytes_limit);
+
 // Create an allocator of fixed size for testing.
 std::unique_ptr<HostAllocator> CreateFixedSizeAllocator(size_t capacity = 1024);
 
+// Names the site of the allocations made by the calling thread while the scope
+// is alive, e.g. the kernel that the thread executes. Profiling allocators
+// attribute sampled allocations to the innermost site. `site` must outlive the
+// scope.
+class AllocationSiteScope {
+ public:
+  explicit AllocationSiteScope(string_view site) : previous_(CurrentSite()) {
+    CurrentSite() = site;
+  }
+  ~AllocationSiteScope() { CurrentSite() = previous_; }
+
+  AllocationSiteScope(const AllocationSiteScope&) = delete;
+  AllocationSiteScope& operator=(const AllocationSiteScope&) = delete;
+
+  // Returns the innermost site of the calling thread, or an empty string.
+  static string_view GetCurrentSite() { return CurrentSite(); }
+
+ private:
+  static string_view& CurrentSite() {
+    thread_local string_view site;
+    return site;
+  }
+
+  string_view previous_;
+};
+
 // An RAII-based abstraction that manages an array of objects via HostAllocator.
 template <typename ObjectT>
 class HostArray {
@@ -26,6 +26,7 @@
 #include "tfrt/support/ref_count.h"
 
 namespace tfrt {
+class ExecutionContext;
 class HostAllocator;
 
 // HostBuffer is a reference counted chunk of untyped memory on the host, whose
@@ -35,11 +36,17 @@ class HostBuffer : public ReferenceCounted<HostBuffer> {
   // Create an uninitialized HostBuffer of the specified size and alignment.
   // This returns a null RCReference on allocation failure.
   // `allocator` will be used to allocate the memory and to deallocate it
-  // when the returned buffer is destroyed.
+  // when the returned buffer is destroyed. Large buffers are backed by huge
+  // pages if `allocator` was created with CreateHugePageAllocator().
   static RCReference<HostBuffer> CreateUninitialized(size_t size,
                                                      size_t alignment,
                                                      HostAllocator *allocator);
 
+  // Same as above, but allocate the memory with the allocator of the request
+  // of `exec_ctx`, which is an arena if the request owns one.
+  static RCReference<HostBuffer> CreateUninitialized(
+      size_t size, size_t alignment, const ExecutionContext &exec_ctx);
+
   using Deallocator = llvm::unique_function<void(void *ptr, size_t size)>;
   // Create a HostBuffer by taking ownership of an externally allocated buffer.
   // `deallocator` is called with `ptr` and `size` as arguments when we destroy
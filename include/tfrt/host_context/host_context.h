@@ -35,6 +35,7 @@ namespace tfrt {
 class DecodedDiagnostic;
 
 class ConcurrentWorkQueue;
+struct MultiThreadedWorkQueueOptions;
 class HostAllocator;
 class TypeDescriptor;
 class IndirectAsyncValue;
@@ -63,6 +64,12 @@ class HostContext {
               std::unique_ptr<HostAllocator> allocator,
               std::unique_ptr<ConcurrentWorkQueue> work_queue);
 
+  // This constructor creates a multi-threaded work queue configured by
+  // `work_queue_options`, e.g. to pin its threads to a set of CPUs.
+  HostContext(std::function<void(const DecodedDiagnostic&)> diag_handler,
+              std::unique_ptr<HostAllocator> allocator,
+              const MultiThreadedWorkQueueOptions& work_queue_options);
+
   HostContext(const HostContext&) = delete;
   HostContext& operator=(const HostContext&) = delete;
   ~HostContext();
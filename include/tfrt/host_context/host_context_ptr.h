@@ -74,7 +74,6 @@ class HostContextPtr {
 
  private:
   friend class HostContextPool;
-  friend class ReadyChain;
 
   explicit HostContextPtr(int index) : index_{static_cast<uint8_t>(index)} {
     assert(index < HostContextPool::kCompacity);
@@ -35,6 +35,7 @@
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/rc_array.h"
 #include "tfrt/support/string_util.h"
 
 namespace tfrt {
@@ -86,6 +87,12 @@ class AsyncKernelFrame {
 
   ArrayRef<uint8_t> GetAttributeSection() const { return attribute_section_; }
 
+  // Returns the reference counted function that keeps the attribute section
+  // alive, or nullptr if there is none.
+  const Function* GetAttributeSectionOwner() const {
+    return attribute_section_owner_;
+  }
+
   // Get the number of arguments.
   int GetNumArgs() const { return arguments_.size(); }
 
@@ -256,7 +263,7 @@ class AsyncKernelFrame {
 
   // Clear arguments.
   void ResetArguments() {
-    for (auto* arg : arguments_) arg->DropRef();
+    DropRefs<AsyncValue>(arguments_);
     arguments_.clear();
   }
 
@@ -273,6 +280,7 @@ class AsyncKernelFrame {
   SmallVector<RCReference<AsyncValue>, 8> results_;
 
   ArrayRef<uint8_t> attribute_section_;
+  const Function* attribute_section_owner_ = nullptr;
   ArrayRef<uint32_t> attribute_offsets_;
   ArrayRef<uint32_t> function_indices_;
   ArrayRef<std::unique_ptr<Function>> functions_;
@@ -280,26 +288,28 @@ class AsyncKernelFrame {
 };
 
 inline void AsyncKernelFrame::AssignFields(const AsyncKernelFrame& other) {
-  for (auto* arg : arguments_) arg->DropRef();
+  DropRefs<AsyncValue>(arguments_);
   arguments_ = other.arguments_;
-  for (auto* arg : arguments_) arg->AddRef();
+  AddRefs<AsyncValue>(arguments_);
 
   assert(results_.empty());
   results_.reserve(other.results_.size());
   for (auto& result : other.results_) results_.push_back(result.CopyRef());
 
   attribute_section_ = other.attribute_section_;
+  attribute_section_owner_ = other.attribute_section_owner_;
   attribute_offsets_ = other.attribute_offsets_;
   function_indices_ = other.function_indices_;
   functions_ = other.functions_;
 }
 
 inline void AsyncKernelFrame::AssignFields(AsyncKernelFrame&& other) {
-  for (auto* arg : arguments_) arg->DropRef();
+  DropRefs<AsyncValue>(arguments_);
   arguments_ = std::move(other.arguments_);
   results_ = std::move(other.results_);
 
   attribute_section_ = other.attribute_section_;
+  attribute_section_owner_ = other.attribute_section_owner_;
   attribute_offsets_ = other.attribute_offsets_;
   function_indices_ = other.function_indices_;
   functions_ = other.functions_;
@@ -331,8 +341,13 @@ class KernelFrameBuilder : public AsyncKernelFrame {
 
   // TODO(tfrt-devs): Consider keeping BEFFile* in the kernel frame directly
   // instead of keeping individual fields.
-  void SetAttributeSection(ArrayRef<uint8_t> attribute_section) {
+  // If `owner` is not null, its reference count keeps `attribute_section`
+  // alive, which allows kernels to use attributes in place beyond their
+  // execution (see DenseAttribute).
+  void SetAttributeSection(ArrayRef<uint8_t> attribute_section,
+                           const Function* owner = nullptr) {
     attribute_section_ = attribute_section;
+    attribute_section_owner_ = owner;
   }
   void SetFunctions(ArrayRef<std::unique_ptr<Function>> functions) {
     functions_ = functions;
@@ -364,6 +379,8 @@ class KernelFrameBuilder : public AsyncKernelFrame {
   void SetDebugInfo(const DebugInfo& debug_info) {
     exec_ctx_.set_debug_info(debug_info);
   }
+
+  void SetStreamId(int stream_id) { exec_ctx_.set_stream_id(stream_id); }
 };
 
 // Implementation details
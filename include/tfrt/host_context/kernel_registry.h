@@ -41,6 +41,12 @@ using SyncKernelImplementation = void (*)(SyncKernelFrame* frame);
 using KernelImplementation =
     Variant<Monostate, AsyncKernelImplementation, SyncKernelImplementation>;
 
+// Native object loaders load the native code that was compiled ahead of time
+// into the kNativeObjects section of a BEF file, e.g. to make it available to
+// the kernels that would otherwise compile it at runtime. `key` identifies the
+// object, and `data` is only valid during the call.
+using NativeObjectLoader = Error (*)(string_view key, ArrayRef<uint8_t> data);
+
 namespace internal {
 
 template <typename TraitT>
@@ -48,6 +54,12 @@ AsyncKernelImplementation AsBEFKernel();
 
 }  // namespace internal
 
+class KernelRegistry;
+
+// The type for kernel registration functions. This is the same as the
+// prototype for the entry point function for dynamic plugins.
+using KernelRegistration = void (*)(KernelRegistry*);
+
 // This represents a mapping between the names of the MLIR opcodes to the
 // implementations of those functions, along with type mappings.
 class KernelRegistry {
@@ -66,8 +78,33 @@ class KernelRegistry {
     AddKernel(name, internal::AsBEFKernel<KernelTraitT>());
   }
 
+  // Returns the kernel with `name`, or an empty KernelImplementation. If
+  // `name` starts with the prefix of a deferred kernel family, the family is
+  // registered first.
   KernelImplementation GetKernel(string_view name) const;
 
+  // Defers the registration of a family of kernels whose names start with
+  // `prefix`, e.g. "tfrt_gpu.", until GetKernel() looks up a kernel name with
+  // the prefix. This avoids the startup cost of the kernel families that a
+  // process doesn't use. While families are deferred, GetKernel() takes a lock.
+  void AddDeferredKernelFamily(string_view prefix,
+                               KernelRegistration registration);
+
+  // Adds the loader of the native objects of the given `kind`. The same loader
+  // can be added more than once, e.g. by kernel libraries that share it.
+  void AddNativeObjectLoader(string_view kind, NativeObjectLoader loader);
+
+  // Returns the loader of the native objects of the given `kind`, or nullptr
+  // if there is none.
+  NativeObjectLoader GetNativeObjectLoader(string_view kind) const;
+
+  // Build a snapshot of the registered kernels with a perfect hash of their
+  // names, which GetKernel() uses from now on. It is meant to be called once
+  // all kernels are registered, e.g. before opening BEF files that resolve
+  // thousands of kernel names. Adding a kernel drops the snapshot, until
+  // Freeze() is called again. Not thread-safe.
+  void Freeze();
+
   TypeName GetType(string_view type) const;
 
  private:
@@ -81,26 +118,36 @@ class KernelRegistry {
 // statically linked in the binary. FUNC should be a function pointer with the
 // prototype given by the tfrt::KernelRegistration alias.
 #define TFRT_STATIC_KERNEL_REGISTRATION(FUNC) \
-  TFRT_STATIC_KERNEL_REGISTRATION_(FUNC, __COUNTER__)
-#define TFRT_STATIC_KERNEL_REGISTRATION_(FUNC, N) \
-  TFRT_STATIC_KERNEL_REGISTRATION__(FUNC, N)
-#define TFRT_STATIC_KERNEL_REGISTRATION__(FUNC, N)          \
-  static bool tfrt_static_kernel_##N##_registered_ = []() { \
-    ::tfrt::AddStaticKernelRegistration(FUNC);              \
-    return true;                                            \
+  TFRT_STATIC_KERNEL_FAMILY_REGISTRATION_("", FUNC, __COUNTER__)
+
+// Like TFRT_STATIC_KERNEL_REGISTRATION, for a function that only registers
+// kernels whose names start with PREFIX, e.g. "tfrt_gpu.". The registration of
+// such families can be deferred, see SetDeferStaticKernelFamilies(). FUNC must
+// not register anything else, e.g. native object loaders.
+#define TFRT_STATIC_KERNEL_FAMILY_REGISTRATION(PREFIX, FUNC) \
+  TFRT_STATIC_KERNEL_FAMILY_REGISTRATION_(PREFIX, FUNC, __COUNTER__)
+#define TFRT_STATIC_KERNEL_FAMILY_REGISTRATION_(PREFIX, FUNC, N) \
+  TFRT_STATIC_KERNEL_FAMILY_REGISTRATION__(PREFIX, FUNC, N)
+#define TFRT_STATIC_KERNEL_FAMILY_REGISTRATION__(PREFIX, FUNC, N) \
+  static bool tfrt_static_kernel_##N##_registered_ = []() {       \
+    ::tfrt::AddStaticKernelRegistration(FUNC, PREFIX);            \
+    return true;                                                  \
   }()
 
-// The type for kernel registration functions. This is the same as the
-// prototype for the entry point function for dynamic plugins.
-using KernelRegistration = void (*)(KernelRegistry*);
-
 // This is called to register all the statically linked kernels in the given
 // registry.
 void RegisterStaticKernels(KernelRegistry* kernel_reg);
 
+// If `defer` is true, RegisterStaticKernels() adds the static kernel families
+// as deferred families of the registry instead of registering them. Defaults
+// to false.
+void SetDeferStaticKernelFamilies(bool defer);
+
 // Adds a kernel to the registry. This should not be used directly; use
-// TFRT_STATIC_KERNEL_REGISTRATION instead.
-void AddStaticKernelRegistration(KernelRegistration func);
+// TFRT_STATIC_KERNEL_REGISTRATION instead. `family_prefix` is empty unless
+// the function only registers the kernels with the prefix.
+void AddStaticKernelRegistration(KernelRegistration func,
+                                 string_view family_prefix = "");
 
 }  // namespace tfrt
 
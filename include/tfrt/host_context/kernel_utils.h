@@ -31,6 +31,8 @@
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/attribute_utils.h"
 #include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_buffer.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/kernel_frame.h"
 #include "tfrt/host_context/kernel_registry.h"
@@ -369,6 +371,37 @@ class RemainingResults {
   MutableArrayRef<RCReference<AsyncValue>> remaining_results_;
 };
 
+// DenseAttribute is a DenseAttr whose elements can be referenced in place by a
+// HostBuffer, so that kernels can create tensors from constants without copying
+// them.
+class DenseAttribute {
+ public:
+  // `owner` keeps the attribute section that contains `attr` alive, or is
+  // nullptr if there is no such function.
+  DenseAttribute(DenseAttr attr, const Function* owner)
+      : attr_(attr), owner_(owner) {}
+
+  const DenseAttr& get() const { return attr_; }
+  const DenseAttr* operator->() const { return &attr_; }
+
+  // Returns a HostBuffer that references the elements in place and keeps the
+  // attribute section alive, or a null reference if the attribute section has
+  // no owner. The elements must not be modified, as they may be in read-only
+  // memory and are shared by all executions of the kernel.
+  RCReference<HostBuffer> GetElementsBuffer() const {
+    if (owner_ == nullptr) return {};
+    ArrayRef<char> elements = attr_.GetRawData();
+    owner_->AddRef();
+    return HostBuffer::CreateFromExternal(
+        const_cast<char*>(elements.data()), elements.size(),
+        [owner = owner_](void*, size_t) { owner->DropRef(); });
+  }
+
+ private:
+  DenseAttr attr_;
+  const Function* owner_;
+};
+
 // RemainingAttributes collects all remaining attributes. There can be at most
 // one RemainingAttributes, and it must appear after all other Attribute.
 class RemainingAttributes {
@@ -891,6 +924,23 @@ struct TfrtKernelImpl<Return (*)(Args...), impl_fn> {
   struct SyncKernelCallHelper<DenseAttr, Tail...>
       : SyncKernelCallTypedAttrHelper<DenseAttr, Tail...> {};
 
+  // Like the above, but for DenseAttribute.
+  template <typename... Tail>
+  struct SyncKernelCallHelper<DenseAttribute, Tail...> {
+    template <int arg_idx, int result_idx, int attr_idx, int func_idx,
+              bool has_kernel_error_handler, bool has_in_chain,
+              typename... PreviousArgs>
+    static void Invoke(AsyncKernelFrame* frame, const PreviousArgs&... pargs) {
+      static_assert(attr_idx != -1,
+                    "Do not place DenseAttribute after RemainingAttributes");
+      DenseAttribute arg(frame->GetDenseAttr(attr_idx),
+                         frame->GetAttributeSectionOwner());
+      SyncKernelCallHelper<Tail...>::template Invoke<
+          arg_idx, result_idx, attr_idx + 1, func_idx, has_kernel_error_handler,
+          has_in_chain>(frame, pargs..., arg);
+    }
+  };
+
   // Like the above, but for ShapeAttr.
   template <typename... Tail>
   struct SyncKernelCallHelper<ShapeAttr, Tail...>
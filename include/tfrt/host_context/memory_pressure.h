@@ -0,0 +1,94 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares MemoryPressure, which sheds load as the memory usage of a
+// HostContext approaches its limits.
+
+#ifndef TFRT_HOST_CONTEXT_MEMORY_PRESSURE_H_
+#define TFRT_HOST_CONTEXT_MEMORY_PRESSURE_H_
+
+#include <functional>
+#include <vector>
+
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/shared_context.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+// MemoryPressure relates the memory in use to the limits of the allocators, so
+// that a burst of large requests degrades throughput instead of running the
+// process out of memory. The usage is reported by sources: the allocator of the
+// HostContext, and e.g. device allocators added with AddSource(). The pressure
+// is the largest fraction of its limit that a source uses. Sources without a
+// limit are ignored, so there is no pressure unless an allocator reports a
+// limit, e.g. one created with CreateMemoryUsageTrackingAllocator().
+//
+// Above the low watermark, new requests with a priority below the default are
+// rejected, and prefetch buffers shrink linearly. Above the high watermark,
+// only critical requests are admitted, and prefetch buffers are disabled.
+// Rejected requests fail with a ResourceExhausted error from
+// RequestContextBuilder::build(), so that callers can retry them later.
+//
+// Example usage:
+//
+//   auto& memory_pressure = MemoryPressure::Get(host);
+//   memory_pressure.AddSource([device] { return device->GetMemoryUsage(); });
+class MemoryPressure : public SharedContext {
+ public:
+  using UsageFn = std::function<Optional<MemoryUsage>()>;
+
+  explicit MemoryPressure(HostContext* host);
+
+  static MemoryPressure& Get(HostContext* host) {
+    return host->GetOrCreateSharedContext<MemoryPressure>();
+  }
+
+  // Adds a source of memory usage. `usage_fn` may be called from any thread,
+  // and whatever it refers to needs to outlive the HostContext.
+  void AddSource(UsageFn usage_fn);
+
+  // Sets the watermarks, as fractions of the limits with 0 < low <= high. The
+  // defaults are 0.8 and 0.95.
+  void SetWatermarks(double low, double high);
+
+  // Returns the largest fraction of its limit that a source uses, or zero if no
+  // source has a limit.
+  double GetPressure() const;
+
+  // Returns a ResourceExhausted error if a new request with `priority` is
+  // rejected at the current pressure.
+  Error AdmitRequest(int64_t id,
+                     RequestOptions::RequestPriority priority) const;
+
+  // Returns the number of elements to buffer ahead of the consumer, instead of
+  // `size`, at the current pressure.
+  size_t LimitBufferSize(size_t size) const;
+
+ private:
+  mutable mutex mu_;
+  std::vector<UsageFn> sources_ TFRT_GUARDED_BY(mu_);
+  double low_watermark_ TFRT_GUARDED_BY(mu_) = 0.8;
+  double high_watermark_ TFRT_GUARDED_BY(mu_) = 0.95;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_MEMORY_PRESSURE_H_
@@ -19,9 +19,16 @@
 #ifndef TFRT_HOST_CONTEXT_NATIVE_FUNCTION_H_
 #define TFRT_HOST_CONTEXT_NATIVE_FUNCTION_H_
 
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
 #include "llvm/ADT/StringMap.h"
+#include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/function.h"
+#include "tfrt/support/error_util.h"
 #include "tfrt/support/mutex.h"
+#include "tfrt/support/type_traits.h"
 
 namespace tfrt {
 
@@ -37,6 +44,25 @@ using NativeCallable = void (*)(AsyncValue* const* arguments, int num_arguments,
                                 RCReference<AsyncValue>* results,
                                 int num_results, HostContext* host);
 
+// TFRT_NATIVE_FUNCTION turns a C++ function with typed arguments and results
+// into a NativeCallable, in the same way TFRT_KERNEL does for kernels:
+//
+//   int32_t Add(int32_t a, int32_t b) { return a + b; }
+//
+//   registry->Add("native_add", TFRT_NATIVE_FUNCTION(Add));
+//
+// Each argument is read from the corresponding AsyncValue with get<T>(), so
+// the AsyncValue must be available when the function is called, which
+// NativeFunction::Execute guarantees. A `HostContext*` parameter receives the
+// host instead of an argument.
+//
+// The function may return void (no results), a value, an AsyncValueRef<T>, an
+// RCReference<AsyncValue>, or a std::tuple of those for multiple results. It
+// may also return Expected<T>, in which case an error sets all the results to
+// that error.
+#define TFRT_NATIVE_FUNCTION(...)                                           \
+  ::tfrt::TfrtNativeFunctionImpl<decltype(&__VA_ARGS__), &__VA_ARGS__>::Invoke
+
 class NativeFunctionRegistry {
  public:
   static NativeFunctionRegistry& GetGlobalRegistry() {
@@ -84,6 +110,166 @@ class NativeFunction : public Function {
   NativeCallable callable_;
 };
 
+namespace internal {
+
+template <typename T>
+void SetNativeResult(T value, RCReference<AsyncValue>* result) {
+  *result = MakeAvailableAsyncValueRef<T>(std::move(value));
+}
+template <typename T>
+void SetNativeResult(AsyncValueRef<T> value, RCReference<AsyncValue>* result) {
+  *result = value.ReleaseRCRef();
+}
+inline void SetNativeResult(RCReference<AsyncValue> value,
+                            RCReference<AsyncValue>* result) {
+  *result = std::move(value);
+}
+
+// Calls `f` and stores its return value of type `Return` in `results`.
+template <typename Return>
+struct NativeReturnHelper {
+  static constexpr int kNumResults = 1;
+
+  template <typename F>
+  static void Invoke(F&& f, RCReference<AsyncValue>* results) {
+    SetNativeResult(f(), results);
+  }
+};
+
+template <>
+struct NativeReturnHelper<void> {
+  static constexpr int kNumResults = 0;
+
+  template <typename F>
+  static void Invoke(F&& f, RCReference<AsyncValue>* results) {
+    f();
+  }
+};
+
+template <typename... T>
+struct NativeReturnHelper<std::tuple<T...>> {
+  static constexpr int kNumResults = sizeof...(T);
+
+  template <typename F>
+  static void Invoke(F&& f, RCReference<AsyncValue>* results) {
+    SetResults(f(), results, std::index_sequence_for<T...>());
+  }
+
+ private:
+  template <size_t... I>
+  static void SetResults(std::tuple<T...>&& values,
+                         RCReference<AsyncValue>* results,
+                         std::index_sequence<I...>) {
+    // Use an initializer list to set the results in order.
+    int unused[] = {0, (SetNativeResult(std::move(std::get<I>(values)),
+                                        &results[I]),
+                        0)...};
+    (void)unused;
+  }
+};
+
+template <typename T>
+struct NativeReturnHelper<Expected<T>> {
+  static constexpr int kNumResults = NativeReturnHelper<T>::kNumResults;
+
+  template <typename F>
+  static void Invoke(F&& f, RCReference<AsyncValue>* results) {
+    Expected<T> value = f();
+    if (!value) {
+      auto error = MakeErrorAsyncValueRef(StrCat(value.takeError()));
+      for (int i = 0; i != kNumResults; ++i) results[i] = error.CopyRef();
+      return;
+    }
+    NativeReturnHelper<T>::Invoke([&]() -> T { return std::move(*value); },
+                                  results);
+  }
+};
+
+template <typename T>
+struct IsNativeArgument : std::true_type {};
+template <>
+struct IsNativeArgument<HostContext*> : std::false_type {};
+
+template <typename... Args>
+struct NumNativeArguments;
+template <>
+struct NumNativeArguments<> : std::integral_constant<int, 0> {};
+template <typename Head, typename... Tail>
+struct NumNativeArguments<Head, Tail...>
+    : std::integral_constant<int, IsNativeArgument<std::decay_t<Head>>::value +
+                                      NumNativeArguments<Tail...>::value> {};
+
+}  // namespace internal
+
+// This class is an implementation detail of TFRT_NATIVE_FUNCTION.
+template <typename F, F f>
+struct TfrtNativeFunctionImpl;
+
+template <typename Return, typename... Args, Return (*impl_fn)(Args...)>
+struct TfrtNativeFunctionImpl<Return (*)(Args...), impl_fn> {
+  // This is the main entry point that gets registered as a NativeCallable.
+  static void Invoke(AsyncValue* const* arguments, int num_arguments,
+                     RCReference<AsyncValue>* results, int num_results,
+                     HostContext* host) {
+    assert(num_arguments == internal::NumNativeArguments<Args...>::value &&
+           "Incorrect number of arguments passed to native function");
+    assert(num_results == internal::NativeReturnHelper<Return>::kNumResults &&
+           "Incorrect number of results passed to native function");
+    (void)num_arguments;
+    (void)num_results;
+    CallHelper<Args..., TypeTag<int>>::template Invoke<0>(arguments, results,
+                                                          host);
+  }
+
+ private:
+  template <typename... RemainingArgs>
+  struct CallHelper;
+
+  // Passes the host to a `HostContext*` parameter.
+  template <typename... Tail>
+  struct CallHelper<HostContext*, Tail...> {
+    template <int arg_idx, typename... PreviousArgs>
+    static void Invoke(AsyncValue* const* arguments,
+                       RCReference<AsyncValue>* results, HostContext* host,
+                       PreviousArgs&&... pargs) {
+      CallHelper<Tail...>::template Invoke<arg_idx>(
+          arguments, results, host, std::forward<PreviousArgs>(pargs)...,
+          host);
+    }
+  };
+
+  // Unpacks the next argument.
+  template <typename Head, typename... Tail>
+  struct CallHelper<Head, Tail...> {
+    template <int arg_idx, typename... PreviousArgs>
+    static void Invoke(AsyncValue* const* arguments,
+                       RCReference<AsyncValue>* results, HostContext* host,
+                       PreviousArgs&&... pargs) {
+      assert(arguments[arg_idx]->IsAvailable());
+      CallHelper<Tail...>::template Invoke<arg_idx + 1>(
+          arguments, results, host, std::forward<PreviousArgs>(pargs)...,
+          arguments[arg_idx]->template get<std::decay_t<Head>>());
+    }
+  };
+
+  // TypeTag<T> is a dummy template parameter to work around the restriction
+  // of GCC that fully specialized templates are not allowed in a template class
+  // scope.
+  template <typename T>
+  struct CallHelper<TypeTag<T>> {
+    template <int arg_idx, typename... PreviousArgs>
+    static void Invoke(AsyncValue* const* arguments,
+                       RCReference<AsyncValue>* results, HostContext* host,
+                       PreviousArgs&&... pargs) {
+      internal::NativeReturnHelper<Return>::Invoke(
+          [&]() -> Return {
+            return impl_fn(std::forward<PreviousArgs>(pargs)...);
+          },
+          results);
+    }
+  };
+};
+
 }  // namespace tfrt
 
 #endif  // TFRT_HOST_CONTEXT_NATIVE_FUNCTION_H_
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// NUMA Topology
+//
+// This file declares the NUMA topology of the host, and the work queue and
+// allocator that keep threads and memory on the same NUMA node. A HostContext
+// runs in NUMA mode when it is created with both, e.g.:
+//
+//   HostContext host(diag_handler,
+//                    CreateNumaAllocator(CreateSlabAllocator),
+//                    CreateNumaWorkQueue(threads_per_node,
+//                                        blocking_threads_per_node));
+//
+// The same configuration is selected in the BEF executor with
+// --work_queue_type=numa and --host_allocator_type=numa_slab.
+
+#ifndef TFRT_HOST_CONTEXT_NUMA_H_
+#define TFRT_HOST_CONTEXT_NUMA_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+class ConcurrentWorkQueue;
+class HostAllocator;
+
+// NumaTopology describes the NUMA nodes of the host that have CPUs.
+class NumaTopology {
+ public:
+  struct Node {
+    // The id of the node in the operating system.
+    int id;
+    // The CPUs of the node.
+    std::vector<int> cpus;
+  };
+
+  // Return the topology of the host. On Linux, it is read from sysfs. On other
+  // systems, or if sysfs is not available, all CPUs are in a single node 0.
+  static const NumaTopology& Get();
+
+  explicit NumaTopology(std::vector<Node> nodes);
+
+  ArrayRef<Node> nodes() const { return nodes_; }
+  int num_nodes() const { return nodes_.size(); }
+
+  // Return the index in nodes() of the node with `id`, or -1 if the topology
+  // does not have this node.
+  int GetNodeIndex(int id) const;
+
+ private:
+  std::vector<Node> nodes_;
+};
+
+// Pin the calling thread to the CPUs of `node`. Pinning is best effort, it is
+// a no-op where thread affinity is not supported.
+void BindCurrentThreadToNumaNode(const NumaTopology::Node& node);
+
+// Return the id of the node the calling thread is bound to by
+// BindCurrentThreadToNumaNode(), or -1 if it is not bound.
+int GetCurrentNumaNode();
+
+// Parse a CPU list in the sysfs format, e.g. "0-3,8-11", and append the CPUs
+// to `cpus`. Return false if the list is malformed.
+bool ParseCpuList(string_view list, std::vector<int>* cpus);
+
+// Return the id of the node that holds the page of `ptr`, or -1 if it is not
+// known, e.g. because the page has not been touched yet.
+int GetNumaNodeOfAddress(const void* ptr);
+
+// Create a work queue with a multi-threaded work queue for each node of
+// `topology`, whose threads are bound to the node. Tasks are placed on the
+// node that holds the memory passed to ConcurrentWorkQueue::AddTaskNear(), or
+// else on the node of the calling worker thread, or else round-robin.
+//
+// The placement decisions are recorded in the
+// /tfrt/host_context/numa_work_queue/placement/{data,caller,round_robin}
+// histograms of the chosen node ids.
+//
+// Requires `num_threads_per_node` > 0 and `num_blocking_threads_per_node` > 0.
+std::unique_ptr<ConcurrentWorkQueue> CreateNumaWorkQueue(
+    int num_threads_per_node, int num_blocking_threads_per_node,
+    const NumaTopology& topology = NumaTopology::Get());
+
+// Create an allocator with an allocator made by `make_allocator` for each node
+// of `topology`. Memory is allocated from the allocator of the node the
+// calling thread is bound to, so that it is first touched on that node.
+// Threads that are not bound use the allocator of the first node.
+//
+// Memory is deallocated with the allocator of the calling thread, so the
+// allocators must accept memory allocated by each other, which is the case
+// for the malloc and slab allocators.
+std::unique_ptr<HostAllocator> CreateNumaAllocator(
+    std::function<std::unique_ptr<HostAllocator>()> make_allocator,
+    const NumaTopology& topology = NumaTopology::Get());
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_NUMA_H_
@@ -39,6 +39,21 @@ class ParallelFor {
   explicit ParallelFor(ExecutionContext exec_ctx)
       : exec_ctx_(std::move(exec_ctx)) {}
 
+  //===--------------------------------------------------------------------===//
+  // Cost is the cost of computing one element of a range. It is modeled after
+  // Eigen::TensorOpCost.
+  //===--------------------------------------------------------------------===//
+  struct Cost {
+    // The number of bytes loaded from and stored to memory.
+    double bytes_loaded = 0;
+    double bytes_stored = 0;
+    // The number of cycles of computation, excluding memory accesses.
+    double compute_cycles = 0;
+
+    // Return the estimated number of cycles to compute one element.
+    double TotalCycles() const;
+  };
+
   //===--------------------------------------------------------------------===//
   // BlockSizes configures how a range is split into parallely executed blocks.
   //===--------------------------------------------------------------------===//
@@ -48,12 +63,21 @@ class ParallelFor {
     static BlockSizes Fixed(size_t n);
     // Splits range into a block sizes not smaller than `min`.
     static BlockSizes Min(size_t min);
+    // Splits a range into blocks sized after the `cost` of each element. Ranges
+    // that are too cheap to amortize the overhead of parallel tasks are not
+    // split. Otherwise the blocks are large enough to amortize the overhead of
+    // one task, and their number is chosen to keep all worker threads busy
+    // until the last block completes.
+    static BlockSizes FromCost(Cost cost);
 
    private:
     friend class ParallelFor;
 
-    explicit BlockSizes(llvm::unique_function<size_t(size_t)> impl)
-        : impl_(std::move(impl)) {}
+    // Block sizes are computed from the number of worker threads and the size
+    // of the range.
+    using Impl = llvm::unique_function<size_t(size_t, size_t)>;
+
+    explicit BlockSizes(Impl impl) : impl_(std::move(impl)) {}
 
     // Returns a parallel block size for a range of `total_size` and the
     // specified number of worker threads.
@@ -63,7 +87,7 @@ class ParallelFor {
     // parallel for parameters to the block size. This is an internal detail,
     // a contract between ParallelFor and BlockSizes. Users of ParallelFor
     // must rely only on public static methods to choose block sizes policy.
-    mutable llvm::unique_function<size_t(size_t)> impl_;
+    mutable Impl impl_;
   };
 
   //===--------------------------------------------------------------------===//
@@ -108,6 +132,9 @@ class ParallelFor {
   //
   // If multiple parallel for operations must be chained together, it is easier
   // to do it with an explicit async chain returned as a result.
+  //
+  // Blocks that start after the request is cancelled are skipped, and the
+  // returned chain is set to the cancellation error.
   AsyncValueRef<Chain> Execute(
       size_t total_size, const BlockSizes& block_sizes,
       llvm::unique_function<void(size_t, size_t)> compute) const;
@@ -18,19 +18,34 @@
 //
 // This file implements a profiling host memory allocator that does a memory
 // leak check and prints allocation statistics when destroyed.
+//
+// With a non-zero `sample_period_bytes`, the allocators also sample
+// allocations, on average one per `sample_period_bytes` allocated bytes, and
+// attribute them to the allocation site of the allocating thread (see
+// AllocationSiteScope). WriteHeapProfile() writes the sampled allocations in
+// the pprof format.
 
+#include <cstddef>
 #include <memory>
 
 #include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
 
 // Decorate an allocator with memory usage profiling.
 std::unique_ptr<HostAllocator> CreateProfiledAllocator(
-    std::unique_ptr<HostAllocator> allocator);
+    std::unique_ptr<HostAllocator> allocator, size_t sample_period_bytes = 0);
 
 // Decorate an allocator with memory leak check.
 std::unique_ptr<HostAllocator> CreateLeakCheckAllocator(
-    std::unique_ptr<HostAllocator> allocator);
+    std::unique_ptr<HostAllocator> allocator, size_t sample_period_bytes = 0);
+
+// Writes the sampled allocations of all alive allocators created with a
+// non-zero `sample_period_bytes` to `os`, as an uncompressed pprof
+// profile.proto. The profile has the allocated objects and bytes of each site
+// since the allocators were created, and the objects and bytes that are still
+// alive, scaled to estimate the unsampled values.
+void WriteHeapProfile(raw_ostream& os);
 
 }  // namespace tfrt
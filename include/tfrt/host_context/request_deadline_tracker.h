@@ -38,6 +38,13 @@ class RequestDeadlineTracker {
         deadline, [req_ctx = std::move(req_ctx)] { req_ctx->Cancel(); });
   }
 
+  // Cancels the request at the deadline set in its RequestOptions, if any.
+  void CancelRequestOnDeadline(RCReference<RequestContext> req_ctx) {
+    auto deadline = req_ctx->deadline();
+    if (deadline == std::chrono::system_clock::time_point::max()) return;
+    CancelRequestOnDeadline(deadline, std::move(req_ctx));
+  }
+
  private:
   TimerQueue* timer_queue_;
 };
@@ -15,15 +15,18 @@
  */
 
 // This file declares ResourceContext - a type-erased container for storing and
-// retrieving resources.
+// retrieving resources - and ResourceSlot, a typed key for the resources that
+// are looked up on every request.
 
 #ifndef TFRT_HOST_CONTEXT_RESOURCE_CONTEXT_H_
 #define TFRT_HOST_CONTEXT_RESOURCE_CONTEXT_H_
 
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <memory>
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm_derived/Support/unique_any.h"
@@ -33,6 +36,9 @@
 
 namespace tfrt {
 
+template <typename T>
+class ResourceSlot;
+
 // ResourceContext is used to store and retrieve resources. This class is
 // thread-safe.
 class ResourceContext {
@@ -112,10 +118,79 @@ class ResourceContext {
     resources_.erase(map_it);
   }
 
+  // Get the resource T in `slot`, or nullptr if it has not been created. This
+  // is a single atomic load. Thread-safe.
+  template <typename T>
+  T* GetResource(const ResourceSlot<T>& slot) const {
+    return static_cast<T*>(
+        slots_[slot.index()].load(std::memory_order_acquire));
+  }
+
+  // Get or create the resource T in `slot`. Only the creation takes the lock,
+  // later calls are a single atomic load. Resources in slots are never
+  // deleted before the ResourceContext.
+  // Thread-safe.
+  template <typename T, typename... Args>
+  T* GetOrCreateResource(const ResourceSlot<T>& slot, Args&&... args)
+      TFRT_EXCLUDES(mu_) {
+    if (T* data = GetResource(slot)) return data;
+
+    tfrt::mutex_lock lock(mu_);
+    std::atomic<void*>& data = slots_[slot.index()];
+    if (void* existing = data.load(std::memory_order_relaxed))
+      return static_cast<T*>(existing);
+    slot_resources_.push_back(std::make_unique<tfrt::UniqueAny>(
+        tfrt::in_place_type<T>, std::forward<Args>(args)...));
+    resource_vector_.push_back(slot_resources_.back().get());
+    T* created = tfrt::any_cast<T>(slot_resources_.back().get());
+    data.store(created, std::memory_order_release);
+    return created;
+  }
+
  private:
+  template <typename T>
+  friend class ResourceSlot;
+
+  // The number of slots of each ResourceContext.
+  static constexpr int kNumSlots = 16;
+
+  // Return the index of a new ResourceSlot. Aborts when all slots are in use.
+  static int AllocateSlot();
+
   tfrt::mutex mu_;
   llvm::StringMap<tfrt::UniqueAny> resources_ TFRT_GUARDED_BY(mu_);
   llvm::SmallVector<tfrt::UniqueAny*, 8> resource_vector_ TFRT_GUARDED_BY(mu_);
+
+  // The resources of the slots, which are written with mu_ held.
+  std::array<std::atomic<void*>, kNumSlots> slots_ = {};
+  llvm::SmallVector<std::unique_ptr<tfrt::UniqueAny>, 2> slot_resources_
+      TFRT_GUARDED_BY(mu_);
+};
+
+// ResourceSlot<T> identifies a resource of type T that is kept in a slot of
+// every ResourceContext instead of the map of named resources, so that it is
+// found without locking. There are few slots, for the resources that kernels
+// look up on every invocation, e.g. caches. A slot is defined once and shared
+// by all its users, e.g.:
+//
+//   const ResourceSlot<Cache>& GetCacheSlot() {
+//     static const ResourceSlot<Cache>* slot = new ResourceSlot<Cache>;
+//     return *slot;
+//   }
+//
+//   Cache* cache = resource_context->GetOrCreateResource(GetCacheSlot());
+template <typename T>
+class ResourceSlot {
+ public:
+  ResourceSlot() : index_(ResourceContext::AllocateSlot()) {}
+
+  ResourceSlot(const ResourceSlot&) = delete;
+  ResourceSlot& operator=(const ResourceSlot&) = delete;
+
+  int index() const { return index_; }
+
+ private:
+  const int index_;
 };
 
 inline ResourceContext::~ResourceContext() {
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Startup Profile
+//
+// This file declares a profile of the phases of process startup, e.g. kernel
+// registration, host context creation, BEF file loading and the first call of
+// each function, which breaks down the cold start time of a process.
+
+#ifndef TFRT_HOST_CONTEXT_STARTUP_PROFILE_H_
+#define TFRT_HOST_CONTEXT_STARTUP_PROFILE_H_
+
+#include <chrono>
+#include <string>
+
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tracing/tracing.h"
+
+namespace tfrt {
+
+// Enables or disables recording of startup phases. The profile is disabled by
+// default, because processes that e.g. open BEF files for every request would
+// record phases without bound.
+void EnableStartupProfile(bool enable);
+bool IsStartupProfileEnabled();
+
+// RAII class that records a startup phase for the duration of the instance,
+// if the startup profile is enabled. Phases can be nested, and are also traced
+// as scopes when tracing is enabled.
+class StartupPhase {
+ public:
+  explicit StartupPhase(string_view name);
+  ~StartupPhase();
+
+  StartupPhase(const StartupPhase&) = delete;
+  StartupPhase& operator=(const StartupPhase&) = delete;
+
+ private:
+  // Empty if the profile was disabled when the phase started.
+  std::string name_;
+  int depth_ = 0;
+  std::chrono::steady_clock::time_point start_;
+  tracing::TracingScope tracing_scope_;
+};
+
+// Prints the recorded phases in the order they started, indented by their
+// nesting, with their wall time and their start time relative to the first
+// phase.
+void PrintStartupProfile(raw_ostream& os);
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_STARTUP_PROFILE_H_
@@ -27,6 +27,7 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/attribute_utils.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_context.h"
@@ -39,10 +40,11 @@ namespace tfrt {
 
 // SyncKernelFrame captures the states associated with a kernel invocation,
 // including the input arguments, attributes, result values, and the execution
-// context. SyncKernelFrame is constructed by the kernel caller (currently only
-// BEFInterpreter) using the SyncKernelFrameBuilder subclass. The kernel
-// implementation is passed a pointer to a SyncKernelFrame object for them to
-// access the inputs and attributes, and return result values.
+// context. SyncKernelFrame is constructed by the kernel caller (BEFInterpreter,
+// or BEFExecutor for sync kernels in async functions) using the
+// SyncKernelFrameBuilder subclass. The kernel implementation is passed a
+// pointer to a SyncKernelFrame object for them to access the inputs and
+// attributes, and return result values.
 class SyncKernelFrame {
  public:
   const ExecutionContext& GetExecutionContext() const { return exec_ctx_; }
@@ -107,19 +109,31 @@ class SyncKernelFrame {
   }
 
   // Get the number of results.
-  int GetNumResults() const { return result_indices_.size(); }
+  int GetNumResults() const {
+    return async_results_.empty() ? result_indices_.size()
+                                  : async_results_.size();
+  }
 
   // Emplace construct the result at given index.
   template <typename T, typename... Args>
   void EmplaceResultAt(int index, Args&&... args) {
     assert(index < GetNumResults() && "Invalid result index");
+    if (!async_results_.empty()) {
+      assert(!async_results_[index] && "Result value is non-empty.");
+      async_results_[index] =
+          MakeAvailableAsyncValueRef<T>(std::forward<Args>(args)...)
+              .ReleaseRCRef();
+      return;
+    }
     Value* result = GetResultAt(index);
     assert(!result->HasValue() && "Result value is non-empty.");
     result->emplace<T>(std::forward<Args>(args)...);
   }
 
-  // Get result at the given index.
+  // Get result at the given index. Results of kernels that run in async
+  // functions are not Values, so they can only be set with EmplaceResultAt().
   Value* GetResultAt(int index) const {
+    assert(async_results_.empty() && "Results are AsyncValues");
     assert(index < result_indices_.size());
     return registers_[result_indices_[index]];
   }
@@ -144,6 +158,8 @@ class SyncKernelFrame {
   ArrayRef<const void*> attributes_;
   // These are indices into `registers_`.
   ArrayRef<uint32_t> result_indices_;
+  // If not empty, results are emplaced here instead of in `registers_`.
+  MutableArrayRef<RCReference<AsyncValue>> async_results_;
 
   const ArrayRef<Value*> registers_;
 
@@ -179,6 +195,11 @@ class SyncKernelFrameBuilder : public SyncKernelFrame {
   void SetResults(ArrayRef<uint32_t> result_indices) {
     result_indices_ = result_indices;
   }
+  // Emplaces the results into available AsyncValues in `results`, which must
+  // be null, instead of into Values.
+  void SetAsyncResults(MutableArrayRef<RCReference<AsyncValue>> results) {
+    async_results_ = results;
+  }
 };
 
 // Implementation details
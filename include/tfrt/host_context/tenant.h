@@ -0,0 +1,76 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tenants
+//
+// This file declares the work queue and allocator of a HostContext that
+// shares its threads and memory with other HostContexts, e.g. to serve several
+// models in one process. Each tenant is a HostContext of its own, so its
+// kernel registry, shared contexts and resources stay isolated, but all of
+// them run on one thread pool and allocate from one allocator:
+//
+//   std::shared_ptr<ConcurrentWorkQueue> work_queue =
+//       CreateMultiThreadedWorkQueue(num_threads, num_blocking_threads);
+//   std::shared_ptr<HostAllocator> allocator = CreateSlabAllocator();
+//   HostContext model(diag_handler,
+//                     CreateTenantAllocator(allocator, quota_bytes),
+//                     CreateTenantWorkQueue(work_queue, {"model", 4}));
+//
+// The shared work queue and allocator are destroyed with the last tenant.
+
+#ifndef TFRT_HOST_CONTEXT_TENANT_H_
+#define TFRT_HOST_CONTEXT_TENANT_H_
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+
+namespace tfrt {
+
+class ConcurrentWorkQueue;
+class HostAllocator;
+
+struct TenantWorkQueueOptions {
+  // Name of the tenant, for ConcurrentWorkQueue::name().
+  std::string name;
+  // Maximum number of non-blocking tasks of the tenant that are in the shared
+  // work queue at a time, which is the share of the threads the tenant can
+  // take when all tenants are busy. Further tasks wait in a queue of the
+  // tenant until an earlier task finishes. Zero means no limit.
+  int max_parallelism = 0;
+};
+
+// Create a work queue that adds its tasks to `work_queue`, which may be shared
+// with other tenants. Blocking tasks are not limited. Quiesce() only waits
+// for the tasks of this tenant, which requires that `work_queue` runs its
+// tasks on threads of its own, like the multi-threaded work queues do.
+std::unique_ptr<ConcurrentWorkQueue> CreateTenantWorkQueue(
+    std::shared_ptr<ConcurrentWorkQueue> work_queue,
+    TenantWorkQueueOptions options);
+
+// Create an allocator that allocates from `allocator`, which may be shared
+// with other tenants, and fails (returns nullptr) allocations that would take
+// the bytes allocated through it above `quota_bytes`. Allocations below 4 kB
+// are counted but never fail, because the runtime does not expect the
+// allocation of its own small objects to fail.
+std::unique_ptr<HostAllocator> CreateTenantAllocator(
+    std::shared_ptr<HostAllocator> allocator,
+    size_t quota_bytes = std::numeric_limits<size_t>::max());
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_TENANT_H_
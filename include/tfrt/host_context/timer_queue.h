@@ -16,16 +16,22 @@
 
 // Timer Queue
 //
-// This file declares TimerQueue, a priority queue to keep track of pending
-// timers. The queue is keyed by timer deadline (the sooner it expires, the
-// higher the priority). On timer expiration, it calls the associated callback.
+// This file declares TimerQueue, which keeps track of pending timers and calls
+// the associated callback when a timer expires.
+//
+// Timers are kept in a hierarchical timing wheel with a resolution of one
+// tick (kTickDuration). Scheduling and cancelling a timer take constant time,
+// and cancelled timers are removed from the wheel right away. The timers that
+// expire in the same tick run in one batch.
 
 #ifndef TFRT_HOST_CONTEXT_TIMER_QUEUE_H_
 #define TFRT_HOST_CONTEXT_TIMER_QUEUE_H_
 
+#include <atomic>
 #include <chrono>
-#include <queue>
+#include <cstdint>
 #include <thread>
+#include <vector>
 
 #include "llvm/ADT/FunctionExtras.h"
 #include "tfrt/support/mutex.h"
@@ -45,6 +51,10 @@ class TimerQueue {
  public:
   using TimerHandle = RCReference<TimerEntry>;
 
+  // The resolution of the timers. A timer never expires before its deadline,
+  // and expires at most one tick after it, unless the timer thread is late.
+  static constexpr TimeDuration kTickDuration = std::chrono::milliseconds(1);
+
   // On creation, starts the timer thread for TimerQueue monitoring.
   TimerQueue();
   // On destruction, cancel every timer in the queue.
@@ -59,6 +69,15 @@ class TimerQueue {
   void CancelTimer(const TimerHandle& timer_handle);
 
  private:
+  // Each level of the wheel has kNumSlots slots. A slot at level L holds the
+  // timers that expire in a range of kNumSlots^L ticks. Timers of levels above
+  // 0 are moved to a lower level when their range starts.
+  static constexpr int kNumLevels = 4;
+  static constexpr int kBitsPerLevel = 8;
+  static constexpr int kNumSlots = 1 << kBitsPerLevel;
+  static constexpr int kNumBitmapWords = kNumSlots / 64;
+  static constexpr uint64_t kNoTick = UINT64_MAX;
+
   // A reference counted timer, which has a deadline and a callback function.
   class TimerEntry : public ReferenceCounted<TimerEntry> {
    public:
@@ -71,34 +90,66 @@ class TimerQueue {
       return MakeRef<TimerEntry>(deadline, std::move(timer_callback));
     }
 
-    struct TimerEntryCompare {
-      bool operator()(const RCReference<TimerEntry>& a,
-                      const RCReference<TimerEntry>& b) const {
-        return a->deadline_ > b->deadline_;
-      }
-    };
-
    private:
     friend class TimerQueue;
     TimePoint deadline_;
     TimerCallback timer_callback_;
     std::atomic<bool> cancelled_{false};
+
+    // The state below is guarded by TimerQueue::mu_. A timer in the wheel is
+    // in the list of slot `slot_` of level `level_`, and holds a reference
+    // that is owned by the wheel. `level_` is -1 otherwise.
+    uint64_t deadline_tick_ = 0;
+    int level_ = -1;
+    int slot_ = 0;
+    TimerEntry* prev_ = nullptr;
+    TimerEntry* next_ = nullptr;
   };
+
   // Timer thread. If a timeout goes off, it calls the callback.
   void TimerThreadRun();
 
-  // Obtain the top timer (timer with the closest deadline) from the queue.
-  // Returns NULL if no active (not cancelled) timer found.
-  TimerEntry* getTopTimer();
+  // Conversions between time points and ticks since start_time_.
+  uint64_t GetDeadlineTick(TimePoint deadline) const;
+  uint64_t GetCurrentTick() const;
+  TimePoint GetTickTime(uint64_t tick) const;
+
+  // Add `entry` to the slot of its deadline, relative to `tick`. Requires
+  // entry->deadline_tick_ >= tick.
+  void Link(TimerEntry* entry, uint64_t tick) TFRT_REQUIRES(mu_);
+  // Remove `entry` from its slot. The caller takes over the reference of the
+  // wheel.
+  void Unlink(TimerEntry* entry) TFRT_REQUIRES(mu_);
+
+  // Return the next tick after current_tick_ that expires timers or moves
+  // timers to a lower level, or kNoTick if the wheel is empty.
+  uint64_t GetNextEventTick() const TFRT_REQUIRES(mu_);
+
+  // Advance current_tick_ to `tick`, and move the timers that expire in this
+  // tick to expired_timers_.
+  void AdvanceTo(uint64_t tick) TFRT_REQUIRES(mu_);
+
+  const TimePoint start_time_;
 
   mutable mutex mu_;
   condition_variable cv_;
   std::thread timer_thread_;
   std::atomic<bool> stop_{false};
-  std::priority_queue<RCReference<TimerEntry>,
-                      std::vector<RCReference<TimerEntry>>,
-                      TimerEntry::TimerEntryCompare>
-      timers_ TFRT_GUARDED_BY(mu_);
+
+  // All timers that expire at or before current_tick_ have been moved out of
+  // the wheel.
+  uint64_t current_tick_ TFRT_GUARDED_BY(mu_) = 0;
+  // The tick the timer thread waits for, kNoTick if it waits for a timer to be
+  // scheduled, or 0 while it is awake.
+  uint64_t wakeup_tick_ TFRT_GUARDED_BY(mu_) = 0;
+
+  TimerEntry* slots_[kNumLevels][kNumSlots] TFRT_GUARDED_BY(mu_) = {};
+  // The bitmap of the non-empty slots of each level.
+  uint64_t occupied_[kNumLevels][kNumBitmapWords] TFRT_GUARDED_BY(mu_) = {};
+
+  // The batch of expired timers that the timer thread runs without holding
+  // mu_. Only accessed by the timer thread.
+  std::vector<TimerEntry*> expired_timers_;
 };
 
 }  // namespace tfrt
@@ -20,12 +20,27 @@
 #ifndef TFRT_IO_BUFFERED_INPUT_STREAM_H_
 #define TFRT_IO_BUFFERED_INPUT_STREAM_H_
 
+#include <memory>
+
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/io/input_stream.h"
 
 namespace tfrt {
 namespace io {
 
+// The options of a BufferedInputStream that reads ahead.
+struct ReadaheadOptions {
+  // The number of blocks that are buffered. The next blocks are read into
+  // num_buffers - 1 buffers while the consumer reads from one.
+  int num_buffers = 2;
+  // The size of the blocks read from the input stream starts at
+  // min_block_size, and is doubled up to max_block_size as long as that
+  // improves the observed read throughput.
+  size_t min_block_size = 256 * 1024;
+  size_t max_block_size = 8 * 1024 * 1024;
+};
+
 class BufferedInputStream : public InputStream {
  public:
   explicit BufferedInputStream(std::unique_ptr<InputStream> input_stream,
@@ -37,9 +52,15 @@ class BufferedInputStream : public InputStream {
     buffer_ = allocator_->Allocate<char>(buffer_size_);
   }
 
-  ~BufferedInputStream() override {
-    allocator_->Deallocate(buffer_, buffer_size_);
-  }
+  // Reads the blocks of `input_stream` ahead on the blocking work queue of
+  // `exec_ctx`, so that reads rarely wait for the input stream. A block is
+  // read on the calling thread instead if reading it ahead has not started
+  // when it is needed.
+  BufferedInputStream(std::unique_ptr<InputStream> input_stream,
+                      const ReadaheadOptions& options, HostAllocator* allocator,
+                      const ExecutionContext& exec_ctx);
+
+  ~BufferedInputStream() override;
 
   // This class is not copyable or movable.
   BufferedInputStream(const BufferedInputStream&) = delete;
@@ -50,6 +71,11 @@ class BufferedInputStream : public InputStream {
   llvm::Expected<size_t> Tell() override;
 
  private:
+  // The blocks read ahead, shared with the tasks that read them.
+  class Readahead;
+
+  llvm::Expected<size_t> ReadFromBlocks(char* buf, size_t max_count);
+
   std::unique_ptr<InputStream> input_stream_;
   HostAllocator* allocator_;
   // The pointer to the buffer.
@@ -64,6 +90,14 @@ class BufferedInputStream : public InputStream {
   llvm::Expected<size_t> buffer_limit_ = 0;
   // Current position in this stream.
   size_t stream_pos_ = 0;
+
+  // Set if the stream reads ahead, in which case the members above other than
+  // stream_pos_ are not used.
+  std::shared_ptr<Readahead> readahead_;
+  // The index of the block that is being read, or -1.
+  int block_index_ = -1;
+  // The position of the next byte in that block to be read.
+  size_t block_pos_ = 0;
 };
 
 }  // namespace io
@@ -36,8 +36,17 @@ class FileInputStream : public InputStream {
 
   llvm::Expected<size_t> Read(char* buf, size_t max_count) override;
 
+  // Like Read(), but returns without waiting for the bytes, see
+  // RandomAccessFile::ReadAsync(). The stream advances by `max_count` bytes
+  // right away, since a read returns less only at the end of the file. This
+  // allows to issue the next reads before this one completes.
+  AsyncValueRef<size_t> ReadAsync(char* buf, size_t max_count,
+                                  const ExecutionContext& exec_ctx);
+
   llvm::Expected<size_t> Tell() override;
 
+  const RandomAccessFile& file() const { return *file_; }
+
  private:
   std::unique_ptr<RandomAccessFile> file_;
   size_t offset_ = 0;
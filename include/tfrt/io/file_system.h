@@ -19,7 +19,12 @@
 #ifndef TFRT_IO_FILE_SYSTEM_H_
 #define TFRT_IO_FILE_SYSTEM_H_
 
+#include <string>
+#include <vector>
+
 #include "llvm/ADT/StringMap.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/mutex.h"
 #include "tfrt/support/thread_annotations.h"
@@ -32,6 +37,24 @@ namespace io {
 // registered for the same sceheme.
 enum class FileSystemPriority : int { kDefault = 1, kHigh = 2 };
 
+// The options to open a random access file with. They describe how the file is
+// going to be read, and file systems should honor them where the underlying
+// storage allows it.
+struct RandomAccessFileOptions {
+  enum class AccessPattern { kNormal, kSequential, kRandom };
+
+  // Hints the expected order of reads, e.g. to tune the read ahead of the
+  // operating system.
+  AccessPattern access_pattern = AccessPattern::kNormal;
+  // Bypasses the page cache, so that reading a large file once does not evict
+  // the pages of other files. The file system may impose alignment
+  // requirements on the reads, and may copy reads that do not meet them.
+  bool direct_io = false;
+  // Drops the bytes read from the page cache after each read. This is a
+  // weaker alternative to `direct_io` without alignment requirements.
+  bool drop_cache_after_read = false;
+};
+
 // An interface that declares operations to read bytes from a random access
 // file.
 class RandomAccessFile {
@@ -51,6 +74,19 @@ class RandomAccessFile {
   // On error, llvm::Error is returned.
   virtual llvm::Expected<size_t> Read(char* buf, size_t max_count,
                                       size_t offset) const = 0;
+
+  // Like Read(), but returns without waiting for the bytes. The file and `buf`
+  // must be kept alive until the result is available.
+  //
+  // The default implementation calls Read() on the blocking work queue, or on
+  // the calling thread if the queue is full.
+  virtual AsyncValueRef<size_t> ReadAsync(
+      char* buf, size_t max_count, size_t offset,
+      const ExecutionContext& exec_ctx) const;
+
+  // Returns whether ReadAsync() keeps reads in flight without blocking a
+  // thread for each of them.
+  virtual bool SupportsNonBlockingRead() const { return false; }
 };
 
 // An interface that declares operations to manage files in a file system.
@@ -60,13 +96,31 @@ class FileSystem {
 
   virtual ~FileSystem() {}
 
-  // Creates a read-only random access file at the given `path`.
+  // Creates a read-only random access file at the given `path`, to be read as
+  // described by `options`.
   //
   // On success, stores a pointer to the new file in `file` and returns
   // llvm::Error::success(). Otherwise, stores NULL in `file` and returns the
   // error.
   virtual llvm::Error NewRandomAccessFile(
-      const std::string& path, std::unique_ptr<RandomAccessFile>* file) = 0;
+      const std::string& path, const RandomAccessFileOptions& options,
+      std::unique_ptr<RandomAccessFile>* file) = 0;
+
+  // Creates a read-only random access file with the default options.
+  llvm::Error NewRandomAccessFile(const std::string& path,
+                                  std::unique_ptr<RandomAccessFile>* file) {
+    return NewRandomAccessFile(path, RandomAccessFileOptions(), file);
+  }
+
+  // Appends the paths that match the glob `pattern` to `results`, in
+  // lexicographical order. A pattern without wildcards matches the path itself
+  // if it exists.
+  //
+  // Returns an error if the file system does not support matching paths.
+  virtual llvm::Error GetMatchingPaths(const std::string& pattern,
+                                       std::vector<std::string>* results) {
+    return MakeStringError("file system does not support matching paths");
+  }
 
   // Returns the priority of this file system. The file system with the highest
   // priority will be used if multiple file systems have been registered for the
@@ -105,6 +159,10 @@ class FileSystemRegistry {
   // FileSystemRegistry::Register(...).
   FileSystem* Lookup(const std::string& scheme);
 
+  // Returns the file system registered for the scheme of `path`, the part
+  // before "://", or for the empty scheme if `path` has none.
+  FileSystem* LookupForPath(const std::string& path);
+
  private:
   mutex mu_;
   llvm::StringMap<std::unique_ptr<FileSystem>> file_systems_
@@ -19,14 +19,22 @@
 #ifndef TFRT_METRICS_METRICS_H_
 #define TFRT_METRICS_METRICS_H_
 
+#include <cstdint>
 #include <string>
 
+#include "counter.h"
 #include "gauge.h"
 #include "histogram.h"
 
 namespace tfrt {
 namespace metrics {
 
+//===----------------------------------------------------------------------===//
+// Methods to create Counter metrics
+//===----------------------------------------------------------------------===//
+
+Counter* NewCounter(std::string name);
+
 //===----------------------------------------------------------------------===//
 // Methods to create Gauge metrics
 //===----------------------------------------------------------------------===//
@@ -34,6 +42,9 @@ namespace metrics {
 template <typename T>
 Gauge<T>* NewGauge(std::string name);
 
+template <>
+Gauge<int64_t>* NewGauge(std::string name);
+
 template <>
 Gauge<std::string>* NewGauge(std::string name);
 
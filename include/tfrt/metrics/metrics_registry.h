@@ -19,8 +19,10 @@
 #ifndef TFRT_METRICS_METRICS_REGISTRY_H_
 #define TFRT_METRICS_METRICS_REGISTRY_H_
 
+#include <cstdint>
 #include <string>
 
+#include "counter.h"
 #include "gauge.h"
 #include "histogram.h"
 
@@ -31,6 +33,11 @@ class MetricsRegistry {
  public:
   virtual ~MetricsRegistry() {}
 
+  // Registries which don't support counters or integer gauges may return
+  // nullptr, in which case the metric is discarded.
+  virtual Counter* NewCounter(std::string name) { return nullptr; }
+  virtual Gauge<int64_t>* NewIntGauge(std::string name) { return nullptr; }
+
   virtual Gauge<std::string>* NewStringGauge(std::string name) = 0;
 
   virtual Histogram* NewHistogram(std::string name, const Buckets& buckets) = 0;
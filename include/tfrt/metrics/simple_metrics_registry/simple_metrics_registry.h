@@ -0,0 +1,68 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Simple Metrics Registry
+//
+// This file declares a metrics registry which keeps the metrics in memory and
+// exports them in the Prometheus text exposition format.
+
+#ifndef TFRT_METRICS_SIMPLE_METRICS_REGISTRY_H_
+#define TFRT_METRICS_SIMPLE_METRICS_REGISTRY_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "tfrt/metrics/metrics_registry.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace metrics {
+
+// Counters and histograms are sharded by thread and updated with relaxed
+// atomics, so that recording doesn't contend on locks or cache lines. Metrics
+// created with the same name and type are shared. Metrics live as long as the
+// registry.
+class SimpleMetricsRegistry : public MetricsRegistry {
+ public:
+  SimpleMetricsRegistry();
+  ~SimpleMetricsRegistry() override;
+
+  Counter* NewCounter(std::string name) override;
+  Gauge<int64_t>* NewIntGauge(std::string name) override;
+  Gauge<std::string>* NewStringGauge(std::string name) override;
+  // If a histogram with `name` exists already, it keeps its buckets.
+  Histogram* NewHistogram(std::string name, const Buckets& buckets) override;
+
+  // Writes the current values of the metrics in the Prometheus text exposition
+  // format, e.g. to serve them from a scraping endpoint. Metric names are
+  // sanitized, e.g. '/tfrt/foo' becomes 'tfrt_foo'. String gauges are exported
+  // as a gauge of value 1 with the string in the 'value' label.
+  void ExportPrometheusText(raw_ostream& os);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+// Returns the process-wide instance, which the 'simple_metrics_registry'
+// target's static registration registers as the global metrics registry.
+SimpleMetricsRegistry* GetGlobalSimpleMetricsRegistry();
+
+}  // namespace metrics
+}  // namespace tfrt
+
+#endif  // TFRT_METRICS_SIMPLE_METRICS_REGISTRY_H_
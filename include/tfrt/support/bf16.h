@@ -19,20 +19,43 @@
 #ifndef TFRT_SUPPORT_BF16_H_
 #define TFRT_SUPPORT_BF16_H_
 
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
 #include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
 
 // This is just a placeholder type telling core TFRT that bf16 has the same
 // size as uint16_t. The client should get its real C++ type via
-// tfrt::TypeForDTypeKind<DType::Kind::BF16>::Type.
-// TODO(tfrt-devs): Port TensorFlow's bfloat16 implementation to TFRT.
+// tfrt::TypeForDTypeKind<DType::Kind::BF16>::Type. The CPU backend computes
+// with Eigen::bfloat16 instead (see EigenTypeForDTypeKind), and converts whole
+// buffers to and from float with tfrt::cpu::simd::ConvertToFloat().
 struct bf16 {
   bf16() : value(0) {}
   explicit bf16(uint16_t v) : value(v) {}
   uint16_t value;
 };
 
+// Conversions between bf16 and float. Conversions to bf16 round to nearest
+// even.
+inline float Bf16ToFloat(bf16 value) {
+  const uint32_t bits = static_cast<uint32_t>(value.value) << 16;
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+inline bf16 FloatToBf16(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  // Keep NaNs quiet, rounding could turn them into infinities.
+  if (std::isnan(value)) return bf16(static_cast<uint16_t>(bits >> 16 | 0x40));
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return bf16(static_cast<uint16_t>(bits >> 16));
+}
+
 }  // namespace tfrt
 
 #endif  // TFRT_SUPPORT_BF16_H_
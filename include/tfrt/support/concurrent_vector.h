@@ -14,16 +14,20 @@
  * limitations under the License.
  */
 
-// A concurent sequential container optimized for read access.
+// Concurent sequential containers optimized for read access.
 
 #ifndef TFRT_SUPPORT_CONCURRENT_VECTOR_H_
 #define TFRT_SUPPORT_CONCURRENT_VECTOR_H_
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <memory>
+#include <new>
+#include <type_traits>
 #include <vector>
 
+#include "llvm/Support/MathExtras.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/mutex.h"
 #include "thread_annotations.h"
@@ -168,5 +172,159 @@ class ConcurrentVector {
   std::vector<std::vector<T>> all_allocated_elements_ TFRT_GUARDED_BY(mutex_);
 };
 
+// A concurrent sequential container with the same interface as
+// ConcurrentVector (except ToArrayRef), which stores the elements in segments
+// that never move. Segment k holds the elements [c * (2^k - 1), c * (2^(k+1) -
+// 1)) for the initial capacity c rounded up to a power of two, so that growing
+// the vector allocates a segment as large as all previous segments together,
+// but never copies elements or keeps retired copies around.
+//
+// Neither writers nor readers take a lock or wait for each other. Writers
+// claim an index with an atomic increment and construct the element in place.
+// size() is the number of leading constructed elements: the writer of an
+// element advances it if all previous elements are constructed, otherwise it
+// marks the element as ready for the writer that completes the previous ones.
+//
+// Requirements:
+//
+// Type T needs to be constructible from the arguments of emplace_back().
+template <typename T>
+class SegmentedConcurrentVector {
+ public:
+  explicit SegmentedConcurrentVector(size_t initial_capacity)
+      : log2_first_segment_size_(
+            llvm::Log2_64_Ceil(std::max<size_t>(initial_capacity, 1))),
+        first_segment_(new Slot[FirstSegmentSize()]) {
+    segments_[0].store(first_segment_, std::memory_order_relaxed);
+    for (int k = 1; k < kMaxSegments; ++k) {
+      segments_[k].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~SegmentedConcurrentVector() {
+    size_t size = size_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < size; ++i) (*this)[i].~T();
+    for (auto& segment : segments_) {
+      delete[] segment.load(std::memory_order_relaxed);
+    }
+  }
+
+  SegmentedConcurrentVector(const SegmentedConcurrentVector&) = delete;
+  SegmentedConcurrentVector& operator=(const SegmentedConcurrentVector&) =
+      delete;
+
+  T& operator[](size_t index) {
+    assert(index < size());
+    return GetSlot(index).value();
+  }
+
+  const T& operator[](size_t index) const {
+    return const_cast<SegmentedConcurrentVector*>(this)->operator[](index);
+  }
+
+  // Return the number of elements currently valid in this vector.  The vector
+  // only grows, so this is conservative w.r.t. the execution of the current
+  // thread.
+  size_t size() const { return size_.load(std::memory_order_acquire); }
+
+  // Insert a new element at the end. Allocates a new segment, with as much
+  // capacity as all the previous segments, if the index is past the last
+  // segment.
+  //
+  // Returns the index of the newly inserted item.
+  template <typename... Args>
+  size_t emplace_back(Args&&... args) {
+    size_t index = reserved_.fetch_add(1, std::memory_order_relaxed);
+    int k = SegmentIndex(index);
+    Slot* segment = segments_[k].load(std::memory_order_acquire);
+    if (!segment) segment = AllocateSegment(k);
+    Slot& slot = segment[SegmentOffset(index, k)];
+    new (&slot.storage) T(std::forward<Args>(args)...);
+
+    // Without concurrent writers, all previous elements are ready and this
+    // writer advances the size. Otherwise the element is marked as ready and
+    // the size is advanced over the ready elements. The sequentially
+    // consistent segments, ready flags and size guarantee that either this
+    // writer sees the size reach its index, or the writer that advances the
+    // size to its index sees it ready.
+    size_t size = index;
+    if (size_.compare_exchange_strong(size, index + 1)) {
+      ++size;
+    } else {
+      slot.ready.store(true);
+      size = size_.load();
+    }
+    while (size < reserved_.load(std::memory_order_relaxed) && IsReady(size)) {
+      // On failure, `size` is updated to the size advanced by another writer.
+      if (size_.compare_exchange_weak(size, size + 1)) ++size;
+    }
+    return index;
+  }
+
+ private:
+  struct Slot {
+    T& value() { return *reinterpret_cast<T*>(&storage); }
+
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    std::atomic<bool> ready{false};
+  };
+
+  static constexpr int kMaxSegments = 64;
+
+  size_t FirstSegmentSize() const {
+    return size_t{1} << log2_first_segment_size_;
+  }
+
+  // Returns the capacity of segment k, which is also the index of its first
+  // element plus FirstSegmentSize().
+  size_t SegmentSize(int k) const { return FirstSegmentSize() << k; }
+
+  int SegmentIndex(size_t index) const {
+    return llvm::Log2_64(index + FirstSegmentSize()) - log2_first_segment_size_;
+  }
+
+  size_t SegmentOffset(size_t index, int k) const {
+    return index + FirstSegmentSize() - SegmentSize(k);
+  }
+
+  Slot& GetSlot(size_t index) const {
+    if (index < FirstSegmentSize()) return first_segment_[index];
+    int k = SegmentIndex(index);
+    Slot* segment = segments_[k].load(std::memory_order_acquire);
+    return segment[SegmentOffset(index, k)];
+  }
+
+  // Returns true if the element at `index` is constructed. Its segment may not
+  // be allocated yet.
+  bool IsReady(size_t index) const {
+    int k = SegmentIndex(index);
+    Slot* segment = segments_[k].load();
+    return segment && segment[SegmentOffset(index, k)].ready.load();
+  }
+
+  // Writers of the first elements of a segment race to allocate it.
+  Slot* AllocateSegment(int k) {
+    Slot* allocated = new Slot[SegmentSize(k)];
+    Slot* segment = nullptr;
+    if (segments_[k].compare_exchange_strong(segment, allocated)) {
+      return allocated;
+    }
+    delete[] allocated;
+    return segment;
+  }
+
+  const int log2_first_segment_size_;
+  // The first segment is allocated upfront, which saves loading it from
+  // segments_ in the common case that it holds all elements.
+  Slot* const first_segment_;
+
+  // The number of indices claimed by emplace_back(), and the number of
+  // leading elements that are constructed and visible to readers.
+  std::atomic<size_t> reserved_{0};
+  std::atomic<size_t> size_{0};
+
+  mutable std::atomic<Slot*> segments_[kMaxSegments];
+};
+
 }  // namespace tfrt
 #endif  // TFRT_SUPPORT_CONCURRENT_VECTOR_H_
@@ -64,6 +64,8 @@ template <typename SubClass>
 class ReferenceCounted;
 template <typename T>
 class RCReference;
+template <typename T>
+class SegmentedConcurrentVector;
 
 template <typename T>
 using Expected = llvm::Expected<T>;
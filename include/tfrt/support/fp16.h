@@ -19,6 +19,9 @@
 #ifndef TFRT_SUPPORT_FP16_H_
 #define TFRT_SUPPORT_FP16_H_
 
+#include <cstdint>
+#include <cstring>
+
 #include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
@@ -31,6 +34,60 @@ struct fp16 {
   explicit fp16(uint16_t v) : value(v) {}
   uint16_t value;
 };
+
+// Conversions between fp16 and float. Conversions to fp16 round to nearest
+// even.
+inline float Fp16ToFloat(fp16 value) {
+  constexpr uint32_t kExponentMask = 0x7c00 << 13;
+  uint32_t bits = static_cast<uint32_t>(value.value & 0x7fff) << 13;
+  const uint32_t exponent = bits & kExponentMask;
+  bits += (127 - 15) << 23;
+  if (exponent == kExponentMask) {
+    // Infinity or NaN.
+    bits += (128 - 16) << 23;
+  } else if (exponent == 0) {
+    // Zero or denormal, renormalized by a float subtraction.
+    bits += 1 << 23;
+    constexpr uint32_t kMagicBits = 113 << 23;
+    float result, magic;
+    std::memcpy(&result, &bits, sizeof(result));
+    std::memcpy(&magic, &kMagicBits, sizeof(magic));
+    result -= magic;
+    std::memcpy(&bits, &result, sizeof(bits));
+  }
+  bits |= static_cast<uint32_t>(value.value & 0x8000) << 16;
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+inline fp16 FloatToFp16(float value) {
+  constexpr uint32_t kFloatInfinity = 255 << 23;
+  constexpr uint32_t kHalfOverflow = (127 + 16) << 23;
+  constexpr uint32_t kDenormalMagicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint32_t sign = bits & 0x80000000u;
+  bits ^= sign;
+  uint16_t result;
+  if (bits >= kHalfOverflow) {
+    // Infinity or NaN, which is kept quiet.
+    result = bits > kFloatInfinity ? 0x7e00 : 0x7c00;
+  } else if (bits < (113 << 23)) {
+    // Denormal or zero, rounded by a float addition.
+    float magnitude, magic;
+    std::memcpy(&magnitude, &bits, sizeof(magnitude));
+    std::memcpy(&magic, &kDenormalMagicBits, sizeof(magic));
+    magnitude += magic;
+    std::memcpy(&bits, &magnitude, sizeof(bits));
+    result = static_cast<uint16_t>(bits - kDenormalMagicBits);
+  } else {
+    const uint32_t mantissa_odd = (bits >> 13) & 1;
+    bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xfff + mantissa_odd;
+    result = static_cast<uint16_t>(bits >> 13);
+  }
+  return fp16(static_cast<uint16_t>(result | sign >> 16));
+}
 }  // namespace tfrt
 
 #endif  // TFRT_SUPPORT_FP16_H_
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Histogram of latencies with a bounded relative error, in the style of
+// HdrHistogram.
+
+#ifndef TFRT_SUPPORT_LATENCY_HISTOGRAM_H_
+#define TFRT_SUPPORT_LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace tfrt {
+
+// Records latencies in nanoseconds into buckets whose width is at most 1/64 of
+// their lower bound, so that percentiles of any latency up to the range of
+// uint64_t have a relative error of less than 2% at a fixed memory cost.
+//
+// Record() is thread-safe and lock-free. The accessors may be called while
+// latencies are recorded, but then they don't return a consistent snapshot.
+class LatencyHistogram {
+ public:
+  using Duration = std::chrono::nanoseconds;
+
+  LatencyHistogram();
+
+  void Record(Duration latency);
+
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+  // Returns zero if the histogram is empty.
+  Duration Min() const;
+  Duration Max() const;
+  Duration Mean() const;
+
+  // Returns the smallest latency that is greater than or equal to
+  // `percentile` percent of the recorded latencies, rounded up to the bucket
+  // boundary. `percentile` is in [0, 100]. Returns zero if the histogram is
+  // empty.
+  Duration Percentile(double percentile) const;
+
+ private:
+  // Latencies below 2^kSubBucketBits ns have a bucket each. Each power of two
+  // above has 2^(kSubBucketBits-1) buckets.
+  static constexpr int kSubBucketBits = 7;
+  static constexpr int kNumBuckets = (1 << kSubBucketBits) +
+                                     (64 - kSubBucketBits) *
+                                         (1 << (kSubBucketBits - 1));
+
+  static int GetBucketIndex(uint64_t value);
+  // Returns the largest value of the bucket.
+  static uint64_t GetBucketMax(int index);
+
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> min_;
+  std::atomic<uint64_t> max_{0};
+  std::array<std::atomic<uint64_t>, kNumBuckets> buckets_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_SUPPORT_LATENCY_HISTOGRAM_H_
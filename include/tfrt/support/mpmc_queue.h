@@ -0,0 +1,158 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Bounded lock-free multi-producer multi-consumer queue.
+
+#ifndef TFRT_SUPPORT_MPMC_QUEUE_H_
+#define TFRT_SUPPORT_MPMC_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "llvm/ADT/Optional.h"
+#include "llvm/Support/MathExtras.h"
+
+namespace tfrt {
+
+// A fixed capacity FIFO queue that allows any number of concurrent producers
+// and consumers without locks (D. Vyukov's bounded MPMC queue).
+//
+// Every slot of the ring has a sequence number that tells whether it is ready
+// to be written or read at a given position. A push or pop claims a position
+// with a CAS on a shared counter, and then only touches its own slot, so
+// producers and consumers do not contend with each other unless the queue is
+// full or empty.
+//
+// Sample usage:
+//
+// BoundedMpmcQueue<T> queue(1024);
+//
+// if (!queue.TryPush(value)) { /* The queue is full. */ }
+//
+// if (llvm::Optional<T> value = queue.TryPop()) { ... }
+//
+// Requirements:
+//
+// Type T needs to be movable.
+template <typename T>
+class BoundedMpmcQueue {
+ public:
+  // `capacity` is rounded up to a power of 2.
+  explicit BoundedMpmcQueue(size_t capacity)
+      : mask_(llvm::PowerOf2Ceil(std::max<size_t>(capacity, 2)) - 1),
+        slots_(new Slot[mask_ + 1]) {
+    for (size_t i = 0; i <= mask_; ++i)
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  BoundedMpmcQueue(const BoundedMpmcQueue&) = delete;
+  BoundedMpmcQueue& operator=(const BoundedMpmcQueue&) = delete;
+
+  ~BoundedMpmcQueue() {
+    while (TryPop()) {
+    }
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Returns false if the queue is full, in which case `value` is not moved.
+  bool TryPush(T&& value) { return TryEmplace(std::move(value)); }
+  bool TryPush(const T& value) { return TryEmplace(value); }
+
+  template <typename... Args>
+  bool TryEmplace(Args&&... args) {
+    size_t position = push_position_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[position & mask_];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (diff == 0) {
+        // The slot is free at this position, try to claim it.
+        if (push_position_.compare_exchange_weak(position, position + 1,
+                                                 std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        // The slot still holds the value from the previous lap.
+        return false;
+      } else {
+        // Another producer claimed the position.
+        position = push_position_.load(std::memory_order_relaxed);
+      }
+    }
+    new (&slot->storage) T(std::forward<Args>(args)...);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns None if the queue is empty.
+  llvm::Optional<T> TryPop() {
+    size_t position = pop_position_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[position & mask_];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+      if (diff == 0) {
+        if (pop_position_.compare_exchange_weak(position, position + 1,
+                                                std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        // The slot has not been written at this position yet.
+        return llvm::None;
+      } else {
+        position = pop_position_.load(std::memory_order_relaxed);
+      }
+    }
+    T* element = reinterpret_cast<T*>(&slot->storage);
+    llvm::Optional<T> value(std::move(*element));
+    element->~T();
+    // Make the slot free for the producer of the next lap.
+    slot->sequence.store(position + mask_ + 1, std::memory_order_release);
+    return value;
+  }
+
+  // Returns an approximate number of elements in the queue.
+  size_t size() const {
+    size_t pop = pop_position_.load(std::memory_order_relaxed);
+    size_t push = push_position_.load(std::memory_order_relaxed);
+    return push > pop ? push - pop : 0;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+  };
+
+  const size_t mask_;
+  const std::unique_ptr<Slot[]> slots_;
+  // The producer and consumer counters are on separate cache lines.
+  alignas(64) std::atomic<size_t> push_position_{0};
+  alignas(64) std::atomic<size_t> pop_position_{0};
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_SUPPORT_MPMC_QUEUE_H_
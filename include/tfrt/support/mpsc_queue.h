@@ -0,0 +1,124 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unbounded intrusive multi-producer single-consumer queue.
+
+#ifndef TFRT_SUPPORT_MPSC_QUEUE_H_
+#define TFRT_SUPPORT_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <type_traits>
+
+namespace tfrt {
+
+// The link of an element of an MpscQueue. Elements derive from it.
+class MpscQueueNode {
+ private:
+  template <typename T>
+  friend class MpscQueue;
+
+  std::atomic<MpscQueueNode*> next_{nullptr};
+};
+
+// A FIFO queue of elements that derive from MpscQueueNode, which allows any
+// number of concurrent producers and a single consumer without locks (D.
+// Vyukov's intrusive MPSC queue). Push() is a single atomic exchange and never
+// allocates, Pop() is wait-free.
+//
+// The queue does not own its elements. An element can only be in one queue at
+// a time, and must stay alive until it is popped.
+//
+// Pop() and empty() may not see an element whose Push() has not returned yet.
+// An element is seen by the consumer if its Push() happens before, e.g. if the
+// producer releases and the consumer acquires the same mutex afterwards.
+//
+// Sample usage:
+//
+// struct Work : MpscQueueNode { ... };
+// MpscQueue<Work> queue;
+//
+// On the producer side, concurrent producers are allowed:
+//
+// queue.Push(new Work(...));
+//
+// On the consumer side, only one thread at a time is allowed:
+//
+// while (Work* work = queue.Pop()) { ...; delete work; }
+template <typename T>
+class MpscQueue {
+  static_assert(std::is_base_of<MpscQueueNode, T>::value,
+                "MpscQueue elements must derive from MpscQueueNode");
+
+ public:
+  MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  // Appends `element` to the queue. Safe to call from any thread.
+  void Push(T* element) { PushNode(element); }
+
+  // Removes and returns the first element, or nullptr if the queue is empty.
+  // Must only be called by the consumer.
+  T* Pop() {
+    MpscQueueNode* tail = tail_;
+    MpscQueueNode* next = tail->next_.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == nullptr) return nullptr;
+      tail_ = tail = next;
+      next = next->next_.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return static_cast<T*>(tail);
+    }
+    // `tail` is the last linked element. Unless a producer is between the
+    // exchange and the link in PushNode(), re-insert the stub behind it so that
+    // it can be popped without racing with producers appending to it.
+    if (tail != head_.load(std::memory_order_acquire)) return nullptr;
+    PushNode(&stub_);
+    next = tail->next_.load(std::memory_order_acquire);
+    if (next == nullptr) return nullptr;
+    tail_ = next;
+    return static_cast<T*>(tail);
+  }
+
+  // Returns true if Pop() would return nullptr. Must only be called by the
+  // consumer.
+  bool empty() const {
+    return tail_ == &stub_ &&
+           stub_.next_.load(std::memory_order_acquire) == nullptr;
+  }
+
+ private:
+  void PushNode(MpscQueueNode* node) {
+    node->next_.store(nullptr, std::memory_order_relaxed);
+    MpscQueueNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+    // Until this store the consumer can not reach `node` and the elements
+    // pushed after it.
+    prev->next_.store(node, std::memory_order_release);
+  }
+
+  // The last pushed node, written by the producers.
+  alignas(64) std::atomic<MpscQueueNode*> head_;
+  // The next node to pop, only accessed by the consumer.
+  alignas(64) MpscQueueNode* tail_;
+  MpscQueueNode stub_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_SUPPORT_MPSC_QUEUE_H_
@@ -24,6 +24,7 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/selective_registration.h"
 
 namespace tfrt {
 template <typename OpMetadataFnTy, typename DispatchFnTy, typename OpFlagsTy>
@@ -41,6 +42,7 @@ class OpRegistryImpl {
   void AddOp(string_view op_name, DispatchFnTy dispatch_fn, OpFlagsTy flags,
              ArrayRef<string_view> attr_names) {
     assert(!op_name.empty() && "op names cannot be empty");
+    if (!ShouldRegisterOp(op_name)) return;
     auto& entry = op_mappings_[op_name];
     entry.dispatch_fn = dispatch_fn;
     entry.flags = flags;
@@ -51,6 +53,7 @@ class OpRegistryImpl {
 
   void AddMetadataFn(string_view op_name, OpMetadataFnTy metadata_fn) {
     assert(!op_name.empty() && "op names cannot be empty");
+    if (!ShouldRegisterOp(op_name)) return;
     op_mappings_[op_name].metadata_fn = metadata_fn;
   }
 
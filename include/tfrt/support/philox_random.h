@@ -23,6 +23,8 @@
 #define TFRT_SUPPORT_PHILOX_RANDOM_H_
 
 #include <math.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include <array>
@@ -61,13 +63,43 @@ class PhiloxRandom {
     return cached_results_[next_result_index_++];
   }
 
- private:
+  // Writes the next `size` 32-bit random values to `output`, i.e. the values
+  // that `size` calls of operator() would return. Whole 128-bit samples are
+  // computed in batches with the SIMD instructions that the CPU supports.
+  void Fill(uint32_t* output, size_t size) {
+    for (; size > 0 && next_result_index_ < kCounterSize; --size)
+      *output++ = cached_results_[next_result_index_++];
+    const size_t num_samples = size / kCounterSize;
+    FillSamples(output, num_samples);
+    output += num_samples * kCounterSize;
+    for (size -= num_samples * kCounterSize; size > 0; --size)
+      *output++ = (*this)();
+  }
+
+  // Skips the next `count` 32-bit random values in constant time. Generators
+  // that skip different counts of the same stream return non-overlapping
+  // values, which allows filling parts of a buffer in parallel.
+  void Skip(uint64_t count) {
+    for (; count > 0 && next_result_index_ < kCounterSize; --count)
+      ++next_result_index_;
+    SkipSamples(count / kCounterSize);
+    if (count % kCounterSize != 0) {
+      cached_results_ = computeRandomBits();
+      next_result_index_ = count % kCounterSize;
+    }
+  }
+
   // Uses the same constants as recommended by the original paper.
   static constexpr uint32_t kPhiloxW32A = 0x9E3779B9;
   static constexpr uint32_t kPhiloxW32B = 0xBB67AE85;
   static constexpr uint32_t kPhiloxM4x32A = 0xD2511F53;
   static constexpr uint32_t kPhiloxM4x32B = 0xCD9E8D57;
 
+ private:
+  // Computes the next `num_samples` 128-bit samples into `output` and advances
+  // the counter past them. Defined in philox_random.cc.
+  void FillSamples(uint32_t* output, size_t num_samples);
+
   // Computes a group of four random numbers using the Philox algorithm.
   CounterType computeRandomBits() {
     CounterType counter = counter_;
@@ -111,6 +143,19 @@ class PhiloxRandom {
     }
   }
 
+  // Helper function to skip the next `count` samples of 128-bits.
+  void SkipSamples(uint64_t count) {
+    const uint64_t low = static_cast<uint64_t>(counter_[1]) << 32 | counter_[0];
+    const uint64_t sum = low + count;
+    counter_[0] = static_cast<uint32_t>(sum);
+    counter_[1] = static_cast<uint32_t>(sum >> 32);
+    if (sum < low) {
+      if (++counter_[2] == 0) {
+        ++counter_[3];
+      }
+    }
+  }
+
   void RaiseKey(KeyType* key) {
     (*key)[0] += kPhiloxW32A;
     (*key)[1] += kPhiloxW32B;
@@ -25,39 +25,52 @@
 
 namespace tfrt {
 
+// Add a reference to each value in `values`. Runs of the same value, e.g. a
+// chain passed several times, take a single atomic operation.
+template <typename T>
+void AddRefs(llvm::ArrayRef<T*> values) {
+  for (size_t i = 0, e = values.size(); i != e;) {
+    size_t j = i + 1;
+    while (j != e && values[j] == values[i]) ++j;
+    values[i]->AddRef(j - i);
+    i = j;
+  }
+}
+
+// Drop a reference to each value in `values`, like AddRefs().
+template <typename T>
+void DropRefs(llvm::ArrayRef<T*> values) {
+  for (size_t i = 0, e = values.size(); i != e;) {
+    size_t j = i + 1;
+    while (j != e && values[j] == values[i]) ++j;
+    values[i]->DropRef(j - i);
+    i = j;
+  }
+}
+
 template <typename T>
 class RCArray {
  public:
-  explicit RCArray(llvm::ArrayRef<T*> values) {
-    values_.reserve(values.size());
-    for (auto* v : values) {
-      v->AddRef();
-      values_.push_back(v);
-    }
+  explicit RCArray(llvm::ArrayRef<T*> values)
+      : values_(values.begin(), values.end()) {
+    AddRefs<T>(values_);
   }
 
   explicit RCArray(llvm::ArrayRef<RCReference<T>> references) {
     values_.reserve(references.size());
-    for (auto& ref : references) {
-      auto* v = ref.get();
-      v->AddRef();
-      values_.push_back(v);
-    }
+    for (auto& ref : references) values_.push_back(ref.get());
+    AddRefs<T>(values_);
   }
 
   RCArray(RCArray&& other) : values_(std::move(other.values_)) {}
 
   RCArray& operator=(RCArray&& other) {
-    for (auto* v : values_) v->DropRef();
+    DropRefs<T>(values_);
     values_ = std::move(other.values_);
     return *this;
   }
 
-  ~RCArray() {
-    for (auto* v : values_) {
-      v->DropRef();
-    }
-  }
+  ~RCArray() { DropRefs<T>(values_); }
 
   T* operator[](size_t i) const {
     assert(i < values_.size());
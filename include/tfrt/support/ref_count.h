@@ -74,21 +74,30 @@ class ReferenceCounted {
   ReferenceCounted& operator=(const ReferenceCounted&) = delete;
 
   // Add a new reference to this object.
-  void AddRef() {
+  void AddRef() { AddRef(1); }
+
+  // Add `count` new references to this object with a single atomic operation,
+  // e.g. for all the users of a value that is shared by several consumers.
+  void AddRef(unsigned count) {
     assert(ref_count_.load(std::memory_order_relaxed) >= 1);
     // It is OK to use std::memory_order_relaxed here as it does not affect the
     // ownership state of the object.
-    ref_count_.fetch_add(1, std::memory_order_relaxed);
+    if (count > 0) ref_count_.fetch_add(count, std::memory_order_relaxed);
   }
 
   // Drop a reference to this object, potentially deallocating it.
-  void DropRef() {
-    assert(ref_count_.load(std::memory_order_relaxed) > 0);
+  void DropRef() { DropRef(1); }
+
+  // Drop `count` references to this object with a single atomic operation,
+  // potentially deallocating it.
+  void DropRef(unsigned count) {
+    assert(ref_count_.load(std::memory_order_relaxed) >= count);
+    if (count == 0) return;
 
-    // If ref_count_==1, this object is owned only by the caller. Bypass a
+    // If ref_count_==count, this object is owned only by the caller. Bypass a
     // locked op in that case.
-    if (ref_count_.load(std::memory_order_acquire) == 1 ||
-        ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    if (ref_count_.load(std::memory_order_acquire) == count ||
+        ref_count_.fetch_sub(count, std::memory_order_acq_rel) == count) {
       // Make assert in ~ReferenceCounted happy
       assert((ref_count_.store(0, std::memory_order_relaxed), true));
       static_cast<SubClass*>(this)->Destroy();
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Selective registration restricts the kernels and op handler ops that the
+// static registration functions add to the ones that a binary uses.
+//
+// The allowed names are usually generated by tools:bef_deps from the BEF files
+// that a binary runs, see tools/selective_registration.bzl. Kernel families
+// that have no allowed kernel are skipped entirely, which keeps startup and
+// registry memory proportional to what the binary executes.
+
+#ifndef TFRT_SUPPORT_SELECTIVE_REGISTRATION_H_
+#define TFRT_SUPPORT_SELECTIVE_REGISTRATION_H_
+
+#include "llvm/ADT/ArrayRef.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+// Allows only the given kernel and op names to be registered. Must be called
+// before anything is registered, i.e. during static initialization, see
+// TFRT_STATIC_SELECTIVE_REGISTRATION. Without a call, everything is allowed.
+void SetSelectiveRegistration(ArrayRef<const char*> kernel_names,
+                              ArrayRef<const char*> op_names);
+
+// Returns whether the kernel with `name` should be registered.
+bool ShouldRegisterKernel(string_view name);
+
+// Returns whether any kernel whose name starts with `prefix` should be
+// registered.
+bool ShouldRegisterKernelFamily(string_view prefix);
+
+// Returns whether the op handler op with `name` should be registered.
+bool ShouldRegisterOp(string_view name);
+
+// Use this macro to set the allowed kernel and op names of a binary. KERNELS
+// and OPS are static arrays of C strings, or {} for none.
+#define TFRT_STATIC_SELECTIVE_REGISTRATION(KERNELS, OPS)   \
+  static bool tfrt_static_selective_registration_ = []() { \
+    ::tfrt::SetSelectiveRegistration(KERNELS, OPS);        \
+    return true;                                           \
+  }()
+
+}  // namespace tfrt
+
+#endif  // TFRT_SUPPORT_SELECTIVE_REGISTRATION_H_
@@ -22,10 +22,17 @@
 #ifndef TFRT_SUPPORT_THREAD_ENVIRONMENT_STD_H_
 #define TFRT_SUPPORT_THREAD_ENVIRONMENT_STD_H_
 
+#include <string>
 #include <thread>
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace tfrt {
 namespace internal {
 
@@ -41,11 +48,31 @@ class StdThread {
 struct StdThreadingEnvironment {
   using Thread = ::tfrt::internal::StdThread;
 
+  // Starts a thread named `name_prefix`. Linux truncates thread names to 15
+  // characters.
   template <class Function, class... Args>
   static std::unique_ptr<Thread> StartThread(llvm::StringRef name_prefix,
                                              Function&& f, Args&&... args) {
-    return std::make_unique<Thread>(
-        std::thread(std::forward<Function>(f), std::forward<Args>(args)...));
+    std::thread thread(std::forward<Function>(f), std::forward<Args>(args)...);
+#if defined(__linux__)
+    std::string name = name_prefix.take_front(15).str();
+    pthread_setname_np(thread.native_handle(), name.c_str());
+#endif
+    return std::make_unique<Thread>(std::move(thread));
+  }
+
+  // Pins the calling thread to `cpus`. Pinning is best effort, it is a no-op
+  // if `cpus` is empty or where thread affinity is not supported.
+  static void SetCurrentThreadAffinity(llvm::ArrayRef<int> cpus) {
+#if defined(__linux__)
+    if (cpus.empty()) return;
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : cpus) {
+      if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &cpu_set);
+    }
+    sched_setaffinity(/*pid=*/0, sizeof(cpu_set), &cpu_set);
+#endif  // __linux__
   }
 
   static uint64_t ThisThreadIdHash() {
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Thread local free list of objects of one type.
+//
+// ThreadLocalFreeList<T> recycles the memory of small, short-lived objects of
+// type T that are allocated and freed at a high rate, e.g. the nodes of the
+// waiter list of an AsyncValue. Memory is cached by the thread that frees it,
+// up to `kMaxSize` blocks per thread, so that the steady state does not
+// allocate. It is typically used to implement the class-specific allocation
+// functions of T:
+//
+//   static void* operator new(size_t size) {
+//     return ThreadLocalFreeList<T>::Allocate(size);
+//   }
+//   static void operator delete(void* ptr) {
+//     ThreadLocalFreeList<T>::Deallocate(ptr);
+//   }
+
+#ifndef TFRT_SUPPORT_THREAD_LOCAL_FREE_LIST_H_
+#define TFRT_SUPPORT_THREAD_LOCAL_FREE_LIST_H_
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+
+namespace tfrt {
+
+template <typename T, int kMaxSize = 1024>
+class ThreadLocalFreeList {
+  static_assert(alignof(T) <= alignof(std::max_align_t),
+                "ThreadLocalFreeList does not support over-aligned types");
+
+ public:
+  // Allocate memory for one T. `size` must be sizeof(T).
+  static void* Allocate(size_t size) {
+    assert(size == sizeof(T));
+    (void)size;
+    return GetCache().Allocate();
+  }
+
+  // Deallocate memory returned by Allocate(), possibly on another thread.
+  static void Deallocate(void* ptr) { GetCache().Deallocate(ptr); }
+
+ private:
+  class Cache {
+   public:
+    ~Cache() {
+      while (head_ != nullptr) ::operator delete(Pop());
+      destroyed_ = true;
+    }
+
+    void* Allocate() {
+      if (head_ == nullptr) return ::operator new(kBlockSize);
+      return Pop();
+    }
+
+    void Deallocate(void* ptr) {
+      // Memory freed by thread-local destructors that run after this one is
+      // not cached.
+      if (destroyed_ || size_ == kMaxSize) {
+        ::operator delete(ptr);
+        return;
+      }
+      auto* block = static_cast<FreeBlock*>(ptr);
+      block->next = head_;
+      head_ = block;
+      ++size_;
+    }
+
+   private:
+    struct FreeBlock {
+      FreeBlock* next;
+    };
+
+    void* Pop() {
+      FreeBlock* block = head_;
+      head_ = block->next;
+      --size_;
+      return block;
+    }
+
+    FreeBlock* head_ = nullptr;
+    int size_ = 0;
+    bool destroyed_ = false;
+  };
+
+  static constexpr size_t kBlockSize =
+      sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T);
+
+  static Cache& GetCache() {
+    static thread_local Cache cache;
+    return cache;
+  }
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_SUPPORT_THREAD_LOCAL_FREE_LIST_H_
@@ -66,8 +66,20 @@ constexpr TensorDType GetTensorDType(uint64_t) { return TensorDType::kUInt64; }
 enum class TensorLayout : uint8_t {
   kRMD = 0,
   kCOO_EXPERIMENTAL = 1,
+  kRMD_CHUNKED = 2,
 };
 
+// A kRMD_CHUNKED tensor record stores a row-major dense tensor whose data is
+// split into chunks with independent checksums, so that it can be written and
+// verified in parallel or as a stream. The record is:
+//
+// <TensorHeader><dims:uint64_t[rank]><num_chunks:uint64_t>
+// <chunk_offsets:uint64_t[num_chunks + 1]><chunk_crcs:uint32_t[num_chunks]>
+// <padding to 8 bytes><tensor_data:dtype[]><padding to 8 bytes>
+//
+// Chunk `i` is the byte range [chunk_offsets[i], chunk_offsets[i + 1]) of
+// tensor_data, and chunk_crcs[i] is its masked crc32c (see crc32c::Mask).
+
 raw_ostream& operator<<(raw_ostream& os, const TensorLayout& layout);
 
 // Tensor header in the Binary Tensor Format. This struct has to directly map to
@@ -28,6 +28,10 @@
 #include "llvm/Support/Error.h"
 #include "tfrt/dtype/dtype.h"
 #include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/forward_decls.h"
@@ -191,7 +195,8 @@ struct ParseDenseHostTensorTraits {
 // at the beginning of the BTF-file.
 Expected<std::vector<uint64_t>> ReadBTFOffsets(std::istream* stream);
 
-// Seeks to the given offset and reads the TENSOR_RECORD as a DHT.
+// Seeks to the given offset and reads the TENSOR_RECORD as a DHT. The chunks of
+// a kRMD_CHUNKED record are verified against their checksums as they are read.
 Expected<DenseHostTensor> ReadDHTFromBTF(std::istream* stream, uint64_t offset,
                                          HostContext* host);
 
@@ -199,6 +204,82 @@ Expected<DenseHostTensor> ReadDHTFromBTF(std::istream* stream, uint64_t offset,
 // only supports DenseHostTensors.
 Error WriteTensorsToBTF(std::ostream* stream, ArrayRef<const Tensor*> tensors);
 
+// Writes a BTF-file at `path` with a kRMD_CHUNKED tensor record of chunks of
+// `chunk_size` bytes for each tensor. The file is sized and mapped upfront, and
+// the chunks of all tensors are copied and checksummed in parallel. The
+// returned chain becomes available when the file is written.
+AsyncValueRef<Chain> WriteChunkedTensorsToBTF(
+    const std::string& path, ArrayRef<const DenseHostTensor*> tensors,
+    size_t chunk_size, const ExecutionContext& exec_ctx);
+
+// A BTF file mapped into memory. Tensors read from it are DenseHostTensors over
+// the mapped pages rather than copies, so reading a tensor costs O(metadata).
+// The file is mapped copy-on-write: its pages are shared with other processes
+// mapping the same file until written to. The mapping stays alive while the
+// MappedBTFFile or any tensor read from it does.
+class MappedBTFFile {
+ public:
+  // Maps the BTF file at `path`.
+  static Expected<MappedBTFFile> Open(const std::string& path);
+
+  uint64_t NumTensors() const { return num_tensors_; }
+
+  // Returns the TENSOR_RECORD at `index` as a DHT over the mapped pages. Only
+  // the pages holding the record offset and header are touched. Checksums of
+  // kRMD_CHUNKED records are not verified.
+  Expected<DenseHostTensor> ReadDHT(uint64_t index) const;
+
+  // Verifies the chunk checksums of the TENSOR_RECORD at `index` in parallel.
+  // The returned chain is an error if a chunk doesn't match its checksum.
+  // Records without checksums are always valid.
+  AsyncValueRef<Chain> VerifyChecksums(uint64_t index,
+                                       const ExecutionContext& exec_ctx) const;
+
+ private:
+  // Location of a TENSOR_RECORD in the mapped file.
+  struct Record {
+    TensorMetadata metadata;
+    uint64_t data_offset = 0;
+    // Chunk tables of kRMD_CHUNKED records.
+    uint64_t num_chunks = 0;
+    uint64_t chunk_offsets_offset = 0;
+    uint64_t chunk_crcs_offset = 0;
+  };
+
+  MappedBTFFile(RCReference<HostBuffer> buffer, uint64_t num_tensors)
+      : buffer_(std::move(buffer)), num_tensors_(num_tensors) {}
+
+  Expected<Record> ReadRecord(uint64_t index) const;
+
+  RCReference<HostBuffer> buffer_;
+  uint64_t num_tensors_;
+};
+
+// Maps the BTF file at `path` and returns the TENSOR_RECORD at `index` over the
+// mapped pages. Returns an error if the tensor doesn't have `dtype` and `rank`.
+Expected<DenseHostTensor> MapDHTFromBTF(const std::string& path,
+                                        uint64_t index, DType dtype,
+                                        int rank);
+
+// Kernel to read a tensor from a BTF file like ReadTensorFromBTF, but without
+// copying the tensor data: the result is a DenseHostTensor over the memory
+// mapped file.
+template <typename T, size_t Rank>
+AsyncValueRef<DenseHostTensor> MapDenseHostTensorFromBTF(
+    std::string path, int32_t index, const ExecutionContext& exec_ctx) {
+  return EnqueueBlockingWork(
+      exec_ctx,
+      [path = std::move(path), index,
+       exec_ctx]() -> Expected<DenseHostTensor> {
+        auto result = MapDHTFromBTF(path, index, GetDType<T>(), Rank);
+        if (!result) {
+          auto diag = EmitError(exec_ctx, result.takeError());
+          return MakeStringError(diag.message);
+        }
+        return result;
+      });
+}
+
 }  // namespace tfrt
 
 #endif  // TFRT_TENSOR_BTF_UTIL_H_
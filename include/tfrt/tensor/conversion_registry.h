@@ -46,6 +46,13 @@ AsyncValueRef<Tensor> ConvertTensor(const ExecutionContext& exec_ctx,
                                     const Device& dst,
                                     TensorType dst_tensor_type);
 
+// Returns the TensorConversionFn registered in the TensorConversionFn registry
+// of `host` for the conversion from `src_tensor_type` to `dst_tensor_type`, or
+// nullptr if there is none.
+TensorConversionFn GetTensorConversionFn(HostContext* host,
+                                         TensorType src_tensor_type,
+                                         TensorType dst_tensor_type);
+
 // Tensor conversion when both source and destination device are CPU.
 AsyncValueRef<HostTensor> ConvertTensorOnHost(const ExecutionContext& exec_ctx,
                                               const Tensor& tensor,
@@ -19,6 +19,7 @@
 
 #include <type_traits>
 
+#include "llvm/ADT/FunctionExtras.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_context.h"
@@ -27,6 +28,26 @@
 
 namespace tfrt {
 
+class DenseHostTensor;
+
+// Conversions that produce a DenseHostTensor are split into blocks of at least
+// this many bytes that are computed in parallel on the host work queue. This
+// keeps the working set of a block in L2 cache, and conversions that produce
+// less than one block run inline in the caller thread.
+constexpr size_t kParallelConversionBlockBytes = 128 * 1024;
+
+// Allocates a DenseHostTensor for `metadata` and computes its elements by
+// calling `compute(data, begin, end)` in parallel for non-overlapping
+// subranges of [0, size), where `data` is the buffer of the result and each
+// index covers `bytes_per_index` bytes of it. `on_done(data)`, if set, is
+// called after all subranges are computed. `compute` and `on_done` may run
+// after this returns, so they must own all the data they read.
+AsyncValueRef<DenseHostTensor> ConvertToDenseHostTensorInParallel(
+    const TensorMetadata& metadata, size_t size, size_t bytes_per_index,
+    llvm::unique_function<void(void* data, size_t begin, size_t end)> compute,
+    const ExecutionContext& exec_ctx,
+    llvm::unique_function<void(void* data)> on_done = {});
+
 // TFRT_CONVERSION is a macro that makes defining conversion functions more
 // straightforward. Example:
 //
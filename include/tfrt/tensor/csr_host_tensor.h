@@ -0,0 +1,103 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file defines the CsrHostTensor class.
+
+#ifndef TFRT_TENSOR_CSR_HOST_TENSOR_H_
+#define TFRT_TENSOR_CSR_HOST_TENSOR_H_
+
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+
+class CooHostTensor;
+class TensorConversionFnRegistry;
+
+void RegisterCsrHostTensorConversionFn(TensorConversionFnRegistry* registry);
+
+// Represents a rank 2 sparse tensor in compressed sparse row (CSR) format.
+// The column indices and values of the non-zero elements of row `r` are at
+// positions [row_ptrs[r], row_ptrs[r + 1]) of `col_indices` and `values`, in
+// the order they were inserted. Row pointers and column indices are int64.
+//
+// A CSC tensor is the CSR tensor of the transpose.
+class CsrHostTensor final : public HostTensor,
+                            public TensorTraits<CsrHostTensor> {
+ public:
+  // Empty and null by default.
+  CsrHostTensor() = default;
+
+  CsrHostTensor(const TensorShape& shape, DType dtype,
+                DenseHostTensor&& row_ptrs, DenseHostTensor&& col_indices,
+                DenseHostTensor&& values)
+      : HostTensor(TensorMetadata(dtype, shape)),
+        row_ptrs_(std::move(row_ptrs)),
+        col_indices_(std::move(col_indices)),
+        values_(std::move(values)) {
+    assert(shape.GetRank() == 2);
+    assert(row_ptrs_.NumElements() == shape.GetDimensionSize(0) + 1);
+    assert(col_indices_.NumElements() == values_.NumElements());
+  }
+
+  CsrHostTensor(CsrHostTensor&& other) = default;
+  CsrHostTensor& operator=(CsrHostTensor&& other) = default;
+
+  CsrHostTensor CopyRef() const {
+    return CsrHostTensor(shape(), dtype(), row_ptrs_.CopyRef(),
+                         col_indices_.CopyRef(), values_.CopyRef());
+  }
+
+  // Raw access to data.
+  const DenseHostTensor* RowPtrs() const { return &row_ptrs_; }
+  const DenseHostTensor* ColIndices() const { return &col_indices_; }
+  const DenseHostTensor* Values() const { return &values_; }
+
+  ssize_t NumRows() const { return shape().GetDimensionSize(0); }
+  ssize_t NumCols() const { return shape().GetDimensionSize(1); }
+  ssize_t NumNonZeros() const { return values_.NumElements(); }
+
+  void Print(raw_ostream& os) const override;
+
+  // Tensor type for CsrHostTensor.
+  static const char* name() { return "CsrHost"; }
+
+ private:
+  // This class is not copyable or assignable.
+  CsrHostTensor(const CsrHostTensor& other) = delete;
+  CsrHostTensor& operator=(const CsrHostTensor&) = delete;
+
+  DenseHostTensor row_ptrs_;
+  DenseHostTensor col_indices_;
+  DenseHostTensor values_;
+};
+
+// Converts a rank 2 CooHostTensor to CSR. Elements of the same row keep their
+// order in `coo`.
+Expected<CsrHostTensor> CopyCooHostTensorToCsrHostTensor(
+    const CooHostTensor& coo, HostContext* host);
+
+// Converts a rank 2 DenseHostTensor to CSR. Elements whose bytes are all zero
+// are not stored.
+Expected<CsrHostTensor> CopyDenseHostTensorToCsrHostTensor(
+    const DenseHostTensor& dht, HostContext* host);
+
+// Converts `csr` to a DenseHostTensor. Returns None on allocation failure.
+llvm::Optional<DenseHostTensor> CopyCsrHostTensorToDenseHostTensor(
+    const CsrHostTensor& csr, HostContext* host);
+
+}  // namespace tfrt
+
+#endif  // TFRT_TENSOR_CSR_HOST_TENSOR_H_
@@ -52,6 +52,12 @@ class DenseHostTensor final : public HostTensor,
   static llvm::Optional<DenseHostTensor> CreateUninitialized(
       const TensorMetadata& metadata, HostAllocator* allocator);
 
+  // Allocate the body with the allocator of the request of `exec_ctx`, which
+  // is an arena if the request owns one. Use this for tensors that are not
+  // expected to outlive the request.
+  static llvm::Optional<DenseHostTensor> CreateUninitialized(
+      const TensorMetadata& metadata, const ExecutionContext& exec_ctx);
+
   template <typename T>
   static llvm::Optional<DenseHostTensor> CreateUninitialized(
       const TensorShape& shape, HostContext* host) {
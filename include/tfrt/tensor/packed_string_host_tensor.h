@@ -0,0 +1,162 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file defines the PackedStringHostTensor class.
+
+#ifndef TFRT_TENSOR_PACKED_STRING_HOST_TENSOR_H_
+#define TFRT_TENSOR_PACKED_STRING_HOST_TENSOR_H_
+
+#include <cstring>
+#include <string>
+
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/host_tensor.h"
+
+namespace tfrt {
+
+class TensorConversionFnRegistry;
+
+void RegisterPackedStringHostTensorConversionFn(
+    TensorConversionFnRegistry* registry);
+
+// Represents a tensor of strings in a contiguous layout: the bytes of all
+// strings are concatenated in one buffer, and element `i` is the byte range
+// [offsets[i], offsets[i + 1]) of it. Unlike StringHostTensor, this needs no
+// allocation per element. The buffers are immutable and reference counted, so
+// CopyRef() shares them.
+class PackedStringHostTensor final
+    : public HostTensor,
+      public TensorTraits<PackedStringHostTensor> {
+ public:
+  // Empty and null by default.
+  PackedStringHostTensor() = default;
+
+  // Adopts `offsets` holding NumElements() + 1 int64 offsets into `bytes`,
+  // without copying either buffer.
+  PackedStringHostTensor(const TensorShape& shape,
+                         RCReference<HostBuffer> offsets,
+                         RCReference<HostBuffer> bytes)
+      : PackedStringHostTensor(shape, std::move(offsets), std::move(bytes),
+                               /*bytes_offset=*/0) {}
+
+  // Copies `strings`, a range of values convertible to string_view, into a
+  // tensor with a single allocation for the offsets and bytes. Returns None on
+  // allocation failure.
+  template <typename Range>
+  static llvm::Optional<PackedStringHostTensor> Create(
+      const TensorShape& shape, const Range& strings, HostContext* host);
+
+  // Returns a scalar tensor that takes ownership of `str` without copying its
+  // bytes. Returns None on allocation failure.
+  static llvm::Optional<PackedStringHostTensor> CreateScalar(
+      std::string&& str, HostContext* host);
+
+  PackedStringHostTensor(PackedStringHostTensor&& other) = default;
+  PackedStringHostTensor& operator=(PackedStringHostTensor&& other) = default;
+
+  PackedStringHostTensor CopyRef() const {
+    return PackedStringHostTensor(shape(), offsets_.CopyRef(), bytes_.CopyRef(),
+                                  bytes_offset_);
+  }
+
+  // Returns the string at `index` in row major order, pointing into the
+  // tensor's bytes.
+  string_view GetString(ssize_t index) const {
+    auto offsets = this->offsets();
+    return string_view(bytes() + offsets[index],
+                       offsets[index + 1] - offsets[index]);
+  }
+
+  ArrayRef<int64_t> offsets() const {
+    return ArrayRef<int64_t>(static_cast<const int64_t*>(offsets_->data()),
+                             NumElements() + 1);
+  }
+
+  // Returns the concatenated bytes of all strings.
+  const char* bytes() const {
+    return static_cast<const char*>(bytes_->data()) + bytes_offset_;
+  }
+
+  const RCReference<HostBuffer>& offsets_buffer() const { return offsets_; }
+  const RCReference<HostBuffer>& bytes_buffer() const { return bytes_; }
+
+  void Print(raw_ostream& os) const override;
+
+  // Tensor type for PackedStringHostTensor.
+  static const char* name() { return "PackedStringHost"; }
+
+ private:
+  // This class is not copyable or assignable.
+  PackedStringHostTensor(const PackedStringHostTensor& other) = delete;
+  PackedStringHostTensor& operator=(const PackedStringHostTensor&) = delete;
+
+  // The strings start at `bytes_offset` in `bytes`, which may be the same
+  // buffer as `offsets`.
+  PackedStringHostTensor(const TensorShape& shape,
+                         RCReference<HostBuffer> offsets,
+                         RCReference<HostBuffer> bytes, size_t bytes_offset)
+      : HostTensor(TensorMetadata(DType(DType::String), shape)),
+        offsets_(std::move(offsets)),
+        bytes_(std::move(bytes)),
+        bytes_offset_(bytes_offset) {
+    assert(offsets_->size() >= (NumElements() + 1) * sizeof(int64_t));
+    assert(bytes_offset_ + this->offsets().back() <= bytes_->size());
+  }
+
+  RCReference<HostBuffer> offsets_;
+  RCReference<HostBuffer> bytes_;
+  size_t bytes_offset_ = 0;
+};
+
+template <typename Range>
+llvm::Optional<PackedStringHostTensor> PackedStringHostTensor::Create(
+    const TensorShape& shape, const Range& strings, HostContext* host) {
+  const size_t num_elements = shape.GetNumElements();
+  const size_t offsets_size = (num_elements + 1) * sizeof(int64_t);
+  size_t num_strings = 0, num_bytes = 0;
+  for (string_view str : strings) {
+    ++num_strings;
+    num_bytes += str.size();
+  }
+  assert(num_strings == num_elements);
+  (void)num_strings;
+
+  // The offsets and bytes share one allocation.
+  auto buffer = HostBuffer::CreateUninitialized(
+      offsets_size + num_bytes, alignof(int64_t), host->allocator());
+  if (!buffer) return llvm::None;
+
+  auto* offsets = static_cast<int64_t*>(buffer->data());
+  auto* bytes = static_cast<char*>(buffer->data()) + offsets_size;
+  int64_t offset = 0;
+  for (string_view str : strings) {
+    *offsets++ = offset;
+    std::memcpy(bytes + offset, str.data(), str.size());
+    offset += str.size();
+  }
+  *offsets = offset;
+
+  auto offsets_buffer = buffer.CopyRef();
+  return PackedStringHostTensor(shape, std::move(offsets_buffer),
+                                std::move(buffer), offsets_size);
+}
+
+}  // namespace tfrt
+
+#endif  // TFRT_TENSOR_PACKED_STRING_HOST_TENSOR_H_
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file defines the StridedHostTensor class.
+
+#ifndef TFRT_TENSOR_STRIDED_HOST_TENSOR_H_
+#define TFRT_TENSOR_STRIDED_HOST_TENSOR_H_
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/host_tensor.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+
+class DenseHostTensor;
+class HostContext;
+
+void RegisterStridedHostTensorConversionFn(
+    TensorConversionFnRegistry* registry);
+
+// Represents a view of the elements in a HostBuffer with arbitrary strides.
+// The element at index (i_0, ..., i_n) is stored
+// `offset + i_0 * stride_0 + ... + i_n * stride_n` elements from the start of
+// the buffer. Slices, transposes and broadcasts (stride 0) of a
+// DenseHostTensor are views of its buffer and do not copy the elements.
+//
+// Kernels that handle strides can take a StridedHostTensor directly; all
+// others convert it to a DenseHostTensor, which only copies the elements if
+// the view is not contiguous.
+class StridedHostTensor final : public HostTensor,
+                                public TensorTraits<StridedHostTensor> {
+ public:
+  // Empty and null by default.
+  StridedHostTensor() = default;
+
+  // `strides` and `offset` are in elements. The caller is responsible for all
+  // elements of the view being within `data`.
+  StridedHostTensor(const TensorMetadata& metadata, ArrayRef<ssize_t> strides,
+                    ssize_t offset, RCReference<HostBuffer> data);
+
+  // Views all elements of `tensor`.
+  explicit StridedHostTensor(const DenseHostTensor& tensor);
+
+  StridedHostTensor(StridedHostTensor&& other) = default;
+  StridedHostTensor& operator=(StridedHostTensor&& other) = default;
+
+  StridedHostTensor CopyRef() const {
+    return StridedHostTensor(metadata(), strides_, offset_, data_.CopyRef());
+  }
+
+  ArrayRef<ssize_t> strides() const { return strides_; }
+  ssize_t offset() const { return offset_; }
+  const RCReference<HostBuffer>& buffer() const { return data_; }
+
+  // Returns true if the elements are stored contiguously in row major order,
+  // i.e. the view can be used as a DenseHostTensor without copying.
+  bool IsContiguous() const;
+
+  // Returns a pointer to the element at index (0, ..., 0).
+  const void* data() const {
+    assert(data_ && "dereferencing a null host tensor");
+    return static_cast<const char*>(data_->data()) +
+           offset_ * dtype().GetHostSize();
+  }
+
+  // Returns the number of rows, i.e. slices along the innermost dimension.
+  ssize_t NumRows() const;
+
+  // Returns the offset in elements of the element at `indices` from data().
+  ssize_t ElementOffset(ArrayRef<ssize_t> indices) const {
+    assert(indices.size() == strides_.size());
+    ssize_t offset = 0;
+    for (int i = 0, e = indices.size(); i < e; ++i)
+      offset += indices[i] * strides_[i];
+    return offset;
+  }
+
+  template <typename DType>
+  const DType& ElementAt(ArrayRef<ssize_t> indices) const {
+    assert(GetDType<DType>() == dtype() && "Incorrect dtype for tensor");
+    return static_cast<const DType*>(data())[ElementOffset(indices)];
+  }
+
+  // Returns the view of the `sizes` elements starting at `begin` in each
+  // dimension.
+  Expected<StridedHostTensor> Slice(ArrayRef<ssize_t> begin,
+                                    ArrayRef<ssize_t> sizes) const;
+
+  // Returns the view with dimension i of the result being dimension `perm[i]`
+  // of this tensor.
+  Expected<StridedHostTensor> Transpose(ArrayRef<int> perm) const;
+
+  // Returns the view broadcast to `shape` with numpy broadcasting rules.
+  Expected<StridedHostTensor> BroadcastTo(const TensorShape& shape) const;
+
+  // Returns the elements as a DenseHostTensor. A contiguous view shares the
+  // buffer, all others are copied into a new buffer. This returns None on
+  // allocation failure.
+  llvm::Optional<DenseHostTensor> ToDenseHostTensor(HostContext* host) const;
+
+  void Print(raw_ostream& os) const override;
+
+  // Tensor type for StridedHostTensor.
+  static const char* name() { return "StridedHost"; }
+
+ private:
+  // This class is not copyable or assignable.
+  StridedHostTensor(const StridedHostTensor& other) = delete;
+  StridedHostTensor& operator=(const StridedHostTensor&) = delete;
+
+  llvm::SmallVector<ssize_t, 4> strides_;
+  ssize_t offset_ = 0;
+  RCReference<HostBuffer> data_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_TENSOR_STRIDED_HOST_TENSOR_H_
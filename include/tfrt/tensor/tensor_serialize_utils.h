@@ -36,6 +36,7 @@ namespace tfrt {
 class DenseHostTensor;
 class HostContext;
 class DenseAttr;
+class DenseAttribute;
 
 // DenseHostTensor to DenseAttr.
 size_t SerializeDenseHostTensorToDenseAttr(const DenseHostTensor& dht,
@@ -45,6 +46,12 @@ size_t SerializeDenseHostTensorToDenseAttr(const DenseHostTensor& dht,
 llvm::Expected<DenseHostTensor> DeserializeDenseHostTensorFromDenseAttr(
     DenseAttr attr, HostContext* host);
 
+// DenseAttribute to DenseHostTensor. The tensor uses the elements of the
+// attribute in place if they can be referenced and are aligned, and a copy of
+// them otherwise.
+llvm::Expected<DenseHostTensor> DeserializeDenseHostTensorFromDenseAttr(
+    const DenseAttribute& attr, HostContext* host);
+
 TensorMetadata CreateTensorMetadata(const DenseAttr& attr);
 
 DenseView CreateDenseView(const DenseAttr& attr);
@@ -20,13 +20,16 @@
 #define TFRT_TENSOR_TENSOR_SHAPE_H_
 
 #include <array>
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Error.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/ref_count.h"
 
 namespace tfrt {
 class KernelRegistry;
@@ -111,16 +114,17 @@ class TensorShape {
  private:
   // The storage of TensorShape is carefully laid out to always be 16-bytes in
   // size, but has to support the full generality of tensor shapes.  To do this,
-  // it has two inline representations, one that can hold up to 7 dimensions
-  // when they fit into 16-bits (each dimension is at most 65535 in size) or up
-  // to 4 dimension where the first three fits in 32-bits and the last fits in
-  // 16 bits.  If neither of these representations work, then an out of line
-  // representation is used for the general case.
+  // it has three inline representations, one that can hold up to 7 dimensions
+  // when they fit into 16-bits (each dimension is at most 65535 in size), one
+  // that holds up to 4 dimension where the first three fits in 32-bits and the
+  // last fits in 16 bits, and one that bit-packs 4 to 6 dimensions of 28, 22
+  // or 18 bits each.  If none of these representations work, then an out of
+  // line representation is used for the general case.
   // Important: Identical shapes must have the same representation kind. For
-  // Rep16 and Rep32, the representation value is assumed to be deterministic.
-  // This means for Rep16 and Rep32 it is sufficient to compare the memory
+  // the inline representations, the representation value is assumed to be
+  // deterministic. This means for them it is sufficient to compare the memory
   // blocks to determine if two shapes are identical.
-  enum class RepKind : uint8_t { kRep16, kRep32, kRepExternal };
+  enum class RepKind : uint8_t { kRep16, kRep32, kRepPacked, kRepExternal };
 
   struct Rep16 {
     uint16_t dims[7];
@@ -134,8 +138,42 @@ class TensorShape {
     uint8_t rank;
   };
 
+  // Dimension `i` takes the bits [i * width, (i + 1) * width) of `bits`, where
+  // width is kPackedBits / rank.
+  static constexpr int kPackedBits = 112;
+  static constexpr int kMinPackedRank = 4;
+  static constexpr int kMaxPackedRank = 6;
+  struct RepPacked {
+    uint8_t bits[kPackedBits / 8];
+    RepKind kind;
+    uint8_t rank;
+  };
+
+  // The out of line dimensions of a RepExternal shape, together with their
+  // product.  They are immutable once built and shared by all copies of the
+  // shape, so copying a TensorShape never allocates.
+  class ExternalDims : public ReferenceCounted<ExternalDims> {
+   public:
+    static ExternalDims* Create(int rank) {
+      void* mem = ::operator new(sizeof(ExternalDims) + rank * sizeof(size_t));
+      return new (mem) ExternalDims();
+    }
+
+    size_t* dims() { return reinterpret_cast<size_t*>(this + 1); }
+
+    ssize_t num_elements = 1;
+
+   private:
+    friend class ReferenceCounted<ExternalDims>;
+
+    void Destroy() {
+      this->~ExternalDims();
+      ::operator delete(this);
+    }
+  };
+
   struct RepExternal {
-    size_t* dims;
+    ExternalDims* dims;
 
     // FIXME: This isn't correct for big endian systems.  static_asserts should
     // catch this below.
@@ -147,6 +185,7 @@ class TensorShape {
   union {
     Rep16 rep16;
     Rep32 rep32;
+    RepPacked rep_packed;
     RepExternal rep_external;
   } representation_;
 
@@ -156,6 +195,10 @@ class TensorShape {
   bool IsRepresentationExternal() const {
     return GetRepresentationKind() == RepKind::kRepExternal;
   }
+
+  // Read and write dimension `dim_idx` of a RepPacked shape.
+  size_t GetPackedDimension(int dim_idx) const;
+  void SetPackedDimension(int dim_idx, size_t dim);
 };
 
 // Represents the shape of a tensor when the shape is known at C++ compile time.
@@ -322,10 +365,27 @@ inline TensorShape::TensorShape(ArrayRef<T> dims) {
     ++next_dim;
   }
 
+  // Next, check whether the dims fit into the packed representation.
+  if (rank >= kMinPackedRank && rank <= kMaxPackedRank) {
+    const int width = kPackedBits / rank;
+    bool fits = true;
+    for (size_t i = 0; i != rank; ++i)
+      fits &= (uint64_t(dims[i]) >> width) == 0;
+    if (fits) {
+      representation_.rep_packed.kind = RepKind::kRepPacked;
+      representation_.rep_packed.rank = rank;
+      for (size_t i = 0; i != rank; ++i) SetPackedDimension(i, dims[i]);
+      return;
+    }
+  }
+
   // Otherwise, nothing fits, use the most general representation.
-  auto* elts = new size_t[rank];
-  memcpy(elts, dims.data(), sizeof(size_t) * rank);
-  representation_.rep_external.dims = elts;
+  auto* external = ExternalDims::Create(rank);
+  for (size_t i = 0; i != rank; ++i) {
+    external->dims()[i] = dims[i];
+    external->num_elements *= dims[i];
+  }
+  representation_.rep_external.dims = external;
   representation_.rep_external.rank = rank;
   representation_.rep_external.kind = RepKind::kRepExternal;
 }
@@ -333,6 +393,7 @@ inline TensorShape::TensorShape(ArrayRef<T> dims) {
 // Return the storage representation for this TensorShape.
 inline TensorShape::RepKind TensorShape::GetRepresentationKind() const {
   static_assert(offsetof(Rep16, kind) == offsetof(Rep32, kind) &&
+                    offsetof(Rep16, kind) == offsetof(RepPacked, kind) &&
                     offsetof(Rep16, kind) == offsetof(RepExternal, kind),
                 "Layout mismatch inside of TensorShape");
   // Because all of the representations store their kind in the same place, we
@@ -349,6 +410,7 @@ inline TensorShape::RepKind TensorShape::GetRepresentationKind() const {
 // Returns the rank of this TensorShape.  The maximum rank is 255.
 inline int TensorShape::GetRank() const {
   static_assert(offsetof(Rep16, rank) == offsetof(Rep32, rank) &&
+                    offsetof(Rep16, rank) == offsetof(RepPacked, rank) &&
                     offsetof(Rep16, rank) == offsetof(RepExternal, rank),
                 "Layout mismatch inside of TensorShape");
   // Because all of the representations store their rank in the same place, we
@@ -356,54 +418,67 @@ inline int TensorShape::GetRank() const {
   return representation_.rep16.rank;
 }
 
+// A packed dimension is at most 28 bits wide, so it always lies within the
+// eight bytes starting at its first byte (clipped to the end of `bits`).
+inline size_t TensorShape::GetPackedDimension(int dim_idx) const {
+  const int width = kPackedBits / GetRank();
+  const int bit = dim_idx * width;
+  const int byte = bit / 8;
+  uint64_t word = 0;
+  memcpy(&word, representation_.rep_packed.bits + byte,
+         std::min<int>(sizeof(word), kPackedBits / 8 - byte));
+  return (word >> (bit % 8)) & ((uint64_t{1} << width) - 1);
+}
+
+inline void TensorShape::SetPackedDimension(int dim_idx, size_t dim) {
+  const int width = kPackedBits / GetRank();
+  const int bit = dim_idx * width;
+  const int byte = bit / 8;
+  uint64_t word = 0;
+  const int num_bytes = std::min<int>(sizeof(word), kPackedBits / 8 - byte);
+  memcpy(&word, representation_.rep_packed.bits + byte, num_bytes);
+  word |= uint64_t{dim} << (bit % 8);
+  memcpy(representation_.rep_packed.bits + byte, &word, num_bytes);
+}
+
 inline TensorShape::TensorShape(const TensorShape& rhs) {
   memcpy(&representation_, &rhs.representation_, sizeof(representation_));
-  if (rhs.IsRepresentationExternal()) {
-    auto rank = GetRank();
-    representation_.rep_external.dims = new size_t[rank];
-    memcpy(representation_.rep_external.dims,
-           rhs.representation_.rep_external.dims, rank * sizeof(size_t));
-  }
+  if (rhs.IsRepresentationExternal())
+    representation_.rep_external.dims->AddRef();
 }
 
 inline TensorShape::TensorShape(TensorShape&& rhs) {
   memcpy(&representation_, &rhs.representation_, sizeof(representation_));
 
-  // We're taking the memory from the RHS, reset it to something valid.
-  if (rhs.IsRepresentationExternal()) {
-    rhs.representation_.rep16.kind = RepKind::kRep16;
-    rhs.representation_.rep16.rank = 0;
-  }
+  // We're taking the memory from the RHS, reset it to a scalar shape.
+  if (rhs.IsRepresentationExternal())
+    memset(&rhs.representation_, 0, sizeof(rhs.representation_));
 }
 
 inline TensorShape& TensorShape::operator=(const TensorShape& rhs) {
-  if (IsRepresentationExternal()) delete[] representation_.rep_external.dims;
+  // Take the new reference first, in case `rhs` shares our external dims.
+  if (rhs.IsRepresentationExternal())
+    rhs.representation_.rep_external.dims->AddRef();
+  if (IsRepresentationExternal()) representation_.rep_external.dims->DropRef();
 
   memcpy(&representation_, &rhs.representation_, sizeof(representation_));
-  if (rhs.IsRepresentationExternal()) {
-    auto rank = GetRank();
-    representation_.rep_external.dims = new size_t[rank];
-    memcpy(representation_.rep_external.dims,
-           rhs.representation_.rep_external.dims, rank * sizeof(size_t));
-  }
   return *this;
 }
 
 inline TensorShape& TensorShape::operator=(TensorShape&& rhs) {
-  if (IsRepresentationExternal()) delete[] representation_.rep_external.dims;
+  if (this == &rhs) return *this;
+  if (IsRepresentationExternal()) representation_.rep_external.dims->DropRef();
 
   memcpy(&representation_, &rhs.representation_, sizeof(representation_));
 
-  // We're taking the memory from the RHS, reset it to something valid.
-  if (rhs.IsRepresentationExternal()) {
-    rhs.representation_.rep16.kind = RepKind::kRep16;
-    rhs.representation_.rep16.rank = 0;
-  }
+  // We're taking the memory from the RHS, reset it to a scalar shape.
+  if (rhs.IsRepresentationExternal())
+    memset(&rhs.representation_, 0, sizeof(rhs.representation_));
   return *this;
 }
 
 inline TensorShape::~TensorShape() {
-  if (IsRepresentationExternal()) delete[] representation_.rep_external.dims;
+  if (IsRepresentationExternal()) representation_.rep_external.dims->DropRef();
 }
 
 template <size_t Rank>
@@ -14,25 +14,57 @@
  * limitations under the License.
  */
 
-// Xprof Tracing Consumer
+// Simple Tracing Sink
 //
-// This file declares a simple tracing consumer.
+// This file declares a tracing sink which records activities into per-thread
+// buffers and exports them in the Chrome trace event format.
 
 #ifndef TFRT_TRACING_SIMPLE_TRACING_SINK_H_
 #define TFRT_TRACING_SIMPLE_TRACING_SINK_H_
 
+#include <memory>
+#include <string>
+
 #include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
 namespace tracing {
 
+// Each thread records its activities into a lock-free ring buffer of
+// fixed-size records with interned names and steady clock timestamps. While
+// tracing is enabled, a background thread moves the records out of the
+// buffers. Records are dropped when a buffer is full.
+//
+// Activities on tracks and counters are rare in comparison, and are recorded
+// under a lock. Tracks are exported as the threads of a separate process.
 class SimpleTracingSink : public TracingSink {
  public:
+  // The activities are written to `trace_file` whenever tracing is disabled,
+  // unless the file name is empty.
+  explicit SimpleTracingSink(std::string trace_file = {});
+  ~SimpleTracingSink() override;
+
   Error RequestTracing(bool enable) override;
   void RecordTracingEvent(NameGenerator gen_name) override;
   void PushTracingScope(NameGenerator gen_name) override;
   void PopTracingScope() override;
+  void RecordTracingFlow(uint64_t flow_id) override;
+  void RecordTracePointEvent(const TracePoint& trace_point) override;
+  void PushTracePointScope(const TracePoint& trace_point) override;
+  void RecordTracingActivity(NameGenerator gen_name, string_view track,
+                             TimePoint begin, TimePoint end,
+                             uint64_t flow_id) override;
+  void RecordTracingCounter(NameGenerator gen_name, int64_t value) override;
+
+  // Writes the activities recorded so far in the Chrome trace event JSON
+  // format, which can be viewed in chrome://tracing or ui.perfetto.dev.
+  void ExportChromeTrace(raw_ostream& os);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
 };
+
 }  // namespace tracing
 }  // namespace tfrt
 
@@ -22,6 +22,7 @@
 #define TFRT_TRACING_TRACING_H_
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 
 #include "llvm/ADT/StringRef.h"
@@ -30,9 +31,31 @@
 namespace tfrt {
 namespace tracing {
 
+// A tracing activity with a name that is known before the activity is
+// recorded, e.g. a string literal or the name of a kernel. Trace points are
+// identified by their address, and sinks may cache per-name state in them
+// instead of generating and looking up the name of each activity.
+class TracePoint {
+ public:
+  constexpr explicit TracePoint(string_view name) : name_(name) {}
+
+  TracePoint(const TracePoint&) = delete;
+  TracePoint& operator=(const TracePoint&) = delete;
+
+  string_view name() const { return name_; }
+
+  // Opaque data of the sink, initially zero.
+  std::atomic<uint64_t>& sink_data() const { return sink_data_; }
+
+ private:
+  const string_view name_;
+  mutable std::atomic<uint64_t> sink_data_{0};
+};
+
 class TracingSink {
  public:
   using NameGenerator = llvm::function_ref<std::string()>;
+  using TimePoint = std::chrono::steady_clock::time_point;
 
   virtual ~TracingSink();
 
@@ -51,8 +74,32 @@ class TracingSink {
   // May be called after trace recording has been disabled.
   virtual void PopTracingScope() = 0;
 
+  // Records a step of the flow `flow_id` in the calling thread's innermost
+  // scope. Flows connect the scopes of an activity which hops across threads
+  // or tasks, e.g. the execution of a request.
+  virtual void RecordTracingFlow(uint64_t flow_id) {}
+
+  // Records an activity from `begin` to `end` on the track named `track`
+  // instead of the calling thread, e.g. work on a GPU stream whose timing is
+  // only known after it has completed. A non-zero `flow_id` adds the activity
+  // to that flow.
+  virtual void RecordTracingActivity(NameGenerator gen_name, string_view track,
+                                     TimePoint begin, TimePoint end,
+                                     uint64_t flow_id) {}
+
+  // Records the current value of the counter named by `gen_name`, e.g. the
+  // memory in use by an allocator.
+  virtual void RecordTracingCounter(NameGenerator gen_name, int64_t value) {}
+
   // The following functions forward to the above. Derived classes can override
   // them as an optimization if their sinks consume the corresponding type.
+
+  virtual void RecordTracePointEvent(const TracePoint& trace_point) {
+    RecordTracingEvent([&] { return trace_point.name().str(); });
+  }
+  virtual void PushTracePointScope(const TracePoint& trace_point) {
+    PushTracingScope([&] { return trace_point.name().str(); });
+  }
 };
 
 // When choosing a level, use
@@ -71,6 +118,10 @@ extern std::atomic<int> kIsTracingEnabled;
 // Stores the current tracing level. All activities which lower level will be
 // discarded.
 extern std::atomic<TracingLevel> kTracingLevel;
+
+// The current tracing level if tracing is enabled, and -1 otherwise. Caches
+// the two above for checks on hot paths.
+extern std::atomic<int> kEnabledTracingLevel;
 }  // namespace internal
 
 // Registers the tracing sink. Only one sink can be registered at any time.
@@ -93,9 +144,17 @@ inline TracingLevel GetCurrentTracingLevel() {
   return current_level;
 }
 
+// Returns whether activities of `level` are currently recorded, i.e.
+// IsTracingEnabled() && IsAboveTracingLevel(level), with a single load.
+inline bool IsTracingEnabled(TracingLevel level) {
+  return internal::kEnabledTracingLevel.load(std::memory_order_acquire) >=
+         static_cast<int>(level);
+}
+
 #else  // TFRT_DISABLE_TRACING
 // Always return false because tracing is disabled at compile time.
 constexpr inline bool IsTracingEnabled() { return false; }
+constexpr inline bool IsTracingEnabled(TracingLevel) { return false; }
 constexpr inline bool IsAboveTracingLevel(TracingLevel) { return false; }
 constexpr inline TracingLevel GetCurrentTracingLevel() {
   return TracingLevel::Default;
@@ -121,10 +180,50 @@ class TracingRequester {
 // Functions to add a tracing event.
 inline void RecordTracingEvent(TracingLevel level,
                                TracingSink::NameGenerator gen_name) {
-  if (IsTracingEnabled() && IsAboveTracingLevel(level)) {
+  if (IsTracingEnabled(level)) {
     internal::kTracingSink->RecordTracingEvent(gen_name);
   }
 }
+inline void RecordTracingEvent(TracingLevel level,
+                               const TracePoint& trace_point) {
+  if (IsTracingEnabled(level)) {
+    internal::kTracingSink->RecordTracePointEvent(trace_point);
+  }
+}
+
+// Function to add a step to a flow. Flow id zero is ignored.
+inline void RecordTracingFlow(TracingLevel level, uint64_t flow_id) {
+  if (flow_id != 0 && IsTracingEnabled(level)) {
+    internal::kTracingSink->RecordTracingFlow(flow_id);
+  }
+}
+
+// Function to add an activity with known timing to a track, see
+// TracingSink::RecordTracingActivity().
+inline void RecordTracingActivity(TracingLevel level,
+                                  TracingSink::NameGenerator gen_name,
+                                  string_view track,
+                                  TracingSink::TimePoint begin,
+                                  TracingSink::TimePoint end,
+                                  uint64_t flow_id = 0) {
+  if (IsTracingEnabled(level)) {
+    internal::kTracingSink->RecordTracingActivity(gen_name, track, begin, end,
+                                                  flow_id);
+  }
+}
+
+// Function to record the value of a counter.
+inline void RecordTracingCounter(TracingLevel level,
+                                 TracingSink::NameGenerator gen_name,
+                                 int64_t value) {
+  if (IsTracingEnabled(level)) {
+    internal::kTracingSink->RecordTracingCounter(gen_name, value);
+  }
+}
+
+// Returns a non-zero flow id. The ids of different processes are distinct with
+// high probability, so that flows can be continued in remote tasks.
+uint64_t NewTracingFlowId();
 
 // RAII class that pushes/pops a tracing scope.
 class TracingScope {
@@ -134,9 +233,13 @@ class TracingScope {
 
  public:
   TracingScope(TracingLevel level, TracingSink::NameGenerator get_name)
-      : enabled_(IsTracingEnabled() && IsAboveTracingLevel(level)) {
+      : enabled_(IsTracingEnabled(level)) {
     if (enabled_) internal::kTracingSink->PushTracingScope(get_name);
   }
+  TracingScope(TracingLevel level, const TracePoint& trace_point)
+      : enabled_(IsTracingEnabled(level)) {
+    if (enabled_) internal::kTracingSink->PushTracePointScope(trace_point);
+  }
 
   ~TracingScope() {
     if (enabled_) internal::kTracingSink->PopTracingScope();
@@ -159,6 +262,16 @@ class TracingScope {
 // `SCOPE` marks an activity with start and end, while `EVENT` marks a single
 // time point. The recommendation is to use `*_SCOPE` when the tracing activity
 // is long enough (~100ns) and `*_EVENT` otherwise.
+//
+// `TFRT_TRACE_FLOW` adds the innermost scope to the flow with the given id,
+// e.g. the trace id of a request.
+//
+// `TFRT_TRACE_COUNTER` records the current value of a counter.
+//
+// The `TFRT_TRACE_STATIC_*` variants take a string literal, which is wrapped
+// in a static TracePoint. `TFRT_TRACE_POINT_SCOPE` takes a TracePoint, e.g.
+// of a kernel. These don't construct a name when tracing is enabled, and only
+// load and compare a single flag when it is disabled.
 
 #ifndef TFRT_DISABLE_TRACING
 #define __TFRT_TRACE_GET_LEVEL(level) tfrt::tracing::TracingLevel::level
@@ -168,12 +281,36 @@ class TracingScope {
 #define TFRT_TRACE_EVENT(level, message)                             \
   ::tfrt::tracing::RecordTracingEvent(__TFRT_TRACE_GET_LEVEL(level), \
                                       [&] { return message; })
+#define TFRT_TRACE_FLOW(level, flow_id) \
+  ::tfrt::tracing::RecordTracingFlow(__TFRT_TRACE_GET_LEVEL(level), flow_id)
+#define TFRT_TRACE_COUNTER(level, name, value)                         \
+  ::tfrt::tracing::RecordTracingCounter(__TFRT_TRACE_GET_LEVEL(level), \
+                                        [&] { return name; }, value)
+// Concatenating "" only compiles for string literals.
+#define TFRT_TRACE_STATIC_SCOPE(level, name)                                 \
+  static ::tfrt::tracing::TracePoint tracing_scope_point("" name);           \
+  ::tfrt::tracing::TracingScope tracing_scope(__TFRT_TRACE_GET_LEVEL(level), \
+                                              tracing_scope_point)
+#define TFRT_TRACE_STATIC_EVENT(level, name)                                \
+  do {                                                                      \
+    static ::tfrt::tracing::TracePoint tracing_event_point("" name);        \
+    ::tfrt::tracing::RecordTracingEvent(__TFRT_TRACE_GET_LEVEL(level),      \
+                                        tracing_event_point);               \
+  } while (false)
+#define TFRT_TRACE_POINT_SCOPE(level, trace_point)                           \
+  ::tfrt::tracing::TracingScope tracing_scope(__TFRT_TRACE_GET_LEVEL(level), \
+                                              trace_point)
 
 #else  // TFRT_DISABLE_TRACING
 // Note: the above macro definitions would generate the same code as these stubs
 // because IsTracingEnabled() always returns false and all code is eliminated.
 #define TFRT_TRACE_SCOPE(level, message)
 #define TFRT_TRACE_EVENT(level, message)
+#define TFRT_TRACE_FLOW(level, flow_id)
+#define TFRT_TRACE_COUNTER(level, name, value)
+#define TFRT_TRACE_STATIC_SCOPE(level, name)
+#define TFRT_TRACE_STATIC_EVENT(level, name)
+#define TFRT_TRACE_POINT_SCOPE(level, trace_point)
 #endif  // TFRT_DISABLE_TRACING
 
 #endif  // TFRT_TRACING_TRACING_H_
@@ -14,6 +14,9 @@
 
 // This file implements core control flow related kernels.
 
+#include <deque>
+#include <vector>
+
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/function.h"
@@ -42,8 +45,53 @@ static void TFRTCall(RemainingArguments args, RemainingResults results,
   fn->Execute(exec_ctx, args.values(), results.values());
 }
 
+// Runs all `branches` with `branch_args` without waiting for `selector`, and
+// forwards `result_refs` to the results of the branch that `select_branch`
+// returns for the available `selector`. The results of the other branches are
+// dropped, so the branches must be free of side effects.
+template <typename SelectBranch>
+static void SpeculateBranches(
+    const ExecutionContext& exec_ctx, ArrayRef<const Function*> branches,
+    AsyncValue* selector, ArrayRef<AsyncValue*> branch_args,
+    SmallVector<RCReference<IndirectAsyncValue>, 4> result_refs,
+    SelectBranch select_branch) {
+  std::vector<SmallVector<RCReference<AsyncValue>, 4>> branch_results(
+      branches.size());
+  for (int i = 0, e = branches.size(); i != e; ++i) {
+    branch_results[i].resize(result_refs.size());
+    branches[i]->Execute(exec_ctx, branch_args, branch_results[i]);
+  }
+
+  selector->AndThen([exec_ctx, selector = FormRef(selector),
+                     branch_results = std::move(branch_results),
+                     result_refs = std::move(result_refs),
+                     select_branch = std::move(select_branch)]() mutable {
+    if (selector->IsError()) {
+      for (auto& result : result_refs) result->ForwardTo(selector.CopyRef());
+      return;
+    }
+
+    int branch_index = select_branch(selector.get());
+    if (branch_index < 0 || branch_index >= branch_results.size()) {
+      auto error = EmitErrorAsync(
+          exec_ctx,
+          tfrt::StrCat("branch_index invalid. branch index: ", branch_index,
+                       " # branches: ", branch_results.size()),
+          tfrt::ErrorCode::kInvalidArgument);
+      for (auto& result : result_refs) result->ForwardTo(error.CopyRef());
+      return;
+    }
+
+    auto& results = branch_results[branch_index];
+    for (int i = 0, e = result_refs.size(); i != e; ++i) {
+      result_refs[i]->ForwardTo(std::move(results[i]));
+    }
+  });
+}
+
 static void TFRTCase(RemainingArguments args, RemainingResults results,
                      RemainingFunctions branches,
+                     RemainingAttributes attributes,
                      const ExecutionContext& exec_ctx) {
   // The first argument is branch index, which must present.
   assert(args.size() >= 1);
@@ -85,11 +133,6 @@ static void TFRTCase(RemainingArguments args, RemainingResults results,
     return;
   }
 
-  // Copy `args` and add a ref to each arg. These refs will be dropped when the
-  // RCArray is destroyed. arg_refs is captured by the lambda so the kernel's
-  // arguments will be available when the closure runs.
-  RCArray<AsyncValue> arg_refs(args.values());
-
   SmallVector<RCReference<IndirectAsyncValue>, 4> result_refs;
   result_refs.reserve(results.size());
   for (int i = 0, e = results.size(); i != e; ++i) {
@@ -99,6 +142,24 @@ static void TFRTCase(RemainingArguments args, RemainingResults results,
     result_refs.push_back(std::move(result));
   }
 
+  // The compiler marks cases with cheap branches that have no side effects as
+  // speculative. Run all branches now to take them off the critical path.
+  if (attributes.size() > 0 && *attributes.Get<bool>(0)) {
+    SmallVector<const Function*, 4> branch_vector;
+    branch_vector.reserve(branches.size());
+    for (int i = 0, e = branches.size(); i != e; ++i)
+      branch_vector.push_back(&(*branches.Get(i)));
+    SpeculateBranches(exec_ctx, branch_vector, branch_index_av,
+                      args.values().drop_front(), std::move(result_refs),
+                      [](AsyncValue* index) { return index->get<int>(); });
+    return;
+  }
+
+  // Copy `args` and add a ref to each arg. These refs will be dropped when the
+  // RCArray is destroyed. arg_refs is captured by the lambda so the kernel's
+  // arguments will be available when the closure runs.
+  RCArray<AsyncValue> arg_refs(args.values());
+
   // Copy `branches` and add a ref to each branch, which is captured by the
   // lambda so the function pointers to the branches will be available when the
   // closure runs.
@@ -142,10 +203,13 @@ static void TFRTCase(RemainingArguments args, RemainingResults results,
 // Attributes: The first attribute is the true_fn, and the second attribute is
 // the false_fn. The functions must have matching signatures, and their
 // signatures must match tfrt.if's signature, exempting the extra i1 for the
-// condition.
+// condition. The optional `speculative` attribute of tfrt.cond says that both
+// functions are cheap and have no side effects, so that both can run before
+// the condition is available.
 static void TFRTIf(RemainingArguments args, RemainingResults results,
                    Attribute<Function> true_fn_const,
                    Attribute<Function> false_fn_const,
+                   RemainingAttributes attributes,
                    const ExecutionContext& exec_ctx) {
   assert(args.size() > 0);
 
@@ -187,11 +251,6 @@ static void TFRTIf(RemainingArguments args, RemainingResults results,
   // Note: At this point, the condition's availability is unknown. It was
   // unavailable when we checked above, but it may become available at any time.
 
-  // Copy `args` and add a ref to each arg. These refs will be dropped when the
-  // RCArray is destroyed. arg_refs is captured by the lambda so the kernel's
-  // arguments will be available when the closure runs.
-  RCArray<AsyncValue> arg_refs(args.values());
-
   // We need to create all the result values eagerly so we can return them
   // from the TFRTIf function, even though we don't know their types.  Use
   // an IndirectAsyncValue for this, because it can lazily get resolved.
@@ -204,6 +263,21 @@ static void TFRTIf(RemainingArguments args, RemainingResults results,
     result_refs.push_back(std::move(result));
   }
 
+  if (attributes.size() > 0 && *attributes.Get<bool>(0)) {
+    const Function* branches[] = {true_fn, false_fn};
+    SpeculateBranches(exec_ctx, branches, condition,
+                      args.values().drop_front(), std::move(result_refs),
+                      [](AsyncValue* condition) {
+                        return condition->get<bool>() ? 0 : 1;
+                      });
+    return;
+  }
+
+  // Copy `args` and add a ref to each arg. These refs will be dropped when the
+  // RCArray is destroyed. arg_refs is captured by the lambda so the kernel's
+  // arguments will be available when the closure runs.
+  RCArray<AsyncValue> arg_refs(args.values());
+
   // Dispatch when the condition becomes available.
   condition->AndThen([if_impl, true_fn_ref = FormRef(true_fn),
                       false_fn_ref = FormRef(false_fn),
@@ -223,8 +297,14 @@ static void TFRTIf(RemainingArguments args, RemainingResults results,
   });
 }
 
+// The loop-carried results of the tfrt.while iterations that may still be
+// running, oldest first.
+using WhileIterationsInFlight =
+    std::deque<SmallVector<RCReference<AsyncValue>, 4>>;
+
 static void TFRTWhileImpl(
     const ExecutionContext& exec_ctx, const Function* body_fn,
+    int32_t parallel_iterations, WhileIterationsInFlight in_flight,
     RCReference<AsyncValue> condition,
     SmallVector<RCReference<AsyncValue>, 4> body_args,
     SmallVector<RCReference<IndirectAsyncValue>, 4> while_results) {
@@ -241,6 +321,42 @@ static void TFRTWhileImpl(
   body_results.resize(while_results.size() + 1);
 
   while (!condition->IsError() && condition->get<bool>()) {
+    // The next iteration only waits for the condition, so the kernels of
+    // previous iterations that do not feed the condition can still be running.
+    // If `parallel_iterations` iterations are in flight, wait for the oldest
+    // one to produce its results before starting the next.
+    if (parallel_iterations > 0 &&
+        in_flight.size() >= static_cast<size_t>(parallel_iterations)) {
+      auto oldest = std::move(in_flight.front());
+      in_flight.pop_front();
+      bool all_available =
+          llvm::all_of(oldest, [](const RCReference<AsyncValue>& value) {
+            return value->IsAvailable();
+          });
+      if (!all_available) {
+        RunWhenReady(
+            oldest,
+            [exec_ctx, body_fn_ref = FormRef(body_fn), parallel_iterations,
+             in_flight = std::move(in_flight), condition = std::move(condition),
+             body_args = std::move(body_args),
+             while_results = std::move(while_results)]() mutable {
+              EnqueueWork(exec_ctx, [exec_ctx,
+                                     body_fn_ref = std::move(body_fn_ref),
+                                     parallel_iterations,
+                                     in_flight = std::move(in_flight),
+                                     condition = std::move(condition),
+                                     body_args = std::move(body_args),
+                                     while_results =
+                                         std::move(while_results)]() mutable {
+                TFRTWhileImpl(exec_ctx, body_fn_ref.get(), parallel_iterations,
+                              std::move(in_flight), std::move(condition),
+                              std::move(body_args), std::move(while_results));
+              });
+            });
+        return;
+      }
+    }
+
     body_fn->Execute(exec_ctx, body_arg_views, body_results);
 
     // The last result from the body is the condition for the next iteration.
@@ -261,21 +377,30 @@ static void TFRTWhileImpl(
                            // reinitialize the state.
     body_results.resize(body_args.size() + 1);
 
+    if (parallel_iterations > 0) {
+      in_flight.emplace_back();
+      for (auto& arg : body_args) in_flight.back().push_back(arg.CopyRef());
+    }
+
     if (!condition->IsAvailable()) {
       // If the condition is not ready yet, we AndThen the remaining work to it.
       auto* condition_av = condition.get();
       condition_av->AndThen(
-          [exec_ctx, body_fn_ref = FormRef(body_fn),
-           condition = std::move(condition), body_args = std::move(body_args),
+          [exec_ctx, body_fn_ref = FormRef(body_fn), parallel_iterations,
+           in_flight = std::move(in_flight), condition = std::move(condition),
+           body_args = std::move(body_args),
            while_results = std::move(while_results)]() mutable {
             // Enqueue the remaining work to the new threads to avoid stack
             // overflow.
             EnqueueWork(
                 exec_ctx, [exec_ctx, body_fn_ref = std::move(body_fn_ref),
+                           parallel_iterations,
+                           in_flight = std::move(in_flight),
                            condition = std::move(condition),
                            body_args = std::move(body_args),
                            while_results = std::move(while_results)]() mutable {
                   TFRTWhileImpl(exec_ctx, body_fn_ref.get(),
+                                parallel_iterations, std::move(in_flight),
                                 std::move(condition), std::move(body_args),
                                 std::move(while_results));
                 });
@@ -318,6 +443,10 @@ static void TFRTWhileImpl(
 //    are the same as the number and types of arguments.
 //  %body: The body function that takes the arguments and returns the results
 //    and an I1 value to indicate whether next iteration should be executed.
+//  parallel_iterations: The optional maximum number of iterations that can be
+//    in flight. An iteration starts as soon as the condition of the previous
+//    one is available, and is in flight until its results are available.
+//    Unbounded if the attribute is missing or not positive.
 //
 // The pseudo code:
 //
@@ -329,10 +458,13 @@ static void TFRTWhileImpl(
 //
 static void TFRTWhile(RemainingArguments args, RemainingResults results,
                       Attribute<Function> body_fn_const,
+                      RemainingAttributes attributes,
                       const ExecutionContext& exec_ctx) {
   assert(args.size() > 1);
 
   const Function* body_fn = &(*body_fn_const);
+  int32_t parallel_iterations =
+      attributes.size() > 0 ? *attributes.Get<int32_t>(0) : 0;
 
   assert(args.size() == results.size() + 1);
   assert(body_fn->argument_types().size() + 1 == args.size());
@@ -360,8 +492,9 @@ static void TFRTWhile(RemainingArguments args, RemainingResults results,
   }
 
   // Invoke execution of the iterations.
-  TFRTWhileImpl(exec_ctx, body_fn, FormRef(condition_av), std::move(body_args),
-                std::move(while_results));
+  TFRTWhileImpl(exec_ctx, body_fn, parallel_iterations,
+                WhileIterationsInFlight(), FormRef(condition_av),
+                std::move(body_args), std::move(while_results));
 }
 
 // This is a helper function that runs a block of iterations and sets up a
@@ -371,50 +504,25 @@ static void TFRTRepeatI32Block(
     const ExecutionContext& exec_ctx, RCReference<const Function> body_fn_ref,
     RCArray<AsyncValue> args,
     SmallVector<RCReference<IndirectAsyncValue>, 4>&& result_refs) {
-  // Temporary buffers to store intermediate arguments and results.
-  SmallVector<AsyncValue*, 8> passed_args(args.values().begin(),
-                                          args.values().end());
-
-  SmallVector<RCReference<AsyncValue>, 4> results;
-  results.resize(result_refs.size());
   auto num_fn_args = args.size();
-
   auto end = std::min(start + block_size, count_value);
 
-  for (int i = start; i < end; ++i) {
-    if (auto cancel_av = exec_ctx.GetCancelAsyncValue()) {
-      // Cancellation detected. DropRef on args if needed, set results to
-      // the cancel async value, and break out.
-      for (int arg = 0; arg != num_fn_args; ++arg) {
-        // If this is not the first iteration, destroy the loop-carried
-        // args. The first iteration uses TFRTRepeatI32's args, which we
-        // can't destroy.
-        if (i > 0) passed_args[arg]->DropRef();
-      }
-
-      for (auto& result : result_refs) {
-        result->ForwardTo(FormRef(cancel_av));
-      }
-      return;
-    }
-
-    body_fn_ref->Execute(exec_ctx, passed_args, results);
-
-    for (int arg = 0; arg != num_fn_args; ++arg) {
-      // If this is not the first iteration, destroy the loop-carried
-      // args. The first iteration uses TFRTRepeatI32's args, which we
-      // can't destroy.
-      if (i > 0) passed_args[arg]->DropRef();
-
-      // If this is not the last iteration, set up for the next
-      // iteration by copying this iteration's results to the next
-      // iteration's args.
-      if (i + 1 != count_value) {
-        passed_args[arg] = results[arg].release();
-      }
+  if (auto cancel_av = exec_ctx.GetCancelAsyncValue()) {
+    // Cancellation detected. Set results to the cancel async value. The
+    // kernels of the iterations that are already running are skipped by the
+    // executor.
+    for (auto& result : result_refs) {
+      result->ForwardTo(FormRef(cancel_av));
     }
+    return;
   }
 
+  // Run the iterations of this block. The body can reuse its execution state
+  // across the iterations instead of setting it up for each one.
+  SmallVector<RCReference<AsyncValue>, 4> results;
+  results.resize(result_refs.size());
+  body_fn_ref->ExecuteRepeatedly(exec_ctx, end - start, args.values(), results);
+
   // Forward result_refs to the actual result values from the last iteration.
   if (end >= count_value) {
     for (int i = 0, e = result_refs.size(); i != e; ++i) {
@@ -423,10 +531,11 @@ static void TFRTRepeatI32Block(
     return;
   } else {
     assert(num_fn_args > 0);
-    passed_args[0]->AndThen(
+    AsyncValue* first_result = results[0].get();
+    first_result->AndThen(
         [end, block_size, count_value, exec_ctx,
          body_fn_ref = std::move(body_fn_ref),
-         arg_refs = RCArray<AsyncValue>(llvm::makeArrayRef(passed_args)),
+         arg_refs = RCArray<AsyncValue>(llvm::makeArrayRef(results)),
          result_refs = std::move(result_refs)]() mutable {
           TFRTRepeatI32Block(end, block_size, count_value, exec_ctx,
                              std::move(body_fn_ref), std::move(arg_refs),
@@ -437,8 +546,12 @@ static void TFRTRepeatI32Block(
 
 // This takes a single i32 iteration count, plus arguments that are passed to
 // the body_fn and eventually returned.
+// The optional `parallel_iterations` attribute is the number of iterations
+// that are dispatched before waiting for the first loop-carried value of the
+// last one, 32 by default.
 static void TFRTRepeatI32(RemainingArguments args, RemainingResults results,
                           Attribute<Function> body_fn_const,
+                          RemainingAttributes attributes,
                           const ExecutionContext& exec_ctx) {
   assert(args.size() > 0 && args.size() - 1 == results.size());
 
@@ -448,12 +561,14 @@ static void TFRTRepeatI32(RemainingArguments args, RemainingResults results,
   assert(body_fn->argument_types() == body_fn->result_types() &&
          "Argument and result types of repeat body_fn must match");
 
+  int32_t parallel_iterations =
+      attributes.size() > 0 ? *attributes.Get<int32_t>(0) : 32;
+
   auto while_impl =
-      [exec_ctx](
+      [exec_ctx, parallel_iterations](
           RCReference<const Function> body_fn_ref, RCArray<AsyncValue> arg_refs,
           SmallVector<RCReference<IndirectAsyncValue>, 4> result_refs) mutable {
-        // TODO(xldrx,jingdong): Get the block_size from an optional attribute.
-        int32_t block_size = 32;
+        int32_t block_size = parallel_iterations;
         auto args = arg_refs.values();
         auto* count = args[0];
         args = args.drop_front();
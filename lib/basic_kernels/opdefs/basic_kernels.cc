@@ -316,6 +316,7 @@ static void print(OpAsmPrinter &p, RepeatI32Op op) {
   p << "tfrt.repeat.i32 ";
   p.printOperands(op.getOperands());
   if (!op->getAttrs().empty()) {
+    p << " attributes";
     p.printOptionalAttrDict(op->getAttrs());
   }
   if (op.getNumOperands() > 1) {
@@ -612,6 +613,98 @@ static LogicalResult verify(ReturnOp op) {
   return success();
 }
 
+//===----------------------------------------------------------------------===//
+// ConstantOp
+//===----------------------------------------------------------------------===//
+
+OpFoldResult ConstantI1Op::fold(ArrayRef<Attribute> operands) {
+  return valueAttr();
+}
+OpFoldResult ConstantI32Op::fold(ArrayRef<Attribute> operands) {
+  return valueAttr();
+}
+OpFoldResult ConstantI64Op::fold(ArrayRef<Attribute> operands) {
+  return valueAttr();
+}
+OpFoldResult ConstantF32Op::fold(ArrayRef<Attribute> operands) {
+  return valueAttr();
+}
+OpFoldResult ConstantF64Op::fold(ArrayRef<Attribute> operands) {
+  return valueAttr();
+}
+OpFoldResult ConstantUI32Op::fold(ArrayRef<Attribute> operands) {
+  return valueAttr();
+}
+OpFoldResult ConstantUI64Op::fold(ArrayRef<Attribute> operands) {
+  return valueAttr();
+}
+
+//===----------------------------------------------------------------------===//
+// MergeChainsOp
+//===----------------------------------------------------------------------===//
+
+OpFoldResult MergeChainsOp::fold(ArrayRef<Attribute> operands) {
+  // Drop repeated inputs and inputs from tfrt.new.chain, which are always
+  // available. Keep one of the latter if there are no other inputs.
+  SmallVector<Value, 4> new_inputs;
+  Value new_chain;
+  for (Value input : inputs()) {
+    if (input.getDefiningOp<NewChainOp>()) {
+      if (!new_chain) new_chain = input;
+    } else if (!llvm::is_contained(new_inputs, input)) {
+      new_inputs.push_back(input);
+    }
+  }
+  if (new_inputs.empty() && new_chain) new_inputs.push_back(new_chain);
+
+  // A merge of a single chain is that chain.
+  if (new_inputs.size() == 1 && new_inputs.front().getType() == getType())
+    return new_inputs.front();
+
+  if (new_inputs.size() == getNumOperands()) return {};
+  (*this)->setOperands(new_inputs);
+  return getResult();
+}
+
+//===----------------------------------------------------------------------===//
+// AddOp and MulOp
+//===----------------------------------------------------------------------===//
+
+// Folds a binary operation on constant operands of attribute type `AttrT`.
+template <typename AttrT, typename Fn>
+static Attribute FoldBinaryOp(ArrayRef<Attribute> operands, Fn fn) {
+  assert(operands.size() == 2);
+  auto lhs = operands[0].dyn_cast_or_null<AttrT>();
+  auto rhs = operands[1].dyn_cast_or_null<AttrT>();
+  if (!lhs || !rhs) return {};
+  return AttrT::get(lhs.getType(), fn(lhs.getValue(), rhs.getValue()));
+}
+
+OpFoldResult AddI32Op::fold(ArrayRef<Attribute> operands) {
+  return FoldBinaryOp<IntegerAttr>(
+      operands, [](const APInt &a, const APInt &b) { return a + b; });
+}
+OpFoldResult AddI64Op::fold(ArrayRef<Attribute> operands) {
+  return FoldBinaryOp<IntegerAttr>(
+      operands, [](const APInt &a, const APInt &b) { return a + b; });
+}
+OpFoldResult AddF32Op::fold(ArrayRef<Attribute> operands) {
+  return FoldBinaryOp<FloatAttr>(
+      operands, [](const APFloat &a, const APFloat &b) { return a + b; });
+}
+OpFoldResult AddF64Op::fold(ArrayRef<Attribute> operands) {
+  return FoldBinaryOp<FloatAttr>(
+      operands, [](const APFloat &a, const APFloat &b) { return a + b; });
+}
+OpFoldResult MulI32Op::fold(ArrayRef<Attribute> operands) {
+  return FoldBinaryOp<IntegerAttr>(
+      operands, [](const APInt &a, const APInt &b) { return a * b; });
+}
+OpFoldResult MulI64Op::fold(ArrayRef<Attribute> operands) {
+  return FoldBinaryOp<IntegerAttr>(
+      operands, [](const APInt &a, const APInt &b) { return a * b; });
+}
+
 }  // namespace tfrt
 
 //===----------------------------------------------------------------------===//
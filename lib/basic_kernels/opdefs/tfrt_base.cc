@@ -16,6 +16,7 @@
 
 #include "tfrt/basic_kernels/opdefs/tfrt_base.h"
 
+#include "mlir/IR/Builders.h"
 #include "mlir/Transforms/InliningUtils.h"
 #include "tfrt/basic_kernels/opdefs/basic_kernels.h"
 #include "tfrt/basic_kernels/opdefs/types.h"
@@ -107,4 +108,31 @@ void TFRTDialect::printType(mlir::Type type,
   }
 }
 
+mlir::Operation *TFRTDialect::materializeConstant(mlir::OpBuilder &builder,
+                                                  mlir::Attribute value,
+                                                  mlir::Type type,
+                                                  mlir::Location loc) {
+  if (auto int_attr = value.dyn_cast<mlir::IntegerAttr>()) {
+    if (type.isInteger(1))
+      return builder.create<ConstantI1Op>(loc, type, int_attr);
+    if (type.isSignlessInteger(32))
+      return builder.create<ConstantI32Op>(loc, type, int_attr);
+    if (type.isSignlessInteger(64))
+      return builder.create<ConstantI64Op>(loc, type, int_attr);
+    if (type.isUnsignedInteger(32))
+      return builder.create<ConstantUI32Op>(loc, type, int_attr);
+    if (type.isUnsignedInteger(64))
+      return builder.create<ConstantUI64Op>(loc, type, int_attr);
+  }
+
+  if (auto float_attr = value.dyn_cast<mlir::FloatAttr>()) {
+    if (type.isF32())
+      return builder.create<ConstantF32Op>(loc, type, float_attr);
+    if (type.isF64())
+      return builder.create<ConstantF64Op>(loc, type, float_attr);
+  }
+
+  return nullptr;
+}
+
 }  // namespace tfrt
@@ -92,7 +92,7 @@ size_t BefAttrEncoder::EncodeDenseAttrHeader(DType::Kind element_type,
 
   const size_t offset =
       EncodeHeader(reinterpret_cast<BefAttrBase*>(&header.base),
-                   /*alignment=*/kAttributeTensorAlignment,
+                   /*alignment=*/GetDenseAttrAlignment(rawdata_size),
                    /*element_type=*/element_type,
                    /*prefix_size=*/header.element_offset,
                    /*byte_size=*/header.element_offset + rawdata_size,
@@ -17,19 +17,23 @@
 // BEF sections other than the Functions section and keeps all strings, types,
 // and attributes as well as their offsets or indices. The second phase reads
 // all the functions and converts them to MLIR regions without resolving nested
-// regions. The third phases resolves all functions as either top level MLIR
-// functions or nested regions, and returns the MLIR module.
+// regions. The tables of the functions are read sequentially, and the kernels
+// of large files are converted in parallel. The third phases resolves all
+// functions as either top level MLIR functions or nested regions, and returns
+// the MLIR module.
 
 #include "tfrt/bef_converter/bef_to_mlir.h"
 
 #include "bef_attr_reader.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/SourceMgr.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Builders.h"
@@ -49,6 +53,10 @@
 namespace tfrt {
 namespace {
 
+// The kernels of functions are converted in parallel if at least this many
+// functions are converted and the MLIRContext allows multithreading.
+constexpr size_t kMinFunctionsForParallelConversion = 16;
+
 class BEFSections {
  public:
   BEFSections()
@@ -96,6 +104,8 @@ struct BEFFile {
 
   mlir::Location location;
 
+  uint8_t format_version = kBEFVersion0;
+
   SmallVector<string_view, 4> location_filenames;
 
   llvm::DenseMap<size_t, mlir::Location> location_positions;
@@ -110,6 +120,12 @@ struct BEFFile {
 
   std::vector<BEFFunction> function_index;
 
+  // Returns true if the tables at the start of each function use fixed width
+  // integers instead of VBR integers.
+  bool HasFixedWidthFunctionTables() const {
+    return format_version >= kBEFVersion1;
+  }
+
   // Returns the filename at `index` into LocationFilename section.
   llvm::Optional<string_view> GetLocationFilename(int index) const {
     if (index < location_filenames.size()) return location_filenames[index];
@@ -161,6 +177,10 @@ struct BEFFunctionContext {
   // Keeps the indices to FunctionIndex for each MLIR operation if it has nested
   // regions. Nested regions will be resolved after processing all functions.
   llvm::DenseMap<mlir::Operation*, ArrayRef<uint32_t>> region_references;
+
+  // Whether each function is converted. Functions that are not converted have
+  // no region body and are left out of the MLIR module.
+  std::vector<bool> converted;
 };
 
 void EmitError(mlir::Location loc, string_view message) {
@@ -172,16 +192,19 @@ void EmitWarning(mlir::Location loc, string_view message) {
 }
 
 // Reads an integer N, and then reads the following N integer items from
-// `reader`. Performs action on each item.
-mlir::LogicalResult ReadIntArray(BEFReader* reader,
-                                 std::vector<size_t>* items) {
+// `reader`. Performs action on each item. If `fixed_width` is true, the
+// integers are 4-byte integers instead of VBR integers.
+mlir::LogicalResult ReadIntArray(BEFReader* reader, std::vector<size_t>* items,
+                                 bool fixed_width = false) {
   size_t num_items;
-  if (!reader->ReadVbrInt(&num_items)) return mlir::failure();
+  if (!reader->ReadFunctionTableInt(&num_items, fixed_width))
+    return mlir::failure();
   items->clear();
   items->reserve(num_items);
   for (int i = 0; i < num_items; ++i) {
     size_t item;
-    if (!reader->ReadVbrInt(&item)) return mlir::failure();
+    if (!reader->ReadFunctionTableInt(&item, fixed_width))
+      return mlir::failure();
     items->push_back(item);
   }
   return mlir::success();
@@ -208,9 +231,12 @@ class BEFToMLIRConverter {
   mlir::LogicalResult ReadKernels(ArrayRef<uint8_t> kernels);
   mlir::LogicalResult ReadTypes(ArrayRef<uint8_t> types);
   mlir::LogicalResult ReadFunctionIndex(ArrayRef<uint8_t> function_index);
+  // Reads the functions named in `function_names` and the functions they
+  // reference, or all functions if `function_names` is empty.
   mlir::LogicalResult ReadFunctions(ArrayRef<uint8_t> functions,
                                     ArrayRef<uint8_t> attribute_names,
                                     ArrayRef<uint8_t> register_types,
+                                    ArrayRef<std::string> function_names,
                                     BEFFunctionContext* function_context);
 
   // Resolves regions in `function_context` as either top level MLIR functions
@@ -270,10 +296,24 @@ class BEFFunctionReader {
         context_(*context),
         location_(mlir::UnknownLoc::get(&context_)) {}
 
-  // Reads a function and returns the location and region body. Returns None on
-  // errors. Nested regions are not resolved yet.
+  // Reads the tables at the start of the function and its register types from
+  // `register_types`.
+  mlir::LogicalResult ReadTables(BEFReader* register_types);
+
+  // Skips the attribute names of this function in `attribute_names` without
+  // converting any kernel, and returns them. Appends the indices of the
+  // functions referenced by the kernels to `referenced_functions`. Must be
+  // called after ReadTables().
+  ArrayRef<uint8_t> SkipKernels(
+      BEFReader* attribute_names,
+      SmallVectorImpl<uint32_t>* referenced_functions);
+
+  // Reads the kernels of the function with the attribute names returned by
+  // SkipKernels(), and returns the location and region body. Returns None on
+  // errors. Nested regions are not resolved yet. Does not access the state of
+  // other function readers, so functions can be read concurrently.
   llvm::Optional<std::pair<mlir::Location, std::unique_ptr<mlir::Region>>>
-  ReadFunction(BEFReader* attribute_names, BEFReader* register_types);
+  ReadFunction(BEFReader* attribute_names);
 
  private:
   // RegisterInfo keeps properties of a register used in this function (eg.
@@ -300,6 +340,12 @@ class BEFFunctionReader {
   mlir::LogicalResult ReadKernelTable();
   mlir::LogicalResult ReadResultRegs();
 
+  // Reads an integer of the tables at the start of the function.
+  bool ReadTableInt(size_t* value) {
+    return function_reader_.ReadFunctionTableInt(
+        value, bef_file_.HasFixedWidthFunctionTables());
+  }
+
   // Reads kernels from `kernels` which contains kernel entries of all kernels
   // in this function, and inserts them as MLIR operations into `block`.
   // Attribute names are read from `attribute_names`.
@@ -330,6 +376,7 @@ class BEFFunctionReader {
   mlir::MLIRContext& context_;
 
   mlir::Location location_;
+  ArrayRef<uint32_t> kernels_;
   std::vector<RegisterInfo> register_table_;
   std::vector<KernelTableEntry> kernel_table_;
   SmallVector<int, 2> result_regs_;
@@ -343,9 +390,11 @@ mlir::LogicalResult BEFToMLIRConverter::ReadHeader() {
     EmitError(bef_file_.location, "Invalid BEF file header detected");
     return mlir::failure();
   }
-  if (!file_reader_.ReadByte(&byte) || (byte != kBEFVersion0)) {
+  if (!file_reader_.ReadByte(&byte) ||
+      (byte != kBEFVersion0 && byte != kBEFVersion1)) {
     EmitError(bef_file_.location, "Unknown BEF format version detected");
   }
+  bef_file_.format_version = byte;
   return mlir::success();
 }
 
@@ -541,7 +590,8 @@ mlir::LogicalResult BEFToMLIRConverter::ReadFunctionIndex(
 
 mlir::LogicalResult BEFToMLIRConverter::ReadFunctions(
     ArrayRef<uint8_t> functions, ArrayRef<uint8_t> attribute_names,
-    ArrayRef<uint8_t> register_types, BEFFunctionContext* function_context) {
+    ArrayRef<uint8_t> register_types, ArrayRef<std::string> function_names,
+    BEFFunctionContext* function_context) {
   // Set up the readers for attribute names and register types. Attribute names
   // and register types will be read if they exist.
   BEFReader attribute_names_reader(attribute_names);
@@ -555,24 +605,96 @@ mlir::LogicalResult BEFToMLIRConverter::ReadFunctions(
     register_types_reader.ReadVbrInt(&num_reg_type_tables);
   }
 
-  // Process all functions.
-  for (const auto& bef_function : bef_file_.function_index) {
-    if (bef_function.IsNativeFunction()) {
-      // Special handling for native functions.
+  // The register types and attribute names of all functions are stored one
+  // function after another, so the tables of all functions are read first to
+  // find the attribute names of each function. This does not create any MLIR
+  // operation.
+  const auto& function_index = bef_file_.function_index;
+  const size_t num_functions = function_index.size();
+  std::vector<llvm::DenseMap<mlir::Operation*, ArrayRef<uint32_t>>>
+      region_references(num_functions);
+  std::vector<std::unique_ptr<BEFFunctionReader>> function_readers(
+      num_functions);
+  std::vector<ArrayRef<uint8_t>> function_attribute_names(num_functions);
+  std::vector<SmallVector<uint32_t, 4>> referenced_functions(num_functions);
+  for (size_t i = 0; i < num_functions; ++i) {
+    const auto& bef_function = function_index[i];
+    // Native functions have no body in the Functions section.
+    if (bef_function.IsNativeFunction()) continue;
+
+    auto function = functions.drop_front(bef_function.function_offset);
+    function_readers[i] = std::make_unique<BEFFunctionReader>(
+        function, bef_file_, bef_function, &region_references[i], &context_);
+    if (mlir::failed(function_readers[i]->ReadTables(&register_types_reader)))
+      return mlir::failure();
+    function_attribute_names[i] = function_readers[i]->SkipKernels(
+        &attribute_names_reader, &referenced_functions[i]);
+  }
+
+  // Select the requested functions and the functions they reference, either as
+  // callees or as nested regions.
+  auto& converted = function_context->converted;
+  converted.assign(num_functions, function_names.empty());
+  if (!function_names.empty()) {
+    SmallVector<uint32_t, 16> worklist;
+    for (const auto& name : function_names) {
+      auto it = llvm::find_if(function_index, [&](const BEFFunction& function) {
+        return function.IsNamedFunction() && function.name == name;
+      });
+      if (it == function_index.end()) {
+        EmitError(bef_file_.location, "Unknown function: " + name);
+        return mlir::failure();
+      }
+      uint32_t index = it - function_index.begin();
+      if (!converted[index]) {
+        converted[index] = true;
+        worklist.push_back(index);
+      }
+    }
+    while (!worklist.empty()) {
+      uint32_t index = worklist.pop_back_val();
+      for (uint32_t referenced : referenced_functions[index]) {
+        // Unknown functions are reported when the kernels are read.
+        if (referenced < num_functions && !converted[referenced]) {
+          converted[referenced] = true;
+          worklist.push_back(referenced);
+        }
+      }
+    }
+  }
+
+  // Convert the kernels of each function. Function readers only share the
+  // read-only `bef_file_`, so functions can be converted in parallel.
+  std::vector<
+      llvm::Optional<std::pair<mlir::Location, std::unique_ptr<mlir::Region>>>>
+      loc_and_regions(num_functions);
+  auto read_function = [&](size_t i) {
+    if (!converted[i] || !function_readers[i]) return;
+    BEFReader attribute_names_reader(function_attribute_names[i]);
+    loc_and_regions[i] =
+        function_readers[i]->ReadFunction(&attribute_names_reader);
+    function_readers[i].reset();
+  };
+  if (context_.isMultithreadingEnabled() &&
+      llvm::count(converted, true) >= kMinFunctionsForParallelConversion) {
+    llvm::parallelForEachN(0, num_functions, read_function);
+  } else {
+    for (size_t i = 0; i < num_functions; ++i) read_function(i);
+  }
+
+  for (size_t i = 0; i < num_functions; ++i) {
+    if (converted[i] && !function_index[i].IsNativeFunction()) {
+      if (!loc_and_regions[i]) return mlir::failure();
       function_context->regions.push_back(
-          {mlir::UnknownLoc::get(&context_), nullptr});
+          std::move(loc_and_regions[i]).getValue());
     } else {
-      // BEF functions are handled here. It reads the function body from the
-      // Functions section in BEF.
-      auto function = functions.drop_front(bef_function.function_offset);
-      BEFFunctionReader function_reader(function, bef_file_, bef_function,
-                                        &function_context->region_references,
-                                        &context_);
-      auto loc_and_region = function_reader.ReadFunction(
-          &attribute_names_reader, &register_types_reader);
-      if (!loc_and_region) return mlir::failure();
-      function_context->regions.push_back(std::move(loc_and_region).getValue());
+      // Native functions and functions that are not converted have no region
+      // body.
+      function_context->regions.push_back(
+          {mlir::UnknownLoc::get(&context_), nullptr});
     }
+    function_context->region_references.insert(region_references[i].begin(),
+                                               region_references[i].end());
   }
   return mlir::success();
 }
@@ -614,7 +736,7 @@ mlir::LogicalResult BEFToMLIRConverter::ResolveFunctions(
   // Resolve top level functions.
   for (int i = 0; i < bef_file_.function_index.size(); ++i) {
     auto& bef_function = bef_file_.function_index[i];
-    if (bef_function.IsNamedFunction()) {
+    if (bef_function.IsNamedFunction() && function_context->converted[i]) {
       auto& region = function_context->regions.at(i);
       if (bef_function.IsNativeFunction()) {
         // Resolve native functions.
@@ -679,17 +801,15 @@ mlir::LogicalResult BEFToMLIRConverter::AddCompilationUnits(
   return mlir::success();
 }
 
-llvm::Optional<std::pair<mlir::Location, std::unique_ptr<mlir::Region>>>
-BEFFunctionReader::ReadFunction(BEFReader* attribute_names,
-                                BEFReader* register_types) {
+mlir::LogicalResult BEFFunctionReader::ReadTables(BEFReader* register_types) {
   auto emit_error = [this](string_view message) {
     EmitError(bef_file_.location, message);
-    return llvm::None;
+    return mlir::failure();
   };
 
   // Read function location.
   size_t location_position_offset;
-  if (!function_reader_.ReadVbrInt(&location_position_offset))
+  if (!ReadTableInt(&location_position_offset))
     return emit_error("Failed to read function location");
   auto location = bef_file_.GetLocationPosition(location_position_offset);
   if (!location) return emit_error("Failed to read function location");
@@ -702,21 +822,50 @@ BEFFunctionReader::ReadFunction(BEFReader* attribute_names,
   if (mlir::failed(ReadResultRegs()))
     return emit_error("Failed to read result regs.");
 
+  // Kernels are 4-byte aligned.
+  if (!function_reader_.ReadAlignment(kKernelEntryAlignment))
+    return emit_error("Failed to read kernels.");
+  kernels_ = llvm::makeArrayRef(
+      reinterpret_cast<const uint32_t*>(function_reader_.file().begin()),
+      function_reader_.file().size() / kKernelEntryAlignment);
+  return mlir::success();
+}
+
+ArrayRef<uint8_t> BEFFunctionReader::SkipKernels(
+    BEFReader* attribute_names,
+    SmallVectorImpl<uint32_t>* referenced_functions) {
+  // The attribute names of a function are the number of kernels followed by
+  // the names of the attributes of each kernel, except for the arguments
+  // pseudo kernel. Reading stops at the first error, as in ReadKernels().
+  auto start = attribute_names->file();
+  size_t num_kernels;
+  bool has_attribute_names = attribute_names->ReadVbrInt(&num_kernels);
+  for (int i = 1; i < kernel_table_.size(); ++i) {
+    auto offset = kernel_table_[i].offset;
+    assert(offset % kKernelEntryAlignment == 0);
+    BEFKernel kernel(kernels_.data() + offset / kKernelEntryAlignment);
+    for (int j = 0; has_attribute_names && j < kernel.num_attributes(); ++j) {
+      size_t attribute_name_offset;
+      has_attribute_names = attribute_names->ReadVbrInt(&attribute_name_offset);
+    }
+    auto functions = kernel.GetFunctions();
+    referenced_functions->append(functions.begin(), functions.end());
+  }
+  return start.drop_back(attribute_names->file().size());
+}
+
+llvm::Optional<std::pair<mlir::Location, std::unique_ptr<mlir::Region>>>
+BEFFunctionReader::ReadFunction(BEFReader* attribute_names) {
   // Create a region body for this function.
   auto region = std::make_unique<mlir::Region>();
   region->push_back(new mlir::Block());
   auto* block = &region->back();
   block->addArguments(bef_function_.argument_types);
 
-  // Kernels are 4-byte aligned.
-  if (!function_reader_.ReadAlignment(kKernelEntryAlignment) ||
-      mlir::failed(ReadKernels(
-          llvm::makeArrayRef(
-              reinterpret_cast<const uint32_t*>(
-                  function_reader_.file().begin()),
-              function_reader_.file().size() / kKernelEntryAlignment),
-          attribute_names, block)))
-    return emit_error("Failed to read kernels.");
+  if (mlir::failed(ReadKernels(kernels_, attribute_names, block))) {
+    EmitError(bef_file_.location, "Failed to read kernels.");
+    return llvm::None;
+  }
 
   return std::pair<mlir::Location, std::unique_ptr<mlir::Region>>{
       location_, std::move(region)};
@@ -729,7 +878,8 @@ mlir::LogicalResult BEFFunctionReader::ReadRegisterTable(
     reg_type_indices.clear();
 
   std::vector<size_t> reg_uses;
-  if (mlir::failed(ReadIntArray(&function_reader_, &reg_uses)))
+  if (mlir::failed(ReadIntArray(&function_reader_, &reg_uses,
+                                bef_file_.HasFixedWidthFunctionTables())))
     return mlir::failure();
 
   assert(reg_type_indices.empty() ||
@@ -752,15 +902,14 @@ mlir::LogicalResult BEFFunctionReader::ReadRegisterTable(
 
 mlir::LogicalResult BEFFunctionReader::ReadKernelTable() {
   size_t num_kernels;
-  if (!function_reader_.ReadVbrInt(&num_kernels)) return mlir::failure();
+  if (!ReadTableInt(&num_kernels)) return mlir::failure();
   for (int i = 0; i < num_kernels; ++i) {
     // stream_id is not needed to reconstruct the MLIR function.
     size_t stream_id = 0;
 
     KernelTableEntry entry;
-    if (!function_reader_.ReadVbrInt(&entry.offset) ||
-        !function_reader_.ReadVbrInt(&entry.num_operands) ||
-        !function_reader_.ReadVbrInt(&stream_id))
+    if (!ReadTableInt(&entry.offset) || !ReadTableInt(&entry.num_operands) ||
+        !ReadTableInt(&stream_id))
       return mlir::failure();
 
     kernel_table_.push_back(entry);
@@ -771,7 +920,7 @@ mlir::LogicalResult BEFFunctionReader::ReadKernelTable() {
 mlir::LogicalResult BEFFunctionReader::ReadResultRegs() {
   for (int i = 0; i < bef_function_.result_types.size(); ++i) {
     size_t register_index;
-    if (!function_reader_.ReadVbrInt(&register_index)) return mlir::failure();
+    if (!ReadTableInt(&register_index)) return mlir::failure();
     result_regs_.push_back(register_index);
   }
   return mlir::success();
@@ -989,7 +1138,8 @@ BEFFunctionReader::RegisterInfo& BEFFunctionReader::GetRegister(
 
 mlir::OwningModuleRef ConvertBEFToMLIR(mlir::Location location,
                                        ArrayRef<uint8_t> bef_file,
-                                       mlir::MLIRContext* context) {
+                                       mlir::MLIRContext* context,
+                                       ArrayRef<std::string> function_names) {
   auto emit_error = [&location](string_view message) {
     EmitError(location, message);
     return nullptr;
@@ -1033,7 +1183,8 @@ mlir::OwningModuleRef ConvertBEFToMLIR(mlir::Location location,
   if (mlir::failed(converter.ReadFunctions(
           sections.Get(BEFSectionID::kFunctions),
           sections.Get(BEFSectionID::kAttributeNames),
-          sections.Get(BEFSectionID::kRegisterTypes), &function_context)))
+          sections.Get(BEFSectionID::kRegisterTypes), function_names,
+          &function_context)))
     return emit_error("Invalid Functions section.");
 
   // The third phase resolves all functions as either top level MLIR functions
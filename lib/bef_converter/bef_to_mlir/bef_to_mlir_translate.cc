@@ -17,6 +17,7 @@
 // This file implements a mlir translation for the bef-to-mlir converter. It
 // opens up an BEF file specified on the command line and converts it to a mlir
 // file at specified location.
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
@@ -27,6 +28,13 @@
 #include "tfrt/bef_converter/bef_to_mlir.h"
 #include "tfrt/init_tfrt_dialects.h"
 
+static llvm::cl::list<std::string> bef_to_mlir_functions(  // NOLINT
+    "bef-to-mlir-functions",
+    llvm::cl::desc("Comma separated names of the functions to convert, along "
+                   "with the functions they reference. Converts all functions "
+                   "if empty."),
+    llvm::cl::CommaSeparated);
+
 namespace tfrt {
 
 mlir::OwningModuleRef BEFToMLIRTranslate(llvm::SourceMgr &source_mgr,
@@ -74,7 +82,9 @@ mlir::OwningModuleRef BEFToMLIRTranslate(llvm::SourceMgr &source_mgr,
 
   mlir::SourceMgrDiagnosticHandler source_mgr_diag_handler(source_mgr, context);
 
-  return ConvertBEFToMLIR(location, bef_file, context);
+  std::vector<std::string> function_names(bef_to_mlir_functions.begin(),
+                                          bef_to_mlir_functions.end());
+  return ConvertBEFToMLIR(location, bef_file, context, function_names);
 }
 
 }  // namespace tfrt
@@ -474,8 +474,12 @@ size_t BefAttrEmitter::GetAlignment(mlir::Attribute attr) {
     return (shape_attr.hasRank()) ? alignof(AttrShapeT) : 1;
   }
 
-  if (auto dense_elements_attr = attr.dyn_cast<mlir::DenseElementsAttr>())
-    return kAttributeTensorAlignment;
+  if (auto dense_elements_attr = attr.dyn_cast<mlir::DenseElementsAttr>()) {
+    const auto shaped_type = dense_elements_attr.getType();
+    return GetDenseAttrAlignment(
+        GetDTypeByteSize(ConvertMlirTypeToDType(shaped_type.getElementType())) *
+        shaped_type.getNumElements());
+  }
 
   if (auto array_attr = attr.dyn_cast<mlir::ArrayAttr>())
     return std::max(alignof(AttrShapeT), GetMaximumAlignment(array_attr));
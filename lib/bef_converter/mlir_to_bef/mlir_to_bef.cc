@@ -26,21 +26,28 @@
 #include "tfrt/bef_converter/mlir_to_bef.h"
 
 #include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
 
 #include "bef_attr_emitter.h"
 #include "bef_compilation_units.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/Alignment.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Block.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/OperationSupport.h"
 #include "tfrt/bef/bef_encoding.h"
@@ -63,6 +70,10 @@
 namespace tfrt {
 
 namespace {
+// Modules with at least this many functions emit them in parallel, if the
+// MLIRContext allows multithreading.
+constexpr size_t kMinFunctionsForParallelEmission = 16;
+
 // This is a simple enum used to indicate success or failure in a more
 // structured way than a simple bool.
 enum class LogicalResult { Success, Failure };
@@ -82,6 +93,60 @@ static bool IsNativeFunc(mlir::FuncOp op) {
 
 static bool IsSyncFunc(mlir::FuncOp op) { return !!op->getAttr("tfrt.sync"); }
 
+// Return the critical path priority of `op`, which is its critical path cost
+// scaled to [0, kMaxKernelPriority] relative to the critical path cost of its
+// function.
+static uint32_t GetCriticalPathPriority(
+    mlir::Operation* op, const compiler::StreamAnalysis& stream_analysis) {
+  int64_t function_cost = stream_analysis.GetCriticalPathCost(nullptr);
+  assert(function_cost > 0);
+  return stream_analysis.GetCriticalPathCost(op) * kMaxKernelPriority /
+         function_cost;
+}
+
+// Return true if the kernels in `block` form a single dependency chain, i.e.
+// each kernel has at most one user kernel, and so does the arguments pseudo
+// kernel, whose users are the kernels using block arguments and the kernels
+// with no operands. The kernels of such a block can only run one after another
+// in the order they appear in the block.
+static bool IsSequentialBlock(mlir::Block& block,
+                              const compiler::StreamAnalysis& stream_analysis) {
+  // Record `user` as the only user kernel in `single_user`. Return false if
+  // there is already a different user kernel.
+  auto add_user = [](mlir::Operation* user, mlir::Operation** single_user) {
+    if (IsReturn(user) || user == *single_user) return true;
+    if (*single_user) return false;
+    *single_user = user;
+    return true;
+  };
+
+  mlir::Operation* pseudo_kernel_user = nullptr;
+  for (auto arg : block.getArguments()) {
+    for (auto* user : arg.getUsers())
+      if (!add_user(user, &pseudo_kernel_user)) return false;
+  }
+
+  int root_stream_id = stream_analysis.GetRootStream().id();
+  for (auto& op : block) {
+    if (IsReturn(&op)) continue;
+
+    // A chain is never split into multiple streams. This is checked anyway so
+    // that the executor never runs kernels of other streams inline.
+    if (stream_analysis.GetStream(&op).id() != root_stream_id) return false;
+
+    if (op.getNumOperands() == 0 && !add_user(&op, &pseudo_kernel_user))
+      return false;
+
+    mlir::Operation* op_user = nullptr;
+    for (auto result : op.getResults()) {
+      for (auto* user : result.getUsers())
+        if (!add_user(user, &op_user)) return false;
+    }
+  }
+
+  return true;
+}
+
 static mlir::FunctionType GetRegionFunctionType(mlir::Region* region) {
   // Emit information about the type of the function.
   auto& block = region->front();
@@ -731,7 +796,10 @@ class BEFModuleEmitter : public BEFFileEmitter {
   void EmitKernels();
   void EmitTypes();
   void EmitFunctions(BEFFileEmitter* attribute_names,
-                     BEFFileEmitter* register_types);
+                     BEFFileEmitter* register_types,
+                     bool fixed_width_function_tables);
+  LogicalResult EmitNativeObjects(
+      ArrayRef<BEFNativeObjectCompiler> native_object_compilers);
 
  private:
   mlir::ModuleOp module_;
@@ -897,21 +965,35 @@ void BEFModuleEmitter::EmitTypes() {
 // This is the emitter that builds the function entry of a BEF.
 class BEFFunctionEmitter : public BEFFileEmitter {
  public:
+  // If `fixed_width_tables` is true, the tables at the start of each function
+  // use 4-byte integers as in kBEFVersion1, instead of VBR integers.
   BEFFunctionEmitter(const EntityTable& entities,
-                     const EntityIndex& entity_index)
-      : entities_(entities), entity_index_(entity_index) {}
-
-  void EmitFunction(mlir::Region* region, BEFFileEmitter* attribute_names,
+                     const EntityIndex& entity_index, bool fixed_width_tables)
+      : entities_(entities),
+        entity_index_(entity_index),
+        fixed_width_tables_(fixed_width_tables) {}
+
+  // Emit the tables at the start of the function in `region` to this emitter,
+  // and its kernel entries to `kernel_list`. The kernel entries follow the
+  // tables in the Functions section, aligned to kKernelEntryAlignment. The
+  // tables do not depend on their offset in the section, so functions can be
+  // emitted independently and appended in any order.
+  void EmitFunction(mlir::Region* region, BEFFileEmitter* kernel_list,
+                    BEFFileEmitter* attribute_names,
                     BEFFileEmitter* register_types);
 
  private:
   void EmitRegisterTable(mlir::Block* block, BEFFileEmitter* register_types);
+  // Emit an integer of the tables at the start of the function.
+  void EmitTableInt(size_t value);
   template <typename UserRange>
   void EmitKernelResultUsers(UserRange users, BEFFileEmitter* kernel_list,
                              BEFFileEmitter* kernel_body) const;
   void EmitArgumentsPseudoKernel(mlir::Block* block,
+                                 uint32_t special_attribute,
                                  BEFFileEmitter* kernel_list) const;
-  void EmitKernel(mlir::Operation* op, BEFFileEmitter* kernel_list,
+  void EmitKernel(mlir::Operation* op, uint32_t priority,
+                  BEFFileEmitter* kernel_list,
                   BEFFileEmitter* attribute_names) const;
 
   unsigned GetRegisterNumber(mlir::Value reg) const {
@@ -934,9 +1016,20 @@ class BEFFunctionEmitter : public BEFFileEmitter {
 
   const EntityTable& entities_;
   const EntityIndex& entity_index_;
+  const bool fixed_width_tables_;
 };
 
+void BEFFunctionEmitter::EmitTableInt(size_t value) {
+  if (fixed_width_tables_) {
+    assert(value <= std::numeric_limits<uint32_t>::max());
+    EmitInt4(value);
+  } else {
+    EmitVbrInt(value);
+  }
+}
+
 void BEFFunctionEmitter::EmitFunction(mlir::Region* region,
+                                      BEFFileEmitter* kernel_list,
                                       BEFFileEmitter* attribute_names,
                                       BEFFileEmitter* register_types) {
   Reset();
@@ -946,7 +1039,7 @@ void BEFFunctionEmitter::EmitFunction(mlir::Region* region,
 
   auto location_offset =
       entity_index_.GetLocationPositionOffset(region->getParentOp());
-  EmitVbrInt(location_offset);
+  EmitTableInt(location_offset);
 
   // Emit the register table.
   EmitRegisterTable(&block, register_types);
@@ -960,12 +1053,10 @@ void BEFFunctionEmitter::EmitFunction(mlir::Region* region,
 
   // Emit a count of kernels, then the offset of each kernel (from the
   // start of the kernel list) then each kernel is emitted in turn.
-  EmitVbrInt(num_kernels);
+  EmitTableInt(num_kernels);
 
   mlir::Operation* return_op = nullptr;
 
-  BEFFileEmitter kernel_list;
-
   if (attribute_names != nullptr) attribute_names->EmitVbrInt(num_kernels);
 
   // Perform stream analysis to get stream information for this function.
@@ -984,13 +1075,26 @@ void BEFFunctionEmitter::EmitFunction(mlir::Region* region,
   //  2) kernels that take no kernel arguments.
 
   // Offset of the kernel in the list.
-  EmitVbrInt(kernel_list.size());
+  EmitTableInt(kernel_list->size());
   // Pseudo has zero operands that need to be available.
-  EmitVbrInt(0);
+  EmitTableInt(0);
   // The pseudo kernel is always in the root stream.
-  EmitVbrInt(stream_analysis.GetRootStream().id());
+  EmitTableInt(stream_analysis.GetRootStream().id());
 
-  EmitArgumentsPseudoKernel(&block, &kernel_list);
+  // Function level special attributes are stored in the pseudo kernel.
+  uint32_t function_special_attribute = 0;
+  if (IsSequentialBlock(block, stream_analysis)) {
+    function_special_attribute |=
+        static_cast<uint32_t>(SpecialAttribute::kSequentialFunction);
+  }
+  if (auto func = llvm::dyn_cast<mlir::FuncOp>(region->getParentOp())) {
+    if (func->getAttr("tfrt.pure")) {
+      function_special_attribute |=
+          static_cast<uint32_t>(SpecialAttribute::kPureFunction);
+    }
+  }
+
+  EmitArgumentsPseudoKernel(&block, function_special_attribute, kernel_list);
 
   for (auto& op : block) {
     // Return kernels get special processing.
@@ -1000,31 +1104,27 @@ void BEFFunctionEmitter::EmitFunction(mlir::Region* region,
     }
 
     // Offset of the kernel in the list.
-    EmitVbrInt(kernel_list.size());
+    EmitTableInt(kernel_list->size());
     // Number of operands that need to be available before it is ready to go.
     auto num_operands_before_running = op.getNumOperands();
 
-    EmitVbrInt(num_operands_before_running);
+    EmitTableInt(num_operands_before_running);
 
     // Emit stream id from stream analysis.
     const auto& stream = stream_analysis.GetStream(&op);
-    EmitVbrInt(stream.id());
+    EmitTableInt(stream.id());
 
-    EmitKernel(&op, &kernel_list, attribute_names);
+    EmitKernel(&op, GetCriticalPathPriority(&op, stream_analysis), kernel_list,
+               attribute_names);
   }
 
   // Emit the result registers list at the end of the KERNEL_TABLE if present.
   if (return_op) {
     for (auto operand : return_op->getOperands()) {
-      EmitVbrInt(GetRegisterNumber(operand));
+      EmitTableInt(GetRegisterNumber(operand));
     }
   }
 
-  // Once we're done, we can emit the kernel data after the kernel index
-  // list. Note that kernel entries are fixed32 integers with 4-byte alignment.
-  EmitAlignment(4);
-  EmitEmitter(kernel_list);
-
   kernel_index_.clear();
 }
 
@@ -1036,7 +1136,11 @@ void BEFFunctionEmitter::EmitRegisterTable(mlir::Block* block,
 
   auto emit_register = [&](mlir::Value reg) {
     // Then the use-count.
-    reg_table.EmitVbrInt(std::distance(reg.use_begin(), reg.use_end()));
+    size_t use_count = std::distance(reg.use_begin(), reg.use_end());
+    if (fixed_width_tables_)
+      reg_table.EmitInt4(use_count);
+    else
+      reg_table.EmitVbrInt(use_count);
 
     // Emit the type index into register types section.
     reg_type_table.EmitVbrInt(entities_.GetTypeIndex(reg.getType()));
@@ -1050,7 +1154,7 @@ void BEFFunctionEmitter::EmitRegisterTable(mlir::Block* block,
     for (auto result : op.getResults()) emit_register(result);
 
   // Emit the number of registers, then the register table.
-  EmitVbrInt(num_registers);
+  EmitTableInt(num_registers);
   EmitEmitter(reg_table);
 
   // Emit the number of registers, then the register type table in register
@@ -1079,7 +1183,8 @@ void BEFFunctionEmitter::EmitKernelResultUsers(
 }
 
 void BEFFunctionEmitter::EmitArgumentsPseudoKernel(
-    mlir::Block* block, BEFFileEmitter* kernel_list) const {
+    mlir::Block* block, uint32_t special_attribute,
+    BEFFileEmitter* kernel_list) const {
   // This kernel starts with a dummy code and a dummy location. And this kernel
   // only has results and used_bys in its body.
 
@@ -1096,7 +1201,7 @@ void BEFFunctionEmitter::EmitArgumentsPseudoKernel(
   // results, including the special result for ops with no operands.
   kernel_list->EmitInt4(block->getNumArguments() + 1);
   // special_metadata
-  kernel_list->EmitInt4(0);
+  kernel_list->EmitInt4(special_attribute);
 
   BEFFileEmitter kernel_body;
   // The first result is the pseudo result used to trigger execution of kernels
@@ -1121,7 +1226,7 @@ void BEFFunctionEmitter::EmitArgumentsPseudoKernel(
   kernel_list->EmitEmitter(kernel_body);
 }
 
-void BEFFunctionEmitter::EmitKernel(mlir::Operation* op,
+void BEFFunctionEmitter::EmitKernel(mlir::Operation* op, uint32_t priority,
                                     BEFFileEmitter* kernel_list,
                                     BEFFileEmitter* attribute_names) const {
   // Each kernel starts out with an opcode record.
@@ -1204,6 +1309,9 @@ void BEFFunctionEmitter::EmitKernel(mlir::Operation* op,
     special_attribute |= static_cast<uint32_t>(SpecialAttribute::kHasDebugInfo);
   }
 
+  assert(priority <= kMaxKernelPriority);
+  special_attribute |= priority << kKernelPriorityShift;
+
   // Emit the special_metadata field of kernel header.
   kernel_list->EmitInt4(special_attribute);
 
@@ -1223,21 +1331,81 @@ void BEFFunctionEmitter::EmitKernel(mlir::Operation* op,
 }
 
 void BEFModuleEmitter::EmitFunctions(BEFFileEmitter* attribute_names,
-                                     BEFFileEmitter* register_types) {
-  BEFFunctionEmitter functions_section(entities_, entity_index_);
+                                     BEFFileEmitter* register_types,
+                                     bool fixed_width_function_tables) {
+  BEFFileEmitter functions_section;
+
+  // The parts of a function emitted by BEFFunctionEmitter, which are appended
+  // to the sections of the file in function order.
+  struct EmittedFunction {
+    EmittedFunction(const EntityTable& entities,
+                    const EntityIndex& entity_index, bool fixed_width_tables)
+        : tables(entities, entity_index, fixed_width_tables) {}
+
+    BEFFunctionEmitter tables;
+    BEFFileEmitter kernel_list;
+    BEFFileEmitter attribute_names;
+    BEFFileEmitter register_types;
+  };
+
+  // Return nullptr for native functions, which have no body.
+  auto emit_function = [&](const EntityTable::FunctionEntry& function_entry) {
+    if (function_entry.IsNative()) return std::unique_ptr<EmittedFunction>();
+    auto function = std::make_unique<EmittedFunction>(
+        entities_, entity_index_, fixed_width_function_tables);
+    function->tables.EmitFunction(
+        function_entry.region, &function->kernel_list,
+        attribute_names != nullptr ? &function->attribute_names : nullptr,
+        register_types != nullptr ? &function->register_types : nullptr);
+    return function;
+  };
+
+  auto append_function = [&](const EntityTable::FunctionEntry& function_entry,
+                             const EmittedFunction* function) {
+    // The fixed width tables of a function start at an aligned offset.
+    if (fixed_width_function_tables)
+      functions_section.EmitAlignment(kKernelEntryAlignment);
+
+    // Remember that we emitted this region to this offset.
+    entity_index_.AddFunction(function_entry.name, functions_section.size(),
+                              function_entry.type, function_entry.kind);
+    if (function == nullptr) return;
+
+    // The kernel entries are fixed32 integers with 4-byte alignment.
+    functions_section.EmitEmitter(function->tables);
+    functions_section.EmitAlignment(kKernelEntryAlignment);
+    functions_section.EmitEmitter(function->kernel_list);
+
+    if (attribute_names != nullptr)
+      attribute_names->EmitEmitter(function->attribute_names);
+    if (register_types != nullptr)
+      register_types->EmitEmitter(function->register_types);
+  };
 
   if (attribute_names != nullptr)
     attribute_names->EmitVbrInt(entities_.functions.size());
   if (register_types != nullptr)
     register_types->EmitVbrInt(entities_.functions.size());
-  for (auto function_entry : entities_.functions) {
-    // Remember that we emitted this region to this offset.
-    entity_index_.AddFunction(function_entry.name, functions_section.size(),
-                              function_entry.type, function_entry.kind);
-    if (!function_entry.IsNative()) {
-      functions_section.EmitFunction(function_entry.region, attribute_names,
-                                     register_types);
+
+  // Functions only read the entity table and index, which are complete at this
+  // point, so large modules emit them in parallel. The results are appended in
+  // the same order as in the sequential case, so that the output does not
+  // depend on the number of threads.
+  const auto& functions = entities_.functions;
+  if (module_.getContext()->isMultithreadingEnabled() &&
+      functions.size() >= kMinFunctionsForParallelEmission) {
+    std::vector<std::unique_ptr<EmittedFunction>> emitted_functions(
+        functions.size());
+    llvm::parallelForEachN(0, functions.size(), [&](size_t i) {
+      emitted_functions[i] = emit_function(functions[i]);
+    });
+    for (size_t i = 0, e = functions.size(); i != e; ++i) {
+      append_function(functions[i], emitted_functions[i].get());
+      emitted_functions[i].reset();
     }
+  } else {
+    for (const auto& function_entry : functions)
+      append_function(function_entry, emit_function(function_entry).get());
   }
 
   // TODO(hyojun): Reduce the increased peak memory usage for keeping
@@ -1273,14 +1441,86 @@ void BEFModuleEmitter::EmitFunctions(BEFFileEmitter* attribute_names,
   EmitSection(BEFSectionID::kFunctions, functions_section);
 }
 
+// Compiles the compilation units referenced by the kernels of the
+// `native_object_compilers`, and emits them to the NativeObjects section.
+LogicalResult BEFModuleEmitter::EmitNativeObjects(
+    ArrayRef<BEFNativeObjectCompiler> native_object_compilers) {
+  llvm::StringMap<const BEFNativeObjectCompiler*> compilers;
+  for (const auto& compiler : native_object_compilers)
+    for (const auto& kernel : compiler.kernels)
+      compilers[kernel] = &compiler;
+
+  BefCompilationUnits compilation_units(module_);
+  llvm::DenseSet<std::pair<const BEFNativeObjectCompiler*, mlir::Attribute>>
+      compiled;
+  std::vector<BEFNativeObject> native_objects;
+
+  LogicalResult result = LogicalResult::Success;
+  module_.walk([&](mlir::Operation* op) {
+    if (result == LogicalResult::Failure ||
+        BefCompilationUnits::IsInCompiledModule(op))
+      return;
+
+    auto it = compilers.find(op->getName().getStringRef());
+    if (it == compilers.end()) return;
+    const BEFNativeObjectCompiler* compiler = it->second;
+
+    for (auto attr : op->getAttrs()) {
+      auto symbol = attr.second.dyn_cast<mlir::SymbolRefAttr>();
+      if (!symbol || symbol.getNestedReferences().size() != 1) continue;
+
+      auto* sym_op =
+          mlir::SymbolTable::lookupSymbolIn(module_.getOperation(), symbol);
+      if (!sym_op || !BefCompilationUnits::IsInCompiledModule(sym_op))
+        continue;
+      if (!compiled.insert({compiler, symbol}).second) continue;
+
+      ArrayRef<uint8_t> serialized =
+          compilation_units.SerializedOperationData(symbol);
+      Expected<Optional<BEFNativeObject>> native_object = compiler->compile(
+          string_view(reinterpret_cast<const char*>(serialized.data()),
+                      serialized.size()),
+          symbol.getNestedReferences()[0].getValue());
+      if (auto err = native_object.takeError()) {
+        op->emitError() << "failed to compile " << symbol
+                        << " ahead of time: " << llvm::toString(std::move(err));
+        result = LogicalResult::Failure;
+        return;
+      }
+      if (native_object->hasValue())
+        native_objects.push_back(std::move(native_object->getValue()));
+    }
+  });
+  if (result == LogicalResult::Failure) return result;
+
+  BEFFileEmitter native_objects_section;
+  auto emit_bytes = [&](string_view bytes) {
+    native_objects_section.EmitVbrInt(bytes.size());
+    native_objects_section.EmitBytes(
+        {reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()});
+  };
+
+  native_objects_section.EmitVbrInt(native_objects.size());
+  for (const auto& native_object : native_objects) {
+    emit_bytes(native_object.kind);
+    emit_bytes(native_object.key);
+    emit_bytes(native_object.data);
+  }
+
+  EmitSection(BEFSectionID::kNativeObjects, native_objects_section);
+  return LogicalResult::Success;
+}
+
 // This function converts the specified MLIR module containing a host executor
 // compatible program to the BinaryExecutableFormat (BEF) format, which is the
 // low level format that the executor takes.
 //
 // On error, this emits the error message through the MLIR error handler, and
 // returns an empty std:vector.
-BefBuffer ConvertMLIRToBEF(mlir::ModuleOp module,
-                           bool disable_optional_sections) {
+BefBuffer ConvertMLIRToBEF(
+    mlir::ModuleOp module, bool disable_optional_sections,
+    bool fixed_width_function_tables,
+    ArrayRef<BEFNativeObjectCompiler> native_object_compilers) {
   BEFModuleEmitter emitter(module);
 
   // Build the entities table.
@@ -1289,7 +1529,8 @@ BefBuffer ConvertMLIRToBEF(mlir::ModuleOp module,
     return {};
 
   // Emit magic numbers and format version.
-  emitter.EmitBytes({kBEFMagic1, kBEFMagic2, kBEFVersion0});
+  uint8_t version = fixed_width_function_tables ? kBEFVersion1 : kBEFVersion0;
+  emitter.EmitBytes({kBEFMagic1, kBEFMagic2, version});
 
   BEFFileEmitter attribute_types;
   BEFFileEmitter attribute_names;
@@ -1306,15 +1547,22 @@ BefBuffer ConvertMLIRToBEF(mlir::ModuleOp module,
 
   if (disable_optional_sections) {
     emitter.EmitFunctions(/*attribute_names=*/nullptr,
-                          /*register_types=*/nullptr);
+                          /*register_types=*/nullptr,
+                          fixed_width_function_tables);
   } else {
-    emitter.EmitFunctions(&attribute_names, &register_types);
+    emitter.EmitFunctions(&attribute_names, &register_types,
+                          fixed_width_function_tables);
 
     emitter.EmitSection(BEFSectionID::kAttributeTypes, attribute_types);
     emitter.EmitSection(BEFSectionID::kAttributeNames, attribute_names);
     emitter.EmitSection(BEFSectionID::kRegisterTypes, register_types);
   }
 
+  if (!native_object_compilers.empty() &&
+      emitter.EmitNativeObjects(native_object_compilers) ==
+          LogicalResult::Failure)
+    return {};
+
   // Return the result.
   return emitter.TakeResult();
 }
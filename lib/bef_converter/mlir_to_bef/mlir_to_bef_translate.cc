@@ -21,6 +21,7 @@
 #include "mlir/IR/BuiltinOps.h"
 #include "tfrt/bef/bef_buffer.h"
 #include "tfrt/bef_converter/mlir_to_bef.h"
+#include "tfrt/bef_converter/mlir_to_bef_translate.h"
 
 static llvm::cl::opt<bool> disable_optional_sections(  // NOLINT
     "disable-optional-sections",
@@ -28,12 +29,27 @@ static llvm::cl::opt<bool> disable_optional_sections(  // NOLINT
                    "types and attribute names."),
     llvm::cl::init(false));
 
+static llvm::cl::opt<bool> fixed_width_function_tables(  // NOLINT
+    "fixed-width-function-tables",
+    llvm::cl::desc("Emit the register and kernel tables of functions with "
+                   "4-byte integers instead of VBR integers, which makes them "
+                   "faster to decode."),
+    llvm::cl::init(false));
+
 namespace tfrt {
 
 mlir::LogicalResult MLIRToBEFTranslate(mlir::ModuleOp module,
                                        llvm::raw_ostream& output) {
-  BefBuffer bef_file =
-      tfrt::ConvertMLIRToBEF(module, disable_optional_sections);
+  return MLIRToBEFWithNativeObjectsTranslate(module, output,
+                                             /*native_object_compilers=*/{});
+}
+
+mlir::LogicalResult MLIRToBEFWithNativeObjectsTranslate(
+    mlir::ModuleOp module, llvm::raw_ostream& output,
+    ArrayRef<BEFNativeObjectCompiler> native_object_compilers) {
+  BefBuffer bef_file = tfrt::ConvertMLIRToBEF(
+      module, disable_optional_sections, fixed_width_function_tables,
+      native_object_compilers);
   if (bef_file.empty()) return mlir::failure();
 
   // Success!
@@ -14,22 +14,34 @@
 
 // This file implements the Executor for BEF files.
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
+#include <deque>
 
 #include "bef_file_impl.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "tfrt/bef/bef_encoding.h"
 #include "tfrt/bef/bef_reader.h"
+#include "tfrt/bef_executor/bef_execution_options.h"
+#include "tfrt/bef_executor/bef_kernel_profiler.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/kernel_frame.h"
 #include "tfrt/host_context/location.h"
+#include "tfrt/host_context/sync_kernel_frame.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
 #include "tfrt/tracing/tracing.h"
 
 #ifdef DEBUG_BEF_EXECUTOR
@@ -75,6 +87,55 @@ LLVM_ATTRIBUTE_ALWAYS_INLINE void SetRegisterValue(
   }
 }
 
+// Run the sync kernel `kernel_fn` in an async function. The kernel reads the
+// payloads of the arguments in `kernel_frame` in place, and emplaces its
+// results directly into available AsyncValues.
+LLVM_ATTRIBUTE_NOINLINE void RunSyncKernel(SyncKernelImplementation kernel_fn,
+                                           KernelFrameBuilder* kernel_frame) {
+  const int num_arguments = kernel_frame->GetNumArgs();
+  SmallVector<Value, 4> arguments;
+  arguments.resize(num_arguments);
+  SmallVector<Value*, 4> registers;
+  SmallVector<uint32_t, 4> argument_indices;
+  for (int i = 0; i < num_arguments; ++i) {
+    AsyncValue* argument = kernel_frame->GetArgAt(i);
+    if (!argument->IsConcrete()) {
+      kernel_frame->ReportError("sync kernels cannot be non-strict");
+      return;
+    }
+    argument->BorrowValue(&arguments[i]);
+    registers.push_back(&arguments[i]);
+    argument_indices.push_back(i);
+  }
+
+  SmallVector<const void*, 4> attributes;
+  for (int i = 0, e = kernel_frame->GetNumAttributes(); i != e; ++i)
+    attributes.push_back(kernel_frame->GetAttribute(i));
+
+  SyncKernelFrameBuilder sync_frame(registers,
+                                    kernel_frame->GetExecutionContext());
+  sync_frame.SetArguments(argument_indices);
+  sync_frame.SetAttributes(attributes);
+  sync_frame.SetAsyncResults(kernel_frame->GetResults());
+  kernel_fn(&sync_frame);
+
+  Error error = sync_frame.TakeError();
+  if (!error) {
+    for (auto& result : kernel_frame->GetResults()) {
+      if (!result) {
+        error = MakeStringError("sync kernel did not set all of its results");
+        break;
+      }
+    }
+  }
+  if (error) {
+    // Results that the kernel did emplace are replaced with the error.
+    auto error_value = kernel_frame->EmitError(StrCat(error));
+    for (auto& result : kernel_frame->GetResults())
+      result = error_value.CopyRef();
+  }
+}
+
 llvm::ArrayRef<unsigned> GetNextUsedBys(const BEFKernel& kernel,
                                         int result_number, int* entry_offset) {
   // Find used_by entries for this result.
@@ -86,6 +147,21 @@ llvm::ArrayRef<unsigned> GetNextUsedBys(const BEFKernel& kernel,
   return used_bys;
 }
 
+// Return the index in `kernel_ids` of the kernel with the highest critical
+// path priority. Among kernels with the same priority, the last one is chosen,
+// so that the most recently enqueued kernel wins when there are no priorities.
+size_t FindHighestPriorityKernel(ArrayRef<BEFFileImpl::KernelInfo> kernel_array,
+                                 ArrayRef<unsigned> kernel_ids) {
+  assert(!kernel_ids.empty());
+  size_t best = kernel_ids.size() - 1;
+  for (size_t i = best; i-- > 0;) {
+    if (kernel_array[kernel_ids[i]].priority >
+        kernel_array[kernel_ids[best]].priority)
+      best = i;
+  }
+  return best;
+}
+
 // ReadyKernelQueue is used for managing ready-to-run kernels in one sequential
 // path.
 class ReadyKernelQueue {
@@ -152,6 +228,15 @@ class ReadyKernelQueue {
     }
   }
 
+  // Switch this queue to `stream_id` and make `kernel_ids`, which must all be
+  // ready, the inline kernels. The queue must be empty.
+  void Reset(int stream_id, std::vector<unsigned> kernel_ids) {
+    assert(inline_kernel_ids_.empty());
+    assert(outline_kernel_ids_.empty());
+    stream_id_ = stream_id;
+    inline_kernel_ids_ = std::move(kernel_ids);
+  }
+
   // `inline_kernel_ids` contains the kernels to be executed in the same thread.
   std::vector<unsigned>& inline_kernel_ids() { return inline_kernel_ids_; }
 
@@ -174,8 +259,213 @@ class ReadyKernelQueue {
   std::vector<unsigned> outline_kernel_ids_;
 };
 
+// ReadyStreamPool holds ready kernels that are not yet claimed by any thread,
+// grouped by stream id, for the kStreamStealing scheduling mode. Threads that
+// run out of kernels on their own stream take a whole stream from the pool.
+// The pool also tracks the number of worker tasks launched for it, so that an
+// executor never has more than `max_workers` tasks in the work queue.
+class ReadyStreamPool {
+ public:
+  // If `prioritize_critical_path` is true, TakeReadyStream() takes the stream
+  // with the highest priority kernel instead of the oldest one.
+  ReadyStreamPool(int max_workers, bool prioritize_critical_path)
+      : max_workers_(max_workers),
+        prioritize_critical_path_(prioritize_critical_path) {
+    assert(max_workers_ > 0);
+  }
+
+  // Add `kernel_ids` to the pool and clear it. Return the number of new worker
+  // tasks the caller needs to launch to process the pool.
+  int AddReadyKernels(MutableArrayRef<BEFFileImpl::KernelInfo> kernel_array,
+                      std::vector<unsigned>& kernel_ids) {
+    mutex_lock lock(mu_);
+    for (unsigned kernel_id : kernel_ids) {
+      assert(kernel_id < kernel_array.size());
+      unsigned stream_id = kernel_array[kernel_id].stream_id;
+      auto& stream_kernels = ready_kernels_[stream_id];
+      if (stream_kernels.kernel_ids.empty())
+        ready_streams_.push_back(stream_id);
+      stream_kernels.kernel_ids.push_back(kernel_id);
+      stream_kernels.max_priority = std::max(stream_kernels.max_priority,
+                                             kernel_array[kernel_id].priority);
+    }
+    kernel_ids.clear();
+
+    int num_new_workers = std::min<int>(max_workers_ - num_workers_,
+                                        ready_streams_.size());
+    num_new_workers = std::max(num_new_workers, 0);
+    num_workers_ += num_new_workers;
+    return num_new_workers;
+  }
+
+  // Move the kernels of the oldest ready stream, or of the stream with the
+  // highest priority kernel if the pool prioritizes the critical path, to
+  // `ready_kernel_queue`. Return false if the pool is empty. If `is_worker` is
+  // true, the caller is a worker task launched for this pool and it retires
+  // when the pool is empty. This is done under the same lock as
+  // AddReadyKernels() so that no stream is left in the pool without a worker.
+  bool TakeReadyStream(ReadyKernelQueue& ready_kernel_queue, bool is_worker) {
+    mutex_lock lock(mu_);
+    if (ready_streams_.empty()) {
+      if (is_worker) --num_workers_;
+      return false;
+    }
+
+    auto stream_iter = ready_streams_.begin();
+    if (prioritize_critical_path_) {
+      for (auto iter = std::next(stream_iter); iter != ready_streams_.end();
+           ++iter) {
+        if (ready_kernels_[*iter].max_priority >
+            ready_kernels_[*stream_iter].max_priority)
+          stream_iter = iter;
+      }
+    }
+    unsigned stream_id = *stream_iter;
+    ready_streams_.erase(stream_iter);
+
+    auto it = ready_kernels_.find(stream_id);
+    assert(it != ready_kernels_.end());
+    ready_kernel_queue.Reset(stream_id, std::move(it->second.kernel_ids));
+    ready_kernels_.erase(it);
+    return true;
+  }
+
+ private:
+  struct ReadyKernels {
+    std::vector<unsigned> kernel_ids;
+    // The highest critical path priority among `kernel_ids`.
+    unsigned max_priority = 0;
+  };
+
+  const int max_workers_;
+  const bool prioritize_critical_path_;
+
+  mutex mu_;
+  // Stream ids that have ready kernels, in the order they became ready.
+  std::deque<unsigned> ready_streams_ TFRT_GUARDED_BY(mu_);
+  // Ready kernels for each stream id in `ready_streams_`.
+  llvm::DenseMap<unsigned, ReadyKernels> ready_kernels_ TFRT_GUARDED_BY(mu_);
+  // Number of worker tasks launched and not yet retired.
+  int num_workers_ TFRT_GUARDED_BY(mu_) = 0;
+};
+
 }  // namespace
 
+// BEFExecutorState is the decoded register and kernel information of a
+// BEFFunction, together with the per-execution state that the BEFExecutor
+// keeps in it (register values and kernel ready counts). It is obtained from
+// and returned to the BEFExecutorStatePool of the function, so that repeated
+// executions neither decode the function again nor allocate these arrays.
+struct BEFExecutorState {
+  BEFFileImpl::FunctionInfo function_info;
+  SmallVector<size_t, 4> result_regs;
+
+  // Prepare this state for a new execution of the function.
+  void Reset() {
+    for (auto& reg : function_info.register_infos.mutable_array())
+      reg.value = nullptr;
+    for (auto& kernel : function_info.kernel_infos.mutable_array())
+      kernel.Reset();
+  }
+};
+
+// BEFExecutorStatePool keeps a small number of BEFExecutorStates of one
+// BEFFunction for reuse. It is a fixed array of slots that are claimed and
+// returned with atomic exchanges. Each thread starts probing at its own slot,
+// so that in the steady state a thread reuses the state it released last
+// without contending with other threads.
+//
+// The states are not allocated with the HostAllocator, as a BEFFile (and hence
+// the pool) may be shared by multiple HostContexts and outlive them.
+class BEFExecutorStatePool {
+ public:
+  BEFExecutorStatePool() = default;
+  BEFExecutorStatePool(const BEFExecutorStatePool&) = delete;
+  BEFExecutorStatePool& operator=(const BEFExecutorStatePool&) = delete;
+
+  ~BEFExecutorStatePool() {
+    for (auto& slot : slots_) delete slot.load(std::memory_order_relaxed);
+  }
+
+  // Return a decoded state that is ready for a new execution of `fn`, or
+  // nullptr if `fn` can not be decoded.
+  BEFExecutorState* Acquire(const BEFFunction& fn) {
+    unsigned start = GetThreadSlot();
+    for (unsigned i = 0; i < kNumSlots; ++i) {
+      auto& slot = slots_[(start + i) % kNumSlots];
+      if (slot.load(std::memory_order_relaxed) == nullptr) continue;
+      if (auto* state = slot.exchange(nullptr, std::memory_order_acquire)) {
+        state->Reset();
+        return state;
+      }
+    }
+
+    auto state = std::make_unique<BEFExecutorState>();
+    size_t location_offset;
+    if (!fn.bef_file()->ReadFunction(fn.function_offset(), fn.result_types(),
+                                     &location_offset, &state->function_info,
+                                     &state->result_regs, GetAllocator()))
+      return nullptr;
+    return state.release();
+  }
+
+  // Return `state` to the pool after the execution using it has completed. It
+  // is deleted if the pool is full.
+  void Release(BEFExecutorState* state) {
+    unsigned start = GetThreadSlot();
+    for (unsigned i = 0; i < kNumSlots; ++i) {
+      auto& slot = slots_[(start + i) % kNumSlots];
+      BEFExecutorState* expected = nullptr;
+      if (slot.load(std::memory_order_relaxed) == nullptr &&
+          slot.compare_exchange_strong(expected, state,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed))
+        return;
+    }
+    delete state;
+  }
+
+ private:
+  static constexpr unsigned kNumSlots = 8;
+
+  static unsigned GetThreadSlot() {
+    static std::atomic<unsigned> next_slot{0};
+    thread_local unsigned slot =
+        next_slot.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+  }
+
+  // Allocator for the info arrays of the states that do not fit inline.
+  static HostAllocator* GetAllocator() {
+    static HostAllocator* allocator = CreateMallocAllocator().release();
+    return allocator;
+  }
+
+  std::atomic<BEFExecutorState*> slots_[kNumSlots] = {};
+};
+
+BEFFunction::BEFFunction(string_view name, FunctionKind function_kind,
+                         ArrayRef<TypeName> arguments,
+                         ArrayRef<TypeName> results, size_t function_offset,
+                         BEFFileImpl* bef_file)
+    : Function(name, function_kind, arguments, results),
+      function_offset_(function_offset),
+      bef_file_(bef_file),
+      sample_site_(BEFSampleSite::Get(name)),
+      // SyncBEFFunctions are not run by the BEFExecutor.
+      executor_state_pool_(function_kind == FunctionKind::kBEFFunction
+                               ? std::make_unique<BEFExecutorStatePool>()
+                               : nullptr) {}
+
+BEFFunction::BEFFunction(BEFFunction&& other)
+    : Function(std::move(other)),
+      function_offset_(other.function_offset_),
+      bef_file_(other.bef_file_),
+      sample_site_(other.sample_site_),
+      executor_state_pool_(std::move(other.executor_state_pool_)) {}
+
+BEFFunction::~BEFFunction() {}
+
 /// A BEFExecutor runs a BEF function containing a stream of asynchronous
 /// kernels. Multiple executors can be active at one time, e.g. due to
 /// concurrent control flow constructs.
@@ -185,6 +475,14 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
                       ArrayRef<AsyncValue*> arguments,
                       MutableArrayRef<RCReference<AsyncValue>> results);
 
+  // Execute `fn` `count` times like Function::ExecuteRepeatedly(). When an
+  // iteration completes synchronously, the next one reuses its executor and
+  // state instead of setting up new ones.
+  static void ExecuteRepeatedly(
+      ExecutionContext exec_ctx, const BEFFunction& fn, int32_t count,
+      ArrayRef<AsyncValue*> arguments,
+      MutableArrayRef<RCReference<AsyncValue>> results);
+
   /// When the last reference to the BEFExecutor is dropped, we deallocate
   /// ourself.  The memory for this class is managed through the HostAllocator
   /// managed by the HostContext.
@@ -195,16 +493,23 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
   }
 
  private:
-  BEFExecutor(ExecutionContext exec_ctx, BEFFileImpl* bef_file);
+  BEFExecutor(ExecutionContext exec_ctx, BEFFileImpl* bef_file,
+              const BEFFunction& fn, BEFExecutorState* state);
   ~BEFExecutor();
 
   void Execute(ArrayRef<AsyncValue*> arguments);
 
+  // Populate the function `results` from the result registers.
+  void PopulateResults(MutableArrayRef<RCReference<AsyncValue>> results);
+
  private:
   // Iteratively process ready kernels in `ready_kernel_queue` and inserts ready
   // users back for next round of processing, until there are no more ready
-  // kernels.
-  void ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue);
+  // kernels. In kStreamStealing mode, this also takes ready streams from
+  // `stream_pool_` until the pool is empty. `is_stream_worker` is true if the
+  // caller is a worker task launched by LaunchStreamWorkers().
+  void ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue,
+                           bool is_stream_worker = false);
 
   // Process the first pseudo kernel and populate its ready users in
   // `ready_kernel_queue`.
@@ -216,6 +521,21 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
   void ProcessReadyKernel(unsigned kernel_id, KernelFrameBuilder* kernel_frame,
                           ReadyKernelQueue& ready_kernel_queue);
 
+  // Run the kernel specified by `kernel_id`, leaving its results in
+  // `kernel_frame`. All arguments of the kernel must be set in the registers.
+  BEFKernel RunKernel(unsigned kernel_id, KernelFrameBuilder* kernel_frame);
+
+  // Set the results of `kernel` in `kernel_frame` to the result registers and
+  // populate the ready users in `ready_kernel_queue`.
+  void ProcessKernelResults(const BEFKernel& kernel, unsigned kernel_id,
+                            KernelFrameBuilder* kernel_frame,
+                            ReadyKernelQueue& ready_kernel_queue);
+
+  // Run the kernels of a function marked as kSequentialFunction one after
+  // another, without maintaining ready counts, and fall back to
+  // ProcessReadyKernels() once a kernel produces an unavailable value.
+  void ExecuteSequentially(ArrayRef<AsyncValue*> arguments);
+
   // Enqueue the `users` of the `result` for later processing. If the result has
   // no users, it will be skipped. If the result is immediately available, then
   // we push them to `ready_kernel_queue`, otherwise we need to enqueue them
@@ -230,32 +550,60 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
   // executed in a dfferent thread in parallel.
   void EnqueueReadyKernels(std::vector<unsigned> kernel_ids);
 
+  // Hand off the outline kernels in `ready_kernel_queue` to other threads,
+  // either by enqueueing them as a new task or by adding them to
+  // `stream_pool_`, depending on the scheduling mode.
+  void SpillOutlineKernels(ReadyKernelQueue& ready_kernel_queue);
+
+  // Launch `num_workers` tasks that process streams from `stream_pool_`.
+  void LaunchStreamWorkers(int num_workers);
+
   HostContext* GetHost() const { return exec_ctx_.host(); }
   BEFFileImpl* BefFile() const { return bef_file_.get(); }
 
-  ArrayRef<uint32_t> kernels() { return function_info_.kernels; }
+  ArrayRef<uint32_t> kernels() { return state_->function_info.kernels; }
 
   MutableArrayRef<BEFFileImpl::RegisterInfo> register_infos() {
-    return function_info_.register_infos.mutable_array();
+    return state_->function_info.register_infos.mutable_array();
   }
 
   MutableArrayRef<BEFFileImpl::KernelInfo> kernel_infos() {
-    return function_info_.kernel_infos.mutable_array();
+    return state_->function_info.kernel_infos.mutable_array();
   }
 
   void DebugPrintError(const BEFKernel& kernel, unsigned kernel_id,
                        AsyncValue* result);
 
+  // Record in `kernel_profiler_` that `users` waited for an argument since
+  // `wait_start`.
+  void RecordAsyncWait(ArrayRef<unsigned> users,
+                       std::chrono::steady_clock::time_point wait_start);
+
  private:
   friend class ReferenceCounted<BEFExecutor>;
 
   /// The execution context for this BEFExecutor.
   ExecutionContext exec_ctx_;
 
-  /// Decoded BEFFunction
-  BEFFileImpl::FunctionInfo function_info_;
+  /// The function being executed.
+  const BEFFunction& fn_;
+
+  /// Decoded BEFFunction and its execution state. It is owned by this executor
+  /// and returned to the pool of `fn_` when this executor is destroyed.
+  BEFExecutorState* state_;
 
   RCReference<BEFFileImpl> bef_file_;
+
+  /// Ready streams waiting for a thread in kStreamStealing mode. It is null in
+  /// kInlineOutline mode.
+  std::unique_ptr<ReadyStreamPool> stream_pool_;
+
+  /// The profiler from BEFExecutionOptions, or null if kernels are not
+  /// profiled.
+  BEFKernelProfiler* kernel_profiler_ = nullptr;
+
+  /// Whether ready kernels are picked by their critical path priority.
+  bool prioritize_critical_path_ = false;
 };
 
 //===----------------------------------------------------------------------===//
@@ -302,8 +650,13 @@ LLVM_ATTRIBUTE_ALWAYS_INLINE void BEFExecutor::ProcessUsedBysAndSetRegister(
   // content. This is fine because the underlying BEF file is supposed to be
   // alive when the BEF executor is alive.
   auto* result_ptr = result.get();
-  result_ptr->AndThen([this, stream_id = ready_kernel_queue.stream_id(), users,
-                       result_register, result = std::move(result)]() mutable {
+  auto wait_start = kernel_profiler_ ? std::chrono::steady_clock::now()
+                                     : std::chrono::steady_clock::time_point();
+  auto process_users = [this, stream_id = ready_kernel_queue.stream_id(),
+                        users, result_register, result = std::move(result),
+                        wait_start]() mutable {
+    if (kernel_profiler_) RecordAsyncWait(users, wait_start);
+
     ReadyKernelQueue ready_kernel_queue(stream_id, kernel_infos());
 
     // SetRegisterValue() must be done before
@@ -313,7 +666,14 @@ LLVM_ATTRIBUTE_ALWAYS_INLINE void BEFExecutor::ProcessUsedBysAndSetRegister(
     ready_kernel_queue.DecrementReadyCountAndEnqueue(users);
     this->ProcessReadyKernels(ready_kernel_queue);
     this->DropRef();
-  });
+  };
+  // The users run on the thread that produces the result, unless it already
+  // runs too many nested continuations, e.g. when a chain of asynchronous
+  // kernels completes in one go.
+  result_ptr->AndThen(
+      [this, process_users = std::move(process_users)]() mutable {
+        RunInlineOrEnqueue(exec_ctx_, std::move(process_users));
+      });
 }
 
 // Process the arguments pseudo kernel and enqueue the ready users of these
@@ -382,11 +742,29 @@ void BEFExecutor::DebugPrintError(const BEFKernel& kernel, unsigned kernel_id,
 #endif
 }
 
+LLVM_ATTRIBUTE_NOINLINE void BEFExecutor::RecordAsyncWait(
+    ArrayRef<unsigned> users,
+    std::chrono::steady_clock::time_point wait_start) {
+  auto wait_time = std::chrono::steady_clock::now() - wait_start;
+  for (unsigned kernel_id : users) {
+    BEFKernel kernel(kernels().data() +
+                     kernel_infos()[kernel_id].offset / kKernelEntryAlignment);
+    kernel_profiler_->RecordAsyncWait(BefFile(), kernel, wait_time);
+  }
+}
+
 // Process the kernel for `kernel_id` and populate `ready_kernel_queue` with
 // ready users.
 void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
                                      KernelFrameBuilder* kernel_frame,
                                      ReadyKernelQueue& ready_kernel_queue) {
+  BEFKernel kernel = RunKernel(kernel_id, kernel_frame);
+  ProcessKernelResults(kernel, kernel_id, kernel_frame, ready_kernel_queue);
+}
+
+// Run the kernel for `kernel_id`. The results are left in `kernel_frame`.
+LLVM_ATTRIBUTE_ALWAYS_INLINE BEFKernel
+BEFExecutor::RunKernel(unsigned kernel_id, KernelFrameBuilder* kernel_frame) {
   MutableArrayRef<BEFFileImpl::RegisterInfo> register_array = register_infos();
 
   assert(kernel_infos()[kernel_id].offset % kKernelEntryAlignment == 0);
@@ -398,7 +776,8 @@ void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
   // async value if the execution has been canceled.
   AsyncValue* any_error_argument = exec_ctx_.GetCancelAsyncValue();
 
-  // Find the kernel implementation of this kernel.
+  // Find the kernel implementation of this kernel, which is null for sync
+  // kernels.
   AsyncKernelImplementation kernel_fn =
       BefFile()->GetAsyncKernel(kernel.kernel_code());
 
@@ -444,6 +823,7 @@ void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
     // error.
     kernel_frame->SetLocation(
         {BefFile()->location_handler(), kernel.kernel_location()});
+    kernel_frame->SetStreamId(kernel_infos()[kernel_id].stream_id);
 
 #if !defined(TFRT_DISABLE_TRACING)
     // Pass down debug info to kernels.
@@ -453,28 +833,64 @@ void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
     // kernel_fn should populate results in kernel_frame with pointers to
     // AsyncValue before it returns.
     {
-      TFRT_TRACE_SCOPE(Debug, kernel_name);
-      kernel_fn(kernel_frame);
+      TFRT_TRACE_POINT_SCOPE(
+          Debug, BefFile()->GetKernelTracePoint(kernel.kernel_code()));
+      BEFSampleScope sample_scope(
+          fn_.sample_site(),
+          BefFile()->GetKernelSampleSite(kernel.kernel_code()));
+#if !defined(TFRT_DISABLE_TRACING)
+      // Attribute the sampled allocations of profiling allocators.
+      AllocationSiteScope allocation_site(kernel_name);
+#endif
+      auto invoke_kernel = [&] {
+        if (LLVM_LIKELY(kernel_fn != nullptr)) {
+          kernel_fn(kernel_frame);
+        } else {
+          RunSyncKernel(BefFile()->GetSyncKernel(kernel.kernel_code()),
+                        kernel_frame);
+        }
+      };
+      if (LLVM_UNLIKELY(kernel_profiler_ != nullptr) &&
+          kernel_profiler_->ShouldSample()) {
+        auto start = std::chrono::steady_clock::now();
+        invoke_kernel();
+        kernel_profiler_->RecordInvocation(
+            BefFile(), kernel, std::chrono::steady_clock::now() - start);
+      } else {
+        invoke_kernel();
+      }
     }
   } else {
-    // Otherwise, automatically propagate errors to the result values.
-    for (size_t i = 0, e = kernel_frame->GetNumResults(); i != e; ++i) {
-      kernel_frame->SetResultAt(i, FormRef(any_error_argument));
+    // Otherwise, automatically propagate errors to the result values. Add the
+    // references for all the results at once.
+    size_t num_results = kernel_frame->GetNumResults();
+    any_error_argument->AddRef(num_results);
+    for (size_t i = 0; i != num_results; ++i) {
+      kernel_frame->SetResultAt(i, TakeRef(any_error_argument));
     }
   }
 
   kernel_frame->ResetArguments();
 
+  return kernel;
+}
+
+// Publish the results of `kernel` in `kernel_frame` and populate
+// `ready_kernel_queue` with ready users.
+LLVM_ATTRIBUTE_ALWAYS_INLINE void BEFExecutor::ProcessKernelResults(
+    const BEFKernel& kernel, unsigned kernel_id,
+    KernelFrameBuilder* kernel_frame, ReadyKernelQueue& ready_kernel_queue) {
+  MutableArrayRef<BEFFileImpl::RegisterInfo> register_array = register_infos();
+
   // The following loop iterates over all results of the kernel. If a result
   // has no users, it will be skipped. If the kernel immediately completed a
   // result, then we can mark all kernels using it as ready to go, otherwise
   // we need to enqueue them on their unavailable operands.
 
-  // Move entry offset to start of results.
-  entry_offset += function_indices.size();
-  auto results = kernel.GetKernelEntries(entry_offset, kernel.num_results());
+  auto results = kernel.GetResults();
   // Move entry offset to start of all used_bys.
-  entry_offset += results.size();
+  int entry_offset = kernel.num_arguments() + kernel.num_attributes() +
+                     kernel.num_functions() + kernel.num_results();
 
   for (int result_number = 0; result_number < results.size(); ++result_number) {
     auto& result_register = register_array[results[result_number]];
@@ -516,36 +932,152 @@ LLVM_ATTRIBUTE_NOINLINE void BEFExecutor::EnqueueReadyKernels(
   });
 }
 
+// Hand off the outline kernels in `ready_kernel_queue` to other threads. In
+// kInlineOutline mode, they are enqueued as one new task. In kStreamStealing
+// mode, they are added to the ready stream pool and new workers are launched
+// only if the pool does not have enough workers yet.
+LLVM_ATTRIBUTE_ALWAYS_INLINE void BEFExecutor::SpillOutlineKernels(
+    ReadyKernelQueue& ready_kernel_queue) {
+  auto& outline_kernel_ids = ready_kernel_queue.outline_kernel_ids();
+  if (outline_kernel_ids.empty()) return;
+
+  if (!stream_pool_) {
+    // The new task runs the stream of its first kernel inline, so put the
+    // highest priority kernel first.
+    if (LLVM_UNLIKELY(prioritize_critical_path_)) {
+      std::swap(outline_kernel_ids.front(),
+                outline_kernel_ids[FindHighestPriorityKernel(
+                    kernel_infos(), outline_kernel_ids)]);
+    }
+    EnqueueReadyKernels(std::move(outline_kernel_ids));
+  } else {
+    int num_new_workers =
+        stream_pool_->AddReadyKernels(kernel_infos(), outline_kernel_ids);
+    if (num_new_workers > 0) LaunchStreamWorkers(num_new_workers);
+  }
+  assert(outline_kernel_ids.empty());
+}
+
+// Launch `num_workers` tasks that keep taking streams from the ready stream
+// pool until it is empty.
+LLVM_ATTRIBUTE_NOINLINE void BEFExecutor::LaunchStreamWorkers(int num_workers) {
+  // Submit the workers in one batch, so that the work queue wakes up its
+  // threads at once.
+  llvm::SmallVector<TaskFunction, 8> workers;
+  workers.reserve(num_workers);
+  for (int i = 0; i < num_workers; ++i) {
+    AddRef();
+    workers.emplace_back([this]() {
+      ReadyKernelQueue ready_kernel_queue(/*stream_id=*/0, kernel_infos());
+      ProcessReadyKernels(ready_kernel_queue, /*is_stream_worker=*/true);
+      DropRef();
+    });
+  }
+  exec_ctx_.work_queue().AddTasks(exec_ctx_, workers);
+}
+
 // Iteratively process ready kernels in `ready_kernel_queue` and inserts ready
 // users back for next round of processing, until there are no more ready
 // kernels.
-void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue) {
-  TFRT_TRACE_SCOPE(Verbose, "BEFExecutor::ProcessReadyKernels");
+void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue,
+                                      bool is_stream_worker) {
+  TFRT_TRACE_STATIC_SCOPE(Verbose, "BEFExecutor::ProcessReadyKernels");
+  TFRT_TRACE_FLOW(Verbose, exec_ctx_.trace_id());
 
   // Process the kernel record to get information about what argument
   // registers, result registers, and attributes should be passed.
   KernelFrameBuilder kernel_frame(exec_ctx_);
-  kernel_frame.SetAttributeSection(BefFile()->attribute_section_);
+  kernel_frame.SetAttributeSection(BefFile()->attribute_section_, &fn_);
   kernel_frame.SetFunctions(BefFile()->functions_);
 
-  if (!ready_kernel_queue.outline_kernel_ids().empty()) {
-    EnqueueReadyKernels(std::move(ready_kernel_queue.outline_kernel_ids()));
+  // In kStreamStealing mode, a thread that runs out of ready kernels keeps
+  // taking streams from the pool, so that the kernels are executed without
+  // going through the work queue.
+  do {
+    SpillOutlineKernels(ready_kernel_queue);
+
+    // The loop below process inline kernels in a LIFO order for cache
+    // locality, or in the order of their critical path priorities if
+    // requested. Outline kernels are handed off to other threads immediately.
+    auto& inline_kernel_ids = ready_kernel_queue.inline_kernel_ids();
+    while (!inline_kernel_ids.empty()) {
+      if (LLVM_UNLIKELY(prioritize_critical_path_)) {
+        std::swap(inline_kernel_ids.back(),
+                  inline_kernel_ids[FindHighestPriorityKernel(
+                      kernel_infos(), inline_kernel_ids)]);
+      }
+      auto kernel_id = inline_kernel_ids.back();
+      inline_kernel_ids.pop_back();
+
+      ProcessReadyKernel(kernel_id, &kernel_frame, ready_kernel_queue);
+
+      SpillOutlineKernels(ready_kernel_queue);
+    }
+  } while (stream_pool_ &&
+           stream_pool_->TakeReadyStream(ready_kernel_queue, is_stream_worker));
+}
+
+// Run the kernels of a sequential function in the order they appear in the
+// function. As each kernel is only used by the next kernel, the next kernel is
+// the only ready kernel as long as the values produced are available, so no
+// ready counts need to be decremented and no ready kernel queue is needed.
+void BEFExecutor::ExecuteSequentially(ArrayRef<AsyncValue*> arguments) {
+  TFRT_TRACE_STATIC_SCOPE(Verbose, "BEFExecutor::ExecuteSequentially");
+  TFRT_TRACE_FLOW(Verbose, exec_ctx_.trace_id());
+
+  MutableArrayRef<BEFFileImpl::RegisterInfo> register_array = register_infos();
+
+  // Set up the registers for the arguments, which must all be available.
+  BEFKernel pseudo_kernel(kernels().data());
+  auto pseudo_results = pseudo_kernel.GetResults();
+  assert(arguments.size() + 1 == pseudo_results.size());
+  for (int argument_number = 0, result_number = 1;
+       result_number < pseudo_results.size();
+       ++argument_number, ++result_number) {
+    assert(arguments[argument_number]->IsAvailable());
+    auto& result_register = register_array[pseudo_results[result_number]];
+    if (result_register.user_count == 0) continue;
+    SetRegisterValue(&result_register, FormRef(arguments[argument_number]));
   }
-  assert(ready_kernel_queue.outline_kernel_ids().empty());
 
-  // The loop below process inline kernels in a LIFO order for cache locality.
-  // Outline kernels are enqueued to the concurrent work queue immediately.
+  KernelFrameBuilder kernel_frame(exec_ctx_);
+  kernel_frame.SetAttributeSection(BefFile()->attribute_section_, &fn_);
+  kernel_frame.SetFunctions(BefFile()->functions_);
 
-  while (!ready_kernel_queue.inline_kernel_ids().empty()) {
-    auto kernel_id = ready_kernel_queue.inline_kernel_ids().back();
-    ready_kernel_queue.inline_kernel_ids().pop_back();
+  for (unsigned kernel_id = kPseudoKernelId + 1, e = kernel_infos().size();
+       kernel_id != e; ++kernel_id) {
+    BEFKernel kernel = RunKernel(kernel_id, &kernel_frame);
+
+    // If the next kernel would have to wait for a result of this kernel, hand
+    // over to the generic path. The ready counts of the remaining kernels are
+    // still correct, as they do not use any results of the kernels before this
+    // one.
+    for (int result_number = 0; result_number < kernel.num_results();
+         ++result_number) {
+      assert(kernel_frame.GetResultAt(result_number) &&
+             "Kernel did not set result AsyncValue");
+      if (!kernel_frame.GetResultAt(result_number)->IsAvailable() &&
+          kernel.num_used_bys(result_number) > 0) {
+        ReadyKernelQueue ready_kernel_queue(
+            kernel_infos()[kPseudoKernelId].stream_id, kernel_infos());
+        ProcessKernelResults(kernel, kernel_id, &kernel_frame,
+                             ready_kernel_queue);
+        ProcessReadyKernels(ready_kernel_queue);
+        return;
+      }
+    }
 
-    ProcessReadyKernel(kernel_id, &kernel_frame, ready_kernel_queue);
+    auto results = kernel.GetResults();
+    for (int result_number = 0; result_number < results.size();
+         ++result_number) {
+      auto& result_register = register_array[results[result_number]];
+      RCReference<AsyncValue> result =
+          kernel_frame.ReleaseResultAt(result_number);
+      if (result_register.user_count == 0) continue;
 
-    if (!ready_kernel_queue.outline_kernel_ids().empty()) {
-      EnqueueReadyKernels(std::move(ready_kernel_queue.outline_kernel_ids()));
+      DebugPrintError(kernel, kernel_id, result.get());
+      SetRegisterValue(&result_register, std::move(result));
     }
-    assert(ready_kernel_queue.outline_kernel_ids().empty());
   }
 }
 
@@ -553,12 +1085,44 @@ void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue) {
 // Executor Setup
 //===----------------------------------------------------------------------===//
 
-BEFExecutor::BEFExecutor(ExecutionContext exec_ctx, BEFFileImpl* bef_file)
-    : exec_ctx_(std::move(exec_ctx)), bef_file_(FormRef(bef_file)) {}
+BEFExecutor::BEFExecutor(ExecutionContext exec_ctx, BEFFileImpl* bef_file,
+                         const BEFFunction& fn, BEFExecutorState* state)
+    : exec_ctx_(std::move(exec_ctx)),
+      fn_(fn),
+      state_(state),
+      bef_file_(FormRef(bef_file)) {
+  const auto* options =
+      exec_ctx_.request_ctx()->GetDataIfExists<BEFExecutionOptions>();
+  if (options && options->GetSchedulingMode(fn.name()) ==
+                     BEFSchedulingMode::kStreamStealing) {
+    int max_workers = options->max_stream_workers > 0
+                          ? options->max_stream_workers
+                          : GetHost()->GetNumWorkerThreads();
+    stream_pool_ = std::make_unique<ReadyStreamPool>(
+        std::max(max_workers, 1), options->prioritize_critical_path);
+  }
+  if (options) {
+    kernel_profiler_ = options->kernel_profiler;
+    prioritize_critical_path_ = options->prioritize_critical_path;
+  }
+}
 
-BEFExecutor::~BEFExecutor() {}
+BEFExecutor::~BEFExecutor() {
+  // The BEF file, and hence `fn_`, is still alive here, as `bef_file_` is
+  // destroyed after the destructor body.
+  fn_.executor_state_pool().Release(state_);
+}
 
 void BEFExecutor::Execute(ArrayRef<AsyncValue*> arguments) {
+  // Functions that are a single chain of kernels are run in order without
+  // tracking ready counts, unless they have to wait for their arguments.
+  if (BEFKernel(kernels().data()).IsSequentialFunction() &&
+      llvm::all_of(arguments,
+                   [](AsyncValue* value) { return value->IsAvailable(); })) {
+    ExecuteSequentially(arguments);
+    return;
+  }
+
   // Each KernelInfo::arguments_not_ready to the number of arguments (or one for
   // kernels with no arguments). This means that as we walk the list to drop the
   // argument count, if we hit zero then it is time for us to trigger the
@@ -582,6 +1146,29 @@ void BEFExecutor::Execute(ArrayRef<AsyncValue*> arguments) {
   ProcessReadyKernels(ready_kernel_queue);
 }
 
+// Cache the `results` of the pure function `fn` for `arguments` once they are
+// all available.
+static void CacheResultsWhenReady(
+    BEFFileImpl* bef_file, const BEFFunction& fn, HostContext* host,
+    uint64_t arguments_hash, ArrayRef<AsyncValue*> arguments,
+    ArrayRef<RCReference<AsyncValue>> results) {
+  SmallVector<RCReference<AsyncValue>, 4> argument_refs;
+  argument_refs.reserve(arguments.size());
+  for (auto* argument : arguments) argument_refs.push_back(FormRef(argument));
+
+  SmallVector<RCReference<AsyncValue>, 4> result_refs;
+  result_refs.reserve(results.size());
+  for (const auto& result : results) result_refs.push_back(result.CopyRef());
+
+  RunWhenReady(results, [bef_file = FormRef(bef_file), fn = &fn, host,
+                         arguments_hash,
+                         argument_refs = std::move(argument_refs),
+                         result_refs = std::move(result_refs)]() {
+    bef_file->function_result_cache_.Insert(fn, host, arguments_hash,
+                                            argument_refs, result_refs);
+  });
+}
+
 void BEFExecutor::Execute(ExecutionContext exec_ctx, const BEFFunction& fn,
                           ArrayRef<AsyncValue*> arguments,
                           MutableArrayRef<RCReference<AsyncValue>> results) {
@@ -594,20 +1181,54 @@ void BEFExecutor::Execute(ExecutionContext exec_ctx, const BEFFunction& fn,
   assert(results.size() == fn.result_types().size() &&
          "incorrect number of results passed to function call");
 
+  // Get the decoded function from the pool of the function. This only decodes
+  // the function if there is no state available for reuse.
+  BEFExecutorState* state = fn.executor_state_pool().Acquire(fn);
+  if (!state) return;
+  assert(state->result_regs.size() == fn.result_types().size());
+
   HostContext* host = exec_ctx.host();
+
+  // Pure functions return the cached results of an earlier execution with
+  // equal arguments, if there is one.
+  llvm::Optional<uint64_t> arguments_hash;
+  if (LLVM_UNLIKELY(
+          BEFKernel(state->function_info.kernels.data()).IsPureFunction())) {
+    arguments_hash = FunctionResultCache::HashArguments(arguments);
+    if (arguments_hash && bef_file->function_result_cache_.Lookup(
+                              &fn, host, *arguments_hash, arguments, results)) {
+      fn.executor_state_pool().Release(state);
+      return;
+    }
+  }
   auto* exec_ptr = host->Allocate<BEFExecutor>();
-  auto* exec = new (exec_ptr) BEFExecutor(std::move(exec_ctx), bef_file);
+  auto* exec =
+      new (exec_ptr) BEFExecutor(std::move(exec_ctx), bef_file, fn, state);
 
-  size_t location_offset;
-  SmallVector<size_t, 4> result_regs;
-  bool success = bef_file->ReadFunction(fn.function_offset(), fn.result_types(),
-                                        &location_offset, &exec->function_info_,
-                                        &result_regs, host->allocator());
-  if (!success) return;
-  assert(result_regs.size() == fn.result_types().size());
+  exec->PopulateResults(results);
 
-  MutableArrayRef<BEFFileImpl::RegisterInfo> register_array =
-      exec->register_infos();
+  // Kick off BEF execution starting from ready kernels.
+  exec->Execute(arguments);
+
+  if (arguments_hash) {
+    CacheResultsWhenReady(bef_file, fn, host, *arguments_hash, arguments,
+                          results);
+  }
+
+  // The executor is created with a refcount of 1 to keep it alive during its
+  // own execution. Now that we're done with it, drop our reference to allow it
+  // to be deleted whenever the last async results become available.
+  exec->DropRef();
+
+  DEBUG_PRINT("Execute function %s end\n",
+              fn.name().empty() ? "(unknown)" : fn.name().str().c_str());
+}
+
+void BEFExecutor::PopulateResults(
+    MutableArrayRef<RCReference<AsyncValue>> results) {
+  MutableArrayRef<BEFFileImpl::RegisterInfo> register_array = register_infos();
+  ArrayRef<size_t> result_regs = state_->result_regs;
+  assert(result_regs.size() == results.size());
 
   // Populate the function result AsyncValues (results).
   //
@@ -638,17 +1259,65 @@ void BEFExecutor::Execute(ExecutionContext exec_ctx, const BEFFunction& fn,
     // for the result.
     results[i] = TakeRef(result_reg.value);
   }
+}
 
-  // Kick off BEF execution starting from ready kernels.
-  exec->Execute(arguments);
+void BEFExecutor::ExecuteRepeatedly(
+    ExecutionContext exec_ctx, const BEFFunction& fn, int32_t count,
+    ArrayRef<AsyncValue*> arguments,
+    MutableArrayRef<RCReference<AsyncValue>> results) {
+  assert(count > 0);
+  assert(arguments.size() == results.size());
+
+  BEFExecutorState* state = fn.executor_state_pool().Acquire(fn);
+  if (!state) return;
+  // Pure functions look up their results in the function result cache on
+  // every execution, which only Execute() does.
+  if (BEFKernel(state->function_info.kernels.data()).IsPureFunction()) {
+    fn.executor_state_pool().Release(state);
+    fn.Function::ExecuteRepeatedly(exec_ctx, count, arguments, results);
+    return;
+  }
 
-  // The executor is created with a refcount of 1 to keep it alive during its
-  // own execution. Now that we're done with it, drop our reference to allow it
-  // to be deleted whenever the last async results become available.
+  SmallVector<AsyncValue*, 4> iteration_arguments(arguments.begin(),
+                                                  arguments.end());
+  SmallVector<RCReference<AsyncValue>, 4> iteration_results;
+  iteration_results.resize(results.size());
+  BEFExecutor* exec = nullptr;
+  for (int32_t i = 0; i < count; ++i) {
+    // The executor of the previous iteration has no other references once all
+    // its kernels have run, as kernels that wait for a value or run on other
+    // threads keep a reference. Then its state can be reset for this iteration
+    // without allocating a new executor or acquiring another state.
+    if (exec != nullptr && exec->IsUnique()) {
+      exec->state_->Reset();
+    } else {
+      if (exec != nullptr) {
+        exec->DropRef();
+        state = fn.executor_state_pool().Acquire(fn);
+        if (!state) {
+          for (size_t j = 0, e = results.size(); j != e; ++j)
+            results[j] = std::move(iteration_results[j]);
+          return;
+        }
+      }
+      auto* exec_ptr = exec_ctx.host()->Allocate<BEFExecutor>();
+      exec = new (exec_ptr) BEFExecutor(exec_ctx, fn.bef_file(), fn, state);
+    }
+
+    exec->PopulateResults(results);
+    exec->Execute(iteration_arguments);
+
+    // The results of this iteration are the arguments of the next one. The
+    // executor took its own references to the arguments.
+    for (size_t j = 0, e = results.size(); j != e; ++j) {
+      iteration_results[j] = std::move(results[j]);
+      iteration_arguments[j] = iteration_results[j].get();
+    }
+  }
   exec->DropRef();
 
-  DEBUG_PRINT("Execute function %s end\n",
-              fn.name().empty() ? "(unknown)" : fn.name().str().c_str());
+  for (size_t j = 0, e = results.size(); j != e; ++j)
+    results[j] = std::move(iteration_results[j]);
 }
 
 //===----------------------------------------------------------------------===//
@@ -662,6 +1331,18 @@ void BEFFunction::Execute(
   BEFExecutor::Execute(exec_ctx, *this, arguments, results);
 }
 
+void BEFFunction::ExecuteRepeatedly(
+    const ExecutionContext& exec_ctx, int32_t count,
+    ArrayRef<AsyncValue*> arguments,
+    MutableArrayRef<RCReference<AsyncValue>> results) const {
+  // SyncBEFFunctions are not run by the BEFExecutor.
+  if (function_kind() != FunctionKind::kBEFFunction) {
+    Function::ExecuteRepeatedly(exec_ctx, count, arguments, results);
+    return;
+  }
+  BEFExecutor::ExecuteRepeatedly(exec_ctx, *this, count, arguments, results);
+}
+
 // To keep this function alive, we have to keep the underlying BEF file alive.
 void BEFFunction::AddRef() const { bef_file_->AddRef(); }
 
@@ -20,14 +20,20 @@
 #include "tfrt/bef_executor/bef_file.h"
 
 #include "bef_file_impl.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/Support/FileSystem.h"
 #include "tfrt/bef/bef_encoding.h"
 #include "tfrt/bef/bef_reader.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/debug_info.h"
+#include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/native_function.h"
+#include "tfrt/host_context/startup_profile.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
 #include "tfrt/support/variant.h"
 
 namespace tfrt {
@@ -62,6 +68,7 @@ class BEFFileReader : public BEFReader {
   bool ReadKernelsSection(HostAllocator* host_allocator);
   bool ReadTypesSection();
   bool ReadFunctionIndexSection();
+  bool ReadNativeObjectsSection();
 
  private:
   bool ReadFunctionIndexSectionInternal(
@@ -144,6 +151,11 @@ bool BEFFileReader::ReadNextSection() {
       bef_file_->debug_info_section_ = section_data;
       SkipPast(section_data);
       break;
+
+    case BEFSectionID::kNativeObjects:
+      bef_file_->native_objects_section_ = section_data;
+      SkipPast(section_data);
+      break;
   }
 
   // Make sure the section reader consumed the right number of bytes.  Not
@@ -232,9 +244,8 @@ bool BEFFileReader::ReadKernelsSection(HostAllocator* host_allocator) {
   size_t num_kernels;
   if (!reader.ReadVbrInt(&num_kernels)) return format_error();
 
-#if !defined(TFRT_DISABLE_TRACING) || defined(DEBUG_BEF_EXECUTOR)
   bef_file_->kernel_names_.reserve(num_kernels);
-#endif
+  bef_file_->kernel_sample_sites_.reserve(num_kernels);
 
   bef_file_->kernels_.reserve(num_kernels);
   while (num_kernels--) {
@@ -251,9 +262,9 @@ bool BEFFileReader::ReadKernelsSection(HostAllocator* host_allocator) {
     const char* kernel_name = reinterpret_cast<const char*>(
         &bef_file_->string_section_[kernel_name_offset]);
 
-#if !defined(TFRT_DISABLE_TRACING) || defined(DEBUG_BEF_EXECUTOR)
     bef_file_->kernel_names_.push_back(kernel_name);
-#endif
+    bef_file_->kernel_trace_points_.emplace_back(kernel_name);
+    bef_file_->kernel_sample_sites_.push_back(BEFSampleSite::Get(kernel_name));
 
     auto kernel = registry_.GetKernel(kernel_name);
     if (kernel.is<Monostate>()) {
@@ -422,6 +433,53 @@ bool BEFFileReader::ReadFunctionIndexSection() {
   return true;
 }
 
+// Read the NativeObjects section from a BEF file, and pass each object to the
+// native object loader of its kind. Objects without a loader are ignored, and
+// so are the objects that fail to load, because the kernels fall back on
+// compiling them at runtime. Emit an error and return false if the section is
+// malformed.
+bool BEFFileReader::ReadNativeObjectsSection() {
+  auto format_error = [&]() -> bool {
+    bef_file_->EmitFormatError("invalid NativeObjects section in BEF file");
+    return false;
+  };
+
+  BEFReader reader(bef_file_->native_objects_section_);
+  if (reader.Empty()) return true;
+
+  auto read_bytes = [&](ArrayRef<uint8_t>* bytes) {
+    size_t size;
+    if (!reader.ReadVbrInt(&size) || size > reader.file().size()) return false;
+    *bytes = reader.file().take_front(size);
+    reader.SkipOffset(size);
+    return true;
+  };
+
+  size_t num_objects;
+  if (!reader.ReadVbrInt(&num_objects)) return format_error();
+
+  while (num_objects--) {
+    ArrayRef<uint8_t> kind, key, data;
+    if (!read_bytes(&kind) || !read_bytes(&key) || !read_bytes(&data))
+      return format_error();
+
+    auto as_string = [](ArrayRef<uint8_t> bytes) {
+      return string_view(reinterpret_cast<const char*>(bytes.data()),
+                         bytes.size());
+    };
+
+    NativeObjectLoader loader =
+        registry_.GetNativeObjectLoader(as_string(kind));
+    if (loader == nullptr) continue;
+
+    if (auto err = loader(as_string(key), data))
+      TFRT_LOG(WARNING) << "Failed to load native object '" << as_string(key)
+                        << "': " << llvm::toString(std::move(err));
+  }
+
+  return true;
+}
+
 // BEFFile / BEFFileImpl Implementation
 BEFFile::BEFFile(std::unique_ptr<LocationHandler> location_handler)
     : location_handler_(std::move(location_handler)) {}
@@ -443,6 +501,7 @@ RCReference<BEFFile> BEFFile::Open(ArrayRef<uint8_t> file,
     return {};
   }
 
+  StartupPhase open_phase("open BEF file");
   BEFFileReader reader(file, registry, bef_impl);
 
   uint8_t header[2];
@@ -455,25 +514,83 @@ RCReference<BEFFile> BEFFile::Open(ArrayRef<uint8_t> file,
   }
 
   uint8_t format_version;
-  if (!reader.ReadByte(&format_version) || format_version != kBEFVersion0) {
+  if (!reader.ReadByte(&format_version) ||
+      (format_version != kBEFVersion0 && format_version != kBEFVersion1)) {
     bef_impl->EmitFormatError("Unknown BEF format version detected");
     return {};
   }
+  bef_impl->format_version_ = format_version;
 
-  while (!reader.Empty()) {
-    if (!reader.ReadNextSection()) return {};
+  {
+    StartupPhase phase("read BEF sections");
+    while (!reader.Empty()) {
+      if (!reader.ReadNextSection()) return {};
+    }
   }
 
   // Now that we've figured out the contents of the sections, resolve some
   // things.
-  if (!reader.ReadKernelsSection(host_allocator) ||
-      !reader.ReadTypesSection() || !reader.ReadFunctionIndexSection())
-    return {};
+  {
+    StartupPhase phase("resolve kernels");
+    if (!reader.ReadKernelsSection(host_allocator)) return {};
+  }
+  {
+    StartupPhase phase("resolve types and functions");
+    if (!reader.ReadTypesSection() || !reader.ReadFunctionIndexSection())
+      return {};
+  }
+  {
+    StartupPhase phase("load native objects");
+    if (!reader.ReadNativeObjectsSection()) return {};
+  }
 
   // Now that we decoded the whole thing, return the BEFFile to the caller.
   return bef_rc;
 }
 
+RCReference<BEFFile> BEFFile::OpenMapped(string_view path,
+                                         const KernelRegistry& registry,
+                                         ErrorHandler error_handler,
+                                         HostAllocator* host_allocator) {
+  auto emit_error = [&](auto&&... args) -> RCReference<BEFFile> {
+    error_handler(DecodedDiagnostic(
+        StrCat("failed to map BEF file '", path, "': ", args...)));
+    return {};
+  };
+
+  auto fd = llvm::sys::fs::openNativeFileForRead(path);
+  if (!fd) return emit_error(llvm::toString(fd.takeError()));
+  auto close_fd =
+      llvm::make_scope_exit([&]() { llvm::sys::fs::closeFile(*fd); });
+
+  llvm::sys::fs::file_status status;
+  if (auto ec = llvm::sys::fs::status(*fd, status))
+    return emit_error(ec.message());
+  if (status.getSize() == 0) return emit_error("file is empty");
+
+  // The mapping is page-aligned, which satisfies GetRequiredBefAlignment().
+  std::error_code ec;
+  auto mapped_file = std::make_unique<llvm::sys::fs::mapped_file_region>(
+      *fd, llvm::sys::fs::mapped_file_region::readonly, status.getSize(),
+      /*offset=*/0, ec);
+  if (ec) return emit_error(ec.message());
+  // Large constants are read at random, so back them with huge pages where the
+  // kernel supports it for file mappings.
+  AdviseHugePages(const_cast<char*>(mapped_file->const_data()),
+                  mapped_file->size());
+
+  ArrayRef<uint8_t> file(
+      reinterpret_cast<const uint8_t*>(mapped_file->const_data()),
+      mapped_file->size());
+  auto bef = Open(file, registry, std::move(error_handler), host_allocator);
+  if (!bef) return {};
+
+  // The mapped region can be closed after the file is mapped. The BEFFile
+  // takes ownership of the mapping, which all its sections point into.
+  static_cast<BEFFileImpl*>(bef.get())->mapped_file_ = std::move(mapped_file);
+  return bef;
+}
+
 DecodedLocation BEFLocationHandler::DecodeLocation(Location loc) const {
   return bef_file_->DecodeLocation(loc.data);
 }
@@ -504,10 +621,14 @@ bool BEFFileImpl::ReadFunction(size_t function_offset,
   if (function_offset >= function_section_.size()) return format_error();
 
   BEFReader reader(function_section_.drop_front(function_offset));
+  auto read_int = [&reader, fixed_width = HasFixedWidthFunctionTables()](
+                      size_t* value) {
+    return reader.ReadFunctionTableInt(value, fixed_width);
+  };
 
   // First we have the location info and register info table.
   size_t num_registers;
-  if (!reader.ReadVbrInt(location_offset) || !reader.ReadVbrInt(&num_registers))
+  if (!read_int(location_offset) || !read_int(&num_registers))
     return format_error();
 
   function_info->register_infos.resize(num_registers, host_allocator);
@@ -516,22 +637,21 @@ bool BEFFileImpl::ReadFunction(size_t function_offset,
   unsigned register_idx = 0;
   while (num_registers--) {
     size_t user_count;
-    if (!reader.ReadVbrInt(&user_count)) return format_error();
+    if (!read_int(&user_count)) return format_error();
     new (register_info_ptr + register_idx) RegisterInfo(user_count);
     ++register_idx;
   }
 
   // Next we have the kernel index table.
   size_t num_kernels;
-  if (!reader.ReadVbrInt(&num_kernels)) return format_error();
+  if (!read_int(&num_kernels)) return format_error();
 
   function_info->kernel_infos.resize(num_kernels, host_allocator);
   auto* kernel_info_ptr = function_info->kernel_infos.mutable_array().data();
   unsigned kernel_idx = 0;
   while (num_kernels--) {
     size_t offset, num_operands, stream_id;
-    if (!reader.ReadVbrInt(&offset) || !reader.ReadVbrInt(&num_operands) ||
-        !reader.ReadVbrInt(&stream_id))
+    if (!read_int(&offset) || !read_int(&num_operands) || !read_int(&stream_id))
       return format_error();
     new (kernel_info_ptr + kernel_idx)
         KernelInfo(offset, stream_id, num_operands);
@@ -542,7 +662,7 @@ bool BEFFileImpl::ReadFunction(size_t function_offset,
   result_regs->reserve(results.size());
   for (unsigned i = 0, e = results.size(); i != e; ++i) {
     size_t result_reg;
-    if (!reader.ReadVbrInt(&result_reg) || result_reg >= num_registers)
+    if (!read_int(&result_reg) || result_reg >= num_registers)
       return format_error();
     result_regs->push_back(result_reg);
   }
@@ -555,6 +675,19 @@ bool BEFFileImpl::ReadFunction(size_t function_offset,
       reinterpret_cast<const uint32_t*>(reader.file().begin()),
       reader.file().size() / kKernelEntryAlignment);
 
+  // Cache the kernel priorities next to the ready counts, where the executor
+  // looks for them when choosing the next ready kernel.
+  for (auto& kernel_info : function_info->kernel_infos.mutable_array()) {
+    if (kernel_info.offset % kKernelEntryAlignment != 0 ||
+        kernel_info.offset / kKernelEntryAlignment >=
+            function_info->kernels.size())
+      return format_error();
+    kernel_info.priority =
+        BEFKernel(function_info->kernels.data() +
+                  kernel_info.offset / kKernelEntryAlignment)
+            .critical_path_priority();
+  }
+
   return true;
 }
 
@@ -604,12 +737,10 @@ DecodedLocation BEFFileImpl::DecodeLocation(size_t location_position_offset) {
   return result;
 }
 
-#if !defined(TFRT_DISABLE_TRACING) || defined(DEBUG_BEF_EXECUTOR)
 const char* BEFFileImpl::GetKernelName(size_t kernel_id) const {
   return (kernel_id >= kernel_names_.size()) ? "(invalid kernel_id)"
                                              : kernel_names_[kernel_id];
 }
-#endif
 
 llvm::Optional<DebugInfoEntry> BEFFileImpl::DecodeDebugInfo(
     BEFKernel* kernel) const {
@@ -651,25 +782,98 @@ const Function* BEFFile::GetFunction(string_view function_name) const {
   return impl->functions_[it->second].get();
 }
 
+void BEFFile::ForEachKernel(
+    string_view kernel_name,
+    llvm::function_ref<void(ArrayRef<const void*> attributes)> fn) const {
+  auto* impl = static_cast<const BEFFileImpl*>(this);
+
+  SmallVector<uint32_t, 2> kernel_codes;
+  for (size_t i = 0; i < impl->kernel_names_.size(); ++i) {
+    if (kernel_name == impl->kernel_names_[i]) kernel_codes.push_back(i);
+  }
+  if (kernel_codes.empty()) return;
+
+  SmallVector<size_t, 16> kernel_offsets;
+  SmallVector<const void*, 4> attributes;
+  for (auto& function : impl->functions_) {
+    if (function->function_kind() == FunctionKind::kNativeFunction) continue;
+    const auto& bef_function = static_cast<const BEFFunction&>(*function);
+    if (bef_function.function_offset() >= impl->function_section_.size())
+      continue;
+
+    // Decode the function tables like BEFFileImpl::ReadFunction, only keeping
+    // the kernel offsets.
+    BEFReader reader(
+        impl->function_section_.drop_front(bef_function.function_offset()));
+    auto read_int = [&reader,
+                     fixed_width = impl->HasFixedWidthFunctionTables()](
+                        size_t* value) {
+      return reader.ReadFunctionTableInt(value, fixed_width);
+    };
+    size_t location_offset, num_registers, num_kernels, unused;
+    if (!read_int(&location_offset) || !read_int(&num_registers)) continue;
+    bool success = true;
+    for (size_t i = 0; success && i < num_registers; ++i)
+      success = read_int(&unused);
+    if (!success || !read_int(&num_kernels)) continue;
+    kernel_offsets.clear();
+    for (size_t i = 0; success && i < num_kernels; ++i) {
+      size_t offset;
+      success = read_int(&offset) && read_int(&unused) && read_int(&unused);
+      kernel_offsets.push_back(offset);
+    }
+    for (size_t i = 0; success && i < function->result_types().size(); ++i)
+      success = read_int(&unused);
+    if (!success || !reader.ReadAlignment(kKernelEntryAlignment)) continue;
+
+    auto kernels = llvm::makeArrayRef(
+        reinterpret_cast<const uint32_t*>(reader.file().begin()),
+        reader.file().size() / kKernelEntryAlignment);
+    for (size_t offset : kernel_offsets) {
+      if (offset % kKernelEntryAlignment != 0 ||
+          offset / kKernelEntryAlignment >= kernels.size())
+        break;
+      BEFKernel kernel(kernels.data() + offset / kKernelEntryAlignment);
+      if (!llvm::is_contained(kernel_codes, kernel.kernel_code())) continue;
+      attributes.clear();
+      for (auto attribute_offset : kernel.GetAttributes()) {
+        attributes.push_back(impl->attribute_section_.data() +
+                             attribute_offset);
+      }
+      fn(attributes);
+    }
+  }
+}
+
 Expected<std::unique_ptr<SyncBEFFunction>> SyncBEFFunction::Create(
     string_view name, ArrayRef<TypeName> arguments, ArrayRef<TypeName> results,
     size_t function_offset, BEFFileImpl* bef_file) {
+  if (function_offset >= bef_file->function_section().size())
+    return MakeStringError("Invalid SyncBEFFunction(Invalid function offset)");
+
   // std::make_unique cannot be used, as the constructor of SyncBEFFunction is
-  // private.
+  // private. The function body is decoded lazily by EnsureDecoded().
   // NOLINTNEXTLINE
-  auto bef_function = std::unique_ptr<SyncBEFFunction>(
+  return std::unique_ptr<SyncBEFFunction>(
       new SyncBEFFunction(name, arguments, results, function_offset, bef_file));
+}
 
-  if (auto error = bef_function->Init())
-    return std::move(error);
-  else
-    return std::move(bef_function);
+Error SyncBEFFunction::EnsureDecoded() const {
+  std::call_once(decode_once_, [this]() {
+    auto* self = const_cast<SyncBEFFunction*>(this);
+    if (auto error = self->Init()) {
+      self->decode_error_ = toString(std::move(error));
+    } else {
+      self->decoded_ = true;
+    }
+  });
+  if (decoded_) return Error::success();
+  return MakeStringError(decode_error_);
 }
 
 Error SyncBEFFunction::Init() {
   assert(register_infos_.empty());
-  assert(kernels_.empty());
-  assert(kernel_offsets_.empty());
+  assert(kernel_entries_.empty());
   assert(result_regs_.empty());
 
   auto format_error = [&](const char* msg) -> Error {
@@ -681,18 +885,22 @@ Error SyncBEFFunction::Init() {
     return format_error("Invalid function offset");
 
   BEFReader reader(function_section.drop_front(function_offset_));
+  auto read_int = [&reader,
+                   fixed_width = bef_file_->HasFixedWidthFunctionTables()](
+                      size_t* value) {
+    return reader.ReadFunctionTableInt(value, fixed_width);
+  };
 
   // First we have the location info and register info table.
   size_t num_registers;
   size_t location_offset;
-  if (!reader.ReadVbrInt(&location_offset) ||
-      !reader.ReadVbrInt(&num_registers))
+  if (!read_int(&location_offset) || !read_int(&num_registers))
     return format_error("Failed to read location_offset or num_registers");
 
   register_infos_.reserve(num_registers);
   for (size_t reg_index = 0; reg_index < num_registers; ++reg_index) {
     size_t user_count;
-    if (!reader.ReadVbrInt(&user_count))
+    if (!read_int(&user_count))
       return format_error("Failed to read register user_count");
 
     bool is_arg = (reg_index < num_arguments());
@@ -707,24 +915,23 @@ Error SyncBEFFunction::Init() {
 
   // Next we have the kernel index table.
   size_t num_kernels;
-  if (!reader.ReadVbrInt(&num_kernels))
+  if (!read_int(&num_kernels))
     return format_error("Failed to read num_kernels");
 
-  kernel_offsets_.reserve(num_kernels);
+  SmallVector<uint32_t, 8> kernel_offsets;
+  kernel_offsets.reserve(num_kernels);
 
   size_t offset, num_operands, stream_id;
 
   // Skip the first kernel which is the pseudo kernel used in BEF executor.
-  if (!reader.ReadVbrInt(&offset) || !reader.ReadVbrInt(&num_operands) ||
-      !reader.ReadVbrInt(&stream_id))
+  if (!read_int(&offset) || !read_int(&num_operands) || !read_int(&stream_id))
     return format_error("Failed to read kernel offset or num_operands");
 
   for (size_t kernel_index = 1; kernel_index < num_kernels; ++kernel_index) {
-    if (!reader.ReadVbrInt(&offset) || !reader.ReadVbrInt(&num_operands) ||
-        !reader.ReadVbrInt(&stream_id))
+    if (!read_int(&offset) || !read_int(&num_operands) || !read_int(&stream_id))
       return format_error("Failed to read kernel offset or num_operands");
 
-    kernel_offsets_.push_back(offset);
+    kernel_offsets.push_back(offset);
   }
 
   // Read the result registers.
@@ -732,7 +939,7 @@ Error SyncBEFFunction::Init() {
   result_regs_.reserve(num_results);
   for (unsigned i = 0, e = num_results; i != e; ++i) {
     size_t result_reg;
-    if (!reader.ReadVbrInt(&result_reg) || result_reg >= num_registers)
+    if (!read_int(&result_reg) || result_reg >= num_registers)
       return format_error("Failed to read result_reg");
     result_regs_.push_back(result_reg);
 
@@ -751,10 +958,96 @@ Error SyncBEFFunction::Init() {
     return format_error("Failed to align BEF to kKernelEntryAlignment");
 
   // We found the start of our kernel section.
-  kernels_ = llvm::makeArrayRef(
+  auto kernels = llvm::makeArrayRef(
       reinterpret_cast<const uint32_t*>(reader.file().begin()),
       reader.file().size() / kKernelEntryAlignment);
 
+  return DecodeKernels(kernels, kernel_offsets);
+}
+
+Error SyncBEFFunction::DecodeKernels(ArrayRef<uint32_t> kernels,
+                                     ArrayRef<uint32_t> kernel_offsets) {
+  SmallVector<int, 16> user_counts;
+  user_counts.reserve(register_infos_.size());
+
+  // Initialize the user counts for each register.
+  for (auto& reg_info : register_infos_) {
+    user_counts.emplace_back() = reg_info.user_count;
+  }
+
+  kernel_entries_.reserve(kernel_offsets.size());
+  kernel_sample_sites_.reserve(kernel_offsets.size());
+
+  for (auto kernel_offset : kernel_offsets) {
+    if (kernel_offset % kKernelEntryAlignment != 0 ||
+        kernel_offset / kKernelEntryAlignment >= kernels.size())
+      return MakeStringError("Invalid SyncBEFFunction(Invalid kernel offset)");
+
+    BEFKernel kernel(kernels.data() + kernel_offset / kKernelEntryAlignment);
+
+    auto& kernel_entry = kernel_entries_.emplace_back();
+    kernel_sample_sites_.push_back(
+        bef_file_->GetKernelSampleSite(kernel.kernel_code()));
+
+    // Get the kernel function.
+    kernel_entry.kernel_fn = bef_file_->GetSyncKernel(kernel.kernel_code());
+    assert(kernel_entry.kernel_fn != nullptr);
+
+    kernel_entry.register_start = register_indices_.size();
+
+    // Collect argument and result registers.
+    auto arguments = kernel.GetArguments();
+    auto results = kernel.GetResults();
+    register_indices_.append(arguments.begin(), arguments.end());
+    register_indices_.append(results.begin(), results.end());
+    kernel_entry.num_arguments = arguments.size();
+    kernel_entry.num_results = results.size();
+
+    int retired_reg_start = register_indices_.size();
+
+    // Collect retired registers from arguments.
+    for (auto reg_idx : arguments) {
+      auto& user_count = user_counts[reg_idx];
+
+      --user_count;
+      assert(user_count >= 0);
+      if (user_count == 0) {
+        assert(!register_infos_[reg_idx].is_arg_or_result);
+        register_indices_.push_back(reg_idx);
+      }
+    }
+
+    // Collect retired registers from results.
+    for (auto reg_idx : results) {
+      // If there is no use for the result, mark it as retired.
+      if (user_counts[reg_idx] == 0) {
+        assert(!register_infos_[reg_idx].is_arg_or_result);
+        register_indices_.push_back(reg_idx);
+      }
+    }
+
+    kernel_entry.num_retired_registers =
+        register_indices_.size() - retired_reg_start;
+
+    // Collect the attributes.
+    kernel_entry.attribute_start = attributes_.size();
+    for (auto attribute_offset : kernel.GetAttributes()) {
+      // We pass the pointer here because this attribute could be an array of
+      // size 0.
+      attributes_.push_back(bef_file_->attribute_section_.data() +
+                            attribute_offset);
+    }
+
+    // Collect the function attributes.
+    for (auto fn_idx : kernel.GetFunctions()) {
+      // Functions are passed as their corresponding `Function`.
+      attributes_.push_back(bef_file_->functions_[fn_idx].get());
+    }
+
+    kernel_entry.num_attributes =
+        attributes_.size() - kernel_entry.attribute_start;
+  }
+
   return Error::success();
 }
 
@@ -19,6 +19,8 @@
 #ifndef TFRT_LIB_BEF_EXECUTOR_BEF_FILE_IMPL_H_
 #define TFRT_LIB_BEF_EXECUTOR_BEF_FILE_IMPL_H_
 
+#include <deque>
+#include <mutex>
 #include <type_traits>
 
 #include "llvm/ADT/ArrayRef.h"
@@ -26,16 +28,21 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "function_result_cache.h"
 #include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/bef_executor/bef_sampling_profiler.h"
 #include "tfrt/host_context/debug_info.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/native_function.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
 
+class BEFExecutorStatePool;
 class BEFFileImpl;
 class DecodedLocation;
 class Value;
@@ -109,30 +116,42 @@ class BEFFunction : public Function {
       : BEFFunction(name, FunctionKind::kBEFFunction, arguments, results,
                     function_offset, bef_file) {}
 
-  BEFFunction(BEFFunction&& other)
-      : Function(std::move(other)),
-        function_offset_(other.function_offset_),
-        bef_file_(other.bef_file_) {}
+  // The constructors and the destructor are defined in bef_executor.cc where
+  // BEFExecutorStatePool is defined.
+  BEFFunction(BEFFunction&& other);
+  ~BEFFunction() override;
 
   size_t function_offset() const { return function_offset_; }
   BEFFileImpl* bef_file() const { return bef_file_; }
+  // The site that samples of the kernels of this function are attributed to.
+  const BEFSampleSite* sample_site() const { return sample_site_; }
+
+  // Return the pool of decoded executor states that are reused across
+  // executions of this function. It is defined in bef_executor.cc.
+  BEFExecutorStatePool& executor_state_pool() const {
+    assert(executor_state_pool_);
+    return *executor_state_pool_;
+  }
 
   void Execute(const ExecutionContext& exec_ctx,
                ArrayRef<AsyncValue*> arguments,
                MutableArrayRef<RCReference<AsyncValue>> results) const override;
+  void ExecuteRepeatedly(
+      const ExecutionContext& exec_ctx, int32_t count,
+      ArrayRef<AsyncValue*> arguments,
+      MutableArrayRef<RCReference<AsyncValue>> results) const override;
   void AddRef() const override;
   void DropRef() const override;
 
  protected:
   BEFFunction(string_view name, FunctionKind function_kind,
               ArrayRef<TypeName> arguments, ArrayRef<TypeName> results,
-              size_t function_offset, BEFFileImpl* bef_file)
-      : Function(name, function_kind, arguments, results),
-        function_offset_(function_offset),
-        bef_file_(bef_file) {}
+              size_t function_offset, BEFFileImpl* bef_file);
 
   size_t function_offset_;
   BEFFileImpl* bef_file_;
+  const BEFSampleSite* sample_site_;
+  std::unique_ptr<BEFExecutorStatePool> executor_state_pool_;
 };
 
 // This class implements SyncFunction for BEF files.
@@ -143,6 +162,27 @@ class SyncBEFFunction final : public BEFFunction {
     bool is_arg_or_result : 1;
   };
 
+  // A kernel of this function, decoded into the form used by the interpreter.
+  // The entries of all kernels are stored in execution order, so executing the
+  // function is a walk over a contiguous array. Register indices and
+  // attributes are stored as segments of pools shared by all kernels, which
+  // keeps an entry at 32 bytes, i.e. two entries per cache line.
+  struct KernelEntry {
+    SyncKernelImplementation kernel_fn;
+    // The argument registers, followed by the result registers, followed by
+    // the registers whose values are retired after this kernel. This is a
+    // segment of register_indices().
+    uint32_t register_start;
+    uint32_t num_arguments;
+    uint32_t num_results;
+    uint32_t num_retired_registers;
+    // All attributes, including function attributes. This is a segment of
+    // attributes().
+    uint32_t attribute_start;
+    uint32_t num_attributes;
+  };
+  static_assert(sizeof(KernelEntry) <= 32, "Unexpected size of KernelEntry.");
+
   // Create a SyncBEFFunction. Return nullptr if the BEF file has format error.
   static Expected<std::unique_ptr<SyncBEFFunction>> Create(
       string_view name, ArrayRef<TypeName> arguments,
@@ -164,19 +204,51 @@ class SyncBEFFunction final : public BEFFunction {
   Error SyncExecute(const ExecutionContext& exec_ctx,
                     ArrayRef<Value*> arguments, ArrayRef<Value*> results) const;
 
+  // Decode the register and kernel information of this function if it has not
+  // been decoded yet. This is thread-safe, and it returns the decoding error,
+  // if any, on every call. The accessors below can only be used after this
+  // returns success.
+  Error EnsureDecoded() const;
+
   // Return an array of descriptors for all of our registers, indexed by
   // their register number.
-  ArrayRef<RegisterInfo> register_infos() const { return register_infos_; }
+  ArrayRef<RegisterInfo> register_infos() const {
+    assert(decoded_);
+    return register_infos_;
+  }
+
+  // Return the decoded kernels of this function in execution order. This does
+  // not include the pseudo kernel as it is not used in the interpreter.
+  ArrayRef<KernelEntry> kernel_entries() const {
+    assert(decoded_);
+    return kernel_entries_;
+  }
+
+  // Return the sample sites of kernel_entries(). They are kept apart from the
+  // entries to keep those small.
+  ArrayRef<const BEFSampleSite*> kernel_sample_sites() const {
+    assert(decoded_);
+    return kernel_sample_sites_;
+  }
 
-  // Return the kernel entries of all kernels of this function.
-  ArrayRef<uint32_t> kernels() const { return kernels_; }
+  // Return the pool of register indices referred to by kernel_entries().
+  ArrayRef<uint32_t> register_indices() const {
+    assert(decoded_);
+    return register_indices_;
+  }
 
-  // Return an array of offsets for all of the kernels in this function,
-  // indexed by the kernel number.
-  ArrayRef<uint32_t> kernel_offsets() const { return kernel_offsets_; }
+  // Return the pool of resolved attribute pointers referred to by
+  // kernel_entries(). Function attributes are passed as `const Function*`.
+  ArrayRef<const void*> attributes() const {
+    assert(decoded_);
+    return attributes_;
+  }
 
   // Return an array of register index for the result registers.
-  ArrayRef<uint32_t> result_regs() const { return result_regs_; }
+  ArrayRef<uint32_t> result_regs() const {
+    assert(decoded_);
+    return result_regs_;
+  }
 
  private:
   SyncBEFFunction(string_view name, ArrayRef<TypeName> arguments,
@@ -187,20 +259,33 @@ class SyncBEFFunction final : public BEFFunction {
 
   // Read the register and kernel information for the function. We cache
   // this information in SyncBEFFunction to avoid repeatedly reading this
-  // information for every function execution.
+  // information for every function execution. It is invoked by
+  // EnsureDecoded() on the first execution rather than when the BEF file is
+  // opened, so that functions that are never executed cost no decoding time
+  // and their pages in the Functions section are never touched.
   Error Init();
 
+  mutable std::once_flag decode_once_;
+  // Set to true once Init() has succeeded.
+  bool decoded_ = false;
+  // The error message from Init(), if it failed.
+  std::string decode_error_;
+
   // This is an array of descriptors for all of our registers, indexed by
   // their register number.
   SmallVector<RegisterInfo, 16> register_infos_;
 
-  // This ArrayRef contains kernel entries of all kernels of this function.
-  ArrayRef<uint32_t> kernels_;
+  // Decode the kernels at `kernel_offsets` in `kernels` into
+  // `kernel_entries_` and the pools they refer to.
+  Error DecodeKernels(ArrayRef<uint32_t> kernels,
+                      ArrayRef<uint32_t> kernel_offsets);
 
-  // This is an array of offsets for all of the kernels in this function,
-  // indexed by the kernel number. This does not include the pseudo kernel as it
-  // is not used in the interpreter.
-  SmallVector<uint32_t, 8> kernel_offsets_;
+  // These are the decoded kernels of this function in execution order, and the
+  // pools of register indices and attributes they refer to.
+  SmallVector<KernelEntry, 8> kernel_entries_;
+  SmallVector<const BEFSampleSite*, 8> kernel_sample_sites_;
+  SmallVector<uint32_t, 32> register_indices_;
+  SmallVector<const void*, 16> attributes_;
 
   // This is an array of register index for the result registers.
   SmallVector<uint32_t, 4> result_regs_;
@@ -255,6 +340,11 @@ class BEFFileImpl : public BEFFile, public DebugInfoDecoder {
     unsigned offset;
     unsigned stream_id;
     std::atomic<int> arguments_not_ready;
+    // The initial value of `arguments_not_ready`. It is used to reset this
+    // KernelInfo when it is reused for another execution.
+    int initial_arguments_not_ready;
+    // The critical path priority of the kernel from its kernel header.
+    unsigned priority = 0;
 
     // We initialize the ready list to at least 1 so that kernels with no
     // operands can be triggered by the pseudo kernel.
@@ -264,7 +354,13 @@ class BEFFileImpl : public BEFFile, public DebugInfoDecoder {
     KernelInfo(unsigned offset, unsigned stream_id, unsigned num_operands)
         : offset(offset),
           stream_id(stream_id),
-          arguments_not_ready(std::max(1u, num_operands)) {}
+          arguments_not_ready(std::max(1u, num_operands)),
+          initial_arguments_not_ready(std::max(1u, num_operands)) {}
+
+    void Reset() {
+      arguments_not_ready.store(initial_arguments_not_ready,
+                                std::memory_order_relaxed);
+    }
   };
 
   using RegisterInfoArray = BEFInfoArray<BEFFileImpl::RegisterInfo, 24>;
@@ -287,13 +383,10 @@ class BEFFileImpl : public BEFFile, public DebugInfoDecoder {
   //
   // On error, an error is emitted and false is returned.
   //
-  // ReadFunction is invoked for every BEFFunction execution. We can consider
-  // caching the kernel and register information in the BEFFunction object to
-  // avoid repeadly reading the same information from the BEF file. However, in
-  // the current implementation, we couple BEFExecutor states, e.g. AsyncValue
-  // for RegisterInfo, with the function reading. Caching kernel and register
-  // information would require us to avoid such coupling which can adversely
-  // affect the performance.
+  // The BEFExecutor does not invoke ReadFunction for every BEFFunction
+  // execution. Decoded FunctionInfo objects are reset and reused across
+  // executions through the BEFFunction's BEFExecutorStatePool, so
+  // ReadFunction is only invoked when the pool is empty.
   bool ReadFunction(size_t function_offset, ArrayRef<TypeName> results,
                     size_t* location_offset, FunctionInfo* function_info,
                     SmallVectorImpl<size_t>* result_regs,
@@ -305,15 +398,32 @@ class BEFFileImpl : public BEFFile, public DebugInfoDecoder {
 
   llvm::Optional<DebugInfoEntry> DecodeDebugInfo(BEFKernel*) const override;
 
-#if !defined(TFRT_DISABLE_TRACING) || defined(DEBUG_BEF_EXECUTOR)
-  // Only used for debugging and tracing.
+  // Only used for debugging, tracing and profiling.
   const char* GetKernelName(size_t kernel_id) const;
-#endif
 
+  // Returns the trace point named after the kernel, which is cheaper to trace
+  // than the name.
+  const tracing::TracePoint& GetKernelTracePoint(size_t kernel_id) const {
+    assert(kernel_id < kernel_trace_points_.size());
+    return kernel_trace_points_[kernel_id];
+  }
+
+  // Returns the site that samples of the kernel are attributed to by the
+  // sampling profiler.
+  const BEFSampleSite* GetKernelSampleSite(size_t kernel_id) const {
+    assert(kernel_id < kernel_sample_sites_.size());
+    return kernel_sample_sites_[kernel_id];
+  }
+
+  // Returns nullptr if the kernel is a sync kernel, which async functions run
+  // with GetSyncKernel() instead.
   AsyncKernelImplementation GetAsyncKernel(uint32_t kernel_code) const {
     assert(kernel_code < kernels_.size());
     const KernelImplementation& kernel_impl = kernels_[kernel_code];
-    assert(kernel_impl.is<AsyncKernelImplementation>());
+    if (LLVM_UNLIKELY(!kernel_impl.is<AsyncKernelImplementation>())) {
+      assert(kernel_impl.is<SyncKernelImplementation>());
+      return nullptr;
+    }
     return kernel_impl.get<AsyncKernelImplementation>();
   }
 
@@ -326,8 +436,16 @@ class BEFFileImpl : public BEFFile, public DebugInfoDecoder {
 
   ArrayRef<uint8_t> function_section() const { return function_section_; }
 
+  // Return true if the tables at the start of each function use 4-byte
+  // integers instead of VBR integers.
+  bool HasFixedWidthFunctionTables() const {
+    return format_version_ == kBEFVersion1;
+  }
+
   ErrorHandler error_handler_;
 
+  uint8_t format_version_ = kBEFVersion0;
+
   ArrayRef<uint8_t> location_filenames_section_;
   ArrayRef<uint8_t> location_positions_section_;
   ArrayRef<uint8_t> string_section_;
@@ -337,15 +455,26 @@ class BEFFileImpl : public BEFFile, public DebugInfoDecoder {
   ArrayRef<uint8_t> types_section_;
   ArrayRef<uint8_t> function_section_;
   ArrayRef<uint8_t> function_index_section_;
+  ArrayRef<uint8_t> native_objects_section_;
   SmallVector<KernelImplementation, 8> kernels_;
   SmallVector<TypeName, 8> type_names_;
   llvm::StringMap<size_t> function_symbol_table_;
   SmallVector<std::unique_ptr<Function>, 8> functions_;
 
-#if !defined(TFRT_DISABLE_TRACING) || defined(DEBUG_BEF_EXECUTOR)
   // Maps from kernel_id to the name of the kernel.
   std::vector<const char*> kernel_names_;
-#endif
+  // Maps from kernel_id to the trace point of the kernel. The trace points are
+  // not movable.
+  std::deque<tracing::TracePoint> kernel_trace_points_;
+  // Maps from kernel_id to the sample site of the kernel.
+  std::vector<const BEFSampleSite*> kernel_sample_sites_;
+
+  // The memory mapping that backs all the sections above, if this BEF file is
+  // opened with BEFFile::OpenMapped().
+  std::unique_ptr<llvm::sys::fs::mapped_file_region> mapped_file_;
+
+  // The cached results of the pure functions of this BEF file.
+  FunctionResultCache function_result_cache_;
 };
 
 }  // namespace tfrt
@@ -26,10 +26,10 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include "tfrt/bef/bef_encoding.h"
-#include "tfrt/bef/bef_reader.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/sync_kernel_frame.h"
+#include "tfrt/support/error_util.h"
 #include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
@@ -49,39 +49,22 @@ class BEFInterpreterImpl final {
                 ArrayRef<Value*> results);
 
  private:
-  struct KernelEntry {
-    SyncKernelImplementation kernel_fn;
-    // KernelEntry starting location in BEF.
-    const uint32_t* kernel_start;
-    // All attributes, including, function attributes.
-    // This refers to a segment in attribute_pool_.
-    int attribute_start;
-    int num_attributes;
-    // Registers that are retired after the execution of this kernel.
-    // This refers to a segment in retired_register_pool_.
-    ArrayRef<Value*> retired_regs;
-  };
-
-  // Set up the data for each kernel.
-  void SetupKernelEntries();
+  // Set up the registers for local values.
+  void Setup();
   // Set up the registers for the function computation.
   void SetupRegisters(ArrayRef<Value*> arguments, ArrayRef<Value*> results);
 
   const SyncBEFFunction& func_;
 
+  // The error message from decoding `func_`, if any. It is returned by
+  // Execute().
+  std::string decode_error_;
+
   // All registers used in the function.
   SmallVector<Value*, 16> registers_;
 
   // Store local Values used in the computation.
   SmallVector<Value, 16> local_values_;
-
-  // All kernel entries in the function.
-  SmallVector<KernelEntry, 16> kernel_entries_;
-
-  // Registers that are retired at each kernel.
-  SmallVector<Value*, 16> retired_register_pool_;
-  // Attributes used in all kernels.
-  SmallVector<const void*, 16> attribute_pool_;
 };
 
 //===----------------------------------------------------------------------===//
@@ -103,13 +86,22 @@ Error BEFInterpreter::Execute(const ExecutionContext& exec_ctx,
 BEFInterpreterImpl::BEFInterpreterImpl(const Function& func)
     : func_{static_cast<const SyncBEFFunction&>(func)} {
   assert(func.function_kind() == FunctionKind::kSyncBEFFunction);
+  // The function body is decoded on its first execution.
+  if (auto error = func_.EnsureDecoded()) {
+    decode_error_ = toString(std::move(error));
+    return;
+  }
+  Setup();
+}
+
+void BEFInterpreterImpl::Setup() {
   auto register_infos = func_.register_infos();
 
   size_t num_registers = register_infos.size();
 
   // Set up local values.
-  local_values_.resize(num_registers - func.num_arguments() -
-                       func.num_results());
+  local_values_.resize(num_registers - func_.num_arguments() -
+                       func_.num_results());
 
   registers_.reserve(num_registers);
   auto local_value_index = 0;
@@ -129,91 +121,6 @@ BEFInterpreterImpl::BEFInterpreterImpl(const Function& func)
       ++local_value_index;
     }
   }
-
-  SetupKernelEntries();
-}
-
-void BEFInterpreterImpl::SetupKernelEntries() {
-  SmallVector<int, 16> user_counts;
-
-  auto register_infos = func_.register_infos();
-  user_counts.reserve(register_infos.size());
-
-  // Initialize the user counts for each register.
-  for (auto& reg_info : register_infos) {
-    user_counts.emplace_back() = reg_info.user_count;
-  }
-
-  retired_register_pool_.reserve(local_values_.size());
-
-  // Prepare all kernel entries for this function.
-  for (auto kernel_offset : func_.kernel_offsets()) {
-    auto& kernel_entry = kernel_entries_.emplace_back();
-
-    // Get the KernelEntry starting location in BEF.
-    kernel_entry.kernel_start =
-        func_.kernels().data() + kernel_offset / kKernelEntryAlignment;
-
-    BEFKernel kernel(kernel_entry.kernel_start);
-
-    // Get the kernel function.
-    kernel_entry.kernel_fn =
-        func_.bef_file()->GetSyncKernel(kernel.kernel_code());
-    assert(kernel_entry.kernel_fn != nullptr);
-
-    int retired_reg_start = retired_register_pool_.size();
-
-    // Collect retired registers from arguments.
-    auto arguments = kernel.GetArguments();
-    for (auto reg_idx : arguments) {
-      auto& user_count = user_counts[reg_idx];
-
-      --user_count;
-      assert(user_count >= 0);
-      if (user_count == 0) {
-        auto* value = registers_[reg_idx];
-        assert(value);
-        retired_register_pool_.emplace_back(value);
-      }
-    }
-
-    // Collect retired registers from results.
-    auto results = kernel.GetResults();
-    for (auto reg_index : results) {
-      // If there is no use for the result, mark it as retired.
-      if (user_counts[reg_index] == 0) {
-        auto* value = registers_[reg_index];
-        assert(value);
-        retired_register_pool_.emplace_back(value);
-      }
-    }
-
-    // Set the retired registers for this kernel.
-    kernel_entry.retired_regs =
-        llvm::makeArrayRef(retired_register_pool_.begin() + retired_reg_start,
-                           retired_register_pool_.end());
-
-    // Collect the attributes
-    int attribute_start = attribute_pool_.size();
-    auto attributes = kernel.GetAttributes();
-    for (auto attribute_offset : attributes) {
-      // We pass the pointer here because this attribute could be an array of
-      // size 0.
-      attribute_pool_.emplace_back(func_.bef_file()->attribute_section_.data() +
-                                   attribute_offset);
-    }
-
-    // Collect the function attributes.
-    auto functions = kernel.GetFunctions();
-    for (auto fn_idx : functions) {
-      // Functions are passed as their corresponding `Function`.
-      attribute_pool_.emplace_back(func_.bef_file()->functions_[fn_idx].get());
-    }
-
-    // Set the attributes for this kernel.
-    kernel_entry.attribute_start = attribute_start;
-    kernel_entry.num_attributes = attribute_pool_.size() - attribute_start;
-  }
 }
 
 void BEFInterpreterImpl::SetupRegisters(ArrayRef<Value*> arguments,
@@ -244,24 +151,43 @@ Error BEFInterpreterImpl::Execute(const ExecutionContext& exec_ctx,
   assert(results.size() == func_.num_results() &&
          "incorrect number of results passed to function call");
 
+  if (!decode_error_.empty()) return MakeStringError(decode_error_);
+
   SetupRegisters(arguments, results);
 
+  const uint32_t* register_indices = func_.register_indices().data();
+  const void* const* attributes = func_.attributes().data();
+
+  ArrayRef<SyncBEFFunction::KernelEntry> kernel_entries =
+      func_.kernel_entries();
+  ArrayRef<const BEFSampleSite*> kernel_sample_sites =
+      func_.kernel_sample_sites();
+
   SyncKernelFrameBuilder kernel_frame(registers_, exec_ctx);
   // Walk through each kernel entry and invoke each kernel sequentially.
-  for (auto& kernel_entry : kernel_entries_) {
-    BEFKernel kernel(kernel_entry.kernel_start);
-
-    kernel_frame.SetArguments(kernel.GetArguments());
+  for (size_t i = 0, e = kernel_entries.size(); i != e; ++i) {
+    const auto& kernel_entry = kernel_entries[i];
+    const uint32_t* kernel_registers =
+        register_indices + kernel_entry.register_start;
+
+    kernel_frame.SetArguments(
+        llvm::makeArrayRef(kernel_registers, kernel_entry.num_arguments));
+    kernel_registers += kernel_entry.num_arguments;
     kernel_frame.SetAttributes(llvm::makeArrayRef(
-        attribute_pool_.data() + kernel_entry.attribute_start,
-        kernel_entry.num_attributes));
-    kernel_frame.SetResults(kernel.GetResults());
-
-    kernel_entry.kernel_fn(&kernel_frame);
+        attributes + kernel_entry.attribute_start, kernel_entry.num_attributes));
+    kernel_frame.SetResults(
+        llvm::makeArrayRef(kernel_registers, kernel_entry.num_results));
+    kernel_registers += kernel_entry.num_results;
+
+    {
+      BEFSampleScope sample_scope(func_.sample_site(), kernel_sample_sites[i]);
+      kernel_entry.kernel_fn(&kernel_frame);
+    }
 
     // Free values that are no longer needed.
-    for (auto value : kernel_entry.retired_regs) {
-      value->reset();
+    for (auto reg_idx : llvm::makeArrayRef(
+             kernel_registers, kernel_entry.num_retired_registers)) {
+      registers_[reg_idx]->reset();
     }
 
     // Check for error.
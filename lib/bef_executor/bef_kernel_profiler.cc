@@ -0,0 +1,171 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the per-kernel profiler for the BEFExecutor.
+
+#include "tfrt/bef_executor/bef_kernel_profiler.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+#include "bef_file_impl.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/bef/bef_reader.h"
+#include "tfrt/metrics/metrics.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+
+namespace {
+
+double ToMicroseconds(std::chrono::nanoseconds time) {
+  return std::chrono::duration<double, std::micro>(time).count();
+}
+
+}  // namespace
+
+BEFKernelProfiler::BEFKernelProfiler(int sample_period)
+    : sample_period_(std::max(sample_period, 1)) {}
+
+BEFKernelProfiler::KernelEntry& BEFKernelProfiler::GetKernelEntry(
+    BEFFileImpl* bef_file, const BEFKernel& kernel) {
+  auto it = kernel_entries_.find(kernel.kernel_start());
+  if (it != kernel_entries_.end()) return it->second;
+
+  // Resolve the name and the location of the kernel on its first record, so
+  // that later records only update the counters.
+  KernelEntry entry;
+  entry.profile.kernel_name = bef_file->GetKernelName(kernel.kernel_code());
+
+  BEFKernel mutable_kernel = kernel;
+  if (auto debug_info = bef_file->DecodeDebugInfo(&mutable_kernel))
+    entry.profile.debug_info = debug_info->str();
+
+  auto location = bef_file->DecodeLocation(kernel.kernel_location());
+  entry.profile.location =
+      StrCat(location.filename, ":", location.line, ":", location.column);
+
+  entry.time_histogram = GetHistogram(
+      StrCat("/tfrt/bef_executor/kernel_time_us/", entry.profile.kernel_name));
+  entry.async_wait_histogram =
+      GetHistogram(StrCat("/tfrt/bef_executor/kernel_async_wait_us/",
+                          entry.profile.kernel_name));
+
+  return kernel_entries_.try_emplace(kernel.kernel_start(), std::move(entry))
+      .first->second;
+}
+
+metrics::Histogram* BEFKernelProfiler::GetHistogram(std::string name) {
+  auto& histogram = histograms_[name];
+  if (!histogram) {
+    // Buckets from 1us to 1s.
+    static const auto* buckets =
+        new metrics::Buckets(metrics::Buckets::Explicit(
+            {1, 10, 100, 1000, 10000, 100000, 1000000}));
+    histogram = metrics::NewHistogram(std::move(name), *buckets);
+  }
+  return histogram;
+}
+
+void BEFKernelProfiler::RecordInvocation(BEFFileImpl* bef_file,
+                                         const BEFKernel& kernel,
+                                         std::chrono::nanoseconds time) {
+  mutex_lock lock(mu_);
+  auto& entry = GetKernelEntry(bef_file, kernel);
+  ++entry.profile.num_invocations;
+  entry.profile.total_time += time;
+  entry.time_histogram->Record(ToMicroseconds(time));
+}
+
+void BEFKernelProfiler::RecordAsyncWait(BEFFileImpl* bef_file,
+                                        const BEFKernel& kernel,
+                                        std::chrono::nanoseconds time) {
+  mutex_lock lock(mu_);
+  auto& entry = GetKernelEntry(bef_file, kernel);
+  ++entry.profile.num_async_waits;
+  entry.profile.async_wait_time += time;
+  entry.async_wait_histogram->Record(ToMicroseconds(time));
+}
+
+std::vector<BEFKernelProfile> BEFKernelProfiler::GetProfiles() const {
+  // Merge the entries of kernels with the same name, debug info and location.
+  std::map<std::tuple<std::string, std::string, std::string>, BEFKernelProfile>
+      merged_profiles;
+  {
+    mutex_lock lock(mu_);
+    for (const auto& kernel_entry : kernel_entries_) {
+      const auto& profile = kernel_entry.second.profile;
+      auto& merged = merged_profiles[std::make_tuple(
+          profile.kernel_name, profile.debug_info, profile.location)];
+      if (merged.kernel_name.empty()) {
+        merged.kernel_name = profile.kernel_name;
+        merged.debug_info = profile.debug_info;
+        merged.location = profile.location;
+      }
+      merged.num_invocations += profile.num_invocations;
+      merged.total_time += profile.total_time;
+      merged.num_async_waits += profile.num_async_waits;
+      merged.async_wait_time += profile.async_wait_time;
+    }
+  }
+
+  std::vector<BEFKernelProfile> profiles;
+  profiles.reserve(merged_profiles.size());
+  for (auto& merged : merged_profiles)
+    profiles.push_back(std::move(merged.second));
+
+  std::stable_sort(profiles.begin(), profiles.end(),
+                   [](const BEFKernelProfile& a, const BEFKernelProfile& b) {
+                     return a.total_time > b.total_time;
+                   });
+  return profiles;
+}
+
+void BEFKernelProfiler::Print(raw_ostream& os) const {
+  os << "--- Kernel profile:\n";
+  os << llvm::right_justify("invocations", 11)
+     << llvm::right_justify("total (us)", 15)
+     << llvm::right_justify("avg (us)", 13) << llvm::right_justify("waits", 9)
+     << llvm::right_justify("wait (us)", 15) << "  kernel @ location\n";
+  for (const auto& profile : GetProfiles()) {
+    double total_us = ToMicroseconds(profile.total_time);
+    double avg_us = profile.num_invocations > 0
+                        ? total_us / profile.num_invocations
+                        : 0.0;
+    os << llvm::format("%11lld %14.3f %12.3f %8lld %14.3f  ",
+                       static_cast<long long>(profile.num_invocations),
+                       total_us, avg_us,
+                       static_cast<long long>(profile.num_async_waits),
+                       ToMicroseconds(profile.async_wait_time));
+    os << profile.kernel_name;
+    if (!profile.debug_info.empty()) os << " (" << profile.debug_info << ")";
+    os << " @ " << profile.location << "\n";
+  }
+  os.flush();
+}
+
+void BEFKernelProfiler::WriteCostProfile(raw_ostream& os) const {
+  os << "# TFRT kernel cost profile: invocations, total time (ns), kernel, "
+        "location\n";
+  for (const auto& profile : GetProfiles()) {
+    if (profile.num_invocations == 0) continue;
+    os << profile.num_invocations << " " << profile.total_time.count() << " "
+       << profile.kernel_name << " " << profile.location << "\n";
+  }
+  os.flush();
+}
+
+}  // namespace tfrt
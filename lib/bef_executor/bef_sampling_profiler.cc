@@ -0,0 +1,225 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the sampling profiler for BEF function execution.
+
+#include "tfrt/bef_executor/bef_sampling_profiler.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/metrics/metrics.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+
+class BEFSampleSiteTable {
+ public:
+  const BEFSampleSite* Get(string_view name) {
+    mutex_lock lock(mu_);
+    auto it = sites_.try_emplace(name, BEFSampleSite(string_view()));
+    // The key of a StringMap entry doesn't move when the map grows.
+    if (it.second) it.first->second.name_ = it.first->getKey();
+    return &it.first->second;
+  }
+
+ private:
+  mutex mu_;
+  llvm::StringMap<BEFSampleSite> sites_ TFRT_GUARDED_BY(mu_);
+};
+
+const BEFSampleSite* BEFSampleSite::Get(string_view name) {
+  static auto* table = new BEFSampleSiteTable;
+  return table->Get(name);
+}
+
+namespace {
+
+// The slots of all threads that have executed BEF kernels. Slots are never
+// freed, the slots of exited threads are reused by new threads.
+class ExecutionSlotRegistry {
+ public:
+  static ExecutionSlotRegistry& Get() {
+    static auto* registry = new ExecutionSlotRegistry;
+    return *registry;
+  }
+
+  internal::BEFExecutionSlot* Register() {
+    mutex_lock lock(mu_);
+    if (!free_slots_.empty()) return free_slots_.pop_back_val();
+    slots_.push_back(std::make_unique<internal::BEFExecutionSlot>());
+    return slots_.back().get();
+  }
+
+  void Unregister(internal::BEFExecutionSlot* slot) {
+    slot->function.store(nullptr, std::memory_order_relaxed);
+    slot->kernel.store(nullptr, std::memory_order_relaxed);
+    mutex_lock lock(mu_);
+    free_slots_.push_back(slot);
+  }
+
+  // Calls `fn` with the function and the kernel of every executing thread.
+  template <typename F>
+  void ForEachExecutingThread(F fn) {
+    mutex_lock lock(mu_);
+    for (const auto& slot : slots_) {
+      const BEFSampleSite* kernel = slot->kernel.load(std::memory_order_acquire);
+      if (kernel == nullptr) continue;
+      fn(slot->function.load(std::memory_order_acquire), kernel);
+    }
+  }
+
+ private:
+  mutex mu_;
+  std::vector<std::unique_ptr<internal::BEFExecutionSlot>> slots_
+      TFRT_GUARDED_BY(mu_);
+  llvm::SmallVector<internal::BEFExecutionSlot*, 8> free_slots_
+      TFRT_GUARDED_BY(mu_);
+};
+
+// Returns the slot of the exiting thread to the registry.
+class ExecutionSlotOwner {
+ public:
+  explicit ExecutionSlotOwner(internal::BEFExecutionSlot* slot) : slot_(slot) {}
+  ~ExecutionSlotOwner() {
+    internal::CurrentExecutionSlot() = nullptr;
+    ExecutionSlotRegistry::Get().Unregister(slot_);
+  }
+
+ private:
+  internal::BEFExecutionSlot* slot_;
+};
+
+}  // namespace
+
+namespace internal {
+
+BEFExecutionSlot* RegisterExecutionSlot() {
+  BEFExecutionSlot* slot = ExecutionSlotRegistry::Get().Register();
+  thread_local ExecutionSlotOwner owner(slot);
+  CurrentExecutionSlot() = slot;
+  return slot;
+}
+
+}  // namespace internal
+
+BEFSamplingProfiler::BEFSamplingProfiler(
+    std::chrono::microseconds sample_period,
+    std::chrono::milliseconds export_period)
+    : sample_period_(std::max(sample_period, std::chrono::microseconds(1))),
+      export_period_(export_period) {
+  sample_thread_ = ThreadingEnvironment::StartThread(
+      "tfrt-bef-sampling-profiler", [this] { SampleLoop(); });
+}
+
+BEFSamplingProfiler::~BEFSamplingProfiler() {
+  {
+    mutex_lock lock(mu_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  sample_thread_.reset();  // Joins the thread.
+
+  mutex_lock lock(mu_);
+  ExportMetrics();
+}
+
+void BEFSamplingProfiler::SampleLoop() {
+  using Clock = std::chrono::steady_clock;
+  auto next_sample = Clock::now() + sample_period_;
+  auto next_export = Clock::now() + export_period_;
+  mutex_lock lock(mu_);
+  while (!cond_.wait_until(lock, next_sample, [this] { return stop_; })) {
+    Sample();
+    // Skip the samples that were missed, e.g. while the process was stopped,
+    // instead of taking them all at once.
+    auto now = Clock::now();
+    next_sample = std::max(next_sample + sample_period_, now);
+    if (now >= next_export) {
+      ExportMetrics();
+      next_export = now + export_period_;
+    }
+  }
+}
+
+void BEFSamplingProfiler::Sample() {
+  ExecutionSlotRegistry::Get().ForEachExecutingThread(
+      [&](const BEFSampleSite* function, const BEFSampleSite* kernel) {
+        ++kernel_entries_[std::make_pair(function, kernel)].num_samples;
+      });
+}
+
+void BEFSamplingProfiler::ExportMetrics() {
+  for (auto& pair : kernel_entries_) {
+    KernelEntry& entry = pair.second;
+    if (entry.num_samples == entry.num_exported_samples) continue;
+    if (entry.counter == nullptr) {
+      string_view function_name =
+          pair.first.first ? pair.first.first->name() : "(unknown)";
+      entry.counter = metrics::NewCounter(
+          StrCat("/tfrt/bef_executor/kernel_samples/", function_name, "/",
+                 pair.first.second->name()));
+    }
+    entry.counter->IncrementBy(entry.num_samples - entry.num_exported_samples);
+    entry.num_exported_samples = entry.num_samples;
+  }
+}
+
+std::vector<BEFSampleProfile> BEFSamplingProfiler::GetProfiles() const {
+  std::vector<BEFSampleProfile> profiles;
+  {
+    mutex_lock lock(mu_);
+    profiles.reserve(kernel_entries_.size());
+    for (const auto& pair : kernel_entries_) {
+      BEFSampleProfile profile;
+      if (pair.first.first)
+        profile.function_name = pair.first.first->name().str();
+      profile.kernel_name = pair.first.second->name().str();
+      profile.num_samples = pair.second.num_samples;
+      profiles.push_back(std::move(profile));
+    }
+  }
+
+  std::sort(profiles.begin(), profiles.end(),
+            [](const BEFSampleProfile& a, const BEFSampleProfile& b) {
+              return std::tie(b.num_samples, a.function_name, a.kernel_name) <
+                     std::tie(a.num_samples, b.function_name, b.kernel_name);
+            });
+  return profiles;
+}
+
+void BEFSamplingProfiler::Print(raw_ostream& os) const {
+  auto profiles = GetProfiles();
+  int64_t total_samples = 0;
+  for (const auto& profile : profiles) total_samples += profile.num_samples;
+
+  os << "--- Sampling profile (" << total_samples << " samples):\n";
+  os << llvm::right_justify("samples", 9) << llvm::right_justify("%", 8)
+     << "  function / kernel\n";
+  for (const auto& profile : profiles) {
+    os << llvm::format("%9lld %7.2f  ",
+                       static_cast<long long>(profile.num_samples),
+                       100.0 * profile.num_samples / total_samples);
+    os << (profile.function_name.empty() ? "(unknown)"
+                                         : profile.function_name)
+       << " / " << profile.kernel_name << "\n";
+  }
+  os.flush();
+}
+
+}  // namespace tfrt
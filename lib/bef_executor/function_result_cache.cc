@@ -0,0 +1,195 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements FunctionResultCache.
+
+#include "function_result_cache.h"
+
+#include <cstring>
+
+#include "tfrt/host_context/chain.h"
+#include "tfrt/support/hash_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+
+namespace {
+
+// The kinds of arguments that can be cached. They are hashed as part of the
+// argument, so that values of different types with the same bytes differ.
+enum class ArgumentKind : uint8_t {
+  kChain,
+  kBool,
+  kInt32,
+  kInt64,
+  kFloat,
+  kDouble,
+  kDenseHostTensor,
+};
+
+llvm::Optional<ArgumentKind> GetArgumentKind(const AsyncValue& value) {
+  if (value.IsType<Chain>()) return ArgumentKind::kChain;
+  if (value.IsType<bool>()) return ArgumentKind::kBool;
+  if (value.IsType<int32_t>()) return ArgumentKind::kInt32;
+  if (value.IsType<int64_t>()) return ArgumentKind::kInt64;
+  if (value.IsType<float>()) return ArgumentKind::kFloat;
+  if (value.IsType<double>()) return ArgumentKind::kDouble;
+  if (value.IsType<DenseHostTensor>()) return ArgumentKind::kDenseHostTensor;
+  return llvm::None;
+}
+
+template <typename T>
+uint64_t HashScalar(const AsyncValue& value, uint64_t seed) {
+  const T& scalar = value.get<T>();
+  return Hash64(reinterpret_cast<const char*>(&scalar), sizeof(T), seed);
+}
+
+uint64_t HashDenseHostTensor(const DenseHostTensor& tensor, uint64_t seed) {
+  const auto& metadata = tensor.metadata();
+  uint64_t hash = Hash64Combine(seed, metadata.dtype.kind());
+  for (int i = 0, e = metadata.shape.GetRank(); i != e; ++i)
+    hash = Hash64Combine(hash, metadata.shape.GetDimensionSize(i));
+  return Hash64(static_cast<const char*>(tensor.data()),
+                tensor.DataSizeInBytes(), hash);
+}
+
+uint64_t HashArgument(const AsyncValue& value, ArgumentKind kind) {
+  uint64_t seed = static_cast<uint64_t>(kind);
+  switch (kind) {
+    case ArgumentKind::kChain:
+      return seed;
+    case ArgumentKind::kBool:
+      return HashScalar<bool>(value, seed);
+    case ArgumentKind::kInt32:
+      return HashScalar<int32_t>(value, seed);
+    case ArgumentKind::kInt64:
+      return HashScalar<int64_t>(value, seed);
+    case ArgumentKind::kFloat:
+      return HashScalar<float>(value, seed);
+    case ArgumentKind::kDouble:
+      return HashScalar<double>(value, seed);
+    case ArgumentKind::kDenseHostTensor:
+      return HashDenseHostTensor(value.get<DenseHostTensor>(), seed);
+  }
+  llvm_unreachable("unknown argument kind");
+}
+
+// Scalars are compared bitwise, consistently with their hashes.
+template <typename T>
+bool ScalarEqual(const AsyncValue& a, const AsyncValue& b) {
+  return std::memcmp(&a.get<T>(), &b.get<T>(), sizeof(T)) == 0;
+}
+
+bool ArgumentEqual(const AsyncValue& a, const AsyncValue& b) {
+  auto kind = GetArgumentKind(a);
+  if (!kind || kind != GetArgumentKind(b)) return false;
+  switch (*kind) {
+    case ArgumentKind::kChain:
+      return true;
+    case ArgumentKind::kBool:
+      return ScalarEqual<bool>(a, b);
+    case ArgumentKind::kInt32:
+      return ScalarEqual<int32_t>(a, b);
+    case ArgumentKind::kInt64:
+      return ScalarEqual<int64_t>(a, b);
+    case ArgumentKind::kFloat:
+      return ScalarEqual<float>(a, b);
+    case ArgumentKind::kDouble:
+      return ScalarEqual<double>(a, b);
+    case ArgumentKind::kDenseHostTensor:
+      return a.get<DenseHostTensor>() == b.get<DenseHostTensor>();
+  }
+  llvm_unreachable("unknown argument kind");
+}
+
+}  // namespace
+
+llvm::Optional<uint64_t> FunctionResultCache::HashArguments(
+    ArrayRef<AsyncValue*> arguments) {
+  uint64_t hash = arguments.size();
+  for (auto* argument : arguments) {
+    if (!argument->IsConcrete()) return llvm::None;
+    auto kind = GetArgumentKind(*argument);
+    if (!kind) return llvm::None;
+    hash = Hash64Combine(hash, HashArgument(*argument, *kind));
+  }
+  return hash;
+}
+
+uint64_t FunctionResultCache::GetKeyHash(const Function* fn, HostContext* host,
+                                         uint64_t arguments_hash) {
+  uint64_t hash = Hash64Combine(reinterpret_cast<uintptr_t>(fn),
+                                reinterpret_cast<uintptr_t>(host));
+  return Hash64Combine(hash, arguments_hash);
+}
+
+bool FunctionResultCache::Lookup(
+    const Function* fn, HostContext* host, uint64_t arguments_hash,
+    ArrayRef<AsyncValue*> arguments,
+    MutableArrayRef<RCReference<AsyncValue>> results) {
+  mutex_lock lock(mu_);
+  auto it = index_.find(GetKeyHash(fn, host, arguments_hash));
+  if (it == index_.end()) return false;
+
+  const Entry& entry = *it->second;
+  if (entry.fn != fn || entry.host != host || entry.hash != arguments_hash ||
+      entry.arguments.size() != arguments.size())
+    return false;
+  for (size_t i = 0, e = arguments.size(); i != e; ++i) {
+    if (!ArgumentEqual(*entry.arguments[i], *arguments[i])) return false;
+  }
+
+  assert(entry.results.size() == results.size());
+  for (size_t i = 0, e = results.size(); i != e; ++i)
+    results[i] = entry.results[i].CopyRef();
+
+  // Move the entry to the front of the LRU list.
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return true;
+}
+
+void FunctionResultCache::Insert(const Function* fn, HostContext* host,
+                                 uint64_t arguments_hash,
+                                 ArrayRef<RCReference<AsyncValue>> arguments,
+                                 ArrayRef<RCReference<AsyncValue>> results) {
+  if (capacity_ == 0) return;
+  for (const auto& result : results) {
+    assert(result->IsAvailable());
+    if (result->IsError()) return;
+  }
+
+  Entry entry{fn, host, arguments_hash, {}, {}};
+  for (const auto& argument : arguments)
+    entry.arguments.push_back(argument.CopyRef());
+  for (const auto& result : results) entry.results.push_back(result.CopyRef());
+
+  // The evicted entries are destroyed after the lock is released.
+  EntryList evicted_entries;
+  {
+    mutex_lock lock(mu_);
+    uint64_t key_hash = GetKeyHash(fn, host, arguments_hash);
+    auto it = index_.find(key_hash);
+    if (it != index_.end()) {
+      evicted_entries.splice(evicted_entries.end(), entries_, it->second);
+    } else if (entries_.size() >= capacity_) {
+      auto last = std::prev(entries_.end());
+      index_.erase(GetKeyHash(last->fn, last->host, last->hash));
+      evicted_entries.splice(evicted_entries.end(), entries_, last);
+    }
+    entries_.push_front(std::move(entry));
+    index_[key_hash] = entries_.begin();
+  }
+}
+
+}  // namespace tfrt
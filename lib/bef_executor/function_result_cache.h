@@ -0,0 +1,105 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares FunctionResultCache, which memoizes the results of pure
+// BEF functions.
+
+#ifndef TFRT_LIB_BEF_EXECUTOR_FUNCTION_RESULT_CACHE_H_
+#define TFRT_LIB_BEF_EXECUTOR_FUNCTION_RESULT_CACHE_H_
+
+#include <cstdint>
+#include <list>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+class Function;
+class HostContext;
+
+// FunctionResultCache is a thread-safe LRU cache of the results of the
+// functions of a BEF file that are marked with kPureFunction. Entries are
+// keyed by the function, the HostContext it runs on and the values of its
+// arguments, so a hit returns the AsyncValues produced by an earlier execution
+// with equal arguments.
+//
+// Only concrete arguments of type Chain, bool, int32_t, int64_t, float, double
+// and DenseHostTensor can be cached. DenseHostTensors are compared by their
+// metadata and contents.
+//
+// The cached AsyncValues are destroyed with the cache, so a BEF file with
+// cached results must be destroyed before the HostContexts that allocated them.
+class FunctionResultCache {
+ public:
+  static constexpr size_t kDefaultCapacity = 1024;
+
+  explicit FunctionResultCache(size_t capacity = kDefaultCapacity)
+      : capacity_(capacity) {}
+
+  FunctionResultCache(const FunctionResultCache&) = delete;
+  FunctionResultCache& operator=(const FunctionResultCache&) = delete;
+
+  // Return the hash of `arguments`, or None if any of them can not be cached.
+  static llvm::Optional<uint64_t> HashArguments(
+      ArrayRef<AsyncValue*> arguments);
+
+  // If the results of `fn` on `host` for `arguments` are cached, set `results`
+  // to them and return true. `arguments_hash` is the value returned by
+  // HashArguments() for `arguments`.
+  bool Lookup(const Function* fn, HostContext* host, uint64_t arguments_hash,
+              ArrayRef<AsyncValue*> arguments,
+              MutableArrayRef<RCReference<AsyncValue>> results);
+
+  // Cache `results` of `fn` on `host` for `arguments`, evicting the least
+  // recently used entry if the cache is full. `results` must all be
+  // available. They are not cached if any of them is an error.
+  void Insert(const Function* fn, HostContext* host, uint64_t arguments_hash,
+              ArrayRef<RCReference<AsyncValue>> arguments,
+              ArrayRef<RCReference<AsyncValue>> results);
+
+ private:
+  struct Entry {
+    const Function* fn;
+    HostContext* host;
+    uint64_t hash;
+    SmallVector<RCReference<AsyncValue>, 4> arguments;
+    SmallVector<RCReference<AsyncValue>, 4> results;
+  };
+  using EntryList = std::list<Entry>;
+
+  // Return the hash of the key of an entry.
+  static uint64_t GetKeyHash(const Function* fn, HostContext* host,
+                             uint64_t arguments_hash);
+
+  const size_t capacity_;
+
+  mutex mu_;
+  // The entries in the order of their last use, most recent first.
+  EntryList entries_ TFRT_GUARDED_BY(mu_);
+  // The entries indexed by the hash of their key. Only one entry is kept for
+  // each hash. An entry whose key collides with an existing one replaces it.
+  llvm::DenseMap<uint64_t, EntryList::iterator> index_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_BEF_EXECUTOR_FUNCTION_RESULT_CACHE_H_
@@ -18,32 +18,51 @@
 // up a given mlir file and then runs it with a host executor.
 #include "tfrt/bef_executor_driver/bef_executor_driver.h"
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <limits>
+#include <memory>
+#include <random>
+#include <thread>
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/ScopeExit.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm_derived/Support/raw_ostream.h"
 #include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/Support/FileUtilities.h"
 #include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef_executor/bef_execution_options.h"
 #include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/bef_executor/bef_kernel_profiler.h"
+#include "tfrt/bef_executor/bef_sampling_profiler.h"
 #include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/core_runtime/request_signature.h"
 #include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/location.h"
+#include "tfrt/host_context/numa.h"
 #include "tfrt/host_context/profiled_allocator.h"
 #include "tfrt/host_context/resource_context.h"
+#include "tfrt/host_context/startup_profile.h"
 #include "tfrt/host_context/value.h"
 #include "tfrt/metrics/common_metrics.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/latency_histogram.h"
 #include "tfrt/support/mutex.h"
 #include "tfrt/support/string_util.h"
 #include "tfrt/tracing/tracing.h"
@@ -56,16 +75,67 @@ static void RunBefFunction(
     const std::function<llvm::Expected<ExecutionContext>(
         HostContext*, ResourceContext*)>& create_execution_context,
     bool print_error_code);
+static Error WarmUpBefFile(
+    HostContext* host, const BEFFile& bef, const RunBefConfig& run_config,
+    const std::function<llvm::Expected<ExecutionContext>(
+        HostContext*, ResourceContext*)>& create_execution_context);
+static void RunBefFunctionUnderLoad(
+    HostContext* host, const Function* function,
+    const std::function<llvm::Expected<ExecutionContext>(
+        HostContext*, ResourceContext*)>& create_execution_context,
+    const RunBefConfig& run_config);
 
 int RunBefExecutor(const RunBefConfig& run_config) {
-  return RunBefExecutor(
+  BEFExecutionOptions execution_options;
+  execution_options.scheduling_mode = run_config.scheduling_mode;
+  execution_options.scheduled_functions.assign(
+      run_config.scheduled_functions.begin(),
+      run_config.scheduled_functions.end());
+  execution_options.prioritize_critical_path =
+      run_config.prioritize_critical_path;
+
+  std::unique_ptr<BEFKernelProfiler> kernel_profiler;
+  if (run_config.print_kernel_profile ||
+      !run_config.kernel_cost_profile_filename.empty()) {
+    kernel_profiler = std::make_unique<BEFKernelProfiler>();
+    execution_options.kernel_profiler = kernel_profiler.get();
+  }
+  std::unique_ptr<BEFSamplingProfiler> sampling_profiler;
+  if (run_config.print_sampling_profile)
+    sampling_profiler = std::make_unique<BEFSamplingProfiler>();
+  if (run_config.print_startup_profile) EnableStartupProfile(true);
+
+  auto result = RunBefExecutor(
       run_config,
-      [](HostContext* host, ResourceContext* resource_context)
+      [&execution_options, &run_config](HostContext* host,
+                                        ResourceContext* resource_context)
           -> llvm::Expected<ExecutionContext> {
-        auto req_ctx = RequestContextBuilder(host, resource_context).build();
+        RequestContextBuilder req_ctx_builder(host, resource_context);
+        req_ctx_builder.context_data().emplace<BEFExecutionOptions>(
+            execution_options);
+        if (run_config.arena_chunk_size > 0)
+          req_ctx_builder.enable_arena_allocator(run_config.arena_chunk_size);
+        auto req_ctx = std::move(req_ctx_builder).build();
         if (!req_ctx) return req_ctx.takeError();
         return ExecutionContext{std::move(req_ctx.get())};
       });
+
+  if (run_config.print_kernel_profile) kernel_profiler->Print(tfrt::outs());
+  if (!run_config.kernel_cost_profile_filename.empty()) {
+    std::error_code error_code;
+    llvm::raw_fd_ostream os(run_config.kernel_cost_profile_filename,
+                            error_code);
+    if (error_code) {
+      llvm::errs() << run_config.program_name << ": couldn't open "
+                   << run_config.kernel_cost_profile_filename << ": "
+                   << error_code.message() << "\n";
+      return 1;
+    }
+    kernel_profiler->WriteCostProfile(os);
+  }
+  if (sampling_profiler) sampling_profiler->Print(tfrt::outs());
+  if (run_config.print_startup_profile) PrintStartupProfile(tfrt::outs());
+  return result;
 }
 
 int RunBefExecutor(
@@ -79,7 +149,10 @@ int RunBefExecutor(
 
   // Set up the input file.
   std::string error_message;
-  auto file = mlir::openInputFile(run_config.input_filename, &error_message);
+  auto file = [&] {
+    StartupPhase phase("read input file");
+    return mlir::openInputFile(run_config.input_filename, &error_message);
+  }();
   if (!file) {
     llvm::errs() << error_message << "\n";
     return 1;
@@ -90,9 +163,12 @@ int RunBefExecutor(
   source_mgr.AddNewSourceBuffer(std::move(file), llvm::SMLoc());
 
   // Parse the input file.
-  mlir::MLIRContext context;
+  auto context = [] {
+    StartupPhase phase("create MLIR context");
+    return std::make_unique<mlir::MLIRContext>();
+  }();
   mlir::SourceMgrDiagnosticVerifierHandler source_mgr_handler(source_mgr,
-                                                              &context);
+                                                              context.get());
 
   auto decoded_diagnostic_handler = [&](const DecodedDiagnostic& diag) {
     std::string message = "runtime error: " + diag.message;
@@ -100,11 +176,11 @@ int RunBefExecutor(
     auto decoded_loc = diag.location;
     if (decoded_loc) {
       auto loc =
-          mlir::FileLineColLoc::get(&context, decoded_loc->filename,
+          mlir::FileLineColLoc::get(context.get(), decoded_loc->filename,
                                     decoded_loc->line, decoded_loc->column);
       emitError(loc) << message;
     } else {
-      auto loc = mlir::FileLineColLoc::get(&context, "", 0, 0);
+      auto loc = mlir::FileLineColLoc::get(context.get(), "", 0, 0);
       emitError(loc) << message;
     }
   };
@@ -112,6 +188,18 @@ int RunBefExecutor(
   assert(GetNumReferenceCountedObjects() == 0 &&
          "We have reference-counted objects before we started to do anything");
 
+  // Only the profiled allocators sample allocations for heap profiles.
+  const size_t sample_period = run_config.heap_profile_filename.empty()
+                                   ? 0
+                                   : run_config.heap_profile_sample_period;
+  if (sample_period > 0 &&
+      run_config.host_allocator_type != HostAllocatorType::kProfiledMalloc &&
+      run_config.host_allocator_type != HostAllocatorType::kLeakCheckMalloc) {
+    llvm::errs() << run_config.program_name
+                 << ": heap profiles require a profiled host allocator\n";
+    return 1;
+  }
+
   std::unique_ptr<HostAllocator> host_allocator;
   switch (run_config.host_allocator_type) {
     case HostAllocatorType::kMalloc:
@@ -124,13 +212,27 @@ int RunBefExecutor(
       break;
     case HostAllocatorType::kProfiledMalloc:
       host_allocator = CreateMallocAllocator();
-      host_allocator = CreateProfiledAllocator(std::move(host_allocator));
+      host_allocator =
+          CreateProfiledAllocator(std::move(host_allocator), sample_period);
       tfrt::outs() << "Choosing profiled allocator based on malloc.\n";
       break;
     case HostAllocatorType::kLeakCheckMalloc:
       host_allocator = CreateMallocAllocator();
-      host_allocator = CreateLeakCheckAllocator(std::move(host_allocator));
+      host_allocator =
+          CreateLeakCheckAllocator(std::move(host_allocator), sample_period);
       tfrt::outs() << "Choosing memory leak check allocator.\n";
+      break;
+    case HostAllocatorType::kSlab:
+      host_allocator = CreateSlabAllocator();
+      tfrt::outs() << "Choosing slab allocator.\n";
+      break;
+    case HostAllocatorType::kNumaSlab:
+      host_allocator = CreateNumaAllocator(CreateSlabAllocator);
+      tfrt::outs() << "Choosing NUMA slab allocator.\n";
+      break;
+    case HostAllocatorType::kHugePageSlab:
+      host_allocator = CreateHugePageAllocator(CreateSlabAllocator());
+      tfrt::outs() << "Choosing slab allocator with huge pages.\n";
   }
   tfrt::outs().flush();
 
@@ -178,9 +280,13 @@ int RunBefExecutor(
            "We have live reference-counted objects before exit.");
   });
 
-  auto core_rt =
-      CoreRuntime::Create(decoded_diagnostic_handler, std::move(host_allocator),
-                          std::move(work_queue));
+  SetDeferStaticKernelFamilies(run_config.defer_kernel_registration);
+  auto core_rt = [&] {
+    StartupPhase phase("create core runtime");
+    return CoreRuntime::Create(decoded_diagnostic_handler,
+                               std::move(host_allocator),
+                               std::move(work_queue));
+  }();
   if (!core_rt) {
     llvm::errs() << core_rt.takeError();
     return 1;
@@ -191,6 +297,7 @@ int RunBefExecutor(
   // If there are any libraries specified, load them and see if they have a
   // kernel registration function.
   for (const auto& lib_name : run_config.shared_libs) {
+    StartupPhase phase(StrCat("load shared library ", lib_name));
     std::string err;
     auto dyn_lib =
         llvm::sys::DynamicLibrary::getPermanentLibrary(lib_name.c_str(), &err);
@@ -207,9 +314,42 @@ int RunBefExecutor(
     }
   }
 
+  // All kernels are registered, freeze the registry to speed up the kernel
+  // lookups of BEFFile::Open().
+  {
+    StartupPhase phase("freeze kernel registry");
+    host->GetMutableRegistry()->Freeze();
+  }
+
+  // Open the preloaded BEF files on their own threads, while the input file is
+  // opened on this one. The kernel registry supports concurrent lookups.
+  std::vector<RCReference<BEFFile>> preloaded_befs(
+      run_config.preload_bef_files.size());
+  std::atomic<int> num_preload_errors{0};
+  std::vector<std::thread> preload_threads;
+  for (int i = 0, e = preloaded_befs.size(); i != e; ++i) {
+    preload_threads.emplace_back([&, i] {
+      std::string path = run_config.preload_bef_files[i];
+      preloaded_befs[i] = BEFFile::OpenMapped(
+          path, host->GetKernelRegistry(),
+          [path](const DecodedDiagnostic& diag) {
+            llvm::errs() << path << ": " << diag.message << "\n";
+          },
+          host->allocator());
+      if (!preloaded_befs[i]) num_preload_errors.fetch_add(1);
+    });
+  }
+
   auto bef(BEFFile::Open(buffer_arr, host->GetKernelRegistry(),
                          decoded_diagnostic_handler, host->allocator()));
 
+  for (auto& thread : preload_threads) thread.join();
+  if (num_preload_errors > 0) {
+    llvm::errs() << run_config.program_name << ": couldn't preload "
+                 << num_preload_errors.load() << " BEF files\n";
+    return 1;
+  }
+
   if (!bef) {
     return mlir::failed(source_mgr_handler.verify());
   }
@@ -239,19 +379,66 @@ int RunBefExecutor(
   auto test_init_function = bef->GetFunction(run_config.test_init_function);
 
   if (test_init_function) {
+    StartupPhase phase(
+        StrCat("first call '", test_init_function->name(), "'"));
     RunBefFunction(host, test_init_function, create_execution_context,
                    run_config.print_error_code);
   }
 
+  // Call the recorded functions before the first calls to warm up the caches.
+  if (!run_config.warmup_signatures_filename.empty()) {
+    StartupPhase phase("warm-up");
+    if (auto error = WarmUpBefFile(host, *bef, run_config,
+                                   create_execution_context)) {
+      llvm::errs() << run_config.program_name << ": "
+                   << toString(std::move(error)) << "\n";
+      return 1;
+    }
+  }
+
   // Loop over each of the functions, running each as a standalone testcase.
+  const bool under_load =
+      run_config.load_num_callers > 0 || run_config.load_qps > 0;
+  RequestRecorder recorder;
   for (auto* fn : function_list) {
-    if (fn != test_init_function) {
+    if (fn == test_init_function) continue;
+    if (fn->argument_types().empty()) recorder.Record(*fn, /*arguments=*/{});
+    if (under_load) {
+      RunBefFunctionUnderLoad(host, fn, create_execution_context, run_config);
+    } else {
+      // Each function is called once, which includes e.g. JIT compilation.
+      StartupPhase phase(StrCat("first call '", fn->name(), "'"));
       RunBefFunction(host, fn, create_execution_context,
                      run_config.print_error_code);
     }
   }
 
+  if (!run_config.record_signatures_filename.empty()) {
+    std::error_code error_code;
+    llvm::raw_fd_ostream os(run_config.record_signatures_filename, error_code);
+    if (error_code) {
+      llvm::errs() << run_config.program_name << ": couldn't open "
+                   << run_config.record_signatures_filename << ": "
+                   << error_code.message() << "\n";
+      return 1;
+    }
+    recorder.Write(os);
+  }
+
+  if (!run_config.heap_profile_filename.empty()) {
+    std::error_code error_code;
+    llvm::raw_fd_ostream os(run_config.heap_profile_filename, error_code);
+    if (error_code) {
+      llvm::errs() << run_config.program_name << ": couldn't open "
+                   << run_config.heap_profile_filename << ": "
+                   << error_code.message() << "\n";
+      return 1;
+    }
+    WriteHeapProfile(os);
+  }
+
   bef.reset();
+  preloaded_befs.clear();
   // Verify the diagnostic handler to make sure that each of the diagnostics
   // matched.
   return mlir::failed(source_mgr_handler.verify());
@@ -276,6 +463,31 @@ static void PrintResult(const TypeName& type_name, const ValueType& result) {
   }
 }
 
+// Calls the functions of the signatures in the warm-up signatures file.
+static Error WarmUpBefFile(
+    HostContext* host, const BEFFile& bef, const RunBefConfig& run_config,
+    const std::function<llvm::Expected<ExecutionContext>(
+        HostContext*, ResourceContext*)>& create_execution_context) {
+  auto buffer =
+      llvm::MemoryBuffer::getFile(run_config.warmup_signatures_filename);
+  if (!buffer)
+    return MakeStringError("couldn't open ",
+                           run_config.warmup_signatures_filename, ": ",
+                           buffer.getError().message());
+  auto signatures = ParseRequestSignatures((*buffer)->getBuffer());
+  if (!signatures) return signatures.takeError();
+
+  ResourceContext resource_context;
+  auto exec_ctx = create_execution_context(host, &resource_context);
+  if (!exec_ctx) return exec_ctx.takeError();
+  auto error = WarmUp(
+      *signatures,
+      [&bef](string_view name) { return bef.GetFunction(name); },
+      exec_ctx.get());
+  host->Quiesce();
+  return error;
+}
+
 static void RunSyncBefFunctionHelper(const ExecutionContext& exec_ctx,
                                      const Function* function) {
   TFRT_TRACE_SCOPE(Default, StrCat("Function: ", function->name()));
@@ -365,23 +577,26 @@ static void RunAsyncBefFunctionHelper(const ExecutionContext& exec_ctx,
   exec_ctx.host()->Quiesce();
 }
 
-static void RunBefFunction(
-    HostContext* host, const Function* function,
-    const std::function<llvm::Expected<ExecutionContext>(
-        HostContext*, ResourceContext*)>& create_execution_context,
-    bool print_error_code) {
+// Returns true if the function can be run from this driver.
+static bool IsRunnable(const Function* function) {
   // If the function takes arguments, then we can't run it from this driver.
   if (!function->argument_types().empty()) {
     tfrt::outs() << "--- Not running '" << function->name()
                  << "' because it has arguments.\n";
     tfrt::outs().flush();
-    return;
+    return false;
   }
 
   // Skip anonymous functions.
-  if (function->name().empty()) {
-    return;
-  }
+  return !function->name().empty();
+}
+
+static void RunBefFunction(
+    HostContext* host, const Function* function,
+    const std::function<llvm::Expected<ExecutionContext>(
+        HostContext*, ResourceContext*)>& create_execution_context,
+    bool print_error_code) {
+  if (!IsRunnable(function)) return;
 
   // Async value leak check before and after running the function.
   size_t before_num_values;
@@ -423,4 +638,197 @@ static void RunBefFunction(
   }
 }
 
+namespace {
+// Calls a function repeatedly in a closed or open loop and records the latency
+// of the calls that start after the warmup.
+class LoadGenerator {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  LoadGenerator(HostContext* host, const Function* function,
+                const std::function<llvm::Expected<ExecutionContext>(
+                    HostContext*, ResourceContext*)>& create_execution_context,
+                const RunBefConfig& run_config)
+      : host_(host),
+        function_(function),
+        create_execution_context_(create_execution_context),
+        run_config_(run_config),
+        done_(MakeConstructedAsyncValueRef<Chain>(host)) {}
+
+  // Runs the calls and blocks until all of them have completed.
+  void Run();
+
+  void PrintResults(raw_ostream& os) const;
+
+ private:
+  // Calls the function and invokes `on_done` when the call has completed.
+  void Call(Clock::time_point start, llvm::unique_function<void()> on_done);
+  void Complete(Clock::time_point start, bool failed);
+
+  // Each caller of the closed loop calls the function until the end.
+  void CallInClosedLoop();
+  // Generates the arrivals of the open loop until the end.
+  void GenerateOpenLoop();
+  // Decrements the number of pending callers and arrivals.
+  void Release();
+
+  HostContext* host_;
+  const Function* function_;
+  const std::function<llvm::Expected<ExecutionContext>(
+      HostContext*, ResourceContext*)>& create_execution_context_;
+  const RunBefConfig& run_config_;
+
+  // Shared across the calls, but not across functions.
+  ResourceContext resource_context_;
+
+  Clock::time_point measure_start_;
+  Clock::time_point end_;
+
+  // Sets `done_` when it drops to zero.
+  std::atomic<int> num_pending_{0};
+  AsyncValueRef<Chain> done_;
+
+  std::atomic<int64_t> num_errors_{0};
+  LatencyHistogram histogram_;
+};
+}  // namespace
+
+static LoadGenerator::Clock::duration Seconds(double seconds) {
+  return std::chrono::duration_cast<LoadGenerator::Clock::duration>(
+      std::chrono::duration<double>(seconds));
+}
+
+void LoadGenerator::Run() {
+  measure_start_ = Clock::now() + Seconds(run_config_.load_warmup_secs);
+  end_ = measure_start_ + Seconds(run_config_.load_duration_secs);
+
+  std::thread open_loop;
+  if (run_config_.load_qps > 0) {
+    // The arrivals are generated on a separate thread, so that they don't
+    // wait for the calls.
+    num_pending_ = 1;
+    open_loop = std::thread([this] { GenerateOpenLoop(); });
+  } else {
+    num_pending_ = run_config_.load_num_callers;
+    for (int i = 0; i < run_config_.load_num_callers; ++i)
+      EnqueueWork(host_, [this] { CallInClosedLoop(); });
+  }
+
+  host_->Await(done_.CopyRCRef());
+  if (open_loop.joinable()) open_loop.join();
+  host_->Quiesce();
+}
+
+void LoadGenerator::Release() {
+  if (num_pending_.fetch_sub(1) == 1) done_.SetStateConcrete();
+}
+
+void LoadGenerator::CallInClosedLoop() {
+  auto now = Clock::now();
+  if (now >= end_) return Release();
+  // Enqueue the next call to avoid recursion if the call completes
+  // synchronously.
+  Call(now, [this] { EnqueueWork(host_, [this] { CallInClosedLoop(); }); });
+}
+
+void LoadGenerator::GenerateOpenLoop() {
+  // Use a fixed seed, so that runs have the same arrivals.
+  std::mt19937_64 rng(0);
+  std::exponential_distribution<double> interval_secs(run_config_.load_qps);
+  auto arrival = Clock::now();
+  while (true) {
+    arrival += Seconds(interval_secs(rng));
+    if (arrival >= end_) break;
+    std::this_thread::sleep_until(arrival);
+    num_pending_.fetch_add(1);
+    EnqueueWork(host_, [this, arrival] {
+      Call(arrival, [this] { Release(); });
+    });
+  }
+  Release();
+}
+
+void LoadGenerator::Call(Clock::time_point start,
+                         llvm::unique_function<void()> on_done) {
+  auto exec_ctx = create_execution_context_(host_, &resource_context_);
+  if (!exec_ctx) {
+    llvm::errs() << "Failed to create execution context.\n";
+    abort();
+  }
+
+  if (function_->function_kind() == FunctionKind::kSyncBEFFunction) {
+    llvm::SmallVector<Value, 4> results;
+    results.resize(function_->result_types().size());
+    llvm::SmallVector<Value*, 4> result_ptrs;
+    for (auto& value : results) result_ptrs.push_back(&value);
+    auto error = ExecuteSyncBEFFunction(*function_, *exec_ctx,
+                                        /*arguments=*/{}, result_ptrs);
+    Complete(start, static_cast<bool>(error));
+    llvm::consumeError(std::move(error));
+    return on_done();
+  }
+
+  auto results = std::make_shared<SmallVector<RCReference<AsyncValue>, 4>>();
+  results->resize(function_->result_types().size());
+  function_->Execute(*exec_ctx, /*arguments=*/{}, *results);
+  RunWhenReady(*results, [this, start, results, on_done = std::move(on_done),
+                          exec_ctx = std::move(*exec_ctx)]() mutable {
+    bool failed = llvm::any_of(
+        *results, [](const auto& result) { return result->IsError(); });
+    Complete(start, failed);
+    results->clear();
+    on_done();
+  });
+}
+
+void LoadGenerator::Complete(Clock::time_point start, bool failed) {
+  if (start < measure_start_) return;
+  histogram_.Record(Clock::now() - start);
+  if (failed) num_errors_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LoadGenerator::PrintResults(raw_ostream& os) const {
+  auto name = function_->name();
+  auto to_us = [](LatencyHistogram::Duration duration) {
+    return llvm::format(
+        "%.1f", std::chrono::duration<double, std::micro>(duration).count());
+  };
+  os << "'" << name << "' completed " << histogram_.count() << " calls ("
+     << num_errors_.load() << " errors), "
+     << llvm::format("%.1f",
+                     histogram_.count() / run_config_.load_duration_secs)
+     << " calls/s\n";
+  os << "'" << name << "' latency(us): min " << to_us(histogram_.Min())
+     << ", mean " << to_us(histogram_.Mean());
+  for (double percentile : {50.0, 90.0, 99.0, 99.9}) {
+    os << ", p" << llvm::format("%g", percentile) << " "
+       << to_us(histogram_.Percentile(percentile));
+  }
+  os << ", max " << to_us(histogram_.Max()) << "\n";
+  os.flush();
+}
+
+static void RunBefFunctionUnderLoad(
+    HostContext* host, const Function* function,
+    const std::function<llvm::Expected<ExecutionContext>(
+        HostContext*, ResourceContext*)>& create_execution_context,
+    const RunBefConfig& run_config) {
+  if (!IsRunnable(function)) return;
+
+  tfrt::outs() << "--- Running '" << function->name() << "' under load: ";
+  if (run_config.load_qps > 0)
+    tfrt::outs() << llvm::format("%g", run_config.load_qps) << " calls/s";
+  else
+    tfrt::outs() << run_config.load_num_callers << " callers";
+  tfrt::outs() << " for " << llvm::format("%g", run_config.load_duration_secs)
+               << "s after " << llvm::format("%g", run_config.load_warmup_secs)
+               << "s warmup\n";
+  tfrt::outs().flush();
+
+  LoadGenerator load_generator(host, function, create_execution_context,
+                               run_config);
+  load_generator.Run();
+  load_generator.PrintResults(tfrt::outs());
+}
+
 }  // namespace tfrt
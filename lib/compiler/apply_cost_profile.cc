@@ -0,0 +1,170 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This implements the pass that sets operation costs from a kernel cost
+// profile.
+
+#include "tfrt/compiler/apply_cost_profile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <tuple>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Location.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+struct ProfileRecord {
+  int64_t invocations = 0;
+  int64_t total_ns = 0;
+};
+
+// Returns the key of a kernel in the profile.
+std::string GetProfileKey(llvm::StringRef kernel_name,
+                          llvm::StringRef location) {
+  return (kernel_name + " " + location).str();
+}
+
+// Returns the profile key of `op`, or an empty string if `op` has no file
+// location. This matches the location that mlir_to_bef emits for `op`.
+std::string GetProfileKey(mlir::Operation* op) {
+  mlir::Location loc = op->getLoc();
+  if (auto fused_loc = loc.dyn_cast<mlir::FusedLoc>()) {
+    for (mlir::Location child : fused_loc.getLocations()) {
+      if (child.isa<mlir::FileLineColLoc>()) {
+        loc = child;
+        break;
+      }
+    }
+  }
+  auto file_loc = loc.dyn_cast<mlir::FileLineColLoc>();
+  if (!file_loc) return "";
+
+  std::string location;
+  llvm::raw_string_ostream os(location);
+  os << file_loc.getFilename() << ":" << file_loc.getLine() << ":"
+     << file_loc.getColumn();
+  return GetProfileKey(op->getName().getStringRef(), os.str());
+}
+
+// Parses the lines "<invocations> <total ns> <kernel name> <location>" of a
+// kernel cost profile. Records of the same kernel, e.g. from concatenated
+// profiles of several runs, are added up.
+mlir::LogicalResult ParseCostProfile(llvm::StringRef buffer,
+                                     llvm::StringMap<ProfileRecord>* records,
+                                     mlir::ModuleOp module) {
+  llvm::SmallVector<llvm::StringRef, 16> lines;
+  buffer.split(lines, '\n', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  for (llvm::StringRef line : lines) {
+    line = line.trim();
+    if (line.empty() || line.startswith("#")) continue;
+
+    llvm::StringRef invocations_str, total_ns_str, kernel_name, location, rest;
+    std::tie(invocations_str, rest) = line.split(' ');
+    std::tie(total_ns_str, rest) = rest.split(' ');
+    std::tie(kernel_name, location) = rest.split(' ');
+    int64_t invocations, total_ns;
+    if (invocations_str.getAsInteger(10, invocations) ||
+        total_ns_str.getAsInteger(10, total_ns) || kernel_name.empty() ||
+        location.empty()) {
+      return module.emitError("invalid kernel cost profile line: ") << line;
+    }
+
+    ProfileRecord& record = (*records)[GetProfileKey(kernel_name, location)];
+    record.invocations += invocations;
+    record.total_ns += total_ns;
+  }
+  return mlir::success();
+}
+
+class ApplyCostProfilePass
+    : public mlir::PassWrapper<ApplyCostProfilePass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+ public:
+  ApplyCostProfilePass() = default;
+  ApplyCostProfilePass(llvm::StringRef profile_filename,
+                       int64_t ns_per_cost_unit) {
+    profile_filename_ = profile_filename.str();
+    ns_per_cost_unit_ = ns_per_cost_unit;
+  }
+  ApplyCostProfilePass(const ApplyCostProfilePass&) {}
+
+  void runOnOperation() override {
+    mlir::ModuleOp module = getOperation();
+    if (ns_per_cost_unit_ < 1) {
+      module.emitError("ns-per-cost-unit must be positive");
+      return signalPassFailure();
+    }
+
+    auto buffer = llvm::MemoryBuffer::getFile(profile_filename_);
+    if (!buffer) {
+      module.emitError("failed to read kernel cost profile '")
+          << profile_filename_ << "': " << buffer.getError().message();
+      return signalPassFailure();
+    }
+
+    llvm::StringMap<ProfileRecord> records;
+    if (mlir::failed(
+            ParseCostProfile((*buffer)->getBuffer(), &records, module)))
+      return signalPassFailure();
+
+    mlir::Builder builder(module.getContext());
+    module.walk([&](mlir::Operation* op) {
+      std::string key = GetProfileKey(op);
+      if (key.empty()) return;
+      auto it = records.find(key);
+      if (it == records.end() || it->second.invocations <= 0) return;
+
+      // Costs are positive, so kernels faster than one unit cost 1.
+      double average_ns = static_cast<double>(it->second.total_ns) /
+                          it->second.invocations;
+      int64_t cost =
+          std::max<int64_t>(1, std::llround(average_ns / ns_per_cost_unit_));
+      op->setAttr("_tfrt_cost", builder.getI64IntegerAttr(cost));
+    });
+  }
+
+ private:
+  Option<std::string> profile_filename_{
+      *this, "profile",
+      llvm::cl::desc("Kernel cost profile written by bef_executor")};
+  Option<int64_t> ns_per_cost_unit_{
+      *this, "ns-per-cost-unit",
+      llvm::cl::desc("Nanoseconds of execution time per cost unit"),
+      llvm::cl::init(1000)};
+};
+
+static mlir::PassRegistration<ApplyCostProfilePass> apply_cost_profile(
+    "tfrt-apply-cost-profile",
+    "Set operation costs from a kernel cost profile");
+
+}  // namespace
+
+std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>> CreateApplyCostProfilePass(
+    llvm::StringRef profile_filename, int64_t ns_per_cost_unit) {
+  return std::make_unique<ApplyCostProfilePass>(profile_filename,
+                                                ns_per_cost_unit);
+}
+
+}  // namespace compiler
+}  // namespace tfrt
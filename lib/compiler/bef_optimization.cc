@@ -0,0 +1,44 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This implements the optimization pipeline for modules in TFRT dialects
+// before BEF emission.
+
+#include "tfrt/compiler/bef_optimization.h"
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/PassRegistry.h"
+#include "mlir/Transforms/Passes.h"
+
+namespace tfrt {
+namespace compiler {
+
+void CreateBEFOptimizationPipeline(mlir::OpPassManager& pm) {
+  pm.addPass(mlir::createInlinerPass());
+  pm.addPass(mlir::createSymbolDCEPass());
+  pm.addNestedPass<mlir::FuncOp>(mlir::createCanonicalizerPass());
+  pm.addNestedPass<mlir::FuncOp>(mlir::createCSEPass());
+  // CSE can make inputs of tfrt.merge.chains equal.
+  pm.addNestedPass<mlir::FuncOp>(mlir::createCanonicalizerPass());
+}
+
+static mlir::PassPipelineRegistration<> bef_optimization(
+    "tfrt-optimize-bef",
+    "Inline, fold and remove dead kernels before BEF emission",
+    CreateBEFOptimizationPipeline);
+
+}  // namespace compiler
+}  // namespace tfrt
@@ -0,0 +1,402 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This implements the pass that clusters CoreRuntime elementwise op chains
+// into CPURT kernels.
+
+#include "tfrt/compiler/cpurt_cwise_clustering.h"
+
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Linalg/IR/LinalgOps.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/AffineMap.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/SymbolTable.h"
+#include "tfrt/core_runtime/opdefs/core_runtime.h"
+#include "tfrt/core_runtime/opdefs/types.h"
+#include "tfrt/cpu/jit/opdefs/cpurt_ops.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+enum class CwiseOp { kAdd, kMul, kRelu, kBiasAdd };
+
+// Returns the elementwise op computed by `op` if it can be clustered.
+llvm::Optional<CwiseOp> GetCwiseOp(corert::ExecuteOp op) {
+  if (op.getNumResults() != 1) return llvm::None;
+
+  // Compiled kernels are executed on the host.
+  auto handler = op.op_handler().getDefiningOp<corert::GetOpHandler>();
+  if (!handler || handler.op_handler_name() != "cpu") return llvm::None;
+
+  llvm::StringRef name = op.op_name();
+  size_t num_operands = op.operands().size();
+
+  if (name == "tf.AddV2" && num_operands == 2) return CwiseOp::kAdd;
+  if (name == "tf.Mul" && num_operands == 2) return CwiseOp::kMul;
+  if (name == "tf.Relu" && num_operands == 1) return CwiseOp::kRelu;
+
+  if (name == "tf.BiasAdd" && num_operands == 2) {
+    llvm::SmallVector<std::pair<llvm::StringRef, mlir::Attribute>, 4> attrs;
+    op.getOpAttrs(&attrs);
+    for (auto& attr : attrs) {
+      if (attr.first != "data_format") continue;
+      auto format = attr.second.dyn_cast<mlir::StringAttr>();
+      if (!format || format.getValue() != "NHWC") return llvm::None;
+    }
+    return CwiseOp::kBiasAdd;
+  }
+
+  return llvm::None;
+}
+
+// Operations of a cluster in the block order.
+struct Cluster {
+  llvm::SmallVector<corert::ExecuteOp, 8> ops;
+  llvm::SmallVector<CwiseOp, 8> kinds;
+  llvm::SmallPtrSet<mlir::Operation*, 8> members;
+};
+
+// Returns true if `op` can be added to the `cluster`. The cluster is replaced
+// by the operation at the position of its last op, so results of the cluster
+// ops can't have users outside of the cluster before the added op.
+bool CanJoin(const Cluster& cluster, corert::ExecuteOp op, CwiseOp kind,
+             mlir::Block& block) {
+  // Bias vector is not computed in the iteration space of the cluster.
+  if (kind == CwiseOp::kBiasAdd) {
+    mlir::Operation* bias = op.operands()[1].getDefiningOp();
+    if (bias && cluster.members.count(bias)) return false;
+  }
+
+  for (corert::ExecuteOp member : cluster.ops) {
+    for (mlir::Operation* user : member->getUsers()) {
+      if (user == op.getOperation() || cluster.members.count(user)) continue;
+      mlir::Operation* ancestor = block.findAncestorOpInBlock(*user);
+      if (!ancestor || ancestor->isBeforeInBlock(op)) return false;
+    }
+  }
+
+  return true;
+}
+
+// Greedily adds clusterable ops of the `block` to the cluster of one of their
+// operands producers.
+std::vector<Cluster> FormClusters(mlir::Block& block) {
+  std::vector<Cluster> clusters;
+  llvm::DenseMap<mlir::Operation*, size_t> cluster_of;
+
+  for (mlir::Operation& operation : block) {
+    auto op = llvm::dyn_cast<corert::ExecuteOp>(&operation);
+    if (!op) continue;
+
+    llvm::Optional<CwiseOp> kind = GetCwiseOp(op);
+    if (!kind) continue;
+
+    llvm::Optional<size_t> joined;
+    for (mlir::Value operand : op.operands()) {
+      auto it = cluster_of.find(operand.getDefiningOp());
+      if (it == cluster_of.end()) continue;
+      if (CanJoin(clusters[it->second], op, *kind, block)) {
+        joined = it->second;
+        break;
+      }
+    }
+
+    if (!joined) {
+      joined = clusters.size();
+      clusters.emplace_back();
+    }
+
+    Cluster& cluster = clusters[*joined];
+    cluster.ops.push_back(op);
+    cluster.kinds.push_back(*kind);
+    cluster.members.insert(op);
+    cluster_of[op] = *joined;
+  }
+
+  return clusters;
+}
+
+// Kernel operand: a tensor in the cluster iteration space, or a bias vector
+// indexed by the innermost dimension.
+struct KernelInput {
+  mlir::Value value;
+  bool bias;
+};
+
+// Builds the body of the fused `linalg.generic` operation.
+void BuildFusedBody(const Cluster& cluster,
+                    llvm::ArrayRef<KernelInput> inputs,
+                    llvm::ArrayRef<mlir::Value> results, mlir::OpBuilder& b,
+                    mlir::Location loc, mlir::ValueRange args) {
+  // Scalar values of the cluster tensors at the current iteration.
+  llvm::DenseMap<mlir::Value, mlir::Value> scalars;
+  for (size_t i = 0; i < inputs.size(); ++i)
+    if (!inputs[i].bias) scalars[inputs[i].value] = args[i];
+
+  auto bias_scalar = [&](mlir::Value value) -> mlir::Value {
+    for (size_t i = 0; i < inputs.size(); ++i)
+      if (inputs[i].bias && inputs[i].value == value) return args[i];
+    llvm_unreachable("bias is not a kernel input");
+  };
+
+  mlir::Value zero = b.create<mlir::ConstantOp>(loc, b.getF32FloatAttr(0.0f));
+
+  for (size_t i = 0; i < cluster.ops.size(); ++i) {
+    corert::ExecuteOp op = cluster.ops[i];
+    mlir::Value lhs = scalars.lookup(op.operands()[0]);
+    mlir::Value result;
+
+    switch (cluster.kinds[i]) {
+      case CwiseOp::kAdd:
+        result =
+            b.create<mlir::AddFOp>(loc, lhs, scalars.lookup(op.operands()[1]));
+        break;
+      case CwiseOp::kMul:
+        result =
+            b.create<mlir::MulFOp>(loc, lhs, scalars.lookup(op.operands()[1]));
+        break;
+      case CwiseOp::kBiasAdd:
+        result = b.create<mlir::AddFOp>(loc, lhs,
+                                        bias_scalar(op.operands()[1]));
+        break;
+      case CwiseOp::kRelu: {
+        mlir::Value positive = b.create<mlir::CmpFOp>(
+            loc, mlir::CmpFPredicate::OGT, lhs, zero);
+        result = b.create<mlir::SelectOp>(loc, positive, lhs, zero);
+        break;
+      }
+    }
+
+    scalars[op->getResult(0)] = result;
+  }
+
+  llvm::SmallVector<mlir::Value, 4> yielded;
+  for (mlir::Value result : results) yielded.push_back(scalars.lookup(result));
+  b.create<mlir::linalg::YieldOp>(loc, yielded);
+}
+
+// Builds a compiled module with the kernel that computes the `cluster`.
+mlir::ModuleOp BuildKernel(const Cluster& cluster,
+                           llvm::ArrayRef<KernelInput> inputs,
+                           llvm::ArrayRef<mlir::Value> results, int rank,
+                           mlir::Location loc) {
+  mlir::OpBuilder b(loc.getContext());
+
+  llvm::SmallVector<int64_t, 4> dynamic_dims(rank);
+  for (int d = 0; d < rank; ++d)
+    dynamic_dims[d] = mlir::ShapedType::kDynamicSize;
+  auto tensor_type = mlir::MemRefType::get(dynamic_dims, b.getF32Type());
+  auto bias_type = mlir::MemRefType::get(dynamic_dims.back(), b.getF32Type());
+
+  llvm::SmallVector<mlir::Type, 4> arg_types;
+  for (const KernelInput& input : inputs)
+    arg_types.push_back(input.bias ? bias_type : tensor_type);
+  llvm::SmallVector<mlir::Type, 4> result_types(results.size(), tensor_type);
+
+  auto kernel = mlir::ModuleOp::create(loc, llvm::StringRef("cpurt_cwise"));
+  kernel->setAttr("tfrt.compiled", b.getUnitAttr());
+
+  auto func = mlir::FuncOp::create(loc, "main",
+                                   b.getFunctionType(arg_types, result_types));
+  kernel.push_back(func);
+  mlir::Block* entry = func.addEntryBlock();
+  b.setInsertionPointToStart(entry);
+
+  // The iteration space is the shape of the first tensor operand.
+  auto* shape_input = llvm::find_if(
+      inputs, [](const KernelInput& input) { return !input.bias; });
+  assert(shape_input != inputs.end() && "cluster must have a tensor operand");
+  mlir::Value shape_arg = entry->getArgument(shape_input - inputs.begin());
+
+  llvm::SmallVector<mlir::Value, 4> dims;
+  for (int d = 0; d < rank; ++d)
+    dims.push_back(b.create<mlir::memref::DimOp>(loc, shape_arg, d));
+
+  // Abort if the operands are not compatible with the iteration space.
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    mlir::Value arg = entry->getArgument(i);
+    if (arg == shape_arg) continue;
+    for (int d = inputs[i].bias ? rank - 1 : 0; d < rank; ++d) {
+      mlir::Value dim =
+          b.create<mlir::memref::DimOp>(loc, arg, inputs[i].bias ? 0 : d);
+      mlir::Value eq =
+          b.create<mlir::CmpIOp>(loc, mlir::CmpIPredicate::eq, dim, dims[d]);
+      b.create<mlir::AssertOp>(loc, eq, "operands shapes do not match");
+    }
+  }
+
+  llvm::SmallVector<mlir::Value, 4> outputs;
+  for (size_t i = 0; i < results.size(); ++i)
+    outputs.push_back(b.create<mlir::memref::AllocOp>(loc, tensor_type, dims));
+
+  mlir::AffineMap identity_map = b.getMultiDimIdentityMap(rank);
+  mlir::AffineMap bias_map =
+      mlir::AffineMap::get(rank, 0, b.getAffineDimExpr(rank - 1));
+
+  llvm::SmallVector<mlir::AffineMap, 8> indexing_maps;
+  for (const KernelInput& input : inputs)
+    indexing_maps.push_back(input.bias ? bias_map : identity_map);
+  for (size_t i = 0; i < outputs.size(); ++i)
+    indexing_maps.push_back(identity_map);
+
+  llvm::SmallVector<llvm::StringRef, 4> iterator_types(
+      rank, mlir::getParallelIteratorTypeName());
+
+  b.create<mlir::linalg::GenericOp>(
+      loc, entry->getArguments(), outputs, indexing_maps, iterator_types,
+      [&](mlir::OpBuilder& nested, mlir::Location nested_loc,
+          mlir::ValueRange args) {
+        BuildFusedBody(cluster, inputs, results, nested, nested_loc, args);
+      });
+
+  b.create<mlir::ReturnOp>(loc, outputs);
+
+  return kernel;
+}
+
+// Replaces the `cluster` with the compiled kernel execution.
+void MaterializeCluster(const Cluster& cluster, int rank,
+                        mlir::SymbolTable& symbol_table) {
+  // Values defined outside of the cluster become kernel operands.
+  llvm::SmallVector<KernelInput, 4> inputs;
+  for (size_t i = 0; i < cluster.ops.size(); ++i) {
+    corert::ExecuteOp op = cluster.ops[i];
+    for (auto operand : llvm::enumerate(op.operands())) {
+      mlir::Operation* producer = operand.value().getDefiningOp();
+      if (producer && cluster.members.count(producer)) continue;
+
+      bool bias = cluster.kinds[i] == CwiseOp::kBiasAdd && operand.index() == 1;
+      KernelInput input{operand.value(), bias};
+      bool seen = llvm::any_of(inputs, [&](const KernelInput& other) {
+        return other.value == input.value && other.bias == input.bias;
+      });
+      if (!seen) inputs.push_back(input);
+    }
+  }
+
+  // Values used outside of the cluster become kernel results.
+  auto is_external = [&](mlir::OpOperand& use) {
+    return !cluster.members.count(use.getOwner());
+  };
+
+  llvm::SmallVector<mlir::Value, 4> results;
+  for (corert::ExecuteOp op : cluster.ops) {
+    mlir::Value result = op->getResult(0);
+    if (llvm::any_of(result.getUses(), is_external)) results.push_back(result);
+  }
+
+  // Dead clusters are left to the canonicalizer.
+  if (results.empty()) return;
+
+  corert::ExecuteOp last = cluster.ops.back();
+  mlir::Location loc = last.getLoc();
+  mlir::ModuleOp kernel = BuildKernel(cluster, inputs, results, rank, loc);
+  symbol_table.insert(kernel);  // uniquifies the kernel module name
+
+  mlir::MLIRContext* ctx = loc.getContext();
+  mlir::OpBuilder b(last);
+
+  auto kernel_ref = mlir::SymbolRefAttr::get(
+      ctx, *kernel.getName(), {mlir::FlatSymbolRefAttr::get(ctx, "main")});
+  auto executable_type =
+      mlir::OpaqueType::get(b.getIdentifier("cpurt"), "jit_executable");
+  auto compile = b.create<cpu::jit::CoreRtCompileOp>(loc, executable_type,
+                                                      kernel_ref);
+
+  llvm::SmallVector<mlir::Value, 4> operands;
+  for (const KernelInput& input : inputs) operands.push_back(input.value);
+  llvm::SmallVector<mlir::Type, 4> result_types(
+      results.size(), corert::TensorHandleType::get(ctx));
+  auto execute = b.create<cpu::jit::CoreRtExecuteOp>(loc, result_types,
+                                                      compile, operands);
+
+  for (size_t i = 0; i < results.size(); ++i)
+    results[i].replaceUsesWithIf(execute->getResult(i), is_external);
+
+  for (corert::ExecuteOp op : llvm::reverse(cluster.ops)) op.erase();
+}
+
+class CpurtCwiseClusteringPass
+    : public mlir::PassWrapper<CpurtCwiseClusteringPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+ public:
+  CpurtCwiseClusteringPass() = default;
+  CpurtCwiseClusteringPass(int rank, int min_cluster_size) {
+    rank_ = rank;
+    min_cluster_size_ = min_cluster_size;
+  }
+  CpurtCwiseClusteringPass(const CpurtCwiseClusteringPass&) {}
+
+  void getDependentDialects(mlir::DialectRegistry& registry) const override {
+    registry.insert<cpu::jit::CpuRuntimeDialect, mlir::StandardOpsDialect,
+                    mlir::linalg::LinalgDialect, mlir::memref::MemRefDialect>();
+  }
+
+  void runOnOperation() override {
+    mlir::ModuleOp module = getOperation();
+    if (rank_ < 1) {
+      module.emitError("clustered tensors rank must be positive");
+      return signalPassFailure();
+    }
+
+    mlir::SymbolTable symbol_table(module);
+
+    // Kernel modules are added to the module body while clustering.
+    auto funcs = llvm::to_vector<4>(module.getOps<mlir::FuncOp>());
+    for (mlir::FuncOp func : funcs) {
+      for (mlir::Block& block : func.getBody()) {
+        for (const Cluster& cluster : FormClusters(block)) {
+          if (static_cast<int>(cluster.ops.size()) < min_cluster_size_)
+            continue;
+          MaterializeCluster(cluster, rank_, symbol_table);
+        }
+      }
+    }
+  }
+
+ private:
+  Option<int> rank_{*this, "rank",
+                    llvm::cl::desc("Rank of the clustered tensors"),
+                    llvm::cl::init(2)};
+  Option<int> min_cluster_size_{
+      *this, "min-cluster-size",
+      llvm::cl::desc("Minimum number of ops in the compiled clusters"),
+      llvm::cl::init(2)};
+};
+
+static mlir::PassRegistration<CpurtCwiseClusteringPass> cpurt_cwise_clustering(
+    "tfrt-cpurt-cwise-clustering",
+    "Cluster CoreRuntime elementwise ops into CPURT kernels");
+
+}  // namespace
+
+std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>>
+CreateCpurtCwiseClusteringPass(int rank, int min_cluster_size) {
+  return std::make_unique<CpurtCwiseClusteringPass>(rank, min_cluster_size);
+}
+
+}  // namespace compiler
+}  // namespace tfrt
@@ -37,7 +37,9 @@ class PrintStreamPass
 
       mlir::emitRemark(loc, "stream id: ")
           << stream.id() << ", stream cost: " << stream.cost()
-          << ", parent stream: " << stream.parent_id();
+          << ", parent stream: " << stream.parent_id()
+          << ", critical path cost: "
+          << stream_analysis.GetCriticalPathCost(op);
     };
 
     emit_stream(nullptr, func_op.getLoc());
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This implements the pass that marks cheap branches without side effects for
+// speculative execution.
+
+#include "tfrt/compiler/speculate_branches.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "tfrt/basic_kernels/opdefs/basic_kernels.h"
+#include "tfrt/compiler/stream_analysis.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+// Returns true if `func` has no side effects and its total cost does not exceed
+// the cost threshold.
+bool IsCheapAndPure(mlir::FuncOp func) {
+  StreamAnalysis stream_analysis(func);
+
+  int64_t cost = 0;
+  for (mlir::Operation& op : func.front()) {
+    if (op.hasTrait<mlir::OpTrait::IsTerminator>()) continue;
+    if (op.getNumRegions() != 0 ||
+        !mlir::MemoryEffectOpInterface::hasNoEffect(&op))
+      return false;
+    cost += stream_analysis.GetOperationCost(&op);
+  }
+
+  return cost <= stream_analysis.GetCostThreshold();
+}
+
+class SpeculateBranchesPass
+    : public mlir::PassWrapper<SpeculateBranchesPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+ public:
+  void runOnOperation() override {
+    mlir::ModuleOp module = getOperation();
+    mlir::SymbolTable symbol_table(module);
+
+    // Branch functions are usually shared by several operations, so each one is
+    // only analyzed once.
+    llvm::DenseMap<mlir::Operation*, bool> is_cheap_and_pure;
+    auto can_speculate = [&](mlir::Attribute branch) {
+      auto symbol = branch.dyn_cast<mlir::FlatSymbolRefAttr>();
+      if (!symbol) return false;
+      auto func = symbol_table.lookup<mlir::FuncOp>(symbol.getValue());
+      if (!func || func.isExternal()) return false;
+      auto it = is_cheap_and_pure.find(func.getOperation());
+      if (it == is_cheap_and_pure.end()) {
+        it = is_cheap_and_pure
+                 .try_emplace(func.getOperation(), IsCheapAndPure(func))
+                 .first;
+      }
+      return it->second;
+    };
+
+    mlir::Builder builder(module.getContext());
+    module.walk([&](mlir::Operation* op) {
+      llvm::SmallVector<mlir::Attribute, 4> branches;
+      if (auto cond = llvm::dyn_cast<tfrt::CondOp>(op)) {
+        branches = {cond.a_true_fnAttr(), cond.b_false_fnAttr()};
+      } else if (auto case_op = llvm::dyn_cast<tfrt::CaseOp>(op)) {
+        branches.append(case_op.branches().begin(), case_op.branches().end());
+      } else {
+        return;
+      }
+
+      if (llvm::all_of(branches, can_speculate))
+        op->setAttr("speculative", builder.getBoolAttr(true));
+    });
+  }
+};
+
+static mlir::PassRegistration<SpeculateBranchesPass> speculate_branches(
+    "tfrt-speculate-branches",
+    "Mark cheap tfrt.cond and tfrt.case branches for speculative execution");
+
+}  // namespace
+
+std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>>
+CreateSpeculateBranchesPass() {
+  return std::make_unique<SpeculateBranchesPass>();
+}
+
+}  // namespace compiler
+}  // namespace tfrt
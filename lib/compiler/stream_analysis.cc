@@ -87,6 +87,12 @@ int64_t StreamAnalysis::GetOperationCost(mlir::Operation* op) const {
     return cost;
   }
 
+  // Other operations can have a cost from a profile, which is set by the
+  // tfrt-apply-cost-profile pass.
+  if (auto cost_attr = op->getAttrOfType<mlir::IntegerAttr>("_tfrt_cost")) {
+    if (cost_attr.getInt() > 0) return cost_attr.getInt();
+  }
+
   // If there is no cost specified for this operation, We conservatively return
   // the cost threshold as its cost. So we treat operations without cost as
   // expensive ops, but not too expensive to outweigh any other operations.
@@ -339,11 +345,40 @@ void StreamAnalysis::FinalizeStreams(mlir::Block& block) {
   }
 }
 
+// ComputeCriticalPathBackwardPass traverses the graph in reversed topological
+// order, so that the critical path costs of all users of an op are known when
+// the op is visited.
+void StreamAnalysis::ComputeCriticalPathBackwardPass(mlir::Block& block) {
+  int64_t max_critical_path_cost = 0;
+  for (auto& op : llvm::reverse(block)) {
+    int64_t max_user_cost = 0;
+    for (auto* user : op.getUsers()) {
+      // Users nested in regions of other ops are accounted for by the op in
+      // this block that contains them.
+      auto* user_in_block = block.findAncestorOpInBlock(*user);
+      if (user_in_block == nullptr || user_in_block == &op) continue;
+      assert(critical_path_cost_map_.count(user_in_block) > 0);
+      max_user_cost =
+          std::max(max_user_cost, critical_path_cost_map_[user_in_block]);
+    }
+
+    int64_t critical_path_cost = build_info_.op_map[&op].cost + max_user_cost;
+    critical_path_cost_map_[&op] = critical_path_cost;
+    max_critical_path_cost =
+        std::max(max_critical_path_cost, critical_path_cost);
+  }
+
+  // All ops are triggered by the root, directly or indirectly.
+  critical_path_cost_map_[kRootOperation] =
+      build_info_.op_map[kRootOperation].cost + max_critical_path_cost;
+}
+
 void StreamAnalysis::AnalyzeBlock(mlir::Block& block) {
   GetOptionsForBlock(block);
   ScheduleOpForwardPass(block);
   BuildStreamBackwardPass(block);
   FinalizeStreams(block);
+  ComputeCriticalPathBackwardPass(block);
 }
 
 const Stream& StreamAnalysis::GetRootStream() const {
@@ -0,0 +1,366 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements BatchedOp.
+
+#include "tfrt/core_runtime/batched_op.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/timer_queue.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+
+// The state of a BatchedOp, which is shared with its timers and the batches
+// in flight.
+class BatchedOp::Batcher : public ReferenceCounted<Batcher> {
+ public:
+  Batcher(CoreRuntimeOp op, OpAttrsRef attrs, int num_results,
+          BatchingOptions options)
+      : op_(std::move(op)),
+        attrs_(std::move(attrs)),
+        num_results_(num_results),
+        options_(std::move(options)) {
+    assert(std::is_sorted(options_.allowed_batch_sizes.begin(),
+                          options_.allowed_batch_sizes.end()));
+  }
+
+  void AddCall(const ExecutionContext& exec_ctx,
+               MutableArrayRef<TensorHandle> arguments,
+               MutableArrayRef<TensorHandle> results);
+
+  void Flush() { RunBatch(TakeBatch(/*batch_id=*/-1)); }
+
+ private:
+  // A call of the op, whose results are resolved when its batch has been
+  // executed.
+  struct Call {
+    ExecutionContext exec_ctx;
+    llvm::SmallVector<TensorHandle, 4> arguments;
+    llvm::SmallVector<AsyncValueRef<TensorMetadata>, 4> metadata;
+    llvm::SmallVector<AsyncValueRef<DenseHostTensor>, 4> tensors;
+    ssize_t num_rows = 0;
+
+    void SetError(const DecodedDiagnostic& diag) {
+      for (auto& md : metadata) md.SetError(diag);
+      for (auto& tensor : tensors) tensor.SetError(diag);
+    }
+  };
+  // SmallVector moves its elements when it grows, std::vector would copy them.
+  using Batch = llvm::SmallVector<Call, 0>;
+
+  // Takes the current batch if its id is `batch_id`, or any batch if
+  // `batch_id` is negative.
+  Batch TakeBatch(int64_t batch_id) {
+    mutex_lock lock(mu_);
+    return TakeBatchLocked(batch_id);
+  }
+  Batch TakeBatchLocked(int64_t batch_id)
+      TFRT_REQUIRES(mu_);
+
+  // Checks the arguments of `call`, which are available, and sets its
+  // `num_rows`. Returns the error to fail the call with, if any.
+  Optional<DecodedDiagnostic> CheckCall(Call& call);
+
+  // Executes the op for `calls` once their arguments are available.
+  void RunBatch(Batch calls);
+  void ExecuteBatch(Batch calls);
+
+  // Splits `results`, the results of the op for `calls`, into the results of
+  // each call.
+  void SplitResults(MutableArrayRef<Call> calls,
+                    MutableArrayRef<TensorHandle> results);
+
+  const CoreRuntimeOp op_;
+  const OpAttrsRef attrs_;
+  const int num_results_;
+  const BatchingOptions options_;
+
+  mutex mu_;
+  Batch calls_ TFRT_GUARDED_BY(mu_);
+  // Rows of `calls_`. Calls whose arguments do not have their metadata yet
+  // count as one row.
+  int num_rows_ TFRT_GUARDED_BY(mu_) = 0;
+  // Identifies the current batch for its timer.
+  int64_t batch_id_ TFRT_GUARDED_BY(mu_) = 0;
+  TimerQueue::TimerHandle timer_ TFRT_GUARDED_BY(mu_);
+  TimerQueue* timer_queue_ TFRT_GUARDED_BY(mu_) = nullptr;
+};
+
+void BatchedOp::Batcher::AddCall(const ExecutionContext& exec_ctx,
+                                 MutableArrayRef<TensorHandle> arguments,
+                                 MutableArrayRef<TensorHandle> results) {
+  assert(results.size() == num_results_);
+  HostContext* host = exec_ctx.host();
+  RCReference<Device> device = host->GetHostDeviceRef();
+
+  Call call{exec_ctx, {}, {}, {}};
+  for (auto& argument : arguments) call.arguments.push_back(std::move(argument));
+  for (auto& result : results) {
+    call.metadata.push_back(
+        MakeUnconstructedAsyncValueRef<TensorMetadata>(host));
+    call.tensors.push_back(
+        MakeUnconstructedAsyncValueRef<DenseHostTensor>(host));
+    result = TensorHandle(device.CopyRef(), call.metadata.back().CopyRef(),
+                          call.tensors.back().CopyRef());
+  }
+  int num_rows = 1;
+  if (!call.arguments.empty() && call.arguments[0].IsMetadataAvailable()) {
+    const TensorShape& shape = call.arguments[0].GetAvailableMetadata().shape;
+    if (shape.GetRank() > 0) num_rows = shape.GetDimensionSize(0);
+  }
+
+  Batch full_batch;
+  {
+    mutex_lock lock(mu_);
+    calls_.push_back(std::move(call));
+    num_rows_ += num_rows;
+    if (num_rows_ >= options_.max_batch_size) {
+      full_batch = TakeBatchLocked(batch_id_);
+    } else if (calls_.size() == 1) {
+      // The timer runs on the timer thread, so it only enqueues the batch.
+      timer_queue_ = host->GetTimerQueue();
+      timer_ = timer_queue_->ScheduleTimer(
+          options_.batch_timeout,
+          [batcher = FormRef(this), batch_id = batch_id_, exec_ctx]() {
+            EnqueueWork(exec_ctx, [batcher = batcher.CopyRef(), batch_id] {
+              batcher->RunBatch(batcher->TakeBatch(batch_id));
+            });
+          });
+    }
+  }
+  if (!full_batch.empty()) RunBatch(std::move(full_batch));
+}
+
+BatchedOp::Batcher::Batch BatchedOp::Batcher::TakeBatchLocked(
+    int64_t batch_id) {
+  if (batch_id >= 0 && batch_id != batch_id_) return {};
+  Batch calls = std::move(calls_);
+  calls_.clear();
+  num_rows_ = 0;
+  ++batch_id_;
+  if (timer_) {
+    timer_queue_->CancelTimer(timer_);
+    timer_.reset();
+  }
+  return calls;
+}
+
+void BatchedOp::Batcher::RunBatch(Batch calls) {
+  if (calls.empty()) return;
+  llvm::SmallVector<AsyncValue*, 8> arguments;
+  for (auto& call : calls) {
+    for (auto& argument : call.arguments)
+      arguments.push_back(argument.GetAsyncTensor());
+  }
+  RunWhenReady(arguments, [batcher = FormRef(this),
+                           calls = std::move(calls)]() mutable {
+    batcher->ExecuteBatch(std::move(calls));
+  });
+}
+
+Optional<DecodedDiagnostic> BatchedOp::Batcher::CheckCall(Call& call) {
+  if (call.arguments.empty()) return DecodedDiagnostic("batched op has no args");
+  for (auto& argument : call.arguments) {
+    AsyncValue* tensor = argument.GetAsyncTensor();
+    if (tensor->IsError()) return tensor->GetError();
+    if (!isa<DenseHostTensor>(tensor->get<Tensor>()))
+      return DecodedDiagnostic("batched args must be dense host tensors");
+    const TensorShape& shape = tensor->get<Tensor>().shape();
+    if (shape.GetRank() == 0)
+      return DecodedDiagnostic("batched args must have a batch dimension");
+    if (&argument == &call.arguments.front()) {
+      call.num_rows = shape.GetDimensionSize(0);
+    } else if (shape.GetDimensionSize(0) != call.num_rows) {
+      return DecodedDiagnostic("args of a call have different batch sizes");
+    }
+  }
+  return llvm::None;
+}
+
+// Returns true if the tensors have the same dtype and the same shape except
+// for the first dimension.
+static bool HaveSameRows(const Tensor& lhs, const Tensor& rhs) {
+  if (lhs.dtype() != rhs.dtype()) return false;
+  SmallVector<ssize_t, 4> lhs_dims, rhs_dims;
+  lhs.shape().GetDimensions(&lhs_dims);
+  rhs.shape().GetDimensions(&rhs_dims);
+  return std::equal(lhs_dims.begin() + 1, lhs_dims.end(), rhs_dims.begin() + 1,
+                    rhs_dims.end());
+}
+
+void BatchedOp::Batcher::ExecuteBatch(Batch calls) {
+  // Fail the calls with invalid arguments, and the calls whose arguments do
+  // not match the arguments of the first call.
+  auto matches = [](const Call& call, const Call& first) {
+    if (call.arguments.size() != first.arguments.size()) return false;
+    for (size_t i = 0; i < call.arguments.size(); ++i) {
+      if (!HaveSameRows(call.arguments[i].GetAsyncTensor()->get<Tensor>(),
+                        first.arguments[i].GetAsyncTensor()->get<Tensor>()))
+        return false;
+    }
+    return true;
+  };
+  Batch batch;
+  batch.reserve(calls.size());
+  for (auto& call : calls) {
+    if (auto diag = CheckCall(call)) {
+      call.SetError(*diag);
+    } else if (!batch.empty() && !matches(call, batch.front())) {
+      call.SetError(DecodedDiagnostic("args do not match the batch"));
+    } else {
+      batch.push_back(std::move(call));
+    }
+  }
+  calls = std::move(batch);
+  if (calls.empty()) return;
+
+  const ExecutionContext exec_ctx = calls.front().exec_ctx;
+  HostContext* host = exec_ctx.host();
+  const size_t num_arguments = calls.front().arguments.size();
+  auto fail = [&](const DecodedDiagnostic& diag) {
+    for (auto& call : calls) call.SetError(diag);
+  };
+
+  ssize_t num_rows = 0;
+  for (auto& call : calls) num_rows += call.num_rows;
+  ssize_t padded_rows = num_rows;
+  auto bucket = std::lower_bound(options_.allowed_batch_sizes.begin(),
+                                 options_.allowed_batch_sizes.end(), num_rows);
+  if (bucket != options_.allowed_batch_sizes.end()) padded_rows = *bucket;
+
+  // Concatenate the arguments along the batch dimension, unless the batch has
+  // a single call that needs no padding.
+  llvm::SmallVector<TensorHandle, 4> batch_arguments;
+  if (calls.size() == 1 && padded_rows == num_rows) {
+    for (auto& argument : calls.front().arguments)
+      batch_arguments.push_back(std::move(argument));
+  } else {
+    RCReference<Device> device = host->GetHostDeviceRef();
+    SmallVector<ssize_t, 4> dims;
+    for (size_t i = 0; i < num_arguments; ++i) {
+      const auto& first_tensor =
+          calls.front().arguments[i].GetAsyncTensor()->get<DenseHostTensor>();
+      first_tensor.shape().GetDimensions(&dims);
+      dims[0] = padded_rows;
+      TensorMetadata md(first_tensor.dtype(), dims);
+      auto dht = DenseHostTensor::CreateUninitialized(md, exec_ctx);
+      if (!dht) return fail(DecodedDiagnostic("out of memory batching args"));
+      auto* begin = static_cast<char*>(dht->data());
+      auto* data = begin;
+      for (auto& call : calls) {
+        const auto& tensor =
+            call.arguments[i].GetAsyncTensor()->get<DenseHostTensor>();
+        std::memcpy(data, tensor.data(), tensor.DataSizeInBytes());
+        data += tensor.DataSizeInBytes();
+      }
+      std::memset(data, 0, begin + dht->DataSizeInBytes() - data);
+      batch_arguments.push_back(TensorHandle(
+          device.CopyRef(), md,
+          MakeAvailableAsyncValueRef<DenseHostTensor>(host, std::move(*dht))));
+    }
+  }
+  // Release the arguments of the calls.
+  for (auto& call : calls) call.arguments.clear();
+
+  llvm::SmallVector<TensorHandle, 4> batch_results;
+  batch_results.resize(num_results_);
+  op_(exec_ctx, batch_arguments, attrs_, batch_results, /*chain=*/nullptr);
+
+  llvm::SmallVector<AsyncValue*, 4> results;
+  for (auto& result : batch_results) results.push_back(result.GetAsyncTensor());
+  RunWhenReady(results, [batcher = FormRef(this), calls = std::move(calls),
+                         batch_results =
+                             std::move(batch_results)]() mutable {
+    batcher->SplitResults(calls, batch_results);
+  });
+}
+
+void BatchedOp::Batcher::SplitResults(MutableArrayRef<Call> calls,
+                                      MutableArrayRef<TensorHandle> results) {
+  ssize_t num_rows = 0;
+  for (auto& call : calls) num_rows += call.num_rows;
+
+  SmallVector<ssize_t, 4> dims;
+  for (int i = 0; i < num_results_; ++i) {
+    AsyncValue* result = results[i].GetAsyncTensor();
+    auto set_error = [&](const DecodedDiagnostic& diag) {
+      for (auto& call : calls) {
+        call.metadata[i].SetError(diag);
+        call.tensors[i].SetError(diag);
+      }
+    };
+    if (result->IsError()) {
+      set_error(result->GetError());
+      continue;
+    }
+    if (!isa<DenseHostTensor>(result->get<Tensor>())) {
+      set_error(DecodedDiagnostic("batched results must be dense host tensors"));
+      continue;
+    }
+    const auto& dht = result->get<DenseHostTensor>();
+    dht.shape().GetDimensions(&dims);
+    if (dims.empty() || dims[0] < num_rows) {
+      set_error(DecodedDiagnostic("batched result has too few rows"));
+      continue;
+    }
+    // The results of the calls are slices of the batch result.
+    size_t row_size = dims[0] ? dht.DataSizeInBytes() / dims[0] : 0;
+    size_t offset = 0;
+    for (auto& call : calls) {
+      dims[0] = call.num_rows;
+      TensorMetadata md(dht.dtype(), dims);
+      size_t size = row_size * call.num_rows;
+      call.metadata[i].emplace(md);
+      call.tensors[i].emplace(
+          md, HostBuffer::CreateFromExternal(dht.buffer().CopyRef(), offset,
+                                             size));
+      offset += size;
+    }
+  }
+}
+
+BatchedOp::BatchedOp(CoreRuntimeOp op, OpAttrsRef attrs, int num_results,
+                     BatchingOptions options)
+    : batcher_(TakeRef(new Batcher(std::move(op), std::move(attrs),
+                                   num_results, std::move(options)))) {
+  assert(std::is_sorted(options.allowed_batch_sizes.begin(),
+                        options.allowed_batch_sizes.end()));
+}
+
+BatchedOp::~BatchedOp() { batcher_->Flush(); }
+
+void BatchedOp::operator()(const ExecutionContext& exec_ctx,
+                           MutableArrayRef<TensorHandle> arguments,
+                           MutableArrayRef<TensorHandle> results) {
+  batcher_->AddCall(exec_ctx, arguments, results);
+}
+
+void BatchedOp::Flush() { batcher_->Flush(); }
+
+}  // namespace tfrt
@@ -19,6 +19,7 @@
 #include <string>
 
 #include "tfrt/core_runtime/core_runtime_op.h"
+#include "tfrt/core_runtime/op_batch.h"
 #include "tfrt/core_runtime/op_handler.h"
 #include "tfrt/core_runtime/op_invocation.h"
 #include "tfrt/core_runtime/tensor_handle.h"
@@ -32,6 +33,7 @@
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/shared_context.h"
+#include "tfrt/host_context/startup_profile.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/mutex.h"
@@ -169,8 +171,12 @@ llvm::Expected<std::unique_ptr<CoreRuntime>> CoreRuntime::Create(
   // Register all of the kernels that are statically linked into this
   // executable with our registry.
   RegisterStaticKernels(runtime->GetHostContext()->GetMutableRegistry());
+  runtime->GetHostContext()->GetMutableRegistry()->Freeze();
 
-  RegisterTensorConversionFns(runtime->GetHostContext());
+  {
+    StartupPhase phase("register tensor conversion functions");
+    RegisterTensorConversionFns(runtime->GetHostContext());
+  }
   return std::move(runtime);
 }
 
@@ -218,6 +224,17 @@ void CoreRuntime::Execute(const ExecutionContext& exec_ctx, string_view op_name,
                  chain);
 }
 
+void CoreRuntime::ExecuteBatch(const ExecutionContext& exec_ctx,
+                               const OpBatch& batch,
+                               MutableArrayRef<TensorHandle> arguments,
+                               MutableArrayRef<TensorHandle> results,
+                               AsyncValueRef<Chain>* chain) {
+  TFRT_TRACE_SCOPE(Default, StrCat("ExecuteBatch#num_ops=", batch.num_ops(),
+                                   "#"));
+  TFRT_TRACE_FLOW(Default, exec_ctx.trace_id());
+  batch.Execute(exec_ctx, arguments, results, chain);
+}
+
 Expected<CoreRuntimeOp> CoreRuntime::MakeOp(string_view op_name,
                                             OpHandler* op_handler) {
 #ifdef TFRT_DISABLE_TRACING
@@ -234,6 +251,7 @@ Expected<CoreRuntimeOp> CoreRuntime::MakeOp(string_view op_name,
         TFRT_TRACE_SCOPE(
             Default,
             StrCat(op_name, "#op_handler=", op_handler->GetName(), "#"));
+        TFRT_TRACE_FLOW(Default, invocation.exec_ctx.trace_id());
         op(invocation);
       },
       is_fallback, std::move(device), op->GetTensorType());
@@ -367,41 +385,50 @@ Expected<CoreRuntimeOp> CoreRuntime::MakeCompositeOp(const Function* fn) {
 }
 
 Expected<CoreRuntimeOp> CoreRuntime::MakeNativeCompositeOp(const Function* fn) {
-  auto execute_fn = [fn = fn](const CompositeOpInvocation& invocation) {
+  // The first argument and the first result are chains for side-effects.
+  if (fn->argument_types().empty() || fn->result_types().empty()) {
+    return MakeStringError("Fn ", fn->name(),
+                           " must take and return a chain for side-effects.");
+  }
+  const size_t num_arguments = fn->argument_types().size();
+  const size_t num_results = fn->result_types().size();
+
+  auto execute_fn = [fn = fn, num_arguments,
+                     num_results](const CompositeOpInvocation& invocation) {
     auto* host = invocation.exec_ctx.host();
 
     // TODO(fishx): Return an error to the client instead of asserting.
-    if (invocation.arguments.size() + 1 != fn->argument_types().size()) {
-      TFRT_LOG(FATAL) << "Fn has " << fn->argument_types().size()
+    if (invocation.arguments.size() + 1 != num_arguments) {
+      TFRT_LOG(FATAL) << "Fn has " << num_arguments
                       << " arguments, while invocation provides "
                       << invocation.arguments.size() << " arguments.";
     }
-    if (invocation.results.size() + 1 != fn->result_types().size()) {
-      TFRT_LOG(FATAL) << "Fn has " << fn->result_types().size()
+    if (invocation.results.size() + 1 != num_results) {
+      TFRT_LOG(FATAL) << "Fn has " << num_results
                       << " results, while invocation provides "
                       << invocation.results.size() << " results.";
     }
 
+    // The invocation keeps its arguments alive for the duration of the call,
+    // and Function::Execute takes its own references to the arguments it needs
+    // later, so the arguments are passed without extra references.
     SmallVector<AsyncValue*, 4> arguments;
-    SmallVector<RCReference<AsyncValue>, 4> arguments_ref;
-    arguments.reserve(fn->argument_types().size());
-    arguments_ref.reserve(fn->argument_types().size());
+    arguments.reserve(num_arguments);
 
     // The first argument is a chain for side-effects.
+    AsyncValueRef<Chain> ready_chain;
     if (invocation.chain && *invocation.chain) {
       arguments.push_back(invocation.chain->GetAsyncValue());
     } else {
-      arguments_ref.push_back(GetReadyChain(host));
-      arguments.push_back(arguments_ref.back().get());
+      ready_chain = GetReadyChain(host);
+      arguments.push_back(ready_chain.GetAsyncValue());
     }
 
-    for (size_t i = 0, e = invocation.arguments.size(); i != e; ++i) {
-      arguments_ref.push_back(invocation.arguments[i].CopyRef());
-      arguments.push_back(arguments_ref.back().get());
-    }
+    for (const auto& argument : invocation.arguments)
+      arguments.push_back(argument.get());
 
     SmallVector<RCReference<AsyncValue>, 4> results;
-    results.resize(fn->result_types().size());
+    results.resize(num_results);
 
     fn->Execute(invocation.exec_ctx, arguments, results);
 
@@ -418,7 +445,7 @@ Expected<CoreRuntimeOp> CoreRuntime::MakeNativeCompositeOp(const Function* fn) {
       size_t i = iter.index();
       auto& result_av = iter.value();
 
-      invocation.results[i] = result_av.CopyRef();
+      invocation.results[i] = std::move(result_av);
     }
   };
   return CoreRuntimeOp(std::move(execute_fn));
@@ -17,6 +17,7 @@
 
 #include "tfrt/core_runtime/dispatch_utils.h"
 
+#include "tfrt/core_runtime/op_dispatch_cache.h"
 #include "tfrt/host_context/host_context.h"
 
 namespace tfrt {
@@ -69,9 +70,11 @@ MDFunctionExecResult ExecuteMetadataFunction(
 
   // TODO(tfrt-devs): Remove this tracing tag when finished debugging
   // dispatch performance.
-  TFRT_TRACE_SCOPE(Verbose, "RunMetadataFunction");
-  if (auto error = metadata_fn(invocation.exec_ctx, argument_mds,
-                               invocation.attrs, result_mds)) {
+  TFRT_TRACE_STATIC_SCOPE(Verbose, "RunMetadataFunction");
+  auto& metadata_fn_cache = MetadataFnCache::Get(invocation.exec_ctx.host());
+  if (auto error = metadata_fn_cache.Run(metadata_fn, invocation.exec_ctx,
+                                         argument_mds, invocation.attrs,
+                                         result_mds)) {
     // If the metadata function produced an error, propagate it.
     propagate_error(std::move(error));
     return MDFunctionExecResult::kError;
@@ -176,8 +179,9 @@ void ExecuteWhenMetadataIsReady(const OpInvocation& invocation,
     // Okay, the shapes are available as we expect, run the metadata
     // function to get the result shapes.
     SmallVector<TensorMetadata, 4> result_mds(num_results);
-    if (auto error =
-            metadata_fn(exec_ctx, argument_mds, frozen_attrs, result_mds)) {
+    auto& metadata_fn_cache = MetadataFnCache::Get(exec_ctx.host());
+    if (auto error = metadata_fn_cache.Run(metadata_fn, exec_ctx, argument_mds,
+                                           frozen_attrs, result_mds)) {
       // If the metadata function produced an error, propagate it.
       return propagate_error(error.get());
     }
@@ -203,6 +207,15 @@ void ExecuteWhenMetadataIsReady(const OpInvocation& invocation,
   });
 }
 
+void UnwrapDonatableArguments(
+    MutableArrayRef<RCReference<AsyncValue>> arguments) {
+  for (auto& argument : arguments) {
+    auto* indirect = dyn_cast<IndirectAsyncValue>(argument.get());
+    if (!indirect || indirect->NumRef() != 1) continue;
+    if (auto* value = indirect->GetForwardedValue()) argument = FormRef(value);
+  }
+}
+
 std::string GetOpDebugString(string_view op_name,
                              ArrayRef<RCReference<AsyncValue>>& inputs,
                              const OpAttrsRef& attrs,
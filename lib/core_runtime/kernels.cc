@@ -178,8 +178,9 @@ static llvm::Expected<TensorHandle> ConstStringTensor(
                       std::move(tensor_ref));
 }
 
+// The tensor references the elements of `value` in the BEF file in place.
 static llvm::Expected<TensorHandle> ConstDenseTensor(
-    DenseAttr value, const ExecutionContext &context) {
+    DenseAttribute value, const ExecutionContext &context) {
   auto *host = context.host();
   auto dht = DeserializeDenseHostTensorFromDenseAttr(value, host);
   if (!dht) return dht.takeError();
@@ -0,0 +1,407 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the LazyOpHandler class and the hook to create it.
+
+#include "tfrt/core_runtime/lazy_op_handler.h"
+
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/bef_converter/bef_attr_encoder.h"
+#include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_handler.h"
+#include "tfrt/core_runtime/op_invocation.h"
+#include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+namespace {
+
+// The ops the LazyOpHandler defers, in the order they are fused.
+enum class LazyOpKind { kOther, kMatMul, kConv2D, kBiasAdd, kRelu };
+
+LazyOpKind GetLazyOpKind(string_view op_name) {
+  if (op_name == "tf.MatMul") return LazyOpKind::kMatMul;
+  if (op_name == "tf.Conv2D") return LazyOpKind::kConv2D;
+  if (op_name == "tf.BiasAdd") return LazyOpKind::kBiasAdd;
+  if (op_name == "tf.Relu") return LazyOpKind::kRelu;
+  return LazyOpKind::kOther;
+}
+
+// The result TensorHandle of a deferred op, which is fulfilled when the op is
+// executed.
+struct DeferredResult {
+  AsyncValueRef<RCReference<Device>> device;
+  AsyncValueRef<TensorMetadata> metadata;
+  RCReference<IndirectAsyncValue> tensor;
+};
+
+struct DeferredOp {
+  DeferredOp(LazyOpKind kind, const CoreRuntimeOp *op,
+             const OpInvocation &invocation)
+      : kind(kind),
+        op(op),
+        exec_ctx(invocation.exec_ctx),
+        attrs(invocation.attrs.freeze()) {
+    for (auto &argument : invocation.arguments)
+      arguments.push_back(std::move(argument));
+
+    auto *host = exec_ctx.host();
+    result.device = MakeUnconstructedAsyncValueRef<RCReference<Device>>(host);
+    result.metadata = MakeUnconstructedAsyncValueRef<TensorMetadata>(host);
+    result.tensor = MakeIndirectAsyncValue(host);
+    invocation.results[0] =
+        TensorHandle(result.device.CopyRef(), result.metadata.CopyRef(),
+                     AsyncValueRef<Tensor>(result.tensor.CopyRef()));
+  }
+
+  // Returns true if `argument` is the result of this op.
+  bool IsResult(const TensorHandle &argument) const {
+    return argument.GetAsyncTensor() == result.tensor.get();
+  }
+
+  LazyOpKind kind;
+  const CoreRuntimeOp *op;
+  ExecutionContext exec_ctx;
+  SmallVector<TensorHandle, 2> arguments;
+  OpAttrsRef attrs;
+  DeferredResult result;
+};
+
+// Copies the attributes of a "tf.Conv2D" op to its fused op.
+void CopyConv2DAttrs(const OpAttrsRef &src, OpAttrs *dst) {
+  string_view padding;
+  if (src.GetString("padding", &padding)) dst->SetString("padding", padding);
+  if (auto data_format = src.GetStringOptional("data_format"))
+    dst->SetString("data_format", *data_format);
+
+  auto strides = src.GetArrayOptional<ssize_t>("strides");
+  if (!strides.empty()) dst->SetArray("strides", strides);
+  auto dilations = src.GetArrayOptional<ssize_t>("dilations");
+  if (!dilations.empty()) dst->SetArray("dilations", dilations);
+  auto explicit_paddings = src.GetArrayOptional<int>("explicit_paddings");
+  if (!explicit_paddings.empty())
+    dst->SetArray("explicit_paddings", explicit_paddings);
+}
+
+// Fulfills the deferred `result` with the TensorHandle computed by the op.
+void ForwardResult(TensorHandle computed, const DeferredResult &result) {
+  if (computed.IsDeviceAvailable()) {
+    result.device.emplace(computed.GetAvailableDevice().CopyRef());
+  } else {
+    const auto &device = computed.GetAsyncDevice();
+    device.AndThen([src = device.CopyRef(), dst = result.device.CopyRef()] {
+      if (src.IsError())
+        dst.SetError(src.GetError());
+      else
+        dst.emplace(src->CopyRef());
+    });
+  }
+
+  if (computed.IsMetadataAvailable()) {
+    result.metadata.emplace(computed.GetAvailableMetadata());
+  } else {
+    const auto &metadata = computed.GetAsyncMetadata();
+    metadata.AndThen(
+        [src = metadata.CopyRef(), dst = result.metadata.CopyRef()] {
+          if (src.IsError())
+            dst.SetError(src.GetError());
+          else
+            dst.emplace(src.get());
+        });
+  }
+
+  result.tensor->ForwardTo(computed.ReleaseTensorRef().ReleaseRCRef());
+}
+
+// The ops deferred by a LazyOpHandler. The trace is reference counted, because
+// the tasks that flush it may outlive the op handler.
+class LazyTrace : public ReferenceCounted<LazyTrace> {
+ public:
+  LazyTrace(const CoreRuntimeOp *fused_matmul_op,
+            const CoreRuntimeOp *fused_conv2d_op)
+      : fused_matmul_op_(fused_matmul_op), fused_conv2d_op_(fused_conv2d_op) {
+    BefAttrEncoder encoder;
+    auto encode = [&](ArrayRef<string_view> ops) {
+      SmallVector<const void *, 2> values;
+      SmallVector<size_t, 2> lengths;
+      for (string_view op : ops) {
+        values.push_back(op.data());
+        lengths.push_back(op.size());
+      }
+      return encoder.EncodeStringListAttr(values.data(), lengths.data(),
+                                          ops.size());
+    };
+    bias_add_offset_ = encode({"BiasAdd"});
+    bias_add_relu_offset_ = encode({"BiasAdd", "Relu"});
+    fused_ops_buffer_ = encoder.TakeResult();
+  }
+
+  // Defers or executes the op invocation.
+  void Record(LazyOpKind kind, const CoreRuntimeOp &op,
+              const OpInvocation &invocation);
+
+  // Executes all deferred ops.
+  void Flush() { Execute(TakeDeferredOps()); }
+
+  // Drops all deferred ops without executing them, and stops deferring ops.
+  void Close();
+
+ private:
+  // Returns true if the op extends the chain of deferred ops.
+  bool CanDefer(LazyOpKind kind, const OpInvocation &invocation) const
+      TFRT_REQUIRES(mu_);
+
+  std::vector<DeferredOp> TakeDeferredOps() {
+    mutex_lock lock(mu_);
+    return TakeDeferredOpsLocked();
+  }
+
+  std::vector<DeferredOp> TakeDeferredOpsLocked() TFRT_REQUIRES(mu_) {
+    std::vector<DeferredOp> ops;
+    ops.swap(deferred_ops_);
+    return ops;
+  }
+
+  void Execute(std::vector<DeferredOp> ops);
+
+  // Executes `ops` as a single "tf._FusedMatMul" or "tf._FusedConv2D" op.
+  // Returns false if they cannot be fused.
+  bool ExecuteFused(MutableArrayRef<DeferredOp> ops);
+
+  // The fused ops of the wrapped op handler, or nullptr if it has none.
+  const CoreRuntimeOp *fused_matmul_op_;
+  const CoreRuntimeOp *fused_conv2d_op_;
+
+  // The encoded "fused_ops" attribute values of the fused op.
+  BefBuffer fused_ops_buffer_;
+  size_t bias_add_offset_;
+  size_t bias_add_relu_offset_;
+
+  mutex mu_;
+  bool closed_ TFRT_GUARDED_BY(mu_) = false;
+  std::vector<DeferredOp> deferred_ops_ TFRT_GUARDED_BY(mu_);
+};
+
+bool LazyTrace::CanDefer(LazyOpKind kind,
+                         const OpInvocation &invocation) const {
+  if (closed_ || invocation.results.size() != 1 ||
+      invocation.arguments.size() != (kind == LazyOpKind::kRelu ? 1 : 2))
+    return false;
+
+  switch (kind) {
+    case LazyOpKind::kMatMul:
+      return fused_matmul_op_ && deferred_ops_.empty();
+    case LazyOpKind::kConv2D:
+      return fused_conv2d_op_ && deferred_ops_.empty();
+    case LazyOpKind::kBiasAdd:
+      return deferred_ops_.size() == 1 &&
+             deferred_ops_.back().IsResult(invocation.arguments[0]);
+    case LazyOpKind::kRelu:
+      return deferred_ops_.size() == 2 &&
+             deferred_ops_.back().IsResult(invocation.arguments[0]);
+    case LazyOpKind::kOther:
+      return false;
+  }
+  return false;
+}
+
+void LazyTrace::Record(LazyOpKind kind, const CoreRuntimeOp &op,
+                       const OpInvocation &invocation) {
+  std::vector<DeferredOp> ops_to_execute;
+  bool deferred = false;
+  bool schedule_flush = false;
+  {
+    mutex_lock lock(mu_);
+    // An op that does not extend the chain ends it. A new chain can only
+    // start with a MatMul or a Conv2D. A complete chain is not executed right away, so
+    // that the caller can drop the intermediate results before it is fused.
+    if (!CanDefer(kind, invocation)) ops_to_execute = TakeDeferredOpsLocked();
+    if (CanDefer(kind, invocation)) {
+      deferred_ops_.emplace_back(kind, &op, invocation);
+      deferred = true;
+      schedule_flush = deferred_ops_.size() == 1;
+    }
+  }
+
+  // Execute the ops that were deferred before the op, so that the ops are
+  // executed in the order they were dispatched.
+  Execute(std::move(ops_to_execute));
+  if (!deferred) op(invocation);
+
+  // Make sure that the chain is executed even if no more ops are dispatched.
+  if (schedule_flush)
+    EnqueueWork(invocation.exec_ctx, [trace = FormRef(this)] {
+      trace->Flush();
+    });
+}
+
+void LazyTrace::Close() {
+  std::vector<DeferredOp> ops;
+  {
+    mutex_lock lock(mu_);
+    closed_ = true;
+    ops = TakeDeferredOpsLocked();
+  }
+  for (auto &op : ops) {
+    auto error = EmitErrorAsync(op.exec_ctx, "op handler was destroyed");
+    ForwardResult(TensorHandle::CreateError(std::move(error)), op.result);
+  }
+}
+
+void LazyTrace::Execute(std::vector<DeferredOp> ops) {
+  if (ops.empty() || ExecuteFused(ops)) return;
+
+  for (auto &op : ops) {
+    TensorHandle result;
+    (*op.op)(op.exec_ctx, op.arguments, op.attrs, result, /*chain=*/nullptr);
+    ForwardResult(std::move(result), op.result);
+  }
+}
+
+bool LazyTrace::ExecuteFused(MutableArrayRef<DeferredOp> ops) {
+  if (ops.size() < 2) return false;
+
+  // The intermediate results can only be fused away if they are referenced by
+  // the deferred ops only, i.e. by their DeferredResult and by the argument of
+  // the next op.
+  for (size_t i = 0; i + 1 < ops.size(); ++i)
+    if (ops[i].result.tensor->NumRef() != 2) return false;
+
+  DeferredOp &first = ops[0];
+  DeferredOp &bias_add = ops[1];
+  DeferredOp &last = ops.back();
+
+  OpAttrs attrs;
+  const CoreRuntimeOp *fused_op;
+  if (first.kind == LazyOpKind::kConv2D) {
+    fused_op = fused_conv2d_op_;
+    CopyConv2DAttrs(first.attrs, &attrs);
+  } else {
+    fused_op = fused_matmul_op_;
+    attrs.Set("transpose_a",
+              first.attrs.GetOptional<bool>("transpose_a").getValueOr(false));
+    attrs.Set("transpose_b",
+              first.attrs.GetOptional<bool>("transpose_b").getValueOr(false));
+  }
+  size_t fused_ops_offset =
+      ops.size() == 3 ? bias_add_relu_offset_ : bias_add_offset_;
+  attrs.Set("fused_ops",
+            AggregateAttr(fused_ops_buffer_.data() + fused_ops_offset));
+
+  SmallVector<TensorHandle, 3> arguments;
+  arguments.push_back(std::move(first.arguments[0]));
+  arguments.push_back(std::move(first.arguments[1]));
+  arguments.push_back(std::move(bias_add.arguments[1]));
+
+  TensorHandle result;
+  (*fused_op)(last.exec_ctx, arguments, OpAttrsRef(attrs), result,
+              /*chain=*/nullptr);
+  ForwardResult(std::move(result), last.result);
+
+  // No one observes the intermediate results.
+  for (size_t i = 0; i + 1 < ops.size(); ++i) {
+    auto error = MakeErrorAsyncValueRef(ops[i].exec_ctx.host(),
+                                        "intermediate result of a fused op");
+    ForwardResult(TensorHandle::CreateError(std::move(error)), ops[i].result);
+  }
+  return true;
+}
+
+class LazyOpHandler : public OpHandler {
+ public:
+  static llvm::Expected<std::unique_ptr<LazyOpHandler>> Create(
+      CoreRuntime *runtime, OpHandler *fallback) {
+    auto op_handler = std::make_unique<LazyOpHandler>(runtime, fallback);
+    // Without the fused ops there is nothing to gain from deferring ops.
+    auto get_fused_op = [&](string_view op_name) -> const CoreRuntimeOp * {
+      auto op = op_handler->GetFallbackOp(op_name);
+      if (op) return *op;
+      llvm::consumeError(op.takeError());
+      return nullptr;
+    };
+    op_handler->trace_ =
+        TakeRef(new LazyTrace(get_fused_op("tf._FusedMatMul"),
+                              get_fused_op("tf._FusedConv2D")));
+    return std::move(op_handler);
+  }
+
+  explicit LazyOpHandler(CoreRuntime *runtime, OpHandler *fallback)
+      : OpHandler("lazy", runtime, fallback) {}
+
+  ~LazyOpHandler() override { trace_->Close(); }
+
+  Expected<CoreRuntimeOp> MakeOp(string_view op_name) override;
+
+ private:
+  // Returns the op of the wrapped op handler. The ops are owned by this op
+  // handler, because the deferred ops outlive the CoreRuntimeOp they were
+  // dispatched to.
+  Expected<const CoreRuntimeOp *> GetFallbackOp(string_view op_name);
+
+  RCReference<LazyTrace> trace_;
+
+  mutex mu_;
+  llvm::StringMap<CoreRuntimeOp> fallback_ops_ TFRT_GUARDED_BY(mu_);
+};
+
+Expected<const CoreRuntimeOp *> LazyOpHandler::GetFallbackOp(
+    string_view op_name) {
+  mutex_lock lock(mu_);
+  auto it = fallback_ops_.find(op_name);
+  if (it != fallback_ops_.end()) return &it->second;
+
+  auto op = GetFallback()->MakeOp(op_name);
+  if (!op) return op.takeError();
+  return &fallback_ops_.try_emplace(op_name, std::move(*op)).first->second;
+}
+
+}  // namespace
+
+Expected<CoreRuntimeOp> LazyOpHandler::MakeOp(string_view op_name) {
+  auto fallback_op = GetFallbackOp(op_name);
+  if (!fallback_op) return fallback_op.takeError();
+
+  LazyOpKind kind = GetLazyOpKind(op_name);
+  const CoreRuntimeOp *op = *fallback_op;
+  return CoreRuntimeOp(
+      [trace = trace_.CopyRef(), kind, op](const OpInvocation &invocation) {
+        trace->Record(kind, *op, invocation);
+      },
+      /*is_fallback=*/false);
+}
+
+llvm::Expected<tfrt::OpHandler *> CreateLazyOpHandler(
+    tfrt::CoreRuntime *runtime, OpHandler *fallback) {
+  auto op_handler = LazyOpHandler::Create(runtime, fallback);
+  if (auto error = op_handler.takeError()) {
+    return std::move(error);
+  }
+  auto op_handler_ptr = op_handler->get();
+  runtime->TakeOpHandler(std::move(op_handler.get()));
+  return op_handler_ptr;
+}
+
+}  // namespace tfrt
@@ -16,6 +16,10 @@
 
 #include "tfrt/core_runtime/op_attrs.h"
 
+#include <cstring>
+#include <limits>
+
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Alignment.h"
@@ -121,9 +125,15 @@ class ImmutableOpAttrs : public ReferenceCounted<ImmutableOpAttrs> {
   void IterateEntries(
       const std::function<void(const OpAttrsRawEntry &entry)> &fn) const;
 
+  // The interner that returned this set, or nullptr if it is not interned.
+  const OpAttrsInterner *interner() const { return interner_; }
+  // The fingerprint of an interned set.
+  uint64_t fingerprint() const { return fingerprint_; }
+
  private:
   friend class ReferenceCounted<ImmutableOpAttrs>;
   friend class OpAttrs;
+  friend class OpAttrsInterner;
 
   static RCReference<ImmutableOpAttrs> create(const OpAttrs &attrs);
   explicit ImmutableOpAttrs(size_t num_entries) : num_entries_(num_entries) {}
@@ -133,6 +143,9 @@ class ImmutableOpAttrs : public ReferenceCounted<ImmutableOpAttrs> {
   // This is the number of entries in this set.
   size_t num_entries_;
 
+  const OpAttrsInterner *interner_ = nullptr;
+  uint64_t fingerprint_ = 0;
+
   // The entries_ array is tail allocated here, and followed by the payload
   // data for the attributes.
   OpAttrsRawEntry entries_[];
@@ -878,4 +891,102 @@ void OpAttrsRef::Print(raw_ostream &os) const {
 
 void OpAttrsRef::Dump() const { Print(llvm::errs()); }
 
+// Return the size of the value of `entry` in bytes.
+static size_t GetValueSize(const OpAttrsRawEntry &entry) {
+  if (entry.element_count == 0) return 0;
+  size_t size = GetHostSizeAndAlignment(entry.GetData(), entry.type).first;
+  return entry.IsArray() ? size * entry.element_count : size;
+}
+
+Optional<uint64_t> OpAttrsRef::Fingerprint(size_t max_value_bytes) const {
+  if (GetNumEntries() == 0) return uint64_t{0};
+  if (auto *ptr = attrs_.dyn_cast<ImmutableOpAttrs *>())
+    if (ptr->interner()) return ptr->fingerprint();
+
+  // Entries are combined with a commutative operation, because the iteration
+  // order of a mutable OpAttrs is not deterministic.
+  uint64_t fingerprint = 0;
+  size_t value_bytes = 0;
+  IterateEntries([&](const OpAttrsRawEntry &entry) {
+    size_t size = GetValueSize(entry);
+    value_bytes += size;
+    if (value_bytes > max_value_bytes) return;
+    const char *data = static_cast<const char *>(entry.GetData());
+    fingerprint += llvm::hash_combine(
+        string_view(entry.name), entry.type, entry.IsArray(),
+        entry.element_count, llvm::hash_combine_range(data, data + size));
+  });
+
+  if (value_bytes > max_value_bytes) return llvm::None;
+  return fingerprint;
+}
+
+bool OpAttrsRef::IsInterned() const { return GetInternedIdentity() != nullptr; }
+
+const void *OpAttrsRef::GetInternedIdentity() const {
+  auto *ptr = attrs_.dyn_cast<ImmutableOpAttrs *>();
+  return ptr && ptr->interner() ? ptr : nullptr;
+}
+
+//===----------------------------------------------------------------------===//
+// OpAttrsInterner implementation
+//===----------------------------------------------------------------------===//
+
+// Return true if `lhs` and `rhs` have the same attribute names and values.
+static bool HaveSameEntries(const ImmutableOpAttrs &lhs, const OpAttrs &rhs) {
+  if (lhs.GetNumEntries() != rhs.GetNumEntries()) return false;
+  bool same = true;
+  lhs.IterateEntries([&](const OpAttrsRawEntry &entry) {
+    if (!same) return;
+    const OpAttrsRawEntry *other = rhs.GetRaw(entry.name);
+    same = other && other->type == entry.type &&
+           other->IsArray() == entry.IsArray() &&
+           other->element_count == entry.element_count &&
+           !memcmp(other->GetData(), entry.GetData(), GetValueSize(entry));
+  });
+  return same;
+}
+
+OpAttrsInterner::~OpAttrsInterner() {
+  for (auto &it : interned_) it.second->DropRef();
+}
+
+OpAttrsRef OpAttrsInterner::Intern(const OpAttrs &attrs) {
+  if (attrs.GetNumEntries() == 0) return OpAttrsRef();
+
+  // Fast path: `attrs` was interned before and not modified since.
+  const auto &frozen = attrs.frozen_representation_;
+  if (frozen && frozen->interner() == this) return OpAttrsRef(frozen.CopyRef());
+
+  bool has_external_entries = false;
+  attrs.IterateEntries([&](const OpAttrsRawEntry &entry) {
+    has_external_entries |= entry.IsExternal();
+  });
+  if (has_external_entries) return attrs.freeze();
+
+  uint64_t fingerprint =
+      *OpAttrsRef(attrs).Fingerprint(std::numeric_limits<size_t>::max());
+
+  mutex_lock lock(mu_);
+  auto range = interned_.equal_range(fingerprint);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (HaveSameEntries(*it->second, attrs)) {
+      attrs.frozen_representation_ = FormRef(it->second);
+      return OpAttrsRef(FormRef(it->second));
+    }
+  }
+
+  auto interned = ImmutableOpAttrs::create(attrs);
+  interned->interner_ = this;
+  interned->fingerprint_ = fingerprint;
+  interned_.emplace(fingerprint, interned.CopyRef().release());
+  attrs.frozen_representation_ = interned.CopyRef();
+  return OpAttrsRef(std::move(interned));
+}
+
+size_t OpAttrsInterner::size() const {
+  mutex_lock lock(mu_);
+  return interned_.size();
+}
+
 }  // namespace tfrt
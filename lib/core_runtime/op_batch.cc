@@ -0,0 +1,124 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements OpBatch.
+
+#include "tfrt/core_runtime/op_batch.h"
+
+#include <algorithm>
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+
+namespace tfrt {
+
+OpBatch::ValueId OpBatch::AddArgument() {
+  ValueId value = num_values_++;
+  last_use_.push_back(kNoUse);
+  argument_values_.push_back(value);
+  return value;
+}
+
+Expected<OpBatch::ValueId> OpBatch::AddOp(string_view op_name,
+                                          OpHandler* op_handler,
+                                          ArrayRef<ValueId> arguments,
+                                          const OpAttrs& attrs,
+                                          size_t num_results) {
+  auto& ops_by_name = resolved_ops_[op_handler];
+  auto it = ops_by_name.find(op_name);
+  if (it == ops_by_name.end()) {
+    auto op = runtime_->MakeOp(op_name, op_handler);
+    if (!op) return op.takeError();
+    it = ops_by_name.try_emplace(op_name, std::move(*op)).first;
+  }
+
+  Op op{&it->second,
+        attrs.freeze(),
+        static_cast<uint32_t>(op_arguments_.size()),
+        static_cast<uint32_t>(arguments.size()),
+        num_values_,
+        static_cast<uint32_t>(num_results)};
+
+  for (ValueId value : arguments) {
+    assert(value < num_values_ && "argument is not a value of the batch");
+    int32_t& last_use = last_use_[value];
+    if (last_use == kEscaped) {
+      op_arguments_.push_back({value, /*take=*/false});
+      continue;
+    }
+    if (last_use != kNoUse) op_arguments_[last_use].take = false;
+    last_use = op_arguments_.size();
+    op_arguments_.push_back({value, /*take=*/true});
+  }
+
+  ops_.push_back(std::move(op));
+  max_op_arguments_ =
+      std::max(max_op_arguments_, static_cast<uint32_t>(arguments.size()));
+
+  ValueId first_result = num_values_;
+  num_values_ += num_results;
+  last_use_.resize(num_values_, kNoUse);
+  return first_result;
+}
+
+void OpBatch::AddResult(ValueId value) {
+  assert(value < num_values_ && "result is not a value of the batch");
+  int32_t& last_use = last_use_[value];
+  if (last_use >= 0) op_arguments_[last_use].take = false;
+  last_use = kEscaped;
+  results_.push_back(value);
+}
+
+void OpBatch::Execute(const ExecutionContext& exec_ctx,
+                      MutableArrayRef<TensorHandle> arguments,
+                      MutableArrayRef<TensorHandle> results,
+                      AsyncValueRef<Chain>* chain) const {
+  assert(arguments.size() == argument_values_.size());
+  assert(results.size() == results_.size());
+
+  // The TensorHandles of all values of the batch are allocated at once.
+  SmallVector<TensorHandle, 16> values;
+  values.resize(num_values_);
+  for (size_t i = 0, e = arguments.size(); i != e; ++i)
+    values[argument_values_[i]] = std::move(arguments[i]);
+
+  SmallVector<TensorHandle, 4> op_arguments;
+  op_arguments.resize(max_op_arguments_);
+  for (const Op& op : ops_) {
+    MutableArrayRef<TensorHandle> args(op_arguments.data(), op.num_arguments);
+    for (uint32_t i = 0; i != op.num_arguments; ++i) {
+      const OpArgument& argument = op_arguments_[op.arguments_begin + i];
+      TensorHandle& value = values[argument.value];
+      // Take the TensorHandle on its last use to enable input forwarding.
+      args[i] = argument.take ? std::move(value) : value.CopyRef();
+    }
+
+    (*op.op)(exec_ctx, args, op.attrs,
+             MutableArrayRef<TensorHandle>(values).slice(op.first_result,
+                                                         op.num_results),
+             chain);
+
+    // The op may leave the arguments untouched.
+    for (auto& arg : args) arg = TensorHandle();
+  }
+
+  for (size_t i = 0, e = results.size(); i != e; ++i)
+    results[i] = values[results_[i]].CopyRef();
+}
+
+}  // namespace tfrt
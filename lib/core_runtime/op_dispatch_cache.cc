@@ -0,0 +1,162 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the caches used on the op dispatch path.
+#include "tfrt/core_runtime/op_dispatch_cache.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "llvm/ADT/Hashing.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/metrics/metrics.h"
+
+namespace tfrt {
+
+ArgumentConversionCache::~ArgumentConversionCache() {
+  for (auto& slot : entries_) delete slot.load(std::memory_order_relaxed);
+}
+
+const ArgumentConversionCache::Entry* ArgumentConversionCache::Insert(
+    const Entry& entry) {
+  auto new_entry = std::make_unique<Entry>(entry);
+  for (auto& slot : entries_) {
+    const Entry* expected = nullptr;
+    if (slot.compare_exchange_strong(expected, new_entry.get(),
+                                     std::memory_order_acq_rel))
+      return new_entry.release();
+    // Another thread cached the same key first.
+    if (expected->key == entry.key) return expected;
+  }
+  return nullptr;
+}
+
+//===----------------------------------------------------------------------===//
+// MetadataFnCache
+//===----------------------------------------------------------------------===//
+
+/*static*/ MetadataFnCache& MetadataFnCache::Get(HostContext* host) {
+  return host->GetOrCreateSharedContext<MetadataFnCache>();
+}
+
+static uint64_t HashMetadataFnCall(OpMetadataFn metadata_fn,
+                                   ArrayRef<TensorMetadata> arguments,
+                                   uint64_t attrs_fingerprint) {
+  llvm::hash_code hash = llvm::hash_combine(
+      reinterpret_cast<const void*>(metadata_fn), attrs_fingerprint);
+  for (const TensorMetadata& md : arguments) {
+    hash = llvm::hash_combine(hash, md.dtype.kind(), md.shape.GetRank());
+    for (int i = 0, e = md.shape.GetRank(); i != e; ++i)
+      hash = llvm::hash_combine(hash, md.shape.GetDimensionSize(i));
+  }
+  // Drop a bit so that the hash is never a reserved DenseMap key.
+  return static_cast<uint64_t>(hash) >> 1;
+}
+
+// Picks the shard from the high bits of the hash, the low bits are used by the
+// DenseMap of the shard.
+static int GetShardIndex(uint64_t hash) {
+  return (hash >> 32) % MetadataFnCache::kNumShards;
+}
+
+RCReference<AsyncValue> MetadataFnCache::Run(
+    OpMetadataFn metadata_fn, const ExecutionContext& exec_ctx,
+    ArrayRef<TensorMetadata> arguments, const OpAttrsRef& attrs,
+    MutableArrayRef<TensorMetadata> results) {
+  auto attrs_fingerprint = attrs.Fingerprint(kMaxAttrValueBytes);
+  if (!attrs_fingerprint) {
+    num_uncacheable_.fetch_add(1, std::memory_order_relaxed);
+    return metadata_fn(exec_ctx, arguments, attrs, results);
+  }
+
+  uint64_t hash =
+      HashMetadataFnCall(metadata_fn, arguments, *attrs_fingerprint);
+  if (Lookup(hash, metadata_fn, arguments, *attrs_fingerprint, results)) {
+    RecordLookup(/*hit=*/true);
+    return {};
+  }
+  RecordLookup(/*hit=*/false);
+
+  if (auto error = metadata_fn(exec_ctx, arguments, attrs, results))
+    return error;
+  Insert(hash, metadata_fn, arguments, *attrs_fingerprint, results);
+  return {};
+}
+
+bool MetadataFnCache::Lookup(uint64_t hash, OpMetadataFn metadata_fn,
+                             ArrayRef<TensorMetadata> arguments,
+                             uint64_t attrs_fingerprint,
+                             MutableArrayRef<TensorMetadata> results) {
+  Shard& shard = shards_[GetShardIndex(hash)];
+  mutex_lock lock(shard.mu);
+  auto it = shard.entries.find(hash);
+  if (it == shard.entries.end()) return false;
+
+  // Different calls with the same hash replace each other in the cache.
+  const Entry& entry = it->second;
+  if (entry.metadata_fn != metadata_fn ||
+      entry.attrs_fingerprint != attrs_fingerprint ||
+      entry.results.size() != results.size() ||
+      ArrayRef<TensorMetadata>(entry.arguments) != arguments)
+    return false;
+
+  std::copy(entry.results.begin(), entry.results.end(), results.begin());
+  return true;
+}
+
+void MetadataFnCache::Insert(uint64_t hash, OpMetadataFn metadata_fn,
+                             ArrayRef<TensorMetadata> arguments,
+                             uint64_t attrs_fingerprint,
+                             ArrayRef<TensorMetadata> results) {
+  Entry entry{metadata_fn, attrs_fingerprint,
+              {arguments.begin(), arguments.end()},
+              {results.begin(), results.end()}};
+
+  Shard& shard = shards_[GetShardIndex(hash)];
+  mutex_lock lock(shard.mu);
+  if (shard.entries.size() >= kMaxEntriesPerShard) shard.entries.clear();
+  shard.entries[hash] = std::move(entry);
+}
+
+void MetadataFnCache::RecordLookup(bool hit) {
+  static metrics::Histogram* hit_rate = metrics::NewHistogram(
+      "/tfrt/core_runtime/metadata_fn_cache/hit_rate",
+      metrics::Buckets::Explicit({0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7, 0.8, 0.9,
+                                  0.95, 0.99, 1.0}));
+
+  if (hit) {
+    num_hits_.fetch_add(1, std::memory_order_relaxed);
+    num_interval_hits_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    num_misses_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint64_t num_lookups = num_hits_.load(std::memory_order_relaxed) +
+                         num_misses_.load(std::memory_order_relaxed);
+  if (num_lookups % kReportInterval != 0) return;
+  uint64_t num_interval_hits =
+      num_interval_hits_.exchange(0, std::memory_order_relaxed);
+  hit_rate->Record(static_cast<double>(num_interval_hits) / kReportInterval);
+}
+
+MetadataFnCache::Stats MetadataFnCache::GetStats() const {
+  Stats stats;
+  stats.num_hits = num_hits_.load(std::memory_order_relaxed);
+  stats.num_misses = num_misses_.load(std::memory_order_relaxed);
+  stats.num_uncacheable = num_uncacheable_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}  // namespace tfrt
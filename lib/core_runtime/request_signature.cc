@@ -0,0 +1,271 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the recording and the replay of request signatures.
+
+#include "tfrt/core_runtime/request_signature.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+
+Expected<RequestSignature> GetRequestSignature(
+    const Function& function, ArrayRef<AsyncValue*> arguments) {
+  RequestSignature signature;
+  signature.function_name = function.name().str();
+  for (AsyncValue* argument : arguments) {
+    if (!argument->IsConcrete())
+      return MakeStringError("argument is not available");
+    if (argument->IsType<Chain>()) {
+      signature.arguments.push_back(
+          {RequestSignature::ArgumentKind::kChain, llvm::None});
+    } else if (argument->IsType<DenseHostTensor>()) {
+      signature.arguments.push_back(
+          {RequestSignature::ArgumentKind::kDenseHostTensor,
+           argument->get<DenseHostTensor>().metadata()});
+    } else if (argument->IsType<TensorHandle>()) {
+      const auto& handle = argument->get<TensorHandle>();
+      if (!handle.IsMetadataAvailable())
+        return MakeStringError("tensor handle metadata is not available");
+      signature.arguments.push_back(
+          {RequestSignature::ArgumentKind::kTensorHandle,
+           handle.GetAvailableMetadata()});
+    } else {
+      return MakeStringError("unsupported argument type");
+    }
+  }
+  return signature;
+}
+
+std::string PrintRequestSignature(const RequestSignature& signature) {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  os << signature.function_name;
+  for (const auto& argument : signature.arguments) {
+    switch (argument.kind) {
+      case RequestSignature::ArgumentKind::kChain:
+        os << " chain";
+        continue;
+      case RequestSignature::ArgumentKind::kDenseHostTensor:
+        os << " dht:";
+        break;
+      case RequestSignature::ArgumentKind::kTensorHandle:
+        os << " th:";
+        break;
+    }
+    llvm::SmallVector<ssize_t, 4> dims;
+    argument.metadata->shape.GetDimensions(&dims);
+    os << argument.metadata->dtype.GetName() << '['
+       << llvm::join(llvm::map_range(dims, [](ssize_t dim) {
+                       return std::to_string(dim);
+                     }),
+                     ",")
+       << ']';
+  }
+  return os.str();
+}
+
+static Expected<DType> ParseDType(string_view name) {
+  for (uint8_t kind = DType::FirstDType; kind < DType::LastDType; ++kind) {
+    DType dtype(static_cast<DType::Kind>(kind));
+    if (name == dtype.GetName()) return dtype;
+  }
+  return MakeStringError("unknown dtype: ", name);
+}
+
+// Parses a tensor type, e.g. "f32[2,3]".
+static Expected<TensorMetadata> ParseTensorMetadata(string_view str) {
+  size_t bracket = str.find('[');
+  if (bracket == string_view::npos || !str.endswith("]"))
+    return MakeStringError("invalid tensor type: ", str);
+
+  auto dtype = ParseDType(str.take_front(bracket));
+  if (!dtype) return dtype.takeError();
+
+  llvm::SmallVector<ssize_t, 4> dims;
+  llvm::SmallVector<string_view, 4> parts;
+  str.drop_front(bracket + 1).drop_back().split(parts, ',', /*MaxSplit=*/-1,
+                                                /*KeepEmpty=*/false);
+  for (string_view part : parts) {
+    ssize_t dim;
+    if (part.getAsInteger(10, dim) || dim < 0)
+      return MakeStringError("invalid tensor type: ", str);
+    dims.push_back(dim);
+  }
+  return TensorMetadata(*dtype, dims);
+}
+
+Expected<RequestSignature> ParseRequestSignature(string_view line) {
+  llvm::SmallVector<string_view, 4> parts;
+  line.split(parts, ' ', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  if (parts.empty()) return MakeStringError("empty request signature");
+
+  RequestSignature signature;
+  signature.function_name = parts[0].str();
+  for (string_view part : llvm::makeArrayRef(parts).drop_front()) {
+    if (part == "chain") {
+      signature.arguments.push_back(
+          {RequestSignature::ArgumentKind::kChain, llvm::None});
+      continue;
+    }
+
+    RequestSignature::ArgumentKind kind;
+    if (part.consume_front("dht:")) {
+      kind = RequestSignature::ArgumentKind::kDenseHostTensor;
+    } else if (part.consume_front("th:")) {
+      kind = RequestSignature::ArgumentKind::kTensorHandle;
+    } else {
+      return MakeStringError("invalid argument: ", part);
+    }
+    auto metadata = ParseTensorMetadata(part);
+    if (!metadata) return metadata.takeError();
+    signature.arguments.push_back({kind, std::move(*metadata)});
+  }
+  return signature;
+}
+
+void RequestRecorder::Record(const Function& function,
+                             ArrayRef<AsyncValue*> arguments) {
+  auto signature = GetRequestSignature(function, arguments);
+  if (!signature) {
+    llvm::consumeError(signature.takeError());
+    return;
+  }
+  std::string printed = PrintRequestSignature(*signature);
+  mutex_lock lock(mu_);
+  if (printed_.insert(printed).second)
+    signatures_.push_back(std::move(*signature));
+}
+
+std::vector<RequestSignature> RequestRecorder::GetSignatures() const {
+  mutex_lock lock(mu_);
+  return signatures_;
+}
+
+void RequestRecorder::Write(raw_ostream& os) const {
+  for (const auto& signature : GetSignatures())
+    os << PrintRequestSignature(signature) << '\n';
+}
+
+Expected<std::vector<RequestSignature>> ParseRequestSignatures(
+    string_view text) {
+  std::vector<RequestSignature> signatures;
+  llvm::SmallVector<string_view, 16> lines;
+  text.split(lines, '\n', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  for (string_view line : lines) {
+    if (line.trim().empty()) continue;
+    auto signature = ParseRequestSignature(line.trim());
+    if (!signature) return signature.takeError();
+    signatures.push_back(std::move(*signature));
+  }
+  return std::move(signatures);
+}
+
+// Returns a zero-filled argument of the signature.
+static Expected<RCReference<AsyncValue>> MakeArgument(
+    const RequestSignature::Argument& argument,
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  if (argument.kind == RequestSignature::ArgumentKind::kChain)
+    return RCReference<AsyncValue>(GetReadyChain(host));
+
+  auto dht = DenseHostTensor::CreateUninitialized(*argument.metadata, host);
+  if (!dht) return MakeStringError("cannot allocate argument");
+  std::memset(dht->data(), 0, dht->DataSizeInBytes());
+
+  if (argument.kind == RequestSignature::ArgumentKind::kDenseHostTensor)
+    return RCReference<AsyncValue>(
+        MakeAvailableAsyncValueRef<DenseHostTensor>(host, std::move(*dht)));
+
+  return RCReference<AsyncValue>(MakeAvailableAsyncValueRef<TensorHandle>(
+      host, host->GetHostDeviceRef(), *argument.metadata,
+      MakeAvailableAsyncValueRef<DenseHostTensor>(host, std::move(*dht))));
+}
+
+Error WarmUp(ArrayRef<RequestSignature> signatures,
+             llvm::function_ref<const Function*(string_view)> find_function,
+             const ExecutionContext& exec_ctx) {
+  std::string errors;
+  auto add_error = [&](string_view function_name, string_view message) {
+    StrAppend(&errors, errors.empty() ? "" : "; ", function_name, ": ",
+              message);
+  };
+
+  llvm::SmallVector<RCReference<AsyncValue>, 4> results;
+  llvm::SmallVector<string_view, 4> result_functions;
+  for (const auto& signature : signatures) {
+    const Function* function = find_function(signature.function_name);
+    if (!function) {
+      add_error(signature.function_name, "function not found");
+      continue;
+    }
+    if (function->function_kind() == FunctionKind::kSyncBEFFunction) {
+      add_error(signature.function_name, "sync functions are not supported");
+      continue;
+    }
+    if (function->num_arguments() != signature.arguments.size()) {
+      add_error(signature.function_name, "wrong number of arguments");
+      continue;
+    }
+
+    llvm::SmallVector<RCReference<AsyncValue>, 4> arguments;
+    for (const auto& argument : signature.arguments) {
+      auto value = MakeArgument(argument, exec_ctx);
+      if (!value) {
+        add_error(signature.function_name, toString(value.takeError()));
+        break;
+      }
+      arguments.push_back(std::move(*value));
+    }
+    if (arguments.size() != signature.arguments.size()) continue;
+
+    llvm::SmallVector<AsyncValue*, 4> argument_ptrs;
+    for (const auto& argument : arguments)
+      argument_ptrs.push_back(argument.get());
+    llvm::SmallVector<RCReference<AsyncValue>, 4> function_results;
+    function_results.resize(function->num_results());
+    function->Execute(exec_ctx, argument_ptrs, function_results);
+    for (auto& result : function_results) {
+      results.push_back(std::move(result));
+      result_functions.push_back(function->name());
+    }
+  }
+
+  exec_ctx.host()->Await(results);
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (auto* error = results[i]->GetErrorIfPresent())
+      add_error(result_functions[i], error->message);
+  }
+
+  if (errors.empty()) return Error::success();
+  return MakeStringError("warm-up failed: ", errors);
+}
+
+}  // namespace tfrt
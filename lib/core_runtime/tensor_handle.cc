@@ -69,11 +69,10 @@ TensorHandle::TensorHandle(AsyncValueRef<RCReference<Device>> async_device,
     new (&async_device_) AsyncValueRef<RCReference<Device>>(error.CopyRef());
     new (&async_metadata_) AsyncValueRef<TensorMetadata>(std::move(error));
   } else {
-    tensor_and_flags_.setPointerAndInt(tensor.release(), flags);
-    new (&async_device_)
-        AsyncValueRef<RCReference<Device>>(std::move(async_device));
-    new (&async_metadata_)
-        AsyncValueRef<TensorMetadata>(std::move(async_metadata));
+    tensor_and_flags_.setPointerAndInt(ReleaseTensor(std::move(tensor)),
+                                       flags);
+    InitDevice(std::move(async_device));
+    InitMetadata(std::move(async_metadata));
   }
 }
 
@@ -96,9 +95,9 @@ TensorHandle::TensorHandle(AsyncValueRef<RCReference<Device>> async_device,
     new (&async_device_) AsyncValueRef<RCReference<Device>>(std::move(error));
 
   } else {
-    tensor_and_flags_.setPointerAndInt(tensor.release(), flags);
-    new (&async_device_)
-        AsyncValueRef<RCReference<Device>>(std::move(async_device));
+    tensor_and_flags_.setPointerAndInt(ReleaseTensor(std::move(tensor)),
+                                       flags);
+    InitDevice(std::move(async_device));
   }
 
   new (&inlined_metadata_) TensorMetadata(metadata);
@@ -123,9 +122,9 @@ TensorHandle::TensorHandle(RCReference<Device> device,
     tensor_and_flags_.setPointerAndInt(error.CopyRef().release(), flags);
     new (&async_metadata_) AsyncValueRef<TensorMetadata>(std::move(error));
   } else {
-    tensor_and_flags_.setPointerAndInt(tensor.release(), flags);
-    new (&async_metadata_)
-        AsyncValueRef<TensorMetadata>(std::move(async_metadata));
+    tensor_and_flags_.setPointerAndInt(ReleaseTensor(std::move(tensor)),
+                                       flags);
+    InitMetadata(std::move(async_metadata));
   }
   new (&inlined_device_) RCReference<Device>(std::move(device));
 }
@@ -137,11 +136,43 @@ TensorHandle::TensorHandle(RCReference<Device> device,
   assert(device);
   uint32_t flags = Flags::DeviceInline | Flags::MetadataInline;
 
-  tensor_and_flags_.setPointerAndInt(tensor.release(), flags);
+  tensor_and_flags_.setPointerAndInt(ReleaseTensor(std::move(tensor)), flags);
   new (&inlined_metadata_) TensorMetadata(metadata);
   new (&inlined_device_) RCReference<Device>(std::move(device));
 }
 
+AsyncValue* TensorHandle::ReleaseTensor(AsyncValueRef<Tensor> tensor) {
+  // Skip the IndirectAsyncValue of a tensor that is already resolved, so that
+  // consumers access the tensor without the extra hop.
+  if (auto* indirect = dyn_cast<IndirectAsyncValue>(tensor.GetAsyncValue())) {
+    if (auto* value = indirect->GetForwardedValue())
+      return FormRef(value).release();
+  }
+  return tensor.release();
+}
+
+void TensorHandle::InitDevice(
+    AsyncValueRef<RCReference<Device>> async_device) {
+  if (async_device.IsConcrete()) {
+    new (&inlined_device_) RCReference<Device>(async_device->CopyRef());
+    tensor_and_flags_.setInt(tensor_and_flags_.getInt() | Flags::DeviceInline);
+  } else {
+    new (&async_device_)
+        AsyncValueRef<RCReference<Device>>(std::move(async_device));
+  }
+}
+
+void TensorHandle::InitMetadata(AsyncValueRef<TensorMetadata> async_metadata) {
+  if (async_metadata.IsConcrete()) {
+    new (&inlined_metadata_) TensorMetadata(async_metadata.get());
+    tensor_and_flags_.setInt(tensor_and_flags_.getInt() |
+                             Flags::MetadataInline);
+  } else {
+    new (&async_metadata_)
+        AsyncValueRef<TensorMetadata>(std::move(async_metadata));
+  }
+}
+
 TensorHandle::TensorHandle(AsyncValueRef<TensorHandle> error) {
   assert(error.IsError());
   tensor_and_flags_.setPointerAndInt(error.CopyRef().release(), 0);
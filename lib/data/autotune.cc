@@ -0,0 +1,164 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the Autotuner, which adjusts the buffer sizes and the
+// parallelism of the iterators in an input pipeline at runtime.
+
+#include "autotune.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "iterator_stats.h"
+#include "tfrt/host_context/async_dispatch.h"
+
+namespace tfrt {
+namespace data {
+namespace {
+
+// Weight of a new sample in the moving averages.
+constexpr double kSmoothing = 0.1;
+// Number of samples of each kind before the desired value is trusted.
+constexpr int64_t kMinSamples = 8;
+
+void UpdateAverage(double sample, int64_t num_samples, double* average) {
+  *average =
+      num_samples == 0 ? sample : *average + kSmoothing * (sample - *average);
+}
+
+}  // namespace
+
+//===----------------------------------------------------------------------===//
+// TunableParameter methods
+//===----------------------------------------------------------------------===//
+void TunableParameter::RecordConsumed() {
+  const auto now = Clock::now();
+  mutex_lock lock(mu_);
+  if (num_consumed_ > 0) {
+    const std::chrono::duration<double, std::nano> interval =
+        now - last_consumed_;
+    UpdateAverage(interval.count(), num_consumed_ - 1, &interval_ns_);
+  }
+  last_consumed_ = now;
+  ++num_consumed_;
+}
+
+void TunableParameter::RecordProduced(Clock::time_point start, size_t bytes) {
+  const std::chrono::duration<double, std::nano> latency =
+      Clock::now() - start;
+  mutex_lock lock(mu_);
+  UpdateAverage(latency.count(), num_produced_, &latency_ns_);
+  UpdateAverage(bytes, num_produced_, &bytes_);
+  ++num_produced_;
+}
+
+int64_t TunableParameter::GetDesiredValue() const {
+  mutex_lock lock(mu_);
+  if (num_consumed_ <= kMinSamples || num_produced_ < kMinSamples)
+    return value();
+  // Elements needed in flight to hide the latency, plus one that is being
+  // consumed.
+  const double in_flight = latency_ns_ / std::max(interval_ns_, 1.0);
+  const int64_t desired = static_cast<int64_t>(std::ceil(in_flight)) + 1;
+  return std::min(std::max(desired, min_value_), max_value_);
+}
+
+double TunableParameter::GetBytesPerElement() const {
+  mutex_lock lock(mu_);
+  return bytes_;
+}
+
+//===----------------------------------------------------------------------===//
+// Autotuner methods
+//===----------------------------------------------------------------------===//
+std::shared_ptr<TunableParameter> Autotuner::Register(
+    TunableParameter::Kind kind, int64_t initial_value, int64_t max_value) {
+  auto parameter = std::make_shared<TunableParameter>(
+      kind, initial_value, /*min_value=*/1, max_value, /*is_tuned=*/true);
+  mutex_lock lock(mu_);
+  parameters_.push_back(parameter);
+  return parameter;
+}
+
+void Autotuner::Tune() {
+  mutex_lock lock(mu_);
+
+  // Drop the parameters of destroyed iterators.
+  std::vector<std::shared_ptr<TunableParameter>> parameters;
+  auto it = std::remove_if(
+      parameters_.begin(), parameters_.end(),
+      [](const std::weak_ptr<TunableParameter>& p) { return p.expired(); });
+  parameters_.erase(it, parameters_.end());
+  for (auto& weak : parameters_) {
+    if (auto parameter = weak.lock())
+      parameters.push_back(std::move(parameter));
+  }
+
+  std::vector<int64_t> desired;
+  desired.reserve(parameters.size());
+  double total_parallelism = 0, total_bytes = 0;
+  for (auto& parameter : parameters) {
+    desired.push_back(parameter->GetDesiredValue());
+    if (parameter->kind() == TunableParameter::Kind::kParallelism) {
+      total_parallelism += desired.back();
+    } else {
+      total_bytes += desired.back() * parameter->GetBytesPerElement();
+    }
+  }
+
+  // Scale the values down proportionally to fit into the budgets.
+  const double parallelism_scale =
+      std::min(1.0, options_.cpu_budget / std::max(total_parallelism, 1.0));
+  const double bytes_scale =
+      std::min(1.0, options_.ram_budget_bytes / std::max(total_bytes, 1.0));
+  for (size_t i = 0; i < parameters.size(); ++i) {
+    TunableParameter& parameter = *parameters[i];
+    const double scale =
+        parameter.kind() == TunableParameter::Kind::kParallelism
+            ? parallelism_scale
+            : bytes_scale;
+    const auto value = static_cast<int64_t>(desired[i] * scale);
+    parameter.set_value(std::max(value, parameter.min_value()));
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Helper functions
+//===----------------------------------------------------------------------===//
+std::shared_ptr<TunableParameter> MakeTunableParameter(
+    int64_t value, const IteratorContext& context, TunableParameter::Kind kind,
+    int64_t default_value, int64_t max_value) {
+  if (value == kAutotune && context.autotuner) {
+    return context.autotuner->Register(
+        kind, std::max<int64_t>(std::min(default_value, max_value), 1),
+        max_value);
+  }
+  if (value == kAutotune) value = default_value;
+  return std::make_shared<TunableParameter>(kind, value, value, value,
+                                            /*is_tuned=*/false);
+}
+
+void RecordWhenAvailable(const IterationResult& result,
+                         std::shared_ptr<TunableParameter> parameter) {
+  RunWhenReady(result.AsyncValues(),
+               [result = result.CopyRef(), parameter = std::move(parameter),
+                start = TunableParameter::Clock::now()]() {
+                 parameter->RecordProduced(start, EstimateBytes(result));
+               });
+}
+
+}  // namespace data
+}  // namespace tfrt
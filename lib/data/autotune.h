@@ -0,0 +1,186 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the Autotuner, which adjusts the buffer sizes and the
+// parallelism of the iterators in an input pipeline at runtime.
+
+#ifndef TFRT_LIB_DATA_AUTOTUNE_H_
+#define TFRT_LIB_DATA_AUTOTUNE_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "tfrt/data/dataset.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace data {
+
+// Value of a buffer size or parallelism argument that asks the Autotuner to
+// choose it.
+constexpr int64_t kAutotune = -1;
+
+// Upper bound of tuned buffer sizes, for elements whose size is unknown to the
+// memory budget.
+constexpr int64_t kMaxAutotuneBufferSize = 256;
+
+// A buffer size or parallelism of an iterator that the Autotuner adjusts.
+//
+// The iterator reports when its consumer requests an element and when a
+// requested element becomes available. From these timestamps, the parameter
+// models the rate at which elements are consumed and the latency to produce
+// one. By Little's law, keeping latency / interval elements in flight hides
+// the latency of producing them.
+class TunableParameter {
+ public:
+  enum class Kind {
+    // Number of concurrent function invocations. Limited by the CPU budget.
+    kParallelism,
+    // Number of elements buffered ahead of the consumer. Limited by the memory
+    // budget.
+    kBufferSize,
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  TunableParameter(Kind kind, int64_t initial_value, int64_t min_value,
+                   int64_t max_value, bool is_tuned)
+      : kind_(kind),
+        min_value_(min_value),
+        max_value_(max_value),
+        is_tuned_(is_tuned),
+        value_(initial_value) {
+    assert(min_value <= initial_value && initial_value <= max_value);
+  }
+
+  Kind kind() const { return kind_; }
+  // Whether an Autotuner adjusts the value. Iterators only need to record
+  // their timestamps for tuned parameters.
+  bool is_tuned() const { return is_tuned_; }
+  int64_t min_value() const { return min_value_; }
+  int64_t max_value() const { return max_value_; }
+
+  // Returns the current value of the parameter.
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+  void set_value(int64_t value) {
+    value_.store(value, std::memory_order_relaxed);
+  }
+
+  // Records that the consumer requested an element.
+  void RecordConsumed() TFRT_EXCLUDES(mu_);
+
+  // Records that an element requested at `start` became available. `bytes` is
+  // the estimated size of the element.
+  void RecordProduced(Clock::time_point start, size_t bytes)
+      TFRT_EXCLUDES(mu_);
+
+  // Returns the value that hides the production latency at the observed
+  // consumption rate, within [min_value, max_value]. Returns the current value
+  // until enough elements have been observed.
+  int64_t GetDesiredValue() const TFRT_EXCLUDES(mu_);
+
+  // Returns the average size of the produced elements.
+  double GetBytesPerElement() const TFRT_EXCLUDES(mu_);
+
+ private:
+  const Kind kind_;
+  const int64_t min_value_;
+  const int64_t max_value_;
+  const bool is_tuned_;
+  std::atomic<int64_t> value_;
+
+  mutable mutex mu_;
+  // Exponential moving averages of the time between two requests, the time
+  // to produce an element, and the size of an element.
+  double interval_ns_ TFRT_GUARDED_BY(mu_) = 0;
+  double latency_ns_ TFRT_GUARDED_BY(mu_) = 0;
+  double bytes_ TFRT_GUARDED_BY(mu_) = 0;
+  int64_t num_consumed_ TFRT_GUARDED_BY(mu_) = 0;
+  int64_t num_produced_ TFRT_GUARDED_BY(mu_) = 0;
+  Clock::time_point last_consumed_ TFRT_GUARDED_BY(mu_);
+};
+
+// The Autotuner of an input pipeline. It is shared by all iterators created
+// from the same tfrt_data.make_iterator, through the IteratorContext.
+//
+// Iterators register a TunableParameter for each argument set to kAutotune,
+// and call MaybeTune() from GetNext(). At most once per `tuning_period`, this
+// sets every parameter to its desired value. If the desired values exceed the
+// CPU budget (the total parallelism) or the memory budget (the total size of
+// the buffered elements), they are scaled down proportionally.
+class Autotuner {
+ public:
+  struct Options {
+    int64_t cpu_budget = 1;
+    int64_t ram_budget_bytes = int64_t{1} << 30;
+    std::chrono::nanoseconds tuning_period = std::chrono::milliseconds(10);
+  };
+
+  explicit Autotuner(const Options& options) : options_(options) {}
+
+  // Returns a new parameter tuned by this Autotuner while the caller keeps a
+  // reference to it.
+  std::shared_ptr<TunableParameter> Register(TunableParameter::Kind kind,
+                                             int64_t initial_value,
+                                             int64_t max_value)
+      TFRT_EXCLUDES(mu_);
+
+  // Tunes all parameters if the tuning period has elapsed since the last time.
+  void MaybeTune() {
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            TunableParameter::Clock::now().time_since_epoch())
+                            .count();
+    int64_t next_tuning = next_tuning_.load(std::memory_order_relaxed);
+    if (now < next_tuning) return;
+    // Only one of the threads that observe the elapsed period tunes.
+    if (!next_tuning_.compare_exchange_strong(
+            next_tuning, now + options_.tuning_period.count()))
+      return;
+    Tune();
+  }
+
+  // Sets all parameters to their desired value within the budgets.
+  void Tune() TFRT_EXCLUDES(mu_);
+
+ private:
+  const Options options_;
+  std::atomic<int64_t> next_tuning_{0};
+
+  mutex mu_;
+  std::vector<std::weak_ptr<TunableParameter>> parameters_ TFRT_GUARDED_BY(mu_);
+};
+
+// Returns the parameter for an iterator argument set to `value`. If `value` is
+// kAutotune and `context` has an Autotuner, the parameter is tuned by it within
+// [1, max_value], starting at `default_value`. Otherwise it is fixed at
+// `value`, or at `default_value` for kAutotune.
+std::shared_ptr<TunableParameter> MakeTunableParameter(
+    int64_t value, const IteratorContext& context, TunableParameter::Kind kind,
+    int64_t default_value, int64_t max_value);
+
+// Records the latency and the size of `result` in `parameter` when it becomes
+// available.
+void RecordWhenAvailable(const IterationResult& result,
+                         std::shared_ptr<TunableParameter> parameter);
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_AUTOTUNE_H_
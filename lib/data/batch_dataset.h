@@ -370,7 +370,10 @@ class BatchDataset : public Dataset {
   BatchDataset(const BatchDataset&) = delete;
   BatchDataset& operator=(const BatchDataset&) = delete;
 
-  RCReference<Iterator> MakeIterator(const IteratorContext& context) override;
+  string_view name() const override { return "batch"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
 
  private:
   // Allow iterator to rely on private data members of this dataset.
@@ -420,7 +423,7 @@ class BatchDatasetIterator : public Iterator {
 };
 
 template <typename... T>
-RCReference<Iterator> BatchDataset<T...>::MakeIterator(
+RCReference<Iterator> BatchDataset<T...>::MakeIteratorImpl(
     const IteratorContext& context) {
   return TakeRef(
       host_->Construct<BatchDatasetIterator<T...>>(FormRef(this), context));
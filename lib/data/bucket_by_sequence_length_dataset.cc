@@ -0,0 +1,200 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements BucketBySequenceLengthDataset class which wraps around
+// another Dataset instance and batches together elements of similar lengths.
+
+#include "bucket_by_sequence_length_dataset.h"
+
+#include <algorithm>
+
+#include "padded_batch_dataset.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace data {
+
+//===----------------------------------------------------------------------===//
+// BucketBySequenceLengthDataset methods
+//===----------------------------------------------------------------------===//
+RCReference<Iterator> BucketBySequenceLengthDataset::MakeIteratorImpl(
+    const IteratorContext& context) {
+  return TakeRef(host_->Construct<BucketBySequenceLengthDatasetIterator>(
+      FormRef(this), context));
+}
+
+//===----------------------------------------------------------------------===//
+// BucketBySequenceLengthDatasetIterator methods
+//===----------------------------------------------------------------------===//
+IterationResult BucketBySequenceLengthDatasetIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  auto* host = exec_ctx.host();
+
+  SmallVector<RCReference<AsyncValue>, 4> result_values;
+  {
+    mutex_lock lock(mu_);
+    // The outputs are created before the inputs that fill them are available,
+    // so the arity is taken from the first input. No thread owns the token
+    // before the first output is added, so this does not race with it.
+    if (arity_ < 0) {
+      first_input_.emplace(input_iterator_->GetNext(exec_ctx));
+      arity_ = first_input_->values.size();
+    }
+    for (int64_t i = 0; i < arity_; ++i)
+      result_values.push_back(MakeIndirectAsyncValue(host));
+  }
+  auto result = IterationResult::Pending(
+      std::move(result_values), MakeUnconstructedAsyncValueRef<bool>(host));
+  {
+    mutex_lock lock(mu_);
+    output_buffer_.push(result.CopyRef());
+  }
+  MaybeScheduleBackgroundTask(exec_ctx, false);
+  return result;
+}
+
+void BucketBySequenceLengthDatasetIterator::MaybeScheduleBackgroundTask(
+    const ExecutionContext& exec_ctx, bool is_token_owner) {
+  auto* host = exec_ctx.host();
+  while (true) {
+    SmallVector<std::pair<IterationResult, IterationResult>, 4> outputs;
+    llvm::Optional<IterationResult> input;
+    bool token_released = false;
+    {
+      mutex_lock lock(mu_);
+      if (!is_token_owner) {
+        // Return since the token is already owned by another thread.
+        if (token_owned_) return;
+        token_owned_ = is_token_owner = true;
+      }
+      while (!output_buffer_.empty() &&
+             (!ready_.empty() || input_exhausted_)) {
+        if (ready_.empty()) {
+          outputs.emplace_back(std::move(output_buffer_.front()),
+                               IterationResult::Eof(host, arity_));
+        } else {
+          outputs.emplace_back(std::move(output_buffer_.front()),
+                               std::move(ready_.front()));
+          ready_.pop();
+        }
+        output_buffer_.pop();
+      }
+      if (output_buffer_.empty()) {
+        // There is no more output value to fill. Release the token.
+        token_owned_ = false;
+        token_released = true;
+      } else if (first_input_.hasValue()) {
+        input = std::move(first_input_);
+        first_input_.reset();
+      }
+    }
+
+    // Fill the outputs outside of the lock, since this may run the callbacks
+    // of the caller.
+    for (auto& output : outputs) {
+      auto& batch = output.second;
+      for (size_t i = 0; i < output.first.values.size(); ++i) {
+        cast<IndirectAsyncValue>(output.first.values[i].get())
+            ->ForwardTo(std::move(batch.values[i]));
+      }
+      if (batch.eof.IsError()) {
+        output.first.eof.SetError(batch.eof.GetError());
+      } else {
+        output.first.eof.emplace(batch.eof.get());
+      }
+    }
+    if (token_released) return;
+
+    // The pending outputs need more batches, so add the next input to its
+    // bucket. Available inputs are added in this loop to avoid recursion.
+    if (!input.hasValue()) input.emplace(input_iterator_->GetNext(exec_ctx));
+    auto async_values = input->AsyncValues();
+    if (std::all_of(async_values.begin(), async_values.end(),
+                    [](AsyncValue* value) { return value->IsAvailable(); })) {
+      AddInput(std::move(*input), host);
+      continue;
+    }
+    RunWhenReady(async_values, [exec_ctx, host, input = std::move(*input),
+                                iterator = FormRef(this)]() mutable {
+      iterator->AddInput(std::move(input), host);
+      RunInlineOrEnqueue(exec_ctx, [exec_ctx, iterator = std::move(iterator)] {
+        iterator->MaybeScheduleBackgroundTask(exec_ctx, true);
+      });
+    });
+    return;
+  }
+}
+
+void BucketBySequenceLengthDatasetIterator::AddInput(IterationResult input,
+                                                     HostContext* host) {
+  const size_t arity = input.values.size();
+  if (input.eof.IsError()) {
+    ready_.push(IterationResult::Error(input.eof.CopyRCRef(), arity));
+    return;
+  }
+  if (input.eof.get()) {
+    // Output the buckets that are not full, in the order of their lengths.
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+      if (!buckets_[i].empty()) AddBatch(i, host);
+    }
+    input_exhausted_ = true;
+    return;
+  }
+  for (auto& value : input.values) {
+    if (value->IsError()) {
+      ready_.push(IterationResult::Error(value.CopyRef(), arity));
+      return;
+    }
+  }
+  if (arity == 0 || !input.values[0]->IsType<DenseHostTensor>() ||
+      input.values[0]->get<DenseHostTensor>().shape().GetRank() == 0) {
+    auto error = MakeErrorAsyncValueRef(
+        host,
+        "bucket_by_sequence_length expects a first component with a sequence "
+        "dimension");
+    ready_.push(IterationResult::Error(std::move(error), arity));
+    return;
+  }
+
+  const int64_t length =
+      input.values[0]->get<DenseHostTensor>().shape().GetDimensionSize(0);
+  const auto& boundaries = parent_dataset_->bucket_boundaries_;
+  const size_t index =
+      std::upper_bound(boundaries.begin(), boundaries.end(), length) -
+      boundaries.begin();
+  buckets_[index].push_back(std::move(input.values));
+  if (buckets_[index].size() >= parent_dataset_->bucket_batch_sizes_[index])
+    AddBatch(index, host);
+}
+
+void BucketBySequenceLengthDatasetIterator::AddBatch(size_t index,
+                                                     HostContext* host) {
+  auto& bucket = buckets_[index];
+  const size_t arity = bucket.front().size();
+  auto batch = PadAndBatch(bucket, parent_dataset_->padding_value_, host);
+  bucket.clear();
+  if (!batch) {
+    auto error = MakeErrorAsyncValueRef(host, StrCat(batch.takeError()));
+    ready_.push(IterationResult::Error(std::move(error), arity));
+    return;
+  }
+  ready_.push(IterationResult::Values(std::move(*batch), host));
+}
+
+}  // namespace data
+}  // namespace tfrt
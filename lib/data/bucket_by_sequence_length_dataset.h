@@ -0,0 +1,156 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares BucketBySequenceLengthDataset class which wraps around
+// another Dataset instance and batches together elements of similar lengths.
+
+#ifndef TFRT_LIB_DATA_BUCKET_BY_SEQUENCE_LENGTH_DATASET_H_
+#define TFRT_LIB_DATA_BUCKET_BY_SEQUENCE_LENGTH_DATASET_H_
+
+#include <queue>
+#include <vector>
+
+#include "tfrt/data/dataset.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace data {
+
+class BucketBySequenceLengthDatasetIterator;
+
+// BucketBySequenceLengthDataset groups the DenseHostTensor elements of the
+// underlying dataset into buckets by the size of the first dimension of their
+// first component, and outputs a batch padded like PaddedBatchDataset whenever
+// a bucket is full. Since a batch only holds sequences of similar lengths, it
+// needs little padding.
+//
+// An element of length `n` goes to bucket `i` such that
+// bucket_boundaries[i - 1] <= n < bucket_boundaries[i], so there is one more
+// bucket than boundaries. Bucket `i` is full when it has bucket_batch_sizes[i]
+// elements. The buckets that are not full are output when the underlying
+// dataset runs out. The order of the output elements is the order in which
+// their buckets become full.
+class BucketBySequenceLengthDataset : public Dataset {
+ public:
+  explicit BucketBySequenceLengthDataset(
+      RCReference<Dataset> input_dataset,
+      std::vector<int64_t> bucket_boundaries,
+      std::vector<int64_t> bucket_batch_sizes, double padding_value,
+      HostContext* host)
+      : input_dataset_(std::move(input_dataset)),
+        bucket_boundaries_(std::move(bucket_boundaries)),
+        bucket_batch_sizes_(std::move(bucket_batch_sizes)),
+        padding_value_(padding_value),
+        host_(host),
+        allocator_(host->allocator()) {
+    assert(bucket_batch_sizes_.size() == bucket_boundaries_.size() + 1);
+  }
+
+  // This class is not copyable or movable.
+  BucketBySequenceLengthDataset(const BucketBySequenceLengthDataset&) = delete;
+  BucketBySequenceLengthDataset& operator=(
+      const BucketBySequenceLengthDataset&) = delete;
+
+  string_view name() const override { return "bucket_by_sequence_length"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
+
+ private:
+  // Allow iterator to rely on private data members of this dataset.
+  friend class BucketBySequenceLengthDatasetIterator;
+
+  void Destroy() override {
+    internal::DestroyImpl<BucketBySequenceLengthDataset>(this, allocator_);
+  }
+
+  RCReference<Dataset> input_dataset_;
+  const std::vector<int64_t> bucket_boundaries_;
+  const std::vector<int64_t> bucket_batch_sizes_;
+  const double padding_value_;
+  HostContext* host_;
+  HostAllocator* allocator_;
+};
+
+class BucketBySequenceLengthDatasetIterator : public Iterator {
+ public:
+  explicit BucketBySequenceLengthDatasetIterator(
+      RCReference<BucketBySequenceLengthDataset> parent_dataset,
+      const IteratorContext& context)
+      : Iterator(),
+        parent_dataset_(std::move(parent_dataset)),
+        input_iterator_(parent_dataset_->input_dataset_->MakeIterator(context)),
+        buckets_(parent_dataset_->bucket_batch_sizes_.size()) {}
+
+  // This class is not copyable or movable.
+  BucketBySequenceLengthDatasetIterator(
+      const BucketBySequenceLengthDatasetIterator&) = delete;
+  BucketBySequenceLengthDatasetIterator& operator=(
+      const BucketBySequenceLengthDatasetIterator&) = delete;
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  using Element = SmallVector<RCReference<AsyncValue>, 4>;
+
+  void Destroy() override {
+    internal::DestroyImpl<BucketBySequenceLengthDatasetIterator>(
+        this, parent_dataset_->allocator_);
+  }
+
+  // Fills the pending outputs with the ready batches, and fetches inputs until
+  // all outputs are filled. Like FilterDatasetIterator, only the thread that
+  // holds the token runs this, which keeps the outputs in order. If an input
+  // is not available, the token is passed to the callback that runs when it
+  // becomes available.
+  void MaybeScheduleBackgroundTask(const ExecutionContext& exec_ctx,
+                                   bool is_token_owner)
+      TFRT_EXCLUDES(mu_);
+
+  // Adds the available `input` to its bucket, and adds a batch to `ready_` if
+  // that fills the bucket. Adds the rest of the buckets once the underlying
+  // dataset runs out.
+  void AddInput(IterationResult input, HostContext* host);
+
+  // Adds a padded batch of the elements in bucket `index` to `ready_`.
+  void AddBatch(size_t index, HostContext* host);
+
+  RCReference<BucketBySequenceLengthDataset> parent_dataset_;
+  RCReference<Iterator> input_iterator_;
+
+  mutex mu_;
+  // The results returned by GetNext(...) that are not filled yet.
+  std::queue<IterationResult> output_buffer_ TFRT_GUARDED_BY(mu_);
+  // The number of components of an element, known from the first input.
+  int64_t arity_ TFRT_GUARDED_BY(mu_) = -1;
+  // The first input, fetched by GetNext(...) to learn the arity.
+  llvm::Optional<IterationResult> first_input_ TFRT_GUARDED_BY(mu_);
+  // See FilterDatasetIterator::token_owned_.
+  bool token_owned_ TFRT_GUARDED_BY(mu_) = false;
+
+  // The members below are only accessed by the token owner.
+  std::vector<SmallVector<Element, 4>> buckets_;
+  // The available batches to output, in order.
+  std::queue<IterationResult> ready_;
+  bool input_exhausted_ = false;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_BUCKET_BY_SEQUENCE_LENGTH_DATASET_H_
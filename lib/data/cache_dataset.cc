@@ -0,0 +1,574 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the CacheDataset class.
+
+#include "cache_dataset.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/packed_string_host_tensor.h"
+#include "tfrt/tensor/tensor_serialize_utils.h"
+
+namespace tfrt {
+namespace data {
+
+// A cache file starts with kFileMagic and the number of values per element,
+// followed by the elements. An element is the number of its values, and for
+// each value its kind, the number of its buffers and for each buffer its size
+// and its bytes. The bytes are aligned to kFileAlignment in the file, so that
+// the mapped tensors are aligned. All integers are little endian uint64.
+static constexpr char kFileMagic[] = "TFRTCACH";
+static constexpr size_t kFileHeaderSize = 2 * sizeof(uint64_t);
+static constexpr size_t kFileAlignment = 64;
+
+static RCReference<HostBuffer> CopyToHostBuffer(string_view bytes,
+                                                size_t alignment,
+                                                HostAllocator* allocator) {
+  auto buffer =
+      HostBuffer::CreateUninitialized(bytes.size(), alignment, allocator);
+  if (buffer && !bytes.empty())
+    std::memcpy(buffer->data(), bytes.data(), bytes.size());
+  return buffer;
+}
+
+// Returns the size of the data of a dense tensor with metadata `metadata`.
+static size_t GetDataSize(const TensorMetadata& metadata) {
+  return metadata.shape.GetNumElements() * metadata.dtype.GetHostSize();
+}
+
+//===----------------------------------------------------------------------===//
+// CachedComponent serialization
+//===----------------------------------------------------------------------===//
+
+llvm::Expected<CachedComponent> SerializeCachedComponent(
+    const AsyncValue& value, HostContext* host) {
+  using Kind = CachedComponent::Kind;
+  HostAllocator* allocator = host->allocator();
+  CachedComponent result;
+
+  if (value.IsType<DenseHostTensor>()) {
+    const auto& tensor = value.get<DenseHostTensor>();
+    auto buffers = SerializeDenseHostTensor(tensor, host);
+    if (!buffers) return buffers.takeError();
+    // Only the data of the tensor is cached, not the rest of its buffer.
+    auto data = std::move((*buffers)[1]);
+    const size_t data_size = GetDataSize(tensor.metadata());
+    if (data->size() > data_size)
+      data = HostBuffer::CreateFromExternal(std::move(data), /*offset=*/0,
+                                            data_size);
+    result.kind = Kind::kDenseHostTensor;
+    result.buffers.push_back(std::move((*buffers)[0]));
+    result.buffers.push_back(std::move(data));
+    return std::move(result);
+  }
+
+  if (value.IsType<PackedStringHostTensor>()) {
+    const auto& tensor = value.get<PackedStringHostTensor>();
+    auto metadata = CopyToHostBuffer(SerializeTensorMetadata(tensor.metadata()),
+                                     alignof(uint64_t), allocator);
+    // The strings may be a range of a larger buffer, e.g. the records of a
+    // TFRecord block, so the offsets are rebased to the start of the range.
+    auto offsets = tensor.offsets();
+    auto rebased = HostBuffer::CreateUninitialized(
+        offsets.size() * sizeof(int64_t), alignof(int64_t), allocator);
+    if (!metadata || !rebased)
+      return MakeStringError("out of memory caching a string tensor");
+    auto* rebased_data = static_cast<int64_t*>(rebased->data());
+    for (size_t i = 0; i < offsets.size(); ++i)
+      rebased_data[i] = offsets[i] - offsets.front();
+    const size_t bytes_offset =
+        tensor.bytes() -
+        static_cast<const char*>(tensor.bytes_buffer()->data()) +
+        offsets.front();
+    result.kind = Kind::kPackedStringHostTensor;
+    result.buffers.push_back(std::move(metadata));
+    result.buffers.push_back(std::move(rebased));
+    result.buffers.push_back(HostBuffer::CreateFromExternal(
+        tensor.bytes_buffer().CopyRef(), bytes_offset,
+        offsets.back() - offsets.front()));
+    return std::move(result);
+  }
+
+  string_view bytes;
+  if (value.IsType<std::string>()) {
+    result.kind = Kind::kString;
+    bytes = value.get<std::string>();
+  } else if (value.IsType<int32_t>()) {
+    result.kind = Kind::kInt32;
+    bytes = string_view(reinterpret_cast<const char*>(&value.get<int32_t>()),
+                        sizeof(int32_t));
+  } else if (value.IsType<int64_t>()) {
+    result.kind = Kind::kInt64;
+    bytes = string_view(reinterpret_cast<const char*>(&value.get<int64_t>()),
+                        sizeof(int64_t));
+  } else {
+    return MakeStringError("cache_dataset can't cache a value of this type");
+  }
+  auto buffer = CopyToHostBuffer(bytes, alignof(int64_t), allocator);
+  if (!buffer) return MakeStringError("out of memory caching a value");
+  result.buffers.push_back(std::move(buffer));
+  return std::move(result);
+}
+
+static llvm::Expected<RCReference<AsyncValue>> DeserializeCachedComponentImpl(
+    const CachedComponent& component, HostContext* host) {
+  using Kind = CachedComponent::Kind;
+  const auto& buffers = component.buffers;
+  auto has_buffer_sizes = [&](std::initializer_list<size_t> min_sizes) {
+    if (buffers.size() != min_sizes.size()) return false;
+    size_t i = 0;
+    for (size_t min_size : min_sizes)
+      if (buffers[i++]->size() < min_size) return false;
+    return true;
+  };
+  auto get_metadata = [&]() {
+    return DeserializeTensorMetadata(string_view(
+        static_cast<const char*>(buffers[0]->data()), buffers[0]->size()));
+  };
+
+  switch (component.kind) {
+    case Kind::kDenseHostTensor: {
+      if (!has_buffer_sizes({sizeof(uint64_t), 0}))
+        return MakeStringError("invalid cached tensor");
+      auto metadata = get_metadata();
+      if (!metadata) return metadata.takeError();
+      if (buffers[1]->size() < GetDataSize(*metadata))
+        return MakeStringError("invalid cached tensor");
+      llvm::SmallVector<RCReference<HostBuffer>, 4> serialized;
+      serialized.push_back(buffers[0].CopyRef());
+      serialized.push_back(buffers[1].CopyRef());
+      auto tensor = DeserializeDenseHostTensor(serialized, host);
+      if (!tensor) return tensor.takeError();
+      return RCReference<AsyncValue>(
+          MakeAvailableAsyncValueRef<DenseHostTensor>(host,
+                                                      std::move(*tensor)));
+    }
+    case Kind::kPackedStringHostTensor: {
+      if (!has_buffer_sizes({sizeof(uint64_t), sizeof(int64_t), 0}))
+        return MakeStringError("invalid cached string tensor");
+      auto metadata = get_metadata();
+      if (!metadata) return metadata.takeError();
+      const size_t num_elements = metadata->shape.GetNumElements();
+      const auto* offsets = static_cast<const int64_t*>(buffers[1]->data());
+      if (buffers[1]->size() < (num_elements + 1) * sizeof(int64_t) ||
+          offsets[num_elements] > buffers[2]->size())
+        return MakeStringError("invalid cached string tensor");
+      return RCReference<AsyncValue>(
+          MakeAvailableAsyncValueRef<PackedStringHostTensor>(
+              host, metadata->shape, buffers[1].CopyRef(),
+              buffers[2].CopyRef()));
+    }
+    case Kind::kString:
+      if (!has_buffer_sizes({0}))
+        return MakeStringError("invalid cached string");
+      return RCReference<AsyncValue>(MakeAvailableAsyncValueRef<std::string>(
+          host, static_cast<const char*>(buffers[0]->data()),
+          buffers[0]->size()));
+    case Kind::kInt32: {
+      int32_t value;
+      if (!has_buffer_sizes({sizeof(value)}))
+        return MakeStringError("invalid cached int32");
+      std::memcpy(&value, buffers[0]->data(), sizeof(value));
+      return RCReference<AsyncValue>(
+          MakeAvailableAsyncValueRef<int32_t>(host, value));
+    }
+    case Kind::kInt64: {
+      int64_t value;
+      if (!has_buffer_sizes({sizeof(value)}))
+        return MakeStringError("invalid cached int64");
+      std::memcpy(&value, buffers[0]->data(), sizeof(value));
+      return RCReference<AsyncValue>(
+          MakeAvailableAsyncValueRef<int64_t>(host, value));
+    }
+  }
+  return MakeStringError("invalid cached value kind");
+}
+
+RCReference<AsyncValue> DeserializeCachedComponent(
+    const CachedComponent& component, HostContext* host) {
+  auto value = DeserializeCachedComponentImpl(component, host);
+  if (!value) return MakeErrorAsyncValueRef(host, StrCat(value.takeError()));
+  return std::move(*value);
+}
+
+//===----------------------------------------------------------------------===//
+// CacheDatasetWriterIterator
+//===----------------------------------------------------------------------===//
+
+// Returns the elements of the input, and caches them in the order of GetNext()
+// once they are available.
+class CacheDatasetWriterIterator : public Iterator {
+ public:
+  explicit CacheDatasetWriterIterator(RCReference<CacheDataset> dataset,
+                                      const IteratorContext& context)
+      : Iterator(),
+        parent_dataset_(std::move(dataset)),
+        input_iterator_(parent_dataset_->input_dataset_->MakeIterator(context)),
+        last_append_(
+            MakeAvailableAsyncValueRef<Chain>(parent_dataset_->host_)) {}
+
+  ~CacheDatasetWriterIterator() override {
+    // The input was not fully read, so the cache is incomplete. Appends hold a
+    // reference to this iterator, so none is pending.
+    if (!done_) Finish(CacheDataset::State::kEmpty);
+  }
+
+  // This class is not copyable or movable.
+  CacheDatasetWriterIterator(const CacheDatasetWriterIterator&) = delete;
+  CacheDatasetWriterIterator& operator=(const CacheDatasetWriterIterator&) =
+      delete;
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  void Destroy() override {
+    internal::DestroyImpl<CacheDatasetWriterIterator>(
+        this, parent_dataset_->allocator_);
+  }
+
+  // Caches `input`. Appends run one at a time, in the order of GetNext().
+  void Append(const IterationResult& input);
+
+  // Stops caching, and publishes the cache if `state` is kComplete.
+  void Finish(CacheDataset::State state);
+
+  llvm::Error OpenFile();
+  llvm::Error WriteElement(const CachedElement& element);
+
+  RCReference<CacheDataset> parent_dataset_;
+  RCReference<Iterator> input_iterator_;
+
+  mutex mu_;
+  // Available once the last element returned by GetNext() is cached.
+  AsyncValueRef<Chain> last_append_ TFRT_GUARDED_BY(mu_);
+
+  // Set by Append() when the cache is complete or dropped.
+  std::atomic<bool> done_{false};
+
+  // The fields below are only accessed by Append() and Finish().
+  size_t num_components_ = 0;
+  std::vector<CachedElement> elements_;
+  std::unique_ptr<llvm::raw_fd_ostream> file_;
+  llvm::SmallString<128> temp_path_;
+};
+
+IterationResult CacheDatasetWriterIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  if (done_.load(std::memory_order_acquire))
+    return input_iterator_->GetNext(exec_ctx);
+
+  mutex_lock lock(mu_);
+  auto input = input_iterator_->GetNext(exec_ctx);
+  llvm::SmallVector<AsyncValue*, 4> dependencies;
+  dependencies.push_back(input.eof.GetAsyncValue());
+  for (auto& value : input.values) dependencies.push_back(value.get());
+  dependencies.push_back(last_append_.GetAsyncValue());
+
+  auto appended = MakeUnconstructedAsyncValueRef<Chain>(exec_ctx.host());
+  RunWhenReady(dependencies, [iterator = FormRef(this), input = input.CopyRef(),
+                              appended = appended.CopyRef()]() {
+    iterator->Append(input);
+    appended.emplace();
+  });
+  last_append_ = std::move(appended);
+  return input;
+}
+
+void CacheDatasetWriterIterator::Append(const IterationResult& input) {
+  using State = CacheDataset::State;
+  if (done_.load(std::memory_order_relaxed)) return;
+  if (input.eof.IsError()) return Finish(State::kEmpty);
+
+  num_components_ = input.values.size();
+  if (!parent_dataset_->filename_.empty() && !file_) {
+    if (auto error = OpenFile()) {
+      llvm::consumeError(std::move(error));
+      return Finish(State::kDisabled);
+    }
+  }
+  if (input.eof.get()) return Finish(State::kComplete);
+
+  CachedElement element;
+  for (auto& value : input.values) {
+    if (value->IsError()) return Finish(State::kEmpty);
+    auto component = SerializeCachedComponent(*value, parent_dataset_->host_);
+    if (!component) {
+      llvm::consumeError(component.takeError());
+      return Finish(State::kDisabled);
+    }
+    element.push_back(std::move(*component));
+  }
+
+  if (!file_) {
+    elements_.push_back(std::move(element));
+  } else if (auto error = WriteElement(element)) {
+    llvm::consumeError(std::move(error));
+    Finish(State::kDisabled);
+  }
+}
+
+void CacheDatasetWriterIterator::Finish(CacheDataset::State state) {
+  using State = CacheDataset::State;
+  done_.store(true, std::memory_order_release);
+  if (file_) {
+    file_->close();
+    if (file_->has_error()) {
+      file_->clear_error();
+      if (state == State::kComplete) state = State::kDisabled;
+    }
+    file_.reset();
+    if (state != State::kComplete ||
+        llvm::sys::fs::rename(temp_path_, parent_dataset_->filename_)) {
+      llvm::sys::fs::remove(temp_path_);
+      if (state == State::kComplete) state = State::kDisabled;
+    }
+  }
+  parent_dataset_->FinishWriting(state, std::move(elements_), num_components_);
+}
+
+llvm::Error CacheDatasetWriterIterator::OpenFile() {
+  // The cache is written to a temporary file, which is renamed once complete,
+  // so that an incomplete cache is never read.
+  int fd;
+  if (auto ec = llvm::sys::fs::createUniqueFile(
+          parent_dataset_->filename_ + ".tmp-%%%%%%%%", fd, temp_path_))
+    return MakeStringError("failed to create cache file: ", ec.message());
+  file_ = std::make_unique<llvm::raw_fd_ostream>(fd, /*shouldClose=*/true);
+
+  uint64_t num_components = num_components_;
+  file_->write(kFileMagic, sizeof(uint64_t));
+  file_->write(reinterpret_cast<const char*>(&num_components),
+               sizeof(num_components));
+  if (file_->has_error()) return MakeStringError("failed to write cache file");
+  return llvm::Error::success();
+}
+
+llvm::Error CacheDatasetWriterIterator::WriteElement(
+    const CachedElement& element) {
+  auto write_uint64 = [&](uint64_t value) {
+    file_->write(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  write_uint64(element.size());
+  for (const auto& component : element) {
+    write_uint64(static_cast<uint64_t>(component.kind));
+    write_uint64(component.buffers.size());
+    for (const auto& buffer : component.buffers) {
+      write_uint64(buffer->size());
+      const uint64_t offset = file_->tell();
+      file_->write_zeros(llvm::alignTo(offset, kFileAlignment) - offset);
+      file_->write(static_cast<const char*>(buffer->data()), buffer->size());
+    }
+  }
+  if (file_->has_error()) return MakeStringError("failed to write cache file");
+  return llvm::Error::success();
+}
+
+//===----------------------------------------------------------------------===//
+// CacheDatasetReaderIterator
+//===----------------------------------------------------------------------===//
+
+// Returns the elements of a complete cache.
+class CacheDatasetReaderIterator : public Iterator {
+ public:
+  // Reads `elements` if the cache is in memory, or `file` otherwise.
+  explicit CacheDatasetReaderIterator(
+      RCReference<CacheDataset> dataset,
+      const std::vector<CachedElement>* elements, RCReference<HostBuffer> file,
+      size_t num_components)
+      : Iterator(),
+        parent_dataset_(std::move(dataset)),
+        elements_(elements),
+        file_(std::move(file)),
+        num_components_(num_components) {}
+
+  // This class is not copyable or movable.
+  CacheDatasetReaderIterator(const CacheDatasetReaderIterator&) = delete;
+  CacheDatasetReaderIterator& operator=(const CacheDatasetReaderIterator&) =
+      delete;
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  void Destroy() override {
+    internal::DestroyImpl<CacheDatasetReaderIterator>(
+        this, parent_dataset_->allocator_);
+  }
+
+  // Parses the element at `file_position_`. The buffers of the element are
+  // slices of the mapped file.
+  llvm::Expected<CachedElement> ReadElement()
+      TFRT_REQUIRES(mu_);
+
+  RCReference<CacheDataset> parent_dataset_;
+  const std::vector<CachedElement>* elements_;
+  RCReference<HostBuffer> file_;
+  const size_t num_components_;
+
+  mutex mu_;
+  size_t next_index_ TFRT_GUARDED_BY(mu_) = 0;
+  size_t file_position_ TFRT_GUARDED_BY(mu_) = kFileHeaderSize;
+};
+
+IterationResult CacheDatasetReaderIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  llvm::SmallVector<RCReference<AsyncValue>, 4> values;
+  {
+    mutex_lock lock(mu_);
+    CachedElement read_element;
+    const CachedElement* element;
+    if (file_) {
+      if (file_position_ == file_->size())
+        return IterationResult::Eof(host, num_components_);
+      auto result = ReadElement();
+      if (!result) {
+        file_position_ = file_->size();
+        auto error = MakeErrorAsyncValueRef(
+            host, StrCat("failed to read cache file: ", result.takeError()));
+        return IterationResult::Error(std::move(error), num_components_);
+      }
+      read_element = std::move(*result);
+      element = &read_element;
+    } else {
+      if (next_index_ == elements_->size())
+        return IterationResult::Eof(host, num_components_);
+      element = &(*elements_)[next_index_++];
+    }
+    for (const auto& component : *element)
+      values.push_back(DeserializeCachedComponent(component, host));
+  }
+  return IterationResult::Values(std::move(values), host);
+}
+
+llvm::Expected<CachedElement> CacheDatasetReaderIterator::ReadElement() {
+  const char* data = static_cast<const char*>(file_->data());
+  const size_t size = file_->size();
+  auto read_uint64 = [&](uint64_t* value) {
+    if (size - file_position_ < sizeof(*value)) return false;
+    std::memcpy(value, data + file_position_, sizeof(*value));
+    file_position_ += sizeof(*value);
+    return true;
+  };
+
+  uint64_t num_components;
+  if (!read_uint64(&num_components) || num_components != num_components_)
+    return MakeStringError("invalid element at offset ", file_position_);
+  CachedElement element;
+  for (uint64_t i = 0; i < num_components; ++i) {
+    uint64_t kind, num_buffers;
+    if (!read_uint64(&kind) || !read_uint64(&num_buffers))
+      return MakeStringError("invalid element at offset ", file_position_);
+    CachedComponent component;
+    component.kind = static_cast<CachedComponent::Kind>(kind);
+    for (uint64_t j = 0; j < num_buffers; ++j) {
+      uint64_t buffer_size;
+      if (!read_uint64(&buffer_size))
+        return MakeStringError("invalid element at offset ", file_position_);
+      const size_t offset = llvm::alignTo(file_position_, kFileAlignment);
+      if (offset > size || size - offset < buffer_size)
+        return MakeStringError("invalid element at offset ", file_position_);
+      component.buffers.push_back(
+          HostBuffer::CreateFromExternal(file_.CopyRef(), offset, buffer_size));
+      file_position_ = offset + buffer_size;
+    }
+    element.push_back(std::move(component));
+  }
+  return std::move(element);
+}
+
+//===----------------------------------------------------------------------===//
+// CacheDataset
+//===----------------------------------------------------------------------===//
+
+RCReference<Iterator> CacheDataset::MakeIteratorImpl(
+    const IteratorContext& context) {
+  mutex_lock lock(mu_);
+  if (state_ == State::kEmpty && !filename_.empty() && MaybeOpenFile())
+    state_ = State::kComplete;
+
+  switch (state_) {
+    case State::kEmpty:
+      state_ = State::kWriting;
+      return TakeRef(host_->Construct<CacheDatasetWriterIterator>(
+          FormRef(this), context));
+    case State::kComplete:
+      return TakeRef(host_->Construct<CacheDatasetReaderIterator>(
+          FormRef(this), &elements_, file_.CopyRef(), num_components_));
+    case State::kWriting:
+    case State::kDisabled:
+      break;
+  }
+  return input_dataset_->MakeIterator(context);
+}
+
+bool CacheDataset::MaybeOpenFile() {
+  uint64_t size;
+  if (llvm::sys::fs::file_size(filename_, size) || size < kFileHeaderSize)
+    return false;
+  auto file = llvm::sys::fs::openNativeFileForRead(filename_);
+  if (!file) {
+    llvm::consumeError(file.takeError());
+    return false;
+  }
+  auto close_file =
+      llvm::make_scope_exit([&] { llvm::sys::fs::closeFile(*file); });
+
+  std::error_code ec;
+  auto region = std::make_unique<llvm::sys::fs::mapped_file_region>(
+      *file, llvm::sys::fs::mapped_file_region::readonly, size, /*offset=*/0,
+      ec);
+  if (ec) return false;
+  const char* data = region->const_data();
+  uint64_t num_components;
+  std::memcpy(&num_components, data + sizeof(uint64_t), sizeof(uint64_t));
+  if (std::memcmp(data, kFileMagic, sizeof(uint64_t)) != 0) return false;
+
+  num_components_ = num_components;
+  file_ = HostBuffer::CreateFromExternal(
+      const_cast<char*>(data), size,
+      [region = std::move(region)](void*, size_t) {});
+  return true;
+}
+
+void CacheDataset::FinishWriting(State state,
+                                 std::vector<CachedElement> elements,
+                                 size_t num_components) {
+  mutex_lock lock(mu_);
+  assert(state_ == State::kWriting);
+  state_ = state;
+  if (state != State::kComplete) return;
+  num_components_ = num_components;
+  if (filename_.empty()) {
+    elements_ = std::move(elements);
+  } else if (!MaybeOpenFile()) {
+    state_ = State::kEmpty;
+  }
+}
+
+}  // namespace data
+}  // namespace tfrt
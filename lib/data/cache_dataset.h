@@ -0,0 +1,137 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the CacheDataset class which caches the elements of
+// another dataset in memory or in a file, so that repeated epochs don't
+// recompute them.
+
+#ifndef TFRT_LIB_DATA_CACHE_DATASET_H_
+#define TFRT_LIB_DATA_CACHE_DATASET_H_
+
+#include <string>
+#include <vector>
+
+#include "tfrt/data/dataset.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace data {
+
+class CacheDatasetWriterIterator;
+class CacheDatasetReaderIterator;
+
+// A value of an element in its serialized form. The buffers depend on the
+// kind of the value:
+// - kDenseHostTensor: the tensor metadata and the tensor data, as returned by
+//   SerializeDenseHostTensor().
+// - kPackedStringHostTensor: the tensor metadata, the offsets and the bytes.
+// - kString, kInt32 and kInt64: the bytes of the value.
+struct CachedComponent {
+  enum class Kind : uint64_t {
+    kDenseHostTensor = 1,
+    kPackedStringHostTensor = 2,
+    kString = 3,
+    kInt32 = 4,
+    kInt64 = 5,
+  };
+
+  Kind kind;
+  std::vector<RCReference<HostBuffer>> buffers;
+};
+
+using CachedElement = std::vector<CachedComponent>;
+
+// Serializes an available value. The buffers of tensors are shared with the
+// value, not copied.
+llvm::Expected<CachedComponent> SerializeCachedComponent(
+    const AsyncValue& value, HostContext* host);
+
+// Returns an available value deserialized from `component`. The tensors share
+// the buffers of `component`.
+RCReference<AsyncValue> DeserializeCachedComponent(
+    const CachedComponent& component, HostContext* host);
+
+// CacheDataset caches the elements of the first full iteration of its input
+// dataset, and returns the cached elements in the iterations after it.
+//
+// If `filename` is empty, the cache is held in memory and shares the buffers of
+// the tensors. Otherwise the elements are written to `filename`, which is
+// memory mapped by the later iterations. A file cache is reused by datasets
+// created with the same `filename`, e.g. by later runs of the program.
+//
+// Only the first iterator writes the cache. It is dropped, and written again by
+// a later iterator, if that iterator is destroyed before the end of the input
+// or if the input returns an error. Iterators created while the cache is
+// written read the input directly. If an element has a type that can't be
+// serialized, the dataset stops caching and always reads the input.
+class CacheDataset : public Dataset {
+ public:
+  explicit CacheDataset(RCReference<Dataset> input_dataset,
+                        std::string filename, HostContext* host)
+      : input_dataset_(std::move(input_dataset)),
+        filename_(std::move(filename)),
+        host_(host),
+        allocator_(host->allocator()) {}
+
+  // This class is not copyable or movable.
+  CacheDataset(const CacheDataset&) = delete;
+  CacheDataset& operator=(const CacheDataset&) = delete;
+
+  string_view name() const override { return "cache"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
+
+ private:
+  friend class CacheDatasetWriterIterator;
+  friend class CacheDatasetReaderIterator;
+
+  enum class State { kEmpty, kWriting, kComplete, kDisabled };
+
+  void Destroy() override {
+    internal::DestroyImpl<CacheDataset>(this, allocator_);
+  }
+
+  // Memory maps the cache file if it exists. Returns true on success.
+  bool MaybeOpenFile() TFRT_REQUIRES(mu_);
+
+  // Called by the writer iterator when it is done. Sets the state to
+  // `state`, and publishes `elements` if the cache is in memory.
+  void FinishWriting(State state, std::vector<CachedElement> elements,
+                     size_t num_components);
+
+  RCReference<Dataset> input_dataset_;
+  const std::string filename_;
+  HostContext* host_;
+  HostAllocator* allocator_;
+
+  mutex mu_;
+  State state_ TFRT_GUARDED_BY(mu_) = State::kEmpty;
+  // The number of values per element.
+  size_t num_components_ TFRT_GUARDED_BY(mu_) = 0;
+  // The cached elements if the cache is in memory, immutable once complete.
+  std::vector<CachedElement> elements_ TFRT_GUARDED_BY(mu_);
+  // The mapped cache file if the cache is in a file.
+  RCReference<HostBuffer> file_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_CACHE_DATASET_H_
@@ -0,0 +1,341 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the CompactShuffleDataset class.
+
+#include "compact_shuffle_dataset.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/packed_string_host_tensor.h"
+
+namespace tfrt {
+namespace data {
+
+//===----------------------------------------------------------------------===//
+// CompactShuffleBuffer methods
+//===----------------------------------------------------------------------===//
+
+static constexpr size_t kChunkAlignment = 64;
+
+llvm::Error CompactShuffleBuffer::AddRecord(string_view bytes) {
+  auto chunk_index = GetChunk(bytes.size());
+  if (!chunk_index) return chunk_index.takeError();
+
+  Chunk& chunk = chunks_[*chunk_index];
+  std::memcpy(static_cast<char*>(chunk.buffer->data()) + chunk.used,
+              bytes.data(), bytes.size());
+  slots_.push_back(Slot{*chunk_index, chunk.used, bytes.size(), nullptr});
+  chunk.used += bytes.size();
+  chunk.live += bytes.size();
+  ++chunk.num_records;
+  live_bytes_ += bytes.size();
+  return llvm::Error::success();
+}
+
+void CompactShuffleBuffer::AddError(IterationResult error) {
+  slots_.push_back(
+      Slot{0, 0, 0, std::make_unique<IterationResult>(std::move(error))});
+}
+
+IterationResult CompactShuffleBuffer::Take(size_t index, HostContext* host) {
+  Slot slot = std::move(slots_[index]);
+  if (index + 1 != slots_.size()) slots_[index] = std::move(slots_.back());
+  slots_.pop_back();
+  if (slot.error) return std::move(*slot.error);
+
+  Chunk& chunk = chunks_[slot.chunk];
+  auto offsets = HostBuffer::CreateUninitialized(
+      2 * sizeof(int64_t), alignof(int64_t), allocator_);
+  llvm::Optional<PackedStringHostTensor> tensor;
+  if (offsets) {
+    auto* offsets_data = static_cast<int64_t*>(offsets->data());
+    offsets_data[0] = slot.offset;
+    offsets_data[1] = slot.offset + slot.length;
+    tensor.emplace(TensorShape({}), std::move(offsets), chunk.buffer.CopyRef());
+  }
+
+  chunk.live -= slot.length;
+  --chunk.num_records;
+  live_bytes_ -= slot.length;
+  MaybeReleaseChunk(slot.chunk);
+  MaybeCompact();
+
+  if (!tensor) {
+    auto error = MakeErrorAsyncValueRef(host, "out of memory taking a record");
+    return IterationResult::Error(std::move(error), 1);
+  }
+  llvm::SmallVector<RCReference<AsyncValue>, 4> values;
+  values.push_back(MakeAvailableAsyncValueRef<PackedStringHostTensor>(
+      host, std::move(*tensor)));
+  return IterationResult::Values(std::move(values), host);
+}
+
+llvm::Expected<uint32_t> CompactShuffleBuffer::GetChunk(size_t length) {
+  // Records larger than a chunk get a chunk of their own.
+  const bool dedicated = length > chunk_size_;
+  if (!dedicated && has_current_chunk_) {
+    const Chunk& chunk = chunks_[current_chunk_];
+    if (chunk.buffer->size() - chunk.used >= length) return current_chunk_;
+    has_current_chunk_ = false;
+    MaybeReleaseChunk(current_chunk_);
+  }
+
+  const size_t size = std::max(chunk_size_, length);
+  auto buffer = AllocateChunk(size);
+  if (!buffer) {
+    return MakeStringError("failed to allocate a shuffle buffer chunk of ",
+                           size, " bytes");
+  }
+
+  uint32_t index;
+  if (free_chunks_.empty()) {
+    index = chunks_.size();
+    chunks_.emplace_back();
+  } else {
+    index = free_chunks_.back();
+    free_chunks_.pop_back();
+  }
+  chunks_[index].buffer = std::move(buffer);
+  arena_bytes_ += size;
+  if (!dedicated) {
+    current_chunk_ = index;
+    has_current_chunk_ = true;
+  }
+  return index;
+}
+
+RCReference<HostBuffer> CompactShuffleBuffer::AllocateChunk(size_t size) {
+  if (spill_directory_.empty())
+    return HostBuffer::CreateUninitialized(size, kChunkAlignment, allocator_);
+
+  int fd;
+  llvm::SmallString<128> path;
+  if (llvm::sys::fs::createUniqueFile(
+          spill_directory_ + "/tfrt_shuffle_buffer-%%%%%%%%", fd, path))
+    return {};
+  auto file = llvm::sys::fs::convertFDToNativeFile(fd);
+  auto close_file =
+      llvm::make_scope_exit([&] { llvm::sys::fs::closeFile(file); });
+  // The mapping keeps the contents of the file, which is deleted when the
+  // chunk is unmapped.
+  llvm::sys::fs::remove(path);
+
+  if (llvm::sys::fs::resize_file(file, size)) return {};
+  std::error_code ec;
+  auto region = std::make_unique<llvm::sys::fs::mapped_file_region>(
+      file, llvm::sys::fs::mapped_file_region::readwrite, size, /*offset=*/0,
+      ec);
+  if (ec) return {};
+  char* data = region->data();
+  return HostBuffer::CreateFromExternal(
+      data, size, [region = std::move(region)](void*, size_t) {});
+}
+
+void CompactShuffleBuffer::MaybeReleaseChunk(uint32_t chunk_index) {
+  if (has_current_chunk_ && chunk_index == current_chunk_) return;
+  Chunk& chunk = chunks_[chunk_index];
+  if (chunk.num_records > 0) return;
+  arena_bytes_ -= chunk.buffer->size();
+  chunk = Chunk();
+  free_chunks_.push_back(chunk_index);
+}
+
+void CompactShuffleBuffer::MaybeCompact() {
+  if (arena_bytes_ <= 2 * chunk_size_ || 2 * live_bytes_ >= arena_bytes_)
+    return;
+
+  // Copy every record into new chunks. The old chunks are released as they
+  // become empty, and are kept alive by the records taken from them.
+  has_current_chunk_ = false;
+  for (Slot& slot : slots_) {
+    if (slot.error) continue;
+    auto chunk_index = GetChunk(slot.length);
+    // The remaining records stay in their chunks.
+    if (!chunk_index) {
+      llvm::consumeError(chunk_index.takeError());
+      return;
+    }
+
+    Chunk& old_chunk = chunks_[slot.chunk];
+    Chunk& new_chunk = chunks_[*chunk_index];
+    const char* bytes =
+        static_cast<const char*>(old_chunk.buffer->data()) + slot.offset;
+    std::memcpy(static_cast<char*>(new_chunk.buffer->data()) + new_chunk.used,
+                bytes, slot.length);
+    old_chunk.live -= slot.length;
+    --old_chunk.num_records;
+    new_chunk.live += slot.length;
+    ++new_chunk.num_records;
+
+    const uint32_t old_chunk_index = slot.chunk;
+    slot.chunk = *chunk_index;
+    slot.offset = new_chunk.used;
+    new_chunk.used += slot.length;
+    MaybeReleaseChunk(old_chunk_index);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// CompactShuffleDataset methods
+//===----------------------------------------------------------------------===//
+RCReference<Iterator> CompactShuffleDataset::MakeIteratorImpl(
+    const IteratorContext& context) {
+  return TakeRef(
+      host_->Construct<CompactShuffleDatasetIterator>(FormRef(this), context));
+}
+
+//===----------------------------------------------------------------------===//
+// CompactShuffleDatasetIterator methods
+//===----------------------------------------------------------------------===//
+constexpr size_t CompactShuffleDatasetIterator::kChunkSize;
+
+IterationResult CompactShuffleDatasetIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  auto* host = exec_ctx.host();
+  llvm::SmallVector<RCReference<AsyncValue>, 4> result_values;
+  result_values.push_back(MakeIndirectAsyncValue(host));
+  auto result_eof = MakeUnconstructedAsyncValueRef<bool>(host);
+  auto result =
+      IterationResult::Pending(std::move(result_values), std::move(result_eof));
+  {
+    mutex_lock lock(mu_);
+    output_buffer_.push(result.CopyRef());
+  }
+
+  MaybeScheduleBackgroundTask(exec_ctx, false);
+  return result;
+}
+
+void CompactShuffleDatasetIterator::MaybeScheduleBackgroundTask(
+    const ExecutionContext& exec_ctx, bool is_token_owner) {
+  {
+    mutex_lock lock(mu_);
+    // There is no more output value to update. Release the token if the caller
+    // owns the token and then return.
+    if (output_buffer_.empty()) {
+      if (is_token_owner) {
+        token_owned_ = false;
+      }
+      return;
+    }
+    // Return since the token is already owned by another thread.
+    if (!is_token_owner && token_owned_) return;
+    // Take the token if the thread does not already own the token.
+    token_owned_ = true;
+    is_token_owner = true;
+  }
+
+  auto host = exec_ctx.host();
+  auto callback = [exec_ctx, iterator = FormRef(this)]() mutable {
+    RunInlineOrEnqueue(exec_ctx, [exec_ctx, iterator = std::move(iterator)] {
+      iterator->MaybeScheduleBackgroundTask(exec_ctx, true);
+    });
+  };
+
+  const size_t max_buffer_size = parent_dataset_->buffer_size_;
+  while (OutputBufferSize() > 0) {
+    // Fills shuffle_buffer_ with up to buffer_size_ values. It can have less
+    // than buffer_size_ values only if the input_iterator_ has reached end.
+    while (shuffle_buffer_.size() < max_buffer_size && !reached_eof_) {
+      if (!pending_input_) pending_input_ = input_iterator_->GetNext(exec_ctx);
+      // The bytes of a record are copied once both its eof and its value are
+      // available.
+      auto* eof_async = pending_input_->eof.GetAsyncValue();
+      auto* value_async = pending_input_->values[0].get();
+      if (eof_async->IsUnavailable()) {
+        eof_async->AndThen(std::move(callback));
+        return;
+      }
+      if (eof_async->IsConcrete() && value_async->IsUnavailable()) {
+        value_async->AndThen(std::move(callback));
+        return;
+      }
+      auto input = std::move(*pending_input_);
+      pending_input_.reset();
+      AddToShuffleBuffer(std::move(input), host);
+    }
+
+    if (shuffle_buffer_.size() > 0) {
+      auto index = random_() % shuffle_buffer_.size();
+      HandleEofAvailableInput(shuffle_buffer_.Take(index, host), host);
+    } else {
+      HandleEofAvailableInput(IterationResult::Eof(host, 1), host);
+    }
+  }
+  MaybeScheduleBackgroundTask(exec_ctx, true);
+}
+
+void CompactShuffleDatasetIterator::AddToShuffleBuffer(IterationResult input,
+                                                       HostContext* host) {
+  assert(input.values.size() == 1);
+  if (input.eof.IsConcrete() && input.eof.get()) {
+    reached_eof_ = true;
+    return;
+  }
+  AsyncValue* value = input.values[0].get();
+  if (input.eof.IsError() || value->IsError()) {
+    shuffle_buffer_.AddError(std::move(input));
+    return;
+  }
+
+  if (!value->IsType<PackedStringHostTensor>() ||
+      value->get<PackedStringHostTensor>().shape().GetRank() != 0) {
+    auto error = MakeErrorAsyncValueRef(
+        host, "compact_shuffle_dataset expects scalar string tensors");
+    shuffle_buffer_.AddError(IterationResult::Error(std::move(error), 1));
+    return;
+  }
+  auto bytes = value->get<PackedStringHostTensor>().GetString(0);
+  if (auto error = shuffle_buffer_.AddRecord(bytes)) {
+    auto async_error = MakeErrorAsyncValueRef(host, StrCat(error));
+    shuffle_buffer_.AddError(IterationResult::Error(std::move(async_error), 1));
+  }
+}
+
+void CompactShuffleDatasetIterator::HandleEofAvailableInput(
+    IterationResult input, HostContext* host) {
+  auto input_eof = std::move(input.eof);
+  auto input_values = std::move(input.values);
+  if (input_eof.IsError() || !input_eof.get()) {
+    auto output = DequeueOutputBuffer();
+    auto* output_value = cast<IndirectAsyncValue>(output.values[0].get());
+    output_value->ForwardTo(std::move(input_values[0]));
+    if (input_eof.IsError()) {
+      output.eof.SetError(input_eof.GetError());
+    } else {
+      output.eof.emplace(false);
+    }
+    return;
+  }
+  // The input_iterator_ has been exhausted and there is no remaining count.
+  auto error = MakeErrorAsyncValueRef(host, "iterator reached end");
+  auto output_buffer_size = OutputBufferSize();
+  for (; output_buffer_size > 0; --output_buffer_size) {
+    auto output = DequeueOutputBuffer();
+    output.values[0]->SetError(error->GetError());
+    output.eof.emplace(true);
+  }
+}
+
+}  // namespace data
+}  // namespace tfrt
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the CompactShuffleDataset class which shuffles records
+// in a compact buffer.
+
+#ifndef TFRT_LIB_DATA_COMPACT_SHUFFLE_DATASET_H_
+#define TFRT_LIB_DATA_COMPACT_SHUFFLE_DATASET_H_
+
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "tfrt/data/dataset.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/philox_random.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace data {
+
+class CompactShuffleDatasetIterator;
+
+// A shuffle buffer that stores the bytes of its records in an arena of large
+// chunks, and the record locations in a flat array, instead of an AsyncValue
+// and a tensor per record. Removed records are views into their chunk, which
+// is released by the buffer once it holds no records.
+//
+// Records are removed in random order, so the chunks fragment. When less than
+// half of the arena holds records, the records are compacted into new chunks.
+//
+// If `spill_directory` is not empty, the chunks are memory mapped from unlinked
+// temporary files in that directory, so the buffer can exceed the RAM.
+class CompactShuffleBuffer {
+ public:
+  CompactShuffleBuffer(size_t chunk_size, std::string spill_directory,
+                       HostAllocator* allocator)
+      : chunk_size_(chunk_size),
+        spill_directory_(std::move(spill_directory)),
+        allocator_(allocator) {}
+
+  size_t size() const { return slots_.size(); }
+
+  // Copies `bytes` into the arena as a new record.
+  llvm::Error AddRecord(string_view bytes);
+
+  // Adds an element that is an error.
+  void AddError(IterationResult error);
+
+  // Removes the element at `index`. Returns a scalar PackedStringHostTensor
+  // that shares the chunk of a record, or the error of an error element.
+  IterationResult Take(size_t index, HostContext* host);
+
+ private:
+  struct Chunk {
+    RCReference<HostBuffer> buffer;
+    // The number of bytes of the chunk that are filled.
+    size_t used = 0;
+    // The number and the total size of the records in the chunk.
+    size_t num_records = 0;
+    size_t live = 0;
+  };
+
+  // A record is the bytes [offset, offset + length) of chunks_[chunk], or an
+  // error element if `error` is set.
+  struct Slot {
+    uint32_t chunk;
+    uint64_t offset;
+    uint64_t length;
+    std::unique_ptr<IterationResult> error;
+  };
+
+  // Returns the index of a chunk with at least `length` free bytes.
+  llvm::Expected<uint32_t> GetChunk(size_t length);
+
+  RCReference<HostBuffer> AllocateChunk(size_t size);
+
+  // Releases `chunk` if it is empty and not filled anymore.
+  void MaybeReleaseChunk(uint32_t chunk);
+
+  // Copies the records into new chunks if less than half of the arena holds
+  // records.
+  void MaybeCompact();
+
+  const size_t chunk_size_;
+  const std::string spill_directory_;
+  HostAllocator* allocator_;
+
+  std::vector<Chunk> chunks_;
+  // The indices of released chunks, which can be reused.
+  std::vector<uint32_t> free_chunks_;
+  // The chunk that records are appended to.
+  uint32_t current_chunk_ = 0;
+  bool has_current_chunk_ = false;
+  // The total size of the chunks and of the records in them.
+  size_t arena_bytes_ = 0;
+  size_t live_bytes_ = 0;
+
+  std::vector<Slot> slots_;
+};
+
+// CompactShuffleDataset shuffles the records of another dataset, like
+// ShuffleDataset, with a CompactShuffleBuffer. The elements of the input
+// dataset must be scalar PackedStringHostTensors, e.g. the records of a
+// TFRecordDataset. The buffer only keeps their bytes, at the cost of copying
+// each record once.
+class CompactShuffleDataset : public Dataset {
+ public:
+  explicit CompactShuffleDataset(RCReference<Dataset> input_dataset,
+                                 int64_t buffer_size, int64_t seed,
+                                 int64_t seed2, std::string spill_directory,
+                                 HostContext* host)
+      : input_dataset_(std::move(input_dataset)),
+        buffer_size_(buffer_size),
+        seed_(seed),
+        seed2_(seed2),
+        spill_directory_(std::move(spill_directory)),
+        host_(host),
+        allocator_(host->allocator()) {
+    assert(buffer_size_ > 0);
+  }
+
+  // This class is not copyable or movable.
+  CompactShuffleDataset(const CompactShuffleDataset&) = delete;
+  CompactShuffleDataset& operator=(const CompactShuffleDataset&) = delete;
+
+  string_view name() const override { return "compact_shuffle"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
+
+ private:
+  friend class CompactShuffleDatasetIterator;
+
+  void Destroy() override {
+    internal::DestroyImpl<CompactShuffleDataset>(this, allocator_);
+  }
+
+  RCReference<Dataset> input_dataset_;
+  int64_t buffer_size_;
+  int64_t seed_;
+  int64_t seed2_;
+  std::string spill_directory_;
+  HostContext* host_;
+  HostAllocator* allocator_;
+};
+
+class CompactShuffleDatasetIterator : public Iterator {
+ public:
+  // The size of the chunks of the shuffle buffer.
+  static constexpr size_t kChunkSize = 4 * 1024 * 1024;
+
+  explicit CompactShuffleDatasetIterator(
+      RCReference<CompactShuffleDataset> dataset,
+      const IteratorContext& context)
+      : Iterator(),
+        parent_dataset_(std::move(dataset)),
+        input_iterator_(parent_dataset_->input_dataset_->MakeIterator(context)),
+        random_(parent_dataset_->seed_, parent_dataset_->seed2_),
+        shuffle_buffer_(kChunkSize, parent_dataset_->spill_directory_,
+                        parent_dataset_->allocator_) {}
+
+  // This class is not copyable or movable.
+  CompactShuffleDatasetIterator(const CompactShuffleDatasetIterator&) = delete;
+  CompactShuffleDatasetIterator& operator=(
+      const CompactShuffleDatasetIterator&) = delete;
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  void Destroy() override {
+    internal::DestroyImpl<CompactShuffleDatasetIterator>(
+        this, parent_dataset_->allocator_);
+  }
+
+  // This method ensures that the control flow (e.g. get value from the
+  // input_iterator_) is only executed by the thread that holds the token, like
+  // in ShuffleDatasetIterator.
+  void MaybeScheduleBackgroundTask(const ExecutionContext& exec_ctx,
+                                   bool is_token_owner)
+      TFRT_EXCLUDES(mu_);
+
+  // Adds an available input to the shuffle buffer.
+  void AddToShuffleBuffer(IterationResult input, HostContext* host);
+
+  void HandleEofAvailableInput(IterationResult input, HostContext* host);
+
+  int OutputBufferSize() TFRT_EXCLUDES(mu_) {
+    mutex_lock lock(mu_);
+    return output_buffer_.size();
+  }
+
+  IterationResult DequeueOutputBuffer() TFRT_EXCLUDES(mu_) {
+    mutex_lock lock(mu_);
+    assert(!output_buffer_.empty());
+    auto value = std::move(output_buffer_.front());
+    output_buffer_.pop();
+    return value;
+  }
+
+  RCReference<CompactShuffleDataset> parent_dataset_;
+  RCReference<Iterator> input_iterator_;
+  random::PhiloxRandom random_;
+
+  // True iff the input_iterator_ has reached EOF.
+  bool reached_eof_ = false;
+  CompactShuffleBuffer shuffle_buffer_;
+  // The input that is added to the shuffle buffer once it is available.
+  llvm::Optional<IterationResult> pending_input_;
+
+  mutex mu_;
+  // A queue of IterationResult that have already been returned to the
+  // GetNext(...) caller.
+  std::queue<IterationResult> output_buffer_ TFRT_GUARDED_BY(mu_);
+  // The token of ShuffleDatasetIterator.
+  bool token_owned_ TFRT_GUARDED_BY(mu_) = false;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_COMPACT_SHUFFLE_DATASET_H_
@@ -14,12 +14,23 @@
 
 // This file implements data kernels.
 
+#include <algorithm>
+#include <functional>
+
+#include "autotune.h"
 #include "batch_dataset.h"
+#include "bucket_by_sequence_length_dataset.h"
+#include "cache_dataset.h"
+#include "compact_shuffle_dataset.h"
 #include "filter_dataset.h"
 #include "interleave_dataset.h"
+#include "iterator_stats.h"
 #include "log_dataset.h"
+#include "map_and_batch_dataset.h"
 #include "map_dataset.h"
 #include "memory_dataset.h"
+#include "padded_batch_dataset.h"
+#include "parallel_map_dataset.h"
 #include "prefetch_dataset.h"
 #include "range_dataset.h"
 #include "repeat_dataset.h"
@@ -27,6 +38,8 @@
 #include "skip_dataset.h"
 #include "slice_dataset.h"
 #include "tf_record_dataset.h"
+#include "tf_record_files_dataset.h"
+#include "llvm_derived/Support/raw_ostream.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/error_util.h"
@@ -105,11 +118,12 @@ RCReference<MapDataset> MakeMapDataset(RCReference<Dataset>* dataset,
 //===----------------------------------------------------------------------===//
 
 RCReference<FilterDataset> MakeFilterDataset(RCReference<Dataset>* dataset,
+                                             Attribute<bool> batched,
                                              Attribute<Function> fn,
                                              const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
-  return TakeRef(host->Construct<FilterDataset>((*dataset).CopyRef(),
-                                                FormRef(&fn.get()), host));
+  return TakeRef(host->Construct<FilterDataset>(
+      (*dataset).CopyRef(), FormRef(&fn.get()), *batched, host));
 }
 
 //===----------------------------------------------------------------------===//
@@ -118,15 +132,15 @@ RCReference<FilterDataset> MakeFilterDataset(RCReference<Dataset>* dataset,
 
 RCReference<InterleaveDataset> MakeInterleaveDataset(
     RCReference<Dataset>* dataset, int64_t cycle_length, int64_t block_length,
-    Attribute<int64_t> arity, Attribute<Function> fn,
-    const ExecutionContext& exec_ctx) {
+    Attribute<int64_t> arity, Attribute<bool> is_deterministic,
+    Attribute<Function> fn, const ExecutionContext& exec_ctx) {
   assert(
       fn->result_types().size() == 1 &&
       "Interleave expects only one function output, which must be a dataset.");
 
   return TakeRef(exec_ctx.host()->Construct<InterleaveDataset>(
       dataset->CopyRef(), cycle_length, block_length, FormRef(&fn.get()),
-      arity.get(), exec_ctx.host()));
+      arity.get(), is_deterministic.get(), exec_ctx.host()));
 }
 
 //===----------------------------------------------------------------------===//
@@ -134,14 +148,37 @@ RCReference<InterleaveDataset> MakeInterleaveDataset(
 //===----------------------------------------------------------------------===//
 
 RCReference<TFRecordDataset> MakeTFRecordDataset(
-    std::string path, const ExecutionContext& exec_ctx) {
+    std::string path, Attribute<bool> verify_payload_checksum,
+    const ExecutionContext& exec_ctx) {
   // Default buffer size to 256 KB.
   int64_t buffer_size = 256 * 1024;
   int64_t max_prefetch_num = 80;
   int64_t prefetch_threshold = 20;
   return TakeRef(exec_ctx.host()->Construct<TFRecordDataset>(
       std::move(path), buffer_size, max_prefetch_num, prefetch_threshold,
-      exec_ctx.host()));
+      *verify_payload_checksum, exec_ctx.host()));
+}
+
+//===----------------------------------------------------------------------===//
+// TFRecordFilesDataset
+//===----------------------------------------------------------------------===//
+
+RCReference<TFRecordFilesDataset> MakeTFRecordFilesDataset(
+    int64_t num_parallel_reads, int64_t num_shards, int64_t shard_index,
+    RemainingArguments patterns, Attribute<int64_t> file_shuffle_seed,
+    Attribute<bool> verify_payload_checksum, const ExecutionContext& exec_ctx) {
+  std::vector<std::string> pattern_strings;
+  pattern_strings.reserve(patterns.size());
+  for (AsyncValue* pattern : patterns.values())
+    pattern_strings.push_back(pattern->get<std::string>());
+  // The same defaults as TFRecordDataset, for each file.
+  int64_t buffer_size = 256 * 1024;
+  int64_t max_prefetch_num = 80;
+  int64_t prefetch_threshold = 20;
+  return TakeRef(exec_ctx.host()->Construct<TFRecordFilesDataset>(
+      std::move(pattern_strings), num_parallel_reads, num_shards, shard_index,
+      *file_shuffle_seed, buffer_size, max_prefetch_num, prefetch_threshold,
+      *verify_payload_checksum, exec_ctx.host()));
 }
 
 //===----------------------------------------------------------------------===//
@@ -155,6 +192,30 @@ RCReference<ShuffleDataset> MakeShuffleDataset(
       dataset->CopyRef(), buffer_size, seed, seed2, exec_ctx.host()));
 }
 
+//===----------------------------------------------------------------------===//
+// CompactShuffleDataset
+//===----------------------------------------------------------------------===//
+
+RCReference<CompactShuffleDataset> MakeCompactShuffleDataset(
+    RCReference<Dataset>* dataset, int64_t buffer_size, int64_t seed,
+    int64_t seed2, StringAttribute spill_directory,
+    const ExecutionContext& exec_ctx) {
+  return TakeRef(exec_ctx.host()->Construct<CompactShuffleDataset>(
+      dataset->CopyRef(), buffer_size, seed, seed2, spill_directory.str(),
+      exec_ctx.host()));
+}
+
+//===----------------------------------------------------------------------===//
+// CacheDataset
+//===----------------------------------------------------------------------===//
+
+RCReference<CacheDataset> MakeCacheDataset(RCReference<Dataset>* dataset,
+                                           StringAttribute filename,
+                                           const ExecutionContext& exec_ctx) {
+  return TakeRef(exec_ctx.host()->Construct<CacheDataset>(
+      dataset->CopyRef(), filename.str(), exec_ctx.host()));
+}
+
 //===----------------------------------------------------------------------===//
 // RepeatDataset
 //===----------------------------------------------------------------------===//
@@ -203,6 +264,81 @@ RCReference<BatchDataset<T...>> MakeBatchDataset(
       dataset->CopyRef(), batch_size, same_input_metadata.get(), host));
 }
 
+//===----------------------------------------------------------------------===//
+// PaddedBatchDataset
+//===----------------------------------------------------------------------===//
+
+RCReference<PaddedBatchDataset> MakePaddedBatchDataset(
+    RCReference<Dataset>* dataset, int64_t batch_size,
+    Attribute<float> padding_value, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  return TakeRef(host->Construct<PaddedBatchDataset>(
+      dataset->CopyRef(), batch_size, padding_value.get(), host));
+}
+
+//===----------------------------------------------------------------------===//
+// BucketBySequenceLengthDataset
+//===----------------------------------------------------------------------===//
+
+llvm::Expected<RCReference<BucketBySequenceLengthDataset>>
+MakeBucketBySequenceLengthDataset(RCReference<Dataset>* dataset,
+                                  ArrayAttribute<int64_t> bucket_batch_sizes,
+                                  ArrayAttribute<int64_t> bucket_boundaries,
+                                  Attribute<float> padding_value,
+                                  const ExecutionContext& exec_ctx) {
+  if (bucket_batch_sizes.size() != bucket_boundaries.size() + 1)
+    return MakeStringError(
+        "bucket_batch_sizes must have one more entry than bucket_boundaries");
+  auto boundaries = bucket_boundaries.data();
+  if (std::adjacent_find(boundaries.begin(), boundaries.end(),
+                         std::greater_equal<int64_t>()) != boundaries.end())
+    return MakeStringError("bucket_boundaries must be increasing");
+  auto batch_sizes = bucket_batch_sizes.data();
+  if (std::any_of(batch_sizes.begin(), batch_sizes.end(),
+                  [](int64_t batch_size) { return batch_size <= 0; }))
+    return MakeStringError("bucket_batch_sizes must be positive");
+
+  HostContext* host = exec_ctx.host();
+  return TakeRef(host->Construct<BucketBySequenceLengthDataset>(
+      dataset->CopyRef(),
+      std::vector<int64_t>(boundaries.begin(), boundaries.end()),
+      std::vector<int64_t>(batch_sizes.begin(), batch_sizes.end()),
+      padding_value.get(), host));
+}
+
+//===----------------------------------------------------------------------===//
+// MapAndBatchDataset
+//===----------------------------------------------------------------------===//
+
+RCReference<MapAndBatchDataset> MakeMapAndBatchDataset(
+    RCReference<Dataset>* dataset, int64_t batch_size,
+    RemainingArguments args, ArrayAttribute<ssize_t> element_shape,
+    Attribute<DType::Kind> element_type, Attribute<Function> fn,
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  TensorMetadata element_metadata(DType(element_type.get()),
+                                  element_shape.data());
+  return TakeRef(host->Construct<MapAndBatchDataset>(
+      dataset->CopyRef(), batch_size, RCArray<AsyncValue>(args.values()),
+      FormRef(&fn.get()), element_metadata, host));
+}
+
+//===----------------------------------------------------------------------===//
+// ParallelMapDataset
+//===----------------------------------------------------------------------===//
+
+RCReference<ParallelMapDataset> MakeParallelMapDataset(
+    RCReference<Dataset>* dataset, int64_t num_parallel_calls,
+    int64_t buffer_size, RemainingArguments args,
+    Attribute<bool> is_deterministic, Attribute<Function> fn,
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  return TakeRef(host->Construct<ParallelMapDataset>(
+      dataset->CopyRef(), RCArray<AsyncValue>(args.values()),
+      FormRef(&fn.get()), num_parallel_calls, buffer_size,
+      is_deterministic.get(), host));
+}
+
 //===----------------------------------------------------------------------===//
 // PrefetchDataset
 //===----------------------------------------------------------------------===//
@@ -211,9 +347,6 @@ RCReference<PrefetchDataset> MakePrefetchDataset(
     RCReference<Dataset>* dataset, int64_t prefetch_num,
     Attribute<bool> is_deterministic, const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
-  if (prefetch_num == -1) {
-    prefetch_num = host->GetNumWorkerThreads();
-  }
   return TakeRef(host->Construct<PrefetchDataset>(
       dataset->CopyRef(), prefetch_num, is_deterministic.get(), host));
 }
@@ -222,9 +355,22 @@ RCReference<PrefetchDataset> MakePrefetchDataset(
 // Generic input pipeline kernels
 //===----------------------------------------------------------------------===//
 
-// Create an iterator that points to the first element in the dataset.
-RCReference<Iterator> MakeIteratorFromDataset(RCReference<Dataset>* dataset) {
+// Create an iterator that points to the first element in the dataset. The
+// iterators of the pipeline share an Autotuner whose CPU budget is the number
+// of worker threads. If `collect_stats` is true, the iterators record their
+// stats, which are printed when the iterators are destroyed.
+RCReference<Iterator> MakeIteratorFromDataset(
+    RCReference<Dataset>* dataset, Attribute<bool> collect_stats,
+    const ExecutionContext& exec_ctx) {
+  Autotuner::Options options;
+  options.cpu_budget =
+      std::max<int64_t>(exec_ctx.host()->GetNumWorkerThreads(), 1);
   IteratorContext context;
+  context.autotuner = std::make_shared<Autotuner>(options);
+  if (*collect_stats) {
+    context.stats =
+        std::make_shared<PipelineStats>(exec_ctx.host(), &tfrt::outs());
+  }
   return (*dataset)->MakeIterator(context);
 }
 
@@ -236,6 +382,16 @@ RCReference<Iterator> MakeIteratorFromDataset(RCReference<Dataset>* dataset) {
 static void IteratorGetNext(RCReference<Iterator>* iterator, Chain chain_in,
                             Result<Chain> chain_out, RemainingResults results,
                             const ExecutionContext& exec_ctx) {
+  // Do not pull more elements, which may start more asynchronous work in the
+  // input pipeline, for a cancelled request.
+  if (AsyncValue* cancel_av = exec_ctx.GetCancelAsyncValue()) {
+    for (size_t i = 0, e = results.size(); i < e; ++i) {
+      results[i] = FormRef(cancel_av);
+    }
+    chain_out.Set(FormRef(cancel_av));
+    return;
+  }
+
   auto input = (*iterator)->GetNext(exec_ctx);
   auto* eof = input.eof.GetAsyncValue();
   assert(results.size() == input.values.size());
@@ -486,6 +642,10 @@ void RegisterDataKernels(KernelRegistry* registry) {
                       TFRT_KERNEL(MakeBatchDataset<DenseHostTensor, int64_t>));
   registry->AddKernel("tfrt_data.batch_dataset.i64_and_i64",
                       TFRT_KERNEL(MakeBatchDataset<int64_t, int64_t>));
+  registry->AddKernel("tfrt_data.padded_batch_dataset",
+                      TFRT_KERNEL(MakePaddedBatchDataset));
+  registry->AddKernel("tfrt_data.bucket_by_sequence_length_dataset",
+                      TFRT_KERNEL(MakeBucketBySequenceLengthDataset));
 
   registry->AddKernel("tfrt_data.memory_dataset.i64",
                       TFRT_KERNEL(MakeMemoryDataset<int64_t>));
@@ -497,6 +657,10 @@ void RegisterDataKernels(KernelRegistry* registry) {
   registry->AddKernel("tfrt_data.interleave_dataset",
                       TFRT_KERNEL(MakeInterleaveDataset));
   registry->AddKernel("tfrt_data.map_dataset", TFRT_KERNEL(MakeMapDataset));
+  registry->AddKernel("tfrt_data.map_and_batch_dataset",
+                      TFRT_KERNEL(MakeMapAndBatchDataset));
+  registry->AddKernel("tfrt_data.parallel_map_dataset",
+                      TFRT_KERNEL(MakeParallelMapDataset));
   registry->AddKernel("tfrt_data.prefetch_dataset",
                       TFRT_KERNEL(MakePrefetchDataset));
   registry->AddKernel("tfrt_data.repeat_dataset",
@@ -504,8 +668,14 @@ void RegisterDataKernels(KernelRegistry* registry) {
   registry->AddKernel("tfrt_data.skip_dataset", TFRT_KERNEL(MakeSkipDataset));
   registry->AddKernel("tfrt_data.tf_record_dataset",
                       TFRT_KERNEL(MakeTFRecordDataset));
+  registry->AddKernel("tfrt_data.tf_record_files_dataset",
+                      TFRT_KERNEL(MakeTFRecordFilesDataset));
   registry->AddKernel("tfrt_data.shuffle_dataset",
                       TFRT_KERNEL(MakeShuffleDataset));
+  registry->AddKernel("tfrt_data.compact_shuffle_dataset",
+                      TFRT_KERNEL(MakeCompactShuffleDataset));
+  registry->AddKernel("tfrt_data.cache_dataset",
+                      TFRT_KERNEL(MakeCacheDataset));
   registry->AddKernel("tfrt_data.log_dataset", TFRT_KERNEL(MakeLogDataset));
 }
 
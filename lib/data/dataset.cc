@@ -16,6 +16,8 @@
 
 #include "tfrt/data/dataset.h"
 
+#include "iterator_stats.h"
+
 namespace tfrt {
 namespace data {
 namespace internal {
@@ -25,5 +27,17 @@ bool IsConcreteAndEmpty(const IterationResult& result) {
 }
 
 }  // namespace internal
+
+RCReference<Iterator> Dataset::MakeIterator(const IteratorContext& context) {
+  if (!context.stats) return MakeIteratorImpl(context);
+
+  // The iterators of the inputs record that this stage consumes them.
+  IteratorStats* stats =
+      context.stats->GetStage(name(), context.consumer_stats);
+  IteratorContext input_context = context;
+  input_context.consumer_stats = stats;
+  return TakeRef(context.stats->host()->Construct<InstrumentedIterator>(
+      MakeIteratorImpl(input_context), context.stats, stats));
+}
 }  // namespace data
 }  // namespace tfrt
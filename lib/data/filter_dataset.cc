@@ -20,15 +20,90 @@
 
 #include "filter_dataset.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
 
 namespace tfrt {
 namespace data {
 
+// Returns whether `predicate` selects an input element, or a row of it in
+// batched mode. An invalid batched predicate is reported by SelectRows().
+static bool IsSelected(const AsyncValue& predicate, bool batched) {
+  if (!batched) return predicate.get<bool>();
+  if (!predicate.IsType<DenseHostTensor>()) return true;
+  const auto& mask = predicate.get<DenseHostTensor>();
+  if (mask.dtype() != GetDType<bool>()) return true;
+  const bool* data = static_cast<const bool*>(mask.data());
+  return std::any_of(data, data + mask.NumElements(),
+                     [](bool selected) { return selected; });
+}
+
+// Returns batches with the rows of `values` selected by the bool tensor
+// `predicate`. Returns `values` if all rows are selected.
+static llvm::Expected<SmallVector<RCReference<AsyncValue>, 4>> SelectRows(
+    const AsyncValue& predicate, ArrayRef<RCReference<AsyncValue>> values,
+    HostContext* host) {
+  if (!predicate.IsType<DenseHostTensor>() ||
+      predicate.get<DenseHostTensor>().dtype() != GetDType<bool>() ||
+      predicate.get<DenseHostTensor>().shape().GetRank() != 1)
+    return MakeStringError(
+        "batched filter function must return a rank 1 bool tensor");
+  const auto& mask = predicate.get<DenseHostTensor>();
+  const bool* selected = static_cast<const bool*>(mask.data());
+  const ssize_t num_rows = mask.NumElements();
+  const ssize_t num_selected = std::count(selected, selected + num_rows, true);
+
+  SmallVector<RCReference<AsyncValue>, 4> results;
+  for (const auto& value : values) {
+    if (!value->IsType<DenseHostTensor>() ||
+        value->get<DenseHostTensor>().shape().GetRank() == 0 ||
+        value->get<DenseHostTensor>().shape().GetDimensionSize(0) != num_rows)
+      return MakeStringError("batched filter expects tensors with ", num_rows,
+                             " rows");
+    if (num_selected == num_rows) {
+      results.push_back(value.CopyRef());
+      continue;
+    }
+
+    const auto& batch = value->get<DenseHostTensor>();
+    SmallVector<ssize_t, 4> dims;
+    batch.shape().GetDimensions(&dims);
+    dims[0] = num_selected;
+    auto result = DenseHostTensor::CreateUninitialized(
+        TensorMetadata(batch.dtype(), dims), host);
+    if (!result) return MakeStringError("out of memory filtering a batch");
+
+    // Copy the selected rows, merging the runs of adjacent rows.
+    const size_t row_size =
+        batch.NumElements() / num_rows * batch.dtype().GetHostSize();
+    const char* src = static_cast<const char*>(batch.data());
+    char* dst = static_cast<char*>(result->data());
+    for (ssize_t begin = 0; begin < num_rows;) {
+      if (!selected[begin]) {
+        ++begin;
+        continue;
+      }
+      ssize_t end = begin + 1;
+      while (end < num_rows && selected[end]) ++end;
+      const size_t size = (end - begin) * row_size;
+      std::memcpy(dst, src + begin * row_size, size);
+      dst += size;
+      begin = end;
+    }
+    results.push_back(
+        MakeAvailableAsyncValueRef<DenseHostTensor>(host, std::move(*result)));
+  }
+  return std::move(results);
+}
+
 //===----------------------------------------------------------------------===//
 // FilterDataset methods
 //===----------------------------------------------------------------------===//
-RCReference<Iterator> FilterDataset::MakeIterator(
+RCReference<Iterator> FilterDataset::MakeIteratorImpl(
     const IteratorContext& context) {
   return TakeRef(
       host_->Construct<FilterDatasetIterator>(FormRef(this), context));
@@ -54,12 +129,12 @@ IterationResult FilterDatasetIterator::GetNext(
     mutex_lock lock(mu_);
     output_buffer_.push(result.CopyRef());
   }
-  MaybeScheduleBackgroundTask(exec_ctx, false, 0);
+  MaybeScheduleBackgroundTask(exec_ctx, false);
   return result;
 }
 
 void FilterDatasetIterator::MaybeScheduleBackgroundTask(
-    const ExecutionContext& exec_ctx, bool is_token_owner, int callback_count) {
+    const ExecutionContext& exec_ctx, bool is_token_owner) {
   {
     mutex_lock lock(mu_);
     // There is no more output value to update. Release the token if the caller
@@ -98,7 +173,9 @@ void FilterDatasetIterator::MaybeScheduleBackgroundTask(
     predicate_values[0]->AndThen(
         [predicate_values = predicate_values[0].CopyRef(),
          iterator = FormRef(this)]() mutable {
-          if (!predicate_values->IsError() && !predicate_values->get<bool>()) {
+          if (!predicate_values->IsError() &&
+              !IsSelected(*predicate_values,
+                          iterator->parent_dataset_->batched_)) {
             iterator->num_false_predicate_.fetch_add(1);
           }
         });
@@ -123,8 +200,7 @@ void FilterDatasetIterator::MaybeScheduleBackgroundTask(
   async_value_ptrs.push_back(input.eof.GetAsyncValue());
   async_value_ptrs.push_back(predicate.values[0].get());
   async_value_ptrs.push_back(predicate.eof.GetAsyncValue());
-  RunWhenReady(async_value_ptrs, [exec_ctx, host, callback_count,
-                                  input = std::move(input),
+  RunWhenReady(async_value_ptrs, [exec_ctx, host, input = std::move(input),
                                   predicate = std::move(predicate),
                                   iterator = FormRef(this)]() mutable {
     auto predicate_value = std::move(predicate.values[0]);
@@ -152,24 +228,33 @@ void FilterDatasetIterator::MaybeScheduleBackgroundTask(
         value->SetError(predicate_value->GetError());
       }
       output.eof.SetError(predicate_value->GetError());
-    } else if (predicate_value->get<bool>()) {
+    } else if (IsSelected(*predicate_value,
+                          iterator->parent_dataset_->batched_)) {
       // The input satisfies the predicate.
       auto output = iterator->DequeueOutputBuffer();
-      for (int i = 0; i < output.values.size(); ++i) {
-        auto* output_value = cast<IndirectAsyncValue>(output.values[i].get());
-        output_value->ForwardTo(std::move(input.values[i]));
+      auto values =
+          iterator->parent_dataset_->batched_
+              ? SelectRows(*predicate_value, input.values, host)
+              : llvm::Expected<SmallVector<RCReference<AsyncValue>, 4>>(
+                    std::move(input.values));
+      if (!values) {
+        auto error = MakeErrorAsyncValueRef(host, StrCat(values.takeError()));
+        for (auto& value : output.values) value->SetError(error->GetError());
+        output.eof.SetError(error->GetError());
+      } else {
+        for (int i = 0; i < output.values.size(); ++i) {
+          auto* output_value =
+              cast<IndirectAsyncValue>(output.values[i].get());
+          output_value->ForwardTo(std::move((*values)[i]));
+        }
+        output.eof.emplace(false);
       }
-      output.eof.emplace(false);
     } else {
       iterator->num_false_predicate_.fetch_sub(1);
     }
-    if (callback_count >= MAX_RECURSIVE_CALLS) {
-      EnqueueWork(exec_ctx, [exec_ctx, iterator = std::move(iterator)] {
-        iterator->MaybeScheduleBackgroundTask(exec_ctx, true, 0);
-      });
-    } else {
-      iterator->MaybeScheduleBackgroundTask(exec_ctx, true, callback_count + 1);
-    }
+    RunInlineOrEnqueue(exec_ctx, [exec_ctx, iterator = std::move(iterator)] {
+      iterator->MaybeScheduleBackgroundTask(exec_ctx, true);
+    });
   });
 }
 
@@ -37,22 +37,32 @@ class FilterDatasetIterator;
 
 // FilterDataset takes elements from the underlying dataset and outputs those
 // elements which satisfy a user-defined filter function.
+//
+// If `batched` is true, the elements are batches of DenseHostTensors with the
+// same first dimension, and the filter function returns a rank 1 bool
+// DenseHostTensor with a value per row. Each output element is a batch with
+// the selected rows of an input element, and batches without selected rows are
+// skipped. This calls the function once per batch instead of once per row.
 class FilterDataset : public Dataset {
  public:
   explicit FilterDataset(RCReference<Dataset> input_dataset,
-                         RCReference<const Function> filter_fn,
+                         RCReference<const Function> filter_fn, bool batched,
                          HostContext* host)
       : input_dataset_(std::move(input_dataset)),
         host_(host),
         allocator_(host->allocator()),
         arity_(filter_fn->num_arguments()),
-        filter_fn_(std::move(filter_fn)) {}
+        filter_fn_(std::move(filter_fn)),
+        batched_(batched) {}
 
   // This class is not copyable or movable.
   FilterDataset(const FilterDataset&) = delete;
   FilterDataset& operator=(const FilterDataset&) = delete;
 
-  RCReference<Iterator> MakeIterator(const IteratorContext& context) override;
+  string_view name() const override { return "filter"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
 
  private:
   // Allow iterator to rely on private data members of this dataset.
@@ -69,6 +79,7 @@ class FilterDataset : public Dataset {
   // The function should take value from the `input_dataset_` as input and
   // then output a boolean value.
   RCReference<const Function> filter_fn_;
+  const bool batched_;
 };
 
 class FilterDatasetIterator : public Iterator {
@@ -104,7 +115,7 @@ class FilterDatasetIterator : public Iterator {
   // appropriate. This method will recursively call itself again when the first
   // value in the `input_and_predicate_buffer_` becomes available.
   void MaybeScheduleBackgroundTask(const ExecutionContext& exec_ctx,
-                                   bool is_token_owner, int callback_count)
+                                   bool is_token_owner)
       TFRT_EXCLUDES(mu_);
 
   int OutputBufferSize() TFRT_EXCLUDES(mu_) {
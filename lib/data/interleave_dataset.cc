@@ -28,10 +28,23 @@ namespace data {
 //===----------------------------------------------------------------------===//
 // InterleaveDataset methods
 //===----------------------------------------------------------------------===//
-RCReference<Iterator> InterleaveDataset::MakeIterator(
+RCReference<Iterator> InterleaveDataset::MakeIteratorImpl(
     const IteratorContext& context) {
-  return TakeRef(
-      host_->Construct<InterleaveDatasetIterator>(FormRef(this), context));
+  if (is_deterministic_)
+    return TakeRef(
+        host_->Construct<InterleaveDatasetIterator>(FormRef(this), context));
+  return TakeRef(host_->Construct<NonDeterministicInterleaveDatasetIterator>(
+      FormRef(this), context));
+}
+
+// Runs `work` on the blocking work queue, or on the calling thread if the
+// queue is full.
+static void RunBlockingWorkOrInline(const ExecutionContext& exec_ctx,
+                                    llvm::unique_function<void()> work) {
+  auto shared_work =
+      std::make_shared<llvm::unique_function<void()>>(std::move(work));
+  if (!EnqueueBlockingWork(exec_ctx, [shared_work] { (*shared_work)(); }))
+    (*shared_work)();
 }
 
 //===----------------------------------------------------------------------===//
@@ -56,12 +69,9 @@ IterationResult InterleaveDatasetIterator::GetNext(
   auto result_eof = MakeUnconstructedAsyncValueRef<bool>(host);
   auto result =
       IterationResult::Pending(std::move(result_values), std::move(result_eof));
-  {
-    mutex_lock lock(mu_);
-    output_buffer_back_.push(result.CopyRef());
-  }
+  output_buffer_back_.Push(new PendingOutput(result.CopyRef()));
 
-  MaybeScheduleBackgroundTask(exec_ctx, false, 0);
+  MaybeScheduleBackgroundTask(exec_ctx, false);
   return result;
 }
 
@@ -91,7 +101,8 @@ void InterleaveDatasetIterator::PreInitializeIntermediateIterators(
         MakeUnconstructedAsyncValueRef<IterationResult>(host);
     entry.iterator =
         MakeUnconstructedAsyncValueRef<RCReference<Iterator>>(host);
-    // Instantiate the intermediate iterator once the dataset is available.
+    // Instantiate the intermediate iterator once the dataset is available, on
+    // the blocking work queue so that the iterators are opened in parallel.
     entry.dataset->AndThen([dataset = entry.dataset.CopyRef(),
                             prefetched_value = entry.prefetched_value.CopyRef(),
                             iterator = entry.iterator.CopyRef(),
@@ -101,14 +112,20 @@ void InterleaveDatasetIterator::PreInitializeIntermediateIterators(
         iterator.SetError(dataset->GetError());
         return;
       }
-      auto iter =
-          dataset->template get<RCReference<Dataset>>()->MakeIterator(context);
-      // IDEA(donglin): delay prefetching values from the 'future' iterators
-      // until we have finished prefetching values from the iterators in the
-      // current cycle.
-      auto input = iter->GetNext(exec_ctx);
-      prefetched_value.emplace(std::move(input));
-      iterator.emplace(std::move(iter));
+      RunBlockingWorkOrInline(
+          exec_ctx, [dataset = std::move(dataset),
+                     prefetched_value = std::move(prefetched_value),
+                     iterator = std::move(iterator), context,
+                     exec_ctx]() mutable {
+            auto iter = dataset->template get<RCReference<Dataset>>()
+                            ->MakeIterator(context);
+            // IDEA(donglin): delay prefetching values from the 'future'
+            // iterators until we have finished prefetching values from the
+            // iterators in the current cycle.
+            auto input = iter->GetNext(exec_ctx);
+            prefetched_value.emplace(std::move(input));
+            iterator.emplace(std::move(iter));
+          });
     });
 
     prefetched_iterators_.push(std::move(entry));
@@ -296,20 +313,24 @@ AsyncValue* InterleaveDatasetIterator::FillOutputValues(
 }
 
 void InterleaveDatasetIterator::MaybeScheduleBackgroundTask(
-    const ExecutionContext& exec_ctx, bool is_token_owner, int callback_count) {
+    const ExecutionContext& exec_ctx, bool is_token_owner) {
   while (true) {
     {
       mutex_lock lock(mu_);
+      // Return since the token is already owned by another thread. The owner
+      // drains output_buffer_back_ with the mutex before it releases the
+      // token, so it sees the value pushed by the caller.
+      if (!is_token_owner && token_owned_) return;
       // There is no more output value to update. Release the token if the
-      // caller owns the token and then return.
-      if (output_buffer_front_.empty() && output_buffer_back_.empty()) {
+      // caller owns the token and then return. A value that can not be popped
+      // yet is being pushed by a thread that calls this method afterwards.
+      DrainOutputBufferBack();
+      if (output_buffer_front_.empty()) {
         if (is_token_owner) {
           token_owned_ = false;
         }
         return;
       }
-      // Return since the token is already owned by another thread.
-      if (!is_token_owner && token_owned_) return;
       // Take the token if the thread does not already own the token.
       token_owned_ = true;
       is_token_owner = true;
@@ -320,16 +341,10 @@ void InterleaveDatasetIterator::MaybeScheduleBackgroundTask(
     // output_buffer_front_.
 
     auto host = exec_ctx.host();
-    auto callback = [exec_ctx, callback_count,
-                     iterator = FormRef(this)]() mutable {
-      if (callback_count >= MAX_RECURSIVE_CALLS) {
-        EnqueueWork(exec_ctx, [exec_ctx, iterator = std::move(iterator)] {
-          iterator->MaybeScheduleBackgroundTask(exec_ctx, true, 0);
-        });
-      } else {
-        iterator->MaybeScheduleBackgroundTask(exec_ctx, true,
-                                              callback_count + 1);
-      }
+    auto callback = [exec_ctx, iterator = FormRef(this)]() mutable {
+      RunInlineOrEnqueue(exec_ctx, [exec_ctx, iterator = std::move(iterator)] {
+        iterator->MaybeScheduleBackgroundTask(exec_ctx, true);
+      });
     };
 
     auto* unavailable_async_value_ptr = FetchInputValues(exec_ctx);
@@ -366,5 +381,218 @@ void InterleaveDatasetIterator::MaybeScheduleBackgroundTask(
   }
 }
 
+//===----------------------------------------------------------------------===//
+// NonDeterministicInterleaveDatasetIterator methods
+//===----------------------------------------------------------------------===//
+IterationResult NonDeterministicInterleaveDatasetIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  auto* host = exec_ctx.host();
+
+  llvm::SmallVector<RCReference<AsyncValue>, 4> result_values;
+  result_values.resize(parent_dataset_->arity_);
+  for (size_t i = 0; i < parent_dataset_->arity_; ++i) {
+    result_values[i] = MakeIndirectAsyncValue(host);
+  }
+  auto result_eof = MakeUnconstructedAsyncValueRef<bool>(host);
+  auto result =
+      IterationResult::Pending(std::move(result_values), std::move(result_eof));
+  {
+    mutex_lock lock(mu_);
+    outputs_.push(result.CopyRef());
+  }
+
+  Schedule(exec_ctx);
+  return result;
+}
+
+void NonDeterministicInterleaveDatasetIterator::Schedule(
+    const ExecutionContext& exec_ctx) {
+  const int64_t cycle_length = parent_dataset_->cycle_length_;
+  const int64_t max_open_iterators =
+      cycle_length + parent_dataset_->prefetch_iterator_num_;
+
+  while (true) {
+    // Decide what to do with the mutex, and do it without the mutex because
+    // the callbacks of the outputs and fetches can run inline.
+    SmallVector<std::pair<IterationResult, IterationResult>, 4> forwards;
+    SmallVector<IterationResult, 4> eof_outputs;
+    SmallVector<RCReference<Iterator>, 4> fetches;
+    bool fetch_input = false;
+    {
+      mutex_lock lock(mu_);
+      while (num_cycle_iterators_ < cycle_length &&
+             !opened_iterators_.empty()) {
+        idle_iterators_.push(std::move(opened_iterators_.front()));
+        opened_iterators_.pop();
+        ++num_cycle_iterators_;
+      }
+
+      // Fetch up to `cycle_length` elements ahead of the outputs.
+      while (!idle_iterators_.empty() &&
+             static_cast<int64_t>(elements_.size()) + num_pending_elements_ <
+                 static_cast<int64_t>(outputs_.size()) + cycle_length) {
+        fetches.push_back(std::move(idle_iterators_.front()));
+        idle_iterators_.pop();
+        ++num_pending_elements_;
+      }
+
+      // Open the next iterator if there are fewer than `max_open_iterators`.
+      if (!is_input_iterator_eof_ && !is_fetching_input_ &&
+          num_cycle_iterators_ + num_opening_iterators_ +
+                  static_cast<int64_t>(opened_iterators_.size()) <
+              max_open_iterators) {
+        is_fetching_input_ = true;
+        fetch_input = true;
+      }
+
+      while (!outputs_.empty() && !elements_.empty()) {
+        forwards.emplace_back(std::move(outputs_.front()),
+                              std::move(elements_.front()));
+        outputs_.pop();
+        elements_.pop();
+      }
+
+      // All iterators have reached end.
+      if (is_input_iterator_eof_ && !is_fetching_input_ &&
+          num_opening_iterators_ == 0 && opened_iterators_.empty() &&
+          num_cycle_iterators_ == 0 && elements_.empty()) {
+        for (; !outputs_.empty(); outputs_.pop())
+          eof_outputs.push_back(std::move(outputs_.front()));
+      }
+    }
+
+    if (forwards.empty() && eof_outputs.empty() && fetches.empty() &&
+        !fetch_input) {
+      return;
+    }
+
+    for (auto& forward : forwards) {
+      auto& output = forward.first;
+      auto& element = forward.second;
+      if (element.eof.IsError()) {
+        output.eof.SetError(element.eof.GetError());
+        for (auto& value : output.values) {
+          value->SetError(element.eof.GetError());
+        }
+        continue;
+      }
+      output.eof.emplace(false);
+      for (int i = 0; i < parent_dataset_->arity_; ++i) {
+        auto* output_value = cast<IndirectAsyncValue>(output.values[i].get());
+        output_value->ForwardTo(std::move(element.values[i]));
+      }
+    }
+
+    if (!eof_outputs.empty()) {
+      auto error =
+          MakeErrorAsyncValueRef(exec_ctx.host(), "iterator reached end");
+      for (auto& output : eof_outputs) {
+        for (auto& value : output.values) {
+          value->SetError(error->GetError());
+        }
+        output.eof.emplace(true);
+      }
+    }
+
+    for (auto& iterator : fetches) {
+      auto element = iterator->GetNext(exec_ctx);
+      auto values = element.AsyncValues();
+      RunWhenReady(exec_ctx, values,
+                   [self = FormRef(this), iterator = std::move(iterator),
+                    element = std::move(element), exec_ctx]() mutable {
+                     self->HandleElement(std::move(iterator),
+                                         std::move(element));
+                     self->Schedule(exec_ctx);
+                   });
+    }
+
+    if (fetch_input) {
+      auto input = input_iterator_->GetNext(exec_ctx);
+      AsyncValue* input_eof = input.eof.GetAsyncValue();
+      RunWhenReady(exec_ctx, input_eof,
+                   [self = FormRef(this), input = std::move(input),
+                    exec_ctx]() mutable {
+                     self->HandleInput(std::move(input), exec_ctx);
+                     self->Schedule(exec_ctx);
+                   });
+    }
+  }
+}
+
+void NonDeterministicInterleaveDatasetIterator::HandleInput(
+    IterationResult input, const ExecutionContext& exec_ctx) {
+  if (input.eof.IsError()) {
+    mutex_lock lock(mu_);
+    is_fetching_input_ = false;
+    elements_.push(IterationResult::Error(input.eof.CopyRCRef(),
+                                          parent_dataset_->arity_));
+    return;
+  }
+  if (input.eof.get()) {
+    mutex_lock lock(mu_);
+    is_fetching_input_ = false;
+    is_input_iterator_eof_ = true;
+    return;
+  }
+
+  // Construct dataset = func_(input).
+  SmallVector<AsyncValue*, 4> fn_args;
+  for (const auto& value : input.values) {
+    fn_args.push_back(value.get());
+  }
+  SmallVector<RCReference<AsyncValue>, 1> fn_results;
+  fn_results.resize(1);
+  parent_dataset_->func_->Execute(exec_ctx, fn_args, fn_results);
+  {
+    mutex_lock lock(mu_);
+    is_fetching_input_ = false;
+    ++num_opening_iterators_;
+  }
+
+  AsyncValue* dataset = fn_results[0].get();
+  dataset->AndThen([self = FormRef(this), dataset = std::move(fn_results[0]),
+                    exec_ctx]() mutable {
+    RunBlockingWorkOrInline(exec_ctx, [self = std::move(self),
+                                       dataset = std::move(dataset),
+                                       exec_ctx]() mutable {
+      self->OpenIterator(std::move(dataset), exec_ctx);
+      self->Schedule(exec_ctx);
+    });
+  });
+}
+
+void NonDeterministicInterleaveDatasetIterator::OpenIterator(
+    RCReference<AsyncValue> dataset, const ExecutionContext& exec_ctx) {
+  if (dataset->IsError()) {
+    mutex_lock lock(mu_);
+    --num_opening_iterators_;
+    elements_.push(
+        IterationResult::Error(std::move(dataset), parent_dataset_->arity_));
+    return;
+  }
+
+  auto iterator =
+      dataset->template get<RCReference<Dataset>>()->MakeIterator(context_);
+  mutex_lock lock(mu_);
+  --num_opening_iterators_;
+  opened_iterators_.push(std::move(iterator));
+}
+
+void NonDeterministicInterleaveDatasetIterator::HandleElement(
+    RCReference<Iterator> iterator, IterationResult element) {
+  // Release the iterator without the mutex if it has reached end.
+  RCReference<Iterator> finished_iterator;
+  mutex_lock lock(mu_);
+  --num_pending_elements_;
+  if (!element.eof.IsError() && element.eof.get()) {
+    finished_iterator = std::move(iterator);
+    --num_cycle_iterators_;
+    return;
+  }
+  // Errors are forwarded like elements, and the iterator stays in the cycle.
+  elements_.push(std::move(element));
+  idle_iterators_.push(std::move(iterator));
+}
+
 }  // namespace data
 }  // namespace tfrt
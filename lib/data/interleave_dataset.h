@@ -26,6 +26,7 @@
 #include "tfrt/data/dataset.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mpsc_queue.h"
 #include "tfrt/support/mutex.h"
 #include "tfrt/support/thread_annotations.h"
 
@@ -51,17 +52,25 @@ class InterleaveDatasetIterator;
 // returned Dataset objects, and cycle through them, producing `block_length`
 // consecutive elements from each iterator, and consuming the next input
 // element each time it reaches the end of an iterator.
+//
+// The intermediate iterators are opened on the blocking work queue, so that
+// iterators that are slow to open (e.g. files on network storage) are opened
+// in parallel. If `is_deterministic` is false, the dataset returns the
+// elements of the iterators in the cycle in the order they become available
+// ("sloppy" interleave), so that a slow iterator does not stall the others.
+// `block_length` is ignored in that case.
 class InterleaveDataset : public Dataset {
  public:
   explicit InterleaveDataset(RCReference<Dataset> input_dataset,
                              int64_t cycle_length, int64_t block_length,
                              RCReference<const Function> func, int64_t arity,
-                             HostContext* host)
+                             bool is_deterministic, HostContext* host)
       : input_dataset_(std::move(input_dataset)),
         cycle_length_(cycle_length),
         block_length_(block_length),
         prefetch_iterator_num_(cycle_length),
         arity_(arity),
+        is_deterministic_(is_deterministic),
         host_(host),
         allocator_(host->allocator()),
         func_(std::move(func)) {
@@ -73,11 +82,15 @@ class InterleaveDataset : public Dataset {
   InterleaveDataset(const InterleaveDataset&) = delete;
   InterleaveDataset& operator=(const InterleaveDataset&) = delete;
 
-  RCReference<Iterator> MakeIterator(const IteratorContext& context) override;
+  string_view name() const override { return "interleave"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
 
  private:
   // Allow iterator to rely on private data members of this dataset.
   friend class InterleaveDatasetIterator;
+  friend class NonDeterministicInterleaveDatasetIterator;
 
   void Destroy() override {
     internal::DestroyImpl<InterleaveDataset>(this, allocator_);
@@ -91,6 +104,7 @@ class InterleaveDataset : public Dataset {
   // cycle.
   const int64_t prefetch_iterator_num_;
   const int64_t arity_;
+  const bool is_deterministic_;
   HostContext* host_;
   HostAllocator* allocator_;
   RCReference<const Function> func_;
@@ -112,6 +126,8 @@ class InterleaveDatasetIterator : public Iterator {
     }
   }
 
+  ~InterleaveDatasetIterator() override { DrainOutputBufferBack(); }
+
   // This class is not copyable or movable.
   InterleaveDatasetIterator(const InterleaveDatasetIterator&) = delete;
   InterleaveDatasetIterator& operator=(const InterleaveDatasetIterator&) =
@@ -120,6 +136,12 @@ class InterleaveDatasetIterator : public Iterator {
   IterationResult GetNext(const ExecutionContext& exec_ctx) override;
 
  private:
+  // An IterationResult enqueued in output_buffer_back_.
+  struct PendingOutput : MpscQueueNode {
+    explicit PendingOutput(IterationResult r) : result(std::move(r)) {}
+    IterationResult result;
+  };
+
   // This struct contains the state for an intermediate iterator. The state is
   // needed by InterleaveDatasetIterator to return results in the expected order
   // and still be able to fetch multiple values from the intermeidate iterators
@@ -176,7 +198,7 @@ class InterleaveDatasetIterator : public Iterator {
   // background task. Otherwise, this method will schedule background task as
   // appropriate.
   void MaybeScheduleBackgroundTask(const ExecutionContext& exec_ctx,
-                                   bool is_token_owner, int callback_count)
+                                   bool is_token_owner)
       TFRT_EXCLUDES(mu_);
 
   // If the input iterator has not reached end, prefetch enough values from it
@@ -221,20 +243,26 @@ class InterleaveDatasetIterator : public Iterator {
   AsyncValue* FillOutputValues(const ExecutionContext& exec_ctx)
       TFRT_EXCLUDES(mu_);
 
+  // Move the values in output_buffer_back_ to output_buffer_front_. Only the
+  // token owner can call this method.
+  void DrainOutputBufferBack() {
+    while (PendingOutput* output = output_buffer_back_.Pop()) {
+      output_buffer_front_.push(std::move(output->result));
+      delete output;
+    }
+  }
+
   // Return the total number of values in the output buffers.
-  int OutputBufferSize() TFRT_EXCLUDES(mu_) {
-    mutex_lock lock(mu_);
-    return output_buffer_back_.size() + output_buffer_front_.size();
+  int OutputBufferSize() {
+    DrainOutputBufferBack();
+    return output_buffer_front_.size();
   }
 
   // Return the next value in the output buffer. Values in the
   // output_buffer_front_ should be returned before those values in
   // the output_buffer_back_.
-  IterationResult DequeueOutputBuffer() TFRT_EXCLUDES(mu_) {
-    if (output_buffer_front_.empty()) {
-      mutex_lock lock(mu_);
-      std::swap(output_buffer_front_, output_buffer_back_);
-    }
+  IterationResult DequeueOutputBuffer() {
+    if (output_buffer_front_.empty()) DrainOutputBufferBack();
     assert(!output_buffer_front_.empty());
     auto value = std::move(output_buffer_front_.front());
     output_buffer_front_.pop();
@@ -266,10 +294,11 @@ class InterleaveDatasetIterator : public Iterator {
   size_t total_queues_size_ = 0;
 
   mutex mu_;
-  // A queue of unavailable IterationResult enqueued by the caller of GetNext().
-  // This queue must be accessed with the mutex because it can be accessed by
-  // both GetNext() caller and the blocking threadpool.
-  std::queue<IterationResult> output_buffer_back_ TFRT_GUARDED_BY(mu_);
+  // A queue of unavailable IterationResult enqueued by the callers of
+  // GetNext() without the mutex. Only the token owner pops from it, or the
+  // caller of MaybeScheduleBackgroundTask() with the mutex when no thread owns
+  // the token.
+  MpscQueue<PendingOutput> output_buffer_back_;
   // A queue of unavailable IterationResult that are moved from
   // output_buffer_back_. This queue can be accessed without the mutex because
   // only the token owner can access it.
@@ -285,6 +314,76 @@ class InterleaveDatasetIterator : public Iterator {
   bool token_owned_ TFRT_GUARDED_BY(mu_);
 };
 
+// This iterator returns the elements of the intermediate iterators in the
+// order they become available. Each iterator in the cycle has up to one
+// pending GetNext(), as long as fewer than `cycle_length` elements are
+// buffered ahead of the outputs.
+class NonDeterministicInterleaveDatasetIterator : public Iterator {
+ public:
+  explicit NonDeterministicInterleaveDatasetIterator(
+      RCReference<InterleaveDataset> parent_dataset,
+      const IteratorContext& context)
+      : Iterator(),
+        parent_dataset_(std::move(parent_dataset)),
+        input_iterator_(parent_dataset_->input_dataset_->MakeIterator(context)),
+        context_(context) {}
+
+  // This class is not copyable or movable.
+  NonDeterministicInterleaveDatasetIterator(
+      const NonDeterministicInterleaveDatasetIterator&) = delete;
+  NonDeterministicInterleaveDatasetIterator& operator=(
+      const NonDeterministicInterleaveDatasetIterator&) = delete;
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  void Destroy() override {
+    internal::DestroyImpl<NonDeterministicInterleaveDatasetIterator>(
+        this, parent_dataset_->allocator_);
+  }
+
+  // Fetches values from the input iterator and the iterators in the cycle, and
+  // forwards the available elements to the pending outputs, as far as possible
+  // without waiting. The callbacks of the fetches call it again.
+  void Schedule(const ExecutionContext& exec_ctx) TFRT_EXCLUDES(mu_);
+
+  // Calls func_ on the fetched `input` and opens the iterator of the resulting
+  // dataset on the blocking work queue.
+  void HandleInput(IterationResult input, const ExecutionContext& exec_ctx)
+      TFRT_EXCLUDES(mu_);
+
+  // Creates the intermediate iterator of `dataset`.
+  void OpenIterator(RCReference<AsyncValue> dataset,
+                    const ExecutionContext& exec_ctx) TFRT_EXCLUDES(mu_);
+
+  // Buffers the available `element` fetched from `iterator`.
+  void HandleElement(RCReference<Iterator> iterator, IterationResult element)
+      TFRT_EXCLUDES(mu_);
+
+  RCReference<InterleaveDataset> parent_dataset_;
+  RCReference<Iterator> input_iterator_;
+  const IteratorContext context_;
+
+  mutex mu_;
+  // Unavailable results returned by GetNext().
+  std::queue<IterationResult> outputs_ TFRT_GUARDED_BY(mu_);
+  // Available elements and errors that are not forwarded to an output yet.
+  std::queue<IterationResult> elements_ TFRT_GUARDED_BY(mu_);
+  // Opened iterators that are not in the cycle yet.
+  std::queue<RCReference<Iterator>> opened_iterators_ TFRT_GUARDED_BY(mu_);
+  // Iterators in the cycle without a pending GetNext().
+  std::queue<RCReference<Iterator>> idle_iterators_ TFRT_GUARDED_BY(mu_);
+  // The number of iterators in the cycle, idle or not.
+  int64_t num_cycle_iterators_ TFRT_GUARDED_BY(mu_) = 0;
+  // The number of pending GetNext() of iterators in the cycle.
+  int64_t num_pending_elements_ TFRT_GUARDED_BY(mu_) = 0;
+  // The number of iterators that are being opened.
+  int64_t num_opening_iterators_ TFRT_GUARDED_BY(mu_) = 0;
+  // Whether a value is being fetched from input_iterator_.
+  bool is_fetching_input_ TFRT_GUARDED_BY(mu_) = false;
+  bool is_input_iterator_eof_ TFRT_GUARDED_BY(mu_) = false;
+};
+
 }  // namespace data
 }  // namespace tfrt
 
@@ -36,7 +36,7 @@ IterationResult PrefetchingIterator::GetNext(const ExecutionContext& exec_ctx) {
         prefetch_buffer_.size() <
             prefetch_threshold_ + output_buffer_.size() + 1) {
       auto task = [iterator = FormRef(this), exec_ctx]() {
-        TFRT_TRACE_SCOPE(Default, "ReadIOSource");
+        TFRT_TRACE_STATIC_SCOPE(Default, "ReadIOSource");
         iterator->ReadIOSource(exec_ctx);
       };
       // This call can fail if the work queue is full.
@@ -58,8 +58,8 @@ IterationResult PrefetchingIterator::GetNext(const ExecutionContext& exec_ctx) {
     if (!prefetch_buffer_.empty() && output_buffer_.empty()) {
       auto input = std::move(prefetch_buffer_.front());
       prefetch_buffer_.pop();
-      // An IterationResult from GetNextElement() should only contain available
-      // AsyncValues.
+      // An IterationResult from GetNextElement() should have an available
+      // eof.
       assert(input.eof.IsAvailable());
       if (input.eof.IsError()) {
         input.eof.GetAsyncValue()->SetErrorLocationIfUnset(
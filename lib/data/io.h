@@ -82,11 +82,11 @@ class PrefetchingIterator : public Iterator {
   // guarantees that all calls to this function will be properly synchronized.
   //
   // GetNextElement() is expected to run synchronously and returns an
-  // IterationResult that contains only available AsyncValues. And it should
-  // avoid decoding error location. This is because the location handler might
-  // have already been freed when this method is called by a blocking thread.
-  // PrefetchingIterator should set error location and emit the error when it
-  // forwards the error to an output value.
+  // IterationResult whose eof is available, its values may become available
+  // later. And it should avoid decoding error location. This is because the
+  // location handler might have already been freed when this method is called
+  // by a blocking thread. PrefetchingIterator should set error location and
+  // emit the error when it forwards the error to an output value.
   virtual IterationResult GetNextElement(const ExecutionContext& exec_cxt) = 0;
 
  private:
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the statistics collected for the iterators of an input
+// pipeline.
+
+#include "iterator_stats.h"
+
+#include <algorithm>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/metrics/metrics.h"
+#include "tfrt/support/string_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/packed_string_host_tensor.h"
+
+namespace tfrt {
+namespace data {
+namespace {
+
+int64_t ToNanoseconds(IteratorStats::Clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             time.time_since_epoch())
+      .count();
+}
+
+// The histograms of the stages with the same name.
+struct StageMetrics {
+  metrics::Histogram* produce_time_us;
+  metrics::Histogram* bytes;
+};
+
+StageMetrics GetStageMetrics(const std::string& name) {
+  static mutex* mu = new mutex;
+  static auto* stage_metrics = new llvm::StringMap<StageMetrics>;
+  mutex_lock lock(*mu);
+  auto it = stage_metrics->find(name);
+  if (it != stage_metrics->end()) return it->second;
+
+  // Powers of 4 from 1us to ~17s, and from 64B to 1GiB.
+  std::vector<double> time_bounds, byte_bounds;
+  for (double bound = 1; bound < 2e7; bound *= 4) time_bounds.push_back(bound);
+  for (double bound = 64; bound <= (1 << 30); bound *= 4)
+    byte_bounds.push_back(bound);
+  auto metric_name = [&](const char* metric) {
+    return StrCat("/tfrt/data/", name, "/", metric);
+  };
+  StageMetrics result{
+      metrics::NewHistogram(metric_name("produce_time_us"),
+                            metrics::Buckets::Explicit(std::move(time_bounds))),
+      metrics::NewHistogram(
+          metric_name("bytes"),
+          metrics::Buckets::Explicit(std::move(byte_bounds)))};
+  stage_metrics->try_emplace(name, result);
+  return result;
+}
+
+}  // namespace
+
+size_t EstimateBytes(const IterationResult& result) {
+  size_t bytes = 0;
+  for (auto& value : result.values) {
+    if (!value->IsConcrete()) continue;
+    if (value->IsType<DenseHostTensor>()) {
+      bytes += value->get<DenseHostTensor>().DataSizeInBytes();
+    } else if (value->IsType<PackedStringHostTensor>()) {
+      auto offsets = value->get<PackedStringHostTensor>().offsets();
+      bytes += offsets.back() - offsets.front();
+    } else if (value->IsType<std::string>()) {
+      bytes += value->get<std::string>().size();
+    }
+  }
+  return bytes;
+}
+
+//===----------------------------------------------------------------------===//
+// IteratorStats methods
+//===----------------------------------------------------------------------===//
+IteratorStats::IteratorStats(std::string name, IteratorStats* consumer)
+    : name_(std::move(name)),
+      consumer_(consumer),
+      produce_time_us_metric_(GetStageMetrics(name_).produce_time_us),
+      bytes_metric_(GetStageMetrics(name_).bytes) {}
+
+void IteratorStats::RecordGetNext(Clock::time_point start,
+                                  Clock::time_point returned) {
+  num_calls_.fetch_add(1, std::memory_order_relaxed);
+  blocked_ns_.fetch_add(ToNanoseconds(returned) - ToNanoseconds(start),
+                        std::memory_order_relaxed);
+  int64_t expected = 0;
+  first_call_ns_.compare_exchange_strong(expected, ToNanoseconds(start),
+                                         std::memory_order_relaxed);
+}
+
+void IteratorStats::RecordReady(Clock::time_point start,
+                                Clock::time_point ready, size_t bytes,
+                                bool is_element) {
+  const int64_t produce_ns = ToNanoseconds(ready) - ToNanoseconds(start);
+  int64_t last_ready = last_ready_ns_.load(std::memory_order_relaxed);
+  while (last_ready < ToNanoseconds(ready) &&
+         !last_ready_ns_.compare_exchange_weak(last_ready,
+                                               ToNanoseconds(ready),
+                                               std::memory_order_relaxed)) {
+  }
+  if (!is_element) return;
+  num_elements_.fetch_add(1, std::memory_order_relaxed);
+  num_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  produce_ns_.fetch_add(produce_ns, std::memory_order_relaxed);
+  produce_time_us_metric_->Record(produce_ns / 1000.0);
+  bytes_metric_->Record(bytes);
+}
+
+std::chrono::nanoseconds IteratorStats::active_time() const {
+  const int64_t first_call = first_call_ns_.load();
+  const int64_t last_ready = last_ready_ns_.load();
+  return std::chrono::nanoseconds(
+      first_call == 0 ? 0 : std::max<int64_t>(last_ready - first_call, 0));
+}
+
+//===----------------------------------------------------------------------===//
+// PipelineStats methods
+//===----------------------------------------------------------------------===//
+IteratorStats* PipelineStats::GetStage(string_view name,
+                                       IteratorStats* consumer) {
+  mutex_lock lock(mu_);
+  for (auto& stage : stages_) {
+    if (stage->name() == name && stage->consumer() == consumer)
+      return stage.get();
+  }
+  stages_.push_back(std::make_unique<IteratorStats>(name.str(), consumer));
+  return stages_.back().get();
+}
+
+void PipelineStats::Print(raw_ostream& os) const {
+  mutex_lock lock(mu_);
+  auto average_us = [](std::chrono::nanoseconds time, int64_t count) {
+    return count == 0 ? 0.0 : time.count() / 1000.0 / count;
+  };
+
+  // The self time of each stage, see the comment of Print().
+  std::vector<double> self_us(stages_.size());
+  for (size_t i = 0; i < stages_.size(); ++i) {
+    const IteratorStats& stage = *stages_[i];
+    double inputs_us = 0;
+    for (const auto& input : stages_) {
+      if (input->consumer() != &stage || stage.num_elements() == 0) continue;
+      const double inputs_per_element =
+          static_cast<double>(input->num_elements()) / stage.num_elements();
+      inputs_us = std::max(
+          inputs_us, inputs_per_element * average_us(input->produce_time(),
+                                                     input->num_elements()));
+    }
+    self_us[i] = std::max(
+        average_us(stage.produce_time(), stage.num_elements()) - inputs_us,
+        0.0);
+  }
+
+  os << "stage                      elements        bytes   produce_us      "
+        "self_us   blocked_us   elements/s\n";
+  // The stages are listed from the last stage of the pipeline, and each stage
+  // is followed by its inputs.
+  size_t bottleneck = stages_.size();
+  auto print_stage = [&](auto& print_stage, const IteratorStats* consumer,
+                         int depth) -> void {
+    for (size_t i = 0; i < stages_.size(); ++i) {
+      const IteratorStats& stage = *stages_[i];
+      if (stage.consumer() != consumer) continue;
+      if (bottleneck == stages_.size() || self_us[i] > self_us[bottleneck])
+        bottleneck = i;
+      const double active_s = stage.active_time().count() / 1e9;
+      os << llvm::format(
+          "%-24s %10lld %12lld %12.1f %12.1f %12.1f %12.1f\n",
+          (std::string(2 * depth, ' ') + stage.name()).c_str(),
+          static_cast<long long>(stage.num_elements()),
+          static_cast<long long>(stage.num_bytes()),
+          average_us(stage.produce_time(), stage.num_elements()), self_us[i],
+          average_us(stage.blocked_time(), stage.num_calls()),
+          active_s > 0 ? stage.num_elements() / active_s : 0.0);
+      print_stage(print_stage, &stage, depth + 1);
+    }
+  };
+  print_stage(print_stage, nullptr, 0);
+  if (bottleneck != stages_.size())
+    os << "Likely bottleneck: " << stages_[bottleneck]->name() << "\n";
+}
+
+//===----------------------------------------------------------------------===//
+// InstrumentedIterator methods
+//===----------------------------------------------------------------------===//
+IterationResult InstrumentedIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  const auto start = IteratorStats::Clock::now();
+  auto result = input_->GetNext(exec_ctx);
+  stats_->RecordGetNext(start, IteratorStats::Clock::now());
+  RunWhenReady(result.AsyncValues(), [result = result.CopyRef(),
+                                      stats = stats_, start,
+                                      pipeline_stats = pipeline_stats_]() {
+    const bool is_element = !result.eof.IsError() && !result.eof.get();
+    stats->RecordReady(start, IteratorStats::Clock::now(),
+                       is_element ? EstimateBytes(result) : 0, is_element);
+  });
+  return result;
+}
+
+void InstrumentedIterator::Destroy() {
+  // Keep the pipeline stats alive until this iterator is deallocated.
+  auto pipeline_stats = pipeline_stats_;
+  internal::DestroyImpl<InstrumentedIterator>(
+      this, pipeline_stats->host()->allocator());
+}
+
+}  // namespace data
+}  // namespace tfrt
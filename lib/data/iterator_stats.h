@@ -0,0 +1,163 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the statistics collected for the iterators of an input
+// pipeline, to find the stage that limits its throughput.
+
+#ifndef TFRT_LIB_DATA_ITERATOR_STATS_H_
+#define TFRT_LIB_DATA_ITERATOR_STATS_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tfrt/data/dataset.h"
+#include "tfrt/metrics/histogram.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace data {
+
+// Returns the size of the tensors and strings in the values of `result`, which
+// are not required to be available.
+size_t EstimateBytes(const IterationResult& result);
+
+// The statistics of the iterators of a pipeline stage, i.e. of a dataset. The
+// iterators of the same dataset under the same consumer stage share them, e.g.
+// the iterators that an interleave stage creates for each of its inputs.
+class IteratorStats {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  IteratorStats(std::string name, IteratorStats* consumer);
+
+  const std::string& name() const { return name_; }
+  // The stage that reads the elements of this stage, or null for the last
+  // stage of the pipeline.
+  IteratorStats* consumer() const { return consumer_; }
+
+  // Records a GetNext() call that started at `start` and returned at
+  // `returned`.
+  void RecordGetNext(Clock::time_point start, Clock::time_point returned);
+
+  // Records that the element requested at `start` became available at `ready`.
+  // `bytes` is the size of the element, and `is_element` is false at the end
+  // of the iteration or on error.
+  void RecordReady(Clock::time_point start, Clock::time_point ready,
+                   size_t bytes, bool is_element);
+
+  int64_t num_calls() const { return num_calls_.load(); }
+  int64_t num_elements() const { return num_elements_.load(); }
+  int64_t num_bytes() const { return num_bytes_.load(); }
+  // The total time spent in GetNext() calls, which the caller is blocked for.
+  std::chrono::nanoseconds blocked_time() const {
+    return std::chrono::nanoseconds(blocked_ns_.load());
+  }
+  // The total time from GetNext() calls until their elements are available.
+  std::chrono::nanoseconds produce_time() const {
+    return std::chrono::nanoseconds(produce_ns_.load());
+  }
+  // The time from the first GetNext() call until the last element became
+  // available.
+  std::chrono::nanoseconds active_time() const;
+
+ private:
+  const std::string name_;
+  IteratorStats* const consumer_;
+  // Histograms of the metrics registry, shared by the stages with this name.
+  metrics::Histogram* const produce_time_us_metric_;
+  metrics::Histogram* const bytes_metric_;
+
+  std::atomic<int64_t> num_calls_{0};
+  std::atomic<int64_t> num_elements_{0};
+  std::atomic<int64_t> num_bytes_{0};
+  std::atomic<int64_t> blocked_ns_{0};
+  std::atomic<int64_t> produce_ns_{0};
+  // Nanoseconds since the clock epoch.
+  std::atomic<int64_t> first_call_ns_{0};
+  std::atomic<int64_t> last_ready_ns_{0};
+};
+
+// Collects the IteratorStats of the stages of a pipeline. Set it in the
+// IteratorContext of the iterator of the last stage, and Dataset::MakeIterator
+// instruments every iterator created from that context.
+class PipelineStats {
+ public:
+  // If `summary_os` is not null, the stats are printed to it when this object
+  // is destroyed, i.e. when the iterators of the pipeline are destroyed.
+  explicit PipelineStats(HostContext* host, raw_ostream* summary_os = nullptr)
+      : host_(host), summary_os_(summary_os) {}
+
+  ~PipelineStats() {
+    if (summary_os_) Print(*summary_os_);
+  }
+
+  HostContext* host() const { return host_; }
+
+  // Returns the stats of the stage `name` read by `consumer`.
+  IteratorStats* GetStage(string_view name, IteratorStats* consumer)
+      TFRT_EXCLUDES(mu_);
+
+  // Prints a table with the stats of each stage.
+  //
+  // The self time of a stage is its average produce time per element minus the
+  // produce time of the input elements it consumes per element. The stage with
+  // the largest self time is reported as the likely bottleneck. This does not
+  // account for the parallelism of the stages, so a parallel stage may be
+  // reported even if its throughput is sufficient.
+  void Print(raw_ostream& os) const TFRT_EXCLUDES(mu_);
+
+ private:
+  HostContext* const host_;
+  raw_ostream* const summary_os_;
+  mutable mutex mu_;
+  std::vector<std::unique_ptr<IteratorStats>> stages_ TFRT_GUARDED_BY(mu_);
+};
+
+// Forwards the calls to an iterator and records them in `stats`. Keeps
+// `pipeline_stats` alive.
+class InstrumentedIterator : public Iterator {
+ public:
+  InstrumentedIterator(RCReference<Iterator> input,
+                       std::shared_ptr<PipelineStats> pipeline_stats,
+                       IteratorStats* stats)
+      : Iterator(),
+        input_(std::move(input)),
+        pipeline_stats_(std::move(pipeline_stats)),
+        stats_(stats) {}
+
+  // This class is not copyable or movable.
+  InstrumentedIterator(const InstrumentedIterator&) = delete;
+  InstrumentedIterator& operator=(const InstrumentedIterator&) = delete;
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  void Destroy() override;
+
+  RCReference<Iterator> input_;
+  std::shared_ptr<PipelineStats> pipeline_stats_;
+  IteratorStats* stats_;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_ITERATOR_STATS_H_
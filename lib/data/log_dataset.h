@@ -21,8 +21,11 @@
 
 #include <queue>
 
+#include "iterator_stats.h"
+#include "llvm/Support/Format.h"
 #include "llvm_derived/Support/raw_ostream.h"
 #include "tfrt/data/dataset.h"
+#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
@@ -32,7 +35,8 @@ class LogDatasetIterator;
 
 // LogDataset wraps around another dataset instance and forwards values from
 // that dataset to its caller. It additionally logs the GetNext(...) calls to
-// facilitate MLIR unit tests.
+// facilitate MLIR unit tests, and the throughput of the input when the
+// iterator is destroyed.
 class LogDataset : public Dataset {
  public:
   explicit LogDataset(RCReference<Dataset> input_dataset, HostContext* host)
@@ -42,7 +46,10 @@ class LogDataset : public Dataset {
   LogDataset(const LogDataset&) = delete;
   LogDataset& operator=(const LogDataset&) = delete;
 
-  RCReference<Iterator> MakeIterator(const IteratorContext& context) override;
+  string_view name() const override { return "log"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
 
  private:
   // Allow iterator to rely on private data members of this dataset.
@@ -62,8 +69,20 @@ class LogDatasetIterator : public Iterator {
                               const IteratorContext& context)
       : Iterator(),
         parent_dataset_(std::move(parent_dataset)),
-        input_iterator_(
-            parent_dataset_->input_dataset_->MakeIterator(context)) {}
+        input_iterator_(parent_dataset_->input_dataset_->MakeIterator(context)),
+        stats_("log", /*consumer=*/nullptr) {}
+
+  ~LogDatasetIterator() override {
+    const double active_s = stats_.active_time().count() / 1e9;
+    tfrt::outs() << "LogDatasetIterator: " << stats_.num_elements()
+                 << " elements, " << stats_.num_bytes() << " bytes";
+    if (active_s > 0) {
+      tfrt::outs() << llvm::format(", %.1f elements/s, %.1f bytes/s",
+                                   stats_.num_elements() / active_s,
+                                   stats_.num_bytes() / active_s);
+    }
+    tfrt::outs() << "\n";
+  }
 
   // This class is not copyable or movable.
   LogDatasetIterator(const LogDatasetIterator&) = delete;
@@ -71,7 +90,18 @@ class LogDatasetIterator : public Iterator {
 
   IterationResult GetNext(const ExecutionContext& exec_ctx) override {
     tfrt::outs() << "LogDatasetIterator::GetNext called\n";
-    return input_iterator_->GetNext(exec_ctx);
+    const auto start = IteratorStats::Clock::now();
+    auto result = input_iterator_->GetNext(exec_ctx);
+    stats_.RecordGetNext(start, IteratorStats::Clock::now());
+    RunWhenReady(result.AsyncValues(),
+                 [iterator = FormRef(this), result = result.CopyRef(), start] {
+                   const bool is_element =
+                       !result.eof.IsError() && !result.eof.get();
+                   iterator->stats_.RecordReady(
+                       start, IteratorStats::Clock::now(),
+                       is_element ? EstimateBytes(result) : 0, is_element);
+                 });
+    return result;
   }
 
  private:
@@ -83,9 +113,10 @@ class LogDatasetIterator : public Iterator {
   RCReference<LogDataset> parent_dataset_;
   RCReference<Iterator> input_iterator_;
   std::queue<IterationResult> buffer_;
+  IteratorStats stats_;
 };
 
-inline RCReference<Iterator> LogDataset::MakeIterator(
+inline RCReference<Iterator> LogDataset::MakeIteratorImpl(
     const IteratorContext& context) {
   return TakeRef(host_->Construct<LogDatasetIterator>(FormRef(this), context));
 }
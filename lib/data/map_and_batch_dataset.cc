@@ -0,0 +1,220 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements MapAndBatchDataset class which wraps around another
+// Dataset instance and batches the results of a function over its elements,
+// with the function writing each result into the batch tensor.
+
+#include "map_and_batch_dataset.h"
+
+#include <atomic>
+
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace data {
+namespace {
+
+// The state of a batch whose slots are being filled.
+class Batch {
+ public:
+  Batch(int64_t batch_size, TensorMetadata element_metadata,
+        RCReference<HostBuffer> buffer, AsyncValueRef<DenseHostTensor> result)
+      : batch_size_(batch_size),
+        element_metadata_(std::move(element_metadata)),
+        buffer_(std::move(buffer)),
+        result_(std::move(result)),
+        num_pending_(batch_size) {}
+
+  const TensorMetadata& element_metadata() const { return element_metadata_; }
+
+  // Returns the slot at `index` of the batch tensor.
+  DenseHostTensor GetSlot(int64_t index) const {
+    const size_t slot_size = element_metadata_.GetHostSizeInBytes();
+    auto slot = HostBuffer::CreateFromExternal(buffer_.CopyRef(),
+                                               index * slot_size, slot_size);
+    return DenseHostTensor(element_metadata_, std::move(slot));
+  }
+
+  // Marks a slot whose input is past the end of the iteration as done.
+  void OnEof(const ExecutionContext& exec_ctx) {
+    num_eof_.fetch_add(1);
+    OnSlotDone(exec_ctx);
+  }
+
+  // Marks a slot as failed with `error`.
+  void OnError(RCReference<AsyncValue> error,
+               const ExecutionContext& exec_ctx) {
+    // Keep the first error.
+    AsyncValue* null_value = nullptr;
+    AsyncValue* error_value = error.release();
+    if (!error_.compare_exchange_strong(null_value, error_value,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+      error_value->DropRef();
+    }
+    OnSlotDone(exec_ctx);
+  }
+
+  // Marks a slot as done. When all slots are done, sets the result and deletes
+  // the batch.
+  void OnSlotDone(const ExecutionContext& exec_ctx) {
+    if (num_pending_.fetch_sub(1) != 1) return;
+
+    auto* error_value = error_.load(std::memory_order_acquire);
+    const int64_t size = batch_size_ - num_eof_.load();
+    if (error_value != nullptr) {
+      result_.SetError(error_value->GetError());
+      error_value->DropRef();
+    } else if (size == 0) {
+      result_.SetError(
+          MakeErrorAsyncValueRef(exec_ctx.host(), "iterator reached end")
+              ->GetError());
+    } else {
+      // A partial batch at the end of the iteration is a prefix of the buffer.
+      SmallVector<ssize_t, 4> dims;
+      dims.push_back(size);
+      for (int i = 0; i < element_metadata_.shape.GetRank(); ++i)
+        dims.push_back(element_metadata_.shape.GetDimensionSize(i));
+      TensorMetadata metadata(element_metadata_.dtype, dims);
+      auto buffer =
+          size == batch_size_
+              ? std::move(buffer_)
+              : HostBuffer::CreateFromExternal(
+                    std::move(buffer_), /*offset=*/0,
+                    metadata.GetHostSizeInBytes());
+      result_.emplace(metadata, std::move(buffer));
+    }
+    delete this;
+  }
+
+ private:
+  const int64_t batch_size_;
+  const TensorMetadata element_metadata_;
+  RCReference<HostBuffer> buffer_;
+  AsyncValueRef<DenseHostTensor> result_;
+  std::atomic<int64_t> num_pending_;
+  std::atomic<int64_t> num_eof_{0};
+  std::atomic<AsyncValue*> error_{nullptr};
+};
+
+// Invokes `map_fn` on `arguments` and the slot at `index` of `batch`, and marks
+// the slot as done when the function's results are available.
+void FillSlot(const Function* map_fn,
+              SmallVector<RCReference<AsyncValue>, 4> arguments,
+              Batch* batch, int64_t index, const ExecutionContext& exec_ctx) {
+  arguments.push_back(MakeAvailableAsyncValueRef<DenseHostTensor>(
+                          exec_ctx.host(), batch->GetSlot(index))
+                          .ReleaseRCRef());
+  SmallVector<AsyncValue*, 4> argument_ptrs;
+  for (auto& argument : arguments) argument_ptrs.push_back(argument.get());
+
+  SmallVector<RCReference<AsyncValue>, 4> results;
+  results.resize(map_fn->result_types().size());
+  map_fn->Execute(exec_ctx, argument_ptrs, results);
+
+  SmallVector<AsyncValue*, 4> result_ptrs;
+  for (auto& result : results) result_ptrs.push_back(result.get());
+  RunWhenReady(result_ptrs, [results = std::move(results),
+                             arguments = std::move(arguments), batch,
+                             exec_ctx]() {
+    for (auto& result : results) {
+      if (result->IsError()) return batch->OnError(result.CopyRef(), exec_ctx);
+    }
+    batch->OnSlotDone(exec_ctx);
+  });
+}
+
+}  // namespace
+
+//===----------------------------------------------------------------------===//
+// MapAndBatchDataset methods
+//===----------------------------------------------------------------------===//
+RCReference<Iterator> MapAndBatchDataset::MakeIteratorImpl(
+    const IteratorContext& context) {
+  return TakeRef(
+      host_->Construct<MapAndBatchDatasetIterator>(FormRef(this), context));
+}
+
+//===----------------------------------------------------------------------===//
+// MapAndBatchDatasetIterator methods
+//===----------------------------------------------------------------------===//
+IterationResult MapAndBatchDatasetIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  const int64_t batch_size = parent_dataset_->batch_size_;
+  const TensorMetadata& element_metadata = parent_dataset_->element_metadata_;
+
+  SmallVector<IterationResult, 4> inputs;
+  for (int64_t i = 0; i < batch_size; ++i) {
+    inputs.push_back(input_iterator_->GetNext(exec_ctx));
+  }
+
+  // The batch tensor is allocated upfront, so that every slot can be written
+  // as soon as its input is available.
+  auto buffer = HostBuffer::CreateUninitialized(
+      batch_size * element_metadata.GetHostSizeInBytes(),
+      element_metadata.dtype.GetHostAlignment(), host->allocator());
+  if (!buffer) {
+    return IterationResult::Error(
+        EmitErrorAsync(exec_ctx, "failed to allocate batch tensor"), 1);
+  }
+
+  auto result = MakeUnconstructedAsyncValueRef<DenseHostTensor>(host);
+  auto* batch = new Batch(batch_size, element_metadata, std::move(buffer),
+                          result.CopyRef());
+  // result's eof should be exactly the same as the eof of the first input.
+  auto eof = inputs[0].eof.CopyRef();
+
+  for (int64_t i = 0; i < batch_size; ++i) {
+    SmallVector<RCReference<AsyncValue>, 4> arguments;
+    for (auto* value : parent_dataset_->additional_fn_args_.values())
+      arguments.push_back(FormRef(value));
+    for (auto& value : inputs[i].values) arguments.push_back(std::move(value));
+
+    SmallVector<AsyncValue*, 4> async_value_ptrs;
+    for (auto& argument : arguments) async_value_ptrs.push_back(argument.get());
+    async_value_ptrs.push_back(inputs[i].eof.GetAsyncValue());
+
+    RunWhenReady(async_value_ptrs, [dataset = parent_dataset_.CopyRef(),
+                                    arguments = std::move(arguments),
+                                    input_eof = std::move(inputs[i].eof),
+                                    batch, index = i, exec_ctx]() mutable {
+      if (input_eof.IsError())
+        return batch->OnError(input_eof.ReleaseRCRef(), exec_ctx);
+      if (input_eof.get()) return batch->OnEof(exec_ctx);
+      for (auto& argument : arguments) {
+        if (argument->IsError())
+          return batch->OnError(std::move(argument), exec_ctx);
+      }
+      EnqueueWork(exec_ctx, [dataset = std::move(dataset),
+                             arguments = std::move(arguments), batch, index,
+                             exec_ctx]() mutable {
+        FillSlot(dataset->map_fn_.get(), std::move(arguments), batch, index,
+                 exec_ctx);
+      });
+    });
+  }
+
+  SmallVector<RCReference<AsyncValue>, 4> values;
+  values.push_back(result.ReleaseRCRef());
+  return IterationResult::Pending(std::move(values), std::move(eof));
+}
+
+}  // namespace data
+}  // namespace tfrt
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares MapAndBatchDataset class which wraps around another
+// Dataset instance and batches the results of a function over its elements,
+// with the function writing each result into the batch tensor.
+
+#ifndef TFRT_LIB_DATA_MAP_AND_BATCH_DATASET_H_
+#define TFRT_LIB_DATA_MAP_AND_BATCH_DATASET_H_
+
+#include "tfrt/data/dataset.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+namespace data {
+
+class MapAndBatchDatasetIterator;
+
+// MapAndBatchDataset maps a user-defined function over the elements in its
+// input dataset, and batches the results into a DenseHostTensor with +1
+// dimension, like a MapDataset followed by a BatchDataset.
+//
+// Instead of returning its result, the function writes it into its slot of
+// the batch tensor, which is allocated before the function is invoked. The
+// slot is passed to the function as a DenseHostTensor with
+// `element_metadata`, after the additional arguments and the element. The
+// function returns when the slot is written, e.g. with a chain. This saves
+// the copy of every element that BatchDataset makes. The slots of a batch are
+// filled in parallel on the work queue.
+class MapAndBatchDataset : public Dataset {
+ public:
+  explicit MapAndBatchDataset(RCReference<Dataset> input_dataset,
+                              int64_t batch_size,
+                              RCArray<AsyncValue> additional_fn_args,
+                              RCReference<const Function> map_fn,
+                              const TensorMetadata& element_metadata,
+                              HostContext* host)
+      : input_dataset_(std::move(input_dataset)),
+        batch_size_(batch_size),
+        host_(host),
+        allocator_(host->allocator()),
+        additional_fn_args_(std::move(additional_fn_args)),
+        map_fn_(std::move(map_fn)),
+        element_metadata_(element_metadata) {
+    assert(batch_size_ > 0);
+  }
+
+  // This class is not copyable or movable.
+  MapAndBatchDataset(const MapAndBatchDataset&) = delete;
+  MapAndBatchDataset& operator=(const MapAndBatchDataset&) = delete;
+
+  string_view name() const override { return "map_and_batch"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
+
+ private:
+  // Allow iterator to rely on private data members of this dataset.
+  friend class MapAndBatchDatasetIterator;
+
+  void Destroy() override {
+    internal::DestroyImpl<MapAndBatchDataset>(this, allocator_);
+  }
+
+  RCReference<Dataset> input_dataset_;
+  const int64_t batch_size_;
+  HostContext* host_;
+  HostAllocator* allocator_;
+  RCArray<AsyncValue> additional_fn_args_;
+  RCReference<const Function> map_fn_;
+  // The metadata of the slot of each element in the batch tensor.
+  const TensorMetadata element_metadata_;
+};
+
+class MapAndBatchDatasetIterator : public Iterator {
+ public:
+  explicit MapAndBatchDatasetIterator(
+      RCReference<MapAndBatchDataset> parent_dataset,
+      const IteratorContext& context)
+      : Iterator(),
+        parent_dataset_(std::move(parent_dataset)),
+        input_iterator_(
+            parent_dataset_->input_dataset_->MakeIterator(context)) {}
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  // This class is not copyable or movable.
+  MapAndBatchDatasetIterator(const MapAndBatchDatasetIterator&) = delete;
+  MapAndBatchDatasetIterator& operator=(const MapAndBatchDatasetIterator&) =
+      delete;
+
+  void Destroy() override {
+    internal::DestroyImpl<MapAndBatchDatasetIterator>(
+        this, parent_dataset_->allocator_);
+  }
+
+  RCReference<MapAndBatchDataset> parent_dataset_;
+  RCReference<Iterator> input_iterator_;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_MAP_AND_BATCH_DATASET_H_
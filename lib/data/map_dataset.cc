@@ -25,7 +25,8 @@ namespace data {
 //===----------------------------------------------------------------------===//
 // MapDataset methods
 //===----------------------------------------------------------------------===//
-RCReference<Iterator> MapDataset::MakeIterator(const IteratorContext& context) {
+RCReference<Iterator> MapDataset::MakeIteratorImpl(
+    const IteratorContext& context) {
   return TakeRef(host_->Construct<MapDatasetIterator>(FormRef(this), context));
 }
 
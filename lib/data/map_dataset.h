@@ -47,7 +47,10 @@ class MapDataset : public Dataset {
   MapDataset(const MapDataset&) = delete;
   MapDataset& operator=(const MapDataset&) = delete;
 
-  RCReference<Iterator> MakeIterator(const IteratorContext& context) override;
+  string_view name() const override { return "map"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
 
  private:
   // Allow iterator to rely on private data members of this dataset.
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements PaddedBatchDataset class which wraps around another
+// Dataset instance and batches its elements, padding the components of each
+// batch to the largest shape in the batch.
+
+#include "padded_batch_dataset.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace data {
+
+template <typename T>
+static void Fill(void* data, size_t num_elements, double value) {
+  auto* begin = static_cast<T*>(data);
+  std::fill(begin, begin + num_elements, static_cast<T>(value));
+}
+
+// Sets `num_elements` elements of type `dtype` at `data` to `value`. Returns
+// false if `dtype` does not support the value.
+static bool FillWithPadding(DType dtype, double value, void* data,
+                            size_t num_elements) {
+  if (value == 0) {
+    std::memset(data, 0, num_elements * dtype.GetHostSize());
+    return true;
+  }
+  switch (dtype.kind()) {
+    case DType::I1:
+      Fill<bool>(data, num_elements, value);
+      return true;
+    case DType::I8:
+      Fill<int8_t>(data, num_elements, value);
+      return true;
+    case DType::I16:
+      Fill<int16_t>(data, num_elements, value);
+      return true;
+    case DType::I32:
+      Fill<int32_t>(data, num_elements, value);
+      return true;
+    case DType::I64:
+      Fill<int64_t>(data, num_elements, value);
+      return true;
+    case DType::UI8:
+      Fill<uint8_t>(data, num_elements, value);
+      return true;
+    case DType::UI16:
+      Fill<uint16_t>(data, num_elements, value);
+      return true;
+    case DType::UI32:
+      Fill<uint32_t>(data, num_elements, value);
+      return true;
+    case DType::UI64:
+      Fill<uint64_t>(data, num_elements, value);
+      return true;
+    case DType::F32:
+      Fill<float>(data, num_elements, value);
+      return true;
+    case DType::F64:
+      Fill<double>(data, num_elements, value);
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Copies `element` into `dst`, a row major buffer of shape `padded_dims`.
+static void CopyToPadded(const DenseHostTensor& element,
+                         ArrayRef<ssize_t> padded_dims, char* dst) {
+  SmallVector<ssize_t, 4> dims;
+  element.shape().GetDimensions(&dims);
+  const int rank = dims.size();
+
+  // The innermost dimensions that are not padded are contiguous in `dst`, so
+  // they are copied together.
+  int inner = rank;
+  size_t chunk_size = element.dtype().GetHostSize();
+  while (inner > 0 && dims[inner - 1] == padded_dims[inner - 1])
+    chunk_size *= dims[--inner];
+  const char* src = static_cast<const char*>(element.data());
+  if (inner == 0) {
+    std::memcpy(dst, src, chunk_size);
+    return;
+  }
+
+  // Copy a row of the innermost padded dimension at a time.
+  const size_t row_size = dims[inner - 1] * chunk_size;
+  SmallVector<size_t, 4> strides(rank);
+  size_t stride = element.dtype().GetHostSize();
+  for (int i = rank - 1; i >= 0; --i) {
+    strides[i] = stride;
+    stride *= padded_dims[i];
+  }
+  const int num_outer = inner - 1;
+  size_t num_rows = 1;
+  for (int i = 0; i < num_outer; ++i) num_rows *= dims[i];
+  if (row_size == 0) return;
+
+  SmallVector<ssize_t, 4> index(num_outer, 0);
+  for (size_t row = 0; row < num_rows; ++row) {
+    size_t offset = 0;
+    for (int i = 0; i < num_outer; ++i) offset += index[i] * strides[i];
+    std::memcpy(dst + offset, src, row_size);
+    src += row_size;
+    for (int i = num_outer - 1; i >= 0 && ++index[i] == dims[i]; --i)
+      index[i] = 0;
+  }
+}
+
+llvm::Expected<SmallVector<RCReference<AsyncValue>, 4>> PadAndBatch(
+    ArrayRef<SmallVector<RCReference<AsyncValue>, 4>> elements,
+    double padding_value, HostContext* host) {
+  assert(!elements.empty());
+  SmallVector<RCReference<AsyncValue>, 4> results;
+  for (size_t component = 0, e = elements[0].size(); component < e;
+       ++component) {
+    // Compute the largest shape of the component.
+    const DenseHostTensor* first = nullptr;
+    SmallVector<ssize_t, 4> padded_dims;
+    bool is_padded = false;
+    for (const auto& element : elements) {
+      const auto& value = element[component];
+      if (!value->IsType<DenseHostTensor>())
+        return MakeStringError("padded batch expects DenseHostTensor inputs");
+      const auto& tensor = value->get<DenseHostTensor>();
+      if (first == nullptr) {
+        first = &tensor;
+        tensor.shape().GetDimensions(&padded_dims);
+        continue;
+      }
+      if (tensor.dtype() != first->dtype() ||
+          tensor.shape().GetRank() != first->shape().GetRank())
+        return MakeStringError(
+            "padded batch expects inputs with the same dtype and rank, got ",
+            first->metadata(), " and ", tensor.metadata());
+      for (int i = 0, rank = padded_dims.size(); i < rank; ++i) {
+        const ssize_t size = tensor.shape().GetDimensionSize(i);
+        if (size == padded_dims[i]) continue;
+        padded_dims[i] = std::max(padded_dims[i], size);
+        is_padded = true;
+      }
+    }
+
+    SmallVector<ssize_t, 4> batch_dims;
+    batch_dims.push_back(elements.size());
+    batch_dims.append(padded_dims.begin(), padded_dims.end());
+    auto result = DenseHostTensor::CreateUninitialized(
+        TensorMetadata(first->dtype(), batch_dims), host);
+    if (!result) return MakeStringError("out of memory padding a batch");
+
+    char* data = static_cast<char*>(result->data());
+    if (is_padded && !FillWithPadding(first->dtype(), padding_value, data,
+                                      result->NumElements()))
+      return MakeStringError("padding value ", padding_value,
+                             " is not supported for dtype ", first->dtype());
+
+    const size_t element_size =
+        result->NumElements() / elements.size() * first->dtype().GetHostSize();
+    for (size_t i = 0; i < elements.size(); ++i) {
+      CopyToPadded(elements[i][component]->get<DenseHostTensor>(), padded_dims,
+                   data + i * element_size);
+    }
+    results.push_back(
+        MakeAvailableAsyncValueRef<DenseHostTensor>(host, std::move(*result)));
+  }
+  return std::move(results);
+}
+
+//===----------------------------------------------------------------------===//
+// PaddedBatchDataset methods
+//===----------------------------------------------------------------------===//
+RCReference<Iterator> PaddedBatchDataset::MakeIteratorImpl(
+    const IteratorContext& context) {
+  return TakeRef(
+      host_->Construct<PaddedBatchDatasetIterator>(FormRef(this), context));
+}
+
+//===----------------------------------------------------------------------===//
+// PaddedBatchDatasetIterator methods
+//===----------------------------------------------------------------------===//
+IterationResult PaddedBatchDatasetIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  auto* host = exec_ctx.host();
+
+  // Fetch the inputs of the batch, then pad them once their shapes are known.
+  SmallVector<IterationResult, 4> inputs;
+  SmallVector<AsyncValue*, 8> async_values;
+  for (int64_t i = 0; i < parent_dataset_->batch_size_; ++i) {
+    inputs.push_back(input_iterator_->GetNext(exec_ctx));
+    for (auto* value : inputs.back().AsyncValues())
+      async_values.push_back(value);
+  }
+
+  SmallVector<RCReference<AsyncValue>, 4> result_values;
+  SmallVector<RCReference<AsyncValue>, 4> pending_values;
+  for (size_t i = 0, e = inputs[0].values.size(); i < e; ++i) {
+    result_values.push_back(MakeIndirectAsyncValue(host));
+    pending_values.push_back(result_values.back().CopyRef());
+  }
+  auto result = IterationResult::Pending(std::move(pending_values),
+                                         inputs[0].eof.CopyRef());
+
+  RunWhenReady(async_values, [host,
+                              padding_value = parent_dataset_->padding_value_,
+                              inputs = std::move(inputs),
+                              result_values =
+                                  std::move(result_values)]() mutable {
+    auto set_error = [&](const DecodedDiagnostic& error) {
+      for (auto& value : result_values) value->SetError(error);
+    };
+    // The eof of the batch is the eof of its first input.
+    if (inputs[0].eof.IsError()) return set_error(inputs[0].eof.GetError());
+    if (inputs[0].eof.get()) {
+      auto error = MakeErrorAsyncValueRef(host, "iterator reached end");
+      return set_error(error->GetError());
+    }
+
+    SmallVector<SmallVector<RCReference<AsyncValue>, 4>, 4> elements;
+    for (auto& input : inputs) {
+      if (input.eof.IsError()) return set_error(input.eof.GetError());
+      if (input.eof.get()) break;
+      for (auto& value : input.values) {
+        if (value->IsError()) return set_error(value->GetError());
+      }
+      elements.push_back(std::move(input.values));
+    }
+
+    auto batch = PadAndBatch(elements, padding_value, host);
+    if (!batch) {
+      auto error = MakeErrorAsyncValueRef(host, StrCat(batch.takeError()));
+      return set_error(error->GetError());
+    }
+    for (size_t i = 0; i < result_values.size(); ++i) {
+      cast<IndirectAsyncValue>(result_values[i].get())
+          ->ForwardTo(std::move((*batch)[i]));
+    }
+  });
+  return result;
+}
+
+}  // namespace data
+}  // namespace tfrt
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares PaddedBatchDataset class which wraps around another
+// Dataset instance and batches its elements, padding the components of each
+// batch to the largest shape in the batch.
+
+#ifndef TFRT_LIB_DATA_PADDED_BATCH_DATASET_H_
+#define TFRT_LIB_DATA_PADDED_BATCH_DATASET_H_
+
+#include "tfrt/data/dataset.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace data {
+
+class PaddedBatchDatasetIterator;
+
+// Stacks `elements`, each a list of available DenseHostTensor components, into
+// one DenseHostTensor per component. The components must have the same dtype
+// and rank in all elements. The shape of a batched component is the number of
+// elements followed by the largest size of each dimension over the elements,
+// and the positions that are past the end of an element hold `padding_value`.
+llvm::Expected<SmallVector<RCReference<AsyncValue>, 4>> PadAndBatch(
+    ArrayRef<SmallVector<RCReference<AsyncValue>, 4>> elements,
+    double padding_value, HostContext* host);
+
+// PaddedBatchDataset combines `batch_size` consecutive DenseHostTensor elements
+// of the underlying dataset into one element, like BatchDataset, but allows the
+// elements to have different shapes. Each batch is padded to its own largest
+// shape instead of a fixed shape, which keeps the padding of batches of short
+// sequences small. The last batch has less than `batch_size` elements if the
+// underlying dataset runs out.
+class PaddedBatchDataset : public Dataset {
+ public:
+  explicit PaddedBatchDataset(RCReference<Dataset> input_dataset,
+                              int64_t batch_size, double padding_value,
+                              HostContext* host)
+      : input_dataset_(std::move(input_dataset)),
+        batch_size_(batch_size),
+        padding_value_(padding_value),
+        host_(host),
+        allocator_(host->allocator()) {}
+
+  // This class is not copyable or movable.
+  PaddedBatchDataset(const PaddedBatchDataset&) = delete;
+  PaddedBatchDataset& operator=(const PaddedBatchDataset&) = delete;
+
+  string_view name() const override { return "padded_batch"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
+
+ private:
+  // Allow iterator to rely on private data members of this dataset.
+  friend class PaddedBatchDatasetIterator;
+
+  void Destroy() override {
+    internal::DestroyImpl<PaddedBatchDataset>(this, allocator_);
+  }
+
+  RCReference<Dataset> input_dataset_;
+  const int64_t batch_size_;
+  const double padding_value_;
+  HostContext* host_;
+  HostAllocator* allocator_;
+};
+
+class PaddedBatchDatasetIterator : public Iterator {
+ public:
+  explicit PaddedBatchDatasetIterator(
+      RCReference<PaddedBatchDataset> parent_dataset,
+      const IteratorContext& context)
+      : Iterator(),
+        parent_dataset_(std::move(parent_dataset)),
+        input_iterator_(
+            parent_dataset_->input_dataset_->MakeIterator(context)) {}
+
+  // This class is not copyable or movable.
+  PaddedBatchDatasetIterator(const PaddedBatchDatasetIterator&) = delete;
+  PaddedBatchDatasetIterator& operator=(const PaddedBatchDatasetIterator&) =
+      delete;
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  void Destroy() override {
+    internal::DestroyImpl<PaddedBatchDatasetIterator>(
+        this, parent_dataset_->allocator_);
+  }
+
+  RCReference<PaddedBatchDataset> parent_dataset_;
+  RCReference<Iterator> input_iterator_;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_PADDED_BATCH_DATASET_H_
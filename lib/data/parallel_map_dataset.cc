@@ -0,0 +1,188 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements ParallelMapDataset class which wraps around another
+// Dataset instance and transforms its elements with several function
+// invocations in flight.
+
+#include "parallel_map_dataset.h"
+
+#include "tfrt/host_context/async_dispatch.h"
+
+namespace tfrt {
+namespace data {
+
+//===----------------------------------------------------------------------===//
+// ParallelMapDataset methods
+//===----------------------------------------------------------------------===//
+RCReference<Iterator> ParallelMapDataset::MakeIteratorImpl(
+    const IteratorContext& context) {
+  return TakeRef(
+      host_->Construct<ParallelMapDatasetIterator>(FormRef(this), context));
+}
+
+//===----------------------------------------------------------------------===//
+// ParallelMapDatasetIterator methods
+//===----------------------------------------------------------------------===//
+
+static bool AvailableAndNotEof(const IterationResult& result) {
+  if (result.eof.IsConcrete() && result.eof.get()) return false;
+  if (!result.eof.IsAvailable()) return false;
+  for (auto& value : result.values) {
+    if (!value->IsAvailable()) return false;
+  }
+  return true;
+}
+
+IterationResult ParallelMapDatasetIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  if (num_parallel_calls_->is_tuned()) num_parallel_calls_->RecordConsumed();
+  if (buffer_size_->is_tuned()) buffer_size_->RecordConsumed();
+  if (autotuner_) autotuner_->MaybeTune();
+
+  while (buffer_.size() < buffer_size_->value() + 1) {
+    buffer_.push_back(MapAsync(input_iterator_->GetNext(exec_ctx), exec_ctx));
+    if (buffer_size_->is_tuned())
+      RecordWhenAvailable(buffer_.back(), buffer_size_);
+  }
+  if (!parent_dataset_->is_deterministic_) {
+    for (auto it = buffer_.begin(), e = buffer_.end(); it != e; ++it) {
+      if (AvailableAndNotEof(*it)) {
+        auto value = std::move(*it);
+        buffer_.erase(it);
+        return value;
+      }
+    }
+  }
+
+  auto result = std::move(buffer_.front());
+  buffer_.pop_front();
+  return result;
+}
+
+IterationResult ParallelMapDatasetIterator::MapAsync(
+    IterationResult input, const ExecutionContext& exec_ctx) {
+  const size_t num_results = parent_dataset_->map_fn_->result_types().size();
+
+  SmallVector<RCReference<AsyncValue>, 4> arguments;
+  SmallVector<AsyncValue*, 4> argument_ptrs;
+  for (auto* value : parent_dataset_->additional_fn_args_.values())
+    arguments.push_back(FormRef(value));
+  for (auto& value : input.values) arguments.push_back(std::move(value));
+  for (auto& argument : arguments) argument_ptrs.push_back(argument.get());
+
+  SmallVector<RCReference<IndirectAsyncValue>, 4> results;
+  SmallVector<RCReference<AsyncValue>, 4> results_copy;
+  for (size_t i = 0; i < num_results; ++i) {
+    results.push_back(MakeIndirectAsyncValue(exec_ctx.host()));
+    results_copy.push_back(results.back().CopyRef());
+  }
+
+  RunWhenReady(argument_ptrs, [iterator = FormRef(this),
+                               arguments = std::move(arguments),
+                               results = std::move(results),
+                               exec_ctx]() mutable {
+    // Forward errors, e.g. at the end of iteration, without invoking the
+    // function.
+    for (auto& argument : arguments) {
+      if (!argument->IsError()) continue;
+      for (auto& result : results) result->ForwardTo(argument.CopyRef());
+      return;
+    }
+
+    auto* iterator_ptr = iterator.get();
+    iterator_ptr->Schedule(
+        [iterator = std::move(iterator), arguments = std::move(arguments),
+         results = std::move(results), exec_ctx]() mutable {
+          const auto start = TunableParameter::Clock::now();
+          // Skip the function of a request that was cancelled while the
+          // invocation was deferred or queued.
+          if (auto* cancel_av = exec_ctx.GetCancelAsyncValue()) {
+            for (auto& result : results) result->ForwardTo(FormRef(cancel_av));
+            iterator->OnInvocationDone(start, exec_ctx);
+            return;
+          }
+          SmallVector<AsyncValue*, 4> argument_ptrs;
+          for (auto& argument : arguments)
+            argument_ptrs.push_back(argument.get());
+          SmallVector<RCReference<AsyncValue>, 4> fn_results;
+          fn_results.resize(results.size());
+          iterator->parent_dataset_->map_fn_->Execute(exec_ctx, argument_ptrs,
+                                                      fn_results);
+
+          SmallVector<AsyncValue*, 4> fn_result_ptrs;
+          SmallVector<RCReference<AsyncValue>, 4> fn_result_refs;
+          for (size_t i = 0; i < results.size(); ++i) {
+            fn_result_ptrs.push_back(fn_results[i].get());
+            fn_result_refs.push_back(fn_results[i].CopyRef());
+            results[i]->ForwardTo(std::move(fn_results[i]));
+          }
+          // The invocation is in flight until its results are available, so
+          // that functions which offload their work are bounded as well.
+          RunWhenReady(fn_result_ptrs,
+                       [iterator = std::move(iterator), exec_ctx, start,
+                        fn_result_refs = std::move(fn_result_refs)]() {
+                         iterator->OnInvocationDone(start, exec_ctx);
+                       });
+        },
+        exec_ctx);
+  });
+
+  return IterationResult::Pending(std::move(results_copy),
+                                  std::move(input.eof));
+}
+
+void ParallelMapDatasetIterator::Schedule(
+    llvm::unique_function<void()> invocation,
+    const ExecutionContext& exec_ctx) {
+  {
+    mutex_lock lock(mu_);
+    deferred_.push(std::move(invocation));
+  }
+  EnqueueDeferred(exec_ctx);
+}
+
+void ParallelMapDatasetIterator::OnInvocationDone(
+    TunableParameter::Clock::time_point start,
+    const ExecutionContext& exec_ctx) {
+  if (num_parallel_calls_->is_tuned())
+    num_parallel_calls_->RecordProduced(start, /*bytes=*/0);
+  {
+    mutex_lock lock(mu_);
+    --num_in_flight_;
+  }
+  EnqueueDeferred(exec_ctx);
+}
+
+void ParallelMapDatasetIterator::EnqueueDeferred(
+    const ExecutionContext& exec_ctx) {
+  // The limit may change while invocations are in flight when it is tuned.
+  SmallVector<llvm::unique_function<void()>, 4> invocations;
+  {
+    mutex_lock lock(mu_);
+    while (!deferred_.empty() &&
+           num_in_flight_ < num_parallel_calls_->value()) {
+      invocations.push_back(std::move(deferred_.front()));
+      deferred_.pop();
+      ++num_in_flight_;
+    }
+  }
+  for (auto& invocation : invocations)
+    EnqueueWork(exec_ctx, std::move(invocation));
+}
+
+}  // namespace data
+}  // namespace tfrt
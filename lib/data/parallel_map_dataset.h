@@ -0,0 +1,165 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares ParallelMapDataset class which wraps around another
+// Dataset instance and transforms its elements with several function
+// invocations in flight.
+
+#ifndef TFRT_LIB_DATA_PARALLEL_MAP_DATASET_H_
+#define TFRT_LIB_DATA_PARALLEL_MAP_DATASET_H_
+
+#include <list>
+#include <memory>
+#include <queue>
+
+#include "autotune.h"
+#include "llvm/ADT/FunctionExtras.h"
+#include "tfrt/data/dataset.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace data {
+
+class ParallelMapDatasetIterator;
+
+// ParallelMapDataset maps a user-defined function over the elements in its
+// input dataset like MapDataset, but runs up to `num_parallel_calls` function
+// invocations concurrently on the work queue. The iterator maps up to
+// `buffer_size` elements ahead of the caller. Both can be kAutotune.
+class ParallelMapDataset : public Dataset {
+ public:
+  explicit ParallelMapDataset(RCReference<Dataset> input_dataset,
+                              RCArray<AsyncValue> additional_fn_args,
+                              RCReference<const Function> map_fn,
+                              int64_t num_parallel_calls, int64_t buffer_size,
+                              bool is_deterministic, HostContext* host)
+      : input_dataset_(std::move(input_dataset)),
+        host_(host),
+        allocator_(host->allocator()),
+        additional_fn_args_(std::move(additional_fn_args)),
+        map_fn_(std::move(map_fn)),
+        num_parallel_calls_(num_parallel_calls),
+        buffer_size_(buffer_size),
+        is_deterministic_(is_deterministic) {
+    assert(num_parallel_calls_ > 0 || num_parallel_calls_ == kAutotune);
+    assert(buffer_size_ >= 0 || buffer_size_ == kAutotune);
+  }
+
+  // This class is not copyable or movable.
+  ParallelMapDataset(const ParallelMapDataset&) = delete;
+  ParallelMapDataset& operator=(const ParallelMapDataset&) = delete;
+
+  string_view name() const override { return "parallel_map"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
+
+ private:
+  // Allow iterator to rely on private data members of this dataset.
+  friend class ParallelMapDatasetIterator;
+
+  void Destroy() override {
+    internal::DestroyImpl<ParallelMapDataset>(this, allocator_);
+  }
+
+  RCReference<Dataset> input_dataset_;
+  HostContext* host_;
+  HostAllocator* allocator_;
+  RCArray<AsyncValue> additional_fn_args_;
+  RCReference<const Function> map_fn_;
+  const int64_t num_parallel_calls_;
+  const int64_t buffer_size_;
+  // If this is set to true, the dataset returns values in the order of the
+  // input dataset. Otherwise, it returns the first mapped value available.
+  const bool is_deterministic_;
+};
+
+class ParallelMapDatasetIterator : public Iterator {
+ public:
+  explicit ParallelMapDatasetIterator(
+      RCReference<ParallelMapDataset> parent_dataset,
+      const IteratorContext& context)
+      : Iterator(),
+        parent_dataset_(std::move(parent_dataset)),
+        input_iterator_(
+            parent_dataset_->input_dataset_->MakeIterator(context)),
+        autotuner_(context.autotuner) {
+    const int64_t num_worker_threads =
+        parent_dataset_->host_->GetNumWorkerThreads();
+    num_parallel_calls_ = MakeTunableParameter(
+        parent_dataset_->num_parallel_calls_, context,
+        TunableParameter::Kind::kParallelism, num_worker_threads,
+        kMaxAutotuneBufferSize);
+    buffer_size_ = MakeTunableParameter(
+        parent_dataset_->buffer_size_, context,
+        TunableParameter::Kind::kBufferSize, num_parallel_calls_->value(),
+        kMaxAutotuneBufferSize);
+  }
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  // This class is not copyable or movable.
+  ParallelMapDatasetIterator(const ParallelMapDatasetIterator&) = delete;
+  ParallelMapDatasetIterator& operator=(const ParallelMapDatasetIterator&) =
+      delete;
+
+  void Destroy() override {
+    internal::DestroyImpl<ParallelMapDatasetIterator>(
+        this, parent_dataset_->allocator_);
+  }
+
+  // Returns the result of mapping `input`. The function is invoked through
+  // Schedule() once the input values are available.
+  IterationResult MapAsync(IterationResult input,
+                           const ExecutionContext& exec_ctx);
+
+  // Enqueues `invocation` to the work queue if fewer than `num_parallel_calls`
+  // invocations are in flight, and otherwise defers it until one completes.
+  void Schedule(llvm::unique_function<void()> invocation,
+                const ExecutionContext& exec_ctx) TFRT_EXCLUDES(mu_);
+
+  // Marks an invocation that started at `start` as completed, and enqueues the
+  // oldest deferred ones that fit.
+  void OnInvocationDone(TunableParameter::Clock::time_point start,
+                        const ExecutionContext& exec_ctx) TFRT_EXCLUDES(mu_);
+
+  // Enqueues deferred invocations while fewer than `num_parallel_calls` are
+  // in flight.
+  void EnqueueDeferred(const ExecutionContext& exec_ctx) TFRT_EXCLUDES(mu_);
+
+  RCReference<ParallelMapDataset> parent_dataset_;
+  RCReference<Iterator> input_iterator_;
+  std::shared_ptr<Autotuner> autotuner_;
+  std::shared_ptr<TunableParameter> num_parallel_calls_;
+  std::shared_ptr<TunableParameter> buffer_size_;
+  // Mapped values that have not been returned to the GetNext(...) caller yet.
+  std::list<IterationResult> buffer_;
+
+  mutex mu_;
+  // The number of invocations that are enqueued or whose results are not
+  // available yet.
+  int64_t num_in_flight_ TFRT_GUARDED_BY(mu_) = 0;
+  std::queue<llvm::unique_function<void()>> deferred_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_PARALLEL_MAP_DATASET_H_
@@ -19,13 +19,15 @@
 // buffer.
 #include "prefetch_dataset.h"
 
+#include "tfrt/host_context/memory_pressure.h"
+
 namespace tfrt {
 namespace data {
 
 //===----------------------------------------------------------------------===//
 // PrefetchDataset methods
 //===----------------------------------------------------------------------===//
-RCReference<Iterator> PrefetchDataset::MakeIterator(
+RCReference<Iterator> PrefetchDataset::MakeIteratorImpl(
     const IteratorContext& context) {
   if (is_deterministic_)
     return TakeRef(
@@ -34,13 +36,46 @@ RCReference<Iterator> PrefetchDataset::MakeIterator(
       FormRef(this), context));
 }
 
+std::shared_ptr<TunableParameter> PrefetchDataset::MakePrefetchNum(
+    const IteratorContext& context) const {
+  return MakeTunableParameter(prefetch_num_, context,
+                              TunableParameter::Kind::kBufferSize,
+                              host_->GetNumWorkerThreads(),
+                              kMaxAutotuneBufferSize);
+}
+
+// Returns the next element of `input_iterator`, and records when it becomes
+// available if `prefetch_num` is tuned.
+static IterationResult Prefetch(
+    Iterator* input_iterator,
+    const std::shared_ptr<TunableParameter>& prefetch_num,
+    const ExecutionContext& exec_ctx) {
+  auto result = input_iterator->GetNext(exec_ctx);
+  if (prefetch_num->is_tuned()) RecordWhenAvailable(result, prefetch_num);
+  return result;
+}
+
+// Returns the number of elements to keep in the buffer. The prefetched
+// elements beyond the one being returned are shed under memory pressure.
+static size_t BufferLimit(const std::shared_ptr<TunableParameter>& prefetch_num,
+                          const ExecutionContext& exec_ctx) {
+  return MemoryPressure::Get(exec_ctx.host())
+             .LimitBufferSize(prefetch_num->value()) +
+         1;
+}
+
 //===----------------------------------------------------------------------===//
 // PrefetchDatasetIterator methods
 //===----------------------------------------------------------------------===//
 IterationResult PrefetchDatasetIterator::GetNext(
     const ExecutionContext& exec_ctx) {
-  while (buffer_.size() < parent_dataset_->prefetch_num_ + 1) {
-    buffer_.push(input_iterator_->GetNext(exec_ctx));
+  if (prefetch_num_->is_tuned()) {
+    prefetch_num_->RecordConsumed();
+    autotuner_->MaybeTune();
+  }
+  auto buffer_limit = BufferLimit(prefetch_num_, exec_ctx);
+  while (buffer_.size() < buffer_limit) {
+    buffer_.push(Prefetch(input_iterator_.get(), prefetch_num_, exec_ctx));
   }
   auto result = std::move(buffer_.front());
   buffer_.pop();
@@ -62,8 +97,14 @@ static bool AvailableAndNotEof(const IterationResult& result) {
 
 IterationResult NonDeterministicPrefetchDatasetIterator::GetNext(
     const ExecutionContext& exec_ctx) {
-  while (buffer_.size() < parent_dataset_->prefetch_num_ + 1) {
-    buffer_.push_back(input_iterator_->GetNext(exec_ctx));
+  if (prefetch_num_->is_tuned()) {
+    prefetch_num_->RecordConsumed();
+    autotuner_->MaybeTune();
+  }
+  auto buffer_limit = BufferLimit(prefetch_num_, exec_ctx);
+  while (buffer_.size() < buffer_limit) {
+    buffer_.push_back(
+        Prefetch(input_iterator_.get(), prefetch_num_, exec_ctx));
   }
   for (auto it = buffer_.begin(), e = buffer_.end(); it != e; ++it) {
     if (AvailableAndNotEof(*it)) {
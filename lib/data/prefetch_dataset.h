@@ -22,8 +22,10 @@
 #define TFRT_LIB_DATA_PREFETCH_DATASET_H_
 
 #include <list>
+#include <memory>
 #include <queue>
 
+#include "autotune.h"
 #include "tfrt/data/dataset.h"
 #include "tfrt/support/forward_decls.h"
 
@@ -48,7 +50,10 @@ class PrefetchDataset : public Dataset {
   PrefetchDataset(const PrefetchDataset&) = delete;
   PrefetchDataset& operator=(const PrefetchDataset&) = delete;
 
-  RCReference<Iterator> MakeIterator(const IteratorContext& context) override;
+  string_view name() const override { return "prefetch"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
 
  private:
   // Allow iterator to rely on private data members of this dataset.
@@ -59,7 +64,12 @@ class PrefetchDataset : public Dataset {
     internal::DestroyImpl<PrefetchDataset>(this, host_->allocator());
   }
 
+  // Returns the prefetch_num parameter of an iterator created in `context`.
+  std::shared_ptr<TunableParameter> MakePrefetchNum(
+      const IteratorContext& context) const;
+
   RCReference<Dataset> input_dataset_;
+  // The number of prefetched elements, or kAutotune.
   int64_t prefetch_num_;
   // If this is set to true, the dataset returns values in a deterministic
   // order. Otherwise, it might return values in a non-deterministic as long as
@@ -76,7 +86,9 @@ class PrefetchDatasetIterator : public Iterator {
       : Iterator(),
         parent_dataset_(std::move(parent_dataset)),
         input_iterator_(
-            parent_dataset_->input_dataset_->MakeIterator(context)) {}
+            parent_dataset_->input_dataset_->MakeIterator(context)),
+        autotuner_(context.autotuner),
+        prefetch_num_(parent_dataset_->MakePrefetchNum(context)) {}
 
   // This class is not copyable or movable.
   PrefetchDatasetIterator(const PrefetchDatasetIterator&) = delete;
@@ -92,6 +104,8 @@ class PrefetchDatasetIterator : public Iterator {
 
   RCReference<PrefetchDataset> parent_dataset_;
   RCReference<Iterator> input_iterator_;
+  std::shared_ptr<Autotuner> autotuner_;
+  std::shared_ptr<TunableParameter> prefetch_num_;
   std::queue<IterationResult> buffer_;
 };
 
@@ -104,7 +118,9 @@ class NonDeterministicPrefetchDatasetIterator : public Iterator {
       : Iterator(),
         parent_dataset_(std::move(parent_dataset)),
         input_iterator_(
-            parent_dataset_->input_dataset_->MakeIterator(context)) {}
+            parent_dataset_->input_dataset_->MakeIterator(context)),
+        autotuner_(context.autotuner),
+        prefetch_num_(parent_dataset_->MakePrefetchNum(context)) {}
 
   // This class is not copyable or movable.
   NonDeterministicPrefetchDatasetIterator(const PrefetchDatasetIterator&) =
@@ -122,6 +138,8 @@ class NonDeterministicPrefetchDatasetIterator : public Iterator {
 
   RCReference<PrefetchDataset> parent_dataset_;
   RCReference<Iterator> input_iterator_;
+  std::shared_ptr<Autotuner> autotuner_;
+  std::shared_ptr<TunableParameter> prefetch_num_;
   std::list<IterationResult> buffer_;
 };
 
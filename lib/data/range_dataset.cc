@@ -58,7 +58,7 @@ IterationResult RangeDatasetIterator::GetNext(
 //===----------------------------------------------------------------------===//
 // RangeDataset methods
 //===----------------------------------------------------------------------===//
-RCReference<Iterator> RangeDataset::MakeIterator(
+RCReference<Iterator> RangeDataset::MakeIteratorImpl(
     const IteratorContext& context) {
   return TakeRef(host_->Construct<RangeDatasetIterator>(FormRef(this)));
 }
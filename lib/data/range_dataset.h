@@ -46,7 +46,10 @@ class RangeDataset : public Dataset {
   RangeDataset(const RangeDataset&) = delete;
   RangeDataset& operator=(const RangeDataset&) = delete;
 
-  RCReference<Iterator> MakeIterator(const IteratorContext& context) override;
+  string_view name() const override { return "range"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
 
  private:
   friend class RangeDatasetIterator;
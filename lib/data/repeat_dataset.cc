@@ -27,7 +27,7 @@ namespace data {
 //===----------------------------------------------------------------------===//
 // RepeatDataset methods
 //===----------------------------------------------------------------------===//
-RCReference<Iterator> RepeatDataset::MakeIterator(
+RCReference<Iterator> RepeatDataset::MakeIteratorImpl(
     const IteratorContext& context) {
   return TakeRef(
       host_->Construct<RepeatDatasetIterator>(FormRef(this), context));
@@ -64,12 +64,12 @@ IterationResult RepeatDatasetIterator::GetNext(
     output_buffer_.push(result.CopyRef());
   }
 
-  MaybeScheduleBackgroundTask(exec_ctx, false, 0);
+  MaybeScheduleBackgroundTask(exec_ctx, false);
   return result;
 }
 
 void RepeatDatasetIterator::MaybeScheduleBackgroundTask(
-    const ExecutionContext& exec_ctx, bool is_token_owner, int callback_count) {
+    const ExecutionContext& exec_ctx, bool is_token_owner) {
   {
     mutex_lock lock(mu_);
     // There is no more output value to update. Release the token if the caller
@@ -96,15 +96,10 @@ void RepeatDatasetIterator::MaybeScheduleBackgroundTask(
   // false. And schedule tasks to run the filter_fn for newly fetched values in
   // parallel.
   auto host = exec_ctx.host();
-  auto callback = [exec_ctx, callback_count,
-                   iterator = FormRef(this)]() mutable {
-    if (callback_count >= MAX_RECURSIVE_CALLS) {
-      EnqueueWork(exec_ctx, [exec_ctx, iterator = std::move(iterator)] {
-        iterator->MaybeScheduleBackgroundTask(exec_ctx, true, 0);
-      });
-    } else {
-      iterator->MaybeScheduleBackgroundTask(exec_ctx, true, callback_count + 1);
-    }
+  auto callback = [exec_ctx, iterator = FormRef(this)]() mutable {
+    RunInlineOrEnqueue(exec_ctx, [exec_ctx, iterator = std::move(iterator)] {
+      iterator->MaybeScheduleBackgroundTask(exec_ctx, true);
+    });
   };
 
   int input_fetch_num = OutputBufferSize() - input_buffer_.size();
@@ -122,9 +117,9 @@ void RepeatDatasetIterator::MaybeScheduleBackgroundTask(
   }
   if (input_buffer_.empty()) {
     // Recursively call the function again because the output_buffer_ might have
-    // more values. No state is kept in the stack due to tail recursion. Thus we
-    // don't need to increment the callback_count.
-    MaybeScheduleBackgroundTask(exec_ctx, true, callback_count);
+    // more values. No state is kept in the stack due to tail recursion. Thus it
+    // does not need to go through RunInlineOrEnqueue().
+    MaybeScheduleBackgroundTask(exec_ctx, true);
     return;
   }
   // After the first value in the `input_buffer_` becomes available, the token
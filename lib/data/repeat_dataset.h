@@ -46,7 +46,10 @@ class RepeatDataset : public Dataset {
   RepeatDataset(const RepeatDataset&) = delete;
   RepeatDataset& operator=(const RepeatDataset&) = delete;
 
-  RCReference<Iterator> MakeIterator(const IteratorContext& context) override;
+  string_view name() const override { return "repeat"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
 
  private:
   friend class RepeatDatasetIterator;
@@ -94,7 +97,7 @@ class RepeatDatasetIterator : public Iterator {
   // appropriate. This method will recursively call itself again when the first
   // value in the `input_buffer_` becomes available.
   void MaybeScheduleBackgroundTask(const ExecutionContext& exec_ctx,
-                                   bool is_token_owner, int callback_count)
+                                   bool is_token_owner)
       TFRT_EXCLUDES(mu_);
 
   void HandleEofAvailableInput(IterationResult input, HostContext* host);
@@ -27,7 +27,7 @@ namespace data {
 //===----------------------------------------------------------------------===//
 // ShuffleDataset methods
 //===----------------------------------------------------------------------===//
-RCReference<Iterator> ShuffleDataset::MakeIterator(
+RCReference<Iterator> ShuffleDataset::MakeIteratorImpl(
     const IteratorContext& context) {
   return TakeRef(
       host_->Construct<ShuffleDatasetIterator>(FormRef(this), context));
@@ -62,12 +62,12 @@ IterationResult ShuffleDatasetIterator::GetNext(
     output_buffer_.push(result.CopyRef());
   }
 
-  MaybeScheduleBackgroundTask(exec_ctx, false, 0);
+  MaybeScheduleBackgroundTask(exec_ctx, false);
   return result;
 }
 
 void ShuffleDatasetIterator::MaybeScheduleBackgroundTask(
-    const ExecutionContext& exec_ctx, bool is_token_owner, int callback_count) {
+    const ExecutionContext& exec_ctx, bool is_token_owner) {
   {
     mutex_lock lock(mu_);
     // There is no more output value to update. Release the token if the caller
@@ -89,15 +89,10 @@ void ShuffleDatasetIterator::MaybeScheduleBackgroundTask(
   // ensures in-order delivery since at most one thread can take value from the
   // input_iterator_ and update the output value in the output_buffer_.
   auto host = exec_ctx.host();
-  auto callback = [exec_ctx, callback_count,
-                   iterator = FormRef(this)]() mutable {
-    if (callback_count >= MAX_RECURSIVE_CALLS) {
-      EnqueueWork(exec_ctx, [exec_ctx, iterator = std::move(iterator)] {
-        iterator->MaybeScheduleBackgroundTask(exec_ctx, true, 0);
-      });
-    } else {
-      iterator->MaybeScheduleBackgroundTask(exec_ctx, true, callback_count + 1);
-    }
+  auto callback = [exec_ctx, iterator = FormRef(this)]() mutable {
+    RunInlineOrEnqueue(exec_ctx, [exec_ctx, iterator = std::move(iterator)] {
+      iterator->MaybeScheduleBackgroundTask(exec_ctx, true);
+    });
   };
 
   auto max_buffer_size = parent_dataset_->buffer_size_;
@@ -139,7 +134,7 @@ void ShuffleDatasetIterator::MaybeScheduleBackgroundTask(
       HandleEofAvailableInput(std::move(input), host);
     }
   }
-  MaybeScheduleBackgroundTask(exec_ctx, true, callback_count);
+  MaybeScheduleBackgroundTask(exec_ctx, true);
 }
 
 void ShuffleDatasetIterator::HandleEofAvailableInput(IterationResult input,
@@ -50,7 +50,10 @@ class ShuffleDataset : public Dataset {
   ShuffleDataset(const ShuffleDataset&) = delete;
   ShuffleDataset& operator=(const ShuffleDataset&) = delete;
 
-  RCReference<Iterator> MakeIterator(const IteratorContext& context) override;
+  string_view name() const override { return "shuffle"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
 
  private:
   friend class ShuffleDatasetIterator;
@@ -93,7 +96,7 @@ class ShuffleDatasetIterator : public Iterator {
   // helps ensure in-order delivery while still allowing an unblocking
   // GetNext(...) API.
   void MaybeScheduleBackgroundTask(const ExecutionContext& exec_ctx,
-                                   bool is_token_owner, int callback_count)
+                                   bool is_token_owner)
       TFRT_EXCLUDES(mu_);
 
   void HandleEofAvailableInput(IterationResult input, HostContext* host);
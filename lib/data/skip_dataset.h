@@ -42,7 +42,10 @@ class SkipDataset : public Dataset {
   SkipDataset(const SkipDataset&) = delete;
   SkipDataset& operator=(const SkipDataset&) = delete;
 
-  RCReference<Iterator> MakeIterator(const IteratorContext& context) override;
+  string_view name() const override { return "skip"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
 
  private:
   friend class SkipDatasetIterator;
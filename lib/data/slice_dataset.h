@@ -42,7 +42,10 @@ class SliceDataset : public Dataset {
   SliceDataset(const SliceDataset&) = delete;
   SliceDataset& operator=(const SliceDataset&) = delete;
 
-  RCReference<Iterator> MakeIterator(const IteratorContext& context) override;
+  string_view name() const override { return "slice"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
 
  private:
   friend class SliceDatasetIterator<T>;
@@ -113,7 +116,7 @@ inline IterationResult SliceDatasetIterator<DenseHostTensor>::GetNext(
 }
 
 template <typename T>
-RCReference<Iterator> SliceDataset<T>::MakeIterator(
+RCReference<Iterator> SliceDataset<T>::MakeIteratorImpl(
     const IteratorContext& context) {
   return TakeRef(host_->Construct<SliceDatasetIterator<T>>(
       FormRef(this), data_.begin(), data_.end()));
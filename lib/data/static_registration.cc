@@ -28,7 +28,7 @@ static void RegisterKernels(KernelRegistry* registry) {
   RegisterDataKernels(registry);
 }
 
-TFRT_STATIC_KERNEL_REGISTRATION(RegisterKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("tfrt_data.", RegisterKernels);
 
 }  // namespace data
 }  // namespace tfrt
@@ -12,138 +12,398 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-// This file implements TFRecordDataset class which reads records from TFRecord
-// files into strings.
+// This file implements TFRecordReader and TFRecordDataset classes which read
+// records from TFRecord files into string tensors.
 
 #include "tf_record_dataset.h"
 
-#include "tfrt/io/buffered_input_stream.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/io/file_input_stream.h"
 #include "tfrt/io/file_system.h"
 #include "tfrt/support/crc32c.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/raw_coding.h"
+#include "tfrt/tensor/packed_string_host_tensor.h"
 
 namespace tfrt {
 namespace data {
+namespace {
 
-//===----------------------------------------------------------------------===//
-// Implementation for TFRecordDataset member functions
-//===----------------------------------------------------------------------===//
+// A record is a uint64 length and the masked crc32c of the length, followed
+// by the payload and the masked crc32c of the payload.
+constexpr size_t kHeaderSize = sizeof(uint64_t) + sizeof(uint32_t);
+constexpr size_t kFooterSize = sizeof(uint32_t);
 
-RCReference<Iterator> TFRecordDataset::MakeIterator(
-    const IteratorContext& context) {
-  return TakeRef(
-      host_->Construct<TFRecordDatasetIterator>(FormRef(this), context));
+constexpr size_t kBlockAlignment = 64;
+
+// The payloads of a block are verified in tasks of at least this many bytes.
+constexpr size_t kMinVerifyTaskSize = 64 * 1024;
+
+struct UnverifiedRecord {
+  AsyncValueRef<PackedStringHostTensor> value;
+  PackedStringHostTensor tensor;
+  // The position of the record in the file.
+  size_t position;
+};
+
+// Sets each record's value to its tensor if the payload matches the checksum
+// that follows it in the block, and to an error otherwise.
+void VerifyRecords(MutableArrayRef<UnverifiedRecord> records) {
+  for (auto& record : records) {
+    string_view payload = record.tensor.GetString(0);
+    const uint32_t masked_crc = DecodeFixed32(payload.data() + payload.size());
+    if (crc32c::Unmask(masked_crc) !=
+        crc32c::Value(payload.data(), payload.size())) {
+      record.value.SetError(
+          StrCat("data corruption at position ", record.position));
+    } else {
+      record.value.emplace(std::move(record.tensor));
+    }
+  }
+}
+
+// Verifies `records` on the blocking work queue, or on the calling thread if
+// the queue is full.
+void EnqueueVerifyRecords(std::vector<UnverifiedRecord> records,
+                          const ExecutionContext& exec_ctx) {
+  auto shared = std::make_shared<std::vector<UnverifiedRecord>>(
+      std::move(records));
+  if (!EnqueueBlockingWork(exec_ctx, [shared] { VerifyRecords(*shared); }))
+    VerifyRecords(*shared);
 }
 
+}  // namespace
+
 //===----------------------------------------------------------------------===//
-// Implementation for TFRecordDatasetIterator member functions
+// Implementation for TFRecordReader member functions
 //===----------------------------------------------------------------------===//
-IterationResult TFRecordDatasetIterator::GetNextElement(
-    const ExecutionContext& exec_ctx) {
+
+llvm::Expected<RCReference<TFRecordReader>> TFRecordReader::Open(
+    const std::string& path, size_t block_size, bool verify_payload_checksum,
+    HostAllocator* allocator) {
+  auto* fs_registry = ::tfrt::io::FileSystemRegistry::Default();
+  auto* file_system = fs_registry->LookupForPath(path);
+  if (!file_system)
+    return MakeStringError("No file system is found for the given scheme");
+
+  // Records are read front to back.
+  ::tfrt::io::RandomAccessFileOptions options;
+  options.access_pattern =
+      ::tfrt::io::RandomAccessFileOptions::AccessPattern::kSequential;
+  std::unique_ptr<::tfrt::io::RandomAccessFile> file;
+  if (auto error = file_system->NewRandomAccessFile(path, options, &file))
+    return std::move(error);
+
+  auto stream = std::make_unique<::tfrt::io::FileInputStream>(std::move(file));
+  auto* async_stream =
+      stream->file().SupportsNonBlockingRead() ? stream.get() : nullptr;
+  return TakeRef(new TFRecordReader(std::move(stream), async_stream,
+                                    block_size, verify_payload_checksum,
+                                    allocator));
+}
+
+IterationResult TFRecordReader::GetNext(const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
-  if (auto error = MaybeInitializeStream()) {
-    auto async_error = MakeErrorAsyncValueRef(host, StrCat(error));
-    return IterationResult::Error(std::move(async_error), 1);
+  while (records_.empty()) {
+    if (!read_ahead_pending_ && stream_eof_) {
+      if (block_pos_ == block_limit_) return IterationResult::Eof(host, 1);
+      const size_t position = block_offset_ + block_pos_;
+      block_pos_ = block_limit_;
+      auto error = MakeErrorAsyncValueRef(
+          host, StrCat("truncated record at position ", position));
+      return IterationResult::Error(std::move(error), 1);
+    }
+    if (auto error = FinishReadAhead()) {
+      // Do not decode location or emit error because the local handler might
+      // have been freed.
+      auto async_error = MakeErrorAsyncValueRef(host, StrCat(error));
+      return IterationResult::Error(std::move(async_error), 1);
+    }
+    ParseBlock(exec_ctx);
+    StartReadAhead(exec_ctx);
+  }
+
+  auto result = std::move(records_.front());
+  records_.pop();
+  return result;
+}
+
+void TFRecordReader::StartReadAhead(const ExecutionContext& exec_ctx) {
+  if (read_ahead_pending_ || stream_eof_) return;
+  if (async_stream_) return StartAsyncReadAhead(exec_ctx);
+  {
+    mutex_lock lock(mu_);
+    assert(read_ahead_state_ == ReadAheadState::kIdle);
+    read_ahead_state_ = ReadAheadState::kQueued;
   }
+  read_ahead_pending_ = true;
 
-  bool eof = false;
-  auto result = ReadRecord(&eof);
+  bool enqueued = EnqueueBlockingWork(exec_ctx, [reader = FormRef(this)] {
+    {
+      mutex_lock lock(reader->mu_);
+      // GetNext() read the block on its own thread.
+      if (reader->read_ahead_state_ != ReadAheadState::kQueued) return;
+      reader->read_ahead_state_ = ReadAheadState::kRunning;
+    }
+    auto error = reader->ReadBlock();
+    mutex_lock lock(reader->mu_);
+    if (error) reader->read_ahead_error_ = StrCat(error);
+    reader->read_ahead_state_ = ReadAheadState::kDone;
+    reader->read_ahead_done_.notify_all();
+  });
+  // The block is read by FinishReadAhead() instead.
+  if (!enqueued) {
+    mutex_lock lock(mu_);
+    read_ahead_state_ = ReadAheadState::kIdle;
+  }
+}
 
-  if (eof) {
-    return IterationResult::Eof(host, 1);
+void TFRecordReader::StartAsyncReadAhead(const ExecutionContext& exec_ctx) {
+  {
+    mutex_lock lock(mu_);
+    assert(read_ahead_state_ == ReadAheadState::kIdle);
+    read_ahead_state_ = ReadAheadState::kRunning;
   }
-  if (!result) {
-    // Do not decode location or emit error because the local handler might have
-    // been freed.
-    auto error = MakeErrorAsyncValueRef(host, StrCat(result.takeError()));
-    return IterationResult::Error(std::move(error), 1);
+  read_ahead_pending_ = true;
+
+  size_t read_size = 0;
+  auto block = AllocateBlock(&read_size);
+  if (!block) {
+    mutex_lock lock(mu_);
+    read_ahead_error_ = StrCat(block.takeError());
+    read_ahead_state_ = ReadAheadState::kDone;
+    return;
   }
+  char* data =
+      static_cast<char*>((*block)->data()) + (block_limit_ - block_pos_);
+  auto count = async_stream_->ReadAsync(data, read_size, exec_ctx);
+  count.AndThen([reader = FormRef(this), block = std::move(*block), read_size,
+                 count = count.CopyRef()]() mutable {
+    llvm::Optional<std::string> error;
+    if (count.IsError()) {
+      // The stream already skipped the block, end the iteration after this
+      // error.
+      error = count.GetError().message;
+      reader->block_pos_ = reader->block_limit_;
+      reader->stream_eof_ = true;
+    } else {
+      reader->SetBlock(std::move(block), read_size, *count);
+    }
+    mutex_lock lock(reader->mu_);
+    reader->read_ahead_error_ = std::move(error);
+    reader->read_ahead_state_ = ReadAheadState::kDone;
+    reader->read_ahead_done_.notify_all();
+  });
+}
 
-  llvm::SmallVector<RCReference<AsyncValue>, 4> values;
-  values.push_back(
-      MakeAvailableAsyncValueRef<std::string>(host, std::move(*result)));
-  return IterationResult::Values(std::move(values), host);
+llvm::Error TFRecordReader::FinishReadAhead() {
+  if (!read_ahead_pending_) return ReadBlock();
+  read_ahead_pending_ = false;
+
+  bool take_over = false;
+  llvm::Optional<std::string> error;
+  {
+    mutex_lock lock(mu_);
+    // Take over reading ahead if it has not started yet.
+    if (read_ahead_state_ == ReadAheadState::kIdle ||
+        read_ahead_state_ == ReadAheadState::kQueued) {
+      take_over = true;
+    } else {
+      read_ahead_done_.wait(lock, [this]() TFRT_REQUIRES(mu_) {
+        return read_ahead_state_ == ReadAheadState::kDone;
+      });
+      std::swap(error, read_ahead_error_);
+    }
+    read_ahead_state_ = ReadAheadState::kIdle;
+  }
+  if (take_over) return ReadBlock();
+  if (error) return MakeStringError(*error);
+  return llvm::Error::success();
 }
 
 // Logic based on tensorflow/core/io/record_reader.*
-// Note: RecordReader maintains the offset. For now, we're relying on
-// ifstream reading sequentially.
-llvm::Expected<std::string> TFRecordDatasetIterator::ReadChecksummed(
-    size_t pos, size_t n, bool* eof) {
-  // The crc has size uint32.
-  const size_t count = n + sizeof(uint32_t);
-  *eof = false;
-
-  std::string result;
-  result.clear();
-  result.resize(count);
-
-  char* buffer = &result[0];
-  auto count_or_error = stream_->Read(buffer, count);
+llvm::Error TFRecordReader::ReadBlock() {
+  size_t read_size = 0;
+  auto block = AllocateBlock(&read_size);
+  if (!block) return block.takeError();
+  char* data =
+      static_cast<char*>((*block)->data()) + (block_limit_ - block_pos_);
+  auto count_or_error = stream_->Read(data, read_size);
   if (!count_or_error) return count_or_error.takeError();
+  SetBlock(std::move(*block), read_size, *count_or_error);
+  return llvm::Error::success();
+}
 
-  if (*count_or_error < count) {
-    *eof = true;
-    return MakeStringError("end of file");
+llvm::Expected<RCReference<HostBuffer>> TFRecordReader::AllocateBlock(
+    size_t* read_size) {
+  const size_t leftover = block_limit_ - block_pos_;
+
+  // Read at least the rest of the record that starts with the leftover bytes.
+  size_t missing = 1;
+  if (leftover >= kHeaderSize) {
+    const char* header = static_cast<const char*>(block_->data()) + block_pos_;
+    missing = kHeaderSize + DecodeFixed64(header) + kFooterSize - leftover;
+  }
+  *read_size = llvm::alignTo(missing, block_size_);
+
+  auto block = HostBuffer::CreateUninitialized(
+      leftover + *read_size, kBlockAlignment, allocator_);
+  if (!block) {
+    // The record can not be read, end the iteration after this error.
+    block_pos_ = block_limit_;
+    stream_eof_ = true;
+    return MakeStringError("failed to allocate a block of ",
+                           leftover + *read_size, " bytes");
   }
-  const uint32_t masked_crc = DecodeFixed32(result.data() + n);
-  if (crc32c::Unmask(masked_crc) != crc32c::Value(result.data(), n)) {
-    return MakeStringError("data corruption at position ", pos);
+  if (leftover > 0) {
+    std::memcpy(block->data(),
+                static_cast<const char*>(block_->data()) + block_pos_,
+                leftover);
   }
+  return std::move(block);
+}
 
-  result.resize(n);
-  return result;
+void TFRecordReader::SetBlock(RCReference<HostBuffer> block, size_t read_size,
+                              size_t count) {
+  const size_t leftover = block_limit_ - block_pos_;
+  stream_eof_ = count < read_size;
+  block_offset_ += block_pos_;
+  block_ = std::move(block);
+  block_pos_ = 0;
+  block_limit_ = leftover + count;
 }
 
-llvm::Expected<std::string> TFRecordDatasetIterator::ReadRecord(bool* eof) {
-  *eof = false;
-  auto pos = stream_->Tell();
-  if (!pos) return pos.takeError();
+void TFRecordReader::ParseBlock(const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  const char* data = static_cast<const char*>(block_->data());
+
+  // The payload of record `i` is [starts[i], starts[i] + lengths[i]).
+  llvm::SmallVector<size_t, 64> starts;
+  llvm::SmallVector<size_t, 64> lengths;
+  llvm::Optional<size_t> corrupted_header;
+  while (block_limit_ - block_pos_ >= kHeaderSize) {
+    const char* header = data + block_pos_;
+    const uint32_t masked_crc = DecodeFixed32(header + sizeof(uint64_t));
+    if (crc32c::Unmask(masked_crc) !=
+        crc32c::Value(header, sizeof(uint64_t))) {
+      corrupted_header = block_offset_ + block_pos_;
+      break;
+    }
+    const uint64_t length = DecodeFixed64(header);
+    if (block_limit_ - block_pos_ - kHeaderSize < length + kFooterSize) break;
+    starts.push_back(block_pos_ + kHeaderSize);
+    lengths.push_back(length);
+    block_pos_ += kHeaderSize + length + kFooterSize;
+  }
 
-  // Read header.
-  auto header = ReadChecksummed(*pos, sizeof(uint64_t), eof);
-  if (!header) return header.takeError();
-  const uint64_t length = DecodeFixed64(header->data());
+  if (!starts.empty()) {
+    // The records share one buffer of [begin, end) offsets into the block.
+    const size_t num_records = starts.size();
+    auto offsets = HostBuffer::CreateUninitialized(
+        2 * num_records * sizeof(int64_t), alignof(int64_t),
+        allocator_);
+    if (!offsets) {
+      auto error = MakeErrorAsyncValueRef(
+          host, "failed to allocate the offsets of a block");
+      records_.push(IterationResult::Error(std::move(error), 1));
+      block_pos_ = block_limit_;
+      stream_eof_ = true;
+      return;
+    }
+    auto* offsets_data = static_cast<int64_t*>(offsets->data());
 
-  // Read body.
-  auto body = ReadChecksummed(*pos, length, eof);
-  if (*eof) {
-    *eof = false;
-    return MakeStringError("truncated record at position ", *pos);
+    std::vector<UnverifiedRecord> unverified;
+    size_t unverified_size = 0;
+    for (size_t i = 0; i < num_records; ++i) {
+      offsets_data[2 * i] = starts[i];
+      offsets_data[2 * i + 1] = starts[i] + lengths[i];
+      PackedStringHostTensor tensor(
+          TensorShape({}),
+          HostBuffer::CreateFromExternal(offsets.CopyRef(),
+                                         2 * i * sizeof(int64_t),
+                                         2 * sizeof(int64_t)),
+          block_.CopyRef());
+
+      llvm::SmallVector<RCReference<AsyncValue>, 4> values;
+      if (!verify_payload_checksum_) {
+        values.push_back(MakeAvailableAsyncValueRef<PackedStringHostTensor>(
+            host, std::move(tensor)));
+      } else {
+        auto value =
+            MakeUnconstructedAsyncValueRef<PackedStringHostTensor>(host);
+        values.push_back(value.CopyRCRef());
+        unverified.push_back(
+            UnverifiedRecord{std::move(value), std::move(tensor),
+                             block_offset_ + starts[i] - kHeaderSize});
+        unverified_size += lengths[i];
+        if (unverified_size >= kMinVerifyTaskSize) {
+          EnqueueVerifyRecords(std::move(unverified), exec_ctx);
+          unverified.clear();
+          unverified_size = 0;
+        }
+      }
+      records_.push(IterationResult::Values(std::move(values), host));
+    }
+    if (!unverified.empty())
+      EnqueueVerifyRecords(std::move(unverified), exec_ctx);
   }
-  return body;
-}
 
-llvm::Error TFRecordDatasetIterator::MaybeInitializeStream() {
-  if (initialization_error_) {
-    return MakeStringError(initialization_error_);
+  if (corrupted_header) {
+    // The records that follow can not be located, end the iteration.
+    auto error = MakeErrorAsyncValueRef(
+        host, StrCat("data corruption at position ", *corrupted_header));
+    records_.push(IterationResult::Error(std::move(error), 1));
+    block_pos_ = block_limit_;
+    stream_eof_ = true;
   }
+}
 
-  if (stream_) return llvm::Error::success();
+//===----------------------------------------------------------------------===//
+// Implementation for TFRecordDataset member functions
+//===----------------------------------------------------------------------===//
 
-  auto* fs_registry = ::tfrt::io::FileSystemRegistry::Default();
-  auto* file_system = fs_registry->Lookup("");
-  if (!file_system) {
-    initialization_error_ =
-        MakeStringError("No file system is found for the given scheme");
-    return MakeStringError(initialization_error_);
+RCReference<Iterator> TFRecordDataset::MakeIteratorImpl(
+    const IteratorContext& context) {
+  return TakeRef(
+      host_->Construct<TFRecordDatasetIterator>(FormRef(this), context));
+}
+
+//===----------------------------------------------------------------------===//
+// Implementation for TFRecordDatasetIterator member functions
+//===----------------------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+// Implementation for TFRecordDatasetIterator member functions
+//===----------------------------------------------------------------------===//
+IterationResult TFRecordDatasetIterator::GetNextElement(
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  if (auto error = MaybeInitializeReader()) {
+    auto async_error = MakeErrorAsyncValueRef(host, StrCat(error));
+    return IterationResult::Error(std::move(async_error), 1);
   }
+  return reader_->GetNext(exec_ctx);
+}
 
-  std::unique_ptr<::tfrt::io::RandomAccessFile> file;
-  auto error = file_system->NewRandomAccessFile(parent_dataset_->path_, &file);
-  if (error) {
-    initialization_error_ = MakeStringError(error);
-    return error;
+llvm::Error TFRecordDatasetIterator::MaybeInitializeReader() {
+  if (initialization_error_) {
+    return MakeStringError(initialization_error_);
   }
 
-  stream_ = std::make_unique<::tfrt::io::FileInputStream>(std::move(file));
-  if (parent_dataset_->buffer_size_ > 0) {
-    stream_ = std::make_unique<::tfrt::io::BufferedInputStream>(
-        std::move(stream_), parent_dataset_->buffer_size_,
-        parent_dataset_->allocator_);
+  if (reader_) return llvm::Error::success();
+
+  auto reader = TFRecordReader::Open(
+      parent_dataset_->path_, parent_dataset_->buffer_size_,
+      parent_dataset_->verify_payload_checksum_, parent_dataset_->allocator_);
+  if (!reader) {
+    initialization_error_ = reader.takeError();
+    return MakeStringError(initialization_error_);
   }
+  reader_ = std::move(*reader);
   return llvm::Error::success();
 }
 
@@ -15,44 +15,158 @@
  */
 
 // This file declares TFRecordDataset class which reads records from TFRecord
-// files into strings.
+// files into string tensors.
 
 #ifndef TFRT_LIB_DATA_TF_RECORD_DATASET_H_
 #define TFRT_LIB_DATA_TF_RECORD_DATASET_H_
 
+#include <queue>
+
 #include "io.h"
 #include "tfrt/data/dataset.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/io/file_input_stream.h"
 #include "tfrt/io/input_stream.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
 namespace data {
 
-// TFRecordDataset reads TFRecord bytes from a file.
+// TFRecordReader reads the records of a TFRecord file.
+//
+// The file is read in blocks of `block_size` bytes at multiples of
+// `block_size` in the file. Each record is a scalar PackedStringHostTensor
+// that points into the block holding it, so records are never copied onto the
+// heap one by one. A record that straddles two blocks is copied to the start
+// of the next block.
 //
-// TODO(rachelim): Consider using a custom data type to represent the
-// bytes read from a TFRecord file. This will make the code more type safe
-// and allow for future optimizations to use mmap instead of copying bytes
-// from the file onto the heap.
+// The next block is read ahead while the records of the current block are
+// consumed, with an asynchronous read if the file supports non-blocking reads
+// and on the blocking work queue otherwise. The length of each record is
+// verified when the block is parsed. The payloads of a block are verified on
+// the blocking work queue unless `verify_payload_checksum` is false. A record
+// with a corrupted payload is an error value, the iteration continues after
+// it.
+//
+// GetNext() must not be called concurrently.
+class TFRecordReader : public ReferenceCounted<TFRecordReader> {
+ public:
+  // Opens the file at `path` with the default file system.
+  static llvm::Expected<RCReference<TFRecordReader>> Open(
+      const std::string& path, size_t block_size, bool verify_payload_checksum,
+      HostAllocator* allocator);
+
+  // Starts reading the first block on the blocking work queue.
+  void Start(const ExecutionContext& exec_ctx) { StartReadAhead(exec_ctx); }
+
+  // Returns the next record, an error, or eof. The returned eof is available,
+  // the record may become available later.
+  IterationResult GetNext(const ExecutionContext& exec_ctx);
+
+ private:
+  TFRecordReader(std::unique_ptr<::tfrt::io::InputStream> stream,
+                 ::tfrt::io::FileInputStream* async_stream, size_t block_size,
+                 bool verify_payload_checksum, HostAllocator* allocator)
+      : stream_(std::move(stream)),
+        async_stream_(async_stream),
+        block_size_(block_size),
+        verify_payload_checksum_(verify_payload_checksum),
+        allocator_(allocator) {
+    assert(block_size_ > 0);
+  }
+
+  // The states of reading the next block ahead.
+  enum class ReadAheadState { kIdle, kQueued, kRunning, kDone };
+
+  // Enqueues reading the next block, unless the stream is exhausted.
+  void StartReadAhead(const ExecutionContext& exec_ctx);
+
+  // Starts reading the next block from async_stream_. The read ahead state is
+  // kRunning until the read completes, so it is never taken over.
+  void StartAsyncReadAhead(const ExecutionContext& exec_ctx);
+
+  // Reads the next block if it was not read ahead, or waits until it is.
+  // Reading ahead is not waited for until it started, it is read on the
+  // calling thread instead.
+  llvm::Error FinishReadAhead();
+
+  // Reads the next block from the input stream. The unparsed bytes of the
+  // current block are copied to the start of the new block, and the new block
+  // is large enough to hold the record that starts with them.
+  llvm::Error ReadBlock();
+
+  // Allocates the next block and copies the unparsed bytes of the current
+  // block to its start. Sets `read_size` to the number of bytes to read after
+  // them.
+  llvm::Expected<RCReference<HostBuffer>> AllocateBlock(size_t* read_size);
+
+  // Makes `block` the current block, after `count` of the `read_size` bytes
+  // were read into it.
+  void SetBlock(RCReference<HostBuffer> block, size_t read_size, size_t count);
+
+  // Parses the complete records of the current block into records_, and
+  // enqueues the verification of their payloads.
+  void ParseBlock(const ExecutionContext& exec_ctx);
+
+  std::unique_ptr<::tfrt::io::InputStream> stream_;
+  // The stream_ if it is a file that supports non-blocking reads, or null.
+  ::tfrt::io::FileInputStream* async_stream_;
+  const size_t block_size_;
+  const bool verify_payload_checksum_;
+  HostAllocator* allocator_;
+
+  // The bytes [block_pos_, block_limit_) of block_ are read from the file but
+  // not parsed yet. They are the start of a record, if any. These and
+  // stream_eof_ are written by reading ahead while read_ahead_pending_.
+  RCReference<HostBuffer> block_;
+  size_t block_pos_ = 0;
+  size_t block_limit_ = 0;
+  // The position of block_ in the file.
+  size_t block_offset_ = 0;
+  // Whether the input stream has no more bytes to read.
+  bool stream_eof_ = false;
+
+  // Whether reading ahead was enqueued and not finished by GetNext().
+  bool read_ahead_pending_ = false;
+  mutex mu_;
+  condition_variable read_ahead_done_;
+  ReadAheadState read_ahead_state_ TFRT_GUARDED_BY(mu_) =
+      ReadAheadState::kIdle;
+  llvm::Optional<std::string> read_ahead_error_ TFRT_GUARDED_BY(mu_);
+
+  // Records that are parsed but not returned yet.
+  std::queue<IterationResult> records_;
+};
+
+// TFRecordDataset reads TFRecord bytes from a file with a TFRecordReader, in
+// blocks of `buffer_size` bytes. The reader runs in the blocking tasks of a
+// PrefetchingIterator.
 class TFRecordDataset : public Dataset {
  public:
   explicit TFRecordDataset(std::string path, int64_t buffer_size,
                            int64_t max_prefetch_num, int64_t prefetch_threshold,
-                           HostContext* host)
+                           bool verify_payload_checksum, HostContext* host)
       : path_(std::move(path)),
         buffer_size_(buffer_size),
         max_prefetch_num_(max_prefetch_num),
         prefetch_threshold_(prefetch_threshold),
+        verify_payload_checksum_(verify_payload_checksum),
         host_(host),
         allocator_(host->allocator()) {
-    assert(buffer_size_ >= 0);
+    assert(buffer_size_ > 0);
   }
 
   // This class is not copyable or movable.
   TFRecordDataset(const TFRecordDataset&) = delete;
   TFRecordDataset& operator=(const TFRecordDataset&) = delete;
 
-  RCReference<Iterator> MakeIterator(const IteratorContext& context) override;
+  string_view name() const override { return "tf_record"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
 
  private:
   friend class TFRecordDatasetIterator;
@@ -65,6 +179,7 @@ class TFRecordDataset : public Dataset {
   const int64_t buffer_size_;
   const int64_t max_prefetch_num_;
   const int64_t prefetch_threshold_;
+  const bool verify_payload_checksum_;
   HostContext* host_;
   HostAllocator* allocator_;
 };
@@ -87,7 +202,7 @@ class TFRecordDatasetIterator : public io::PrefetchingIterator {
   // the next record.
   IterationResult GetNextElement(const ExecutionContext& exec_ctx) final;
 
-  llvm::Error MaybeInitializeStream();
+  llvm::Error MaybeInitializeReader();
 
  private:
   void Destroy() override {
@@ -95,24 +210,8 @@ class TFRecordDatasetIterator : public io::PrefetchingIterator {
                                                    parent_dataset_->allocator_);
   }
 
-  // Reads n + 4 bytes from the input stream and verifies that the checksum of
-  // the first n bytes is stored in the last 4 bytes. Updates *eof to true
-  // iff stream_ is already at eof and no bytes are read. Returns an error if
-  // less than n + 4 bytes can be read, or the checksum doesn't match.
-  // Otherwise, advances the input stream by n + 4 bytes and returns the first
-  // n bytes.
-  // If eof is set to true, caller should not process the return value.
-  llvm::Expected<std::string> ReadChecksummed(size_t pos, size_t n, bool* eof);
-
-  // Reads a record from the input stream and advances the input stream to point
-  // to the start of the next record. Updates *eof to true iff stream_ is
-  // already at the end of file and there is no error. Otherwise, returns the
-  // record or an error. If eof is set to true, caller should not process the
-  // return value.
-  llvm::Expected<std::string> ReadRecord(bool* eof);
-
   RCReference<TFRecordDataset> parent_dataset_;
-  std::unique_ptr<::tfrt::io::InputStream> stream_;
+  RCReference<TFRecordReader> reader_;
   llvm::Error initialization_error_ = llvm::Error::success();
 };
 
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements TFRecordFilesDataset class which reads the records of
+// several TFRecord files concurrently.
+
+#include "tf_record_files_dataset.h"
+
+#include <utility>
+
+#include "tfrt/io/file_system.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/philox_random.h"
+
+namespace tfrt {
+namespace data {
+
+//===----------------------------------------------------------------------===//
+// Implementation for TFRecordFilesDataset member functions
+//===----------------------------------------------------------------------===//
+
+RCReference<Iterator> TFRecordFilesDataset::MakeIteratorImpl(
+    const IteratorContext& context) {
+  return TakeRef(
+      host_->Construct<TFRecordFilesDatasetIterator>(FormRef(this), context));
+}
+
+//===----------------------------------------------------------------------===//
+// Implementation for TFRecordFilesDatasetIterator member functions
+//===----------------------------------------------------------------------===//
+
+IterationResult TFRecordFilesDatasetIterator::GetNextElement(
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  if (auto error = MaybeInitializeFiles()) {
+    auto async_error = MakeErrorAsyncValueRef(host, StrCat(error));
+    return IterationResult::Error(std::move(async_error), 1);
+  }
+
+  // Keep num_parallel_reads files open.
+  const size_t num_parallel_reads = parent_dataset_->num_parallel_reads_;
+  while (readers_.size() < num_parallel_reads && next_file_ < files_.size()) {
+    readers_.emplace_back();
+    if (auto error = OpenNextFile(readers_.size() - 1, exec_ctx)) {
+      auto async_error = MakeErrorAsyncValueRef(host, StrCat(error));
+      return IterationResult::Error(std::move(async_error), 1);
+    }
+  }
+
+  while (!readers_.empty()) {
+    if (next_reader_ >= readers_.size()) next_reader_ = 0;
+    auto result = readers_[next_reader_]->GetNext(exec_ctx);
+    if (!result.eof.IsConcrete() || !result.eof.get()) {
+      ++next_reader_;
+      return result;
+    }
+    if (auto error = OpenNextFile(next_reader_, exec_ctx)) {
+      auto async_error = MakeErrorAsyncValueRef(host, StrCat(error));
+      return IterationResult::Error(std::move(async_error), 1);
+    }
+  }
+  return IterationResult::Eof(host, 1);
+}
+
+llvm::Error TFRecordFilesDatasetIterator::MaybeInitializeFiles() {
+  if (initialization_error_) {
+    return MakeStringError(initialization_error_);
+  }
+
+  if (initialized_) return llvm::Error::success();
+
+  auto* fs_registry = ::tfrt::io::FileSystemRegistry::Default();
+  std::vector<std::string> files;
+  for (const auto& pattern : parent_dataset_->patterns_) {
+    auto* file_system = fs_registry->LookupForPath(pattern);
+    if (!file_system) {
+      initialization_error_ =
+          MakeStringError("No file system is found for the given scheme");
+      return MakeStringError(initialization_error_);
+    }
+    const size_t num_files = files.size();
+    if (auto error = file_system->GetMatchingPaths(pattern, &files)) {
+      initialization_error_ = std::move(error);
+      return MakeStringError(initialization_error_);
+    }
+    if (files.size() == num_files) {
+      initialization_error_ = MakeStringError("no files match ", pattern);
+      return MakeStringError(initialization_error_);
+    }
+  }
+
+  // Keep the files of this shard.
+  for (size_t i = parent_dataset_->shard_index_; i < files.size();
+       i += parent_dataset_->num_shards_) {
+    files_.push_back(std::move(files[i]));
+  }
+  if (parent_dataset_->file_shuffle_seed_ >= 0) {
+    random::PhiloxRandom random(parent_dataset_->file_shuffle_seed_, 0);
+    for (size_t i = files_.size(); i > 1; --i)
+      std::swap(files_[i - 1], files_[random() % i]);
+  }
+  initialized_ = true;
+  return llvm::Error::success();
+}
+
+llvm::Error TFRecordFilesDatasetIterator::OpenNextFile(
+    size_t index, const ExecutionContext& exec_ctx) {
+  if (next_file_ == files_.size()) {
+    readers_.erase(readers_.begin() + index);
+    return llvm::Error::success();
+  }
+
+  auto reader = TFRecordReader::Open(
+      files_[next_file_++], parent_dataset_->buffer_size_,
+      parent_dataset_->verify_payload_checksum_, parent_dataset_->allocator_);
+  if (!reader) {
+    readers_.erase(readers_.begin() + index);
+    return reader.takeError();
+  }
+  readers_[index] = std::move(*reader);
+  readers_[index]->Start(exec_ctx);
+  return llvm::Error::success();
+}
+
+}  // namespace data
+}  // namespace tfrt
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares TFRecordFilesDataset class which reads the records of
+// several TFRecord files concurrently.
+
+#ifndef TFRT_LIB_DATA_TF_RECORD_FILES_DATASET_H_
+#define TFRT_LIB_DATA_TF_RECORD_FILES_DATASET_H_
+
+#include <string>
+#include <vector>
+
+#include "io.h"
+#include "tf_record_dataset.h"
+#include "tfrt/data/dataset.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace data {
+
+// TFRecordFilesDataset reads the records of the files that match a list of
+// paths or glob patterns, in the order of the patterns and of the sorted
+// matches of each pattern.
+//
+// The files are sharded for distributed input: the dataset reads the files
+// whose index in that order is `shard_index` modulo `num_shards`. If
+// `file_shuffle_seed` is not negative, each iterator reads the files of the
+// shard in a random order, the first level of a two level shuffle with a
+// shuffle buffer after this dataset.
+//
+// The iterator reads `num_parallel_reads` files at a time, each with a
+// TFRecordReader that reads ahead on the blocking work queue, so the files are
+// read concurrently. It returns one record of each file in turn, and replaces
+// a file that reached the end with the next file in its place. The order of
+// the records is deterministic.
+class TFRecordFilesDataset : public Dataset {
+ public:
+  explicit TFRecordFilesDataset(std::vector<std::string> patterns,
+                                int64_t num_parallel_reads, int64_t num_shards,
+                                int64_t shard_index, int64_t file_shuffle_seed,
+                                int64_t buffer_size, int64_t max_prefetch_num,
+                                int64_t prefetch_threshold,
+                                bool verify_payload_checksum, HostContext* host)
+      : patterns_(std::move(patterns)),
+        num_parallel_reads_(num_parallel_reads),
+        num_shards_(num_shards),
+        shard_index_(shard_index),
+        file_shuffle_seed_(file_shuffle_seed),
+        buffer_size_(buffer_size),
+        max_prefetch_num_(max_prefetch_num),
+        prefetch_threshold_(prefetch_threshold),
+        verify_payload_checksum_(verify_payload_checksum),
+        host_(host),
+        allocator_(host->allocator()) {
+    assert(num_parallel_reads_ > 0);
+    assert(num_shards_ > 0);
+    assert(shard_index_ >= 0 && shard_index_ < num_shards_);
+    assert(buffer_size_ > 0);
+  }
+
+  // This class is not copyable or movable.
+  TFRecordFilesDataset(const TFRecordFilesDataset&) = delete;
+  TFRecordFilesDataset& operator=(const TFRecordFilesDataset&) = delete;
+
+  string_view name() const override { return "tf_record_files"; }
+
+  RCReference<Iterator> MakeIteratorImpl(
+      const IteratorContext& context) override;
+
+ private:
+  friend class TFRecordFilesDatasetIterator;
+
+  void Destroy() override {
+    internal::DestroyImpl<TFRecordFilesDataset>(this, allocator_);
+  }
+
+  const std::vector<std::string> patterns_;
+  const int64_t num_parallel_reads_;
+  const int64_t num_shards_;
+  const int64_t shard_index_;
+  const int64_t file_shuffle_seed_;
+  const int64_t buffer_size_;
+  const int64_t max_prefetch_num_;
+  const int64_t prefetch_threshold_;
+  const bool verify_payload_checksum_;
+  HostContext* host_;
+  HostAllocator* allocator_;
+};
+
+class TFRecordFilesDatasetIterator : public io::PrefetchingIterator {
+ public:
+  explicit TFRecordFilesDatasetIterator(
+      RCReference<TFRecordFilesDataset> parent_dataset,
+      const IteratorContext& context)
+      : io::PrefetchingIterator(parent_dataset->max_prefetch_num_,
+                                parent_dataset->prefetch_threshold_, context),
+        parent_dataset_(std::move(parent_dataset)) {}
+
+  // This class is not copyable or movable.
+  TFRecordFilesDatasetIterator(const TFRecordFilesDatasetIterator&) = delete;
+  TFRecordFilesDatasetIterator& operator=(const TFRecordFilesDatasetIterator&) =
+      delete;
+
+ protected:
+  // Reads the next record from the open files, in turn.
+  IterationResult GetNextElement(const ExecutionContext& exec_ctx) final;
+
+ private:
+  void Destroy() override {
+    internal::DestroyImpl<TFRecordFilesDatasetIterator>(
+        this, parent_dataset_->allocator_);
+  }
+
+  // Lists the files of this shard, in a random order if file_shuffle_seed is
+  // not negative.
+  llvm::Error MaybeInitializeFiles();
+
+  // Opens the next file into readers_[index], or removes readers_[index] if
+  // there are no more files. The reader starts reading the file right away.
+  llvm::Error OpenNextFile(size_t index, const ExecutionContext& exec_ctx);
+
+  RCReference<TFRecordFilesDataset> parent_dataset_;
+  bool initialized_ = false;
+  llvm::Error initialization_error_ = llvm::Error::success();
+
+  // The files of this shard and the index of the next file to open.
+  std::vector<std::string> files_;
+  size_t next_file_ = 0;
+
+  // The readers of the open files and the index of the next reader to read.
+  std::vector<RCReference<TFRecordReader>> readers_;
+  size_t next_reader_ = 0;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_TF_RECORD_FILES_DATASET_H_
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements BatchingRemoteClient.
+
+#include "tfrt/distributed_runtime/batching_remote_client.h"
+
+#include <string>
+#include <utility>
+
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+
+BatchingRemoteClient::~BatchingRemoteClient() {
+  mutex_lock lock(mu_);
+  assert(num_inflight_batches_ == 0 && "Batches are still in flight");
+  assert(!pending_batch_ && "Requests were not sent");
+}
+
+void BatchingRemoteClient::RemoteExecuteAsync(
+    RemoteCallContext* call_ctx, const RemoteExecuteRequest* request,
+    RemoteExecuteResponse* response, CallbackFn done) {
+  if (call_ctx != RemoteCallContext::GetDefault()) {
+    client_->RemoteExecuteAsync(call_ctx, request, response, std::move(done));
+    return;
+  }
+  AddRequest(
+      request->ByteSizeLong(),
+      [&](BatchedRequest* batched) {
+        *batched->mutable_remote_execute() = *request;
+      },
+      [response, done = std::move(done)](Error e,
+                                         BatchedResponse* batched) mutable {
+        if (batched) response->Swap(batched->mutable_remote_execute());
+        done(std::move(e));
+      });
+}
+
+void BatchingRemoteClient::SendReadyChainsAsync(
+    RemoteCallContext* call_ctx, const SendReadyChainsRequest* request,
+    SendReadyChainsResponse* response, CallbackFn done) {
+  if (call_ctx != RemoteCallContext::GetDefault()) {
+    client_->SendReadyChainsAsync(call_ctx, request, response,
+                                  std::move(done));
+    return;
+  }
+  AddRequest(
+      request->ByteSizeLong(),
+      [&](BatchedRequest* batched) {
+        *batched->mutable_send_ready_chains() = *request;
+      },
+      [response, done = std::move(done)](Error e,
+                                         BatchedResponse* batched) mutable {
+        if (batched) response->Swap(batched->mutable_send_ready_chains());
+        done(std::move(e));
+      });
+}
+
+void BatchingRemoteClient::DeleteRemoteObjectsAsync(
+    RemoteCallContext* call_ctx, const DeleteRemoteObjectsRequest* request,
+    DeleteRemoteObjectsResponse* response, CallbackFn done) {
+  if (call_ctx != RemoteCallContext::GetDefault()) {
+    client_->DeleteRemoteObjectsAsync(call_ctx, request, response,
+                                      std::move(done));
+    return;
+  }
+  AddRequest(
+      request->ByteSizeLong(),
+      [&](BatchedRequest* batched) {
+        *batched->mutable_delete_remote_objects() = *request;
+      },
+      [response, done = std::move(done)](Error e,
+                                         BatchedResponse* batched) mutable {
+        if (batched) response->Swap(batched->mutable_delete_remote_objects());
+        done(std::move(e));
+      });
+}
+
+void BatchingRemoteClient::AddRequest(
+    size_t num_bytes, llvm::function_ref<void(BatchedRequest*)> set_request,
+    ResponseFn response_fn) {
+  std::unique_ptr<Batch> batch;
+  {
+    mutex_lock lock(mu_);
+    if (!pending_batch_) pending_batch_ = std::make_unique<Batch>();
+    set_request(pending_batch_->request.add_requests());
+    pending_batch_->num_bytes += num_bytes;
+    pending_batch_->response_fns.push_back(std::move(response_fn));
+
+    const bool full =
+        pending_batch_->response_fns.size() >= options_.max_batch_size ||
+        pending_batch_->num_bytes >= options_.max_batch_bytes;
+    if (!full && num_inflight_batches_ >= options_.max_inflight_batches) return;
+    batch = std::move(pending_batch_);
+    ++num_inflight_batches_;
+  }
+  SendBatch(std::move(batch));
+}
+
+void BatchingRemoteClient::SendBatch(std::unique_ptr<Batch> batch) {
+  const BatchRequest* request = &batch->request;
+  auto response = std::make_unique<BatchResponse>();
+  BatchResponse* response_ptr = response.get();
+  client_->BatchAsync(
+      RemoteCallContext::GetDefault(), request, response_ptr,
+      [this, batch = std::move(batch),
+       response = std::move(response)](Error e) mutable {
+        // Send the requests that accumulated in the meantime before invoking
+        // the callbacks, which may take a while.
+        std::unique_ptr<Batch> next_batch;
+        {
+          mutex_lock lock(mu_);
+          if (pending_batch_) {
+            next_batch = std::move(pending_batch_);
+          } else {
+            --num_inflight_batches_;
+          }
+        }
+        if (next_batch) SendBatch(std::move(next_batch));
+
+        const std::string batch_error = e ? StrCat(e) : std::string();
+        auto& response_fns = batch->response_fns;
+        for (int i = 0; i < response_fns.size(); ++i) {
+          if (!batch_error.empty()) {
+            response_fns[i](MakeStringError(batch_error), nullptr);
+          } else if (i >= response->responses_size()) {
+            response_fns[i](MakeStringError("missing response in batch"),
+                            nullptr);
+          } else {
+            BatchedResponse* batched = response->mutable_responses(i);
+            Error error = batched->error_message().empty()
+                              ? Error::success()
+                              : MakeStringError(batched->error_message());
+            response_fns[i](std::move(error), batched);
+          }
+        }
+      });
+}
+
+}  // namespace tfrt
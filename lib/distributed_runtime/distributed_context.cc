@@ -20,9 +20,13 @@
 
 #include "tfrt/distributed_runtime/distributed_context.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "llvm/ADT/DenseMap.h"
 #include "tfrt/bef/bef_buffer.h"
 #include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/distributed_runtime/batching_remote_client.h"
 #include "tfrt/distributed_runtime/callback_registry.h"
 #include "tfrt/distributed_runtime/cluster_info.h"
 #include "tfrt/distributed_runtime/fabric_communicator.h"
@@ -52,7 +56,9 @@ DistributedContext::DistributedContext(
       remote_manager_(std::make_unique<RemoteObjectManager>(
           cluster_info_.GetTaskHandle(), GetHostContext())),
       callback_registry_(new CallbackRegistry()),
-      function_cache_(new FunctionCache(GetHostContext())) {
+      function_cache_(new FunctionCache(GetHostContext())),
+      payload_codec_(configuration.payload_compression(),
+                     GetHostContext()->allocator()) {
   TaskHandle task_handle = cluster_info_.GetTaskHandle();
   DeviceManager* local_device_mgr = GetHostContext()->GetDeviceManager();
   // For each local device, add a corresponding RemoveDevice instance with the
@@ -112,14 +118,42 @@ RemoteClientInterface* DistributedContext::GetRemoteClient(
   auto it = remote_clients_.find(task_handle);
   if (it == remote_clients_.end()) {
     auto* communicator = server_context_->GetOrCreateFabricCommunicator();
-    auto ret = remote_clients_.try_emplace(
-        task_handle, communicator->CreateRemoteClient(this, task_handle));
+    std::unique_ptr<RemoteClientInterface> client =
+        communicator->CreateRemoteClient(this, task_handle);
+    const RequestBatchingConfiguration& batching =
+        dist_config_.request_batching();
+    if (batching.enabled()) {
+      BatchingRemoteClient::Options options;
+      if (batching.max_batch_size() > 0)
+        options.max_batch_size = batching.max_batch_size();
+      if (batching.max_batch_bytes() > 0)
+        options.max_batch_bytes = batching.max_batch_bytes();
+      if (batching.max_inflight_batches() > 0)
+        options.max_inflight_batches = batching.max_inflight_batches();
+      client =
+          std::make_unique<BatchingRemoteClient>(std::move(client), options);
+    }
+    auto ret = remote_clients_.try_emplace(task_handle, std::move(client));
     assert(ret.second && "Failed to create remote client.");
     it = ret.first;
   }
   return it->second.get();
 }
 
+namespace {
+void RemoteObjectIdToProto(const RemoteObjectId& obj_id,
+                           RemoteObjectIdProto* proto) {
+  proto->set_device(obj_id.device->name().str());
+  proto->set_prefix_id(obj_id.prefix_id);
+  proto->set_local_id(obj_id.local_id);
+}
+
+bool IsSameObject(const RemoteObjectId& a, const RemoteObjectId& b) {
+  return a.prefix_id == b.prefix_id && a.local_id == b.local_id &&
+         a.device.get() == b.device.get();
+}
+}  // namespace
+
 void DistributedContext::GetRemoteDevices(
     DistributedContext::CallbackFn done_callback) {
   // Reference-counted done callback is invoked after all remote calls finish
@@ -135,8 +169,9 @@ void DistributedContext::GetRemoteDevices(
       TaskHandle task_handle = GetTaskHandle(job_config.name(), task.first);
       RemoteClientInterface* client = GetRemoteClient(task_handle);
       auto response = std::make_unique<GetDevicesResponse>();
+      GetDevicesResponse* response_ptr = response.get();
       client->GetDevicesAsync(
-          &call_ctx, request.get(), response.get(),
+          &call_ctx, request.get(), response_ptr,
           [request, response = std::move(response), rc_done = rc_done.CopyRef(),
            this, job_name = job_config.name(), task_id = task.first,
            task_handle](Error e) mutable {
@@ -177,12 +212,11 @@ void DistributedContext::CreateRemoteContexts(
       });
 
   // Base request contains information that is the shared by all the requests
-  // sent to different tasks, including the cluster configuration and collective
-  // groups of distributed context configuration.
-  // Individual requests can directly set to use the allocated fields of the
-  // base one without memory copies. The base request must be alive until all
-  // uses of individual requests have finished.
+  // sent to different tasks, including the cluster configuration, collective
+  // groups of distributed context configuration and the cluster devices.
   auto base_request = std::make_shared<CreateContextRequest>();
+  base_request->set_context_id(context_id_);
+  base_request->set_is_multi_client(mode == RemoteInitMode::MULTI_CLIENT);
   *base_request->mutable_dist_config()->mutable_cluster_config() =
       dist_config_.cluster_config();
   *base_request->mutable_dist_config()->mutable_collective_groups() =
@@ -192,60 +226,123 @@ void DistributedContext::CreateRemoteContexts(
     device_info->set_name(device->name().str());
     device_info->set_type(device->type().name().str());
   }
+  std::vector<std::string> tasks;
   for (const auto& job_config : dist_config_.cluster_config().jobs()) {
     for (const auto& task : job_config.tasks()) {
       if (job_config.name() == dist_config_.job_name() &&
           task.first == dist_config_.task_id()) {
         continue;
       }
+      tasks.push_back(
+          TaskNameUtil::ConcatTaskName(job_config.name(), task.first));
+    }
+  }
 
-      auto request = std::make_unique<CreateContextRequest>();
-      request->set_context_id(context_id_);
-      auto* request_dist_config = request->mutable_dist_config();
-      request_dist_config->set_job_name(job_config.name());
-      request_dist_config->set_task_id(task.first);
-      request_dist_config->unsafe_arena_set_allocated_cluster_config(
-          base_request->mutable_dist_config()->mutable_cluster_config());
-      for (auto& cg :
-           *base_request->mutable_dist_config()->mutable_collective_groups()) {
-        request_dist_config->mutable_collective_groups()
-            ->UnsafeArenaAddAllocated(&cg);
-      }
-      for (auto& device : *base_request->mutable_devices()) {
-        request->mutable_devices()->UnsafeArenaAddAllocated(&device);
-      }
-      request->set_is_multi_client(mode == RemoteInitMode::MULTI_CLIENT);
+  SendCreateContextToTasks(std::move(base_request), tasks, std::move(rc_done));
+}
 
-      TaskHandle task_handle = GetTaskHandle(job_config.name(), task.first);
-      RemoteClientInterface* client = GetRemoteClient(task_handle);
-      auto response = std::make_unique<CreateContextResponse>();
-      client->CreateContextAsync(
-          RemoteCallContext::GetDefault(), request.get(), response.get(),
-          [this, task_handle, base_request, request = std::move(request),
-           response = std::move(response),
-           rc_done = rc_done.CopyRef()](Error e) mutable {
-            if (e) {
-              rc_done->UpdateState(std::move(e));
-            } else {
-              rc_done->UpdateState(
-                  AddReadyChain(task_handle, response->ready_chain()));
-            }
-            // NOTE: `base_request` is the owner of `cluster_config` and
-            // `collective_groups`. Release these fields from `request` so that
-            // these fields are not destructed multiple times.
-            auto request_dist_config = request->mutable_dist_config();
-            request_dist_config->unsafe_arena_release_cluster_config();
-            const int n_groups = request_dist_config->collective_groups_size();
-            for (int i = 0; i < n_groups; i++) {
-              request_dist_config->mutable_collective_groups()
-                  ->UnsafeArenaReleaseLast();
-            }
-            const int n_devices = request->devices_size();
-            for (int i = 0; i < n_devices; i++) {
-              request->mutable_devices()->UnsafeArenaReleaseLast();
-            }
-          });
+void DistributedContext::ForwardCreateContext(
+    const CreateContextRequest& request, CreateContextResponse* response,
+    DistributedContext::CallbackFn done_callback) {
+  if (request.forward_to_tasks().empty()) {
+    done_callback(Error::success());
+    return;
+  }
+  std::vector<std::string> tasks(request.forward_to_tasks().begin(),
+                                 request.forward_to_tasks().end());
+  auto rc_done = MakeRef<RefCountedCallback>(
+      [this, tasks, response,
+       done_callback = std::move(done_callback)](Error e) mutable {
+        if (e) {
+          done_callback(std::move(e));
+          return;
+        }
+        // The ready chains of the subtree were added by the responses of the
+        // forwarded requests.
+        done_callback(AddSubtreeReadyChains(tasks, response));
+      });
+  SendCreateContextToTasks(std::make_shared<CreateContextRequest>(request),
+                           tasks, std::move(rc_done));
+}
+
+void DistributedContext::SendCreateContextToTasks(
+    std::shared_ptr<CreateContextRequest> base_request,
+    ArrayRef<std::string> tasks, RCReference<RefCountedCallback> done) {
+  const size_t num_subtrees = std::min(tasks.size(), kCreateContextFanout);
+  for (size_t i = 0; i < num_subtrees; ++i) {
+    const size_t begin = i * tasks.size() / num_subtrees;
+    const size_t end = (i + 1) * tasks.size() / num_subtrees;
+    Expected<TaskHandle> task_handle =
+        cluster_info_.GetTaskHandle(tasks[begin]);
+    if (!task_handle) {
+      done->UpdateState(task_handle.takeError());
+      continue;
+    }
+    std::string job_name;
+    int task_id;
+    if (Error e =
+            TaskNameUtil::ParseTaskName(tasks[begin], &job_name, &task_id)) {
+      done->UpdateState(std::move(e));
+      continue;
+    }
+
+    // Individual requests directly use the allocated fields of the base one
+    // without memory copies. The base request must be alive until all uses of
+    // individual requests have finished.
+    auto request = std::make_unique<CreateContextRequest>();
+    request->set_context_id(base_request->context_id());
+    request->set_is_multi_client(base_request->is_multi_client());
+    auto* request_dist_config = request->mutable_dist_config();
+    request_dist_config->set_job_name(job_name);
+    request_dist_config->set_task_id(task_id);
+    request_dist_config->unsafe_arena_set_allocated_cluster_config(
+        base_request->mutable_dist_config()->mutable_cluster_config());
+    for (auto& cg :
+         *base_request->mutable_dist_config()->mutable_collective_groups()) {
+      request_dist_config->mutable_collective_groups()->UnsafeArenaAddAllocated(
+          &cg);
+    }
+    for (auto& device : *base_request->mutable_devices()) {
+      request->mutable_devices()->UnsafeArenaAddAllocated(&device);
     }
+    for (size_t j = begin + 1; j < end; ++j) {
+      request->add_forward_to_tasks(tasks[j]);
+    }
+
+    RemoteClientInterface* client = GetRemoteClient(*task_handle);
+    auto response = std::make_unique<CreateContextResponse>();
+    CreateContextRequest* request_ptr = request.get();
+    CreateContextResponse* response_ptr = response.get();
+    client->CreateContextAsync(
+        RemoteCallContext::GetDefault(), request_ptr, response_ptr,
+        [this, task_handle = *task_handle, base_request,
+         request = std::move(request), response = std::move(response),
+         done = done.CopyRef()](Error e) mutable {
+          if (e) {
+            done->UpdateState(std::move(e));
+          } else {
+            done->UpdateState(
+                AddReadyChain(task_handle, response->ready_chain()));
+            for (const auto& chain : response->subtree_ready_chains()) {
+              done->UpdateState(
+                  AddReadyChain(GetTaskHandle(chain.device()), chain));
+            }
+          }
+          // NOTE: `base_request` is the owner of `cluster_config`,
+          // `collective_groups` and `devices`. Release these fields from
+          // `request` so that these fields are not destructed multiple times.
+          auto request_dist_config = request->mutable_dist_config();
+          request_dist_config->unsafe_arena_release_cluster_config();
+          const int n_groups = request_dist_config->collective_groups_size();
+          for (int i = 0; i < n_groups; i++) {
+            request_dist_config->mutable_collective_groups()
+                ->UnsafeArenaReleaseLast();
+          }
+          const int n_devices = request->devices_size();
+          for (int i = 0; i < n_devices; i++) {
+            request->mutable_devices()->UnsafeArenaReleaseLast();
+          }
+        });
   }
 }
 
@@ -260,62 +357,118 @@ Error DistributedContext::AddReadyChain(TaskHandle task_handle,
   RemoteObjectId ready_chain(chain.prefix_id(), chain.local_id(),
                              device.CopyRef());
   mutex_lock l(ready_chains_mu_);
-  ready_chains_.insert({task_handle, ready_chain});
+  // A later broadcast may replace the chain.
+  auto it = ready_chains_.try_emplace(task_handle, ready_chain);
+  if (!it.second) it.first->second = ready_chain;
   return Error::success();
 }
 
-namespace {
-void RemoteObjectIdToProto(RemoteObjectId& obj_id, RemoteObjectIdProto* proto) {
-  proto->set_device(obj_id.device->name().str());
-  proto->set_prefix_id(obj_id.prefix_id);
-  proto->set_local_id(obj_id.local_id);
+Error DistributedContext::AddSubtreeReadyChains(
+    ArrayRef<std::string> tasks, CreateContextResponse* response) {
+  mutex_lock l(ready_chains_mu_);
+  for (const auto& task : tasks) {
+    Expected<TaskHandle> task_handle = cluster_info_.GetTaskHandle(task);
+    if (!task_handle) return task_handle.takeError();
+    auto it = ready_chains_.find(*task_handle);
+    if (it == ready_chains_.end()) {
+      return llvm::make_error<UnknownErrorInfo>(
+          StrCat("Missing remote ready chain from ", task));
+    }
+    RemoteObjectIdToProto(it->second, response->add_subtree_ready_chains());
+  }
+  return Error::success();
 }
-}  // namespace
 
 void DistributedContext::BroadcastRemoteReadyChains(
     DistributedContext::CallbackFn done_callback) {
-  // Reference-counted done callback is invoked after all remote calls finish
-  auto rc_done = MakeRef<RefCountedCallback>(std::move(done_callback));
-  // Create a copy of remote ready chains to avoid frequent mutex locking when
-  // constructng the reqeust.
-  auto ready_chain_objs = RemoteReadyChains();
+  // Reference-counted done callback is invoked after all remote calls finish.
+  // If any of them failed, the next broadcast sends all chains again.
+  auto rc_done = MakeRef<RefCountedCallback>(
+      [this, done_callback = std::move(done_callback)](Error e) mutable {
+        if (e) {
+          mutex_lock l(ready_chains_mu_);
+          broadcast_ready_chains_.clear();
+        }
+        done_callback(std::move(e));
+      });
 
-  auto request = std::make_shared<SendReadyChainsRequest>();
-  request->set_context_id(context_id_);
-  for (const auto& job_config : dist_config_.cluster_config().jobs()) {
-    for (const auto& task : job_config.tasks()) {
-      auto ready_chain = request->add_ready_chains();
-      TaskHandle task_handle = GetTaskHandle(job_config.name(), task.first);
-      if (task_handle == GetTaskHandle()) {
-        RemoteObjectIdToProto(*local_ready_chain_, ready_chain);
-      } else {
-        auto it = ready_chain_objs.find(task_handle);
-        if (it == ready_chain_objs.end()) {
-          rc_done->UpdateState(llvm::make_error<UnknownErrorInfo>(StrCat(
-              "Missing remote ready chain from ",
-              TaskNameUtil::ConcatTaskName(job_config.name(), task.first))));
+  SendReadyChainsRequest changed;
+  std::vector<std::string> tasks;
+  {
+    mutex_lock l(ready_chains_mu_);
+    for (const auto& job_config : dist_config_.cluster_config().jobs()) {
+      for (const auto& task : job_config.tasks()) {
+        TaskHandle task_handle = GetTaskHandle(job_config.name(), task.first);
+        const RemoteObjectId* ready_chain = nullptr;
+        if (task_handle == GetTaskHandle()) {
+          ready_chain = local_ready_chain_.get();
+        } else {
+          tasks.push_back(
+              TaskNameUtil::ConcatTaskName(job_config.name(), task.first));
+          auto it = ready_chains_.find(task_handle);
+          if (it == ready_chains_.end()) {
+            rc_done->UpdateState(llvm::make_error<UnknownErrorInfo>(StrCat(
+                "Missing remote ready chain from ",
+                TaskNameUtil::ConcatTaskName(job_config.name(), task.first))));
+            continue;
+          }
+          ready_chain = &it->second;
+        }
+        auto sent = broadcast_ready_chains_.find(task_handle);
+        if (sent != broadcast_ready_chains_.end()) {
+          if (IsSameObject(sent->second, *ready_chain)) continue;
+          sent->second = *ready_chain;
         } else {
-          RemoteObjectIdToProto(it->getSecond(), ready_chain);
+          broadcast_ready_chains_.try_emplace(task_handle, *ready_chain);
         }
+        RemoteObjectIdToProto(*ready_chain, changed.add_ready_chains());
       }
     }
   }
 
-  for (const auto& job_config : dist_config_.cluster_config().jobs()) {
-    for (const auto& task : job_config.tasks()) {
-      if (job_config.name() == dist_config_.job_name() &&
-          task.first == dist_config_.task_id()) {
-        continue;
-      }
-      TaskHandle task_handle = GetTaskHandle(job_config.name(), task.first);
-      RemoteClientInterface* client = GetRemoteClient(task_handle);
-      auto response = std::make_shared<SendReadyChainsResponse>();
-      client->SendReadyChainsAsync(
-          RemoteCallContext::GetDefault(), request.get(), response.get(),
-          [request, response, rc_done = rc_done.CopyRef()](Error e) mutable {
-            rc_done->UpdateState(std::move(e));
-          });
+  SendReadyChainsToTasks(changed.ready_chains(), tasks, std::move(rc_done));
+}
+
+void DistributedContext::ForwardRemoteReadyChains(
+    const SendReadyChainsRequest& request,
+    DistributedContext::CallbackFn done_callback) {
+  std::vector<std::string> tasks(request.forward_to_tasks().begin(),
+                                 request.forward_to_tasks().end());
+  SendReadyChainsToTasks(request.ready_chains(), tasks,
+                         MakeRef<RefCountedCallback>(std::move(done_callback)));
+}
+
+void DistributedContext::SendReadyChainsToTasks(
+    const google::protobuf::RepeatedPtrField<RemoteObjectIdProto>&
+        ready_chains,
+    ArrayRef<std::string> tasks, RCReference<RefCountedCallback> done) {
+  const size_t num_subtrees = std::min(tasks.size(), kReadyChainsFanout);
+  for (size_t i = 0; i < num_subtrees; ++i) {
+    const size_t begin = i * tasks.size() / num_subtrees;
+    const size_t end = (i + 1) * tasks.size() / num_subtrees;
+    Expected<TaskHandle> task_handle =
+        cluster_info_.GetTaskHandle(tasks[begin]);
+    if (!task_handle) {
+      done->UpdateState(task_handle.takeError());
+      continue;
+    }
+
+    auto request = std::make_unique<SendReadyChainsRequest>();
+    request->set_context_id(context_id_);
+    *request->mutable_ready_chains() = ready_chains;
+    for (size_t j = begin + 1; j < end; ++j) {
+      request->add_forward_to_tasks(tasks[j]);
     }
+    auto response = std::make_unique<SendReadyChainsResponse>();
+    SendReadyChainsRequest* request_ptr = request.get();
+    SendReadyChainsResponse* response_ptr = response.get();
+    RemoteClientInterface* client = GetRemoteClient(*task_handle);
+    client->SendReadyChainsAsync(
+        RemoteCallContext::GetDefault(), request_ptr, response_ptr,
+        [request = std::move(request), response = std::move(response),
+         done = done.CopyRef()](Error e) mutable {
+          done->UpdateState(std::move(e));
+        });
   }
 }
 
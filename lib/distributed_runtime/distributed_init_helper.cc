@@ -20,12 +20,16 @@
 
 #include "tfrt/distributed_runtime/distributed_init_helper.h"
 
+#include <chrono>
+#include <vector>
+
 #include "google/protobuf/util/message_differencer.h"
 #include "tfrt/distributed_runtime/distributed_context.h"
 #include "tfrt/distributed_runtime/proto/cluster_config.pb.h"
 #include "tfrt/distributed_runtime/server_context.h"
 #include "tfrt/distributed_runtime/task_name_util.h"
 #include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/metrics/metrics.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/random_util.h"
 
@@ -41,6 +45,77 @@ bool IsMultiClientLead(DistributedContextConfiguration& configuration) {
   return configuration.job_name() == lead_job &&
          configuration.task_id() == lead_task;
 }
+
+// Latency histograms of the phases of cluster initialization on the single
+// client or the lead task.
+struct InitPhaseMetrics {
+  metrics::Histogram* get_devices_ms;
+  metrics::Histogram* create_contexts_ms;
+  metrics::Histogram* broadcast_ready_chains_ms;
+  metrics::Histogram* total_ms;
+};
+
+const InitPhaseMetrics& GetInitPhaseMetrics() {
+  static const InitPhaseMetrics* init_metrics = [] {
+    // Powers of 2 from 1ms to ~9h.
+    std::vector<double> bounds;
+    for (double bound = 1; bound < 4e7; bound *= 2) bounds.push_back(bound);
+    auto buckets = metrics::Buckets::Explicit(std::move(bounds));
+    auto histogram = [&](const char* phase) {
+      return metrics::NewHistogram(
+          StrCat("/tfrt/distributed_runtime/init/", phase), buckets);
+    };
+    return new InitPhaseMetrics{
+        histogram("get_devices_ms"), histogram("create_contexts_ms"),
+        histogram("broadcast_ready_chains_ms"), histogram("total_ms")};
+  }();
+  return *init_metrics;
+}
+
+// Returns a callback that records the time until it is invoked in `histogram`,
+// and then invokes `done`.
+DistributedContext::CallbackFn TimePhase(metrics::Histogram* histogram,
+                                         DistributedContext::CallbackFn done) {
+  auto start = std::chrono::steady_clock::now();
+  return [histogram, start, done = std::move(done)](Error e) mutable {
+    histogram->Record(std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count());
+    done(std::move(e));
+  };
+}
+
+// Collects the devices of the remote tasks, creates contexts on them and, in
+// multi-client mode, broadcasts their ready chains. The remote calls of each
+// phase are issued concurrently, and the creation of contexts and the
+// broadcast are forwarded along a tree of tasks.
+void InitializeRemoteTasks(DistributedContext* context,
+                           DistributedContext::RemoteInitMode mode,
+                           DistributedContext::CallbackFn done) {
+  const InitPhaseMetrics& init_metrics = GetInitPhaseMetrics();
+  done = TimePhase(init_metrics.total_ms, std::move(done));
+  context->GetRemoteDevices(TimePhase(
+      init_metrics.get_devices_ms,
+      [context, mode, done = std::move(done)](Error e) mutable {
+        if (e) {
+          done(std::move(e));
+          return;
+        }
+        context->CreateRemoteContexts(
+            mode,
+            TimePhase(
+                GetInitPhaseMetrics().create_contexts_ms,
+                [context, mode, done = std::move(done)](Error e) mutable {
+                  if (e || mode != DistributedContext::MULTI_CLIENT) {
+                    done(std::move(e));
+                    return;
+                  }
+                  context->BroadcastRemoteReadyChains(
+                      TimePhase(GetInitPhaseMetrics().broadcast_ready_chains_ms,
+                                std::move(done)));
+                }));
+      }));
+}
 }  // namespace
 
 void DistributedInitHelper::InitializeSingleClientDistributedContext(
@@ -57,21 +132,14 @@ void DistributedInitHelper::InitializeSingleClientDistributedContext(
   DistributedContext* dist_context = expected.get();
 
   // Create distributed contexts on remote tasks in the cluster.
-  dist_context->GetRemoteDevices(
+  InitializeRemoteTasks(
+      dist_context, DistributedContext::RemoteInitMode::SINGLE_CLIENT,
       [dist_context, done = std::move(done)](Error e) mutable {
         if (e) {
           done(std::move(e));
-          return;
+        } else {
+          done(dist_context);
         }
-        dist_context->CreateRemoteContexts(
-            DistributedContext::RemoteInitMode::SINGLE_CLIENT,
-            [dist_context, done = std::move(done)](Error e) mutable {
-              if (e) {
-                done(std::move(e));
-              } else {
-                done(dist_context);
-              }
-            });
       });
 }
 
@@ -82,29 +150,19 @@ void DistributedInitHelper::InitializeMultiClientDistributedContext(
     uint64_t context_id = random::New64();
     auto expected = server_context_->CreateDistributedContext(
         context_id, std::move(configuration));
+    if (!expected) {
+      done(expected.takeError());
+      return;
+    }
     DistributedContext* context = expected.get();
-    context->GetRemoteDevices(
+    InitializeRemoteTasks(
+        context, DistributedContext::RemoteInitMode::MULTI_CLIENT,
         [context, done = std::move(done)](Error e) mutable {
           if (e) {
             done(std::move(e));
-            return;
+          } else {
+            done(context);
           }
-          context->CreateRemoteContexts(
-              DistributedContext::RemoteInitMode::MULTI_CLIENT,
-              [context, done = std::move(done)](Error e) mutable {
-                if (e) {
-                  done(std::move(e));
-                  return;
-                }
-                context->BroadcastRemoteReadyChains(
-                    [context, done = std::move(done)](Error e) mutable {
-                      if (e) {
-                        done(std::move(e));
-                        return;
-                      }
-                      done(context);
-                    });
-              });
         });
   } else {
     mutex_lock l(mu_);
@@ -16,11 +16,12 @@
 
 //===- function_cache.cc - Function Cache ----------------*- C++ -*--------===//
 //
-// Contains implementation of FunctionCache class.
+// Contains implementation of FunctionCache and CompiledProgramCache classes.
 
 #include "tfrt/distributed_runtime/function_cache.h"
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/MD5.h"
 #include "tfrt/bef/bef_buffer.h"
 #include "tfrt/bef_executor/bef_file.h"
 #include "tfrt/distributed_runtime/callback_registry.h"
@@ -44,6 +45,10 @@ Error FunctionCache::Register(const std::string& program_name,
         StrCat("Failed to open lowered BEF for function ", program_name, "."));
   }
   const Function* fn = bef_file->GetFunction(program_name);
+  if (fn == nullptr) {
+    return llvm::make_error<MalformattedMlirFileErrorInfo>(
+        StrCat("Failed to find function ", program_name, " in program."));
+  }
   int arg_index = 0;
   bool require_distributed_context = false;
   if (fn->num_arguments() > 0 &&
@@ -82,4 +87,47 @@ FunctionCache::CachedBEF* FunctionCache::Prepare(
   return nullptr;
 }
 
+std::string CompiledProgramCache::Fingerprint(string_view program) {
+  llvm::MD5 hash;
+  hash.update(program);
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  return std::string(reinterpret_cast<const char*>(result.Bytes.data()),
+                     result.Bytes.size());
+}
+
+std::string CompiledProgramCache::Key(string_view fingerprint,
+                                      bool need_compilation,
+                                      bool program_is_bef) {
+  std::string key(fingerprint);
+  key.push_back(static_cast<char>(need_compilation | program_is_bef << 1));
+  return key;
+}
+
+std::shared_ptr<const CompiledProgramCache::CompiledProgram>
+CompiledProgramCache::Lookup(const std::string& key) const {
+  mutex_lock lock(mu_);
+  auto iter = programs_.find(key);
+  if (iter == programs_.end()) return nullptr;
+  return iter->second;
+}
+
+void CompiledProgramCache::Insert(
+    const std::string& key, std::shared_ptr<const CompiledProgram> program) {
+  const size_t program_bytes = program->bef_buffer.size();
+  if (program_bytes > capacity_bytes_) return;
+
+  mutex_lock lock(mu_);
+  if (!programs_.emplace(key, std::move(program)).second) return;
+  insertion_order_.push_back(key);
+  size_bytes_ += program_bytes;
+
+  while (size_bytes_ > capacity_bytes_) {
+    auto iter = programs_.find(insertion_order_.front());
+    size_bytes_ -= iter->second->bef_buffer.size();
+    programs_.erase(iter);
+    insertion_order_.pop_front();
+  }
+}
+
 }  // namespace tfrt
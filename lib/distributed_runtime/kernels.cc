@@ -14,7 +14,12 @@
 
 // This file implements kernels for distributed execution.
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -23,23 +28,30 @@
 #include "tfrt/distributed_runtime/distributed_context.h"
 #include "tfrt/distributed_runtime/distributed_kernels.h"
 #include "tfrt/distributed_runtime/fabric_communicator.h"
+#include "tfrt/distributed_runtime/function_cache.h"
 #include "tfrt/distributed_runtime/payload.h"
+#include "tfrt/distributed_runtime/payload_codec.h"
 #include "tfrt/distributed_runtime/proto/remote_message.pb.h"
 #include "tfrt/distributed_runtime/remote_chain_manager.h"
 #include "tfrt/distributed_runtime/remote_client.h"
 #include "tfrt/distributed_runtime/remote_execute.h"
+#include "tfrt/distributed_runtime/remote_iterator.h"
 #include "tfrt/distributed_runtime/remote_object_manager.h"
 #include "tfrt/distributed_runtime/remote_tensor.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/bf16.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/fp16.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/refcounted_callback.h"
 #include "tfrt/support/string_util.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
 #include "tfrt/tensor/tensor_serialize_utils.h"
+#include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
 
@@ -48,41 +60,84 @@ namespace {
 //===----------------------------------------------------------------------===//
 // Dist AllReduce
 //===----------------------------------------------------------------------===//
+
+// Each segment of a tensor reduced by AllReduce is split into one chunk of
+// this size per member of the group.
+constexpr size_t kAllReduceChunkBytes = 4 * 1024 * 1024;
+
+// Incoming chunks are reduced in parallel blocks of at least this size.
+constexpr size_t kMinReductionBlockBytes = 256 * 1024;
+
+// Describes how elements of type T are reduced: loaded into ComputeType,
+// combined, and stored back.
 template <typename T>
-void SumReductionFn(char* lhs, const char* rhs, size_t data_size) {
-  T* typed_lhs = reinterpret_cast<T*>(lhs);
-  const T* typed_rhs = reinterpret_cast<const T*>(rhs);
+struct ReductionTraits {
+  using ComputeType = T;
+  static T Load(T value) { return value; }
+  static T Store(T value) { return value; }
+};
+
+// bf16 and fp16 are storage-only types, so they are reduced in float and
+// rounded to nearest even when stored back.
+template <>
+struct ReductionTraits<bf16> {
+  using ComputeType = float;
+  static float Load(bf16 value) { return Bf16ToFloat(value); }
+  static bf16 Store(float value) { return FloatToBf16(value); }
+};
+
+template <>
+struct ReductionTraits<fp16> {
+  using ComputeType = float;
+  static float Load(fp16 value) { return Fp16ToFloat(value); }
+  static fp16 Store(float value) { return FloatToFp16(value); }
+};
+
+// Combines `rhs` into `lhs` element-wise. The buffers never alias, which lets
+// the compiler vectorize the loop.
+template <typename T, typename BinaryOp>
+void ReduceElements(char* lhs, const char* rhs, size_t data_size,
+                    BinaryOp op) {
+  using Traits = ReductionTraits<T>;
+  T* __restrict__ typed_lhs = reinterpret_cast<T*>(lhs);
+  const T* __restrict__ typed_rhs = reinterpret_cast<const T*>(rhs);
   const size_t num_elements = data_size / sizeof(T);
   for (size_t i = 0; i < num_elements; ++i) {
-    typed_lhs[i] += typed_rhs[i];
+    typed_lhs[i] = Traits::Store(
+        op(Traits::Load(typed_lhs[i]), Traits::Load(typed_rhs[i])));
   }
 }
+
+template <typename T>
+void SumReductionFn(char* lhs, const char* rhs, size_t data_size) {
+  using C = typename ReductionTraits<T>::ComputeType;
+  ReduceElements<T>(lhs, rhs, data_size, [](C a, C b) { return a + b; });
+}
+
 template <typename T>
 void MaxReductionFn(char* lhs, const char* rhs, size_t data_size) {
-  T* typed_lhs = reinterpret_cast<T*>(lhs);
-  const T* typed_rhs = reinterpret_cast<const T*>(rhs);
-  const size_t num_elements = data_size / sizeof(T);
-  for (size_t i = 0; i < num_elements; ++i) {
-    typed_lhs[i] = typed_lhs[i] > typed_rhs[i] ? typed_lhs[i] : typed_rhs[i];
-  }
+  using C = typename ReductionTraits<T>::ComputeType;
+  ReduceElements<T>(lhs, rhs, data_size,
+                    [](C a, C b) { return a > b ? a : b; });
 }
 
 template <typename T>
 void MinReductionFn(char* lhs, const char* rhs, size_t data_size) {
-  T* typed_lhs = reinterpret_cast<T*>(lhs);
-  const T* typed_rhs = reinterpret_cast<const T*>(rhs);
-  const size_t num_elements = data_size / sizeof(T);
-  for (size_t i = 0; i < num_elements; ++i) {
-    typed_lhs[i] = typed_lhs[i] < typed_rhs[i] ? typed_lhs[i] : typed_rhs[i];
-  }
+  using C = typename ReductionTraits<T>::ComputeType;
+  ReduceElements<T>(lhs, rhs, data_size,
+                    [](C a, C b) { return a < b ? a : b; });
 }
 
 template <typename T>
 void DivFinalFn(char* lhs, size_t data_size, size_t group_size) {
+  using Traits = ReductionTraits<T>;
+  // Divide by a signed group size, so that integer elements are not promoted
+  // to unsigned.
+  const auto divisor = static_cast<typename Traits::ComputeType>(group_size);
   T* typed_lhs = reinterpret_cast<T*>(lhs);
   const size_t num_elements = data_size / sizeof(T);
   for (size_t i = 0; i < num_elements; ++i) {
-    typed_lhs[i] = typed_lhs[i] / group_size;
+    typed_lhs[i] = Traits::Store(Traits::Load(typed_lhs[i]) / divisor);
   }
 }
 
@@ -129,11 +184,62 @@ llvm::StringRef GetSplit(llvm::StringRef split_input, size_t num_splits,
       num_elements_current_split * sizeof(T));
 }
 
+// Returns the bytes `split` of `tensor` as a buffer that shares the storage of
+// the tensor, so that sending it does not copy it.
+RCReference<HostBuffer> SliceTensorBuffer(const DenseHostTensor& tensor,
+                                          llvm::StringRef split) {
+  const size_t offset =
+      split.data() - static_cast<const char*>(tensor.buffer()->data());
+  return HostBuffer::CreateFromExternal(tensor.buffer().CopyRef(), offset,
+                                        split.size());
+}
+
+Payload SingleBufferPayload(RCReference<HostBuffer> buffer) {
+  llvm::SmallVector<RCReference<HostBuffer>, 4> buffers;
+  buffers.push_back(std::move(buffer));
+  return Payload(std::move(buffers));
+}
+
 InstanceKey StepKey(const std::string& prefix, const InstanceKey& instance_key,
                     int step) {
   return StrCat(prefix, ":", instance_key, ":", step);
 }
 
+// Sends `payload` to the value of `key` at the task of `client`, encoded as
+// `kind` by the payload codec of `dist_ctx`. Ref counts `refcounted_done` until
+// the payload is sent.
+void SendPayload(const DistributedContext& dist_ctx,
+                 RemoteClientInterface* client, const InstanceKey& key,
+                 Payload payload, PayloadCodec::PayloadKind kind,
+                 RCReference<RefCountedCallback> refcounted_done) {
+  auto request = std::make_unique<SendDataRequest>();
+  auto response = std::make_unique<SendDataResponse>();
+  request->set_context_id(dist_ctx.GetContextId());
+  request->set_instance_key(key);
+  Payload encoded = dist_ctx.GetPayloadCodec().Encode(std::move(payload), kind,
+                                                      request.get());
+  auto* request_ptr = request.get();
+  auto* response_ptr = response.get();
+  client->SendDataWithPayloadAsync(
+      RemoteCallContext::GetDefault(), request_ptr, std::move(encoded),
+      response_ptr,
+      [request = std::move(request), response = std::move(response),
+       refcounted_done = std::move(refcounted_done)](Error e) {
+        refcounted_done->UpdateState(std::move(e));
+      });
+}
+
+// Returns the kind of the partial results exchanged by AllReduce with
+// `reduction_name`. Lossy encodings only suit partial sums of floats, they
+// would change the results of min and max.
+template <typename T>
+PayloadCodec::PayloadKind PartialResultKind(string_view reduction_name) {
+  if (std::is_same<T, float>::value &&
+      (reduction_name == "sum" || reduction_name == "mean"))
+    return PayloadCodec::PayloadKind::kFloatPartialSums;
+  return PayloadCodec::PayloadKind::kBytes;
+}
+
 size_t SplitIndex(int id, size_t group_size, int step) {
   size_t index = id - step;
   index = ((index % group_size) + group_size) % group_size;
@@ -157,6 +263,414 @@ TaskHandle GetTaskHandle(Argument<DistributedContext> dist_context,
   return dist_context->GetTaskHandle(task_name.get());
 }
 
+// Reduces the `num_elements` elements of `in_tensor` at `segment` with a ring
+// of 2 * group_size - 1 steps: group_size steps that scatter and reduce a chunk
+// of the segment per step, followed by the steps that gather the reduced
+// chunks.
+template <typename T>
+void DoAllReduceSegment(const ExecutionContext& exec_ctx,
+                        const AsyncValueRef<DistributedContext>& dist_ctx,
+                        const InstanceKey& instance_key,
+                        const std::string& prefix, int my_index,
+                        size_t group_size, const DenseHostTensor& in_tensor,
+                        llvm::StringRef segment, size_t num_elements,
+                        RemoteClientInterface* neighbor_client,
+                        const ElementWiseReductionFunction& reduction_fn,
+                        const ElementWiseFinalFunction& final_fn,
+                        PayloadCodec::PayloadKind partial_kind,
+                        RCReference<RefCountedCallback> refcounted_done) {
+  const size_t kLastScatterStep = group_size - 1;
+  const size_t kLastGatherStep = 2 * group_size - 2;
+  const int kTotalSteps = 2 * group_size - 1;
+  auto* callback_registry = dist_ctx->GetCallbackRegistry();
+
+  for (int step = 0; step < kTotalSteps; ++step) {
+    const InstanceKey step_key = StepKey(prefix, instance_key, step);
+    const InstanceKey next_step_key = StepKey(prefix, instance_key, step + 1);
+    const size_t split_id = SplitIndex(my_index, group_size, step);
+    llvm::StringRef split_data =
+        GetSplit<T>(segment, group_size, num_elements, split_id);
+    // Only the results sent in the scatter stage are partial; the one sent in
+    // the last scatter step, and forwarded by the gather stage, is final.
+    const PayloadCodec::PayloadKind send_kind =
+        step < kLastScatterStep ? partial_kind
+                                : PayloadCodec::PayloadKind::kBytes;
+
+    if (step == 0) {
+      // The split is overwritten by the gather stage only after the neighbor
+      // received it, so it can be sent without a copy.
+      SendPayload(*dist_ctx, neighbor_client, next_step_key,
+                  SingleBufferPayload(SliceTensorBuffer(in_tensor, split_data)),
+                  send_kind, refcounted_done.CopyRef());
+    } else if (step <= kLastScatterStep) {
+      // Scatter stage: send a chunk to the neighbor, aggregate the incoming
+      // chunk with local buffer.
+      callback_registry->SetCallback(
+          step_key,
+          [step, in_split = split_data, out_split = split_data,
+           dist_ctx = dist_ctx.CopyRef(), next_step_key, send_kind,
+           neighbor_client, reduction_fn, final_fn, kLastScatterStep,
+           group_size, exec_ctx, refcounted_done = refcounted_done.CopyRef()](
+              const InstanceKey&,
+              CallbackRegistry::CallbackValue callback_value) mutable {
+            char* data = static_cast<char*>(callback_value.buffers[0]->data());
+            // Scatter aggregates the results with the local buffer. Large
+            // chunks are reduced in parallel blocks.
+            auto reduce = [data, in_split, out_split, reduction_fn, final_fn,
+                           last_step = step == kLastScatterStep,
+                           group_size](size_t begin, size_t end) {
+              const size_t offset = begin * sizeof(T);
+              const size_t size = (end - begin) * sizeof(T);
+              reduction_fn(data + offset, in_split.data() + offset, size);
+              if (last_step) {
+                final_fn(data + offset, size, group_size);
+                std::copy(data + offset, data + offset + size,
+                          const_cast<char*>(out_split.begin()) + offset);
+              }
+            };
+            auto send = [dist_ctx = std::move(dist_ctx), next_step_key,
+                         send_kind, neighbor_client,
+                         callback_value = std::move(callback_value),
+                         refcounted_done =
+                             std::move(refcounted_done)]() mutable {
+              SendPayload(*dist_ctx, neighbor_client, next_step_key,
+                          std::move(callback_value), send_kind,
+                          std::move(refcounted_done));
+            };
+            ParallelFor(exec_ctx).Execute(
+                in_split.size() / sizeof(T),
+                ParallelFor::BlockSizes::Min(
+                    std::max<size_t>(kMinReductionBlockBytes / sizeof(T), 1)),
+                std::move(reduce), std::move(send));
+          });
+    } else {
+      // Gather stage: an incoming chunk is final; just assign it to local
+      // buffer and pass it to the neighbor as is.
+      callback_registry->SetCallback(
+          step_key,
+          [step, out_split = split_data, kLastGatherStep,
+           dist_ctx = dist_ctx.CopyRef(), next_step_key, neighbor_client,
+           refcounted_done = refcounted_done.CopyRef()](
+              const InstanceKey&,
+              CallbackRegistry::CallbackValue callback_value) mutable {
+            RCReference<HostBuffer> data = callback_value.buffers[0].CopyRef();
+            // Gather assigns the incoming data to the local buffer
+            std::copy(static_cast<char*>(data->data()),
+                      static_cast<char*>(data->data()) + data->size(),
+                      const_cast<char*>(out_split.begin()));
+            if (step < kLastGatherStep) {
+              SendPayload(*dist_ctx, neighbor_client, next_step_key,
+                          std::move(callback_value),
+                          PayloadCodec::PayloadKind::kBytes,
+                          refcounted_done.CopyRef());
+            }
+          });
+    }
+  }
+}
+
+// Reduces `in_tensor` over a ring of `members`, in which this task is at
+// `my_index`. Ref counts `refcounted_done` until its part is done.
+template <typename T>
+void DoRingAllReduce(const ExecutionContext& exec_ctx,
+                     const AsyncValueRef<DistributedContext>& dist_ctx,
+                     const InstanceKey& instance_key, const std::string& prefix,
+                     llvm::ArrayRef<TaskHandle> members, int my_index,
+                     const DenseHostTensor& in_tensor,
+                     const ElementWiseReductionFunction& reduction_fn,
+                     const ElementWiseFinalFunction& final_fn,
+                     PayloadCodec::PayloadKind partial_kind,
+                     RCReference<RefCountedCallback> refcounted_done) {
+  const size_t group_size = members.size();
+  RemoteClientInterface* neighbor_client =
+      dist_ctx->GetRemoteClient(members[(my_index + 1) % group_size]);
+  auto in_tensor_ref =
+      llvm::StringRef(reinterpret_cast<const char*>(in_tensor.data()),
+                      in_tensor.DataSizeInBytes());
+
+  // The tensor is reduced in segments, each by its own ring of steps with
+  // distinct keys. The rings run concurrently, so that reducing a chunk of one
+  // segment overlaps with transferring the chunks of the others.
+  const size_t num_elements = in_tensor.NumElements();
+  const size_t segment_size =
+      group_size * std::max<size_t>(kAllReduceChunkBytes / sizeof(T), 1);
+  const size_t num_segments = std::max<size_t>(num_elements / segment_size, 1);
+  for (size_t segment = 0; segment < num_segments; ++segment) {
+    const size_t segment_begin = segment * segment_size;
+    const size_t segment_elements = segment + 1 < num_segments
+                                        ? segment_size
+                                        : num_elements - segment_begin;
+    const InstanceKey segment_key =
+        num_segments == 1 ? instance_key : StrCat(instance_key, "/", segment);
+    DoAllReduceSegment<T>(
+        exec_ctx, dist_ctx, segment_key, prefix, my_index, group_size,
+        in_tensor,
+        in_tensor_ref.substr(segment_begin * sizeof(T),
+                             segment_elements * sizeof(T)),
+        segment_elements, neighbor_client, reduction_fn, final_fn,
+        partial_kind, refcounted_done.CopyRef());
+  }
+}
+
+// Returns the children of `rank` in a binomial tree over `group_size` ranks
+// rooted at rank 0: rank + 2^k for every 2^k below the lowest set bit of rank.
+// The parent of a rank is the rank with its lowest set bit cleared, so a tree
+// is log2(group_size) levels deep.
+llvm::SmallVector<int, 8> TreeChildren(int rank, int group_size) {
+  llvm::SmallVector<int, 8> children;
+  const int limit = rank == 0 ? group_size : (rank & -rank);
+  for (int bit = 1; bit < limit && rank + bit < group_size; bit <<= 1)
+    children.push_back(rank + bit);
+  return children;
+}
+
+int TreeParent(int rank) { return rank & (rank - 1); }
+
+// Reduces `tensor` of all `members` into `tensor` of members[root], along a
+// binomial tree. Each member adds the tensors of its children to its own, then
+// sends the partial result to its parent. Ref counts `refcounted_done` until
+// the part of this member is done.
+void TreeReduce(const AsyncValueRef<DistributedContext>& dist_ctx,
+                const InstanceKey& instance_key, const std::string& prefix,
+                llvm::ArrayRef<TaskHandle> members, int my_index, int root,
+                const DenseHostTensor& tensor,
+                const ElementWiseReductionFunction& reduction_fn,
+                PayloadCodec::PayloadKind partial_kind,
+                RCReference<RefCountedCallback> refcounted_done) {
+  const int group_size = members.size();
+  const int rank = (my_index - root + group_size) % group_size;
+  const TaskHandle parent = members[(TreeParent(rank) + root) % group_size];
+  // Sends the partial result to the parent once all children were reduced.
+  auto reduced = TakeRef(new RefCountedCallback(
+      [dist_ctx = dist_ctx.CopyRef(), instance_key, prefix, rank, parent,
+       tensor = tensor.CopyRef(), partial_kind,
+       refcounted_done = std::move(refcounted_done)](Error e) mutable {
+        if (e || rank == 0) {
+          refcounted_done->UpdateState(std::move(e));
+          return;
+        }
+        // The tensor is overwritten only by results that depend on this
+        // partial result, so it can be sent without a copy.
+        SendPayload(*dist_ctx, dist_ctx->GetRemoteClient(parent),
+                    StepKey(prefix, instance_key, rank),
+                    SingleBufferPayload(tensor.buffer().CopyRef()),
+                    partial_kind, std::move(refcounted_done));
+      }));
+
+  // Children may arrive concurrently, so their reductions are serialized.
+  auto mu = std::make_shared<mutex>();
+  char* data = const_cast<char*>(static_cast<const char*>(tensor.data()));
+  const size_t size = tensor.DataSizeInBytes();
+  for (int child : TreeChildren(rank, group_size)) {
+    dist_ctx->GetCallbackRegistry()->SetCallback(
+        StepKey(prefix, instance_key, child),
+        [mu, data, size, reduction_fn, reduced = reduced.CopyRef()](
+            const InstanceKey&,
+            CallbackRegistry::CallbackValue callback_value) {
+          mutex_lock lock(*mu);
+          reduction_fn(
+              data, static_cast<const char*>(callback_value.buffers[0]->data()),
+              size);
+        });
+  }
+}
+
+// Broadcasts `tensor` of members[root] to `tensor` of all other `members`,
+// along a binomial tree. Each member forwards the tensor to its children once
+// it received it. Ref counts `refcounted_done` until the part of this member
+// is done.
+void TreeBroadcast(const AsyncValueRef<DistributedContext>& dist_ctx,
+                   const InstanceKey& instance_key, const std::string& prefix,
+                   llvm::ArrayRef<TaskHandle> members, int my_index, int root,
+                   const DenseHostTensor& tensor,
+                   RCReference<RefCountedCallback> refcounted_done) {
+  const int group_size = members.size();
+  const int rank = (my_index - root + group_size) % group_size;
+  llvm::SmallVector<TaskHandle, 8> children;
+  llvm::SmallVector<int, 8> child_ranks = TreeChildren(rank, group_size);
+  for (int child : child_ranks)
+    children.push_back(members[(child + root) % group_size]);
+
+  auto send_to_children = [dist_ctx = dist_ctx.CopyRef(), instance_key, prefix,
+                           children, child_ranks, tensor = tensor.CopyRef(),
+                           refcounted_done = std::move(refcounted_done)]() {
+    for (int i = 0; i < children.size(); ++i) {
+      SendPayload(*dist_ctx, dist_ctx->GetRemoteClient(children[i]),
+                  StepKey(prefix, instance_key, child_ranks[i]),
+                  SingleBufferPayload(tensor.buffer().CopyRef()),
+                  PayloadCodec::PayloadKind::kBytes, refcounted_done.CopyRef());
+    }
+  };
+
+  if (rank == 0) {
+    send_to_children();
+    return;
+  }
+  char* data = const_cast<char*>(static_cast<const char*>(tensor.data()));
+  dist_ctx->GetCallbackRegistry()->SetCallback(
+      StepKey(prefix, instance_key, rank),
+      [data, send_to_children = std::move(send_to_children)](
+          const InstanceKey&, CallbackRegistry::CallbackValue callback_value) {
+        RCReference<HostBuffer> received = callback_value.buffers[0].CopyRef();
+        std::copy(static_cast<char*>(received->data()),
+                  static_cast<char*>(received->data()) + received->size(),
+                  data);
+        send_to_children();
+      });
+}
+
+// Reduces `tensor` of all `members` to members[0] and broadcasts the result
+// back, both along binomial trees.
+void DoTreeAllReduce(const AsyncValueRef<DistributedContext>& dist_ctx,
+                     const InstanceKey& instance_key, const std::string& prefix,
+                     llvm::ArrayRef<TaskHandle> members, int my_index,
+                     const DenseHostTensor& tensor,
+                     const ElementWiseReductionFunction& reduction_fn,
+                     const ElementWiseFinalFunction& final_fn,
+                     PayloadCodec::PayloadKind partial_kind,
+                     RCReference<RefCountedCallback> refcounted_done) {
+  auto reduced = TakeRef(new RefCountedCallback(
+      [dist_ctx = dist_ctx.CopyRef(), instance_key, prefix,
+       members = llvm::SmallVector<TaskHandle, 8>(members.begin(),
+                                                  members.end()),
+       my_index, tensor = tensor.CopyRef(), final_fn,
+       refcounted_done = std::move(refcounted_done)](Error e) mutable {
+        if (e) {
+          refcounted_done->UpdateState(std::move(e));
+          return;
+        }
+        if (my_index == 0) {
+          final_fn(static_cast<char*>(tensor.data()), tensor.DataSizeInBytes(),
+                   members.size());
+        }
+        TreeBroadcast(dist_ctx, StrCat(instance_key, ":broadcast"), prefix,
+                      members, my_index, /*root=*/0, tensor,
+                      std::move(refcounted_done));
+      }));
+  TreeReduce(dist_ctx, StrCat(instance_key, ":reduce"), prefix, members,
+             my_index, /*root=*/0, tensor, reduction_fn, partial_kind,
+             std::move(reduced));
+}
+
+// Returns the indices of `members` grouped by the host of their addresses, in
+// the order of the first member of each host.
+llvm::SmallVector<llvm::SmallVector<int, 8>, 4> GroupMembersByHost(
+    DistributedContext* dist_ctx, llvm::ArrayRef<TaskHandle> members) {
+  llvm::SmallVector<llvm::SmallVector<int, 8>, 4> hosts;
+  llvm::StringMap<int> host_indices;
+  for (int i = 0; i < members.size(); ++i) {
+    string_view host = dist_ctx->GetRemoteAddress(members[i]).rsplit(':').first;
+    auto it = host_indices.try_emplace(host, hosts.size()).first;
+    if (it->second == hosts.size()) hosts.emplace_back();
+    hosts[it->second].push_back(i);
+  }
+  return hosts;
+}
+
+// Reduces `tensor` within each host along binomial trees, then over a ring of
+// the first member of each host, and broadcasts the result within each host
+// along binomial trees. Only one member per host sends over the network.
+template <typename T>
+void DoHierarchicalAllReduce(
+    const ExecutionContext& exec_ctx,
+    const AsyncValueRef<DistributedContext>& dist_ctx,
+    const InstanceKey& instance_key, const std::string& prefix,
+    llvm::ArrayRef<TaskHandle> members, int my_index,
+    const llvm::SmallVector<llvm::SmallVector<int, 8>, 4>& hosts,
+    const DenseHostTensor& tensor,
+    const ElementWiseReductionFunction& reduction_fn,
+    const ElementWiseFinalFunction& final_fn,
+    PayloadCodec::PayloadKind partial_kind,
+    RCReference<RefCountedCallback> refcounted_done) {
+  llvm::SmallVector<TaskHandle, 8> local_members, leaders;
+  int my_local_index = -1, my_leader_index = -1;
+  for (const auto& host : hosts) {
+    if (host.front() == my_index) my_leader_index = leaders.size();
+    leaders.push_back(members[host.front()]);
+    if (llvm::is_contained(host, my_index)) {
+      for (int index : host) {
+        if (index == my_index) my_local_index = local_members.size();
+        local_members.push_back(members[index]);
+      }
+    }
+  }
+
+  // The final function applies to the reduction over all members, not over
+  // the leaders.
+  const size_t group_size = members.size();
+  ElementWiseFinalFunction leaders_final_fn =
+      [final_fn, group_size](char* lhs, size_t data_size, size_t) {
+        final_fn(lhs, data_size, group_size);
+      };
+
+  auto broadcast_locally = [dist_ctx = dist_ctx.CopyRef(), instance_key, prefix,
+                            local_members, my_local_index,
+                            tensor = tensor.CopyRef()](
+                               RCReference<RefCountedCallback> done) {
+    TreeBroadcast(dist_ctx, StrCat(instance_key, ":local_broadcast"), prefix,
+                  local_members, my_local_index, /*root=*/0, tensor,
+                  std::move(done));
+  };
+  auto reduced_locally = TakeRef(new RefCountedCallback(
+      [exec_ctx, dist_ctx = dist_ctx.CopyRef(), instance_key, prefix, leaders,
+       my_leader_index, tensor = tensor.CopyRef(), reduction_fn,
+       leaders_final_fn, partial_kind,
+       broadcast_locally = std::move(broadcast_locally),
+       refcounted_done = std::move(refcounted_done)](Error e) mutable {
+        if (e) {
+          refcounted_done->UpdateState(std::move(e));
+          return;
+        }
+        if (my_leader_index == -1) {
+          broadcast_locally(std::move(refcounted_done));
+          return;
+        }
+        auto reduced_globally = TakeRef(new RefCountedCallback(
+            [broadcast_locally = std::move(broadcast_locally),
+             refcounted_done = std::move(refcounted_done)](Error e) mutable {
+              if (e) {
+                refcounted_done->UpdateState(std::move(e));
+                return;
+              }
+              broadcast_locally(std::move(refcounted_done));
+            }));
+        DoRingAllReduce<T>(exec_ctx, dist_ctx, StrCat(instance_key, ":hosts"),
+                           prefix, leaders, my_leader_index, tensor,
+                           reduction_fn, leaders_final_fn, partial_kind,
+                           std::move(reduced_globally));
+      }));
+  TreeReduce(dist_ctx, StrCat(instance_key, ":local_reduce"), prefix,
+             local_members, my_local_index, /*root=*/0, tensor, reduction_fn,
+             partial_kind, std::move(reduced_locally));
+}
+
+// Collectives of at most this many bytes are bound by latency rather than
+// bandwidth, and use algorithms with fewer sequential steps than a ring.
+constexpr size_t kSmallCollectiveBytes = 64 * 1024;
+
+enum class CollectiveAlgorithm {
+  // Pipelined ring, which is bandwidth optimal but takes O(N) steps.
+  kRing,
+  // Binomial trees, which take O(log N) steps.
+  kTree,
+  // Trees within hosts and a ring across hosts.
+  kHierarchical,
+};
+
+// The arguments must be the same on all members, so that they all select the
+// same algorithm.
+CollectiveAlgorithm SelectAllReduceAlgorithm(size_t num_bytes,
+                                             size_t num_elements,
+                                             size_t group_size,
+                                             size_t num_hosts) {
+  // A ring also needs at least one element per member.
+  if (num_bytes <= kSmallCollectiveBytes || num_elements < group_size)
+    return CollectiveAlgorithm::kTree;
+  if (num_hosts > 1 && num_hosts < group_size)
+    return CollectiveAlgorithm::kHierarchical;
+  return CollectiveAlgorithm::kRing;
+}
+
 template <typename T>
 void DoAllReduce(const ExecutionContext& exec_ctx,
                  AsyncValueRef<DistributedContext> dist_ctx,
@@ -166,6 +680,7 @@ void DoAllReduce(const ExecutionContext& exec_ctx,
                  const DenseHostTensor& out_tensor,
                  ElementWiseReductionFunction reduction_fn,
                  ElementWiseFinalFunction final_fn,
+                 PayloadCodec::PayloadKind partial_kind,
                  AsyncValueRef<Chain> out_chain) {
   const auto& collective_group =
       dist_ctx->GetCollectiveGroup(collective_group_name);
@@ -177,21 +692,8 @@ void DoAllReduce(const ExecutionContext& exec_ctx,
                               collective_group_name));
     return;
   }
-  const size_t kGroupSize = collective_group.members.size();
-  const size_t kLastScatterStep = kGroupSize - 1;
-  const size_t kLastGatherStep = 2 * kGroupSize - 2;
+  const auto& kMembers = collective_group.members;
   const auto kPrefix = collective_group_name;
-  const int kTotalSteps = 2 * kGroupSize - 1;
-
-  const int neighbor_index = (my_index + 1) % collective_group.members.size();
-  const TaskHandle neighbor_task = collective_group.members[neighbor_index];
-
-  auto in_tensor_ref =
-      llvm::StringRef(reinterpret_cast<const char*>(in_tensor.data()),
-                      in_tensor.DataSizeInBytes());
-  auto* callback_registry = dist_ctx->GetCallbackRegistry();
-  RemoteClientInterface* neighbor_client =
-      dist_ctx->GetRemoteClient(neighbor_task);
 
   auto done = [out_chain = out_chain.CopyRef(),
                dist_ctx = dist_ctx.CopyRef()](Error e) mutable {
@@ -228,87 +730,48 @@ void DoAllReduce(const ExecutionContext& exec_ctx,
         }
       }));
 
-  for (int step = 0; step < kTotalSteps; ++step) {
-    const InstanceKey step_key = StepKey(kPrefix, instance_key, step);
-    const InstanceKey next_step_key = StepKey(kPrefix, instance_key, step + 1);
-    const size_t split_id = SplitIndex(my_index, kGroupSize, step);
-    llvm::StringRef split_data = GetSplit<T>(in_tensor_ref, kGroupSize,
-                                             in_tensor.NumElements(), split_id);
-    auto request = std::make_unique<SendDataRequest>();
-    auto response = std::make_unique<SendDataResponse>();
-    request->set_context_id(dist_ctx->GetContextId());
-    request->set_instance_key(next_step_key);
+  const auto hosts = GroupMembersByHost(&dist_ctx.get(), kMembers);
+  switch (SelectAllReduceAlgorithm(in_tensor.DataSizeInBytes(),
+                                   in_tensor.NumElements(), kMembers.size(),
+                                   hosts.size())) {
+    case CollectiveAlgorithm::kTree:
+      DoTreeAllReduce(dist_ctx, instance_key, kPrefix, kMembers, my_index,
+                      in_tensor, reduction_fn, final_fn, partial_kind,
+                      std::move(refcounted_done));
+      break;
+    case CollectiveAlgorithm::kHierarchical:
+      DoHierarchicalAllReduce<T>(exec_ctx, dist_ctx, instance_key, kPrefix,
+                                 kMembers, my_index, hosts, in_tensor,
+                                 reduction_fn, final_fn, partial_kind,
+                                 std::move(refcounted_done));
+      break;
+    case CollectiveAlgorithm::kRing:
+      DoRingAllReduce<T>(exec_ctx, dist_ctx, instance_key, kPrefix, kMembers,
+                         my_index, in_tensor, reduction_fn, final_fn,
+                         partial_kind, std::move(refcounted_done));
+      break;
+  }
+}
 
-    if (step == 0) {
-      request->add_payload(split_data.data(), split_data.size());
-      neighbor_client->SendDataAsync(
-          RemoteCallContext::GetDefault(), request.get(), response.get(),
-          [request = std::move(request), response = std::move(response),
-           refcounted_done = refcounted_done.CopyRef()](Error e) {
-            refcounted_done->UpdateState(std::move(e));
-          });
-    } else if (step <= kLastScatterStep) {
-      // Scatter stage: send a chunk to the neighbor, aggregate the incoming
-      // chunk with local buffer.
-      callback_registry->SetCallback(
-          step_key,
-          [step, in_split = split_data, out_split = split_data,
-           request = std::move(request), response = std::move(response),
-           neighbor_client, reduction_fn, final_fn, kLastScatterStep,
-           kGroupSize, refcounted_done = refcounted_done.CopyRef()](
-              const InstanceKey&,
-              CallbackRegistry::CallbackValue callback_value) mutable {
-            RCReference<HostBuffer> data = callback_value.buffers[0].CopyRef();
-            // Scatter aggregates the results with the local buffer.
-            reduction_fn(static_cast<char*>(data->data()),
-                         const_cast<char*>(in_split.data()), in_split.size());
-
-            if (step == kLastScatterStep) {
-              final_fn(static_cast<char*>(data->data()), in_split.size(),
-                       kGroupSize);
-              std::copy(static_cast<char*>(data->data()),
-                        static_cast<char*>(data->data()) + data->size(),
-                        const_cast<char*>(out_split.begin()));
-            }
-            request->add_payload(data->data(), data->size());
-            neighbor_client->SendDataAsync(
-                RemoteCallContext::GetDefault(), request.get(), response.get(),
-                [request = std::move(request), response = std::move(response),
-                 callback_value = std::move(callback_value),
-                 refcounted_done = refcounted_done.CopyRef()](Error e) mutable {
-                  refcounted_done->UpdateState(std::move(e));
-                });
-          });
-    } else {
-      // Gather stage: an incoming chunk is final; just assign it to local
-      // buffer and pass it to the neighbor as is.
-      callback_registry->SetCallback(
-          step_key,
-          [step, out_split = split_data, kLastGatherStep,
-           request = std::move(request), response = std::move(response),
-           neighbor_client, refcounted_done = refcounted_done.CopyRef()](
-              const InstanceKey&,
-              CallbackRegistry::CallbackValue callback_value) mutable {
-            RCReference<HostBuffer> data = callback_value.buffers[0].CopyRef();
-            // Gather assigns the incoming data to the local buffer
-            std::copy(static_cast<char*>(data->data()),
-                      static_cast<char*>(data->data()) + data->size(),
-                      const_cast<char*>(out_split.begin()));
-            if (step < kLastGatherStep) {
-              request->add_payload(data->data(), data->size());
-              neighbor_client->SendDataAsync(
-                  RemoteCallContext::GetDefault(), request.get(),
-                  response.get(),
-                  [request = std::move(request), response = std::move(response),
-                   callback_value = std::move(callback_value),
-                   refcounted_done =
-                       refcounted_done.CopyRef()](Error e) mutable {
-                    refcounted_done->UpdateState(std::move(e));
-                  });
-            }
-          });
-    }
+// Returns false if `reduction_name` is not a known reduction.
+template <typename T>
+bool GetReductionFunctions(string_view reduction_name,
+                           ElementWiseReductionFunction* reduction_fn,
+                           ElementWiseFinalFunction* final_fn) {
+  *final_fn = IdentityFinalFn;
+  if (reduction_name == "sum") {
+    *reduction_fn = SumReductionFn<T>;
+  } else if (reduction_name == "min") {
+    *reduction_fn = MinReductionFn<T>;
+  } else if (reduction_name == "max") {
+    *reduction_fn = MaxReductionFn<T>;
+  } else if (reduction_name == "mean") {
+    *reduction_fn = SumReductionFn<T>;
+    *final_fn = DivFinalFn<T>;
+  } else {
+    return false;
   }
+  return true;
 }
 
 template <typename T>
@@ -321,30 +784,153 @@ void AllReduce(Argument<DistributedContext> dist_context,
                const ExecutionContext& exec_ctx) {
   auto out_chain_indirect = out_chain.Allocate();
   ElementWiseReductionFunction reduction_fn;
-  ElementWiseFinalFunction final_fn = IdentityFinalFn;
-  if (reduction_name.get() == "sum") {
-    reduction_fn = SumReductionFn<T>;
-  } else if (reduction_name.get() == "min") {
-    reduction_fn = MinReductionFn<T>;
-  } else if (reduction_name.get() == "max") {
-    reduction_fn = MaxReductionFn<T>;
-  } else if (reduction_name.get() == "mean") {
-    reduction_fn = SumReductionFn<T>;
-    final_fn = DivFinalFn<T>;
-  } else {
+  ElementWiseFinalFunction final_fn;
+  if (!GetReductionFunctions<T>(reduction_name.get(), &reduction_fn,
+                                &final_fn)) {
     out_chain_indirect.SetError("unexpected reduction_name in AllReduce");
     return;
   }
+  const auto partial_kind = PartialResultKind<T>(reduction_name.get());
 
   EnqueueWork(exec_ctx, [exec_ctx, instance_key = *instance_key,
                          dist_context = dist_context.ValueRef(),
                          collective_group_name = *collective_group_name,
                          in_tensor = in_tensor.ValueRef(),
                          out_tensor = out_tensor.ValueRef(), reduction_fn,
-                         final_fn, out_chain = std::move(out_chain_indirect)] {
+                         final_fn, partial_kind,
+                         out_chain = std::move(out_chain_indirect)] {
     DoAllReduce<T>(exec_ctx, dist_context.CopyRef(), instance_key,
                    collective_group_name, in_tensor.get(), out_tensor.get(),
-                   reduction_fn, final_fn, out_chain.CopyRef());
+                   reduction_fn, final_fn, partial_kind, out_chain.CopyRef());
+  });
+}
+
+// Tensors reduced by FusedAllReduce are packed into buckets of up to this many
+// bytes, and each bucket is reduced by one collective.
+constexpr size_t kFusionBucketBytes = 4 * 1024 * 1024;
+
+// Reduces `inputs` into `outputs` with one AllReduce per bucket of consecutive
+// tensors, instead of one per tensor.
+template <typename T>
+void DoFusedAllReduce(const ExecutionContext& exec_ctx,
+                      AsyncValueRef<DistributedContext> dist_ctx,
+                      const InstanceKey& instance_key,
+                      const std::string& collective_group_name,
+                      llvm::ArrayRef<DenseHostTensor> inputs,
+                      llvm::ArrayRef<DenseHostTensor> outputs,
+                      ElementWiseReductionFunction reduction_fn,
+                      ElementWiseFinalFunction final_fn,
+                      PayloadCodec::PayloadKind partial_kind,
+                      AsyncValueRef<Chain> out_chain) {
+  auto refcounted_done = TakeRef(new RefCountedCallback(
+      [out_chain = std::move(out_chain)](Error e) mutable {
+        if (e) {
+          out_chain.SetError(e);
+        } else {
+          out_chain.emplace();
+        }
+      }));
+
+  size_t begin = 0;
+  for (int bucket = 0; begin < inputs.size(); ++bucket) {
+    size_t end = begin + 1;
+    size_t num_elements = inputs[begin].NumElements();
+    while (end < inputs.size() &&
+           (num_elements + inputs[end].NumElements()) * sizeof(T) <=
+               kFusionBucketBytes) {
+      num_elements += inputs[end++].NumElements();
+    }
+    const ssize_t dims[] = {static_cast<ssize_t>(num_elements)};
+    auto fused = DenseHostTensor::CreateUninitialized<T>(TensorShape(dims),
+                                                         exec_ctx.host());
+    if (!fused) {
+      refcounted_done->UpdateState(
+          MakeStringError("out of memory fusing tensors in FusedAllReduce"));
+      return;
+    }
+    T* fused_data = static_cast<T*>(fused->data());
+    llvm::SmallVector<DenseHostTensor, 8> bucket_outputs;
+    for (size_t i = begin; i < end; ++i) {
+      const T* data = static_cast<const T*>(inputs[i].data());
+      fused_data = std::copy(data, data + inputs[i].NumElements(), fused_data);
+      bucket_outputs.push_back(outputs[i].CopyRef());
+    }
+
+    auto bucket_chain = MakeUnconstructedAsyncValueRef<Chain>(exec_ctx.host());
+    DoAllReduce<T>(exec_ctx, dist_ctx.CopyRef(),
+                   StrCat(instance_key, ":fused:", bucket),
+                   collective_group_name, *fused, *fused, reduction_fn,
+                   final_fn, partial_kind, bucket_chain.CopyRef());
+    // Scatter the reduced bucket to the outputs.
+    bucket_chain.AndThen([bucket_chain = bucket_chain.CopyRef(),
+                          fused = std::move(*fused),
+                          outputs = std::move(bucket_outputs),
+                          refcounted_done = refcounted_done.CopyRef()]() {
+      if (bucket_chain.IsError()) {
+        refcounted_done->UpdateState(
+            MakeStringError(bucket_chain.GetError().message));
+        return;
+      }
+      const T* data = static_cast<const T*>(fused.data());
+      for (const DenseHostTensor& output : outputs) {
+        std::copy(data, data + output.NumElements(),
+                  static_cast<T*>(const_cast<void*>(output.data())));
+        data += output.NumElements();
+      }
+    });
+    begin = end;
+  }
+}
+
+// Reduces each of the first half of `tensors` into the tensor at the same
+// position in the second half. Small tensors are fused into larger buffers,
+// which take far fewer collective steps than reducing them one by one.
+template <typename T>
+void FusedAllReduce(Argument<DistributedContext> dist_context,
+                    Argument<std::string> collective_group_name,
+                    Argument<InstanceKey> instance_key,
+                    Argument<Chain> in_chain, RemainingArguments tensors,
+                    Result<Chain> out_chain, StringAttribute reduction_name,
+                    const ExecutionContext& exec_ctx) {
+  auto out_chain_indirect = out_chain.Allocate();
+  ElementWiseReductionFunction reduction_fn;
+  ElementWiseFinalFunction final_fn;
+  if (!GetReductionFunctions<T>(reduction_name.get(), &reduction_fn,
+                                &final_fn)) {
+    out_chain_indirect.SetError("unexpected reduction_name in FusedAllReduce");
+    return;
+  }
+  const auto partial_kind = PartialResultKind<T>(reduction_name.get());
+
+  const size_t num_tensors = tensors.size() / 2;
+  if (tensors.size() % 2 != 0) {
+    out_chain_indirect.SetError(
+        "FusedAllReduce expects as many output as input tensors");
+    return;
+  }
+  llvm::SmallVector<DenseHostTensor, 8> inputs, outputs;
+  for (size_t i = 0; i < num_tensors; ++i) {
+    const auto& input = tensors[i]->get<DenseHostTensor>();
+    const auto& output = tensors[num_tensors + i]->get<DenseHostTensor>();
+    if (input.NumElements() != output.NumElements()) {
+      out_chain_indirect.SetError(StrCat(
+          "FusedAllReduce input and output tensors differ in size at ", i));
+      return;
+    }
+    inputs.push_back(input.CopyRef());
+    outputs.push_back(output.CopyRef());
+  }
+
+  EnqueueWork(exec_ctx, [exec_ctx, instance_key = *instance_key,
+                         dist_context = dist_context.ValueRef(),
+                         collective_group_name = *collective_group_name,
+                         inputs = std::move(inputs),
+                         outputs = std::move(outputs), reduction_fn, final_fn,
+                         partial_kind,
+                         out_chain = std::move(out_chain_indirect)] {
+    DoFusedAllReduce<T>(exec_ctx, dist_context.CopyRef(), instance_key,
+                        collective_group_name, inputs, outputs, reduction_fn,
+                        final_fn, partial_kind, out_chain.CopyRef());
   });
 }
 
@@ -388,28 +974,37 @@ void DoBroadcast(AsyncValueRef<DistributedContext> dist_ctx,
         }
       }));
 
+  // Small tensors, and tensors with fewer elements than members, are sent
+  // along a binomial tree instead of being split over the ring.
+  if (tensor.DataSizeInBytes() <= kSmallCollectiveBytes ||
+      num_elements < kGroupSize) {
+    const int sender_index = FindMyIndex(collective_group.members, sender);
+    if (sender_index == -1) {
+      refcounted_done->UpdateState(MakeStringError(
+          "The broadcast sender is not part of the collective group ",
+          collective_group_name));
+      return;
+    }
+    TreeBroadcast(dist_ctx, StrCat(instance_key, ":tree"), kPrefix,
+                  collective_group.members, my_index, sender_index, tensor,
+                  std::move(refcounted_done));
+    return;
+  }
+
   for (auto i = 0; i < kGroupSize; ++i) {
     auto chunk_key = StepKey(kPrefix, instance_key, i);
-    auto request = std::make_unique<SendDataRequest>();
-    auto response = std::make_unique<SendDataResponse>();
-    request->set_context_id(dist_ctx->GetContextId());
-    request->set_instance_key(StepKey(kPrefix, chunk_key, neighbor_index));
+    auto neighbor_key = StepKey(kPrefix, chunk_key, neighbor_index);
     if (my_task == sender) {
       // A Sender sends data to its neighbor.
-      auto payload = GetSplit<T>(in_tensor, kGroupSize, num_elements, i);
-      request->add_payload(payload.data(), payload.size());
-      neighbor_client->SendDataAsync(
-          RemoteCallContext::GetDefault(), request.get(), response.get(),
-          [request = std::move(request), response = std::move(response),
-           refcounted_done = refcounted_done.CopyRef()](Error e) {
-            refcounted_done->UpdateState(std::move(e));
-          });
+      auto split = GetSplit<T>(in_tensor, kGroupSize, num_elements, i);
+      SendPayload(*dist_ctx, neighbor_client, neighbor_key,
+                  SingleBufferPayload(SliceTensorBuffer(tensor, split)),
+                  PayloadCodec::PayloadKind::kBytes, refcounted_done.CopyRef());
     } else {
       registry->SetCallback(
           StepKey(kPrefix, chunk_key, my_index),
           [sender, i, in_tensor, kGroupSize, neighbor_task, num_elements,
-           neighbor_client, request = std::move(request),
-           response = std::move(response),
+           dist_ctx = dist_ctx.CopyRef(), neighbor_client, neighbor_key,
            refcounted_done = refcounted_done.CopyRef()](
               const InstanceKey&,
               CallbackRegistry::CallbackValue callback_value) mutable {
@@ -421,15 +1016,10 @@ void DoBroadcast(AsyncValueRef<DistributedContext> dist_ctx,
                           GetSplit<T>(in_tensor, kGroupSize, num_elements, i)
                               .begin()));
             if (neighbor_task != sender) {
-              request->add_payload(data->data(), data->size());
-              neighbor_client->SendDataAsync(
-                  RemoteCallContext::GetDefault(), request.get(),
-                  response.get(),
-                  [request = std::move(request), response = std::move(response),
-                   callback_value = std::move(callback_value),
-                   refcounted_done = refcounted_done.CopyRef()](Error e) {
-                    refcounted_done->UpdateState(std::move(e));
-                  });
+              SendPayload(*dist_ctx, neighbor_client, neighbor_key,
+                          std::move(callback_value),
+                          PayloadCodec::PayloadKind::kBytes,
+                          refcounted_done.CopyRef());
             }
           });
     }
@@ -493,7 +1083,6 @@ void DoAllGather(
   const auto kNeighborIndex = (my_index + 1) % kGroupSize;
   const auto kNeighborId = collective_group.members[kNeighborIndex];
   const auto kPrefix = collective_group.name;
-  const auto kContextId = dist_ctx->GetContextId();
   auto in_tensor_ref =
       llvm::StringRef(reinterpret_cast<const char*>(in_tensor.data()),
                       in_tensor.DataSizeInBytes());
@@ -501,13 +1090,13 @@ void DoAllGather(
   auto* registry = dist_ctx->GetCallbackRegistry();
   RemoteClientInterface* neighbor_client =
       dist_ctx->GetRemoteClient(kNeighborId);
+  // Small results are gathered in one step, with each member sending its
+  // tensor to all others, instead of forwarding the tensors over the ring.
+  const bool kDirect = out_tensor.DataSizeInBytes() <= kSmallCollectiveBytes;
 
   for (size_t ring_order = 0; ring_order < kGroupSize; ++ring_order) {
     const auto chunk_key = StepKey(kPrefix, instance_key, ring_order);
-    auto request = std::make_unique<SendDataRequest>();
-    auto response = std::make_unique<SendDataResponse>();
-    request->set_context_id(kContextId);
-    request->set_instance_key(StepKey(kPrefix, chunk_key, kNeighborIndex));
+    const auto neighbor_key = StepKey(kPrefix, chunk_key, kNeighborIndex);
     if (my_index == ring_order) {
       const char* src_pos = in_tensor_ref.data();
       for (size_t i = 0; i < offsets[my_index].size(); ++i) {
@@ -515,21 +1104,29 @@ void DoAllGather(
                   out_tensor_ref + offsets[my_index][i] * sizeof(T));
         src_pos += step_sizes[my_index] * sizeof(T);
       }
-      request->add_payload(in_tensor_ref.data(), in_tensor_ref.size());
-      neighbor_client->SendDataAsync(
-          RemoteCallContext::GetDefault(), request.get(), response.get(),
-          [request = std::move(request), response = std::move(response),
-           refcounted_done = refcounted_done.CopyRef()](Error e) {
-            refcounted_done->UpdateState(std::move(e));
-          });
+      if (kDirect) {
+        for (size_t index = 0; index < kGroupSize; ++index) {
+          if (index == my_index) continue;
+          SendPayload(
+              *dist_ctx,
+              dist_ctx->GetRemoteClient(collective_group.members[index]),
+              StepKey(kPrefix, chunk_key, index),
+              SingleBufferPayload(SliceTensorBuffer(in_tensor, in_tensor_ref)),
+              PayloadCodec::PayloadKind::kBytes, refcounted_done.CopyRef());
+        }
+        continue;
+      }
+      SendPayload(
+          *dist_ctx, neighbor_client, neighbor_key,
+          SingleBufferPayload(SliceTensorBuffer(in_tensor, in_tensor_ref)),
+          PayloadCodec::PayloadKind::kBytes, refcounted_done.CopyRef());
 
     } else {
       registry->SetCallback(
           StepKey(kPrefix, chunk_key, my_index),
           [ring_order, offsets, step_sizes, out_tensor_ref, kNeighborIndex,
-           neighbor_client, request = std::move(request),
-           response = std::move(response),
-           refcounted_done = refcounted_done.CopyRef()](
+           kDirect, dist_ctx = dist_ctx.CopyRef(), neighbor_client,
+           neighbor_key, refcounted_done = refcounted_done.CopyRef()](
               const InstanceKey&,
               CallbackRegistry::CallbackValue callback_value) mutable {
             RCReference<HostBuffer> data = callback_value.buffers[0].CopyRef();
@@ -540,16 +1137,11 @@ void DoAllGather(
                         out_tensor_ref + offsets[ring_order][i] * sizeof(T));
               src_pos += step_sizes[ring_order] * sizeof(T);
             }
-            if (ring_order != kNeighborIndex) {
-              request->add_payload(data->data(), data->size());
-              neighbor_client->SendDataAsync(
-                  RemoteCallContext::GetDefault(), request.get(),
-                  response.get(),
-                  [request = std::move(request), response = std::move(response),
-                   callback_value = std::move(callback_value),
-                   refcounted_done = refcounted_done.CopyRef()](Error e) {
-                    refcounted_done->UpdateState(std::move(e));
-                  });
+            if (!kDirect && ring_order != kNeighborIndex) {
+              SendPayload(*dist_ctx, neighbor_client, neighbor_key,
+                          std::move(callback_value),
+                          PayloadCodec::PayloadKind::kBytes,
+                          refcounted_done.CopyRef());
             }
           });
     }
@@ -924,19 +1516,47 @@ void AllGatherAnyShape(Argument<DistributedContext> dist_ctx,
       });
 }
 
+// Programs up to this size are sent with the first registration request.
+// Larger programs are only sent if the receiver has not cached them yet.
+constexpr size_t kInlineProgramBytes = 4096;
+
+// Sends `request` to `remote_client`. If the receiver does not have the
+// program with the fingerprint of the request, resends it with `program`.
+void RegisterFunctionWithFingerprint(
+    RemoteClientInterface* remote_client,
+    std::unique_ptr<RegisterFunctionRequest> request, StringAttribute program,
+    llvm::unique_function<void(Error, const RegisterFunctionResponse&)> done) {
+  auto response = std::make_unique<RegisterFunctionResponse>();
+  RegisterFunctionRequest* request_ptr = request.get();
+  RegisterFunctionResponse* response_ptr = response.get();
+  remote_client->RegisterFunctionAsync(
+      RemoteCallContext::GetDefault(), request_ptr, response_ptr,
+      [remote_client, request = std::move(request),
+       response = std::move(response), program,
+       done = std::move(done)](Error e) mutable {
+        if (!e && response->program_missing() && request->program().empty()) {
+          request->set_program(program.str());
+          RegisterFunctionWithFingerprint(remote_client, std::move(request),
+                                          program, std::move(done));
+          return;
+        }
+        done(std::move(e), *response);
+      });
+}
+
 void RemoteRegisterKernelHelper(Chain ch, DistributedContext* dist_context,
                                 const TaskHandle receiver,
                                 RemainingResults results,
                                 StringAttribute program,
                                 StringAttribute program_name,
-                                bool need_compilation,
+                                bool need_compilation, bool program_is_bef,
                                 const ExecutionContext& exec_ctx) {
   auto request = std::make_unique<RegisterFunctionRequest>();
   // program and program_name will live as long as out_chain is not populated.
   request->set_context_id(dist_context->GetContextId());
-  request->set_program(program.str());
   request->set_program_name(program_name.str());
   request->set_need_compilation(need_compilation);
+  request->set_program_is_bef(program_is_bef);
   RemoteClientInterface* remote_client =
       dist_context->GetRemoteClient(receiver);
 
@@ -948,24 +1568,29 @@ void RemoteRegisterKernelHelper(Chain ch, DistributedContext* dist_context,
   }
   results[0] = out.CopyRef();
 
-  EnqueueWork(exec_ctx, [remote_client, request = std::move(request),
+  EnqueueWork(exec_ctx, [remote_client, request = std::move(request), program,
                          dist_context, need_compilation,
                          out = out.CopyRef()]() mutable {
-    auto response = std::make_unique<RegisterFunctionResponse>();
-    remote_client->RegisterFunctionAsync(
-        RemoteCallContext::GetDefault(), request.get(), response.get(),
-        [request = std::move(request), response = std::move(response),
-         need_compilation, dist_context, out = out.CopyRef()](Error e) mutable {
+    // Hashing the program may take a while, so it is done off the kernel.
+    request->set_program_fingerprint(
+        CompiledProgramCache::Fingerprint(program.get()));
+    if (program.get().size() <= kInlineProgramBytes) {
+      request->set_program(program.str());
+    }
+    RegisterFunctionWithFingerprint(
+        remote_client, std::move(request), program,
+        [need_compilation, dist_context, out = out.CopyRef()](
+            Error e, const RegisterFunctionResponse& response) {
           if (e) {
             out->SetError(DecodedDiagnostic(std::move(e)));
           } else {
             if (need_compilation) {
               DeviceManager* manager = dist_context->GetRemoteDeviceManager();
               llvm::SmallVector<RCReference<Device>, 4> output_devices;
-              output_devices.reserve(response->output_device_size());
-              for (int i = 0; i < response->output_device_size(); i++) {
+              output_devices.reserve(response.output_device_size());
+              for (int i = 0; i < response.output_device_size(); i++) {
                 RCReference<Device> device =
-                    manager->GetDeviceRef<Device>(response->output_device(i));
+                    manager->GetDeviceRef<Device>(response.output_device(i));
                 output_devices.push_back(device.CopyRef());
               }
               out->emplace<RemoteExecuteSpec>(std::move(output_devices));
@@ -984,7 +1609,7 @@ void RegisterTFRTFunctionKernel(Chain ch, DistributedContext* dist_context,
                                 const ExecutionContext& exec_ctx) {
   RemoteRegisterKernelHelper(ch, dist_context, receiver, results, program,
                              program_name, /*need_compilation=*/false,
-                             exec_ctx);
+                             /*program_is_bef=*/false, exec_ctx);
 }
 
 void RegisterTFFunctionKernel(Chain ch, DistributedContext* dist_context,
@@ -993,7 +1618,20 @@ void RegisterTFFunctionKernel(Chain ch, DistributedContext* dist_context,
                               StringAttribute program_name,
                               const ExecutionContext& exec_ctx) {
   RemoteRegisterKernelHelper(ch, dist_context, receiver, results, program,
-                             program_name, /*need_compilation=*/true, exec_ctx);
+                             program_name, /*need_compilation=*/true,
+                             /*program_is_bef=*/false, exec_ctx);
+}
+
+// Registers a program that is already compiled to BEF, so the receiver does not
+// parse or compile it.
+void RegisterBEFFunctionKernel(Chain ch, DistributedContext* dist_context,
+                               TaskHandle receiver, RemainingResults results,
+                               StringAttribute program,
+                               StringAttribute program_name,
+                               const ExecutionContext& exec_ctx) {
+  RemoteRegisterKernelHelper(ch, dist_context, receiver, results, program,
+                             program_name, /*need_compilation=*/false,
+                             /*program_is_bef=*/true, exec_ctx);
 }
 
 AsyncValueRef<RemoteExecuteSpec> CreateRemoteExecuteSpec(
@@ -1027,23 +1665,45 @@ void RemoteExecute(Chain ch, DistributedContext* dist_context,
   // If some output IDs are present in the inputs, we assume all output IDs are
   // pre-allocated.
   const bool output_id_allocated = num_fn_inputs != inputs.size();
+  TFRT_TRACE_SCOPE(Default, StrCat("RemoteExecute: ", program_name.str()));
+  TFRT_TRACE_FLOW(Default, exec_ctx.trace_id());
   auto request = std::make_unique<RemoteExecuteRequest>();
   // program_name will live as long as out_chain is not populated.
   request->set_context_id(dist_context->GetContextId());
   request->set_program_name(program_name.str());
+  request->set_trace_id(exec_ctx.trace_id());
   request->mutable_input()->Reserve(num_fn_inputs);
+  const int64_t max_inline_bytes = dist_context->GetMaxInlineTensorBytes();
+  request->set_max_inline_output_bytes(max_inline_bytes);
+
+  // First output: chain
+  AsyncValueRef<Chain> out_chain =
+      MakeConstructedAsyncValueRef<Chain>(exec_ctx.host());
+  results[0] = out_chain.CopyRef();
 
   for (int i = 0; i < num_fn_inputs; ++i) {
+    // Small host tensors are passed by value, which saves sending them to the
+    // remote task as objects first.
+    if (inputs[i]->IsType<DenseHostTensor>()) {
+      const auto& tensor = inputs[i]->get<DenseHostTensor>();
+      if (!CanInlineTensor(tensor, max_inline_bytes)) {
+        out_chain.SetError(llvm::make_error<InvalidArgumentErrorInfo>(
+            StrCat("Input ", i, " of ", tensor.DataSizeInBytes(),
+                   " bytes exceeds max_inline_tensor_bytes: ",
+                   max_inline_bytes)));
+        return;
+      }
+      auto* inline_input = request->add_inline_input();
+      inline_input->set_index(i);
+      SerializeInlineTensor(tensor, inline_input);
+      continue;
+    }
     const RemoteObjectId& input = inputs[i]->get<RemoteObjectId>();
     auto* add_input = request->add_input();
     add_input->set_prefix_id(input.prefix_id);
     add_input->set_local_id(input.local_id);
     add_input->set_device(input.device->name().str());
   }
-  // First output: chain
-  AsyncValueRef<Chain> out_chain =
-      MakeConstructedAsyncValueRef<Chain>(exec_ctx.host());
-  results[0] = out_chain.CopyRef();
 
   // If output_id is preallocated, we only return TensorHandles. Otherwise, we
   // return output ids followed by TensorHandles.
@@ -1072,6 +1732,8 @@ void RemoteExecute(Chain ch, DistributedContext* dist_context,
   request->mutable_output()->Reserve(num_fn_output);
   RemoteObjectManager* manager = dist_context->GetRemoteObjectManager();
   struct RemoteObjectAndMetadata {
+    // The index of the output in the request.
+    int output_index;
     AsyncValueRef<RemoteObjectId> id;
     AsyncValueRef<RemoteTensor> tensor;
     AsyncValueRef<TensorMetadata> metadata;
@@ -1105,7 +1767,7 @@ void RemoteExecute(Chain ch, DistributedContext* dist_context,
           exec_ctx.host(), out_id->device.CopyRef(), metadata.CopyRef(),
           tensor.CopyRef());
       remote_objs.emplace_back(RemoteObjectAndMetadata{
-          out_id.CopyRef(), std::move(tensor), std::move(metadata)});
+          i - 1, out_id.CopyRef(), std::move(tensor), std::move(metadata)});
       // The remaining outputs are TensorHandle
       results[th_output_idx + remote_objs.size()] = th.CopyRef();
     }
@@ -1119,17 +1781,30 @@ void RemoteExecute(Chain ch, DistributedContext* dist_context,
 
   RemoteClientInterface* remote_client =
       dist_context->GetRemoteClient(receiver);
-  EnqueueWork(exec_ctx, [remote_client, request = std::move(request),
+  EnqueueWork(exec_ctx, [exec_ctx, remote_client, request = std::move(request),
                          dist_context, out_chain = out_chain.CopyRef(),
                          remote_objs = std::move(remote_objs)]() mutable {
+    // Do not send the request if the request was cancelled while it was
+    // queued.
+    if (auto* cancel_av = exec_ctx.GetCancelAsyncValue()) {
+      for (auto& obj : remote_objs) {
+        obj.metadata.SetError(cancel_av->GetError());
+        obj.tensor.SetError(cancel_av->GetError());
+      }
+      out_chain.SetError(cancel_av->GetError());
+      return;
+    }
     auto response = std::make_unique<RemoteExecuteResponse>();
+    RemoteExecuteRequest* request_ptr = request.get();
+    RemoteExecuteResponse* response_ptr = response.get();
     remote_client->RemoteExecuteAsync(
-        RemoteCallContext::GetDefault(), request.get(), response.get(),
+        RemoteCallContext::GetDefault(), request_ptr, response_ptr,
         [request = std::move(request), response = std::move(response),
          out_chain = out_chain.CopyRef(), remote_objs = std::move(remote_objs),
          host_context = dist_context->GetHostContext()](Error e) mutable {
           // Propagate metadata and output chain
           const int num_metadata = response->metadata_size();
+          auto inline_output = response->inline_output().begin();
           for (int i = 0; i < remote_objs.size(); ++i) {
             auto& obj = remote_objs[i];
             if (i >= num_metadata) {
@@ -1137,12 +1812,26 @@ void RemoteExecute(Chain ch, DistributedContext* dist_context,
               continue;
             }
             auto metadata = DeserializeTensorMetadata(response->metadata(i));
-            if (metadata) {
-              obj.metadata.emplace(metadata.get());
-              obj.tensor.emplace(std::move(metadata.get()), obj.id.get());
-            } else {
+            if (!metadata) {
               obj.tensor.SetError(DecodedDiagnostic(metadata.takeError()));
+              continue;
             }
+            obj.metadata.emplace(metadata.get());
+            // Inline outputs are in the order of the outputs.
+            if (inline_output != response->inline_output().end() &&
+                inline_output->index() == obj.output_index) {
+              auto value =
+                  DeserializeInlineTensor(*inline_output++, host_context);
+              if (value) {
+                obj.tensor.emplace(std::move(metadata.get()), obj.id.get(),
+                                   std::move(*value));
+                continue;
+              }
+              // The value is only an optimization, the remote object is
+              // still there.
+              llvm::consumeError(value.takeError());
+            }
+            obj.tensor.emplace(std::move(metadata.get()), obj.id.get());
           }
           if (e) {
             out_chain.SetError(std::move(e));
@@ -1183,6 +1872,26 @@ void RemoteExecuteTHPreallocatedKernel(
                 num_inputs.get(), num_output_with_tensorhandle.get(), exec_ctx);
 }
 
+// Creates an iterator that fetches the elements of the iterator `iterator_id`
+// on `receiver` by running `program_name`, see RemoteIterator.
+Expected<RCReference<data::Iterator>> MakeRemoteIterator(
+    Chain ch, DistributedContext* dist_context, TaskHandle receiver,
+    Argument<RemoteObjectId> chain_id, Argument<RemoteObjectId> iterator_id,
+    Attribute<int32_t> num_values, Attribute<int32_t> prefetch_num,
+    StringAttribute program_name, const ExecutionContext& exec_ctx) {
+  if (*num_values < 0 || *prefetch_num < 0) {
+    return llvm::make_error<InvalidArgumentErrorInfo>(
+        StrCat("Invalid remote iterator with ", *num_values, " values and ",
+               *prefetch_num, " prefetched elements"));
+  }
+  HostContext* host = exec_ctx.host();
+  return TakeRef(host->Construct<RemoteIterator>(
+      dist_context->GetRemoteClient(receiver),
+      dist_context->GetRemoteObjectManager(), dist_context->GetContextId(),
+      program_name.get(), chain_id.get(), iterator_id.get(), *num_values,
+      *prefetch_num, host));
+}
+
 AsyncValueRef<RemoteObjectId> GetChainForTaskHandle(
     Chain ch, RemoteChainManager* chain_manager, TaskHandle task,
     const ExecutionContext& exec_ctx) {
@@ -1213,14 +1922,18 @@ void SendBytes(Argument<DistributedContext> dist_context,
   auto response = std::make_unique<SendDataResponse>();
   request->set_context_id(dist_context->GetContextId());
   request->set_instance_key(*instance_key);
-  const int kNumBuffers = serialized->buffers.size();
-  for (size_t i = 0; i < kNumBuffers; ++i) {
-    request->add_payload(serialized->buffers[i]->data(),
-                         serialized->buffers[i]->size());
-  }
+  llvm::SmallVector<RCReference<HostBuffer>, 4> buffers;
+  for (const auto& buffer : serialized->buffers)
+    buffers.push_back(buffer.CopyRef());
+  Payload payload = dist_context->GetPayloadCodec().Encode(
+      Payload(std::move(buffers)), PayloadCodec::PayloadKind::kBytes,
+      request.get());
+  auto* request_ptr = request.get();
+  auto* response_ptr = response.get();
   dist_context->GetRemoteClient(*receiver_task)
-      ->SendDataAsync(
-          RemoteCallContext::GetDefault(), request.get(), response.get(),
+      ->SendDataWithPayloadAsync(
+          RemoteCallContext::GetDefault(), request_ptr, std::move(payload),
+          response_ptr,
           [request = std::move(request), response = std::move(response),
            dist_context = dist_context.ValueRef(),
            out_chain = out_chain_indirect.CopyRef()](Error e) {
@@ -1270,6 +1983,18 @@ void RegisterDistributedKernels(KernelRegistry* registry) {
                       TFRT_KERNEL(AllReduce<float>));
   registry->AddKernel("tfrt_dist.cpu.allreduce.i32",
                       TFRT_KERNEL(AllReduce<int32_t>));
+  registry->AddKernel("tfrt_dist.cpu.allreduce.bf16",
+                      TFRT_KERNEL(AllReduce<bf16>));
+  registry->AddKernel("tfrt_dist.cpu.allreduce.f16",
+                      TFRT_KERNEL(AllReduce<fp16>));
+  registry->AddKernel("tfrt_dist.cpu.fused_allreduce.f32",
+                      TFRT_KERNEL(FusedAllReduce<float>));
+  registry->AddKernel("tfrt_dist.cpu.fused_allreduce.i32",
+                      TFRT_KERNEL(FusedAllReduce<int32_t>));
+  registry->AddKernel("tfrt_dist.cpu.fused_allreduce.bf16",
+                      TFRT_KERNEL(FusedAllReduce<bf16>));
+  registry->AddKernel("tfrt_dist.cpu.fused_allreduce.f16",
+                      TFRT_KERNEL(FusedAllReduce<fp16>));
   registry->AddKernel("tfrt_dist.cpu.broadcast.f32",
                       TFRT_KERNEL(Broadcast<float>));
   registry->AddKernel("tfrt_dist.cpu.broadcast.i32",
@@ -1294,6 +2019,10 @@ void RegisterDistributedKernels(KernelRegistry* registry) {
                       TFRT_KERNEL(RegisterTFRTFunctionKernel));
   registry->AddKernel("tfrt_dist.register_tf_function",
                       TFRT_KERNEL(RegisterTFFunctionKernel));
+  registry->AddKernel("tfrt_dist.register_bef_function",
+                      TFRT_KERNEL(RegisterBEFFunctionKernel));
+  registry->AddKernel("tfrt_dist.remote_iterator",
+                      TFRT_KERNEL(MakeRemoteIterator));
   registry->AddKernel("tfrt_dist.get_chain_for_task_handle",
                       TFRT_KERNEL(GetChainForTaskHandle));
   registry->AddKernel("tfrt_dist.set_chain_for_task_handle",
@@ -23,7 +23,9 @@ namespace tfrt {
 void RegisterDistributedKernels(KernelRegistry* registry);
 void RegisterDistributedTestKernels(KernelRegistry* registry);
 
-TFRT_STATIC_KERNEL_REGISTRATION(RegisterDistributedKernels);
-TFRT_STATIC_KERNEL_REGISTRATION(RegisterDistributedTestKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("tfrt_dist.",
+                                       RegisterDistributedKernels);
+TFRT_STATIC_KERNEL_FAMILY_REGISTRATION("tfrt_dist.",
+                                       RegisterDistributedTestKernels);
 
 }  // namespace tfrt
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements LocalFabricCommunicator.
+
+#include "tfrt/distributed_runtime/local_fabric_communicator.h"
+
+#include <cstring>
+
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/distributed_runtime/distributed_context.h"
+#include "tfrt/distributed_runtime/remote_client.h"
+#include "tfrt/distributed_runtime/request_handler.h"
+#include "tfrt/distributed_runtime/server_context.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+namespace {
+
+// The servers in this process with a LocalFabricCommunicator, by address.
+class LocalServers {
+ public:
+  static LocalServers* Get() {
+    static auto* servers = new LocalServers();
+    return servers;
+  }
+
+  bool Add(string_view address, ServerContext* server) {
+    mutex_lock lock(mu_);
+    return servers_.try_emplace(address, server).second;
+  }
+
+  void Remove(string_view address) {
+    mutex_lock lock(mu_);
+    servers_.erase(address);
+  }
+
+  ServerContext* Find(string_view address) {
+    mutex_lock lock(mu_);
+    auto iter = servers_.find(address);
+    return iter == servers_.end() ? nullptr : iter->second;
+  }
+
+ private:
+  mutex mu_;
+  llvm::StringMap<ServerContext*> servers_ TFRT_GUARDED_BY(mu_);
+};
+
+class LocalRemoteClient : public RemoteClientInterface {
+ public:
+  explicit LocalRemoteClient(std::string address)
+      : address_(std::move(address)) {}
+
+#define LOCAL_CLIENT_METHOD(method)                                        \
+  void method##Async(RemoteCallContext* call_ctx,                          \
+                     const method##Request* request,                       \
+                     method##Response* response, CallbackFn done) final {  \
+    Dispatch(                                                              \
+        [request, response](RequestHandlerInterface* handler,              \
+                            CallbackFn done, HostContext*) {               \
+          handler->Handle##method(request, response, std::move(done));    \
+        },                                                                 \
+        std::move(done));                                                  \
+  }
+
+  LOCAL_CLIENT_METHOD(GetDevices);
+  LOCAL_CLIENT_METHOD(CreateContext);
+  LOCAL_CLIENT_METHOD(CloseContext);
+  LOCAL_CLIENT_METHOD(SendReadyChains);
+  LOCAL_CLIENT_METHOD(SendData);
+  LOCAL_CLIENT_METHOD(RegisterFunction);
+  LOCAL_CLIENT_METHOD(RemoteExecute);
+  LOCAL_CLIENT_METHOD(RemoteExecuteOp);
+  LOCAL_CLIENT_METHOD(DeleteRemoteObjects);
+  LOCAL_CLIENT_METHOD(KeepAlive);
+  LOCAL_CLIENT_METHOD(Batch);
+
+#undef LOCAL_CLIENT_METHOD
+
+  // The sender may reuse the payload buffers once the request is done, e.g.
+  // for later steps of a collective, so the receiver gets a copy of them.
+  void SendDataWithPayloadAsync(RemoteCallContext* call_ctx,
+                                SendDataRequest* request, Payload payload,
+                                SendDataResponse* response,
+                                CallbackFn done) final {
+    Dispatch(
+        [request, response, payload = std::move(payload)](
+            RequestHandlerInterface* handler, CallbackFn done,
+            HostContext* host) mutable {
+          llvm::SmallVector<RCReference<HostBuffer>, 4> buffers;
+          buffers.reserve(payload.buffers.size());
+          for (const auto& buffer : payload.buffers) {
+            auto copy = HostBuffer::CreateUninitialized(
+                buffer->size(), alignof(std::max_align_t), host->allocator());
+            if (!copy) {
+              done(llvm::make_error<UnknownErrorInfo>(
+                  "Failed to allocate payload buffer"));
+              return;
+            }
+            std::memcpy(copy->data(), buffer->data(), buffer->size());
+            buffers.push_back(std::move(copy));
+          }
+          handler->HandleSendDataWithPayload(
+              request, Payload(std::move(buffers)), response, std::move(done));
+        },
+        std::move(done));
+  }
+
+ private:
+  using HandleFn = llvm::unique_function<void(
+      RequestHandlerInterface* handler, CallbackFn done, HostContext* host)>;
+
+  // Runs `handle` with the request handler of the destination server, on its
+  // work queue, like a request received from the network.
+  void Dispatch(HandleFn handle, CallbackFn done) {
+    ServerContext* server = LocalServers::Get()->Find(address_);
+    if (server == nullptr) {
+      done(llvm::make_error<UnknownErrorInfo>(
+          StrCat("No local server with address ", address_)));
+      return;
+    }
+    EnqueueWork(server->GetHostContext(), [server, handle = std::move(handle),
+                                           done = std::move(done)]() mutable {
+      handle(server->GetRequestHandler(), std::move(done),
+             server->GetHostContext());
+    });
+  }
+
+  const std::string address_;
+};
+
+}  // namespace
+
+LocalFabricCommunicator::LocalFabricCommunicator(ServerContext* server_context)
+    : FabricCommunicator(kLocalFabricCommunicatorType, server_context),
+      address_(server_context->GetConfiguration()
+                   .fabric_configuration.server_address) {
+  registered_ = LocalServers::Get()->Add(address_, server_context);
+  if (!registered_) {
+    TFRT_LOG(ERROR) << "Another local server has the address " << address_;
+  }
+}
+
+LocalFabricCommunicator::~LocalFabricCommunicator() {
+  if (registered_) LocalServers::Get()->Remove(address_);
+}
+
+std::unique_ptr<RemoteClientInterface>
+LocalFabricCommunicator::CreateRemoteClient(DistributedContext* dist_context,
+                                            TaskHandle task_handle) {
+  return std::make_unique<LocalRemoteClient>(
+      dist_context->GetRemoteAddress(task_handle).str());
+}
+
+FabricCommunicator* CreateLocalFabricCommunicator(
+    ServerContext* server_context) {
+  return new LocalFabricCommunicator(server_context);
+}
+
+}  // namespace tfrt
@@ -26,6 +26,7 @@
 #include "mlir/IR/TypeUtilities.h"
 #include "tfrt/basic_kernels/opdefs/types.h"
 #include "tfrt/core_runtime/opdefs/types.h"
+#include "tfrt/data/opdefs/types.h"
 #include "tfrt/distributed_runtime/opdefs/types.h"
 
 namespace tfrt {
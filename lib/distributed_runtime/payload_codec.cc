@@ -0,0 +1,412 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements PayloadCodec.
+
+#include "tfrt/distributed_runtime/payload_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/support/bf16.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace {
+
+constexpr size_t kDefaultMinPayloadBytes = 4096;
+constexpr float kDefaultTopKFraction = 0.01f;
+constexpr size_t kHeaderBytes = sizeof(uint64_t);
+
+// Parameters of the LZ4 block format: matches are at least 4 bytes long and at
+// most 64KiB away, the last match starts at least 12 bytes before the end of
+// the block, and the last 5 bytes are literals.
+constexpr size_t kLz4MinMatch = 4;
+constexpr size_t kLz4MaxOffset = 65535;
+constexpr size_t kLz4MatchFindLimit = 12;
+constexpr size_t kLz4LastLiterals = 5;
+constexpr int kLz4HashLog = 12;
+// Lengths of at least 15 continue in bytes after the token.
+constexpr size_t kLz4LengthMask = 15;
+
+uint32_t Read32(const char* ptr) {
+  uint32_t value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+uint32_t Lz4Hash(uint32_t value) {
+  return (value * 2654435761U) >> (32 - kLz4HashLog);
+}
+
+void Lz4WriteLength(size_t length, char*& out) {
+  for (; length >= 255; length -= 255) *out++ = static_cast<char>(255);
+  *out++ = static_cast<char>(length);
+}
+
+// Compresses the `size` bytes at `src` into an LZ4 block at `dst`. Returns the
+// size of the block, or 0 if it does not fit in `capacity` bytes.
+size_t Lz4Compress(const char* src, size_t size, char* dst, size_t capacity) {
+  const char* const src_end = src + size;
+  const char* anchor = src;
+  char* out = dst;
+  char* const out_end = dst + capacity;
+
+  // Emits the literals from `anchor` to `literals_end`, followed by a match of
+  // `match_length` bytes unless it is zero.
+  auto emit = [&](const char* literals_end, size_t offset,
+                  size_t match_length) {
+    const size_t literal_length = literals_end - anchor;
+    const size_t max_size = 1 + literal_length / 255 + 1 + literal_length + 2 +
+                            match_length / 255 + 1;
+    if (static_cast<size_t>(out_end - out) < max_size) return false;
+    char* token = out++;
+    uint8_t token_value = std::min(literal_length, kLz4LengthMask) << 4;
+    if (literal_length >= kLz4LengthMask)
+      Lz4WriteLength(literal_length - kLz4LengthMask, out);
+    std::memcpy(out, anchor, literal_length);
+    out += literal_length;
+    if (match_length > 0) {
+      *out++ = static_cast<char>(offset & 0xff);
+      *out++ = static_cast<char>(offset >> 8);
+      const size_t length = match_length - kLz4MinMatch;
+      token_value |= std::min(length, kLz4LengthMask);
+      if (length >= kLz4LengthMask)
+        Lz4WriteLength(length - kLz4LengthMask, out);
+    }
+    *token = static_cast<char>(token_value);
+    return true;
+  };
+
+  if (size > kLz4MatchFindLimit) {
+    // Maps the hash of 4 bytes to the last position they were seen at.
+    std::vector<uint32_t> table(size_t{1} << kLz4HashLog, 0);
+    const char* const match_limit = src_end - kLz4MatchFindLimit;
+    const char* const match_end_limit = src_end - kLz4LastLiterals;
+    // Incompressible data is skipped faster the longer no match is found.
+    size_t misses = 0;
+    for (const char* ptr = src + 1; ptr <= match_limit;) {
+      const uint32_t hash = Lz4Hash(Read32(ptr));
+      const char* candidate = src + table[hash];
+      table[hash] = ptr - src;
+      if (static_cast<size_t>(ptr - candidate) > kLz4MaxOffset ||
+          Read32(candidate) != Read32(ptr)) {
+        ptr += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+      while (ptr > anchor && candidate > src && ptr[-1] == candidate[-1]) {
+        --ptr;
+        --candidate;
+      }
+      const char* match_end = ptr + kLz4MinMatch;
+      for (const char* next = candidate + kLz4MinMatch;
+           match_end < match_end_limit && *match_end == *next; ++next)
+        ++match_end;
+      if (!emit(ptr, ptr - candidate, match_end - ptr)) return 0;
+      table[Lz4Hash(Read32(match_end - 2))] = match_end - 2 - src;
+      anchor = ptr = match_end;
+    }
+  }
+  if (!emit(src_end, 0, 0)) return 0;
+  return out - dst;
+}
+
+// Decompresses the LZ4 block of `size` bytes at `src` into exactly `dst_size`
+// bytes at `dst`. Returns false if the block is malformed.
+bool Lz4Decompress(const char* src, size_t size, char* dst, size_t dst_size) {
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(src);
+  const uint8_t* const in_end = in + size;
+  char* out = dst;
+  char* const out_end = dst + dst_size;
+
+  auto read_length = [&](size_t& length) {
+    uint8_t byte;
+    do {
+      if (in == in_end) return false;
+      byte = *in++;
+      length += byte;
+    } while (byte == 255);
+    return true;
+  };
+
+  while (in < in_end) {
+    const uint8_t token = *in++;
+    size_t literal_length = token >> 4;
+    if (literal_length == kLz4LengthMask && !read_length(literal_length))
+      return false;
+    if (static_cast<size_t>(in_end - in) < literal_length ||
+        static_cast<size_t>(out_end - out) < literal_length)
+      return false;
+    std::memcpy(out, in, literal_length);
+    in += literal_length;
+    out += literal_length;
+    // The last sequence has no match.
+    if (in == in_end) break;
+
+    if (in_end - in < 2) return false;
+    const size_t offset = in[0] | in[1] << 8;
+    in += 2;
+    if (offset == 0 || offset > static_cast<size_t>(out - dst)) return false;
+    size_t match_length = token & kLz4LengthMask;
+    if (match_length == kLz4LengthMask && !read_length(match_length))
+      return false;
+    match_length += kLz4MinMatch;
+    if (static_cast<size_t>(out_end - out) < match_length) return false;
+    // The match may overlap the bytes it produces.
+    const char* match = out - offset;
+    if (offset >= match_length) {
+      std::memcpy(out, match, match_length);
+    } else {
+      for (size_t i = 0; i < match_length; ++i) out[i] = match[i];
+    }
+    out += match_length;
+  }
+  return out == out_end;
+}
+
+void WriteHeader(uint64_t value, char*& out) {
+  std::memcpy(out, &value, sizeof(value));
+  out += sizeof(value);
+}
+
+uint64_t ReadHeader(const char*& in) {
+  uint64_t value;
+  std::memcpy(&value, in, sizeof(value));
+  in += sizeof(value);
+  return value;
+}
+
+RCReference<HostBuffer> AllocateBuffer(size_t size, HostAllocator* allocator) {
+  return HostBuffer::CreateUninitialized(size, alignof(std::max_align_t),
+                                         allocator);
+}
+
+// The Encode functions return null if the encoding does not shrink `buffer`.
+RCReference<HostBuffer> EncodeLz4(const HostBuffer& buffer,
+                                  HostAllocator* allocator) {
+  if (buffer.size() <= kHeaderBytes) return {};
+  auto encoded = AllocateBuffer(buffer.size(), allocator);
+  if (!encoded) return {};
+  char* out = static_cast<char*>(encoded->data());
+  WriteHeader(buffer.size(), out);
+  const size_t block_size =
+      Lz4Compress(static_cast<const char*>(buffer.data()), buffer.size(), out,
+                  buffer.size() - kHeaderBytes - 1);
+  if (block_size == 0) return {};
+  return HostBuffer::CreateFromExternal(std::move(encoded), 0,
+                                        kHeaderBytes + block_size);
+}
+
+RCReference<HostBuffer> EncodeBf16(const HostBuffer& buffer,
+                                   HostAllocator* allocator) {
+  const size_t num_values = buffer.size() / sizeof(float);
+  auto encoded = AllocateBuffer(num_values * sizeof(bf16), allocator);
+  if (!encoded) return {};
+  const float* values = static_cast<const float*>(buffer.data());
+  bf16* out = static_cast<bf16*>(encoded->data());
+  for (size_t i = 0; i < num_values; ++i) out[i] = FloatToBf16(values[i]);
+  return encoded;
+}
+
+RCReference<HostBuffer> EncodeTopK(const HostBuffer& buffer, float fraction,
+                                   HostAllocator* allocator) {
+  const size_t num_values = buffer.size() / sizeof(float);
+  if (num_values > std::numeric_limits<uint32_t>::max()) return {};
+  const size_t k = std::max<size_t>(
+      1, std::min<size_t>(num_values, std::ceil(num_values * fraction)));
+  const size_t size =
+      2 * kHeaderBytes + k * (sizeof(uint32_t) + sizeof(float));
+  if (size >= buffer.size()) return {};
+  auto encoded = AllocateBuffer(size, allocator);
+  if (!encoded) return {};
+
+  const float* values = static_cast<const float*>(buffer.data());
+  std::vector<uint32_t> indices(num_values);
+  std::iota(indices.begin(), indices.end(), 0);
+  std::nth_element(indices.begin(), indices.begin() + k - 1, indices.end(),
+                   [values](uint32_t a, uint32_t b) {
+                     return std::abs(values[a]) > std::abs(values[b]);
+                   });
+  // Sorted indices are scattered in order by the receiver.
+  std::sort(indices.begin(), indices.begin() + k);
+
+  char* out = static_cast<char*>(encoded->data());
+  WriteHeader(num_values, out);
+  WriteHeader(k, out);
+  std::memcpy(out, indices.data(), k * sizeof(uint32_t));
+  out += k * sizeof(uint32_t);
+  for (size_t i = 0; i < k; ++i, out += sizeof(float))
+    std::memcpy(out, &values[indices[i]], sizeof(float));
+  return encoded;
+}
+
+Expected<RCReference<HostBuffer>> DecodeLz4(const HostBuffer& buffer,
+                                            HostAllocator* allocator) {
+  if (buffer.size() < kHeaderBytes)
+    return MakeStringError("truncated LZ4 payload");
+  const char* in = static_cast<const char*>(buffer.data());
+  const uint64_t size = ReadHeader(in);
+  // A byte of an LZ4 block expands to at most 255 bytes.
+  if (size / 255 > buffer.size())
+    return MakeStringError("malformed LZ4 payload");
+  auto decoded = AllocateBuffer(size, allocator);
+  if (!decoded) return MakeStringError("out of memory decoding LZ4 payload");
+  if (!Lz4Decompress(in, buffer.size() - kHeaderBytes,
+                     static_cast<char*>(decoded->data()), size))
+    return MakeStringError("malformed LZ4 payload");
+  return std::move(decoded);
+}
+
+Expected<RCReference<HostBuffer>> DecodeBf16(const HostBuffer& buffer,
+                                             HostAllocator* allocator) {
+  if (buffer.size() % sizeof(bf16) != 0)
+    return MakeStringError("truncated bf16 payload");
+  const size_t num_values = buffer.size() / sizeof(bf16);
+  auto decoded = AllocateBuffer(num_values * sizeof(float), allocator);
+  if (!decoded) return MakeStringError("out of memory decoding bf16 payload");
+  const bf16* values = static_cast<const bf16*>(buffer.data());
+  float* out = static_cast<float*>(decoded->data());
+  for (size_t i = 0; i < num_values; ++i) out[i] = Bf16ToFloat(values[i]);
+  return std::move(decoded);
+}
+
+Expected<RCReference<HostBuffer>> DecodeTopK(const HostBuffer& buffer,
+                                             HostAllocator* allocator) {
+  const char* in = static_cast<const char*>(buffer.data());
+  if (buffer.size() < 2 * kHeaderBytes)
+    return MakeStringError("truncated top-k payload");
+  const uint64_t num_values = ReadHeader(in);
+  const uint64_t k = ReadHeader(in);
+  if (num_values > std::numeric_limits<uint32_t>::max() || k > num_values ||
+      buffer.size() - 2 * kHeaderBytes !=
+          k * (sizeof(uint32_t) + sizeof(float)))
+    return MakeStringError("malformed top-k payload");
+  auto decoded = AllocateBuffer(num_values * sizeof(float), allocator);
+  if (!decoded) return MakeStringError("out of memory decoding top-k payload");
+
+  float* out = static_cast<float*>(decoded->data());
+  std::fill(out, out + num_values, 0.0f);
+  const char* values = in + k * sizeof(uint32_t);
+  for (size_t i = 0; i < k; ++i) {
+    uint32_t index;
+    std::memcpy(&index, in + i * sizeof(uint32_t), sizeof(index));
+    if (index >= num_values)
+      return MakeStringError("top-k payload index out of range");
+    std::memcpy(&out[index], values + i * sizeof(float), sizeof(float));
+  }
+  return std::move(decoded);
+}
+
+}  // namespace
+
+PayloadCodec::PayloadCodec(const PayloadCompressionConfiguration& config,
+                           HostAllocator* allocator)
+    : lz4_(config.lz4()),
+      float_encoding_(config.float_encoding()),
+      top_k_fraction_(config.top_k_fraction() > 0 ? config.top_k_fraction()
+                                                  : kDefaultTopKFraction),
+      min_payload_bytes_(config.min_payload_bytes() > 0
+                             ? config.min_payload_bytes()
+                             : kDefaultMinPayloadBytes),
+      allocator_(allocator) {}
+
+Payload PayloadCodec::Encode(Payload payload, PayloadKind kind,
+                             SendDataRequest* request) const {
+  if (!enabled()) return payload;
+
+  llvm::SmallVector<PayloadEncoding, 4> encodings;
+  bool encoded_any = false;
+  for (auto& buffer : payload.buffers) {
+    RCReference<HostBuffer> encoded;
+    PayloadEncoding encoding = PAYLOAD_ENCODING_NONE;
+    if (buffer->size() >= min_payload_bytes_) {
+      if (kind == PayloadKind::kFloatPartialSums &&
+          buffer->size() % sizeof(float) == 0) {
+        if (float_encoding_ == PayloadCompressionConfiguration::BF16) {
+          encoded = EncodeBf16(*buffer, allocator_);
+          encoding = PAYLOAD_ENCODING_BF16;
+        } else if (float_encoding_ == PayloadCompressionConfiguration::TOP_K) {
+          encoded = EncodeTopK(*buffer, top_k_fraction_, allocator_);
+          encoding = PAYLOAD_ENCODING_TOP_K;
+        }
+      }
+      if (!encoded && lz4_) {
+        encoded = EncodeLz4(*buffer, allocator_);
+        encoding = PAYLOAD_ENCODING_LZ4;
+      }
+    }
+    if (encoded) {
+      buffer = std::move(encoded);
+      encoded_any = true;
+    } else {
+      encoding = PAYLOAD_ENCODING_NONE;
+    }
+    encodings.push_back(encoding);
+  }
+
+  if (encoded_any) {
+    for (PayloadEncoding encoding : encodings)
+      request->add_payload_encoding(encoding);
+  }
+  return payload;
+}
+
+bool PayloadCodec::IsEncoded(const SendDataRequest& request) {
+  return request.payload_encoding_size() > 0;
+}
+
+Expected<Payload> PayloadCodec::Decode(const SendDataRequest& request,
+                                       Payload payload) const {
+  if (!IsEncoded(request)) return std::move(payload);
+  if (request.payload_encoding_size() != payload.buffers.size()) {
+    return MakeStringError("payload has ", payload.buffers.size(),
+                           " buffers but ", request.payload_encoding_size(),
+                           " encodings");
+  }
+
+  for (int i = 0; i < payload.buffers.size(); ++i) {
+    Expected<RCReference<HostBuffer>> decoded = RCReference<HostBuffer>();
+    switch (request.payload_encoding(i)) {
+      case PAYLOAD_ENCODING_NONE:
+        continue;
+      case PAYLOAD_ENCODING_LZ4:
+        decoded = DecodeLz4(*payload.buffers[i], allocator_);
+        break;
+      case PAYLOAD_ENCODING_BF16:
+        decoded = DecodeBf16(*payload.buffers[i], allocator_);
+        break;
+      case PAYLOAD_ENCODING_TOP_K:
+        decoded = DecodeTopK(*payload.buffers[i], allocator_);
+        break;
+      default:
+        return MakeStringError("unknown payload encoding ",
+                               request.payload_encoding(i));
+    }
+    if (!decoded) return decoded.takeError();
+    payload.buffers[i] = std::move(*decoded);
+  }
+  return std::move(payload);
+}
+
+}  // namespace tfrt
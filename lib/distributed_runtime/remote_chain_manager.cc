@@ -40,4 +40,23 @@ void RemoteChainManager::SetRemoteChain(TaskHandle task, RemoteObjectId chain) {
   chains_.insert({task, chain});
 }
 
+void RemoteChainManager::AddPendingTensor(const AsyncValue* tensor,
+                                          const RemoteObjectId& id) {
+  mutex_lock lock(pending_tensors_mu_);
+  pending_tensors_.try_emplace(tensor, id);
+}
+
+void RemoteChainManager::RemovePendingTensor(const AsyncValue* tensor) {
+  mutex_lock lock(pending_tensors_mu_);
+  pending_tensors_.erase(tensor);
+}
+
+llvm::Optional<RemoteObjectId> RemoteChainManager::GetPendingTensor(
+    const AsyncValue* tensor) {
+  mutex_lock lock(pending_tensors_mu_);
+  auto iter = pending_tensors_.find(tensor);
+  if (iter == pending_tensors_.end()) return llvm::None;
+  return iter->second;
+}
+
 }  // namespace tfrt
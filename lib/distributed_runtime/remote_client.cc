@@ -0,0 +1,66 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the default batching of RemoteClientInterface.
+
+#include "tfrt/distributed_runtime/remote_client.h"
+
+#include "tfrt/support/refcounted_callback.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+
+void RemoteClientInterface::BatchAsync(RemoteCallContext* call_ctx,
+                                       const BatchRequest* request,
+                                       BatchResponse* response,
+                                       CallbackFn done) {
+  // Add all responses first, so that callbacks of earlier requests don't race
+  // with adding the responses of later ones.
+  for (int i = 0; i < request->requests_size(); ++i) response->add_responses();
+
+  auto refcounted_done = MakeRef<RefCountedCallback>(std::move(done));
+  for (int i = 0; i < request->requests_size(); ++i) {
+    const BatchedRequest& batched_request = request->requests(i);
+    BatchedResponse* batched_response = response->mutable_responses(i);
+    auto request_done = [batched_response,
+                         refcounted_done = refcounted_done.CopyRef()](Error e) {
+      if (e) batched_response->set_error_message(StrCat(e));
+    };
+    switch (batched_request.request_case()) {
+      case BatchedRequest::kRemoteExecute:
+        RemoteExecuteAsync(call_ctx, &batched_request.remote_execute(),
+                           batched_response->mutable_remote_execute(),
+                           std::move(request_done));
+        break;
+      case BatchedRequest::kSendReadyChains:
+        SendReadyChainsAsync(call_ctx, &batched_request.send_ready_chains(),
+                             batched_response->mutable_send_ready_chains(),
+                             std::move(request_done));
+        break;
+      case BatchedRequest::kDeleteRemoteObjects:
+        DeleteRemoteObjectsAsync(
+            call_ctx, &batched_request.delete_remote_objects(),
+            batched_response->mutable_delete_remote_objects(),
+            std::move(request_done));
+        break;
+      default:
+        batched_response->set_error_message("unknown request in batch");
+        break;
+    }
+  }
+}
+
+}  // namespace tfrt
@@ -0,0 +1,80 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the helpers to pass tensors by value in RemoteExecute.
+
+#include "tfrt/distributed_runtime/remote_execute.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/tensor_serialize_utils.h"
+
+namespace tfrt {
+
+// The alignment of the buffers of DenseHostTensor::CreateUninitialized().
+constexpr size_t kMinInlineTensorAlignment = 16;
+
+bool CanInlineTensor(const DenseHostTensor& tensor, int64_t max_bytes) {
+  // String elements are not stored in the tensor's buffer.
+  return max_bytes > 0 && tensor.dtype() != DType(DType::String) &&
+         tensor.DataSizeInBytes() <= max_bytes;
+}
+
+void SerializeInlineTensor(const DenseHostTensor& tensor,
+                           InlineTensorProto* proto) {
+  proto->set_metadata(SerializeTensorMetadata(tensor.metadata()));
+  proto->set_data(tensor.data(), tensor.DataSizeInBytes());
+}
+
+Expected<DenseHostTensor> DeserializeInlineTensor(
+    const InlineTensorProto& proto, HostContext* host) {
+  auto metadata = DeserializeTensorMetadata(proto.metadata());
+  if (!metadata) return metadata.takeError();
+  auto tensor = DenseHostTensor::CreateUninitialized(*metadata, host);
+  if (!tensor) return MakeStringError("Cannot allocate inline tensor");
+  if (tensor->DataSizeInBytes() != proto.data().size()) {
+    return MakeStringError("Inline tensor has ", proto.data().size(),
+                           " bytes, expected ", tensor->DataSizeInBytes());
+  }
+  std::memcpy(tensor->data(), proto.data().data(), proto.data().size());
+  return std::move(*tensor);
+}
+
+Expected<DenseHostTensor> TakeInlineTensor(InlineTensorProto* proto,
+                                           HostContext* host) {
+  auto metadata = DeserializeTensorMetadata(proto->metadata());
+  if (!metadata) return metadata.takeError();
+  const size_t size = metadata->dtype.GetHostSize() *
+                      metadata->shape.GetNumElements();
+  if (size != proto->data().size()) {
+    return MakeStringError("Inline tensor has ", proto->data().size(),
+                           " bytes, expected ", size);
+  }
+  const size_t alignment = std::max(metadata->dtype.GetHostAlignment(),
+                                    kMinInlineTensorAlignment);
+  if (reinterpret_cast<uintptr_t>(proto->data().data()) % alignment != 0)
+    return DeserializeInlineTensor(*proto, host);
+  std::string* data = proto->release_data();
+  auto buffer = HostBuffer::CreateFromExternal(
+      &(*data)[0], data->size(), [data](void*, size_t) { delete data; });
+  return DenseHostTensor(*metadata, std::move(buffer));
+}
+
+}  // namespace tfrt
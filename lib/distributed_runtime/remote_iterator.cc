@@ -0,0 +1,188 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements RemoteIterator.
+
+#include "tfrt/distributed_runtime/remote_iterator.h"
+
+#include <limits>
+#include <memory>
+
+#include "tfrt/distributed_runtime/proto/remote_message.pb.h"
+#include "tfrt/distributed_runtime/remote_client.h"
+#include "tfrt/distributed_runtime/remote_execute.h"
+#include "tfrt/distributed_runtime/remote_object_manager.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/memory_pressure.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+// The error of the elements after the end of a tfrt_data iterator.
+constexpr char kEndOfIteratorMessage[] = "iterator reached end";
+
+void SetRemoteObjectIdProto(const RemoteObjectId& id,
+                            RemoteObjectIdProto* proto) {
+  proto->set_prefix_id(id.prefix_id);
+  proto->set_local_id(id.local_id);
+  proto->set_device(id.device->name().str());
+}
+
+}  // namespace
+
+RemoteIterator::RemoteIterator(RemoteClientInterface* remote_client,
+                               RemoteObjectManager* object_manager,
+                               uint64_t context_id, string_view program_name,
+                               RemoteObjectId chain_id,
+                               RemoteObjectId iterator_id, int num_values,
+                               int prefetch_num, HostContext* host)
+    : remote_client_(remote_client),
+      object_manager_(object_manager),
+      context_id_(context_id),
+      program_name_(program_name),
+      iterator_id_(std::move(iterator_id)),
+      num_values_(num_values),
+      prefetch_num_(prefetch_num),
+      host_(host),
+      last_chain_id_(std::move(chain_id)) {}
+
+data::IterationResult RemoteIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  // Keep `prefetch_num_` requests in flight after the one that is returned,
+  // fewer under memory pressure.
+  auto prefetch_num = MemoryPressure::Get(host_).LimitBufferSize(
+      static_cast<size_t>(prefetch_num_));
+  while (buffer_.size() <= prefetch_num && !ReachedEnd()) {
+    buffer_.push(FetchNext());
+  }
+  if (buffer_.empty()) return data::IterationResult::Eof(host_, num_values_);
+  auto result = std::move(buffer_.front());
+  buffer_.pop();
+  return result;
+}
+
+data::IterationResult RemoteIterator::FetchNext() {
+  auto request = std::make_unique<RemoteExecuteRequest>();
+  request->set_context_id(context_id_);
+  request->set_program_name(program_name_);
+  // The tensors are only returned by value, however large they are.
+  request->set_max_inline_output_bytes(std::numeric_limits<int64_t>::max());
+  SetRemoteObjectIdProto(last_chain_id_, request->add_input());
+  SetRemoteObjectIdProto(iterator_id_, request->add_input());
+
+  RemoteObjectId chain_id = last_chain_id_;
+  last_chain_id_ =
+      object_manager_->AllocateRemoteObject(iterator_id_.device.CopyRef());
+  SetRemoteObjectIdProto(last_chain_id_, request->add_output()->mutable_id());
+  for (int i = 0; i < num_values_; ++i) {
+    auto* output = request->add_output();
+    output->set_need_metadata(true);
+    output->set_value_only(true);
+  }
+  {
+    mutex_lock lock(mu_);
+    for (const RemoteObjectId& id : consumed_chain_ids_)
+      SetRemoteObjectIdProto(id, request->add_release());
+    consumed_chain_ids_.clear();
+  }
+
+  SmallVector<RCReference<AsyncValue>, 4> values;
+  values.reserve(num_values_);
+  for (int i = 0; i < num_values_; ++i) {
+    values.push_back(
+        MakeUnconstructedAsyncValueRef<DenseHostTensor>(host_).ReleaseRCRef());
+  }
+  auto result = data::IterationResult::Pending(
+      std::move(values), MakeUnconstructedAsyncValueRef<bool>(host_));
+
+  auto response = std::make_unique<RemoteExecuteResponse>();
+  RemoteExecuteRequest* request_ptr = request.get();
+  RemoteExecuteResponse* response_ptr = response.get();
+  remote_client_->RemoteExecuteAsync(
+      RemoteCallContext::GetDefault(), request_ptr, response_ptr,
+      [iterator = FormRef(this), request = std::move(request),
+       response = std::move(response), chain_id = std::move(chain_id),
+       result = result.CopyRef()](Error e) mutable {
+        if (e) {
+          auto diag = DecodedDiagnostic(std::move(e));
+          mutex_lock lock(iterator->mu_);
+          iterator->failed_chain_ids_.push_back(std::move(chain_id));
+          if (string_view(diag.message).contains(kEndOfIteratorMessage)) {
+            iterator->end_of_iteration_ = true;
+            for (auto& value : result.values) value->SetError(diag);
+            result.eof.emplace(true);
+            return;
+          }
+          for (auto& value : result.values) value->SetError(diag);
+          result.eof.SetError(diag);
+          return;
+        }
+        // Output 0 is the chain, and the inline outputs are in order.
+        auto inline_output = response->mutable_inline_output()->begin();
+        const auto inline_end = response->mutable_inline_output()->end();
+        for (size_t i = 0; i < result.values.size(); ++i) {
+          auto& value = result.values[i];
+          if (inline_output == inline_end ||
+              inline_output->index() != i + 1) {
+            value->SetError(DecodedDiagnostic(
+                StrCat("Value ", i, " of the remote iterator not returned")));
+            continue;
+          }
+          auto tensor = TakeInlineTensor(&*inline_output++, iterator->host_);
+          if (!tensor) {
+            value->SetError(DecodedDiagnostic(tensor.takeError()));
+            continue;
+          }
+          value->emplace<DenseHostTensor>(std::move(*tensor));
+        }
+        result.eof.emplace(false);
+        mutex_lock lock(iterator->mu_);
+        iterator->consumed_chain_ids_.push_back(std::move(chain_id));
+      });
+  return result;
+}
+
+void RemoteIterator::Destroy() {
+  // All requests completed, since each of them holds a reference.
+  auto request = std::make_unique<DeleteRemoteObjectsRequest>();
+  request->set_context_id(context_id_);
+  SetRemoteObjectIdProto(iterator_id_, request->add_input());
+  SetRemoteObjectIdProto(last_chain_id_, request->add_input());
+  {
+    mutex_lock lock(mu_);
+    for (const RemoteObjectId& id : consumed_chain_ids_)
+      SetRemoteObjectIdProto(id, request->add_input());
+    for (const RemoteObjectId& id : failed_chain_ids_)
+      SetRemoteObjectIdProto(id, request->add_input());
+  }
+  auto response = std::make_unique<DeleteRemoteObjectsResponse>();
+  DeleteRemoteObjectsRequest* request_ptr = request.get();
+  DeleteRemoteObjectsResponse* response_ptr = response.get();
+  remote_client_->DeleteRemoteObjectsAsync(
+      RemoteCallContext::GetDefault(), request_ptr, response_ptr,
+      [request = std::move(request),
+       response = std::move(response)](Error e) mutable {
+        // The chains of failed requests may not exist on the remote task.
+        if (e) {
+          TFRT_LOG(INFO) << "Error deleting remote iterator: "
+                         << DecodedDiagnostic(std::move(e));
+        }
+      });
+  data::internal::DestroyImpl<RemoteIterator>(this, host_->allocator());
+}
+
+}  // namespace tfrt
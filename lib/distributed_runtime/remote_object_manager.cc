@@ -16,6 +16,9 @@
 
 #include "tfrt/distributed_runtime/remote_object_manager.h"
 
+#include <algorithm>
+
+#include "llvm/ADT/Hashing.h"
 #include "tfrt/host_context/async_value_ref.h"
 
 namespace tfrt {
@@ -34,6 +37,39 @@ RemoteObjectId RemoteObjectManager::AllocateRemoteObject(
   return RemoteObjectId(prefix_id_, local_id, output_device.CopyRef());
 }
 
+int RemoteObjectManager::GetShardIndex(const RemoteObjectId& id) {
+  // DenseMap hashes ids by their local id, so the shard is picked by a hash
+  // that is independent of it. Otherwise the local ids of a shard would share
+  // their low bits, and collide in its map.
+  return static_cast<size_t>(llvm::hash_combine(id.prefix_id, id.local_id)) %
+         kNumShards;
+}
+
+template <typename F>
+void RemoteObjectManager::ForEachShard(ArrayRef<RemoteObjectId> ids, F fn) {
+  // Sort the indices of the ids by shard, with a counting sort.
+  llvm::SmallVector<int, 16> shard_indices;
+  shard_indices.reserve(ids.size());
+  size_t offsets[kNumShards + 1] = {};
+  for (const RemoteObjectId& id : ids) {
+    shard_indices.push_back(GetShardIndex(id));
+    ++offsets[shard_indices.back() + 1];
+  }
+  for (int i = 0; i < kNumShards; ++i) offsets[i + 1] += offsets[i];
+  llvm::SmallVector<size_t, 16> indices(ids.size());
+  size_t next[kNumShards];
+  std::copy(offsets, offsets + kNumShards, next);
+  for (size_t i = 0; i < ids.size(); ++i) indices[next[shard_indices[i]]++] = i;
+
+  for (int i = 0; i < kNumShards; ++i) {
+    if (offsets[i] == offsets[i + 1]) continue;
+    Shard& shard = shards_[i];
+    tfrt::mutex_lock lock(shard.mutex);
+    fn(shard.object_maps, ArrayRef<size_t>(indices).slice(
+                              offsets[i], offsets[i + 1] - offsets[i]));
+  }
+}
+
 void RemoteObjectManager::SetRemoteObject(const RemoteObjectId& id,
                                           RCReference<AsyncValue> value) {
   RCReference<AsyncValue> val = GetRemoteObject(id);
@@ -41,32 +77,58 @@ void RemoteObjectManager::SetRemoteObject(const RemoteObjectId& id,
   cast<IndirectAsyncValue>(val.get())->ForwardTo(value.CopyRef());
 }
 
+void RemoteObjectManager::SetRemoteObjects(
+    ArrayRef<RemoteObjectId> ids, ArrayRef<RCReference<AsyncValue>> values) {
+  assert(ids.size() == values.size());
+  llvm::SmallVector<RCReference<AsyncValue>, 4> vals;
+  GetRemoteObjects(ids, &vals);
+  // Forward outside of the locks, as it may run the waiters of the values.
+  for (size_t i = 0; i < ids.size(); ++i) {
+    assert(vals[i]->IsUnresolvedIndirect());
+    cast<IndirectAsyncValue>(vals[i].get())->ForwardTo(values[i].CopyRef());
+  }
+}
+
 RCReference<AsyncValue> RemoteObjectManager::GetRemoteObject(
     const RemoteObjectId& id) {
-  tfrt::mutex_lock lock(mutex_);
-  auto iter = object_maps_.find(id);
-  if (iter != object_maps_.end()) {
+  Shard& shard = shards_[GetShardIndex(id)];
+  tfrt::mutex_lock lock(shard.mutex);
+  auto iter = shard.object_maps.find(id);
+  if (iter != shard.object_maps.end()) {
     return iter->second.CopyRef();
   }
   RCReference<AsyncValue> value = MakeIndirectAsyncValue(host_context_);
-  object_maps_[id] = value.CopyRef();
+  shard.object_maps[id] = value.CopyRef();
   return value.CopyRef();
 }
 
+void RemoteObjectManager::GetRemoteObjects(
+    ArrayRef<RemoteObjectId> ids,
+    SmallVectorImpl<RCReference<AsyncValue>>* values) {
+  const size_t begin = values->size();
+  values->resize(begin + ids.size());
+  ForEachShard(ids, [&](ObjectMap& objects, ArrayRef<size_t> indices) {
+    for (size_t index : indices) {
+      RCReference<AsyncValue>& value = objects[ids[index]];
+      if (!value) value = MakeIndirectAsyncValue(host_context_);
+      (*values)[begin + index] = value.CopyRef();
+    }
+  });
+}
+
 // Delete the given remote object ids.
-Error RemoteObjectManager::DeleteRemoteObjects(
-    const llvm::SmallVectorImpl<RemoteObjectId>& ids) {
-  tfrt::mutex_lock lock(mutex_);
+Error RemoteObjectManager::DeleteRemoteObjects(ArrayRef<RemoteObjectId> ids) {
   std::unique_ptr<ErrorCollection> errors;
-  for (const RemoteObjectId& id : ids) {
-    if (!object_maps_.erase(id)) {
+  ForEachShard(ids, [&](ObjectMap& objects, ArrayRef<size_t> indices) {
+    for (size_t index : indices) {
+      if (objects.erase(ids[index])) continue;
       if (!errors) {
         errors = std::make_unique<ErrorCollection>();
       }
       errors->AddError(llvm::make_error<InvalidArgumentErrorInfo>(
-          StrCat("Could not find object: ", id)));
+          StrCat("Could not find object: ", ids[index])));
     }
-  }
+  });
   if (errors) {
     return Error(std::move(errors));
   } else {
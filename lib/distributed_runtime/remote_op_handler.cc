@@ -55,6 +55,15 @@ void PopulateRemoteExecuteOutputProto(RemoteExecuteOutput* proto,
   proto->set_need_metadata(true);
 }
 
+// Sets the results that are not available yet to `diag`.
+void SetResultsError(llvm::MutableArrayRef<TensorAndMetadata> results,
+                     const DecodedDiagnostic& diag) {
+  for (auto& result : results) {
+    if (!result.metadata.IsAvailable()) result.metadata.SetError(diag);
+    if (!result.tensor->IsAvailable()) result.tensor->SetError(diag);
+  }
+}
+
 // TODO(ayushd): support attribute types other than I64.
 Error PopulateRequestAttrsProto(RemoteExecuteOpRequest* request,
                                 OpAttrsRef attrs) {
@@ -127,8 +136,10 @@ Expected<CoreRuntimeOp> RemoteOpHandler::MakeOp(string_view op_name) {
 
 void RemoteOpHandler::Execute(const std::string& op_name,
                               const OpInvocation& invocation) {
-  // Wait for async input tensors before starting to dispatch the
-  // remote op.
+  // Inputs produced by remote ops in flight are passed by their remote object
+  // ids, so that this op is dispatched right away and waits for them on the
+  // remote task, overlapping with the producing ops. Other async inputs are
+  // waited for before dispatching the remote op.
   llvm::SmallVector<AsyncValue*, 4> to_wait;
 
   auto chain = MakeConstructedAsyncValueRef<Chain>(dist_ctx_->GetHostContext());
@@ -139,10 +150,15 @@ void RemoteOpHandler::Execute(const std::string& op_name,
   auto arguments =
       std::make_unique<llvm::SmallVector<RCReference<AsyncValue>, 8>>();
   arguments->resize(invocation.arguments.size());
+  auto input_ids =
+      std::make_unique<llvm::SmallVector<llvm::Optional<RemoteObjectId>, 8>>();
+  input_ids->resize(invocation.arguments.size());
   for (auto i = 0; i < invocation.arguments.size(); ++i) {
     auto* tensor_av = invocation.arguments[i].GetAsyncTensor();
     (*arguments)[i] = FormRef(tensor_av);
-    if (!tensor_av->IsAvailable()) {
+    if (tensor_av->IsAvailable()) continue;
+    (*input_ids)[i] = remote_chain_manager_->GetPendingTensor(tensor_av);
+    if (!(*input_ids)[i]) {
       to_wait.push_back(tensor_av);
     }
   }
@@ -151,6 +167,7 @@ void RemoteOpHandler::Execute(const std::string& op_name,
   request->set_context_id(dist_ctx_->GetContextId());
   request->set_op_handler_name(remote_device_->name().str());
   request->set_op_name(op_name);
+  request->set_trace_id(invocation.exec_ctx.trace_id());
 
   // Add output object ids to the request.
   // TODO(ayushd): optimize so that metadata is not always asynchronous.
@@ -188,46 +205,74 @@ void RemoteOpHandler::Execute(const std::string& op_name,
   // Add op attributes to the request.
   if (Error attr_error =
           PopulateRequestAttrsProto(request.get(), invocation.attrs.freeze())) {
-    chain.SetError(attr_error);
-    for (auto& output_th : invocation.results) {
-      output_th.GetAsyncTensor()->SetError(DecodedDiagnostic(attr_error));
-    }
+    DecodedDiagnostic diag(attr_error);
+    chain.SetError(diag);
+    SetResultsError(*results, diag);
     return;
   }
 
   RunWhenReady(
       to_wait,
-      [dist_ctx = dist_ctx_, arguments = std::move(arguments),
+      [dist_ctx = dist_ctx_, remote_chain_manager = remote_chain_manager_,
+       arguments = std::move(arguments), input_ids = std::move(input_ids),
        results = std::move(results), request = std::move(request),
        attrs = invocation.attrs.freeze(), remote_task = std::move(remote_task),
        chain = std::move(chain)]() mutable {
         // Add input object ids to the request.
-        for (auto& input : *arguments) {
-          // Each TensorHandle should contain an available RemoteTensor.
-          // The corresponding tensor on the remote side may be
-          // unavailable.
-          assert(input->IsAvailable());
+        for (auto i = 0; i < arguments->size(); ++i) {
+          auto& input = (*arguments)[i];
+          auto& input_id = (*input_ids)[i];
+          if (!input_id) {
+            // The TensorHandle should contain an available RemoteTensor. The
+            // corresponding tensor on the remote side may be unavailable.
+            assert(input->IsAvailable());
+            if (input->IsError()) {
+              chain.SetError(input->GetError());
+              SetResultsError(*results, input->GetError());
+              return;
+            }
+            input_id = input->get<RemoteTensor>().remote_object_id();
+          }
           auto* request_input = request->add_input();
-          PopulateRemoteObjectIdProto(
-              request_input, input->get<RemoteTensor>().remote_object_id());
+          PopulateRemoteObjectIdProto(request_input, *input_id);
           TFRT_DLOG(INFO) << "RemoteOpHandler input "
                           << request_input->DebugString();
         }
 
+        // The request is sent, so ops consuming the results can be sent too.
+        for (auto& result : *results) {
+          remote_chain_manager->AddPendingTensor(result.tensor.get(),
+                                                 *result.remote_object_id);
+        }
+
         auto response = std::make_unique<RemoteExecuteOpResponse>();
         RemoteClientInterface* remote_client =
             dist_ctx->GetRemoteClient(remote_task);
+        RemoteExecuteOpRequest* request_ptr = request.get();
+        RemoteExecuteOpResponse* response_ptr = response.get();
         remote_client->RemoteExecuteOpAsync(
-            RemoteCallContext::GetDefault(), request.get(), response.get(),
-            [results = std::move(results), request = std::move(request),
-             response = std::move(response),
+            RemoteCallContext::GetDefault(), request_ptr, response_ptr,
+            [remote_chain_manager, results = std::move(results),
+             request = std::move(request), response = std::move(response),
              chain = chain.CopyRef()](Error e) mutable {
+              auto remove_pending = [&] {
+                for (auto& result : *results) {
+                  remote_chain_manager->RemovePendingTensor(
+                      result.tensor.get());
+                }
+              };
               if (e) {
-                chain.SetError(std::move(e));
+                DecodedDiagnostic diag(std::move(e));
+                chain.SetError(diag);
+                SetResultsError(*results, diag);
+                remove_pending();
                 return;
               }
               if (response->metadata_size() != results->size()) {
-                chain.SetError("unexpected number of remote results");
+                DecodedDiagnostic diag("unexpected number of remote results");
+                chain.SetError(diag);
+                SetResultsError(*results, diag);
+                remove_pending();
                 return;
               }
               for (auto i = 0; i < response->metadata_size(); ++i) {
@@ -238,10 +283,13 @@ void RemoteOpHandler::Execute(const std::string& op_name,
                   (*results)[i].tensor->emplace<RemoteTensor>(
                       metadata.get(), *(*results)[i].remote_object_id);
                 } else {
-                  (*results)[i].tensor->SetError(DecodedDiagnostic(
-                      "could not deserialize metadata in response"));
+                  DecodedDiagnostic diag(
+                      "could not deserialize metadata in response");
+                  (*results)[i].metadata.SetError(diag);
+                  (*results)[i].tensor->SetError(diag);
                 }
               }
+              remove_pending();
               chain.SetStateConcrete();
             });
       });
@@ -22,6 +22,13 @@ RemoteTensor::RemoteTensor(const TensorMetadata& metadata,
                            const RemoteObjectId& remote_object_id)
     : Tensor(metadata), remote_object_id_(remote_object_id) {}
 
+RemoteTensor::RemoteTensor(const TensorMetadata& metadata,
+                           const RemoteObjectId& remote_object_id,
+                           DenseHostTensor inline_value)
+    : Tensor(metadata),
+      remote_object_id_(remote_object_id),
+      inline_value_(std::move(inline_value)) {}
+
 void RemoteTensor::Print(raw_ostream& os) const {
   os << "RemoteTensor : " << remote_object_id_ << " dtype = " << dtype()
      << ", shape = " << shape();
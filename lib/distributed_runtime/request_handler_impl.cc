@@ -33,7 +33,9 @@
 #include "tfrt/distributed_runtime/distributed_context.h"
 #include "tfrt/distributed_runtime/distributed_init_helper.h"
 #include "tfrt/distributed_runtime/function_cache.h"
+#include "tfrt/distributed_runtime/payload_codec.h"
 #include "tfrt/distributed_runtime/proto/remote_message.pb.h"
+#include "tfrt/distributed_runtime/remote_execute.h"
 #include "tfrt/distributed_runtime/remote_object_manager.h"
 #include "tfrt/distributed_runtime/request_handler.h"
 #include "tfrt/host_context/async_dispatch.h"
@@ -44,9 +46,12 @@
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/refcounted_callback.h"
+#include "tfrt/support/string_util.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/tensor.h"
 #include "tfrt/tensor/tensor_serialize_utils.h"
+#include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
 namespace {
@@ -57,6 +62,31 @@ void ToProto(const RemoteObjectId& id, RemoteObjectIdProto* proto) {
   proto->set_device(id.device->name().str());
 }
 
+// Returns the argument of type `type` that `proto` passes by value, either a
+// DenseHostTensor or a TensorHandle of it on the host device.
+Expected<RCReference<AsyncValue>> MakeInlineArgument(
+    const InlineTensorProto& proto, TypeName type, HostContext* host) {
+  auto tensor = DeserializeInlineTensor(proto, host);
+  if (!tensor) return tensor.takeError();
+  TensorMetadata metadata = tensor->metadata();
+  auto value =
+      MakeAvailableAsyncValueRef<DenseHostTensor>(host, std::move(*tensor));
+  if (type.GetName() != "!corert.tensorhandle") return value.ReleaseRCRef();
+  return MakeAvailableAsyncValueRef<TensorHandle>(
+             host, host->GetHostDeviceRef(), metadata,
+             AsyncValueRef<Tensor>(std::move(value)))
+      .ReleaseRCRef();
+}
+
+// Returns the DenseHostTensor that `value` holds, directly or in a
+// TensorHandle, or nullptr if it holds none.
+const DenseHostTensor* GetDenseHostTensor(const AsyncValue* value) {
+  if (value->IsType<TensorHandle>())
+    value = value->get<TensorHandle>().GetAsyncTensor();
+  if (!value->IsConcrete() || !value->IsType<DenseHostTensor>()) return nullptr;
+  return &value->get<DenseHostTensor>();
+}
+
 class RequestHandler : public RequestHandlerInterface {
  public:
   explicit RequestHandler(ServerContext* server_context)
@@ -81,6 +111,10 @@ class RequestHandler : public RequestHandlerInterface {
   void HandleSendData(const SendDataRequest* request,
                       SendDataResponse* response, CallbackFn done) final;
 
+  void HandleSendDataWithPayload(const SendDataRequest* request,
+                                 Payload payload, SendDataResponse* response,
+                                 CallbackFn done) final;
+
   void HandleRegisterFunction(const RegisterFunctionRequest* request,
                               RegisterFunctionResponse* response,
                               CallbackFn done) final;
@@ -100,9 +134,24 @@ class RequestHandler : public RequestHandlerInterface {
   void HandleKeepAlive(const KeepAliveRequest* request,
                        KeepAliveResponse* response, CallbackFn done) final;
 
+  void HandleBatch(const BatchRequest* request, BatchResponse* response,
+                   CallbackFn done) final {
+    HandleBatchRequest(this, request, response, std::move(done));
+  }
+
  private:
   HostContext* host_ctx() { return server_context_->GetHostContext(); }
 
+  // Parses and optionally compiles the program of `request` into BEF.
+  static Expected<CompiledProgramCache::CompiledProgram> CompileProgram(
+      const RegisterFunctionRequest& request, string_view task_name);
+
+  // Registers `program` with the function cache of `dist_context`.
+  static Error RegisterCompiledProgram(
+      DistributedContext* dist_context, const std::string& program_name,
+      const CompiledProgramCache::CompiledProgram& program,
+      RegisterFunctionResponse* response);
+
   ServerContext* server_context_;
 };
 
@@ -158,7 +207,9 @@ void HandleCreateContextInternal(ServerContext* server_context,
     }
   }
   ToProto(dist_context->LocalReadyChain(), response->mutable_ready_chain());
-  done(Error::success());
+  // Respond once the subtree of this task in the cluster initialization has
+  // created its contexts too, with the ready chains of the subtree.
+  dist_context->ForwardCreateContext(*request, response, std::move(done));
 }
 
 void RequestHandler::HandleCreateContext(const CreateContextRequest* request,
@@ -226,21 +277,15 @@ void RequestHandler::HandleSendReadyChains(
       return;
     }
   }
-  wrapped_done(Error::success());
+  // Respond once the subtree of this task in the broadcast has the chains too.
+  context->ForwardRemoteReadyChains(*request, std::move(wrapped_done));
 }
 
 void RequestHandler::HandleSendData(const SendDataRequest* request,
                                     SendDataResponse* response,
                                     CallbackFn done) {
-  auto expected = server_context_->GetDistributedContext(request->context_id());
-  if (!expected) {
-    done(expected.takeError());
-    return;
-  }
-  DistributedContext* dist_context = expected.get();
-
-  InstanceKey key = request->instance_key();
-  // TODO(ayushd): avoid string copy
+  // Transports that receive the payload outside of the message avoid this
+  // copy by calling HandleSendDataWithPayload.
   llvm::SmallVector<RCReference<HostBuffer>, 4> buffers;
   for (size_t i = 0; i < request->payload_size(); ++i) {
     auto buffer = tfrt::HostBuffer::CreateUninitialized(
@@ -250,62 +295,162 @@ void RequestHandler::HandleSendData(const SendDataRequest* request,
               static_cast<char*>(buffer->data()));
     buffers.push_back(std::move(buffer));
   }
-  dist_context->GetCallbackRegistry()->SetValue(key,
-                                                Payload(std::move(buffers)));
-  done(Error::success());
+  HandleSendDataWithPayload(request, Payload(std::move(buffers)), response,
+                            std::move(done));
+}
+
+void RequestHandler::HandleSendDataWithPayload(const SendDataRequest* request,
+                                               Payload payload,
+                                               SendDataResponse* response,
+                                               CallbackFn done) {
+  auto expected = server_context_->GetDistributedContext(request->context_id());
+  if (!expected) {
+    done(expected.takeError());
+    return;
+  }
+  DistributedContext* dist_context = expected.get();
+
+  if (!PayloadCodec::IsEncoded(*request)) {
+    InstanceKey key = request->instance_key();
+    dist_context->GetCallbackRegistry()->SetValue(key, std::move(payload));
+    done(Error::success());
+    return;
+  }
+
+  // Decoding large payloads is expensive, so it runs on the work queue rather
+  // than the transport thread. The request stays alive until `done` is called.
+  EnqueueWork(dist_context->GetHostContext(),
+              [dist_context, request, payload = std::move(payload),
+               done = std::move(done)]() mutable {
+                auto decoded = dist_context->GetPayloadCodec().Decode(
+                    *request, std::move(payload));
+                if (!decoded) {
+                  done(decoded.takeError());
+                  return;
+                }
+                InstanceKey key = request->instance_key();
+                dist_context->GetCallbackRegistry()->SetValue(
+                    key, std::move(*decoded));
+                done(Error::success());
+              });
 }
 
 void RequestHandler::HandleRegisterFunction(
     const RegisterFunctionRequest* request, RegisterFunctionResponse* response,
     CallbackFn done) {
   auto expected = server_context_->GetDistributedContext(request->context_id());
-  if (!expected) done(expected.takeError());
+  if (!expected) {
+    done(expected.takeError());
+    return;
+  }
   DistributedContext* dist_context = expected.get();
+  CompiledProgramCache* program_cache =
+      server_context_->GetCompiledProgramCache();
+
+  // Reuse the program compiled for an earlier request with the same
+  // fingerprint, possibly from another distributed context.
+  std::string key;
+  if (!request->program_fingerprint().empty()) {
+    key = CompiledProgramCache::Key(request->program_fingerprint(),
+                                    request->need_compilation(),
+                                    request->program_is_bef());
+    if (auto program = program_cache->Lookup(key)) {
+      done(RegisterCompiledProgram(dist_context, request->program_name(),
+                                   *program, response));
+      return;
+    }
+    if (request->program().empty()) {
+      response->set_program_missing(true);
+      done(Error::success());
+      return;
+    }
+    if (CompiledProgramCache::Fingerprint(request->program()) !=
+        request->program_fingerprint()) {
+      done(llvm::make_error<InvalidArgumentErrorInfo>(
+          StrCat("Fingerprint mismatch for program: ",
+                 request->program_name()),
+          dist_context->GetTaskName()));
+      return;
+    }
+  }
+
+  // Parsing and compiling may take long, so they run on the blocking work
+  // queue instead of the thread handling requests.
+  auto program = EnqueueBlockingWork(host_ctx(), [request, dist_context] {
+    return CompileProgram(*request, dist_context->GetTaskName());
+  });
+  program.AndThen([request, response, dist_context, program_cache,
+                   key = std::move(key), done = std::move(done),
+                   program = program.CopyRef()]() mutable {
+    if (program.IsError()) {
+      done(llvm::make_error<UnknownErrorInfo>(program.GetError().message,
+                                              dist_context->GetTaskName()));
+      return;
+    }
+    auto shared_program =
+        std::make_shared<const CompiledProgramCache::CompiledProgram>(
+            std::move(*program));
+    if (!key.empty()) program_cache->Insert(key, shared_program);
+    done(RegisterCompiledProgram(dist_context, request->program_name(),
+                                 *shared_program, response));
+  });
+}
+
+Expected<CompiledProgramCache::CompiledProgram> RequestHandler::CompileProgram(
+    const RegisterFunctionRequest& request, string_view task_name) {
+  CompiledProgramCache::CompiledProgram program;
+  if (request.program_is_bef()) {
+    program.bef_buffer.assign(request.program().begin(),
+                              request.program().end());
+    return std::move(program);
+  }
 
   const CompilerPass* pass = GetCompilerPass(kCompilerPassName);
-  BefBuffer bef_buffer;
   if (pass == nullptr) {
-    done(llvm::make_error<NotFoundErrorInfo>(
-        StrCat("Compiler pass not found for program: ",
-               request->program_name()),
-        dist_context->GetTaskName()));
-    return;
+    return llvm::make_error<NotFoundErrorInfo>(
+        StrCat("Compiler pass not found for program: ", request.program_name()),
+        task_name);
   }
   mlir::MLIRContext context;
   mlir::OwningModuleRef module =
-      pass->ParseMlirProgram(request->program(), &context);
+      pass->ParseMlirProgram(request.program(), &context);
   if (!module) {
-    done(llvm::make_error<MalformattedMlirFileErrorInfo>(
-        StrCat("Failed parsing program:", request->program_name()),
-        dist_context->GetTaskName()));
-    return;
-  };
-  if (request->need_compilation()) {
+    return llvm::make_error<MalformattedMlirFileErrorInfo>(
+        StrCat("Failed parsing program:", request.program_name()), task_name);
+  }
+  if (request.need_compilation()) {
     llvm::Expected<CompilerPass::CompilationOutput> output_or =
         pass->Compile(module.get(), &context);
     if (!output_or) {
-      done(llvm::make_error<CompilationFailedErrorInfo>(
-          StrCat("Failed to convert MLIR to BEF: ", request->program_name()),
-          dist_context->GetTaskName()));
-      return;
+      return llvm::make_error<CompilationFailedErrorInfo>(
+          StrCat("Failed to convert MLIR to BEF: ", request.program_name()),
+          task_name);
     }
     CompilerPass::CompilationOutput output = std::move(output_or.get());
     for (const auto& output_device : output.output_devices) {
-      response->add_output_device(output_device);
+      program.output_devices.push_back(output_device);
     }
     module = std::move(output.module);
   }
-  bef_buffer = ConvertMLIRToBEF(module.get(),
-                                /* disable_optional_sections = */ true);
-  if (bef_buffer.empty()) {
-    done(llvm::make_error<MalformattedMlirFileErrorInfo>(
-        StrCat("Failed to convert MLIR to BEF: ", request->program_name()),
-        dist_context->GetTaskName()));
-    return;
+  program.bef_buffer = ConvertMLIRToBEF(module.get(),
+                                        /* disable_optional_sections = */ true);
+  if (program.bef_buffer.empty()) {
+    return llvm::make_error<MalformattedMlirFileErrorInfo>(
+        StrCat("Failed to convert MLIR to BEF: ", request.program_name()),
+        task_name);
+  }
+  return std::move(program);
+}
+
+Error RequestHandler::RegisterCompiledProgram(
+    DistributedContext* dist_context, const std::string& program_name,
+    const CompiledProgramCache::CompiledProgram& program,
+    RegisterFunctionResponse* response) {
+  for (const auto& output_device : program.output_devices) {
+    response->add_output_device(output_device);
   }
   FunctionCache* function_cache = dist_context->GetFunctionCache();
-  done(
-      function_cache->Register(request->program_name(), std::move(bef_buffer)));
+  return function_cache->Register(program_name, program.bef_buffer);
 }
 
 void RequestHandler::HandleRemoteExecute(const RemoteExecuteRequest* request,
@@ -347,10 +492,16 @@ void RequestHandler::HandleRemoteExecute(const RemoteExecuteRequest* request,
     return;
   }
 
+  TFRT_TRACE_SCOPE(Default,
+                   StrCat("HandleRemoteExecute: ", request->program_name()));
+  TFRT_TRACE_FLOW(Default, request->trace_id());
+
   // TODO(bramandia): Propagate RequestContext from the request.
   ResourceContext resource_context;
   Expected<RCReference<RequestContext>> req_ctx =
-      RequestContextBuilder(host_ctx(), &resource_context).build();
+      RequestContextBuilder(host_ctx(), &resource_context)
+          .set_trace_id(request->trace_id())
+          .build();
   if (!req_ctx) {
     done(llvm::make_error<UnknownErrorInfo>(
         StrCat("Failed to build RequestContext ", req_ctx.takeError())));
@@ -388,12 +539,15 @@ void RequestHandler::HandleRemoteExecute(const RemoteExecuteRequest* request,
       arguments.push_back(remote_object_id.get());
     }
   }
-  if (fn->argument_types().size() != arguments.size() + request->input_size()) {
+  const int num_inputs = request->input_size() + request->inline_input_size();
+  if (fn->argument_types().size() != arguments.size() + num_inputs) {
     done(llvm::make_error<InvalidArgumentErrorInfo>(
         StrCat("Argument size mismatch: fn #arg: ", fn->argument_types().size(),
-               " Received #inputs: ", request->input_size())));
+               " Received #inputs: ", num_inputs)));
     return;
   }
+  SmallVector<RemoteObjectId, 4> input_ids;
+  input_ids.reserve(request->input_size());
   for (int i = 0; i < request->input_size(); ++i) {
     auto& id = request->input(i);
 
@@ -405,16 +559,60 @@ void RequestHandler::HandleRemoteExecute(const RemoteExecuteRequest* request,
           StrCat("Can't find device: ", id.device())));
       return;
     }
-    RemoteObjectId input_id(id.prefix_id(), id.local_id(), device.CopyRef());
-    RCReference<AsyncValue> val = manager->GetRemoteObject(input_id);
-    arguments_ref.push_back(val.CopyRef());
-    arguments.push_back(val.get());
+    input_ids.emplace_back(id.prefix_id(), id.local_id(), device.CopyRef());
+  }
+  const size_t num_preallocated = arguments_ref.size();
+  manager->GetRemoteObjects(input_ids, &arguments_ref);
+  // Inline inputs are materialized here instead of being looked up, in
+  // increasing order of their index so that the remote objects before them
+  // are already in place.
+  for (const auto& inline_input : request->inline_input()) {
+    const size_t position = num_preallocated + inline_input.index();
+    if (position > arguments_ref.size()) {
+      done(llvm::make_error<InvalidArgumentErrorInfo>(
+          StrCat("Invalid inline input index: ", inline_input.index())));
+      return;
+    }
+    TypeName type =
+        fn->argument_types()[arguments.size() + inline_input.index()];
+    auto value = MakeInlineArgument(inline_input, type, host_ctx());
+    if (!value) {
+      done(value.takeError());
+      return;
+    }
+    arguments_ref.insert(arguments_ref.begin() + position, std::move(*value));
+  }
+  for (size_t i = num_preallocated; i < arguments_ref.size(); ++i)
+    arguments.push_back(arguments_ref[i].get());
+  if (request->release_size() > 0) {
+    SmallVector<RemoteObjectId, 4> release_ids;
+    release_ids.reserve(request->release_size());
+    for (const auto& id : request->release()) {
+      RCReference<Device> device =
+          dist_context->GetRemoteDeviceManager()->GetDeviceRef<Device>(
+              id.device());
+      if (device.get() == nullptr) {
+        done(llvm::make_error<DeviceNotFoundErrorInfo>(
+            StrCat("Can't find device: ", id.device())));
+        return;
+      }
+      release_ids.emplace_back(id.prefix_id(), id.local_id(), device.CopyRef());
+    }
+    if (auto error = manager->DeleteRemoteObjects(release_ids)) {
+      done(std::move(error));
+      return;
+    }
   }
   auto results = std::make_unique<SmallVector<RCReference<AsyncValue>, 4>>();
   results->resize(fn->result_types().size());
 
   fn->Execute(exec_ctx, arguments, *results);
+  SmallVector<RemoteObjectId, 4> output_ids;
+  SmallVector<RCReference<AsyncValue>, 4> output_values;
+  output_ids.reserve(request->output_size());
+  output_values.reserve(request->output_size());
   for (int i = 0; i < request->output_size(); ++i) {
+    if (request->output(i).value_only()) continue;
     auto& id = request->output(i).id();
     RCReference<Device> device =
         dist_context->GetRemoteDeviceManager()->GetDeviceRef<Device>(
@@ -426,9 +624,10 @@ void RequestHandler::HandleRemoteExecute(const RemoteExecuteRequest* request,
     }
     // TODO(bramandia): Do not store the output in the map if the device is not
     // a local device.
-    RemoteObjectId output_id(id.prefix_id(), id.local_id(), device.CopyRef());
-    manager->SetRemoteObject(output_id, (*results)[i].CopyRef());
+    output_ids.emplace_back(id.prefix_id(), id.local_id(), device.CopyRef());
+    output_values.push_back((*results)[i].CopyRef());
   }
+  manager->SetRemoteObjects(output_ids, output_values);
 
   // get the pointer of results before being moved on the lambda capture.
   auto result_ref = results.get();
@@ -440,6 +639,11 @@ void RequestHandler::HandleRemoteExecute(const RemoteExecuteRequest* request,
                                  std::move(arguments_ref)]() mutable {
     for (int i = 0; i < request->output_size(); ++i) {
       if (request->output(i).need_metadata()) {
+        if ((*results)[i]->IsError()) {
+          done(llvm::make_error<UnknownErrorInfo>(
+              (*results)[i]->GetError().message));
+          return;
+        }
         if (fn->result_types()[i].GetName() == "!t.tensor") {
           std::string serialized =
               SerializeTensorMetadata((*results)[i]->get<Tensor>().metadata());
@@ -453,6 +657,19 @@ void RequestHandler::HandleRemoteExecute(const RemoteExecuteRequest* request,
               StrCat("Invalid type ", fn->result_types()[i].GetName())));
           return;
         }
+        // Small results are also returned by value, which saves the client
+        // fetching them.
+        const DenseHostTensor* tensor = GetDenseHostTensor((*results)[i].get());
+        if (tensor && CanInlineTensor(*tensor,
+                                      request->max_inline_output_bytes())) {
+          auto* inline_output = response->add_inline_output();
+          inline_output->set_index(i);
+          SerializeInlineTensor(*tensor, inline_output);
+        } else if (request->output(i).value_only()) {
+          done(llvm::make_error<InvalidArgumentErrorInfo>(
+              StrCat("Output ", i, " can't be returned by value")));
+          return;
+        }
       }
     }
     done(Error::success());
@@ -570,7 +787,9 @@ void RequestHandler::HandleRemoteExecuteOp(
     // TODO(bramandia): Propagate RequestContext from the request.
     ResourceContext resource_context;
     Expected<RCReference<tfrt::RequestContext>> req_ctx =
-        RequestContextBuilder(host_ctx, &resource_context).build();
+        RequestContextBuilder(host_ctx, &resource_context)
+            .set_trace_id(request->trace_id())
+            .build();
     if (!req_ctx) {
       done(llvm::make_error<UnknownErrorInfo>(
           StrCat("Failed to build RequestContext ", req_ctx.takeError())));
@@ -683,4 +902,44 @@ std::unique_ptr<RequestHandlerInterface> NewRequestHandler(
     ServerContext* server_context) {
   return std::make_unique<RequestHandler>(server_context);
 }
+
+void HandleBatchRequest(RequestHandlerInterface* handler,
+                        const BatchRequest* request, BatchResponse* response,
+                        CallbackFn done) {
+  // Add all responses first, so that callbacks of earlier requests don't race
+  // with adding the responses of later ones.
+  for (int i = 0; i < request->requests_size(); ++i) response->add_responses();
+
+  auto refcounted_done = MakeRef<RefCountedCallback>(std::move(done));
+  for (int i = 0; i < request->requests_size(); ++i) {
+    const BatchedRequest& batched_request = request->requests(i);
+    BatchedResponse* batched_response = response->mutable_responses(i);
+    auto request_done = [batched_response,
+                         refcounted_done = refcounted_done.CopyRef()](Error e) {
+      if (e) batched_response->set_error_message(StrCat(e));
+    };
+    switch (batched_request.request_case()) {
+      case BatchedRequest::kRemoteExecute:
+        handler->HandleRemoteExecute(&batched_request.remote_execute(),
+                                     batched_response->mutable_remote_execute(),
+                                     std::move(request_done));
+        break;
+      case BatchedRequest::kSendReadyChains:
+        handler->HandleSendReadyChains(
+            &batched_request.send_ready_chains(),
+            batched_response->mutable_send_ready_chains(),
+            std::move(request_done));
+        break;
+      case BatchedRequest::kDeleteRemoteObjects:
+        handler->HandleDeleteRemoteObjects(
+            &batched_request.delete_remote_objects(),
+            batched_response->mutable_delete_remote_objects(),
+            std::move(request_done));
+        break;
+      default:
+        batched_response->set_error_message("unknown request in batch");
+        break;
+    }
+  }
+}
 }  // namespace tfrt
@@ -24,6 +24,7 @@
 #include "tfrt/distributed_runtime/distributed_context.h"
 #include "tfrt/distributed_runtime/distributed_init_helper.h"
 #include "tfrt/distributed_runtime/fabric_communicator.h"
+#include "tfrt/distributed_runtime/function_cache.h"
 #include "tfrt/distributed_runtime/remote_object_manager.h"
 #include "tfrt/distributed_runtime/request_handler.h"
 #include "tfrt/distributed_runtime/request_handler_impl.h"
@@ -40,7 +41,9 @@ ServerContext::ServerContext(HostContext* host_context,
                              ServerContextConfiguration configuration)
     : host_context_{host_context},
       configuration_{std::move(configuration)},
-      init_helper_{std::make_unique<DistributedInitHelper>(this)} {
+      init_helper_{std::make_unique<DistributedInitHelper>(this)},
+      compiled_program_cache_{std::make_unique<CompiledProgramCache>(
+          configuration_.compiled_program_cache_bytes)} {
   request_handler_ = NewRequestHandler(this);
   GetOrCreateFabricCommunicator();
   GarbageCollectInactiveDistributedContexts(
@@ -19,10 +19,13 @@
 // care about selective registration of kernels.
 
 #include "op_handler_kernels.h"
+#include "tfrt/distributed_runtime/local_fabric_communicator.h"
 #include "tfrt/distributed_runtime/remote_op_handler.h"
 
 namespace tfrt {
 
 TFRT_STATIC_KERNEL_REGISTRATION(RegisterRemoteOpHandlerKernels);
+TFRT_STATIC_FABRIC_COMMUNICATOR_REGISTRATION(kLocalFabricCommunicatorType,
+                                             CreateLocalFabricCommunicator);
 
 }  // namespace tfrt
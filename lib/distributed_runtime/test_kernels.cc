@@ -70,6 +70,19 @@ class TestRequestHandler : public RequestHandlerInterface {
 
 #undef TEST_HANDLE_METHOD
 
+  void HandleSendDataWithPayload(const SendDataRequest* request,
+                                 Payload payload, SendDataResponse* response,
+                                 CallbackFn done) final {
+    handler_->HandleSendDataWithPayload(request, std::move(payload), response,
+                                        std::move(done));
+  }
+
+  // Batched remote executes are buffered like the others.
+  void HandleBatch(const BatchRequest* request, BatchResponse* response,
+                   CallbackFn done) final {
+    HandleBatchRequest(this, request, response, std::move(done));
+  }
+
   void HandleRemoteExecute(const RemoteExecuteRequest* request,
                            RemoteExecuteResponse* response,
                            CallbackFn done) final {
@@ -0,0 +1,129 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements ArenaAllocator.
+
+#include "tfrt/host_context/arena_allocator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+#include "llvm/Support/MathExtras.h"
+
+namespace tfrt {
+
+// Chunks are aligned to a cache line, so that small allocations with the
+// default alignment need no padding at the start of a chunk.
+static constexpr size_t kChunkAlignment = 64;
+
+// The smallest size class.
+static constexpr size_t kMinSizeClass = 16;
+
+ArenaAllocator::ArenaAllocator(HostAllocator* fallback_allocator,
+                               size_t chunk_size)
+    : fallback_allocator_(fallback_allocator),
+      chunk_size_(chunk_size),
+      max_arena_allocation_size_(chunk_size / 4) {
+  assert(fallback_allocator_ != nullptr);
+}
+
+ArenaAllocator::~ArenaAllocator() {
+  mutex_lock lock(mu_);
+  for (void* chunk : chunks_)
+    fallback_allocator_->DeallocateBytes(chunk, chunk_size_);
+  for (auto& size_class_blocks : free_blocks_) {
+    const size_t size_class = size_class_blocks.first;
+    if (IsArenaAllocation(size_class)) continue;
+    for (void* block : size_class_blocks.second)
+      fallback_allocator_->DeallocateBytes(block, size_class);
+  }
+}
+
+size_t ArenaAllocator::SizeClass(size_t size) {
+  if (size <= kMinSizeClass) return kMinSizeClass;
+  return llvm::alignTo(size, llvm::PowerOf2Floor(size) / 8);
+}
+
+void* ArenaAllocator::AllocateBytes(size_t size, size_t alignment) {
+  const size_t size_class = SizeClass(size);
+  const bool is_arena_allocation = IsArenaAllocation(size_class);
+
+  // Arena allocations are identified by their size on deallocation, so they
+  // can not fall back if their alignment does not fit in a chunk.
+  if (is_arena_allocation &&
+      alignment > chunk_size_ - max_arena_allocation_size_)
+    return nullptr;
+
+  char* ptr = nullptr;
+  {
+    mutex_lock lock(mu_);
+    // Recycle a deallocated block. Most allocations of a size class have the
+    // same alignment, so the last block almost always fits.
+    auto it = free_blocks_.find(size_class);
+    if (it != free_blocks_.end()) {
+      auto& blocks = it->second;
+      auto block = std::find_if(blocks.rbegin(), blocks.rend(), [&](void* b) {
+        return reinterpret_cast<uintptr_t>(b) % alignment == 0;
+      });
+      if (block != blocks.rend()) {
+        ptr = static_cast<char*>(*block);
+        blocks.erase(std::next(block).base());
+      }
+    }
+
+    if (ptr == nullptr && is_arena_allocation) {
+      ptr = reinterpret_cast<char*>(
+          llvm::alignTo(reinterpret_cast<uintptr_t>(current_), alignment));
+      if (current_ == nullptr || ptr + size_class > end_) {
+        auto* chunk = static_cast<char*>(
+            fallback_allocator_->AllocateBytes(chunk_size_, kChunkAlignment));
+        if (chunk == nullptr) return nullptr;
+        chunks_.push_back(chunk);
+        end_ = chunk + chunk_size_;
+        ptr = reinterpret_cast<char*>(
+            llvm::alignTo(reinterpret_cast<uintptr_t>(chunk), alignment));
+      }
+      current_ = ptr + size_class;
+    }
+  }
+
+  if (ptr == nullptr) {
+    assert(!is_arena_allocation);
+    ptr = static_cast<char*>(fallback_allocator_->AllocateBytes(
+        size_class, std::max(alignment, kChunkAlignment)));
+    if (ptr == nullptr) return nullptr;
+  }
+
+  // The allocation keeps the chunks alive.
+  AddRef();
+  return ptr;
+}
+
+void ArenaAllocator::DeallocateBytes(void* ptr, size_t size) {
+  {
+    mutex_lock lock(mu_);
+    free_blocks_[SizeClass(size)].push_back(ptr);
+  }
+
+  // The memory is freed with the arena.
+  DropRef();
+}
+
+size_t ArenaAllocator::NumChunks() const {
+  mutex_lock lock(mu_);
+  return chunks_.size();
+}
+
+}  // namespace tfrt
@@ -18,11 +18,84 @@
 
 #include "tfrt/host_context/async_dispatch.h"
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/task_function.h"
+#include "tfrt/support/thread_local_free_list.h"
+#include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
 
+// If the request is traced, adds the enqueuing scope to the request's flow and
+// returns `work` wrapped in a scope which continues the flow on the thread
+// running it.
+static llvm::unique_function<void()> TraceWork(
+    const ExecutionContext& exec_ctx, llvm::unique_function<void()> work) {
+  using tracing::TracingLevel;
+  uint64_t trace_id = exec_ctx.trace_id();
+  if (trace_id == 0 || !tracing::IsTracingEnabled(TracingLevel::Verbose))
+    return work;
+  tracing::RecordTracingFlow(TracingLevel::Verbose, trace_id);
+  return [trace_id, work = std::move(work)]() mutable {
+    static tracing::TracePoint task_trace_point("Task");
+    tracing::TracingScope scope(TracingLevel::Verbose, task_trace_point);
+    tracing::RecordTracingFlow(TracingLevel::Verbose, trace_id);
+    work();
+  };
+}
+
+static std::atomic<int> max_inline_continuation_depth{
+    InlineContinuationLimits().max_depth};
+static std::atomic<int64_t> inline_continuation_time_budget_ns{
+    InlineContinuationLimits().time_budget.count()};
+
+// The inline continuations running nested on this thread, and the time the
+// first nested one started.
+static thread_local int inline_continuation_depth = 0;
+static thread_local std::chrono::steady_clock::time_point
+    inline_continuation_start;
+
+void SetInlineContinuationLimits(const InlineContinuationLimits& limits) {
+  max_inline_continuation_depth.store(limits.max_depth,
+                                      std::memory_order_relaxed);
+  inline_continuation_time_budget_ns.store(limits.time_budget.count(),
+                                           std::memory_order_relaxed);
+}
+
+InlineContinuationLimits GetInlineContinuationLimits() {
+  InlineContinuationLimits limits;
+  limits.max_depth =
+      max_inline_continuation_depth.load(std::memory_order_relaxed);
+  limits.time_budget = std::chrono::nanoseconds(
+      inline_continuation_time_budget_ns.load(std::memory_order_relaxed));
+  return limits;
+}
+
+bool internal::InlineContinuationScope::Enter() {
+  const int depth = inline_continuation_depth;
+  if (depth >= max_inline_continuation_depth.load(std::memory_order_relaxed))
+    return false;
+  // The clock is only read for nested continuations, so that the common case
+  // of a single continuation stays cheap.
+  if (depth > 0) {
+    const auto now = std::chrono::steady_clock::now();
+    if (depth == 1) {
+      inline_continuation_start = now;
+    } else if (now - inline_continuation_start >
+               std::chrono::nanoseconds(inline_continuation_time_budget_ns.load(
+                   std::memory_order_relaxed))) {
+      return false;
+    }
+  }
+  inline_continuation_depth = depth + 1;
+  return true;
+}
+
+void internal::InlineContinuationScope::Exit() { --inline_continuation_depth; }
+
 void Await(const ExecutionContext& exec_ctx,
            ArrayRef<RCReference<AsyncValue>> values) {
   exec_ctx.work_queue().Await(values);
@@ -31,14 +104,65 @@ void Await(const ExecutionContext& exec_ctx,
 void EnqueueWork(const ExecutionContext& exec_ctx,
                  llvm::unique_function<void()> work) {
   auto& work_queue = exec_ctx.work_queue();
-  work_queue.AddTask(exec_ctx, TaskFunction(std::move(work)));
+  work_queue.AddTask(exec_ctx,
+                     TaskFunction(TraceWork(exec_ctx, std::move(work))));
+}
+
+void EnqueueWorkNear(const ExecutionContext& exec_ctx, const void* data,
+                     llvm::unique_function<void()> work) {
+  auto& work_queue = exec_ctx.work_queue();
+  work_queue.AddTaskNear(exec_ctx, data,
+                         TaskFunction(TraceWork(exec_ctx, std::move(work))));
+}
+
+// Runs the closures [begin, end) of `work`, see EnqueueWorkBatch().
+static void RunWorkBatch(
+    const ExecutionContext& exec_ctx,
+    std::shared_ptr<std::vector<llvm::unique_function<void()>>> work,
+    size_t begin, size_t end, std::chrono::nanoseconds time_budget) {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point deadline = Clock::now() + time_budget;
+  while (begin < end) {
+    auto& closure = (*work)[begin++];
+    closure();
+    // Release the captures as soon as the closure has run.
+    closure = nullptr;
+    if (begin == end || Clock::now() < deadline) continue;
+
+    // The budget is spent, so hand off half of the remaining closures, and
+    // continue with the other half and a new budget.
+    if (end - begin > 1) {
+      const size_t mid = begin + (end - begin) / 2;
+      EnqueueWork(exec_ctx, [exec_ctx, work, mid, end, time_budget] {
+        RunWorkBatch(exec_ctx, work, mid, end, time_budget);
+      });
+      end = mid;
+    }
+    deadline = Clock::now() + time_budget;
+  }
+}
+
+void EnqueueWorkBatch(const ExecutionContext& exec_ctx,
+                      std::vector<llvm::unique_function<void()>> work,
+                      std::chrono::nanoseconds time_budget) {
+  if (work.empty()) return;
+  if (work.size() == 1) return EnqueueWork(exec_ctx, std::move(work[0]));
+  auto shared_work =
+      std::make_shared<std::vector<llvm::unique_function<void()>>>(
+          std::move(work));
+  const size_t size = shared_work->size();
+  EnqueueWork(exec_ctx, [exec_ctx, work = std::move(shared_work), size,
+                         time_budget] {
+    RunWorkBatch(exec_ctx, work, 0, size, time_budget);
+  });
 }
 
 bool EnqueueBlockingWork(const ExecutionContext& exec_ctx,
                          llvm::unique_function<void()> work) {
   auto& work_queue = exec_ctx.work_queue();
   Optional<TaskFunction> task = work_queue.AddBlockingTask(
-      exec_ctx, TaskFunction(std::move(work)), /*allow_queuing=*/true);
+      exec_ctx, TaskFunction(TraceWork(exec_ctx, std::move(work))),
+      /*allow_queuing=*/true);
   return !task.hasValue();
 }
 
@@ -46,7 +170,8 @@ bool RunBlockingWork(const ExecutionContext& exec_ctx,
                      llvm::unique_function<void()> work) {
   auto& work_queue = exec_ctx.work_queue();
   Optional<TaskFunction> task = work_queue.AddBlockingTask(
-      exec_ctx, TaskFunction(std::move(work)), /*allow_queuing=*/false);
+      exec_ctx, TaskFunction(TraceWork(exec_ctx, std::move(work))),
+      /*allow_queuing=*/false);
   return !task.hasValue();
 }
 
@@ -91,6 +216,15 @@ void RunWhenReady(ArrayRef<AsyncValue*> values,
   }
 
   struct CounterAndCallee {
+    // The counters are recycled through a thread-local free list, so that
+    // repeated waits do not allocate.
+    static void* operator new(size_t size) {
+      return ThreadLocalFreeList<CounterAndCallee>::Allocate(size);
+    }
+    static void operator delete(void* ptr) {
+      ThreadLocalFreeList<CounterAndCallee>::Deallocate(ptr);
+    }
+
     std::atomic<size_t> counter;
     llvm::unique_function<void()> callee;
   };
@@ -103,7 +237,7 @@ void RunWhenReady(ArrayRef<AsyncValue*> values,
   for (auto* val : unavailable_values) {
     val->AndThen([data]() {
       // Decrement the counter unless we're the last to be here.
-      if (data->counter.fetch_sub(1) != 1) return;
+      if (data->counter.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
 
       // If we are the last one, then run the callee and free the data.
       data->callee();
@@ -122,4 +256,43 @@ void RunWhenReady(ArrayRef<RCReference<AsyncValue>> values,
   RunWhenReady(values_ptr, std::move(callee));
 }
 
+void RunWhenReady(const ExecutionContext& exec_ctx,
+                  ArrayRef<AsyncValue*> values,
+                  llvm::unique_function<void()> callee) {
+  RunWhenReady(values, [exec_ctx, callee = std::move(callee)]() mutable {
+    RunInlineOrEnqueue(exec_ctx, std::move(callee));
+  });
+}
+
+void RunWhenReady(const ExecutionContext& exec_ctx,
+                  ArrayRef<RCReference<AsyncValue>> values,
+                  llvm::unique_function<void()> callee) {
+  RunWhenReady(values, [exec_ctx, callee = std::move(callee)]() mutable {
+    RunInlineOrEnqueue(exec_ctx, std::move(callee));
+  });
+}
+
+AsyncValueRef<Chain> WhenAllReady(HostContext* host,
+                                  ArrayRef<AsyncValue*> values) {
+  bool all_available = llvm::all_of(
+      values, [](const AsyncValue* value) { return value->IsAvailable(); });
+  if (all_available) return GetReadyChain(host);
+
+  auto chain = MakeConstructedAsyncValueRef<Chain>(host);
+  RunWhenReady(values, [chain = chain.CopyRef()]() mutable {
+    chain.SetStateConcrete();
+  });
+  return chain;
+}
+
+AsyncValueRef<Chain> WhenAllReady(HostContext* host,
+                                  ArrayRef<RCReference<AsyncValue>> values) {
+  auto mapped = llvm::map_range(
+      values, [](const RCReference<AsyncValue>& ref) -> AsyncValue* {
+        return ref.get();
+      });
+  SmallVector<AsyncValue*, 8> values_ptr(mapped.begin(), mapped.end());
+  return WhenAllReady(host, values_ptr);
+}
+
 }  // namespace tfrt
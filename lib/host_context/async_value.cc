@@ -21,6 +21,7 @@
 #include "tfrt/host_context/function.h"
 #include "tfrt/support/concurrent_vector.h"
 #include "tfrt/support/string_util.h"
+#include "tfrt/support/thread_local_free_list.h"
 
 namespace tfrt {
 
@@ -32,6 +33,17 @@ class NotifierListNode {
   explicit NotifierListNode(llvm::unique_function<void()> notification)
       : next_(nullptr), notification_(std::move(notification)) {}
 
+  // Nodes are usually freed by the thread that makes an AsyncValue available,
+  // which is likely to add the next waiters. They are recycled through a
+  // thread-local free list, so that waiting on an AsyncValue does not allocate
+  // in the steady state.
+  static void* operator new(size_t size) {
+    return ThreadLocalFreeList<NotifierListNode>::Allocate(size);
+  }
+  static void operator delete(void* ptr) {
+    ThreadLocalFreeList<NotifierListNode>::Deallocate(ptr);
+  }
+
  private:
   friend class AsyncValue;
   // This is the next thing waiting on the AsyncValue.
@@ -16,22 +16,32 @@
 
 // Control dependence representation
 //
-// This file implements GetReadyChain(), a free function version of the
-// ReadyChain method to get an AsyncValueRef to a Chain for the given
-// host.
+// This file implements GetReadyChain().
 //===----------------------------------------------------------------------===//
 
 #include "tfrt/host_context/chain.h"
 
 namespace tfrt {
 
+AsyncValueRef<Chain> GetReadyChain() {
+  static internal::ConcreteAsyncValue<Chain>* ready_chain =
+      new internal::ConcreteAsyncValue<Chain>(
+          internal::ConcreteAsyncValue<Chain>::UnRefCountedConcretePayload{});
+  return AsyncValueRef<Chain>(FormRef(ready_chain));
+}
+
 AsyncValueRef<Chain> GetReadyChain(HostContext* host) {
-  return ReadyChain::Get().GetReadyChain(host);
+  return GetReadyChain();
+}
+
+template <>
+AsyncValueRef<Chain> MakeAvailableAsyncValueRef<Chain>() {
+  return GetReadyChain();
 }
 
 template <>
 AsyncValueRef<Chain> MakeAvailableAsyncValueRef<Chain>(HostContext* host) {
-  return GetReadyChain(host);
+  return GetReadyChain();
 }
 
 }  // namespace tfrt
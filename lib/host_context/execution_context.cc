@@ -18,17 +18,30 @@
 
 #include "tfrt/host_context/execution_context.h"
 
+#include "llvm/ADT/STLExtras.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/memory_pressure.h"
+#include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
 
+constexpr RequestOptions::RequestPriority RequestOptions::kLowPriority;
+constexpr RequestOptions::RequestPriority RequestOptions::kDefaultPriority;
+constexpr RequestOptions::RequestPriority RequestOptions::kHighPriority;
+constexpr RequestOptions::RequestPriority RequestOptions::kCriticalPriority;
+
 RequestContext::~RequestContext() {
   if (auto cancel_value = GetCancelAsyncValue()) {
     cancel_value->DropRef();
   }
 }
 
+HostAllocator* RequestContext::allocator() const {
+  if (arena_allocator_) return arena_allocator_.get();
+  return host_->allocator();
+}
+
 void RequestContext::Cancel() {
   // Create an AsyncValue in error state for cancel.
   auto* error_value = MakeErrorAsyncValueRef(host_, "Cancelled").release();
@@ -42,15 +55,64 @@ void RequestContext::Cancel() {
                                              std::memory_order_release,
                                              std::memory_order_relaxed)) {
     error_value->DropRef();
+    return;
+  }
+
+  // Callbacks added from now on see the cancel value and run immediately, so
+  // the list can be taken out and run without holding the lock.
+  llvm::SmallVector<std::pair<CancelCallbackId, llvm::unique_function<void()>>,
+                    2>
+      callbacks;
+  {
+    mutex_lock lock(cancel_callbacks_mu_);
+    callbacks = std::move(cancel_callbacks_);
+    cancel_callbacks_.clear();
+  }
+  for (auto& callback : callbacks) callback.second();
+}
+
+RequestContext::CancelCallbackId RequestContext::AddCancelCallback(
+    llvm::unique_function<void()> callback) {
+  {
+    mutex_lock lock(cancel_callbacks_mu_);
+    if (!IsCancelled()) {
+      cancel_callbacks_.emplace_back(next_cancel_callback_id_,
+                                     std::move(callback));
+      return next_cancel_callback_id_++;
+    }
   }
+  callback();
+  return -1;
+}
+
+void RequestContext::RemoveCancelCallback(CancelCallbackId id) {
+  mutex_lock lock(cancel_callbacks_mu_);
+  auto it = llvm::find_if(cancel_callbacks_, [id](const auto& callback) {
+    return callback.first == id;
+  });
+  if (it != cancel_callbacks_.end()) cancel_callbacks_.erase(it);
 }
 
 Expected<RCReference<RequestContext>> RequestContextBuilder::build() && {
+  if (auto error = MemoryPressure::Get(host_).AdmitRequest(
+          id_, request_options_.priority))
+    return std::move(error);
+
   auto& cwq = host_->work_queue();
   if (auto error = cwq.InitRequest(this)) return std::move(error);
 
-  return TakeRef(new RequestContext(host_, resource_context_,
-                                    std::move(context_data_), id_));
+  RCReference<ArenaAllocator> arena_allocator;
+  if (arena_chunk_size_ > 0) {
+    arena_allocator =
+        TakeRef(new ArenaAllocator(host_->allocator(), arena_chunk_size_));
+  }
+
+  if (trace_id_ == 0 && tracing::IsTracingEnabled())
+    trace_id_ = tracing::NewTracingFlowId();
+
+  return TakeRef(new RequestContext(
+      host_, resource_context_, std::move(context_data_), id_,
+      request_options_, std::move(arena_allocator), trace_id_));
 };
 
 ExecutionContext::ExecutionContext(RCReference<RequestContext> req_ctx,
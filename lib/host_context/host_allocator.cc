@@ -37,10 +37,45 @@ class MallocAllocator : public HostAllocator {
   void DeallocateBytes(void* ptr, size_t size) override { free(ptr); }
 };
 
+class MemoryUsageTrackingAllocator : public HostAllocator {
+ public:
+  MemoryUsageTrackingAllocator(std::unique_ptr<HostAllocator> allocator,
+                               size_t bytes_limit)
+      : allocator_(std::move(allocator)), bytes_limit_(bytes_limit) {}
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    bytes_in_use_.fetch_add(size, std::memory_order_relaxed);
+    return allocator_->AllocateBytes(size, alignment);
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    bytes_in_use_.fetch_sub(size, std::memory_order_relaxed);
+    allocator_->DeallocateBytes(ptr, size);
+  }
+
+  Optional<MemoryUsage> GetMemoryUsage() const override {
+    MemoryUsage usage;
+    usage.bytes_in_use = bytes_in_use_.load(std::memory_order_relaxed);
+    usage.bytes_limit = bytes_limit_;
+    return usage;
+  }
+
+ private:
+  std::unique_ptr<HostAllocator> allocator_;
+  const size_t bytes_limit_;
+  std::atomic<size_t> bytes_in_use_{0};
+};
+
 void HostAllocator::VtableAnchor() {}
 
 std::unique_ptr<HostAllocator> CreateMallocAllocator() {
   return std::make_unique<MallocAllocator>();
 }
 
+std::unique_ptr<HostAllocator> CreateMemoryUsageTrackingAllocator(
+    std::unique_ptr<HostAllocator> allocator, size_t bytes_limit) {
+  return std::make_unique<MemoryUsageTrackingAllocator>(std::move(allocator),
+                                                        bytes_limit);
+}
+
 }  // namespace tfrt
@@ -22,6 +22,7 @@
 #include <cstdint>
 
 #include "llvm/Support/Format.h"
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_allocator.h"
 
 namespace tfrt {
@@ -66,6 +67,11 @@ RCReference<HostBuffer> HostBuffer::CreateUninitialized(
   return host_buffer;
 }
 
+RCReference<HostBuffer> HostBuffer::CreateUninitialized(
+    size_t size, size_t alignment, const ExecutionContext &exec_ctx) {
+  return CreateUninitialized(size, alignment, exec_ctx.allocator());
+}
+
 RCReference<HostBuffer> HostBuffer::CreateFromExternal(
     void *ptr, size_t size, Deallocator deallocator) {
   // Not allocated via HostAllocator as HostBuffer::CreateUninitialized.
@@ -19,6 +19,7 @@
 #include "tfrt/host_context/host_context.h"
 
 #include "llvm/Support/Error.h"
+#include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/function.h"
@@ -44,7 +45,6 @@ HostContext::HostContext(
       work_queue_(std::move(work_queue)),
       shared_context_mgr_(std::make_unique<SharedContextManager>(this)),
       instance_ptr_{HostContextPool::instance().AllocateForHostContext(this)} {
-  ReadyChain::Get().Construct(this);
   host_device_ =
       device_mgr_.MaybeAddDevice(MakeRef<CpuDevice>(host_device_name));
 }
@@ -56,17 +56,44 @@ HostContext::HostContext(
     : HostContext(std::move(diag_handler), std::move(allocator),
                   std::move(work_queue), kDefaultHostDeviceName) {}
 
+HostContext::HostContext(
+    std::function<void(const DecodedDiagnostic&)> diag_handler,
+    std::unique_ptr<HostAllocator> allocator,
+    const MultiThreadedWorkQueueOptions& work_queue_options)
+    : HostContext(std::move(diag_handler), std::move(allocator),
+                  CreateMultiThreadedWorkQueue(work_queue_options)) {}
+
 HostContext::~HostContext() {
   // Wait for the completion of all async tasks managed by this host context.
   Quiesce();
-  // We need to free the ready chain AsyncValue first, as the destructor of the
-  // AsyncValue calls the HostContext to free its memory.
-  ReadyChain::Get().Destruct(this);
   HostContextPool::instance().FreeHostContext(this);
 }
 
 void Function::VtableAnchor() {}
 
+void Function::ExecuteRepeatedly(
+    const ExecutionContext& exec_ctx, int32_t count,
+    ArrayRef<AsyncValue*> arguments,
+    MutableArrayRef<RCReference<AsyncValue>> results) const {
+  assert(count > 0);
+  assert(arguments.size() == results.size());
+
+  SmallVector<AsyncValue*, 4> iteration_arguments(arguments.begin(),
+                                                  arguments.end());
+  SmallVector<RCReference<AsyncValue>, 4> iteration_results;
+  iteration_results.resize(results.size());
+  for (int32_t i = 0; i < count; ++i) {
+    Execute(exec_ctx, iteration_arguments, results);
+    // The results of this iteration are the arguments of the next one.
+    for (size_t j = 0, e = results.size(); j != e; ++j) {
+      iteration_results[j] = std::move(results[j]);
+      iteration_arguments[j] = iteration_results[j].get();
+    }
+  }
+  for (size_t j = 0, e = results.size(); j != e; ++j)
+    results[j] = std::move(iteration_results[j]);
+}
+
 //===----------------------------------------------------------------------===//
 // Error Reporting
 //===----------------------------------------------------------------------===//
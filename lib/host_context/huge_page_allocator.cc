@@ -0,0 +1,177 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements a host allocator decorator that maps large allocations
+// in huge pages.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace tfrt {
+
+namespace {
+
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+constexpr size_t kGiantPageSize = 1024 * 1024 * 1024;
+
+// A region of mapped memory.
+struct Mapping {
+  void* ptr = nullptr;
+  size_t size = 0;
+};
+
+#if defined(__linux__)
+
+// Maps `size` bytes with explicit huge pages of `page_size` bytes from the
+// hugetlb pool. Returns a null mapping if the pool has no free pages.
+Mapping MapHugeTlbPages(size_t size, size_t page_size) {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+              (llvm::Log2_64(page_size) << MAP_HUGE_SHIFT);
+  size_t mapped_size = llvm::alignTo(size, page_size);
+  void* ptr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (ptr != MAP_FAILED) return {ptr, mapped_size};
+#endif
+  return {};
+}
+
+// Maps `size` bytes in a region aligned to kHugePageSize, which the kernel can
+// back with transparent huge pages.
+Mapping MapTransparentHugePages(size_t size, size_t alignment) {
+  size_t mapped_size = llvm::alignTo(size, kHugePageSize);
+  alignment = std::max(alignment, kHugePageSize);
+
+  // Map enough memory to align the region, then unmap the unaligned head and
+  // the unused tail.
+  size_t reserved_size = mapped_size + alignment;
+  void* reserved = mmap(nullptr, reserved_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (reserved == MAP_FAILED) return {};
+
+  auto begin = reinterpret_cast<uintptr_t>(reserved);
+  auto region = llvm::alignTo(begin, alignment);
+  if (region != begin) munmap(reserved, region - begin);
+  size_t tail_size = begin + reserved_size - (region + mapped_size);
+  if (tail_size != 0)
+    munmap(reinterpret_cast<void*>(region + mapped_size), tail_size);
+
+  AdviseHugePages(reinterpret_cast<void*>(region), mapped_size);
+  return {reinterpret_cast<void*>(region), mapped_size};
+}
+
+Mapping MapHugePages(size_t size, size_t alignment) {
+  // Explicit huge pages are aligned to their size.
+  for (size_t page_size : {kGiantPageSize, kHugePageSize}) {
+    if (size < page_size || alignment > page_size) continue;
+    Mapping mapping = MapHugeTlbPages(size, page_size);
+    if (mapping.ptr) return mapping;
+  }
+  return MapTransparentHugePages(size, alignment);
+}
+
+void UnmapHugePages(const Mapping& mapping) {
+  munmap(mapping.ptr, mapping.size);
+}
+
+#else   // !__linux__
+
+Mapping MapHugePages(size_t size, size_t alignment) { return {}; }
+
+void UnmapHugePages(const Mapping& mapping) {}
+
+#endif  // __linux__
+
+// HugePageAllocator maps allocations of at least `min_size_` bytes in huge
+// pages, and forwards all other allocations to the decorated allocator. The
+// size of each mapping is recorded, because it depends on the kind of huge
+// pages that were available when it was mapped.
+class HugePageAllocator : public HostAllocator {
+ public:
+  HugePageAllocator(std::unique_ptr<HostAllocator> allocator, size_t min_size)
+      : allocator_(std::move(allocator)), min_size_(min_size) {}
+
+  ~HugePageAllocator() override {
+    mutex_lock lock(mu_);
+    assert(mappings_.empty() && "huge page allocations were leaked");
+  }
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    if (size < min_size_) return allocator_->AllocateBytes(size, alignment);
+
+    Mapping mapping = MapHugePages(size, alignment);
+    if (!mapping.ptr) return allocator_->AllocateBytes(size, alignment);
+
+    mutex_lock lock(mu_);
+    mappings_.try_emplace(mapping.ptr, mapping.size);
+    return mapping.ptr;
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    if (size >= min_size_) {
+      Mapping mapping;
+      {
+        mutex_lock lock(mu_);
+        auto it = mappings_.find(ptr);
+        if (it != mappings_.end()) {
+          mapping = {ptr, it->second};
+          mappings_.erase(it);
+        }
+      }
+      if (mapping.ptr) return UnmapHugePages(mapping);
+    }
+    allocator_->DeallocateBytes(ptr, size);
+  }
+
+ private:
+  std::unique_ptr<HostAllocator> allocator_;
+  const size_t min_size_;
+
+  mutex mu_;
+  // The size of the mapping of each huge page allocation.
+  llvm::DenseMap<void*, size_t> mappings_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace
+
+std::unique_ptr<HostAllocator> CreateHugePageAllocator(
+    std::unique_ptr<HostAllocator> allocator, size_t min_size) {
+  return std::make_unique<HugePageAllocator>(std::move(allocator),
+                                             std::max<size_t>(min_size, 1));
+}
+
+void AdviseHugePages(void* ptr, size_t size) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  auto begin = llvm::alignTo(reinterpret_cast<uintptr_t>(ptr), kHugePageSize);
+  auto end = llvm::alignDown(reinterpret_cast<uintptr_t>(ptr) + size,
+                             kHugePageSize);
+  // This is only a hint, the memory is usable if it fails.
+  if (begin < end)
+    madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+#endif
+}
+
+}  // namespace tfrt
@@ -16,24 +16,166 @@
 
 #include "tfrt/host_context/kernel_registry.h"
 
+#include <algorithm>
+#include <atomic>
+#include <numeric>
 #include <vector>
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/xxhash.h"
+#include "tfrt/host_context/startup_profile.h"
 #include "tfrt/host_context/type_name.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/mutex.h"
+#include "tfrt/support/selective_registration.h"
+#include "tfrt/support/string_util.h"
 
 namespace tfrt {
 
 using llvm::StringMap;
 using llvm::StringSet;
 
+namespace {
+
+// Mix the hash of a kernel name with the seed of its bucket.
+uint64_t MixHash(uint64_t hash, uint64_t seed) {
+  uint64_t x = hash ^ (seed * 0x9e3779b97f4a7c15);
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccd;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53;
+  x ^= x >> 33;
+  return x;
+}
+
+// KernelSnapshot is a perfect hash table of kernel names, built with the
+// hash-and-displace method. Names are split into buckets by their hash, and
+// each bucket has a seed that maps all its names to distinct entries. A lookup
+// hashes the name once, and compares it with a single entry.
+class KernelSnapshot {
+ public:
+  // Return nullptr if no perfect hash is found, e.g. because two names have
+  // the same hash.
+  static std::unique_ptr<KernelSnapshot> Create(
+      const StringMap<KernelImplementation>& implementations);
+
+  // Return the kernel with `name`, or an empty KernelImplementation.
+  KernelImplementation Find(string_view name) const {
+    uint64_t hash = llvm::xxHash64(name);
+    uint64_t seed = seeds_[GetBucket(hash)];
+    const Entry& entry = entries_[MixHash(hash, seed) & entry_mask_];
+    return entry.name == name ? entry.implementation : KernelImplementation();
+  }
+
+ private:
+  // The seed is searched up to this value for each bucket.
+  static constexpr uint32_t kMaxSeed = 1 << 16;
+
+  struct Entry {
+    // The name is owned by the registry. Unused entries have an empty name.
+    string_view name;
+    KernelImplementation implementation;
+  };
+
+  size_t GetBucket(uint64_t hash) const { return (hash >> 32) & bucket_mask_; }
+
+  std::vector<uint32_t> seeds_;
+  std::vector<Entry> entries_;
+  size_t bucket_mask_ = 0;
+  size_t entry_mask_ = 0;
+};
+
+constexpr uint32_t KernelSnapshot::kMaxSeed;
+
+std::unique_ptr<KernelSnapshot> KernelSnapshot::Create(
+    const StringMap<KernelImplementation>& implementations) {
+  // About 4 names per bucket, and a load factor of at most 0.8. Both sizes are
+  // powers of two, so that lookups only mask the hash.
+  size_t num_kernels = implementations.size();
+  size_t num_buckets = llvm::PowerOf2Ceil(std::max<size_t>(num_kernels / 4, 1));
+  size_t num_entries = llvm::PowerOf2Ceil(num_kernels + num_kernels / 4 + 1);
+
+  auto snapshot = std::make_unique<KernelSnapshot>();
+  snapshot->seeds_.resize(num_buckets);
+  snapshot->entries_.resize(num_entries);
+  snapshot->bucket_mask_ = num_buckets - 1;
+  snapshot->entry_mask_ = num_entries - 1;
+
+  using Key = std::pair<uint64_t, const llvm::StringMapEntry<
+                                      KernelImplementation>*>;
+  std::vector<std::vector<Key>> buckets(num_buckets);
+  for (const auto& it : implementations) {
+    uint64_t hash = llvm::xxHash64(it.getKey());
+    buckets[snapshot->GetBucket(hash)].push_back({hash, &it});
+  }
+
+  // Place the largest buckets first, while most entries are free.
+  std::vector<size_t> order(num_buckets);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+
+  std::vector<bool> used(num_entries);
+  llvm::SmallVector<size_t, 8> slots;
+  for (size_t bucket_index : order) {
+    const std::vector<Key>& bucket = buckets[bucket_index];
+    if (bucket.empty()) break;
+
+    uint32_t seed = 0;
+    for (;; ++seed) {
+      if (seed == kMaxSeed) return nullptr;
+      slots.clear();
+      bool placed = llvm::all_of(bucket, [&](const Key& key) {
+        size_t slot = MixHash(key.first, seed) & snapshot->entry_mask_;
+        if (used[slot] || llvm::is_contained(slots, slot)) return false;
+        slots.push_back(slot);
+        return true;
+      });
+      if (placed) break;
+    }
+
+    snapshot->seeds_[bucket_index] = seed;
+    for (size_t i = 0; i < bucket.size(); ++i) {
+      used[slots[i]] = true;
+      snapshot->entries_[slots[i]] = {bucket[i].second->getKey(),
+                                      bucket[i].second->getValue()};
+    }
+  }
+  return snapshot;
+}
+
+}  // namespace
+
 struct KernelRegistry::Impl {
+  KernelImplementation Find(string_view kernel_name) const {
+    if (snapshot) return snapshot->Find(kernel_name);
+    auto it = implementations.find(kernel_name);
+    return it == implementations.end() ? KernelImplementation() : it->second;
+  }
+
   StringMap<KernelImplementation> implementations;
+  // The snapshot of `implementations` built by Freeze(), if any.
+  std::unique_ptr<KernelSnapshot> snapshot;
+  StringMap<NativeObjectLoader> native_object_loaders;
   StringSet<> type_names TFRT_GUARDED_BY(mu);
   mutex mu;
+
+  struct DeferredFamily {
+    std::string prefix;
+    KernelRegistration registration;
+  };
+  // The families that are registered on the first lookup of their kernels.
+  // Lookups take `deferred_mu` while `has_deferred_families` is true, because
+  // registering a family adds to `implementations`.
+  std::vector<DeferredFamily> deferred_families TFRT_GUARDED_BY(deferred_mu);
+  std::atomic<bool> has_deferred_families{false};
+  mutex deferred_mu;
 };
 
 KernelRegistry::KernelRegistry() : impl_(std::make_unique<Impl>()) {}
@@ -42,26 +184,82 @@ KernelRegistry::~KernelRegistry() {}
 
 void KernelRegistry::AddKernel(string_view kernel_name,
                                AsyncKernelImplementation fn) {
+  if (!ShouldRegisterKernel(kernel_name)) return;
   bool added =
       impl_->implementations.try_emplace(kernel_name, KernelImplementation{fn})
           .second;
   (void)added;
   assert(added && "Re-registered existing kernel_name for async kernel");
+  impl_->snapshot.reset();
 }
 
 void KernelRegistry::AddSyncKernel(string_view kernel_name,
                                    SyncKernelImplementation fn) {
+  if (!ShouldRegisterKernel(kernel_name)) return;
   bool added =
       impl_->implementations.try_emplace(kernel_name, KernelImplementation{fn})
           .second;
   (void)added;
   assert(added && "Re-registered existing kernel_name for sync kernel");
+  impl_->snapshot.reset();
 }
 
 KernelImplementation KernelRegistry::GetKernel(string_view kernel_name) const {
-  auto it = impl_->implementations.find(kernel_name);
-  return it == impl_->implementations.end() ? KernelImplementation()
-                                            : it->second;
+  if (!impl_->has_deferred_families.load(std::memory_order_acquire))
+    return impl_->Find(kernel_name);
+
+  mutex_lock lock(impl_->deferred_mu);
+  auto kernel = impl_->Find(kernel_name);
+  if (!kernel.is<Monostate>()) return kernel;
+
+  // Move the families of the kernel to the end.
+  auto& families = impl_->deferred_families;
+  auto it = std::stable_partition(
+      families.begin(), families.end(), [&](const Impl::DeferredFamily& f) {
+        return !kernel_name.startswith(f.prefix);
+      });
+  if (it == families.end()) return kernel;
+
+  bool frozen = impl_->snapshot != nullptr;
+  // Registering a deferred family only adds kernels that were not found so
+  // far, so GetKernel() is still logically const.
+  auto* registry = const_cast<KernelRegistry*>(this);
+  for (auto family = it; family != families.end(); ++family) {
+    StartupPhase phase(StrCat("register kernel family ", family->prefix));
+    family->registration(registry);
+  }
+  families.erase(it, families.end());
+  if (frozen) registry->Freeze();
+  if (families.empty())
+    impl_->has_deferred_families.store(false, std::memory_order_release);
+  return impl_->Find(kernel_name);
+}
+
+void KernelRegistry::AddDeferredKernelFamily(string_view prefix,
+                                             KernelRegistration registration) {
+  mutex_lock lock(impl_->deferred_mu);
+  impl_->deferred_families.push_back({prefix.str(), registration});
+  impl_->has_deferred_families.store(true, std::memory_order_release);
+}
+
+void KernelRegistry::AddNativeObjectLoader(string_view kind,
+                                           NativeObjectLoader loader) {
+  // Kernel libraries that share a loader can all register it.
+  auto it = impl_->native_object_loaders.try_emplace(kind, loader).first;
+  (void)it;
+  assert(it->second == loader && "Re-registered a different native object "
+                                 "loader for an existing kind");
+}
+
+NativeObjectLoader KernelRegistry::GetNativeObjectLoader(
+    string_view kind) const {
+  auto it = impl_->native_object_loaders.find(kind);
+  return it == impl_->native_object_loaders.end() ? nullptr : it->second;
+}
+
+void KernelRegistry::Freeze() {
+  // Without a perfect hash, which is unlikely, lookups use the map.
+  impl_->snapshot = KernelSnapshot::Create(impl_->implementations);
 }
 
 TypeName KernelRegistry::GetType(string_view type_name) const {
@@ -70,19 +268,48 @@ TypeName KernelRegistry::GetType(string_view type_name) const {
   return TypeName(it->getKeyData());
 }
 
-static std::vector<KernelRegistration>* GetStaticKernelRegistrations() {
-  static std::vector<KernelRegistration>* ret =
-      new std::vector<KernelRegistration>;
+namespace {
+struct StaticKernelRegistration {
+  KernelRegistration func;
+  // Empty unless `func` registers a kernel family.
+  string_view family_prefix;
+};
+}  // namespace
+
+static std::vector<StaticKernelRegistration>* GetStaticKernelRegistrations() {
+  static std::vector<StaticKernelRegistration>* ret =
+      new std::vector<StaticKernelRegistration>;
   return ret;
 }
 
-void AddStaticKernelRegistration(KernelRegistration func) {
-  GetStaticKernelRegistrations()->push_back(func);
+static std::atomic<bool>* GetDeferStaticKernelFamilies() {
+  static std::atomic<bool>* ret = new std::atomic<bool>(false);
+  return ret;
+}
+
+void AddStaticKernelRegistration(KernelRegistration func,
+                                 string_view family_prefix) {
+  GetStaticKernelRegistrations()->push_back({func, family_prefix});
+}
+
+void SetDeferStaticKernelFamilies(bool defer) {
+  GetDeferStaticKernelFamilies()->store(defer);
 }
 
 void RegisterStaticKernels(KernelRegistry* kernel_reg) {
-  for (auto func : *GetStaticKernelRegistrations()) {
-    func(kernel_reg);
+  StartupPhase phase("register static kernels");
+  const bool defer = GetDeferStaticKernelFamilies()->load();
+  for (const auto& registration : *GetStaticKernelRegistrations()) {
+    // Skip the families that selective registration would drop entirely.
+    if (!registration.family_prefix.empty() &&
+        !ShouldRegisterKernelFamily(registration.family_prefix))
+      continue;
+    if (defer && !registration.family_prefix.empty()) {
+      kernel_reg->AddDeferredKernelFamily(registration.family_prefix,
+                                          registration.func);
+    } else {
+      registration.func(kernel_reg);
+    }
   }
 }
 
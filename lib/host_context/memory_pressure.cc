@@ -0,0 +1,89 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements MemoryPressure.
+
+#include "tfrt/host_context/memory_pressure.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+
+MemoryPressure::MemoryPressure(HostContext* host) {
+  AddSource([host] { return host->allocator()->GetMemoryUsage(); });
+}
+
+void MemoryPressure::AddSource(UsageFn usage_fn) {
+  mutex_lock lock(mu_);
+  sources_.push_back(std::move(usage_fn));
+}
+
+void MemoryPressure::SetWatermarks(double low, double high) {
+  assert(0 < low && low <= high && "invalid watermarks");
+  mutex_lock lock(mu_);
+  low_watermark_ = low;
+  high_watermark_ = high;
+}
+
+double MemoryPressure::GetPressure() const {
+  mutex_lock lock(mu_);
+  double pressure = 0;
+  for (const auto& source : sources_) {
+    auto usage = source();
+    if (!usage || usage->bytes_limit == 0) continue;
+    pressure = std::max(pressure, static_cast<double>(usage->bytes_in_use) /
+                                      usage->bytes_limit);
+  }
+  return pressure;
+}
+
+Error MemoryPressure::AdmitRequest(
+    int64_t id, RequestOptions::RequestPriority priority) const {
+  if (priority >= RequestOptions::kCriticalPriority) return Error::success();
+  double pressure = GetPressure();
+  double watermark;
+  {
+    mutex_lock lock(mu_);
+    if (pressure >= high_watermark_) {
+      watermark = high_watermark_;
+    } else if (pressure >= low_watermark_ &&
+               priority < RequestOptions::kDefaultPriority) {
+      watermark = low_watermark_;
+    } else {
+      return Error::success();
+    }
+  }
+  return llvm::make_error<ResourceExhaustedErrorInfo>(
+      StrCat("Request ", id, " with priority ", priority,
+             " rejected: memory usage is at ", static_cast<int>(pressure * 100),
+             "% of the limit, above the watermark of ",
+             static_cast<int>(watermark * 100), "%"));
+}
+
+size_t MemoryPressure::LimitBufferSize(size_t size) const {
+  double pressure = GetPressure();
+  mutex_lock lock(mu_);
+  if (pressure < low_watermark_) return size;
+  if (pressure >= high_watermark_) return 0;
+  // Shrink linearly between the watermarks.
+  double fraction =
+      (high_watermark_ - pressure) / (high_watermark_ - low_watermark_);
+  return static_cast<size_t>(size * fraction);
+}
+
+}  // namespace tfrt
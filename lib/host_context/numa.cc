@@ -0,0 +1,182 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the NUMA topology discovery, thread binding and the
+// NUMA allocator.
+
+#include "tfrt/host_context/numa.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "tfrt/host_context/host_allocator.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace tfrt {
+
+namespace {
+
+// The id of the node the current thread is bound to, or -1.
+thread_local int current_numa_node = -1;
+
+#if defined(__linux__)
+// Read the nodes that have CPUs from sysfs.
+std::vector<NumaTopology::Node> ReadSysfsNodes() {
+  std::vector<NumaTopology::Node> nodes;
+  std::ifstream online("/sys/devices/system/node/online");
+  std::string line;
+  if (!std::getline(online, line)) return nodes;
+
+  std::vector<int> node_ids;
+  if (!ParseCpuList(line, &node_ids)) return nodes;
+  for (int id : node_ids) {
+    std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(id) +
+                          "/cpulist");
+    NumaTopology::Node node{id, {}};
+    if (!std::getline(cpulist, line) || !ParseCpuList(line, &node.cpus))
+      return {};
+    if (!node.cpus.empty()) nodes.push_back(std::move(node));
+  }
+  return nodes;
+}
+#endif  // __linux__
+
+std::vector<NumaTopology::Node> DiscoverNodes() {
+  std::vector<NumaTopology::Node> nodes;
+#if defined(__linux__)
+  nodes = ReadSysfsNodes();
+#endif
+  if (nodes.empty()) {
+    NumaTopology::Node node{0, {}};
+    int num_cpus = std::max(std::thread::hardware_concurrency(), 1u);
+    for (int cpu = 0; cpu < num_cpus; ++cpu) node.cpus.push_back(cpu);
+    nodes.push_back(std::move(node));
+  }
+  return nodes;
+}
+
+// NumaAllocator forwards allocations to the allocator of the node of the
+// calling thread.
+class NumaAllocator : public HostAllocator {
+ public:
+  NumaAllocator(std::function<std::unique_ptr<HostAllocator>()> make_allocator,
+                const NumaTopology& topology)
+      : topology_(topology) {
+    for (int i = 0; i < topology_.num_nodes(); ++i)
+      allocators_.push_back(make_allocator());
+  }
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    return GetLocalAllocator()->AllocateBytes(size, alignment);
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    GetLocalAllocator()->DeallocateBytes(ptr, size);
+  }
+
+ private:
+  HostAllocator* GetLocalAllocator() {
+    int index = topology_.GetNodeIndex(GetCurrentNumaNode());
+    return allocators_[std::max(index, 0)].get();
+  }
+
+  const NumaTopology topology_;
+  std::vector<std::unique_ptr<HostAllocator>> allocators_;
+};
+
+}  // namespace
+
+const NumaTopology& NumaTopology::Get() {
+  static const NumaTopology* topology = new NumaTopology(DiscoverNodes());
+  return *topology;
+}
+
+NumaTopology::NumaTopology(std::vector<Node> nodes) : nodes_(std::move(nodes)) {
+  assert(!nodes_.empty());
+}
+
+int NumaTopology::GetNodeIndex(int id) const {
+  for (int i = 0, e = nodes_.size(); i != e; ++i) {
+    if (nodes_[i].id == id) return i;
+  }
+  return -1;
+}
+
+void BindCurrentThreadToNumaNode(const NumaTopology::Node& node) {
+#if defined(__linux__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : node.cpus) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &cpu_set);
+  }
+  // Affinity is only a performance hint, the thread is usable if it fails.
+  sched_setaffinity(/*pid=*/0, sizeof(cpu_set), &cpu_set);
+#endif  // __linux__
+  current_numa_node = node.id;
+}
+
+int GetCurrentNumaNode() { return current_numa_node; }
+
+bool ParseCpuList(string_view list, std::vector<int>* cpus) {
+  llvm::SmallVector<llvm::StringRef, 4> ranges;
+  list.trim().split(ranges, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  for (llvm::StringRef range : ranges) {
+    llvm::StringRef first, last;
+    std::tie(first, last) = range.split('-');
+    int begin, end;
+    if (first.getAsInteger(10, begin)) return false;
+    if (last.empty()) {
+      end = begin;
+    } else if (last.getAsInteger(10, end) || end < begin) {
+      return false;
+    }
+    for (int cpu = begin; cpu <= end; ++cpu) cpus->push_back(cpu);
+  }
+  return true;
+}
+
+int GetNumaNodeOfAddress(const void* ptr) {
+#if defined(__linux__) && defined(SYS_move_pages)
+  // move_pages() without target nodes queries the node of each page, without
+  // faulting in pages that are not present.
+  auto page_mask = ~static_cast<uintptr_t>(sysconf(_SC_PAGESIZE) - 1);
+  void* page = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(ptr) &
+                                       page_mask);
+  int status = -1;
+  if (syscall(SYS_move_pages, /*pid=*/0, /*count=*/1UL, &page,
+              /*nodes=*/nullptr, &status, /*flags=*/0) != 0)
+    return -1;
+  return status >= 0 ? status : -1;
+#else   // !__linux__
+  return -1;
+#endif  // __linux__
+}
+
+std::unique_ptr<HostAllocator> CreateNumaAllocator(
+    std::function<std::unique_ptr<HostAllocator>()> make_allocator,
+    const NumaTopology& topology) {
+  return std::make_unique<NumaAllocator>(std::move(make_allocator), topology);
+}
+
+}  // namespace tfrt
@@ -0,0 +1,252 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements a work queue with a multi-threaded work queue for each
+// NUMA node.
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/numa.h"
+#include "tfrt/host_context/task_function.h"
+#include "tfrt/metrics/metrics.h"
+#include "tfrt/support/latch.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+
+namespace {
+
+// The histograms of the nodes chosen by each kind of placement decision.
+struct PlacementMetrics {
+  // The node holds the memory of the task.
+  metrics::Histogram* data;
+  // The node of the worker thread that adds the task.
+  metrics::Histogram* caller;
+  // The task is added by a thread that is not bound to a node.
+  metrics::Histogram* round_robin;
+};
+
+const PlacementMetrics& GetPlacementMetrics() {
+  static const PlacementMetrics* placement_metrics = [] {
+    std::vector<double> bounds;
+    for (const auto& node : NumaTopology::Get().nodes())
+      bounds.push_back(node.id);
+    auto buckets = metrics::Buckets::Explicit(std::move(bounds));
+    auto name = [](const char* kind) {
+      return StrCat("/tfrt/host_context/numa_work_queue/placement/", kind);
+    };
+    return new PlacementMetrics{
+        metrics::NewHistogram(name("data"), buckets),
+        metrics::NewHistogram(name("caller"), buckets),
+        metrics::NewHistogram(name("round_robin"), buckets)};
+  }();
+  return *placement_metrics;
+}
+
+// Counts a task from when it is added until its function is destroyed, after
+// it runs or when it is dropped.
+class PendingTask {
+ public:
+  explicit PendingTask(std::atomic<int>* num_pending_tasks)
+      : num_pending_tasks_(num_pending_tasks) {
+    num_pending_tasks_->fetch_add(1, std::memory_order_relaxed);
+  }
+  PendingTask(PendingTask&& other)
+      : num_pending_tasks_(other.num_pending_tasks_) {
+    other.num_pending_tasks_ = nullptr;
+  }
+  PendingTask& operator=(PendingTask&&) = delete;
+  ~PendingTask() {
+    if (num_pending_tasks_)
+      num_pending_tasks_->fetch_sub(1, std::memory_order_release);
+  }
+
+ private:
+  std::atomic<int>* num_pending_tasks_;
+};
+
+class NumaWorkQueue : public ConcurrentWorkQueue {
+ public:
+  NumaWorkQueue(const NumaTopology& topology, int num_threads_per_node,
+                int num_blocking_threads_per_node);
+  ~NumaWorkQueue() override;
+
+  std::string name() const override {
+    return StrCat("NUMA work queue (", topology_.num_nodes(), " nodes, ",
+                  num_threads_per_node_, " threads and ",
+                  num_blocking_threads_per_node_,
+                  " blocking threads per node)");
+  }
+
+  int GetParallelismLevel() const final {
+    return topology_.num_nodes() * num_threads_per_node_;
+  }
+
+  void AddTask(TaskFunction task) final;
+  void AddTaskNear(const ExecutionContext& exec_ctx, const void* data,
+                   TaskFunction task) final;
+  Optional<TaskFunction> AddBlockingTask(TaskFunction task,
+                                         bool allow_queuing) final;
+  void Quiesce() final;
+  void Await(ArrayRef<RCReference<AsyncValue>> values) final;
+
+  bool IsInWorkerThread() const final;
+
+ private:
+  // Return the index of the node of the calling worker thread, or -1 if it is
+  // not bound to a node of this work queue.
+  int GetCallerNodeIndex() const;
+
+  // Return the index of the node for a task added by the calling thread.
+  int PickNodeIndex();
+
+  void AddTaskToNode(int index, TaskFunction task);
+
+  const NumaTopology topology_;
+  const int num_threads_per_node_;
+  const int num_blocking_threads_per_node_;
+  const PlacementMetrics& metrics_;
+
+  std::vector<std::unique_ptr<ConcurrentWorkQueue>> work_queues_;
+  std::atomic<unsigned> next_node_index_{0};
+  std::atomic<int> num_pending_tasks_{0};
+};
+
+NumaWorkQueue::NumaWorkQueue(const NumaTopology& topology,
+                             int num_threads_per_node,
+                             int num_blocking_threads_per_node)
+    : topology_(topology),
+      num_threads_per_node_(num_threads_per_node),
+      num_blocking_threads_per_node_(num_blocking_threads_per_node),
+      metrics_(GetPlacementMetrics()) {
+  for (int i = 0; i < topology_.num_nodes(); ++i) {
+    work_queues_.push_back(CreateMultiThreadedWorkQueue(
+        num_threads_per_node, num_blocking_threads_per_node));
+  }
+}
+
+NumaWorkQueue::~NumaWorkQueue() {
+  // Pending tasks might add tasks to other nodes during destruction.
+  Quiesce();
+}
+
+int NumaWorkQueue::GetCallerNodeIndex() const {
+  int index = topology_.GetNodeIndex(GetCurrentNumaNode());
+  if (index < 0 || !work_queues_[index]->IsInWorkerThread()) return -1;
+  return index;
+}
+
+int NumaWorkQueue::PickNodeIndex() {
+  int index = GetCallerNodeIndex();
+  if (index >= 0) {
+    metrics_.caller->Record(topology_.nodes()[index].id);
+    return index;
+  }
+  index = next_node_index_.fetch_add(1, std::memory_order_relaxed) %
+          topology_.num_nodes();
+  metrics_.round_robin->Record(topology_.nodes()[index].id);
+  return index;
+}
+
+void NumaWorkQueue::AddTaskToNode(int index, TaskFunction task) {
+  ConcurrentWorkQueue* work_queue = work_queues_[index].get();
+  const NumaTopology::Node* node = &topology_.nodes()[index];
+  work_queue->AddTask(TaskFunction(
+      [work_queue, node, pending = PendingTask(&num_pending_tasks_),
+       task = std::move(task)]() mutable {
+        // Worker threads are bound to their node when they run their first
+        // task. A full queue runs the task in the calling thread, which is
+        // left alone.
+        if (GetCurrentNumaNode() != node->id && work_queue->IsInWorkerThread())
+          BindCurrentThreadToNumaNode(*node);
+        task();
+      }));
+}
+
+void NumaWorkQueue::AddTask(TaskFunction task) {
+  AddTaskToNode(PickNodeIndex(), std::move(task));
+}
+
+void NumaWorkQueue::AddTaskNear(const ExecutionContext& exec_ctx,
+                                const void* data, TaskFunction task) {
+  int index = topology_.GetNodeIndex(GetNumaNodeOfAddress(data));
+  if (index < 0) {
+    AddTask(std::move(task));
+    return;
+  }
+  metrics_.data->Record(topology_.nodes()[index].id);
+  AddTaskToNode(index, std::move(task));
+}
+
+Optional<TaskFunction> NumaWorkQueue::AddBlockingTask(TaskFunction task,
+                                                      bool allow_queuing) {
+  // Blocking threads mostly wait, so they are not bound to their node. The
+  // task is still counted, because it can add tasks to other nodes.
+  int index = GetCallerNodeIndex();
+  if (index < 0)
+    index = next_node_index_.fetch_add(1, std::memory_order_relaxed) %
+            topology_.num_nodes();
+  return work_queues_[index]->AddBlockingTask(
+      TaskFunction([pending = PendingTask(&num_pending_tasks_),
+                    task = std::move(task)]() mutable { task(); }),
+      allow_queuing);
+}
+
+void NumaWorkQueue::Quiesce() {
+  // Tasks of one node can add tasks to another node that has already been
+  // quiesced, so repeat until no task is pending.
+  do {
+    for (auto& work_queue : work_queues_) work_queue->Quiesce();
+  } while (num_pending_tasks_.load(std::memory_order_acquire) != 0);
+}
+
+void NumaWorkQueue::Await(ArrayRef<RCReference<AsyncValue>> values) {
+  assert(!IsInWorkerThread() &&
+         "NumaWorkQueue::Await must not be called from a worker thread");
+
+  // We are done when values_remaining drops to zero.
+  tfrt::latch values_remaining(values.size());
+
+  // As each value becomes available, we decrement the count.
+  for (auto& value : values) {
+    value->AndThen([&values_remaining]() { values_remaining.count_down(); });
+  }
+
+  // Wait until all values are resolved.
+  values_remaining.wait();
+}
+
+bool NumaWorkQueue::IsInWorkerThread() const {
+  for (auto& work_queue : work_queues_) {
+    if (work_queue->IsInWorkerThread()) return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+std::unique_ptr<ConcurrentWorkQueue> CreateNumaWorkQueue(
+    int num_threads_per_node, int num_blocking_threads_per_node,
+    const NumaTopology& topology) {
+  assert(num_threads_per_node > 0 && num_blocking_threads_per_node > 0);
+  return std::make_unique<NumaWorkQueue>(topology, num_threads_per_node,
+                                         num_blocking_threads_per_node);
+}
+
+}  // namespace tfrt
@@ -18,6 +18,9 @@
 
 #include "tfrt/host_context/parallel_for.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/host_context.h"
@@ -30,26 +33,117 @@ using BlockSizes = ParallelFor::BlockSizes;
 // BlockSizes configures how a range is split into blocks executed in parallel.
 //===----------------------------------------------------------------------===//
 
+namespace {
+
+// Do not create too many small blocks.
+constexpr size_t kMaxOversharding = 4;
+
+// The cost model constants are the ones of Eigen::TensorCostModel.
+//
+// The cycles per byte loaded from or stored to memory.
+constexpr double kLoadCycles = 11.0 / 64;
+constexpr double kStoreCycles = 11.0 / 64;
+// The cycles to start running a range in parallel, and for each thread that
+// runs a part of it.
+constexpr double kStartupCycles = 100000;
+constexpr double kPerThreadCycles = 100000;
+// The minimum number of cycles of a block to amortize the overhead of
+// enqueuing it as a task.
+constexpr double kTaskCycles = 40000;
+
+// Faster equivalent of `std::ceil((float) x / (float) y)`.
+size_t DivUp(const size_t x, const size_t y) {
+  assert(y > 0);
+  return (x + y - 1) / y;
+}
+
+// Splits input range to assign `kMaxOversharding` tasks to each worker thread.
+size_t GetDefaultBlockSize(size_t num_worker_threads, size_t total_size) {
+  return total_size / (kMaxOversharding * num_worker_threads);
+}
+
+// Return the fraction of the worker thread time that is used when `num_blocks`
+// blocks of equal cost run on `num_worker_threads` threads.
+double GetEfficiency(size_t num_blocks, size_t num_worker_threads) {
+  return static_cast<double>(num_blocks) /
+         (DivUp(num_blocks, num_worker_threads) * num_worker_threads);
+}
+
+// This is the block size computation of Eigen's ThreadPoolDevice::parallelFor.
+size_t GetCostBlockSize(const ParallelFor::Cost& cost,
+                        size_t num_worker_threads, size_t total_size) {
+  const double element_cycles = std::max(cost.TotalCycles(), 1e-3);
+  const double total_cycles = element_cycles * total_size;
+
+  // Run cheap ranges in the caller thread.
+  const double max_threads =
+      (total_cycles - kStartupCycles) / kPerThreadCycles + 0.9;
+  if (max_threads < 2) return total_size;
+  num_worker_threads =
+      std::min(num_worker_threads, static_cast<size_t>(max_threads));
+
+  // Make blocks large enough to amortize the task overhead, and no more than
+  // kMaxOversharding per worker thread.
+  const double min_block_size = std::ceil(kTaskCycles / element_cycles);
+  if (min_block_size >= total_size) return total_size;
+  size_t block_size =
+      std::max(DivUp(total_size, kMaxOversharding * num_worker_threads),
+               static_cast<size_t>(min_block_size));
+
+  // Coarsen the blocks, up to twice their size, while this does not decrease
+  // the fraction of threads that are busy until the last block completes.
+  const size_t max_block_size = std::min(total_size, 2 * block_size);
+  size_t num_blocks = DivUp(total_size, block_size);
+  double max_efficiency = GetEfficiency(num_blocks, num_worker_threads);
+  for (size_t prev_num_blocks = num_blocks;
+       max_efficiency < 1.0 && prev_num_blocks > 1;) {
+    const size_t coarser_block_size = DivUp(total_size, prev_num_blocks - 1);
+    if (coarser_block_size > max_block_size) break;
+    const size_t coarser_num_blocks = DivUp(total_size, coarser_block_size);
+    prev_num_blocks = coarser_num_blocks;
+    const double coarser_efficiency =
+        GetEfficiency(coarser_num_blocks, num_worker_threads);
+    // Prefer fewer blocks if the efficiency is about the same.
+    if (coarser_efficiency + 0.01 >= max_efficiency) {
+      block_size = coarser_block_size;
+      max_efficiency = std::max(max_efficiency, coarser_efficiency);
+    }
+  }
+  return block_size;
+}
+
+}  // namespace
+
+double ParallelFor::Cost::TotalCycles() const {
+  return bytes_loaded * kLoadCycles + bytes_stored * kStoreCycles +
+         compute_cycles;
+}
+
 BlockSizes ParallelFor::BlockSizes::Fixed(size_t n) {
-  return BlockSizes([n](size_t) { return n; });
+  return BlockSizes([n](size_t, size_t) { return n; });
 }
 
 BlockSizes ParallelFor::BlockSizes::Min(size_t min) {
-  return BlockSizes(
-      [min](size_t block_size) { return std::max(min, block_size); });
+  return BlockSizes([min](size_t num_worker_threads, size_t total_size) {
+    return std::max(min, GetDefaultBlockSize(num_worker_threads, total_size));
+  });
+}
+
+BlockSizes ParallelFor::BlockSizes::FromCost(Cost cost) {
+  return BlockSizes([cost](size_t num_worker_threads, size_t total_size) {
+    return GetCostBlockSize(cost, num_worker_threads, total_size);
+  });
 }
 
 size_t ParallelFor::BlockSizes::GetBlockSize(size_t num_worker_threads,
                                              size_t total_size) const {
-  // Do not create too many small blocks.
-  static constexpr size_t kMaxOversharding = 4;
-
-  // Split input range to assign `kMaxOversharding` tasks to each worker thread.
   assert(total_size > 0 && "Illegal total size");
-  size_t block_size = total_size / (kMaxOversharding * num_worker_threads);
+  num_worker_threads = std::max<size_t>(num_worker_threads, 1);
 
   // Compute final block sizes using implementation function if it is specified.
-  if (impl_) block_size = impl_(block_size);
+  size_t block_size =
+      impl_ ? impl_(num_worker_threads, total_size)
+            : GetDefaultBlockSize(num_worker_threads, total_size);
   assert(block_size >= 0 && "Illegal block size");
   block_size = std::min(block_size, total_size);
 
@@ -118,12 +212,6 @@ class ParallelForExecutionContext {
 
   ~ParallelForExecutionContext() { on_done_(); }
 
-  // Faster equivalent of `std::ceil((float) x / (float) y)`.
-  static size_t DivUp(const size_t x, const size_t y) {
-    assert(y > 0);
-    return (x + y - 1) / y;
-  }
-
   ExecutionContext exec_ctx_;  // The data in exec_ctx_ must stay alive before
                                // the `on_done` is called
 
@@ -167,8 +255,21 @@ AsyncValueRef<Chain> ParallelFor::Execute(
     size_t total_size, const BlockSizes& block_sizes,
     llvm::unique_function<void(size_t, size_t)> compute) const {
   auto chain = MakeConstructedAsyncValueRef<Chain>(exec_ctx_.host());
-  Execute(total_size, block_sizes, std::move(compute),
-          [chain = chain.CopyRef()]() { chain.SetStateConcrete(); });
+  // Nobody waits for the results of a cancelled request, so the remaining
+  // blocks are skipped and the chain carries the cancellation error instead.
+  Execute(
+      total_size, block_sizes,
+      [exec_ctx = exec_ctx_, compute = std::move(compute)](size_t start,
+                                                           size_t end) mutable {
+        if (!exec_ctx.IsCancelled()) compute(start, end);
+      },
+      [exec_ctx = exec_ctx_, chain = chain.CopyRef()]() {
+        if (auto* cancelled = exec_ctx.GetCancelAsyncValue()) {
+          chain.SetError(cancelled->GetError());
+        } else {
+          chain.SetStateConcrete();
+        }
+      });
   return chain;
 }
 
@@ -15,15 +15,26 @@
 //===- profiled_allocator.cc - Profiled Memory Allocator ------------------===//
 //
 // This file implements a profiling host memory allocator that does a memory
-// leak check and prints allocation statistics when destroyed.
+// leak check and prints allocation statistics when destroyed, and optionally
+// samples allocations for heap profiles.
 
 #include "tfrt/host_context/profiled_allocator.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/raw_ostream.h"
 #include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
 
@@ -38,12 +49,149 @@ void AtomicUpdateMax(T const& value, std::atomic<T>* max_value) noexcept {
   }
 }
 
+// Minimal writer of the protocol buffer wire format, enough for the pprof
+// profile.proto.
+class ProtoWriter {
+ public:
+  void AddVarint(int field, uint64_t value) {
+    AppendVarint(field << 3);
+    AppendVarint(value);
+  }
+
+  void AddBytes(int field, string_view bytes) {
+    AppendVarint(field << 3 | 2);
+    AppendVarint(bytes.size());
+    buffer_.append(bytes.begin(), bytes.end());
+  }
+
+  void AddMessage(int field, const ProtoWriter& message) {
+    AddBytes(field, message.buffer_);
+  }
+
+  const std::string& buffer() const { return buffer_; }
+
+ private:
+  void AppendVarint(uint64_t value) {
+    for (; value >= 0x80; value >>= 7)
+      buffer_.push_back(static_cast<char>(value | 0x80));
+    buffer_.push_back(static_cast<char>(value));
+  }
+
+  std::string buffer_;
+};
+
+// The allocation statistics of a site, scaled by the inverse of the sampling
+// probability.
+struct SiteStats {
+  double alloc_objects = 0;
+  double alloc_bytes = 0;
+  double inuse_objects = 0;
+  double inuse_bytes = 0;
+};
+
+// Samples allocations with a probability proportional to their size, and
+// always samples allocations of at least `period` bytes.
+//
+// Whether an allocation is sampled is a function of its address and size, so
+// that deallocations don't need to look up the address unless it is sampled.
+class HeapSampler {
+ public:
+  explicit HeapSampler(uint64_t period);
+  ~HeapSampler();
+
+  uint64_t period() const { return period_; }
+
+  bool IsSampled(void* ptr, size_t size) const {
+    // Fibonacci hashing spreads the aligned addresses over the upper bits.
+    uint64_t hash = reinterpret_cast<uintptr_t>(ptr) * 0x9E3779B97F4A7C15ull;
+    return (hash >> 24) % period_ < size;
+  }
+
+  void RecordAllocation(void* ptr, size_t size) {
+    const double weight = GetWeight(size);
+    mutex_lock lock(mu_);
+    auto& site =
+        *sites_.try_emplace(AllocationSiteScope::GetCurrentSite()).first;
+    site.second.alloc_objects += weight;
+    site.second.alloc_bytes += weight * size;
+    live_[ptr] = std::make_pair(&site, size);
+  }
+
+  void RecordDeallocation(void* ptr) {
+    mutex_lock lock(mu_);
+    live_.erase(ptr);
+  }
+
+  // Adds the statistics of the sampled allocations to `stats`.
+  void AddStats(llvm::StringMap<SiteStats>* stats) const;
+
+ private:
+  // Returns the number of allocations that a sample of `size` bytes stands
+  // for.
+  double GetWeight(size_t size) const {
+    return size >= period_ ? 1.0 : static_cast<double>(period_) / size;
+  }
+
+  const uint64_t period_;
+
+  mutable mutex mu_;
+  // The allocated objects and bytes of each site.
+  llvm::StringMap<SiteStats> sites_ TFRT_GUARDED_BY(mu_);
+  // The site and size of each live sampled allocation.
+  llvm::DenseMap<void*, std::pair<llvm::StringMapEntry<SiteStats>*, size_t>>
+      live_ TFRT_GUARDED_BY(mu_);
+};
+
+// The samplers of the alive profiled allocators.
+struct HeapSamplerRegistry {
+  mutex mu;
+  std::vector<const HeapSampler*> samplers TFRT_GUARDED_BY(mu);
+};
+
+HeapSamplerRegistry& GetHeapSamplerRegistry() {
+  static auto* registry = new HeapSamplerRegistry;
+  return *registry;
+}
+
+HeapSampler::HeapSampler(uint64_t period) : period_(period) {
+  auto& registry = GetHeapSamplerRegistry();
+  mutex_lock lock(registry.mu);
+  registry.samplers.push_back(this);
+}
+
+HeapSampler::~HeapSampler() {
+  auto& registry = GetHeapSamplerRegistry();
+  mutex_lock lock(registry.mu);
+  registry.samplers.erase(
+      std::find(registry.samplers.begin(), registry.samplers.end(), this));
+}
+
+void HeapSampler::AddStats(llvm::StringMap<SiteStats>* stats) const {
+  mutex_lock lock(mu_);
+  for (const auto& site : sites_) {
+    SiteStats& site_stats = (*stats)[site.getKey()];
+    site_stats.alloc_objects += site.second.alloc_objects;
+    site_stats.alloc_bytes += site.second.alloc_bytes;
+  }
+  for (const auto& pair : live_) {
+    SiteStats& site_stats = (*stats)[pair.second.first->getKey()];
+    const size_t size = pair.second.second;
+    const double weight = GetWeight(size);
+    site_stats.inuse_objects += weight;
+    site_stats.inuse_bytes += weight * size;
+  }
+}
+
 }  // namespace
 
 class ProfiledAllocator : public HostAllocator {
  public:
-  explicit ProfiledAllocator(std::unique_ptr<HostAllocator> allocator)
-      : allocator_(std::move(allocator)) {}
+  explicit ProfiledAllocator(std::unique_ptr<HostAllocator> allocator,
+                             size_t sample_period_bytes)
+      : allocator_(std::move(allocator)) {
+    if (sample_period_bytes > 0)
+      sampler_ = std::make_unique<HeapSampler>(sample_period_bytes);
+  }
 
   ~ProfiledAllocator() override {
     if (print_profile_) {
@@ -59,12 +207,18 @@ class ProfiledAllocator : public HostAllocator {
     AtomicUpdateMax<int64_t>(curr_num_bytes_allocated_,
                              &max_num_bytes_allocated_);
 
-    return allocator_->AllocateBytes(size, alignment);
+    void* ptr = allocator_->AllocateBytes(size, alignment);
+    if (sampler_ && ptr != nullptr && sampler_->IsSampled(ptr, size))
+      sampler_->RecordAllocation(ptr, size);
+    return ptr;
   }
 
   void DeallocateBytes(void* ptr, size_t size) override {
     --curr_num_allocations_;
     curr_num_bytes_allocated_.fetch_sub(size);
+    // Forget the sample before the address can be reused.
+    if (sampler_ && sampler_->IsSampled(ptr, size))
+      sampler_->RecordDeallocation(ptr);
 
     allocator_->DeallocateBytes(ptr, size);
   }
@@ -94,12 +248,14 @@ class ProfiledAllocator : public HostAllocator {
 
  private:
   std::unique_ptr<HostAllocator> allocator_;
+  std::unique_ptr<HeapSampler> sampler_;
 };
 
 class LeakCheckAllocator : public ProfiledAllocator {
  public:
-  explicit LeakCheckAllocator(std::unique_ptr<HostAllocator> allocator)
-      : ProfiledAllocator(std::move(allocator)) {
+  LeakCheckAllocator(std::unique_ptr<HostAllocator> allocator,
+                     size_t sample_period_bytes)
+      : ProfiledAllocator(std::move(allocator), sample_period_bytes) {
     print_profile_ = false;
   }
 
@@ -117,12 +273,91 @@ class LeakCheckAllocator : public ProfiledAllocator {
 };
 
 std::unique_ptr<HostAllocator> CreateProfiledAllocator(
-    std::unique_ptr<HostAllocator> allocator) {
-  return std::make_unique<ProfiledAllocator>(std::move(allocator));
+    std::unique_ptr<HostAllocator> allocator, size_t sample_period_bytes) {
+  return std::make_unique<ProfiledAllocator>(std::move(allocator),
+                                             sample_period_bytes);
 }
 
 std::unique_ptr<HostAllocator> CreateLeakCheckAllocator(
-    std::unique_ptr<HostAllocator> allocator) {
-  return std::make_unique<LeakCheckAllocator>(std::move(allocator));
+    std::unique_ptr<HostAllocator> allocator, size_t sample_period_bytes) {
+  return std::make_unique<LeakCheckAllocator>(std::move(allocator),
+                                              sample_period_bytes);
 }
+
+void WriteHeapProfile(raw_ostream& os) {
+  llvm::StringMap<SiteStats> stats;
+  uint64_t period = 0;
+  {
+    auto& registry = GetHeapSamplerRegistry();
+    mutex_lock lock(registry.mu);
+    for (const HeapSampler* sampler : registry.samplers) {
+      sampler->AddStats(&stats);
+      period = std::max(period, sampler->period());
+    }
+  }
+
+  // Sort the sites to make the profile deterministic.
+  std::vector<const llvm::StringMapEntry<SiteStats>*> sites;
+  for (const auto& site : stats) sites.push_back(&site);
+  std::sort(sites.begin(), sites.end(), [](const auto* lhs, const auto* rhs) {
+    return lhs->getKey() < rhs->getKey();
+  });
+
+  // The first entry of the string table must be empty.
+  std::vector<string_view> strings = {""};
+  auto add_string = [&](string_view string) -> uint64_t {
+    strings.push_back(string);
+    return strings.size() - 1;
+  };
+
+  ProtoWriter profile;
+  auto add_value_type = [&](int field, string_view type, string_view unit) {
+    ProtoWriter value_type;
+    value_type.AddVarint(1, add_string(type));
+    value_type.AddVarint(2, add_string(unit));
+    profile.AddMessage(field, value_type);
+  };
+  add_value_type(/*sample_type=*/1, "alloc_objects", "count");
+  add_value_type(/*sample_type=*/1, "alloc_space", "bytes");
+  add_value_type(/*sample_type=*/1, "inuse_objects", "count");
+  add_value_type(/*sample_type=*/1, "inuse_space", "bytes");
+  add_value_type(/*period_type=*/11, "space", "bytes");
+  profile.AddVarint(/*period=*/12, period);
+
+  // Each site is a sample with a single location and function.
+  for (size_t i = 0; i < sites.size(); ++i) {
+    const uint64_t id = i + 1;
+    const SiteStats& site_stats = sites[i]->second;
+
+    ProtoWriter sample;
+    sample.AddVarint(/*location_id=*/1, id);
+    for (double value :
+         {site_stats.alloc_objects, site_stats.alloc_bytes,
+          site_stats.inuse_objects, site_stats.inuse_bytes})
+      sample.AddVarint(/*value=*/2, std::llround(value));
+    profile.AddMessage(/*sample=*/2, sample);
+
+    ProtoWriter line;
+    line.AddVarint(/*function_id=*/1, id);
+    ProtoWriter location;
+    location.AddVarint(/*id=*/1, id);
+    location.AddMessage(/*line=*/4, line);
+    profile.AddMessage(/*location=*/4, location);
+
+    string_view name = sites[i]->getKey();
+    const uint64_t name_index =
+        add_string(name.empty() ? "[unattributed]" : name);
+    ProtoWriter function;
+    function.AddVarint(/*id=*/1, id);
+    function.AddVarint(/*name=*/2, name_index);
+    function.AddVarint(/*system_name=*/3, name_index);
+    profile.AddMessage(/*function=*/5, function);
+  }
+
+  for (string_view string : strings)
+    profile.AddBytes(/*string_table=*/6, string);
+
+  os << profile.buffer();
+}
+
 }  // namespace tfrt
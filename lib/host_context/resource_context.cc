@@ -0,0 +1,33 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements ResourceContext.
+
+#include "tfrt/host_context/resource_context.h"
+
+#include "tfrt/support/logging.h"
+
+namespace tfrt {
+
+constexpr int ResourceContext::kNumSlots;
+
+int ResourceContext::AllocateSlot() {
+  static std::atomic<int> next_slot{0};
+  int slot = next_slot.fetch_add(1, std::memory_order_relaxed);
+  if (slot >= kNumSlots)
+    TFRT_LOG(FATAL) << "All " << kNumSlots << " ResourceSlots are in use";
+  return slot;
+}
+
+}  // namespace tfrt
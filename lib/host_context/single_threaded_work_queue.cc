@@ -15,24 +15,37 @@
 // This file implements a single threaded work queue.
 
 #include <atomic>
-#include <vector>
+#include <chrono>
+#include <deque>
+#include <thread>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/None.h"
+#include "llvm/ADT/STLExtras.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/support/mpsc_queue.h"
 #include "tfrt/support/mutex.h"
 #include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
 namespace {
 
-// This class implements a work queue for single theaded clients. It spawn no
-// threads and performs no synchronization. The only thread used is the host
-// thread when it gets donated.
+// This class implements a work queue for single theaded clients. It spawns no
+// threads. The only thread used is the host thread when it gets donated in
+// Await() or Quiesce(), which we call the driver thread.
+//
+// Tasks added by the driver thread, i.e. by the tasks it runs, are appended to
+// a FIFO that only the driver thread accesses, without any synchronization.
+// Tasks added by other threads are pushed to a lock-free MPSC queue, from which
+// the driver moves them to the FIFO. The driver only takes a lock to sleep when
+// it has run out of tasks, after busy-polling for `spin_duration` if it is not
+// zero, and producers only take it to wake up a sleeping driver.
 class SingleThreadedWorkQueue : public ConcurrentWorkQueue {
  public:
-  SingleThreadedWorkQueue() : is_in_task_(false) {}
+  explicit SingleThreadedWorkQueue(std::chrono::nanoseconds spin_duration)
+      : spin_duration_(spin_duration), is_in_task_(false) {}
+  ~SingleThreadedWorkQueue() override;
 
   std::string name() const override { return "single-threaded"; }
 
@@ -53,31 +66,68 @@ class SingleThreadedWorkQueue : public ConcurrentWorkQueue {
   }
 
  private:
+  struct RemoteTask : MpscQueueNode {
+    explicit RemoteTask(TaskFunction work) : work(std::move(work)) {}
+    TaskFunction work;
+  };
+
+  void Enqueue(TaskFunction work);
+
+  // Runs tasks on the calling thread until `done` returns true, or until there
+  // are no tasks left if `wait_for_tasks` is false. If another thread is the
+  // driver, waits until `done` returns true or the other thread returns.
+  void Drive(llvm::function_ref<bool()> done, bool wait_for_tasks);
+
+  // Runs the next task on the driver thread. Returns false if there is none.
+  bool RunNextTask();
+
+  // Blocks until `ready` returns true. `ready` must only change from false to
+  // true before a call to Notify().
+  void Wait(llvm::function_ref<bool()> ready);
+
+  // Wakes up the threads blocked in Wait().
+  void Notify();
+
   void Execute(TaskFunction work) {
     is_in_task_ = true;
     work();
     is_in_task_ = false;
   }
 
-  // Current implementation uses a single mutex and condition_variable
-  // for all calls to Await(). This is sub-optimal when there are many
-  // outstanding calls to Await(). A more efficient, but more complex,
-  // implementation can create a condition variable per call to Await()
-  // and AddTask() can notify_one() on all of these condition variables.
-  mutable mutex mu_;
+  const std::chrono::nanoseconds spin_duration_;
+
+  // The thread that runs the tasks, or a default id if there is none.
+  std::atomic<std::thread::id> driver_{std::thread::id()};
+  // Tasks in the order they run. Only accessed by the driver thread.
+  std::deque<TaskFunction> local_tasks_;
+  // Tasks added by other threads than the driver thread.
+  MpscQueue<RemoteTask> remote_tasks_;
+
+  mutex mu_;
   condition_variable cv_;
-  std::vector<TaskFunction> work_items_ TFRT_GUARDED_BY(mu_);
+  // Number of threads in Wait(). Notify() only takes `mu_` if it is not zero.
+  std::atomic<int> num_waiters_{0};
+
   std::atomic<bool> is_in_task_;
 };
 }  // namespace
 
+SingleThreadedWorkQueue::~SingleThreadedWorkQueue() {
+  while (RemoteTask* task = remote_tasks_.Pop()) delete task;
+}
+
+void SingleThreadedWorkQueue::Enqueue(TaskFunction work) {
+  if (driver_.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+    local_tasks_.push_back(std::move(work));
+    return;
+  }
+  remote_tasks_.Push(new RemoteTask(std::move(work)));
+  Notify();
+}
+
 // Enqueue a block of work.
 void SingleThreadedWorkQueue::AddTask(TaskFunction work) {
-  {
-    mutex_lock l(mu_);
-    work_items_.push_back(std::move(work));
-  }
-  cv_.notify_all();
+  Enqueue(std::move(work));
 }
 
 // We put blocking tasks and non-blocking tasks in the same queue for
@@ -90,111 +140,111 @@ void SingleThreadedWorkQueue::AddTask(TaskFunction work) {
 Optional<TaskFunction> SingleThreadedWorkQueue::AddBlockingTask(
     TaskFunction work, bool allow_queuing) {
   if (!allow_queuing) return {std::move(work)};
-  {
-    mutex_lock l(mu_);
-    work_items_.push_back(std::move(work));
-  }
-  cv_.notify_all();
+  Enqueue(std::move(work));
   return llvm::None;
 }
 
+void SingleThreadedWorkQueue::Notify() {
+  // Pairs with the fence in Wait(): either the waiter sees the change of its
+  // condition, or we see the waiter and wake it up.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (num_waiters_.load(std::memory_order_relaxed) == 0) return;
+  // Taking the lock makes sure that the waiter either has not checked its
+  // condition yet or is blocked on `cv_`.
+  { mutex_lock l(mu_); }
+  cv_.notify_all();
+}
+
+void SingleThreadedWorkQueue::Wait(llvm::function_ref<bool()> ready) {
+  if (spin_duration_.count() > 0) {
+    auto deadline = std::chrono::steady_clock::now() + spin_duration_;
+    do {
+      if (ready()) return;
+    } while (std::chrono::steady_clock::now() < deadline);
+  }
+
+  mutex_lock l(mu_);
+  num_waiters_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  while (!ready()) cv_.wait(l);
+  num_waiters_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool SingleThreadedWorkQueue::RunNextTask() {
+  // Tasks from other threads run after the tasks that were added before they
+  // were seen by the driver thread.
+  while (RemoteTask* task = remote_tasks_.Pop()) {
+    local_tasks_.push_back(std::move(task->work));
+    delete task;
+  }
+  if (local_tasks_.empty()) return false;
+  TaskFunction work = std::move(local_tasks_.front());
+  local_tasks_.pop_front();
+  Execute(std::move(work));
+  return true;
+}
+
+void SingleThreadedWorkQueue::Drive(llvm::function_ref<bool()> done,
+                                    bool wait_for_tasks) {
+  const std::thread::id self = std::this_thread::get_id();
+  auto run_until_done = [&] {
+    while (!done()) {
+      if (RunNextTask()) continue;
+      if (!wait_for_tasks) return;
+      Wait([&] { return done() || !remote_tasks_.empty(); });
+    }
+  };
+
+  // Nested calls from the tasks keep running tasks on the driver thread.
+  if (driver_.load(std::memory_order_relaxed) == self) {
+    run_until_done();
+    return;
+  }
+
+  while (!done()) {
+    std::thread::id no_driver;
+    if (driver_.compare_exchange_strong(no_driver, self,
+                                        std::memory_order_acquire)) {
+      run_until_done();
+      driver_.store(std::thread::id(), std::memory_order_release);
+      // Another thread may be waiting to take over the remaining tasks.
+      Notify();
+      return;
+    }
+    // Another thread runs the tasks until it returns.
+    Wait([&] {
+      return done() ||
+             driver_.load(std::memory_order_acquire) == std::thread::id();
+    });
+  }
+}
+
 // Block until the system is quiescent (no pending work and no inflight work).
 // Because we are single threaded, we *have* to use the host thread to run
 // work - there is no one else to do it.
 void SingleThreadedWorkQueue::Quiesce() {
-  std::vector<TaskFunction> local_work_items;
-  while (true) {
-    // Work items can add new items to the vector, and we generally want to run
-    // things in order, so make sure we explicitly pop the item off before a new
-    // one is added.
-    {
-      mutex_lock l(mu_);
-      if (work_items_.empty()) break;
-      std::swap(local_work_items, work_items_);
-    }
-    for (auto& item : local_work_items) {
-      Execute(std::move(item));
-    }
-    local_work_items.clear();
-  }
+  Drive([] { return false; }, /*wait_for_tasks=*/false);
 }
 
 void SingleThreadedWorkQueue::Await(ArrayRef<RCReference<AsyncValue>> values) {
   // We are done when values_remaining drops to zero.
-  // Must be accessed while holding mu_. TFRT_GUARDED_BY does not work on local
-  // variables at this point.
-  int values_remaining = values.size();
+  std::atomic<int> values_remaining(values.size());
 
   // As each value becomes available, we can decrement our counts.
   for (auto& value : values) {
-    value->AndThen([this, &values_remaining]() mutable {
-      {
-        mutex_lock l(mu_);
-        --values_remaining;
-      }
-      cv_.notify_all();
+    value->AndThen([this, &values_remaining] {
+      if (values_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        Notify();
     });
   }
 
-  // Run work items until values_remaining drops to zero.
-  auto has_values = [this, &values_remaining]() mutable -> bool {
-    mutex_lock l(mu_);
-    return values_remaining != 0;
-  };
-
-  auto no_items_and_values_remaining = [this, &values_remaining]()
-                                           TFRT_REQUIRES(mu_) -> bool {
-    return values_remaining != 0 && work_items_.empty();
-  };
-
-  // Work items can add new items to the vector, and we generally want to run
-  // things in order, so make sure we explicitly pop the item off before a new
-  // one is added.
-  std::vector<TaskFunction> local_work_items;
-  int next_work_item_index = 0;
-
-  // Run until the values get resolved.
-  while (has_values()) {
-    // If we've processed everything in local_work_items, then grab another
-    // batch of stuff to do.  We're not done, so there must be more to do.
-    if (next_work_item_index == local_work_items.size()) {
-      local_work_items.clear();
-
-      {
-        mutex_lock l(mu_);
-        while (no_items_and_values_remaining()) {
-          cv_.wait(l);
-        }
-        if (values_remaining == 0) {
-          break;
-        }
-        std::swap(local_work_items, work_items_);
-      }
-      next_work_item_index = 0;
-    }
-
-    // Run the next work item.
-    Execute(std::move(local_work_items[next_work_item_index]));
-
-    // Move on to the next item.
-    ++next_work_item_index;
-  }
-
-  // When we resolve all the async values, we're done.  However, we could have
-  // one or more elements left in the local_work_items list.  If so,
-  // reconstruct the worklist in the right order (inserting local work items
-  // at the head of the remaining work to do).
-  if (next_work_item_index != local_work_items.size()) {
-    mutex_lock l(mu_);
-    work_items_.insert(work_items_.begin(),
-                       std::make_move_iterator(local_work_items.begin() +
-                                               next_work_item_index),
-                       std::make_move_iterator(local_work_items.end()));
-  }
+  Drive([&] { return values_remaining.load(std::memory_order_acquire) == 0; },
+        /*wait_for_tasks=*/true);
 }
 
-std::unique_ptr<ConcurrentWorkQueue> CreateSingleThreadedWorkQueue() {
-  return std::make_unique<SingleThreadedWorkQueue>();
+std::unique_ptr<ConcurrentWorkQueue> CreateSingleThreadedWorkQueue(
+    std::chrono::nanoseconds spin_duration) {
+  return std::make_unique<SingleThreadedWorkQueue>(spin_duration);
 }
 
 }  // namespace tfrt
@@ -0,0 +1,280 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements a host allocator that serves small allocations from
+// thread-local caches of size classes, and large allocations from huge page
+// backed regions.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/alloc.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/support/thread_local.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace tfrt {
+
+namespace {
+
+// Size classes are powers of two from kMinBlockSize to kMaxSmallSize.
+constexpr size_t kMinBlockSize = 64;
+constexpr size_t kMaxSmallSize = 32 * 1024;
+constexpr unsigned kNumSizeClasses = 10;
+static_assert(kMinBlockSize << (kNumSizeClasses - 1) == kMaxSmallSize,
+              "size classes must range from kMinBlockSize to kMaxSmallSize");
+
+// Slabs are aligned to their size, so that the slab of a block can be found by
+// masking its address. Each slab holds blocks of a single size class.
+constexpr size_t kSlabSize = 1024 * 1024;
+
+// The number of bytes moved at once between a thread cache and the central
+// free list of a size class. A thread cache holds up to twice as many.
+constexpr size_t kTransferBytes = 64 * 1024;
+
+// Allocations of at least kHugePageSize bytes are mapped in regions aligned to
+// kHugePageSize, which the kernel can back with transparent huge pages.
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+// The header at the start of each slab. It occupies the first block of the
+// slab.
+struct SlabHeader {
+  unsigned size_class;
+};
+static_assert(sizeof(SlabHeader) <= kMinBlockSize, "SlabHeader is too large");
+
+size_t GetBlockSize(unsigned size_class) { return kMinBlockSize << size_class; }
+
+unsigned GetSizeClass(size_t size) {
+  if (size <= kMinBlockSize) return 0;
+  return llvm::Log2_64_Ceil(size) - llvm::Log2_64(kMinBlockSize);
+}
+
+size_t GetBatchSize(unsigned size_class) {
+  return std::max<size_t>(kTransferBytes / GetBlockSize(size_class), 2);
+}
+
+// A free block, linked to the next free block of the same size class.
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+// A singly linked list of free blocks.
+struct FreeList {
+  void Push(void* ptr) {
+    auto* block = static_cast<FreeBlock*>(ptr);
+    block->next = head;
+    head = block;
+    ++size;
+  }
+
+  void* Pop() {
+    assert(head != nullptr);
+    FreeBlock* block = head;
+    head = block->next;
+    --size;
+    return block;
+  }
+
+  // Move up to `count` blocks to `other`. Return the number of moved blocks.
+  size_t MoveTo(FreeList* other, size_t count) {
+    size_t moved = 0;
+    for (; moved < count && head != nullptr; ++moved) other->Push(Pop());
+    return moved;
+  }
+
+  FreeBlock* head = nullptr;
+  size_t size = 0;
+};
+
+// The free lists of one thread. They are accessed without synchronization.
+struct ThreadCache {
+  FreeList free_lists[kNumSizeClasses];
+};
+
+void* AllocateHugePageRegion(size_t size, size_t alignment) {
+#if defined(__linux__)
+  size_t mapped_size = llvm::alignTo(size, kHugePageSize);
+  alignment = std::max(alignment, kHugePageSize);
+
+  // Map enough memory to align the region, then unmap the unaligned head and
+  // the unused tail.
+  size_t reserved_size = mapped_size + alignment;
+  void* reserved = mmap(nullptr, reserved_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (reserved == MAP_FAILED) return nullptr;
+
+  auto begin = reinterpret_cast<uintptr_t>(reserved);
+  auto region = llvm::alignTo(begin, alignment);
+  if (region != begin) munmap(reserved, region - begin);
+  size_t tail_size = begin + reserved_size - (region + mapped_size);
+  if (tail_size != 0)
+    munmap(reinterpret_cast<void*>(region + mapped_size), tail_size);
+
+#if defined(MADV_HUGEPAGE)
+  // This is only a hint, the region is usable if it fails.
+  madvise(reinterpret_cast<void*>(region), mapped_size, MADV_HUGEPAGE);
+#endif
+  return reinterpret_cast<void*>(region);
+#else   // !__linux__
+  return AlignedAlloc(alignment, size);
+#endif  // __linux__
+}
+
+void DeallocateHugePageRegion(void* ptr, size_t size) {
+#if defined(__linux__)
+  munmap(ptr, llvm::alignTo(size, kHugePageSize));
+#else   // !__linux__
+  free(ptr);
+#endif  // __linux__
+}
+
+}  // namespace
+
+// SlabAllocator serves allocations of up to kMaxSmallSize bytes from blocks
+// of power of two size classes. Blocks are carved from slabs, and are aligned
+// to their size. Each thread caches free blocks of each size class, so that
+// most allocations and deallocations do not synchronize with other threads.
+// Threads exchange blocks in batches through a central free list per size
+// class.
+//
+// Larger allocations are forwarded to malloc, except for those of at least
+// kHugePageSize bytes, which are mapped directly so that they can be backed by
+// huge pages.
+//
+// Slabs are only returned to the system when the allocator is destroyed.
+class SlabAllocator : public HostAllocator {
+ public:
+  SlabAllocator()
+      : thread_caches_(ThreadLocal<ThreadCache>::Capacity(
+            4 * std::max(std::thread::hardware_concurrency(), 1u))) {}
+
+  ~SlabAllocator() override {
+    mutex_lock lock(slabs_mu_);
+    for (void* slab : slabs_) free(slab);
+  }
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    if (size >= kHugePageSize) return AllocateHugePageRegion(size, alignment);
+    if (size > kMaxSmallSize) return AlignedAlloc(alignment, size);
+
+    // Blocks are aligned to their size. DeallocateBytes() can not tell small
+    // allocations with larger alignments from large allocations.
+    if (alignment > kMaxSmallSize) return nullptr;
+
+    unsigned size_class = GetSizeClass(std::max(size, alignment));
+    FreeList& free_list = thread_caches_.Local().free_lists[size_class];
+    if (free_list.head == nullptr && !Refill(size_class, &free_list))
+      return nullptr;
+    return free_list.Pop();
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    if (size >= kHugePageSize) {
+      DeallocateHugePageRegion(ptr, size);
+      return;
+    }
+    if (size > kMaxSmallSize) {
+      free(ptr);
+      return;
+    }
+
+    // The size class can be larger than the one of `size` if the allocation
+    // was aligned to more than `size`, so get it from the slab.
+    auto slab = reinterpret_cast<uintptr_t>(ptr) & ~(kSlabSize - 1);
+    unsigned size_class = reinterpret_cast<SlabHeader*>(slab)->size_class;
+    FreeList& free_list = thread_caches_.Local().free_lists[size_class];
+    free_list.Push(ptr);
+
+    size_t batch_size = GetBatchSize(size_class);
+    if (free_list.size > 2 * batch_size)
+      Release(size_class, &free_list, batch_size);
+  }
+
+ private:
+  // The blocks of a size class that are not in a thread cache.
+  struct CentralFreeList {
+    mutex mu;
+    FreeList free_list TFRT_GUARDED_BY(mu);
+    // The part of the last slab of the size class that has not been handed
+    // out yet. Slabs are carved lazily to avoid touching their memory.
+    char* unused_begin TFRT_GUARDED_BY(mu) = nullptr;
+    char* unused_end TFRT_GUARDED_BY(mu) = nullptr;
+  };
+
+  // Move a batch of blocks of `size_class` to the empty `free_list`. Return
+  // false if a new slab is needed and fails to allocate.
+  bool Refill(unsigned size_class, FreeList* free_list) {
+    size_t block_size = GetBlockSize(size_class);
+    size_t batch_size = GetBatchSize(size_class);
+    CentralFreeList& central = central_free_lists_[size_class];
+
+    mutex_lock lock(central.mu);
+    batch_size -= central.free_list.MoveTo(free_list, batch_size);
+    while (batch_size > 0) {
+      if (central.unused_begin == central.unused_end) {
+        char* slab = static_cast<char*>(AllocateSlab(size_class));
+        if (slab == nullptr) break;
+        // Skip the block that holds the header.
+        central.unused_begin = slab + block_size;
+        central.unused_end = slab + kSlabSize;
+      }
+      free_list->Push(central.unused_begin);
+      central.unused_begin += block_size;
+      --batch_size;
+    }
+    return free_list->head != nullptr;
+  }
+
+  // Move `count` blocks of `size_class` from `free_list` to the central free
+  // list.
+  void Release(unsigned size_class, FreeList* free_list, size_t count) {
+    CentralFreeList& central = central_free_lists_[size_class];
+    mutex_lock lock(central.mu);
+    free_list->MoveTo(&central.free_list, count);
+  }
+
+  void* AllocateSlab(unsigned size_class) {
+    void* slab = AlignedAlloc(kSlabSize, kSlabSize);
+    if (slab == nullptr) return nullptr;
+    new (slab) SlabHeader{size_class};
+
+    mutex_lock lock(slabs_mu_);
+    slabs_.push_back(slab);
+    return slab;
+  }
+
+  ThreadLocal<ThreadCache> thread_caches_;
+  CentralFreeList central_free_lists_[kNumSizeClasses];
+
+  mutex slabs_mu_;
+  std::vector<void*> slabs_ TFRT_GUARDED_BY(slabs_mu_);
+};
+
+std::unique_ptr<HostAllocator> CreateSlabAllocator() {
+  return std::make_unique<SlabAllocator>();
+}
+
+}  // namespace tfrt
@@ -0,0 +1,110 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the startup profile.
+
+#include "tfrt/host_context/startup_profile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct PhaseRecord {
+  std::string name;
+  int depth;
+  Clock::time_point start;
+  Clock::duration duration;
+};
+
+struct StartupProfile {
+  std::atomic<bool> enabled{false};
+  mutex mu;
+  std::vector<PhaseRecord> phases TFRT_GUARDED_BY(mu);
+};
+
+StartupProfile& GetStartupProfile() {
+  static auto* profile = new StartupProfile;
+  return *profile;
+}
+
+// Nesting depth of the phases of the current thread.
+thread_local int current_depth = 0;
+
+}  // namespace
+
+void EnableStartupProfile(bool enable) {
+  GetStartupProfile().enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool IsStartupProfileEnabled() {
+  return GetStartupProfile().enabled.load(std::memory_order_relaxed);
+}
+
+StartupPhase::StartupPhase(string_view name)
+    : tracing_scope_(tracing::TracingLevel::Default,
+                     [name] { return name.str(); }) {
+  if (!IsStartupProfileEnabled()) return;
+  name_ = name.str();
+  depth_ = current_depth++;
+  start_ = Clock::now();
+}
+
+StartupPhase::~StartupPhase() {
+  if (name_.empty()) return;
+  auto duration = Clock::now() - start_;
+  --current_depth;
+  auto& profile = GetStartupProfile();
+  mutex_lock lock(profile.mu);
+  profile.phases.push_back({std::move(name_), depth_, start_, duration});
+}
+
+void PrintStartupProfile(raw_ostream& os) {
+  auto& profile = GetStartupProfile();
+  mutex_lock lock(profile.mu);
+  auto& phases = profile.phases;
+  // Phases are recorded when they end, i.e. inner phases first.
+  std::stable_sort(phases.begin(), phases.end(),
+                   [](const PhaseRecord& a, const PhaseRecord& b) {
+                     return a.start < b.start;
+                   });
+
+  auto to_ms = [](Clock::duration duration) {
+    return llvm::format(
+        "%10.3f", std::chrono::duration<double, std::milli>(duration).count());
+  };
+
+  os << "Startup profile:\n";
+  os << "  start(ms)    time(ms)  phase\n";
+  if (phases.empty()) return;
+  Clock::time_point first = phases.front().start, last = first;
+  for (const auto& phase : phases) {
+    os << to_ms(phase.start - first) << "  " << to_ms(phase.duration) << "  ";
+    os.indent(2 * phase.depth) << phase.name << "\n";
+    last = std::max(last, phase.start + phase.duration);
+  }
+  os << "Startup wall time: " << to_ms(last - first) << " ms\n";
+  os.flush();
+}
+
+}  // namespace tfrt
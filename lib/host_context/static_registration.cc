@@ -13,11 +13,18 @@
 // limitations under the License.
 
 // This file implements the work queue factories and registers them.
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <thread>
+#include <tuple>
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/numa.h"
 #include "tfrt/support/logging.h"
 
 namespace tfrt {
@@ -27,70 +34,137 @@ namespace {
 static constexpr int kDefaultNumBlockingThreads = 256;
 
 // Factory function for a single-threaded thread pool. The argument must be
-// empty.
+// either empty or "spin_us=N", to busy-poll for new tasks for up to N
+// microseconds before blocking, e.g. "s:spin_us=50".
 std::unique_ptr<ConcurrentWorkQueue> SingleThreadedWorkQueueFactory(
     string_view arg) {
-  if (!arg.empty()) {
+  string_view value = arg;
+  int64_t spin_us = 0;
+  if (!value.empty() && (!value.consume_front("spin_us=") ||
+                         value.getAsInteger(10, spin_us) || spin_us < 0)) {
     TFRT_LOG(ERROR) << "Invalid argument for s work queue: "
                     << std::string(arg);
     return nullptr;
   }
-  return CreateSingleThreadedWorkQueue();
+  return CreateSingleThreadedWorkQueue(std::chrono::microseconds(spin_us));
 }
 
 struct MakeMultiThreadedWorkQueue {
-  static std::unique_ptr<ConcurrentWorkQueue> make(int num_nonblocking_threads,
-                                                   int num_blocking_threads) {
-    return CreateMultiThreadedWorkQueue(num_nonblocking_threads,
-                                        num_blocking_threads);
+  static std::unique_ptr<ConcurrentWorkQueue> make(
+      const MultiThreadedWorkQueueOptions& options) {
+    return CreateMultiThreadedWorkQueue(options);
   }
 };
 
+// The threads are split evenly between the NUMA nodes.
+struct MakeNumaWorkQueue {
+  static std::unique_ptr<ConcurrentWorkQueue> make(
+      const MultiThreadedWorkQueueOptions& options) {
+    if (options.min_num_blocking_threads != options.num_blocking_threads) {
+      TFRT_LOG(ERROR) << "numa work queue does not support elastic blocking "
+                         "threads";
+      return nullptr;
+    }
+    if (!options.cpus.empty() || !options.blocking_cpus.empty()) {
+      TFRT_LOG(ERROR) << "numa work queue places its threads on the NUMA nodes "
+                         "and does not support CPU sets";
+      return nullptr;
+    }
+    int num_nodes = NumaTopology::Get().num_nodes();
+    return CreateNumaWorkQueue(
+        std::max(options.num_threads / num_nodes, 1),
+        std::max(options.num_blocking_threads / num_nodes, 1));
+  }
+};
+
+// Parses a "key=value" placement option of a multi-threaded thread pool into
+// `options`. Returns false if the option is malformed.
+bool ParseThreadOption(string_view option,
+                       MultiThreadedWorkQueueOptions* options) {
+  string_view key, value;
+  std::tie(key, value) = option.split('=');
+  if (key == "cpus") return ParseCpuList(value, &options->cpus);
+  if (key == "blocking_cpus")
+    return ParseCpuList(value, &options->blocking_cpus);
+  if (key == "name") {
+    options->thread_name = value.str();
+    return true;
+  }
+  if (key == "blocking_name") {
+    options->blocking_thread_name = value.str();
+    return true;
+  }
+  if (key == "deadline_slack_ms") {
+    int slack_ms;
+    if (value.getAsInteger(10, slack_ms) || slack_ms < 0) return false;
+    options->deadline_scheduling = true;
+    options->urgent_deadline_slack = std::chrono::milliseconds(slack_ms);
+    return true;
+  }
+  return false;
+}
+
 // Factory function for a multi-threaded thread pool.  Parses the given argument
-// to determine the construction parameters.  The argument must be either "X" or
-// "X,Y", where X and Y are integers. X will determine the number of threads to
-// use for blocking work, and Y will determine the number of threads for
-// nonblocking work. If X is not specified, the pool will use a number of
-// threads based on the number of CPUs in the system. Y is not specified, a
-// `kDefaultNumBlockingThreads` of threads will be used for blocking work.
+// to determine the construction parameters.  The argument must be either "X",
+// "X,Y" or "X,Y,Z", where X, Y and Z are integers. X will determine the number
+// of threads to use for nonblocking work, and Y will determine the number of
+// threads for blocking work. If X is not specified, the pool will use a number
+// of threads based on the number of CPUs in the system. Y is not specified, a
+// `kDefaultNumBlockingThreads` of threads will be used for blocking work. If Z
+// is specified, the pool keeps only Z blocking threads when it is idle, and
+// starts up to Y when the blocking work needs them.
+//
+// The numbers can be followed by ';'-separated placement options:
+//   cpus=LIST           pin the nonblocking threads to a CPU list like "0-7"
+//   blocking_cpus=LIST  pin the blocking threads, by default to the CPUs that
+//                       are not in `cpus`
+//   name=NAME           name of the nonblocking threads
+//   blocking_name=NAME  name of the blocking threads
+//   deadline_slack_ms=N enable deadline scheduling, with the tasks of requests
+//                       within N milliseconds of their deadline run first
+// e.g. "mstd:8,64;cpus=0-7;name=serving". If X is not specified and `cpus` is,
+// the pool uses one nonblocking thread per CPU in `cpus`.
 template <typename MakeWorkQueue>
 std::unique_ptr<ConcurrentWorkQueue> MultiThreadedWorkQueueFactory(
     string_view arg) {
-  if (arg.empty()) {
-    int num_nonblocking = std::thread::hardware_concurrency();
-    int num_blocking = kDefaultNumBlockingThreads;
-    return MakeWorkQueue::make(num_nonblocking, num_blocking);
-  } else {
-    size_t comma = arg.find(',');
-    int num_threads;
-    int num_blocking = kDefaultNumBlockingThreads;
-    if (comma == std::string::npos) {
-      size_t pos;
-      num_threads = std::stoi(std::string(arg), &pos);
-      if (pos != arg.size()) {
-        TFRT_LOG(ERROR) << "Invalid argument for mstd work queue: "
-                        << std::string(arg);
-        return nullptr;
-      }
-    } else {
-      size_t pos;
-      num_threads =
-          std::stoi(std::string(arg.data(), arg.data() + comma), &pos);
-      if (pos != comma) {
-        TFRT_LOG(ERROR) << "Invalid argument for mstd work queue: "
-                        << std::string(arg);
-        return nullptr;
-      }
-      num_blocking = std::stoi(
-          std::string(arg.data() + comma + 1, arg.data() + arg.size()), &pos);
-      if (pos != arg.size() - comma - 1) {
-        TFRT_LOG(ERROR) << "Invalid argument for mstd work queue: "
-                        << std::string(arg);
-        return nullptr;
-      }
-    }
-    return MakeWorkQueue::make(num_threads, num_blocking);
+  auto invalid_argument = [&]() -> std::unique_ptr<ConcurrentWorkQueue> {
+    TFRT_LOG(ERROR) << "Invalid argument for mstd work queue: "
+                    << std::string(arg);
+    return nullptr;
+  };
+
+  MultiThreadedWorkQueueOptions options;
+  llvm::SmallVector<string_view, 4> parts;
+  arg.split(parts, ';');
+  for (string_view option : llvm::drop_begin(parts, 1)) {
+    if (!ParseThreadOption(option, &options)) return invalid_argument();
+  }
+
+  string_view counts = parts[0];
+  options.num_blocking_threads = kDefaultNumBlockingThreads;
+  if (counts.empty()) {
+    options.num_threads = options.cpus.empty()
+                              ? std::thread::hardware_concurrency()
+                              : options.cpus.size();
+    options.min_num_blocking_threads = options.num_blocking_threads;
+    return MakeWorkQueue::make(options);
+  }
+
+  llvm::SmallVector<string_view, 3> values;
+  counts.split(values, ',');
+  if (values.size() > 3 || values[0].getAsInteger(10, options.num_threads) ||
+      (values.size() > 1 &&
+       values[1].getAsInteger(10, options.num_blocking_threads))) {
+    return invalid_argument();
+  }
+  options.min_num_blocking_threads = options.num_blocking_threads;
+  if (values.size() > 2 &&
+      (values[2].getAsInteger(10, options.min_num_blocking_threads) ||
+       options.min_num_blocking_threads <= 0 ||
+       options.min_num_blocking_threads > options.num_blocking_threads)) {
+    return invalid_argument();
   }
+  return MakeWorkQueue::make(options);
 }
 
 }  // namespace
@@ -98,5 +172,7 @@ std::unique_ptr<ConcurrentWorkQueue> MultiThreadedWorkQueueFactory(
 TFRT_WORK_QUEUE_FACTORY("s", SingleThreadedWorkQueueFactory);
 TFRT_WORK_QUEUE_FACTORY(
     "mstd", MultiThreadedWorkQueueFactory<MakeMultiThreadedWorkQueue>);
+TFRT_WORK_QUEUE_FACTORY("numa",
+                        MultiThreadedWorkQueueFactory<MakeNumaWorkQueue>);
 
 }  // namespace tfrt
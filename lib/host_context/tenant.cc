@@ -0,0 +1,237 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the work queue and allocator of tenants that share
+// their threads and memory with other HostContexts.
+
+#include "tfrt/host_context/tenant.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "llvm/ADT/Optional.h"
+#include "llvm/Support/Error.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/task_function.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/string_util.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+namespace {
+
+class TenantWorkQueue : public ConcurrentWorkQueue {
+ public:
+  TenantWorkQueue(std::shared_ptr<ConcurrentWorkQueue> work_queue,
+                  TenantWorkQueueOptions options)
+      : work_queue_(std::move(work_queue)), options_(std::move(options)) {}
+  ~TenantWorkQueue() override { Quiesce(); }
+
+  std::string name() const override {
+    return StrCat("tenant '", options_.name, "' of ", work_queue_->name());
+  }
+
+  Error InitRequest(RequestContextBuilder* ctx_builder) override {
+    return work_queue_->InitRequest(ctx_builder);
+  }
+
+  void AddTask(TaskFunction task) override {
+    AddTask(llvm::None, std::move(task));
+  }
+  void AddTask(const ExecutionContext& exec_ctx, TaskFunction task) override {
+    AddTask(llvm::Optional<ExecutionContext>(exec_ctx), std::move(task));
+  }
+
+  Optional<TaskFunction> AddBlockingTask(TaskFunction task,
+                                         bool allow_queuing) override {
+    return work_queue_->AddBlockingTask(
+        WrapBlockingTask(std::move(task)), allow_queuing);
+  }
+  Optional<TaskFunction> AddBlockingTask(const ExecutionContext& exec_ctx,
+                                         TaskFunction task,
+                                         bool allow_queuing) override {
+    return work_queue_->AddBlockingTask(
+        exec_ctx, WrapBlockingTask(std::move(task)), allow_queuing);
+  }
+
+  void Await(ArrayRef<RCReference<AsyncValue>> values) override {
+    work_queue_->Await(values);
+  }
+
+  void Quiesce() override {
+    mutex_lock lock(mu_);
+    cv_.wait(lock, [this] { return num_tasks_ == 0; });
+  }
+
+  int GetParallelismLevel() const override {
+    int parallelism = work_queue_->GetParallelismLevel();
+    if (options_.max_parallelism == 0) return parallelism;
+    return std::min(parallelism, options_.max_parallelism);
+  }
+
+  bool IsInWorkerThread() const override {
+    return work_queue_->IsInWorkerThread();
+  }
+
+ private:
+  struct QueuedTask {
+    llvm::Optional<ExecutionContext> exec_ctx;
+    TaskFunction task;
+  };
+
+  // Tells the work queue that a task is done when the function it is captured
+  // in is destroyed, after it runs or when the shared work queue drops it.
+  class TaskDone {
+   public:
+    TaskDone(TenantWorkQueue* work_queue, bool running)
+        : work_queue_(work_queue), running_(running) {}
+    TaskDone(TaskDone&& other)
+        : work_queue_(other.work_queue_), running_(other.running_) {
+      other.work_queue_ = nullptr;
+    }
+    TaskDone& operator=(TaskDone&&) = delete;
+    ~TaskDone() {
+      if (work_queue_) work_queue_->OnTaskDone(running_);
+    }
+
+   private:
+    TenantWorkQueue* work_queue_;
+    // Whether the task holds one of the `max_parallelism` slots.
+    bool running_;
+  };
+
+  void AddTask(llvm::Optional<ExecutionContext> exec_ctx, TaskFunction task) {
+    {
+      mutex_lock lock(mu_);
+      ++num_tasks_;
+      if (options_.max_parallelism > 0) {
+        if (num_running_ == options_.max_parallelism) {
+          queued_tasks_.push_back({std::move(exec_ctx), std::move(task)});
+          return;
+        }
+        ++num_running_;
+      }
+    }
+    Submit({std::move(exec_ctx), std::move(task)});
+  }
+
+  void Submit(QueuedTask queued) {
+    TaskFunction task(
+        [done = TaskDone(this, options_.max_parallelism > 0),
+         task = std::move(queued.task)]() mutable {
+          task();
+          // Release the captures of the task before the next task runs.
+          task = TaskFunction();
+        });
+    if (queued.exec_ctx) {
+      work_queue_->AddTask(*queued.exec_ctx, std::move(task));
+    } else {
+      work_queue_->AddTask(std::move(task));
+    }
+  }
+
+  TaskFunction WrapBlockingTask(TaskFunction task) {
+    {
+      mutex_lock lock(mu_);
+      ++num_tasks_;
+    }
+    return TaskFunction([done = TaskDone(this, /*running=*/false),
+                         task = std::move(task)]() mutable { task(); });
+  }
+
+  void OnTaskDone(bool running) {
+    llvm::Optional<QueuedTask> next;
+    {
+      mutex_lock lock(mu_);
+      if (running) {
+        if (queued_tasks_.empty()) {
+          --num_running_;
+        } else {
+          // The next task takes over the slot.
+          next.emplace(std::move(queued_tasks_.front()));
+          queued_tasks_.pop_front();
+        }
+      }
+      if (--num_tasks_ == 0) cv_.notify_all();
+    }
+    if (next) Submit(std::move(*next));
+  }
+
+  const std::shared_ptr<ConcurrentWorkQueue> work_queue_;
+  const TenantWorkQueueOptions options_;
+
+  mutex mu_;
+  condition_variable cv_;
+  // Number of tasks that are queued, in the shared work queue or running.
+  int num_tasks_ TFRT_GUARDED_BY(mu_) = 0;
+  // Number of non-blocking tasks in the shared work queue or running, if
+  // their number is limited.
+  int num_running_ TFRT_GUARDED_BY(mu_) = 0;
+  std::deque<QueuedTask> queued_tasks_ TFRT_GUARDED_BY(mu_);
+};
+
+class TenantAllocator : public HostAllocator {
+ public:
+  TenantAllocator(std::shared_ptr<HostAllocator> allocator, size_t quota_bytes)
+      : allocator_(std::move(allocator)), quota_bytes_(quota_bytes) {}
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    size_t allocated =
+        allocated_bytes_.fetch_add(size, std::memory_order_relaxed) + size;
+    if (allocated > quota_bytes_ && size >= kMinQuotaSize) {
+      allocated_bytes_.fetch_sub(size, std::memory_order_relaxed);
+      return nullptr;
+    }
+    void* ptr = allocator_->AllocateBytes(size, alignment);
+    if (!ptr) allocated_bytes_.fetch_sub(size, std::memory_order_relaxed);
+    return ptr;
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    allocator_->DeallocateBytes(ptr, size);
+    allocated_bytes_.fetch_sub(size, std::memory_order_relaxed);
+  }
+
+ private:
+  // Smaller allocations are not checked against the quota.
+  static constexpr size_t kMinQuotaSize = 4096;
+
+  const std::shared_ptr<HostAllocator> allocator_;
+  const size_t quota_bytes_;
+  std::atomic<size_t> allocated_bytes_{0};
+};
+
+}  // namespace
+
+std::unique_ptr<ConcurrentWorkQueue> CreateTenantWorkQueue(
+    std::shared_ptr<ConcurrentWorkQueue> work_queue,
+    TenantWorkQueueOptions options) {
+  assert(options.max_parallelism >= 0);
+  return std::make_unique<TenantWorkQueue>(std::move(work_queue),
+                                           std::move(options));
+}
+
+std::unique_ptr<HostAllocator> CreateTenantAllocator(
+    std::shared_ptr<HostAllocator> allocator, size_t quota_bytes) {
+  return std::make_unique<TenantAllocator>(std::move(allocator), quota_bytes);
+}
+
+}  // namespace tfrt
@@ -18,9 +18,37 @@
 
 #include "tfrt/host_context/timer_queue.h"
 
+#include <algorithm>
+
+#include "llvm/Support/MathExtras.h"
+
 namespace tfrt {
 
-TimerQueue::TimerQueue() {
+constexpr TimerQueue::TimeDuration TimerQueue::kTickDuration;
+constexpr int TimerQueue::kNumLevels;
+constexpr int TimerQueue::kBitsPerLevel;
+constexpr int TimerQueue::kNumSlots;
+constexpr int TimerQueue::kNumBitmapWords;
+constexpr uint64_t TimerQueue::kNoTick;
+
+namespace {
+
+// Return the first non-empty slot in [begin, end) of `bitmap`, or -1.
+int FindOccupiedSlot(const uint64_t* bitmap, int begin, int end) {
+  for (int i = begin; i < end;) {
+    uint64_t bits = bitmap[i / 64] >> (i % 64);
+    if (bits != 0) {
+      int slot = i + llvm::countTrailingZeros(bits);
+      return slot < end ? slot : -1;
+    }
+    i = (i / 64 + 1) * 64;
+  }
+  return -1;
+}
+
+}  // namespace
+
+TimerQueue::TimerQueue() : start_time_(Clock::now()) {
   // Start the timer thread.
   // TODO(tfrt-devs): use alternative to std::thread in google-internal build.
   timer_thread_ = std::thread([this]() { TimerThreadRun(); });
@@ -29,8 +57,13 @@ TimerQueue::TimerQueue() {
 TimerQueue::~TimerQueue() {
   mu_.lock();
   // Cancel every timer in the queue.
-  while (!timers_.empty()) {
-    timers_.pop();
+  for (auto& level_slots : slots_) {
+    for (TimerEntry*& slot : level_slots) {
+      while (TimerEntry* entry = slot) {
+        Unlink(entry);
+        entry->DropRef();
+      }
+    }
   }
   stop_.store(true, std::memory_order_release);
   // Notify the timer thread we are done cleaning up.
@@ -40,52 +73,168 @@ TimerQueue::~TimerQueue() {
   timer_thread_.join();
 }
 
-void TimerQueue::TimerThreadRun() {
-  mutex_lock lock(mu_);
-  while (!stop_.load(std::memory_order_acquire)) {
-    const TimerEntry* top_entry = getTopTimer();
-    if (!top_entry) {
-      cv_.wait(lock);
+uint64_t TimerQueue::GetDeadlineTick(TimePoint deadline) const {
+  if (deadline <= start_time_) return 0;
+  // Round up, so that timers do not expire before their deadline.
+  TimeDuration elapsed = deadline - start_time_;
+  uint64_t tick = elapsed / kTickDuration;
+  if (elapsed % kTickDuration != TimeDuration::zero()) ++tick;
+  return tick;
+}
+
+uint64_t TimerQueue::GetCurrentTick() const {
+  TimePoint now = Clock::now();
+  if (now <= start_time_) return 0;
+  return (now - start_time_) / kTickDuration;
+}
+
+TimerQueue::TimePoint TimerQueue::GetTickTime(uint64_t tick) const {
+  return start_time_ + tick * kTickDuration;
+}
+
+void TimerQueue::Link(TimerEntry* entry, uint64_t tick) {
+  assert(entry->level_ < 0 && entry->deadline_tick_ >= tick);
+  uint64_t delta = entry->deadline_tick_ - tick;
+  int level = 0;
+  while (level < kNumLevels - 1 &&
+         delta >= uint64_t{1} << (kBitsPerLevel * (level + 1)))
+    ++level;
+
+  int shift = kBitsPerLevel * level;
+  int slot;
+  if (delta >= uint64_t{1} << (kBitsPerLevel * kNumLevels)) {
+    // The deadline is beyond the range of the wheel. Put the timer in the last
+    // slot of the top level, it is linked again when the range of the slot
+    // starts.
+    slot = ((tick >> shift) + kNumSlots - 1) % kNumSlots;
+  } else {
+    slot = (entry->deadline_tick_ >> shift) % kNumSlots;
+  }
+
+  entry->level_ = level;
+  entry->slot_ = slot;
+  entry->prev_ = nullptr;
+  entry->next_ = slots_[level][slot];
+  if (entry->next_) entry->next_->prev_ = entry;
+  slots_[level][slot] = entry;
+  occupied_[level][slot / 64] |= uint64_t{1} << (slot % 64);
+}
+
+void TimerQueue::Unlink(TimerEntry* entry) {
+  assert(entry->level_ >= 0);
+  int level = entry->level_;
+  int slot = entry->slot_;
+  if (entry->prev_) {
+    entry->prev_->next_ = entry->next_;
+  } else {
+    slots_[level][slot] = entry->next_;
+  }
+  if (entry->next_) entry->next_->prev_ = entry->prev_;
+  if (!slots_[level][slot])
+    occupied_[level][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+
+  entry->level_ = -1;
+  entry->prev_ = nullptr;
+  entry->next_ = nullptr;
+}
+
+uint64_t TimerQueue::GetNextEventTick() const {
+  uint64_t next_tick = kNoTick;
+  for (int level = 0; level < kNumLevels; ++level) {
+    // The range of the slot at `distance` slots from the current one starts
+    // at tick (index + distance) << shift.
+    int shift = kBitsPerLevel * level;
+    uint64_t index = current_tick_ >> shift;
+    int current_slot = index % kNumSlots;
+    int distance;
+    int slot = FindOccupiedSlot(occupied_[level], current_slot + 1, kNumSlots);
+    if (slot >= 0) {
+      distance = slot - current_slot;
     } else {
-      // Wait till the timer expires.
-      cv_.wait_until(lock, top_entry->deadline_);
+      slot = FindOccupiedSlot(occupied_[level], 0, current_slot + 1);
+      if (slot < 0) continue;
+      distance = slot + kNumSlots - current_slot;
     }
-    while (!timers_.empty() && timers_.top()->deadline_ <= Clock::now()) {
-      const auto top_entry = timers_.top().CopyRef();
-      timers_.pop();
-      mu_.unlock();
-      // If timer is not cancelled, run the callback.
-      if (!top_entry->cancelled_) {
-        top_entry->timer_callback_();
-      }
-      mu_.lock();
+    next_tick = std::min(next_tick, (index + distance) << shift);
+  }
+  return next_tick;
+}
+
+void TimerQueue::AdvanceTo(uint64_t tick) {
+  assert(tick > current_tick_ && tick <= GetNextEventTick());
+  current_tick_ = tick;
+
+  // Move the timers of the slots whose range starts at `tick` to the lower
+  // levels, from the top level down.
+  for (int level = kNumLevels - 1; level > 0; --level) {
+    int shift = kBitsPerLevel * level;
+    if ((tick & ((uint64_t{1} << shift) - 1)) != 0) continue;
+    TimerEntry*& slot = slots_[level][(tick >> shift) % kNumSlots];
+    while (TimerEntry* entry = slot) {
+      Unlink(entry);
+      Link(entry, tick);
     }
   }
+
+  // All timers in the level 0 slot of `tick` expire now.
+  TimerEntry*& slot = slots_[0][tick % kNumSlots];
+  while (TimerEntry* entry = slot) {
+    Unlink(entry);
+    expired_timers_.push_back(entry);
+  }
 }
 
-TimerQueue::TimerEntry* TimerQueue::getTopTimer() TFRT_REQUIRES(mu_) {
-  while (!timers_.empty()) {
-    if (timers_.top()->cancelled_) {
-      // Timer is cancelled, discard.
-      timers_.pop();
-    } else {
-      return timers_.top().get();
+void TimerQueue::TimerThreadRun() {
+  mutex_lock lock(mu_);
+  while (!stop_.load(std::memory_order_acquire)) {
+    uint64_t next_tick = GetNextEventTick();
+    uint64_t current_tick = GetCurrentTick();
+    if (next_tick > current_tick) {
+      // Wait till the next timer expires, or till a timer that expires sooner
+      // is scheduled.
+      wakeup_tick_ = next_tick;
+      if (next_tick == kNoTick) {
+        cv_.wait(lock);
+      } else {
+        cv_.wait_until(lock, GetTickTime(next_tick));
+      }
+      wakeup_tick_ = 0;
+      continue;
+    }
+
+    // Collect the timers of all ticks that have passed, and run them in one
+    // batch.
+    do {
+      AdvanceTo(next_tick);
+      next_tick = GetNextEventTick();
+    } while (next_tick <= current_tick);
+    if (expired_timers_.empty()) continue;
+
+    mu_.unlock();
+    for (TimerEntry* entry : expired_timers_) {
+      // If timer is not cancelled, run the callback.
+      if (!entry->cancelled_.load(std::memory_order_acquire)) {
+        entry->timer_callback_();
+      }
+      entry->DropRef();
     }
+    expired_timers_.clear();
+    mu_.lock();
   }
-  // No active timer found. Return a nullptr.
-  return nullptr;
 }
 
 TimerQueue::TimerHandle TimerQueue::ScheduleTimerAt(TimePoint deadline,
                                                     TimerCallback callback) {
   TimerHandle th = TimerEntry::Create(deadline, std::move(callback));
+  uint64_t deadline_tick = GetDeadlineTick(deadline);
   bool notify = false;
   {
     mutex_lock lock(mu_);
-    // Only notify timer thread when the queue is empty, or when the newly added
-    // timer's deadline is shorter.
-    notify = timers_.empty() || timers_.top()->deadline_ > deadline;
-    timers_.push(th.CopyRef());
+    // Timers that are already due expire in the next tick.
+    th->deadline_tick_ = std::max(deadline_tick, current_tick_ + 1);
+    Link(th.CopyRef().release(), current_tick_);
+    // Only notify the timer thread when it waits for a later tick.
+    notify = th->deadline_tick_ < wakeup_tick_;
   }
   // Notify the timer thread that a new timer is added.
   if (notify) cv_.notify_one();
@@ -103,6 +252,15 @@ void TimerQueue::CancelTimer(const TimerQueue::TimerHandle& timer_handle) {
   // callback has started execution, the CancelTimer() will block until
   // the execution finishes.
   timer_handle->cancelled_.store(true, std::memory_order_release);
+
+  // Remove the timer from the wheel, unless it is expiring.
+  TimerEntry* entry = timer_handle.get();
+  {
+    mutex_lock lock(mu_);
+    if (entry->level_ < 0) return;
+    Unlink(entry);
+  }
+  entry->DropRef();
 }
 
 }  // namespace tfrt
@@ -16,11 +16,268 @@
 
 #include "tfrt/io/buffered_input_stream.h"
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <vector>
+
+#include "llvm/ADT/Optional.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
 namespace tfrt {
 namespace io {
 
+// The blocks of the input stream are read into a fixed set of buffers. The
+// consumer takes the filled buffers in order and returns them when it is done
+// with them. At most one thread reads from the input stream at a time: a task
+// on the blocking work queue fills the free buffers one after the other, or
+// the consumer reads a block itself if that task has not started when the
+// consumer needs the block.
+class BufferedInputStream::Readahead
+    : public std::enable_shared_from_this<Readahead> {
+ public:
+  Readahead(std::unique_ptr<InputStream> input_stream,
+            const ReadaheadOptions& options, HostAllocator* allocator,
+            const ExecutionContext& exec_ctx)
+      : input_stream_(std::move(input_stream)),
+        options_(options),
+        allocator_(allocator),
+        exec_ctx_(exec_ctx),
+        blocks_(std::max(options.num_buffers, 2)),
+        block_size_(options.min_block_size) {
+    assert(options_.min_block_size > 0);
+    assert(options_.min_block_size <= options_.max_block_size);
+    for (int i = 0, e = blocks_.size(); i < e; ++i) free_.push_back(i);
+  }
+
+  ~Readahead() {
+    for (auto& block : blocks_) {
+      if (block.data) allocator_->Deallocate(block.data, block.capacity);
+    }
+  }
+
+  // Stops reading ahead, and waits until the block being read is done.
+  void Cancel() TFRT_EXCLUDES(mu_) {
+    mutex_lock lock(mu_);
+    cancelled_ = true;
+    filled_cv_.wait(lock, [this]() TFRT_REQUIRES(mu_) {
+      return state_ != State::kRunning;
+    });
+  }
+
+  // Returns the index of the next block, or -1 at the end of the stream.
+  llvm::Expected<int> Next() TFRT_EXCLUDES(mu_);
+
+  // Returns the block to be filled again.
+  void Release(int index) TFRT_EXCLUDES(mu_) {
+    {
+      mutex_lock lock(mu_);
+      free_.push_back(index);
+    }
+    MaybeStartReading();
+  }
+
+  // Enqueues the task that fills the free blocks, unless it is enqueued or
+  // there is nothing to do.
+  void MaybeStartReading() TFRT_EXCLUDES(mu_);
+
+  string_view GetBlock(int index) const {
+    return string_view(blocks_[index].data, blocks_[index].count);
+  }
+
+ private:
+  enum class State { kIdle, kQueued, kRunning };
+
+  struct Block {
+    char* data = nullptr;
+    size_t capacity = 0;
+    // The number of bytes read into the block.
+    size_t count = 0;
+  };
+
+  // Fills the free blocks until none is left. Runs in state kRunning.
+  void FillBlocks() TFRT_EXCLUDES(mu_);
+
+  // Reads `size` bytes from the input stream into block `index`.
+  void FillBlock(int index, size_t size) TFRT_EXCLUDES(mu_);
+
+  // Doubles the block size if it improved the throughput enough.
+  void AdaptBlockSize(size_t size, std::chrono::nanoseconds elapsed)
+      TFRT_REQUIRES(mu_);
+
+  bool HasWork() const TFRT_REQUIRES(mu_) {
+    return !cancelled_ && !eof_ && !error_ && !free_.empty();
+  }
+
+  const std::unique_ptr<InputStream> input_stream_;
+  const ReadaheadOptions options_;
+  HostAllocator* const allocator_;
+  const ExecutionContext exec_ctx_;
+  // The buffers. Only the thread that is in state kRunning writes a block
+  // taken from free_, only the consumer reads a block taken from filled_.
+  std::vector<Block> blocks_;
+
+  mutex mu_;
+  condition_variable filled_cv_;
+  State state_ TFRT_GUARDED_BY(mu_) = State::kIdle;
+  // The indices of the blocks to be read by the consumer, in order.
+  std::deque<int> filled_ TFRT_GUARDED_BY(mu_);
+  // The indices of the blocks that can be filled.
+  std::deque<int> free_ TFRT_GUARDED_BY(mu_);
+  bool eof_ TFRT_GUARDED_BY(mu_) = false;
+  bool cancelled_ TFRT_GUARDED_BY(mu_) = false;
+  // The error of the last read, reported once after the filled blocks.
+  llvm::Optional<std::string> error_ TFRT_GUARDED_BY(mu_);
+  size_t block_size_ TFRT_GUARDED_BY(mu_);
+  // The throughput in bytes per second at the last block size that improved
+  // the throughput, or 0.
+  double best_throughput_ TFRT_GUARDED_BY(mu_) = 0;
+};
+
+llvm::Expected<int> BufferedInputStream::Readahead::Next() {
+  while (true) {
+    int index;
+    size_t size;
+    {
+      mutex_lock lock(mu_);
+      if (!filled_.empty()) {
+        index = filled_.front();
+        filled_.pop_front();
+        return index;
+      }
+      if (error_) {
+        // The stream ends after the error.
+        auto error = MakeStringError(*error_);
+        error_.reset();
+        eof_ = true;
+        return std::move(error);
+      }
+      if (eof_) return -1;
+      if (state_ == State::kRunning) {
+        filled_cv_.wait(lock, [this]() TFRT_REQUIRES(mu_) {
+          return !filled_.empty() || state_ != State::kRunning;
+        });
+        continue;
+      }
+      // Read the block on this thread rather than waiting for the task that
+      // reads ahead to start, which may wait for this thread.
+      assert(!free_.empty());
+      state_ = State::kRunning;
+      index = free_.front();
+      free_.pop_front();
+      size = block_size_;
+    }
+    FillBlock(index, size);
+    mutex_lock lock(mu_);
+    state_ = State::kIdle;
+  }
+}
+
+void BufferedInputStream::Readahead::MaybeStartReading() {
+  {
+    mutex_lock lock(mu_);
+    if (state_ != State::kIdle || !HasWork()) return;
+    state_ = State::kQueued;
+  }
+  bool enqueued =
+      EnqueueBlockingWork(exec_ctx_, [readahead = shared_from_this()] {
+        {
+          mutex_lock lock(readahead->mu_);
+          // The consumer took over reading.
+          if (readahead->state_ != State::kQueued) return;
+          readahead->state_ = State::kRunning;
+        }
+        readahead->FillBlocks();
+      });
+  // The blocks are read by Next() instead.
+  if (!enqueued) {
+    mutex_lock lock(mu_);
+    if (state_ == State::kQueued) state_ = State::kIdle;
+  }
+}
+
+void BufferedInputStream::Readahead::FillBlocks() {
+  while (true) {
+    int index;
+    size_t size;
+    {
+      mutex_lock lock(mu_);
+      if (!HasWork()) {
+        state_ = State::kIdle;
+        filled_cv_.notify_all();
+        return;
+      }
+      index = free_.front();
+      free_.pop_front();
+      size = block_size_;
+    }
+    FillBlock(index, size);
+  }
+}
+
+void BufferedInputStream::Readahead::FillBlock(int index, size_t size) {
+  Block& block = blocks_[index];
+  if (block.capacity < size) {
+    if (block.data) allocator_->Deallocate(block.data, block.capacity);
+    block.data = allocator_->Allocate<char>(size);
+    block.capacity = size;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  auto count = input_stream_->Read(block.data, size);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  mutex_lock lock(mu_);
+  if (!count) {
+    error_ = StrCat(count.takeError());
+    free_.push_back(index);
+  } else {
+    block.count = *count;
+    filled_.push_back(index);
+    if (*count < size) {
+      eof_ = true;
+    } else {
+      AdaptBlockSize(size, elapsed);
+    }
+  }
+  filled_cv_.notify_all();
+}
+
+void BufferedInputStream::Readahead::AdaptBlockSize(
+    size_t size, std::chrono::nanoseconds elapsed) {
+  // Larger reads amortize the latency of the input stream until they reach
+  // its bandwidth. Stop growing once doubling gains less than this.
+  constexpr double kMinSpeedup = 1.1;
+  if (size != block_size_ || block_size_ >= options_.max_block_size) return;
+  const double throughput =
+      size / std::max(std::chrono::duration<double>(elapsed).count(), 1e-9);
+  if (throughput < best_throughput_ * kMinSpeedup) return;
+  best_throughput_ = throughput;
+  block_size_ = std::min(2 * block_size_, options_.max_block_size);
+}
+
+BufferedInputStream::BufferedInputStream(
+    std::unique_ptr<InputStream> input_stream, const ReadaheadOptions& options,
+    HostAllocator* allocator, const ExecutionContext& exec_ctx)
+    : allocator_(allocator),
+      readahead_(std::make_shared<Readahead>(std::move(input_stream), options,
+                                             allocator, exec_ctx)) {
+  readahead_->MaybeStartReading();
+}
+
+BufferedInputStream::~BufferedInputStream() {
+  if (readahead_) {
+    readahead_->Cancel();
+  } else {
+    allocator_->Deallocate(buffer_, buffer_size_);
+  }
+}
+
 llvm::Expected<size_t> BufferedInputStream::Read(char* buf, size_t max_count) {
   if (max_count < 0) return MakeStringError("max_count should not be negative");
+  if (readahead_) return ReadFromBlocks(buf, max_count);
 
   if (!buffer_limit_) {
     auto error = buffer_limit_.takeError();
@@ -50,6 +307,31 @@ llvm::Expected<size_t> BufferedInputStream::Read(char* buf, size_t max_count) {
   return actual_count;
 }
 
+llvm::Expected<size_t> BufferedInputStream::ReadFromBlocks(char* buf,
+                                                           size_t max_count) {
+  size_t actual_count = 0;
+  while (actual_count < max_count) {
+    if (block_index_ < 0 ||
+        block_pos_ == readahead_->GetBlock(block_index_).size()) {
+      if (block_index_ >= 0) readahead_->Release(block_index_);
+      block_pos_ = 0;
+      auto index = readahead_->Next();
+      block_index_ = index ? *index : -1;
+      if (!index) return index.takeError();
+      if (block_index_ < 0) break;
+      continue;
+    }
+    string_view block = readahead_->GetBlock(block_index_);
+    size_t read_cnt =
+        std::min(block.size() - block_pos_, max_count - actual_count);
+    std::memcpy(buf + actual_count, block.data() + block_pos_, read_cnt);
+    block_pos_ += read_cnt;
+    actual_count += read_cnt;
+  }
+  stream_pos_ += actual_count;
+  return actual_count;
+}
+
 llvm::Expected<size_t> BufferedInputStream::Tell() { return stream_pos_; }
 
 }  // namespace io
@@ -25,6 +25,13 @@ llvm::Expected<size_t> FileInputStream::Read(char* buf, size_t max_count) {
   return result;
 }
 
+AsyncValueRef<size_t> FileInputStream::ReadAsync(
+    char* buf, size_t max_count, const ExecutionContext& exec_ctx) {
+  auto result = file_->ReadAsync(buf, max_count, offset_, exec_ctx);
+  offset_ += max_count;
+  return result;
+}
+
 llvm::Expected<size_t> FileInputStream::Tell() { return offset_; }
 
 }  // namespace io
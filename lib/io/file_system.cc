@@ -18,9 +18,30 @@
 
 #include "tfrt/io/file_system.h"
 
+#include "tfrt/host_context/async_dispatch.h"
+
 namespace tfrt {
 namespace io {
 
+AsyncValueRef<size_t> RandomAccessFile::ReadAsync(
+    char* buf, size_t max_count, size_t offset,
+    const ExecutionContext& exec_ctx) const {
+  auto read = [this, buf, max_count, offset](AsyncValueRef<size_t> result) {
+    auto count = Read(buf, max_count, offset);
+    if (count) {
+      result.emplace(*count);
+    } else {
+      result.SetError(StrCat(count.takeError()));
+    }
+  };
+  auto result = MakeUnconstructedAsyncValueRef<size_t>(exec_ctx.host());
+  if (!EnqueueBlockingWork(exec_ctx, [read, result = result.CopyRef()]() {
+        read(result.CopyRef());
+      }))
+    read(result.CopyRef());
+  return result;
+}
+
 void FileSystemRegistry::Register(const std::string& scheme,
                                   std::unique_ptr<FileSystem> file_system) {
   assert(file_system);
@@ -36,5 +57,10 @@ FileSystem* FileSystemRegistry::Lookup(const std::string& scheme) {
   return file_systems_[scheme].get();
 }
 
+FileSystem* FileSystemRegistry::LookupForPath(const std::string& path) {
+  size_t pos = path.find("://");
+  return Lookup(pos == std::string::npos ? std::string() : path.substr(0, pos));
+}
+
 }  // namespace io
 }  // namespace tfrt
@@ -0,0 +1,665 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the HttpFileSystem class.
+
+#include "http_file_system.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+namespace io {
+namespace {
+
+#if defined(__linux__)
+// Report writes to closed connections as errors rather than with SIGPIPE.
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// Sends and receives on a connection fail after this many seconds without
+// progress, so that an unresponsive server does not block reads forever.
+constexpr int kTimeoutSeconds = 60;
+
+// The parts of an http URL.
+struct Url {
+  std::string host;
+  std::string port;
+  // The host and port as they appear in the URL, sent in the Host header.
+  std::string authority;
+  // The path and query, sent in the request line.
+  std::string target;
+};
+
+llvm::Expected<Url> ParseUrl(string_view url) {
+  string_view rest = url;
+  if (!rest.consume_front("http://"))
+    return MakeStringError("not an http URL: ", url);
+  size_t slash = rest.find('/');
+  Url result;
+  result.authority = rest.substr(0, slash).str();
+  result.target = slash == string_view::npos ? "/" : rest.substr(slash).str();
+  string_view host, port;
+  std::tie(host, port) = string_view(result.authority).rsplit(':');
+  if (host.empty()) return MakeStringError("no host in URL: ", url);
+  result.host = host.str();
+  result.port = port.empty() ? "80" : port.str();
+  return result;
+}
+
+// The bytes of a file returned by a range request.
+struct RangeResponse {
+  // The number of bytes received, which is smaller than requested at the end
+  // of the file.
+  size_t count = 0;
+  size_t file_size = 0;
+};
+
+// The header fields of a response that are used.
+struct ResponseHeader {
+  int status = 0;
+  llvm::Optional<size_t> content_length;
+  std::string content_range;
+  bool close = false;
+  bool chunked = false;
+};
+
+llvm::Expected<ResponseHeader> ParseResponseHeader(string_view header) {
+  ResponseHeader result;
+  string_view status_line, version, status;
+  std::tie(status_line, header) = header.split("\r\n");
+  std::tie(version, status) = status_line.split(' ');
+  if (!version.startswith("HTTP/1.") ||
+      status.substr(0, 3).getAsInteger(10, result.status))
+    return MakeStringError("malformed status line: ", status_line);
+  // HTTP/1.0 connections are not persistent by default.
+  result.close = version == "HTTP/1.0";
+
+  while (!header.empty()) {
+    string_view line, name, value;
+    std::tie(line, header) = header.split("\r\n");
+    std::tie(name, value) = line.split(':');
+    std::string lower_name = name.trim().lower();
+    value = value.trim();
+    if (lower_name == "content-length") {
+      size_t content_length;
+      if (value.getAsInteger(10, content_length))
+        return MakeStringError("malformed Content-Length: ", value);
+      result.content_length = content_length;
+    } else if (lower_name == "content-range") {
+      result.content_range = value.str();
+    } else if (lower_name == "connection") {
+      result.close = value.lower() == "close";
+    } else if (lower_name == "transfer-encoding") {
+      result.chunked = value.lower() != "identity";
+    }
+  }
+  return result;
+}
+
+// Parses a Content-Range value "bytes <first>-<last>/<size>" or
+// "bytes */<size>". Returns false if it is malformed or the size is unknown.
+bool ParseContentRange(string_view content_range, size_t* first,
+                       size_t* size) {
+  string_view range, size_str;
+  if (!content_range.consume_front("bytes ")) return false;
+  std::tie(range, size_str) = content_range.split('/');
+  if (size_str.getAsInteger(10, *size)) return false;
+  if (range == "*") return true;
+  return !range.split('-').first.getAsInteger(10, *first);
+}
+
+// A persistent connection to an HTTP server.
+class HttpConnection {
+ public:
+  static llvm::Expected<std::unique_ptr<HttpConnection>> Connect(
+      const Url& url);
+
+  ~HttpConnection() { close(fd_); }
+
+  // This class is not copyable or movable.
+  HttpConnection(const HttpConnection&) = delete;
+  HttpConnection& operator=(const HttpConnection&) = delete;
+
+  // Requests the bytes [offset, offset + buf.size()) of the file at `url`, and
+  // stores them in `buf`.
+  llvm::Expected<RangeResponse> GetRange(const Url& url, size_t offset,
+                                         MutableArrayRef<char> buf);
+
+  // Returns whether the connection can be used for another request.
+  bool reusable() const { return reusable_; }
+
+ private:
+  explicit HttpConnection(int fd) : fd_(fd) {}
+
+  llvm::Error Send(string_view data);
+
+  // Receives up to `max_count` bytes into `buf`, at least one.
+  llvm::Expected<size_t> Receive(char* buf, size_t max_count);
+
+  // Receives the response header, including the CRLF of its last line.
+  llvm::Expected<std::string> ReceiveHeader();
+
+  // Receives `count` bytes of the response body into `buf`, or discards them
+  // if `buf` is null.
+  llvm::Error ReceiveBody(char* buf, size_t count);
+
+  llvm::Error ConnectionError(string_view action) {
+    reusable_ = false;
+    return MakeStringError("failed to ", action,
+                           " due to error: ", strerror(errno));
+  }
+
+  const int fd_;
+  bool reusable_ = true;
+  // The bytes received past the end of the response header.
+  std::string pending_;
+};
+
+llvm::Expected<std::unique_ptr<HttpConnection>> HttpConnection::Connect(
+    const Url& url) {
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addresses = nullptr;
+  if (int status = getaddrinfo(url.host.c_str(), url.port.c_str(), &hints,
+                               &addresses)) {
+    return MakeStringError("failed to resolve ", url.host,
+                           " due to error: ", gai_strerror(status));
+  }
+
+  int fd = -1;
+  int error = 0;
+  for (addrinfo* address = addresses; address; address = address->ai_next) {
+    fd = socket(address->ai_family, address->ai_socktype,
+                address->ai_protocol);
+    if (fd >= 0 && connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+      break;
+    error = errno;
+    if (fd >= 0) close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addresses);
+  if (fd < 0) {
+    return MakeStringError("failed to connect to ", url.authority,
+                           " due to error: ", strerror(error));
+  }
+
+  // Requests are sent whole, so don't delay them.
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  timeval timeout = {};
+  timeout.tv_sec = kTimeoutSeconds;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  return std::unique_ptr<HttpConnection>(new HttpConnection(fd));
+}
+
+llvm::Error HttpConnection::Send(string_view data) {
+  while (!data.empty()) {
+    ssize_t count = send(fd_, data.data(), data.size(), kSendFlags);
+    if (count < 0 && errno == EINTR) continue;
+    if (count < 0) return ConnectionError("send request");
+    data = data.drop_front(count);
+  }
+  return llvm::Error::success();
+}
+
+llvm::Expected<size_t> HttpConnection::Receive(char* buf, size_t max_count) {
+  while (true) {
+    ssize_t count = recv(fd_, buf, max_count, 0);
+    if (count > 0) return count;
+    if (count == 0) {
+      reusable_ = false;
+      return MakeStringError("connection closed by server");
+    }
+    if (errno != EINTR) return ConnectionError("receive response");
+  }
+}
+
+llvm::Expected<std::string> HttpConnection::ReceiveHeader() {
+  // Bounds the memory used by malformed responses.
+  constexpr size_t kMaxHeaderSize = 64 * 1024;
+
+  size_t end;
+  while ((end = pending_.find("\r\n\r\n")) == std::string::npos) {
+    if (pending_.size() > kMaxHeaderSize) {
+      reusable_ = false;
+      return MakeStringError("response header too large");
+    }
+    char chunk[4096];
+    auto count = Receive(chunk, sizeof(chunk));
+    if (!count) return count.takeError();
+    pending_.append(chunk, *count);
+  }
+  std::string header = pending_.substr(0, end + 2);
+  pending_.erase(0, end + 4);
+  return header;
+}
+
+llvm::Error HttpConnection::ReceiveBody(char* buf, size_t count) {
+  size_t received = std::min(count, pending_.size());
+  if (buf) std::memcpy(buf, pending_.data(), received);
+  pending_.erase(0, received);
+
+  char discarded[4096];
+  while (received < count) {
+    auto chunk =
+        buf ? Receive(buf + received, count - received)
+            : Receive(discarded, std::min(sizeof(discarded), count - received));
+    if (!chunk) return chunk.takeError();
+    received += *chunk;
+  }
+  return llvm::Error::success();
+}
+
+llvm::Expected<RangeResponse> HttpConnection::GetRange(
+    const Url& url, size_t offset, MutableArrayRef<char> buf) {
+  assert(!buf.empty());
+  if (auto error = Send(StrCat("GET ", url.target, " HTTP/1.1\r\nHost: ",
+                               url.authority, "\r\nRange: bytes=", offset,
+                               "-", offset + buf.size() - 1, "\r\n\r\n")))
+    return std::move(error);
+
+  auto header_str = ReceiveHeader();
+  if (!header_str) return header_str.takeError();
+  auto header = ParseResponseHeader(*header_str);
+  if (!header) {
+    reusable_ = false;
+    return header.takeError();
+  }
+  if (header->close) reusable_ = false;
+  if (header->chunked || !header->content_length) {
+    reusable_ = false;
+    return MakeStringError("unsupported response with status ", header->status,
+                           " and no Content-Length");
+  }
+
+  const size_t length = *header->content_length;
+  RangeResponse response;
+  switch (header->status) {
+    case 206: {
+      size_t first = offset;
+      if (!ParseContentRange(header->content_range, &first,
+                             &response.file_size) ||
+          first != offset || length > buf.size()) {
+        reusable_ = false;
+        return MakeStringError("unexpected Content-Range: ",
+                               header->content_range);
+      }
+      if (auto error = ReceiveBody(buf.data(), length)) return std::move(error);
+      response.count = length;
+      return response;
+    }
+    case 416: {
+      // The range starts at or past the end of the file.
+      if (auto error = ReceiveBody(nullptr, length)) return std::move(error);
+      size_t first;
+      if (!ParseContentRange(header->content_range, &first,
+                             &response.file_size))
+        response.file_size = offset;
+      return response;
+    }
+    case 200: {
+      // The server ignored the range and sends the whole file.
+      const size_t begin = std::min(offset, length);
+      response.count = std::min(buf.size(), length - begin);
+      response.file_size = length;
+      if (auto error = ReceiveBody(nullptr, begin)) return std::move(error);
+      if (auto error = ReceiveBody(buf.data(), response.count))
+        return std::move(error);
+      if (auto error = ReceiveBody(nullptr, length - begin - response.count))
+        return std::move(error);
+      return response;
+    }
+    default:
+      if (auto error = ReceiveBody(nullptr, length)) return std::move(error);
+      return MakeStringError("HTTP status ", header->status);
+  }
+}
+
+// Keeps the idle connections to each server for later requests.
+class ConnectionPool {
+ public:
+  // Sends a range request on an idle connection to the server of `url`, or on
+  // a new one.
+  llvm::Expected<RangeResponse> GetRange(const Url& url, size_t offset,
+                                         MutableArrayRef<char> buf)
+      TFRT_EXCLUDES(mu_);
+
+ private:
+  mutex mu_;
+  // The number of connections is bounded by the number of fetch threads.
+  llvm::StringMap<std::vector<std::unique_ptr<HttpConnection>>> idle_
+      TFRT_GUARDED_BY(mu_);
+};
+
+llvm::Expected<RangeResponse> ConnectionPool::GetRange(
+    const Url& url, size_t offset, MutableArrayRef<char> buf) {
+  for (int attempt = 0;; ++attempt) {
+    std::unique_ptr<HttpConnection> connection;
+    {
+      mutex_lock lock(mu_);
+      auto& idle = idle_[url.authority];
+      if (!idle.empty()) {
+        connection = std::move(idle.back());
+        idle.pop_back();
+      }
+    }
+    const bool reused = connection != nullptr;
+    if (!reused) {
+      auto new_connection = HttpConnection::Connect(url);
+      if (!new_connection) return new_connection.takeError();
+      connection = std::move(*new_connection);
+    }
+
+    auto response = connection->GetRange(url, offset, buf);
+    if (connection->reusable()) {
+      mutex_lock lock(mu_);
+      idle_[url.authority].push_back(std::move(connection));
+    }
+    // The server may have closed the connection while it was idle. Retry once
+    // on a new connection.
+    if (response || !reused || attempt > 0) return response;
+    llvm::consumeError(response.takeError());
+  }
+}
+
+}  // namespace
+
+// The blocks of the files, fetched by a fixed number of threads and kept in
+// least recently used order. Concurrent reads of a block share one fetch.
+class HttpBlockCache {
+ public:
+  struct Block {
+    // Set when the block is fetched, guarded by the cache's mutex. The other
+    // members are written before and not modified after.
+    bool done = false;
+    // Shorter than the block size at the end of the file.
+    std::vector<char> data;
+    size_t file_size = 0;
+    llvm::Optional<std::string> error;
+  };
+
+  explicit HttpBlockCache(const HttpFileSystemOptions& options)
+      : options_(options) {
+    assert(options_.block_size > 0);
+    assert(options_.max_connections > 0);
+    assert(options_.max_cached_blocks > 0);
+  }
+
+  ~HttpBlockCache();
+
+  const HttpFileSystemOptions& options() const { return options_; }
+
+  // Returns block `index` of the file at `url`, and starts fetching it if it
+  // is not cached.
+  std::shared_ptr<const Block> GetBlock(const std::string& path,
+                                        const Url& url, size_t index)
+      TFRT_EXCLUDES(mu_);
+
+  // Waits until `block` is fetched.
+  void Await(const Block& block) TFRT_EXCLUDES(mu_) {
+    mutex_lock lock(mu_);
+    fetched_cv_.wait(lock, [&block]() { return block.done; });
+  }
+
+ private:
+  struct Request {
+    std::string key;
+    Url url;
+    size_t index;
+    std::shared_ptr<Block> block;
+  };
+
+  void FetchThreadRun() TFRT_EXCLUDES(mu_);
+
+  // Removes `block` from the cache, unless it was evicted already.
+  void Remove(const std::string& key, const Block* block) TFRT_REQUIRES(mu_);
+
+  const HttpFileSystemOptions options_;
+  ConnectionPool connections_;
+
+  mutex mu_;
+  condition_variable requests_cv_;
+  condition_variable fetched_cv_;
+  bool stopped_ TFRT_GUARDED_BY(mu_) = false;
+  std::deque<Request> requests_ TFRT_GUARDED_BY(mu_);
+  // The cached blocks, most recently used first, and their positions by key.
+  std::list<std::pair<std::string, std::shared_ptr<Block>>> lru_
+      TFRT_GUARDED_BY(mu_);
+  llvm::StringMap<decltype(lru_)::iterator> blocks_ TFRT_GUARDED_BY(mu_);
+  // Started by the first fetch, so that registering the file system is cheap.
+  std::vector<std::thread> threads_ TFRT_GUARDED_BY(mu_);
+};
+
+HttpBlockCache::~HttpBlockCache() {
+  std::vector<std::thread> threads;
+  {
+    mutex_lock lock(mu_);
+    stopped_ = true;
+    threads = std::move(threads_);
+  }
+  requests_cv_.notify_all();
+  for (auto& thread : threads) thread.join();
+}
+
+std::shared_ptr<const HttpBlockCache::Block> HttpBlockCache::GetBlock(
+    const std::string& path, const Url& url, size_t index) {
+  std::string key = StrCat(path, "#", index);
+  mutex_lock lock(mu_);
+  auto it = blocks_.find(key);
+  if (it != blocks_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+  }
+
+  auto block = std::make_shared<Block>();
+  lru_.emplace_front(key, block);
+  blocks_[key] = lru_.begin();
+  if (lru_.size() > static_cast<size_t>(options_.max_cached_blocks)) {
+    blocks_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+
+  requests_.push_back(Request{std::move(key), url, index, block});
+  if (threads_.empty()) {
+    for (int i = 0; i < options_.max_connections; ++i) {
+      // TODO(tfrt-devs): use alternative to std::thread in google-internal
+      // build.
+      threads_.emplace_back([this] { FetchThreadRun(); });
+    }
+  }
+  requests_cv_.notify_one();
+  return block;
+}
+
+void HttpBlockCache::FetchThreadRun() {
+  while (true) {
+    Request request;
+    {
+      mutex_lock lock(mu_);
+      requests_cv_.wait(lock, [this]() TFRT_REQUIRES(mu_) {
+        return stopped_ || !requests_.empty();
+      });
+      if (stopped_) return;
+      request = std::move(requests_.front());
+      requests_.pop_front();
+      // Skip the blocks fetched ahead that were evicted before anyone read
+      // them. Readers only get blocks from the cache.
+      if (request.block.use_count() == 1) continue;
+    }
+
+    Block& block = *request.block;
+    block.data.resize(options_.block_size);
+    auto response = connections_.GetRange(
+        request.url, request.index * options_.block_size, block.data);
+    if (response) {
+      block.data.resize(response->count);
+      block.file_size = response->file_size;
+    } else {
+      block.data.clear();
+      block.error = StrCat(response.takeError());
+    }
+
+    mutex_lock lock(mu_);
+    // Fetch the block again when it is read next.
+    if (block.error) Remove(request.key, &block);
+    block.done = true;
+    fetched_cv_.notify_all();
+  }
+}
+
+void HttpBlockCache::Remove(const std::string& key, const Block* block) {
+  auto it = blocks_.find(key);
+  if (it == blocks_.end() || it->second->second.get() != block) return;
+  lru_.erase(it->second);
+  blocks_.erase(it);
+}
+
+namespace {
+
+// This class is used to read data from a file served over HTTP.
+class HttpRandomAccessFile : public RandomAccessFile {
+ public:
+  HttpRandomAccessFile(HttpBlockCache* cache, const std::string& path, Url url,
+                       size_t size, bool sequential)
+      : cache_(cache),
+        path_(path),
+        url_(std::move(url)),
+        size_(size),
+        sequential_(sequential) {}
+
+  // This class is not copyable or movable.
+  HttpRandomAccessFile(const HttpRandomAccessFile&) = delete;
+  HttpRandomAccessFile& operator=(const HttpRandomAccessFile&) = delete;
+
+  llvm::Expected<size_t> Read(char* buf, size_t max_count,
+                              size_t offset) const override;
+
+ private:
+  HttpBlockCache* const cache_;
+  const std::string path_;
+  const Url url_;
+  const size_t size_;
+  // Whether to fetch the blocks after the ones read ahead.
+  const bool sequential_;
+};
+
+llvm::Expected<size_t> HttpRandomAccessFile::Read(char* buf, size_t max_count,
+                                                  size_t offset) const {
+  if (offset >= size_ || max_count == 0) return 0;
+  const size_t end = std::min(size_, offset + max_count);
+  const size_t block_size = cache_->options().block_size;
+  const size_t first = offset / block_size;
+  const size_t last = (end - 1) / block_size;
+
+  // Request all blocks before waiting for any, so that they are fetched in
+  // parallel.
+  std::vector<std::shared_ptr<const HttpBlockCache::Block>> blocks;
+  for (size_t index = first; index <= last; ++index)
+    blocks.push_back(cache_->GetBlock(path_, url_, index));
+  if (sequential_) {
+    const size_t num_blocks = (size_ + block_size - 1) / block_size;
+    const size_t readahead_end = std::min<size_t>(
+        num_blocks, last + 1 + cache_->options().readahead_blocks);
+    for (size_t index = last + 1; index < readahead_end; ++index)
+      cache_->GetBlock(path_, url_, index);
+  }
+
+  size_t actual_count = 0;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    const auto& block = *blocks[i];
+    cache_->Await(block);
+    if (block.error) {
+      return MakeStringError("failed to read file ", path_,
+                             " due to error: ", *block.error);
+    }
+    const size_t block_offset = (first + i) * block_size;
+    const size_t begin = std::max(offset, block_offset) - block_offset;
+    const size_t block_end = std::min(end - block_offset, block.data.size());
+    // The file is shorter than when it was opened.
+    if (block_end <= begin) break;
+    std::memcpy(buf + actual_count, block.data.data() + begin,
+                block_end - begin);
+    actual_count += block_end - begin;
+  }
+  return actual_count;
+}
+
+}  // namespace
+
+HttpFileSystem::HttpFileSystem(const HttpFileSystemOptions& options)
+    : cache_(std::make_unique<HttpBlockCache>(options)) {}
+
+HttpFileSystem::~HttpFileSystem() {}
+
+llvm::Error HttpFileSystem::NewRandomAccessFile(
+    const std::string& path, const RandomAccessFileOptions& options,
+    std::unique_ptr<RandomAccessFile>* file) {
+  file->reset();
+  auto url = ParseUrl(path);
+  if (!url) return url.takeError();
+
+  auto block = cache_->GetBlock(path, *url, 0);
+  cache_->Await(*block);
+  if (block->error) {
+    return MakeStringError("failed to open file ", path,
+                           " due to error: ", *block->error);
+  }
+
+  *file = std::make_unique<HttpRandomAccessFile>(
+      cache_.get(), path, std::move(*url), block->file_size,
+      options.access_pattern ==
+          RandomAccessFileOptions::AccessPattern::kSequential);
+  return llvm::Error::success();
+}
+
+llvm::Error HttpFileSystem::GetMatchingPaths(
+    const std::string& pattern, std::vector<std::string>* results) {
+  if (pattern.find_first_of("*?[") != std::string::npos)
+    return MakeStringError("wildcards are not supported in URL ", pattern);
+  std::unique_ptr<RandomAccessFile> file;
+  if (auto error = NewRandomAccessFile(pattern, &file)) return error;
+  results->push_back(pattern);
+  return llvm::Error::success();
+}
+
+void RegisterHttpFileSystem(FileSystemRegistry* registry) {
+  registry->Register("http", std::make_unique<HttpFileSystem>());
+}
+
+}  // namespace io
+}  // namespace tfrt
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the HttpFileSystem class, which reads files from HTTP
+// servers with range requests.
+
+#ifndef TFRT_LIB_IO_HTTP_FILE_SYSTEM_H_
+#define TFRT_LIB_IO_HTTP_FILE_SYSTEM_H_
+
+#include <memory>
+
+#include "tfrt/io/file_system.h"
+
+namespace tfrt {
+namespace io {
+
+struct HttpFileSystemOptions {
+  // The size of the range requests, and of the blocks that are cached.
+  size_t block_size = 4 * 1024 * 1024;
+  // The number of requests in flight, each on its own persistent connection.
+  int max_connections = 8;
+  // The number of blocks past a read that are fetched ahead, for files opened
+  // with the sequential access pattern.
+  int readahead_blocks = 8;
+  // The number of most recently used blocks that are kept. This should exceed
+  // max_connections + readahead_blocks, or blocks fetched ahead may be evicted
+  // before they are read.
+  int max_cached_blocks = 32;
+};
+
+// Fetches and caches the blocks of HTTP files. Defined in the .cc file.
+class HttpBlockCache;
+
+// This class is used to read files served by an HTTP/1.1 server that supports
+// range requests, e.g. an object store. Paths are URLs of the form
+// http://host[:port]/path. Reads are split into blocks that are fetched in
+// parallel over a pool of persistent connections. The files are assumed not to
+// change while they are read.
+//
+// Files must not outlive the file system.
+class HttpFileSystem : public FileSystem {
+ public:
+  HttpFileSystem() : HttpFileSystem(HttpFileSystemOptions()) {}
+  explicit HttpFileSystem(const HttpFileSystemOptions& options);
+
+  ~HttpFileSystem() override;
+
+  // This class is not copyable or movable.
+  HttpFileSystem(const HttpFileSystem&) = delete;
+  HttpFileSystem& operator=(const HttpFileSystem&) = delete;
+
+  using FileSystem::NewRandomAccessFile;
+
+  // Fetches the first block of the file, which checks that it exists and
+  // returns its size. Of `options`, only the access pattern is used.
+  llvm::Error NewRandomAccessFile(
+      const std::string& path, const RandomAccessFileOptions& options,
+      std::unique_ptr<RandomAccessFile>* file) override;
+
+  // HTTP servers cannot list files, so only patterns without wildcards are
+  // supported. They match themselves if the file can be opened.
+  llvm::Error GetMatchingPaths(const std::string& pattern,
+                               std::vector<std::string>* results) override;
+
+ private:
+  std::unique_ptr<HttpBlockCache> cache_;
+};
+
+}  // namespace io
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_IO_HTTP_FILE_SYSTEM_H_
@@ -0,0 +1,362 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the IoUring class.
+
+#include "io_uring.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "llvm_derived/Support/raw_ostream.h"
+#include "tfrt/host_context/async_dispatch.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define TFRT_HAS_IO_URING 1
+#endif
+#endif
+
+#if defined(TFRT_HAS_IO_URING)
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace tfrt {
+namespace io {
+namespace {
+
+constexpr unsigned kDefaultEntries = 256;
+
+}  // namespace
+
+struct IoUring::Request {
+  int fd;
+  char* buf;
+  size_t max_count;
+  size_t offset;
+  // The index of the registered buffer that holds `buf`, or -1.
+  int buffer_index;
+  // The number of bytes read so far.
+  size_t count;
+  AsyncValueRef<size_t> result;
+  ExecutionContext exec_ctx;
+};
+
+IoUring* IoUring::Default() {
+  static IoUring* io_uring = []() -> IoUring* {
+    auto created = Create(kDefaultEntries);
+    if (!created) {
+      llvm::consumeError(created.takeError());
+      return nullptr;
+    }
+    return created->release();
+  }();
+  return io_uring;
+}
+
+llvm::Expected<std::unique_ptr<IoUring>> IoUring::Create(unsigned entries) {
+#if defined(TFRT_HAS_IO_URING)
+  std::unique_ptr<IoUring> io_uring(new IoUring());
+  if (auto error = io_uring->Init(entries)) return std::move(error);
+  return std::move(io_uring);
+#else
+  return MakeStringError("io_uring is not supported on this platform");
+#endif
+}
+
+#if defined(TFRT_HAS_IO_URING)
+
+namespace {
+
+// A read is split into requests of at most this many bytes, since the length
+// of a request is 32 bits.
+constexpr size_t kMaxRequestSize = size_t{1} << 30;
+
+int IoUringSetup(unsigned entries, io_uring_params* params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int IoUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags) {
+  return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags,
+                 nullptr, 0);
+}
+
+int IoUringRegister(int ring_fd, unsigned opcode, void* arg,
+                    unsigned num_args) {
+  return syscall(__NR_io_uring_register, ring_fd, opcode, arg, num_args);
+}
+
+// Returns whether `error` of a system call means it should be retried.
+bool IsTransient(int error) {
+  return error == EINTR || error == EAGAIN || error == EBUSY;
+}
+
+}  // namespace
+
+llvm::Error IoUring::Init(unsigned entries) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  ring_fd_ = IoUringSetup(entries, &params);
+  if (ring_fd_ < 0)
+    return MakeStringError("failed to set up io_uring: ", strerror(errno));
+
+  // IORING_OP_READ, unlike IORING_OP_READV, needs Linux 5.6.
+  std::vector<char> probe_buffer(
+      sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op));
+  auto* probe = reinterpret_cast<io_uring_probe*>(probe_buffer.data());
+  if (IoUringRegister(ring_fd_, IORING_REGISTER_PROBE, probe,
+                      IORING_OP_LAST) < 0 ||
+      probe->last_op < IORING_OP_READ ||
+      !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED))
+    return MakeStringError("io_uring does not support reads");
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap)
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+  auto map = [this](size_t size, off_t offset) -> void* {
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+    return data == MAP_FAILED ? nullptr : data;
+  };
+  sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+  cq_ring_ = single_mmap ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+  if (!sq_ring_ || !cq_ring_ || !sqes_)
+    return MakeStringError("failed to map io_uring: ", strerror(errno));
+
+  char* sq_ring = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+  sq_array_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+  sq_mask_ = *reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+
+  char* cq_ring = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+  cq_entries_ = params.cq_entries;
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+
+  // TODO(tfrt-devs): use alternative to std::thread in google-internal build.
+  completion_thread_ = std::thread([this] { ReapCompletions(); });
+  return llvm::Error::success();
+}
+
+IoUring::~IoUring() {
+  if (completion_thread_.joinable()) {
+    Submit(nullptr);
+    completion_thread_.join();
+  }
+  if (sqes_) munmap(sqes_, sqes_size_);
+  if (cq_ring_ && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_) munmap(sq_ring_, sq_ring_size_);
+  if (ring_fd_ >= 0) close(ring_fd_);
+}
+
+llvm::Error IoUring::RegisterBuffers(ArrayRef<MutableArrayRef<char>> buffers) {
+  if (!buffers_.empty())
+    return MakeStringError("io_uring buffers are already registered");
+  std::vector<iovec> iovecs;
+  for (auto buffer : buffers) iovecs.push_back({buffer.data(), buffer.size()});
+  if (IoUringRegister(ring_fd_, IORING_REGISTER_BUFFERS, iovecs.data(),
+                      iovecs.size()) < 0)
+    return MakeStringError("failed to register io_uring buffers: ",
+                           strerror(errno));
+  buffers_.assign(buffers.begin(), buffers.end());
+  return llvm::Error::success();
+}
+
+AsyncValueRef<size_t> IoUring::Read(int fd, char* buf, size_t max_count,
+                                    size_t offset,
+                                    const ExecutionContext& exec_ctx) {
+  if (max_count == 0) return MakeAvailableAsyncValueRef<size_t>(0);
+  auto result = MakeUnconstructedAsyncValueRef<size_t>(exec_ctx.host());
+  int buffer_index = -1;
+  for (int i = 0, e = buffers_.size(); i < e; ++i) {
+    if (buf >= buffers_[i].begin() && buf + max_count <= buffers_[i].end()) {
+      buffer_index = i;
+      break;
+    }
+  }
+  Submit(new Request{fd, buf, max_count, offset, buffer_index, /*count=*/0,
+                     result.CopyRef(), exec_ctx});
+  return result;
+}
+
+void IoUring::Submit(Request* request) {
+  {
+    mutex_lock lock(mu_);
+    queued_.push_back(request);
+  }
+  SubmitQueued();
+}
+
+void IoUring::SubmitQueued() {
+  {
+    mutex_lock lock(mu_);
+    if (submitting_) return;
+    submitting_ = true;
+  }
+  // Only the submitting thread writes the tail of the submission queue.
+  unsigned tail = *sq_tail_;
+  while (true) {
+    {
+      mutex_lock lock(mu_);
+      const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+      while (!queued_.empty() && tail - head < sq_entries_ &&
+             num_in_flight_ < cq_entries_) {
+        const unsigned index = tail & sq_mask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        if (Request* request = queued_.front()) {
+          PrepareRead(*request, sqe);
+        } else {
+          // Wake up the completion thread to stop it.
+          std::memset(sqe, 0, sizeof(*sqe));
+          sqe->opcode = IORING_OP_NOP;
+        }
+        sq_array_[index] = index;
+        queued_.pop_front();
+        ++num_in_flight_;
+        ++tail;
+      }
+      // The kernel consumed all entries, and the queued requests wait for
+      // completions to be reaped, if any.
+      if (tail == head) {
+        submitting_ = false;
+        return;
+      }
+    }
+
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+    const unsigned to_submit =
+        tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (IoUringEnter(ring_fd_, to_submit, 0, 0) >= 0) continue;
+    if (!IsTransient(errno)) {
+      tfrt::errs() << "failed to submit to io_uring: " << strerror(errno)
+                   << "\n";
+      mutex_lock lock(mu_);
+      submitting_ = false;
+      return;
+    }
+    sched_yield();
+  }
+}
+
+void IoUring::PrepareRead(const Request& request, io_uring_sqe* sqe) const {
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode =
+      request.buffer_index < 0 ? IORING_OP_READ : IORING_OP_READ_FIXED;
+  sqe->fd = request.fd;
+  sqe->off = request.offset + request.count;
+  sqe->addr = reinterpret_cast<uintptr_t>(request.buf + request.count);
+  sqe->len = std::min(request.max_count - request.count, kMaxRequestSize);
+  if (request.buffer_index >= 0) sqe->buf_index = request.buffer_index;
+  sqe->user_data = reinterpret_cast<uintptr_t>(&request);
+}
+
+void IoUring::ReapCompletions() {
+  bool stopped = false;
+  while (!stopped) {
+    if (IoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+        !IsTransient(errno)) {
+      tfrt::errs() << "failed to wait for io_uring completions: "
+                   << strerror(errno) << "\n";
+      return;
+    }
+
+    llvm::SmallVector<std::pair<Request*, int>, 16> completions;
+    const unsigned head = *cq_head_;
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (unsigned i = head; i != tail; ++i) {
+      const io_uring_cqe& cqe = cqes_[i & cq_mask_];
+      auto* request = reinterpret_cast<Request*>(cqe.user_data);
+      if (request) {
+        completions.emplace_back(request, cqe.res);
+      } else {
+        stopped = true;
+      }
+    }
+    __atomic_store_n(cq_head_, tail, __ATOMIC_RELEASE);
+    {
+      mutex_lock lock(mu_);
+      num_in_flight_ -= tail - head;
+    }
+
+    for (auto& completion : completions)
+      Complete(completion.first, completion.second);
+    // Submit the retries, and the requests that waited for completions.
+    SubmitQueued();
+  }
+}
+
+void IoUring::Complete(Request* request, int res) {
+  if (res > 0) request->count += res;
+  // Retry interrupted reads, and read the rest after a short read. The read
+  // that returns 0 bytes at the end of the file completes the request.
+  if (res == -EINTR || res == -EAGAIN ||
+      (res > 0 && request->count < request->max_count)) {
+    mutex_lock lock(mu_);
+    queued_.push_back(request);
+    return;
+  }
+
+  std::unique_ptr<Request> done(request);
+  if (res < 0) {
+    EnqueueWork(done->exec_ctx,
+                [result = std::move(done->result),
+                 message = StrCat("failed to read file due to error: ",
+                                  strerror(-res))]() mutable {
+                  result.SetError(message);
+                });
+  } else {
+    EnqueueWork(done->exec_ctx, [result = std::move(done->result),
+                                 count = done->count]() mutable {
+      result.emplace(count);
+    });
+  }
+}
+
+#else  // !TFRT_HAS_IO_URING
+
+IoUring::~IoUring() {}
+
+llvm::Error IoUring::RegisterBuffers(ArrayRef<MutableArrayRef<char>> buffers) {
+  return MakeStringError("io_uring is not supported on this platform");
+}
+
+AsyncValueRef<size_t> IoUring::Read(int fd, char* buf, size_t max_count,
+                                    size_t offset,
+                                    const ExecutionContext& exec_ctx) {
+  return MakeErrorAsyncValueRef(exec_ctx.host(),
+                                "io_uring is not supported on this platform");
+}
+
+#endif  // TFRT_HAS_IO_URING
+
+}  // namespace io
+}  // namespace tfrt
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the IoUring class, which reads files asynchronously with
+// Linux io_uring.
+
+#ifndef TFRT_LIB_IO_IO_URING_H_
+#define TFRT_LIB_IO_IO_URING_H_
+
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace tfrt {
+namespace io {
+
+// Reads files with a Linux io_uring instance, so that any number of reads are
+// in flight without a thread waiting for each of them.
+//
+// Reads are queued and submitted in batches: while one thread submits the
+// queued reads to the kernel with a single system call, the reads that other
+// threads queue are submitted by the same thread in the next batch. A
+// background thread reaps the completions, resubmits short reads, and sets
+// the results on the work queue of the reads.
+class IoUring {
+ public:
+  // Returns the process wide instance, or nullptr if io_uring is not
+  // available, e.g. on other systems than Linux, before Linux 5.6, or if a
+  // seccomp policy forbids it.
+  static IoUring* Default();
+
+  // Creates an instance whose submission queue has `entries` entries.
+  static llvm::Expected<std::unique_ptr<IoUring>> Create(unsigned entries);
+
+  // There must be no reads in flight.
+  ~IoUring();
+
+  // This class is not copyable or movable.
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  // Registers `buffers` with the kernel. Reads into a registered buffer do not
+  // map its pages into the kernel for each read. Buffers can be registered
+  // once, before the first read.
+  llvm::Error RegisterBuffers(ArrayRef<MutableArrayRef<char>> buffers);
+
+  // Reads up to `max_count` bytes of the file `fd` starting at `offset` into
+  // `buf`. Like RandomAccessFile::Read(), the result is less than `max_count`
+  // only at the end of the file. The result is set by a task of the work queue
+  // of `exec_ctx`. `fd` and `buf` must be valid until then.
+  AsyncValueRef<size_t> Read(int fd, char* buf, size_t max_count,
+                             size_t offset, const ExecutionContext& exec_ctx);
+
+ private:
+  struct Request;
+
+  IoUring() = default;
+
+  // Sets up the ring and starts the completion thread.
+  llvm::Error Init(unsigned entries);
+
+  // Queues `request`, or a request to stop the completion thread if it is
+  // null, and submits the queued requests.
+  void Submit(Request* request) TFRT_EXCLUDES(mu_);
+
+  // Submits the queued requests, unless another thread does. The number of
+  // requests in flight is limited by the size of the completion queue.
+  void SubmitQueued() TFRT_EXCLUDES(mu_);
+
+  // Fills `sqe` to read the rest of `request`.
+  void PrepareRead(const Request& request, io_uring_sqe* sqe) const;
+
+  // Runs on the completion thread until it is stopped.
+  void ReapCompletions();
+
+  // Handles the completion of `request` with the result `res` of a read.
+  void Complete(Request* request, int res);
+
+  int ring_fd_ = -1;
+
+  // The submission queue ring and its entries.
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned sq_entries_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  // The completion queue ring, which may be mapped together with sq_ring_.
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  unsigned cq_entries_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+
+  // The registered buffers, written before the first read.
+  std::vector<MutableArrayRef<char>> buffers_;
+
+  mutex mu_;
+  // The requests that are not submitted yet.
+  std::deque<Request*> queued_ TFRT_GUARDED_BY(mu_);
+  // The number of submitted requests whose completion is not reaped yet.
+  unsigned num_in_flight_ TFRT_GUARDED_BY(mu_) = 0;
+  // Whether a thread is submitting requests.
+  bool submitting_ TFRT_GUARDED_BY(mu_) = false;
+
+  std::thread completion_thread_;
+};
+
+}  // namespace io
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_IO_IO_URING_H_
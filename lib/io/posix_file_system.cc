@@ -20,11 +20,17 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <glob.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
 
+#include "io_uring.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm_derived/Support/raw_ostream.h"
+#include "tfrt/support/aligned_buffer.h"
 
 namespace tfrt {
 namespace io {
@@ -33,8 +39,12 @@ namespace {
 // This class is used to read data from a random access file.
 class PosixRandomAccessFile : public RandomAccessFile {
  public:
-  explicit PosixRandomAccessFile(int fd, const std::string& path)
-      : fd_(fd), path_(path) {}
+  explicit PosixRandomAccessFile(int fd, const std::string& path,
+                                 bool direct_io, bool drop_cache_after_read)
+      : fd_(fd),
+        path_(path),
+        direct_io_(direct_io),
+        drop_cache_after_read_(drop_cache_after_read) {}
 
   ~PosixRandomAccessFile() override;
 
@@ -45,9 +55,40 @@ class PosixRandomAccessFile : public RandomAccessFile {
   llvm::Expected<size_t> Read(char* buf, size_t max_count,
                               size_t offset) const override;
 
+  // Reads with io_uring if it is available.
+  AsyncValueRef<size_t> ReadAsync(
+      char* buf, size_t max_count, size_t offset,
+      const ExecutionContext& exec_ctx) const override;
+
+  bool SupportsNonBlockingRead() const override {
+    return IoUring::Default() != nullptr;
+  }
+
  private:
+  // Returns whether the read can be passed to the file as is. Direct I/O
+  // requires aligned buffers, offsets and sizes.
+  bool CanReadDirectly(const char* buf, size_t max_count, size_t offset) const {
+    if (!direct_io_) return true;
+    return reinterpret_cast<uintptr_t>(buf) % kDirectIoAlignment == 0 &&
+           max_count % kDirectIoAlignment == 0 &&
+           offset % kDirectIoAlignment == 0;
+  }
+
+  // Reads up to `max_count` bytes at `offset` with pread().
+  llvm::Expected<size_t> ReadDirectly(char* buf, size_t max_count,
+                                      size_t offset) const;
+
+  // Reads the aligned range around the requested bytes into an aligned buffer,
+  // and copies the requested bytes out of it.
+  llvm::Expected<size_t> ReadThroughAlignedBuffer(char* buf, size_t max_count,
+                                                  size_t offset) const;
+
+  void DropCache(size_t offset, size_t count) const;
+
   int fd_;
   const std::string path_;
+  const bool direct_io_;
+  const bool drop_cache_after_read_;
 };
 
 PosixRandomAccessFile::~PosixRandomAccessFile() {
@@ -62,13 +103,23 @@ llvm::Expected<size_t> PosixRandomAccessFile::Read(char* buf, size_t max_count,
                                                    size_t offset) const {
   if (fd_ < 0) return MakeStringError("failed to read file ", path_);
 
+  auto count = CanReadDirectly(buf, max_count, offset)
+                   ? ReadDirectly(buf, max_count, offset)
+                   : ReadThroughAlignedBuffer(buf, max_count, offset);
+  if (count && drop_cache_after_read_) DropCache(offset, *count);
+  return count;
+}
+
+llvm::Expected<size_t> PosixRandomAccessFile::ReadDirectly(
+    char* buf, size_t max_count, size_t offset) const {
   size_t actual_count = 0;
   while (actual_count < max_count) {
     // Some platforms, notably macs, throw EINVAL if pread is asked to read
     // more than fits in a 32-bit integer.
     size_t request_count = max_count - actual_count;
     if (request_count > std::numeric_limits<std::int32_t>::max())
-      request_count = std::numeric_limits<std::int32_t>::max();
+      request_count = std::numeric_limits<std::int32_t>::max() /
+                      kDirectIoAlignment * kDirectIoAlignment;
 
     ssize_t read_count =
         pread(fd_, buf + actual_count, request_count, offset + actual_count);
@@ -77,21 +128,129 @@ llvm::Expected<size_t> PosixRandomAccessFile::Read(char* buf, size_t max_count,
       return MakeStringError("failed to read file ", path_,
                              " due to error: ", strerror(errno));
     if (read_count > 0) actual_count += read_count;
+    // A short direct read is at the end of the file. Reading on would start
+    // at an unaligned offset.
+    if (direct_io_ && read_count >= 0 &&
+        static_cast<size_t>(read_count) < request_count)
+      break;
   }
 
   return actual_count;
 }
+
+llvm::Expected<size_t> PosixRandomAccessFile::ReadThroughAlignedBuffer(
+    char* buf, size_t max_count, size_t offset) const {
+  // Bounds the size of the aligned buffer for large reads.
+  constexpr size_t kMaxBufferSize = 1 << 20;
+
+  size_t aligned_offset = llvm::alignDown(offset, kDirectIoAlignment);
+  size_t skip = offset - aligned_offset;
+  AlignedBuffer<kDirectIoAlignment> buffer(std::min<size_t>(
+      llvm::alignTo(skip + max_count, kDirectIoAlignment), kMaxBufferSize));
+
+  size_t actual_count = 0;
+  while (actual_count < max_count) {
+    size_t request_count = std::min<size_t>(
+        buffer.size(),
+        llvm::alignTo(skip + max_count - actual_count, kDirectIoAlignment));
+    auto read_count =
+        ReadDirectly(reinterpret_cast<char*>(buffer.data()), request_count,
+                     aligned_offset);
+    if (!read_count) return read_count.takeError();
+    if (*read_count <= skip) break;
+    size_t count = std::min(*read_count - skip, max_count - actual_count);
+    std::memcpy(buf + actual_count, buffer.data() + skip, count);
+    actual_count += count;
+    if (*read_count < request_count) break;
+    aligned_offset += request_count;
+    skip = 0;
+  }
+
+  return actual_count;
+}
+
+void PosixRandomAccessFile::DropCache(size_t offset, size_t count) const {
+#if defined(__linux__)
+  // This is a hint, so errors are ignored.
+  posix_fadvise(fd_, offset, count, POSIX_FADV_DONTNEED);
+#endif
+}
+
+AsyncValueRef<size_t> PosixRandomAccessFile::ReadAsync(
+    char* buf, size_t max_count, size_t offset,
+    const ExecutionContext& exec_ctx) const {
+  IoUring* io_uring = IoUring::Default();
+  if (fd_ < 0 || !io_uring || !CanReadDirectly(buf, max_count, offset))
+    return RandomAccessFile::ReadAsync(buf, max_count, offset, exec_ctx);
+  auto result = io_uring->Read(fd_, buf, max_count, offset, exec_ctx);
+  if (drop_cache_after_read_) {
+    // The file is kept alive until the result is available.
+    result.AndThen([this, offset, result = result.CopyRef()]() {
+      if (!result.IsError()) DropCache(offset, result.get());
+    });
+  }
+  return result;
+}
 }  // namespace
 
 llvm::Error PosixFileSystem::NewRandomAccessFile(
-    const std::string& path, std::unique_ptr<RandomAccessFile>* file) {
-  int fd = open(path.c_str(), O_RDONLY);
+    const std::string& path, const RandomAccessFileOptions& options,
+    std::unique_ptr<RandomAccessFile>* file) {
+  bool direct_io = false;
+  bool drop_cache_after_read = options.drop_cache_after_read;
+  int fd = -1;
+#if defined(__linux__)
+  if (options.direct_io) {
+    fd = open(path.c_str(), O_RDONLY | O_DIRECT);
+    direct_io = fd >= 0;
+    // Some file systems, e.g. tmpfs, do not support O_DIRECT. Keep the page
+    // cache small instead.
+    if (fd < 0 && errno == EINVAL) drop_cache_after_read = true;
+  }
+#endif
+  if (!direct_io) fd = open(path.c_str(), O_RDONLY);
   if (fd < 0) {
     file->reset();
     return MakeStringError("failed to open file ", path,
                            " due to error: ", strerror(errno));
   }
-  *file = std::make_unique<PosixRandomAccessFile>(fd, path);
+
+#if defined(__linux__)
+  // These are hints, so errors are ignored.
+  switch (options.access_pattern) {
+    case RandomAccessFileOptions::AccessPattern::kNormal:
+      break;
+    case RandomAccessFileOptions::AccessPattern::kSequential:
+      posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      break;
+    case RandomAccessFileOptions::AccessPattern::kRandom:
+      posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+      break;
+  }
+#endif
+
+  *file = std::make_unique<PosixRandomAccessFile>(fd, path, direct_io,
+                                                  drop_cache_after_read);
+  return llvm::Error::success();
+}
+
+llvm::Error PosixFileSystem::GetMatchingPaths(
+    const std::string& pattern, std::vector<std::string>* results) {
+  glob_t matches;
+  int status =
+      glob(pattern.c_str(), /*flags=*/0, /*errfunc=*/nullptr, &matches);
+  if (status == GLOB_NOMATCH) {
+    globfree(&matches);
+    return llvm::Error::success();
+  }
+  if (status != 0) {
+    globfree(&matches);
+    return MakeStringError("failed to match pattern ", pattern);
+  }
+  // glob() sorts the paths.
+  for (size_t i = 0; i < matches.gl_pathc; ++i)
+    results->push_back(matches.gl_pathv[i]);
+  globfree(&matches);
   return llvm::Error::success();
 }
 
@@ -24,6 +24,11 @@
 namespace tfrt {
 namespace io {
 
+// The alignment of the buffers, offsets and sizes of reads from files opened
+// for direct I/O. This is the page size, a multiple of the logical block size
+// of common devices.
+constexpr size_t kDirectIoAlignment = 4096;
+
 // This class is used to manage files in a POSIX file system.
 class PosixFileSystem : public FileSystem {
  public:
@@ -33,9 +38,19 @@ class PosixFileSystem : public FileSystem {
   PosixFileSystem(const PosixFileSystem&) = delete;
   PosixFileSystem& operator=(const PosixFileSystem&) = delete;
 
+  using FileSystem::NewRandomAccessFile;
+
+  // Opens the file with O_DIRECT for `options.direct_io` where the file system
+  // supports it, and passes the other options to posix_fadvise(). Reads of
+  // direct I/O files that are not aligned to kDirectIoAlignment are copied
+  // through an aligned buffer. Options that the platform does not support are
+  // ignored.
   llvm::Error NewRandomAccessFile(
-      const std::string& path,
+      const std::string& path, const RandomAccessFileOptions& options,
       std::unique_ptr<RandomAccessFile>* file) override;
+
+  llvm::Error GetMatchingPaths(const std::string& pattern,
+                               std::vector<std::string>* results) override;
 };
 
 }  // namespace io
@@ -22,9 +22,11 @@ namespace tfrt {
 namespace io {
 
 void RegisterPosixFileSystem(FileSystemRegistry* registry);
+void RegisterHttpFileSystem(FileSystemRegistry* registry);
 
 static bool kRegisterFileSystem = [] {
   RegisterPosixFileSystem(FileSystemRegistry::Default());
+  RegisterHttpFileSystem(FileSystemRegistry::Default());
   return true;
 }();
 
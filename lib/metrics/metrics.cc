@@ -21,6 +21,14 @@
 namespace tfrt {
 namespace metrics {
 
+// A dummy implementation of the Counter metric interface.
+class DummyCounter : public Counter {
+ public:
+  DummyCounter() {}
+
+  void IncrementBy(int64_t value) override {}
+};
+
 // A dummy implementation of the Gauge metric interface.
 template <typename T>
 class DummyGauge : public Gauge<T> {
@@ -38,6 +46,23 @@ class DummyHistogram : public Histogram {
   void Record(double value) override {}
 };
 
+Counter* NewCounter(std::string name) {
+  if (internal::kMetricsRegistry != nullptr) {
+    if (auto* counter = internal::kMetricsRegistry->NewCounter(name))
+      return counter;
+  }
+  return new DummyCounter();
+}
+
+template <>
+Gauge<int64_t>* NewGauge(std::string name) {
+  if (internal::kMetricsRegistry != nullptr) {
+    if (auto* gauge = internal::kMetricsRegistry->NewIntGauge(name))
+      return gauge;
+  }
+  return new DummyGauge<int64_t>();
+}
+
 template <>
 Gauge<std::string>* NewGauge(std::string name) {
   if (internal::kMetricsRegistry != nullptr)
@@ -0,0 +1,316 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+//===- simple_metrics_registry.cc - A simple Metrics Registry ------------===//
+//
+// This file implements a metrics registry which keeps the metrics in memory
+// and exports them in the Prometheus text exposition format.
+
+#include "tfrt/metrics/simple_metrics_registry/simple_metrics_registry.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace metrics {
+
+namespace {
+
+const int kNumShards = 16;
+
+// Returns the shard of the calling thread. Threads are assigned to shards
+// round-robin, which spreads concurrent updates across cache lines.
+int GetShardIndex() {
+  static std::atomic<int> next_index{0};
+  thread_local int index =
+      next_index.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return index;
+}
+
+// An atomic value padded to its own cache line.
+template <typename T>
+struct PaddedAtomic {
+  std::atomic<T> value{0};
+  char padding[64 - sizeof(std::atomic<T>)];
+};
+
+class SimpleCounter : public Counter {
+ public:
+  void IncrementBy(int64_t value) override {
+    shards_[GetShardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  int64_t value() const {
+    int64_t result = 0;
+    for (const auto& shard : shards_)
+      result += shard.value.load(std::memory_order_relaxed);
+    return result;
+  }
+
+ private:
+  std::array<PaddedAtomic<int64_t>, kNumShards> shards_;
+};
+
+class SimpleIntGauge : public Gauge<int64_t> {
+ public:
+  void Set(int64_t value) override {
+    value_.store(value, std::memory_order_relaxed);
+  }
+
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+class SimpleStringGauge : public Gauge<std::string> {
+ public:
+  void Set(std::string value) override {
+    mutex_lock lock(mu_);
+    value_ = std::move(value);
+  }
+
+  std::string value() const {
+    mutex_lock lock(mu_);
+    return value_;
+  }
+
+ private:
+  mutable mutex mu_;
+  std::string value_ TFRT_GUARDED_BY(mu_);
+};
+
+class SimpleHistogram : public Histogram {
+ public:
+  explicit SimpleHistogram(const Buckets& buckets)
+      : bounds_(buckets.explicit_bounds()) {
+    for (auto& counts : counts_) {
+      counts.reset(new std::atomic<uint64_t>[bounds_.size() + 1]);
+      for (size_t i = 0; i <= bounds_.size(); ++i) counts[i] = 0;
+    }
+  }
+
+  void Record(double value) override {
+    // Bucket 0 is the underflow bucket, bucket i > 0 has the lower bound
+    // bounds_[i - 1].
+    size_t bucket = std::upper_bound(bounds_.begin(), bounds_.end(), value) -
+                    bounds_.begin();
+    int shard = GetShardIndex();
+    counts_[shard][bucket].fetch_add(1, std::memory_order_relaxed);
+    std::atomic<double>& sum = sums_[shard].value;
+    double old_sum = sum.load(std::memory_order_relaxed);
+    while (!sum.compare_exchange_weak(old_sum, old_sum + value,
+                                      std::memory_order_relaxed)) {
+    }
+  }
+
+  const std::vector<double>& bounds() const { return bounds_; }
+
+  // Returns the number of values recorded in each bucket.
+  std::vector<uint64_t> GetCounts() const {
+    std::vector<uint64_t> result(bounds_.size() + 1);
+    for (const auto& counts : counts_) {
+      for (size_t i = 0; i < result.size(); ++i)
+        result[i] += counts[i].load(std::memory_order_relaxed);
+    }
+    return result;
+  }
+
+  double GetSum() const {
+    double result = 0;
+    for (const auto& sum : sums_)
+      result += sum.value.load(std::memory_order_relaxed);
+    return result;
+  }
+
+ private:
+  const std::vector<double> bounds_;
+  // The counts of each shard are allocated separately to avoid false sharing.
+  std::array<std::unique_ptr<std::atomic<uint64_t>[]>, kNumShards> counts_;
+  std::array<PaddedAtomic<double>, kNumShards> sums_;
+};
+
+// Returns `name` with the characters which are not allowed in Prometheus
+// metric names replaced by underscores.
+std::string GetPrometheusName(string_view name) {
+  name = name.ltrim('/');
+  std::string result;
+  result.reserve(name.size() + 1);
+  if (!name.empty() && llvm::isDigit(name.front())) result.push_back('_');
+  for (char c : name)
+    result.push_back(llvm::isAlnum(c) || c == ':' ? c : '_');
+  return result;
+}
+
+// Returns `value` escaped for a Prometheus label value.
+std::string EscapeLabelValue(string_view value) {
+  std::string result;
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      result.push_back('\\');
+      result.push_back(c);
+    } else if (c == '\n') {
+      result.append("\\n");
+    } else {
+      result.push_back(c);
+    }
+  }
+  return result;
+}
+
+// Returns the entries of `map` sorted by name, for a deterministic export.
+template <typename T>
+std::vector<std::pair<string_view, const T*>> GetSortedEntries(
+    const llvm::StringMap<std::unique_ptr<T>>& map) {
+  std::vector<std::pair<string_view, const T*>> result;
+  result.reserve(map.size());
+  for (const auto& entry : map)
+    result.emplace_back(entry.getKey(), entry.getValue().get());
+  std::sort(result.begin(), result.end(),
+            [](const auto& lhs, const auto& rhs) {
+              return lhs.first < rhs.first;
+            });
+  return result;
+}
+
+// Returns the metric of `map` named `name`, or creates it with `args`.
+template <typename T, typename... Args>
+T* GetOrCreate(llvm::StringMap<std::unique_ptr<T>>& map, std::string name,
+               Args&&... args) {
+  auto& metric = map[name];
+  if (!metric) metric = std::make_unique<T>(std::forward<Args>(args)...);
+  return metric.get();
+}
+
+}  // namespace
+
+class SimpleMetricsRegistry::Impl {
+ public:
+  Counter* NewCounter(std::string name) {
+    mutex_lock lock(mu_);
+    return GetOrCreate(counters_, std::move(name));
+  }
+
+  Gauge<int64_t>* NewIntGauge(std::string name) {
+    mutex_lock lock(mu_);
+    return GetOrCreate(int_gauges_, std::move(name));
+  }
+
+  Gauge<std::string>* NewStringGauge(std::string name) {
+    mutex_lock lock(mu_);
+    return GetOrCreate(string_gauges_, std::move(name));
+  }
+
+  Histogram* NewHistogram(std::string name, const Buckets& buckets) {
+    mutex_lock lock(mu_);
+    return GetOrCreate(histograms_, std::move(name), buckets);
+  }
+
+  void ExportPrometheusText(raw_ostream& os) {
+    mutex_lock lock(mu_);
+    for (const auto& entry : GetSortedEntries(counters_)) {
+      std::string name = GetPrometheusName(entry.first);
+      os << "# TYPE " << name << " counter\n";
+      os << name << " " << entry.second->value() << "\n";
+    }
+    for (const auto& entry : GetSortedEntries(int_gauges_)) {
+      std::string name = GetPrometheusName(entry.first);
+      os << "# TYPE " << name << " gauge\n";
+      os << name << " " << entry.second->value() << "\n";
+    }
+    for (const auto& entry : GetSortedEntries(string_gauges_)) {
+      std::string name = GetPrometheusName(entry.first);
+      os << "# TYPE " << name << " gauge\n";
+      os << name << "{value=\"" << EscapeLabelValue(entry.second->value())
+         << "\"} 1\n";
+    }
+    for (const auto& entry : GetSortedEntries(histograms_)) {
+      std::string name = GetPrometheusName(entry.first);
+      const SimpleHistogram& histogram = *entry.second;
+      std::vector<uint64_t> counts = histogram.GetCounts();
+      os << "# TYPE " << name << " histogram\n";
+      // Prometheus buckets are cumulative and labeled with their upper bound.
+      // The upper bound of bucket i is the lower bound of bucket i + 1.
+      uint64_t count = 0;
+      for (size_t i = 0; i < histogram.bounds().size(); ++i) {
+        count += counts[i];
+        os << name << "_bucket{le=\""
+           << llvm::format("%.17g", histogram.bounds()[i]) << "\"} " << count
+           << "\n";
+      }
+      count += counts.back();
+      os << name << "_bucket{le=\"+Inf\"} " << count << "\n";
+      os << name << "_sum " << llvm::format("%.17g", histogram.GetSum())
+         << "\n";
+      os << name << "_count " << count << "\n";
+    }
+  }
+
+ private:
+  mutex mu_;
+  llvm::StringMap<std::unique_ptr<SimpleCounter>> counters_
+      TFRT_GUARDED_BY(mu_);
+  llvm::StringMap<std::unique_ptr<SimpleIntGauge>> int_gauges_
+      TFRT_GUARDED_BY(mu_);
+  llvm::StringMap<std::unique_ptr<SimpleStringGauge>> string_gauges_
+      TFRT_GUARDED_BY(mu_);
+  llvm::StringMap<std::unique_ptr<SimpleHistogram>> histograms_
+      TFRT_GUARDED_BY(mu_);
+};
+
+SimpleMetricsRegistry::SimpleMetricsRegistry()
+    : impl_(std::make_unique<Impl>()) {}
+
+SimpleMetricsRegistry::~SimpleMetricsRegistry() = default;
+
+Counter* SimpleMetricsRegistry::NewCounter(std::string name) {
+  return impl_->NewCounter(std::move(name));
+}
+
+Gauge<int64_t>* SimpleMetricsRegistry::NewIntGauge(std::string name) {
+  return impl_->NewIntGauge(std::move(name));
+}
+
+Gauge<std::string>* SimpleMetricsRegistry::NewStringGauge(std::string name) {
+  return impl_->NewStringGauge(std::move(name));
+}
+
+Histogram* SimpleMetricsRegistry::NewHistogram(std::string name,
+                                               const Buckets& buckets) {
+  return impl_->NewHistogram(std::move(name), buckets);
+}
+
+void SimpleMetricsRegistry::ExportPrometheusText(raw_ostream& os) {
+  impl_->ExportPrometheusText(os);
+}
+
+SimpleMetricsRegistry* GetGlobalSimpleMetricsRegistry() {
+  static auto* registry = new SimpleMetricsRegistry;
+  return registry;
+}
+
+}  // namespace metrics
+}  // namespace tfrt
@@ -15,41 +15,55 @@
 //===- crc32c_accelerate.cc - crc32c Utilities ----------------------------===//
 //
 // This file defines C++ utility functions for crc32c accelerate.
+//
+// The implementation is selected at runtime, independent of the compiler
+// flags, from the fastest one that the CPU supports:
+//
+//   x86-64: AVX-512 VPCLMULQDQ folding of 256 bytes per iteration, and
+//           SSE4.2 crc32 over three interleaved streams, combined with
+//           PCLMULQDQ, for the rest.
+//   AArch64: ARMv8 crc32c over three interleaved streams.
+//
+// CRC math: the crc32c of a message M with initial state s is
+// (s * x^(8 * len(M)) + M * x^32) mod P, with the bits of each byte reflected,
+// i.e. the least significant bit of the first byte is the highest coefficient.
+// Since the state is linear in M, the message can be split into blocks whose
+// states are computed independently and combined by multiplying them with
+// powers of x, or folded with carry-less multiplications until a short
+// message with the same crc is left.
 
 #include <stddef.h>
 #include <stdint.h>
 
 #include "tfrt/support/raw_coding.h"
 
-// SSE4.2 accelerated CRC32c.
-
-// See if the SSE4.2 crc32c instruction is available.
-#undef USE_SSE_CRC32C
-#ifdef __SSE4_2__
-#if defined(__x86_64__) && defined(__GNUC__) && \
-    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8))
-#define USE_SSE_CRC32C 1
-#elif defined(__x86_64__) && defined(__clang__)
-#if __has_builtin(__builtin_cpu_supports)
-#define USE_SSE_CRC32C 1
+#undef TFRT_CRC32C_X86
+#undef TFRT_CRC32C_ARM
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TFRT_CRC32C_X86 1
+#elif defined(__aarch64__) && defined(__linux__) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define TFRT_CRC32C_ARM 1
 #endif
-#endif
-#endif /* __SSE4_2__ */
 
 // This version of Apple clang has a bug:
 // https://llvm.org/bugs/show_bug.cgi?id=25510
 #if defined(__APPLE__) && (__clang_major__ <= 8)
-#undef USE_SSE_CRC32C
+#undef TFRT_CRC32C_X86
 #endif
 
-#ifdef USE_SSE_CRC32C
-#include <nmmintrin.h>
+#if defined(TFRT_CRC32C_X86)
+#include <immintrin.h>
+#elif defined(TFRT_CRC32C_ARM)
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
 #endif
 
 namespace tfrt {
 namespace crc32c {
 
-#ifndef USE_SSE_CRC32C
+#if !defined(TFRT_CRC32C_X86) && !defined(TFRT_CRC32C_ARM)
 
 bool CanAccelerate() { return false; }
 uint32_t AcceleratedExtend(uint32_t crc, const char *buf, size_t size) {
@@ -59,43 +73,243 @@ uint32_t AcceleratedExtend(uint32_t crc, const char *buf, size_t size) {
 
 #else
 
-// SSE4.2 optimized crc32c computation.
-bool CanAccelerate() { return __builtin_cpu_supports("sse4.2"); }
+namespace {
 
-uint32_t AcceleratedExtend(uint32_t crc, const char *buf, size_t size) {
-  const uint8_t *p = reinterpret_cast<const uint8_t *>(buf);
-  const uint8_t *e = p + size;
-  uint32_t l = crc ^ 0xffffffffu;
-
-  // Advance p until aligned to 8-bytes..
-  // Point x at first 7-byte aligned byte in string.  This might be
-  // just past the end of the string.
-  const uintptr_t pval = reinterpret_cast<uintptr_t>(p);
-  const uint8_t *x = reinterpret_cast<const uint8_t *>(((pval + 7) >> 3) << 3);
-  if (x <= e) {
-    // Process bytes until finished or p is 8-byte aligned
-    while (p != x) {
-      l = _mm_crc32_u8(l, *p);
-      p++;
+// The crc32c polynomial with reflected bits, without the x^32 term.
+constexpr uint32_t kReflectedPoly = 0x82f63b78u;
+
+// Returns x^n mod P with reflected bits, where bit 31 is x^0.
+constexpr uint32_t PowerOfX(int n) {
+  uint32_t value = 0x80000000u;
+  for (int i = 0; i < n; ++i)
+    value = (value >> 1) ^ ((value & 1) ? kReflectedPoly : 0);
+  return value;
+}
+
+// Size of the blocks of the interleaved streams, which amortizes the cost of
+// combining the three states.
+constexpr size_t kLongBlock = 1024;
+
+uint64_t Load64(const uint8_t *p) {
+  return DecodeFixed64(reinterpret_cast<const char *>(p));
+}
+
+using ExtendFn = uint32_t (*)(uint32_t crc, const uint8_t *p, size_t size);
+
+#if defined(TFRT_CRC32C_X86)
+
+#define TFRT_CRC32C_TARGET(isa) __attribute__((target(isa)))
+
+// Combining the states with PCLMULQDQ is cheap enough to also interleave
+// shorter messages.
+constexpr size_t kShortBlock = 128;
+
+// Returns crc * x^(8 * n) mod P, where `constant` is x^(8 * n - 33) mod P.
+// The carry-less product is (crc * constant * x) with 64 reflected bits, and
+// the crc32 of the 8 bytes of the product multiplies it by x^32 mod P.
+TFRT_CRC32C_TARGET("sse4.2,pclmul")
+uint32_t ShiftSse42(uint32_t crc, uint32_t constant) {
+  __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(crc),
+                                         _mm_cvtsi32_si128(constant), 0x00);
+  return _mm_crc32_u64(0, _mm_cvtsi128_si64(product));
+}
+
+// Updates `crc` with three streams of `block` bytes at a time, as long as
+// there are three blocks left.
+template <size_t block>
+TFRT_CRC32C_TARGET("sse4.2,pclmul")
+uint32_t ExtendInterleavedSse42(uint32_t crc, const uint8_t **p,
+                                const uint8_t *e) {
+  static constexpr uint32_t kShift1 = PowerOfX(8 * block - 33);
+  static constexpr uint32_t kShift2 = PowerOfX(16 * block - 33);
+
+  while (e - *p >= static_cast<ptrdiff_t>(3 * block)) {
+    const uint8_t *p0 = *p;
+    uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+    for (size_t i = 0; i < block; i += 8) {
+      crc0 = _mm_crc32_u64(crc0, Load64(p0 + i));
+      crc1 = _mm_crc32_u64(crc1, Load64(p0 + block + i));
+      crc2 = _mm_crc32_u64(crc2, Load64(p0 + 2 * block + i));
     }
+    crc = ShiftSse42(crc0, kShift2) ^ ShiftSse42(crc1, kShift1) ^ crc2;
+    *p += 3 * block;
   }
+  return crc;
+}
+
+TFRT_CRC32C_TARGET("sse4.2")
+uint32_t ExtendTailSse42(uint32_t crc, const uint8_t *p, const uint8_t *e) {
+  uint64_t crc64 = crc;
+  for (; e - p >= 8; p += 8) crc64 = _mm_crc32_u64(crc64, Load64(p));
+  crc = crc64;
+  for (; p != e; ++p) crc = _mm_crc32_u8(crc, *p);
+  return crc;
+}
+
+TFRT_CRC32C_TARGET("sse4.2,pclmul")
+uint32_t ExtendSse42(uint32_t crc, const uint8_t *p, size_t size) {
+  const uint8_t *e = p + size;
+  crc = ExtendInterleavedSse42<kLongBlock>(crc, &p, e);
+  crc = ExtendInterleavedSse42<kShortBlock>(crc, &p, e);
+  return ExtendTailSse42(crc, p, e);
+}
+
+// Returns the multipliers that fold each 128-bit lane forward by `bytes`,
+// x^(8 * bytes + 31) mod P for the low and x^(8 * bytes - 33) mod P for the
+// high 64 bits of the lane.
+__m128i FoldConstants128(size_t bytes) {
+  return _mm_set_epi64x(PowerOfX(8 * bytes - 33), PowerOfX(8 * bytes + 31));
+}
+
+TFRT_CRC32C_TARGET("avx512f")
+__m512i FoldConstants512(size_t bytes) {
+  uint64_t lo = PowerOfX(8 * bytes + 31), hi = PowerOfX(8 * bytes - 33);
+  return _mm512_set_epi64(hi, lo, hi, lo, hi, lo, hi, lo);
+}
+
+TFRT_CRC32C_TARGET("avx512f,vpclmulqdq")
+__m512i Fold512(__m512i value, __m512i constants, __m512i next) {
+  __m512i lo = _mm512_clmulepi64_epi128(value, constants, 0x00);
+  __m512i hi = _mm512_clmulepi64_epi128(value, constants, 0x11);
+  return _mm512_ternarylogic_epi64(lo, hi, next, 0x96);
+}
+
+TFRT_CRC32C_TARGET("pclmul")
+__m128i Fold128(__m128i value, __m128i constants, __m128i next) {
+  __m128i lo = _mm_clmulepi64_si128(value, constants, 0x00);
+  __m128i hi = _mm_clmulepi64_si128(value, constants, 0x11);
+  return _mm_xor_si128(_mm_xor_si128(lo, hi), next);
+}
 
-  // Process bytes 16 at a time
-  uint64_t l64 = l;
-  while ((e - p) >= 16) {
-    l64 = _mm_crc32_u64(l64, *reinterpret_cast<const uint64_t *>(p));
-    l64 = _mm_crc32_u64(l64, *reinterpret_cast<const uint64_t *>(p + 8));
-    p += 16;
+// Folds four 512-bit accumulators, i.e. 256 bytes, per iteration. The folded
+// 128 bits at the end of the message have the same crc as the message.
+TFRT_CRC32C_TARGET("avx512f,vpclmulqdq,sse4.2,pclmul")
+uint32_t ExtendAvx512(uint32_t crc, const uint8_t *p, size_t size) {
+  if (size < 256) return ExtendSse42(crc, p, size);
+  const uint8_t *e = p + size;
+
+  static const __m512i kFold256 = FoldConstants512(256);
+  // The constants that fold a lane forward by i lanes.
+  static const auto *kFoldLanes = [] {
+    auto *constants = new __m128i[16];
+    for (int i = 1; i < 16; ++i) constants[i] = FoldConstants128(16 * i);
+    return constants;
+  }();
+
+  // The initial state is the same as xor-ing it into the first 4 bytes.
+  __m512i acc0 = _mm512_xor_si512(_mm512_loadu_si512(p),
+                                  _mm512_maskz_set1_epi32(1, crc));
+  __m512i acc1 = _mm512_loadu_si512(p + 64);
+  __m512i acc2 = _mm512_loadu_si512(p + 128);
+  __m512i acc3 = _mm512_loadu_si512(p + 192);
+  for (p += 256; e - p >= 256; p += 256) {
+    acc0 = Fold512(acc0, kFold256, _mm512_loadu_si512(p));
+    acc1 = Fold512(acc1, kFold256, _mm512_loadu_si512(p + 64));
+    acc2 = Fold512(acc2, kFold256, _mm512_loadu_si512(p + 128));
+    acc3 = Fold512(acc3, kFold256, _mm512_loadu_si512(p + 192));
   }
 
-  // Process remaining bytes one at a time.
-  l = l64;
-  while (p < e) {
-    l = _mm_crc32_u8(l, *p);
-    p++;
+  // Fold the 16 lanes of the accumulators into the last one.
+  __m128i lanes[16];
+  _mm512_storeu_si512(lanes, acc0);
+  _mm512_storeu_si512(lanes + 4, acc1);
+  _mm512_storeu_si512(lanes + 8, acc2);
+  _mm512_storeu_si512(lanes + 12, acc3);
+  __m128i value = lanes[15];
+  for (int i = 0; i < 15; ++i)
+    value = Fold128(lanes[i], kFoldLanes[15 - i], value);
+
+  for (; e - p >= 16; p += 16) {
+    value = Fold128(value, kFoldLanes[1],
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
   }
 
-  return l ^ 0xffffffffu;
+  uint64_t crc64 = _mm_crc32_u64(0, _mm_cvtsi128_si64(value));
+  crc64 = _mm_crc32_u64(crc64, _mm_extract_epi64(value, 1));
+  return ExtendTailSse42(crc64, p, e);
+}
+
+ExtendFn SelectExtend() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("vpclmulqdq") &&
+      __builtin_cpu_supports("pclmul"))
+    return ExtendAvx512;
+  if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul"))
+    return ExtendSse42;
+  return nullptr;
+}
+
+#else  // TFRT_CRC32C_ARM
+
+#if defined(__clang__)
+#define TFRT_CRC32C_TARGET __attribute__((target("crc")))
+#else
+#define TFRT_CRC32C_TARGET __attribute__((target("+crc")))
+#endif
+
+// Returns a * b mod P with reflected bits.
+uint32_t MultiplyModP(uint32_t a, uint32_t b) {
+  uint32_t product = 0;
+  for (uint32_t mask = 0x80000000u; mask != 0; mask >>= 1) {
+    if (a & mask) product ^= b;
+    b = (b >> 1) ^ ((b & 1) ? kReflectedPoly : 0);
+  }
+  return product;
+}
+
+// Updates `crc` with three streams of `block` bytes at a time, as long as
+// there are three blocks left. The states are combined in software, which is
+// cheap compared to the blocks.
+template <size_t block>
+TFRT_CRC32C_TARGET
+uint32_t ExtendInterleavedArm(uint32_t crc, const uint8_t **p,
+                              const uint8_t *e) {
+  static constexpr uint32_t kShift1 = PowerOfX(8 * block);
+  static constexpr uint32_t kShift2 = PowerOfX(16 * block);
+
+  while (e - *p >= static_cast<ptrdiff_t>(3 * block)) {
+    const uint8_t *p0 = *p;
+    uint32_t crc0 = crc, crc1 = 0, crc2 = 0;
+    for (size_t i = 0; i < block; i += 8) {
+      crc0 = __crc32cd(crc0, Load64(p0 + i));
+      crc1 = __crc32cd(crc1, Load64(p0 + block + i));
+      crc2 = __crc32cd(crc2, Load64(p0 + 2 * block + i));
+    }
+    crc = MultiplyModP(crc0, kShift2) ^ MultiplyModP(crc1, kShift1) ^ crc2;
+    *p += 3 * block;
+  }
+  return crc;
+}
+
+TFRT_CRC32C_TARGET
+uint32_t ExtendArm(uint32_t crc, const uint8_t *p, size_t size) {
+  const uint8_t *e = p + size;
+  crc = ExtendInterleavedArm<kLongBlock>(crc, &p, e);
+  for (; e - p >= 8; p += 8) crc = __crc32cd(crc, Load64(p));
+  for (; p != e; ++p) crc = __crc32cb(crc, *p);
+  return crc;
+}
+
+ExtendFn SelectExtend() {
+  if (getauxval(AT_HWCAP) & HWCAP_CRC32) return ExtendArm;
+  return nullptr;
+}
+
+#endif
+
+ExtendFn GetExtend() {
+  static const ExtendFn extend = SelectExtend();
+  return extend;
+}
+
+}  // namespace
+
+bool CanAccelerate() { return GetExtend() != nullptr; }
+
+uint32_t AcceleratedExtend(uint32_t crc, const char *buf, size_t size) {
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(buf);
+  return GetExtend()(crc ^ 0xffffffffu, p, size) ^ 0xffffffffu;
 }
 
 #endif
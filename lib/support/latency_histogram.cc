@@ -0,0 +1,110 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements LatencyHistogram.
+
+#include "tfrt/support/latency_histogram.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "llvm/Support/MathExtras.h"
+
+namespace tfrt {
+
+LatencyHistogram::LatencyHistogram()
+    : min_(std::numeric_limits<uint64_t>::max()) {
+  for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+}
+
+// Values below 2^kSubBucketBits map to their own bucket. Larger values map to
+// one of the 2^(kSubBucketBits-1) buckets of their power of two, given by the
+// kSubBucketBits-1 bits below the most significant bit.
+int LatencyHistogram::GetBucketIndex(uint64_t value) {
+  const int num_sub_buckets = 1 << (kSubBucketBits - 1);
+  if (value < (uint64_t{1} << kSubBucketBits)) return value;
+  int msb = llvm::Log2_64(value);
+  int shift = msb - (kSubBucketBits - 1);
+  int sub_bucket = (value >> shift) - num_sub_buckets;
+  return (1 << kSubBucketBits) + (msb - kSubBucketBits) * num_sub_buckets +
+         sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketMax(int index) {
+  const int num_sub_buckets = 1 << (kSubBucketBits - 1);
+  if (index < (1 << kSubBucketBits)) return index;
+  index -= 1 << kSubBucketBits;
+  int msb = kSubBucketBits + index / num_sub_buckets;
+  int shift = msb - (kSubBucketBits - 1);
+  uint64_t top = num_sub_buckets + index % num_sub_buckets;
+  // Wraps around to the maximum of uint64_t for the last bucket.
+  return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(Duration latency) {
+  uint64_t value = std::max<Duration::rep>(latency.count(), 0);
+  buckets_[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+
+  uint64_t min = min_.load(std::memory_order_relaxed);
+  while (value < min &&
+         !min_.compare_exchange_weak(min, value, std::memory_order_relaxed)) {
+  }
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (value > max &&
+         !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+
+  count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Duration LatencyHistogram::Min() const {
+  if (count() == 0) return Duration::zero();
+  return Duration(min_.load(std::memory_order_relaxed));
+}
+
+LatencyHistogram::Duration LatencyHistogram::Max() const {
+  return Duration(max_.load(std::memory_order_relaxed));
+}
+
+LatencyHistogram::Duration LatencyHistogram::Mean() const {
+  uint64_t count = this->count();
+  if (count == 0) return Duration::zero();
+  return Duration(sum_.load(std::memory_order_relaxed) / count);
+}
+
+LatencyHistogram::Duration LatencyHistogram::Percentile(
+    double percentile) const {
+  assert(percentile >= 0 && percentile <= 100);
+  uint64_t count = this->count();
+  if (count == 0) return Duration::zero();
+
+  uint64_t rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(percentile / 100 * count)));
+  uint64_t cumulative_count = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    cumulative_count += buckets_[i].load(std::memory_order_relaxed);
+    if (cumulative_count >= rank) {
+      // The recorded extremes are exact, unlike the bucket boundaries.
+      uint64_t value = std::min(GetBucketMax(i),
+                                max_.load(std::memory_order_relaxed));
+      return std::max(Duration(value), Min());
+    }
+  }
+  return Max();
+}
+
+}  // namespace tfrt
@@ -0,0 +1,260 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the batched computation of Philox samples.
+//
+// The kernel is selected at runtime, independent of the compiler flags. The
+// SIMD kernels compute 8 (AVX2) or 16 (AVX-512) consecutive samples at once,
+// with the four 32-bit words of the counters in separate registers, and
+// transpose the results back to the sample order of the scalar algorithm.
+
+#include "tfrt/support/philox_random.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#undef TFRT_PHILOX_X86
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TFRT_PHILOX_X86 1
+#include <immintrin.h>
+#endif
+
+namespace tfrt {
+namespace random {
+namespace {
+
+using CounterType = PhiloxRandom::CounterType;
+using KeyType = PhiloxRandom::KeyType;
+
+// Computes samples starting at `counter`, in multiples of the SIMD width.
+// Returns the number of samples written to `output`.
+using FillFn = size_t (*)(CounterType counter, const KeyType& key,
+                          uint32_t* output, size_t num_samples);
+
+#if defined(TFRT_PHILOX_X86)
+
+#define TFRT_PHILOX_TARGET(isa) __attribute__((target(isa)))
+
+// Adds `count` to the 128-bit `counter`.
+void AddToCounter(CounterType* counter, uint32_t count) {
+  uint32_t old = (*counter)[0];
+  (*counter)[0] += count;
+  if ((*counter)[0] >= old) return;
+  for (int i = 1; i < PhiloxRandom::kCounterSize; ++i)
+    if (++(*counter)[i] != 0) return;
+}
+
+// Writes the counters of `num_lanes` consecutive samples starting at
+// `counter`, one row per 32-bit word.
+void LaneCounters(CounterType counter, int num_lanes, uint32_t* rows) {
+  for (int lane = 0; lane < num_lanes; ++lane) {
+    for (int i = 0; i < PhiloxRandom::kCounterSize; ++i)
+      rows[i * num_lanes + lane] = counter[i];
+    AddToCounter(&counter, 1);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// AVX2 kernel, 8 samples per iteration.
+//===----------------------------------------------------------------------===//
+
+// Computes the low and high 32 bits of the products of the lanes of `a` with
+// the multiplier `m`, which is broadcast to all lanes.
+TFRT_PHILOX_TARGET("avx2")
+inline void MultiplyHighLow8(__m256i a, __m256i m, __m256i* low,
+                             __m256i* high) {
+  __m256i even = _mm256_mul_epu32(a, m);
+  __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+  *low = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xaa);
+  *high = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+}
+
+TFRT_PHILOX_TARGET("avx2")
+size_t FillAvx2(CounterType counter, const KeyType& key, uint32_t* output,
+                size_t num_samples) {
+  constexpr int kLanes = 8;
+  const __m256i lane_offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i multiplier_a = _mm256_set1_epi32(PhiloxRandom::kPhiloxM4x32A);
+  const __m256i multiplier_b = _mm256_set1_epi32(PhiloxRandom::kPhiloxM4x32B);
+
+  size_t i = 0;
+  for (; i + kLanes <= num_samples; i += kLanes) {
+    __m256i c0, c1, c2, c3;
+    if (counter[0] <= UINT32_MAX - (kLanes - 1)) {
+      c0 = _mm256_add_epi32(_mm256_set1_epi32(counter[0]), lane_offsets);
+      c1 = _mm256_set1_epi32(counter[1]);
+      c2 = _mm256_set1_epi32(counter[2]);
+      c3 = _mm256_set1_epi32(counter[3]);
+    } else {
+      // The low word of the counter wraps around within this batch.
+      alignas(32) uint32_t rows[PhiloxRandom::kCounterSize][kLanes];
+      LaneCounters(counter, kLanes, &rows[0][0]);
+      c0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(rows[0]));
+      c1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(rows[1]));
+      c2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(rows[2]));
+      c3 = _mm256_load_si256(reinterpret_cast<const __m256i*>(rows[3]));
+    }
+
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; ++round) {
+      __m256i low0, high0, low1, high1;
+      MultiplyHighLow8(c0, multiplier_a, &low0, &high0);
+      MultiplyHighLow8(c2, multiplier_b, &low1, &high1);
+      c0 = _mm256_xor_si256(_mm256_xor_si256(high1, c1), _mm256_set1_epi32(k0));
+      c1 = low1;
+      c2 = _mm256_xor_si256(_mm256_xor_si256(high0, c3), _mm256_set1_epi32(k1));
+      c3 = low0;
+      k0 += PhiloxRandom::kPhiloxW32A;
+      k1 += PhiloxRandom::kPhiloxW32B;
+    }
+
+    // Transpose the words to samples: t* hold pairs of words, u* hold the
+    // samples {0, 4}, {1, 5}, {2, 6} and {3, 7} in their 128-bit halves.
+    __m256i t0 = _mm256_unpacklo_epi32(c0, c1);
+    __m256i t1 = _mm256_unpackhi_epi32(c0, c1);
+    __m256i t2 = _mm256_unpacklo_epi32(c2, c3);
+    __m256i t3 = _mm256_unpackhi_epi32(c2, c3);
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    auto* out = reinterpret_cast<__m256i*>(output + i * 4);
+    _mm256_storeu_si256(out + 0, _mm256_permute2x128_si256(u0, u1, 0x20));
+    _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(u2, u3, 0x20));
+    _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(u0, u1, 0x31));
+    _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(u2, u3, 0x31));
+
+    AddToCounter(&counter, kLanes);
+  }
+  return i;
+}
+
+//===----------------------------------------------------------------------===//
+// AVX-512 kernel, 16 samples per iteration.
+//===----------------------------------------------------------------------===//
+
+TFRT_PHILOX_TARGET("avx512f")
+inline void MultiplyHighLow16(__m512i a, __m512i m, __m512i* low,
+                              __m512i* high) {
+  __m512i even = _mm512_mul_epu32(a, m);
+  __m512i odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), m);
+  *low = _mm512_mask_blend_epi32(0xaaaa, even, _mm512_slli_epi64(odd, 32));
+  *high = _mm512_mask_blend_epi32(0xaaaa, _mm512_srli_epi64(even, 32), odd);
+}
+
+TFRT_PHILOX_TARGET("avx512f")
+size_t FillAvx512(CounterType counter, const KeyType& key, uint32_t* output,
+                  size_t num_samples) {
+  constexpr int kLanes = 16;
+  const __m512i lane_offsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+                                                 10, 11, 12, 13, 14, 15);
+  const __m512i multiplier_a = _mm512_set1_epi32(PhiloxRandom::kPhiloxM4x32A);
+  const __m512i multiplier_b = _mm512_set1_epi32(PhiloxRandom::kPhiloxM4x32B);
+
+  size_t i = 0;
+  for (; i + kLanes <= num_samples; i += kLanes) {
+    __m512i c0, c1, c2, c3;
+    if (counter[0] <= UINT32_MAX - (kLanes - 1)) {
+      c0 = _mm512_add_epi32(_mm512_set1_epi32(counter[0]), lane_offsets);
+      c1 = _mm512_set1_epi32(counter[1]);
+      c2 = _mm512_set1_epi32(counter[2]);
+      c3 = _mm512_set1_epi32(counter[3]);
+    } else {
+      // The low word of the counter wraps around within this batch.
+      alignas(64) uint32_t rows[PhiloxRandom::kCounterSize][kLanes];
+      LaneCounters(counter, kLanes, &rows[0][0]);
+      c0 = _mm512_load_si512(rows[0]);
+      c1 = _mm512_load_si512(rows[1]);
+      c2 = _mm512_load_si512(rows[2]);
+      c3 = _mm512_load_si512(rows[3]);
+    }
+
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; ++round) {
+      __m512i low0, high0, low1, high1;
+      MultiplyHighLow16(c0, multiplier_a, &low0, &high0);
+      MultiplyHighLow16(c2, multiplier_b, &low1, &high1);
+      c0 = _mm512_xor_si512(_mm512_xor_si512(high1, c1), _mm512_set1_epi32(k0));
+      c1 = low1;
+      c2 = _mm512_xor_si512(_mm512_xor_si512(high0, c3), _mm512_set1_epi32(k1));
+      c3 = low0;
+      k0 += PhiloxRandom::kPhiloxW32A;
+      k1 += PhiloxRandom::kPhiloxW32B;
+    }
+
+    // Transpose the words to samples: u* hold the samples {0, 4, 8, 12},
+    // {1, 5, 9, 13}, {2, 6, 10, 14} and {3, 7, 11, 15} in their 128-bit lanes,
+    // v* and w* gather the lanes of the first and second half of the samples.
+    __m512i t0 = _mm512_unpacklo_epi32(c0, c1);
+    __m512i t1 = _mm512_unpackhi_epi32(c0, c1);
+    __m512i t2 = _mm512_unpacklo_epi32(c2, c3);
+    __m512i t3 = _mm512_unpackhi_epi32(c2, c3);
+    __m512i u0 = _mm512_unpacklo_epi64(t0, t2);
+    __m512i u1 = _mm512_unpackhi_epi64(t0, t2);
+    __m512i u2 = _mm512_unpacklo_epi64(t1, t3);
+    __m512i u3 = _mm512_unpackhi_epi64(t1, t3);
+    __m512i v0 = _mm512_shuffle_i32x4(u0, u1, _MM_SHUFFLE(1, 0, 1, 0));
+    __m512i v1 = _mm512_shuffle_i32x4(u2, u3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m512i w0 = _mm512_shuffle_i32x4(u0, u1, _MM_SHUFFLE(3, 2, 3, 2));
+    __m512i w1 = _mm512_shuffle_i32x4(u2, u3, _MM_SHUFFLE(3, 2, 3, 2));
+    uint32_t* out = output + i * 4;
+    _mm512_storeu_si512(
+        out + 0, _mm512_shuffle_i32x4(v0, v1, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm512_storeu_si512(
+        out + 16, _mm512_shuffle_i32x4(v0, v1, _MM_SHUFFLE(3, 1, 3, 1)));
+    _mm512_storeu_si512(
+        out + 32, _mm512_shuffle_i32x4(w0, w1, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm512_storeu_si512(
+        out + 48, _mm512_shuffle_i32x4(w0, w1, _MM_SHUFFLE(3, 1, 3, 1)));
+
+    AddToCounter(&counter, kLanes);
+  }
+  return i;
+}
+
+FillFn SelectFill() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return FillAvx512;
+  if (__builtin_cpu_supports("avx2")) return FillAvx2;
+  return nullptr;
+}
+
+#else
+
+FillFn SelectFill() { return nullptr; }
+
+#endif
+
+FillFn GetFill() {
+  static const FillFn fill = SelectFill();
+  return fill;
+}
+
+}  // namespace
+
+void PhiloxRandom::FillSamples(uint32_t* output, size_t num_samples) {
+  size_t i = 0;
+  if (FillFn fill = GetFill()) {
+    i = fill(counter_, key_, output, num_samples);
+    SkipSamples(i);
+  }
+  for (; i < num_samples; ++i) {
+    CounterType sample = computeRandomBits();
+    for (int j = 0; j < kCounterSize; ++j)
+      output[i * kCounterSize + j] = sample[j];
+  }
+}
+
+}  // namespace random
+}  // namespace tfrt
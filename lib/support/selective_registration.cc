@@ -0,0 +1,68 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements selective registration.
+
+#include "tfrt/support/selective_registration.h"
+
+#include <cassert>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringSet.h"
+
+namespace tfrt {
+namespace {
+
+struct SelectiveRegistration {
+  llvm::StringSet<> kernel_names;
+  llvm::StringSet<> op_names;
+};
+
+// Returns nullptr unless SetSelectiveRegistration() was called. It is only
+// written during static initialization, so reads need no synchronization.
+SelectiveRegistration*& GetSelectiveRegistration() {
+  static SelectiveRegistration* registration = nullptr;
+  return registration;
+}
+
+}  // namespace
+
+void SetSelectiveRegistration(ArrayRef<const char*> kernel_names,
+                              ArrayRef<const char*> op_names) {
+  auto*& registration = GetSelectiveRegistration();
+  assert(!registration && "Selective registration is already set");
+  registration = new SelectiveRegistration;
+  for (const char* name : kernel_names) registration->kernel_names.insert(name);
+  for (const char* name : op_names) registration->op_names.insert(name);
+}
+
+bool ShouldRegisterKernel(string_view name) {
+  const auto* registration = GetSelectiveRegistration();
+  return !registration || registration->kernel_names.count(name);
+}
+
+bool ShouldRegisterKernelFamily(string_view prefix) {
+  const auto* registration = GetSelectiveRegistration();
+  if (!registration) return true;
+  return llvm::any_of(registration->kernel_names, [&](const auto& entry) {
+    return entry.getKey().startswith(prefix);
+  });
+}
+
+bool ShouldRegisterOp(string_view name) {
+  const auto* registration = GetSelectiveRegistration();
+  return !registration || registration->op_names.count(name);
+}
+
+}  // namespace tfrt
@@ -106,6 +106,8 @@ raw_ostream& operator<<(raw_ostream& os, const TensorLayout& layout) {
       return os << "Row-Major Dense tensor";
     case TensorLayout::kCOO_EXPERIMENTAL:
       return os << "COOrdinate list sparse tensor";
+    case TensorLayout::kRMD_CHUNKED:
+      return os << "Row-Major Dense tensor in checksummed chunks";
   }
   return os << "Unknown";
 }
@@ -16,8 +16,18 @@
 
 #include "tfrt/tensor/btf_util.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <iostream>
 
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/Support/FileSystem.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/crc32c.h"
+
 namespace tfrt {
 namespace {
 
@@ -73,7 +83,8 @@ Expected<DenseHostTensor> ReadDHTFromBTF(std::istream* stream, uint64_t offset,
   if (!ReadStream(stream, &header, 1)) {
     return MakeStringError("failed to read tensor header at offset", offset);
   }
-  if (header.layout != btf::TensorLayout::kRMD) {
+  if (header.layout != btf::TensorLayout::kRMD &&
+      header.layout != btf::TensorLayout::kRMD_CHUNKED) {
     return MakeStringError("unexpected tensor layout ", header.layout);
   }
   SmallVector<ssize_t, 4> dims;
@@ -88,16 +99,252 @@ Expected<DenseHostTensor> ReadDHTFromBTF(std::istream* stream, uint64_t offset,
     return MakeStringError("cannot allocate result tensor");
   }
   auto dht = std::move(*dht_or);
-  // This can read a large amount of data from the stream. Depending on the
-  // underlying file system implementation, we may need to have a more optimal
-  // strategy for reading the file.
-  if (!ReadStream(stream, reinterpret_cast<uint8_t*>(dht.data()),
-                  dht.DataSizeInBytes())) {
-    return MakeStringError("failed to read tensor data at offset", offset);
+  auto* data = reinterpret_cast<char*>(dht.data());
+  const size_t data_size = dht.DataSizeInBytes();
+
+  if (header.layout == btf::TensorLayout::kRMD) {
+    // This can read a large amount of data from the stream. Depending on the
+    // underlying file system implementation, we may need to have a more
+    // optimal strategy for reading the file.
+    if (!ReadStream(stream, data, data_size)) {
+      return MakeStringError("failed to read tensor data at offset", offset);
+    }
+    return std::move(dht);
+  }
+
+  uint64_t num_chunks;
+  if (!ReadStream(stream, &num_chunks) || num_chunks > data_size + 1) {
+    return MakeStringError("failed to read tensor chunks at offset", offset);
+  }
+  std::vector<uint64_t> chunk_offsets(num_chunks + 1);
+  std::vector<uint32_t> chunk_crcs(num_chunks);
+  if (!ReadStream(stream, chunk_offsets.data(), chunk_offsets.size()) ||
+      !ReadStream(stream, chunk_crcs.data(), chunk_crcs.size())) {
+    return MakeStringError("failed to read tensor chunks at offset", offset);
+  }
+  if (chunk_offsets.front() != 0 || chunk_offsets.back() != data_size ||
+      !std::is_sorted(chunk_offsets.begin(), chunk_offsets.end())) {
+    return MakeStringError("invalid tensor chunk offsets at offset", offset);
+  }
+  const size_t tables_size = (num_chunks + 2) * sizeof(uint64_t) +
+                             num_chunks * sizeof(uint32_t);
+  stream->ignore(Pad(tables_size));
+
+  // Verify each chunk while it is still in cache, rather than making a second
+  // pass over the whole tensor.
+  for (uint64_t i = 0; i != num_chunks; ++i) {
+    char* chunk = data + chunk_offsets[i];
+    const size_t chunk_size = chunk_offsets[i + 1] - chunk_offsets[i];
+    if (!ReadStream(stream, chunk, chunk_size)) {
+      return MakeStringError("failed to read tensor data at offset", offset);
+    }
+    if (crc32c::Unmask(chunk_crcs[i]) != crc32c::Value(chunk, chunk_size)) {
+      return MakeStringError("checksum mismatch in chunk ", i,
+                             " of tensor at offset ", offset);
+    }
   }
   return std::move(dht);
 }
 
+Expected<MappedBTFFile> MappedBTFFile::Open(const std::string& path) {
+  auto file = llvm::sys::fs::openNativeFileForRead(path);
+  if (!file) {
+    llvm::consumeError(file.takeError());
+    return MakeStringError("failed to open file ", path, " for reading");
+  }
+  auto close_file =
+      llvm::make_scope_exit([&] { llvm::sys::fs::closeFile(*file); });
+
+  llvm::sys::fs::file_status status;
+  if (auto ec = llvm::sys::fs::status(*file, status)) {
+    return MakeStringError("failed to stat file ", path, ": ", ec.message());
+  }
+  const uint64_t size = status.getSize();
+  if (size < sizeof(uint64_t)) {
+    return MakeStringError("failed to read num_tensors from path ", path);
+  }
+
+  // Map copy-on-write, so that tensors over the mapping are writable like any
+  // other DenseHostTensor without modifying the file.
+  std::error_code ec;
+  auto region = std::make_unique<llvm::sys::fs::mapped_file_region>(
+      *file, llvm::sys::fs::mapped_file_region::priv, size, /*offset=*/0, ec);
+  if (ec) {
+    return MakeStringError("failed to map file ", path, ": ", ec.message());
+  }
+
+  char* data = region->data();
+  AdviseHugePages(data, size);
+  auto buffer = HostBuffer::CreateFromExternal(
+      data, size, [region = std::move(region)](void*, size_t) {});
+
+  uint64_t num_tensors;
+  std::memcpy(&num_tensors, data, sizeof(num_tensors));
+  if (num_tensors > size / sizeof(uint64_t) - 1) {
+    return MakeStringError("invalid num_tensors ", num_tensors, " in path ",
+                           path);
+  }
+  return MappedBTFFile(std::move(buffer), num_tensors);
+}
+
+Expected<MappedBTFFile::Record> MappedBTFFile::ReadRecord(
+    uint64_t index) const {
+  if (index >= num_tensors_) {
+    return MakeStringError("invalid tensor index ", index, " in file with ",
+                           num_tensors_, " tensors");
+  }
+
+  const auto* data = static_cast<const char*>(buffer_->data());
+  const uint64_t size = buffer_->size();
+  auto in_bounds = [&](uint64_t offset, uint64_t n) {
+    return offset <= size && n <= size - offset;
+  };
+  auto read = [&](uint64_t offset, void* value, size_t n) {
+    if (!in_bounds(offset, n)) return false;
+    std::memcpy(value, data + offset, n);
+    return true;
+  };
+
+  uint64_t offset;
+  if (!read(sizeof(uint64_t) * (index + 1), &offset, sizeof(offset))) {
+    return MakeStringError("failed to read tensor offset for tensor index ",
+                           index);
+  }
+
+  btf::TensorHeader header;
+  if (!read(offset, &header, sizeof(header))) {
+    return MakeStringError("failed to read tensor header at offset ", offset);
+  }
+  if (header.layout != btf::TensorLayout::kRMD &&
+      header.layout != btf::TensorLayout::kRMD_CHUNKED) {
+    return MakeStringError("unexpected tensor layout ", header.layout);
+  }
+
+  if (header.rank > size / sizeof(ssize_t)) {
+    return MakeStringError("failed to read tensor dims at offset ", offset);
+  }
+  SmallVector<ssize_t, 4> dims;
+  dims.resize(header.rank);
+  const uint64_t dims_offset = offset + sizeof(header);
+  if (!read(dims_offset, dims.data(), dims.size() * sizeof(ssize_t))) {
+    return MakeStringError("failed to read tensor dims at offset ", offset);
+  }
+
+  Record record;
+  record.metadata = TensorMetadata(DType(ToDTypeKind(header.dtype)),
+                                   TensorShape(dims));
+  record.data_offset = dims_offset + dims.size() * sizeof(ssize_t);
+
+  if (header.layout == btf::TensorLayout::kRMD_CHUNKED) {
+    if (!read(record.data_offset, &record.num_chunks, sizeof(uint64_t)) ||
+        record.num_chunks > size / sizeof(uint64_t)) {
+      return MakeStringError("failed to read tensor chunks at offset ",
+                             offset);
+    }
+    record.chunk_offsets_offset = record.data_offset + sizeof(uint64_t);
+    record.chunk_crcs_offset = record.chunk_offsets_offset +
+                               (record.num_chunks + 1) * sizeof(uint64_t);
+    const uint64_t tables_end =
+        record.chunk_crcs_offset + record.num_chunks * sizeof(uint32_t);
+    record.data_offset = tables_end + Pad(tables_end);
+  }
+
+  const size_t data_size = record.metadata.GetHostSizeInBytes();
+  if (!in_bounds(record.data_offset, data_size)) {
+    return MakeStringError("failed to read tensor data at offset ", offset);
+  }
+  if (record.data_offset % record.metadata.dtype.GetHostAlignment() != 0) {
+    return MakeStringError("misaligned tensor data at offset ", offset);
+  }
+
+  if (record.num_chunks > 0) {
+    ArrayRef<uint64_t> chunk_offsets(
+        reinterpret_cast<const uint64_t*>(data + record.chunk_offsets_offset),
+        record.num_chunks + 1);
+    if (chunk_offsets.front() != 0 || chunk_offsets.back() != data_size ||
+        !std::is_sorted(chunk_offsets.begin(), chunk_offsets.end())) {
+      return MakeStringError("invalid tensor chunk offsets at offset ",
+                             offset);
+    }
+  }
+
+  return record;
+}
+
+Expected<DenseHostTensor> MappedBTFFile::ReadDHT(uint64_t index) const {
+  auto record = ReadRecord(index);
+  if (!record) return record.takeError();
+
+  auto tensor_data = HostBuffer::CreateFromExternal(
+      buffer_.CopyRef(), record->data_offset,
+      record->metadata.GetHostSizeInBytes());
+  return DenseHostTensor(record->metadata, std::move(tensor_data));
+}
+
+AsyncValueRef<Chain> MappedBTFFile::VerifyChecksums(
+    uint64_t index, const ExecutionContext& exec_ctx) const {
+  auto record = ReadRecord(index);
+  if (!record) return EmitErrorAsync(exec_ctx, record.takeError());
+
+  // Checks the chunks [begin, end) and returns whether all of them match.
+  auto verify = [buffer = buffer_.CopyRef(), record = *record](
+                    size_t begin, size_t end) {
+    const auto* data = static_cast<const char*>(buffer->data());
+    const auto* chunk_offsets = reinterpret_cast<const uint64_t*>(
+        data + record.chunk_offsets_offset);
+    const auto* chunk_crcs =
+        reinterpret_cast<const uint32_t*>(data + record.chunk_crcs_offset);
+    for (size_t i = begin; i != end; ++i) {
+      const char* chunk = data + record.data_offset + chunk_offsets[i];
+      const size_t chunk_size = chunk_offsets[i + 1] - chunk_offsets[i];
+      if (crc32c::Unmask(chunk_crcs[i]) != crc32c::Value(chunk, chunk_size))
+        return false;
+    }
+    return true;
+  };
+
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = record->metadata.GetHostSizeInBytes() /
+                      std::max<uint64_t>(record->num_chunks, 1);
+
+  auto corrupted = std::make_shared<std::atomic<bool>>(false);
+  auto result = MakeConstructedAsyncValueRef<Chain>(exec_ctx.host());
+  ParallelFor(exec_ctx).Execute(
+      record->num_chunks, ParallelFor::BlockSizes::FromCost(cost),
+      [verify = std::move(verify), corrupted](size_t begin, size_t end) {
+        if (!verify(begin, end)) corrupted->store(true);
+      },
+      [result = result.CopyRef(), corrupted, index]() {
+        if (corrupted->load()) {
+          result.SetError(
+              StrCat("checksum mismatch in tensor at index ", index));
+        } else {
+          result.SetStateConcrete();
+        }
+      });
+  return result;
+}
+
+Expected<DenseHostTensor> MapDHTFromBTF(const std::string& path,
+                                        uint64_t index, DType dtype,
+                                        int rank) {
+  auto file = MappedBTFFile::Open(path);
+  if (!file) return file.takeError();
+
+  auto dht = file->ReadDHT(index);
+  if (!dht) return dht.takeError();
+
+  if (dht->dtype() != dtype) {
+    return MakeStringError("unexpected tensor dtype ", dht->dtype(),
+                           ". Expected dtype is ", dtype);
+  }
+  if (dht->shape().GetRank() != rank) {
+    return MakeStringError("unexpected tensor rank ", dht->shape().GetRank(),
+                           ". Expected rank is ", rank);
+  }
+  return dht;
+}
+
 Error WriteTensorsToBTF(std::ostream* stream, ArrayRef<const Tensor*> tensors) {
   const uint64_t num_tensors = tensors.size();
   if (!WriteStream(stream, &num_tensors, 1)) {
@@ -141,4 +388,152 @@ Error WriteTensorsToBTF(std::ostream* stream, ArrayRef<const Tensor*> tensors) {
   return Error::success();
 }
 
+AsyncValueRef<Chain> WriteChunkedTensorsToBTF(
+    const std::string& path, ArrayRef<const DenseHostTensor*> tensors,
+    size_t chunk_size, const ExecutionContext& exec_ctx) {
+  assert(chunk_size > 0);
+
+  // A chunked record with the location of its chunks in the output file.
+  struct ChunkedRecord {
+    DenseHostTensor dht;
+    uint64_t offset;
+    uint64_t data_offset;
+    uint64_t crcs_offset;
+    // Index of the first chunk of the record among the chunks of all records.
+    uint64_t first_chunk;
+  };
+
+  // Lay out the file upfront, so that the chunks can be written in any order.
+  std::vector<ChunkedRecord> records;
+  records.reserve(tensors.size());
+  uint64_t offset = (1 + tensors.size()) * sizeof(uint64_t);
+  uint64_t num_chunks = 0;
+  for (const DenseHostTensor* dht : tensors) {
+    auto dtype = btf::ToTensorDType(dht->dtype().kind());
+    if (!dtype) return EmitErrorAsync(exec_ctx, dtype.takeError());
+    const size_t nbytes = dht->DataSizeInBytes();
+    const uint64_t record_chunks = (nbytes + chunk_size - 1) / chunk_size;
+    const uint64_t tables_offset = offset + sizeof(btf::TensorHeader) +
+                                   dht->shape().GetRank() * sizeof(uint64_t);
+    const uint64_t crcs_offset =
+        tables_offset + (record_chunks + 2) * sizeof(uint64_t);
+    const uint64_t tables_end = crcs_offset + record_chunks * sizeof(uint32_t);
+    const uint64_t data_offset = tables_end + Pad(tables_end);
+    records.push_back(
+        {dht->CopyRef(), offset, data_offset, crcs_offset, num_chunks});
+    offset = data_offset + nbytes + Pad(nbytes);
+    num_chunks += record_chunks;
+  }
+  const uint64_t file_size = offset;
+
+  auto file = llvm::sys::fs::openNativeFileForReadWrite(
+      path, llvm::sys::fs::CD_CreateAlways, llvm::sys::fs::OF_None);
+  if (!file) {
+    llvm::consumeError(file.takeError());
+    return EmitErrorAsync(exec_ctx,
+                          StrCat("failed to open file ", path, " for writing"));
+  }
+  auto close_file =
+      llvm::make_scope_exit([&] { llvm::sys::fs::closeFile(*file); });
+
+  if (auto ec = llvm::sys::fs::resize_file(*file, file_size)) {
+    return EmitErrorAsync(
+        exec_ctx, StrCat("failed to resize file ", path, ": ", ec.message()));
+  }
+  std::error_code ec;
+  auto region = std::make_unique<llvm::sys::fs::mapped_file_region>(
+      *file, llvm::sys::fs::mapped_file_region::readwrite, file_size,
+      /*offset=*/0, ec);
+  if (ec) {
+    return EmitErrorAsync(
+        exec_ctx, StrCat("failed to map file ", path, ": ", ec.message()));
+  }
+
+  // Write the metadata serially, it is small compared to the tensor data.
+  char* data = region->data();
+  auto write = [&](uint64_t offset, const void* value, size_t n) {
+    std::memcpy(data + offset, value, n);
+  };
+  const uint64_t num_tensors = tensors.size();
+  write(0, &num_tensors, sizeof(num_tensors));
+  for (size_t i = 0; i != records.size(); ++i) {
+    const ChunkedRecord& record = records[i];
+    const TensorShape& shape = record.dht.shape();
+    write((i + 1) * sizeof(uint64_t), &record.offset, sizeof(uint64_t));
+
+    btf::TensorHeader header = {};
+    header.rank = static_cast<uint64_t>(shape.GetRank());
+    header.dtype = *btf::ToTensorDType(record.dht.dtype().kind());
+    header.layout = btf::TensorLayout::kRMD_CHUNKED;
+    uint64_t pos = record.offset;
+    write(pos, &header, sizeof(header));
+    pos += sizeof(header);
+    for (int dim = 0; dim < shape.GetRank(); ++dim) {
+      const uint64_t size = shape.GetDimensionSize(dim);
+      write(pos, &size, sizeof(size));
+      pos += sizeof(size);
+    }
+
+    const uint64_t nbytes = record.dht.DataSizeInBytes();
+    const uint64_t record_chunks = (nbytes + chunk_size - 1) / chunk_size;
+    write(pos, &record_chunks, sizeof(record_chunks));
+    pos += sizeof(record_chunks);
+    for (uint64_t chunk = 0; chunk <= record_chunks; ++chunk) {
+      const uint64_t chunk_offset =
+        std::min<uint64_t>(chunk * chunk_size, nbytes);
+      write(pos, &chunk_offset, sizeof(chunk_offset));
+      pos += sizeof(chunk_offset);
+    }
+    // Zero the paddings, so that the file content is deterministic.
+    const uint64_t tables_end =
+        record.crcs_offset + record_chunks * sizeof(uint32_t);
+    std::memset(data + tables_end, 0, record.data_offset - tables_end);
+    const uint64_t data_end = record.data_offset + nbytes;
+    std::memset(data + data_end, 0, Pad(nbytes));
+  }
+
+  // Copy and checksum the chunks of all tensors in parallel.
+  ParallelFor::Cost cost;
+  cost.bytes_loaded = chunk_size;
+  cost.bytes_stored = chunk_size;
+
+  // The region outlives all tasks, and is unmapped by `on_done` so that the
+  // data is written back to the file before the result becomes available.
+  auto result = MakeConstructedAsyncValueRef<Chain>(exec_ctx.host());
+  auto write_chunks = [records = std::move(records), data, chunk_size](
+                          size_t begin, size_t end) {
+    // The record of chunk `begin` is the last one starting at or before it.
+    // Records are sorted by their first chunk.
+    auto record = std::prev(std::upper_bound(
+        records.begin(), records.end(), begin,
+        [](uint64_t chunk, const ChunkedRecord& record) {
+          return chunk < record.first_chunk;
+        }));
+    for (size_t i = begin; i != end; ++i) {
+      while (std::next(record) != records.end() &&
+             std::next(record)->first_chunk <= i)
+        ++record;
+      const uint64_t chunk = i - record->first_chunk;
+      const uint64_t chunk_offset = chunk * chunk_size;
+      const size_t size = std::min<uint64_t>(
+          chunk_size, record->dht.DataSizeInBytes() - chunk_offset);
+      char* dst = data + record->data_offset + chunk_offset;
+      std::memcpy(dst,
+                  static_cast<const char*>(record->dht.data()) + chunk_offset,
+                  size);
+      const uint32_t crc = crc32c::Mask(crc32c::Value(dst, size));
+      std::memcpy(data + record->crcs_offset + chunk * sizeof(uint32_t), &crc,
+                  sizeof(crc));
+    }
+  };
+  ParallelFor(exec_ctx).Execute(
+      num_chunks, ParallelFor::BlockSizes::FromCost(cost),
+      std::move(write_chunks),
+      [result = result.CopyRef(), region = std::move(region)]() mutable {
+        region.reset();
+        result.SetStateConcrete();
+      });
+  return result;
+}
+
 }  // namespace tfrt
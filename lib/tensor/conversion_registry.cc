@@ -49,16 +49,22 @@ TensorConversionFn TensorConversionFnRegistry::GetTensorConversionFn(
   return it == conversion_fn_map_.end() ? nullptr : it->second;
 }
 
+TensorConversionFn GetTensorConversionFn(HostContext* host,
+                                         TensorType src_tensor_type,
+                                         TensorType dst_tensor_type) {
+  auto& shared_ctx =
+      host->GetOrCreateSharedContext<TensorConversionFnRegistryContext>();
+  assert(shared_ctx.registry && "does not have a TensorConversionFnRegistry");
+  return shared_ctx.registry->GetTensorConversionFn(
+      {src_tensor_type, dst_tensor_type});
+}
+
 AsyncValueRef<Tensor> ConvertTensor(const ExecutionContext& exec_ctx,
                                     const Tensor& tensor, const Device& src,
                                     const Device& dst,
                                     TensorType dst_tensor_type) {
-  auto* host = exec_ctx.host();
-  auto& shared_ctx =
-      host->GetOrCreateSharedContext<TensorConversionFnRegistryContext>();
-  assert(shared_ctx.registry && "does not have a TensorConversionFnRegistry");
-  auto conversion_fn = shared_ctx.registry->GetTensorConversionFn(
-      {tensor.tensor_type(), dst_tensor_type});
+  auto conversion_fn = GetTensorConversionFn(
+      exec_ctx.host(), tensor.tensor_type(), dst_tensor_type);
 
   if (!conversion_fn) {
     return EmitErrorAsync(exec_ctx,
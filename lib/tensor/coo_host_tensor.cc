@@ -16,6 +16,8 @@
 
 #include "tfrt/tensor/coo_host_tensor.h"
 
+#include <cstring>
+
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include "tfrt/host_context/async_value_ref.h"
@@ -30,25 +32,27 @@
 namespace tfrt {
 
 namespace {
+// Scatters the elements of `values` to the row major offsets of `indices` in
+// `data`, a buffer of `shape`. Later duplicates of an index overwrite earlier
+// ones.
 template <typename DType>
-void ConvertToDHTTensorHelper(const DenseHostTensor &indices,
-                              const DenseHostTensor &values,
-                              DenseHostTensor *result_tensor) {
-  auto result_tensor_view = MutableDHTArrayView<DType>(result_tensor);
-  const TensorMetadata &result_metadata = result_tensor->metadata();
-  const auto &result_shape = result_metadata.shape;
-  result_tensor_view.Fill(DType(0));
+void ScatterToDHTHelper(const DenseHostTensor &indices,
+                        const DenseHostTensor &values, const TensorShape &shape,
+                        void *data) {
+  const int rank = shape.GetRank();
+  SmallVector<ssize_t, 4> strides;
+  shape.GetStrides(&strides);
+
+  auto *result = static_cast<DType *>(data);
   auto indices_view = DHTIndexableView<int64_t, 2>(&indices);
   auto values_view = DHTIndexableView<DType, 1>(&values);
   for (int i = 0, e = values_view.FixedShape().GetNumElements(); i != e; ++i) {
     size_t offset = 0;
-    size_t stride = 1;
-    for (int j = result_shape.GetRank() - 1; j >= 0; --j) {
-      assert(indices_view.ElementAt(i, j) < result_shape.GetDimensionSize(j));
-      offset += stride * indices_view.ElementAt(i, j);
-      stride *= result_shape.GetDimensionSize(j);
+    for (int j = 0; j != rank; ++j) {
+      assert(indices_view.ElementAt(i, j) < shape.GetDimensionSize(j));
+      offset += strides[j] * indices_view.ElementAt(i, j);
     }
-    result_tensor_view[offset] = values_view.ElementAt(i);
+    result[offset] = values_view.ElementAt(i);
   }
 }
 }  // namespace
@@ -107,28 +111,29 @@ ConvertCooHostTensorToScalarHostTensor(const CooHostTensor &coo,
 static AsyncValueRef<DenseHostTensor> ConvertCooHostTensorToDenseHostTensor(
     const CooHostTensor &tensor, const CpuDevice &src, const CpuDevice &dst,
     const ExecutionContext &exec_ctx) {
-  auto *host = exec_ctx.host();
-  auto result = MakeUnconstructedAsyncValueRef<DenseHostTensor>(host);
-  auto result_alloc =
-      DenseHostTensor::CreateUninitialized(tensor.metadata(), host);
-  if (!result_alloc) {
-    return MakeErrorAsyncValueRef(
-        host, "out of memory converting coo tensor to dht tensor");
-  }
-  auto &result_tensor = result_alloc.getValue();
-
-  switch (tensor.dtype().kind()) {
-    default:
-      llvm_unreachable("can't happen");
-#define DTYPE_NUMERIC(ENUM)                                   \
-  case DType::ENUM:                                           \
-    ConvertToDHTTensorHelper<TypeForDTypeKind<DType::ENUM>>(  \
-        *tensor.Indices(), *tensor.Values(), &result_tensor); \
+  // The dense result is zero filled in parallel, and the values are scattered
+  // serially afterwards to keep the order of duplicate indices.
+  auto element_size = tensor.dtype().GetHostSize();
+  return ConvertToDenseHostTensorInParallel(
+      tensor.metadata(), tensor.NumElements(), element_size,
+      [element_size](void *data, size_t begin, size_t end) {
+        std::memset(static_cast<char *>(data) + begin * element_size, 0,
+                    (end - begin) * element_size);
+      },
+      exec_ctx,
+      [metadata = tensor.metadata(), indices = tensor.Indices()->CopyRef(),
+       values = tensor.Values()->CopyRef()](void *data) {
+        switch (metadata.dtype.kind()) {
+          default:
+            llvm_unreachable("can't happen");
+#define DTYPE_NUMERIC(ENUM)                                  \
+  case DType::ENUM:                                          \
+    ScatterToDHTHelper<TypeForDTypeKind<DType::ENUM>>(       \
+        indices, values, metadata.shape, data);              \
     break;
 #include "tfrt/dtype/dtype.def"  // NOLINT
-  }
-  result.emplace(std::move(result_tensor));
-  return result;
+        }
+      });
 }
 
 void RegisterCooHostTensorConversionFn(TensorConversionFnRegistry *registry) {
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the CsrHostTensor class.
+
+#include "tfrt/tensor/csr_host_tensor.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/device.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/conversion_utils.h"
+#include "tfrt/tensor/coo_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+
+namespace {
+
+// Writes the rows [begin, end) of `csr` to `data`, a row major buffer of the
+// dense tensor.
+void CopyRowsToDense(const CsrHostTensor& csr, void* data, size_t begin,
+                     size_t end) {
+  const size_t element_size = csr.dtype().GetHostSize();
+  const size_t row_bytes = csr.NumCols() * element_size;
+  auto* dst = static_cast<char*>(data);
+  std::memset(dst + begin * row_bytes, 0, (end - begin) * row_bytes);
+
+  auto* row_ptrs = static_cast<const int64_t*>(csr.RowPtrs()->data());
+  auto* col_indices = static_cast<const int64_t*>(csr.ColIndices()->data());
+  auto* values = static_cast<const char*>(csr.Values()->data());
+  for (size_t row = begin; row < end; ++row) {
+    char* dst_row = dst + row * row_bytes;
+    for (int64_t i = row_ptrs[row], e = row_ptrs[row + 1]; i != e; ++i)
+      std::memcpy(dst_row + col_indices[i] * element_size,
+                  values + i * element_size, element_size);
+  }
+}
+
+// The buffers of a CSR tensor that is being constructed.
+struct CsrBuffers {
+  int64_t* row_ptrs() { return static_cast<int64_t*>(row_ptrs_dht.data()); }
+  int64_t* col_indices() {
+    return static_cast<int64_t*>(col_indices_dht.data());
+  }
+  char* values() { return static_cast<char*>(values_dht.data()); }
+
+  CsrHostTensor Build(const TensorMetadata& metadata) && {
+    return CsrHostTensor(metadata.shape, metadata.dtype,
+                         std::move(row_ptrs_dht), std::move(col_indices_dht),
+                         std::move(values_dht));
+  }
+
+  DenseHostTensor row_ptrs_dht;
+  DenseHostTensor col_indices_dht;
+  DenseHostTensor values_dht;
+};
+
+// Allocates the buffers of a CSR tensor with `num_nonzeros` elements.
+Expected<CsrBuffers> AllocateCsrBuffers(const TensorMetadata& metadata,
+                                        ssize_t num_nonzeros,
+                                        HostContext* host) {
+  if (metadata.shape.GetRank() != 2)
+    return MakeStringError("CSR tensor must be rank 2, got shape ",
+                           metadata.shape);
+
+  auto row_ptrs = DenseHostTensor::CreateUninitialized<int64_t>(
+      TensorShape(metadata.shape.GetDimensionSize(0) + 1), host);
+  auto col_indices = DenseHostTensor::CreateUninitialized<int64_t>(
+      TensorShape(num_nonzeros), host);
+  auto values = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(metadata.dtype, TensorShape(num_nonzeros)), host);
+  if (!row_ptrs || !col_indices || !values)
+    return MakeStringError("out of memory allocating CSR tensor");
+
+  return CsrBuffers{std::move(row_ptrs.getValue()),
+                    std::move(col_indices.getValue()),
+                    std::move(values.getValue())};
+}
+
+}  // namespace
+
+void CsrHostTensor::Print(raw_ostream& os) const {
+  os << "CsrHostTensor dtype = " << dtype() << ", shape = " << shape();
+  os << ", row_ptrs = [";
+  llvm::interleaveComma(DHTArrayView<int64_t>(&row_ptrs_).Elements(), os);
+  os << "], col_indices = [";
+  llvm::interleaveComma(DHTArrayView<int64_t>(&col_indices_).Elements(), os);
+  os << "], values = [";
+
+  auto element_size = dtype().GetHostSize();
+  auto* data_ptr = static_cast<const char*>(values_.data());
+  for (ssize_t i = 0, e = values_.NumElements(); i != e; ++i) {
+    if (i != 0) os << ", ";
+    dtype().Print(data_ptr + i * element_size, os);
+  }
+  os << "]\n";
+}
+
+Expected<CsrHostTensor> CopyCooHostTensorToCsrHostTensor(
+    const CooHostTensor& coo, HostContext* host) {
+  const ssize_t num_nonzeros = coo.Values()->NumElements();
+  auto buffers = AllocateCsrBuffers(coo.metadata(), num_nonzeros, host);
+  if (!buffers) return buffers.takeError();
+
+  const ssize_t num_rows = coo.shape().GetDimensionSize(0);
+  const ssize_t num_cols = coo.shape().GetDimensionSize(1);
+  DHTIndexableView<int64_t, 2> indices(coo.Indices());
+  int64_t* row_ptrs = buffers->row_ptrs();
+  int64_t* col_indices = buffers->col_indices();
+  char* values = buffers->values();
+  auto* coo_values = static_cast<const char*>(coo.Values()->data());
+  const size_t element_size = coo.dtype().GetHostSize();
+
+  // Counting sort of the elements by row, which keeps the order of the
+  // elements within a row.
+  std::fill(row_ptrs, row_ptrs + num_rows + 1, 0);
+  for (ssize_t i = 0; i != num_nonzeros; ++i) {
+    int64_t row = indices.ElementAt(i, 0);
+    int64_t col = indices.ElementAt(i, 1);
+    if (row < 0 || row >= num_rows || col < 0 || col >= num_cols)
+      return MakeStringError("index [", row, ", ", col,
+                             "] is out of bounds of ", coo.shape());
+    ++row_ptrs[row + 1];
+  }
+  for (ssize_t row = 0; row != num_rows; ++row)
+    row_ptrs[row + 1] += row_ptrs[row];
+
+  SmallVector<int64_t, 16> next(row_ptrs, row_ptrs + num_rows);
+  for (ssize_t i = 0; i != num_nonzeros; ++i) {
+    int64_t pos = next[indices.ElementAt(i, 0)]++;
+    col_indices[pos] = indices.ElementAt(i, 1);
+    std::memcpy(values + pos * element_size, coo_values + i * element_size,
+                element_size);
+  }
+
+  return std::move(*buffers).Build(coo.metadata());
+}
+
+Expected<CsrHostTensor> CopyDenseHostTensorToCsrHostTensor(
+    const DenseHostTensor& dht, HostContext* host) {
+  if (dht.shape().GetRank() != 2)
+    return MakeStringError("CSR tensor must be rank 2, got shape ",
+                           dht.shape());
+
+  const ssize_t num_rows = dht.shape().GetDimensionSize(0);
+  const ssize_t num_cols = dht.shape().GetDimensionSize(1);
+  const size_t element_size = dht.dtype().GetHostSize();
+  auto* data = static_cast<const char*>(dht.data());
+  SmallVector<char, 16> zero(element_size, 0);
+  auto is_nonzero = [&](ssize_t i) {
+    return std::memcmp(data + i * element_size, zero.data(), element_size) != 0;
+  };
+
+  ssize_t num_nonzeros = 0;
+  for (ssize_t i = 0, e = dht.NumElements(); i != e; ++i)
+    num_nonzeros += is_nonzero(i);
+
+  auto buffers = AllocateCsrBuffers(dht.metadata(), num_nonzeros, host);
+  if (!buffers) return buffers.takeError();
+
+  int64_t* row_ptrs = buffers->row_ptrs();
+  int64_t* col_indices = buffers->col_indices();
+  char* values = buffers->values();
+
+  int64_t pos = 0;
+  for (ssize_t row = 0; row != num_rows; ++row) {
+    row_ptrs[row] = pos;
+    for (ssize_t col = 0; col != num_cols; ++col) {
+      ssize_t i = row * num_cols + col;
+      if (!is_nonzero(i)) continue;
+      col_indices[pos] = col;
+      std::memcpy(values + pos * element_size, data + i * element_size,
+                  element_size);
+      ++pos;
+    }
+  }
+  row_ptrs[num_rows] = pos;
+
+  return std::move(*buffers).Build(dht.metadata());
+}
+
+llvm::Optional<DenseHostTensor> CopyCsrHostTensorToDenseHostTensor(
+    const CsrHostTensor& csr, HostContext* host) {
+  auto dht = DenseHostTensor::CreateUninitialized(csr.metadata(), host);
+  if (!dht) return llvm::None;
+  CopyRowsToDense(csr, dht->data(), 0, csr.NumRows());
+  return dht;
+}
+
+static AsyncValueRef<DenseHostTensor> ConvertCsrHostTensorToDenseHostTensor(
+    const CsrHostTensor& tensor, const CpuDevice& src, const CpuDevice& dst,
+    const ExecutionContext& exec_ctx) {
+  // Rows are independent, so duplicate column indices within a row are still
+  // written in order when rows are converted in parallel.
+  return ConvertToDenseHostTensorInParallel(
+      tensor.metadata(), tensor.NumRows(),
+      tensor.NumCols() * tensor.dtype().GetHostSize(),
+      [csr = tensor.CopyRef()](void* data, size_t begin, size_t end) {
+        CopyRowsToDense(csr, data, begin, end);
+      },
+      exec_ctx);
+}
+
+static AsyncValueRef<CooHostTensor> ConvertCsrHostTensorToCooHostTensor(
+    const CsrHostTensor& tensor, const CpuDevice& src, const CpuDevice& dst,
+    const ExecutionContext& exec_ctx) {
+  auto* host = exec_ctx.host();
+  const ssize_t num_nonzeros = tensor.NumNonZeros();
+  auto indices = DenseHostTensor::CreateUninitialized<int64_t>(
+      TensorShape({num_nonzeros, 2}), host);
+  if (!indices)
+    return MakeErrorAsyncValueRef(host, "out of memory converting tensor");
+
+  MutableDHTIndexableView<int64_t, 2> indices_view(indices.getPointer());
+  DHTArrayView<int64_t> row_ptrs(tensor.RowPtrs());
+  DHTArrayView<int64_t> col_indices(tensor.ColIndices());
+  for (ssize_t row = 0, e = tensor.NumRows(); row != e; ++row) {
+    for (int64_t i = row_ptrs[row]; i != row_ptrs[row + 1]; ++i) {
+      indices_view.ElementAt(i, 0) = row;
+      indices_view.ElementAt(i, 1) = col_indices[i];
+    }
+  }
+
+  // The values are in the same order in both formats.
+  return MakeAvailableAsyncValueRef<CooHostTensor>(
+      host, tensor.shape(), tensor.dtype(), std::move(indices.getValue()),
+      tensor.Values()->CopyRef());
+}
+
+static Expected<CsrHostTensor> ConvertCooHostTensorToCsrHostTensor(
+    const CooHostTensor& tensor, const CpuDevice& src, const CpuDevice& dst,
+    const ExecutionContext& exec_ctx) {
+  return CopyCooHostTensorToCsrHostTensor(tensor, exec_ctx.host());
+}
+
+static Expected<CsrHostTensor> ConvertDenseHostTensorToCsrHostTensor(
+    const DenseHostTensor& tensor, const CpuDevice& src, const CpuDevice& dst,
+    const ExecutionContext& exec_ctx) {
+  return CopyDenseHostTensorToCsrHostTensor(tensor, exec_ctx.host());
+}
+
+void RegisterCsrHostTensorConversionFn(TensorConversionFnRegistry* registry) {
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertCsrHostTensorToDenseHostTensor));
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertCsrHostTensorToCooHostTensor));
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertCooHostTensorToCsrHostTensor));
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertDenseHostTensorToCsrHostTensor));
+}
+
+}  // namespace tfrt
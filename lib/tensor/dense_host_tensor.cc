@@ -16,6 +16,7 @@
 
 #include "tfrt/tensor/dense_host_tensor.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
 
@@ -26,6 +27,7 @@
 #include "tfrt/host_context/device.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/tensor/conversion_registry.h"
 #include "tfrt/tensor/conversion_utils.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
@@ -54,6 +56,11 @@ llvm::Optional<DenseHostTensor> DenseHostTensor::CreateUninitialized(
   return CreateUninitialized(metadata, host->allocator());
 }
 
+llvm::Optional<DenseHostTensor> DenseHostTensor::CreateUninitialized(
+    const TensorMetadata& metadata, const ExecutionContext& exec_ctx) {
+  return CreateUninitialized(metadata, exec_ctx.allocator());
+}
+
 AsyncValueRef<DenseHostTensor> DenseHostTensor::MakeConstructedAsyncValueRef(
     const TensorMetadata& metadata, HostContext* host) {
   auto dht = CreateUninitialized(metadata, host);
@@ -102,30 +109,52 @@ bool operator==(const DenseHostTensor& a, const DenseHostTensor& b) {
              0;
 }
 
+AsyncValueRef<DenseHostTensor> ConvertToDenseHostTensorInParallel(
+    const TensorMetadata& metadata, size_t size, size_t bytes_per_index,
+    llvm::unique_function<void(void* data, size_t begin, size_t end)> compute,
+    const ExecutionContext& exec_ctx,
+    llvm::unique_function<void(void* data)> on_done) {
+  auto* host = exec_ctx.host();
+  auto result_alloc = DenseHostTensor::CreateUninitialized(metadata, host);
+  if (!result_alloc)
+    return MakeErrorAsyncValueRef(host, "out of memory converting tensor");
+
+  auto result = MakeUnconstructedAsyncValueRef<DenseHostTensor>(host);
+  void* data = result_alloc->data();
+  size_t min_block_size =
+      std::max<size_t>(1, kParallelConversionBlockBytes /
+                              std::max<size_t>(1, bytes_per_index));
+
+  ParallelFor(exec_ctx).Execute(
+      size, ParallelFor::BlockSizes::Min(min_block_size),
+      [data, compute = std::move(compute)](size_t begin, size_t end) mutable {
+        compute(data, begin, end);
+      },
+      [data, on_done = std::move(on_done),
+       result_tensor = std::move(result_alloc.getValue()),
+       result = result.CopyRef()]() mutable {
+        if (on_done) on_done(data);
+        result.emplace(std::move(result_tensor));
+      });
+
+  return result;
+}
+
 static AsyncValueRef<DenseHostTensor> ConvertDenseHostTensorToDenseHostTensor(
     const DenseHostTensor& tensor, const CpuDevice& src, const CpuDevice& dst,
     const ExecutionContext& exec_ctx) {
-  auto* host = exec_ctx.host();
   // We need to make a copy of the data, because the source and result
   // buffers are logically independent.
-  auto result = MakeUnconstructedAsyncValueRef<DenseHostTensor>(host);
-
-  auto result_alloc =
-      DenseHostTensor::CreateUninitialized(tensor.metadata(), host);
-  if (!result_alloc)
-    return MakeErrorAsyncValueRef(host, "out of memory copying tensor");
-
-  auto& result_tensor = result_alloc.getValue();
-
-  // TODO(tfrt-devs): This could be done in parallel in the background for
-  // large tensors.  We could also detect when the tensor is full of broadcasted
+  // TODO(tfrt-devs): We could detect when the tensor is full of broadcasted
   // data and convert to ScalarHostTensor.
-
-  // Copy over the data.
-  memcpy(result_tensor.data(), tensor.data(), tensor.DataSizeInBytes());
-
-  result.emplace(std::move(result_tensor));
-  return result;
+  return ConvertToDenseHostTensorInParallel(
+      tensor.metadata(), tensor.DataSizeInBytes(), /*bytes_per_index=*/1,
+      [src = tensor.buffer().CopyRef()](void* data, size_t begin, size_t end) {
+        std::memcpy(static_cast<char*>(data) + begin,
+                    static_cast<const char*>(src->data()) + begin,
+                    end - begin);
+      },
+      exec_ctx);
 }
 
 void RegisterDenseHostTensorConversionFn(TensorConversionFnRegistry* registry) {
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the PackedStringHostTensor class.
+
+#include "tfrt/tensor/packed_string_host_tensor.h"
+
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/conversion_utils.h"
+#include "tfrt/tensor/string_host_tensor.h"
+
+namespace tfrt {
+
+llvm::Optional<PackedStringHostTensor> PackedStringHostTensor::CreateScalar(
+    std::string&& str, HostContext* host) {
+  auto offsets = HostBuffer::CreateUninitialized(
+      2 * sizeof(int64_t), alignof(int64_t), host->allocator());
+  if (!offsets) return llvm::None;
+  auto* offsets_data = static_cast<int64_t*>(offsets->data());
+  offsets_data[0] = 0;
+  offsets_data[1] = str.size();
+
+  // Keep the string on the heap, so that its characters don't move.
+  auto owned = std::make_unique<std::string>(std::move(str));
+  char* data = &(*owned)[0];
+  size_t size = owned->size();
+  auto bytes = HostBuffer::CreateFromExternal(
+      data, size, [owned = std::move(owned)](void*, size_t) {});
+
+  return PackedStringHostTensor(TensorShape({}), std::move(offsets),
+                                std::move(bytes));
+}
+
+void PackedStringHostTensor::Print(raw_ostream& os) const {
+  os << "PackedStringHostTensor shape = " << shape();
+
+  static constexpr ssize_t kThreshold = 32;
+  if (NumElements() > kThreshold) {
+    llvm::MD5 hash;
+    for (ssize_t i = 0, e = NumElements(); i != e; ++i)
+      hash.update(GetString(i));
+    llvm::MD5::MD5Result result;
+    hash.final(result);
+    os << ", md5sum = " << result.low();
+  }
+
+  os << ", values = [";
+  // Print at most 32 elements for a tensor.
+  for (ssize_t i = 0, e = std::min(kThreshold, NumElements()); i != e; ++i) {
+    if (i != 0) os << ", ";
+    os << '"' << GetString(i) << '"';
+  }
+
+  if (NumElements() > kThreshold) {
+    os << ", ... ";
+  }
+
+  os << ']';
+}
+
+// The buffers are immutable, so the result shares them with `tensor`.
+static PackedStringHostTensor
+ConvertPackedStringHostTensorToPackedStringHostTensor(
+    const PackedStringHostTensor& tensor, const CpuDevice& src,
+    const CpuDevice& dst, const ExecutionContext& exec_ctx) {
+  return tensor.CopyRef();
+}
+
+static Expected<StringHostTensor>
+ConvertPackedStringHostTensorToStringHostTensor(
+    const PackedStringHostTensor& tensor, const CpuDevice& src,
+    const CpuDevice& dst, const ExecutionContext& exec_ctx) {
+  auto result = StringHostTensor::CreateUninitialized(tensor.metadata(),
+                                                      exec_ctx.host());
+  if (!result) return MakeStringError("out of memory converting tensor");
+
+  auto strings = result->strings();
+  for (ssize_t i = 0, e = tensor.NumElements(); i != e; ++i) {
+    string_view str = tensor.GetString(i);
+    strings[i].assign(str.data(), str.size());
+  }
+  return std::move(*result);
+}
+
+static Expected<PackedStringHostTensor>
+ConvertStringHostTensorToPackedStringHostTensor(
+    const StringHostTensor& tensor, const CpuDevice& src, const CpuDevice& dst,
+    const ExecutionContext& exec_ctx) {
+  auto result = PackedStringHostTensor::Create(tensor.shape(), tensor.strings(),
+                                               exec_ctx.host());
+  if (!result) return MakeStringError("out of memory converting tensor");
+  return std::move(*result);
+}
+
+void RegisterPackedStringHostTensorConversionFn(
+    TensorConversionFnRegistry* registry) {
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertPackedStringHostTensorToPackedStringHostTensor));
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertPackedStringHostTensorToStringHostTensor));
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertStringHostTensorToPackedStringHostTensor));
+}
+
+}  // namespace tfrt
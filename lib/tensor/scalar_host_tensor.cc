@@ -69,25 +69,12 @@ ConvertScalarHostTensorToScalarHostTensor(const AnyScalarHostTensor& tensor,
   }
 }
 
-llvm::Optional<DenseHostTensor> CopyScalarHostTensorToDenseHostTensor(
-    const AnyScalarHostTensor& tensor, const ExecutionContext& exec_ctx) {
-  auto* host = exec_ctx.host();
-  auto result_alloc =
-      DenseHostTensor::CreateUninitialized(tensor.metadata(), host);
-
-  if (!result_alloc) return llvm::None;
-
-  auto& result_tensor = result_alloc.getValue();
-
-  auto num_elements = result_tensor.NumElements();
-  auto element_size = tensor.dtype().GetHostSize();
-  auto* dest_data = result_tensor.data();
-  auto* src_data = tensor.data();
-
-  // Fill the DenseHostTensor with the scalar value.  We specialize for a few
-  // common sizes here to allow the compiler to specialize for us.
-  // TODO(tfrt-devs): This could be done in parallel in the background for
-  // large tensors.
+// Fills `num_elements` elements of `element_size` bytes at `dest_data` with
+// the value at `src_data`.
+static void FillWithScalar(void* dest_data, const void* src_data,
+                           size_t element_size, ssize_t num_elements) {
+  // We specialize for a few common sizes here to allow the compiler to
+  // specialize for us.
   switch (element_size) {
     default:
       // Fully generic size.
@@ -115,6 +102,21 @@ llvm::Optional<DenseHostTensor> CopyScalarHostTensorToDenseHostTensor(
             *static_cast<const int64_t*>(src_data);
       break;
   }
+}
+
+llvm::Optional<DenseHostTensor> CopyScalarHostTensorToDenseHostTensor(
+    const AnyScalarHostTensor& tensor, const ExecutionContext& exec_ctx) {
+  auto* host = exec_ctx.host();
+  auto result_alloc =
+      DenseHostTensor::CreateUninitialized(tensor.metadata(), host);
+
+  if (!result_alloc) return llvm::None;
+
+  auto& result_tensor = result_alloc.getValue();
+
+  // Fill the DenseHostTensor with the scalar value.
+  FillWithScalar(result_tensor.data(), tensor.data(),
+                 tensor.dtype().GetHostSize(), result_tensor.NumElements());
 
   return result_alloc;
 }
@@ -122,15 +124,19 @@ llvm::Optional<DenseHostTensor> CopyScalarHostTensorToDenseHostTensor(
 static AsyncValueRef<DenseHostTensor> ConvertScalarHostTensorToDenseHostTensor(
     const AnyScalarHostTensor& tensor, const CpuDevice& src,
     const CpuDevice& dst, const ExecutionContext& exec_ctx) {
-  auto* host = exec_ctx.host();
-  auto result = MakeUnconstructedAsyncValueRef<DenseHostTensor>(host);
-
-  auto optional_dht = CopyScalarHostTensorToDenseHostTensor(tensor, exec_ctx);
-  if (!optional_dht)
-    return MakeErrorAsyncValueRef(host, "out of memory copying tensor");
-
-  result.emplace(std::move(optional_dht.getValue()));
-  return result;
+  // Large tensors are filled in parallel, so the value is copied out of
+  // `tensor`, which may be destroyed before the conversion completes.
+  auto element_size = tensor.dtype().GetHostSize();
+  auto* value_data = static_cast<const char*>(tensor.data());
+  SmallVector<char, 16> value(value_data, value_data + element_size);
+  return ConvertToDenseHostTensorInParallel(
+      tensor.metadata(), tensor.NumElements(), element_size,
+      [element_size, value = std::move(value)](void* data, size_t begin,
+                                               size_t end) {
+        FillWithScalar(static_cast<char*>(data) + begin * element_size,
+                       value.data(), element_size, end - begin);
+      },
+      exec_ctx);
 }
 
 void RegisterScalarHostTensorConversionFn(
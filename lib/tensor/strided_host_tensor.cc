@@ -0,0 +1,356 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the StridedHostTensor class.
+
+#include "tfrt/tensor/strided_host_tensor.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/device.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/conversion_utils.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+
+namespace {
+
+// Calls `fn` with the offset in elements from data() of the first element of
+// each row (i.e. the innermost dimension) of `tensor`, in row major order.
+template <typename Fn>
+void ForEachRow(const StridedHostTensor& tensor, Fn fn) {
+  if (tensor.NumElements() == 0) return;
+
+  const int rank = tensor.shape().GetRank();
+  if (rank <= 1) {
+    fn(0);
+    return;
+  }
+
+  SmallVector<ssize_t, 4> dims;
+  tensor.shape().GetDimensions(&dims);
+  ArrayRef<ssize_t> strides = tensor.strides();
+
+  SmallVector<ssize_t, 4> index(rank - 1, 0);
+  ssize_t offset = 0;
+  while (true) {
+    fn(offset);
+    // Advance the index of the outer dimensions.
+    int i = rank - 2;
+    for (; i >= 0; --i) {
+      offset += strides[i];
+      if (++index[i] < dims[i]) break;
+      offset -= strides[i] * dims[i];
+      index[i] = 0;
+    }
+    if (i < 0) return;
+  }
+}
+
+// Rows are gathered in tiles of kTileRows x kTileColumns elements, so that the
+// cache lines of the source read for one column of a tile are reused for the
+// next columns, e.g. when copying a transpose.
+constexpr ssize_t kTileRows = 16;
+constexpr ssize_t kTileColumns = 64;
+
+// Copies the rows [row_begin, row_end) of a view with `dims` and `strides` at
+// `src` to row major `dst`, where T is an integer type of the element size.
+template <typename T>
+void CopyRows(ArrayRef<ssize_t> dims, ArrayRef<ssize_t> strides,
+              const void* src, void* dst, ssize_t row_begin, ssize_t row_end) {
+  const int rank = dims.size();
+  const ssize_t row_size = rank == 0 ? 1 : dims[rank - 1];
+  const ssize_t row_stride = rank == 0 ? 0 : strides[rank - 1];
+
+  // Returns the offset in elements from `src` of the first element of `row`.
+  auto row_offset = [&](ssize_t row) {
+    ssize_t offset = 0;
+    for (int i = rank - 2; i >= 0; --i) {
+      offset += (row % dims[i]) * strides[i];
+      row /= dims[i];
+    }
+    return offset;
+  };
+
+  auto* src_data = static_cast<const T*>(src);
+  auto* dst_data = static_cast<T*>(dst) + row_begin * row_size;
+
+  if (row_stride == 1) {
+    for (ssize_t row = row_begin; row < row_end; ++row) {
+      std::memcpy(dst_data, src_data + row_offset(row), row_size * sizeof(T));
+      dst_data += row_size;
+    }
+    return;
+  }
+
+  ssize_t offsets[kTileRows];
+  for (ssize_t tile_row = row_begin; tile_row < row_end;
+       tile_row += kTileRows) {
+    const ssize_t num_rows = std::min(kTileRows, row_end - tile_row);
+    for (ssize_t r = 0; r < num_rows; ++r)
+      offsets[r] = row_offset(tile_row + r);
+
+    for (ssize_t tile_col = 0; tile_col < row_size; tile_col += kTileColumns) {
+      const ssize_t col_end = std::min(tile_col + kTileColumns, row_size);
+      for (ssize_t r = 0; r < num_rows; ++r) {
+        const T* src_row = src_data + offsets[r];
+        T* dst_row = dst_data + r * row_size;
+        for (ssize_t c = tile_col; c < col_end; ++c)
+          dst_row[c] = src_row[c * row_stride];
+      }
+    }
+    dst_data += num_rows * row_size;
+  }
+}
+
+// Calls CopyRows with an integer type of `element_size` bytes.
+void CopyRows(size_t element_size, ArrayRef<ssize_t> dims,
+              ArrayRef<ssize_t> strides, const void* src, void* dst,
+              ssize_t row_begin, ssize_t row_end) {
+  switch (element_size) {
+    case sizeof(uint8_t):
+      return CopyRows<uint8_t>(dims, strides, src, dst, row_begin, row_end);
+    case sizeof(uint16_t):
+      return CopyRows<uint16_t>(dims, strides, src, dst, row_begin, row_end);
+    case sizeof(uint32_t):
+      return CopyRows<uint32_t>(dims, strides, src, dst, row_begin, row_end);
+    case sizeof(uint64_t):
+      return CopyRows<uint64_t>(dims, strides, src, dst, row_begin, row_end);
+    default:
+      // Copy elements of other sizes (e.g. complex128) as multiple integers
+      // by appending a dimension.
+      assert(element_size % sizeof(uint64_t) == 0);
+      const ssize_t words = element_size / sizeof(uint64_t);
+      SmallVector<ssize_t, 5> word_dims(dims.begin(), dims.end());
+      SmallVector<ssize_t, 5> word_strides;
+      for (ssize_t stride : strides) word_strides.push_back(stride * words);
+      word_dims.push_back(words);
+      word_strides.push_back(1);
+      // Rows of the original view are now the outer rows of the last two
+      // dimensions.
+      const ssize_t row_size = dims.empty() ? 1 : dims.back();
+      return CopyRows<uint64_t>(word_dims, word_strides, src, dst,
+                                row_begin * row_size, row_end * row_size);
+  }
+}
+
+}  // namespace
+
+StridedHostTensor::StridedHostTensor(const TensorMetadata& metadata,
+                                     ArrayRef<ssize_t> strides, ssize_t offset,
+                                     RCReference<HostBuffer> data)
+    : HostTensor(metadata),
+      strides_(strides.begin(), strides.end()),
+      offset_(offset),
+      data_(std::move(data)) {
+  assert(strides_.size() == metadata.shape.GetRank());
+}
+
+StridedHostTensor::StridedHostTensor(const DenseHostTensor& tensor)
+    : HostTensor(tensor.metadata()), data_(tensor.buffer().CopyRef()) {
+  tensor.shape().GetStrides(&strides_);
+}
+
+bool StridedHostTensor::IsContiguous() const {
+  ssize_t expected_stride = 1;
+  for (int i = shape().GetRank() - 1; i >= 0; --i) {
+    ssize_t dim = shape().GetDimensionSize(i);
+    // The stride of a dimension of size 1 is never used.
+    if (dim == 1) continue;
+    if (dim == 0) return true;
+    if (strides_[i] != expected_stride) return false;
+    expected_stride *= dim;
+  }
+  return true;
+}
+
+Expected<StridedHostTensor> StridedHostTensor::Slice(
+    ArrayRef<ssize_t> begin, ArrayRef<ssize_t> sizes) const {
+  const int rank = shape().GetRank();
+  if (static_cast<int>(begin.size()) != rank ||
+      static_cast<int>(sizes.size()) != rank)
+    return MakeStringError("slice of rank ", begin.size(), " and ",
+                           sizes.size(), " does not match tensor of rank ",
+                           rank);
+
+  ssize_t offset = offset_;
+  for (int i = 0; i < rank; ++i) {
+    if (begin[i] < 0 || sizes[i] < 0 ||
+        begin[i] + sizes[i] > shape().GetDimensionSize(i))
+      return MakeStringError("slice [", begin[i], ", ", begin[i] + sizes[i],
+                             ") is out of bounds of dimension ", i, " of ",
+                             shape());
+    offset += begin[i] * strides_[i];
+  }
+
+  return StridedHostTensor(TensorMetadata(dtype(), sizes), strides_, offset,
+                           data_.CopyRef());
+}
+
+Expected<StridedHostTensor> StridedHostTensor::Transpose(
+    ArrayRef<int> perm) const {
+  const int rank = shape().GetRank();
+  if (static_cast<int>(perm.size()) != rank)
+    return MakeStringError("permutation of size ", perm.size(),
+                           " does not match tensor of rank ", rank);
+
+  SmallVector<bool, 4> seen(rank, false);
+  SmallVector<ssize_t, 4> dims(rank), strides(rank);
+  for (int i = 0; i < rank; ++i) {
+    int dim = perm[i];
+    if (dim < 0 || dim >= rank || seen[dim])
+      return MakeStringError("invalid permutation for tensor of rank ", rank);
+    seen[dim] = true;
+    dims[i] = shape().GetDimensionSize(dim);
+    strides[i] = strides_[dim];
+  }
+
+  return StridedHostTensor(TensorMetadata(dtype(), dims), strides, offset_,
+                           data_.CopyRef());
+}
+
+Expected<StridedHostTensor> StridedHostTensor::BroadcastTo(
+    const TensorShape& shape) const {
+  const int rank = this->shape().GetRank();
+  const int result_rank = shape.GetRank();
+  if (result_rank < rank)
+    return MakeStringError("can't broadcast ", this->shape(), " to ", shape);
+
+  // Dimensions are aligned at the innermost dimension. Missing and size 1
+  // dimensions are broadcast with stride 0.
+  SmallVector<ssize_t, 4> strides(result_rank, 0);
+  for (int i = 0; i < rank; ++i) {
+    int result_dim = result_rank - rank + i;
+    ssize_t dim = this->shape().GetDimensionSize(i);
+    if (dim == shape.GetDimensionSize(result_dim)) {
+      strides[result_dim] = strides_[i];
+    } else if (dim != 1) {
+      return MakeStringError("can't broadcast ", this->shape(), " to ", shape);
+    }
+  }
+
+  return StridedHostTensor(TensorMetadata(dtype(), shape), strides, offset_,
+                           data_.CopyRef());
+}
+
+llvm::Optional<DenseHostTensor> StridedHostTensor::ToDenseHostTensor(
+    HostContext* host) const {
+  const size_t element_size = dtype().GetHostSize();
+
+  if (IsContiguous()) {
+    auto buffer = HostBuffer::CreateFromExternal(
+        data_.CopyRef(), offset_ * element_size, NumElements() * element_size);
+    if (!buffer) return llvm::None;
+    return DenseHostTensor(metadata(), std::move(buffer));
+  }
+
+  auto result = DenseHostTensor::CreateUninitialized(metadata(), host);
+  if (!result) return llvm::None;
+
+  SmallVector<ssize_t, 4> dims;
+  shape().GetDimensions(&dims);
+  CopyRows(element_size, dims, strides_, data(), result->data(), 0,
+           NumRows());
+  return result;
+}
+
+ssize_t StridedHostTensor::NumRows() const {
+  const int rank = shape().GetRank();
+  if (rank == 0) return 1;
+  const ssize_t row_size = shape().GetDimensionSize(rank - 1);
+  return row_size == 0 ? 0 : NumElements() / row_size;
+}
+
+void StridedHostTensor::Print(raw_ostream& os) const {
+  os << "StridedHostTensor dtype = " << dtype() << ", shape = " << shape()
+     << ", strides = [";
+  llvm::interleaveComma(strides_, os);
+  os << "], offset = " << offset_;
+
+  // Print at most 32 elements for a tensor.
+  static const ssize_t kThreshold = 32;
+  const size_t element_size = dtype().GetHostSize();
+  const int rank = shape().GetRank();
+  const ssize_t row_size = rank == 0 ? 1 : shape().GetDimensionSize(rank - 1);
+  const ssize_t row_stride = rank == 0 ? 0 : strides_[rank - 1];
+  auto* src = static_cast<const char*>(data());
+
+  os << ", values = [";
+  ssize_t num_printed = 0;
+  ForEachRow(*this, [&](ssize_t offset) {
+    for (ssize_t i = 0; i < row_size && num_printed < kThreshold; ++i) {
+      if (num_printed++ != 0) os << ", ";
+      dtype().Print(src + (offset + i * row_stride) * element_size, os);
+    }
+  });
+  if (NumElements() > kThreshold) os << ", ... ";
+  os << ']';
+}
+
+static AsyncValueRef<DenseHostTensor> ConvertStridedHostTensorToDenseHostTensor(
+    const StridedHostTensor& tensor, const CpuDevice& src, const CpuDevice& dst,
+    const ExecutionContext& exec_ctx) {
+  auto* host = exec_ctx.host();
+  if (tensor.IsContiguous()) {
+    auto dht = tensor.ToDenseHostTensor(host);
+    if (!dht)
+      return MakeErrorAsyncValueRef(host, "out of memory copying tensor");
+    return MakeAvailableAsyncValueRef<DenseHostTensor>(
+        host, std::move(dht.getValue()));
+  }
+
+  // Large views are copied in parallel blocks of rows.
+  const size_t element_size = tensor.dtype().GetHostSize();
+  const int rank = tensor.shape().GetRank();
+  const ssize_t row_size = tensor.shape().GetDimensionSize(rank - 1);
+  return ConvertToDenseHostTensorInParallel(
+      tensor.metadata(), tensor.NumRows(), row_size * element_size,
+      [element_size, view = tensor.CopyRef()](void* data, size_t begin,
+                                               size_t end) {
+        SmallVector<ssize_t, 4> dims;
+        view.shape().GetDimensions(&dims);
+        CopyRows(element_size, dims, view.strides(), view.data(), data, begin,
+                 end);
+      },
+      exec_ctx);
+}
+
+static AsyncValueRef<StridedHostTensor>
+ConvertDenseHostTensorToStridedHostTensor(const DenseHostTensor& tensor,
+                                          const CpuDevice& src,
+                                          const CpuDevice& dst,
+                                          const ExecutionContext& exec_ctx) {
+  return MakeAvailableAsyncValueRef<StridedHostTensor>(exec_ctx.host(),
+                                                       tensor);
+}
+
+void RegisterStridedHostTensorConversionFn(
+    TensorConversionFnRegistry* registry) {
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertStridedHostTensorToDenseHostTensor));
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertDenseHostTensorToStridedHostTensor));
+}
+
+}  // namespace tfrt
@@ -19,6 +19,7 @@
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/host_context/sync_kernel_utils.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/tensor/packed_string_host_tensor.h"
 #include "tfrt/tensor/string_host_tensor.h"
 
 namespace tfrt {
@@ -54,6 +55,57 @@ static Expected<StringHostTensor> CreateUninitializedStringTensor(
   return std::move(*result);
 }
 
+// Creates a PackedStringHostTensor, copying the attribute values into a single
+// buffer.
+static Expected<PackedStringHostTensor> CreatePackedStringTensor(
+    ArrayAttribute<ssize_t> shape, AggregateAttr values,
+    const ExecutionContext& exec_ctx) {
+  TensorShape tensor_shape(shape.data());
+  if (tensor_shape.GetNumElements() != values.GetNumElements()) {
+    return MakeStringError("Shape mismatch");
+  }
+
+  SmallVector<string_view, 8> strings;
+  strings.reserve(values.GetNumElements());
+  for (int i = 0, e = values.GetNumElements(); i != e; ++i) {
+    strings.push_back(values.GetAttributeOfType<StringAttr>(i).GetValue());
+  }
+
+  auto result =
+      PackedStringHostTensor::Create(tensor_shape, strings, exec_ctx.host());
+  if (!result) {
+    return MakeStringError("Cannot allocate tensor");
+  }
+  return std::move(*result);
+}
+
+// Packs strings, e.g. records read by tfrt_data.tf_record_dataset, into a rank
+// 1 PackedStringHostTensor with one allocation for all of them.
+static Expected<PackedStringHostTensor> PackStrings(
+    RepeatedArguments<std::string> strings, const ExecutionContext& exec_ctx) {
+  auto result = PackedStringHostTensor::Create(
+      TensorShape(static_cast<ssize_t>(strings.size())), strings,
+      exec_ctx.host());
+  if (!result) {
+    return MakeStringError("Cannot allocate tensor");
+  }
+  return std::move(*result);
+}
+
+// Wraps a string, e.g. a record read by tfrt_data.tf_record_dataset, in a
+// scalar PackedStringHostTensor. The bytes are not copied if this kernel holds
+// the only reference to the string.
+static Expected<PackedStringHostTensor> StringToTensor(
+    Argument<std::string> str, const ExecutionContext& exec_ctx) {
+  std::string value = str.value()->IsUnique() ? std::move(*str) : *str;
+  auto result =
+      PackedStringHostTensor::CreateScalar(std::move(value), exec_ctx.host());
+  if (!result) {
+    return MakeStringError("Cannot allocate tensor");
+  }
+  return std::move(*result);
+}
+
 }  // namespace
 
 void RegisterStringHostTensorKernels(KernelRegistry* registry) {
@@ -63,6 +115,13 @@ void RegisterStringHostTensorKernels(KernelRegistry* registry) {
                           TFRT_SYNC_KERNEL(CreateStringTensor));
   registry->AddSyncKernel("tfrt_sht_sync.create_uninitialized_tensor",
                           TFRT_SYNC_KERNEL(CreateUninitializedStringTensor));
+  registry->AddKernel("tfrt_sht.create_packed_tensor",
+                      TFRT_KERNEL(CreatePackedStringTensor));
+  registry->AddSyncKernel("tfrt_sht_sync.create_packed_tensor",
+                          TFRT_SYNC_KERNEL(CreatePackedStringTensor));
+  registry->AddKernel("tfrt_sht.pack_strings", TFRT_KERNEL(PackStrings));
+  registry->AddKernel("tfrt_sht.string_to_tensor",
+                      TFRT_KERNEL(StringToTensor));
 }
 
 }  // namespace tfrt
@@ -21,6 +21,7 @@
 #include "tfrt/dtype/dtype.h"
 #include "tfrt/host_context/attribute_utils.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/byte_order.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/tensor/dense_host_tensor.h"
@@ -62,6 +63,19 @@ llvm::Expected<DenseHostTensor> DeserializeDenseHostTensorFromDenseAttr(
   return std::move(result_tensor);
 }
 
+llvm::Expected<DenseHostTensor> DeserializeDenseHostTensorFromDenseAttr(
+    const DenseAttribute& attr, HostContext* host) {
+  const DenseAttr& dense_attr = attr.get();
+  TensorMetadata md(DType(dense_attr.dtype()), dense_attr.shape());
+  if (reinterpret_cast<uintptr_t>(dense_attr.GetElements()) %
+          md.dtype.GetHostAlignment() ==
+      0) {
+    if (auto buffer = attr.GetElementsBuffer())
+      return DenseHostTensor(md, std::move(buffer));
+  }
+  return DeserializeDenseHostTensorFromDenseAttr(dense_attr, host);
+}
+
 TensorMetadata CreateTensorMetadata(const DenseAttr& attr) {
   return CreateDenseView(attr).metadata();
 }
@@ -57,16 +57,16 @@ bool TensorShape::operator==(const TensorShape& other) const {
   // We assume that two identical shapes have the same representation kind.
   if (GetRepresentationKind() != other.GetRepresentationKind()) return false;
   if (!IsRepresentationExternal()) {
-    // Both rep16 and rep32 have the same size and share the same memory, so
-    // either representation is sufficient when comparing the block of memory.
+    // All the inline representations have the same size and share the same
+    // memory, so any of them is sufficient when comparing the block of memory.
     return memcmp(&representation_, &other.representation_,
                   sizeof(representation_)) == 0;
   }
   if (GetRank() != other.GetRank()) return false;
-  return std::equal(representation_.rep_external.dims,
-                    representation_.rep_external.dims + GetRank(),
-                    other.representation_.rep_external.dims);
-  return true;
+  auto* dims = representation_.rep_external.dims;
+  auto* other_dims = other.representation_.rep_external.dims;
+  return dims == other_dims ||
+         std::equal(dims->dims(), dims->dims() + GetRank(), other_dims->dims());
 }
 
 bool TensorShape::operator!=(const TensorShape& other) const {
@@ -102,10 +102,13 @@ ssize_t TensorShape::GetNumElements() const {
           return result;
       }
 
-    case RepKind::kRepExternal:
-      for (size_t i = 0, e = GetRank(); i != e; ++i)
-        result *= representation_.rep_external.dims[i];
+    case RepKind::kRepPacked:
+      for (int i = 0, e = GetRank(); i != e; ++i)
+        result *= GetPackedDimension(i);
       return result;
+
+    case RepKind::kRepExternal:
+      return representation_.rep_external.dims->num_elements;
   }
 }
 
@@ -137,8 +140,12 @@ void TensorShape::GetDimensions(MutableArrayRef<ssize_t> result) const {
           return;
       }
 
+    case RepKind::kRepPacked:
+      for (int i = 0, e = rank; i != e; ++i) result[i] = GetPackedDimension(i);
+      return;
+
     case RepKind::kRepExternal:
-      memcpy(result.data(), representation_.rep_external.dims,
+      memcpy(result.data(), representation_.rep_external.dims->dims(),
              sizeof(size_t) * rank);
       return;
   }
@@ -188,8 +195,11 @@ ssize_t TensorShape::GetDimensionSize(int dim_idx) const {
           return 0;
       }
 
+    case RepKind::kRepPacked:
+      return GetPackedDimension(dim_idx);
+
     case RepKind::kRepExternal:
-      return representation_.rep_external.dims[dim_idx];
+      return representation_.rep_external.dims->dims()[dim_idx];
   }
 }
 
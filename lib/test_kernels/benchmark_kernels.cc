@@ -14,11 +14,14 @@
 
 // This file implements ops for benchmarking BEFExecutor
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <ctime>
 
 #include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm_derived/Support/raw_ostream.h"
 #include "tfrt/bef_executor/bef_file.h"
@@ -30,13 +33,23 @@
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/host_context/sync_kernel_utils.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
 #include "tfrt/test_kernels.h"
 
 namespace tfrt {
 namespace {
+// BenchmarkStats is thread-safe, so that runs can be executed concurrently.
 class BenchmarkStats {
  public:
+  // The start of a run.
+  struct Run {
+    int index;
+    std::clock_t start_cpu;
+    std::chrono::steady_clock::time_point start_walltime;
+  };
+
   BenchmarkStats(string_view name, int num_warmup_runs, int max_count,
                  std::chrono::microseconds benchmark_duration)
       : name_{name},
@@ -44,49 +57,52 @@ class BenchmarkStats {
         max_count_{max_count},
         benchmark_duration_{benchmark_duration} {}
 
-  void StartRun() {
-    ++cur_count_;
-    // Start recording CPU time.
-    cur_start_cpu_ = std::clock();
-    cur_start_walltime_ = std::chrono::steady_clock::now();
+  // Starts a new run, or returns None if no more rounds should be run.
+  llvm::Optional<Run> StartRun() {
+    mutex_lock lock(mu_);
+    if (cur_count_ >= max_count_ + num_warmup_runs_) return llvm::None;
+    if (cur_count_ > num_warmup_runs_ &&
+        std::chrono::steady_clock::now() - measure_start_walltime_ >=
+            benchmark_duration_)
+      return llvm::None;
+
+    Run run{++cur_count_, std::clock(), std::chrono::steady_clock::now()};
+    // Start measuring the total duration with the first run after the warm
+    // up period.
+    if (run.index == num_warmup_runs_ + 1) {
+      measure_start_cpu_ = run.start_cpu;
+      measure_start_walltime_ = run.start_walltime;
+    }
+    return run;
   }
 
-  void StopRun() {
+  void StopRun(const Run& run) {
+    // Stop the timers.
+    auto stop_walltime = std::chrono::steady_clock::now();
+    std::clock_t stop_cpu = std::clock();
+
+    mutex_lock lock(mu_);
     // Do not collect the runtime statistics if we are still in the warm up
     // period.
-    if (cur_count_ <= num_warmup_runs_) return;
-
-    // Stop the wall clock timer.
-    auto cur_stop_walltime_ = std::chrono::steady_clock::now();
-
-    // Stop the CPU timer.
-    std::clock_t cur_stop_cpu_ = std::clock();
+    if (run.index <= num_warmup_runs_) return;
 
     // Collect the wall clock duration.
-    auto duration_walltime_ = cur_stop_walltime_ - cur_start_walltime_;
-    run_times_walltime_.push_back(duration_walltime_);
+    run_times_walltime_.push_back(stop_walltime - run.start_walltime);
 
-    // Collect the CPU duration in microseconds.
-    // First cast to integer that represents microseconds with truncation, as
-    // does std::chrono::duration_cast. Then cast to std::chrono::microseconds.
-    std::clock_t duration_cpu_raw = cur_stop_cpu_ - cur_start_cpu_;
-    auto duration_cpu_ = static_cast<std::chrono::nanoseconds>(
-        static_cast<int64_t>(1e9 * duration_cpu_raw / CLOCKS_PER_SEC));
+    // Collect the CPU duration of the process. Concurrent runs are included.
+    run_times_cpu_.push_back(CpuDuration(stop_cpu - run.start_cpu));
 
-    run_times_cpu_.push_back(duration_cpu_);
-
-    total_duration_walltime_ += duration_walltime_;
-    total_duration_cpu_ += duration_cpu_;
-  }
-
-  // Return if we should we run more rounds.
-  bool MoreRun() const {
-    return cur_count_ < max_count_ + num_warmup_runs_ &&
-           total_duration_walltime_ < benchmark_duration_;
+    total_duration_walltime_ = std::max(
+        total_duration_walltime_,
+        std::chrono::nanoseconds(stop_walltime - measure_start_walltime_));
+    total_duration_cpu_ = std::max(total_duration_cpu_,
+                                   CpuDuration(stop_cpu - measure_start_cpu_));
   }
 
   // Summarize the benchmark results.
   void Summarize() {
+    mutex_lock lock(mu_);
+    if (run_times_walltime_.empty()) return;
     std::sort(run_times_walltime_.begin(), run_times_walltime_.end());
     std::sort(run_times_cpu_.begin(), run_times_cpu_.end());
 
@@ -101,6 +117,8 @@ class BenchmarkStats {
     llvm::raw_string_ostream(prefix) << "BM:" << name_ << ':';
     auto cpu_utilization =
         total_duration_cpu_.count() * 100.0 / total_duration_walltime_.count();
+    auto throughput =
+        run_times_walltime_.size() * 1e9 / total_duration_walltime_.count();
 
     tfrt::outs() << prefix
                  << "Duration(ns): " << total_duration_walltime_.count()
@@ -130,30 +148,49 @@ class BenchmarkStats {
                  << '\n';
     tfrt::outs() << prefix << "CPU utilization(percent): " << cpu_utilization
                  << "\n";
+    tfrt::outs() << prefix << "Throughput(runs/s): " << throughput << "\n";
     tfrt::outs().flush();
   }
 
  private:
+  // Converts the CPU time in clock ticks to nanoseconds, with truncation as
+  // does std::chrono::duration_cast.
+  static std::chrono::nanoseconds CpuDuration(std::clock_t duration) {
+    return std::chrono::nanoseconds(
+        static_cast<int64_t>(1e9 * duration / CLOCKS_PER_SEC));
+  }
+
   const std::string name_;
   const int num_warmup_runs_;
   const int max_count_;
-  int cur_count_ = 0;
   const std::chrono::nanoseconds benchmark_duration_;
-  std::chrono::nanoseconds total_duration_walltime_{};
-  std::chrono::nanoseconds total_duration_cpu_{};
-  std::chrono::time_point<std::chrono::steady_clock> cur_start_walltime_{};
-  std::clock_t cur_start_cpu_;
-  std::vector<std::chrono::nanoseconds> run_times_walltime_;
-  // CPU run times in microseconds.
-  std::vector<std::chrono::nanoseconds> run_times_cpu_;
+
+  mutex mu_;
+  int cur_count_ TFRT_GUARDED_BY(mu_) = 0;
+  // The start of the first run after the warm up period.
+  std::clock_t measure_start_cpu_ TFRT_GUARDED_BY(mu_) = 0;
+  std::chrono::steady_clock::time_point measure_start_walltime_
+      TFRT_GUARDED_BY(mu_);
+  // The time from the start of the first run after the warm up period to the
+  // end of the last run.
+  std::chrono::nanoseconds total_duration_walltime_ TFRT_GUARDED_BY(mu_){};
+  std::chrono::nanoseconds total_duration_cpu_ TFRT_GUARDED_BY(mu_){};
+  std::vector<std::chrono::nanoseconds> run_times_walltime_
+      TFRT_GUARDED_BY(mu_);
+  std::vector<std::chrono::nanoseconds> run_times_cpu_ TFRT_GUARDED_BY(mu_);
 };
 
+// Runs `num_concurrent_runs` loops that each execute the function, and start
+// the next run when the previous one has finished.
 class AsyncBenchmarkRunner {
  public:
-  AsyncBenchmarkRunner(BenchmarkStats bm_stats, const Function* func,
+  AsyncBenchmarkRunner(string_view name, int num_warmup_runs, int max_count,
+                       std::chrono::microseconds benchmark_duration,
+                       int num_concurrent_runs, const Function* func,
                        ArrayRef<AsyncValue*> args,
                        const ExecutionContext& exec_ctx)
-      : bm_stats_(std::move(bm_stats)),
+      : bm_stats_(name, num_warmup_runs, max_count, benchmark_duration),
+        num_concurrent_runs_(num_concurrent_runs),
         func_{FormRef(func)},
         args_{args.begin(), args.end()},
         exec_ctx_(exec_ctx) {
@@ -176,17 +213,27 @@ class AsyncBenchmarkRunner {
 
   void Start(llvm::unique_function<void()> clean_up) {
     clean_up_ = std::move(clean_up);
-    StartNewRun();
+    num_running_loops_.store(num_concurrent_runs_);
+    for (int i = 0; i < num_concurrent_runs_; ++i) StartNewRun();
   }
 
  private:
   // Start benchmarking a new function execution.
   void StartNewRun() {
-    bm_stats_.StartRun();
+    auto run = bm_stats_.StartRun();
+    if (!run) {
+      // The last loop to finish summarizes the results.
+      if (num_running_loops_.fetch_sub(1) == 1) {
+        bm_stats_.Summarize();
+        clean_up_();
+      }
+      return;
+    }
+
     // We need to run the actual work in the work queue to avoid exhausting the
     // stack space, otherwise, we will have very deep recursion of
     // Function::Execute -> AsyncValue::AndThen -> Function::Execute -> ...
-    EnqueueWork(exec_ctx_, [this] {
+    EnqueueWork(exec_ctx_, [this, run = *run] {
       // The benchmarked function should return exactly one value.
       assert(func_->result_types().size() == 1);
 
@@ -194,24 +241,20 @@ class AsyncBenchmarkRunner {
       func_->Execute(exec_ctx_, /*arguments=*/args_, /*results=*/result);
 
       // AndThen() is called when the function execution finishes. We record the
-      // execution time and start the next run in the AndThen() callback.
-      // Therefore, each of the function execution is run serially.
+      // execution time and start the next run of this loop in the AndThen()
+      // callback.
       auto* result_ptr = result.release();
-      result_ptr->AndThen([this, result_ptr]() mutable {
-        bm_stats_.StopRun();
+      result_ptr->AndThen([this, result_ptr, run]() mutable {
+        bm_stats_.StopRun(run);
         result_ptr->DropRef();
-
-        if (bm_stats_.MoreRun()) {
-          StartNewRun();
-        } else {
-          bm_stats_.Summarize();
-          clean_up_();
-        }
+        StartNewRun();
       });
     });
   }
 
   BenchmarkStats bm_stats_;
+  const int num_concurrent_runs_;
+  std::atomic<int> num_running_loops_{0};
   RCReference<const Function> func_;
   SmallVector<AsyncValue*, 4> args_;
   ExecutionContext exec_ctx_;
@@ -227,12 +270,14 @@ class AsyncBenchmarkRunner {
 // duration_secs: Benchmark duration in seconds.
 // max_count: Max run count of input function.
 // name: The name used to tag the benchmark results.
+// num_concurrent_runs: Number of runs of the input function in flight.
 // num_warmup_runs: Number of warm up runs before benchmarking starts.
 // fn_const: The input function to be benchmarked.
 static void TestAsyncBenchmark(RemainingArguments args, Result<Chain> chain,
                                Attribute<int32_t> duration_secs,
                                Attribute<int32_t> max_count,
                                StringAttribute name,
+                               Attribute<int32_t> num_concurrent_runs,
                                Attribute<int32_t> num_warmup_runs,
                                Attribute<Function> fn_const,
                                KernelErrorHandler handler,
@@ -246,10 +291,15 @@ static void TestAsyncBenchmark(RemainingArguments args, Result<Chain> chain,
     return;
   }
 
-  BenchmarkStats bm_stats{name.str(), *num_warmup_runs, *max_count,
-                          std::chrono::seconds(*duration_secs)};
-  auto benchmark_runner = new AsyncBenchmarkRunner(std::move(bm_stats), fn,
-                                                   args.values(), exec_ctx);
+  if (*num_concurrent_runs < 1) {
+    handler.ReportError("Benchmark op requires num_concurrent_runs >= 1");
+    return;
+  }
+
+  auto benchmark_runner = new AsyncBenchmarkRunner(
+      name.get(), *num_warmup_runs, *max_count,
+      std::chrono::seconds(*duration_secs), *num_concurrent_runs, fn,
+      args.values(), exec_ctx);
 
   benchmark_runner->Start([benchmark_runner, chain = chain.Allocate()] {
     chain.emplace();
@@ -300,10 +350,9 @@ static Error TestSyncBenchmark(RemainingSyncArguments args,
 
   BEFInterpreter interpreter{*fn};
 
-  while (bm_stats.MoreRun()) {
-    bm_stats.StartRun();
+  while (auto run = bm_stats.StartRun()) {
     auto error = interpreter.Execute(exec_ctx, func_args, {});
-    bm_stats.StopRun();
+    bm_stats.StopRun(*run);
     if (error) return error;
   }
 
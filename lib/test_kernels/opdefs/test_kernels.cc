@@ -187,7 +187,9 @@ static ParseResult parseBenchmarkOp(OpAsmParser &parser,
     }
   };
 
-  // Set the default attribute num_warmup_runs to 1 if unset
+  // Set the default attributes num_concurrent_runs and num_warmup_runs to 1 if
+  // unset
+  setDefaultAttrIfUnset("num_concurrent_runs", 1);
   setDefaultAttrIfUnset("num_warmup_runs", 1);
 
   Region *target = result.addRegion();
@@ -329,7 +331,9 @@ static ParseResult parseSyncBenchmarkOp(OpAsmParser &parser,
     }
   };
 
-  // Set the default attribute num_warmup_runs to 1 if unset
+  // Set the default attributes num_concurrent_runs and num_warmup_runs to 1 if
+  // unset
+  setDefaultAttrIfUnset("num_concurrent_runs", 1);
   setDefaultAttrIfUnset("num_warmup_runs", 1);
 
   return success();
@@ -39,26 +39,10 @@ void NativeAsyncSink(AsyncValue* const* arguments, int num_arguments,
   results[0] = MakeAvailableAsyncValueRef<Chain>(host);
 }
 
-void NativeAdd(AsyncValue* const* arguments, int num_arguments,
-               RCReference<AsyncValue>* results, int num_results,
-               HostContext* host) {
-  assert(num_arguments == 2);
-  int32_t a = arguments[0]->get<int32_t>();
-  int32_t b = arguments[1]->get<int32_t>();
+int32_t NativeAdd(int32_t a, int32_t b) { return a + b; }
 
-  assert(num_results == 1);
-  results[0] = MakeAvailableAsyncValueRef<int32_t>(host, a + b);
-}
-
-void NativeAsyncAdd(AsyncValue* const* arguments, int num_arguments,
-                    RCReference<AsyncValue>* results, int num_results,
-                    HostContext* host) {
-  assert(num_arguments == 2);
-  int32_t a = arguments[0]->get<int32_t>();
-  int32_t b = arguments[1]->get<int32_t>();
-
-  assert(num_results == 1);
-  results[0] = EnqueueWork(host, [c = a + b]() { return c; });
+AsyncValueRef<int32_t> NativeAsyncAdd(int32_t a, int32_t b, HostContext* host) {
+  return EnqueueWork(host, [c = a + b]() { return c; });
 }
 
 void NativeError(AsyncValue* const* arguments, int num_arguments,
@@ -73,8 +57,8 @@ void NativeError(AsyncValue* const* arguments, int num_arguments,
 void RegisterTestNativeFunctions(NativeFunctionRegistry* registry) {
   registry->Add("native_sink", NativeSink);
   registry->Add("native_async_sink", NativeAsyncSink);
-  registry->Add("native_add", NativeAdd);
-  registry->Add("native_async_add", NativeAsyncAdd);
+  registry->Add("native_add", TFRT_NATIVE_FUNCTION(NativeAdd));
+  registry->Add("native_async_add", TFRT_NATIVE_FUNCTION(NativeAsyncAdd));
   registry->Add("native_error", NativeError);
 }
 
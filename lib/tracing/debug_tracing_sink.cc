@@ -16,6 +16,7 @@
 //
 // This file implements a debug tracing sink which prints activities to stdout.
 
+#include <chrono>
 #include <string>
 
 #include "llvm/Support/Error.h"
@@ -38,6 +39,23 @@ class DebugTracingSink : public TracingSink {
 
   void PopTracingScope() override { os_ << "End Scope\n"; }
 
+  void RecordTracingFlow(uint64_t flow_id) override {
+    os_ << "Flow:" << flow_id << "\n";
+  }
+
+  void RecordTracingActivity(NameGenerator gen_name, string_view track,
+                             TimePoint begin, TimePoint end,
+                             uint64_t flow_id) override {
+    auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+    os_ << "Activity:" << gen_name() << " on " << track << " for "
+        << duration.count() << "us\n";
+  }
+
+  void RecordTracingCounter(NameGenerator gen_name, int64_t value) override {
+    os_ << "Counter:" << gen_name() << "=" << value << "\n";
+  }
+
  private:
   llvm::raw_ostream& os_ = llvm::outs();
 };
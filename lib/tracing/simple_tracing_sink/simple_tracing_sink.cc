@@ -14,106 +14,439 @@
 
 //===- simple_tracing_sink.cc - A Simple implementation of Tracing Sink ---===//
 //
-// This file implements a simple tracing sink which prints activities to stderr.
+// This file implements a tracing sink which records activities into per-thread
+// ring buffers and exports them in the Chrome trace event format.
 
 #include "tfrt/tracing/simple_tracing_sink/simple_tracing_sink.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
 #include "tfrt/support/logging.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/support/thread_environment.h"
 
 namespace tfrt {
 namespace tracing {
 
 namespace {
 
-const auto kProcessStart = std::chrono::steady_clock::now();
+using Clock = std::chrono::steady_clock;
 
-class TracingStorage {
-  using Time = std::chrono::steady_clock::time_point;
+int64_t ToNanos(Clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             time.time_since_epoch())
+      .count();
+}
 
-  struct Activity {
-    std::string name;
-    Time start;
-    Time end;
-  };
+int64_t NowNanos() { return ToNanos(Clock::now()); }
 
-  static const int kMaxEntries = 100;
+// Fixed-size record of an activity. Events have begin_ns == end_ns, flow
+// steps have a non-zero flow_id.
+struct Activity {
+  uint32_t name_id;
+  int64_t begin_ns;
+  int64_t end_ns;
+  uint64_t flow_id;
+};
+
+// Ring buffer of activities with a single producer, the owning thread, and a
+// single consumer, the flushing thread.
+class ThreadBuffer {
+  static constexpr uint64_t kCapacity = 1 << 14;
 
  public:
-  ~TracingStorage() {
-    using microseconds = std::chrono::microseconds;
-    using nanoseconds = std::chrono::nanoseconds;
-
-    for (const auto& activity : activities_) {
-      auto start_us = std::chrono::duration_cast<microseconds>(activity.start -
-                                                               kProcessStart);
-
-      if (activity.start == activity.end) {
-        TFRT_LOG(INFO) << "::: [" << activity.name << "]: " << start_us.count()
-                       << " us";
-        continue;
-      }
+  explicit ThreadBuffer(int thread_id) : thread_id_(thread_id) {}
 
-      auto end_us = std::chrono::duration_cast<microseconds>(activity.end -
-                                                             kProcessStart);
-      auto duration_ns = std::chrono::duration_cast<nanoseconds>(
-          activity.end - activity.start);
+  int thread_id() const { return thread_id_; }
 
-      TFRT_LOG(INFO) << "::: [" << activity.name << "]: " << start_us.count()
-                     << " us -- " << end_us.count() << " ("
-                     << duration_ns.count() << " ns)";
+  // Called by the owning thread. Drops the activity if the buffer is full.
+  void Push(const Activity& activity) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == kCapacity) {
+      num_dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
     }
-    TFRT_LOG(INFO) << "Total activities collected: " << activities_.size();
+    activities_[head % kCapacity] = activity;
+    head_.store(head + 1, std::memory_order_release);
   }
 
-  void RecordEvent(std::string&& name) {
-    if (activities_.size() >= kMaxEntries) return;
-    auto now = Now();
-    activities_.push_back(Activity{std::move(name), now, now});
+  // Called by the consumer. Moves all activities to `consumer`.
+  template <typename F>
+  void Drain(F&& consumer) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) consumer(activities_[tail % kCapacity]);
+    tail_.store(tail, std::memory_order_release);
   }
 
-  void PushScope(std::string&& name) {
-    if (activities_.size() >= kMaxEntries) return;
-    stack_.emplace_back(std::move(name), Now());
+  uint64_t num_dropped() const {
+    return num_dropped_.load(std::memory_order_relaxed);
+  }
+
+  // The following members are only accessed by the owning thread.
+
+  // Names interned by this thread, to avoid locking the name table.
+  llvm::StringMap<uint32_t> name_ids;
+  // Name ids and begin timestamps of the open scopes.
+  llvm::SmallVector<std::pair<uint32_t, int64_t>, 16> scopes;
+
+ private:
+  const int thread_id_;
+  // Written by the producer and the consumer respectively. The activities in
+  // between keep them on separate cache lines.
+  std::atomic<uint64_t> head_{0};
+  std::array<Activity, kCapacity> activities_;
+  std::atomic<uint64_t> tail_{0};
+  std::atomic<uint64_t> num_dropped_{0};
+};
+
+// Sinks are numbered to detect thread-local buffers of a previous sink.
+std::atomic<int64_t> kNextSinkId{0};
+
+}  // namespace
+
+class SimpleTracingSink::Impl {
+ public:
+  explicit Impl(std::string trace_file)
+      : trace_file_(std::move(trace_file)), start_ns_(NowNanos()) {}
+
+  ~Impl() { StopFlushThread(); }
+
+  Error RequestTracing(bool enable) {
+    if (enable) {
+      mutex_lock lock(mu_);
+      stop_ = false;
+      flush_thread_ = ThreadingEnvironment::StartThread(
+          "tfrt-tracing", [this] { FlushLoop(); });
+      return Error::success();
+    }
+    StopFlushThread();
+    Flush();
+    if (uint64_t num_dropped = GetNumDropped()) {
+      TFRT_LOG(WARNING) << "Dropped " << num_dropped
+                        << " tracing activities, the buffers were full.";
+    }
+    if (trace_file_.empty()) return Error::success();
+    std::error_code error_code;
+    llvm::raw_fd_ostream os(trace_file_, error_code, llvm::sys::fs::OF_None);
+    if (error_code) return llvm::errorCodeToError(error_code);
+    ExportChromeTrace(os);
+    return Error::success();
+  }
+
+  void RecordEvent(TracingSink::NameGenerator gen_name) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    uint32_t name_id = Intern(buffer, gen_name());
+    int64_t now = NowNanos();
+    buffer.Push(Activity{name_id, now, now, 0});
+  }
+
+  void PushScope(TracingSink::NameGenerator gen_name) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    uint32_t name_id = Intern(buffer, gen_name());
+    buffer.scopes.emplace_back(name_id, NowNanos());
   }
 
   void PopScope() {
-    if (activities_.size() >= kMaxEntries) return;
-    if (stack_.empty()) return;
-    activities_.push_back({std::move(std::get<std::string>(stack_.back())),
-                           std::get<Time>(stack_.back()), Now()});
-    stack_.pop_back();
+    int64_t now = NowNanos();
+    ThreadBuffer& buffer = GetThreadBuffer();
+    if (buffer.scopes.empty()) return;
+    auto scope = buffer.scopes.pop_back_val();
+    buffer.Push(Activity{scope.first, scope.second, now, 0});
+  }
+
+  void RecordEvent(const TracePoint& trace_point) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    uint32_t name_id = Intern(buffer, trace_point);
+    int64_t now = NowNanos();
+    buffer.Push(Activity{name_id, now, now, 0});
+  }
+
+  void PushScope(const TracePoint& trace_point) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    uint32_t name_id = Intern(buffer, trace_point);
+    buffer.scopes.emplace_back(name_id, NowNanos());
+  }
+
+  void RecordFlow(uint64_t flow_id) {
+    int64_t now = NowNanos();
+    GetThreadBuffer().Push(Activity{0, now, now, flow_id});
+  }
+
+  void RecordActivity(TracingSink::NameGenerator gen_name, string_view track,
+                      Clock::time_point begin, Clock::time_point end,
+                      uint64_t flow_id) {
+    std::string name = gen_name();
+    mutex_lock lock(mu_);
+    int track_id = track_ids_.try_emplace(track, track_ids_.size())
+                       .first->second;
+    Activity activity{InternLocked(name), ToNanos(begin), ToNanos(end), 0};
+    track_activities_.emplace_back(track_id, activity);
+    if (flow_id == 0) return;
+    activity.end_ns = activity.begin_ns;
+    activity.flow_id = flow_id;
+    track_activities_.emplace_back(track_id, activity);
+  }
+
+  void RecordCounter(TracingSink::NameGenerator gen_name, int64_t value) {
+    std::string name = gen_name();
+    int64_t now = NowNanos();
+    mutex_lock lock(mu_);
+    counters_.push_back(Counter{InternLocked(name), now, value});
+  }
+
+  void ExportChromeTrace(raw_ostream& os) {
+    Flush();
+    mutex_lock lock(mu_);
+    // The first and last timestamp of each flow, which start and finish it.
+    llvm::DenseMap<uint64_t, std::pair<int64_t, int64_t>> flow_ranges;
+    for (const auto* activities : {&activities_, &track_activities_}) {
+      for (const auto& pair : *activities) {
+        const Activity& activity = pair.second;
+        if (activity.flow_id == 0) continue;
+        auto it = flow_ranges.try_emplace(activity.flow_id, activity.begin_ns,
+                                          activity.begin_ns);
+        it.first->second.first =
+            std::min(it.first->second.first, activity.begin_ns);
+        it.first->second.second =
+            std::max(it.first->second.second, activity.begin_ns);
+      }
+    }
+
+    llvm::json::OStream json(os);
+    auto write_activity = [&](int pid, int tid, const Activity& activity) {
+      json.object([&] {
+        json.attribute("pid", pid);
+        json.attribute("tid", tid);
+        json.attribute("ts", ToMicros(activity.begin_ns));
+        if (activity.flow_id != 0) {
+          // Flow steps bind to the enclosing scope.
+          const auto& range = flow_ranges[activity.flow_id];
+          json.attribute("name", "flow");
+          json.attribute("cat", "flow");
+          json.attribute("id", llvm::utohexstr(activity.flow_id));
+          json.attribute("bp", "e");
+          json.attribute("ph", activity.begin_ns == range.first    ? "s"
+                               : activity.begin_ns == range.second ? "f"
+                                                                   : "t");
+          return;
+        }
+        json.attribute("name", names_[activity.name_id]);
+        if (activity.begin_ns == activity.end_ns) {
+          json.attribute("ph", "i");
+          json.attribute("s", "t");
+        } else {
+          json.attribute("ph", "X");
+          json.attribute("dur", (activity.end_ns - activity.begin_ns) / 1000.0);
+        }
+      });
+    };
+    json.object([&] {
+      json.attributeArray("traceEvents", [&] {
+        for (const auto& pair : activities_)
+          write_activity(/*pid=*/0, pair.first, pair.second);
+        for (const auto& track : track_ids_) {
+          json.object([&] {
+            json.attribute("pid", 1);
+            json.attribute("tid", track.second);
+            json.attribute("ph", "M");
+            json.attribute("name", "thread_name");
+            json.attributeObject(
+                "args", [&] { json.attribute("name", track.getKey()); });
+          });
+        }
+        for (const auto& pair : track_activities_)
+          write_activity(/*pid=*/1, pair.first, pair.second);
+        for (const Counter& counter : counters_) {
+          json.object([&] {
+            json.attribute("pid", 0);
+            json.attribute("ts", ToMicros(counter.time_ns));
+            json.attribute("ph", "C");
+            json.attribute("name", names_[counter.name_id]);
+            json.attributeObject(
+                "args", [&] { json.attribute("value", counter.value); });
+          });
+        }
+      });
+      json.attribute("displayTimeUnit", "ns");
+    });
   }
 
  private:
-  static Time Now() { return std::chrono::steady_clock::now(); }
+  ThreadBuffer& GetThreadBuffer() {
+    // Trivially destructible, which avoids a guard on every access.
+    thread_local struct {
+      int64_t sink_id;
+      ThreadBuffer* buffer;
+    } tls = {-1, nullptr};
+    if (LLVM_UNLIKELY(tls.sink_id != sink_id_)) {
+      mutex_lock lock(mu_);
+      buffers_.push_back(std::make_unique<ThreadBuffer>(buffers_.size()));
+      tls = {sink_id_, buffers_.back().get()};
+    }
+    return *tls.buffer;
+  }
+
+  // Returns the id of `name`, which is only looked up in the table shared by
+  // all threads the first time the calling thread sees it.
+  uint32_t Intern(ThreadBuffer& buffer, std::string name) {
+    auto it = buffer.name_ids.find(name);
+    if (LLVM_LIKELY(it != buffer.name_ids.end())) return it->second;
+    uint32_t name_id = [&] {
+      mutex_lock lock(mu_);
+      return InternLocked(name);
+    }();
+    buffer.name_ids.try_emplace(name, name_id);
+    return name_id;
+  }
+
+  // Returns the id of `name` in the table shared by all threads.
+  uint32_t InternLocked(const std::string& name) TFRT_REQUIRES(mu_) {
+    auto pair = name_ids_.try_emplace(name, names_.size());
+    if (pair.second) names_.push_back(name);
+    return pair.first->second;
+  }
+
+  // Returns the id of the name of `trace_point`, which is cached in the trace
+  // point together with the lower bits of the sink id.
+  uint32_t Intern(ThreadBuffer& buffer, const TracePoint& trace_point) {
+    const uint64_t sink_bits = static_cast<uint64_t>(sink_id_ + 1) << 32;
+    uint64_t data = trace_point.sink_data().load(std::memory_order_relaxed);
+    if (LLVM_LIKELY((data & ~uint64_t{0xffffffff}) == sink_bits))
+      return static_cast<uint32_t>(data);
+    uint32_t name_id = Intern(buffer, trace_point.name().str());
+    trace_point.sink_data().store(sink_bits | name_id,
+                                  std::memory_order_relaxed);
+    return name_id;
+  }
+
+  double ToMicros(int64_t nanos) const { return (nanos - start_ns_) / 1000.0; }
+
+  // Moves the activities from the thread buffers to activities_.
+  void DrainBuffers() TFRT_REQUIRES(mu_) {
+    for (const auto& buffer : buffers_) {
+      buffer->Drain([&](const Activity& activity) {
+        activities_.emplace_back(buffer->thread_id(), activity);
+      });
+    }
+  }
+
+  void Flush() {
+    mutex_lock lock(mu_);
+    DrainBuffers();
+  }
+
+  void FlushLoop() {
+    mutex_lock lock(mu_);
+    while (!stop_) {
+      cond_.wait_until(lock, Clock::now() + std::chrono::milliseconds(10),
+                       [this] { return stop_; });
+      DrainBuffers();
+    }
+  }
 
-  llvm::SmallVector<std::tuple<std::string, Time>, 16> stack_;
-  llvm::SmallVector<Activity, kMaxEntries> activities_;
+  uint64_t GetNumDropped() {
+    mutex_lock lock(mu_);
+    uint64_t result = 0;
+    for (const auto& buffer : buffers_) result += buffer->num_dropped();
+    return result;
+  }
+
+  void StopFlushThread() {
+    std::unique_ptr<ThreadingEnvironment::Thread> thread;
+    {
+      mutex_lock lock(mu_);
+      stop_ = true;
+      thread = std::move(flush_thread_);
+    }
+    cond_.notify_all();
+    thread.reset();  // Joins the thread.
+  }
+
+  const std::string trace_file_;
+  const int64_t start_ns_;
+  const int64_t sink_id_ = kNextSinkId.fetch_add(1);
+
+  mutex mu_;
+  condition_variable cond_;
+  bool stop_ TFRT_GUARDED_BY(mu_) = false;
+  std::unique_ptr<ThreadingEnvironment::Thread> flush_thread_
+      TFRT_GUARDED_BY(mu_);
+  // Buffers outlive their threads, which may exit while tracing.
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_ TFRT_GUARDED_BY(mu_);
+  llvm::StringMap<uint32_t> name_ids_ TFRT_GUARDED_BY(mu_);
+  std::vector<std::string> names_ TFRT_GUARDED_BY(mu_);
+  // Drained activities, paired with the id of the recording thread.
+  std::vector<std::pair<int, Activity>> activities_ TFRT_GUARDED_BY(mu_);
+  // Activities on tracks, paired with the id of the track.
+  llvm::StringMap<int> track_ids_ TFRT_GUARDED_BY(mu_);
+  std::vector<std::pair<int, Activity>> track_activities_ TFRT_GUARDED_BY(mu_);
+  struct Counter {
+    uint32_t name_id;
+    int64_t time_ns;
+    int64_t value;
+  };
+  std::vector<Counter> counters_ TFRT_GUARDED_BY(mu_);
 };
-}  // namespace
 
-static TracingStorage& GetTracingStorage() {
-  static thread_local TracingStorage tracing_storage;
-  return tracing_storage;
-}
+SimpleTracingSink::SimpleTracingSink(std::string trace_file)
+    : impl_(std::make_unique<Impl>(std::move(trace_file))) {}
+
+SimpleTracingSink::~SimpleTracingSink() = default;
 
 Error SimpleTracingSink::RequestTracing(bool enable) {
-  return Error::success();
+  return impl_->RequestTracing(enable);
 }
 
 void SimpleTracingSink::RecordTracingEvent(
     TracingSink::NameGenerator gen_name) {
-  GetTracingStorage().PushScope(gen_name());
+  impl_->RecordEvent(gen_name);
 }
 void SimpleTracingSink::PushTracingScope(TracingSink::NameGenerator gen_name) {
-  GetTracingStorage().PushScope(gen_name());
+  impl_->PushScope(gen_name);
+}
+void SimpleTracingSink::PopTracingScope() { impl_->PopScope(); }
+void SimpleTracingSink::RecordTracingFlow(uint64_t flow_id) {
+  impl_->RecordFlow(flow_id);
+}
+void SimpleTracingSink::RecordTracePointEvent(const TracePoint& trace_point) {
+  impl_->RecordEvent(trace_point);
+}
+void SimpleTracingSink::PushTracePointScope(const TracePoint& trace_point) {
+  impl_->PushScope(trace_point);
+}
+
+void SimpleTracingSink::RecordTracingActivity(NameGenerator gen_name,
+                                              string_view track,
+                                              TimePoint begin, TimePoint end,
+                                              uint64_t flow_id) {
+  impl_->RecordActivity(gen_name, track, begin, end, flow_id);
+}
+void SimpleTracingSink::RecordTracingCounter(NameGenerator gen_name,
+                                             int64_t value) {
+  impl_->RecordCounter(gen_name, value);
+}
+
+void SimpleTracingSink::ExportChromeTrace(raw_ostream& os) {
+  impl_->ExportChromeTrace(os);
 }
-void SimpleTracingSink::PopTracingScope() { GetTracingStorage().PopScope(); }
 
 }  // namespace tracing
 }  // namespace tfrt
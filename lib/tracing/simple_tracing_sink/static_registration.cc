@@ -13,7 +13,10 @@
 // limitations under the License.
 
 // This file uses a static constructor to automatically register the simple
-// tracing sink.
+// tracing sink. Traces are written to the file named by the TFRT_TRACE_FILE
+// environment variable, if set.
+
+#include <cstdlib>
 
 #include "tfrt/tracing/simple_tracing_sink/simple_tracing_sink.h"
 #include "tfrt/tracing/tracing.h"
@@ -21,7 +24,8 @@
 namespace tfrt {
 namespace tracing {
 static const bool kRegisterTracingSink = [] {
-  RegisterTracingSink(new SimpleTracingSink);
+  const char* trace_file = std::getenv("TFRT_TRACE_FILE");
+  RegisterTracingSink(new SimpleTracingSink(trace_file ? trace_file : ""));
   return true;
 }();
 }  // namespace tracing
@@ -19,6 +19,7 @@
 
 #include <cassert>
 #include <mutex>
+#include <random>
 
 #include "llvm/Support/Error.h"
 
@@ -29,12 +30,22 @@ TracingSink::~TracingSink() = default;
 TracingSink* internal::kTracingSink = nullptr;
 std::atomic<int> internal::kIsTracingEnabled(0);
 std::atomic<TracingLevel> internal::kTracingLevel(TracingLevel::Default);
+std::atomic<int> internal::kEnabledTracingLevel(-1);
 
 static std::mutex& GetTracingMutex() {
   static auto mutex = new std::mutex;
   return *mutex;
 }
 
+// Updates kEnabledTracingLevel from the other two. Requires the tracing mutex.
+static void UpdateEnabledTracingLevel() {
+  internal::kEnabledTracingLevel.store(
+      internal::kIsTracingEnabled.load(std::memory_order_relaxed) > 0
+          ? static_cast<int>(internal::kTracingLevel.load())
+          : -1,
+      std::memory_order_release);
+}
+
 void RegisterTracingSink(TracingSink* tracing_sink) {
   std::unique_lock<std::mutex> lock(GetTracingMutex());
   assert(tracing_sink);
@@ -52,12 +63,22 @@ void RequestTracing(bool enable) {
     if (value == 0 || --value > 0) return;
   }
   internal::kIsTracingEnabled.store(value, std::memory_order_release);
+  UpdateEnabledTracingLevel();
   // Don't log error to avoid binary size bloat.
   consumeError(internal::kTracingSink->RequestTracing(enable));
 }
 
 void SetTracingLevel(TracingLevel level) {
+  std::unique_lock<std::mutex> lock(GetTracingMutex());
   internal::kTracingLevel.store(level);
+  UpdateEnabledTracingLevel();
+}
+
+uint64_t NewTracingFlowId() {
+  // Random upper bits keep the ids of different processes apart.
+  static auto next_id = new std::atomic<uint64_t>(
+      static_cast<uint64_t>(std::random_device()()) << 32 | 1);
+  return next_id->fetch_add(1, std::memory_order_relaxed);
 }
 
 }  // namespace tracing
@@ -134,6 +134,24 @@ func @controlflow_repeat_large() {
   tfrt.return
 }
 
+// CHECK-LABEL: --- Running 'controlflow_repeat_parallel_iterations'
+func @controlflow_repeat_parallel_iterations() {
+  %count = tfrt.constant.i32 100
+  %v0 = tfrt.constant.i32 42
+
+  %sum = tfrt.repeat.i32 %count, %v0 attributes {parallel_iterations = 4 : i32} : i32 {
+    %one = tfrt.constant.i32 1
+    %v2 = "tfrt_test.async_add.i32"(%v0, %one) : (i32, i32) -> i32
+    tfrt.return %v2: i32
+  }
+
+  %ch0 = tfrt.new.chain
+  // CHECK-NEXT: int32 = 142
+  tfrt.print.i32 %sum, %ch0
+
+  tfrt.return
+}
+
 // CHECK-LABEL: --- Running 'controlflow_repeat_cancel'
 func @controlflow_repeat_cancel() -> i32 {
   %ch0 = tfrt.new.chain
@@ -223,6 +241,31 @@ func @if_test_with_func() {
   tfrt.return
 }
 
+// CHECK-LABEL: --- Running 'speculative_if_test_with_func'
+func @speculative_if_test_with_func() {
+  %ch0 = tfrt.new.chain
+
+  %a = tfrt.constant.i32 41
+  %zero = tfrt.constant.i32 0
+
+  // Both functions run before the asynchronously computed condition is
+  // available.
+  %async_a = "tfrt_test.async_add.i32"(%a, %zero) : (i32, i32) -> i32
+  %true = "tfrt.lessequal.i32"(%zero, %async_a) : (i32, i32) -> (i1)
+  %true_res = tfrt.cond %true @identity @double (%a) {speculative = true} : (i32) -> (i32)
+
+  // CHECK-NEXT: int32 = 41
+  %ch1 = tfrt.print.i32 %true_res, %ch0
+
+  %false = "tfrt.lessequal.i32"(%async_a, %zero) : (i32, i32) -> (i1)
+  %false_res = tfrt.cond %false @identity @double (%a) {speculative = true} : (i32) -> (i32)
+
+  // CHECK-NEXT: int32 = 82
+  %ch2 = tfrt.print.i32 %false_res, %ch1
+
+  tfrt.return
+}
+
 func @branch0(%ch: !tfrt.chain, %arg: i32) -> (!tfrt.chain, i32) {
   %one = tfrt.constant.i32 2
   %res = tfrt.add.i32 %arg, %one
@@ -259,6 +302,38 @@ func @tfrt_case_test() {
   tfrt.return
 }
 
+// CHECK-LABEL: --- Running 'speculative_case_test'
+func @speculative_case_test() {
+  %ch0 = tfrt.new.chain
+
+  %zero = tfrt.constant.i32 0
+  %one = tfrt.constant.i32 1
+  %arg = tfrt.constant.i32 40
+
+  // Both branches run before the asynchronously computed index is available.
+  %branch_index = "tfrt_test.async_add.i32"(%zero, %one) : (i32, i32) -> i32
+  %ch1, %res = tfrt.case %branch_index [@branch0, @branch1] (%ch0, %arg) {speculative = true} : (i32) -> (i32)
+
+  // CHECK: int32 = 43
+  %ch2 = tfrt.print.i32 %res, %ch1
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'speculative_case_invalid_index_test'
+func @speculative_case_invalid_index_test() -> i32 {
+  %ch0 = tfrt.new.chain
+
+  %one = tfrt.constant.i32 1
+  %arg = tfrt.constant.i32 40
+
+  %branch_index = "tfrt_test.async_add.i32"(%one, %one) : (i32, i32) -> i32
+  %ch1, %res = tfrt.case %branch_index [@branch0, @branch1] (%ch0, %arg) {speculative = true} : (i32) -> (i32)
+
+  // CHECK: 'speculative_case_invalid_index_test' returned <<error: branch_index invalid. branch index: 2 # branches: 2
+  tfrt.return %res : i32
+}
+
 func @tfrt_while_body(%ch: !tfrt.chain, %iteration: i32, %arg: i32) -> (!tfrt.chain, i32, i32, i1) {
   %one = tfrt.constant.i32 1
   %five = tfrt.constant.i32 5
@@ -287,6 +362,41 @@ func @tfrt_while_test() -> !tfrt.chain {
   tfrt.return %ch3 : !tfrt.chain
 }
 
+// The loop-carried %arg does not feed the condition, so the next iteration can
+// start before it is computed.
+func @tfrt_while_async_body(%ch: !tfrt.chain, %iteration: i32, %arg: i32) -> (!tfrt.chain, i32, i32, i1) {
+  %one = tfrt.constant.i32 1
+  %five = tfrt.constant.i32 5
+  %next_iteration = tfrt.add.i32 %iteration, %one
+  %next_arg = "tfrt_test.async_add.i32"(%arg, %five) : (i32, i32) -> i32
+  %next_cond = "tfrt.lessequal.i32"(%next_iteration, %five) : (i32, i32) -> (i1)
+
+  tfrt.return %ch, %next_iteration, %next_arg, %next_cond : !tfrt.chain, i32, i32, i1
+}
+
+// CHECK-LABEL: --- Running 'tfrt_while_parallel_iterations_test'
+func @tfrt_while_parallel_iterations_test() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+
+  %cond = tfrt.constant.i1 true
+  %iteration = tfrt.constant.i32 0
+  %arg = tfrt.constant.i32 0
+
+  %ch1, %iteration1, %arg1 = tfrt.while %cond @tfrt_while_async_body(%ch0, %iteration, %arg) {parallel_iterations = 1 : i32} : (!tfrt.chain, i32, i32) -> (!tfrt.chain, i32, i32)
+
+  // CHECK: int32 = 30
+  %ch2 = tfrt.print.i32 %arg1, %ch1
+
+  %ch3, %iteration2, %arg2 = tfrt.while %cond @tfrt_while_async_body(%ch2, %iteration, %arg) {parallel_iterations = 2 : i32} : (!tfrt.chain, i32, i32) -> (!tfrt.chain, i32, i32)
+
+  // CHECK: int32 = 30
+  %ch4 = tfrt.print.i32 %arg2, %ch3
+  // CHECK: int32 = 6
+  %ch5 = tfrt.print.i32 %iteration2, %ch4
+
+  tfrt.return %ch5 : !tfrt.chain
+}
+
 func @tfrt_while_error_body(%ch: !tfrt.chain, %iteration: i32, %arg: i32) -> (!tfrt.chain, i32, i32, i1) {
   %one = tfrt.constant.i32 1
   %five = tfrt.constant.i32 5
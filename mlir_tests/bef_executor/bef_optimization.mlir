@@ -0,0 +1,47 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor_lite $(bef_name %s) | FileCheck %s --dump-input=fail
+// RUN: tfrt_opt -tfrt-optimize-bef %s | tfrt_translate -mlir-to-bef > %t.bef
+// RUN: bef_executor_lite %t.bef | FileCheck %s --dump-input=fail
+
+// Compares the executor time of a function before and after the
+// tfrt-optimize-bef pipeline, which inlines the calls, folds the arithmetic
+// and removes the redundant chains.
+
+func private @add_and_sync(%ch: !tfrt.chain, %x: i32, %y: i32) -> (!tfrt.chain, i32) {
+  %z = tfrt.add.i32 %x, %y
+  %new = tfrt.new.chain
+  %ch1 = tfrt.merge.chains %ch, %new : !tfrt.chain, !tfrt.chain
+  tfrt.return %ch1, %z : !tfrt.chain, i32
+}
+
+// CHECK-LABEL: --- Running 'bef_optimization'
+func @bef_optimization() {
+  // CHECK: BM:call_chain:Count: 100
+  // CHECK: BM:call_chain:Time 50%(ns):
+  // CHECK: BM:call_chain:CPU 50%(ns):
+  tfrt_test.benchmark "call_chain"() duration_secs = 1, max_count = 100, num_warmup_runs = 10
+  {
+    %ch0 = tfrt.new.chain
+    %a = tfrt.constant.i32 20
+    %b = tfrt.constant.i32 1
+    %ch1, %c = tfrt.call @add_and_sync(%ch0, %a, %b) : (!tfrt.chain, i32, i32) -> (!tfrt.chain, i32)
+    %ch2, %d = tfrt.call @add_and_sync(%ch1, %c, %c) : (!tfrt.chain, i32, i32) -> (!tfrt.chain, i32)
+    %ch3 = tfrt.merge.chains %ch1, %ch2, %ch0 : !tfrt.chain, !tfrt.chain, !tfrt.chain
+    tfrt.return %d : i32
+  }
+
+  tfrt.return
+}
@@ -30,6 +30,7 @@ func @benchmark() {
   // CHECK: BM:add.i32:CPU 95%(ns):
   // CHECK: BM:add.i32:CPU 99%(ns):
   // CHECK: BM:add.i32:CPU utilization(percent):
+  // CHECK: BM:add.i32:Throughput(runs/s):
 
 
   tfrt_test.benchmark "add.i32"() duration_secs = 1, max_count = 100, num_warmup_runs = 10
@@ -68,3 +69,23 @@ func @benchmark2() {
 
   tfrt.return
 }
+
+// A function to demonstrate the use of benchmark kernels with concurrent runs
+// of the input function.
+func @concurrent_benchmark() {
+  // CHECK: BM:async_add.i32:Duration(ns):
+  // CHECK: BM:async_add.i32:Count: 100
+  // CHECK: BM:async_add.i32:Throughput(runs/s):
+
+  tfrt_test.benchmark "async_add.i32"()
+      duration_secs = 10,
+      max_count = 100,
+      num_concurrent_runs = 4,
+      num_warmup_runs = 10 {
+    %c = tfrt.constant.i32 42
+    %x = "tfrt_test.async_add.i32"(%c, %c) : (i32, i32) -> i32
+    tfrt.return %x : i32
+  }
+
+  tfrt.return
+}
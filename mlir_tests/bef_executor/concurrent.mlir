@@ -16,6 +16,7 @@
 
 // RUN: bef_executor_lite $(bef_name %s) | FileCheck %s --dump-input=fail
 // RUN: bef_executor_lite -work_queue_type=mstd $(bef_name %s) | FileCheck %s --dump-input=fail
+// RUN: bef_executor_lite -work_queue_type=mstd -scheduling_mode=stream_stealing $(bef_name %s) | FileCheck %s --dump-input=fail
 
 // Asynchronously increment %counter once.
 // CHECK-LABEL: async_incs
@@ -0,0 +1,40 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor_lite $(bef_name %s) --work_queue_type=s --prioritize_critical_path 2>&1 | FileCheck %s --dump-input=fail
+// RUN: bef_executor_lite $(bef_name %s) --work_queue_type=s --prioritize_critical_path --scheduling_mode=stream_stealing 2>&1 | FileCheck %s --dump-input=fail
+
+module attributes {tfrt.cost_threshold = 10 : i64} {
+
+// CHECK-LABEL: --- Running 'critical_path_first'
+func @critical_path_first() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+
+  // The chain of kernel 1, 2 and 3 is run before kernel 0, as it is the
+  // critical path of the function.
+
+  // CHECK: id: 1
+  // CHECK-NEXT: id: 2
+  // CHECK-NEXT: id: 3
+  // CHECK-NEXT: id: 0
+  %ch1 = tfrt_test.test_cost %ch0 {id = 0 : i64, _tfrt_cost = 1 : i64}
+  %ch2 = tfrt_test.test_cost %ch0 {id = 1 : i64, _tfrt_cost = 2 : i64}
+  %ch3 = tfrt_test.test_cost %ch2 {id = 2 : i64, _tfrt_cost = 2 : i64}
+  %ch4 = tfrt_test.test_cost %ch3 {id = 3 : i64, _tfrt_cost = 2 : i64}
+
+  %ch5 = tfrt.merge.chains %ch1, %ch4 : !tfrt.chain, !tfrt.chain
+  tfrt.return %ch5 : !tfrt.chain
+}
+
+}
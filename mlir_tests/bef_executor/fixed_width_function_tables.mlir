@@ -0,0 +1,49 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: tfrt_translate -mlir-to-bef --fixed-width-function-tables %s | bef_executor_lite 2>&1 | FileCheck %s --dump-input=fail
+
+// CHECK-LABEL: --- Running 'fixed_width.async'
+func @fixed_width.async() -> i32 {
+  %ch0 = tfrt.new.chain
+
+  %x = tfrt.constant.i32 40
+  %y = tfrt.constant.i32 2
+  %z = tfrt.add.i32 %x, %y
+
+  // CHECK: int32 = 42
+  %ch1 = tfrt.print.i32 %z, %ch0
+
+  // CHECK: 'fixed_width.async' returned 42
+  tfrt.return %z : i32
+}
+
+// CHECK-LABEL: --- Running 'fixed_width.sync'
+func @fixed_width.sync() -> i32 attributes {tfrt.sync} {
+  %x = "tfrt.constant_s.i32"() {value = 42 : i32} : () -> i32
+  %y = "tfrt.constant_s.i32"() {value = 1 : i32} : () -> i32
+
+  %z = "tfrt.add_s.i32"(%x, %y) : (i32, i32) -> i32
+
+  // CHECK: 'fixed_width.sync' returned 43
+  tfrt.return %z : i32
+}
+
+// CHECK-LABEL: --- Running 'fixed_width.call'
+func @fixed_width.call() -> i32 {
+  %r = tfrt.call @fixed_width.async() : () -> i32
+
+  // CHECK: 'fixed_width.call' returned 42
+  tfrt.return %r : i32
+}
@@ -0,0 +1,43 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor_lite -print_kernel_profile $(bef_name %s) | FileCheck %s --dump-input=fail
+// RUN: bef_executor_lite -kernel_cost_profile=%t.profile $(bef_name %s)
+// RUN: FileCheck %s --check-prefix=COST --input-file=%t.profile
+
+// CHECK-LABEL: --- Running 'profiled'
+func @profiled() -> i32 {
+  %ch0 = tfrt.new.chain
+  %x = tfrt.constant.i32 41
+  %c1 = tfrt.constant.i32 1
+
+  %y = "tfrt_test.async_add.i32"(%x, %c1) : (i32, i32) -> i32
+  %z = tfrt.add.i32 %y, %c1
+
+  // CHECK: int32 = 43
+  %ch1 = tfrt.print.i32 %z, %ch0
+
+  tfrt.return %z : i32
+}
+
+// The kernel profile is printed after all functions have run.
+// CHECK: --- Kernel profile:
+// CHECK-DAG: {{^ +}}1 {{.*}} tfrt_test.async_add.i32 @ {{.*}}kernel_profile.mlir:{{[0-9]+}}:{{[0-9]+}}
+// CHECK-DAG: {{^ +}}1 {{.*}} tfrt.add.i32 @ {{.*}}kernel_profile.mlir:{{[0-9]+}}:{{[0-9]+}}
+// CHECK-DAG: {{^ +}}1 {{.*}} tfrt.print.i32 @ {{.*}}kernel_profile.mlir:{{[0-9]+}}:{{[0-9]+}}
+
+// The cost profile has a line per kernel, which tfrt-apply-cost-profile reads.
+// COST: # TFRT kernel cost profile
+// COST-DAG: {{^}}1 {{[0-9]+}} tfrt_test.async_add.i32 {{.*}}kernel_profile.mlir:{{[0-9]+}}:{{[0-9]+}}
+// COST-DAG: {{^}}1 {{[0-9]+}} tfrt.add.i32 {{.*}}kernel_profile.mlir:{{[0-9]+}}:{{[0-9]+}}
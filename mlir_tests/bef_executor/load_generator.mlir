@@ -0,0 +1,37 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor_lite --load_num_callers=4 --load_warmup_secs=0.01 --load_duration_secs=0.1 $(bef_name %s) | FileCheck %s --dump-input=fail --check-prefixes=CHECK,CLOSED
+// RUN: bef_executor_lite --load_qps=1000 --load_warmup_secs=0.01 --load_duration_secs=0.1 $(bef_name %s) | FileCheck %s --dump-input=fail --check-prefixes=CHECK,OPEN
+
+// CLOSED-LABEL: --- Running 'async_add' under load: 4 callers for 0.1s after 0.01s warmup
+// OPEN-LABEL: --- Running 'async_add' under load: 1000 calls/s for 0.1s after 0.01s warmup
+func @async_add() -> i32 {
+  %one = tfrt.constant.i32 1
+  %x = "tfrt_test.async_add.i32"(%one, %one) : (i32, i32) -> i32
+  %y = "tfrt_test.async_add.i32"(%x, %one) : (i32, i32) -> i32
+
+  // CHECK: 'async_add' completed {{[0-9]+}} calls (0 errors), {{.*}} calls/s
+  // CHECK: 'async_add' latency(us): min {{.*}}, mean {{.*}}, p50 {{.*}}, p90 {{.*}}, p99 {{.*}}, p99.9 {{.*}}, max
+  tfrt.return %y : i32
+}
+
+// CHECK-LABEL: --- Running 'sync_add' under load
+func @sync_add() -> i32 attributes {tfrt.sync} {
+  %one = "tfrt.constant_s.i32"() {value = 1 : i32} : () -> i32
+  %x = "tfrt.add_s.i32"(%one, %one) : (i32, i32) -> i32
+
+  // CHECK: 'sync_add' completed {{[0-9]+}} calls (0 errors)
+  tfrt.return %x : i32
+}
@@ -0,0 +1,56 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor_lite $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+// RUN: bef_executor_lite $(bef_name %s) --work_queue_type=mstd 2>&1 | FileCheck %s --dump-input=fail
+
+// The print in this function shows whether it is executed or its results are
+// taken from the cache.
+// CHECK-LABEL: --- Not running 'print_and_add_one' because it has arguments
+func @print_and_add_one(%ch: !tfrt.chain, %x: i32) -> (!tfrt.chain, i32)
+    attributes {tfrt.pure} {
+  %ch1 = tfrt.print.i32 %x, %ch
+  %c1 = tfrt.constant.i32 1
+  %y = tfrt.add.i32 %x, %c1
+  tfrt.return %ch1, %y : !tfrt.chain, i32
+}
+
+// CHECK-LABEL: --- Running 'call_pure_function'
+func @call_pure_function() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %c41 = tfrt.constant.i32 41
+  %c1 = tfrt.constant.i32 1
+
+  // CHECK-NEXT: int32 = 41
+  %ch1, %x = tfrt.call @print_and_add_one(%ch0, %c41)
+    : (!tfrt.chain, i32) -> (!tfrt.chain, i32)
+
+  // The second call with equal arguments returns the cached results.
+  %ch2, %y = tfrt.call @print_and_add_one(%ch1, %c41)
+    : (!tfrt.chain, i32) -> (!tfrt.chain, i32)
+
+  // CHECK-NEXT: int32 = 42
+  // CHECK-NEXT: int32 = 42
+  %ch3 = tfrt.print.i32 %x, %ch2
+  %ch4 = tfrt.print.i32 %y, %ch3
+
+  // CHECK-NEXT: int32 = 1
+  %ch5, %z = tfrt.call @print_and_add_one(%ch4, %c1)
+    : (!tfrt.chain, i32) -> (!tfrt.chain, i32)
+
+  // CHECK-NEXT: int32 = 2
+  %ch6 = tfrt.print.i32 %z, %ch5
+
+  tfrt.return %ch6 : !tfrt.chain
+}
@@ -0,0 +1,33 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor_lite -print_sampling_profile $(bef_name %s) | FileCheck %s --dump-input=fail
+
+// CHECK-LABEL: --- Running 'sampled'
+func @sampled() -> i32 {
+  %ch0 = tfrt.new.chain
+  %x = tfrt.constant.i32 41
+  %c1 = tfrt.constant.i32 1
+  %y = tfrt.add.i32 %x, %c1
+
+  // CHECK: int32 = 42
+  %ch1 = tfrt.print.i32 %y, %ch0
+
+  tfrt.return %y : i32
+}
+
+// The function runs too briefly to be sampled reliably, so only the header of
+// the profile is checked.
+// CHECK: --- Sampling profile ({{[0-9]+}} samples):
+// CHECK-NEXT: samples {{ +}}% function / kernel
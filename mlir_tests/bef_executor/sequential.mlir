@@ -0,0 +1,55 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor_lite $(bef_name %s) | FileCheck %s --dump-input=fail
+// RUN: bef_executor_lite -work_queue_type=mstd $(bef_name %s) | FileCheck %s --dump-input=fail
+
+// These functions are single chains of kernels, which are executed without
+// tracking ready counts until a kernel produces an unavailable value.
+
+// CHECK-LABEL: --- Running 'sequential_chain'
+func @sequential_chain() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+
+  // CHECK: hello host executor!
+  // CHECK-NEXT: hello host executor!
+  // CHECK-NEXT: hello host executor!
+  %ch1 = "tfrt_test.print_hello"(%ch0) : (!tfrt.chain) -> !tfrt.chain
+  %ch2 = "tfrt_test.print_hello"(%ch1) : (!tfrt.chain) -> !tfrt.chain
+  %ch3 = "tfrt_test.print_hello"(%ch2) : (!tfrt.chain) -> !tfrt.chain
+
+  tfrt.return %ch3 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'sequential_chain_with_async_kernel'
+func @sequential_chain_with_async_kernel() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+
+  // CHECK: hello host executor!
+  %ch1 = "tfrt_test.print_hello"(%ch0) : (!tfrt.chain) -> !tfrt.chain
+
+  // The result of tfrt_test.do.async is not available when it returns, so the
+  // rest of the chain runs when it becomes available.
+  // CHECK-NEXT: int32 = 42
+  %ch2 = tfrt_test.do.async %ch1 : (!tfrt.chain) -> (!tfrt.chain) {
+    %x = tfrt.constant.i32 42
+    %ch3 = tfrt.print.i32 %x, %ch1
+    tfrt.return %ch3 : !tfrt.chain
+  }
+
+  // CHECK-NEXT: hello host executor!
+  %ch4 = "tfrt_test.print_hello"(%ch2) : (!tfrt.chain) -> !tfrt.chain
+
+  tfrt.return %ch4 : !tfrt.chain
+}
@@ -155,3 +155,26 @@ func @test_invoke_sync_function() -> i32 {
   // CHECK: 'test_invoke_sync_function' returned 5
   tfrt.return %c : i32
 }
+
+// Sync kernels can also run in async functions, mixed with async kernels.
+// CHECK-LABEL: --- Running 'sync_kernels_in_async_function'
+func @sync_kernels_in_async_function() -> i32 {
+  %a = tfrt.constant.i32 2
+  %b = "tfrt.constant_s.i32"() {value = 3 : i32} : () -> i32
+
+  %c = "tfrt.add_s.i32"(%a, %b) : (i32, i32) -> i32
+  %d = tfrt.add.i32 %c, %b
+  %e = "tfrt.mul_s.i32"(%d, %c) : (i32, i32) -> i32
+  %f = "tfrt_test.sync_sum"(%a, %b, %e) : (i32, i32, i32) -> i32
+
+  // CHECK: 'sync_kernels_in_async_function' returned 45
+  tfrt.return %f : i32
+}
+
+// CHECK-LABEL: --- Running 'sync_kernel_error_in_async_function'
+func @sync_kernel_error_in_async_function() -> i32 {
+  %x = "tfrt_test.fail_s"() : () -> i32
+  %y = tfrt.add.i32 %x, %x
+  tfrt.return %y : i32
+}
+// CHECK: 'sync_kernel_error_in_async_function' returned <<error: something bad happened>>
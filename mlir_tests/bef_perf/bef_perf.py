@@ -32,6 +32,13 @@ The following metrics are collected:
   CPU 50%(us): The median (50%) CPU time for this function in microseconds
   CPU 95%(us): The 95 percentile CPU time for this function in microseconds
   CPU 99%(us): The 99 percentile CPU time for this function in microseconds
+  Throughput(runs/s): The number of runs per second, which is higher than the
+    inverse of the median wall time if the benchmark runs concurrently (see
+    num_concurrent_runs of tfrt_test.benchmark)
+
+The benchmarks can be run with several work queue types to compare them, e.g.
+--work_queue_type=s,mstd:4:4, in which case the results are reported per
+function and work queue type.
 
 Usage:
 
@@ -92,7 +99,7 @@ def print_perf_results(results, cpu_info):
   for name, res_dict in results.items():
     if not metrics:
       metrics = res_dict.keys()
-      row_format = '{:<25}' + '{:^15}' * len(metrics)
+      row_format = '{:<40}' + '{:^15}' * len(metrics)
 
       # print the header.
       print(row_format.format('', *metrics))
@@ -101,21 +108,23 @@ def print_perf_results(results, cpu_info):
     print(row_format.format(name, *results))
 
 
-def run_benchmark(env: Env, in_file):
+def run_benchmark(env: Env, file_name, mlir):
   """Run the benchmark functions contained in an MLIR file.
 
   Args:
     env: Runtime environment
-    in_file: MLIR file containing functions for benchmarking
+    file_name: Name of the MLIR file
+    mlir: MLIR code containing functions for benchmarking
 
   Returns:
     A dict from function names to the performance result dicts
   """
 
-  print('Running benchmarks in', in_file.name)
+  print('Running benchmarks in', file_name, 'with work queue',
+        env.work_queue_type)
   # Run file_path through mlir_to_bef and bef_executor and extract the
   # benchmark result.
-  return env.run_mlir(in_file.read())
+  return env.run_mlir(mlir)
 
 
 def main():
@@ -136,7 +145,8 @@ def main():
   parser.add_argument(
       '--work_queue_type',
       default='s',
-      help='Type of work queue (s(default), mstd, ...)')
+      help='Comma-separated types of work queue to run the benchmarks with '
+      '(s(default), mstd, ...)')
   parser.add_argument(
       '--tfrt_translate',
       default=os.path.join(BUILD_DIR, 'tools/tfrt_translate'),
@@ -148,18 +158,28 @@ def main():
 
   args = parser.parse_args()
 
-  env = Env(args.tfrt_translate, args.bef_executor, args.host_allocator_type,
-            args.work_queue_type)
-
-  # Run through each of the input mlir files.
-  print('-' * 40)
-  result_list = [run_benchmark(env, in_file) for in_file in args.mlirs]
-  print('-' * 40)
+  work_queue_types = args.work_queue_type.split(',')
+  mlirs = [in_file.read() for in_file in args.mlirs]
 
-  # Merge, format, and print the benchmark results.
+  # Run through each of the input mlir files with each work queue type.
   merged_results = dict()
-  for r in result_list:
-    merged_results.update(r)
+  for work_queue_type in work_queue_types:
+    env = Env(args.tfrt_translate, args.bef_executor, args.host_allocator_type,
+              work_queue_type)
+    print('-' * 40)
+    result_list = [
+        run_benchmark(env, in_file.name, mlir)
+        for in_file, mlir in zip(args.mlirs, mlirs)
+    ]
+    print('-' * 40)
+
+    # Merge the benchmark results, which are keyed by the function name and
+    # the work queue type if there are several.
+    for r in result_list:
+      for name, res_dict in r.items():
+        if len(work_queue_types) > 1:
+          name = '{} [{}]'.format(name, work_queue_type)
+        merged_results[name] = res_dict
 
   if not merged_results:
     print(
@@ -14,12 +14,18 @@
 
 """BUILD rules for generating benchmark .mlir files."""
 
-# Runs gen_benchmark_mlir to create ${benchmark_name}.mlir.
-def gen_benchmark(benchmark_name = "", num_kernels = 100):
+# Runs gen_benchmark_mlir to create ${benchmark_name}.mlir, or
+# ${benchmark_name}_x${num_concurrent_runs}.mlir for concurrent benchmarks.
+def gen_benchmark(benchmark_name = "", num_kernels = 100, num_concurrent_runs = 1):
+    name = benchmark_name
+    if num_concurrent_runs > 1:
+        name += "_x" + str(num_concurrent_runs)
     native.genrule(
-        name = "gen_" + benchmark_name,
-        outs = [benchmark_name + ".mlir"],
-        cmd = "$(location gen_benchmark_mlir) --num_kernels=" + str(num_kernels) + " " + benchmark_name + " > $@",
+        name = "gen_" + name,
+        outs = [name + ".mlir"],
+        cmd = "$(location gen_benchmark_mlir) --num_kernels=" + str(num_kernels) +
+              " --num_concurrent_runs=" + str(num_concurrent_runs) + " " +
+              benchmark_name + " > $@",
         exec_tools = ["gen_benchmark_mlir"],
         output_to_bindir = True,  # Match OSS
     )
@@ -17,12 +17,15 @@ r"""Generate performance test cases for BEFExecutor.
 
 Usage:
   python gen_benchmark_mlir.py <test_case> <optional:num_kernels>
+      <optional:num_concurrent_runs>
 
   where each 'test_case' is a key in main()'s generator_map.
 
   Example command:
   $ python3 gen_benchmark_mlir.py fully_serial --num_kernels 120 > \
       fully_serial.mlir
+  $ python3 gen_benchmark_mlir.py diamond --num_concurrent_runs 8 > \
+      diamond_x8.mlir
 """
 
 from __future__ import absolute_import
@@ -33,7 +36,7 @@ from mlir_tests.bef_perf.gen_benchmark_mlir_lib import gen_benchmark_mlir_main
 from mlir_tests.bef_perf.gen_benchmark_mlir_lib import generate_benchmark_mlir  # from @tf_runtime
 
 
-def generate_fully_serial_mlir(num_kernels):
+def generate_fully_serial_mlir(num_kernels, num_concurrent_runs=1):
   """Generate a fully serial DAG for benchmarking BEFExecutor."""
 
   body = """
@@ -59,10 +62,11 @@ def generate_fully_serial_mlir(num_kernels):
   # Add return statement.
   body += '\n  tfrt.return %c{} : i32'.format(num_kernels)
 
-  return generate_benchmark_mlir('BM_full_serial_{}'.format(num_kernels), body)
+  return generate_benchmark_mlir('BM_full_serial_{}'.format(num_kernels), body,
+                                 num_concurrent_runs)
 
 
-def generate_fully_parallel_mlir(num_kernels):
+def generate_fully_parallel_mlir(num_kernels, num_concurrent_runs=1):
   """Generate a fully parallel DAG for benchmarking BEFExecutor."""
 
   body = """
@@ -91,10 +95,10 @@ def generate_fully_parallel_mlir(num_kernels):
   body += '\n  tfrt.return %c{} : i32'.format(num_kernels)
 
   return generate_benchmark_mlir('BM_full_parallel_{}'.format(num_kernels),
-                                 body)
+                                 body, num_concurrent_runs)
 
 
-def generate_star_mlir(num_kernels):
+def generate_star_mlir(num_kernels, num_concurrent_runs=1):
   """Generate a fully parallel DAG for benchmarking BEFExecutor."""
 
   body = """
@@ -132,10 +136,11 @@ def generate_star_mlir(num_kernels):
   # Add return statement.
   body += '\n  tfrt.return %s : i32'
 
-  return generate_benchmark_mlir('BM_star_{}'.format(num_kernels), body)
+  return generate_benchmark_mlir('BM_star_{}'.format(num_kernels), body,
+                                 num_concurrent_runs)
 
 
-def generate_dense_host_tensor(num_kernels):
+def generate_dense_host_tensor(num_kernels, num_concurrent_runs=1):
   """Benchmark DHTIndexableView overhead.
 
   Generate a no-op dense host tensor program for benchmarking the overhead of
@@ -168,11 +173,12 @@ def generate_dense_host_tensor(num_kernels):
   body += '\n  tfrt.return %c{} : !tfrt.chain'.format(num_kernels)
 
   return generate_benchmark_mlir(
-      'BM_DenseHostTensor_{}'.format(num_kernels),
-      body) + '\n' + generate_host_tensor(num_kernels)
+      'BM_DenseHostTensor_{}'.format(num_kernels), body,
+      num_concurrent_runs) + '\n' + generate_host_tensor(
+          num_kernels, num_concurrent_runs)
 
 
-def generate_host_tensor(num_kernels):
+def generate_host_tensor(num_kernels, num_concurrent_runs=1):
   """Benchmark DHTIndexableView overhead.
 
   Generate a no-op host tensor program for benchmarking the overhead of
@@ -204,7 +210,217 @@ def generate_host_tensor(num_kernels):
   # Add return statement.
   body += '\n  tfrt.return %c{num_kernels} : !tfrt.chain'
 
-  return generate_benchmark_mlir('BM_HostTensor_{}'.format(num_kernels), body)
+  return generate_benchmark_mlir('BM_HostTensor_{}'.format(num_kernels), body,
+                                 num_concurrent_runs)
+
+
+def generate_diamond_mlir(num_kernels, num_concurrent_runs=1, width=8):
+  """Generate a DAG of fan-out/fan-in diamonds for benchmarking BEFExecutor."""
+
+  num_layers = max(1, num_kernels // (width + 1))
+
+  body = """
+  // The pseudo-code for this mlir function is as follows:
+  //
+  // a = 1
+  // s0 = 1
+  // for each layer l:
+  //   c_l_0 = s_l + a
+  //   ...
+  //   c_l_{{w}} = s_l + a
+  //   s_{{l+1}} = sum(c_l_0, ..., c_l_{{w}})
+  //
+  // The c_l_i's of a layer can be computed in parallel, and each layer waits
+  // for all of the c_l_i's of the previous layer.
+
+  %a = tfrt.constant.i32 1
+  %s0 = tfrt.constant.i32 1
+""".format()
+
+  lines = []
+  for l in range(num_layers):
+    for i in range(width):
+      lines.append(
+          '  %c{l}_{i} = "tfrt_test.async_add.i32"(%s{l}, %a) : '
+          '(i32, i32) -> i32'.format(l=l, i=i))
+    lines.append('  %s{} = "tfrt_test.sum"({}) : ({}) -> i32'.format(
+        l + 1, ', '.join('%c{}_{}'.format(l, i) for i in range(width)),
+        ', '.join(['i32'] * width)))
+
+  body += '\n'.join(lines)
+  # Add return statement.
+  body += '\n  tfrt.return %s{} : i32'.format(num_layers)
+
+  return generate_benchmark_mlir('BM_diamond_{}'.format(num_kernels), body,
+                                 num_concurrent_runs)
+
+
+def generate_async_chains_mlir(num_kernels,
+                               num_concurrent_runs=1,
+                               num_chains=8):
+  """Generate parallel chains of async kernels for benchmarking BEFExecutor."""
+
+  chain_length = max(1, num_kernels // num_chains)
+
+  body = """
+  // The pseudo-code for this mlir function is as follows:
+  //
+  // a = 1
+  // c_i_0 = 1
+  // c_i_1 = async(c_i_0 + a)
+  // c_i_2 = async(c_i_1 + a)
+  // ...
+  // s = sum(c_0_n, c_1_n, ...)
+  //
+  // Every kernel returns an unavailable value that is set on the work queue,
+  // so the executor suspends and resumes each chain at every kernel.
+
+  %a = tfrt.constant.i32 1
+  %c0 = tfrt.constant.i32 1
+"""
+
+  def value(chain, i):
+    return '%c0' if i == 0 else '%c{}_{}'.format(chain, i)
+
+  lines = []
+  for i in range(chain_length):
+    for chain in range(num_chains):
+      lines.append('  {} = "tfrt_test.async_add.i32"({}, %a) : '
+                   '(i32, i32) -> i32'.format(
+                       value(chain, i + 1), value(chain, i)))
+  lines.append('  %s = "tfrt_test.sum"({}) : ({}) -> i32'.format(
+      ', '.join(value(chain, chain_length) for chain in range(num_chains)),
+      ', '.join(['i32'] * num_chains)))
+
+  body += '\n'.join(lines)
+  # Add return statement.
+  body += '\n  tfrt.return %s : i32'
+
+  return generate_benchmark_mlir('BM_async_chains_{}'.format(num_kernels),
+                                 body, num_concurrent_runs)
+
+
+def generate_control_flow_mlir(num_kernels, num_concurrent_runs=1, depth=8):
+  """Generate nested control flow for benchmarking BEFExecutor.
+
+  The benchmarked region runs a tfrt.while loop, whose body calls a function
+  nested `depth` levels deep, where each level is a tfrt.if that calls the
+  next level with tfrt.call.
+  """
+
+  # Each iteration runs about 4 kernels per level.
+  num_iterations = max(1, num_kernels // (4 * depth))
+  name = 'BM_control_flow_{}'.format(num_kernels)
+
+  functions = ["""
+func @{name}_level0(%x: i32) -> i32 {{
+  %one = tfrt.constant.i32 1
+  %y = tfrt.add.i32 %x, %one
+  tfrt.return %y : i32
+}}
+""".format(name=name)]
+
+  for level in range(1, depth + 1):
+    functions.append("""
+func @{name}_level{level}(%x: i32) -> i32 {{
+  %cond = tfrt.constant.i1 true
+  %res = tfrt.if %cond, %x : (i32) -> (i32) {{
+    %y = tfrt.call @{name}_level{prev}(%x) : (i32) -> (i32)
+    tfrt.return %y : i32
+  }} else {{
+    tfrt.return %x : i32
+  }}
+  tfrt.return %res : i32
+}}
+""".format(name=name, level=level, prev=level - 1))
+
+  functions.append("""
+func @{name}_loop_body(%iteration: i32, %x: i32) -> (i32, i32, i1) {{
+  %one = tfrt.constant.i32 1
+  %last = tfrt.constant.i32 {last}
+  %next_iteration = tfrt.add.i32 %iteration, %one
+  %next_x = tfrt.call @{name}_level{depth}(%x) : (i32) -> (i32)
+  %cond = "tfrt.lessequal.i32"(%next_iteration, %last) : (i32, i32) -> (i1)
+  tfrt.return %next_iteration, %next_x, %cond : i32, i32, i1
+}}
+""".format(name=name, last=num_iterations - 1, depth=depth))
+
+  body = """
+  // The pseudo-code for this mlir function is as follows:
+  //
+  // x = 0
+  // for i in range({num_iterations}):
+  //   x = level{depth}(x)
+  //
+  // where level_k(x) = if true: level_{{k-1}}(x) and level_0(x) = x + 1.
+
+  %cond = tfrt.constant.i1 true
+  %zero = tfrt.constant.i32 0
+  %iteration, %x = tfrt.while %cond @{name}_loop_body(%zero, %zero) : (i32, i32) -> (i32, i32)
+  tfrt.return %x : i32
+""".format(num_iterations=num_iterations, depth=depth, name=name)
+
+  return ''.join(functions) + generate_benchmark_mlir(name, body,
+                                                      num_concurrent_runs)
+
+
+def generate_tensor_graph_mlir(num_kernels, num_concurrent_runs=1, size=32):
+  """Generate a graph of dense host tensor kernels for benchmarking BEFExecutor.
+
+  Each layer multiplies the output of the previous layer with a weight matrix
+  and applies relu, like the dense layers of a model. The scalar kernels of a
+  parallel branch compete with the tensor kernels for the work queue.
+  """
+
+  # Each layer runs 3 tensor kernels and 1 scalar kernel.
+  num_layers = max(1, num_kernels // 4)
+
+  body = """
+  // The pseudo-code for this mlir function is as follows:
+  //
+  // w = fill([{size}, {size}], 0.5)
+  // h_0 = fill([{size}, {size}], 1.0)
+  // s_0 = 1
+  // for each layer l:
+  //   h_l = relu(matmul(h_{{l-1}}, w))
+  //   s_l = async(s_{{l-1}} + 1)
+
+  %ch0 = tfrt.new.chain
+  %zero = tfrt.constant.f32 0.0
+  %one = tfrt.constant.f32 1.0
+  %a = tfrt.constant.i32 1
+  %s0 = tfrt.constant.i32 1
+
+  %w = tfrt_dht.create_uninitialized_tensor.f32.2 [{size} : i64, {size} : i64]
+  %ch_w = tfrt_dht.fill_tensor_with_constant.f32 %w, %ch0 0.5 : f32
+  %h0 = tfrt_dht.create_uninitialized_tensor.f32.2 [{size} : i64, {size} : i64]
+  %ch_h0 = tfrt_dht.fill_tensor_with_constant.f32 %h0, %ch0 1.0 : f32
+  %ch_0 = tfrt.merge.chains %ch_w, %ch_h0 : !tfrt.chain, !tfrt.chain
+""".format(size=size)
+
+  lines = []
+  for l in range(1, num_layers + 1):
+    lines += [
+        '  %h{l} = tfrt_dht.create_uninitialized_tensor.f32.2 '
+        '[{size} : i64, {size} : i64]'.format(l=l, size=size),
+        '  %ch_m{l} = "tfrt_test.matmul.f32.2"(%one, %h{prev}, %w, %zero, '
+        '%h{l}, %ch_{prev}) : (f32, !t.tensor, !t.tensor, f32, !t.tensor, '
+        '!tfrt.chain) -> !tfrt.chain'.format(l=l, prev=l - 1),
+        '  %ch_{l} = "tfrt_test.relu_inplace.f32"(%h{l}, %ch_m{l}) : '
+        '(!t.tensor, !tfrt.chain) -> !tfrt.chain'.format(l=l),
+        '  %s{l} = "tfrt_test.async_add.i32"(%s{prev}, %a) : '
+        '(i32, i32) -> i32'.format(l=l, prev=l - 1),
+    ]
+
+  body += '\n'.join(lines)
+  # Add return statement.
+  body += """
+  %ch_s = "tfrt_test.as_chain"(%s{l}) : (i32) -> !tfrt.chain
+  %ch_out = tfrt.merge.chains %ch_{l}, %ch_s : !tfrt.chain, !tfrt.chain
+  tfrt.return %ch_out : !tfrt.chain""".format(l=num_layers)
+
+  return generate_benchmark_mlir('BM_tensor_graph_{}'.format(num_kernels), body,
+                                 num_concurrent_runs)
 
 
 def main():
@@ -213,6 +429,10 @@ def main():
       'fully_parallel': generate_fully_parallel_mlir,
       'star': generate_star_mlir,
       'dense_host_tensor': generate_dense_host_tensor,
+      'diamond': generate_diamond_mlir,
+      'async_chains': generate_async_chains_mlir,
+      'control_flow': generate_control_flow_mlir,
+      'tensor_graph': generate_tensor_graph_mlir,
   }
   gen_benchmark_mlir_main(generator_map)
 
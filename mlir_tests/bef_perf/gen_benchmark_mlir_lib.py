@@ -38,23 +38,35 @@ def _indent_lines(s, indentation):
   return '\n'.join(lines)
 
 
-def generate_benchmark_mlir(func_name, body):
-  """Return the MLIR code for benchmarking func_name."""
+def generate_benchmark_mlir(func_name, body, num_concurrent_runs=1):
+  """Return the MLIR code for benchmarking func_name.
+
+  Args:
+    func_name: The name of the benchmark function.
+    body: The MLIR code of the benchmarked region.
+    num_concurrent_runs: The number of runs of the region in flight at the same
+      time. If greater than one, the benchmark name is suffixed with it.
+  """
 
   body = _indent_lines(body, indentation=4)
 
+  concurrency = ''
+  if num_concurrent_runs > 1:
+    func_name = '{}_x{}'.format(func_name, num_concurrent_runs)
+    concurrency = '\n    num_concurrent_runs = {},'.format(num_concurrent_runs)
+
   return """
 func @{func_name}() {{
   tfrt_test.benchmark "{func_name}"()
     duration_secs = 10,
-    max_count = 1000000,
+    max_count = 1000000,{concurrency}
     num_warmup_runs = 10 {{
 {body}
   }}
   tfrt.return
 }}
 """.format(
-    func_name=func_name, body=body)
+    func_name=func_name, body=body, concurrency=concurrency)
 
 
 def gen_benchmark_mlir_main(generator_map):
@@ -62,7 +74,8 @@ def gen_benchmark_mlir_main(generator_map):
 
   Args:
     generator_map: A dict mapping from test case names to functions that
-      generate code for that test.
+      generate code for that test. The functions take the number of kernels
+      and the number of concurrent runs.
 
   Raises:
     RuntimeError: When the test case name is not known.
@@ -74,13 +87,18 @@ def gen_benchmark_mlir_main(generator_map):
   parser.add_argument('--num_kernels', metavar='NUM_KERNELS', nargs='?',
                       type=int, default=100,
                       help='Number of kernels in a test. Default is 100.')
+  parser.add_argument('--num_concurrent_runs', metavar='NUM_CONCURRENT_RUNS',
+                      nargs='?', type=int, default=1,
+                      help='Number of runs of a test in flight at the same '
+                      'time. Default is 1.')
   args = parser.parse_args()
 
   header = """// This code is auto-generated from gen_benchmark_mlir.py. Do not edit manually.
 // To generate this file run:
-//   $ python3 ./gen_benchmark_mlir.py {test_names} --num_kernels {num_kernels}
+//   $ python3 ./gen_benchmark_mlir.py {test_names} --num_kernels {num_kernels} --num_concurrent_runs {num_concurrent_runs}
 """.format(test_names=' '.join(args.tests),
-           num_kernels=args.num_kernels)
+           num_kernels=args.num_kernels,
+           num_concurrent_runs=args.num_concurrent_runs)
   # pyformat: enable
 
   print(header)
@@ -90,4 +108,4 @@ def gen_benchmark_mlir_main(generator_map):
       raise RuntimeError('Unknown test case {}'.format(test))
 
     generator = generator_map[test]
-    print(generator(args.num_kernels))
+    print(generator(args.num_kernels, args.num_concurrent_runs))
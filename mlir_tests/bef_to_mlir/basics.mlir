@@ -13,6 +13,7 @@
 // limitations under the License.
 
 // RUN: tfrt_translate --bef-to-mlir $(bef_name %s) | tfrt_opt | FileCheck %s --dump-input=fail
+// RUN: tfrt_translate -mlir-to-bef --fixed-width-function-tables %s | tfrt_translate --bef-to-mlir | tfrt_opt | FileCheck %s --dump-input=fail
 
 // CHECK-LABEL: func @basic.argument
 func @basic.argument(%a : i32) -> i32 {
@@ -0,0 +1,129 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: tfrt_translate --bef-to-mlir $(bef_name %s) \
+// RUN: | tfrt_opt -allow-unregistered-dialect \
+// RUN: | FileCheck %s --check-prefix=ALL --dump-input=fail
+// RUN: tfrt_translate --bef-to-mlir --bef-to-mlir-functions=caller \
+// RUN:   $(bef_name %s) \
+// RUN: | tfrt_opt -allow-unregistered-dialect \
+// RUN: | FileCheck %s --check-prefix=CALLER --dump-input=fail
+// RUN: tfrt_translate --bef-to-mlir --bef-to-mlir-functions=unused,callee \
+// RUN:   $(bef_name %s) \
+// RUN: | tfrt_opt -allow-unregistered-dialect \
+// RUN: | FileCheck %s --check-prefix=UNUSED --dump-input=fail
+
+// ALL-LABEL: func private @native_func
+// CALLER-LABEL: func private @native_func
+// UNUSED-LABEL: func private @native_func
+func private @native_func(%x: i32) -> i32 attributes {tfrt.native}
+
+// ALL-LABEL: func @callee
+// CALLER-LABEL: func @callee
+// UNUSED-LABEL: func @callee
+func @callee(%x: i32) -> i32 {
+  %r = "native_call"(%x) {callee = @native_func} : (i32) -> i32
+  tfrt.return %r : i32
+}
+// UNUSED-NOT: @caller
+
+// ALL-LABEL: func @caller
+// CALLER-LABEL: func @caller
+func @caller(%cond: i1, %x: i32) -> i32 {
+  // CALLER: tfrt.if
+  %r = tfrt.if %cond, %x : (i32) -> (i32) {
+    // CALLER-NEXT: tfrt.call @callee
+    %y = tfrt.call @callee(%x) : (i32) -> i32
+    tfrt.return %y : i32
+  } else {
+    tfrt.return %x : i32
+  }
+  tfrt.return %r : i32
+}
+// CALLER-NOT: func
+
+// ALL-LABEL: func @unused
+// UNUSED-LABEL: func @unused
+func @unused() -> i32 {
+  %x = tfrt.constant.i32 1
+  tfrt.return %x : i32
+}
+// UNUSED-NOT: func
+
+// Enough functions to convert the kernels in parallel.
+// ALL-COUNT-16: tfrt.constant.i32 2
+func @f0() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f1() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f2() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f3() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f4() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f5() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f6() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f7() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f8() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f9() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f10() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f11() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f12() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f13() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f14() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
+func @f15() -> i32 {
+  %x = tfrt.constant.i32 2
+  tfrt.return %x : i32
+}
@@ -0,0 +1,39 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: echo "# TFRT kernel cost profile" > %t.profile
+// RUN: echo "4 8000000 tfrt.add.i32 %s:29:3" >> %t.profile
+// RUN: echo "2 100 tfrt.add.i32 %s:32:3" >> %t.profile
+// RUN: echo "1 1000 tfrt.add.i32 %s:32:3" >> %t.profile
+// RUN: echo "1 5000 tfrt.constant.i32 %s:99:3" >> %t.profile
+// RUN: tfrt_opt "-tfrt-apply-cost-profile=profile=%t.profile ns-per-cost-unit=1000" %s | FileCheck %s -dump-input=fail
+
+// RUN: not tfrt_opt "-tfrt-apply-cost-profile=profile=%t.missing" %s 2>&1 | FileCheck %s --check-prefix=MISSING
+// MISSING: failed to read kernel cost profile
+
+// CHECK-LABEL: func @profiled
+func @profiled(%x: i32) -> i32 {
+  // The average time of 2 ms is 2000 units.
+  // CHECK: tfrt.add.i32 {{.*}}{_tfrt_cost = 2000 : i64}
+  %y = tfrt.add.i32 %x, %x
+  // Records of the same kernel are added up, and costs are at least 1.
+  // CHECK: tfrt.add.i32 {{.*}}{_tfrt_cost = 1 : i64}
+  %z = tfrt.add.i32 %y, %x
+  // Operations that are not in the profile keep no cost.
+  // CHECK: tfrt.constant.i32 1
+  // CHECK-NOT: _tfrt_cost
+  %one = tfrt.constant.i32 1
+  %result = tfrt.add.i32 %z, %one
+  tfrt.return %result : i32
+}
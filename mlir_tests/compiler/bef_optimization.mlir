@@ -0,0 +1,69 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: tfrt_opt -tfrt-optimize-bef %s | FileCheck %s -dump-input=fail
+
+// The inlined function is removed.
+// CHECK-NOT: @double
+func private @double(%ch: !tfrt.chain, %x: i32) -> (!tfrt.chain, i32) {
+  %y = tfrt.add.i32 %x, %x
+  tfrt.return %ch, %y : !tfrt.chain, i32
+}
+
+// CHECK-LABEL: func @inline_call
+// CHECK-SAME: ([[ch:%.*]]: !tfrt.chain, [[x:%.*]]: i32)
+func @inline_call(%ch: !tfrt.chain, %x: i32) -> (!tfrt.chain, i32) {
+  // CHECK-NEXT: [[y:%.*]] = tfrt.add.i32 [[x]], [[x]]
+  // CHECK-NEXT: tfrt.return [[ch]], [[y]] : !tfrt.chain, i32
+  %ch1, %y = tfrt.call @double(%ch, %x) : (!tfrt.chain, i32) -> (!tfrt.chain, i32)
+  tfrt.return %ch1, %y : !tfrt.chain, i32
+}
+
+// CHECK-LABEL: func @fold_constants
+func @fold_constants() -> i32 {
+  // CHECK-NEXT: [[c:%.*]] = tfrt.constant.i32 42
+  // CHECK-NEXT: tfrt.return [[c]] : i32
+  %a = tfrt.constant.i32 20
+  %b = tfrt.constant.i32 1
+  %c = tfrt.add.i32 %a, %b
+  %two = tfrt.constant.i32 2
+  %d = tfrt.mul.i32 %c, %two
+  tfrt.return %d : i32
+}
+
+// CHECK-LABEL: func @simplify_chains
+// CHECK-SAME: ([[ch0:%.*]]: !tfrt.chain, [[ch1:%.*]]: !tfrt.chain)
+func @simplify_chains(%ch0: !tfrt.chain, %ch1: !tfrt.chain) -> (!tfrt.chain, !tfrt.chain) {
+  // CHECK-NEXT: [[merged:%.*]] = tfrt.merge.chains [[ch0]], [[ch1]] : !tfrt.chain, !tfrt.chain
+  // CHECK-NEXT: tfrt.return [[ch0]], [[merged]] : !tfrt.chain, !tfrt.chain
+  %new0 = tfrt.new.chain
+  %new1 = tfrt.new.chain
+  %a = tfrt.merge.chains %ch0, %new0 : !tfrt.chain, !tfrt.chain
+  %b = tfrt.merge.chains %ch0, %new1, %ch1, %ch0 : !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain
+  tfrt.return %a, %b : !tfrt.chain, !tfrt.chain
+}
+
+// CHECK-LABEL: func @remove_dead_kernels
+// CHECK-SAME: ([[x:%.*]]: i32)
+func @remove_dead_kernels(%x: i32) -> !tfrt.chain {
+  // CHECK-NEXT: [[ch0:%.*]] = tfrt.new.chain
+  // CHECK-NEXT: [[ch1:%.*]] = tfrt.print.i32 [[x]], [[ch0]]
+  // CHECK-NEXT: tfrt.return [[ch1]] : !tfrt.chain
+  %unused = tfrt.add.i32 %x, %x
+  %ch0 = tfrt.new.chain
+  %ch1 = tfrt.new.chain
+  %ch2 = tfrt.merge.chains %ch0, %ch1 : !tfrt.chain, !tfrt.chain
+  %ch3 = tfrt.print.i32 %x, %ch2
+  tfrt.return %ch3 : !tfrt.chain
+}
@@ -0,0 +1,74 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: tfrt_opt -tfrt-cpurt-cwise-clustering %s | FileCheck %s -dump-input=fail
+
+// CHECK-LABEL: @bias_relu_mul
+// CHECK-SAME: ([[x:%.*]]: !corert.tensorhandle, [[bias:%.*]]: !corert.tensorhandle, [[y:%.*]]: !corert.tensorhandle)
+func @bias_relu_mul(%x: !corert.tensorhandle, %bias: !corert.tensorhandle,
+                    %y: !corert.tensorhandle) -> !corert.tensorhandle {
+  %ch = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch "cpu"
+
+  // CHECK-NOT: corert.executeop
+  // CHECK: [[exec:%.*]] = cpurt.corert.compile {kernel = @cpurt_cwise::@main}
+  // CHECK: [[res:%.*]] = cpurt.corert.execute [[exec]] ([[x]], [[bias]], [[y]])
+  // CHECK-NEXT: tfrt.return [[res]]
+  %0 = corert.executeop(%cpu) "tf.BiasAdd"(%x, %bias) : 1
+  %1 = corert.executeop(%cpu) "tf.Relu"(%0) : 1
+  %2 = corert.executeop(%cpu) "tf.Mul"(%1, %y) : 1
+  tfrt.return %2 : !corert.tensorhandle
+}
+
+// CHECK-LABEL: @single_op
+func @single_op(%x: !corert.tensorhandle) -> !corert.tensorhandle {
+  %ch = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch "cpu"
+
+  // CHECK-NOT: cpurt.corert.compile
+  // CHECK: corert.executeop({{.*}}) "tf.Relu"
+  %0 = corert.executeop(%cpu) "tf.Relu"(%x) : 1
+  tfrt.return %0 : !corert.tensorhandle
+}
+
+// CHECK-LABEL: @used_before_cluster_end
+func @used_before_cluster_end(%x: !corert.tensorhandle)
+    -> (!corert.tensorhandle, !corert.tensorhandle) {
+  %ch = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch "cpu"
+
+  // CHECK-NOT: cpurt.corert.compile
+  // CHECK: corert.executeop({{.*}}) "tf.AddV2"
+  // CHECK: corert.executeop({{.*}}) "tf.Tanh"
+  // CHECK: corert.executeop({{.*}}) "tf.Mul"
+  %0 = corert.executeop(%cpu) "tf.AddV2"(%x, %x) : 1
+  %1 = corert.executeop(%cpu) "tf.Tanh"(%0) : 1
+  %2 = corert.executeop(%cpu) "tf.Mul"(%0, %1) : 1
+  tfrt.return %1, %2 : !corert.tensorhandle, !corert.tensorhandle
+}
+
+// CHECK: module @cpurt_cwise attributes {tfrt.compiled}
+// CHECK: func @main(%[[X:.*]]: memref<?x?xf32>, %[[B:.*]]: memref<?xf32>,
+// CHECK-SAME:       %[[Y:.*]]: memref<?x?xf32>) -> memref<?x?xf32>
+// CHECK-COUNT-3: assert
+// CHECK: %[[OUT:.*]] = memref.alloc
+// CHECK: linalg.generic
+// CHECK-SAME: ins(%[[X]], %[[B]], %[[Y]]
+// CHECK-SAME: outs(%[[OUT]]
+// CHECK: addf
+// CHECK: cmpf ogt
+// CHECK: select
+// CHECK: mulf
+// CHECK: linalg.yield
+// CHECK: return %[[OUT]] : memref<?x?xf32>
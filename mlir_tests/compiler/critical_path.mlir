@@ -0,0 +1,42 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: tfrt_opt -tfrt-print-stream -verify-diagnostics %s
+
+module attributes {tfrt.cost_threshold = 10 : i64} {
+
+// critical path cost of root = 1 (root) + 11 (%ch1)
+// expected-remark@+1 {{critical path cost: 12}}
+func @critical_path(%ch0: !tfrt.chain) -> !tfrt.chain {
+  // The chain %ch1 -> %ch2 -> %ch3 is the critical path, even though %ch4 is
+  // the most expensive op.
+
+  // expected-remark@+1 {{critical path cost: 11}}
+  %ch1 = tfrt_test.test_cost %ch0 {id = 0 : i64, _tfrt_cost = 3 : i64}
+  // expected-remark@+1 {{critical path cost: 8}}
+  %ch2 = tfrt_test.test_cost %ch1 {id = 1 : i64, _tfrt_cost = 3 : i64}
+  // expected-remark@+1 {{critical path cost: 5}}
+  %ch3 = tfrt_test.test_cost %ch2 {id = 2 : i64, _tfrt_cost = 3 : i64}
+
+  // expected-remark@+1 {{critical path cost: 7}}
+  %ch4 = tfrt_test.test_cost %ch0 {id = 3 : i64, _tfrt_cost = 5 : i64}
+
+  // expected-remark@+1 {{critical path cost: 2}}
+  %ch5 = tfrt.merge.chains %ch3, %ch4 : !tfrt.chain, !tfrt.chain
+
+  // expected-remark@+1 {{critical path cost: 1}}
+  tfrt.return %ch5 : !tfrt.chain
+}
+
+}
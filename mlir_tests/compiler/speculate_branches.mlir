@@ -0,0 +1,79 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: tfrt_opt -tfrt-speculate-branches %s | FileCheck %s -dump-input=fail
+
+module attributes {tfrt.cost_threshold = 10 : i64} {
+
+func @identity(%x: i32) -> i32 {
+  tfrt.return %x : i32
+}
+
+// Operations without a cost cost the threshold.
+func @double(%x: i32) -> i32 {
+  %y = tfrt.add.i32 %x, %x
+  tfrt.return %y : i32
+}
+
+func @add_one(%x: i32) -> i32 {
+  %one = tfrt.constant.i32 1
+  %y = tfrt.add.i32 %x, %one
+  tfrt.return %y : i32
+}
+
+func @print(%x: i32) -> i32 {
+  %ch0 = tfrt.new.chain
+  %ch1 = tfrt.print.i32 %x, %ch0
+  tfrt.return %x : i32
+}
+
+// CHECK-LABEL: func @cheap_cond
+func @cheap_cond(%cond: i1, %x: i32) -> i32 {
+  // CHECK: tfrt.cond {{.*}} @identity @double {{.*}} {speculative = true}
+  %res = tfrt.cond %cond @identity @double (%x) : (i32) -> (i32)
+  tfrt.return %res : i32
+}
+
+// CHECK-LABEL: func @expensive_cond
+func @expensive_cond(%cond: i1, %x: i32) -> i32 {
+  // CHECK-NOT: speculative
+  %res = tfrt.cond %cond @identity @add_one (%x) : (i32) -> (i32)
+  tfrt.return %res : i32
+}
+
+// CHECK-LABEL: func @side_effect_cond
+func @side_effect_cond(%cond: i1, %x: i32) -> i32 {
+  // CHECK-NOT: speculative
+  %res = tfrt.cond %cond @identity @print (%x) : (i32) -> (i32)
+  tfrt.return %res : i32
+}
+
+func @branch0(%ch: !tfrt.chain, %x: i32) -> (!tfrt.chain, i32) {
+  tfrt.return %ch, %x : !tfrt.chain, i32
+}
+
+func @branch1(%ch: !tfrt.chain, %x: i32) -> (!tfrt.chain, i32) {
+  %y = tfrt.add.i32 %x, %x
+  tfrt.return %ch, %y : !tfrt.chain, i32
+}
+
+// CHECK-LABEL: func @cheap_case
+func @cheap_case(%index: i32, %x: i32) -> i32 {
+  %ch0 = tfrt.new.chain
+  // CHECK: tfrt.case {{.*}} [@branch0, @branch1] {{.*}} {speculative = true}
+  %ch1, %res = tfrt.case %index [@branch0, @branch1] (%ch0, %x) : (i32) -> (i32)
+  tfrt.return %res : i32
+}
+
+}
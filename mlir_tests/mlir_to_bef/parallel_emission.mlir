@@ -0,0 +1,172 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Modules with many functions are emitted in parallel. Check that the output
+// does not depend on the number of threads, with and without fixed width
+// function tables.
+
+// RUN: tfrt_translate -mlir-to-bef %s > %t.parallel.bef
+// RUN: tfrt_translate -mlir-to-bef --mlir-disable-threading %s > %t.sequential.bef
+// RUN: cmp %t.parallel.bef %t.sequential.bef
+
+// RUN: tfrt_translate -mlir-to-bef --fixed-width-function-tables %s > %t.parallel.fixed.bef
+// RUN: tfrt_translate -mlir-to-bef --fixed-width-function-tables --mlir-disable-threading %s > %t.sequential.fixed.bef
+// RUN: cmp %t.parallel.fixed.bef %t.sequential.fixed.bef
+
+func private @native(%x: i32) -> i32 attributes {tfrt.native}
+
+func @async.0(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 0
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @sync.1(%x : i32) -> i32 attributes {tfrt.sync} {
+  %y = "tfrt.add_s.i32"(%x, %x) {name = "sync.1"} : (i32, i32) -> i32
+  tfrt.return %y : i32
+}
+
+func @async.2(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 2
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @async.3(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 3
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @async.4(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 4
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @sync.5(%x : i32) -> i32 attributes {tfrt.sync} {
+  %y = "tfrt.add_s.i32"(%x, %x) {name = "sync.5"} : (i32, i32) -> i32
+  tfrt.return %y : i32
+}
+
+func @async.6(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 6
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @async.7(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 7
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @async.8(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 8
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @sync.9(%x : i32) -> i32 attributes {tfrt.sync} {
+  %y = "tfrt.add_s.i32"(%x, %x) {name = "sync.9"} : (i32, i32) -> i32
+  tfrt.return %y : i32
+}
+
+func @async.10(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 10
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @async.11(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 11
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @async.12(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 12
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @sync.13(%x : i32) -> i32 attributes {tfrt.sync} {
+  %y = "tfrt.add_s.i32"(%x, %x) {name = "sync.13"} : (i32, i32) -> i32
+  tfrt.return %y : i32
+}
+
+func @async.14(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 14
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @async.15(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 15
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @async.16(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 16
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @sync.17(%x : i32) -> i32 attributes {tfrt.sync} {
+  %y = "tfrt.add_s.i32"(%x, %x) {name = "sync.17"} : (i32, i32) -> i32
+  tfrt.return %y : i32
+}
+
+func @async.18(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 18
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
+
+func @async.19(%x : i32, %ch : !tfrt.chain) -> (i32, !tfrt.chain) {
+  %c = tfrt.constant.i32 19
+  %y = tfrt.add.i32 %x, %c
+  %z = "native_call"(%y) {callee = @native} : (i32) -> i32
+  %ch1 = tfrt.print.i32 %z, %ch
+  tfrt.return %z, %ch1 : i32, !tfrt.chain
+}
@@ -42,3 +42,17 @@ func @sync_basic() attributes {tfrt.sync} {
 
   tfrt.return
 }
+
+// CHECK-LABEL: --- Running 'packed'
+func @packed() {
+  %c0 = tfrt.new.chain
+
+  %a = "tfrt_sht.create_packed_tensor"()
+    {shape = [3], values = ["packed", "", "tensor"]} : () -> !t.tensor
+
+  // CHECK: PackedStringHostTensor shape = [3]
+  // CHECK-SAME: values = ["packed", "", "tensor"]
+  %c1 = tfrt_dht.print_tensor %a, %c0
+
+  tfrt.return
+}
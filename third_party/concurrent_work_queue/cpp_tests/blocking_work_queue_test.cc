@@ -85,11 +85,58 @@ TEST(BlockingWorkQueueTest, Quiescing) {
   barrier.count_down();
   // Wait for completion.
   executed.wait();
+  // Wait until the pending task counters are decremented.
+  quiescing.Wait();
 
   // Verify that pending task counter was not attached to rejected 't5'.
   ASSERT_FALSE(quiescing.HasPendingTasks());
 }
 
+TEST(BlockingWorkQueueTest, OverflowToDynamicThreads) {
+  auto quiescing_state = std::make_unique<internal::QuiescingState>();
+  WorkQueue work_queue(quiescing_state.get(), 1,
+                       /*max_num_dynamic_threads=*/2, std::chrono::seconds(1),
+                       /*max_num_overflow_threads=*/2);
+
+  latch barrier(1);
+  latch executed(4);
+
+  auto task = [&](latch* started) -> TaskFunction {
+    return TaskFunction([&, started]() {
+      if (started) started->count_down();
+      barrier.wait();
+      executed.count_down();
+    });
+  };
+
+  // Each task starts before the next one is added, so the static thread is
+  // busy, and the next two tasks overflow to dynamic threads.
+  for (int i = 0; i < 3; ++i) {
+    latch started(1);
+    auto t = work_queue.EnqueueBlockingTask(task(&started));
+    ASSERT_FALSE(t.hasValue());
+    started.wait();
+  }
+
+  // All dynamic threads are busy, the task waits in the static queue.
+  auto t4 = work_queue.EnqueueBlockingTask(task(nullptr));
+  ASSERT_FALSE(t4.hasValue());
+  auto t5 = work_queue.RunBlockingTask(task(nullptr));
+  ASSERT_TRUE(t5.hasValue());  // rejected
+
+  // Let the tasks complete.
+  barrier.count_down();
+  executed.wait();
+  work_queue.Quiesce();
+
+  // Dynamic threads are available again.
+  latch done(1);
+  auto t6 =
+      work_queue.RunBlockingTask(TaskFunction([&] { done.count_down(); }));
+  ASSERT_FALSE(t6.hasValue());
+  done.wait();
+}
+
 // -------------------------------------------------------------------------- //
 // Performance benchmarks.
 // -------------------------------------------------------------------------- //
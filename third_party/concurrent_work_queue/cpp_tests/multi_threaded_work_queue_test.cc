@@ -4,14 +4,23 @@
 
 // Unit tests and benchmarks for MultiThreadedWorkQueue.
 
+#include <algorithm>
 #include <atomic>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 #include "gtest/gtest.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/support/latch.h"
 
 namespace tfrt {
 namespace {
@@ -50,5 +59,149 @@ TEST(MultiThreadedWorkQueueTest, PingPong) {
   ASSERT_EQ(last_executed_task, num_tasks - 1);
 }
 
+TEST(MultiThreadedWorkQueueTest, QuiesceWaitsForNestedTasks) {
+  auto host = CreateTestHostContext(4);
+
+  // Each task adds a blocking task that adds a non-blocking task, so there
+  // are moments when no task is queued while tasks are still pending.
+  std::atomic<int> num_completed{0};
+  const int num_tasks = 100;
+  for (int i = 0; i < num_tasks; ++i) {
+    EnqueueWork(host.get(), [&] {
+      bool enqueued = EnqueueBlockingWork(host.get(), [&] {
+        EnqueueWork(host.get(), [&] { ++num_completed; });
+      });
+      EXPECT_TRUE(enqueued);
+    });
+  }
+  host->Quiesce();
+  EXPECT_EQ(num_completed.load(), num_tasks);
+
+  // Quiesce() returns right away when no task is pending.
+  for (int i = 0; i < 100; ++i) host->Quiesce();
+}
+
+TEST(MultiThreadedWorkQueueTest, RequestPriority) {
+  auto host = CreateTestHostContext(1);
+  auto make_exec_ctx = [&](RequestOptions::RequestPriority priority) {
+    RequestOptions options;
+    options.priority = priority;
+    auto req_ctx = RequestContextBuilder(host.get(), nullptr)
+                       .set_request_options(options)
+                       .build();
+    return ExecutionContext(std::move(*req_ctx));
+  };
+  ExecutionContext low = make_exec_ctx(RequestOptions::kLowPriority);
+  ExecutionContext high = make_exec_ctx(RequestOptions::kHighPriority);
+  EXPECT_EQ(high.priority(), RequestOptions::kHighPriority);
+
+  // The low priority task is added last, but it runs after the high priority
+  // task. Wait with a latch, because Quiesce() can run the tasks in this
+  // thread.
+  std::vector<int> order;
+  latch done(2);
+  EnqueueWork(high, [&] {
+    EnqueueWork(high, [&] {
+      order.push_back(1);
+      done.count_down();
+    });
+    EnqueueWork(low, [&] {
+      order.push_back(2);
+      done.count_down();
+    });
+  });
+  done.wait();
+  EXPECT_EQ(order, std::vector<int>({1, 2}));
+}
+
+TEST(MultiThreadedWorkQueueTest, DeadlineScheduling) {
+  MultiThreadedWorkQueueOptions options;
+  options.num_threads = 1;
+  options.num_blocking_threads = 1;
+  options.deadline_scheduling = true;
+  options.urgent_deadline_slack = std::chrono::seconds(10);
+  auto host = std::make_unique<HostContext>([](const DecodedDiagnostic&) {},
+                                            CreateMallocAllocator(), options);
+  auto make_request = [&](std::chrono::system_clock::time_point deadline) {
+    RequestOptions options;
+    options.deadline = deadline;
+    return RequestContextBuilder(host.get(), nullptr)
+        .set_request_options(options)
+        .build();
+  };
+
+  // A request that is past its deadline is rejected.
+  auto late = make_request(std::chrono::system_clock::now());
+  EXPECT_FALSE(late);
+  llvm::consumeError(late.takeError());
+
+  auto bulk_ctx = make_request(std::chrono::system_clock::time_point::max());
+  auto urgent_ctx =
+      make_request(std::chrono::system_clock::now() + std::chrono::seconds(1));
+  ASSERT_TRUE(bulk_ctx && urgent_ctx);
+  ExecutionContext bulk(std::move(*bulk_ctx));
+  ExecutionContext urgent(std::move(*urgent_ctx));
+
+  // The task of the request close to its deadline is added first, but it runs
+  // before the task without a deadline, which would otherwise run first as the
+  // most recently added task of the worker thread.
+  std::vector<int> order;
+  latch done(2);
+  EnqueueWork(bulk, [&] {
+    EnqueueWork(urgent, [&] {
+      order.push_back(1);
+      done.count_down();
+    });
+    EnqueueWork(bulk, [&] {
+      order.push_back(2);
+      done.count_down();
+    });
+  });
+  done.wait();
+  EXPECT_EQ(order, std::vector<int>({1, 2}));
+}
+
+#if defined(__linux__)
+// Returns the CPUs the calling thread is allowed to run on.
+std::vector<int> GetCurrentThreadCpus() {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  sched_getaffinity(/*pid=*/0, sizeof(cpu_set), &cpu_set);
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &cpu_set)) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+TEST(MultiThreadedWorkQueueTest, PinnedThreads) {
+  if (std::thread::hardware_concurrency() < 2) GTEST_SKIP();
+
+  MultiThreadedWorkQueueOptions options;
+  options.num_threads = 2;
+  options.num_blocking_threads = 2;
+  options.cpus = {0};
+  auto host = std::make_unique<HostContext>([](const DecodedDiagnostic&) {},
+                                            CreateMallocAllocator(), options);
+
+  // The non-blocking threads run on CPU 0, the blocking threads on the others.
+  std::vector<int> cpus, blocking_cpus;
+  latch done(2);
+  host->work_queue().AddTask(TaskFunction([&] {
+    if (host->IsInWorkerThread()) cpus = GetCurrentThreadCpus();
+    done.count_down();
+  }));
+  EXPECT_TRUE(EnqueueBlockingWork(host.get(), [&] {
+    blocking_cpus = GetCurrentThreadCpus();
+    done.count_down();
+  }));
+  done.wait();
+
+  if (!cpus.empty()) EXPECT_EQ(cpus, std::vector<int>({0}));
+  EXPECT_FALSE(blocking_cpus.empty());
+  EXPECT_EQ(std::count(blocking_cpus.begin(), blocking_cpus.end(), 0), 0);
+}
+#endif  // __linux__
+
 }  // namespace
 }  // namespace tfrt
@@ -6,7 +6,14 @@
 
 #include "non_blocking_work_queue.h"
 
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
 #include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/host_context/task_function.h"
 #include "tfrt/support/latch.h"
 #include "tfrt/support/thread_environment.h"
@@ -16,6 +23,156 @@ namespace {
 
 using WorkQueue = ::tfrt::internal::NonBlockingWorkQueue<ThreadingEnvironment>;
 
+TEST(NonBlockingWorkQueueTest, LastAddedTaskRunsNext) {
+  internal::QuiescingState qstate;
+  WorkQueue work_queue(&qstate, 1);
+
+  // Wait with a latch, because Quiesce() can run the tasks in this thread.
+  std::vector<int> order;
+  ::tfrt::latch done(3);
+  auto record = [&](int i) {
+    return TaskFunction([&, i] {
+      order.push_back(i);
+      done.count_down();
+    });
+  };
+  work_queue.AddTask(TaskFunction([&] {
+    work_queue.AddTask(record(1));
+    work_queue.AddTask(record(2));
+    work_queue.AddTask(record(3));
+  }));
+  done.wait();
+
+  EXPECT_EQ(order, std::vector<int>({3, 2, 1}));
+}
+
+TEST(NonBlockingWorkQueueTest, TasksRunInPriorityOrder) {
+  internal::QuiescingState qstate;
+  WorkQueue work_queue(&qstate, 1);
+
+  std::vector<int> order;
+  ::tfrt::latch done(4);
+  auto record = [&](int i) {
+    return TaskFunction([&, i] {
+      order.push_back(i);
+      done.count_down();
+    });
+  };
+  work_queue.AddTask(TaskFunction([&] {
+    work_queue.AddTask(record(1), internal::TaskPriority::kLow);
+    work_queue.AddTask(record(2), internal::TaskPriority::kHigh);
+    work_queue.AddTask(record(3), internal::TaskPriority::kDefault);
+    work_queue.AddTask(record(4), internal::TaskPriority::kCritical);
+  }));
+  done.wait();
+
+  EXPECT_EQ(order, std::vector<int>({4, 2, 3, 1}));
+}
+
+TEST(NonBlockingWorkQueueTest, LowPriorityTaskDoesNotStarve) {
+  internal::QuiescingState qstate;
+  WorkQueue work_queue(&qstate, 1);
+
+  // A chain of high priority tasks runs until the low priority task runs.
+  std::atomic<bool> low_priority_done{false};
+  std::function<void()> add_high_priority_task = [&] {
+    work_queue.AddTask(TaskFunction([&] {
+                         if (!low_priority_done) add_high_priority_task();
+                       }),
+                       internal::TaskPriority::kHigh);
+  };
+
+  ::tfrt::latch done(1);
+  work_queue.AddTask(TaskFunction([&] {
+    work_queue.AddTask(TaskFunction([&] {
+                         low_priority_done = true;
+                         done.count_down();
+                       }),
+                       internal::TaskPriority::kLow);
+    add_high_priority_task();
+  }));
+  done.wait();
+  work_queue.Quiesce();
+}
+
+TEST(NonBlockingWorkQueueTest, ContinuationRunsInSameThread) {
+  internal::QuiescingState qstate;
+  WorkQueue work_queue(&qstate, 4);
+
+  const int num_tasks = 100;
+  std::atomic<int> num_same_thread{0};
+  ::tfrt::latch done(num_tasks);
+  for (int i = 0; i < num_tasks; ++i) {
+    work_queue.AddTask(TaskFunction([&] {
+      std::thread::id id = std::this_thread::get_id();
+      work_queue.AddTask(TaskFunction([&, id] {
+        if (std::this_thread::get_id() == id) ++num_same_thread;
+        done.count_down();
+      }));
+    }));
+  }
+  done.wait();
+  EXPECT_EQ(num_same_thread.load(), num_tasks);
+}
+
+TEST(NonBlockingWorkQueueTest, AddTasks) {
+  internal::QuiescingState qstate;
+  WorkQueue work_queue(&qstate, 4);
+
+  // Add more tasks than the size of a per-thread queue, so that some of them
+  // run in the calling thread.
+  const int num_tasks = 2 * internal::TaskPriorityDeque::kCapacity;
+  std::atomic<int> num_completed{0};
+  auto make_tasks = [&] {
+    llvm::SmallVector<TaskFunction, 16> tasks;
+    for (int i = 0; i < num_tasks; ++i)
+      tasks.emplace_back([&] { ++num_completed; });
+    return tasks;
+  };
+
+  // Add tasks from a free-standing thread.
+  auto tasks = make_tasks();
+  work_queue.AddTasks(tasks);
+  work_queue.Quiesce();
+  EXPECT_EQ(num_completed.load(), num_tasks);
+
+  // Add tasks from a worker thread.
+  ::tfrt::latch done(1);
+  work_queue.AddTask(TaskFunction([&] {
+    auto tasks = make_tasks();
+    work_queue.AddTasks(tasks);
+    done.count_down();
+  }));
+  done.wait();
+  work_queue.Quiesce();
+  EXPECT_EQ(num_completed.load(), 2 * num_tasks);
+}
+
+TEST(NonBlockingWorkQueueTest, WorkerThreadStats) {
+  internal::QuiescingState qstate;
+  WorkQueue work_queue(&qstate, 2);
+  // Wait until both worker threads park.
+  work_queue.Quiesce();
+
+  // A task added to the queue of a busy worker thread is stolen by the other
+  // worker thread, which is woken up for it.
+  ::tfrt::latch stolen(1);
+  ::tfrt::latch done(1);
+  work_queue.AddTask(TaskFunction([&] {
+    TaskFunction task([&] { stolen.count_down(); });
+    work_queue.AddTasks(MutableArrayRef<TaskFunction>(task));
+    stolen.wait();
+    done.count_down();
+  }));
+  done.wait();
+  work_queue.Quiesce();
+
+  internal::WorkQueueStats stats = work_queue.GetStats();
+  EXPECT_GE(stats.num_steals, 1);
+  EXPECT_GE(stats.num_unparks, 1);
+  EXPECT_GE(stats.num_parks, stats.num_unparks);
+}
+
 // Benchmark work queue throughput.
 //
 // Submit `num_producers` tasks to `producer` work queue, each submitting
@@ -73,6 +230,42 @@ void NoOp(WorkQueue& producer, WorkQueue& worker, benchmark::State& state) {
       ->ArgPair(100, 100)                         \
       ->ArgPair(100, 1000)
 
+// Benchmark the fan-out of `num_tasks` no-op tasks from a worker thread, added
+// one by one or as a batch.
+void FanOut(benchmark::State& state, bool batch) {
+  BenchmarkUseRealTime();
+  internal::QuiescingState qstate;
+  WorkQueue worker(&qstate, 8);
+  const int num_tasks = state.range(0);
+
+  for (auto _ : state) {
+    ::tfrt::latch latch(num_tasks);
+    worker.AddTask(TaskFunction([&] {
+      llvm::SmallVector<TaskFunction, 64> tasks;
+      for (int i = 0; i < num_tasks; ++i)
+        tasks.emplace_back([&] { latch.count_down(); });
+      if (batch) {
+        worker.AddTasks(tasks);
+      } else {
+        for (TaskFunction& task : tasks) worker.AddTask(std::move(task));
+      }
+    }));
+    latch.wait();
+  }
+
+  state.SetItemsProcessed(num_tasks * state.iterations());
+}
+
+static void BM_FanOut_AddTask(benchmark::State& state) {
+  FanOut(state, /*batch=*/false);
+}
+BENCHMARK(BM_FanOut_AddTask)->Arg(8)->Arg(64);
+
+static void BM_FanOut_AddTasks(benchmark::State& state) {
+  FanOut(state, /*batch=*/true);
+}
+BENCHMARK(BM_FanOut_AddTasks)->Arg(8)->Arg(64);
+
 BM_NoOp(4, 4);
 BM_NoOp(8, 8);
 BM_NoOp(16, 16);
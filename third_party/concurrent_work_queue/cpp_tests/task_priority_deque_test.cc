@@ -152,6 +152,23 @@ TEST(TaskPriorityDequeTest, PushFrontAndPopBackWithPriority) {
   ASSERT_EQ(queue.Size(), 0);
 }
 
+TEST(TaskPriorityDequeTest, PushAndPopFrontLowestPriority) {
+  TaskFunctions fn;
+  TaskPriorityDeque queue;
+
+  ASSERT_EQ(queue.PushFront(fn.Next(1), TaskPriority::kLow), llvm::None);
+  ASSERT_EQ(queue.PushFront(fn.Next(2), TaskPriority::kLow), llvm::None);
+  ASSERT_EQ(queue.PushFront(fn.Next(3), TaskPriority::kDefault), llvm::None);
+  ASSERT_EQ(queue.PushFront(fn.Next(4), TaskPriority::kCritical), llvm::None);
+
+  ASSERT_EQ(fn.Run(queue.PopFrontLowestPriority()), 2);
+  ASSERT_EQ(fn.Run(queue.PopFrontLowestPriority()), 1);
+  ASSERT_EQ(fn.Run(queue.PopFrontLowestPriority()), 3);
+  ASSERT_EQ(fn.Run(queue.PopFrontLowestPriority()), 4);
+  ASSERT_EQ(queue.PopFrontLowestPriority(), llvm::None);
+  ASSERT_EQ(queue.Size(), 0);
+}
+
 TEST(TaskPriorityDequeTest, PushFrontToOverflowDefaultPriority) {
   TaskFunctions fn;
   TaskPriorityDeque queue;
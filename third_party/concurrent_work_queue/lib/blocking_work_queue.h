@@ -7,10 +7,33 @@
 //
 // This work queue uses TaskQueue for storing pending tasks. Tasks executed
 // in mostly FIFO order, which is optimal for IO tasks.
+//
+// Blocking tasks that do not allow queuing run in dynamically started threads,
+// which exit after they are idle for `idle_wait_time`. With
+// `max_num_overflow_threads` > 0, tasks that allow queuing also overflow to the
+// dynamic threads when all statically allocated threads are busy, so that the
+// static threads are only the minimum capacity, and the rest of the capacity
+// tracks the load.
+//
+// The work queue records the following metrics, prefixed with
+// /tfrt/host_context/blocking_work_queue/. The task metrics are recorded for
+// one in `kMetricsSamplingPeriod` tasks added with EnqueueBlockingTask(), and
+// for all tasks added with RunBlockingTask():
+//
+//   queue_depth: the size of the static thread queue that accepted the task.
+//   queue_latency_us: the time from adding the task until it starts running.
+//   run_time_us: the time the task runs.
+//   long_tasks: the number of tasks running for longer than kLongTaskTime,
+//     which are also recorded as tracing events.
+//   dynamic_threads: the number of dynamic threads when one starts or exits.
+//   idle_dynamic_threads: the number of dynamic threads waiting for a task.
+//   spins_per_park, steals_per_park, steals, parks, parked_threads: the
+//     activity of the static threads, see WorkQueueMetrics.
 
 #ifndef TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_BLOCKING_WORK_QUEUE_H_
 #define TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_BLOCKING_WORK_QUEUE_H_
 
+#include <chrono>
 #include <cstdint>
 #include <limits>
 #include <list>
@@ -21,6 +44,7 @@
 #include "llvm/Support/Compiler.h"
 #include "task_queue.h"
 #include "tfrt/host_context/task_function.h"
+#include "tfrt/metrics/metrics.h"
 #include "work_queue_base.h"
 
 namespace tfrt {
@@ -29,6 +53,29 @@ namespace internal {
 template <typename ThreadingEnvironment>
 class BlockingWorkQueue;
 
+// The metrics shared by all blocking work queues.
+struct BlockingWorkQueueMetrics {
+  WorkQueueMetrics work_queue;
+  metrics::Histogram* dynamic_threads;
+  metrics::Gauge<int64_t>* idle_dynamic_threads;
+};
+
+inline const BlockingWorkQueueMetrics& GetBlockingWorkQueueMetrics() {
+  static const BlockingWorkQueueMetrics* blocking_metrics = [] {
+    // Powers of two up to the capacity of a queue.
+    std::vector<double> counts = {0};
+    for (double count = 1; count <= TaskQueue::kCapacity; count *= 2)
+      counts.push_back(count);
+    const std::string prefix = "/tfrt/host_context/blocking_work_queue/";
+    return new BlockingWorkQueueMetrics{
+        NewWorkQueueMetrics(prefix, TaskQueue::kCapacity),
+        metrics::NewHistogram(prefix + "dynamic_threads",
+                              metrics::Buckets::Explicit(counts)),
+        metrics::NewGauge<int64_t>(prefix + "idle_dynamic_threads")};
+  }();
+  return *blocking_metrics;
+}
+
 template <typename ThreadingEnvironmentTy>
 struct WorkQueueTraits<BlockingWorkQueue<ThreadingEnvironmentTy>> {
   using ThreadingEnvironment = ThreadingEnvironmentTy;
@@ -50,11 +97,15 @@ class BlockingWorkQueue
   explicit BlockingWorkQueue(
       QuiescingState* quiescing_state, int num_threads,
       int max_num_dynamic_threads = std::numeric_limits<int>::max(),
-      std::chrono::nanoseconds idle_wait_time = std::chrono::seconds(1));
+      std::chrono::nanoseconds idle_wait_time = std::chrono::seconds(1),
+      int max_num_overflow_threads = 0,
+      WorkerThreadOptions thread_options = {});
   ~BlockingWorkQueue() { Quiesce(); }
 
-  // Enqueues `task` for execution by one of the statically allocated thread.
-  // Return task wrapped in optional if all per-thread queues are full.
+  // Enqueues `task` for execution by one of the statically allocated thread,
+  // or by a dynamic thread if all static threads are busy and fewer than
+  // `max_num_overflow_threads` queued tasks run in dynamic threads. Return task
+  // wrapped in optional if all per-thread queues are full.
   Optional<TaskFunction> EnqueueBlockingTask(TaskFunction task);
 
   // Runs `task` in one of the dynamically started threads. Returns task
@@ -70,15 +121,23 @@ class BlockingWorkQueue
   template <typename WorkQueue>
   friend class WorkQueueBase;
 
+  using Base::AddPendingTasks;
+  using Base::CompletePendingTask;
   using Base::GetPerThread;
   using Base::IsNotifyParkedThreadRequired;
   using Base::IsQuiescing;
+  using Base::NumBlockedThreads;
+  using Base::RunTask;
   using Base::WithPendingTaskCounter;
+  using Base::WithTaskMetrics;
 
   using Base::coprimes_;
   using Base::event_count_;
   using Base::num_threads_;
   using Base::thread_data_;
+  using Base::thread_options_;
+
+  using Base::kMetricsSamplingPeriod;
 
   LLVM_NODISCARD Optional<TaskFunction> NextTask(Queue* queue);
   LLVM_NODISCARD Optional<TaskFunction> Steal(Queue* queue);
@@ -89,13 +148,26 @@ class BlockingWorkQueue
   // relationship, and can guarantee that tasks with inter-dependencies
   // will all make progress together.
 
+  // Returns true if a task can run in a dynamic thread, either an idle one or
+  // a new one.
+  bool HasDynamicThreadCapacity() const TFRT_REQUIRES(mutex_);
+
+  // Runs `task` in an idle dynamic thread, or starts a new one. Requires
+  // HasDynamicThreadCapacity().
+  void StartDynamicTask(TaskFunction task) TFRT_REQUIRES(mutex_);
+
   // Waits for the next available task. Returns empty optional if the task was
   // not found.
   Optional<TaskFunction> WaitNextTask(mutex_lock* lock) TFRT_REQUIRES(mutex_);
 
+  const BlockingWorkQueueMetrics& metrics_;
+
   // Maximum number of dynamically started threads.
   const int max_num_dynamic_threads_;
 
+  // Maximum number of tasks that allow queuing running in dynamic threads.
+  const int max_num_overflow_threads_;
+
   // For how long dynamically started thread waits for the next task before
   // stopping.
   const std::chrono::nanoseconds idle_wait_time_;
@@ -111,6 +183,9 @@ class BlockingWorkQueue
   // Number of dynamic threads waiting for the next task.
   int num_idle_dynamic_threads_ TFRT_GUARDED_BY(mutex_) = 0;
 
+  // Number of tasks that allow queuing running in dynamic threads.
+  int num_overflow_tasks_ TFRT_GUARDED_BY(mutex_) = 0;
+
   // This queue is a temporary storage to transfer task ownership to one of the
   // idle threads. It does not keep more tasks than there are idle threads.
   std::queue<TaskFunction> idle_task_queue_ TFRT_GUARDED_BY(mutex_);
@@ -119,8 +194,8 @@ class BlockingWorkQueue
   using DynamicThread = std::pair<std::unique_ptr<Thread>, bool>;
 
   // Container for dynamically started threads. Some of the threads might be
-  // already terminated. Terminated threads lazily removed from the
-  // `dynamic_threads_` on each call to `RunBlockingTask`.
+  // already terminated. Terminated threads are lazily removed from the
+  // `dynamic_threads_` when a dynamic thread starts or exits.
   std::list<DynamicThread> dynamic_threads_ TFRT_GUARDED_BY(mutex_);
 
   // Idle threads must stop waiting for the next task in the `idle_task_queue_`.
@@ -130,29 +205,58 @@ class BlockingWorkQueue
 template <typename ThreadingEnvironment>
 BlockingWorkQueue<ThreadingEnvironment>::BlockingWorkQueue(
     QuiescingState* quiescing_state, int num_threads,
-    int max_num_dynamic_threads, std::chrono::nanoseconds idle_wait_time)
-    : WorkQueueBase<BlockingWorkQueue>(quiescing_state, kThreadNamePrefix,
-                                       num_threads),
+    int max_num_dynamic_threads, std::chrono::nanoseconds idle_wait_time,
+    int max_num_overflow_threads, WorkerThreadOptions thread_options)
+    : WorkQueueBase<BlockingWorkQueue>(
+          quiescing_state, kThreadNamePrefix, num_threads,
+          GetBlockingWorkQueueMetrics().work_queue, std::move(thread_options)),
+      metrics_(GetBlockingWorkQueueMetrics()),
       max_num_dynamic_threads_(max_num_dynamic_threads),
+      max_num_overflow_threads_(max_num_overflow_threads),
       idle_wait_time_(idle_wait_time) {}
 
 template <typename ThreadingEnvironment>
 Optional<TaskFunction>
 BlockingWorkQueue<ThreadingEnvironment>::EnqueueBlockingTask(
     TaskFunction task) {
-  // In quiescing mode we count the number of pending tasks, and are allowed to
-  // execute tasks in the caller thread.
+  // In quiescing mode we are allowed to execute tasks in the caller thread.
   const bool is_quiescing = IsQuiescing();
-  if (is_quiescing) task = WithPendingTaskCounter(std::move(task));
+
+  PerThread* pt = GetPerThread();
+  const bool is_sampled = pt->rng() % kMetricsSamplingPeriod == 0;
+  if (is_sampled) task = WithTaskMetrics(std::move(task));
+
+  // Overflow to a dynamic thread if no static thread is waiting for a task.
+  // The counter is decremented when the task completes, before the dynamic
+  // thread waits for the next task.
+  if (max_num_overflow_threads_ > 0 && NumBlockedThreads() == 0) {
+    mutex_lock lock(mutex_);
+    if (num_overflow_tasks_ < max_num_overflow_threads_ &&
+        HasDynamicThreadCapacity()) {
+      ++num_overflow_tasks_;
+      StartDynamicTask(WithPendingTaskCounter(
+          TaskFunction([this, task = std::move(task)]() mutable {
+            task();
+            task.reset();
+            mutex_lock lock(mutex_);
+            --num_overflow_tasks_;
+          })));
+      return llvm::None;
+    }
+  }
+
+  // Keep track of the number of pending tasks in the worker queues.
+  AddPendingTasks(1);
 
   // If the worker queue is full, we will return `task` to the caller.
   llvm::Optional<TaskFunction> inline_task = {std::move(task)};
 
-  PerThread* pt = GetPerThread();
   if (pt->parent == this) {
     // Worker thread of this pool, push onto the thread's queue.
     Queue& q = thread_data_[pt->thread_id].queue;
     inline_task = q.PushFront(std::move(*inline_task));
+    if (is_sampled && !inline_task.hasValue())
+      metrics_.work_queue.queue_depth->Record(q.Size());
   } else {
     // A random free-standing thread (or worker of another pool).
     unsigned r = pt->rng();
@@ -160,8 +264,10 @@ BlockingWorkQueue<ThreadingEnvironment>::EnqueueBlockingTask(
     unsigned inc = coprimes_[FastReduce(r, coprimes_.size())];
 
     for (unsigned i = 0; i < num_threads_ && inline_task.hasValue(); i++) {
-      inline_task =
-          thread_data_[victim].queue.PushFront(std::move(*inline_task));
+      Queue& q = thread_data_[victim].queue;
+      inline_task = q.PushFront(std::move(*inline_task));
+      if (is_sampled && !inline_task.hasValue())
+        metrics_.work_queue.queue_depth->Record(q.Size());
       if ((victim += inc) >= num_threads_) victim -= num_threads_;
     }
   }
@@ -173,9 +279,10 @@ BlockingWorkQueue<ThreadingEnvironment>::EnqueueBlockingTask(
     // and even if we are running inside a non-blocking work queue, a single
     // potential context switch won't negatively impact system performance.
     if (is_quiescing) {
-      (*inline_task)();
+      RunTask(&*inline_task);
       return llvm::None;
     } else {
+      CompletePendingTask();
       return inline_task;
     }
   }
@@ -198,22 +305,37 @@ Optional<TaskFunction> BlockingWorkQueue<ThreadingEnvironment>::RunBlockingTask(
     TaskFunction task) {
   mutex_lock lock(mutex_);
 
+  // There are no idle threads and we are at the thread limit. Return task
+  // to the caller.
+  if (!HasDynamicThreadCapacity()) return {std::move(task)};
+
   // Attach a PendingTask counter only if we were able to submit the task
-  // to one of the worker threads. It's unsafe to return the task with
+  // to one of the dynamic threads. It's unsafe to return the task with
   // a counter to the caller, because we don't know when/if it will be
   // destructed and the counter decremented.
-  auto wrap = [&](TaskFunction task) -> TaskFunction {
-    return IsQuiescing() ? WithPendingTaskCounter(std::move(task))
-                         : std::move(task);
-  };
+  task = WithPendingTaskCounter(std::move(task));
+  StartDynamicTask(WithTaskMetrics(std::move(task)));
+
+  return llvm::None;
+}
+
+template <typename ThreadingEnvironment>
+bool BlockingWorkQueue<ThreadingEnvironment>::HasDynamicThreadCapacity() const {
+  return idle_task_queue_.size() < num_idle_dynamic_threads_ ||
+         num_dynamic_threads_ < max_num_dynamic_threads_;
+}
+
+template <typename ThreadingEnvironment>
+void BlockingWorkQueue<ThreadingEnvironment>::StartDynamicTask(
+    TaskFunction task) {
+  assert(HasDynamicThreadCapacity());
 
   // There are idle threads. We enqueue the task to the queue and then notify
   // one of the idle threads.
   if (idle_task_queue_.size() < num_idle_dynamic_threads_) {
-    idle_task_queue_.emplace(wrap(std::move(task)));
+    idle_task_queue_.emplace(std::move(task));
     wake_do_work_cv_.notify_one();
-
-    return llvm::None;
+    return;
   }
 
   // Cleanup dynamic threads that are already terminated.
@@ -222,66 +344,72 @@ Optional<TaskFunction> BlockingWorkQueue<ThreadingEnvironment>::RunBlockingTask(
 
   // There are no idle threads and we are not at the thread limit. We
   // start a new thread to run the task.
-  if (num_dynamic_threads_ < max_num_dynamic_threads_) {
-    // Prepare an entry to hold a new dynamic thread.
-    //
-    // NOTE: We rely on std::list pointer stability for passing a reference to
-    // the container element to the `do_work` lambda.
-    dynamic_threads_.emplace_back();
-    DynamicThread& dynamic_thread = dynamic_threads_.back();
-
-    auto do_work = [this, &dynamic_thread,
-                    task = wrap(std::move(task))]() mutable {
-      task();
-      // Reset executed task to call destructor without holding the lock,
-      // because it might be expensive. Also we want to call it before
-      // notifying quiescing thread, because destructor potentially could
-      // drop the last references on captured async values.
+  //
+  // Prepare an entry to hold a new dynamic thread.
+  //
+  // NOTE: We rely on std::list pointer stability for passing a reference to
+  // the container element to the `do_work` lambda.
+  dynamic_threads_.emplace_back();
+  DynamicThread& dynamic_thread = dynamic_threads_.back();
+
+  auto do_work = [this, &dynamic_thread, task = std::move(task)]() mutable {
+    // Dynamic threads are placed on the same CPUs as the static threads.
+    ThreadingEnvironment::SetCurrentThreadAffinity(thread_options_.cpus);
+    task();
+    // Reset executed task to call destructor without holding the lock,
+    // because it might be expensive. Also we want to call it before
+    // notifying quiescing thread, because destructor potentially could
+    // drop the last references on captured async values.
+    task.reset();
+
+    mutex_lock lock(mutex_);
+
+    // Try to get the next task. If one is found, run it. If there is no
+    // task to execute, GetNextTask will return None that converts to
+    // false.
+    while (llvm::Optional<TaskFunction> task = WaitNextTask(&lock)) {
+      mutex_.unlock();
+      // Do not hold the lock while executing and destructing the task.
+      (*task)();
       task.reset();
+      mutex_.lock();
+    }
 
-      mutex_lock lock(mutex_);
-
-      // Try to get the next task. If one is found, run it. If there is no
-      // task to execute, GetNextTask will return None that converts to
-      // false.
-      while (llvm::Optional<TaskFunction> task = WaitNextTask(&lock)) {
-        mutex_.unlock();
-        // Do not hold the lock while executing and destructing the task.
-        (*task)();
-        task.reset();
-        mutex_.lock();
-      }
-
-      // No more work to do or shutdown occurred. Exit the thread.
-      dynamic_thread.second = false;
-      --num_dynamic_threads_;
-      if (stop_waiting_) thread_exited_cv_.notify_one();
-    };
-
-    // Start a new dynamic thread.
-    dynamic_thread.second = true;  // is active
-    dynamic_thread.first = ThreadingEnvironment::StartThread(
-        kDynamicThreadNamePrefix, std::move(do_work));
-    ++num_dynamic_threads_;
-
-    return llvm::None;
-  }
+    // No more work to do or shutdown occurred. Exit the thread.
+    dynamic_thread.second = false;
+    --num_dynamic_threads_;
+    metrics_.dynamic_threads->Record(num_dynamic_threads_);
+    if (stop_waiting_) thread_exited_cv_.notify_one();
+
+    // Join the threads that exited before this one, so that idle threads do
+    // not linger after a burst of tasks. The other threads released the lock
+    // when they marked themselves terminated, and join promptly.
+    dynamic_threads_.remove_if([&](DynamicThread& thread) -> bool {
+      return thread.second == false && &thread != &dynamic_thread;
+    });
+  };
 
-  // There are no idle threads and we are at the thread limit. Return task
-  // to the caller.
-  return {std::move(task)};
+  // Start a new dynamic thread.
+  dynamic_thread.second = true;  // is active
+  dynamic_thread.first = ThreadingEnvironment::StartThread(
+      thread_options_.name_prefix.empty()
+          ? string_view(kDynamicThreadNamePrefix)
+          : string_view(thread_options_.name_prefix),
+      std::move(do_work));
+  ++num_dynamic_threads_;
+  metrics_.dynamic_threads->Record(num_dynamic_threads_);
 }
 
 template <typename ThreadingEnvironment>
 Optional<TaskFunction> BlockingWorkQueue<ThreadingEnvironment>::WaitNextTask(
     mutex_lock* lock) {
-  ++num_idle_dynamic_threads_;
+  metrics_.idle_dynamic_threads->Set(++num_idle_dynamic_threads_);
 
   const auto timeout = std::chrono::system_clock::now() + idle_wait_time_;
   wake_do_work_cv_.wait_until(*lock, timeout, [this]() TFRT_REQUIRES(mutex_) {
     return !idle_task_queue_.empty() || stop_waiting_;
   });
-  --num_idle_dynamic_threads_;
+  metrics_.idle_dynamic_threads->Set(--num_idle_dynamic_threads_);
 
   // Found something in the queue. Return the task.
   if (!idle_task_queue_.empty()) {
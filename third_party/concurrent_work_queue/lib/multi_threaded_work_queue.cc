@@ -5,15 +5,21 @@
 // Concurrent Work Queue implementation composed from a blocking and
 // non-blocking work queues.
 
+#include <chrono>
+#include <limits>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include "blocking_work_queue.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
 #include "non_blocking_work_queue.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/task_function.h"
+#include "tfrt/support/error_util.h"
 #include "tfrt/support/latch.h"
 #include "tfrt/support/ref_count.h"
 #include "tfrt/support/string_util.h"
@@ -21,19 +27,68 @@
 
 namespace tfrt {
 
+namespace {
+
+// Map the priority of the request to the priority of its tasks.
+internal::TaskPriority GetTaskPriority(const ExecutionContext& exec_ctx) {
+  RequestOptions::RequestPriority priority = exec_ctx.priority();
+  if (priority >= RequestOptions::kCriticalPriority)
+    return internal::TaskPriority::kCritical;
+  if (priority >= RequestOptions::kHighPriority)
+    return internal::TaskPriority::kHigh;
+  if (priority >= RequestOptions::kDefaultPriority)
+    return internal::TaskPriority::kDefault;
+  return internal::TaskPriority::kLow;
+}
+
+// Returns true if the request has a deadline within `slack` from now.
+bool IsDeadlineUrgent(const ExecutionContext& exec_ctx,
+                      std::chrono::nanoseconds slack) {
+  auto deadline = exec_ctx.deadline();
+  if (deadline == std::chrono::system_clock::time_point::max()) return false;
+  return deadline - std::chrono::system_clock::now() < slack;
+}
+
+// Returns the CPUs of the blocking threads, which are kept off the CPUs of the
+// non-blocking threads unless they are set explicitly.
+std::vector<int> GetBlockingCpus(const MultiThreadedWorkQueueOptions& options) {
+  if (!options.blocking_cpus.empty() || options.cpus.empty())
+    return options.blocking_cpus;
+  std::vector<int> cpus;
+  int num_cpus = std::thread::hardware_concurrency();
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    if (!llvm::is_contained(options.cpus, cpu)) cpus.push_back(cpu);
+  }
+  // If the non-blocking threads use all the CPUs, `cpus` is empty and the
+  // blocking threads are not pinned.
+  return cpus;
+}
+
+}  // namespace
+
 class MultiThreadedWorkQueue : public ConcurrentWorkQueue {
  public:
-  MultiThreadedWorkQueue(int num_threads, int num_blocking_threads);
+  explicit MultiThreadedWorkQueue(const MultiThreadedWorkQueueOptions& options);
   ~MultiThreadedWorkQueue() override;
 
   std::string name() const override {
+    if (min_num_blocking_threads_ == num_blocking_threads_) {
+      return StrCat("Multi-threaded C++ work queue (", num_threads_,
+                    " threads, ", num_blocking_threads_, " blocking threads)");
+    }
     return StrCat("Multi-threaded C++ work queue (", num_threads_, " threads, ",
-                  num_blocking_threads_, " blocking threads)");
+                  min_num_blocking_threads_, " to ", num_blocking_threads_,
+                  " blocking threads)");
   }
 
   int GetParallelismLevel() const final { return num_threads_; }
 
+  Error InitRequest(RequestContextBuilder* ctx_builder) final;
+
   void AddTask(TaskFunction task) final;
+  void AddTask(const ExecutionContext& exec_ctx, TaskFunction task) final;
+  void AddTasks(const ExecutionContext& exec_ctx,
+                MutableArrayRef<TaskFunction> tasks) final;
   Optional<TaskFunction> AddBlockingTask(TaskFunction task,
                                          bool allow_queuing) final;
   void Quiesce() final;
@@ -42,21 +97,38 @@ class MultiThreadedWorkQueue : public ConcurrentWorkQueue {
   bool IsInWorkerThread() const final;
 
  private:
+  internal::TaskPriority GetPriority(const ExecutionContext& exec_ctx) const;
+
   const int num_threads_;
   const int num_blocking_threads_;
+  const int min_num_blocking_threads_;
+  const bool deadline_scheduling_;
+  const std::chrono::nanoseconds urgent_deadline_slack_;
 
   std::unique_ptr<internal::QuiescingState> quiescing_state_;
   internal::NonBlockingWorkQueue<ThreadingEnvironment> non_blocking_work_queue_;
   internal::BlockingWorkQueue<ThreadingEnvironment> blocking_work_queue_;
 };
 
-MultiThreadedWorkQueue::MultiThreadedWorkQueue(int num_threads,
-                                               int num_blocking_threads)
-    : num_threads_(num_threads),
-      num_blocking_threads_(num_blocking_threads),
+MultiThreadedWorkQueue::MultiThreadedWorkQueue(
+    const MultiThreadedWorkQueueOptions& options)
+    : num_threads_(options.num_threads),
+      num_blocking_threads_(options.num_blocking_threads),
+      min_num_blocking_threads_(options.min_num_blocking_threads),
+      deadline_scheduling_(options.deadline_scheduling),
+      urgent_deadline_slack_(options.urgent_deadline_slack),
       quiescing_state_(std::make_unique<internal::QuiescingState>()),
-      non_blocking_work_queue_(quiescing_state_.get(), num_threads),
-      blocking_work_queue_(quiescing_state_.get(), num_blocking_threads) {}
+      non_blocking_work_queue_(
+          quiescing_state_.get(), num_threads_,
+          internal::WorkerThreadOptions{options.thread_name, options.cpus}),
+      blocking_work_queue_(
+          quiescing_state_.get(), min_num_blocking_threads_,
+          /*max_num_dynamic_threads=*/std::numeric_limits<int>::max(),
+          options.blocking_idle_timeout,
+          /*max_num_overflow_threads=*/num_blocking_threads_ -
+              min_num_blocking_threads_,
+          internal::WorkerThreadOptions{options.blocking_thread_name,
+                                        GetBlockingCpus(options)}) {}
 
 MultiThreadedWorkQueue::~MultiThreadedWorkQueue() {
   // Pending tasks in the underlying queues might submit new tasks to each other
@@ -64,10 +136,55 @@ MultiThreadedWorkQueue::~MultiThreadedWorkQueue() {
   Quiesce();
 }
 
+Error MultiThreadedWorkQueue::InitRequest(RequestContextBuilder* ctx_builder) {
+  if (!deadline_scheduling_) return Error::success();
+  auto deadline = ctx_builder->request_options().deadline;
+  if (deadline == std::chrono::system_clock::time_point::max())
+    return Error::success();
+  // A request that would reach its deadline while its first task waits in the
+  // queue is rejected, instead of taking capacity from the requests that can
+  // still complete in time.
+  auto queue_latency = non_blocking_work_queue_.QueueLatency();
+  if (std::chrono::system_clock::now() + queue_latency >= deadline) {
+    return llvm::make_error<DeadlineExceededErrorInfo>(StrCat(
+        "Request ", ctx_builder->id(),
+        " cannot meet its deadline with the current queueing delay of ",
+        std::chrono::duration_cast<std::chrono::microseconds>(queue_latency)
+            .count(),
+        "us"));
+  }
+  return Error::success();
+}
+
+// With deadline scheduling, the tasks of requests close to their deadline are
+// promoted to high priority, so that they do not wait behind bulk traffic.
+// The per-worker queues only order tasks by a few priority levels, so this
+// approximates earliest-deadline-first scheduling without a global ordered
+// queue.
+internal::TaskPriority MultiThreadedWorkQueue::GetPriority(
+    const ExecutionContext& exec_ctx) const {
+  internal::TaskPriority priority = GetTaskPriority(exec_ctx);
+  // TaskPriority values are smaller for more urgent tasks.
+  if (deadline_scheduling_ && priority > internal::TaskPriority::kHigh &&
+      IsDeadlineUrgent(exec_ctx, urgent_deadline_slack_))
+    return internal::TaskPriority::kHigh;
+  return priority;
+}
+
 void MultiThreadedWorkQueue::AddTask(TaskFunction task) {
   non_blocking_work_queue_.AddTask(std::move(task));
 }
 
+void MultiThreadedWorkQueue::AddTask(const ExecutionContext& exec_ctx,
+                                     TaskFunction task) {
+  non_blocking_work_queue_.AddTask(std::move(task), GetPriority(exec_ctx));
+}
+
+void MultiThreadedWorkQueue::AddTasks(const ExecutionContext& exec_ctx,
+                                      MutableArrayRef<TaskFunction> tasks) {
+  non_blocking_work_queue_.AddTasks(tasks, GetPriority(exec_ctx));
+}
+
 Optional<TaskFunction> MultiThreadedWorkQueue::AddBlockingTask(
     TaskFunction task, bool allow_queuing) {
   if (allow_queuing) {
@@ -78,23 +195,14 @@ Optional<TaskFunction> MultiThreadedWorkQueue::AddBlockingTask(
 }
 
 void MultiThreadedWorkQueue::Quiesce() {
-  // Turn on pending tasks counter inside both work queues.
-  auto quiescing = internal::Quiescing::Start(quiescing_state_.get());
-
-  // We call NonBlockingWorkQueue::Quiesce() first because we prefer to keep
-  // caller thread busy with compute intensive tasks.
-  non_blocking_work_queue_.Quiesce();
+  // Waiting for the tasks of the worker threads would deadlock.
+  non_blocking_work_queue_.CheckCallerThread("MultiThreadedWorkQueue::Quiesce");
 
-  // Wait for completion of all blocking tasks.
-  blocking_work_queue_.Quiesce();
-
-  // At this point we might still have tasks in the work queues, but because we
-  // enabled quiescing mode earlier, we can rely on empty check as a loop
-  // condition.
-  while (quiescing.HasPendingTasks()) {
-    non_blocking_work_queue_.Quiesce();
-    blocking_work_queue_.Quiesce();
-  }
+  // Both work queues count the tasks that are not completed, and the task that
+  // completes last wakes up this thread, so there is no need to poll the
+  // queues or to wait until the worker threads park.
+  auto quiescing = internal::Quiescing::Start(quiescing_state_.get());
+  quiescing.Wait();
 }
 
 void MultiThreadedWorkQueue::Await(ArrayRef<RCReference<AsyncValue>> values) {
@@ -121,8 +229,31 @@ bool MultiThreadedWorkQueue::IsInWorkerThread() const {
 std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
     int num_threads, int num_blocking_threads) {
   assert(num_threads > 0 && num_blocking_threads > 0);
-  return std::make_unique<MultiThreadedWorkQueue>(num_threads,
-                                                  num_blocking_threads);
+  return CreateMultiThreadedWorkQueue(num_threads, num_blocking_threads,
+                                      num_blocking_threads);
+}
+
+std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
+    int num_threads, int num_blocking_threads, int min_num_blocking_threads,
+    std::chrono::nanoseconds blocking_idle_timeout) {
+  assert(num_threads > 0 && min_num_blocking_threads > 0 &&
+         min_num_blocking_threads <= num_blocking_threads);
+  MultiThreadedWorkQueueOptions options;
+  options.num_threads = num_threads;
+  options.num_blocking_threads = num_blocking_threads;
+  options.min_num_blocking_threads = min_num_blocking_threads;
+  options.blocking_idle_timeout = blocking_idle_timeout;
+  return CreateMultiThreadedWorkQueue(options);
+}
+
+std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
+    const MultiThreadedWorkQueueOptions& options) {
+  MultiThreadedWorkQueueOptions resolved = options;
+  if (resolved.min_num_blocking_threads == 0)
+    resolved.min_num_blocking_threads = resolved.num_blocking_threads;
+  assert(resolved.num_threads > 0 && resolved.min_num_blocking_threads > 0 &&
+         resolved.min_num_blocking_threads <= resolved.num_blocking_threads);
+  return std::make_unique<MultiThreadedWorkQueue>(resolved);
 }
 
 }  // namespace tfrt
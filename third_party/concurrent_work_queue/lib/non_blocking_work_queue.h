@@ -10,11 +10,29 @@
 // Work queue implementation based on non-blocking concurrency primitives
 // optimized for CPU intensive non-blocking compute tasks.
 //
-// This work queue uses TaskDeque for storing pending tasks. Thread tries to
-// pop a task from the front of its own queue, and in a steal loop it tries to
-// steal a task from the back of another thread pending tasks queue. This gives
-// mostly LIFO task execution order, which is optimal for cache locality for
-// compute intensive tasks.
+// This work queue uses TaskPriorityDeque for storing pending tasks. Thread
+// tries to pop a task from the front of its own queue, and in a steal loop it
+// tries to steal a task from the back of another thread pending tasks queue.
+// This gives mostly LIFO task execution order, which is optimal for cache
+// locality for compute intensive tasks.
+//
+// Both popping and stealing take the tasks with the highest priority first. To
+// prevent the starvation of low priority tasks, every `kLowPriorityPeriod`-th
+// task of a worker thread is taken from the lowest priority first.
+//
+// In addition to the deque, each worker thread has a LIFO slot that holds the
+// last task it added. The worker runs this task next, while the data produced
+// by the task that added it is still hot in cache. The LIFO slot is private
+// to the worker thread: tasks in the slot can't be stolen, and memory
+// accesses to it are not synchronized. When a worker adds another task while
+// the slot is occupied, the previous task moves to the front of the deque,
+// where other threads can steal it. The slot keeps the more urgent of the two
+// tasks, and low priority tasks bypass the slot.
+//
+// The work queue records the WorkQueueMetrics prefixed with
+// /tfrt/host_context/work_queue/, the task metrics for one in
+// `kMetricsSamplingPeriod` added tasks. The queue_depth of a task kept in the
+// LIFO slot is the size of the deque.
 //
 // Work stealing algorithm is based on:
 //
@@ -24,8 +42,10 @@
 #ifndef TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_NON_BLOCKING_WORK_QUEUE_H_
 #define TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_NON_BLOCKING_WORK_QUEUE_H_
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Compiler.h"
-#include "task_deque.h"
+#include "task_priority_deque.h"
 #include "tfrt/host_context/task_function.h"
 #include "work_queue_base.h"
 
@@ -35,11 +55,34 @@ namespace internal {
 template <typename ThreadingEnvironment>
 class NonBlockingWorkQueue;
 
+// Pending tasks of a NonBlockingWorkQueue worker thread.
+struct NonBlockingTaskQueue {
+  // Flush() is called by the work queue destructor when the worker threads
+  // might still run, so it only empties the deque. The task in the LIFO slot
+  // is destroyed with the queue.
+  void Flush() { deque.Flush(); }
+
+  // Accessed only by the owner thread.
+  Optional<TaskFunction> lifo_slot;
+  TaskPriority lifo_slot_priority = TaskPriority::kDefault;
+  unsigned num_next_tasks = 0;
+
+  TaskPriorityDeque deque;
+};
+
+// The metrics shared by all non-blocking work queues.
+inline const WorkQueueMetrics& GetNonBlockingWorkQueueMetrics() {
+  static const WorkQueueMetrics* non_blocking_metrics =
+      new WorkQueueMetrics(NewWorkQueueMetrics(
+          "/tfrt/host_context/work_queue/", TaskPriorityDeque::kCapacity));
+  return *non_blocking_metrics;
+}
+
 template <typename ThreadingEnvironmentTy>
 struct WorkQueueTraits<NonBlockingWorkQueue<ThreadingEnvironmentTy>> {
   using ThreadingEnvironment = ThreadingEnvironmentTy;
   using Thread = typename ThreadingEnvironment::Thread;
-  using Queue = ::tfrt::internal::TaskDeque;
+  using Queue = ::tfrt::internal::NonBlockingTaskQueue;
 };
 
 template <typename ThreadingEnvironment>
@@ -54,29 +97,45 @@ class NonBlockingWorkQueue
 
  public:
   explicit NonBlockingWorkQueue(QuiescingState* quiescing_state,
-                                int num_threads);
+                                int num_threads,
+                                WorkerThreadOptions thread_options = {});
   ~NonBlockingWorkQueue() = default;
 
-  void AddTask(TaskFunction task);
+  void AddTask(TaskFunction task,
+               TaskPriority priority = TaskPriority::kDefault);
+
+  // Add `tasks` that can run in parallel, e.g. the fan-out of an executor, and
+  // wake up enough parked threads to run them all at once. The tasks are moved
+  // out of `tasks`. A worker thread pushes the tasks to the front of its own
+  // queue, bypassing its LIFO slot, so that they can be stolen.
+  void AddTasks(MutableArrayRef<TaskFunction> tasks,
+                TaskPriority priority = TaskPriority::kDefault);
 
   using Base::Steal;
 
  private:
   static constexpr char const* kThreadNamePrefix = "tfrt-non-blocking-queue";
 
+  // Period of the worker thread tasks taken from the lowest priority first.
+  static constexpr unsigned kLowPriorityPeriod = 16;
+
   template <typename WorkQueue>
   friend class WorkQueueBase;
 
+  using Base::AddPendingTasks;
   using Base::GetPerThread;
   using Base::IsNotifyParkedThreadRequired;
-  using Base::IsQuiescing;
-  using Base::WithPendingTaskCounter;
+  using Base::RunTask;
+  using Base::WithTaskMetrics;
 
   using Base::coprimes_;
   using Base::event_count_;
+  using Base::metrics_;
   using Base::num_threads_;
   using Base::thread_data_;
 
+  using Base::kMetricsSamplingPeriod;
+
   LLVM_NODISCARD Optional<TaskFunction> NextTask(Queue* queue);
   LLVM_NODISCARD Optional<TaskFunction> Steal(Queue* queue);
   LLVM_NODISCARD bool Empty(Queue* queue);
@@ -84,14 +143,18 @@ class NonBlockingWorkQueue
 
 template <typename ThreadingEnvironment>
 NonBlockingWorkQueue<ThreadingEnvironment>::NonBlockingWorkQueue(
-    QuiescingState* quiescing_state, int num_threads)
+    QuiescingState* quiescing_state, int num_threads,
+    WorkerThreadOptions thread_options)
     : WorkQueueBase<NonBlockingWorkQueue>(quiescing_state, kThreadNamePrefix,
-                                          num_threads) {}
+                                          num_threads,
+                                          GetNonBlockingWorkQueueMetrics(),
+                                          std::move(thread_options)) {}
 
 template <typename ThreadingEnvironment>
-void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(TaskFunction task) {
+void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(
+    TaskFunction task, TaskPriority priority) {
   // Keep track of the number of pending tasks.
-  if (IsQuiescing()) task = WithPendingTaskCounter(std::move(task));
+  AddPendingTasks(1);
 
   // If the worker queue is full, we will execute `task` in the current thread.
   llvm::Optional<TaskFunction> inline_task;
@@ -114,16 +177,41 @@ void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(TaskFunction task) {
   bool skip_notify = false;
 
   PerThread* pt = GetPerThread();
+  const bool is_sampled = pt->rng() % kMetricsSamplingPeriod == 0;
+  if (is_sampled) task = WithTaskMetrics(std::move(task));
+
   if (pt->parent == this) {
     // Worker thread of this pool, push onto the thread's queue.
+    // The new task goes into the LIFO slot, and the task it replaces goes to
+    // the front of the deque. The task in the slot does not need a notification
+    // because other threads can't steal it.
     Queue& q = thread_data_[pt->thread_id].queue;
-    skip_notify = q.Empty();
-    inline_task = q.PushFront(std::move(task));
+    // TaskPriority values are smaller for more urgent tasks.
+    if (priority == TaskPriority::kLow ||
+        (q.lifo_slot.hasValue() && priority > q.lifo_slot_priority)) {
+      skip_notify = q.deque.Empty();
+      inline_task = q.deque.PushFront(std::move(task), priority);
+    } else if (!q.lifo_slot.hasValue()) {
+      q.lifo_slot = std::move(task);
+      q.lifo_slot_priority = priority;
+      if (is_sampled) metrics_.queue_depth->Record(q.deque.Size());
+      return;
+    } else {
+      skip_notify = q.deque.Empty();
+      inline_task =
+          q.deque.PushFront(std::move(*q.lifo_slot), q.lifo_slot_priority);
+      q.lifo_slot = std::move(task);
+      q.lifo_slot_priority = priority;
+    }
+    if (is_sampled && !inline_task.hasValue())
+      metrics_.queue_depth->Record(q.deque.Size());
   } else {
     // A free-standing thread (or worker of another pool).
     unsigned rnd = FastReduce(pt->rng(), num_threads_);
     Queue& q = thread_data_[rnd].queue;
-    inline_task = q.PushBack(std::move(task));
+    inline_task = q.deque.PushBack(std::move(task), priority);
+    if (is_sampled && !inline_task.hasValue())
+      metrics_.queue_depth->Record(q.deque.Size());
   }
   // Note: below we touch `*this` after making `task` available to worker
   // threads. Strictly speaking, this can lead to a racy-use-after-free.
@@ -137,26 +225,88 @@ void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(TaskFunction task) {
     if (!skip_notify && IsNotifyParkedThreadRequired())
       event_count_.Notify(/*notify_all=*/false);
   } else {
-    (*inline_task)();  // Push failed, execute directly.
+    RunTask(&*inline_task);  // Push failed, execute directly.
   }
 }
 
+template <typename ThreadingEnvironment>
+void NonBlockingWorkQueue<ThreadingEnvironment>::AddTasks(
+    MutableArrayRef<TaskFunction> tasks, TaskPriority priority) {
+  // Tasks that did not fit into a full queue are executed in this thread after
+  // the other tasks are made available to the worker threads.
+  llvm::SmallVector<TaskFunction, 4> inline_tasks;
+  int num_queued = 0;
+
+  PerThread* pt = GetPerThread();
+  const bool is_worker = pt->parent == this;
+  unsigned rnd = is_worker ? 0 : FastReduce(pt->rng(), num_threads_);
+  AddPendingTasks(tasks.size());
+  for (TaskFunction& task : tasks) {
+    // A worker thread pushes onto the front of its own queue, a free-standing
+    // thread spreads the tasks over consecutive queues.
+    const bool is_sampled = pt->rng() % kMetricsSamplingPeriod == 0;
+    if (is_sampled) task = WithTaskMetrics(std::move(task));
+    llvm::Optional<TaskFunction> inline_task;
+    TaskPriorityDeque& deque =
+        thread_data_[is_worker ? pt->thread_id : rnd].queue.deque;
+    if (is_worker) {
+      inline_task = deque.PushFront(std::move(task), priority);
+    } else {
+      inline_task = deque.PushBack(std::move(task), priority);
+      if (++rnd == static_cast<unsigned>(num_threads_)) rnd = 0;
+    }
+    if (is_sampled && !inline_task.hasValue())
+      metrics_.queue_depth->Record(deque.Size());
+
+    if (inline_task.hasValue()) {
+      inline_tasks.push_back(std::move(*inline_task));
+    } else {
+      ++num_queued;
+    }
+  }
+
+  // Wake up all parked threads with a single call if there is a task for each
+  // of them, otherwise one parked thread per task. Threads that are spinning
+  // pick up tasks without a notification.
+  if (num_queued >= num_threads_) {
+    event_count_.Notify(/*notify_all=*/true);
+  } else {
+    for (int i = 0; i < num_queued; ++i) {
+      if (IsNotifyParkedThreadRequired())
+        event_count_.Notify(/*notify_all=*/false);
+    }
+  }
+
+  for (TaskFunction& task : inline_tasks) RunTask(&task);
+}
+
 template <typename ThreadingEnvironment>
 LLVM_NODISCARD Optional<TaskFunction>
 NonBlockingWorkQueue<ThreadingEnvironment>::NextTask(Queue* queue) {
-  return queue->PopFront();
+  if (++queue->num_next_tasks % kLowPriorityPeriod == 0) {
+    Optional<TaskFunction> task = queue->deque.PopFrontLowestPriority();
+    if (task.hasValue()) return task;
+  }
+  if (queue->lifo_slot.hasValue()) {
+    Optional<TaskFunction> task = std::move(queue->lifo_slot);
+    queue->lifo_slot.reset();
+    return task;
+  }
+  return queue->deque.PopFront();
 }
 
 template <typename ThreadingEnvironment>
 LLVM_NODISCARD Optional<TaskFunction>
 NonBlockingWorkQueue<ThreadingEnvironment>::Steal(Queue* queue) {
-  return queue->PopBack();
+  return queue->deque.PopBack();
 }
 
+// The LIFO slot is not checked: it is only accessed by the owner thread, and
+// the owner always runs the task in its slot before it looks for other work.
 template <typename ThreadingEnvironment>
 LLVM_NODISCARD bool NonBlockingWorkQueue<ThreadingEnvironment>::Empty(
     Queue* queue) {
-  return queue->Empty();
+  return queue->deque.Empty();
 }
 
 }  // namespace internal
@@ -124,30 +124,14 @@ class TaskPriorityDeque {
   //
   // If all queues are empty returns empty optional.
   LLVM_NODISCARD llvm::Optional<TaskFunction> PopFront() {
-    PointerState front(front_.load(std::memory_order_relaxed));
-
-    for (TaskPriority priority : kTaskPriorities) {
-      uint64_t index = front.IndexExt(priority);
-
-      Elem* e = elem(priority, (index - 1) & kIndexMask);
-      uint8_t s = e->state.load(std::memory_order_relaxed);
-
-      if (s != kReady) continue;
-      if (!e->state.compare_exchange_strong(s, kBusy,
-                                            std::memory_order_acquire)) {
-        return llvm::None;
-      }
-
-      TaskFunction task = std::move(e->task);
-      e->state.store(kEmpty, std::memory_order_release);
-      front_.store(front.WithIndexExt((index - 1) & kIndexMaskExt, priority),
-                   std::memory_order_relaxed);
-
-      return llvm::Optional<TaskFunction>(std::move(task));
-    }
+    return PopFrontInOrder</*lowest_first=*/false>();
+  }
 
-    // No tasks found at any priority level.
-    return llvm::None;
+  // PopFrontLowestPriority() is PopFront() that iterates through all queues in
+  // the reverse priority order. Calling it from time to time prevents the
+  // starvation of low priority tasks.
+  LLVM_NODISCARD llvm::Optional<TaskFunction> PopFrontLowestPriority() {
+    return PopFrontInOrder</*lowest_first=*/true>();
   }
 
   // PushBack() inserts task `w` at the end of the queue for the specified
@@ -229,6 +213,43 @@ class TaskPriorityDeque {
   }
 
  private:
+  // Removes and returns the first element of the first non-empty queue, from
+  // the highest or the lowest priority.
+  template <bool lowest_first>
+  LLVM_NODISCARD llvm::Optional<TaskFunction> PopFrontInOrder() {
+    PointerState front(front_.load(std::memory_order_relaxed));
+    // Remote threads only move `back` towards `front`, so a stale `back` can
+    // only report an empty deque as non-empty. Skipping the empty deques
+    // avoids touching the cache lines of their elements.
+    PointerState back(back_.load(std::memory_order_relaxed));
+
+    for (int i = 0; i < kNumTaskPriorities; ++i) {
+      const TaskPriority priority = static_cast<TaskPriority>(
+          lowest_first ? kNumTaskPriorities - 1 - i : i);
+      uint64_t index = front.IndexExt(priority);
+      if (index == back.IndexExt(priority)) continue;
+
+      Elem* e = elem(priority, (index - 1) & kIndexMask);
+      uint8_t s = e->state.load(std::memory_order_relaxed);
+
+      if (s != kReady) continue;
+      if (!e->state.compare_exchange_strong(s, kBusy,
+                                            std::memory_order_acquire)) {
+        return llvm::None;
+      }
+
+      TaskFunction task = std::move(e->task);
+      e->state.store(kEmpty, std::memory_order_release);
+      front_.store(front.WithIndexExt((index - 1) & kIndexMaskExt, priority),
+                   std::memory_order_relaxed);
+
+      return llvm::Optional<TaskFunction>(std::move(task));
+    }
+
+    // No tasks found at any priority level.
+    return llvm::None;
+  }
+
   // We use log2(kCapacity) + 1 bits to store rolling index of front/back
   // elements for all priority levels.
   //
@@ -21,9 +21,14 @@
 //
 // Before parking on a conditional variable, thread might go into a spin loop
 // (controlled by `kMaxSpinningThreads` constant), and execute steal loop for a
-// fixed number of iterations. This allows to skip expensive park/unpark
-// operations, and reduces latency. Increasing `kMaxSpinningThreads` improves
-// latency at the cost of burned CPU cycles.
+// limited time. This allows to skip expensive park/unpark operations, and
+// reduces latency. Increasing `kMaxSpinningThreads` improves latency at the
+// cost of burned CPU cycles.
+//
+// The spin time adapts to the load seen by each worker thread: a thread that
+// recently waited for a short time before finding a new task spins for about
+// twice that time, and a thread that recently waited for longer than
+// `kMaxSpinTime` parks without spinning.
 //
 // See derived work queue implementation for more details about work stealing.
 //
@@ -40,6 +45,9 @@
 //    std::unique_ptr<Thread> StartThread(string_view name_prefix,
 //         Function&& f, Args&&... args) { ... }
 //
+//    // Pins the calling thread to `cpus`, if `cpus` is not empty.
+//    static void SetCurrentThreadAffinity(ArrayRef<int> cpus) { ... }
+//
 //    // Returns current thread id hash code. Must have characteristics of a
 //    // good hash function and generate uniformly distributed values. Values
 //    // are used as an initial seed for per-thread random number generation.
@@ -49,19 +57,24 @@
 #ifndef TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_WORK_QUEUE_BASE_H_
 #define TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_WORK_QUEUE_BASE_H_
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "event_count.h"
 #include "llvm/Support/Compiler.h"
 #include "task_queue.h"
 #include "tfrt/host_context/task_function.h"
+#include "tfrt/metrics/metrics.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/mutex.h"
 #include "tfrt/support/string_util.h"
+#include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
 namespace internal {
@@ -91,18 +104,52 @@ template <typename Derived>
 struct WorkQueueTraits;
 
 //===----------------------------------------------------------------------===//
-// Quiescing enables pending tasks counter to implement strong work queue
-// emptiness check in the MultiThreadedWorkQueue::Quiesce() implementation.
+// Placement and naming of the threads started by a work queue.
+//===----------------------------------------------------------------------===//
+struct WorkerThreadOptions {
+  // Name of the threads, or empty for the default name of the work queue.
+  std::string name_prefix;
+  // CPUs the threads are pinned to, or empty to not pin the threads.
+  std::vector<int> cpus;
+};
+
+//===----------------------------------------------------------------------===//
+// Quiescing state counts the tasks added to a work queue that are not completed
+// yet, to implement the strong work queue emptiness check in the
+// MultiThreadedWorkQueue::Quiesce() implementation without polling the queues.
 //===----------------------------------------------------------------------===//
 struct QuiescingState {
-  std::atomic<int64_t> num_quiescing;
-  std::atomic<int64_t> num_pending_tasks;
+  void AddPendingTasks(int64_t num_tasks) {
+    num_pending_tasks.fetch_add(num_tasks, std::memory_order_relaxed);
+  }
+
+  // Marks a pending task completed. The task that completes last wakes up the
+  // threads waiting in Quiescing::Wait(). Sequentially consistent operations
+  // guarantee that either this thread sees the waiting thread, or the waiting
+  // thread sees that no task is pending.
+  void CompletePendingTask() {
+    if (num_pending_tasks.fetch_sub(1) != 1 || num_quiescing.load() == 0)
+      return;
+    mutex_lock lock(mu);
+    ++quiescent_epoch;
+    quiescent_cv.notify_all();
+  }
+
+  std::atomic<int64_t> num_quiescing{0};
+  std::atomic<int64_t> num_pending_tasks{0};
+
+  // Incremented each time the number of pending tasks drops to zero while a
+  // thread is quiescing, so that the waiting threads are released even if new
+  // tasks are added before they wake up.
+  mutex mu;
+  condition_variable quiescent_cv;
+  uint64_t quiescent_epoch TFRT_GUARDED_BY(mu) = 0;
 };
 
 //===----------------------------------------------------------------------===//
 // MultithreadedWorkQueue::Quiesce() requires strong guarantees for queue
-// emptyness check. If quiescing mode is enabled (via creating an instance of
-// Quiescing), work queue tracks the number of pending tasks.
+// emptyness check. While an instance of Quiescing exists, the task that
+// completes last notifies the quiescing threads.
 //===----------------------------------------------------------------------===//
 class Quiescing {
  public:
@@ -127,15 +174,25 @@ class Quiescing {
   Quiescing& operator=(const Quiescing&) = delete;
 
   // HasPendingTasks() returns true if some of the tasks added to the owning
-  // queue after `*this` was created are not completed.
+  // queue are not completed.
   bool HasPendingTasks() const {
-    return state_->num_pending_tasks.load(std::memory_order_relaxed) != 0;
+    return state_->num_pending_tasks.load(std::memory_order_acquire) != 0;
+  }
+
+  // Wait() blocks until no task is pending, or until the last pending task
+  // completed after the call, even if new tasks were added since then.
+  void Wait() {
+    mutex_lock lock(state_->mu);
+    const uint64_t epoch = state_->quiescent_epoch;
+    state_->quiescent_cv.wait(lock, [&]() TFRT_REQUIRES(state_->mu) {
+      return !HasPendingTasks() || state_->quiescent_epoch != epoch;
+    });
   }
 
  private:
   explicit Quiescing(QuiescingState* state) : state_(state) {
     assert(state != nullptr);
-    state_->num_quiescing.fetch_add(1, std::memory_order_relaxed);
+    state_->num_quiescing.fetch_add(1);
   }
 
   QuiescingState* state_;
@@ -148,12 +205,12 @@ class PendingTask {
  public:
   explicit PendingTask(QuiescingState* state) : state_(state) {
     assert(state != nullptr);
-    state_->num_pending_tasks.fetch_add(1, std::memory_order_relaxed);
+    state_->AddPendingTasks(1);
   }
 
   ~PendingTask() {
     if (state_ == nullptr) return;  // in moved-out state
-    state_->num_pending_tasks.fetch_sub(1, std::memory_order_relaxed);
+    state_->CompletePendingTask();
   }
 
   PendingTask(PendingTask&& other) : state_(other.state_) {
@@ -173,6 +230,64 @@ class PendingTask {
   QuiescingState* state_;
 };
 
+//===----------------------------------------------------------------------===//
+// Counters of the worker threads of a work queue, to tune the spin loop.
+//===----------------------------------------------------------------------===//
+struct WorkQueueStats {
+  // The number of steal attempts in the spin loop.
+  uint64_t num_spins = 0;
+  // The number of times a worker thread parked, and woke up again.
+  uint64_t num_parks = 0;
+  uint64_t num_unparks = 0;
+  // The number of tasks a worker thread stole from another thread.
+  uint64_t num_steals = 0;
+};
+
+// The metrics shared by all work queues of a kind, e.g. all blocking work
+// queues. Their names are the kind's prefix followed by the member name.
+struct WorkQueueMetrics {
+  // Recorded when a worker thread parks, with the counts since it last parked.
+  metrics::Histogram* spins_per_park;
+  metrics::Histogram* steals_per_park;
+  metrics::Counter* steals;
+  metrics::Counter* parks;
+  // The number of parked worker threads of the queue that last parked or
+  // unparked a thread.
+  metrics::Gauge<int64_t>* parked_threads;
+
+  // Recorded for the sampled tasks (see WithTaskMetrics): the size of the
+  // worker queue that accepted the task, the time from adding the task until
+  // it starts running, and the time it runs.
+  metrics::Histogram* queue_depth;
+  metrics::Histogram* queue_latency_us;
+  metrics::Histogram* run_time_us;
+  // The number of sampled tasks that ran for longer than kLongTaskTime.
+  metrics::Counter* long_tasks;
+};
+
+inline WorkQueueMetrics NewWorkQueueMetrics(const std::string& prefix,
+                                            unsigned queue_capacity) {
+  auto park_buckets =
+      metrics::Buckets::Explicit({0, 1, 10, 100, 1e3, 1e4, 1e5, 1e6});
+  // Powers of two up to the capacity of a queue.
+  std::vector<double> counts = {0};
+  for (double count = 1; count <= queue_capacity; count *= 2)
+    counts.push_back(count);
+  auto count_buckets = metrics::Buckets::Explicit(counts);
+  auto time_buckets =
+      metrics::Buckets::Explicit({1, 10, 100, 1e3, 1e4, 1e5, 1e6, 1e7});
+  return WorkQueueMetrics{
+      metrics::NewHistogram(prefix + "spins_per_park", park_buckets),
+      metrics::NewHistogram(prefix + "steals_per_park", park_buckets),
+      metrics::NewCounter(prefix + "steals"),
+      metrics::NewCounter(prefix + "parks"),
+      metrics::NewGauge<int64_t>(prefix + "parked_threads"),
+      metrics::NewHistogram(prefix + "queue_depth", count_buckets),
+      metrics::NewHistogram(prefix + "queue_latency_us", time_buckets),
+      metrics::NewHistogram(prefix + "run_time_us", time_buckets),
+      metrics::NewCounter(prefix + "long_tasks")};
+}
+
 //===----------------------------------------------------------------------===//
 // Work queue base class (derived by non-blocking and blocking work queues).
 //===----------------------------------------------------------------------===//
@@ -238,6 +353,17 @@ class WorkQueueBase {
     return per_thread->parent == &derived_;
   }
 
+  // Returns the sum of the counters of all worker threads. Can be called by
+  // any thread at any time, the counters of running threads are approximate.
+  WorkQueueStats GetStats() const;
+
+  // Returns the moving average of the time the sampled tasks waited in the
+  // queue before they started running, or zero before any task was sampled.
+  std::chrono::nanoseconds QueueLatency() const {
+    return std::chrono::nanoseconds(
+        queue_latency_ns_.load(std::memory_order_relaxed));
+  }
+
   // Stop all threads managed by this work queue.
   void Cancel();
 
@@ -255,14 +381,33 @@ class WorkQueueBase {
     int thread_id;  // Worker thread index in the workers queue
   };
 
+  // Counters of a worker thread. They are only updated by the worker thread,
+  // so the increments do not need atomic read-modify-write operations.
+  struct WorkerStats {
+    static void Increment(std::atomic<uint64_t>* counter, uint64_t n = 1) {
+      counter->store(counter->load(std::memory_order_relaxed) + n,
+                     std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> num_spins{0};
+    std::atomic<uint64_t> num_parks{0};
+    std::atomic<uint64_t> num_unparks{0};
+    std::atomic<uint64_t> num_steals{0};
+
+    // The counters when the thread last parked.
+    uint64_t num_spins_at_park = 0;
+    uint64_t num_steals_at_park = 0;
+  };
+
   struct ThreadData {
     ThreadData() : thread(), queue() {}
     std::unique_ptr<Thread> thread;
     Queue queue;
+    WorkerStats stats;
   };
 
-  // Returns a TaskFunction with an attached pending tasks counter, if the
-  // quiescing mode is on.
+  // Returns a TaskFunction with an attached pending tasks counter, for the
+  // tasks that do not run from the worker queues.
   TaskFunction WithPendingTaskCounter(TaskFunction task) {
     return TaskFunction(
         [task = std::move(task), p = PendingTask(quiescing_state_)]() mutable {
@@ -270,13 +415,35 @@ class WorkQueueBase {
         });
   }
 
+  // Tasks pushed to the worker queues are counted as pending tasks by the
+  // derived work queue, and marked completed by RunTask() after they run.
+  void AddPendingTasks(int64_t num_tasks) {
+    quiescing_state_->AddPendingTasks(num_tasks);
+  }
+  void CompletePendingTask() { quiescing_state_->CompletePendingTask(); }
+
+  // Runs and destroys `task`, which was counted as a pending task. The task is
+  // destroyed first, because it might hold the last references to the values
+  // the quiescing thread waits for.
+  void RunTask(TaskFunction* task) {
+    (*task)();
+    task->reset();
+    CompletePendingTask();
+  }
+
   // TODO(ezhulenev): Make this a runtime parameter? More spinning threads help
   // to reduce latency at the cost of wasted CPU cycles.
   static constexpr int kMaxSpinningThreads = 1;
 
-  // The number of steal loop spin iterations before parking (this number is
-  // divided by the number of threads, to get spin count for each thread).
-  static constexpr int kSpinCount = 5000;
+  // The time a worker thread spins in the steal loop before parking is twice
+  // the moving average of the time it recently waited for a new task, within
+  // [kMinSpinTime, kMaxSpinTime]. If the average is more than kMaxSpinTime
+  // the thread parks without spinning.
+  static constexpr std::chrono::nanoseconds kMinSpinTime{2000};
+  static constexpr std::chrono::nanoseconds kMaxSpinTime{50000};
+
+  // The spin loop reads the clock once per this number of steal attempts.
+  static constexpr int kSpinCheckPeriod = 16;
 
   // If there are enough active threads with an empty pending task queues, there
   // is no need for spinning before parking a thread that is out of work to do,
@@ -288,10 +455,23 @@ class WorkQueueBase {
   // will be unparked, however this should be very rare in practice.
   static constexpr int kMinActiveThreadsToStartSpinning = 4;
 
+  // Recording the task metrics of every task would slow down short tasks by
+  // more than 2x, so derived work queues only sample one in this many tasks.
+  static constexpr unsigned kMetricsSamplingPeriod = 64;
+
+  // Sampled tasks running for longer than this are counted and traced.
+  static constexpr std::chrono::milliseconds kLongTaskTime{10};
+
   explicit WorkQueueBase(QuiescingState* quiescing_state,
-                         string_view name_prefix, int num_threads);
+                         string_view name_prefix, int num_threads,
+                         const WorkQueueMetrics& metrics,
+                         WorkerThreadOptions thread_options = {});
   ~WorkQueueBase();
 
+  // Wraps a sampled `task` to record the time it waits before running and the
+  // time it runs, and to trace it.
+  TaskFunction WithTaskMetrics(TaskFunction task) const;
+
   // Main worker thread loop.
   void WorkerLoop(int thread_id);
 
@@ -299,8 +479,18 @@ class WorkQueueBase {
   // is time to exit (returns false). Can optionally return a task to execute in
   // `task` (in such case `task.hasValue() == true` on return).
   LLVM_NODISCARD bool WaitForWork(EventCount::Waiter* waiter,
+                                  WorkerStats* stats,
                                   llvm::Optional<TaskFunction>* task);
 
+  // Spin() steals tasks in a loop until it finds one or `spin_time` elapses.
+  LLVM_NODISCARD llvm::Optional<TaskFunction> Spin(
+      std::chrono::nanoseconds spin_time, WorkerStats* stats);
+
+  // GetSpinTime() returns the time a worker thread that recently waited
+  // `idle_time` on average for a new task spins before parking.
+  static std::chrono::nanoseconds GetSpinTime(
+      std::chrono::nanoseconds idle_time);
+
   // StartSpinning() checks if the number of threads in the spin loop is less
   // than the allowed maximum, if so increments the number of spinning threads
   // by one and returns true (caller must enter the spin loop). Otherwise
@@ -340,6 +530,7 @@ class WorkQueueBase {
   unsigned NumActiveThreads() const { return num_threads_ - blocked_.load(); }
 
   const int num_threads_;
+  const WorkerThreadOptions thread_options_;
 
   std::vector<ThreadData> thread_data_;
   std::vector<unsigned> coprimes_;
@@ -397,9 +588,21 @@ class WorkQueueBase {
   };
 
   EventCount event_count_;
+  const WorkQueueMetrics& metrics_;
+  // Updated by the sampled tasks, see QueueLatency().
+  mutable std::atomic<int64_t> queue_latency_ns_{0};
   Derived& derived_;
 };
 
+template <typename Derived>
+constexpr std::chrono::nanoseconds WorkQueueBase<Derived>::kMinSpinTime;
+template <typename Derived>
+constexpr std::chrono::nanoseconds WorkQueueBase<Derived>::kMaxSpinTime;
+template <typename Derived>
+constexpr unsigned WorkQueueBase<Derived>::kMetricsSamplingPeriod;
+template <typename Derived>
+constexpr std::chrono::milliseconds WorkQueueBase<Derived>::kLongTaskTime;
+
 // Calculate coprimes of all numbers [1, n].
 //
 // Coprimes are used for random walks over all threads in Steal
@@ -426,8 +629,11 @@ inline std::vector<unsigned> ComputeCoprimes(int n) {
 
 template <typename Derived>
 WorkQueueBase<Derived>::WorkQueueBase(QuiescingState* quiescing_state,
-                                      string_view name_prefix, int num_threads)
+                                      string_view name_prefix, int num_threads,
+                                      const WorkQueueMetrics& metrics,
+                                      WorkerThreadOptions thread_options)
     : num_threads_(num_threads),
+      thread_options_(std::move(thread_options)),
       thread_data_(num_threads),
       coprimes_(ComputeCoprimes(num_threads)),
       blocked_(0),
@@ -436,11 +642,18 @@ WorkQueueBase<Derived>::WorkQueueBase(QuiescingState* quiescing_state,
       quiescing_state_(quiescing_state),
       spinning_state_(0),
       event_count_(num_threads),
+      metrics_(metrics),
       derived_(static_cast<Derived&>(*this)) {
   assert(num_threads >= 1);
   for (int i = 0; i < num_threads; i++) {
     thread_data_[i].thread = ThreadingEnvironment::StartThread(
-        name_prefix, [this, i]() { WorkerLoop(i); });
+        thread_options_.name_prefix.empty()
+            ? name_prefix
+            : string_view(thread_options_.name_prefix),
+        [this, i]() {
+          ThreadingEnvironment::SetCurrentThreadAffinity(thread_options_.cpus);
+          WorkerLoop(i);
+        });
   }
 }
 
@@ -485,7 +698,7 @@ void WorkQueueBase<Derived>::Quiesce() {
 
   while (task.hasValue()) {
     // Execute stolen task in the caller thread.
-    (*task)();
+    RunTask(&*task);
 
     // Try to steal the next task.
     task = Steal();
@@ -529,25 +742,26 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
   pt->thread_id = thread_id;
 
   Queue* q = &(thread_data_[thread_id].queue);
+  WorkerStats* stats = &(thread_data_[thread_id].stats);
   EventCount::Waiter* waiter = event_count_.waiter(thread_id);
 
-  // TODO(dvyukov,rmlarsen): The time spent in NonEmptyQueueIndex() is
-  // proportional to num_threads_ and we assume that new work is scheduled at
-  // a constant rate, so we set spin_count to 5000 / num_threads_. The
-  // constant was picked based on a fair dice roll, tune it.
-  const int spin_count = num_threads_ > 0 ? kSpinCount / num_threads_ : 0;
+  // Exponential moving average of the time this thread waited for a new task
+  // once it ran out of work. Start with the longest spin time.
+  std::chrono::nanoseconds idle_time = kMaxSpinTime / 2;
 
   while (!cancelled_) {
     Optional<TaskFunction> t = derived_.NextTask(q);
     if (!t.hasValue()) {
       t = Steal();
-      if (!t.hasValue()) {
+      if (t.hasValue()) {
+        WorkerStats::Increment(&stats->num_steals);
+      } else {
+        const auto idle_start = std::chrono::steady_clock::now();
+
         // Maybe leave thread spinning. This reduces latency.
-        const bool start_spinning = StartSpinning();
-        if (start_spinning) {
-          for (int i = 0; i < spin_count && !t.hasValue(); ++i) {
-            t = Steal();
-          }
+        const std::chrono::nanoseconds spin_time = GetSpinTime(idle_time);
+        if (spin_time.count() > 0 && StartSpinning()) {
+          t = Spin(spin_time, stats);
 
           const bool stopped_spinning = StopSpinning();
           // If a task was submitted to the queue without a call to
@@ -557,24 +771,52 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
           // been already stolen by some other thread.
           if (stopped_spinning && !t.hasValue()) {
             t = Steal();
+            if (t.hasValue()) WorkerStats::Increment(&stats->num_steals);
           }
         }
 
         if (!t.hasValue()) {
-          if (!WaitForWork(waiter, &t)) {
+          if (!WaitForWork(waiter, stats, &t)) {
             return;
           }
         }
+
+        idle_time = (7 * idle_time +
+                     (std::chrono::steady_clock::now() - idle_start)) /
+                    8;
       }
     }
     if (t.hasValue()) {
-      (*t)();  // Execute a task.
+      RunTask(&*t);  // Execute a task.
+    }
+  }
+}
+
+template <typename Derived>
+std::chrono::nanoseconds WorkQueueBase<Derived>::GetSpinTime(
+    std::chrono::nanoseconds idle_time) {
+  if (idle_time > kMaxSpinTime) return std::chrono::nanoseconds(0);
+  return std::min(std::max(2 * idle_time, kMinSpinTime), kMaxSpinTime);
+}
+
+template <typename Derived>
+LLVM_NODISCARD llvm::Optional<TaskFunction> WorkQueueBase<Derived>::Spin(
+    std::chrono::nanoseconds spin_time, WorkerStats* stats) {
+  const auto deadline = std::chrono::steady_clock::now() + spin_time;
+  for (uint64_t i = 1;; ++i) {
+    llvm::Optional<TaskFunction> t = Steal();
+    if (t.hasValue() || (i % kSpinCheckPeriod == 0 &&
+                         std::chrono::steady_clock::now() >= deadline)) {
+      WorkerStats::Increment(&stats->num_spins, i);
+      if (t.hasValue()) WorkerStats::Increment(&stats->num_steals);
+      return t;
     }
   }
 }
 
 template <typename Derived>
 bool WorkQueueBase<Derived>::WaitForWork(EventCount::Waiter* waiter,
+                                         WorkerStats* stats,
                                          llvm::Optional<TaskFunction>* task) {
   assert(!task->hasValue());
   // We already did best-effort emptiness check in Steal, so prepare for
@@ -588,6 +830,7 @@ bool WorkQueueBase<Derived>::WaitForWork(EventCount::Waiter* waiter,
       return false;
     } else {
       *task = derived_.Steal(&(thread_data_[victim].queue));
+      if (task->hasValue()) WorkerStats::Increment(&stats->num_steals);
       return true;
     }
   }
@@ -625,11 +868,60 @@ bool WorkQueueBase<Derived>::WaitForWork(EventCount::Waiter* waiter,
     return false;
   }
 
+  // Record the counts since the last park of this thread.
+  const uint64_t num_spins = stats->num_spins.load(std::memory_order_relaxed);
+  const uint64_t num_steals = stats->num_steals.load(std::memory_order_relaxed);
+  metrics_.spins_per_park->Record(num_spins - stats->num_spins_at_park);
+  metrics_.steals_per_park->Record(num_steals - stats->num_steals_at_park);
+  metrics_.steals->IncrementBy(num_steals - stats->num_steals_at_park);
+  metrics_.parks->Increment();
+  metrics_.parked_threads->Set(blocked_.load(std::memory_order_relaxed));
+  stats->num_spins_at_park = num_spins;
+  stats->num_steals_at_park = num_steals;
+
+  WorkerStats::Increment(&stats->num_parks);
   event_count_.CommitWait(waiter);
-  blocked_.fetch_sub(1);
+  WorkerStats::Increment(&stats->num_unparks);
+  metrics_.parked_threads->Set(blocked_.fetch_sub(1) - 1);
   return true;
 }
 
+template <typename Derived>
+TaskFunction WorkQueueBase<Derived>::WithTaskMetrics(TaskFunction task) const {
+  return TaskFunction([this, metrics = &metrics_, task = std::move(task),
+                       add_time = std::chrono::steady_clock::now()]() mutable {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    using std::chrono::nanoseconds;
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto latency = start_time - add_time;
+    metrics->queue_latency_us->Record(
+        duration_cast<microseconds>(latency).count());
+    // Exponential moving average with a weight of 1/8 for the new sample. The
+    // sampled tasks may race to update it, which only loses samples.
+    const int64_t average = queue_latency_ns_.load(std::memory_order_relaxed);
+    queue_latency_ns_.store(
+        average + (duration_cast<nanoseconds>(latency).count() - average) / 8,
+        std::memory_order_relaxed);
+    {
+      static tracing::TracePoint trace_point("WorkQueue::SampledTask");
+      tracing::TracingScope scope(tracing::TracingLevel::Verbose, trace_point);
+      task();
+    }
+    const auto run_time = std::chrono::steady_clock::now() - start_time;
+    metrics->run_time_us->Record(duration_cast<microseconds>(run_time).count());
+    if (run_time >= kLongTaskTime) {
+      metrics->long_tasks->Increment();
+      tracing::RecordTracingEvent(tracing::TracingLevel::Default, [&] {
+        return StrCat("WorkQueue::LongTask#run_time_us=",
+                      duration_cast<microseconds>(run_time).count(),
+                      ",queue_latency_us=",
+                      duration_cast<microseconds>(latency).count(), "#");
+      });
+    }
+  });
+}
+
 template <typename Derived>
 bool WorkQueueBase<Derived>::StartSpinning() {
   if (NumActiveThreads() > kMinActiveThreadsToStartSpinning) return false;
@@ -710,6 +1002,19 @@ int WorkQueueBase<Derived>::NonEmptyQueueIndex() {
   return -1;
 }
 
+template <typename Derived>
+WorkQueueStats WorkQueueBase<Derived>::GetStats() const {
+  WorkQueueStats stats;
+  for (const ThreadData& thread_data : thread_data_) {
+    const WorkerStats& s = thread_data.stats;
+    stats.num_spins += s.num_spins.load(std::memory_order_relaxed);
+    stats.num_parks += s.num_parks.load(std::memory_order_relaxed);
+    stats.num_unparks += s.num_unparks.load(std::memory_order_relaxed);
+    stats.num_steals += s.num_steals.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
 template <typename Derived>
 int WorkQueueBase<Derived>::CurrentThreadId() const {
   const PerThread* pt = GetPerThread();
@@ -0,0 +1,314 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- BEF Dependencies Utility -------------------------------------------===//
+//
+// This file prints the kernels, op handler ops and types that a set of BEF
+// files reference, which is what a binary that runs them needs to register.
+//
+// $ bef_deps --output_format=list foo.bef bar.bef
+// kernel corert.executeop
+// op tf.AddV2
+// type !corert.tensorhandle
+//
+// --output_format=cc prints a source file for selective registration, see
+// tfrt/support/selective_registration.h, and --output_format=deps prints the
+// Bazel targets that register the referenced kernels and ops.
+
+#include <cstdio>
+#include <set>
+#include <string>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "tfrt/bef/bef_encoding.h"
+#include "tfrt/bef/bef_reader.h"
+
+namespace {
+
+using tfrt::BEFAttributeType;
+using tfrt::BEFReader;
+using tfrt::BEFSectionID;
+
+enum class OutputFormat { kList, kCc, kDeps };
+
+llvm::cl::list<std::string> cl_input_filenames(  // NOLINT
+    llvm::cl::Positional, llvm::cl::desc("<input BEF files>"),
+    llvm::cl::OneOrMore);
+
+llvm::cl::opt<OutputFormat> cl_output_format(  // NOLINT
+    "output_format", llvm::cl::desc("What to print"),
+    llvm::cl::init(OutputFormat::kList),
+    llvm::cl::values(
+        clEnumValN(OutputFormat::kList, "list",
+                   "the referenced kernels, ops and types"),
+        clEnumValN(OutputFormat::kCc, "cc",
+                   "a source file for selective registration"),
+        clEnumValN(OutputFormat::kDeps, "deps",
+                   "the Bazel targets that register the kernels and ops")));
+
+// The names referenced by the input BEF files, sorted for a stable output.
+struct BefDeps {
+  std::set<std::string> kernels;
+  std::set<std::string> ops;
+  std::set<std::string> types;
+};
+
+llvm::Error MakeError(llvm::StringRef file, llvm::StringRef message) {
+  return llvm::createStringError(llvm::inconvertibleErrorCode(), "%s: %s",
+                                 file.str().c_str(), message.str().c_str());
+}
+
+// Returns whether `str` looks like the name of an op, e.g. "tf.AddV2".
+bool IsOpName(llvm::StringRef str) {
+  auto dot = str.find('.');
+  if (dot == 0 || dot == llvm::StringRef::npos || dot + 1 == str.size())
+    return false;
+  return llvm::all_of(str, [](char c) {
+    return llvm::isAlnum(c) || c == '_' || c == '.';
+  });
+}
+
+// Reads a section that is a count followed by offsets into the string table,
+// i.e. the Kernels and Types sections, and inserts the strings into `names`.
+bool ReadStringOffsets(llvm::ArrayRef<uint8_t> section,
+                       llvm::ArrayRef<uint8_t> strings,
+                       std::set<std::string>* names) {
+  BEFReader reader(section);
+  size_t count;
+  if (!reader.ReadVbrInt(&count)) return false;
+  while (count--) {
+    size_t offset;
+    if (!reader.ReadVbrInt(&offset) || offset >= strings.size()) return false;
+    llvm::StringRef str(reinterpret_cast<const char*>(&strings[offset]),
+                        strings.size() - offset);
+    names->insert(str.take_until([](char c) { return c == '\0'; }).str());
+  }
+  return true;
+}
+
+// Op names are string attributes of the corert kernels. The AttributeTypes
+// section is the only place that identifies the string attributes, so all of
+// them that look like op names are collected. Extra names are harmless, they
+// only keep an op registered that is not used.
+bool ReadOpNames(llvm::ArrayRef<uint8_t> attribute_types,
+                 llvm::ArrayRef<uint8_t> attributes,
+                 std::set<std::string>* names) {
+  const auto string_type =
+      static_cast<BEFAttributeType>(tfrt::DType::String);
+  BEFReader reader(attribute_types);
+  size_t count;
+  if (!reader.ReadVbrInt(&count)) return false;
+  while (count--) {
+    size_t offset, type;
+    if (!reader.ReadVbrInt(&offset) || !reader.ReadVbrInt(&type)) return false;
+    if (static_cast<BEFAttributeType>(type) != string_type) continue;
+    if (offset + sizeof(tfrt::AttrSizeT) > attributes.size()) return false;
+    llvm::StringRef str = tfrt::DecodeLengthPrefixedString(&attributes[offset]);
+    if (str.end() > reinterpret_cast<const char*>(attributes.end()))
+      return false;
+    if (IsOpName(str)) names->insert(str.str());
+  }
+  return true;
+}
+
+llvm::Error ReadBefDeps(llvm::StringRef file, BefDeps* deps) {
+  auto buffer = llvm::MemoryBuffer::getFile(file, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer) return MakeError(file, buffer.getError().message());
+
+  llvm::ArrayRef<uint8_t> data(
+      reinterpret_cast<const uint8_t*>((*buffer)->getBufferStart()),
+      (*buffer)->getBufferSize());
+  BEFReader reader(data);
+
+  uint8_t header[3];
+  if (!reader.ReadByte(&header[0]) || !reader.ReadByte(&header[1]) ||
+      header[0] != tfrt::kBEFMagic1 || header[1] != tfrt::kBEFMagic2)
+    return MakeError(file, "invalid BEF file header");
+  if (!reader.ReadByte(&header[2]) || (header[2] != tfrt::kBEFVersion0 &&
+                                       header[2] != tfrt::kBEFVersion1))
+    return MakeError(file, "unknown BEF format version");
+
+  constexpr int kNumSections = static_cast<int>(BEFSectionID::kNumSectionIDs);
+  llvm::ArrayRef<uint8_t> sections[kNumSections];
+  while (!reader.Empty()) {
+    uint8_t section_id;
+    llvm::ArrayRef<uint8_t> section_data;
+    if (!reader.ReadSection(&section_id, &section_data))
+      return MakeError(file, "invalid section");
+    if (section_id < kNumSections)
+      sections[section_id] = section_data;
+    reader.SkipPast(section_data);
+  }
+  auto get_section = [&](BEFSectionID id) {
+    return sections[static_cast<int>(id)];
+  };
+
+  auto strings = get_section(BEFSectionID::kStrings);
+  if (!ReadStringOffsets(get_section(BEFSectionID::kKernels), strings,
+                         &deps->kernels))
+    return MakeError(file, "invalid Kernels section");
+  if (!ReadStringOffsets(get_section(BEFSectionID::kTypes), strings,
+                         &deps->types))
+    return MakeError(file, "invalid Types section");
+
+  auto attribute_types = get_section(BEFSectionID::kAttributeTypes);
+  if (attribute_types.empty()) {
+    return MakeError(file,
+                     "missing AttributeTypes section, translate the file "
+                     "without -disable-optional-sections");
+  }
+  if (!ReadOpNames(attribute_types, get_section(BEFSectionID::kAttributes),
+                   &deps->ops))
+    return MakeError(file, "invalid AttributeTypes section");
+
+  return llvm::Error::success();
+}
+
+void PrintList(const BefDeps& deps) {
+  for (const auto& name : deps.kernels) printf("kernel %s\n", name.c_str());
+  for (const auto& name : deps.ops) printf("op %s\n", name.c_str());
+  for (const auto& name : deps.types) printf("type %s\n", name.c_str());
+}
+
+void PrintNameArray(const char* array_name,
+                    const std::set<std::string>& names) {
+  printf("static const char* const %s[] = {\n", array_name);
+  for (const auto& name : names) printf("    \"%s\",\n", name.c_str());
+  printf("};\n");
+}
+
+void PrintCc(const BefDeps& deps) {
+  printf("// Generated by tools:bef_deps, do not edit.\n\n");
+  printf("#include \"tfrt/support/selective_registration.h\"\n\n");
+  // Arrays can't be empty, so no names are passed as {} instead.
+  if (!deps.kernels.empty()) PrintNameArray("kKernelNames", deps.kernels);
+  if (!deps.ops.empty()) PrintNameArray("kOpNames", deps.ops);
+  printf("\nTFRT_STATIC_SELECTIVE_REGISTRATION(%s, %s);\n",
+         deps.kernels.empty() ? "{}" : "kKernelNames",
+         deps.ops.empty() ? "{}" : "kOpNames");
+}
+
+// The targets that register the kernels and ops whose names start with the
+// given prefix. The first matching entry is used, so more specific prefixes
+// come first.
+struct TargetEntry {
+  const char* prefix;
+  const char* target;
+};
+
+constexpr TargetEntry kKernelTargets[] = {
+    {"corert.create_cpu_op_handler",
+     "@tf_runtime//backends/cpu:core_runtime_alwayslink"},
+    {"corert.create_null_op_handler",
+     "@tf_runtime//backends/cpu:core_runtime_alwayslink"},
+    {"corert.create_gpu_op_handler",
+     "@tf_runtime//backends/gpu:gpu_op_handler_alwayslink"},
+    {"corert.", "@tf_runtime//:core_runtime_alwayslink"},
+    {"corert_sync.", "@tf_runtime//:core_runtime_alwayslink"},
+    {"cpurt.corert.",
+     "@tf_runtime//backends/cpu:cpurt_corert_kernels_alwayslink"},
+    {"cpurt.", "@tf_runtime//backends/cpu:cpurt_kernels_alwayslink"},
+    {"coo.", "@tf_runtime//:tensor_alwayslink"},
+    {"eigen.", "@tf_runtime//backends/common:eigen_kernels_alwayslink"},
+    {"tf_sync.", "@tf_runtime//backends/cpu:cpu_kernels_alwayslink"},
+    {"tfrt.", "@tf_runtime//:basic_kernels_alwayslink"},
+    {"tfrt_cuda.", "@tf_runtime//backends/gpu:gpu_kernels_alwayslink"},
+    {"tfrt_data.", "@tf_runtime//:data_alwayslink"},
+    {"tfrt_dht.", "@tf_runtime//:tensor_alwayslink"},
+    {"tfrt_dht_sync.", "@tf_runtime//:tensor_alwayslink"},
+    {"tfrt_dist.", "@tf_runtime//:distributed_kernels_alwayslink"},
+    {"tfrt_gpu.", "@tf_runtime//backends/gpu:gpu_kernels_alwayslink"},
+    {"tfrt_sht.", "@tf_runtime//:tensor_alwayslink"},
+    {"tfrt_sht_sync.", "@tf_runtime//:tensor_alwayslink"},
+    {"tfrt_test.", "@tf_runtime//:test_kernels_alwayslink"},
+    {"tfrt_tutorial.", "@tf_runtime//:test_kernels_alwayslink"},
+    {"ts.", "@tf_runtime//:tensor_alwayslink"},
+    {"ts_sync.", "@tf_runtime//:tensor_alwayslink"},
+    {"vt.", "@tf_runtime//:test_kernels_alwayslink"},
+};
+
+constexpr TargetEntry kCpuOpTargets[] = {
+    {"tf.", "@tf_runtime//backends/cpu:tf_ops_alwayslink"},
+    {"tfrt_test.", "@tf_runtime//backends/cpu:test_ops_alwayslink"},
+};
+
+constexpr TargetEntry kGpuOpTargets[] = {
+    {"tf.", "@tf_runtime//backends/gpu:gpu_tf_ops_alwayslink"},
+    {"tfrt_test.", "@tf_runtime//backends/gpu:gpu_test_ops_alwayslink"},
+};
+
+// Inserts the target of `name` into `targets`. Returns false if no prefix
+// matches.
+template <size_t N>
+bool AddTarget(llvm::StringRef name, const TargetEntry (&entries)[N],
+               std::set<std::string>* targets) {
+  for (const auto& entry : entries) {
+    if (!name.startswith(entry.prefix)) continue;
+    targets->insert(entry.target);
+    return true;
+  }
+  return false;
+}
+
+void PrintDeps(const BefDeps& deps) {
+  std::set<std::string> targets;
+  for (const auto& name : deps.kernels) {
+    if (!AddTarget(name, kKernelTargets, &targets))
+      fprintf(stderr, "bef_deps: no known target for kernel %s\n",
+              name.c_str());
+  }
+  // Ops are only dispatched by the op handlers that the BEF files create.
+  bool has_cpu = deps.kernels.count("corert.create_cpu_op_handler");
+  bool has_gpu = deps.kernels.count("corert.create_gpu_op_handler");
+  for (const auto& name : deps.ops) {
+    if (has_cpu) AddTarget(name, kCpuOpTargets, &targets);
+    if (has_gpu) AddTarget(name, kGpuOpTargets, &targets);
+  }
+  for (const auto& target : targets) printf("\"%s\",\n", target.c_str());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  llvm::cl::ParseCommandLineOptions(argc, argv, "BEF dependencies utility\n");
+
+  BefDeps deps;
+  for (const auto& file : cl_input_filenames) {
+    if (auto error = ReadBefDeps(file, &deps)) {
+      fprintf(stderr, "%s: %s\n", argv[0],
+              llvm::toString(std::move(error)).c_str());
+      return 1;
+    }
+  }
+
+  switch (cl_output_format) {
+    case OutputFormat::kList:
+      PrintList(deps);
+      break;
+    case OutputFormat::kCc:
+      PrintCc(deps);
+      break;
+    case OutputFormat::kDeps:
+      PrintDeps(deps);
+      break;
+  }
+  return 0;
+}
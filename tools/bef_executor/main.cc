@@ -20,7 +20,9 @@
 #include <string>
 
 #include "llvm/Support/CommandLine.h"
+#include "llvm_derived/Support/raw_ostream.h"
 #include "tfrt/bef_executor_driver/bef_executor_driver.h"
+#include "tfrt/cpu/jit/cpurt.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/tracing/tracing.h"
 
@@ -46,7 +48,9 @@ static llvm::cl::opt<std::string> cl_test_init_function(  // NOLINT
 // Enable ConcurrentWorkQueue types to be specified on the command line.
 static llvm::cl::opt<std::string> cl_work_queue_type(  // NOLINT
     "work_queue_type",
-    llvm::cl::desc("Specify concurrent work queue type (s, mstd, ...):"),
+    llvm::cl::desc("Specify concurrent work queue type (s, mstd, ...), e.g. "
+                   "mstd:8,64;cpus=0-7 pins 8 nonblocking threads to CPUs "
+                   "0-7 and the blocking threads to the other CPUs:"),
     llvm::cl::init("s"));
 
 // Enable HostAllocator types to be specified on the command line.
@@ -60,9 +64,141 @@ static llvm::cl::opt<tfrt::HostAllocatorType> cl_host_allocator_type(  // NOLINT
         clEnumValN(tfrt::HostAllocatorType::kProfiledMalloc,
                    "profiled_allocator", "Malloc with metric profiling."),
         clEnumValN(tfrt::HostAllocatorType::kLeakCheckMalloc,
-                   "leak_check_allocator", "Malloc with memory leak check.")),
+                   "leak_check_allocator", "Malloc with memory leak check."),
+        clEnumValN(tfrt::HostAllocatorType::kSlab, "slab",
+                   "Thread-local size class caches for small allocations."),
+        clEnumValN(tfrt::HostAllocatorType::kNumaSlab, "numa_slab",
+                   "Slab allocator for each NUMA node."),
+        clEnumValN(tfrt::HostAllocatorType::kHugePageSlab, "huge_page_slab",
+                   "Slab allocator with explicit huge pages for large "
+                   "allocations.")),
     llvm::cl::init(tfrt::HostAllocatorType::kLeakCheckMalloc));
 
+// Enable BEFExecutor scheduling modes to be specified on the command line.
+static llvm::cl::opt<tfrt::BEFSchedulingMode> cl_scheduling_mode(  // NOLINT
+    "scheduling_mode", llvm::cl::desc("Specify BEF executor scheduling mode:"),
+    llvm::cl::values(
+        clEnumValN(tfrt::BEFSchedulingMode::kInlineOutline, "inline_outline",
+                   "Run kernels of the current stream inline and enqueue "
+                   "the others as one task."),
+        clEnumValN(tfrt::BEFSchedulingMode::kStreamStealing, "stream_stealing",
+                   "Group ready kernels by stream and let idle workers steal "
+                   "whole streams.")),
+    llvm::cl::init(tfrt::BEFSchedulingMode::kInlineOutline));
+
+static llvm::cl::list<std::string> cl_scheduled_functions(  // NOLINT
+    "scheduled_functions",
+    llvm::cl::desc("Specify MLIR functions that use --scheduling_mode. If "
+                   "empty, it applies to all functions."),
+    llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated);
+
+static llvm::cl::opt<bool> cl_prioritize_critical_path(  // NOLINT
+    "prioritize_critical_path",
+    llvm::cl::desc("Run ready kernels on the longest chain of dependent "
+                   "kernels first."),
+    llvm::cl::Optional, llvm::cl::ValueDisallowed);
+
+static llvm::cl::opt<bool> cl_print_kernel_profile(  // NOLINT
+    "print_kernel_profile",
+    llvm::cl::desc("Profile every kernel and print per-kernel invocation "
+                   "counts, wall time and async wait time at exit."),
+    llvm::cl::Optional, llvm::cl::ValueDisallowed);
+
+static llvm::cl::opt<std::string> cl_kernel_cost_profile(  // NOLINT
+    "kernel_cost_profile",
+    llvm::cl::desc("Profile every kernel and write the kernel costs to this "
+                   "file at exit, for the tfrt-apply-cost-profile pass."),
+    llvm::cl::value_desc("filename"), llvm::cl::init(""));
+
+static llvm::cl::opt<bool> cl_print_sampling_profile(  // NOLINT
+    "print_sampling_profile",
+    llvm::cl::desc("Sample the kernels that the threads execute every 10 ms "
+                   "and print the number of samples per kernel at exit."),
+    llvm::cl::Optional, llvm::cl::ValueDisallowed);
+
+static llvm::cl::opt<std::string> cl_heap_profile(  // NOLINT
+    "heap_profile",
+    llvm::cl::desc("Sample the allocations of the profiled host allocators "
+                   "and write a pprof heap profile to this file after running "
+                   "all functions."),
+    llvm::cl::value_desc("filename"), llvm::cl::init(""));
+
+static llvm::cl::opt<size_t> cl_heap_profile_sample_period(  // NOLINT
+    "heap_profile_sample_period",
+    llvm::cl::desc("Average number of bytes allocated between heap profile "
+                   "samples."),
+    llvm::cl::init(512 * 1024));
+
+static llvm::cl::opt<size_t> cl_arena_chunk_size(  // NOLINT
+    "arena_chunk_size",
+    llvm::cl::desc("If positive, give each function call an arena allocator "
+                   "with chunks of this many bytes, which recycles the memory "
+                   "of the intermediate tensors within the call."),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<bool> cl_print_startup_profile(  // NOLINT
+    "print_startup_profile",
+    llvm::cl::desc("Print the wall time of the startup phases, e.g. kernel "
+                   "registration, BEF file loading and the first call of each "
+                   "function, at exit."),
+    llvm::cl::Optional, llvm::cl::ValueDisallowed);
+
+static llvm::cl::opt<bool> cl_defer_kernel_registration(  // NOLINT
+    "defer_kernel_registration",
+    llvm::cl::desc("Register the static kernel families, e.g. tfrt_gpu, on "
+                   "the first lookup of their kernels instead of at startup."),
+    llvm::cl::Optional, llvm::cl::ValueDisallowed);
+
+static llvm::cl::list<std::string> cl_preload_bef_files(  // NOLINT
+    "preload_bef_files",
+    llvm::cl::desc("Specify BEF files to open in parallel with the input "
+                   "file"),
+    llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated);
+
+static llvm::cl::opt<std::string> cl_record_signatures(  // NOLINT
+    "record_signatures",
+    llvm::cl::desc("Write the signatures of the function calls to this file, "
+                   "for --warmup_signatures."),
+    llvm::cl::value_desc("filename"), llvm::cl::init(""));
+
+static llvm::cl::opt<std::string> cl_warmup_signatures(  // NOLINT
+    "warmup_signatures",
+    llvm::cl::desc("Call the functions of the signatures in this file with "
+                   "zero-filled arguments before running the functions."),
+    llvm::cl::value_desc("filename"), llvm::cl::init(""));
+
+static llvm::cl::opt<int> cl_load_num_callers(  // NOLINT
+    "load_num_callers",
+    llvm::cl::desc("Run each function under load from this number of "
+                   "concurrent callers, each of which calls it again when the "
+                   "previous call has completed, and print its latency "
+                   "percentiles."),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<double> cl_load_qps(  // NOLINT
+    "load_qps",
+    llvm::cl::desc("Run each function under load from calls that arrive at "
+                   "this average rate per second (a Poisson process), and "
+                   "print its latency percentiles. Overrides "
+                   "--load_num_callers."),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<double> cl_load_warmup_secs(  // NOLINT
+    "load_warmup_secs",
+    llvm::cl::desc("Seconds of load before the calls are measured."),
+    llvm::cl::init(1));
+
+static llvm::cl::opt<double> cl_load_duration_secs(  // NOLINT
+    "load_duration_secs",
+    llvm::cl::desc("Seconds of load during which the calls are measured."),
+    llvm::cl::init(10));
+
+static llvm::cl::opt<bool> cl_print_cpurt_kernel_stats(  // NOLINT
+    "print_cpurt_kernel_stats",
+    llvm::cl::desc("Print the time spent compiling and executing every CPURT "
+                   "kernel at exit."),
+    llvm::cl::Optional, llvm::cl::ValueDisallowed);
+
 // Enable aggregate op handler types to be specified on the command line.
 static llvm::cl::opt<bool> cl_enable_tracing(  // NOLINT
     "enable_tracing", llvm::cl::desc("Enable Performance Tracing"),
@@ -98,10 +234,36 @@ int main(int argc, char** argv) {
   run_config.work_queue_type = cl_work_queue_type;
   run_config.host_allocator_type = cl_host_allocator_type;
   run_config.print_error_code = cl_print_error_code;
+  run_config.arena_chunk_size = cl_arena_chunk_size;
+  run_config.scheduling_mode = cl_scheduling_mode;
+  run_config.scheduled_functions = cl_scheduled_functions;
+  run_config.prioritize_critical_path = cl_prioritize_critical_path;
+  run_config.print_kernel_profile = cl_print_kernel_profile;
+  run_config.kernel_cost_profile_filename = cl_kernel_cost_profile;
+  run_config.print_sampling_profile = cl_print_sampling_profile;
+  run_config.heap_profile_filename = cl_heap_profile;
+  run_config.heap_profile_sample_period = cl_heap_profile_sample_period;
+  run_config.print_startup_profile = cl_print_startup_profile;
+  run_config.defer_kernel_registration = cl_defer_kernel_registration;
+  run_config.preload_bef_files = cl_preload_bef_files;
+  run_config.record_signatures_filename = cl_record_signatures;
+  run_config.warmup_signatures_filename = cl_warmup_signatures;
+  run_config.load_num_callers = cl_load_num_callers;
+  run_config.load_qps = cl_load_qps;
+  run_config.load_warmup_secs = cl_load_warmup_secs;
+  run_config.load_duration_secs = cl_load_duration_secs;
 
   llvm::Optional<tfrt::tracing::TracingRequester> tracing;
   if (cl_enable_tracing) tracing.emplace();
   tfrt::tracing::SetTracingLevel(cl_tracing_level);
 
-  return RunBefExecutor(run_config);
+  if (cl_print_cpurt_kernel_stats)
+    tfrt::cpu::jit::EnableKernelExecutionStats(true);
+
+  int result = RunBefExecutor(run_config);
+
+  if (cl_print_cpurt_kernel_stats)
+    tfrt::cpu::jit::PrintKernelStats(tfrt::outs());
+
+  return result;
 }
@@ -29,6 +29,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "tfrt/host_context/host_buffer.h"
+#include "tfrt/support/crc32c.h"
 #include "tfrt/tensor/btf.h"
 #include "tfrt/tensor/coo_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor.h"
@@ -153,6 +154,46 @@ class BtfFile {
     return DenseHostTensor(metadata, std::move(buf));
   }
 
+  // Read a dense tensor stored in checksummed chunks from the BTF file.
+  //
+  // The caveats described in the ReadDenseHostTensorPayload documentation also
+  // apply to the returned tensor.
+  //
+  // Returns llvm::None if the payload is malformed or a chunk doesn't match its
+  // checksum.
+  llvm::Optional<DenseHostTensor> ReadChunkedDenseHostTensorPayload(
+      size_t* pos, DType type, uint64_t rank) const {
+    const int64_t* dims = Read<int64_t>(pos, rank);
+    if (!dims) return llvm::None;
+
+    TensorMetadata metadata(type, llvm::ArrayRef<ssize_t>(dims, rank));
+    size_t data_size = type.GetHostSize() * metadata.shape.GetNumElements();
+
+    const uint64_t* num_chunks = Read<uint64_t>(pos);
+    if (!num_chunks || *num_chunks > size_) return llvm::None;
+    const uint64_t* chunk_offsets = Read<uint64_t>(pos, *num_chunks + 1);
+    const uint32_t* chunk_crcs = Read<uint32_t>(pos, *num_chunks);
+    if (!chunk_offsets || !chunk_crcs) return llvm::None;
+    *pos = (*pos + 7) & ~size_t{7};
+
+    const char* data = Read<char>(pos, data_size);
+    if (!data) return llvm::None;
+
+    if (chunk_offsets[0] != 0 || chunk_offsets[*num_chunks] != data_size)
+      return llvm::None;
+    for (uint64_t i = 0; i < *num_chunks; ++i) {
+      if (chunk_offsets[i] > chunk_offsets[i + 1]) return llvm::None;
+      const uint32_t crc =
+          tfrt::crc32c::Value(data + chunk_offsets[i],
+                              chunk_offsets[i + 1] - chunk_offsets[i]);
+      if (tfrt::crc32c::Unmask(chunk_crcs[i]) != crc) return llvm::None;
+    }
+
+    RCReference<HostBuffer> buf = HostBuffer::CreateFromExternal(
+        const_cast<char*>(data), data_size, [](void*, size_t) {});
+    return DenseHostTensor(metadata, std::move(buf));
+  }
+
   // Read a COO tensor from the BTF file.
   //
   // The caveats described in the ReadDenseHostTensorPayload documentation also
@@ -228,6 +269,21 @@ int main(int argc, char* argv[]) {
         llvm::outs() << "\n";
       } break;
 
+      case TensorLayout::kRMD_CHUNKED: {
+        llvm::Optional<DenseHostTensor> tensor =
+            file.ReadChunkedDenseHostTensorPayload(&payload_pos, type,
+                                                   header->rank);
+        if (!tensor) {
+          llvm::errs() << "Could not parse chunked payload for tensor " << i
+                       << "\n";
+          continue;
+        }
+
+        llvm::outs() << "[" << i << "] ";
+        tensor->Print(llvm::outs());
+        llvm::outs() << "\n";
+      } break;
+
       case TensorLayout::kCOO_EXPERIMENTAL: {
         llvm::Optional<CooHostTensor> tensor =
             file.ReadCooHostTensorPayload(&payload_pos, type, header->rank);
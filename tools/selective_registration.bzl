@@ -0,0 +1,58 @@
+# Copyright 2021 The TensorFlow Runtime Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""BUILD rules for binaries that only register what their BEF files use."""
+
+load("@tf_runtime//:build_defs.bzl", "tfrt_cc_library")
+
+def tfrt_selective_registration(
+        name,
+        bef_files,
+        deps = [],
+        bef_deps = "@tf_runtime//tools:bef_deps",
+        **kwargs):
+    """Creates a library that restricts registration to what BEF files use.
+
+    Runs "bef_deps --output_format=cc" on `bef_files` to generate the kernel
+    and op names that the binary is allowed to register. Kernel families
+    without allowed kernels are skipped at startup, and all other kernels and
+    ops are dropped from the registries.
+
+    Bazel can't derive the dependencies of a target from the contents of
+    files, so the kernel and op libraries are passed as `deps`. Run
+    "bef_deps --output_format=deps" on the BEF files to print them, and only
+    link those instead of e.g. tools:bef_executor_lightweight_kernels.
+
+    Args:
+      name: the name of the library.
+      bef_files: the BEF files, or the rules that generate them.
+      deps: the _alwayslink libraries that register the kernels and ops.
+      bef_deps: the tool to use.
+      **kwargs: passed to tfrt_cc_library.
+    """
+    src = name + "_selective_registration.cc"
+    native.genrule(
+        name = name + "_gen",
+        srcs = bef_files,
+        outs = [src],
+        cmd = "$(location " + bef_deps + ") --output_format=cc $(SRCS) > $@",
+        exec_tools = [bef_deps],
+    )
+    tfrt_cc_library(
+        name = name,
+        srcs = [src],
+        alwayslink = 1,
+        deps = deps + ["@tf_runtime//:support"],
+        **kwargs
+    )